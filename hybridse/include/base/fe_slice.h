@@ -20,6 +20,7 @@
 #include <memory.h>
 #include <stddef.h>
 #include <string.h>
+#include <atomic>
 #include <memory>
 #include <string>
 #include "base/raw_buffer.h"
@@ -129,39 +130,62 @@ class RefCountedSlice : public Slice {
 
     // Create slice own the buffer
     inline static RefCountedSlice CreateManaged(int8_t *buf, size_t size) {
-        return RefCountedSlice(buf, size, true);
+        return RefCountedSlice(buf, size, new RefCount(false));
     }
 
+    // Create slice own a new buffer of `size` bytes, the buffer and its
+    // reference count are in one allocation
+    static RefCountedSlice Allocate(size_t size);
+
     // Create slice without ownership
     inline static RefCountedSlice Create(int8_t *buf, size_t size) {
-        return RefCountedSlice(buf, size, false);
+        return RefCountedSlice(buf, size, nullptr);
     }
 
     // Create slice without ownership
     inline static RefCountedSlice Create(const char *buf, size_t size) {
-        return RefCountedSlice(buf, size, false);
+        return RefCountedSlice(buf, size, nullptr);
+    }
+
+    // Create slice referencing the buffer kept alive by `owner`, which is
+    // released with the last slice sharing it
+    inline static RefCountedSlice CreateShared(
+        const char *buf, size_t size, const std::shared_ptr<void> &owner) {
+        RefCountedSlice slice(buf, size, nullptr);
+        slice.owner_ = owner;
+        return slice;
     }
 
     RefCountedSlice() : Slice(nullptr, 0), ref_cnt_(nullptr) {}
 
     RefCountedSlice(const RefCountedSlice &slice);
-    RefCountedSlice(RefCountedSlice &&);
+    RefCountedSlice(RefCountedSlice &&) noexcept;
     RefCountedSlice &operator=(const RefCountedSlice &);
-    RefCountedSlice &operator=(RefCountedSlice &&);
+    RefCountedSlice &operator=(RefCountedSlice &&) noexcept;
 
  private:
-    RefCountedSlice(int8_t *data, size_t size, bool managed)
+    // The reference count of a managed buffer, which is atomic so that the
+    // slices of a buffer can be copied and released on different threads.
+    // An intrusive one is the header right before the buffer it counts.
+    struct alignas(16) RefCount {
+        explicit RefCount(bool intrusive) : cnt(1), intrusive(intrusive) {}
+        std::atomic<int32_t> cnt;
+        const bool intrusive;
+    };
+
+    RefCountedSlice(int8_t *data, size_t size, RefCount *ref_cnt)
         : Slice(reinterpret_cast<const char *>(data), size),
-          ref_cnt_(managed ? new int(1) : nullptr) {}
+          ref_cnt_(ref_cnt) {}
 
-    RefCountedSlice(const char *data, size_t size, bool managed)
-        : Slice(data, size), ref_cnt_(managed ? new int(1) : nullptr) {}
+    RefCountedSlice(const char *data, size_t size, RefCount *ref_cnt)
+        : Slice(data, size), ref_cnt_(ref_cnt) {}
 
     void Release();
 
     void Update(const RefCountedSlice &slice);
 
-    int32_t *ref_cnt_;
+    RefCount *ref_cnt_;
+    std::shared_ptr<void> owner_;
 };
 
 }  // namespace base
@@ -81,6 +81,13 @@ class AbstractIterator {
 
     /// Move to the beginning of the dataset.
     virtual void SeekToFirst() = 0;
+
+    /// Stop the iteration once the key of an element passes `bound` in the
+    /// order of the iteration, or `limit` elements are iterated since the
+    /// last seek. `limit` is unlimited if it is 0.
+    /// Return `false` by default as the bound is ignored, and the caller
+    /// checks the elements no matter whether it is applied.
+    virtual bool SetBound(const K& bound, uint64_t limit) { return false; }
 };
 /// \brief An iterator over a key-value pairs dataset
 /// \tparam K key type of elements
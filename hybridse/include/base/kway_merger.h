@@ -0,0 +1,150 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef INCLUDE_BASE_KWAY_MERGER_H_
+#define INCLUDE_BASE_KWAY_MERGER_H_
+
+#include <functional>
+#include <utility>
+#include <vector>
+
+namespace hybridse {
+namespace base {
+
+// KWayMerger tells which of the k sorted sources holds the next key of the
+// merge. The sources are kept in a binary heap by their current keys, the
+// source whose key comes first by Compare is on the top, and the ties go to
+// the lower source index, or to the higher one if kTieToLower is false.
+//
+// The source on the top which still comes before the best of the other
+// sources after it moves is not sifted, so a run of the keys of one source
+// not overlapping the others takes a single comparison per key.
+template <typename Key, typename Compare = std::less<Key>,
+          bool kTieToLower = true>
+class KWayMerger {
+ public:
+    KWayMerger() : cmp_(), keys_(), heap_(), bound_(kNoSource) {}
+
+    // remove all the sources and size the merger for cnt sources
+    void Reset(size_t cnt) {
+        keys_.assign(cnt, Key());
+        heap_.clear();
+        heap_.reserve(cnt);
+        bound_ = kNoSource;
+    }
+
+    // add the source idx at its first key, a source is added at most once
+    void Add(size_t idx, const Key& key) {
+        keys_[idx] = key;
+        heap_.push_back(idx);
+        SiftUp(heap_.size() - 1);
+        bound_ = kNoSource;
+    }
+
+    bool Empty() const { return heap_.empty(); }
+    size_t Size() const { return heap_.size(); }
+
+    // the source holding the next key, the merger must not be empty
+    size_t Top() const { return heap_[0]; }
+    const Key& TopKey() const { return keys_[heap_[0]]; }
+
+    // the top source moved to the key
+    void Next(const Key& key) {
+        size_t top = heap_[0];
+        keys_[top] = key;
+        if (heap_.size() == 1) {
+            return;
+        }
+        if (bound_ == kNoSource) {
+            bound_ = heap_[1];
+            if (heap_.size() > 2 && Before(heap_[2], bound_)) {
+                bound_ = heap_[2];
+            }
+        }
+        if (Before(top, bound_)) {
+            return;
+        }
+        SiftDown(0);
+        bound_ = kNoSource;
+    }
+
+    // the top source is exhausted
+    void Pop() {
+        heap_[0] = heap_.back();
+        heap_.pop_back();
+        if (!heap_.empty()) {
+            SiftDown(0);
+        }
+        bound_ = kNoSource;
+    }
+
+ private:
+    static constexpr size_t kNoSource = static_cast<size_t>(-1);
+
+    bool Before(size_t lhs, size_t rhs) const {
+        if (cmp_(keys_[lhs], keys_[rhs])) {
+            return true;
+        }
+        if (cmp_(keys_[rhs], keys_[lhs])) {
+            return false;
+        }
+        return kTieToLower ? lhs < rhs : lhs > rhs;
+    }
+
+    void SiftUp(size_t pos) {
+        size_t idx = heap_[pos];
+        while (pos > 0) {
+            size_t parent = (pos - 1) / 2;
+            if (!Before(idx, heap_[parent])) {
+                break;
+            }
+            heap_[pos] = heap_[parent];
+            pos = parent;
+        }
+        heap_[pos] = idx;
+    }
+
+    void SiftDown(size_t pos) {
+        size_t idx = heap_[pos];
+        size_t size = heap_.size();
+        while (true) {
+            size_t child = 2 * pos + 1;
+            if (child >= size) {
+                break;
+            }
+            if (child + 1 < size && Before(heap_[child + 1], heap_[child])) {
+                child++;
+            }
+            if (!Before(heap_[child], idx)) {
+                break;
+            }
+            heap_[pos] = heap_[child];
+            pos = child;
+        }
+        heap_[pos] = idx;
+    }
+
+    Compare cmp_;
+    std::vector<Key> keys_;
+    // the sources in the heap
+    std::vector<size_t> heap_;
+    // the best of the children of the top, kNoSource if it is not known
+    size_t bound_;
+};
+
+}  // namespace base
+}  // namespace hybridse
+#endif  // INCLUDE_BASE_KWAY_MERGER_H_
@@ -18,6 +18,8 @@
 #define INCLUDE_BASE_MEM_POOL_H_
 #include <stddef.h>
 #include <stdint.h>
+#include <algorithm>
+#include <atomic>
 #include <list>
 #include <thread>  //NOLINT
 #include "glog/logging.h"
@@ -40,6 +42,8 @@ class MemoryChunk {
         delete[] mem_;
     }
     inline size_t available_size() { return chuck_size_ - allocated_size_; }
+    inline size_t allocated_size() { return allocated_size_; }
+    inline size_t chuck_size() { return chuck_size_; }
     char* Alloc(size_t request_size) {
         if (request_size > available_size()) {
             return nullptr;
@@ -50,6 +54,7 @@ class MemoryChunk {
     }
     inline void free() { allocated_size_ = 0; }
     inline MemoryChunk* next() { return next_; }
+    inline void set_next(MemoryChunk* next) { next_ = next; }
     enum { DEFAULT_CHUCK_SIZE = 4096 };
 
  private:
@@ -58,10 +63,30 @@ class MemoryChunk {
     size_t allocated_size_;
     char* mem_;
 };
+
+// the chucks allocated and freed from the heap by the pools of all threads
+struct MemPoolStats {
+    uint64_t heap_alloc_cnt = 0;
+    uint64_t heap_alloc_bytes = 0;
+    uint64_t heap_free_cnt = 0;
+    uint64_t heap_free_bytes = 0;
+    // the chucks reused from the free chucks of the pools
+    uint64_t recycle_cnt = 0;
+};
+
+// the chucks are sized in the power of two classes from DEFAULT_CHUCK_SIZE to
+// MAX_RETAINED_SIZE. The chucks released by a reset are kept in the free
+// lists of their classes and reused by the later expansions, so the runs in
+// the steady state allocate nothing from the heap. The pool is not thread
+// safe and is used by one thread, e.g. the thread local JitRuntime
 class ByteMemoryPool {
  public:
     explicit ByteMemoryPool(size_t init_size = MemoryChunk::DEFAULT_CHUCK_SIZE)
-        : chucks_(nullptr) {
+        : chucks_(nullptr),
+          free_chucks_(),
+          free_size_(0),
+          used_size_(0),
+          peak_used_size_(0) {
         DLOG(INFO) << std::this_thread::get_id() << " " << __FUNCTION__ << "("
                    << reinterpret_cast<void*>(this) << ")" << std::endl;
 
@@ -70,31 +95,187 @@ class ByteMemoryPool {
     ~ByteMemoryPool() {
         DLOG(INFO) << std::this_thread::get_id() << " " << __FUNCTION__ << "("
                    << reinterpret_cast<void*>(this) << ")" << std::endl;
-        Reset();
+        Release();
+        for (auto& chuck : free_chucks_) {
+            while (chuck) {
+                auto next = chuck->next();
+                DeleteChuck(chuck);
+                chuck = next;
+            }
+        }
     }
     char* Alloc(size_t request_size) {
         if (nullptr == chucks_ || chucks_->available_size() < request_size) {
             ExpandStorage(request_size);
         }
+        used_size_ += request_size;
         return chucks_->Alloc(request_size);
     }
 
-    // clear last chuck
-    // and delete other chucks
+    // make the next allocations of size bytes in total fit in one chuck,
+    // e.g. the memory used by the last runs of the same sql
+    void Reserve(size_t size) {
+        if (chucks_ != nullptr && chucks_->available_size() >= size) {
+            return;
+        }
+        if (used_size_ == 0) {
+            Recycle();
+        }
+        ExpandStorage(size);
+    }
+
+    // free all the allocated memory for reuse. the chucks used since the
+    // last reset are replaced by one chuck which fits them all, so the next
+    // run of the same size allocates from one chuck. a chuck larger
+    // than MAX_RETAINED_SIZE is not kept
     void Reset() {
+        peak_used_size_ = std::max(peak_used_size_, used_size_);
+        size_t used = used_size_;
+        used_size_ = 0;
+        if (chucks_ != nullptr && chucks_->next() == nullptr &&
+            chucks_->chuck_size() <= MAX_RETAINED_SIZE) {
+            chucks_->free();
+            return;
+        }
+        Recycle();
+        if (used > 0 && used <= MAX_RETAINED_SIZE) {
+            ExpandStorage(used);
+        }
+    }
+    void ExpandStorage(size_t request_size) {
+        size_t size = ChuckSize(request_size);
+        MemoryChunk* chuck = PopFreeChuck(size);
+        if (chuck == nullptr) {
+            chuck = new MemoryChunk(nullptr, size);
+            stats_.heap_alloc_cnt.fetch_add(1, std::memory_order_relaxed);
+            stats_.heap_alloc_bytes.fetch_add(size, std::memory_order_relaxed);
+        }
+        chuck->set_next(chucks_);
+        chucks_ = chuck;
+    }
+
+    // the bytes allocated since the last reset
+    size_t used_size() const { return used_size_; }
+    // the max bytes allocated between two resets since the last ResetPeak
+    size_t peak_used_size() const {
+        return std::max(peak_used_size_, used_size_);
+    }
+    void ResetPeak() { peak_used_size_ = 0; }
+    // the bytes of the free chucks kept for reuse
+    size_t free_size() const { return free_size_; }
+
+    static MemPoolStats GetStats() {
+        MemPoolStats stats;
+        stats.heap_alloc_cnt =
+            stats_.heap_alloc_cnt.load(std::memory_order_relaxed);
+        stats.heap_alloc_bytes =
+            stats_.heap_alloc_bytes.load(std::memory_order_relaxed);
+        stats.heap_free_cnt =
+            stats_.heap_free_cnt.load(std::memory_order_relaxed);
+        stats.heap_free_bytes =
+            stats_.heap_free_bytes.load(std::memory_order_relaxed);
+        stats.recycle_cnt = stats_.recycle_cnt.load(std::memory_order_relaxed);
+        return stats;
+    }
+
+    enum { MAX_RETAINED_SIZE = 1 << 20 };
+    // the max bytes of the free chucks kept by a pool
+    enum { MAX_FREE_SIZE = 4 << 20 };
+
+ private:
+    // log2(MAX_RETAINED_SIZE / DEFAULT_CHUCK_SIZE) + 1
+    static constexpr size_t SIZE_CLASS_NUM = 9;
+
+    // zero initialized as a static member
+    struct AtomicStats {
+        std::atomic<uint64_t> heap_alloc_cnt;
+        std::atomic<uint64_t> heap_alloc_bytes;
+        std::atomic<uint64_t> heap_free_cnt;
+        std::atomic<uint64_t> heap_free_bytes;
+        std::atomic<uint64_t> recycle_cnt;
+    };
+
+    // the size of the class which fits the request, the request larger than
+    // MAX_RETAINED_SIZE is not rounded, in which case the chuck isn't kept
+    static size_t ChuckSize(size_t request_size) {
+        if (request_size > MAX_RETAINED_SIZE) {
+            return request_size;
+        }
+        size_t size = MemoryChunk::DEFAULT_CHUCK_SIZE;
+        while (size < request_size) {
+            size <<= 1;
+        }
+        return size;
+    }
+    static size_t SizeClass(size_t size) {
+        size_t size_class = 0;
+        while ((static_cast<size_t>(MemoryChunk::DEFAULT_CHUCK_SIZE)
+                << size_class) < size) {
+            size_class++;
+        }
+        return size_class;
+    }
+
+    // take a free chuck of the class of size or a larger one
+    MemoryChunk* PopFreeChuck(size_t size) {
+        if (size > MAX_RETAINED_SIZE) {
+            return nullptr;
+        }
+        for (size_t i = SizeClass(size); i < SIZE_CLASS_NUM; i++) {
+            MemoryChunk* chuck = free_chucks_[i];
+            if (chuck != nullptr) {
+                free_chucks_[i] = chuck->next();
+                free_size_ -= chuck->chuck_size();
+                chuck->free();
+                stats_.recycle_cnt.fetch_add(1, std::memory_order_relaxed);
+                return chuck;
+            }
+        }
+        return nullptr;
+    }
+
+    // move all the chucks to the free lists
+    void Recycle() {
         auto chuck = chucks_;
         while (chuck) {
             chucks_ = chuck->next();
-            delete chuck;
+            size_t size = chuck->chuck_size();
+            if (size > MAX_RETAINED_SIZE || free_size_ + size > MAX_FREE_SIZE) {
+                DeleteChuck(chuck);
+            } else {
+                size_t size_class = SizeClass(size);
+                chuck->set_next(free_chucks_[size_class]);
+                free_chucks_[size_class] = chuck;
+                free_size_ += size;
+            }
             chuck = chucks_;
         }
     }
-    void ExpandStorage(size_t request_size) {
-        chucks_ = new MemoryChunk(chucks_, request_size);
+
+    // delete all the chucks
+    void Release() {
+        auto chuck = chucks_;
+        while (chuck) {
+            chucks_ = chuck->next();
+            DeleteChuck(chuck);
+            chuck = chucks_;
+        }
+    }
+
+    static void DeleteChuck(MemoryChunk* chuck) {
+        stats_.heap_free_cnt.fetch_add(1, std::memory_order_relaxed);
+        stats_.heap_free_bytes.fetch_add(chuck->chuck_size(),
+                                         std::memory_order_relaxed);
+        delete chuck;
     }
 
- private:
     MemoryChunk* chucks_;
+    MemoryChunk* free_chucks_[SIZE_CLASS_NUM];
+    size_t free_size_;
+    size_t used_size_;
+    size_t peak_used_size_;
+
+    inline static AtomicStats stats_;
 };
 }  // namespace base
 }  // namespace hybridse
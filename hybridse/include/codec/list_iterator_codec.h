@@ -62,7 +62,9 @@ class ColumnImpl : public WrapListImpl<V, Row> {
           root_(impl),
           row_idx_(row_idx),
           col_idx_(col_idx),
-          offset_(offset) {}
+          offset_(offset),
+          iter_cnt_(0),
+          decoded_(nullptr) {}
 
     ~ColumnImpl() {}
 
@@ -99,15 +101,28 @@ class ColumnImpl : public WrapListImpl<V, Row> {
         return new ColumnIterator<V>(root_, this);
     }
     const uint64_t GetCount() override { return root_->GetCount(); }
-    V At(uint64_t pos) override { return GetFieldUnsafe(root_->At(pos)); }
+    double GetSampleScale() override { return root_->GetSampleScale(); }
+    V At(uint64_t pos) override {
+        // the decoded column is read by the position directly
+        return decoded_ != nullptr ? decoded_->At(pos)
+                                   : GetFieldUnsafe(root_->At(pos));
+    }
 
     ListV<Row> *root() const override { return root_; }
 
+    // count the iterations over the column, the column iterated more than
+    // once is decoded and the decoded list is shared by the later iterations
+    uint32_t IncIterCount() { return ++iter_cnt_; }
+    ListV<V> *GetDecoded() const { return decoded_; }
+    void SetDecoded(ListV<V> *decoded) { decoded_ = decoded; }
+
  protected:
     ListV<Row> *root_;
     const uint32_t row_idx_;
     const uint32_t col_idx_;
     const uint32_t offset_;
+    uint32_t iter_cnt_;
+    ListV<V> *decoded_;
 };
 
 class StringColumnImpl : public ColumnImpl<StringRef> {
@@ -177,7 +192,12 @@ class ArrayListV : public ListV<V> {
         return new ArrayListIterator<V>(buffer_, start_, end_);
     }
     virtual const uint64_t GetCount() { return end_ - start_; }
-    virtual V At(uint64_t pos) const { return buffer_->at(start_ + pos); }
+    V At(uint64_t pos) override {
+        return start_ + pos < end_ ? buffer_->at(start_ + pos) : V();
+    }
+
+    // the values of the list are contiguous from data()
+    const V *data() const { return buffer_->data() + start_; }
 
  protected:
     uint64_t start_;
@@ -338,7 +358,9 @@ class BoolArrayListV : public ListV<bool> {
         return new BoolArrayListIterator(buffer_, start_, end_);
     }
     virtual const uint64_t GetCount() { return end_ - start_; }
-    virtual bool At(uint64_t pos) const { return buffer_->at(start_ + pos); }
+    bool At(uint64_t pos) override {
+        return start_ + pos < end_ ? buffer_->at(start_ + pos) : false;
+    }
 
  protected:
     uint64_t start_;
@@ -433,6 +455,7 @@ class InnerRangeList : public ListV<V> {
     virtual ConstIterator<uint64_t, V> *GetRawIterator() {
         return new InnerRangeIterator<V>(root_, start_, end_);
     }
+    double GetSampleScale() override { return root_->GetSampleScale(); }
 
     ListV<Row> *root_;
     uint64_t start_;
@@ -453,6 +476,7 @@ class InnerRowsList : public ListV<V> {
     virtual ConstIterator<uint64_t, V> *GetRawIterator() {
         return new InnerRowsIterator<V>(root_, start_, end_);
     }
+    double GetSampleScale() override { return root_->GetSampleScale(); }
 
     ListV<Row> *root_;
     uint64_t start_;
@@ -61,6 +61,10 @@ class ListV {
         }
         return iter->Valid() ? iter->GetValue() : V();
     }
+
+    /// \brief Return the number of elements each element of the list stands
+    /// for, greater than 1 if the list is sampled from a larger one.
+    virtual double GetSampleScale() { return 1.0; }
 };
 }  // namespace codec
 }  // namespace hybridse
@@ -222,12 +222,10 @@ uint32_t CalcTotalLength(uint32_t primary_size, uint32_t str_field_cnt,
                          uint32_t str_size, uint32_t* str_addr_space);
 
 inline void AppendNullBit(int8_t* buf_ptr, uint32_t col_idx, int8_t is_null) {
-    int8_t* ptr = buf_ptr + HEADER_LENGTH + (col_idx >> 3);
-    if (is_null) {
-        *(reinterpret_cast<uint8_t*>(ptr)) |= 1 << (col_idx & 0x07);
-    } else {
-        *(reinterpret_cast<uint8_t*>(ptr)) &= ~(1 << (col_idx & 0x07));
-    }
+    uint8_t* ptr =
+        reinterpret_cast<uint8_t*>(buf_ptr + HEADER_LENGTH + (col_idx >> 3));
+    uint8_t bit = col_idx & 0x07;
+    *ptr = (*ptr & ~(1 << bit)) | ((is_null != 0) << bit);
 }
 
 inline int32_t AppendInt16(int8_t* buf_ptr, uint32_t buf_size, int16_t val,
@@ -2124,6 +2124,11 @@ class ExternalFnDefNode : public FnDefNode {
 
     void SetReturnByArg(bool flag) { this->return_by_arg_ = flag; }
 
+    // the function returns the same output for the same args and has no side
+    // effects, so a call to it on the constants can be run on the compile
+    bool deterministic() const { return deterministic_; }
+    void SetDeterministic(bool flag) { this->deterministic_ = flag; }
+
     bool IsResolved() const { return ret_type_ != nullptr; }
 
     base::Status Validate(const std::vector<const TypeNode *> &arg_types) const override;
@@ -2154,6 +2159,8 @@ class ExternalFnDefNode : public FnDefNode {
     int variadic_pos_;
 
     bool return_by_arg_;
+
+    bool deterministic_ = false;
 };
 
 class UdfDefNode : public FnDefNode {
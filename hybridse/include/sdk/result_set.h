@@ -18,6 +18,7 @@
 #define INCLUDE_SDK_RESULT_SET_H_
 
 #include <stdint.h>
+#include <string.h>
 #include <string>
 #include "sdk/base.h"
 
@@ -216,6 +217,203 @@ class ResultSet {
     virtual bool IsNULL(int index) = 0;
 
     virtual int32_t Size() = 0;
+
+    /// \brief Read the column `index` of all the rows into the buffers of
+    /// the caller in one call.
+    ///
+    /// The values are packed by their native types, 1 byte for a bool, the
+    /// int32 of GetDate for a date and the int64 milliseconds for a
+    /// timestamp, and a null cell is zero. `nulls[i]` is set to 1 if the cell
+    /// of row i is null, and 0 otherwise. The cursor is reset before the
+    /// first row on return.
+    ///
+    /// Return the count of the rows, or -1 if the column is a string column
+    /// or the buffers are too small.
+    int32_t GetColumn(uint32_t index, char* values, uint32_t values_size,
+                      char* nulls, uint32_t nulls_size) {
+        uint32_t width = GetColumnWidth(index);
+        if (width == 0) {
+            return -1;
+        }
+        auto type = GetSchema()->GetColumnType(index);
+        Reset();
+        int32_t cnt = 0;
+        bool ok = true;
+        while (Next()) {
+            if ((static_cast<uint64_t>(cnt) + 1) * width > values_size ||
+                static_cast<uint32_t>(cnt) >= nulls_size) {
+                ok = false;
+                break;
+            }
+            char* value = values + static_cast<uint64_t>(cnt) * width;
+            memset(value, 0, width);
+            nulls[cnt] = IsNULL(index) ? 1 : 0;
+            if (!nulls[cnt]) {
+                ReadValue(index, type, value);
+            }
+            cnt++;
+        }
+        Reset();
+        return ok ? cnt : -1;
+    }
+
+    /// \brief Return the total bytes of the strings of the string column
+    /// `index`, or -1 if it is not a string column. The cursor is reset
+    /// before the first row on return.
+    int64_t GetStringColumnSize(uint32_t index) {
+        if (!IsStringColumn(index)) {
+            return -1;
+        }
+        Reset();
+        int64_t size = 0;
+        std::string val;
+        while (Next()) {
+            if (!IsNULL(index) && GetString(index, &val)) {
+                size += val.size();
+            }
+        }
+        Reset();
+        return size;
+    }
+
+    /// \brief Read the string column `index` of all the rows into the
+    /// buffers of the caller in one call.
+    ///
+    /// The strings are concatenated in `values`, and the string of row i is
+    /// from the int32 offset i to the int32 offset i + 1 of `offsets`, which
+    /// holds one offset more than the rows. A null cell is an empty string
+    /// with `nulls[i]` set to 1. The cursor is reset before the first row on
+    /// return.
+    ///
+    /// Return the count of the rows, or -1 if it is not a string column or
+    /// the buffers are too small.
+    int32_t GetStringColumn(uint32_t index, char* values, uint32_t values_size,
+                            char* offsets, uint32_t offsets_size, char* nulls,
+                            uint32_t nulls_size) {
+        if (!IsStringColumn(index) || offsets_size < sizeof(int32_t)) {
+            return -1;
+        }
+        Reset();
+        int32_t cnt = 0;
+        int32_t offset = 0;
+        bool ok = true;
+        std::string val;
+        memcpy(offsets, &offset, sizeof(offset));
+        while (Next()) {
+            if ((static_cast<uint64_t>(cnt) + 2) * sizeof(int32_t) >
+                    offsets_size ||
+                static_cast<uint32_t>(cnt) >= nulls_size) {
+                ok = false;
+                break;
+            }
+            val.clear();
+            nulls[cnt] = IsNULL(index) ? 1 : 0;
+            if (!nulls[cnt]) {
+                GetString(index, &val);
+            }
+            if (static_cast<uint64_t>(offset) + val.size() > values_size) {
+                ok = false;
+                break;
+            }
+            memcpy(values + offset, val.data(), val.size());
+            offset += val.size();
+            cnt++;
+            memcpy(offsets + cnt * sizeof(int32_t), &offset, sizeof(offset));
+        }
+        Reset();
+        return ok ? cnt : -1;
+    }
+
+ private:
+    bool IsStringColumn(uint32_t index) {
+        auto schema = GetSchema();
+        return schema != nullptr &&
+               static_cast<int32_t>(index) < schema->GetColumnCnt() &&
+               schema->GetColumnType(index) == kTypeString;
+    }
+
+    // the bytes of a value of the column in GetColumn, 0 if it is a string
+    // column or out of the schema
+    uint32_t GetColumnWidth(uint32_t index) {
+        auto schema = GetSchema();
+        if (schema == nullptr ||
+            static_cast<int32_t>(index) >= schema->GetColumnCnt()) {
+            return 0;
+        }
+        switch (schema->GetColumnType(index)) {
+            case kTypeBool:
+                return 1;
+            case kTypeInt16:
+                return sizeof(int16_t);
+            case kTypeInt32:
+            case kTypeDate:
+                return sizeof(int32_t);
+            case kTypeFloat:
+                return sizeof(float);
+            case kTypeInt64:
+            case kTypeTimestamp:
+                return sizeof(int64_t);
+            case kTypeDouble:
+                return sizeof(double);
+            default:
+                return 0;
+        }
+    }
+
+    void ReadValue(uint32_t index, DataType type, char* value) {
+        switch (type) {
+            case kTypeBool: {
+                bool v = false;
+                GetBool(index, &v);
+                *value = v ? 1 : 0;
+                break;
+            }
+            case kTypeInt16: {
+                int16_t v = 0;
+                GetInt16(index, &v);
+                memcpy(value, &v, sizeof(v));
+                break;
+            }
+            case kTypeInt32: {
+                int32_t v = 0;
+                GetInt32(index, &v);
+                memcpy(value, &v, sizeof(v));
+                break;
+            }
+            case kTypeDate: {
+                int32_t v = 0;
+                GetDate(index, &v);
+                memcpy(value, &v, sizeof(v));
+                break;
+            }
+            case kTypeFloat: {
+                float v = 0;
+                GetFloat(index, &v);
+                memcpy(value, &v, sizeof(v));
+                break;
+            }
+            case kTypeInt64: {
+                int64_t v = 0;
+                GetInt64(index, &v);
+                memcpy(value, &v, sizeof(v));
+                break;
+            }
+            case kTypeTimestamp: {
+                int64_t v = 0;
+                GetTime(index, &v);
+                memcpy(value, &v, sizeof(v));
+                break;
+            }
+            case kTypeDouble: {
+                double v = 0;
+                GetDouble(index, &v);
+                memcpy(value, &v, sizeof(v));
+                break;
+            }
+            default:
+                break;
+        }
+    }
 };
 
 }  // namespace sdk
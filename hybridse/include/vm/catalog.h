@@ -52,6 +52,12 @@ struct IndexSt {
     std::vector<ColInfo> keys;  ///< first keys set
 };
 
+/// Represents the statistics of the data of an index
+struct IndexStats {
+    uint64_t pk_cnt = 0;   ///< count of the first keys
+    uint64_t row_cnt = 0;  ///< count of the rows in the index
+};
+
 /// \typedef IndexList repeated fields of IndexDef
 typedef ::google::protobuf::RepeatedPtrField<::hybridse::type::IndexDef>
     IndexList;
@@ -93,6 +99,47 @@ class DataHandler : public ListV<Row> {
     virtual base::Status GetStatus() { return base::Status::OK(); }
 };
 
+/// \brief The positional access of a list without random access, e.g. a
+/// window read from the storage.
+///
+/// The rows are read from one iterator of the list on demand and kept with
+/// their positions, so lag, at and first_value over the window walk the rows
+/// before the position once instead of once per call. The iterator is kept
+/// as long as the rows, since they may refer to the memory it holds.
+class RowPositionIndex {
+ public:
+    explicit RowPositionIndex(ListV<Row>* list)
+        : list_(list), iter_(), rows_(), inited_(false) {}
+
+    Row At(uint64_t pos) {
+        if (!inited_) {
+            inited_ = true;
+            iter_ = list_->GetIterator();
+            if (iter_) {
+                iter_->SeekToFirst();
+            }
+        }
+        while (rows_.size() <= pos && iter_ && iter_->Valid()) {
+            rows_.push_back(iter_->GetValue());
+            iter_->Next();
+        }
+        return pos < rows_.size() ? rows_[pos] : Row();
+    }
+
+    /// Drop the rows, e.g. the rows of the list are filtered by a new predicate
+    void Reset() {
+        iter_.reset();
+        rows_.clear();
+        inited_ = false;
+    }
+
+ private:
+    ListV<Row>* list_;
+    std::unique_ptr<RowIterator> iter_;
+    std::vector<Row> rows_;
+    bool inited_;
+};
+
 /// \brief A sequence of DataHandler
 class DataHandlerList {
  public:
@@ -209,6 +256,18 @@ class ErrorRowHandler : public RowHandler {
     Row row_;
 };
 
+/// \brief A predicate on the encoded rows of a table.
+///
+/// It is evaluated by the storage on the raw buffer of a row, so the rows
+/// not matched are skipped before they are materialized.
+class RowPredicate {
+ public:
+    RowPredicate() {}
+    virtual ~RowPredicate() {}
+    /// Return whether the encoded row matches the predicate.
+    virtual bool Match(const int8_t* buf, uint32_t size) const = 0;
+};
+
 /// \brief A table dataset operation abstraction.
 class TableHandler : public DataHandler {
  public:
@@ -258,6 +317,41 @@ class TableHandler : public DataHandler {
         const std::string& index_name, const std::vector<std::string>& pks) {
         return std::shared_ptr<Tablet>();
     }
+
+    /// Set the version of the data into `version`, it changes whenever the
+    /// data changes. Return `false` by default as the version is unknown.
+    virtual bool GetDataVersion(uint64_t* version) { return false; }
+
+    /// Set the statistics of the data of the index into `stats`.
+    /// Return `false` by default as the statistics are unknown.
+    virtual bool GetIndexStats(const std::string& index_name,
+                               IndexStats* stats) {
+        return false;
+    }
+
+    /// Skip the rows not matched by `predicate` in the iterators of the
+    /// table. The rows iterated are still filtered by the caller, as the
+    /// predicate may be ignored. Return `false` by default as it is ignored.
+    virtual bool SetRowPredicate(
+        const std::shared_ptr<RowPredicate>& predicate) {
+        return false;
+    }
+
+    /// Decode only the columns set in `mask` of the rows iterated, the other
+    /// columns may be read as null. It is set when the rows are only read by
+    /// the projects depending on the columns of `mask`. Return `false` by
+    /// default as it is ignored.
+    virtual bool SetColumnMask(
+        const std::shared_ptr<const std::vector<bool>>& mask) {
+        return false;
+    }
+
+    /// Return the disjoint parts of the table in the order the iterator of
+    /// the table reads them, which may be read by different threads at the
+    /// same time. Return empty by default as the table is not split.
+    virtual std::vector<std::shared_ptr<TableHandler>> GetParts() {
+        return {};
+    }
 };
 
 /// \brief A table dataset's error handler, representing a error table
@@ -41,6 +41,7 @@ namespace vm {
 using ::hybridse::codec::Row;
 
 class Engine;
+class EngineCompileCache;
 /// \brief An options class for controlling engine behaviour.
 class EngineOptions {
  public:
@@ -111,6 +112,70 @@ class EngineOptions {
         return enable_batch_window_parallelization_;
     }
 
+    /// Set the thread num to run window aggregation across partition keys and
+    /// table projects across the parts of the table in batch mode, default `1`.
+    inline EngineOptions* set_batch_window_thread_num(uint32_t num) {
+        batch_window_thread_num_ = num;
+        return this;
+    }
+    /// Return the thread num to run window aggregation and table projects in batch mode.
+    inline uint32_t batch_window_thread_num() const { return batch_window_thread_num_; }
+
+    /// Set the min rows of a partition key to split it into time ranges
+    /// aggregated on the batch window threads, default `65536`, `0` to run
+    /// every key on one thread.
+    inline EngineOptions* set_batch_window_split_rows(uint32_t rows) {
+        batch_window_split_rows_ = rows;
+        return this;
+    }
+    /// Return the min rows of a partition key to split it in batch mode.
+    inline uint32_t batch_window_split_rows() const { return batch_window_split_rows_; }
+
+    /// Set the maximum number of rows read from the request mode windows of
+    /// the names, default empty to read all the rows of the windows. The rows
+    /// read are spread evenly over the window, so `avg`, `min` and `max`
+    /// are estimated from them, and `scaled_count` and `scaled_sum` scale
+    /// `count` and `sum` by the rows of the window each row read stands for.
+    /// The name of a window merged with the others is the one of the merged
+    /// window, so the exact windows are better given the frames distinct
+    /// from the sampled ones.
+    inline EngineOptions* set_window_sample_sizes(
+        const std::map<std::string, uint64_t>& sizes) {
+        window_sample_sizes_ = sizes;
+        return this;
+    }
+    /// Return the sample sizes of the request mode windows by their names.
+    inline const std::map<std::string, uint64_t>& window_sample_sizes() const {
+        return window_sample_sizes_;
+    }
+
+    /// Set the maximum number of threads to run the independent branches of
+    /// a request mode sql, e.g. its windows, default `1` to run them serially.
+    inline EngineOptions* set_request_branch_thread_num(uint32_t num) {
+        request_branch_thread_num_ = num;
+        return this;
+    }
+    /// Return the maximum number of threads to run the branches of a request mode sql.
+    inline uint32_t request_branch_thread_num() const { return request_branch_thread_num_; }
+
+    /// Set the maximum number of cached results of a request mode sql,
+    /// default `0` to disable the cache. The results are cached only if the
+    /// tables read by the sql keep the versions of their data.
+    inline EngineOptions* set_max_request_result_cache_size(uint32_t size) {
+        max_request_result_cache_size_ = size;
+        return this;
+    }
+    /// Return the maximum number of cached results of a request mode sql.
+    inline uint32_t max_request_result_cache_size() const { return max_request_result_cache_size_; }
+
+    /// Set the time in ms a cached request result lives, default `1000`.
+    inline EngineOptions* set_request_result_cache_ttl(uint32_t ttl_ms) {
+        request_result_cache_ttl_ = ttl_ms;
+        return this;
+    }
+    /// Return the time in ms a cached request result lives.
+    inline uint32_t request_result_cache_ttl() const { return request_result_cache_ttl_; }
+
     /// Set the maximum number of cache entries, default is `50`.
     inline void set_max_sql_cache_size(uint32_t size) {
         max_sql_cache_size_ = size;
@@ -118,6 +183,26 @@ class EngineOptions {
     /// Return the maximum number of entries we can hold for compiling cache.
     inline uint32_t max_sql_cache_size() const { return max_sql_cache_size_; }
 
+    /// Set `true` to compile the batch mode queries differing only in the
+    /// literals compared in their WHERE clauses into one plan, default `false`.
+    /// The literals are replaced by positional parameters before compiling.
+    inline EngineOptions* set_enable_literal_parameterize(bool flag) {
+        enable_literal_parameterize_ = flag;
+        return this;
+    }
+    /// Return if the literals of the batch mode queries are parameterized.
+    inline bool is_enable_literal_parameterize() const { return enable_literal_parameterize_; }
+
+    /// Set `true` to record the runs, the output rows and the time of the
+    /// runners per physical node of the compiled sql, default `false`.
+    /// The stats of a cached sql are shown by `Engine::Explain`.
+    inline EngineOptions* set_enable_runner_stats(bool flag) {
+        enable_runner_stats_ = flag;
+        return this;
+    }
+    /// Return if the stats of the runners are recorded.
+    inline bool is_enable_runner_stats() const { return enable_runner_stats_; }
+
     /// Set `true` to enable spark unsafe row format, default `false`.
     EngineOptions* set_enable_spark_unsaferow_format(bool flag);
     /// Return if the engine can support can support spark unsafe row format.
@@ -137,7 +222,15 @@ class EngineOptions {
     bool batch_request_optimized_;
     bool enable_expr_optimize_;
     bool enable_batch_window_parallelization_;
+    uint32_t batch_window_thread_num_;
+    uint32_t batch_window_split_rows_;
+    std::map<std::string, uint64_t> window_sample_sizes_;
+    uint32_t request_branch_thread_num_;
     uint32_t max_sql_cache_size_;
+    uint32_t max_request_result_cache_size_;
+    uint32_t request_result_cache_ttl_;
+    bool enable_literal_parameterize_;
+    bool enable_runner_stats_;
     bool enable_spark_unsaferow_format_;
     JitOptions jit_options_;
 };
@@ -176,6 +269,28 @@ class RunSession {
     /// Return if this run session support printing debug information.
     bool IsDebug() { return is_debug_; }
 
+    /// Stop running a query once the deadline in the micros since the epoch is passed, 0 is no deadline.
+    /// The run stopped returns kRunDeadlineExceeded.
+    void SetDeadline(uint64_t deadline_us) { deadline_us_ = deadline_us; }
+    static const int32_t kRunDeadlineExceeded = -3;
+
+    /// Bound the memory of the rows kept by the partitions and the sorts of a batch query by the bytes, 0 is
+    /// no bound. The rows beyond the bound are spilled to the temporary files in `spill_dir`, or the run is
+    /// stopped and returns kRunMemoryExceeded if `spill_dir` is empty.
+    void SetMemoryBudget(uint64_t budget, const std::string& spill_dir = "") {
+        memory_budget_ = budget;
+        spill_dir_ = spill_dir;
+    }
+    static const int32_t kRunMemoryExceeded = -4;
+
+    /// Enable recording the time every runner takes while running a query.
+    void EnableTrace() { is_trace_ = true; }
+    /// Return if this run session records the time of the runners.
+    bool IsTrace() const { return is_trace_; }
+    /// Return the runner traces of the last run, it is empty if the trace is not enabled
+    /// or the result is read from the request result cache.
+    const std::vector<RunnerTrace>& GetTraces() const { return traces_; }
+
     /// Bind this run session with specific procedure
     void SetSpName(const std::string& sp_name) { sp_name_ = sp_name; }
     /// Return the engine mode of this run session
@@ -185,6 +300,11 @@ class RunSession {
     std::shared_ptr<hybridse::vm::CompileInfo> compile_info_;
     hybridse::vm::EngineMode engine_mode_;
     bool is_debug_;
+    bool is_trace_;
+    std::vector<RunnerTrace> traces_;
+    uint64_t deadline_us_;
+    uint64_t memory_budget_;
+    std::string spill_dir_;
     std::string sp_name_;
     friend Engine;
 };
@@ -193,7 +313,7 @@ class RunSession {
 class BatchRunSession : public RunSession {
  public:
     explicit BatchRunSession(bool mini_batch = false)
-        : RunSession(kBatchMode), parameter_schema_() {}
+        : RunSession(kBatchMode), parameter_schema_(), literal_parameter_row_(), literal_parameterized_(false) {}
     ~BatchRunSession() {}
     /// \brief Query sql with parameter row in batch mode.
     /// Query results will be returned as std::vector<Row> in output
@@ -208,8 +328,15 @@ class BatchRunSession : public RunSession {
     void SetParameterSchema(const codec::Schema& schema) { parameter_schema_ = schema; }
     /// Return query parameter schema.
     virtual const Schema& GetParameterSchema() const { return parameter_schema_; }
+    /// Return if the sql is compiled with its literals replaced by parameters.
+    bool IsLiteralParameterized() const { return literal_parameterized_; }
+
  private:
     codec::Schema parameter_schema_;
+    // the parameters of the literals replaced, which are taken when no parameter row is given
+    Row literal_parameter_row_;
+    bool literal_parameterized_;
+    friend Engine;
 };
 /// \brief RequestRunSession is a kind of RunSession designed for request mode query.
 ///
@@ -294,6 +421,7 @@ struct ExplainOutput {
     std::string ir;             ///< Codegen IR String
     vm::Schema output_schema;   ///< The schema of query result
     vm::Router router;          ///< The Router for request-mode query
+    std::string runner_stats;  ///< The runner stats of the cached sql, empty if not recorded
 };
 
 
@@ -371,6 +499,9 @@ class Engine {
     /// \brief Clear engine's compiling result cache
     void ClearCacheLocked(const std::string& db);
 
+    /// \brief Get the hit and miss counts of engine's compiling result cache
+    void GetCacheStats(uint64_t* hit_count, uint64_t* miss_count) const;
+
  private:
     bool GetDependentTables(node::PlanNode* node, std::set<std::string>* tables,
                             base::Status& status);  // NOLINT
@@ -385,14 +516,18 @@ class Engine {
                            std::shared_ptr<CompileInfo> info,
                            base::Status& status);  // NOLINT
 
+    /// Compile the sql, or take the compile info of the same sql from the cache
+    bool GetOrCompile(const std::string& sql, const std::string& db,
+                      RunSession& session,    // NOLINT
+                      base::Status& status);  // NOLINT
+
     bool Explain(const std::string& sql, const std::string& db,
                  EngineMode engine_mode, const codec::Schema& parameter_schema,
                  const std::set<size_t>& common_column_indices,
                  ExplainOutput* explain_output, base::Status* status);
     std::shared_ptr<Catalog> cl_;
     EngineOptions options_;
-    base::SpinMutex mu_;
-    EngineLRUCache lru_cache_;
+    std::unique_ptr<EngineCompileCache> compile_cache_;
 };
 
 /// \brief Local tablet is responsible to run a task locally.
@@ -19,7 +19,6 @@
 #include <memory>
 #include <set>
 #include <string>
-#include "boost/compute/detail/lru_cache.hpp"
 #include "vm/physical_op.h"
 namespace hybridse {
 namespace vm {
@@ -38,6 +37,13 @@ struct BatchRequestInfo {
     std::set<size_t> output_common_column_indices;
 };
 
+// the time a runner takes in a traced run, the time of its producers is not included
+struct RunnerTrace {
+    int64_t id;
+    std::string name;
+    uint64_t time_us;
+};
+
 enum ComileType {
     kCompileSql,
 };
@@ -62,14 +68,15 @@ class CompileInfo {
                                   const std::string& tab) = 0;
     virtual void DumpClusterJob(std::ostream& output,
                                 const std::string& tab) = 0;
+    /// Dump the stats of the runners recorded with the runner stats enabled,
+    /// one line per runner.
+    virtual void DumpRunnerStats(std::ostream& output) = 0;
+    virtual void ResetRunnerStats() = 0;
+    /// Dump the jit functions of the plan, one line per function with its
+    /// address, plan node and output columns.
+    virtual void DumpFnSymbols(std::ostream& output) = 0;
 };
 
-typedef std::map<
-    EngineMode,
-    std::map<std::string, boost::compute::detail::lru_cache<
-                              std::string, std::shared_ptr<CompileInfo>>>>
-    EngineLRUCache;
-
 class CompileInfoCache {
  public:
     virtual std::shared_ptr<hybridse::vm::CompileInfo> GetRequestInfo(
@@ -94,11 +101,46 @@ class JitOptions {
     bool is_enable_perf() const { return enable_perf_; }
     void set_enable_perf(bool flag) { enable_perf_ = flag; }
 
+    // the directory to keep the compiled objects across restarts, empty to
+    // compile every sql, only supported by the llvm jit
+    const std::string& object_cache_dir() const { return object_cache_dir_; }
+    void set_object_cache_dir(const std::string& dir) { object_cache_dir_ = dir; }
+
+    // compile a module without optimization for immediate use and switch to
+    // the optimized code once it is compiled in background, only supported
+    // by the llvm jit
+    bool is_enable_tiered_compile() const { return enable_tiered_compile_; }
+    void set_enable_tiered_compile(bool flag) { enable_tiered_compile_ = flag; }
+
+    // split a module into parts which are optimized and compiled on the
+    // threads concurrently, only supported by the llvm jit
+    uint32_t compile_thread_num() const { return compile_thread_num_; }
+    void set_compile_thread_num(uint32_t num) { compile_thread_num_ = num; }
+
+    // in tiered compile mode, count the branches taken by the unoptimized
+    // code during the first runs of a module and optimize it with the
+    // profile, 0 to optimize without profile
+    uint32_t pgo_profile_runs() const { return pgo_profile_runs_; }
+    void set_pgo_profile_runs(uint32_t runs) { pgo_profile_runs_ = runs; }
+
+    // link the bitcode of the builtin functions into the modules, so that the
+    // calls to them are inlined by the optimization, only supported by the
+    // llvm jit
+    bool is_enable_inline_builtins() const { return enable_inline_builtins_; }
+    void set_enable_inline_builtins(bool flag) {
+        enable_inline_builtins_ = flag;
+    }
+
  private:
     bool enable_mcjit_ = false;
     bool enable_vtune_ = false;
     bool enable_gdb_ = false;
     bool enable_perf_ = false;
+    std::string object_cache_dir_ = "";
+    bool enable_tiered_compile_ = false;
+    uint32_t compile_thread_num_ = 1;
+    uint32_t pgo_profile_runs_ = 0;
+    bool enable_inline_builtins_ = false;
 };
 }  // namespace vm
 }  // namespace hybridse
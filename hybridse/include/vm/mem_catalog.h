@@ -37,19 +37,21 @@ using hybridse::codec::RowIterator;
 using hybridse::codec::WindowIterator;
 
 struct AscKeyComparor {
-    bool operator()(std::pair<std::string, Row> i,
-                    std::pair<std::string, Row> j) {
+    bool operator()(const std::pair<std::string, Row>& i,
+                    const std::pair<std::string, Row>& j) const {
         return i.first < j.first;
     }
 };
 struct AscComparor {
-    bool operator()(std::pair<uint64_t, Row> i, std::pair<uint64_t, Row> j) {
+    bool operator()(const std::pair<uint64_t, Row>& i,
+                    const std::pair<uint64_t, Row>& j) const {
         return i.first < j.first;
     }
 };
 
 struct DescComparor {
-    bool operator()(std::pair<uint64_t, Row> i, std::pair<uint64_t, Row> j) {
+    bool operator()(const std::pair<uint64_t, Row>& i,
+                    const std::pair<uint64_t, Row>& j) const {
         return i.first > j.first;
     }
 };
@@ -59,6 +61,10 @@ typedef std::vector<Row> MemTable;
 typedef std::map<std::string, MemTimeTable, std::greater<std::string>>
     MemSegmentMap;
 
+// sort the rows of the table by their keys, the rows of the same key keep
+// their order
+void SortMemTimeTable(MemTimeTable* table, bool is_asc);
+
 class MemTimeTableIterator : public RowIterator {
  public:
     MemTimeTableIterator(const MemTimeTable* table, const vm::Schema* schema);
@@ -228,6 +234,9 @@ class MemTimeTableHandler : public TableHandler {
     const std::string GetHandlerTypeName() override {
         return "MemTimeTableHandler";
     }
+    // the rows of a sampled window stand for scale rows each
+    void SetSampleScale(double scale) { sample_scale_ = scale; }
+    double GetSampleScale() override { return sample_scale_; }
 
  protected:
     const std::string table_name_;
@@ -237,6 +246,7 @@ class MemTimeTableHandler : public TableHandler {
     IndexHint index_hint_;
     MemTimeTable table_;
     OrderType order_type_;
+    double sample_scale_ = 1.0;
 };
 
 class Window : public MemTimeTableHandler {
@@ -298,7 +308,8 @@ class WindowRange {
           end_offset_(0),
           start_row_(0),
           end_row_(0),
-          max_size_(0) {}
+          max_size_(0),
+          sample_size_(0) {}
     WindowRange(Window::WindowFrameType frame_type, int64_t start_offset,
                 int64_t end_offset, uint64_t rows_preceding, uint64_t max_size)
         : frame_type_(frame_type),
@@ -306,7 +317,8 @@ class WindowRange {
           end_offset_(end_offset),
           start_row_(rows_preceding),
           end_row_(0),
-          max_size_(max_size) {}
+          max_size_(max_size),
+          sample_size_(0) {}
 
     virtual ~WindowRange() {}
     static WindowRange CreateRowsWindow(uint64_t rows_preceding) {
@@ -357,6 +369,8 @@ class WindowRange {
     uint64_t start_row_;
     uint64_t end_row_;
     uint64_t max_size_;
+    // keep at most sample_size_ rows spread evenly over the window if > 0
+    uint64_t sample_size_;
 };
 
 /**
@@ -515,7 +529,7 @@ class MemSegmentHandler : public TableHandler {
  public:
     MemSegmentHandler(std::shared_ptr<PartitionHandler> partition_hander,
                       const std::string& key)
-        : partition_hander_(partition_hander), key_(key) {}
+        : partition_hander_(partition_hander), key_(key), positions_(this) {}
 
     virtual ~MemSegmentHandler() {}
 
@@ -573,17 +587,7 @@ class MemSegmentHandler : public TableHandler {
         }
         return cnt;
     }
-    Row At(uint64_t pos) override {
-        auto iter = GetIterator();
-        if (!iter) {
-            return Row();
-        }
-        iter->SeekToFirst();
-        while (pos-- > 0 && iter->Valid()) {
-            iter->Next();
-        }
-        return iter->Valid() ? iter->GetValue() : Row();
-    }
+    Row At(uint64_t pos) override { return positions_.At(pos); }
     const std::string GetHandlerTypeName() override {
         return "MemSegmentHandler";
     }
@@ -591,6 +595,7 @@ class MemSegmentHandler : public TableHandler {
  private:
     std::shared_ptr<vm::PartitionHandler> partition_hander_;
     std::string key_;
+    RowPositionIndex positions_;
 };
 
 class MemPartitionHandler
@@ -739,13 +744,17 @@ class RequestUnionTableHandler : public TableHandler {
  public:
     RequestUnionTableHandler(uint64_t request_ts, const Row& request_row,
                              const std::shared_ptr<TableHandler>& window)
-        : request_ts_(request_ts), request_row_(request_row), window_(window) {}
+        : request_ts_(request_ts),
+          request_row_(request_row),
+          window_(window),
+          positions_(this) {}
     ~RequestUnionTableHandler() {}
 
     std::unique_ptr<RowIterator> GetIterator() override {
         return std::unique_ptr<RowIterator>(GetRawIterator());
     }
     RowIterator* GetRawIterator() override;
+    Row At(uint64_t pos) override { return positions_.At(pos); }
 
     const Types& GetTypes() override { return window_->GetTypes(); }
     const IndexHint& GetIndex() override { return window_->GetIndex(); }
@@ -761,6 +770,7 @@ class RequestUnionTableHandler : public TableHandler {
     uint64_t request_ts_;
     const Row request_row_;
     std::shared_ptr<TableHandler> window_;
+    RowPositionIndex positions_;
 };
 
 // row iter interfaces for llvm
@@ -769,6 +779,7 @@ bool RowIterHasNext(int8_t* iter);
 void RowIterNext(int8_t* iter);
 int8_t* RowIterGetCurSlice(int8_t* iter, size_t idx);
 size_t RowIterGetCurSliceSize(int8_t* iter, size_t idx);
+int8_t* RowIterGetCurRow(int8_t* iter);
 void RowIterDelete(int8_t* iter);
 int8_t* RowGetSlice(int8_t* row_ptr, size_t idx);
 size_t RowGetSliceSize(int8_t* row_ptr, size_t idx);
@@ -42,6 +42,8 @@ public class JitManager {
     // One jit currently only take one llvm module, since symbol may duplicate
     private static Map<String, HybridSeJitWrapper> jits = new HashMap<>();
     private static Set<String> initializedModuleTags = new HashSet<>();
+    // The object cache dir of the jits created from now on
+    private static String objectCacheDir = null;
 
     /**
      * Return JIT specified by tag.
@@ -61,6 +63,10 @@ public class JitManager {
 
     private static JitOptions getJitOptions() {
         JitOptions options = new JitOptions();
+        String cacheDir = objectCacheDir != null ? objectCacheDir : System.getProperty("fesql.jit.object_cache_dir");
+        if (cacheDir != null && !cacheDir.isEmpty()) {
+            options.set_object_cache_dir(cacheDir);
+        }
         try (InputStream input = JitManager.class.getClassLoader().getResourceAsStream("jit.properties")) {
             Properties prop = new Properties(System.getProperties());
             if (input == null) {
@@ -93,6 +99,45 @@ public class JitManager {
         return options;
     }
 
+    /**
+     * Set the object cache dir of the jits created from now on, the modules compiled into the dir are loaded
+     * instead of compiled again.
+     *
+     * @param dir object cache dir, null to use the system property fesql.jit.object_cache_dir
+     */
+    public static synchronized void setObjectCacheDir(String dir) {
+        objectCacheDir = dir;
+    }
+
+    /**
+     * Compile native module with module byte buffer into the object cache dir, so that the jits with the same
+     * object cache dir on the same kind of host load the module without compiling it.
+     *
+     * @param moduleBuffer ByteBuffer used to initialize native module
+     * @param dir object cache dir
+     */
+    public static synchronized void compileModule(ByteBuffer moduleBuffer, String dir) {
+        if (!moduleBuffer.isDirect()) {
+            throw new RuntimeException("JIT must use direct buffer");
+        }
+        JitOptions options = getJitOptions();
+        options.set_object_cache_dir(dir);
+        HybridSeJitWrapper jit = HybridSeJitWrapper.Create(options);
+        if (jit == null) {
+            throw new RuntimeException("Fail to create native jit");
+        }
+        try {
+            jit.Init();
+            HybridSeJitWrapper.InitJitSymbols(jit);
+            if (!jit.CompileModuleFromBuffer(moduleBuffer)) {
+                throw new RuntimeException("Fail to compile native module");
+            }
+        } finally {
+            HybridSeJitWrapper.DeleteJit(jit);
+            jit.delete();
+        }
+    }
+
     private static synchronized boolean hasModule(String tag) {
         return initializedModuleTags.contains(tag);
     }
@@ -16,36 +16,60 @@
 
 #include "base/fe_slice.h"
 
+#include <new>
+#include <utility>
+
 namespace hybridse {
 namespace base {
 
 RefCountedSlice::~RefCountedSlice() { Release(); }
 
+RefCountedSlice RefCountedSlice::Allocate(size_t size) {
+    void* header = malloc(sizeof(RefCount) + size);
+    if (header == nullptr) {
+        return RefCountedSlice();
+    }
+    auto ref_cnt = new (header) RefCount(true);
+    return RefCountedSlice(reinterpret_cast<int8_t*>(ref_cnt + 1), size,
+                           ref_cnt);
+}
+
 void RefCountedSlice::Release() {
     if (this->ref_cnt_ != nullptr) {
-        auto& cnt = *this->ref_cnt_;
-        cnt -= 1;
-        if (cnt == 0) {
-            free(buf());
-            delete this->ref_cnt_;
+        if (this->ref_cnt_->cnt.fetch_sub(1, std::memory_order_acq_rel) ==
+            1) {
+            if (this->ref_cnt_->intrusive) {
+                this->ref_cnt_->~RefCount();
+                free(this->ref_cnt_);
+            } else {
+                free(buf());
+                delete this->ref_cnt_;
+            }
         }
+        this->ref_cnt_ = nullptr;
     }
+    this->owner_.reset();
 }
 
 void RefCountedSlice::Update(const RefCountedSlice& slice) {
     reset(slice.data(), slice.size());
     this->ref_cnt_ = slice.ref_cnt_;
     if (this->ref_cnt_ != nullptr) {
-        (*this->ref_cnt_) += 1;
+        this->ref_cnt_->cnt.fetch_add(1, std::memory_order_relaxed);
     }
+    this->owner_ = slice.owner_;
 }
 
 RefCountedSlice::RefCountedSlice(const RefCountedSlice& slice) {
     this->Update(slice);
 }
 
-RefCountedSlice::RefCountedSlice(RefCountedSlice&& slice) {
-    this->Update(slice);
+RefCountedSlice::RefCountedSlice(RefCountedSlice&& slice) noexcept
+    : Slice(slice.data(), slice.size()),
+      ref_cnt_(slice.ref_cnt_),
+      owner_(std::move(slice.owner_)) {
+    slice.reset(nullptr, 0);
+    slice.ref_cnt_ = nullptr;
 }
 
 RefCountedSlice& RefCountedSlice::operator=(const RefCountedSlice& slice) {
@@ -57,12 +81,17 @@ RefCountedSlice& RefCountedSlice::operator=(const RefCountedSlice& slice) {
     return *this;
 }
 
-RefCountedSlice& RefCountedSlice::operator=(RefCountedSlice&& slice) {
+RefCountedSlice& RefCountedSlice::operator=(RefCountedSlice&& slice) noexcept {
     if (&slice == this) {
         return *this;
     }
     this->Release();
-    this->Update(slice);
+    // take over the reference of the moved slice
+    reset(slice.data(), slice.size());
+    this->ref_cnt_ = slice.ref_cnt_;
+    this->owner_ = std::move(slice.owner_);
+    slice.reset(nullptr, 0);
+    slice.ref_cnt_ = nullptr;
     return *this;
 }
 
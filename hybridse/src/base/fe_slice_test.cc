@@ -15,6 +15,10 @@
  */
 
 #include "base/fe_slice.h"
+#include <string>
+#include <thread>  // NOLINT
+#include <utility>
+#include <vector>
 #include "gtest/gtest.h"
 
 namespace hybridse {
@@ -46,6 +50,53 @@ TEST_F(SliceTest, ref_cnt_slice) {
     ASSERT_EQ(0, strcmp(reinterpret_cast<char*>(ref.buf()), "hello world"));
 }
 
+TEST_F(SliceTest, allocated_slice) {
+    RefCountedSlice ref;
+    {
+        auto slice = RefCountedSlice::Allocate(12);
+        strcpy(reinterpret_cast<char*>(slice.buf()), "hello world");  // NOLINT
+        ref = slice;
+    }
+    ASSERT_EQ(0, strcmp(reinterpret_cast<char*>(ref.buf()), "hello world"));
+    // the buffer keeps the alignment of malloc after the count header
+    ASSERT_EQ(0u, reinterpret_cast<uintptr_t>(ref.buf()) % 16);
+
+    RefCountedSlice moved(std::move(ref));
+    ASSERT_EQ(nullptr, ref.buf());  // NOLINT
+    ASSERT_EQ(12u, moved.size());
+
+    // copies released on several threads
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([moved]() {
+            for (int i = 0; i < 10000; ++i) {
+                RefCountedSlice copy = moved;
+                ASSERT_EQ(12u, copy.size());
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    ASSERT_EQ(0, strcmp(reinterpret_cast<char*>(moved.buf()), "hello world"));
+}
+
+TEST_F(SliceTest, shared_slice) {
+    auto owner = std::make_shared<std::string>("hello world");
+    std::weak_ptr<std::string> weak = owner;
+
+    RefCountedSlice ref;
+    {
+        auto slice = RefCountedSlice::CreateShared(owner->data() + 6, 5, owner);
+        owner.reset();
+        ref = slice;
+    }
+    ASSERT_FALSE(weak.expired());
+    ASSERT_EQ("world", ref.ToString());
+    ref = RefCountedSlice();
+    ASSERT_TRUE(weak.expired());
+}
+
 }  // namespace base
 }  // namespace hybridse
 
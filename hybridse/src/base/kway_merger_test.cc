@@ -0,0 +1,151 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "base/kway_merger.h"
+#include <algorithm>
+#include <functional>
+#include <random>
+#include <utility>
+#include <vector>
+#include "gtest/gtest.h"
+
+namespace hybridse {
+namespace base {
+
+class KWayMergerTest : public ::testing::Test {
+ public:
+    KWayMergerTest() {}
+    ~KWayMergerTest() {}
+};
+
+typedef std::vector<std::vector<uint64_t>> Sources;
+
+// merge the sources by the merger, return the source index of every key
+template <typename Merger>
+static std::vector<std::pair<uint64_t, size_t>> Merge(const Sources& sources) {
+    Merger merger;
+    merger.Reset(sources.size());
+    std::vector<size_t> pos(sources.size(), 0);
+    for (size_t i = 0; i < sources.size(); i++) {
+        if (!sources[i].empty()) {
+            merger.Add(i, sources[i][0]);
+        }
+    }
+    std::vector<std::pair<uint64_t, size_t>> result;
+    while (!merger.Empty()) {
+        size_t idx = merger.Top();
+        result.push_back({merger.TopKey(), idx});
+        if (++pos[idx] < sources[idx].size()) {
+            merger.Next(sources[idx][pos[idx]]);
+        } else {
+            merger.Pop();
+        }
+    }
+    return result;
+}
+
+// merge the sources by picking the first key of all the sources every time
+template <typename Compare>
+static std::vector<std::pair<uint64_t, size_t>> LinearMerge(
+    const Sources& sources, bool tie_to_lower) {
+    Compare cmp;
+    std::vector<size_t> pos(sources.size(), 0);
+    std::vector<std::pair<uint64_t, size_t>> result;
+    while (true) {
+        int64_t pick = -1;
+        for (size_t i = 0; i < sources.size(); i++) {
+            if (pos[i] >= sources[i].size()) {
+                continue;
+            }
+            if (pick < 0) {
+                pick = i;
+                continue;
+            }
+            uint64_t key = sources[i][pos[i]];
+            uint64_t pick_key = sources[pick][pos[pick]];
+            if (cmp(key, pick_key) || (!cmp(pick_key, key) && !tie_to_lower)) {
+                pick = i;
+            }
+        }
+        if (pick < 0) {
+            break;
+        }
+        result.push_back({sources[pick][pos[pick]], pick});
+        pos[pick]++;
+    }
+    return result;
+}
+
+static Sources RandomSources(std::mt19937* rand, size_t cnt, bool desc) {
+    Sources sources(cnt);
+    for (auto& source : sources) {
+        size_t size = (*rand)() % 20;
+        uint64_t key = (*rand)() % 100;
+        for (size_t i = 0; i < size; i++) {
+            source.push_back(key);
+            // the runs of the sources overlap now and then
+            uint64_t step = (*rand)() % 4 == 0 ? (*rand)() % 30 : (*rand)() % 2;
+            key = desc ? (key > step ? key - step : 0) : key + step;
+        }
+    }
+    return sources;
+}
+
+TEST_F(KWayMergerTest, MergeAscending) {
+    std::mt19937 rand(1);
+    for (int i = 0; i < 1000; i++) {
+        auto sources = RandomSources(&rand, rand() % 8, false);
+        ASSERT_EQ((LinearMerge<std::less<uint64_t>>(sources, true)),
+                  Merge<KWayMerger<uint64_t>>(sources));
+    }
+}
+
+TEST_F(KWayMergerTest, MergeDescending) {
+    std::mt19937 rand(2);
+    for (int i = 0; i < 1000; i++) {
+        auto sources = RandomSources(&rand, rand() % 8, true);
+        ASSERT_EQ(
+            (LinearMerge<std::greater<uint64_t>>(sources, true)),
+            (Merge<KWayMerger<uint64_t, std::greater<uint64_t>>>(sources)));
+        ASSERT_EQ(
+            (LinearMerge<std::greater<uint64_t>>(sources, false)),
+            (Merge<KWayMerger<uint64_t, std::greater<uint64_t>, false>>(
+                sources)));
+    }
+}
+
+TEST_F(KWayMergerTest, MergeRuns) {
+    // the sources not overlapping are emitted one after another
+    Sources sources = {{7, 8, 9}, {1, 2, 3}, {4, 5, 6}, {}};
+    auto result = Merge<KWayMerger<uint64_t>>(sources);
+    std::vector<std::pair<uint64_t, size_t>> expect = {
+        {1, 1}, {2, 1}, {3, 1}, {4, 2}, {5, 2}, {6, 2}, {7, 0}, {8, 0}, {9, 0}};
+    ASSERT_EQ(expect, result);
+
+    // the ties go to the lower index
+    sources = {{1, 3}, {1, 2}, {1}};
+    result = Merge<KWayMerger<uint64_t>>(sources);
+    expect = {{1, 0}, {1, 1}, {1, 2}, {2, 1}, {3, 0}};
+    ASSERT_EQ(expect, result);
+}
+
+}  // namespace base
+}  // namespace hybridse
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -15,6 +15,7 @@
  */
 
 #include "base/mem_pool.h"
+#include <cstring>
 #include <string>
 #include "gtest/gtest.h"
 
@@ -51,6 +52,84 @@ TEST_F(MemPoolTest, ByteMemoryPoolTest) {
         ASSERT_EQ("helloworldhybri", std::string(s3, 15));
     }
 }
+
+TEST_F(MemPoolTest, ResetTest) {
+    ByteMemoryPool mem_pool;
+    char* s1 = mem_pool.Alloc(10);
+    mem_pool.Reset();
+    // the chuck is reused
+    ASSERT_EQ(s1, mem_pool.Alloc(10));
+
+    // the chucks are merged into one which fits them
+    for (int i = 0; i < 10; i++) {
+        memset(mem_pool.Alloc(3000), 'a', 3000);
+    }
+    mem_pool.Reset();
+    char* s2 = mem_pool.Alloc(3000);
+    for (int i = 1; i < 10; i++) {
+        ASSERT_EQ(s2 + i * 3000, mem_pool.Alloc(3000));
+    }
+    mem_pool.Reset();
+    ASSERT_EQ(s2, mem_pool.Alloc(3000));
+
+    // a large chuck is not kept
+    mem_pool.Alloc(ByteMemoryPool::MAX_RETAINED_SIZE + 1);
+    mem_pool.Reset();
+    char* s3 = mem_pool.Alloc(10);
+    memcpy(s3, "helloworld", 10);
+    ASSERT_EQ("helloworld", std::string(s3, 10));
+}
+
+TEST_F(MemPoolTest, RecycleTest) {
+    ByteMemoryPool mem_pool;
+    memset(mem_pool.Alloc(3000), 'a', 3000);
+    memset(mem_pool.Alloc(3000), 'a', 3000);
+    ASSERT_EQ(6000u, mem_pool.used_size());
+    // the two chucks are kept free and replaced by one which fits them
+    mem_pool.Reset();
+    ASSERT_EQ(0u, mem_pool.used_size());
+    ASSERT_EQ(2u * MemoryChunk::DEFAULT_CHUCK_SIZE, mem_pool.free_size());
+    auto stats = ByteMemoryPool::GetStats();
+    // the run spilling out of the chuck takes a free one
+    memset(mem_pool.Alloc(8192), 'b', 8192);
+    memset(mem_pool.Alloc(3000), 'b', 3000);
+    auto spill_stats = ByteMemoryPool::GetStats();
+    ASSERT_EQ(stats.heap_alloc_cnt, spill_stats.heap_alloc_cnt);
+    ASSERT_EQ(stats.recycle_cnt + 1, spill_stats.recycle_cnt);
+    ASSERT_EQ(1u * MemoryChunk::DEFAULT_CHUCK_SIZE, mem_pool.free_size());
+
+    // the steady state allocates nothing from the heap
+    auto run = [&mem_pool]() {
+        for (int i = 0; i < 4; i++) {
+            memset(mem_pool.Alloc(3000), 'c', 3000);
+        }
+        memset(mem_pool.Alloc(10000), 'c', 10000);
+        mem_pool.Reset();
+    };
+    run();
+    stats = ByteMemoryPool::GetStats();
+    mem_pool.ResetPeak();
+    for (int i = 0; i < 10; i++) {
+        run();
+    }
+    auto steady_stats = ByteMemoryPool::GetStats();
+    ASSERT_EQ(stats.heap_alloc_cnt, steady_stats.heap_alloc_cnt);
+    ASSERT_EQ(stats.heap_free_cnt, steady_stats.heap_free_cnt);
+    ASSERT_EQ(22000u, mem_pool.peak_used_size());
+    mem_pool.ResetPeak();
+    ASSERT_EQ(0u, mem_pool.peak_used_size());
+}
+
+TEST_F(MemPoolTest, ReserveTest) {
+    ByteMemoryPool mem_pool;
+    mem_pool.Reserve(20000);
+    char* s1 = mem_pool.Alloc(10000);
+    ASSERT_EQ(s1 + 10000, mem_pool.Alloc(10000));
+    mem_pool.Reset();
+    // the chuck fits the reserve already
+    mem_pool.Reserve(20000);
+    ASSERT_EQ(s1, mem_pool.Alloc(20000));
+}
 }  // namespace base
 }  // namespace hybridse
 
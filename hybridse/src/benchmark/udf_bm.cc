@@ -41,6 +41,38 @@ static void BM_ArraySumColDouble(benchmark::State& state) {  // NOLINT
     SumArrayListCol(&state, BENCHMARK, state.range(0), "col4");
 }
 
+static void BM_DecodedSumColUdaf(benchmark::State& state) {  // NOLINT
+    ReduceDecodedCol(&state, BENCHMARK, state.range(0), "sum", false);
+}
+static void BM_DecodedSumColKernel(benchmark::State& state) {  // NOLINT
+    ReduceDecodedCol(&state, BENCHMARK, state.range(0), "sum", true);
+}
+static void BM_DecodedMinColUdaf(benchmark::State& state) {  // NOLINT
+    ReduceDecodedCol(&state, BENCHMARK, state.range(0), "min", false);
+}
+static void BM_DecodedMinColKernel(benchmark::State& state) {  // NOLINT
+    ReduceDecodedCol(&state, BENCHMARK, state.range(0), "min", true);
+}
+static void BM_DecodedMaxColUdaf(benchmark::State& state) {  // NOLINT
+    ReduceDecodedCol(&state, BENCHMARK, state.range(0), "max", false);
+}
+static void BM_DecodedMaxColKernel(benchmark::State& state) {  // NOLINT
+    ReduceDecodedCol(&state, BENCHMARK, state.range(0), "max", true);
+}
+static void BM_DecodedAvgColUdaf(benchmark::State& state) {  // NOLINT
+    ReduceDecodedCol(&state, BENCHMARK, state.range(0), "avg", false);
+}
+static void BM_DecodedAvgColKernel(benchmark::State& state) {  // NOLINT
+    ReduceDecodedCol(&state, BENCHMARK, state.range(0), "avg", true);
+}
+
+static void BM_ProjectRowColsJit(benchmark::State& state) {  // NOLINT
+    ProjectRowCols(&state, BENCHMARK, state.range(0), false);
+}
+static void BM_ProjectRowColsRowView(benchmark::State& state) {  // NOLINT
+    ProjectRowCols(&state, BENCHMARK, state.range(0), true);
+}
+
 static void BM_CopyMemSegment(benchmark::State& state) {  // NOLINT
     CopyMemSegment(&state, BENCHMARK, state.range(0));
 }
@@ -75,6 +107,22 @@ static void BM_DateFormat(benchmark::State& state) {  // NOLINT
     DateFormat(&state, BENCHMARK);
 }
 
+static void BM_LikeContains(benchmark::State& state) {  // NOLINT
+    StringLikeMatch(&state, BENCHMARK, state.range(0), "%needle%", false);
+}
+static void BM_LikeGeneral(benchmark::State& state) {  // NOLINT
+    StringLikeMatch(&state, BENCHMARK, state.range(0), "Key%ne_dle", false);
+}
+static void BM_ILikeContains(benchmark::State& state) {  // NOLINT
+    StringLikeMatch(&state, BENCHMARK, state.range(0), "%NEEDLE%", true);
+}
+static void BM_CaseCompareSimd(benchmark::State& state) {  // NOLINT
+    StringCaseCompare(&state, BENCHMARK, state.range(0), true);
+}
+static void BM_CaseCompareLibc(benchmark::State& state) {  // NOLINT
+    StringCaseCompare(&state, BENCHMARK, state.range(0), false);
+}
+
 static void BM_AllocFromByteMemPool1000(benchmark::State& state) {  // NOLINT
     ByteMemPoolAlloc1000(&state, BENCHMARK, state.range(0));
 }
@@ -123,6 +171,48 @@ BENCHMARK(BM_ArraySumColDouble)
     ->Args({100})
     ->Args({1000})
     ->Args({10000});
+BENCHMARK(BM_DecodedSumColUdaf)
+    ->Args({10})
+    ->Args({100})
+    ->Args({1000})
+    ->Args({10000});
+BENCHMARK(BM_DecodedSumColKernel)
+    ->Args({10})
+    ->Args({100})
+    ->Args({1000})
+    ->Args({10000});
+BENCHMARK(BM_DecodedMinColUdaf)
+    ->Args({10})
+    ->Args({100})
+    ->Args({1000})
+    ->Args({10000});
+BENCHMARK(BM_DecodedMinColKernel)
+    ->Args({10})
+    ->Args({100})
+    ->Args({1000})
+    ->Args({10000});
+BENCHMARK(BM_DecodedMaxColUdaf)
+    ->Args({10})
+    ->Args({100})
+    ->Args({1000})
+    ->Args({10000});
+BENCHMARK(BM_DecodedMaxColKernel)
+    ->Args({10})
+    ->Args({100})
+    ->Args({1000})
+    ->Args({10000});
+BENCHMARK(BM_DecodedAvgColUdaf)
+    ->Args({10})
+    ->Args({100})
+    ->Args({1000})
+    ->Args({10000});
+BENCHMARK(BM_DecodedAvgColKernel)
+    ->Args({10})
+    ->Args({100})
+    ->Args({1000})
+    ->Args({10000});
+BENCHMARK(BM_ProjectRowColsJit)->Args({10})->Args({100})->Args({1000});
+BENCHMARK(BM_ProjectRowColsRowView)->Args({10})->Args({100})->Args({1000});
 BENCHMARK(BM_RequestUnionSumColDouble)
     ->Args({10})
     ->Args({100})
@@ -162,6 +252,12 @@ BENCHMARK(BM_TimestampToString);
 BENCHMARK(BM_DateFormat);
 BENCHMARK(BM_DateToString);
 
+BENCHMARK(BM_LikeContains)->Args({16})->Args({256})->Args({4096});
+BENCHMARK(BM_LikeGeneral)->Args({16})->Args({256})->Args({4096});
+BENCHMARK(BM_ILikeContains)->Args({16})->Args({256})->Args({4096});
+BENCHMARK(BM_CaseCompareSimd)->Args({16})->Args({256})->Args({4096});
+BENCHMARK(BM_CaseCompareLibc)->Args({16})->Args({256})->Args({4096});
+
 BENCHMARK(BM_HistoryWindowBuffer)
     ->Args({10})
     ->Args({100})
@@ -15,6 +15,7 @@
  */
 
 #include "benchmark/udf_bm_case.h"
+#include <strings.h>
 #include <memory>
 #include <string>
 #include <vector>
@@ -24,10 +25,14 @@
 #include "codegen/ir_base_builder.h"
 #include "codegen/window_ir_builder.h"
 #include "gtest/gtest.h"
+#include "udf/simd_string.h"
 #include "udf/udf.h"
 #include "udf/udf_test.h"
+#include "vm/engine.h"
 #include "vm/jit_runtime.h"
 #include "vm/mem_catalog.h"
+#include "vm/simple_catalog.h"
+#include "vm/sql_compiler.h"
 namespace hybridse {
 namespace bm {
 using codec::ColumnImpl;
@@ -279,6 +284,137 @@ void SumArrayListCol(benchmark::State* state, MODE mode, int64_t data_size,
     }
 }
 
+static double RunReduceKernel(const std::string& fn_name, int8_t* input) {
+    double value = 0;
+    if (fn_name == "sum") {
+        value = udf::v1::sum_list<double>(input);
+    } else if (fn_name == "avg") {
+        value = udf::v1::avg_list<double>(input);
+    } else if (fn_name == "min") {
+        udf::v1::min_list<double>(input, &value);
+    } else if (fn_name == "max") {
+        udf::v1::max_list<double>(input, &value);
+    }
+    return value;
+}
+
+void ReduceDecodedCol(benchmark::State* state, MODE mode, int64_t data_size,
+                      const std::string& fn_name, bool use_kernel) {
+    std::vector<double> buffer;
+    for (int64_t i = 0; i < data_size; i++) {
+        buffer.push_back((i * 37) % 101 + 0.5);
+    }
+    codec::ArrayListV<double> list(&buffer);
+    codec::ListRef<double> list_ref;
+    list_ref.list = reinterpret_cast<int8_t*>(&list);
+    int8_t* input = reinterpret_cast<int8_t*>(&list_ref);
+    auto udaf = udf::UdfFunctionBuilder(fn_name)
+                    .args<codec::ListRef<double>>()
+                    .returns<double>()
+                    .build();
+    switch (mode) {
+        case BENCHMARK: {
+            if (use_kernel) {
+                for (auto _ : *state) {
+                    benchmark::DoNotOptimize(RunReduceKernel(fn_name, input));
+                }
+            } else {
+                for (auto _ : *state) {
+                    benchmark::DoNotOptimize(udaf(list_ref));
+                }
+            }
+            break;
+        }
+        case TEST: {
+            ASSERT_NEAR(udaf(list_ref), RunReduceKernel(fn_name, input),
+                        1e-6);
+            break;
+        }
+    }
+}
+
+// the projection of "select col1 + col2 + col5 as c1, col6 > col0 as c2"
+static codec::Row RunProjectByRowView(const codec::Schema& schema,
+                                      const codec::Schema& output_schema,
+                                      const codec::Row& row) {
+    codec::RowView row_view(schema, row.buf(), row.size());
+    int32_t col1 = 0;
+    int16_t col2 = 0;
+    int64_t col5 = 0;
+    const char* col0 = nullptr;
+    const char* col6 = nullptr;
+    uint32_t col0_size = 0;
+    uint32_t col6_size = 0;
+    row_view.GetInt32(1, &col1);
+    row_view.GetInt16(2, &col2);
+    row_view.GetInt64(5, &col5);
+    row_view.GetString(0, &col0, &col0_size);
+    row_view.GetString(6, &col6, &col6_size);
+    codec::RowBuilder row_builder(output_schema);
+    uint32_t total_size = row_builder.CalTotalLength(0);
+    int8_t* buf = static_cast<int8_t*>(malloc(total_size));
+    row_builder.SetBuffer(buf, total_size);
+    row_builder.AppendInt64(col1 + col2 + col5);
+    row_builder.AppendBool(codec::StringRef(col6_size, col6) >
+                           codec::StringRef(col0_size, col0));
+    return codec::Row(base::RefCountedSlice::CreateManaged(buf, total_size));
+}
+
+void ProjectRowCols(benchmark::State* state, MODE mode, int64_t data_size,
+                    bool use_row_view) {
+    type::TableDef table_def;
+    std::vector<Row> buffer;
+    CaseDataMock::BuildOnePkTableData(table_def, buffer, data_size);
+    type::Database db;
+    db.set_name("db");
+    *db.add_tables() = table_def;
+    auto catalog = std::make_shared<vm::SimpleCatalog>();
+    catalog->AddDatabase(db);
+
+    vm::Engine engine(catalog);
+    vm::BatchRunSession session;
+    base::Status status;
+    ASSERT_TRUE(engine.Get(
+        "select col1 + col2 + col5 as c1, col6 > col0 as c2 from t1;", "db",
+        session, status))
+        << status;
+    auto compile_info = std::dynamic_pointer_cast<vm::SqlCompileInfo>(
+        session.GetCompileInfo());
+    auto& sql_context = compile_info->get_sql_context();
+    auto fn = sql_context.physical_plan->GetFnInfos()[0]->fn_ptr();
+    const codec::Schema& output_schema = sql_context.schema;
+    Row parameter;
+    switch (mode) {
+        case BENCHMARK: {
+            if (use_row_view) {
+                for (auto _ : *state) {
+                    for (auto& row : buffer) {
+                        benchmark::DoNotOptimize(RunProjectByRowView(
+                            table_def.columns(), output_schema, row));
+                    }
+                }
+            } else {
+                for (auto _ : *state) {
+                    for (auto& row : buffer) {
+                        benchmark::DoNotOptimize(
+                            vm::CoreAPI::RowProject(fn, row, parameter, true));
+                    }
+                }
+            }
+            break;
+        }
+        case TEST: {
+            for (auto& row : buffer) {
+                Row expected = RunProjectByRowView(table_def.columns(),
+                                                   output_schema, row);
+                Row output = vm::CoreAPI::RowProject(fn, row, parameter, true);
+                ASSERT_EQ(expected.ToString(), output.ToString());
+            }
+            break;
+        }
+    }
+}
+
 void DoSumTableCol(vm::TableHandler* window, benchmark::State* state, MODE mode,
                    int64_t data_size, const std::string& col_name) {
     vm::SchemasContext schemas_context;
@@ -590,6 +726,63 @@ void DateToString(benchmark::State* state, MODE mode) {
         }
     }
 }
+// a text of data_size bytes ending with "needle"
+static std::string BuildText(int64_t data_size) {
+    std::string text;
+    while (static_cast<int64_t>(text.size()) + 6 < data_size) {
+        text += "Key:Value,";
+    }
+    text.resize(data_size < 6 ? 0 : data_size - 6);
+    return text + "needle";
+}
+void StringLikeMatch(benchmark::State* state, MODE mode, int64_t data_size,
+                     const std::string& pattern, bool case_insensitive) {
+    std::string text = BuildText(data_size);
+    codec::StringRef str(text);
+    codec::StringRef pattern_ref(pattern);
+    auto fn = case_insensitive ? udf::v1::ilike_match : udf::v1::like_match;
+    switch (mode) {
+        case BENCHMARK: {
+            for (auto _ : *state) {
+                benchmark::DoNotOptimize(fn(&str, &pattern_ref));
+            }
+            break;
+        }
+        case TEST: {
+            ASSERT_TRUE(fn(&str, &pattern_ref));
+            break;
+        }
+    }
+}
+void StringCaseCompare(benchmark::State* state, MODE mode, int64_t data_size,
+                       bool use_simd) {
+    std::string text = BuildText(data_size);
+    std::string upper = text;
+    for (auto& c : upper) {
+        c = toupper(c);
+    }
+    switch (mode) {
+        case BENCHMARK: {
+            for (auto _ : *state) {
+                if (use_simd) {
+                    benchmark::DoNotOptimize(udf::simd::CaseCompare(
+                        text.data(), text.size(), upper.data(),
+                        upper.size()));
+                } else {
+                    benchmark::DoNotOptimize(strncasecmp(
+                        text.data(), upper.data(), text.size()));
+                }
+            }
+            break;
+        }
+        case TEST: {
+            ASSERT_EQ(0, udf::simd::CaseCompare(text.data(), text.size(),
+                                                upper.data(), upper.size()));
+            ASSERT_EQ(0, strncasecmp(text.data(), upper.data(), text.size()));
+            break;
+        }
+    }
+}
 int64_t RunHistoryWindowBuffer(const vm::WindowRange& window_range,
                                uint64_t data_size,
                                const bool exclude_current_time) {  // NOLINT
@@ -28,6 +28,12 @@ void SumRequestUnionTableCol(benchmark::State* state, MODE mode,
                              int64_t data_size, const std::string& col_name);
 void SumArrayListCol(benchmark::State* state, MODE mode, int64_t data_size,
                      const std::string& col_name);
+// reduce a decoded double column by the udaf or by the list kernel
+void ReduceDecodedCol(benchmark::State* state, MODE mode, int64_t data_size,
+                      const std::string& fn_name, bool use_kernel);
+// project the columns of t1 rows by the compiled sql or by decoding the rows
+void ProjectRowCols(benchmark::State* state, MODE mode, int64_t data_size,
+                    bool use_row_view);
 void CopyMemTable(benchmark::State* state, MODE mode, int64_t data_size);
 void CopyMemSegment(benchmark::State* state, MODE mode, int64_t data_size);
 void CopyArrayList(benchmark::State* state, MODE mode, int64_t data_size);
@@ -40,6 +46,12 @@ void TimestampFormat(benchmark::State* state, MODE mode);
 
 void DateToString(benchmark::State* state, MODE mode);
 void DateFormat(benchmark::State* state, MODE mode);
+// String Udf
+void StringLikeMatch(benchmark::State* state, MODE mode, int64_t data_size,
+                     const std::string& pattern, bool case_insensitive);
+// compare a string with its upper case copy by the simd kernel or strncasecmp
+void StringCaseCompare(benchmark::State* state, MODE mode, int64_t data_size,
+                       bool use_simd);
 void ByteMemPoolAlloc1000(benchmark::State* state, MODE mode,
                           size_t request_size);
 void NewFree1000(benchmark::State* state, MODE mode, size_t request_size);
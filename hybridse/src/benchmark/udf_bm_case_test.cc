@@ -45,6 +45,18 @@ TEST_F(UdfBMCaseTest, SumRequestUnionTableCol1_TEST) {
     SumRequestUnionTableCol(nullptr, TEST, 10000L, "col1");
 }
 
+TEST_F(UdfBMCaseTest, ReduceDecodedCol_TEST) {
+    for (auto fn_name : {"sum", "min", "max", "avg"}) {
+        ReduceDecodedCol(nullptr, TEST, 10L, fn_name, true);
+        ReduceDecodedCol(nullptr, TEST, 1000L, fn_name, true);
+    }
+}
+
+TEST_F(UdfBMCaseTest, ProjectRowCols_TEST) {
+    ProjectRowCols(nullptr, TEST, 10L, false);
+    ProjectRowCols(nullptr, TEST, 100L, false);
+}
+
 TEST_F(UdfBMCaseTest, CopyMemSegment_TEST) {
     CopyMemSegment(nullptr, TEST, 10L);
     CopyMemSegment(nullptr, TEST, 100L);
@@ -80,6 +92,15 @@ TEST_F(UdfBMCaseTest, TimestampFormat_TEST) { TimestampFormat(nullptr, TEST); }
 TEST_F(UdfBMCaseTest, DateToString_TEST) { DateToString(nullptr, TEST); }
 TEST_F(UdfBMCaseTest, DateFormat_TEST) { DateFormat(nullptr, TEST); }
 
+TEST_F(UdfBMCaseTest, StringLikeMatch_TEST) {
+    StringLikeMatch(nullptr, TEST, 256, "%needle%", false);
+    StringLikeMatch(nullptr, TEST, 256, "Key%ne_dle", false);
+    StringLikeMatch(nullptr, TEST, 256, "%NEEDLE%", true);
+}
+TEST_F(UdfBMCaseTest, StringCaseCompare_TEST) {
+    StringCaseCompare(nullptr, TEST, 256, true);
+}
+
 }  // namespace bm
 }  // namespace hybridse
 int main(int argc, char** argv) {
@@ -0,0 +1,32 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_BITCODE_BUILTIN_BITCODE_H_
+#define SRC_BITCODE_BUILTIN_BITCODE_H_
+
+#include <stddef.h>
+
+namespace hybridse {
+namespace bitcode {
+
+// the llvm bitcode of builtin_functions.cc, which is generated by the build,
+// the size is 0 if the build finds no clang of the llvm version
+extern const unsigned char kBuiltinBitcode[];
+extern const size_t kBuiltinBitcodeSize;
+
+}  // namespace bitcode
+}  // namespace hybridse
+#endif  // SRC_BITCODE_BUILTIN_BITCODE_H_
@@ -0,0 +1,131 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// The builtin functions compiled into the llvm bitcode which the jit links
+// into the modules, so that the calls to them can be inlined. This file is
+// not compiled into the library: every function is named by the symbol the
+// jit calls, and it must do the same as the native function registered with
+// the symbol, which the calls left after the optimization still go to.
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+#include "codec/type_codec.h"
+#include "udf/civil_time.h"
+#include "udf/udf.h"
+
+using hybridse::codec::Date;
+using hybridse::codec::Timestamp;
+namespace v1 = hybridse::udf::v1;
+
+#define HYBRIDSE_BUILTIN(ret, fn, symbol, ...) \
+    extern "C" ret fn(__VA_ARGS__) __asm__(symbol); ret fn(__VA_ARGS__)
+
+// row codec, see InitBuiltinJitSymbols
+HYBRIDSE_BUILTIN(void, builtin_encode_nullbit,
+                 "hybridse_storage_encode_nullbit", int8_t* buf_ptr,
+                 uint32_t col_idx, int8_t is_null) {
+    hybridse::codec::v1::AppendNullBit(buf_ptr, col_idx, is_null);
+}
+HYBRIDSE_BUILTIN(int8_t, builtin_get_str_addr_space,
+                 "hybridse_storage_get_str_addr_space", uint32_t size) {
+    return hybridse::codec::v1::GetAddrSpace(size);
+}
+
+// math udfs, see DefaultUdfLibrary::InitMathUdf
+HYBRIDSE_BUILTIN(int32_t, builtin_abs_int16, "abs.int16", int16_t x) {
+    return v1::Abs32<int16_t>()(x);
+}
+HYBRIDSE_BUILTIN(int32_t, builtin_abs_int32, "abs.int32", int32_t x) {
+    return v1::Abs32<int32_t>()(x);
+}
+HYBRIDSE_BUILTIN(int64_t, builtin_abs_int64, "abs.int64", int64_t x) {
+    return v1::Abs<int64_t>()(x);
+}
+HYBRIDSE_BUILTIN(double, builtin_abs_double, "abs.double", double x) {
+    return v1::Abs<double>()(x);
+}
+HYBRIDSE_BUILTIN(int64_t, builtin_ceil_int16, "ceil.int16", int16_t x) {
+    return v1::Ceil<int16_t>()(x);
+}
+HYBRIDSE_BUILTIN(int64_t, builtin_ceil_int32, "ceil.int32", int32_t x) {
+    return v1::Ceil<int32_t>()(x);
+}
+HYBRIDSE_BUILTIN(int64_t, builtin_ceil_int64, "ceil.int64", int64_t x) {
+    return v1::Ceil<int64_t>()(x);
+}
+HYBRIDSE_BUILTIN(double, builtin_ceil_double, "ceil.double", double x) {
+    return ceil(x);
+}
+HYBRIDSE_BUILTIN(int64_t, builtin_floor_int16, "floor.int16", int16_t x) {
+    return v1::Floor<int16_t>()(x);
+}
+HYBRIDSE_BUILTIN(int64_t, builtin_floor_int32, "floor.int32", int32_t x) {
+    return v1::Floor<int32_t>()(x);
+}
+HYBRIDSE_BUILTIN(int64_t, builtin_floor_int64, "floor.int64", int64_t x) {
+    return v1::Floor<int64_t>()(x);
+}
+HYBRIDSE_BUILTIN(double, builtin_floor_double, "floor.double", double x) {
+    return floor(x);
+}
+
+// date udfs, see DefaultUdfLibrary::InitDateUdf
+HYBRIDSE_BUILTIN(int32_t, builtin_year_int64, "year.int64", int64_t ts) {
+    return v1::YearOfTs(ts);
+}
+HYBRIDSE_BUILTIN(int32_t, builtin_year_timestamp, "year.timestamp",
+                 Timestamp* ts) {
+    return v1::YearOfTs(ts->ts_);
+}
+HYBRIDSE_BUILTIN(int32_t, builtin_month_int64, "month.int64", int64_t ts) {
+    return v1::MonthOfTs(ts);
+}
+HYBRIDSE_BUILTIN(int32_t, builtin_month_timestamp, "month.timestamp",
+                 Timestamp* ts) {
+    return v1::MonthOfTs(ts->ts_);
+}
+HYBRIDSE_BUILTIN(int32_t, builtin_dayofmonth_int64, "dayofmonth.int64",
+                 int64_t ts) {
+    return v1::DayOfMonthOfTs(ts);
+}
+HYBRIDSE_BUILTIN(int32_t, builtin_dayofmonth_timestamp,
+                 "dayofmonth.timestamp", Timestamp* ts) {
+    return v1::DayOfMonthOfTs(ts->ts_);
+}
+HYBRIDSE_BUILTIN(int32_t, builtin_dayofweek_int64, "dayofweek.int64",
+                 int64_t ts) {
+    return v1::DayOfWeekOfTs(ts);
+}
+HYBRIDSE_BUILTIN(int32_t, builtin_dayofweek_timestamp, "dayofweek.timestamp",
+                 Timestamp* ts) {
+    return v1::DayOfWeekOfTs(ts->ts_);
+}
+HYBRIDSE_BUILTIN(int32_t, builtin_dayofweek_date, "dayofweek.date",
+                 Date* date) {
+    return v1::DayOfWeekOfDate(date->date_);
+}
+HYBRIDSE_BUILTIN(int32_t, builtin_weekofyear_int64, "weekofyear.int64",
+                 int64_t ts) {
+    return v1::WeekOfYearOfTs(ts);
+}
+HYBRIDSE_BUILTIN(int32_t, builtin_weekofyear_timestamp,
+                 "weekofyear.timestamp", Timestamp* ts) {
+    return v1::WeekOfYearOfTs(ts->ts_);
+}
+HYBRIDSE_BUILTIN(int32_t, builtin_weekofyear_date, "weekofyear.date",
+                 Date* date) {
+    return v1::WeekOfYearOfDate(date->date_);
+}
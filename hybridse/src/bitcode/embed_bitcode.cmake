@@ -0,0 +1,36 @@
+# Copyright 2021 4Paradigm
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+# write the bitcode file INPUT into the source OUTPUT as the array of bitcode/builtin_bitcode.h, the array is
+# empty without INPUT
+#   cmake -DINPUT=builtin_functions.bc -DOUTPUT=builtin_bitcode.cc -P embed_bitcode.cmake
+if (INPUT)
+    file(READ ${INPUT} BITCODE_HEX HEX)
+    string(LENGTH "${BITCODE_HEX}" BITCODE_HEX_LEN)
+    math(EXPR BITCODE_SIZE "${BITCODE_HEX_LEN} / 2")
+    string(REGEX REPLACE "([0-9a-f][0-9a-f])" "0x\\1," BITCODE_BYTES "${BITCODE_HEX}")
+else ()
+    set(BITCODE_SIZE 0)
+    set(BITCODE_BYTES "0")
+endif ()
+file(WRITE ${OUTPUT} "// generated by embed_bitcode.cmake, do not edit
+#include \"bitcode/builtin_bitcode.h\"
+
+namespace hybridse {
+namespace bitcode {
+const unsigned char kBuiltinBitcode[] = {${BITCODE_BYTES}};
+const size_t kBuiltinBitcodeSize = ${BITCODE_SIZE};
+}  // namespace bitcode
+}  // namespace hybridse
+")
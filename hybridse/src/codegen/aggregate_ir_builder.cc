@@ -20,20 +20,28 @@
 #include <limits>
 #include <map>
 #include <memory>
+#include <set>
 
 #include "codegen/expr_ir_builder.h"
 #include "codegen/ir_base_builder.h"
+#include "codegen/type_ir_builder.h"
+#include "codegen/udf_ir_builder.h"
 #include "codegen/variable_ir_builder.h"
 #include "gflags/gflags.h"
 #include "glog/logging.h"
 namespace hybridse {
 namespace codegen {
 
-AggregateIRBuilder::AggregateIRBuilder(const vm::SchemasContext* sc,
-                                       ::llvm::Module* module,
+using ::hybridse::common::kCodegenError;
+
+AggregateIRBuilder::AggregateIRBuilder(CodeGenContext* ctx,
                                        const node::FrameNode* frame_node,
                                        uint32_t id)
-    : schema_context_(sc), module_(module), frame_node_(frame_node), id_(id) {
+    : ctx_(ctx),
+      schema_context_(ctx->schemas_context()),
+      module_(ctx->GetModule()),
+      frame_node_(frame_node),
+      id_(id) {
     available_agg_func_set_.insert("sum");
     available_agg_func_set_.insert("avg");
     available_agg_func_set_.insert("count");
@@ -71,6 +79,9 @@ bool AggregateIRBuilder::CollectAggColumn(const hybridse::node::ExprNode* expr,
             }
             boost::to_lower(agg_func_name);
             if (!IsAggFuncName(agg_func_name)) {
+                if (call->GetFnDef()->GetType() == node::kUdafDef) {
+                    return CollectUdafCall(call, output_idx, res_agg_type);
+                }
                 break;
             }
             if (call->GetChildNum() != 1) {
@@ -133,6 +144,112 @@ bool AggregateIRBuilder::CollectAggColumn(const hybridse::node::ExprNode* expr,
     return false;
 }
 
+static bool IsClosedFn(const node::FnDefNode* fn,
+                       const std::set<int64_t>& bound_ids);
+
+// whether the ids an expression refers to are all bound by the functions it is
+// in, the row loop does not bind the row or the parameters of the project
+static bool IsClosedExpr(const node::ExprNode* expr,
+                         const std::set<int64_t>& bound_ids) {
+    if (expr == nullptr) {
+        return true;
+    }
+    switch (expr->GetExprType()) {
+        case node::kExprId: {
+            auto id = dynamic_cast<const node::ExprIdNode*>(expr);
+            return bound_ids.find(id->GetId()) != bound_ids.end();
+        }
+        case node::kExprColumnRef:
+        case node::kExprParameter:
+            return false;
+        case node::kExprCall: {
+            auto call = dynamic_cast<const node::CallExprNode*>(expr);
+            if (!IsClosedFn(call->GetFnDef(), bound_ids)) {
+                return false;
+            }
+            break;
+        }
+        default:
+            break;
+    }
+    for (size_t i = 0; i < expr->GetChildNum(); ++i) {
+        if (!IsClosedExpr(expr->GetChild(i), bound_ids)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool IsClosedFn(const node::FnDefNode* fn,
+                       const std::set<int64_t>& bound_ids) {
+    if (fn == nullptr) {
+        return true;
+    }
+    switch (fn->GetType()) {
+        case node::kLambdaDef: {
+            auto lambda = dynamic_cast<const node::LambdaNode*>(fn);
+            std::set<int64_t> ids(bound_ids);
+            for (size_t i = 0; i < lambda->GetArgSize(); ++i) {
+                ids.insert(lambda->GetArg(i)->GetId());
+            }
+            return IsClosedExpr(lambda->body(), ids);
+        }
+        case node::kUdafDef: {
+            auto udaf = dynamic_cast<const node::UdafDefNode*>(fn);
+            return IsClosedExpr(udaf->init_expr(), bound_ids) &&
+                   IsClosedFn(udaf->update_func(), bound_ids) &&
+                   IsClosedFn(udaf->output_func(), bound_ids);
+        }
+        default:
+            return true;
+    }
+}
+
+bool AggregateIRBuilder::CollectUdafCall(const node::CallExprNode* call,
+                                         size_t output_idx,
+                                         hybridse::type::Type* res_agg_type) {
+    auto udaf = dynamic_cast<const node::UdafDefNode*>(call->GetFnDef());
+    if (udaf == nullptr || udaf->init_expr() == nullptr ||
+        udaf->update_func() == nullptr) {
+        return false;
+    }
+    // only the udafs iterating on the rows of the window, which the window
+    // aggregations are lambdafied to
+    if (call->GetChildNum() != 1 || udaf->GetArgSize() != 1 ||
+        call->GetChild(0)->GetExprType() != node::kExprId) {
+        return false;
+    }
+    auto elem_type = udaf->GetElementType(0);
+    if (elem_type == nullptr || elem_type->base() != node::kRow ||
+        udaf->IsElementNullable(0)) {
+        return false;
+    }
+    // the output is encoded into the fixed part of the output row
+    auto ret_type = udaf->GetReturnType();
+    if (ret_type == nullptr) {
+        return false;
+    }
+    switch (ret_type->base()) {
+        case node::kBool:
+        case node::kInt16:
+        case node::kInt32:
+        case node::kInt64:
+        case node::kFloat:
+        case node::kDouble:
+            break;
+        default:
+            return false;
+    }
+    if (!IsClosedFn(udaf, {})) {
+        return false;
+    }
+    if (!DataType2SchemaType(*ret_type, res_agg_type)) {
+        return false;
+    }
+    udaf_call_infos_.emplace_back(udaf, output_idx);
+    return true;
+}
+
 class StatisticalAggGenerator {
  public:
     StatisticalAggGenerator(node::DataType col_type,
@@ -461,6 +578,127 @@ class StatisticalAggGenerator {
     ::llvm::Value* count_state_;
 };
 
+// UdafAggGenerator computes an udaf call in the row loop, the states are kept
+// in the stack of the loop function as UdfIRBuilder::BuildUdafCall does
+class UdafAggGenerator {
+ public:
+    UdafAggGenerator(CodeGenContext* ctx, const node::FrameNode* frame,
+                     const UdafCallInfo& info)
+        : ctx_(ctx),
+          frame_(frame),
+          udaf_(info.udaf),
+          output_idx_(info.output_idx),
+          states_() {}
+
+    Status GenInitState() {
+        const node::TypeNode* state_type = udaf_->GetStateType();
+        CHECK_TRUE(state_type != nullptr, kCodegenError, "Missing state type");
+        std::vector<const node::TypeNode*> field_types;
+        if (state_type->base() == node::kTuple) {
+            field_types = state_type->generics();
+        } else {
+            field_types.push_back(state_type);
+        }
+
+        NativeValue init_value;
+        ExprIRBuilder init_expr_builder(ctx_);
+        init_expr_builder.set_frame(nullptr, frame_);
+        CHECK_STATUS(init_expr_builder.Build(udaf_->init_expr(), &init_value),
+                     "Build init expr ", udaf_->init_expr()->GetExprString(),
+                     " failed");
+        CHECK_TRUE(field_types.size() == 1 ||
+                       (init_value.IsTuple() &&
+                        init_value.GetFieldNum() == field_types.size()),
+                   kCodegenError);
+
+        ::llvm::IRBuilder<>* builder = ctx_->GetBuilder();
+        for (size_t i = 0; i < field_types.size(); ++i) {
+            ::llvm::Type* llvm_ty = nullptr;
+            CHECK_TRUE(GetLlvmType(ctx_->GetModule(), field_types[i], &llvm_ty),
+                       kCodegenError, "Fail to get llvm type for ",
+                       field_types[i]->GetName());
+            NativeValue sub =
+                field_types.size() > 1 ? init_value.GetField(i) : init_value;
+            if (TypeIRBuilder::IsStructPtr(llvm_ty)) {
+                states_.push_back(sub.GetValue(builder));
+            } else {
+                ::llvm::Value* state =
+                    CreateAllocaAtHead(builder, llvm_ty, "state_alloca");
+                builder->CreateStore(sub.GetValue(builder), state);
+                states_.push_back(state);
+            }
+        }
+        return Status::OK();
+    }
+
+    Status GenUpdate(const NativeValue& row) {
+        NativeValue update_value;
+        UdfIRBuilder udf_builder(ctx_, nullptr, frame_);
+        CHECK_STATUS(
+            udf_builder.BuildCall(
+                udaf_->update_func(),
+                {udaf_->GetStateType(), udaf_->GetElementType(0)},
+                {LoadState(), row}, &update_value),
+            "Build update function call of ", udaf_->GetName(), " failed");
+
+        ::llvm::IRBuilder<>* builder = ctx_->GetBuilder();
+        CHECK_TRUE(states_.size() == 1 ||
+                       (update_value.IsTuple() &&
+                        update_value.GetFieldNum() == states_.size()),
+                   kCodegenError);
+        for (size_t i = 0; i < states_.size(); ++i) {
+            NativeValue sub =
+                states_.size() > 1 ? update_value.GetField(i) : update_value;
+            ::llvm::Value* raw_update = sub.GetValue(builder);
+            if (TypeIRBuilder::IsStructPtr(raw_update->getType())) {
+                raw_update = builder->CreateLoad(raw_update);
+            }
+            builder->CreateStore(raw_update, states_[i]);
+        }
+        return Status::OK();
+    }
+
+    Status GenOutput(std::vector<std::pair<size_t, NativeValue>>* outputs) {
+        NativeValue output = LoadState();
+        if (udaf_->output_func() != nullptr) {
+            UdfIRBuilder udf_builder(ctx_, nullptr, frame_);
+            CHECK_STATUS(udf_builder.BuildCall(udaf_->output_func(),
+                                               {udaf_->GetStateType()},
+                                               {LoadState()}, &output),
+                         "Build output function call of ", udaf_->GetName(),
+                         " failed");
+        }
+        CHECK_TRUE(!output.IsTuple(), kCodegenError,
+                   "Output do not support tuple");
+        outputs->emplace_back(output_idx_, output);
+        return Status::OK();
+    }
+
+ private:
+    NativeValue LoadState() {
+        ::llvm::IRBuilder<>* builder = ctx_->GetBuilder();
+        std::vector<NativeValue> values;
+        for (auto state : states_) {
+            if (TypeIRBuilder::IsStructPtr(state->getType())) {
+                values.push_back(NativeValue::Create(state));
+            } else {
+                values.push_back(
+                    NativeValue::Create(builder->CreateLoad(state)));
+            }
+        }
+        if (values.size() > 1) {
+            return NativeValue::CreateTuple(values);
+        }
+        return values[0];
+    }
+
+    CodeGenContext* ctx_;
+    const node::FrameNode* frame_;
+    const node::UdafDefNode* udaf_;
+    size_t output_idx_;
+    std::vector<::llvm::Value*> states_;
+};
+
 llvm::Type* AggregateIRBuilder::GetOutputLlvmType(
     ::llvm::LLVMContext& llvm_ctx, const std::string& fname,
     const node::DataType& node_type) {
@@ -629,25 +867,30 @@ bool AggregateIRBuilder::BuildMulti(const std::string& base_funcname,
         module_->getOrInsertFunction(fn_name, fnt),
         {window_ptr.GetValue(&builder), builder.CreateLoad(output_buf)});
 
-    ::llvm::BasicBlock* head_block =
-        ::llvm::BasicBlock::Create(llvm_ctx, "head", fn);
-    ::llvm::BasicBlock* enter_block =
-        ::llvm::BasicBlock::Create(llvm_ctx, "enter_iter", fn);
-    ::llvm::BasicBlock* body_block =
-        ::llvm::BasicBlock::Create(llvm_ctx, "iter_body", fn);
-    ::llvm::BasicBlock* exit_block =
-        ::llvm::BasicBlock::Create(llvm_ctx, "exit_iter", fn);
-
     std::vector<StatisticalAggGenerator> generators;
     if (!ScheduleAggGenerators(agg_col_infos_, &generators)) {
         LOG(WARNING) << "Schedule agg ops failed";
         return false;
     }
+    std::vector<UdafAggGenerator> udaf_generators;
+    for (auto& info : udaf_call_infos_) {
+        udaf_generators.emplace_back(ctx_, frame_node_, info);
+    }
+
+    // the udaf functions are built by the context, so is the whole loop
+    FunctionScopeGuard fn_guard(fn, ctx_);
+    ::llvm::IRBuilder<>* fn_builder = ctx_->GetBuilder();
 
     // gen head
-    builder.SetInsertPoint(head_block);
     for (auto& agg_generator : generators) {
-        agg_generator.GenInitState(&builder);
+        agg_generator.GenInitState(fn_builder);
+    }
+    for (auto& udaf_generator : udaf_generators) {
+        status = udaf_generator.GenInitState();
+        if (!status.isOK()) {
+            LOG(WARNING) << "fail to gen udaf init state: " << status;
+            return false;
+        }
     }
 
     ::llvm::Value* input_arg = fn->arg_begin();
@@ -656,113 +899,142 @@ bool AggregateIRBuilder::BuildMulti(const std::string& base_funcname,
     // on stack unique pointer
     size_t iter_bytes = sizeof(std::unique_ptr<codec::RowIterator>);
     ::llvm::Value* iter_ptr = CreateAllocaAtHead(
-        &builder, ::llvm::Type::getInt8Ty(llvm_ctx), "row_iter",
+        fn_builder, ::llvm::Type::getInt8Ty(llvm_ctx), "row_iter",
         ::llvm::ConstantInt::get(int64_ty, iter_bytes, true));
     auto get_iter_func = module_->getOrInsertFunction(
         "hybridse_storage_get_row_iter", void_ty, ptr_ty, ptr_ty);
-    builder.CreateCall(get_iter_func, {input_arg, iter_ptr});
-    builder.CreateBr(enter_block);
+    fn_builder->CreateCall(get_iter_func, {input_arg, iter_ptr});
 
-    // gen iter begin
-    builder.SetInsertPoint(enter_block);
     auto bool_ty = llvm::Type::getInt1Ty(llvm_ctx);
     auto has_next_func = module_->getOrInsertFunction(
         "hybridse_storage_row_iter_has_next",
         ::llvm::FunctionType::get(bool_ty, {ptr_ty}, false));
-    ::llvm::Value* has_next = builder.CreateCall(has_next_func, iter_ptr);
-    builder.CreateCondBr(has_next, body_block, exit_block);
-
-    // gen iter body
-    builder.SetInsertPoint(body_block);
     auto get_slice_func = module_->getOrInsertFunction(
         "hybridse_storage_row_iter_get_cur_slice",
         ::llvm::FunctionType::get(ptr_ty, {ptr_ty, int64_ty}, false));
     auto get_slice_size_func = module_->getOrInsertFunction(
         "hybridse_storage_row_iter_get_cur_slice_size",
         ::llvm::FunctionType::get(int64_ty, {ptr_ty, int64_ty}, false));
-    std::unordered_map<size_t, std::pair<::llvm::Value*, ::llvm::Value*>>
-        used_slices;
-
-    // compute current row's slices
-    for (auto& pair : agg_col_infos_) {
-        size_t schema_idx = pair.second.schema_idx;
-        auto iter = used_slices.find(schema_idx);
-        if (iter == used_slices.end()) {
-            ::llvm::Value* idx_value =
-                llvm::ConstantInt::get(int64_ty, schema_idx, true);
-            ::llvm::Value* buf_ptr =
-                builder.CreateCall(get_slice_func, {iter_ptr, idx_value});
-            ::llvm::Value* buf_size =
-                builder.CreateCall(get_slice_size_func, {iter_ptr, idx_value});
-            used_slices[schema_idx] = {buf_ptr, buf_size};
-        }
-    }
+    auto get_row_func = module_->getOrInsertFunction(
+        "hybridse_storage_row_iter_get_cur_row",
+        ::llvm::FunctionType::get(ptr_ty, {ptr_ty}, false));
+    auto next_func = module_->getOrInsertFunction(
+        "hybridse_storage_row_iter_next",
+        ::llvm::FunctionType::get(void_ty, {ptr_ty}, false));
 
-    // compute row field fetches
-    std::unordered_map<std::string, NativeValue> cur_row_fields_dict;
-    for (auto& pair : agg_col_infos_) {
-        auto& info = pair.second;
-        std::string col_key = info.GetColKey();
-        if (cur_row_fields_dict.find(col_key) == cur_row_fields_dict.end()) {
-            size_t schema_idx = info.schema_idx;
-            auto& slice_info = used_slices[schema_idx];
-
-            ScopeVar dummy_scope_var;
-            BufNativeIRBuilder buf_builder(
-                schema_idx, schema_context_->GetRowFormat(schema_idx),
-                body_block, &dummy_scope_var);
-            NativeValue field_value;
-            if (!buf_builder.BuildGetField(info.col_idx, slice_info.first,
-                                           slice_info.second, &field_value)) {
-                LOG(ERROR) << "fail to gen fetch column";
-                return false;
+    status = ctx_->CreateWhile(
+        [&](::llvm::Value** has_next) {
+            *has_next = ctx_->GetBuilder()->CreateCall(has_next_func, iter_ptr);
+            return Status::OK();
+        },
+        [&]() {
+            ::llvm::IRBuilder<>* body_builder = ctx_->GetBuilder();
+            std::unordered_map<size_t,
+                               std::pair<::llvm::Value*, ::llvm::Value*>>
+                used_slices;
+
+            // compute current row's slices
+            for (auto& pair : agg_col_infos_) {
+                size_t schema_idx = pair.second.schema_idx;
+                auto iter = used_slices.find(schema_idx);
+                if (iter == used_slices.end()) {
+                    ::llvm::Value* idx_value =
+                        llvm::ConstantInt::get(int64_ty, schema_idx, true);
+                    ::llvm::Value* buf_ptr = body_builder->CreateCall(
+                        get_slice_func, {iter_ptr, idx_value});
+                    ::llvm::Value* buf_size = body_builder->CreateCall(
+                        get_slice_size_func, {iter_ptr, idx_value});
+                    used_slices[schema_idx] = {buf_ptr, buf_size};
+                }
             }
-            cur_row_fields_dict[col_key] = field_value;
-        }
-    }
 
-    // compute accumulation
-    for (auto& agg_generator : generators) {
-        std::vector<::llvm::Value*> fields;
-        std::vector<::llvm::Value*> fields_is_null;
-        for (auto& key : agg_generator.GetColKeys()) {
-            auto iter = cur_row_fields_dict.find(key);
-            if (iter == cur_row_fields_dict.end()) {
-                LOG(WARNING) << "Fail to find row field of " << key;
-                return false;
+            // compute row field fetches
+            std::unordered_map<std::string, NativeValue> cur_row_fields_dict;
+            for (auto& pair : agg_col_infos_) {
+                auto& info = pair.second;
+                std::string col_key = info.GetColKey();
+                if (cur_row_fields_dict.find(col_key) ==
+                    cur_row_fields_dict.end()) {
+                    size_t schema_idx = info.schema_idx;
+                    auto& slice_info = used_slices[schema_idx];
+
+                    ScopeVar dummy_scope_var;
+                    BufNativeIRBuilder buf_builder(
+                        schema_idx, schema_context_->GetRowFormat(schema_idx),
+                        ctx_->GetCurrentBlock(), &dummy_scope_var);
+                    NativeValue field_value;
+                    CHECK_TRUE(buf_builder.BuildGetField(
+                                   info.col_idx, slice_info.first,
+                                   slice_info.second, &field_value),
+                               kCodegenError, "fail to gen fetch column");
+                    cur_row_fields_dict[col_key] = field_value;
+                }
             }
-            auto& field_value = iter->second;
-            fields.push_back(field_value.GetValue(&builder));
-            fields_is_null.push_back(field_value.GetIsNull(&builder));
-        }
-        agg_generator.GenUpdate(&builder, fields, fields_is_null);
+
+            // compute accumulation
+            for (auto& agg_generator : generators) {
+                std::vector<::llvm::Value*> fields;
+                std::vector<::llvm::Value*> fields_is_null;
+                for (auto& key : agg_generator.GetColKeys()) {
+                    auto iter = cur_row_fields_dict.find(key);
+                    CHECK_TRUE(iter != cur_row_fields_dict.end(),
+                               kCodegenError, "Fail to find row field of ",
+                               key);
+                    auto& field_value = iter->second;
+                    fields.push_back(field_value.GetValue(body_builder));
+                    fields_is_null.push_back(
+                        field_value.GetIsNull(body_builder));
+                }
+                agg_generator.GenUpdate(body_builder, fields, fields_is_null);
+            }
+
+            // the update functions of the udafs take the current row
+            if (!udaf_generators.empty()) {
+                NativeValue cur_row = NativeValue::Create(
+                    body_builder->CreateCall(get_row_func, {iter_ptr}));
+                for (auto& udaf_generator : udaf_generators) {
+                    CHECK_STATUS(udaf_generator.GenUpdate(cur_row));
+                }
+            }
+            ctx_->GetBuilder()->CreateCall(next_func, {iter_ptr});
+            return Status::OK();
+        });
+    if (!status.isOK()) {
+        LOG(WARNING) << "fail to gen agg row loop: " << status;
+        return false;
     }
-    auto next_func = module_->getOrInsertFunction(
-        "hybridse_storage_row_iter_next",
-        ::llvm::FunctionType::get(void_ty, {ptr_ty}, false));
-    builder.CreateCall(next_func, {iter_ptr});
-    builder.CreateBr(enter_block);
 
     // gen iter end
-    builder.SetInsertPoint(exit_block);
     auto delete_iter_func = module_->getOrInsertFunction(
         "hybridse_storage_row_iter_delete",
         ::llvm::FunctionType::get(void_ty, {ptr_ty}, false));
-    builder.CreateCall(delete_iter_func, {iter_ptr});
+    ctx_->GetBuilder()->CreateCall(delete_iter_func, {iter_ptr});
+
+    std::vector<std::pair<size_t, NativeValue>> outputs;
+    for (auto& agg_generator : generators) {
+        agg_generator.GenOutputs(ctx_->GetBuilder(), &outputs);
+    }
+    for (auto& udaf_generator : udaf_generators) {
+        status = udaf_generator.GenOutput(&outputs);
+        if (!status.isOK()) {
+            LOG(WARNING) << "fail to gen udaf output: " << status;
+            return false;
+        }
+    }
 
     // store results to output row
     std::map<uint32_t, NativeValue> dummy_map;
     BufNativeEncoderIRBuilder output_encoder(&dummy_map, &output_schema,
-                                             exit_block);
-    for (auto& agg_generator : generators) {
-        std::vector<std::pair<size_t, NativeValue>> outputs;
-        agg_generator.GenOutputs(&builder, &outputs);
-        for (auto pair : outputs) {
-            output_encoder.BuildEncodePrimaryField(output_arg, pair.first,
-                                                   pair.second);
-        }
+                                             ctx_->GetCurrentBlock());
+    for (auto pair : outputs) {
+        output_encoder.BuildEncodePrimaryField(output_arg, pair.first,
+                                               pair.second);
     }
-    builder.CreateRetVoid();
+    ctx_->GetBuilder()->CreateRetVoid();
+
+    auto fn_scope = ctx_->GetCurrentScope();
+    fn_scope->blocks()->DropEmptyBlocks();
+    fn_scope->blocks()->ReInsertTo(fn);
     return true;
 }
 
@@ -21,6 +21,7 @@
 #include <unordered_map>
 #include <utility>
 #include <vector>
+#include "codegen/context.h"
 #include "codegen/expr_ir_builder.h"
 #include "codegen/variable_ir_builder.h"
 #include "llvm/IR/IRBuilder.h"
@@ -77,10 +78,20 @@ struct AggColumnInfo {
     }
 };
 
+// an udaf call over the rows of the window, which is computed by its init,
+// update and output functions in the shared row loop
+struct UdafCallInfo {
+    const node::UdafDefNode* udaf;
+    size_t output_idx;
+
+    UdafCallInfo(const node::UdafDefNode* udaf, size_t output_idx)
+        : udaf(udaf), output_idx(output_idx) {}
+};
+
 class AggregateIRBuilder {
  public:
-    AggregateIRBuilder(const vm::SchemasContext*, ::llvm::Module* module,
-                       const node::FrameNode* frame_node, uint32_t id);
+    AggregateIRBuilder(CodeGenContext* ctx, const node::FrameNode* frame_node,
+                       uint32_t id);
 
     // TODO(someone): remove temporary implementations for row-wise agg
     static bool EnableColumnAggOpt();
@@ -101,15 +112,22 @@ class AggregateIRBuilder {
                     const std::string& output_ptr_name,
                     const vm::Schema& output_schema);
 
-    bool empty() const { return agg_col_infos_.empty(); }
+    bool empty() const {
+        return agg_col_infos_.empty() && udaf_call_infos_.empty();
+    }
 
  private:
+    bool CollectUdafCall(const node::CallExprNode* call, size_t output_idx,
+                         ::hybridse::type::Type* res_agg_type);
+
+    CodeGenContext* ctx_;
     const vm::SchemasContext* schema_context_;
     ::llvm::Module* module_;
     const node::FrameNode* frame_node_;
     uint32_t id_;
     std::set<std::string> available_agg_func_set_;
     std::unordered_map<std::string, AggColumnInfo> agg_col_infos_;
+    std::vector<UdafCallInfo> udaf_call_infos_;
 };
 
 }  // namespace codegen
@@ -124,6 +124,49 @@ TEST_F(AggregateIRBuilderTest, TestMixedMultipleAgg) {
     free(ptr);
 }
 
+TEST_F(AggregateIRBuilderTest, TestMixedUdafAgg) {
+    std::string sql =
+        "SELECT "
+        "sum(col1) OVER w1 as col1_sum, "
+        "count_where(col1, col1 > 11) OVER w1 as col1_count_where, "
+        "sum_where(col1, col2 > 22) OVER w1 as col1_sum_where, "
+        "avg_where(col4, col1 > 1) OVER w1 as col4_avg_where, "
+        "max_where(col3, col1 < 1000) OVER w1 as col3_max_where, "
+        "distinct_count(col6) OVER w1 as col6_distinct_count, "
+        "min(col5) OVER w1 as col5_min "
+        "FROM t1 WINDOW "
+        "w1 AS "
+        "(PARTITION BY COL2 ORDER BY `TS` ROWS_RANGE BETWEEN 3 PRECEDING AND "
+        "CURRENT ROW) limit 10;";
+
+    int8_t* ptr = NULL;
+    std::vector<Row> window;
+    type::TableDef table1;
+    BuildWindow(table1, window, &ptr);
+    int8_t* output = NULL;
+    int8_t* row_ptr = reinterpret_cast<int8_t*>(&window[window.size() - 1]);
+    codec::ListRef<Row> window_ref;
+    window_ref.list = ptr;
+    int8_t* window_ptr = reinterpret_cast<int8_t*>(&window_ref);
+    codec::Schema schema;
+    CheckFnLetBuilder(&manager, table1, "", sql, row_ptr, window_ptr, &schema,
+                      &output);
+
+    // the udafs are computed in the row loop of the legacy aggregations
+    codec::RowView view(schema);
+    view.Reset(output, view.GetSize(output));
+    ASSERT_EQ(view.GetInt32Unsafe(0), 1 + 11 + 111 + 1111 + 11111);
+    ASSERT_EQ(view.GetInt64Unsafe(1), 3);
+    ASSERT_EQ(view.GetInt32Unsafe(2), 111 + 1111 + 11111);
+    ASSERT_DOUBLE_EQ(view.GetDoubleUnsafe(3),
+                     (44.1 + 444.1 + 4444.1 + 44444.1) / 4);
+    ASSERT_FLOAT_EQ(view.GetFloatUnsafe(4), 333.1f);
+    ASSERT_EQ(view.GetInt64Unsafe(5), 5);
+    ASSERT_EQ(view.GetInt64Unsafe(6), 5L);
+
+    free(ptr);
+}
+
 }  // namespace codegen
 }  // namespace hybridse
 
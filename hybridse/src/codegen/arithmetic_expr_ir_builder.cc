@@ -650,13 +650,21 @@ bool ArithmeticIRBuilder::BuildSDivExpr(::llvm::BasicBlock* block,
     }
     ::llvm::IRBuilder<> builder(block);
 
-    // TODO(someone): fully and correctly handle arithmetic exception
+    // the division by 0 gives 0, and the division by -1 is the negation,
+    // which doesn't trap on the min value. the divisor is replaced by 1 in
+    // both cases, so the sdiv is computed unconditionally without a branch
     ::llvm::Type* llvm_ty = casted_right->getType();
     ::llvm::Value* zero = ::llvm::ConstantInt::get(llvm_ty, 0);
     ::llvm::Value* div_is_zero = builder.CreateICmpEQ(casted_right, zero);
+    ::llvm::Value* div_is_minus_one = builder.CreateICmpEQ(
+        casted_right, ::llvm::ConstantInt::getSigned(llvm_ty, -1));
     casted_right = builder.CreateSelect(
-        div_is_zero, ::llvm::ConstantInt::get(llvm_ty, 1), casted_right);
+        builder.CreateOr(div_is_zero, div_is_minus_one),
+        ::llvm::ConstantInt::get(llvm_ty, 1), casted_right);
     ::llvm::Value* div_result = builder.CreateSDiv(casted_left, casted_right);
+    div_result = builder.CreateSelect(div_is_minus_one,
+                                      builder.CreateNeg(casted_left),
+                                      div_result);
     div_result = builder.CreateSelect(div_is_zero, zero, div_result);
 
     *output = div_result;
@@ -675,13 +683,16 @@ bool ArithmeticIRBuilder::BuildModExpr(::llvm::BasicBlock* block,
     }
     ::llvm::IRBuilder<> builder(block);
     if (casted_left->getType()->isIntegerTy()) {
-        // TODO(someone): fully and correctly handle arithmetic exception
-        ::llvm::Value* zero =
-            ::llvm::ConstantInt::get(casted_right->getType(), 0);
+        // the remainder by 0 gives 0, and the remainder by -1 is 0 too, which
+        // traps on the min value. both are computed by the divisor 1
+        ::llvm::Type* llvm_ty = casted_right->getType();
+        ::llvm::Value* zero = ::llvm::ConstantInt::get(llvm_ty, 0);
         ::llvm::Value* rem_is_zero = builder.CreateICmpEQ(casted_right, zero);
+        ::llvm::Value* rem_is_minus_one = builder.CreateICmpEQ(
+            casted_right, ::llvm::ConstantInt::getSigned(llvm_ty, -1));
         casted_right = builder.CreateSelect(
-            rem_is_zero, ::llvm::ConstantInt::get(casted_right->getType(), 1),
-            casted_right);
+            builder.CreateOr(rem_is_zero, rem_is_minus_one),
+            ::llvm::ConstantInt::get(llvm_ty, 1), casted_right);
         ::llvm::Value* srem_result =
             builder.CreateSRem(casted_left, casted_right);
         srem_result = builder.CreateSelect(rem_is_zero, zero, srem_result);
@@ -1042,6 +1042,25 @@ TEST_F(ArithmeticIRBuilderTest, TestModInt32XExpr) {
         ::hybridse::node::kFnOpMod);
 }
 
+TEST_F(ArithmeticIRBuilderTest, TestDivModMinusOne) {
+    // the min value divided by -1 wraps instead of trapping
+    BinaryArithmeticExprCheck<Nullable<int64_t>, Nullable<int64_t>,
+                              Nullable<int64_t>>(INT64_MIN, -1L, INT64_MIN,
+                                                 ::hybridse::node::kFnOpDiv);
+    BinaryArithmeticExprCheck<Nullable<int32_t>, Nullable<int32_t>,
+                              Nullable<int32_t>>(12, -1, -12,
+                                                 ::hybridse::node::kFnOpDiv);
+    BinaryArithmeticExprCheck<Nullable<int32_t>, Nullable<int32_t>,
+                              Nullable<int32_t>>(INT32_MIN, -1, 0,
+                                                 ::hybridse::node::kFnOpMod);
+    BinaryArithmeticExprCheck<Nullable<int64_t>, Nullable<int64_t>,
+                              Nullable<int64_t>>(-12L, -1L, 0L,
+                                                 ::hybridse::node::kFnOpMod);
+    BinaryArithmeticExprCheck<Nullable<int32_t>, Nullable<int32_t>,
+                              Nullable<int32_t>>(nullptr, -1, nullptr,
+                                                 ::hybridse::node::kFnOpDiv);
+}
+
 TEST_F(ArithmeticIRBuilderTest, TestModFloatXExpr) {
     BinaryArithmeticExprCheck<int16_t, float, float>(
         ::hybridse::node::kInt16, ::hybridse::node::kFloat,
@@ -15,6 +15,7 @@
  */
 
 #include "codegen/buf_ir_builder.h"
+#include <algorithm>
 #include <string>
 #include <utility>
 #include <vector>
@@ -59,32 +60,32 @@ bool BufNativeIRBuilder::BuildGetField(size_t col_idx, ::llvm::Value* row_ptr, :
     switch (data_type.base_) {
         case ::hybridse::node::kBool: {
             llvm::Type* bool_ty = builder.getInt1Ty();
-            return BuildGetPrimaryField("hybridse_storage_get_bool_field", row_ptr, col_idx, offset, bool_ty, output);
+            return BuildGetPrimaryField(row_ptr, col_idx, offset, bool_ty, output);
         }
         case ::hybridse::node::kInt16: {
             llvm::Type* i16_ty = builder.getInt16Ty();
-            return BuildGetPrimaryField("hybridse_storage_get_int16_field", row_ptr, col_idx, offset, i16_ty, output);
+            return BuildGetPrimaryField(row_ptr, col_idx, offset, i16_ty, output);
         }
         case ::hybridse::node::kInt32: {
             llvm::Type* i32_ty = builder.getInt32Ty();
-            return BuildGetPrimaryField("hybridse_storage_get_int32_field", row_ptr, col_idx, offset, i32_ty, output);
+            return BuildGetPrimaryField(row_ptr, col_idx, offset, i32_ty, output);
         }
         case ::hybridse::node::kInt64: {
             llvm::Type* i64_ty = builder.getInt64Ty();
-            return BuildGetPrimaryField("hybridse_storage_get_int64_field", row_ptr, col_idx, offset, i64_ty, output);
+            return BuildGetPrimaryField(row_ptr, col_idx, offset, i64_ty, output);
         }
         case ::hybridse::node::kFloat: {
             llvm::Type* float_ty = builder.getFloatTy();
-            return BuildGetPrimaryField("hybridse_storage_get_float_field", row_ptr, col_idx, offset, float_ty, output);
+            return BuildGetPrimaryField(row_ptr, col_idx, offset, float_ty, output);
         }
         case ::hybridse::node::kDouble: {
             llvm::Type* double_ty = builder.getDoubleTy();
-            return BuildGetPrimaryField("hybridse_storage_get_double_field", row_ptr, col_idx, offset, double_ty,
+            return BuildGetPrimaryField(row_ptr, col_idx, offset, double_ty,
                                         output);
         }
         case ::hybridse::node::kTimestamp: {
             NativeValue int64_val;
-            if (!BuildGetPrimaryField("hybridse_storage_get_int64_field", row_ptr, col_idx, offset,
+            if (!BuildGetPrimaryField(row_ptr, col_idx, offset,
                                       builder.getInt64Ty(), &int64_val)) {
                 return false;
             }
@@ -98,7 +99,7 @@ bool BufNativeIRBuilder::BuildGetField(size_t col_idx, ::llvm::Value* row_ptr, :
         }
         case ::hybridse::node::kDate: {
             NativeValue int32_val;
-            if (!BuildGetPrimaryField("hybridse_storage_get_int32_field", row_ptr, col_idx, offset,
+            if (!BuildGetPrimaryField(row_ptr, col_idx, offset,
                                       builder.getInt32Ty(), &int32_val)) {
                 return false;
             }
@@ -128,30 +129,161 @@ bool BufNativeIRBuilder::BuildGetField(size_t col_idx, ::llvm::Value* row_ptr, :
     }
 }
 
-bool BufNativeIRBuilder::BuildGetPrimaryField(const std::string& fn_name, ::llvm::Value* row_ptr, uint32_t col_idx,
-                                              uint32_t offset, ::llvm::Type* type, NativeValue* output) {
+// the fields of a row are not aligned
+static ::llvm::Value* CreateUnalignedLoad(::llvm::IRBuilder<>* builder, ::llvm::Type* type, ::llvm::Value* ptr) {
+    ptr = builder->CreatePointerCast(ptr, type->getPointerTo());
+#if LLVM_VERSION_MAJOR >= 10
+    return builder->CreateAlignedLoad(type, ptr, ::llvm::MaybeAlign(1));
+#else
+    return builder->CreateAlignedLoad(type, ptr, 1);
+#endif
+}
+
+::llvm::Value* BufNativeIRBuilder::BuildLoadableRow(::llvm::IRBuilder<>* builder, ::llvm::Value* row_ptr,
+                                                    uint32_t min_size, ::llvm::Value** row_is_null,
+                                                    ::llvm::Value** null_row) {
+    // share the buffers of a few sizes in the module
+    uint32_t size = 64;
+    while (size < min_size) {
+        size <<= 1;
+    }
+    ::llvm::Module* module = block_->getModule();
+    std::string name = "__hybridse_null_row_" + std::to_string(size);
+    ::llvm::GlobalVariable* global = module->getNamedGlobal(name);
+    if (global == nullptr) {
+        auto array_ty = ::llvm::ArrayType::get(builder->getInt8Ty(), size);
+        global = new ::llvm::GlobalVariable(*module, array_ty, true, ::llvm::GlobalValue::PrivateLinkage,
+                                            ::llvm::ConstantAggregateZero::get(array_ty), name);
+    }
+    ::llvm::Type* i8_ptr_ty = builder->getInt8PtrTy();
+    *null_row = builder->CreatePointerCast(global, i8_ptr_ty);
+    row_ptr = builder->CreatePointerCast(row_ptr, i8_ptr_ty);
+    *row_is_null = builder->CreateIsNull(row_ptr);
+    return builder->CreateSelect(*row_is_null, *null_row, row_ptr);
+}
+
+::llvm::Value* BufNativeIRBuilder::BuildIsNullAt(::llvm::IRBuilder<>* builder, ::llvm::Value* row,
+                                                 ::llvm::Value* row_is_null, uint32_t col_idx) {
+    ::llvm::Value* bitmap_ptr = builder->CreateConstInBoundsGEP1_32(builder->getInt8Ty(), row,
+                                                                    codec::HEADER_LENGTH + (col_idx >> 3));
+    ::llvm::Value* bits = builder->CreateLoad(builder->getInt8Ty(), bitmap_ptr);
+    ::llvm::Value* bit = builder->CreateAnd(bits, builder->getInt8(1 << (col_idx & 0x07)));
+    return builder->CreateOr(row_is_null, builder->CreateIsNotNull(bit));
+}
+
+bool BufNativeIRBuilder::BuildGetPrimaryField(::llvm::Value* row_ptr, uint32_t col_idx, uint32_t offset,
+                                              ::llvm::Type* type, NativeValue* output) {
     if (row_ptr == NULL || type == NULL || output == NULL) {
         LOG(WARNING) << "input args have null ptr";
         return false;
     }
     ::llvm::IRBuilder<> builder(block_);
-    ::llvm::Type* i8_ptr_ty = builder.getInt8PtrTy();
-    ::llvm::Type* i32_ty = builder.getInt32Ty();
-    ::llvm::Value* val_col_idx = builder.getInt32(col_idx);
-    ::llvm::Value* val_offset = builder.getInt32(offset);
-    ::llvm::Value* is_null_alloca = CreateAllocaAtHead(&builder, builder.getInt8Ty(), "is_null_addr");
-    ::llvm::FunctionCallee callee =
-        block_->getModule()->getOrInsertFunction(fn_name, type, i8_ptr_ty, i32_ty, i32_ty, i8_ptr_ty);
-
-    ::llvm::Value* raw = builder.CreateCall(callee, {row_ptr, val_col_idx, val_offset, is_null_alloca});
-    ::llvm::Value* is_null = builder.CreateLoad(is_null_alloca);
+    // bool is stored in a byte
+    ::llvm::Type* load_ty = type->isIntegerTy(1) ? builder.getInt8Ty() : type;
+    uint32_t min_size = std::max(offset + static_cast<uint32_t>(load_ty->getPrimitiveSizeInBits()) / 8,
+                                 static_cast<uint32_t>(codec::HEADER_LENGTH + (col_idx >> 3) + 1));
+    ::llvm::Value* row_is_null = nullptr;
+    ::llvm::Value* null_row = nullptr;
+    ::llvm::Value* row = BuildLoadableRow(&builder, row_ptr, min_size, &row_is_null, &null_row);
+    ::llvm::Value* is_null = BuildIsNullAt(&builder, row, row_is_null, col_idx);
+
+    ::llvm::Value* field_ptr = builder.CreateConstInBoundsGEP1_32(builder.getInt8Ty(), row, offset);
+    ::llvm::Value* raw = CreateUnalignedLoad(&builder, load_ty, field_ptr);
+    if (load_ty != type) {
+        raw = builder.CreateIsNotNull(raw);
+    }
+    raw = builder.CreateSelect(is_null, ::llvm::Constant::getNullValue(type), raw);
     *output = NativeValue::CreateWithFlag(raw, is_null);
     return true;
 }
 
+::llvm::Value* BufNativeIRBuilder::BuildLoadStrOffset(::llvm::IRBuilder<>* builder, ::llvm::Value* offsets,
+                                                      uint32_t str_idx, ::llvm::Value* addr_space) {
+    ::llvm::Type* i32_ty = builder->getInt32Ty();
+    ::llvm::Value* ptr = builder->CreateInBoundsGEP(builder->getInt8Ty(), offsets,
+                                                    builder->CreateMul(builder->getInt32(str_idx), addr_space));
+    // the bytes beyond the width are not loaded, which may be out of the row
+    std::vector<::llvm::Value*> bytes;
+    for (uint32_t i = 0; i < 4; i++) {
+        ::llvm::Value* idx =
+            builder->CreateSelect(builder->CreateICmpUGT(addr_space, builder->getInt32(i)), builder->getInt32(i),
+                                  builder->getInt32(0));
+        ::llvm::Value* byte =
+            builder->CreateLoad(builder->getInt8Ty(), builder->CreateInBoundsGEP(builder->getInt8Ty(), ptr, idx));
+        bytes.push_back(builder->CreateZExt(byte, i32_ty));
+    }
+    auto shl = [&](size_t i, uint64_t bits) { return builder->CreateShl(bytes[i], bits); };
+    // 2 and 4 bytes offsets are little endian, 3 bytes offsets are big endian
+    ::llvm::Value* offset1 = bytes[0];
+    ::llvm::Value* offset2 = builder->CreateOr(bytes[0], shl(1, 8));
+    ::llvm::Value* offset3 = builder->CreateOr(builder->CreateOr(shl(0, 16), shl(1, 8)), bytes[2]);
+    ::llvm::Value* offset4 = builder->CreateOr(offset2, builder->CreateOr(shl(2, 16), shl(3, 24)));
+    ::llvm::Value* offset = builder->CreateSelect(builder->CreateICmpEQ(addr_space, builder->getInt32(3)), offset3,
+                                                  offset4);
+    offset = builder->CreateSelect(builder->CreateICmpEQ(addr_space, builder->getInt32(2)), offset2, offset);
+    return builder->CreateSelect(builder->CreateICmpEQ(addr_space, builder->getInt32(1)), offset1, offset);
+}
+
 bool BufNativeIRBuilder::BuildGetStringField(uint32_t col_idx, uint32_t offset, uint32_t next_str_field_offset,
                                              uint32_t str_start_offset, ::llvm::Value* row_ptr, ::llvm::Value* size,
                                              NativeValue* output) {
+    if (row_ptr == NULL || size == NULL || output == NULL) {
+        LOG(WARNING) << "input args have null ptr";
+        return false;
+    }
+    if (FLAGS_enable_spark_unsaferow_format) {
+        return BuildGetStringFieldByCall(col_idx, offset, next_str_field_offset, str_start_offset, row_ptr, size,
+                                         output);
+    }
+    ::llvm::IRBuilder<> builder(block_);
+    ::llvm::Type* i32_ty = builder.getInt32Ty();
+    uint32_t min_size = std::max(str_start_offset + (std::max(offset, next_str_field_offset) + 1) * 4,
+                                 static_cast<uint32_t>(codec::HEADER_LENGTH + (col_idx >> 3) + 1));
+    ::llvm::Value* row_is_null = nullptr;
+    ::llvm::Value* null_row = nullptr;
+    ::llvm::Value* row = BuildLoadableRow(&builder, row_ptr, min_size, &row_is_null, &null_row);
+    ::llvm::Value* is_null = BuildIsNullAt(&builder, row, row_is_null, col_idx);
+
+    // the width of the string offsets depends on the row size, see codec::v1::GetAddrSpace
+    size = builder.CreateIntCast(size, i32_ty, false);
+    ::llvm::Value* addr_space = builder.CreateSelect(builder.CreateICmpULE(size, builder.getInt32(1 << 24)),
+                                                     builder.getInt32(3), builder.getInt32(4));
+    addr_space = builder.CreateSelect(builder.CreateICmpULE(size, builder.getInt32(UINT16_MAX)), builder.getInt32(2),
+                                      addr_space);
+    addr_space = builder.CreateSelect(builder.CreateICmpULE(size, builder.getInt32(UINT8_MAX)), builder.getInt32(1),
+                                      addr_space);
+    ::llvm::Value* offsets = builder.CreateConstInBoundsGEP1_32(builder.getInt8Ty(), row, str_start_offset);
+    ::llvm::Value* str_offset = BuildLoadStrOffset(&builder, offsets, offset, addr_space);
+    ::llvm::Value* str_end = nullptr;
+    if (next_str_field_offset > 0) {
+        str_end = BuildLoadStrOffset(&builder, offsets, next_str_field_offset, addr_space);
+    } else {
+        str_end = CreateUnalignedLoad(
+            &builder, i32_ty, builder.CreateConstInBoundsGEP1_32(builder.getInt8Ty(), row, codec::VERSION_LENGTH));
+    }
+    // a broken row gets an empty string as the codec does
+    ::llvm::Value* str_size =
+        builder.CreateSelect(builder.CreateOr(is_null, builder.CreateICmpULT(str_end, str_offset)),
+                             builder.getInt32(0), builder.CreateSub(str_end, str_offset));
+    ::llvm::Value* data = builder.CreateSelect(
+        is_null, null_row, builder.CreateInBoundsGEP(builder.getInt8Ty(), row, str_offset));
+
+    codegen::StringIRBuilder string_ir_builder(block_->getModule());
+    ::llvm::Value* string_ref;
+    if (!string_ir_builder.NewString(block_, &string_ref)) {
+        LOG(WARNING) << "fail to initialize string ref";
+        return false;
+    }
+    builder.CreateStore(str_size, builder.CreateStructGEP(string_ir_builder.GetType(), string_ref, 0));
+    builder.CreateStore(data, builder.CreateStructGEP(string_ir_builder.GetType(), string_ref, 1));
+    *output = NativeValue::CreateWithFlag(string_ref, is_null);
+    return true;
+}
+
+bool BufNativeIRBuilder::BuildGetStringFieldByCall(uint32_t col_idx, uint32_t offset,
+                                                   uint32_t next_str_field_offset, uint32_t str_start_offset,
+                                                   ::llvm::Value* row_ptr, ::llvm::Value* size,
+                                                   NativeValue* output) {
     base::Status status;
     if (row_ptr == NULL || size == NULL || output == NULL) {
         LOG(WARNING) << "input args have null ptr";
@@ -454,18 +586,25 @@ bool BufNativeEncoderIRBuilder::AppendPrimary(::llvm::Value* i8_ptr, const Nativ
     ::llvm::IRBuilder<> builder(block_);
     ::llvm::Value* offset = builder.getInt32(field_offset);
     if (val.IsNullable()) {
-        ::llvm::Type* size_ty = builder.getInt32Ty();
-        ::llvm::Type* i8_ty = builder.getInt8Ty();
-        ::llvm::Type* i8_ptr_ty = builder.getInt8PtrTy();
-        ::llvm::Type* void_ty = builder.getVoidTy();
-        auto callee = block_->getModule()->getOrInsertFunction("hybridse_storage_encode_nullbit", void_ty, i8_ptr_ty,
-                                                               size_ty, i8_ty);
-        builder.CreateCall(
-            callee, {i8_ptr, builder.getInt32(field_idx), builder.CreateIntCast(val.GetIsNull(&builder), i8_ty, true)});
+        BuildSetNullAt(&builder, i8_ptr, field_idx, val.GetIsNull(&builder));
     }
     return BuildStoreOffset(builder, i8_ptr, offset, val.GetValue(&builder));
 }
 
+void BufNativeEncoderIRBuilder::BuildSetNullAt(::llvm::IRBuilder<>* builder, ::llvm::Value* i8_ptr,
+                                               uint32_t field_idx, ::llvm::Value* is_null) {
+    // straight-line code instead of the call of hybridse_storage_encode_nullbit, so the null flags computed by
+    // the bitwise ops of the expressions are stored without a branch or a call
+    ::llvm::Type* i8_ty = builder->getInt8Ty();
+    uint8_t mask = 1 << (field_idx & 0x07);
+    ::llvm::Value* bitmap_ptr =
+        builder->CreateConstInBoundsGEP1_32(i8_ty, i8_ptr, codec::HEADER_LENGTH + (field_idx >> 3));
+    ::llvm::Value* bits = builder->CreateLoad(i8_ty, bitmap_ptr);
+    ::llvm::Value* null_bit = builder->CreateShl(builder->CreateZExt(is_null, i8_ty), field_idx & 0x07);
+    bits = builder->CreateOr(builder->CreateAnd(bits, builder->getInt8(static_cast<uint8_t>(~mask))), null_bit);
+    builder->CreateStore(bits, bitmap_ptr);
+}
+
 bool BufNativeEncoderIRBuilder::AppendHeader(::llvm::Value* i8_ptr, ::llvm::Value* size, ::llvm::Value* bitmap_size) {
     ::llvm::IRBuilder<> builder(block_);
     ::llvm::Value* fversion = builder.getInt8(1);
@@ -52,6 +52,9 @@ class BufNativeEncoderIRBuilder : public RowEncodeIRBuilder {
     bool CalcStrBodyStart(::llvm::Value** output, ::llvm::Value* str_add_space);
     bool AppendPrimary(::llvm::Value* i8_ptr, const NativeValue& val,
                        size_t field_idx, uint32_t field_offset);
+    // set the null bit of the field by the bitwise ops on the bitmap byte
+    void BuildSetNullAt(::llvm::IRBuilder<>* builder, ::llvm::Value* i8_ptr,
+                        uint32_t field_idx, ::llvm::Value* is_null);
 
     bool AppendString(::llvm::Value* i8_ptr, ::llvm::Value* buf_size,
                       uint32_t field_idx, const NativeValue& str_val,
@@ -81,14 +84,36 @@ class BufNativeIRBuilder : public RowDecodeIRBuilder {
                        ::llvm::Value* row_size, NativeValue* output);
 
  private:
-    bool BuildGetPrimaryField(const std::string& fn_name,
-                              ::llvm::Value* row_ptr, uint32_t col_idx,
+    bool BuildGetPrimaryField(::llvm::Value* row_ptr, uint32_t col_idx,
                               uint32_t offset, ::llvm::Type* type,
                               NativeValue* output);
     bool BuildGetStringField(uint32_t col_idx, uint32_t offset,
                              uint32_t next_str_field_offset,
                              uint32_t str_start_offset, ::llvm::Value* row_ptr,
                              ::llvm::Value* size, NativeValue* output);
+    // read the string field by calling the codec, used by the spark
+    // unsaferow format
+    bool BuildGetStringFieldByCall(uint32_t col_idx, uint32_t offset,
+                                   uint32_t next_str_field_offset,
+                                   uint32_t str_start_offset,
+                                   ::llvm::Value* row_ptr, ::llvm::Value* size,
+                                   NativeValue* output);
+
+    // Return the row to load the fields from, which is a zeroed constant
+    // buffer of at least `min_size` bytes if the row is null, so that the
+    // loads need no branch. `null_row` is set to the constant buffer.
+    ::llvm::Value* BuildLoadableRow(::llvm::IRBuilder<>* builder,
+                                    ::llvm::Value* row_ptr, uint32_t min_size,
+                                    ::llvm::Value** row_is_null,
+                                    ::llvm::Value** null_row);
+    ::llvm::Value* BuildIsNullAt(::llvm::IRBuilder<>* builder,
+                                 ::llvm::Value* row, ::llvm::Value* row_is_null,
+                                 uint32_t col_idx);
+    // load the offset of the string field `str_idx` whose width is
+    // `addr_space` bytes from the string offsets starting at `offsets`
+    ::llvm::Value* BuildLoadStrOffset(::llvm::IRBuilder<>* builder,
+                                      ::llvm::Value* offsets, uint32_t str_idx,
+                                      ::llvm::Value* addr_space);
 
  private:
     ::llvm::BasicBlock* block_;
@@ -18,6 +18,8 @@
 #include <stdio.h>
 #include <cstdlib>
 #include <memory>
+#include <string>
+#include <utility>
 #include <vector>
 #include "case/sql_case.h"
 #include "codec/fe_row_codec.h"
@@ -505,6 +507,53 @@ TEST_F(BufIRBuilderTest, native_test_load_string) {
     free(ptr);
 }
 
+TEST_F(BufIRBuilderTest, native_test_load_wide_string) {
+    type::TableDef table;
+    std::vector<std::pair<std::string, type::Type>> columns = {{"col0", type::kInt32},
+                                                               {"col1", type::kVarchar},
+                                                               {"col2", type::kVarchar},
+                                                               {"col3", type::kVarchar},
+                                                               {"col4", type::kInt64}};
+    for (auto& column : columns) {
+        auto column_def = table.add_columns();
+        column_def->set_name(column.first);
+        column_def->set_type(column.second);
+    }
+    // the string offsets take 1, 2 and 3 bytes
+    for (uint32_t str_size : {10, 300, 70000}) {
+        std::string str(str_size, 'a');
+        codec::RowBuilder row_builder(table.columns());
+        uint32_t size = row_builder.CalTotalLength(str_size + 3);
+        int8_t* ptr = static_cast<int8_t*>(malloc(size));
+        ASSERT_TRUE(row_builder.SetBuffer(ptr, size));
+        ASSERT_TRUE(row_builder.AppendInt32(32));
+        ASSERT_TRUE(row_builder.AppendString(str.c_str(), str_size));
+        ASSERT_TRUE(row_builder.AppendNULL());
+        ASSERT_TRUE(row_builder.AppendString("end", 3));
+        ASSERT_TRUE(row_builder.AppendInt64(64));
+
+        RunCaseV1<int32_t>(32, table, type::kInt32, "col0", ptr, size);
+        RunCaseV1<codec::StringRef>(codec::StringRef(str), table, type::kVarchar, "col1", ptr, size);
+        RunCaseV1<codec::StringRef>(codec::StringRef("end"), table, type::kVarchar, "col3", ptr, size);
+        RunCaseV1<int64_t>(64, table, type::kInt64, "col4", ptr, size);
+        codec::StringRef result;
+        bool is_null = false;
+        LoadValue(&result, &is_null, table, type::kVarchar, "col2", ptr, size);
+        ASSERT_TRUE(is_null);
+        free(ptr);
+    }
+
+    // a null row
+    int32_t int_result;
+    codec::StringRef str_result;
+    bool is_null = false;
+    LoadValue(&int_result, &is_null, table, type::kInt32, "col0", nullptr, 0);
+    ASSERT_TRUE(is_null);
+    is_null = false;
+    LoadValue(&str_result, &is_null, table, type::kVarchar, "col3", nullptr, 0);
+    ASSERT_TRUE(is_null);
+}
+
 TEST_F(BufIRBuilderTest, encode_ir_builder) {
     int8_t* ptr = NULL;
     type::TableDef table;
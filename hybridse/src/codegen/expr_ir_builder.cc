@@ -776,6 +776,11 @@ Status ExprIRBuilder::BuildBinaryExpr(const ::hybridse::node::BinaryExpr* node,
             CHECK_STATUS(BuildAsUdf(node, "at", {left, right}, output));
             break;
         }
+        case ::hybridse::node::kFnOpLike: {
+            CHECK_STATUS(
+                BuildAsUdf(node, "like_match", {left, right}, output));
+            break;
+        }
         default: {
             return Status(kCodegenError,
                           "Invalid op " + ExprOpTypeName(node->GetOp()));
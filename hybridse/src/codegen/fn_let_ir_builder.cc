@@ -111,8 +111,8 @@ Status RowFnLetIRBuilder::Build(
 
         if (agg_iter == window_agg_builder.end()) {
             window_agg_builder.insert(std::make_pair(
-                frame_str, AggregateIRBuilder(ctx_->schemas_context(), module,
-                                              frame, agg_builder_id++)));
+                frame_str,
+                AggregateIRBuilder(ctx_, frame, agg_builder_id++)));
             agg_iter = window_agg_builder.find(frame_str);
         }
         if (agg_iter->second.CollectAggColumn(expr, i, &col_agg_type)) {
@@ -688,6 +688,25 @@ TEST_F(UdfIRBuilderTest, strcmp_udf_test) {
         "strcmp", nullptr, nullptr, StringRef(""));
 }
 
+TEST_F(UdfIRBuilderTest, like_match_udf_test) {
+    CheckUdf<bool, StringRef, StringRef>("like_match", true,
+                                         StringRef("hybridse"),
+                                         StringRef("hy%se"));
+    CheckUdf<bool, StringRef, StringRef>("like_match", false,
+                                         StringRef("hybridse"),
+                                         StringRef("hy_e%"));
+    CheckUdf<bool, StringRef, StringRef>("like_match", true,
+                                         StringRef("50%"), StringRef("50\\%"));
+    CheckUdf<bool, StringRef, StringRef>("like_match", false,
+                                         StringRef("HybridSE"),
+                                         StringRef("%bridse"));
+    CheckUdf<bool, StringRef, StringRef>("ilike_match", true,
+                                         StringRef("HybridSE"),
+                                         StringRef("%bridse"));
+    CheckUdf<Nullable<bool>, Nullable<StringRef>, Nullable<StringRef>>(
+        "like_match", nullptr, nullptr, StringRef("%"));
+}
+
 TEST_F(UdfIRBuilderTest, null_process_test) {
     CheckUdf<bool, Nullable<double>>("is_null", true, nullptr);
     CheckUdf<bool, Nullable<double>>("is_null", false, 1.0);
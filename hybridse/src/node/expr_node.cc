@@ -617,6 +617,10 @@ Status BinaryExpr::InferAttr(ExprAnalysisContext* ctx) {
             return ctx->InferAsUdf(this, "at");
             break;
         }
+        case kFnOpLike: {
+            return ctx->InferAsUdf(this, "like_match");
+            break;
+        }
         default:
             return Status(common::kTypeError,
                           "Unknown binary op type: " + ExprOpTypeName(GetOp()));
@@ -883,10 +887,12 @@ ExternalFnDefNode* ExternalFnDefNode::ShadowCopy(NodeManager* nm) const {
 
 ExternalFnDefNode* ExternalFnDefNode::DeepCopy(NodeManager* nm) const {
     if (IsResolved()) {
-        return nm->MakeExternalFnDefNode(function_name(), function_ptr(),
-                                         GetReturnType(), IsReturnNullable(),
-                                         arg_types_, arg_nullable_,
-                                         variadic_pos(), return_by_arg());
+        auto def = nm->MakeExternalFnDefNode(
+            function_name(), function_ptr(), GetReturnType(),
+            IsReturnNullable(), arg_types_, arg_nullable_, variadic_pos(),
+            return_by_arg());
+        def->SetDeterministic(deterministic());
+        return def;
     } else {
         return nm->MakeUnresolvedFnDefNode(function_name());
     }
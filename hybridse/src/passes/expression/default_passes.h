@@ -19,7 +19,9 @@
 
 #include <memory>
 
+#include "passes/expression/fold_const_calls.h"
 #include "passes/expression/merge_aggregations.h"
+#include "passes/expression/merge_common_exprs.h"
 #include "passes/expression/simplify.h"
 #include "passes/resolve_fn_and_attrs.h"
 
@@ -30,6 +32,8 @@ void AddDefaultExprOptPasses(node::ExprAnalysisContext* ctx,
                              ExprPassGroup* group) {
     group->AddPass(std::make_shared<passes::MergeAggregations>());
     group->AddPass(std::make_shared<passes::ExprSimplifier>());
+    group->AddPass(std::make_shared<passes::FoldConstCalls>());
+    group->AddPass(std::make_shared<passes::MergeCommonExprs>());
     group->AddPass(std::make_shared<passes::ResolveFnAndAttrs>(ctx));
 }
 
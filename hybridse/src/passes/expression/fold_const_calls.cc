@@ -0,0 +1,322 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "passes/expression/fold_const_calls.h"
+
+#include <string>
+#include <vector>
+
+#include "codec/type_codec.h"
+#include "node/node_manager.h"
+#include "vm/jit_runtime.h"
+
+namespace hybridse {
+namespace passes {
+
+namespace {
+
+// an arg of the external function as it is passed by the codegen: the
+// numbers by value and the structs by pointer
+struct CArg {
+    enum Kind { kInt32, kInt64, kFloat, kDouble, kPtr };
+    Kind kind = kInt32;
+    int32_t i32 = 0;
+    int64_t i64 = 0;
+    float f = 0;
+    double d = 0;
+    codec::Timestamp ts;
+    codec::Date date;
+    codec::StringRef str;
+    void* ptr = nullptr;
+};
+
+struct COutput {
+    bool b = false;
+    int16_t i16 = 0;
+    int32_t i32 = 0;
+    int64_t i64 = 0;
+    float f = 0;
+    double d = 0;
+    codec::Timestamp ts;
+    codec::Date date;
+    codec::StringRef str;
+    bool is_null = false;
+};
+
+struct CCall {
+    void* fn = nullptr;
+    node::DataType ret = node::kNull;
+    bool return_by_arg = false;
+    bool ret_nullable = false;
+    std::vector<CArg> args;
+};
+
+void* OutputPtr(node::DataType type, COutput* out) {
+    switch (type) {
+        case node::kBool:
+            return &out->b;
+        case node::kInt16:
+            return &out->i16;
+        case node::kInt32:
+            return &out->i32;
+        case node::kInt64:
+            return &out->i64;
+        case node::kFloat:
+            return &out->f;
+        case node::kDouble:
+            return &out->d;
+        case node::kTimestamp:
+            return &out->ts;
+        case node::kDate:
+            return &out->date;
+        case node::kVarchar:
+            return &out->str;
+        default:
+            return nullptr;
+    }
+}
+
+template <typename Ret, typename... Ts>
+Ret CallAs(void* fn, Ts... args) {
+    return reinterpret_cast<Ret (*)(Ts...)>(fn)(args...);
+}
+
+template <typename... Ts>
+bool CallWith(const CCall& call, COutput* out, Ts... args) {
+    if (call.return_by_arg) {
+        void* ptr = OutputPtr(call.ret, out);
+        if (ptr == nullptr) {
+            return false;
+        }
+        if (call.ret_nullable) {
+            CallAs<void, Ts..., void*, bool*>(call.fn, args..., ptr,
+                                              &out->is_null);
+        } else {
+            CallAs<void, Ts..., void*>(call.fn, args..., ptr);
+        }
+        return true;
+    }
+    // the struct outputs are always returned by arg
+    switch (call.ret) {
+        case node::kBool:
+            out->b = CallAs<bool, Ts...>(call.fn, args...);
+            return true;
+        case node::kInt16:
+            out->i16 = CallAs<int16_t, Ts...>(call.fn, args...);
+            return true;
+        case node::kInt32:
+            out->i32 = CallAs<int32_t, Ts...>(call.fn, args...);
+            return true;
+        case node::kInt64:
+            out->i64 = CallAs<int64_t, Ts...>(call.fn, args...);
+            return true;
+        case node::kFloat:
+            out->f = CallAs<float, Ts...>(call.fn, args...);
+            return true;
+        case node::kDouble:
+            out->d = CallAs<double, Ts...>(call.fn, args...);
+            return true;
+        default:
+            return false;
+    }
+}
+
+// builds the c signature of the call one arg a time, kDepth is the number
+// of the args still allowed
+template <size_t kDepth, typename... Ts>
+struct Invoker {
+    static bool Invoke(const CCall& call, COutput* out, Ts... args) {
+        size_t idx = sizeof...(Ts);
+        if (idx == call.args.size()) {
+            return CallWith<Ts...>(call, out, args...);
+        }
+        const CArg& arg = call.args[idx];
+        switch (arg.kind) {
+            case CArg::kInt32:
+                return Invoker<kDepth - 1, Ts..., int32_t>::Invoke(
+                    call, out, args..., arg.i32);
+            case CArg::kInt64:
+                return Invoker<kDepth - 1, Ts..., int64_t>::Invoke(
+                    call, out, args..., arg.i64);
+            case CArg::kFloat:
+                return Invoker<kDepth - 1, Ts..., float>::Invoke(
+                    call, out, args..., arg.f);
+            case CArg::kDouble:
+                return Invoker<kDepth - 1, Ts..., double>::Invoke(
+                    call, out, args..., arg.d);
+            case CArg::kPtr:
+                return Invoker<kDepth - 1, Ts..., void*>::Invoke(
+                    call, out, args..., arg.ptr);
+            default:
+                return false;
+        }
+    }
+};
+
+template <typename... Ts>
+struct Invoker<0, Ts...> {
+    static bool Invoke(const CCall& call, COutput* out, Ts... args) {
+        if (sizeof...(Ts) != call.args.size()) {
+            return false;
+        }
+        return CallWith<Ts...>(call, out, args...);
+    }
+};
+
+bool ToCArg(const node::TypeNode* type, const node::ConstNode* value,
+            CArg* arg) {
+    if (type == nullptr || type->GetGenericSize() > 0 ||
+        type->base() != value->GetDataType()) {
+        return false;
+    }
+    switch (type->base()) {
+        case node::kInt32:
+            arg->kind = CArg::kInt32;
+            arg->i32 = value->GetInt();
+            return true;
+        case node::kInt64:
+            arg->kind = CArg::kInt64;
+            arg->i64 = value->GetLong();
+            return true;
+        case node::kFloat:
+            arg->kind = CArg::kFloat;
+            arg->f = value->GetFloat();
+            return true;
+        case node::kDouble:
+            arg->kind = CArg::kDouble;
+            arg->d = value->GetDouble();
+            return true;
+        case node::kTimestamp:
+            arg->kind = CArg::kPtr;
+            arg->ts.ts_ = value->GetLong();
+            return true;
+        case node::kDate:
+            arg->kind = CArg::kPtr;
+            arg->date.date_ = static_cast<int32_t>(value->GetLong());
+            return true;
+        case node::kVarchar:
+            arg->kind = CArg::kPtr;
+            arg->str = codec::StringRef(value->GetStr());
+            return true;
+        default:
+            return false;
+    }
+}
+
+node::ConstNode* ToConstNode(node::NodeManager* nm, node::DataType type,
+                             const COutput& out) {
+    switch (type) {
+        case node::kBool:
+            return nm->MakeConstNode(out.b);
+        case node::kInt16:
+            return nm->MakeConstNode(out.i16);
+        case node::kInt32:
+            return nm->MakeConstNode(out.i32);
+        case node::kInt64:
+            return nm->MakeConstNode(out.i64);
+        case node::kFloat:
+            return nm->MakeConstNode(out.f);
+        case node::kDouble:
+            return nm->MakeConstNode(out.d);
+        case node::kTimestamp:
+            return nm->MakeConstNode(out.ts.ts_, node::kTimestamp);
+        case node::kDate:
+            return nm->MakeConstNode(static_cast<int64_t>(out.date.date_),
+                                     node::kDate);
+        case node::kVarchar: {
+            // the string constant is kept as a c string
+            std::string str = out.str.ToString();
+            if (out.str.IsNull() || str.find('\0') != std::string::npos) {
+                return nullptr;
+            }
+            return nm->MakeConstNode(str);
+        }
+        default:
+            return nullptr;
+    }
+}
+
+}  // namespace
+
+Status FoldConstCalls::VisitCall(node::CallExprNode* call, ExprNode** out) {
+    *out = call;
+    auto fn = dynamic_cast<node::ExternalFnDefNode*>(call->GetFnDef());
+    if (fn == nullptr || !fn->IsResolved() || !fn->deterministic() ||
+        fn->function_ptr() == nullptr || fn->variadic_pos() >= 0 ||
+        fn->GetArgSize() != call->GetChildNum() ||
+        call->GetChildNum() > kMaxArgs) {
+        return Status::OK();
+    }
+    if (!fn->return_by_arg() && fn->IsReturnNullable()) {
+        return Status::OK();
+    }
+    CCall c_call;
+    c_call.fn = fn->function_ptr();
+    c_call.ret = fn->GetReturnType()->base();
+    c_call.return_by_arg = fn->return_by_arg();
+    c_call.ret_nullable = fn->IsReturnNullable();
+    c_call.args.resize(call->GetChildNum());
+    for (size_t i = 0; i < call->GetChildNum(); ++i) {
+        auto child = call->GetChild(i);
+        if (child->GetExprType() != node::kExprPrimary ||
+            fn->IsArgNullable(i)) {
+            return Status::OK();
+        }
+        auto value = dynamic_cast<node::ConstNode*>(child);
+        if (value->IsNull() ||
+            !ToCArg(fn->GetArgType(i), value, &c_call.args[i])) {
+            return Status::OK();
+        }
+    }
+    // the args are not moved any more, point to the structs
+    for (size_t i = 0; i < c_call.args.size(); ++i) {
+        CArg& arg = c_call.args[i];
+        switch (fn->GetArgType(i)->base()) {
+            case node::kTimestamp:
+                arg.ptr = &arg.ts;
+                break;
+            case node::kDate:
+                arg.ptr = &arg.date;
+                break;
+            case node::kVarchar:
+                arg.ptr = &arg.str;
+                break;
+            default:
+                break;
+        }
+    }
+
+    // the outputs of the string functions are allocated by the runtime, copy
+    // them out before the release
+    COutput c_out;
+    auto runtime = vm::JitRuntime::get();
+    runtime->InitRunStep();
+    bool done = Invoker<kMaxArgs>::Invoke(c_call, &c_out);
+    node::ConstNode* output = nullptr;
+    if (done && !c_out.is_null) {
+        output = ToConstNode(ctx()->node_manager(), c_call.ret, c_out);
+    }
+    runtime->ReleaseRunStep();
+    if (output == nullptr) {
+        return Status::OK();
+    }
+    CHECK_STATUS(output->InferAttr(ctx()));
+    *out = output;
+    return Status::OK();
+}
+
+}  // namespace passes
+}  // namespace hybridse
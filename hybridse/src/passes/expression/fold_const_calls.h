@@ -0,0 +1,43 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_PASSES_EXPRESSION_FOLD_CONST_CALLS_H_
+#define SRC_PASSES_EXPRESSION_FOLD_CONST_CALLS_H_
+
+#include "passes/expression/simplify.h"
+
+namespace hybridse {
+namespace passes {
+
+/**
+ * Run the calls to the deterministic external functions on the constant
+ * args at compile time, and replace the calls by the constant outputs, eg,
+ * `date_format(timestamp("2020-05-22"), "%Y")` becomes "2020". The calls are
+ * folded bottom up, so the nested calls on the constants are folded too.
+ *
+ * The calls are kept if the function takes more than kMaxArgs args, takes
+ * a nullable or variadic arg, or returns null.
+ */
+class FoldConstCalls : public ExprInplaceTransformUp {
+ public:
+    static const size_t kMaxArgs = 3;
+
+    Status VisitCall(node::CallExprNode*, ExprNode**) override;
+};
+
+}  // namespace passes
+}  // namespace hybridse
+#endif  // SRC_PASSES_EXPRESSION_FOLD_CONST_CALLS_H_
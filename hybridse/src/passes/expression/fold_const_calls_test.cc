@@ -0,0 +1,85 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "passes/expression/fold_const_calls.h"
+#include "passes/expression/expr_pass_test.h"
+#include "udf/literal_traits.h"
+
+namespace hybridse {
+namespace passes {
+
+class FoldConstCallsTest : public ExprPassTestBase {};
+
+static const node::ConstNode* AsConst(const node::ExprNode* expr) {
+    if (expr->GetExprType() != node::kExprPrimary) {
+        return nullptr;
+    }
+    return dynamic_cast<const node::ConstNode*>(expr);
+}
+
+TEST_F(FoldConstCallsTest, Test) {
+    auto schema = udf::MakeLiteralSchema<int32_t, codec::StringRef>();
+    schemas_ctx_.BuildTrivial({&schema});
+
+    std::string sql =
+        "select substring(\"hello world\", 3, 6), "
+        "strcmp(\"text\", \"text1\"), "
+        "date_format(timestamp(\"2020-05-22 10:43:40\"), \"%Y-%m-%d\"), "
+        "date(\"2020-05-22\"), "
+        "substring(col_1, 3, 6), "
+        "timestamp(\"not a time\") from t1;";
+    node::LambdaNode* function_let = nullptr;
+    InitFunctionLet(sql, &function_let);
+
+    FoldConstCalls pass;
+    node::ExprNode* output = nullptr;
+    Status status = ApplyPass(&pass, function_let, &output);
+    ASSERT_TRUE(status.isOK()) << status;
+    ASSERT_EQ(6u, output->GetChildNum());
+
+    auto substr = AsConst(output->GetChild(0));
+    ASSERT_TRUE(substr != nullptr);
+    ASSERT_EQ(node::kVarchar, substr->GetDataType());
+    ASSERT_EQ("llo wo", std::string(substr->GetStr()));
+
+    auto cmp = AsConst(output->GetChild(1));
+    ASSERT_TRUE(cmp != nullptr);
+    ASSERT_EQ(node::kInt32, cmp->GetDataType());
+    ASSERT_EQ(-1, cmp->GetInt());
+
+    // the nested calls are folded bottom up
+    auto date_str = AsConst(output->GetChild(2));
+    ASSERT_TRUE(date_str != nullptr);
+    ASSERT_EQ("2020-05-22", std::string(date_str->GetStr()));
+
+    auto date = AsConst(output->GetChild(3));
+    ASSERT_TRUE(date != nullptr);
+    ASSERT_EQ(node::kDate, date->GetDataType());
+    ASSERT_EQ(codec::Date(2020, 5, 22).date_, date->GetLong());
+
+    // the calls on the columns and the null outputs are kept
+    ASSERT_EQ(node::kExprCall, output->GetChild(4)->GetExprType());
+    ASSERT_EQ(node::kExprCall, output->GetChild(5)->GetExprType());
+}
+
+}  // namespace passes
+}  // namespace hybridse
+
+int main(int argc, char** argv) {
+    ::testing::GTEST_FLAG(color) = "yes";
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,92 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "passes/expression/merge_common_exprs.h"
+
+namespace hybridse {
+namespace passes {
+
+Status MergeCommonExprs::Apply(ExprAnalysisContext* ctx, ExprNode* expr,
+                               ExprNode** out) {
+    merged_.clear();
+    buckets_.clear();
+    *out = DoApply(expr);
+    return Status::OK();
+}
+
+bool MergeCommonExprs::IsCandidate(const ExprNode* expr) {
+    // the leaves are cheap, and the other kinds do not compare all of their
+    // attributes in Equals
+    switch (expr->GetExprType()) {
+        case node::kExprCall:
+        case node::kExprBinary:
+        case node::kExprUnary:
+        case node::kExprCast:
+        case node::kExprGetField:
+        case node::kExprCond:
+        case node::kExprBetween:
+            return expr->GetChildNum() > 0 && expr->GetOutputType() != nullptr;
+        default:
+            return false;
+    }
+}
+
+ExprNode* MergeCommonExprs::DoApply(ExprNode* expr) {
+    auto iter = merged_.find(expr->node_id());
+    if (iter != merged_.end()) {
+        return iter->second;
+    }
+    // merge the children first, so the equal expressions have the same
+    // children and are found by them
+    for (size_t i = 0; i < expr->GetChildNum(); ++i) {
+        ExprNode* child = expr->GetChild(i);
+        if (child == nullptr) {
+            continue;
+        }
+        ExprNode* merged_child = DoApply(child);
+        if (merged_child != child) {
+            expr->SetChild(i, merged_child);
+        }
+    }
+    ExprNode* output = expr;
+    if (IsCandidate(expr)) {
+        std::string key = std::to_string(expr->GetExprType());
+        for (size_t i = 0; i < expr->GetChildNum(); ++i) {
+            key.append(",");
+            key.append(expr->GetChild(i) == nullptr
+                           ? "null"
+                           : std::to_string(expr->GetChild(i)->node_id()));
+        }
+        auto& bucket = buckets_[key];
+        for (auto candidate : bucket) {
+            if (candidate->nullable() == expr->nullable() &&
+                node::TypeEquals(candidate->GetOutputType(),
+                                 expr->GetOutputType()) &&
+                candidate->Equals(expr)) {
+                output = candidate;
+                break;
+            }
+        }
+        if (output == expr) {
+            bucket.push_back(expr);
+        }
+    }
+    merged_[expr->node_id()] = output;
+    return output;
+}
+
+}  // namespace passes
+}  // namespace hybridse
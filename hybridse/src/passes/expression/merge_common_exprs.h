@@ -0,0 +1,55 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_PASSES_EXPRESSION_MERGE_COMMON_EXPRS_H_
+#define SRC_PASSES_EXPRESSION_MERGE_COMMON_EXPRS_H_
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "passes/expression/expr_pass.h"
+
+namespace hybridse {
+namespace passes {
+
+using base::Status;
+using node::ExprAnalysisContext;
+using node::ExprNode;
+
+/**
+ * Merge the equal sub expressions of the expression, e.g. the projects of a
+ * frame, into one node. The codegen caches the value of an expression node,
+ * so a sub expression shared by the projects is computed once per row.
+ */
+class MergeCommonExprs : public passes::ExprPass {
+ public:
+    Status Apply(ExprAnalysisContext* ctx, ExprNode* expr,
+                 ExprNode** out) override;
+
+ private:
+    ExprNode* DoApply(ExprNode* expr);
+    static bool IsCandidate(const ExprNode* expr);
+
+    // node id -> merged node
+    std::unordered_map<size_t, ExprNode*> merged_;
+    // expr type and child node ids -> merged nodes
+    std::unordered_map<std::string, std::vector<ExprNode*>> buckets_;
+};
+
+}  // namespace passes
+}  // namespace hybridse
+#endif  // SRC_PASSES_EXPRESSION_MERGE_COMMON_EXPRS_H_
@@ -0,0 +1,66 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "passes/expression/merge_common_exprs.h"
+#include "passes/expression/expr_pass_test.h"
+#include "udf/literal_traits.h"
+
+namespace hybridse {
+namespace passes {
+
+class MergeCommonExprsTest : public ExprPassTestBase {};
+
+TEST_F(MergeCommonExprsTest, Test) {
+    auto schema = udf::MakeLiteralSchema<int32_t, float, double, int64_t>();
+    schemas_ctx_.BuildTrivial({&schema});
+
+    std::string sql =
+        "select log(col_0 + 1) + 1, log(col_0 + 1) * 2, log(col_0 + 2), "
+        "substr(string(col_3), 1, 3), substr(string(col_3), 1, 3), "
+        "col_1 + 1, col_2 + 1 from t1;";
+    node::LambdaNode* function_let = nullptr;
+    InitFunctionLet(sql, &function_let);
+
+    MergeCommonExprs pass;
+    node::ExprNode* output = nullptr;
+    Status status = ApplyPass(&pass, function_let, &output);
+    ASSERT_TRUE(status.isOK()) << status;
+    ASSERT_EQ(7u, output->GetChildNum());
+
+    // log(col_0 + 1) is shared by the first two projects
+    auto log_0 = output->GetChild(0)->GetChild(0);
+    auto log_1 = output->GetChild(1)->GetChild(0);
+    ASSERT_EQ(node::kExprCall, log_0->GetExprType());
+    ASSERT_EQ(log_0, log_1);
+
+    // col_0 + 1 is not col_0 + 2
+    ASSERT_NE(log_0, output->GetChild(2));
+
+    // the equal projects are one node
+    ASSERT_EQ(output->GetChild(3), output->GetChild(4));
+
+    // the same op on the other columns
+    ASSERT_NE(output->GetChild(5), output->GetChild(6));
+}
+
+}  // namespace passes
+}  // namespace hybridse
+
+int main(int argc, char** argv) {
+    ::testing::GTEST_FLAG(color) = "yes";
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -57,6 +57,9 @@ class ExprInplaceTransformUp : public ExprPass {
                              const std::vector<node::ExprAttrNode>&,
                              node::FnDefNode**);
 
+ protected:
+    ExprAnalysisContext* ctx() const { return ctx_; }
+
  private:
     ExprAnalysisContext* ctx_;
     std::map<size_t, ExprNode*> cache_;
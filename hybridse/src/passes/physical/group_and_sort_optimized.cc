@@ -481,6 +481,28 @@ bool GroupAndSortOptimized::TransformKeysAndOrderExpr(
     return true;
 }
 
+// The index with fewer rows of a key is better as fewer rows are scanned by
+// a window on it. The index with more keys is taken as better if the
+// statistics of the data are unknown
+bool GroupAndSortOptimized::IsBetterIndex(
+    std::shared_ptr<TableHandler> table_handler, const IndexSt& org_index,
+    const IndexSt& new_index) {
+    IndexStats org_stats;
+    IndexStats new_stats;
+    if (table_handler->GetIndexStats(org_index.name, &org_stats) &&
+        table_handler->GetIndexStats(new_index.name, &new_stats) &&
+        org_stats.pk_cnt > 0 && new_stats.pk_cnt > 0) {
+        double org_rows = static_cast<double>(org_stats.row_cnt) /
+                          static_cast<double>(org_stats.pk_cnt);
+        double new_rows = static_cast<double>(new_stats.row_cnt) /
+                          static_cast<double>(new_stats.pk_cnt);
+        if (org_rows != new_rows) {
+            return new_rows < org_rows;
+        }
+    }
+    return org_index.keys.size() < new_index.keys.size();
+}
+
 bool GroupAndSortOptimized::MatchBestIndex(
     const std::vector<std::string>& columns,
     const std::vector<std::string>& order_columns,
@@ -556,7 +578,7 @@ bool GroupAndSortOptimized::MatchBestIndex(
                 } else {
                     auto org_index = index_hint.at(best_index_name);
                     auto new_index = index_hint.at(name);
-                    if (org_index.keys.size() < new_index.keys.size()) {
+                    if (IsBetterIndex(table_handler, org_index, new_index)) {
                         best_index_name = name;
                         best_index_bitmap = sub_best_bitmap;
                     }
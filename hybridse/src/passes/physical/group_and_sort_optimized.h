@@ -26,6 +26,7 @@ namespace passes {
 using codec::Schema;
 using hybridse::vm::Filter;
 using hybridse::vm::IndexSt;
+using hybridse::vm::IndexStats;
 using hybridse::vm::Join;
 using hybridse::vm::Key;
 using hybridse::vm::SchemasContext;
@@ -91,6 +92,9 @@ class GroupAndSortOptimized : public TransformUpPysicalPass {
                         std::shared_ptr<TableHandler> table_handler,
                         std::vector<bool>* bitmap, std::string* index_name,
                         std::vector<bool>* best_bitmap);  // NOLINT
+    static bool IsBetterIndex(std::shared_ptr<TableHandler> table_handler,
+                              const IndexSt& org_index,
+                              const IndexSt& new_index);
 };
 }  // namespace passes
 }  // namespace hybridse
@@ -0,0 +1,380 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "plan/literal_parameterizer.h"
+#include <cctype>
+#include <cerrno>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <set>
+#include <vector>
+#include "base/fe_slice.h"
+
+namespace hybridse {
+namespace plan {
+
+namespace {
+
+enum TokenKind {
+    kTokenIdent,
+    kTokenQuotedIdent,
+    kTokenString,
+    kTokenInteger,
+    kTokenFloat,
+    kTokenCompare,
+    kTokenLParen,
+    kTokenRParen,
+    kTokenSemicolon,
+    kTokenParameter,
+    kTokenOther,
+};
+
+struct Token {
+    TokenKind kind;
+    size_t begin;
+    size_t end;
+    // the upper case of an identifier, or the value of a string
+    std::string text;
+};
+
+inline bool IsIdentChar(char c) {
+    return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+}
+
+// split the sql into the tokens the parameterization looks at, return false
+// if the sql is not lexed as it is expected
+bool Tokenize(const std::string& sql, std::vector<Token>* tokens) {
+    size_t i = 0;
+    size_t n = sql.size();
+    while (i < n) {
+        char c = sql[i];
+        if (std::isspace(static_cast<unsigned char>(c))) {
+            i++;
+            continue;
+        }
+        if ((c == '-' && i + 1 < n && sql[i + 1] == '-') || c == '#') {
+            while (i < n && sql[i] != '\n') {
+                i++;
+            }
+            continue;
+        }
+        if (c == '/' && i + 1 < n && sql[i + 1] == '*') {
+            size_t end = sql.find("*/", i + 2);
+            if (end == std::string::npos) {
+                return false;
+            }
+            i = end + 2;
+            continue;
+        }
+        Token token = {kTokenOther, i, i + 1, ""};
+        if (c == '\'' || c == '"') {
+            if (i + 2 < n && sql[i + 1] == c && sql[i + 2] == c) {
+                // the triple quoted strings are left to the parser
+                return false;
+            }
+            bool escaped = false;
+            size_t j = i + 1;
+            while (j < n && sql[j] != c) {
+                if (sql[j] == '\\') {
+                    escaped = true;
+                    j++;
+                }
+                j++;
+            }
+            if (j >= n) {
+                return false;
+            }
+            token.end = j + 1;
+            // the raw and bytes strings are prefixed, e.g. r'...'
+            bool prefixed = i > 0 && IsIdentChar(sql[i - 1]);
+            if (!escaped && !prefixed) {
+                token.kind = kTokenString;
+                token.text = sql.substr(i + 1, j - i - 1);
+            }
+        } else if (c == '`') {
+            size_t end = sql.find('`', i + 1);
+            if (end == std::string::npos) {
+                return false;
+            }
+            token.kind = kTokenQuotedIdent;
+            token.end = end + 1;
+        } else if (std::isdigit(static_cast<unsigned char>(c)) ||
+                   (c == '.' && i + 1 < n &&
+                    std::isdigit(static_cast<unsigned char>(sql[i + 1])))) {
+            size_t j = i;
+            bool is_float = false;
+            while (j < n && std::isdigit(static_cast<unsigned char>(sql[j]))) {
+                j++;
+            }
+            if (j < n && sql[j] == '.') {
+                is_float = true;
+                j++;
+                while (j < n &&
+                       std::isdigit(static_cast<unsigned char>(sql[j]))) {
+                    j++;
+                }
+            }
+            if (j < n && (sql[j] == 'e' || sql[j] == 'E')) {
+                size_t k = j + 1;
+                if (k < n && (sql[k] == '+' || sql[k] == '-')) {
+                    k++;
+                }
+                if (k < n && std::isdigit(static_cast<unsigned char>(sql[k]))) {
+                    is_float = true;
+                    j = k;
+                    while (j < n &&
+                           std::isdigit(static_cast<unsigned char>(sql[j]))) {
+                        j++;
+                    }
+                }
+            }
+            if (j < n && IsIdentChar(sql[j])) {
+                // e.g. the hex integers and the intervals like 3d
+                while (j < n && IsIdentChar(sql[j])) {
+                    j++;
+                }
+            } else {
+                token.kind = is_float ? kTokenFloat : kTokenInteger;
+            }
+            token.end = j;
+        } else if (IsIdentChar(c)) {
+            size_t j = i;
+            while (j < n && IsIdentChar(sql[j])) {
+                token.text.push_back(static_cast<char>(
+                    std::toupper(static_cast<unsigned char>(sql[j]))));
+                j++;
+            }
+            token.kind = kTokenIdent;
+            token.end = j;
+        } else if (c == '=' || c == '<' || c == '>' || c == '!') {
+            size_t j = i + 1;
+            bool compare = c != '!';
+            if (j < n && (sql[j] == '=' || (c == '<' && sql[j] == '>'))) {
+                j++;
+                compare = true;
+            } else if (j < n && (c == '<' || c == '>') && sql[j] == c) {
+                // the shifts
+                j++;
+                compare = false;
+            }
+            token.end = j;
+            token.kind = compare ? kTokenCompare : kTokenOther;
+        } else if (c == '(') {
+            token.kind = kTokenLParen;
+        } else if (c == ')') {
+            token.kind = kTokenRParen;
+        } else if (c == ';') {
+            token.kind = kTokenSemicolon;
+        } else if (c == '?' || c == '@') {
+            token.kind = kTokenParameter;
+        }
+        i = token.end;
+        tokens->push_back(std::move(token));
+    }
+    return true;
+}
+
+// the keywords after which the literals are not in a WHERE clause
+const std::set<std::string>& ClauseKeywords() {
+    static const std::set<std::string> keywords = {
+        "SELECT", "FROM",   "GROUP", "HAVING", "ORDER",   "LIMIT", "WINDOW",
+        "UNION",  "JOIN",   "ON",    "INTO",   "OPTIONS", "CONFIG"};
+    return keywords;
+}
+
+// the keywords that may follow a comparison as a whole
+const std::set<std::string>& FollowKeywords() {
+    static const std::set<std::string> keywords = {
+        "AND", "OR", "GROUP", "HAVING", "ORDER", "LIMIT", "WINDOW", "UNION"};
+    return keywords;
+}
+
+bool IsColumnToken(const Token& token) {
+    if (token.kind == kTokenQuotedIdent) {
+        return true;
+    }
+    return token.kind == kTokenIdent &&
+           ClauseKeywords().count(token.text) == 0 &&
+           FollowKeywords().count(token.text) == 0 && token.text != "WHERE" &&
+           token.text != "NOT" && token.text != "NULL";
+}
+
+bool IsFollowToken(const std::vector<Token>& tokens, size_t idx) {
+    if (idx >= tokens.size()) {
+        return true;
+    }
+    const Token& token = tokens[idx];
+    return token.kind == kTokenRParen || token.kind == kTokenSemicolon ||
+           (token.kind == kTokenIdent && FollowKeywords().count(token.text));
+}
+
+struct Literal {
+    const Token* token;
+    type::Type type;
+    int64_t int_value;
+    double double_value;
+};
+
+bool ParseLiteral(const std::string& sql, const Token& token,
+                  Literal* literal) {
+    literal->token = &token;
+    literal->int_value = 0;
+    literal->double_value = 0;
+    std::string image = sql.substr(token.begin, token.end - token.begin);
+    errno = 0;
+    char* end = nullptr;
+    switch (token.kind) {
+        case kTokenString:
+            literal->type = type::kVarchar;
+            return true;
+        case kTokenInteger: {
+            long long value = std::strtoll(image.c_str(), &end, 10);  // NOLINT
+            if (errno != 0 || *end != '\0') {
+                return false;
+            }
+            // the same types as the integer literals of the planner
+            literal->type = (value >= INT32_MIN && value <= INT32_MAX)
+                                ? type::kInt32
+                                : type::kInt64;
+            literal->int_value = value;
+            return true;
+        }
+        case kTokenFloat: {
+            double value = std::strtod(image.c_str(), &end);
+            if (errno != 0 || *end != '\0' || !std::isfinite(value)) {
+                return false;
+            }
+            literal->type = type::kDouble;
+            literal->double_value = value;
+            return true;
+        }
+        default:
+            return false;
+    }
+}
+
+bool IsLiteralToken(const Token& token) {
+    return token.kind == kTokenString || token.kind == kTokenInteger ||
+           token.kind == kTokenFloat;
+}
+
+}  // namespace
+
+bool ParameterizeLiterals(const std::string& sql,
+                          std::string* parameterized_sql,
+                          codec::Schema* parameter_types,
+                          codec::Row* parameter_row) {
+    if (parameterized_sql == nullptr || parameter_types == nullptr ||
+        parameter_row == nullptr) {
+        return false;
+    }
+    std::vector<Token> tokens;
+    if (!Tokenize(sql, &tokens)) {
+        return false;
+    }
+    size_t first = 0;
+    while (first < tokens.size() && tokens[first].kind == kTokenLParen) {
+        first++;
+    }
+    if (first >= tokens.size() || tokens[first].kind != kTokenIdent ||
+        tokens[first].text != "SELECT") {
+        return false;
+    }
+    // whether the tokens are in a WHERE clause at each depth of brackets
+    std::vector<bool> in_where = {false};
+    std::vector<Literal> literals;
+    for (size_t idx = 0; idx < tokens.size(); idx++) {
+        const Token& token = tokens[idx];
+        switch (token.kind) {
+            case kTokenParameter:
+                return false;
+            case kTokenLParen:
+                in_where.push_back(in_where.back());
+                break;
+            case kTokenRParen:
+                if (in_where.size() > 1) {
+                    in_where.pop_back();
+                }
+                break;
+            case kTokenIdent:
+                if (token.text == "WHERE") {
+                    in_where.back() = true;
+                } else if (ClauseKeywords().count(token.text)) {
+                    in_where.back() = false;
+                }
+                break;
+            default:
+                break;
+        }
+        if (!IsLiteralToken(token) || !in_where.back() || idx < 2 ||
+            tokens[idx - 1].kind != kTokenCompare ||
+            !IsColumnToken(tokens[idx - 2]) || !IsFollowToken(tokens, idx + 1)) {
+            continue;
+        }
+        Literal literal;
+        if (ParseLiteral(sql, token, &literal)) {
+            literals.push_back(literal);
+        }
+    }
+    if (literals.empty()) {
+        return false;
+    }
+
+    parameter_types->Clear();
+    parameterized_sql->clear();
+    size_t pos = 0;
+    uint32_t str_length = 0;
+    for (const auto& literal : literals) {
+        parameterized_sql->append(sql, pos, literal.token->begin - pos);
+        parameterized_sql->push_back('?');
+        pos = literal.token->end;
+        auto column = parameter_types->Add();
+        column->set_name("?" + std::to_string(parameter_types->size()));
+        column->set_type(literal.type);
+        if (literal.type == type::kVarchar) {
+            str_length += literal.token->text.size();
+        }
+    }
+    parameterized_sql->append(sql, pos, std::string::npos);
+
+    codec::RowBuilder builder(*parameter_types);
+    uint32_t size = builder.CalTotalLength(str_length);
+    auto slice = base::RefCountedSlice::Allocate(size);
+    builder.SetBuffer(slice.buf(), size);
+    for (const auto& literal : literals) {
+        switch (literal.type) {
+            case type::kInt32:
+                builder.AppendInt32(static_cast<int32_t>(literal.int_value));
+                break;
+            case type::kInt64:
+                builder.AppendInt64(literal.int_value);
+                break;
+            case type::kDouble:
+                builder.AppendDouble(literal.double_value);
+                break;
+            default:
+                builder.AppendString(literal.token->text.data(),
+                                     literal.token->text.size());
+                break;
+        }
+    }
+    *parameter_row = codec::Row(slice);
+    return true;
+}
+
+}  // namespace plan
+}  // namespace hybridse
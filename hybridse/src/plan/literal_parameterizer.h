@@ -0,0 +1,50 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_PLAN_LITERAL_PARAMETERIZER_H_
+#define SRC_PLAN_LITERAL_PARAMETERIZER_H_
+
+#include <string>
+#include "codec/fe_row_codec.h"
+#include "codec/row.h"
+
+namespace hybridse {
+namespace plan {
+
+/// \brief Replace the literals compared with the columns in the WHERE clauses
+/// of a query by positional parameters, e.g.
+///
+///     SELECT * FROM t1 WHERE col1 = 'a123' AND col2 > 10;
+///
+/// is parameterized as
+///
+///     SELECT * FROM t1 WHERE col1 = ? AND col2 > ?;
+///
+/// with the parameter row ('a123', 10), so the queries differing only in the
+/// literals share one compiled plan.
+///
+/// Only the integer, float and string literals that are the whole right side
+/// of a comparison with a column are replaced, and a query with positional
+/// parameters already is left as it is. `parameter_row` is encoded with the
+/// schema `parameter_types`. Return `false` if no literal is replaced.
+bool ParameterizeLiterals(const std::string& sql,
+                          std::string* parameterized_sql,
+                          codec::Schema* parameter_types,
+                          codec::Row* parameter_row);
+
+}  // namespace plan
+}  // namespace hybridse
+#endif  // SRC_PLAN_LITERAL_PARAMETERIZER_H_
@@ -0,0 +1,128 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "plan/literal_parameterizer.h"
+#include <string>
+#include <vector>
+#include "gtest/gtest.h"
+
+namespace hybridse {
+namespace plan {
+
+class LiteralParameterizerTest : public ::testing::Test {};
+
+TEST_F(LiteralParameterizerTest, ParameterizeWhereLiterals) {
+    std::string sql =
+        "SELECT c1, c2 FROM t1 WHERE c1 = 'a123' AND t1.c2 > 10 AND "
+        "`c3` <= 3000000000 OR c4 != 1.5;";
+    std::string parameterized_sql;
+    codec::Schema types;
+    codec::Row row;
+    ASSERT_TRUE(ParameterizeLiterals(sql, &parameterized_sql, &types, &row));
+    ASSERT_EQ(
+        "SELECT c1, c2 FROM t1 WHERE c1 = ? AND t1.c2 > ? AND `c3` <= ? OR "
+        "c4 != ?;",
+        parameterized_sql);
+    ASSERT_EQ(4, types.size());
+    ASSERT_EQ(type::kVarchar, types.Get(0).type());
+    ASSERT_EQ(type::kInt32, types.Get(1).type());
+    ASSERT_EQ(type::kInt64, types.Get(2).type());
+    ASSERT_EQ(type::kDouble, types.Get(3).type());
+
+    codec::RowView view(types, row.buf(), row.size());
+    const char* str = nullptr;
+    uint32_t length = 0;
+    ASSERT_EQ(0, view.GetString(0, &str, &length));
+    ASSERT_EQ("a123", std::string(str, length));
+    int32_t int32_value = 0;
+    ASSERT_EQ(0, view.GetInt32(1, &int32_value));
+    ASSERT_EQ(10, int32_value);
+    int64_t int64_value = 0;
+    ASSERT_EQ(0, view.GetInt64(2, &int64_value));
+    ASSERT_EQ(3000000000L, int64_value);
+    double double_value = 0;
+    ASSERT_EQ(0, view.GetDouble(3, &double_value));
+    ASSERT_EQ(1.5, double_value);
+}
+
+TEST_F(LiteralParameterizerTest, SameShapeSameSql) {
+    std::string first;
+    std::string second;
+    codec::Schema types;
+    codec::Row row;
+    ASSERT_TRUE(ParameterizeLiterals(
+        "select * from t1 where user_id = 'a123' limit 10", &first, &types,
+        &row));
+    ASSERT_TRUE(ParameterizeLiterals(
+        "select * from t1 where user_id = 'b4' limit 10", &second, &types,
+        &row));
+    ASSERT_EQ("select * from t1 where user_id = ? limit 10", first);
+    ASSERT_EQ(first, second);
+}
+
+TEST_F(LiteralParameterizerTest, KeepOtherLiterals) {
+    std::string parameterized_sql;
+    codec::Schema types;
+    codec::Row row;
+    std::vector<std::string> sqls = {
+        // the literals out of the WHERE clauses
+        "SELECT c1, 1 FROM t1 LIMIT 10",
+        "SELECT c1 FROM t1 LAST JOIN t2 ON t1.c1 = t2.c1 AND t2.c2 = 1",
+        // the literals not compared with a column as a whole
+        "SELECT c1 FROM t1 WHERE c2 = -1 AND c3 = 1 + 2 AND c4 = 'a' || 'b'",
+        "SELECT c1 FROM t1 WHERE c2 BETWEEN 1 AND 3 AND c3 IN (1, 2)",
+        "SELECT c1 FROM t1 WHERE 1 = c2 AND abs(c3) = 1 AND c4 = 0x1F",
+        "SELECT c1 FROM t1 WHERE c2 = 'a\\'b' AND c3 = r'ab' AND c4 = 3d",
+        // the queries with parameters and the other statements
+        "SELECT c1 FROM t1 WHERE c2 = ? AND c3 = 1",
+        "INSERT INTO t1 VALUES (1, 'a')",
+        "DELETE FROM t1 WHERE c1 = 'a'",
+    };
+    for (const auto& sql : sqls) {
+        ASSERT_FALSE(
+            ParameterizeLiterals(sql, &parameterized_sql, &types, &row))
+            << sql << " is parameterized as " << parameterized_sql;
+    }
+}
+
+TEST_F(LiteralParameterizerTest, ParameterizeNestedWhere) {
+    std::string parameterized_sql;
+    codec::Schema types;
+    codec::Row row;
+    ASSERT_TRUE(ParameterizeLiterals(
+        "SELECT sum(c2) OVER w FROM (SELECT * FROM t1 WHERE (c1 = \"x\")) "
+        "WHERE c3 = 2 -- c4 = ?\n"
+        "WINDOW w AS (PARTITION BY c1 ORDER BY c6 ROWS BETWEEN 3 PRECEDING "
+        "AND CURRENT ROW)",
+        &parameterized_sql, &types, &row));
+    ASSERT_EQ(
+        "SELECT sum(c2) OVER w FROM (SELECT * FROM t1 WHERE (c1 = ?)) "
+        "WHERE c3 = ? -- c4 = ?\n"
+        "WINDOW w AS (PARTITION BY c1 ORDER BY c6 ROWS BETWEEN 3 PRECEDING "
+        "AND CURRENT ROW)",
+        parameterized_sql);
+    ASSERT_EQ(2, types.size());
+    ASSERT_EQ(type::kVarchar, types.Get(0).type());
+    ASSERT_EQ(type::kInt32, types.Get(1).type());
+}
+
+}  // namespace plan
+}  // namespace hybridse
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -60,6 +60,18 @@ namespace std {
 }
 %typemap(javain) hybridse::vm::ByteArrayPtr "$javainput"
 %typemap(javaout) hybridse::vm::ByteArrayPtr "{ return $jnicall; }"
+
+%typemap(jni) hybridse::vm::IntArrayPtr "jintArray"
+%typemap(jtype) hybridse::vm::IntArrayPtr "int[]"
+%typemap(jstype) hybridse::vm::IntArrayPtr "int[]"
+%typemap(in) hybridse::vm::IntArrayPtr {
+    $1 = (hybridse::vm::IntArrayPtr) JCALL2(GetIntArrayElements, jenv, $input, 0);
+}
+%typemap(argout) hybridse::vm::IntArrayPtr {
+    JCALL3(ReleaseIntArrayElements, jenv, $input, (jint *) $1, 0);
+}
+%typemap(javain) hybridse::vm::IntArrayPtr "$javainput"
+%typemap(javaout) hybridse::vm::IntArrayPtr "{ return $jnicall; }"
 #endif
 
 // Fix for Java shared_ptr unref
@@ -0,0 +1,143 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_UDF_CIVIL_TIME_H_
+#define SRC_UDF_CIVIL_TIME_H_
+
+#include <stdint.h>
+#include <time.h>
+#include "codec/type_codec.h"
+
+// The civil time of the date udfs. The functions are inline, as they are
+// compiled into the builtin bitcode too, see bitcode/builtin_functions.cc
+namespace hybridse {
+namespace udf {
+namespace v1 {
+
+// TODO(chenjing): 时区统一配置
+const int32_t TZ = 8;
+const time_t TZ_OFFSET = TZ * 3600000;
+
+// The civil date of the days since 1970-01-01, the inverse of DaysFromCivil.
+// It is the proleptic gregorian calendar counted in the 400 years eras, so it
+// needs neither gmtime_r nor a table:
+// http://howardhinnant.github.io/date_algorithms.html
+inline void CivilFromDays(int64_t days, int32_t *year, int32_t *month,
+                                 int32_t *day) {
+    days += 719468;
+    const int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+    const int64_t doe = days - era * 146097;
+    const int64_t yoe =
+        (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    const int64_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    const int64_t mp = (5 * doy + 2) / 153;
+    *day = static_cast<int32_t>(doy - (153 * mp + 2) / 5 + 1);
+    *month = static_cast<int32_t>(mp < 10 ? mp + 3 : mp - 9);
+    *year = static_cast<int32_t>(yoe + era * 400 + (*month <= 2));
+}
+inline int64_t DaysFromCivil(int32_t year, int32_t month, int32_t day) {
+    const int64_t y = year - (month <= 2);
+    const int64_t era = (y >= 0 ? y : y - 399) / 400;
+    const int64_t yoe = y - era * 400;
+    const int64_t doy = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 +
+                        day - 1;
+    const int64_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+}
+inline int64_t FloorDiv(int64_t a, int64_t b) {
+    return a / b - (a % b != 0 && (a < 0) != (b < 0));
+}
+// the seconds and the days of the timestamp in the time zone, the seconds are
+// truncated as gmtime_r is given by the other udfs
+inline int64_t LocalSeconds(int64_t ts) {
+    return (ts + TZ_OFFSET) / 1000;
+}
+inline int64_t LocalDays(int64_t ts) {
+    return FloorDiv(LocalSeconds(ts), 86400);
+}
+// 0 for sunday as tm_wday, 1970-01-01 is a thursday
+inline int32_t WeekDayOfDays(int64_t days) {
+    return static_cast<int32_t>(days - FloorDiv(days + 4, 7) * 7 + 4);
+}
+// the iso 8601 week number, the week of a day is the week of its thursday
+inline int32_t IsoWeekOfDays(int64_t days) {
+    int64_t thursday = days - (WeekDayOfDays(days) + 6) % 7 + 3;
+    int32_t year, month, day;
+    CivilFromDays(thursday, &year, &month, &day);
+    return static_cast<int32_t>(
+        (thursday - DaysFromCivil(year, 1, 1)) / 7 + 1);
+}
+// the dates boost::gregorian accepts, the udfs return 0 for the others as
+// they did when boost threw
+inline bool IsValidCivil(int32_t year, int32_t month, int32_t day) {
+    static const int32_t kMonthDays[] = {31, 28, 31, 30, 31, 30,
+                                         31, 31, 30, 31, 30, 31};
+    if (year < 1400 || year > 9999 || month < 1 || month > 12 || day < 1) {
+        return false;
+    }
+    bool leap = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+    return day <= kMonthDays[month - 1] + (month == 2 && leap);
+}
+
+inline int32_t DayOfMonthOfTs(int64_t ts) {
+    int32_t year, month, day;
+    CivilFromDays(LocalDays(ts), &year, &month, &day);
+    return day;
+}
+inline int32_t DayOfWeekOfTs(int64_t ts) {
+    return WeekDayOfDays(LocalDays(ts)) + 1;
+}
+inline int32_t WeekOfYearOfTs(int64_t ts) {
+    int64_t days = LocalDays(ts);
+    int32_t year, month, day;
+    CivilFromDays(days, &year, &month, &day);
+    if (!IsValidCivil(year, month, day)) {
+        return 0;
+    }
+    return IsoWeekOfDays(days);
+}
+inline int32_t MonthOfTs(int64_t ts) {
+    int32_t year, month, day;
+    CivilFromDays(LocalDays(ts), &year, &month, &day);
+    return month;
+}
+inline int32_t YearOfTs(int64_t ts) {
+    int32_t year, month, day;
+    CivilFromDays(LocalDays(ts), &year, &month, &day);
+    return year;
+}
+inline int32_t DayOfWeekOfDate(int32_t date) {
+    int32_t day, month, year;
+    if (!codec::Date::Decode(date, &year, &month, &day) ||
+        !IsValidCivil(year, month, day)) {
+        return 0;
+    }
+    return WeekDayOfDays(DaysFromCivil(year, month, day)) + 1;
+}
+// Return the iso 8601 week number 1..53
+inline int32_t WeekOfYearOfDate(int32_t date) {
+    int32_t day, month, year;
+    if (!codec::Date::Decode(date, &year, &month, &day) ||
+        !IsValidCivil(year, month, day)) {
+        return 0;
+    }
+    return IsoWeekOfDays(DaysFromCivil(year, month, day));
+}
+
+}  // namespace v1
+}  // namespace udf
+}  // namespace hybridse
+#endif  // SRC_UDF_CIVIL_TIME_H_
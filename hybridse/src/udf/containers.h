@@ -18,9 +18,10 @@
 #define SRC_UDF_CONTAINERS_H_
 
 #include <algorithm>
+#include <cmath>
 #include <functional>
-#include <map>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "codec/type_codec.h"
@@ -97,33 +98,31 @@ class TopKContainer {
     }
 
     static void OutputString(ContainerT* ptr, codec::StringRef* output) {
-        auto& map = ptr->map_;
-        if (map.empty()) {
+        auto& heap = ptr->heap_;
+        if (heap.empty()) {
             output->size_ = 0;
             output->data_ = "";
             return;
         }
+        // a min heap sorted by the reversed order is in descending order
+        std::sort_heap(heap.begin(), heap.end(), Greater);
 
         // estimate output length
         uint32_t str_len = 0;
-        for (auto iter = map.rbegin(); iter != map.rend(); ++iter) {
-            uint32_t key_len = v1::to_string_len(iter->first);
-            str_len += (key_len + 1) * iter->second;  // "x,x,x,"
+        for (auto& key : heap) {
+            str_len += v1::to_string_len(key) + 1;  // "x,x,x,"
         }
         // allocate string buffer
         char* buffer = udf::v1::AllocManagedStringBuf(str_len);
         // fill string buffer
         char* cur = buffer;
         uint32_t remain_space = str_len;
-        for (auto iter = map.rbegin(); iter != map.rend(); ++iter) {
-            for (size_t k = 0; k < iter->second; ++k) {
-                uint32_t key_len =
-                    v1::format_string(iter->first, cur, remain_space);
-                cur += key_len;
-                remain_space -= key_len;
-                if (remain_space-- > 0) {
-                    *(cur++) = ',';
-                }
+        for (auto& key : heap) {
+            uint32_t key_len = v1::format_string(key, cur, remain_space);
+            cur += key_len;
+            remain_space -= key_len;
+            if (remain_space-- > 0) {
+                *(cur++) = ',';
             }
         }
         *(buffer + str_len - 1) = '\0';
@@ -132,28 +131,172 @@ class TopKContainer {
     }
 
     void Push(InputT t) {
+        if (bound_ <= 0) {
+            return;
+        }
         auto key = ContainerStorageTypeTrait<T>::to_stored_value(t);
-        auto iter = map_.find(key);
-        if (iter == map_.end()) {
-            map_.insert(iter, {key, 1});
-        } else {
-            iter->second += 1;
+        if (heap_.size() < static_cast<size_t>(bound_)) {
+            heap_.push_back(key);
+            std::push_heap(heap_.begin(), heap_.end(), Greater);
+        } else if (heap_.front() < key) {
+            // replace the minimum, a value not greater than it is dropped
+            // without touching the heap
+            std::pop_heap(heap_.begin(), heap_.end(), Greater);
+            heap_.back() = key;
+            std::push_heap(heap_.begin(), heap_.end(), Greater);
+        }
+    }
+
+ private:
+    static bool Greater(const StorageT& x, const StorageT& y) { return y < x; }
+
+    // min heap of the top `bound_` values, duplicates included
+    std::vector<StorageT> heap_;
+    BoundT bound_ = -1;  // delayed to be set by first push
+};
+
+/**
+ * Finalize a hash value so that every bit of the result depends on all the
+ * input bits, std::hash of integers is the identity.
+ */
+inline uint64_t MixHash(uint64_t h) {
+    // splitmix64 finalizer
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebULL;
+    h ^= h >> 31;
+    return h;
+}
+
+/**
+ * A hash map of open addressing with linear probing. All the entries are
+ * kept in one array, so it allocates only when the map grows, rather than
+ * once for every new key as std::unordered_map does.
+ */
+template <typename K, typename V, typename Hash = std::hash<K>>
+class HashMap {
+ public:
+    HashMap() {}
+
+    // return the value of `key`, a new entry of `value` is inserted if the
+    // key is absent
+    V* Insert(const K& key, const V& value, bool* inserted = nullptr) {
+        if ((size_ + 1) * 2 > slots_.size()) {
+            Grow();
+        }
+        size_t pos = Probe(key);
+        bool absent = !used_[pos];
+        if (absent) {
+            used_[pos] = 1;
+            slots_[pos] = {key, value};
+            size_ += 1;
+        }
+        if (inserted != nullptr) {
+            *inserted = absent;
+        }
+        return &slots_[pos].second;
+    }
+
+    V* Find(const K& key) {
+        if (size_ == 0) {
+            return nullptr;
+        }
+        size_t pos = Probe(key);
+        return used_[pos] ? &slots_[pos].second : nullptr;
+    }
+
+    bool Erase(const K& key) {
+        if (size_ == 0) {
+            return false;
+        }
+        size_t pos = Probe(key);
+        if (!used_[pos]) {
+            return false;
+        }
+        // shift the following entries of the probe sequence backward, so
+        // that no tombstone is needed
+        size_t mask = slots_.size() - 1;
+        size_t hole = pos;
+        for (size_t next = (hole + 1) & mask; used_[next];
+             next = (next + 1) & mask) {
+            size_t home = Home(slots_[next].first);
+            // move the entry if its home slot does not lie in (hole, next]
+            if (((next - home) & mask) >= ((next - hole) & mask)) {
+                slots_[hole] = slots_[next];
+                hole = next;
+            }
+        }
+        used_[hole] = 0;
+        size_ -= 1;
+        return true;
+    }
+
+    size_t size() const { return size_; }
+
+    template <typename F>
+    void ForEach(F&& fn) const {
+        for (size_t i = 0; i < slots_.size(); ++i) {
+            if (used_[i]) {
+                fn(slots_[i].first, slots_[i].second);
+            }
         }
-        elem_cnt_ += 1;
-        if (elem_cnt_ > bound_) {
-            auto iter_min = map_.begin();
-            iter_min->second -= 1;
-            if (iter_min->second == 0) {
-                map_.erase(iter_min);
+    }
+
+ private:
+    size_t Home(const K& key) const {
+        return MixHash(Hash()(key)) & (slots_.size() - 1);
+    }
+
+    // the slot of `key`, or the empty slot it would be inserted into
+    size_t Probe(const K& key) const {
+        size_t mask = slots_.size() - 1;
+        size_t pos = Home(key);
+        while (used_[pos] && !(slots_[pos].first == key)) {
+            pos = (pos + 1) & mask;
+        }
+        return pos;
+    }
+
+    void Grow() {
+        std::vector<std::pair<K, V>> slots;
+        std::vector<uint8_t> used;
+        slots.swap(slots_);
+        used.swap(used_);
+        size_t capacity = slots.empty() ? 16 : slots.size() * 2;
+        slots_.resize(capacity);
+        used_.resize(capacity, 0);
+        for (size_t i = 0; i < slots.size(); ++i) {
+            if (used[i]) {
+                size_t pos = Probe(slots[i].first);
+                used_[pos] = 1;
+                slots_[pos] = slots[i];
             }
-            elem_cnt_ -= 1;
         }
     }
 
+    std::vector<std::pair<K, V>> slots_;
+    std::vector<uint8_t> used_;
+    size_t size_ = 0;
+};
+
+/**
+ * A hash set over HashMap.
+ */
+template <typename T, typename Hash = std::hash<T>>
+class HashSet {
+ public:
+    // return true if `value` is new to the set
+    bool Insert(const T& value) {
+        bool inserted = false;
+        map_.Insert(value, 0, &inserted);
+        return inserted;
+    }
+
+    size_t size() const { return map_.size(); }
+
  private:
-    std::map<StorageT, size_t, std::less<StorageT>> map_;
-    BoundT elem_cnt_ = 0;
-    BoundT bound_ = -1;  // delayed to be set by first push
+    HashMap<T, uint8_t, Hash> map_;
 };
 
 template <typename K, typename V,
@@ -188,10 +331,7 @@ class BoundedGroupByDict {
         Destroy(ptr);
     }
 
-    static void Destroy(ContainerT* ptr) {
-        ptr->map().clear();
-        ptr->~ContainerT();
-    }
+    static void Destroy(ContainerT* ptr) { ptr->~ContainerT(); }
 
     static void OutputString(ContainerT* ptr, bool is_desc,
                              codec::StringRef* output) {
@@ -204,40 +344,25 @@ class BoundedGroupByDict {
     static void OutputString(ContainerT* ptr, bool is_desc,
                              codec::StringRef* output,
                              const FormatValueF& format_value) {
-        auto& map = ptr->map_;
-        if (map.empty()) {
+        if (ptr->size() == 0) {
             output->size_ = 0;
             output->data_ = "";
             return;
         }
+        auto entries = ptr->SortedEntries(is_desc);
 
         // estimate output length
         uint32_t str_len = 0;
-        auto stop_pos = map.end();
-        auto stop_rpos = map.rend();
-        if (is_desc) {
-            for (auto iter = map.rbegin(); iter != map.rend(); ++iter) {
-                uint32_t key_len = v1::to_string_len(iter->first);
-                uint32_t value_len = format_value(iter->second, nullptr, 0);
-                uint32_t new_len = str_len + key_len + value_len + 2;  // "k:v,"
-                if (new_len > MAX_OUTPUT_STR_SIZE) {
-                    stop_rpos = iter;
-                    break;
-                } else {
-                    str_len = new_len;
-                }
-            }
-        } else {
-            for (auto iter = map.begin(); iter != map.end(); ++iter) {
-                uint32_t key_len = v1::to_string_len(iter->first);
-                uint32_t value_len = format_value(iter->second, nullptr, 0);
-                uint32_t new_len = str_len + key_len + value_len + 2;  // "k:v,"
-                if (new_len > MAX_OUTPUT_STR_SIZE) {
-                    stop_pos = iter;
-                    break;
-                } else {
-                    str_len = new_len;
-                }
+        size_t stop_pos = entries.size();
+        for (size_t i = 0; i < entries.size(); ++i) {
+            uint32_t key_len = v1::to_string_len(entries[i].first);
+            uint32_t value_len = format_value(entries[i].second, nullptr, 0);
+            uint32_t new_len = str_len + key_len + value_len + 2;  // "k:v,"
+            if (new_len > MAX_OUTPUT_STR_SIZE) {
+                stop_pos = i;
+                break;
+            } else {
+                str_len = new_len;
             }
         }
 
@@ -247,43 +372,19 @@ class BoundedGroupByDict {
         // fill string buffer
         char* cur = buffer;
         uint32_t remain_space = str_len;
-        if (is_desc) {
-            for (auto iter = map.rbegin(); iter != map.rend(); ++iter) {
-                if (iter == stop_rpos) {
-                    break;
-                }
-                uint32_t key_len =
-                    v1::format_string(iter->first, cur, remain_space);
-                cur += key_len;
-                *(cur++) = ':';
-                remain_space -= key_len + 1;
-
-                uint32_t value_len =
-                    format_value(iter->second, cur, remain_space);
-                cur += value_len;
-                remain_space -= value_len;
-                if (remain_space-- > 0) {
-                    *(cur++) = ',';
-                }
-            }
-        } else {
-            for (auto iter = map.begin(); iter != map.end(); ++iter) {
-                if (iter == stop_pos) {
-                    break;
-                }
-                uint32_t key_len =
-                    v1::format_string(iter->first, cur, remain_space);
-                cur += key_len;
-                *(cur++) = ':';
-                remain_space -= key_len + 1;
-
-                uint32_t value_len =
-                    format_value(iter->second, cur, remain_space);
-                cur += value_len;
-                remain_space -= value_len;
-                if (remain_space-- > 0) {
-                    *(cur++) = ',';
-                }
+        for (size_t i = 0; i < stop_pos; ++i) {
+            uint32_t key_len =
+                v1::format_string(entries[i].first, cur, remain_space);
+            cur += key_len;
+            *(cur++) = ':';
+            remain_space -= key_len + 1;
+
+            uint32_t value_len =
+                format_value(entries[i].second, cur, remain_space);
+            cur += value_len;
+            remain_space -= value_len;
+            if (remain_space-- > 0) {
+                *(cur++) = ',';
             }
         }
 
@@ -293,14 +394,209 @@ class BoundedGroupByDict {
             str_len - 1;  // must leave one '\0' for string format impl
     }
 
-    std::map<StorageK, StorageV>& map() { return map_; }
+    // return the value of key, `value` is inserted if the key is absent. The
+    // pointer is valid until the next insert
+    StorageV* Insert(const StorageK& key, const StorageV& value,
+                     bool* inserted) {
+        return map_.Insert(key, value, inserted);
+    }
+
+    // drop the smallest key, it scans the groups as they are not ordered
+    void EraseFirst() {
+        const StorageK* first = nullptr;
+        map_.ForEach([&first](const StorageK& key, const StorageV&) {
+            if (first == nullptr || key < *first) {
+                first = &key;
+            }
+        });
+        if (first != nullptr) {
+            StorageK key = *first;
+            map_.Erase(key);
+        }
+    }
+
+    size_t size() const { return map_.size(); }
+
+    template <typename F>
+    void ForEach(F&& fn) const {
+        map_.ForEach(std::forward<F>(fn));
+    }
+
+    // the groups in the order of key
+    std::vector<std::pair<StorageK, StorageV>> SortedEntries(
+        bool is_desc = false) const {
+        std::vector<std::pair<StorageK, StorageV>> entries;
+        entries.reserve(map_.size());
+        map_.ForEach([&entries](const StorageK& key, const StorageV& value) {
+            entries.emplace_back(key, value);
+        });
+        std::sort(entries.begin(), entries.end(),
+                  [is_desc](const std::pair<StorageK, StorageV>& x,
+                            const std::pair<StorageK, StorageV>& y) {
+                      return is_desc ? y.first < x.first : x.first < y.first;
+                  });
+        return entries;
+    }
 
  private:
-    std::map<StorageK, StorageV> map_;
+    // the keys of a window are usually a few categories repeated, so the
+    // groups are kept in one flat hash map and sorted only for the output
+    HashMap<StorageK, StorageV> map_;
 
     static const size_t MAX_OUTPUT_STR_SIZE = 4096;
 };
 
+/**
+ * HyperLogLog sketch estimating the number of distinct values in a fixed
+ * 2^P bytes, the standard error is about 1.04 / sqrt(2^P).
+ */
+template <typename T, uint32_t P = 12>
+class HyperLogLog {
+ public:
+    using InputT = typename DataTypeTrait<T>::CCallArgType;
+    using StorageT = typename ContainerStorageTypeTrait<T>::type;
+    using ContainerT = HyperLogLog<T, P>;
+
+    static constexpr uint32_t REGISTER_NUM = 1u << P;
+
+    static void Init(ContainerT* addr) { new (addr) ContainerT(); }
+    static void Destroy(ContainerT* ptr) { ptr->~ContainerT(); }
+
+    void Push(InputT t) {
+        auto value = ContainerStorageTypeTrait<T>::to_stored_value(t);
+        uint64_t h = MixHash(std::hash<StorageT>()(value));
+        uint32_t idx = static_cast<uint32_t>(h >> (64 - P));
+        // rank of the first 1 bit in the remaining 64 - P bits
+        uint64_t rest = (h << P) | (1ULL << (P - 1));
+        uint8_t rank = static_cast<uint8_t>(__builtin_clzll(rest) + 1);
+        if (registers_.empty()) {
+            registers_.resize(REGISTER_NUM, 0);
+        }
+        if (registers_[idx] < rank) {
+            registers_[idx] = rank;
+        }
+    }
+
+    int64_t Estimate() const {
+        if (registers_.empty()) {
+            return 0;
+        }
+        const double m = REGISTER_NUM;
+        double sum = 0;
+        uint32_t zeros = 0;
+        for (uint8_t r : registers_) {
+            sum += std::ldexp(1.0, -static_cast<int>(r));
+            zeros += r == 0;
+        }
+        double alpha = 0.7213 / (1 + 1.079 / m);
+        double estimate = alpha * m * m / sum;
+        if (estimate <= 2.5 * m && zeros != 0) {
+            // linear counting for the small range
+            estimate = m * std::log(m / zeros);
+        }
+        return static_cast<int64_t>(estimate + 0.5);
+    }
+
+ private:
+    std::vector<uint8_t> registers_;
+};
+
+/**
+ * Space-saving summary of the most frequent keys in at most `capacity`
+ * counters. Once full, a new key takes over the counter of the minimum
+ * count, so the count of a key is over estimated by at most that minimum.
+ * The counters form a min heap and the index maps a key to its heap slot,
+ * so an update takes O(log capacity).
+ */
+template <typename K>
+class SpaceSaving {
+ public:
+    using InputK = typename DataTypeTrait<K>::CCallArgType;
+    using StorageK = typename ContainerStorageTypeTrait<K>::type;
+    using Entry = std::pair<StorageK, int64_t>;
+
+    void set_capacity(size_t capacity) { capacity_ = capacity; }
+    size_t capacity() const { return capacity_; }
+
+    void Push(InputK k) {
+        if (capacity_ == 0) {
+            return;
+        }
+        auto key = ContainerStorageTypeTrait<K>::to_stored_value(k);
+        size_t* pos = index_.Find(key);
+        if (pos != nullptr) {
+            heap_[*pos].second += 1;
+            SiftDown(*pos);
+        } else if (heap_.size() < capacity_) {
+            heap_.push_back({key, 1});
+            index_.Insert(key, heap_.size() - 1);
+            SiftUp(heap_.size() - 1);
+        } else {
+            index_.Erase(heap_[0].first);
+            heap_[0].first = key;
+            heap_[0].second += 1;
+            index_.Insert(key, 0);
+            SiftDown(0);
+        }
+    }
+
+    // the entries in descending order of count, ties in ascending order
+    // of key
+    std::vector<Entry> Top(size_t n) const {
+        std::vector<Entry> entries(heap_);
+        n = std::min(n, entries.size());
+        std::partial_sort(entries.begin(), entries.begin() + n, entries.end(),
+                          [](const Entry& x, const Entry& y) {
+                              return x.second > y.second ||
+                                     (x.second == y.second && x.first < y.first);
+                          });
+        entries.resize(n);
+        return entries;
+    }
+
+ private:
+    void Swap(size_t i, size_t j) {
+        std::swap(heap_[i], heap_[j]);
+        *index_.Find(heap_[i].first) = i;
+        *index_.Find(heap_[j].first) = j;
+    }
+
+    void SiftUp(size_t i) {
+        while (i > 0) {
+            size_t parent = (i - 1) / 2;
+            if (heap_[parent].second <= heap_[i].second) {
+                break;
+            }
+            Swap(i, parent);
+            i = parent;
+        }
+    }
+
+    void SiftDown(size_t i) {
+        while (true) {
+            size_t min = i;
+            size_t left = 2 * i + 1;
+            size_t right = left + 1;
+            if (left < heap_.size() && heap_[left].second < heap_[min].second) {
+                min = left;
+            }
+            if (right < heap_.size() &&
+                heap_[right].second < heap_[min].second) {
+                min = right;
+            }
+            if (min == i) {
+                break;
+            }
+            Swap(i, min);
+            i = min;
+        }
+    }
+
+    size_t capacity_ = 0;
+    std::vector<Entry> heap_;
+    HashMap<StorageK, size_t> index_;
+};
+
 }  // namespace container
 }  // namespace udf
 }  // namespace hybridse
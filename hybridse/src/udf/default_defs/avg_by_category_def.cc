@@ -66,16 +66,13 @@ struct AvgCateDef {
             if (is_key_null || is_value_null) {
                 return ptr;
             }
-            auto& map = ptr->map();
             auto stored_key = ContainerT::to_stored_key(key);
-            auto iter = map.find(stored_key);
-            if (iter == map.end()) {
-                map.insert(iter, {stored_key,
-                                  {1, ContainerT::to_stored_value(value)}});
-            } else {
-                auto& pair = iter->second;
-                pair.first += 1;
-                pair.second += ContainerT::to_stored_value(value);
+            bool inserted = false;
+            auto pair = ptr->Insert(
+                stored_key, {1, ContainerT::to_stored_value(value)}, &inserted);
+            if (!inserted) {
+                pair->first += 1;
+                pair->second += ContainerT::to_stored_value(value);
             }
             return ptr;
         }
@@ -187,9 +184,9 @@ struct TopKAvgCateWhereDef {
             if (cond && !is_cond_null) {
                 AvgCateImpl::Update(ptr, value, is_value_null, key,
                                     is_key_null);
-                auto& map = ptr->map();
-                if (bound >= 0 && map.size() > static_cast<size_t>(bound)) {
-                    map.erase(map.begin());
+                if (bound >= 0 &&
+                    ptr->size() > static_cast<size_t>(bound)) {
+                    ptr->EraseFirst();
                 }
             }
             return ptr;
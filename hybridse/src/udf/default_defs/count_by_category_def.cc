@@ -63,14 +63,11 @@ struct CountCateDef {
             if (is_key_null || is_value_null) {
                 return ptr;
             }
-            auto& map = ptr->map();
             auto stored_key = ContainerT::to_stored_key(key);
-            auto iter = map.find(stored_key);
-            if (iter == map.end()) {
-                map.insert(iter, {stored_key, 1});
-            } else {
-                auto& single = iter->second;
-                single += 1;
+            bool inserted = false;
+            auto single = ptr->Insert(stored_key, 1, &inserted);
+            if (!inserted) {
+                *single += 1;
             }
             return ptr;
         }
@@ -178,9 +175,9 @@ struct TopKCountCateWhereDef {
             if (cond && !is_cond_null) {
                 AvgCateImpl::Update(ptr, value, is_value_null, key,
                                     is_key_null);
-                auto& map = ptr->map();
-                if (bound >= 0 && map.size() > static_cast<size_t>(bound)) {
-                    map.erase(map.begin());
+                if (bound >= 0 &&
+                    ptr->size() > static_cast<size_t>(bound)) {
+                    ptr->EraseFirst();
                 }
             }
             return ptr;
@@ -15,7 +15,6 @@
  */
 
 #include <algorithm>
-#include <queue>
 #include <string>
 #include <tuple>
 #include <unordered_set>
@@ -30,6 +29,7 @@
 #include "codec/type_codec.h"
 #include "udf/containers.h"
 #include "udf/default_udf_library.h"
+#include "udf/simd_string.h"
 #include "udf/udf.h"
 #include "udf/udf_registry.h"
 #include "vm/jit_runtime.h"
@@ -167,6 +167,22 @@ class StringSplitState : public base::FeBaseObject {
 };
 
 struct FZStringOpsDef {
+    // a single character or a delimeter without regex meta characters
+    // splits as a literal, the latter is the same as splitting by the regex
+    // but without boost::regex
+    static bool IsLiteralDelimeter(const StringRef& delimeter) {
+        if (delimeter.size_ == 1) {
+            return true;
+        }
+        static const char* META_CHARS = ".[]{}()\\*+?|^$";
+        for (uint32_t i = 0; i < delimeter.size_; ++i) {
+            if (strchr(META_CHARS, delimeter.data_[i]) != nullptr) {
+                return false;
+            }
+        }
+        return true;
+    }
+
     static StringSplitState* InitList() {
         auto list = new StringSplitState();
         vm::JitRuntime::get()->AddManagedObject(list);
@@ -185,22 +201,18 @@ struct FZStringOpsDef {
             return state;
         }
         auto list = state->GetListV();
-        if (delimeter->size_ == 1) {
-            char d = delimeter->data_[0];
+        if (IsLiteralDelimeter(*delimeter)) {
+            const char* d = delimeter->data_;
+            size_t d_size = delimeter->size_;
             const char* begin = str->data_;
             const char* end = str->data_ + str->size_;
-            const char* cur = begin;
-            while (cur < end) {
-                if (*cur == d) {
-                    list->Add(std::string(begin, cur - begin));
-                    begin = cur + 1;
-                }
-                ++cur;
-            }
-            if (begin == cur) {
-                list->Add("");
-            } else {
+            while (true) {
+                const char* cur = simd::FindSubstr(begin, end, d, d_size);
                 list->Add(std::string(begin, cur - begin));
+                if (cur == end) {
+                    break;
+                }
+                begin = cur + d_size;
             }
         } else {
             // fallback impl with boost regex
@@ -239,11 +251,11 @@ struct FZStringOpsDef {
             const char* end = str->data_ + str->size_;
             const char* cur = begin;
             bool part_found = false;
-            while (cur < end) {
+            while ((cur = simd::FindAnyOf(cur, end, d1, d2)) < end) {
                 if (*cur == d1) {
                     part_found = false;
                     begin = cur + 1;
-                } else if (*cur == d2 && !part_found) {
+                } else if (!part_found) {
                     list->Add(std::string(begin, cur - begin));
                     part_found = true;
                 }
@@ -292,13 +304,13 @@ struct FZStringOpsDef {
             const char* end = str->data_ + str->size_;
             const char* cur = begin;
             int cur_parts = 0;
-            while (cur < end) {
+            while ((cur = simd::FindAnyOf(cur, end, d1, d2)) < end) {
                 if (*cur == d1) {
                     if (cur_parts == 1) {
                         list->Add(std::string(begin, cur - begin));
                     }
                     cur_parts = 0;
-                } else if (*cur == d2) {
+                } else {
                     ++cur_parts;
                     if (cur_parts == 1) {
                         begin = cur + 1;
@@ -398,31 +410,29 @@ struct FZTop1Ratio {
         if (is_key_null) {
             return ptr;
         }
-        auto& map = ptr->map();
         auto stored_key = ContainerT::to_stored_key(key);
-        auto iter = map.find(stored_key);
-        if (iter == map.end()) {
-            map.insert(iter, {stored_key, 1});
-        } else {
-            auto& single = iter->second;
-            single += 1;
+        bool inserted = false;
+        auto single = ptr->Insert(stored_key, 1, &inserted);
+        if (!inserted) {
+            *single += 1;
         }
         return ptr;
     }
 
     static double Output(ContainerT* ptr) {
-        auto& map = ptr->map();
-        if (map.empty()) {
+        if (ptr->size() == 0) {
+            ContainerT::Destroy(ptr);
             return 0;
         }
         int max = 0;
         int size = 0;
-        for (auto iter = map.begin(); iter != map.end(); ++iter) {
-            size += iter->second;
-            if (iter->second > max) {
-                max = iter->second;
+        ptr->ForEach([&max, &size](const typename ContainerT::StorageK&,
+                                   const int64_t& count) {
+            size += count;
+            if (count > max) {
+                max = count;
             }
-        }
+        });
         double maxRatio = static_cast<double>(max) / size;
         ContainerT::Destroy(ptr);
         return maxRatio;
@@ -431,7 +441,7 @@ struct FZTop1Ratio {
 
 template <typename K>
 struct FZTopNFrequency {
-    static const size_t MAXIMUM_TOPN = 1024;
+    static constexpr size_t MAXIMUM_TOPN = 1024;
 
     // we need store top_n config in state
     class TopNContainer
@@ -457,18 +467,15 @@ struct FZTopNFrequency {
 
     static TopNContainer* Update(TopNContainer* ptr, InputK key,
                                  bool is_key_null, int32_t top_n) {
-        auto& map = ptr->map();
         ptr->top_n_ = top_n;
         if (is_key_null) {
             return ptr;
         }
         auto stored_key = TopNContainer::to_stored_key(key);
-        auto iter = map.find(stored_key);
-        if (iter == map.end()) {
-            map.insert(iter, {stored_key, 1});
-        } else {
-            auto& single = iter->second;
-            single += 1;
+        bool inserted = false;
+        auto single = ptr->Insert(stored_key, 1, &inserted);
+        if (!inserted) {
+            *single += 1;
         }
         return ptr;
     }
@@ -480,32 +487,33 @@ struct FZTopNFrequency {
             return;
         }
         size_t top_n = ptr->top_n_ < MAXIMUM_TOPN ? ptr->top_n_ : MAXIMUM_TOPN;
-        auto& map = ptr->map();
         using StorageK = typename container::ContainerStorageTypeTrait<K>::type;
         using Entry = std::pair<StorageK, size_t>;
-        auto cmp = [](Entry x, Entry y) {
-            if (x.second < y.second) {
-                return true;
-            } else if (x.second == y.second) {
-                return x.first > y.first;
-            } else {
-                return false;
-            }
-        };
-        std::priority_queue<Entry, std::vector<Entry>, decltype(cmp)> queue(
-            cmp);
-        for (auto iter = map.begin(); iter != map.end(); ++iter) {
-            queue.push({iter->first, iter->second});
-        }
+        std::vector<Entry> entries;
+        entries.reserve(ptr->size());
+        ptr->ForEach([&entries](const StorageK& key, const int64_t& count) {
+            entries.emplace_back(key, count);
+        });
+        // only the top n entries are ordered, in descending order of
+        // frequency and ascending order of key for the same frequency
+        size_t n = std::min(top_n, entries.size());
+        std::partial_sort(entries.begin(), entries.begin() + n, entries.end(),
+                          [](const Entry& x, const Entry& y) {
+                              return x.second > y.second ||
+                                     (x.second == y.second && x.first < y.first);
+                          });
         std::vector<StorageK> keys;
-        for (size_t i = 0; i < top_n; ++i) {
-            if (queue.empty()) {
-                break;
-            }
-            keys.emplace_back(queue.top().first);
-            queue.pop();
+        for (size_t i = 0; i < n; ++i) {
+            keys.emplace_back(entries[i].first);
         }
+        OutputKeys(keys, top_n, output);
+        TopNContainer::Destroy(ptr);
+    }
 
+    // output the keys joined by ',', padded with NULL to `top_n` keys
+    template <typename StorageK>
+    static void OutputKeys(const std::vector<StorageK>& keys, size_t top_n,
+                           codec::StringRef* output) {
         // estimate output length
         uint32_t str_len = 0;
         for (size_t i = 0; i < top_n; ++i) {
@@ -538,6 +546,61 @@ struct FZTopNFrequency {
         *(buffer + str_len - 1) = '\0';
         output->data_ = buffer;
         output->size_ = str_len - 1;
+    }
+};
+
+template <typename K>
+struct FZApproxTopNFrequency {
+    // at least MINIMUM_CAPACITY counters, and CAPACITY_FACTOR times of top_n
+    static constexpr size_t MINIMUM_CAPACITY = 64;
+    static constexpr size_t CAPACITY_FACTOR = 4;
+
+    class TopNContainer : public udf::container::SpaceSaving<K> {
+     public:
+        static void Init(TopNContainer* addr) { new (addr) TopNContainer(); }
+        static void Destroy(TopNContainer* ptr) { ptr->~TopNContainer(); }
+        size_t top_n_ = 0;
+    };
+
+    using InputK = typename TopNContainer::InputK;
+
+    void operator()(UdafRegistryHelper& helper) {  // NOLINT
+        std::string suffix =
+            ".opaque_space_saving_" + DataTypeTrait<K>::to_string() + "_";
+        helper.doc(helper.GetDoc())
+            .templates<StringRef, Opaque<TopNContainer>, Nullable<K>, int32_t>()
+            .init("approx_topn_frequency_init" + suffix, TopNContainer::Init)
+            .update("approx_topn_frequency_update" + suffix, Update)
+            .output("approx_topn_frequency_output" + suffix, Output);
+    }
+
+    static TopNContainer* Update(TopNContainer* ptr, InputK key,
+                                 bool is_key_null, int32_t top_n) {
+        if (ptr->capacity() == 0 && top_n > 0) {
+            ptr->top_n_ = std::min(static_cast<size_t>(top_n),
+                                   FZTopNFrequency<K>::MAXIMUM_TOPN);
+            ptr->set_capacity(
+                std::max(ptr->top_n_ * CAPACITY_FACTOR, MINIMUM_CAPACITY));
+        }
+        if (!is_key_null) {
+            ptr->Push(key);
+        }
+        return ptr;
+    }
+
+    static void Output(TopNContainer* ptr, codec::StringRef* output) {
+        if (ptr->top_n_ == 0) {
+            output->data_ = "";
+            output->size_ = 0;
+            TopNContainer::Destroy(ptr);
+            return;
+        }
+        using StorageK = typename TopNContainer::StorageK;
+        std::vector<StorageK> keys;
+        for (auto& entry : ptr->Top(ptr->top_n_)) {
+            keys.emplace_back(entry.first);
+        }
+        FZTopNFrequency<K>::OutputKeys(keys, ptr->top_n_, output);
         TopNContainer::Destroy(ptr);
     }
 };
@@ -652,6 +715,16 @@ void DefaultUdfLibrary::InitFeatureZero() {
         @since 0.1.0)")
         .args_in<int16_t, int32_t, int64_t, float, double, Date, Timestamp,
                  StringRef>();
+
+    RegisterUdafTemplate<FZApproxTopNFrequency>("approx_topn_frequency")
+        .doc(R"(@brief Return the approximate topN keys sorted by their
+        frequency, counted by the space-saving algorithm in at most
+        max(4 * topN, 64) counters. The result is exact when the window has
+        no more distinct keys than the counters.
+
+        @since 0.4.0)")
+        .args_in<int16_t, int32_t, int64_t, float, double, Date, Timestamp,
+                 StringRef>();
 }
 
 }  // namespace udf
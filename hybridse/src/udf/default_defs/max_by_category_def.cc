@@ -63,17 +63,12 @@ struct MaxCateDef {
             if (is_key_null || is_value_null) {
                 return ptr;
             }
-            auto& map = ptr->map();
             auto stored_key = ContainerT::to_stored_key(key);
-            auto iter = map.find(stored_key);
-            if (iter == map.end()) {
-                map.insert(iter,
-                           {stored_key, ContainerT::to_stored_value(value)});
-            } else {
-                auto& single = iter->second;
-                if (single < ContainerT::to_stored_value(value)) {
-                    single = ContainerT::to_stored_value(value);
-                }
+            bool inserted = false;
+            auto stored_value = ContainerT::to_stored_value(value);
+            auto single = ptr->Insert(stored_key, stored_value, &inserted);
+            if (!inserted && *single < stored_value) {
+                *single = stored_value;
             }
             return ptr;
         }
@@ -180,9 +175,9 @@ struct TopKMaxCateWhereDef {
             if (cond && !is_cond_null) {
                 AvgCateImpl::Update(ptr, value, is_value_null, key,
                                     is_key_null);
-                auto& map = ptr->map();
-                if (bound >= 0 && map.size() > static_cast<size_t>(bound)) {
-                    map.erase(map.begin());
+                if (bound >= 0 &&
+                    ptr->size() > static_cast<size_t>(bound)) {
+                    ptr->EraseFirst();
                 }
             }
             return ptr;
@@ -64,17 +64,12 @@ struct MinCateDef {
             if (is_key_null || is_value_null) {
                 return ptr;
             }
-            auto& map = ptr->map();
             auto stored_key = ContainerT::to_stored_key(key);
-            auto iter = map.find(stored_key);
-            if (iter == map.end()) {
-                map.insert(iter,
-                           {stored_key, ContainerT::to_stored_value(value)});
-            } else {
-                auto& single = iter->second;
-                if (single > ContainerT::to_stored_value(value)) {
-                    single = ContainerT::to_stored_value(value);
-                }
+            bool inserted = false;
+            auto stored_value = ContainerT::to_stored_value(value);
+            auto single = ptr->Insert(stored_key, stored_value, &inserted);
+            if (!inserted && *single > stored_value) {
+                *single = stored_value;
             }
             return ptr;
         }
@@ -181,9 +176,9 @@ struct TopKMinCateWhereDef {
             if (cond && !is_cond_null) {
                 AvgCateImpl::Update(ptr, value, is_value_null, key,
                                     is_key_null);
-                auto& map = ptr->map();
-                if (bound >= 0 && map.size() > static_cast<size_t>(bound)) {
-                    map.erase(map.begin());
+                if (bound >= 0 &&
+                    ptr->size() > static_cast<size_t>(bound)) {
+                    ptr->EraseFirst();
                 }
             }
             return ptr;
@@ -55,6 +55,12 @@ void AtList(::hybridse::codec::ListRef<V>* list_ref, int64_t pos, V* v,
     }
 }
 
+template <class V>
+double SampleScaleList(::hybridse::codec::ListRef<V>* list_ref) {
+    auto list = (codec::ListV<V>*)(list_ref->list);
+    return list->GetSampleScale();
+}
+
 node::ExprNode* BuildAt(UdfResolveContext* ctx, ExprNode* input, ExprNode* idx,
                         ExprNode* default_val) {
     auto input_type = input->GetOutputType();
@@ -118,6 +124,31 @@ void RegisterBaseListAt(UdfLibrary* lib) {
         .template returns<Nullable<V>>();
 }
 
+template <typename V>
+void RegisterBaseListSampleScale(UdfLibrary* lib) {
+    lib->RegisterExternal("window_sample_scale")
+        .doc(R"(
+            @brief Returns the number of rows of the window each row of the
+            sampled window stands for, 1 if the window is not sampled.
+
+            The request mode windows are sampled by the window sample sizes of
+            the engine options.
+
+            @since 0.4.0
+        )")
+        .args<codec::ListRef<V>>(reinterpret_cast<void*>(SampleScaleList<V>))
+        .template returns<double>();
+}
+
+// the aggregation over the rows of the sampled window scaled to the window
+node::ExprNode* BuildScaledAggr(UdfResolveContext* ctx, const std::string& fn,
+                                ExprNode* input) {
+    auto nm = ctx->node_manager();
+    auto aggr = nm->MakeFuncNode(fn, {input}, nullptr);
+    auto scale = nm->MakeFuncNode("window_sample_scale", {input}, nullptr);
+    return nm->MakeBinaryExprNode(aggr, scale, node::kFnOpMulti);
+}
+
 void DefaultUdfLibrary::InitWindowFunctions() {
     // basic at impl for <list<V>, int32>
     RegisterBaseListAt<bool>(this);
@@ -136,6 +167,43 @@ void DefaultUdfLibrary::InitWindowFunctions() {
             return BuildAt(ctx, input, idx, nullptr);
         });
 
+    RegisterBaseListSampleScale<bool>(this);
+    RegisterBaseListSampleScale<int16_t>(this);
+    RegisterBaseListSampleScale<int32_t>(this);
+    RegisterBaseListSampleScale<int64_t>(this);
+    RegisterBaseListSampleScale<float>(this);
+    RegisterBaseListSampleScale<double>(this);
+    RegisterBaseListSampleScale<Date>(this);
+    RegisterBaseListSampleScale<Timestamp>(this);
+    RegisterBaseListSampleScale<StringRef>(this);
+
+    RegisterExprUdf("scaled_count")
+        .list_argument_at(0)
+        .args<AnyArg>([](UdfResolveContext* ctx, ExprNode* input) {
+            return BuildScaledAggr(ctx, "count", input);
+        })
+        .doc(R"(
+            @brief Returns the estimated number of the rows of the window, which
+            is the count of the rows of the sampled window scaled by
+            window_sample_scale, and the exact count if the window is not
+            sampled.
+
+            @since 0.4.0
+        )");
+    RegisterExprUdf("scaled_sum")
+        .list_argument_at(0)
+        .args<AnyArg>([](UdfResolveContext* ctx, ExprNode* input) {
+            return BuildScaledAggr(ctx, "sum", input);
+        })
+        .doc(R"(
+            @brief Returns the estimated sum of the values of the window, which
+            is the sum of the values of the sampled window scaled by
+            window_sample_scale, and the exact sum if the window is not
+            sampled.
+
+            @since 0.4.0
+        )");
+
     RegisterAlias("lag", "at");
     RegisterExprUdf("first_value")
         .list_argument_at(0)
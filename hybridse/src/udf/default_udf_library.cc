@@ -18,7 +18,6 @@
 
 #include <string>
 #include <tuple>
-#include <unordered_set>
 #include <utility>
 #include <vector>
 
@@ -256,10 +255,10 @@ struct AvgUdafDef {
 template <typename T>
 struct DistinctCountDef {
     using ArgT = typename DataTypeTrait<T>::CCallArgType;
-    using SetT = std::unordered_set<T>;
+    using SetT = container::HashSet<T>;
 
     void operator()(UdafRegistryHelper& helper) {  // NOLINT
-        std::string suffix = ".opaque_std_set_" + DataTypeTrait<T>::to_string();
+        std::string suffix = ".opaque_hash_set_" + DataTypeTrait<T>::to_string();
         helper.templates<int64_t, Opaque<SetT>, T>()
             .init("distinct_count_init" + suffix, init_set)
             .update("distinct_count_update" + suffix,
@@ -271,7 +270,6 @@ struct DistinctCountDef {
 
     static int64_t set_size(SetT* set) {
         int64_t size = set->size();
-        set->clear();
         set->~SetT();
         return size;
     }
@@ -279,7 +277,7 @@ struct DistinctCountDef {
     template <typename V>
     struct UpdateImpl {
         static SetT* update_set(SetT* set, V value) {
-            set->insert(value);
+            set->Insert(value);
             return set;
         }
     };
@@ -287,12 +285,39 @@ struct DistinctCountDef {
     template <typename V>
     struct UpdateImpl<V*> {
         static SetT* update_set(SetT* set, V* value) {
-            set->insert(*value);
+            set->Insert(*value);
             return set;
         }
     };
 };
 
+template <typename T>
+struct ApproxDistinctCountDef {
+    using ContainerT = container::HyperLogLog<T>;
+    using InputT = typename ContainerT::InputT;
+
+    void operator()(UdafRegistryHelper& helper) {  // NOLINT
+        std::string suffix = ".opaque_hll_" + DataTypeTrait<T>::to_string();
+        helper.templates<int64_t, Opaque<ContainerT>, Nullable<T>>()
+            .init("approx_distinct_count_init" + suffix, ContainerT::Init)
+            .update("approx_distinct_count_update" + suffix, Update)
+            .output("approx_distinct_count_output" + suffix, Output);
+    }
+
+    static ContainerT* Update(ContainerT* ptr, InputT value, bool is_null) {
+        if (!is_null) {
+            ptr->Push(value);
+        }
+        return ptr;
+    }
+
+    static int64_t Output(ContainerT* ptr) {
+        int64_t estimate = ptr->Estimate();
+        ContainerT::Destroy(ptr);
+        return estimate;
+    }
+};
+
 template <typename T>
 struct SumWhereDef {
     void operator()(UdafRegistryHelper& helper) {  // NOLINT
@@ -562,6 +587,7 @@ void DefaultUdfLibrary::InitStringUdf() {
         .args<StringRef, int32_t>(
             static_cast<void (*)(codec::StringRef*, int32_t,
                                  codec::StringRef*)>(udf::v1::sub_string))
+        .deterministic()
         .return_by_arg(true)
         .doc(R"(
             @brief Return a substring from string `str` starting at position `pos `.
@@ -591,6 +617,7 @@ void DefaultUdfLibrary::InitStringUdf() {
         .args<StringRef, int32_t, int32_t>(
             static_cast<void (*)(codec::StringRef*, int32_t, int32_t,
                                  codec::StringRef*)>(udf::v1::sub_string))
+        .deterministic()
         .return_by_arg(true)
         .doc(R"(
             @brief Return a substring `len` characters long from string str, starting at position `pos`.
@@ -621,6 +648,7 @@ void DefaultUdfLibrary::InitStringUdf() {
         .args<StringRef, StringRef>(
             static_cast<int32_t (*)(codec::StringRef*, codec::StringRef*)>(
                 udf::v1::strcmp))
+        .deterministic()
         .doc(R"(
             @brief Returns 0 if the strings are the same, -1 if the first argument is smaller than the second according to the current sort order, and 1 otherwise.
 
@@ -638,10 +666,43 @@ void DefaultUdfLibrary::InitStringUdf() {
             @endcode
 
             @since 0.1.0)");
+    RegisterExternal("like_match")
+        .args<StringRef, StringRef>(udf::v1::like_match)
+        .doc(R"(
+            @brief Returns true if the string matches the pattern, where '%' matches any sequence of characters, '_' matches any single character and '\' escapes the next character. `str LIKE pattern` is computed by this function.
+
+            Example:
+
+            @code{.sql}
+
+                select like_match("hybridse", "hy%se");
+                -- output true
+                select "hybridse" like "hy_e%";
+                -- output false
+
+            @endcode
+
+            @since 0.4.0)");
+    RegisterExternal("ilike_match")
+        .args<StringRef, StringRef>(udf::v1::ilike_match)
+        .doc(R"(
+            @brief Same as like_match but compares the ASCII letters case insensitive.
+
+            Example:
+
+            @code{.sql}
+
+                select ilike_match("HybridSE", "hy%se");
+                -- output true
+
+            @endcode
+
+            @since 0.4.0)");
     RegisterExternal("date_format")
         .args<Timestamp, StringRef>(
             static_cast<void (*)(codec::Timestamp*, codec::StringRef*,
                                  codec::StringRef*)>(udf::v1::date_format))
+        .deterministic()
         .return_by_arg(true)
         .doc(R"(
             @brief Formats the datetime value according to the format string.
@@ -656,6 +717,7 @@ void DefaultUdfLibrary::InitStringUdf() {
         .args<Date, StringRef>(
             static_cast<void (*)(codec::Date*, codec::StringRef*,
                                  codec::StringRef*)>(udf::v1::date_format))
+        .deterministic()
         .return_by_arg(true)
         .doc(R"(
             @brief Formats the date value according to the format string.
@@ -1428,6 +1490,7 @@ void DefaultUdfLibrary::InitTypeUdf() {
         .args<codec::Timestamp>(reinterpret_cast<void*>(
             static_cast<void (*)(Timestamp*, Date*, bool*)>(
                 v1::timestamp_to_date)))
+        .deterministic()
         .return_by_arg(true)
         .returns<Nullable<Date>>()
         .doc(R"(
@@ -1446,6 +1509,7 @@ void DefaultUdfLibrary::InitTypeUdf() {
         .args<codec::StringRef>(reinterpret_cast<void*>(
             static_cast<void (*)(StringRef*, Date*, bool*)>(
                 v1::string_to_date)))
+        .deterministic()
         .return_by_arg(true)
         .returns<Nullable<Date>>();
 
@@ -1453,6 +1517,7 @@ void DefaultUdfLibrary::InitTypeUdf() {
         .args<codec::Date>(reinterpret_cast<void*>(
             static_cast<void (*)(Date*, Timestamp*, bool*)>(
                 v1::date_to_timestamp)))
+        .deterministic()
         .return_by_arg(true)
         .returns<Nullable<Timestamp>>()
         .doc(R"(
@@ -1480,6 +1545,7 @@ void DefaultUdfLibrary::InitTypeUdf() {
         .args<codec::StringRef>(reinterpret_cast<void*>(
             static_cast<void (*)(StringRef*, Timestamp*, bool*)>(
                 v1::string_to_timestamp)))
+        .deterministic()
         .return_by_arg(true)
         .returns<Nullable<Timestamp>>();
 }
@@ -1902,6 +1968,32 @@ void DefaultUdfLibrary::InitUdaf() {
         .args_in<bool, int16_t, int32_t, int64_t, float, double, Timestamp,
                  Date, StringRef>();
 
+    RegisterUdafTemplate<ApproxDistinctCountDef>("approx_distinct_count")
+        .doc(R"(
+            @brief Estimate number of distinct values with a HyperLogLog
+            sketch of 4KB, whose standard error is about 1.6%. Null values
+            are skipped.
+
+            @param value  Specify value column to aggregate on.
+
+            Example:
+
+            |value|
+            |--|
+            |0|
+            |0|
+            |2|
+            |2|
+            |4|
+            @code{.sql}
+                SELECT approx_distinct_count(value) OVER w;
+                -- output 3
+            @endcode
+            @since 0.4.0
+        )")
+        .args_in<bool, int16_t, int32_t, int64_t, float, double, Timestamp,
+                 Date, StringRef>();
+
     RegisterUdafTemplate<SumWhereDef>("sum_where")
         .doc(R"(
             @brief Compute sum of values match specified condition
@@ -0,0 +1,292 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "udf/simd_string.h"
+
+#include <cstring>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace hybridse {
+namespace udf {
+namespace simd {
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#define HYBRIDSE_SIMD_STRING 1
+
+#if defined(__AVX2__)
+typedef __m256i Vec;
+static constexpr size_t VEC_SIZE = 32;
+static constexpr uint32_t FULL_MASK = 0xFFFFFFFFu;
+static inline Vec Load(const char* p) {
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+}
+static inline Vec Splat(char c) { return _mm256_set1_epi8(c); }
+static inline uint32_t EqMask(Vec a, Vec b) {
+    return static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(a, b)));
+}
+// 'A' - 'Z' to 'a' - 'z', bytes over 0x7f are negative and not in range
+static inline Vec Lower(Vec v) {
+    Vec upper = _mm256_and_si256(_mm256_cmpgt_epi8(v, Splat('A' - 1)),
+                                 _mm256_cmpgt_epi8(Splat('Z' + 1), v));
+    return _mm256_or_si256(v, _mm256_and_si256(upper, Splat(0x20)));
+}
+#else
+typedef __m128i Vec;
+static constexpr size_t VEC_SIZE = 16;
+static constexpr uint32_t FULL_MASK = 0xFFFFu;
+static inline Vec Load(const char* p) {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+}
+static inline Vec Splat(char c) { return _mm_set1_epi8(c); }
+static inline uint32_t EqMask(Vec a, Vec b) {
+    return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(a, b)));
+}
+static inline Vec Lower(Vec v) {
+    Vec upper = _mm_and_si128(_mm_cmpgt_epi8(v, Splat('A' - 1)),
+                              _mm_cmplt_epi8(v, Splat('Z' + 1)));
+    return _mm_or_si128(v, _mm_and_si128(upper, Splat(0x20)));
+}
+#endif
+#endif
+
+static inline char LowerByte(char c) {
+    return (c >= 'A' && c <= 'Z') ? static_cast<char>(c | 0x20) : c;
+}
+
+static inline char UpperByte(char c) {
+    return (c >= 'a' && c <= 'z') ? static_cast<char>(c & ~0x20) : c;
+}
+
+const char* FindByte(const char* begin, const char* end, char c) {
+    // glibc memchr is vectorized and dispatched at run time already
+    if (begin >= end) {
+        return end;
+    }
+    auto pos = memchr(begin, c, end - begin);
+    return pos == nullptr ? end : static_cast<const char*>(pos);
+}
+
+const char* FindAnyOf(const char* begin, const char* end, char c1, char c2) {
+    if (c1 == c2) {
+        return FindByte(begin, end, c1);
+    }
+    const char* cur = begin;
+#ifdef HYBRIDSE_SIMD_STRING
+    Vec s1 = Splat(c1);
+    Vec s2 = Splat(c2);
+    for (; cur + VEC_SIZE <= end; cur += VEC_SIZE) {
+        Vec v = Load(cur);
+        uint32_t mask = EqMask(v, s1) | EqMask(v, s2);
+        if (mask != 0) {
+            return cur + __builtin_ctz(mask);
+        }
+    }
+#endif
+    for (; cur < end; ++cur) {
+        if (*cur == c1 || *cur == c2) {
+            return cur;
+        }
+    }
+    return end;
+}
+
+const char* FindSubstr(const char* begin, const char* end, const char* needle,
+                       size_t needle_size) {
+    if (needle_size == 0) {
+        return begin;
+    }
+    if (needle_size == 1) {
+        return FindByte(begin, end, needle[0]);
+    }
+    if (begin + needle_size > end) {
+        return end;
+    }
+    const char* cur = begin;
+#ifdef HYBRIDSE_SIMD_STRING
+    // compare the first and the last byte of the needle at VEC_SIZE
+    // positions at once, only the candidates match both are compared fully
+    Vec first = Splat(needle[0]);
+    Vec last = Splat(needle[needle_size - 1]);
+    for (; cur + needle_size - 1 + VEC_SIZE <= end; cur += VEC_SIZE) {
+        uint32_t mask = EqMask(Load(cur), first) &
+                        EqMask(Load(cur + needle_size - 1), last);
+        while (mask != 0) {
+            uint32_t offset = __builtin_ctz(mask);
+            if (memcmp(cur + offset + 1, needle + 1, needle_size - 2) == 0) {
+                return cur + offset;
+            }
+            mask &= mask - 1;
+        }
+    }
+#endif
+    for (; cur + needle_size <= end; ++cur) {
+        if (*cur == needle[0] && memcmp(cur, needle, needle_size) == 0) {
+            return cur;
+        }
+    }
+    return end;
+}
+
+int32_t CaseCompare(const char* a, size_t a_size, const char* b,
+                    size_t b_size) {
+    size_t min_size = a_size < b_size ? a_size : b_size;
+    size_t i = 0;
+#ifdef HYBRIDSE_SIMD_STRING
+    for (; i + VEC_SIZE <= min_size; i += VEC_SIZE) {
+        uint32_t mask = EqMask(Lower(Load(a + i)), Lower(Load(b + i)));
+        if (mask != FULL_MASK) {
+            // fall to the byte loop from the first different byte
+            i += __builtin_ctz(~mask);
+            break;
+        }
+    }
+#endif
+    for (; i < min_size; ++i) {
+        auto x = static_cast<uint8_t>(LowerByte(a[i]));
+        auto y = static_cast<uint8_t>(LowerByte(b[i]));
+        if (x != y) {
+            return x < y ? -1 : 1;
+        }
+    }
+    if (a_size == b_size) {
+        return 0;
+    }
+    return a_size < b_size ? -1 : 1;
+}
+
+// return the first occurrence of the needle ignoring ASCII case
+static const char* CaseFindSubstr(const char* begin, const char* end,
+                                  const char* needle, size_t needle_size) {
+    if (needle_size == 0) {
+        return begin;
+    }
+    char lower = LowerByte(needle[0]);
+    char upper = UpperByte(needle[0]);
+    const char* cur = begin;
+    while (cur + needle_size <= end) {
+        cur = FindAnyOf(cur, end - needle_size + 1, lower, upper);
+        if (cur + needle_size > end) {
+            break;
+        }
+        if (CaseCompare(cur, needle_size, needle, needle_size) == 0) {
+            return cur;
+        }
+        ++cur;
+    }
+    return end;
+}
+
+static inline bool ByteEquals(char x, char y, bool case_insensitive) {
+    return x == y || (case_insensitive && LowerByte(x) == LowerByte(y));
+}
+
+// greedy matching which backtracks to the last '%' only
+static bool MatchGeneral(const char* str, size_t str_size, const char* pattern,
+                         size_t pattern_size, bool case_insensitive) {
+    size_t i = 0;
+    size_t j = 0;
+    size_t star_j = pattern_size + 1;
+    size_t star_i = 0;
+    while (i < str_size) {
+        if (j < pattern_size && pattern[j] == '%') {
+            star_j = ++j;
+            star_i = i;
+            continue;
+        }
+        if (j < pattern_size) {
+            char pc = pattern[j];
+            size_t token_size = 1;
+            bool any = false;
+            if (pc == '\\' && j + 1 < pattern_size) {
+                pc = pattern[j + 1];
+                token_size = 2;
+            } else if (pc == '_') {
+                any = true;
+            }
+            if (any || ByteEquals(str[i], pc, case_insensitive)) {
+                ++i;
+                j += token_size;
+                continue;
+            }
+        }
+        if (star_j <= pattern_size) {
+            // let the last '%' take one more byte
+            i = ++star_i;
+            j = star_j;
+            continue;
+        }
+        return false;
+    }
+    while (j < pattern_size && pattern[j] == '%') {
+        ++j;
+    }
+    return j == pattern_size;
+}
+
+bool LikeMatch(const char* str, size_t str_size, const char* pattern,
+               size_t pattern_size, bool case_insensitive) {
+    // find the literal between the leading and the trailing '%'
+    size_t lit_begin = 0;
+    while (lit_begin < pattern_size && pattern[lit_begin] == '%') {
+        ++lit_begin;
+    }
+    if (lit_begin == pattern_size) {
+        // empty pattern matches empty string only, '%...' matches any
+        return pattern_size > 0 || str_size == 0;
+    }
+    size_t lit_end = pattern_size;
+    while (pattern[lit_end - 1] == '%') {
+        --lit_end;
+    }
+    const char* lit = pattern + lit_begin;
+    size_t lit_size = lit_end - lit_begin;
+    for (size_t k = 0; k < lit_size; ++k) {
+        if (lit[k] == '%' || lit[k] == '_' || lit[k] == '\\') {
+            return MatchGeneral(str, str_size, pattern, pattern_size,
+                                case_insensitive);
+        }
+    }
+    bool any_prefix = lit_begin > 0;
+    bool any_suffix = lit_end < pattern_size;
+    if (lit_size > str_size) {
+        return false;
+    }
+    if (!any_prefix && !any_suffix) {
+        return lit_size == str_size &&
+               (case_insensitive ? CaseCompare(str, str_size, lit, lit_size) == 0
+                                 : memcmp(str, lit, lit_size) == 0);
+    }
+    if (!any_prefix) {
+        return case_insensitive ? CaseCompare(str, lit_size, lit, lit_size) == 0
+                                : memcmp(str, lit, lit_size) == 0;
+    }
+    if (!any_suffix) {
+        const char* tail = str + str_size - lit_size;
+        return case_insensitive
+                   ? CaseCompare(tail, lit_size, lit, lit_size) == 0
+                   : memcmp(tail, lit, lit_size) == 0;
+    }
+    const char* end = str + str_size;
+    return (case_insensitive ? CaseFindSubstr(str, end, lit, lit_size)
+                             : FindSubstr(str, end, lit, lit_size)) != end;
+}
+
+}  // namespace simd
+}  // namespace udf
+}  // namespace hybridse
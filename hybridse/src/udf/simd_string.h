@@ -0,0 +1,60 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_UDF_SIMD_STRING_H_
+#define SRC_UDF_SIMD_STRING_H_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace hybridse {
+namespace udf {
+namespace simd {
+
+/**
+ * String kernels of the string udfs, which scan 16 bytes (SSE2, or 32 bytes
+ * when built with AVX2) at a time on x86-64 and fall back to byte loops
+ * elsewhere. All of them work on bytes, case folding is ASCII only.
+ */
+
+// return the first occurrence of `c` in [begin, end), or `end`
+const char* FindByte(const char* begin, const char* end, char c);
+
+// return the first occurrence of either `c1` or `c2` in [begin, end), or `end`
+const char* FindAnyOf(const char* begin, const char* end, char c1, char c2);
+
+// return the first occurrence of the needle in [begin, end), or `end`
+const char* FindSubstr(const char* begin, const char* end, const char* needle,
+                       size_t needle_size);
+
+// compare as strcmp does after ASCII lower casing both strings
+int32_t CaseCompare(const char* a, size_t a_size, const char* b,
+                    size_t b_size);
+
+/**
+ * Match the string against a SQL LIKE pattern, where '%' matches any
+ * sequence, '_' matches any single byte and '\' escapes the next byte.
+ * A pattern which is a literal with '%' at either end is matched by the
+ * kernels above rather than the general backtracking matcher.
+ */
+bool LikeMatch(const char* str, size_t str_size, const char* pattern,
+               size_t pattern_size, bool case_insensitive);
+
+}  // namespace simd
+}  // namespace udf
+}  // namespace hybridse
+
+#endif  // SRC_UDF_SIMD_STRING_H_
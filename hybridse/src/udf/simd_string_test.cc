@@ -0,0 +1,129 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "udf/simd_string.h"
+
+#include <algorithm>
+#include <random>
+#include <string>
+
+#include "gtest/gtest.h"
+
+namespace hybridse {
+namespace udf {
+namespace simd {
+
+class SimdStringTest : public ::testing::Test {};
+
+static std::string RandomString(std::mt19937* rng, size_t size) {
+    static const char CHARS[] = "abAB,:";
+    std::string str(size, ' ');
+    for (auto& c : str) {
+        c = CHARS[(*rng)() % (sizeof(CHARS) - 1)];
+    }
+    return str;
+}
+
+static bool Like(const std::string& str, const std::string& pattern,
+                 bool case_insensitive = false) {
+    return LikeMatch(str.data(), str.size(), pattern.data(), pattern.size(),
+                     case_insensitive);
+}
+
+TEST_F(SimdStringTest, FindTest) {
+    std::mt19937 rng(42);
+    for (int round = 0; round < 2000; ++round) {
+        std::string str = RandomString(&rng, rng() % 100);
+        std::string needle = RandomString(&rng, 1 + rng() % 4);
+        const char* begin = str.data();
+        const char* end = str.data() + str.size();
+
+        size_t expect = str.find(needle);
+        const char* pos =
+            FindSubstr(begin, end, needle.data(), needle.size());
+        ASSERT_EQ(expect == std::string::npos ? str.size() : expect,
+                  static_cast<size_t>(pos - begin))
+            << str << " " << needle;
+
+        expect = str.find_first_of(needle.substr(0, 2));
+        pos = FindAnyOf(begin, end, needle[0], needle[needle.size() > 1]);
+        ASSERT_EQ(expect == std::string::npos ? str.size() : expect,
+                  static_cast<size_t>(pos - begin));
+    }
+}
+
+TEST_F(SimdStringTest, CaseCompareTest) {
+    std::mt19937 rng(7);
+    for (int round = 0; round < 2000; ++round) {
+        std::string a = RandomString(&rng, rng() % 70);
+        std::string b = a;
+        if (!b.empty() && rng() % 2 == 0) {
+            b[rng() % b.size()] = 'b';
+        }
+        if (rng() % 4 == 0) {
+            b.resize(rng() % (b.size() + 1));
+        }
+        std::string lower_a = a;
+        std::string lower_b = b;
+        std::transform(lower_a.begin(), lower_a.end(), lower_a.begin(),
+                       ::tolower);
+        std::transform(lower_b.begin(), lower_b.end(), lower_b.begin(),
+                       ::tolower);
+        int expect = lower_a.compare(lower_b);
+        expect = expect < 0 ? -1 : (expect > 0 ? 1 : 0);
+        ASSERT_EQ(expect, CaseCompare(a.data(), a.size(), b.data(), b.size()))
+            << a << " " << b;
+    }
+    // bytes over 0x7f are not folded
+    ASSERT_NE(0, CaseCompare("\xc1", 1, "\xe1", 1));
+}
+
+TEST_F(SimdStringTest, LikeMatchTest) {
+    ASSERT_TRUE(Like("", ""));
+    ASSERT_FALSE(Like("a", ""));
+    ASSERT_TRUE(Like("", "%"));
+    ASSERT_TRUE(Like("hybridse", "hybridse"));
+    ASSERT_FALSE(Like("hybridse", "hybrid"));
+    ASSERT_TRUE(Like("hybridse", "hy%"));
+    ASSERT_TRUE(Like("hybridse", "%se"));
+    ASSERT_TRUE(Like("hybridse", "%bri%"));
+    ASSERT_FALSE(Like("hybridse", "%brx%"));
+    ASSERT_TRUE(Like("hybridse", "hy_rid%"));
+    ASSERT_TRUE(Like("hybridse", "h%r%e"));
+    ASSERT_FALSE(Like("hybridse", "h%r%x"));
+    ASSERT_TRUE(Like("a%b", "a\\%b"));
+    ASSERT_FALSE(Like("axb", "a\\%b"));
+    ASSERT_TRUE(Like("a_b", "a\\_b"));
+    ASSERT_FALSE(Like("axb", "a\\_b"));
+    ASSERT_TRUE(Like("HybridSE", "hy%se", true));
+    ASSERT_FALSE(Like("HybridSE", "hy%se", false));
+    ASSERT_TRUE(Like("HybridSE", "%BRID%", true));
+    ASSERT_TRUE(Like("HybridSE", "h_B%", true));
+    std::string long_str(100, 'a');
+    long_str += "needle";
+    ASSERT_TRUE(Like(long_str, "%needle%"));
+    ASSERT_TRUE(Like(long_str, "%NEEDLE", true));
+    ASSERT_TRUE(Like(long_str, "%a_ee%"));
+}
+
+}  // namespace simd
+}  // namespace udf
+}  // namespace hybridse
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
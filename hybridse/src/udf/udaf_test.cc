@@ -14,6 +14,7 @@
  * limitations under the License.
  */
 
+#include "udf/containers.h"
 #include "udf/udf_test.h"
 
 namespace hybridse {
@@ -194,6 +195,120 @@ TEST_F(UdafTest, topk_test) {
         "top", StringRef(""), MakeList<int32_t>({}), MakeList<int32_t>({}));
 }
 
+TEST_F(UdafTest, distinct_count_test) {
+    CheckUdf<int64_t, ListRef<int32_t>>(
+        "distinct_count", 3, MakeList<int32_t>({0, 0, 2, 2, 4}));
+    CheckUdf<int64_t, ListRef<StringRef>>(
+        "distinct_count", 2,
+        MakeList<StringRef>({StringRef("a"), StringRef("b"), StringRef("a")}));
+    CheckUdf<int64_t, ListRef<int32_t>>("distinct_count", 0,
+                                        MakeList<int32_t>({}));
+}
+
+TEST_F(UdafTest, approx_distinct_count_test) {
+    CheckUdf<int64_t, ListRef<Nullable<int32_t>>>(
+        "approx_distinct_count", 3,
+        MakeList<Nullable<int32_t>>({0, 0, 2, nullptr, 2, 4}));
+    CheckUdf<int64_t, ListRef<StringRef>>(
+        "approx_distinct_count", 2,
+        MakeList<StringRef>({StringRef("a"), StringRef("b"), StringRef("a")}));
+    CheckUdf<int64_t, ListRef<int64_t>>("approx_distinct_count", 0,
+                                        MakeList<int64_t>({}));
+
+    container::HyperLogLog<int64_t> hll;
+    for (int64_t i = 0; i < 100000; ++i) {
+        hll.Push(i * 1024);
+        hll.Push(i * 1024);
+    }
+    ASSERT_NEAR(100000, hll.Estimate(), 100000 * 0.05);
+}
+
+TEST_F(UdafTest, hash_map_test) {
+    container::HashMap<int32_t, int32_t> map;
+    for (int32_t i = 0; i < 1000; ++i) {
+        bool inserted = false;
+        map.Insert(i * 16, i, &inserted);
+        ASSERT_TRUE(inserted);
+    }
+    for (int32_t i = 0; i < 1000; i += 2) {
+        ASSERT_TRUE(map.Erase(i * 16));
+    }
+    ASSERT_FALSE(map.Erase(0));
+    ASSERT_EQ(500u, map.size());
+    for (int32_t i = 0; i < 1000; ++i) {
+        auto value = map.Find(i * 16);
+        if (i % 2 == 0) {
+            ASSERT_EQ(nullptr, value);
+        } else {
+            ASSERT_NE(nullptr, value);
+            ASSERT_EQ(i, *value);
+        }
+    }
+}
+
+TEST_F(UdafTest, group_by_dict_test) {
+    using DictT = container::BoundedGroupByDict<StringRef, int64_t>;
+    std::vector<std::string> keys;
+    for (int i = 0; i < 100; ++i) {
+        keys.push_back("city_" + std::to_string(i % 10));
+    }
+    DictT dict;
+    for (auto& key : keys) {
+        bool inserted = false;
+        auto value = dict.Insert(StringRef(key), 1, &inserted);
+        if (!inserted) {
+            *value += 1;
+        }
+    }
+    ASSERT_EQ(10u, dict.size());
+    dict.ForEach([](const StringRef&, const int64_t& count) {
+        ASSERT_EQ(10, count);
+    });
+    auto entries = dict.SortedEntries(true);
+    ASSERT_EQ(StringRef("city_9"), entries.front().first);
+    ASSERT_EQ(StringRef("city_0"), entries.back().first);
+    dict.EraseFirst();
+    ASSERT_EQ(StringRef("city_1"), dict.SortedEntries().front().first);
+    bool inserted = false;
+    ASSERT_EQ(1, *dict.Insert(StringRef("city_0"), 1, &inserted));
+    ASSERT_TRUE(inserted);
+    ASSERT_EQ(10, *dict.Insert(StringRef("city_1"), 1, &inserted));
+    ASSERT_FALSE(inserted);
+
+    CheckUdf<StringRef, ListRef<int32_t>, ListRef<StringRef>>(
+        "count_cate", StringRef("x:3,y:2"), MakeList<int32_t>({0, 1, 2, 3, 4}),
+        MakeList<StringRef>({StringRef("x"), StringRef("y"), StringRef("x"),
+                             StringRef("y"), StringRef("x")}));
+}
+
+TEST_F(UdafTest, approx_topn_frequency_test) {
+    CheckUdf<StringRef, ListRef<Nullable<int32_t>>, ListRef<int32_t>>(
+        "approx_topn_frequency", StringRef("3,1,2"),
+        MakeList<Nullable<int32_t>>({1, 3, nullptr, 2, 3, 1, 3}),
+        MakeList<int32_t>({3, 3, 3, 3, 3, 3, 3}));
+    // padded with NULL
+    CheckUdf<StringRef, ListRef<StringRef>, ListRef<int32_t>>(
+        "approx_topn_frequency", StringRef("b,a,NULL"),
+        MakeList<StringRef>({StringRef("a"), StringRef("b"), StringRef("b")}),
+        MakeList<int32_t>({3, 3, 3}));
+    // same as the exact one
+    CheckUdf<StringRef, ListRef<int32_t>, ListRef<int32_t>>(
+        "fz_topn_frequency", StringRef("3,1"),
+        MakeList<int32_t>({1, 3, 2, 3, 1, 3}),
+        MakeList<int32_t>({2, 2, 2, 2, 2, 2}));
+
+    // the frequent keys survive a long tail of distinct keys
+    container::SpaceSaving<int32_t> summary;
+    summary.set_capacity(64);
+    for (int32_t i = 0; i < 10000; ++i) {
+        summary.Push(i % 4 == 0 ? 1 : (i % 4 == 1 ? 2 : 100 + i));
+    }
+    auto top = summary.Top(2);
+    ASSERT_EQ(2u, top.size());
+    ASSERT_EQ(1, top[0].first);
+    ASSERT_EQ(2, top[1].first);
+}
+
 TEST_F(UdafTest, sum_cate_test) {
     CheckUdf<StringRef, ListRef<int32_t>, ListRef<int32_t>>(
         "sum_cate", StringRef("1:4,2:6"), MakeList<int32_t>({1, 2, 3, 4}),
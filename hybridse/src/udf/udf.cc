@@ -16,10 +16,15 @@
 
 #include "udf/udf.h"
 #include <stdint.h>
+#include <string.h>
 #include <time.h>
+#include <functional>
 #include <map>
+#include <memory>
 #include <set>
+#include <type_traits>
 #include <utility>
+#include <vector>
 #include "base/iterator.h"
 #include "boost/date_time.hpp"
 #include "boost/date_time/gregorian/parsers.hpp"
@@ -32,8 +37,10 @@
 #include "codegen/fn_ir_builder.h"
 #include "node/node_manager.h"
 #include "node/sql_node.h"
+#include "udf/civil_time.h"
 #include "udf/default_udf_library.h"
 #include "udf/literal_traits.h"
+#include "udf/simd_string.h"
 #include "vm/jit_runtime.h"
 
 namespace hybridse {
@@ -45,86 +52,68 @@ using hybridse::codec::ListRef;
 using hybridse::codec::ListV;
 using hybridse::codec::Row;
 using hybridse::codec::StringRef;
-// TODO(chenjing): 时区统一配置
-const int32_t TZ = 8;
-const time_t TZ_OFFSET = TZ * 3600000;
 bthread_key_t B_THREAD_LOCAL_MEM_POOL_KEY;
 
-int32_t dayofmonth(int64_t ts) {
-    time_t time = (ts + TZ_OFFSET) / 1000;
-    struct tm t;
-    gmtime_r(&time, &t);
-    return t.tm_mday;
-}
-int32_t dayofweek(int64_t ts) {
-    time_t time = (ts + TZ_OFFSET) / 1000;
-    struct tm t;
-    gmtime_r(&time, &t);
-    return t.tm_wday + 1;
-}
-int32_t weekofyear(int64_t ts) {
-    time_t time = (ts + TZ_OFFSET) / 1000;
-    struct tm t;
-    gmtime_r(&time, &t);
-    try {
-        boost::gregorian::date d = boost::gregorian::date_from_tm(t);
-        return d.week_number();
-    } catch (...) {
-        return 0;
-    }
-}
-int32_t month(int64_t ts) {
-    time_t time = (ts + TZ_OFFSET) / 1000;
-    struct tm t;
-    gmtime_r(&time, &t);
-    return t.tm_mon + 1;
-}
-int32_t year(int64_t ts) {
-    time_t time = (ts + TZ_OFFSET) / 1000;
-    struct tm t;
-    gmtime_r(&time, &t);
-    return t.tm_year + 1900;
-}
+int32_t dayofmonth(int64_t ts) { return DayOfMonthOfTs(ts); }
+int32_t dayofweek(int64_t ts) { return DayOfWeekOfTs(ts); }
+int32_t weekofyear(int64_t ts) { return WeekOfYearOfTs(ts); }
+int32_t month(int64_t ts) { return MonthOfTs(ts); }
+int32_t year(int64_t ts) { return YearOfTs(ts); }
 
 int32_t dayofmonth(codec::Timestamp *ts) { return dayofmonth(ts->ts_); }
 int32_t weekofyear(codec::Timestamp *ts) { return weekofyear(ts->ts_); }
 int32_t month(codec::Timestamp *ts) { return month(ts->ts_); }
 int32_t year(codec::Timestamp *ts) { return year(ts->ts_); }
 int32_t dayofweek(codec::Timestamp *ts) { return dayofweek(ts->ts_); }
-int32_t dayofweek(codec::Date *date) {
-    int32_t day, month, year;
-    if (!codec::Date::Decode(date->date_, &year, &month, &day)) {
-        return 0;
+int32_t dayofweek(codec::Date *date) { return DayOfWeekOfDate(date->date_); }
+// Return the iso 8601 week number 1..53
+int32_t weekofyear(codec::Date *date) { return WeekOfYearOfDate(date->date_); }
+
+// write the digits of value padded by 0 to width, value is not negative
+static inline char *WriteDigits(char *buffer, int32_t value, int width) {
+    for (int i = width - 1; i >= 0; i--) {
+        buffer[i] = static_cast<char>('0' + value % 10);
+        value /= 10;
     }
-    try {
-        if (month <= 0 || month > 12) {
-            return 0;
-        } else if (day <= 0 || day > 31) {
-            return 0;
-        }
-        boost::gregorian::date d(year, month, day);
-        return d.day_of_week() + 1;
-    } catch (...) {
-        return 0;
+    return buffer + width;
+}
+// the formats of timestamp_to_string and date_to_string are written without
+// strftime, the years out of 4 digits are left to strftime
+static inline bool FastFormatDate(int32_t year, int32_t month, int32_t day,
+                                  char *buffer, size_t size) {
+    if (size < 11 || year < 1000 || year > 9999) {
+        return false;
     }
+    char *p = WriteDigits(buffer, year, 4);
+    *p++ = '-';
+    p = WriteDigits(p, month, 2);
+    *p++ = '-';
+    p = WriteDigits(p, day, 2);
+    *p = '\0';
+    return true;
 }
-// Return the iso 8601 week number 1..53
-int32_t weekofyear(codec::Date *date) {
-    int32_t day, month, year;
-    if (!codec::Date::Decode(date->date_, &year, &month, &day)) {
-        return 0;
+static inline bool FastFormatTimestamp(int64_t ts, const char *format,
+                                       char *buffer, size_t size) {
+    if (size < 20 || 0 != ::strcmp(format, "%Y-%m-%d %H:%M:%S")) {
+        return false;
     }
-    try {
-        if (month <= 0 || month > 12) {
-            return 0;
-        } else if (day <= 0 || day > 31) {
-            return 0;
-        }
-        boost::gregorian::date d(year, month, day);
-        return d.week_number();
-    } catch (...) {
-        return 0;
+    int64_t secs = LocalSeconds(ts);
+    int64_t days = FloorDiv(secs, 86400);
+    int32_t sod = static_cast<int32_t>(secs - days * 86400);
+    int32_t year, month, day;
+    CivilFromDays(days, &year, &month, &day);
+    if (!FastFormatDate(year, month, day, buffer, size)) {
+        return false;
     }
+    char *p = buffer + 10;
+    *p++ = ' ';
+    p = WriteDigits(p, sod / 3600, 2);
+    *p++ = ':';
+    p = WriteDigits(p, sod / 60 % 60, 2);
+    *p++ = ':';
+    p = WriteDigits(p, sod % 60, 2);
+    *p = '\0';
+    return true;
 }
 
 float Cotf(float x) { return cosf(x) / sinf(x); }
@@ -139,7 +128,10 @@ void date_format(codec::Timestamp *timestamp,
 }
 void date_format(const codec::Timestamp *timestamp, const char *format,
                  char *buffer, size_t size) {
-    time_t time = (timestamp->ts_ + TZ_OFFSET) / 1000;
+    if (FastFormatTimestamp(timestamp->ts_, format, buffer, size)) {
+        return;
+    }
+    time_t time = LocalSeconds(timestamp->ts_);
     struct tm t;
     gmtime_r(&time, &t);
     strftime(buffer, size, format, &t);
@@ -182,6 +174,11 @@ bool date_format(const codec::Date *date, const char *format, char *buffer,
         } else if (day <= 0 || day > 31) {
             return 0;
         }
+        if (0 == ::strcmp(format, "%Y-%m-%d") &&
+            IsValidCivil(year, month, day) &&
+            FastFormatDate(year, month, day, buffer, size)) {
+            return true;
+        }
         boost::gregorian::date g_date(year, month, day);
         tm t = boost::gregorian::to_tm(g_date);
         strftime(buffer, size, format, &t);
@@ -236,13 +233,9 @@ void bool_to_string(bool v, hybridse::codec::StringRef *output) {
 
 void timestamp_to_date(codec::Timestamp *timestamp,
                        hybridse::codec::Date *output, bool *is_null) {
-    time_t time = (timestamp->ts_ + TZ_OFFSET) / 1000;
-    struct tm t;
-    if (nullptr == gmtime_r(&time, &t)) {
-        *is_null = true;
-        return;
-    }
-    *output = codec::Date(t.tm_year + 1900, t.tm_mon + 1, t.tm_mday);
+    int32_t year, month, day;
+    CivilFromDays(LocalDays(timestamp->ts_), &year, &month, &day);
+    *output = codec::Date(year, month, day);
     *is_null = false;
     return;
 }
@@ -650,6 +643,16 @@ int32_t strcmp(hybridse::codec::StringRef *s1, hybridse::codec::StringRef *s2) {
     }
     return hybridse::codec::StringRef::compare(*s1, *s2);
 }
+bool like_match(hybridse::codec::StringRef *str,
+                hybridse::codec::StringRef *pattern) {
+    return simd::LikeMatch(str->data_, str->size_, pattern->data_,
+                           pattern->size_, false);
+}
+bool ilike_match(hybridse::codec::StringRef *str,
+                 hybridse::codec::StringRef *pattern) {
+    return simd::LikeMatch(str->data_, str->size_, pattern->data_,
+                           pattern->size_, true);
+}
 
 //
 
@@ -778,6 +781,58 @@ char *AllocManagedStringBuf(int32_t bytes) {
     return reinterpret_cast<char *>(vm::JitRuntime::get()->AllocManaged(bytes));
 }
 
+// The values of a column decoded from the rows of the window. It is
+// released with the run step.
+template <class V>
+class DecodedColumn : public base::FeBaseObject {
+ public:
+    explicit DecodedColumn(ListV<V> *column) : buffer_(), list_() {
+        buffer_.reserve(column->GetCount());
+        auto iter = column->GetIterator();
+        for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+            buffer_.push_back(iter->GetValue());
+        }
+        list_.reset(new codec::ArrayListV<V>(&buffer_));
+    }
+    ListV<V> *list() { return list_.get(); }
+
+ private:
+    std::vector<V> buffer_;
+    std::unique_ptr<codec::ArrayListV<V>> list_;
+};
+
+// The window is walked by every udaf over the column, so a column iterated
+// more than once is decoded into a buffer shared by the later iterations.
+// The first iteration walks the rows, as most columns are aggregated once.
+// only the columns of numbers are decoded
+template <class V>
+using IsDecodedColumn =
+    std::integral_constant<bool, std::is_arithmetic<V>::value &&
+                                     !std::is_same<V, bool>::value>;
+
+template <class V>
+static ListV<V> *GetSharedColumn(ListV<V> *list, std::true_type) {
+    auto column = dynamic_cast<codec::ColumnImpl<V> *>(list);
+    if (column == nullptr) {
+        return list;
+    }
+    if (column->GetDecoded() != nullptr) {
+        return column->GetDecoded();
+    }
+    if (column->IncIterCount() < 2) {
+        return list;
+    }
+    auto decoded = new DecodedColumn<V>(column);
+    vm::JitRuntime::get()->AddManagedObject(decoded);
+    column->SetDecoded(decoded->list());
+    return decoded->list();
+}
+
+template <class V>
+static ListV<V> *GetSharedColumn(ListV<V> *list, std::false_type) {
+    return list;
+}
+
 template <class V>
 bool iterator_list(int8_t *input, int8_t *output) {
     if (nullptr == input || nullptr == output) {
@@ -787,7 +842,8 @@ bool iterator_list(int8_t *input, int8_t *output) {
         (::hybridse::codec::ListRef<> *)(input);
     ::hybridse::codec::IteratorRef *iterator_ref =
         (::hybridse::codec::IteratorRef *)(output);
-    ListV<V> *col = (ListV<V> *)(list_ref->list);
+    ListV<V> *col =
+        GetSharedColumn((ListV<V> *)(list_ref->list), IsDecodedColumn<V>());
     auto col_iter = col->GetRawIterator();
     col_iter->SeekToFirst();
     iterator_ref->iterator = reinterpret_cast<int8_t *>(col_iter);
@@ -861,6 +917,137 @@ void delete_iterator(int8_t *input) {
     }
 }
 
+// the values decoded by the iterator are reduced in blocks of this size
+static const uint64_t LIST_BLOCK_SIZE = 256;
+
+// call fn on the contiguous blocks of values of the list
+template <class V, class F>
+static void ReduceListBlocks(int8_t *input, F &&fn) {
+    auto list_ref = reinterpret_cast<ListRef<> *>(input);
+    auto list = reinterpret_cast<ListV<V> *>(list_ref->list);
+    auto array = dynamic_cast<codec::ArrayListV<V> *>(list);
+    if (array != nullptr) {
+        fn(array->data(), array->GetCount());
+        return;
+    }
+    V block[LIST_BLOCK_SIZE];
+    uint64_t size = 0;
+    std::unique_ptr<ConstIterator<uint64_t, V>> iter(list->GetRawIterator());
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+        block[size++] = iter->GetValue();
+        if (size == LIST_BLOCK_SIZE) {
+            fn(block, size);
+            size = 0;
+        }
+    }
+    if (size > 0) {
+        fn(block, size);
+    }
+}
+
+// the four lanes have no dependency on each other, so the loop is vectorized
+template <class V>
+static V SumBuffer(const V *values, uint64_t size) {
+    V lanes[4] = {0, 0, 0, 0};
+    uint64_t i = 0;
+    for (; i + 4 <= size; i += 4) {
+        lanes[0] += values[i];
+        lanes[1] += values[i + 1];
+        lanes[2] += values[i + 2];
+        lanes[3] += values[i + 3];
+    }
+    V sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    for (; i < size; i++) {
+        sum += values[i];
+    }
+    return sum;
+}
+
+// size should be positive
+template <class V, class Cmp>
+static V SelectBuffer(const V *values, uint64_t size, Cmp cmp) {
+    V lanes[4] = {values[0], values[0], values[0], values[0]};
+    uint64_t i = 0;
+    for (; i + 4 <= size; i += 4) {
+        for (int k = 0; k < 4; k++) {
+            lanes[k] = cmp(values[i + k], lanes[k]) ? values[i + k] : lanes[k];
+        }
+    }
+    for (; i < size; i++) {
+        lanes[0] = cmp(values[i], lanes[0]) ? values[i] : lanes[0];
+    }
+    for (int k = 1; k < 4; k++) {
+        lanes[0] = cmp(lanes[k], lanes[0]) ? lanes[k] : lanes[0];
+    }
+    return lanes[0];
+}
+
+template <class V>
+V sum_list(int8_t *input) {
+    V sum = 0;
+    if (nullptr == input) {
+        return sum;
+    }
+    ReduceListBlocks<V>(input, [&sum](const V *values, uint64_t size) {
+        sum += SumBuffer(values, size);
+    });
+    return sum;
+}
+
+template <class V>
+double avg_list(int8_t *input) {
+    double sum = 0;
+    uint64_t cnt = 0;
+    if (nullptr != input) {
+        ReduceListBlocks<V>(input, [&](const V *values, uint64_t size) {
+            sum += SumBuffer(values, size);
+            cnt += size;
+        });
+    }
+    return sum / cnt;
+}
+
+template <class V>
+bool min_list(int8_t *input, V *output) {
+    bool found = false;
+    if (nullptr == input || nullptr == output) {
+        return found;
+    }
+    ReduceListBlocks<V>(input, [&](const V *values, uint64_t size) {
+        V min = SelectBuffer(values, size, std::less<V>());
+        *output = found && *output < min ? *output : min;
+        found = true;
+    });
+    return found;
+}
+
+template <class V>
+bool max_list(int8_t *input, V *output) {
+    bool found = false;
+    if (nullptr == input || nullptr == output) {
+        return found;
+    }
+    ReduceListBlocks<V>(input, [&](const V *values, uint64_t size) {
+        V max = SelectBuffer(values, size, std::greater<V>());
+        *output = found && *output > max ? *output : max;
+        found = true;
+    });
+    return found;
+}
+
+#define INSTANTIATE_REDUCE_LIST(V)                         \
+    template V sum_list<V>(int8_t * input);                \
+    template double avg_list<V>(int8_t * input);           \
+    template bool min_list<V>(int8_t * input, V * output); \
+    template bool max_list<V>(int8_t * input, V * output);
+
+INSTANTIATE_REDUCE_LIST(int16_t)
+INSTANTIATE_REDUCE_LIST(int32_t)
+INSTANTIATE_REDUCE_LIST(int64_t)
+INSTANTIATE_REDUCE_LIST(float)
+INSTANTIATE_REDUCE_LIST(double)
+#undef INSTANTIATE_REDUCE_LIST
+
 }  // namespace v1
 
 bool RegisterMethod(const std::string &fn_name, hybridse::node::TypeNode *ret,
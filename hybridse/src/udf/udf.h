@@ -162,9 +162,23 @@ struct Truncate32 {
     int32_t operator()(V r) { return static_cast<int32_t>(trunc(r)); }
 };
 
+// Reduce a list of numbers. A list materialized in an array is reduced over
+// its buffer directly, other lists are decoded into blocks by the iterator
+// and the blocks are reduced the same way. The float sums are accumulated in
+// several lanes, so they may differ from the sequential sum in the last bits.
 template <class V>
 double avg_list(int8_t *input);
 
+template <class V>
+V sum_list(int8_t *input);
+
+// return false if the list is empty
+template <class V>
+bool min_list(int8_t *input, V *output);
+
+template <class V>
+bool max_list(int8_t *input, V *output);
+
 template <class V>
 struct StructMaximum {
     using Args = std::tuple<V, V>;
@@ -243,6 +257,10 @@ void sub_string(hybridse::codec::StringRef *str, int32_t pos,
 void sub_string(hybridse::codec::StringRef *str, int32_t pos, int32_t len,
                 hybridse::codec::StringRef *output);
 int32_t strcmp(hybridse::codec::StringRef *s1, hybridse::codec::StringRef *s2);
+bool like_match(hybridse::codec::StringRef *str,
+                hybridse::codec::StringRef *pattern);
+bool ilike_match(hybridse::codec::StringRef *str,
+                 hybridse::codec::StringRef *pattern);
 void bool_to_string(bool v, hybridse::codec::StringRef *output);
 void string_to_bool(codec::StringRef *str, bool *out, bool *is_null_ptr);
 void string_to_int(codec::StringRef *str, int32_t *v, bool *is_null_ptr);
@@ -175,6 +175,10 @@ UdafRegistryHelper UdfLibrary::RegisterUdaf(const std::string& name) {
     return UdafRegistryHelper(GetCanonicalName(name), this);
 }
 
+VectorUdfRegistryHelper UdfLibrary::RegisterVectorUdf(const std::string& name) {
+    return VectorUdfRegistryHelper(GetCanonicalName(name), this);
+}
+
 Status UdfLibrary::RegisterAlias(const std::string& alias,
                                  const std::string& name) {
     std::string canonical_name = GetCanonicalName(name);
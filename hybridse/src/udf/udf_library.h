@@ -44,6 +44,7 @@ class ExprUdfRegistryHelper;
 class LlvmUdfRegistryHelper;
 class ExternalFuncRegistryHelper;
 class UdafRegistryHelper;
+class VectorUdfRegistryHelper;
 class UdfRegistry;
 class UdafRegistry;
 class CompositeRegistry;
@@ -107,6 +108,7 @@ class UdfLibrary {
     LlvmUdfRegistryHelper RegisterCodeGenUdf(const std::string& name);
     ExternalFuncRegistryHelper RegisterExternal(const std::string& name);
     UdafRegistryHelper RegisterUdaf(const std::string& name);
+    VectorUdfRegistryHelper RegisterVectorUdf(const std::string& name);
 
     Status RegisterAlias(const std::string& alias, const std::string& name);
     Status RegisterFromFile(const std::string& path);
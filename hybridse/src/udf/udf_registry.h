@@ -21,6 +21,7 @@
 #include <sstream>
 #include <string>
 #include <tuple>
+#include <type_traits>
 #include <unordered_map>
 #include <unordered_set>
 #include <utility>
@@ -1286,6 +1287,13 @@ class ExternalFuncRegistryHelper
         return *this;
     }
 
+    // mark the function of the current args deterministic, see
+    // ExternalFnDefNode::deterministic
+    ExternalFuncRegistryHelper& deterministic() {
+        deterministic_ = true;
+        return *this;
+    }
+
     ExternalFuncRegistryHelper& doc(const std::string& str) {
         SetDoc(str);
         return *this;
@@ -1315,6 +1323,7 @@ class ExternalFuncRegistryHelper
         auto def = node_manager()->MakeExternalFnDefNode(
             fn_name_, fn_ptr_, return_type_, return_nullable_, arg_types_,
             arg_nullable_, variadic_pos_, return_by_arg_);
+        def->SetDeterministic(deterministic_);
         cur_def_ = def;
 
         auto registry = std::make_shared<ExternalFuncRegistry>(name(), def);
@@ -1345,6 +1354,7 @@ class ExternalFuncRegistryHelper
         return_type_ = nullptr;
         return_nullable_ = false;
         variadic_pos_ = -1;
+        deterministic_ = false;
     }
 
     std::string fn_name_;
@@ -1356,6 +1366,7 @@ class ExternalFuncRegistryHelper
     bool return_nullable_ = false;
     int variadic_pos_ = -1;
     bool return_by_arg_ = false;
+    bool deterministic_ = false;
 
     node::ExternalFnDefNode* cur_def_ = nullptr;
 };
@@ -1433,6 +1444,75 @@ class ExternalTemplateFuncRegistryHelper {
     ExternalFuncRegistryHelper helper_;
 };
 
+/**
+ * Call a batch kernel `R kernel(const T* values, const bool* nulls, size_t n)`
+ * on the values of a list. A list kept in an array is passed as is, with
+ * null `nulls` since the array holds no null, the other lists are gathered
+ * into buffers together with the null flags of the column.
+ */
+template <typename T, typename R, R (*KERNEL)(const T*, const bool*, size_t)>
+struct VectorUdfAdapter {
+    static_assert(!std::is_same<T, bool>::value,
+                  "bool values are not contiguous in an array list");
+
+    static R Call(codec::ListRef<T>* list_ref) {
+        auto list = reinterpret_cast<codec::ListV<T>*>(list_ref->list);
+        auto array = dynamic_cast<codec::ArrayListV<T>*>(list);
+        if (array != nullptr) {
+            return KERNEL(array->data(), nullptr, array->GetCount());
+        }
+        size_t size = list->GetCount();
+        std::unique_ptr<T[]> values(new T[size]);
+        std::unique_ptr<bool[]> nulls(new bool[size]);
+        auto column = dynamic_cast<codec::WrapListImpl<T, codec::Row>*>(list);
+        size_t n = 0;
+        if (column != nullptr) {
+            auto iter = column->root()->GetIterator();
+            for (iter->SeekToFirst(); iter->Valid() && n < size; iter->Next()) {
+                values[n] = T();
+                column->GetField(iter->GetValue(), &values[n], &nulls[n]);
+                n++;
+            }
+        } else {
+            auto iter = list->GetIterator();
+            for (iter->SeekToFirst(); iter->Valid() && n < size; iter->Next()) {
+                values[n] = iter->GetValue();
+                nulls[n] = false;
+                n++;
+            }
+        }
+        return KERNEL(values.get(), nulls.get(), n);
+    }
+};
+
+/**
+ * Register the batch kernels of a function over lists, see VectorUdfAdapter.
+ * The function is resolved as an external function over the list type, so
+ * it is called once per list instead of once per element.
+ */
+class VectorUdfRegistryHelper {
+ public:
+    VectorUdfRegistryHelper(const std::string& name, UdfLibrary* library)
+        : helper_(library->RegisterExternal(name)) {}
+
+    template <typename T, typename R, R (*KERNEL)(const T*, const bool*, size_t)>
+    VectorUdfRegistryHelper& kernel() {
+        helper_
+            .args<codec::ListRef<T>>(reinterpret_cast<void*>(
+                &VectorUdfAdapter<T, R, KERNEL>::Call))
+            .template returns<R>();
+        return *this;
+    }
+
+    VectorUdfRegistryHelper& doc(const std::string& str) {
+        helper_.doc(str);
+        return *this;
+    }
+
+ private:
+    ExternalFuncRegistryHelper helper_;
+};
+
 class SimpleUdfRegistry : public UdfRegistry {
  public:
     explicit SimpleUdfRegistry(const std::string& name,
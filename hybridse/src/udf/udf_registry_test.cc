@@ -16,7 +16,9 @@
 
 #include "udf/udf_registry.h"
 #include <gtest/gtest.h>
+#include "codec/fe_row_codec.h"
 #include "codegen/context.h"
+#include "vm/mem_catalog.h"
 
 namespace hybridse {
 namespace udf {
@@ -261,6 +263,62 @@ TEST_F(UdfRegistryTest, test_external_udf_register) {
     ASSERT_EQ("string", fn_def->ret_type()->GetName());
 }
 
+// sum the non null values, and count the nulls in the hundreds
+static int64_t SumKernel(const int32_t* values, const bool* nulls, size_t n) {
+    int64_t sum = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (nulls != nullptr && nulls[i]) {
+            sum += 100;
+        } else {
+            sum += values[i];
+        }
+    }
+    return sum;
+}
+
+TEST_F(UdfRegistryTest, test_vector_udf_register) {
+    UdfLibrary library;
+    library.RegisterVectorUdf("vsum").kernel<int32_t, int64_t, SumKernel>();
+
+    auto fn_def = dynamic_cast<const node::ExternalFnDefNode*>(
+        GetFnDef<codec::ListRef<int32_t>>(&library, "vsum", &nm));
+    ASSERT_TRUE(fn_def != nullptr && fn_def->GetType() == node::kExternalFnDef);
+    ASSERT_EQ("int64", fn_def->ret_type()->GetName());
+    ASSERT_TRUE(GetFnDef<int32_t>(&library, "vsum", &nm) == nullptr);
+    auto call = reinterpret_cast<int64_t (*)(codec::ListRef<int32_t>*)>(
+        fn_def->function_ptr());
+
+    // an array list is passed as is
+    std::vector<int32_t> values = {1, 2, 3, 4};
+    codec::ArrayListV<int32_t> array(&values);
+    codec::ListRef<int32_t> array_ref;
+    array_ref.list = reinterpret_cast<int8_t*>(&array);
+    ASSERT_EQ(10, call(&array_ref));
+
+    // a column is gathered with the null flags
+    type::TableDef table;
+    auto column = table.add_columns();
+    column->set_name("col0");
+    column->set_type(type::kInt32);
+    vm::MemTableHandler window(&table.columns());
+    for (int i = 0; i < 4; i++) {
+        codec::RowBuilder builder(table.columns());
+        uint32_t size = builder.CalTotalLength(0);
+        int8_t* ptr = static_cast<int8_t*>(malloc(size));
+        builder.SetBuffer(ptr, size);
+        if (i == 2) {
+            builder.AppendNULL();
+        } else {
+            builder.AppendInt32(i + 1);
+        }
+        window.AddRow(codec::Row(base::RefCountedSlice::CreateManaged(ptr, size)));
+    }
+    codec::ColumnImpl<int32_t> col(&window, 0, 0, codec::HEADER_LENGTH + 1);
+    codec::ListRef<int32_t> col_ref;
+    col_ref.list = reinterpret_cast<int8_t*>(&col);
+    ASSERT_EQ(1 + 2 + 100 + 4, call(&col_ref));
+}
+
 TEST_F(UdfRegistryTest, test_variadic_external_udf_register) {
     UdfLibrary library;
     const node::ExternalFnDefNode* fn_def;
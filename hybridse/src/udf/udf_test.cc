@@ -225,6 +225,80 @@ TEST_F(UdfTest, udf_sum_test) {
     SumTest(&window);
 }
 
+TEST_F(UdfTest, ReduceListTest) {
+    // the array list is reduced over its buffer
+    std::vector<int32_t> values;
+    for (int32_t i = 0; i < 1003; i++) {
+        values.push_back((i * 37) % 101 - 50);
+    }
+    ArrayListV<int32_t> array(&values, 1, 1002);
+    ListRef<int32_t> array_ref;
+    array_ref.list = reinterpret_cast<int8_t*>(&array);
+    int32_t expect_sum = 0;
+    for (uint32_t i = 1; i < 1002; i++) {
+        expect_sum += values[i];
+    }
+    int8_t* input = reinterpret_cast<int8_t*>(&array_ref);
+    ASSERT_EQ(expect_sum, v1::sum_list<int32_t>(input));
+    ASSERT_DOUBLE_EQ(expect_sum / 1001.0, v1::avg_list<int32_t>(input));
+    int32_t min = 0;
+    ASSERT_TRUE(v1::min_list<int32_t>(input, &min));
+    ASSERT_EQ(-50, min);
+    int32_t max = 0;
+    ASSERT_TRUE(v1::max_list<int32_t>(input, &max));
+    ASSERT_EQ(50, max);
+
+    // the column is reduced by the iterator
+    vm::MemTableHandler window;
+    for (int i = 0; i < 300; i++) {
+        window.AddRow(rows[i % rows.size()]);
+    }
+    ListRef<double> col;
+    ASSERT_TRUE(FetchColList(&window, 3, 2 + 4 + 2 + 4, &col));
+    input = reinterpret_cast<int8_t*>(&col);
+    ASSERT_NEAR(100 * (4.1 + 44.1 + 444.1), v1::sum_list<double>(input),
+                1e-6);
+    double min_value = 0;
+    ASSERT_TRUE(v1::min_list<double>(input, &min_value));
+    ASSERT_EQ(4.1, min_value);
+    double max_value = 0;
+    ASSERT_TRUE(v1::max_list<double>(input, &max_value));
+    ASSERT_EQ(444.1, max_value);
+
+    std::vector<int64_t> empty;
+    ArrayListV<int64_t> empty_array(&empty);
+    ListRef<int64_t> empty_ref;
+    empty_ref.list = reinterpret_cast<int8_t*>(&empty_array);
+    int64_t value = 0;
+    input = reinterpret_cast<int8_t*>(&empty_ref);
+    ASSERT_FALSE(v1::min_list<int64_t>(input, &value));
+    ASSERT_EQ(0, v1::sum_list<int64_t>(input));
+}
+
+TEST_F(UdfTest, SharedColumnTest) {
+    vm::MemTableHandler window;
+    for (auto row : rows) {
+        window.AddRow(row);
+    }
+    ListRef<int32_t> list;
+    ASSERT_TRUE(FetchColList(&window, 0, 2, &list));
+    auto col = reinterpret_cast<ColumnImpl<int32_t>*>(list.list);
+    auto sum = UdfFunctionBuilder("sum")
+                   .args<ListRef<int32_t>>()
+                   .returns<int32_t>()
+                   .build();
+    ASSERT_TRUE(sum.valid());
+    ASSERT_EQ(1 + 11 + 111, sum(list));
+    ASSERT_TRUE(col->GetDecoded() == nullptr);
+    // the later iterations share the decoded column
+    ASSERT_EQ(1 + 11 + 111, sum(list));
+    auto decoded = col->GetDecoded();
+    ASSERT_TRUE(decoded != nullptr);
+    ASSERT_EQ(1 + 11 + 111, sum(list));
+    ASSERT_EQ(decoded, col->GetDecoded());
+    ASSERT_EQ(3u, decoded->GetCount());
+}
+
 TEST_F(UdfTest, GetColTest) {
     ArrayListV<Row> impl(&rows);
     const uint32_t size = sizeof(ColumnImpl<int16_t>);
@@ -488,6 +562,52 @@ TEST_F(UdfTest, TimestampToString) {
     }
 }
 
+TEST_F(UdfTest, CivilTimeOfTimestamp) {
+    // 2000-01-01 00:00:00 in the time zone
+    int64_t ts = 946656000000L;
+    ASSERT_EQ(2000, udf::v1::year(ts));
+    ASSERT_EQ(1, udf::v1::month(ts));
+    ASSERT_EQ(1, udf::v1::dayofmonth(ts));
+    ASSERT_EQ(7, udf::v1::dayofweek(ts));
+    ASSERT_EQ(52, udf::v1::weekofyear(ts));
+    ASSERT_EQ(1999, udf::v1::year(ts - 1));
+    ASSERT_EQ(12, udf::v1::month(ts - 1));
+    ASSERT_EQ(31, udf::v1::dayofmonth(ts - 1));
+    // 2020-02-29, a leap day
+    ts = 1582905600000L;
+    ASSERT_EQ(2, udf::v1::month(ts));
+    ASSERT_EQ(29, udf::v1::dayofmonth(ts));
+    ASSERT_EQ(9, udf::v1::weekofyear(ts));
+    // 1969-12-31 23:59:59, before the epoch in utc
+    ts = -8 * 3600000L - 1000;
+    ASSERT_EQ(1969, udf::v1::year(ts));
+    ASSERT_EQ(31, udf::v1::dayofmonth(ts));
+    ASSERT_EQ(4, udf::v1::dayofweek(ts));
+    codec::StringRef str;
+    codec::Timestamp timestamp(ts);
+    udf::v1::timestamp_to_string(&timestamp, &str);
+    ASSERT_EQ(codec::StringRef("1969-12-31 23:59:59"), str);
+}
+
+TEST_F(UdfTest, CivilTimeOfDate) {
+    codec::Date date(2021, 1, 3);
+    ASSERT_EQ(1, udf::v1::dayofweek(&date));
+    ASSERT_EQ(53, udf::v1::weekofyear(&date));
+    date = codec::Date(2024, 12, 30);
+    ASSERT_EQ(2, udf::v1::dayofweek(&date));
+    ASSERT_EQ(1, udf::v1::weekofyear(&date));
+    // the invalid dates
+    date = codec::Date(2021, 2, 29);
+    ASSERT_EQ(0, udf::v1::dayofweek(&date));
+    ASSERT_EQ(0, udf::v1::weekofyear(&date));
+    codec::StringRef str;
+    udf::v1::date_to_string(&date, &str);
+    ASSERT_EQ(0u, str.size_);
+    date = codec::Date(2020, 2, 29);
+    udf::v1::date_to_string(&date, &str);
+    ASSERT_EQ(codec::StringRef("2020-02-29"), str);
+}
+
 template <class Ret, class... Args>
 void CheckUdf(UdfLibrary* library, const std::string& name, Ret&& expect,
               Args&&... args) {
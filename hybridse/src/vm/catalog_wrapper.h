@@ -381,6 +381,13 @@ class TableFilterWrapper : public TableHandler {
     virtual const OrderType GetOrderType() const {
         return table_hander_->GetOrderType();
     }
+    std::vector<std::shared_ptr<TableHandler>> GetParts() override {
+        auto parts = table_hander_->GetParts();
+        for (auto& part : parts) {
+            part = std::make_shared<TableFilterWrapper>(part, parameter_, fun_);
+        }
+        return parts;
+    }
     std::shared_ptr<TableHandler> table_hander_;
     const Row& parameter_;
     Row value_;
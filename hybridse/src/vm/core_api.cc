@@ -15,6 +15,7 @@
  */
 
 #include "vm/core_api.h"
+#include <vector>
 #include "base/sig_trace.h"
 #include "codec/fe_row_codec.h"
 #include "udf/default_udf_library.h"
@@ -276,6 +277,72 @@ void CoreAPI::CopyRowToUnsafeRowBytes(const hybridse::codec::Row inputRow,
     memcpy(outputBytes, inputRow.buf() + codec::HEADER_LENGTH, length);
 }
 
+hybridse::codec::Row CoreAPI::UnsafeRowProjectBatch(
+    const hybridse::vm::RawPtrHandle fn,
+    hybridse::vm::ByteArrayPtr inputUnsafeRowBytes,
+    hybridse::vm::IntArrayPtr offsets, const int rowCnt,
+    hybridse::vm::IntArrayPtr outputOffsets) {
+    if (fn == nullptr || inputUnsafeRowBytes == nullptr || offsets == nullptr ||
+        outputOffsets == nullptr || rowCnt <= 0) {
+        return hybridse::codec::Row();
+    }
+    auto udf = reinterpret_cast<int32_t (*)(const int64_t, const int8_t*,
+                                            const int8_t*, const int8_t*, int8_t**)>(
+        const_cast<int8_t*>(fn));
+    // the outputs are kept until their total size is known
+    std::vector<int8_t*> outputs(rowCnt, nullptr);
+    auto release = [&outputs]() {
+        for (auto buf : outputs) {
+            free(buf);
+        }
+    };
+    uint32_t total_size = 0;
+    for (int i = 0; i < rowCnt; i++) {
+        int32_t size = offsets[i + 1] - offsets[i];
+        if (size <= static_cast<int32_t>(codec::HEADER_LENGTH)) {
+            LOG(WARNING) << "invalid UnsafeRow " << i << " of size " << size;
+            release();
+            return hybridse::codec::Row();
+        }
+        auto inputRow = Row(base::RefCountedSlice::Create(
+            inputUnsafeRowBytes + offsets[i], size));
+        auto row_ptr = reinterpret_cast<const int8_t*>(&inputRow);
+
+        // Init current run step runtime
+        JitRuntime::get()->InitRunStep();
+        uint32_t ret = udf(0, row_ptr, nullptr, nullptr, &outputs[i]);
+        // Release current run step resources
+        JitRuntime::get()->ReleaseRunStep();
+
+        if (ret != 0 || outputs[i] == nullptr) {
+            LOG(WARNING) << "fail to run udf " << ret << " on row " << i;
+            release();
+            return hybridse::codec::Row();
+        }
+        outputOffsets[i] = total_size;
+        total_size += RowView::GetSize(outputs[i]) - codec::HEADER_LENGTH;
+    }
+    outputOffsets[rowCnt] = total_size;
+
+    auto slice =
+        base::RefCountedSlice::Allocate(codec::HEADER_LENGTH + total_size);
+    int8_t* buf = slice.buf();
+    if (buf == nullptr) {
+        release();
+        return hybridse::codec::Row();
+    }
+    memcpy(buf, outputs[0], codec::HEADER_LENGTH);
+    *reinterpret_cast<uint32_t*>(buf + codec::VERSION_LENGTH) =
+        codec::HEADER_LENGTH + total_size;
+    for (int i = 0; i < rowCnt; i++) {
+        memcpy(buf + codec::HEADER_LENGTH + outputOffsets[i],
+               outputs[i] + codec::HEADER_LENGTH,
+               outputOffsets[i + 1] - outputOffsets[i]);
+    }
+    release();
+    return Row(slice);
+}
+
 hybridse::codec::Row CoreAPI::WindowProject(const RawPtrHandle fn,
                                             const uint64_t row_key,
                                             const Row row,
@@ -348,11 +415,10 @@ bool CoreAPI::ComputeCondition(const hybridse::vm::RawPtrHandle fn,
 }
 
 hybridse::codec::Row CoreAPI::NewRow(size_t bytes) {
-    auto buf = reinterpret_cast<int8_t*>(malloc(bytes));
-    if (buf == nullptr) {
+    auto slice = base::RefCountedSlice::Allocate(bytes);
+    if (slice.buf() == nullptr) {
         return hybridse::codec::Row();
     }
-    auto slice = base::RefCountedSlice::CreateManaged(buf, bytes);
     return hybridse::codec::Row(slice);
 }
 
@@ -361,13 +427,12 @@ RawPtrHandle CoreAPI::GetRowBuf(hybridse::codec::Row* row, size_t idx) {
 }
 
 RawPtrHandle CoreAPI::AppendRow(hybridse::codec::Row* row, size_t bytes) {
-    auto buf = reinterpret_cast<int8_t*>(malloc(bytes));
-    if (buf == nullptr) {
+    auto slice = base::RefCountedSlice::Allocate(bytes);
+    if (slice.buf() == nullptr) {
         return nullptr;
     }
-    auto slice = base::RefCountedSlice::CreateManaged(buf, bytes);
     row->Append(slice);
-    return buf;
+    return slice.buf();
 }
 
 bool CoreAPI::EnableSignalTraceback() {
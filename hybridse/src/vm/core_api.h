@@ -35,6 +35,7 @@ class HybridSeJitWrapper;
 
 typedef const int8_t* RawPtrHandle;
 typedef int8_t* ByteArrayPtr;
+typedef int32_t* IntArrayPtr;
 
 class WindowInterface {
  public:
@@ -143,6 +144,19 @@ class CoreAPI {
                                         hybridse::vm::ByteArrayPtr outputBytes,
                                         const int length);
 
+    // Row project API with Spark UnsafeRow optimization for the rows of a
+    // partition in one call. The i-th input row is at
+    // [offsets[i], offsets[i + 1]) of inputUnsafeRowBytes, with the row header
+    // reserved before the UnsafeRow bytes. The output UnsafeRows are packed
+    // after the header of the returned row and outputOffsets gets their
+    // rowCnt + 1 offsets, so the packed rows can be copied out with
+    // CopyRowToUnsafeRowBytes. Return an empty row if any row fails.
+    static hybridse::codec::Row UnsafeRowProjectBatch(
+        const hybridse::vm::RawPtrHandle fn,
+        hybridse::vm::ByteArrayPtr inputUnsafeRowBytes,
+        hybridse::vm::IntArrayPtr offsets, const int rowCnt,
+        hybridse::vm::IntArrayPtr outputOffsets);
+
     static hybridse::codec::Row WindowProject(
         const hybridse::vm::RawPtrHandle fn, const uint64_t key, const Row row,
         const bool is_instance, size_t append_slices, WindowInterface* window);
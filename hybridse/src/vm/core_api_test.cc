@@ -15,6 +15,8 @@
  */
 
 #include "vm/core_api.h"
+#include <string>
+#include <vector>
 #include "gtest/gtest.h"
 
 namespace hybridse {
@@ -45,6 +47,64 @@ TEST_F(CoreAPITest, test_create_new_row) {
     ASSERT_TRUE(builder.AppendBool(false));
 }
 
+// a project function which reverses the bytes of the input row after its header
+static int32_t ReverseProject(const int64_t key, const int8_t* row_ptr,
+                              const int8_t* window_ptr,
+                              const int8_t* parameter_ptr, int8_t** out) {
+    auto row = reinterpret_cast<const codec::Row*>(row_ptr);
+    if (row->size() == codec::HEADER_LENGTH + 1) {
+        return 1;
+    }
+    int8_t* buf = static_cast<int8_t*>(malloc(row->size()));
+    buf[0] = 1;
+    buf[1] = 1;
+    *reinterpret_cast<uint32_t*>(buf + codec::VERSION_LENGTH) = row->size();
+    for (int32_t i = codec::HEADER_LENGTH; i < row->size(); i++) {
+        buf[i] = row->buf()[row->size() - 1 - i + codec::HEADER_LENGTH];
+    }
+    *out = buf;
+    return 0;
+}
+
+TEST_F(CoreAPITest, test_unsafe_row_project_batch) {
+    std::string input;
+    std::vector<int32_t> offsets;
+    std::vector<std::string> rows;
+    for (int i = 0; i < 10; i++) {
+        offsets.push_back(input.size());
+        rows.push_back(std::string((i + 1) * 8, 'a' + i));
+        rows.back()[0] = 'A';
+        input.append(codec::HEADER_LENGTH, '\0');
+        input.append(rows.back());
+    }
+    offsets.push_back(input.size());
+    auto fn = reinterpret_cast<RawPtrHandle>(&ReverseProject);
+    std::vector<int32_t> out_offsets(rows.size() + 1);
+    auto output = CoreAPI::UnsafeRowProjectBatch(
+        fn, reinterpret_cast<ByteArrayPtr>(&input[0]), offsets.data(),
+        rows.size(), out_offsets.data());
+    ASSERT_FALSE(output.empty());
+    std::string packed(output.size() - codec::HEADER_LENGTH, '\0');
+    CoreAPI::CopyRowToUnsafeRowBytes(
+        output, reinterpret_cast<ByteArrayPtr>(&packed[0]), packed.size());
+    for (size_t i = 0; i < rows.size(); i++) {
+        std::string expect(rows[i].rbegin(), rows[i].rend());
+        ASSERT_EQ(expect, packed.substr(out_offsets[i],
+                                        out_offsets[i + 1] - out_offsets[i]));
+    }
+    ASSERT_EQ(static_cast<int32_t>(packed.size()), out_offsets.back());
+
+    // a failed row fails the batch
+    input.append(codec::HEADER_LENGTH, '\0');
+    input.push_back('x');
+    offsets.push_back(input.size());
+    out_offsets.resize(offsets.size());
+    output = CoreAPI::UnsafeRowProjectBatch(
+        fn, reinterpret_cast<ByteArrayPtr>(&input[0]), offsets.data(),
+        offsets.size() - 1, out_offsets.data());
+    ASSERT_TRUE(output.empty());
+}
+
 }  // namespace vm
 }  // namespace hybridse
 
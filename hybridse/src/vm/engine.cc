@@ -15,20 +15,25 @@
  */
 
 #include "vm/engine.h"
+#include <algorithm>
+#include <set>
+#include <sstream>
 #include <string>
 #include <utility>
 #include <vector>
 #include "base/fe_strings.h"
-#include "boost/none.hpp"
-#include "boost/optional.hpp"
 #include "codec/fe_row_codec.h"
 #include "codec/fe_schema_codec.h"
 #include "codec/list_iterator_codec.h"
 #include "codegen/buf_ir_builder.h"
 #include "gflags/gflags.h"
 #include "llvm-c/Target.h"
+#include "plan/literal_parameterizer.h"
+#include "vm/engine_compile_cache.h"
+#include "vm/jit_runtime.h"
 #include "vm/local_tablet_handler.h"
 #include "vm/mem_catalog.h"
+#include "vm/request_result_cache.h"
 #include "vm/sql_compiler.h"
 
 DECLARE_bool(logtostderr);
@@ -49,7 +54,14 @@ EngineOptions::EngineOptions()
       batch_request_optimized_(true),
       enable_expr_optimize_(true),
       enable_batch_window_parallelization_(false),
+      batch_window_thread_num_(1),
+      batch_window_split_rows_(65536),
+      request_branch_thread_num_(1),
       max_sql_cache_size_(50),
+      max_request_result_cache_size_(0),
+      request_result_cache_ttl_(1000),
+      enable_literal_parameterize_(false),
+      enable_runner_stats_(false),
       enable_spark_unsaferow_format_(false) {
     // TODO(chendihao): Pass the parameter to avoid global gflag
     FLAGS_enable_spark_unsaferow_format = enable_spark_unsaferow_format_;
@@ -61,9 +73,10 @@ EngineOptions* EngineOptions::set_enable_spark_unsaferow_format(bool flag) {
     return this;
 }
 
-Engine::Engine(const std::shared_ptr<Catalog>& catalog) : cl_(catalog), options_(), mu_(), lru_cache_() {}
+Engine::Engine(const std::shared_ptr<Catalog>& catalog)
+    : cl_(catalog), options_(), compile_cache_(new EngineCompileCache(options_.max_sql_cache_size())) {}
 Engine::Engine(const std::shared_ptr<Catalog>& catalog, const EngineOptions& options)
-    : cl_(catalog), options_(options), mu_(), lru_cache_() {}
+    : cl_(catalog), options_(options), compile_cache_(new EngineCompileCache(options_.max_sql_cache_size())) {}
 Engine::~Engine() {}
 void Engine::InitializeGlobalLLVM() {
     if (LLVM_IS_INITIALIZED) return;
@@ -180,7 +193,66 @@ bool Engine::IsCompatibleCache(RunSession& session,  // NOLINT
 
 bool Engine::Get(const std::string& sql, const std::string& db, RunSession& session,
                  base::Status& status) {  // NOLINT (runtime/references)
-    std::shared_ptr<CompileInfo> cached_info = GetCacheLocked(db, sql, session.engine_mode());
+    if (session.engine_mode() == kBatchMode) {
+        auto batch_sess = dynamic_cast<BatchRunSession*>(&session);
+        if (batch_sess->literal_parameterized_) {
+            // the parameters of the last sql compiled by the session
+            batch_sess->SetParameterSchema(codec::Schema());
+            batch_sess->literal_parameter_row_ = Row();
+            batch_sess->literal_parameterized_ = false;
+        }
+        std::string parameterized_sql;
+        codec::Schema parameter_types;
+        Row parameter_row;
+        if (options_.is_enable_literal_parameterize() && batch_sess->GetParameterSchema().empty() &&
+            plan::ParameterizeLiterals(sql, &parameterized_sql, &parameter_types, &parameter_row)) {
+            batch_sess->SetParameterSchema(parameter_types);
+            if (GetOrCompile(parameterized_sql, db, session, status)) {
+                batch_sess->literal_parameter_row_ = parameter_row;
+                batch_sess->literal_parameterized_ = true;
+                return true;
+            }
+            // the literals may be where a parameter is not supported
+            DLOG(INFO) << "fail to compile the parameterized sql: " << status.msg;
+            batch_sess->SetParameterSchema(codec::Schema());
+            status = base::Status::OK();
+        }
+    }
+    return GetOrCompile(sql, db, session, status);
+}
+
+// The compile result of a sql depends on the parameter types in batch mode and on the common columns in batch
+// request mode too, so they are part of the cache key, after a '\0' which does not appear in a sql
+static std::string CacheKey(const std::string& sql, const codec::Schema& parameter_types,
+                            const std::set<size_t>& common_column_indices) {
+    if (parameter_types.empty() && common_column_indices.empty()) {
+        return sql;
+    }
+    std::string key = sql;
+    key.push_back('\0');
+    for (const auto& column : parameter_types) {
+        key.append(std::to_string(column.type())).push_back(',');
+    }
+    key.push_back(';');
+    for (size_t idx : common_column_indices) {
+        key.append(std::to_string(idx)).push_back(',');
+    }
+    return key;
+}
+
+static std::string CacheKey(const std::string& sql, RunSession& session) {  // NOLINT
+    if (session.engine_mode() == kBatchMode) {
+        return CacheKey(sql, dynamic_cast<BatchRunSession*>(&session)->GetParameterSchema(), {});
+    } else if (session.engine_mode() == kBatchRequestMode) {
+        return CacheKey(sql, {}, dynamic_cast<BatchRequestRunSession*>(&session)->common_column_indices());
+    }
+    return sql;
+}
+
+bool Engine::GetOrCompile(const std::string& sql, const std::string& db, RunSession& session,
+                          base::Status& status) {  // NOLINT (runtime/references)
+    const std::string cache_key = CacheKey(sql, session);
+    std::shared_ptr<CompileInfo> cached_info = GetCacheLocked(db, cache_key, session.engine_mode());
     if (cached_info && IsCompatibleCache(session, cached_info, status)) {
         session.SetCompileInfo(cached_info);
         return true;
@@ -201,6 +273,11 @@ bool Engine::Get(const std::string& sql, const std::string& db, RunSession& sess
     sql_context.is_cluster_optimized = options_.is_cluster_optimzied();
     sql_context.is_batch_request_optimized = options_.is_batch_request_optimized();
     sql_context.enable_batch_window_parallelization = options_.is_enable_batch_window_parallelization();
+    sql_context.batch_window_thread_num = options_.batch_window_thread_num();
+    sql_context.batch_window_split_rows = options_.batch_window_split_rows();
+    sql_context.window_sample_sizes = options_.window_sample_sizes();
+    sql_context.request_branch_thread_num = options_.request_branch_thread_num();
+    sql_context.enable_runner_stats = options_.is_enable_runner_stats();
     sql_context.enable_expr_optimize = options_.is_enable_expr_optimize();
     sql_context.jit_options = options_.jit_options();
     if (session.engine_mode() == kBatchMode) {
@@ -223,8 +300,14 @@ bool Engine::Get(const std::string& sql, const std::string& db, RunSession& sess
             return false;
         }
     }
+    if (session.engine_mode() == kRequestMode && options_.max_request_result_cache_size() > 0) {
+        std::vector<std::shared_ptr<TableHandler>> tables;
+        RequestResultCache::CollectTables(sql_context.physical_plan, &tables);
+        sql_context.request_result_cache = std::make_shared<RequestResultCache>(
+            options_.max_request_result_cache_size(), options_.request_result_cache_ttl(), tables);
+    }
 
-    SetCacheLocked(db, sql, session.engine_mode(), info);
+    SetCacheLocked(db, cache_key, session.engine_mode(), info);
     session.SetCompileInfo(info);
     if (session.is_debug_) {
         std::ostringstream plan_oss;
@@ -276,6 +359,13 @@ bool Engine::Explain(const std::string& sql, const std::string& db, EngineMode e
     explain_output->physical_plan = ctx.physical_plan_str;
     explain_output->ir = ctx.ir;
     explain_output->request_name = ctx.request_name;
+    auto cached_info = std::dynamic_pointer_cast<SqlCompileInfo>(
+        GetCacheLocked(db, CacheKey(sql, parameter_schema, common_column_indices), engine_mode));
+    if (cached_info) {
+        std::ostringstream oss;
+        cached_info->get_sql_context().cluster_job.PrintStats(oss);
+        explain_output->runner_stats = oss.str();
+    }
     if (engine_mode == ::hybridse::vm::kBatchMode) {
         std::set<std::string> tables;
         base::Status status;
@@ -324,56 +414,37 @@ bool Engine::Explain(const std::string& sql, const std::string& db, EngineMode e
     return Explain(sql, db, engine_mode, empty_schema, common_column_indices, explain_output, status);
 }
 
-void Engine::ClearCacheLocked(const std::string& db) {
-    std::lock_guard<base::SpinMutex> lock(mu_);
-    for (auto& cache : lru_cache_) {
-        cache.second.erase(db);
-    }
+void Engine::ClearCacheLocked(const std::string& db) { compile_cache_->Clear(db); }
+
+void Engine::GetCacheStats(uint64_t* hit_count, uint64_t* miss_count) const {
+    *hit_count = compile_cache_->hit_count();
+    *miss_count = compile_cache_->miss_count();
 }
 
 std::shared_ptr<CompileInfo> Engine::GetCacheLocked(const std::string& db, const std::string& sql,
                                                     EngineMode engine_mode) {
-    std::lock_guard<base::SpinMutex> lock(mu_);
-    auto mode_iter = lru_cache_.find(engine_mode);
-    if (mode_iter == lru_cache_.end()) {
-        return nullptr;
-    }
-    auto& mode_cache = mode_iter->second;
-    auto db_iter = mode_cache.find(db);
-    if (db_iter == mode_cache.end()) {
-        return nullptr;
-    }
-    auto& lru = db_iter->second;
-    auto value = lru.get(sql);
-    if (value == boost::none) {
-        return nullptr;
-    } else {
-        return value.value();
-    }
+    return compile_cache_->Get(engine_mode, db, sql);
 }
 
 bool Engine::SetCacheLocked(const std::string& db, const std::string& sql, EngineMode engine_mode,
                             std::shared_ptr<CompileInfo> info) {
-    std::lock_guard<base::SpinMutex> lock(mu_);
-    auto& mode_cache = lru_cache_[engine_mode];
-    using BoostLRU = boost::compute::detail::lru_cache<std::string, std::shared_ptr<CompileInfo>>;
-    std::map<std::string, BoostLRU>::iterator db_iter = mode_cache.find(db);
-    if (db_iter == mode_cache.end()) {
-        db_iter = mode_cache.insert(db_iter, {db, BoostLRU(options_.max_sql_cache_size())});
-    }
-    auto& lru = db_iter->second;
-    auto value = lru.get(sql);
-    if (value == boost::none || engine_mode == kBatchRequestMode) {
-        lru.insert(sql, info);
-        return true;
-    } else {
+    if (!compile_cache_->Put(engine_mode, db, sql, info, false)) {
         // TODO(xxx): Ensure compile result is stable
         DLOG(INFO) << "Engine cache already exists: " << engine_mode << " " << db << "\n" << sql;
         return false;
     }
+    return true;
 }
 
-RunSession::RunSession(EngineMode engine_mode) : engine_mode_(engine_mode), is_debug_(false), sp_name_("") {}
+RunSession::RunSession(EngineMode engine_mode)
+    : engine_mode_(engine_mode),
+      is_debug_(false),
+      is_trace_(false),
+      traces_(),
+      deadline_us_(0),
+      memory_budget_(0),
+      spill_dir_(""),
+      sp_name_("") {}
 RunSession::~RunSession() {}
 
 bool RunSession::SetCompileInfo(const std::shared_ptr<CompileInfo>& compile_info) {
@@ -396,15 +467,51 @@ int32_t RequestRunSession::Run(const uint32_t task_id, const Row& in_row, Row* o
         return -2;
     }
     DLOG(INFO) << "Request Row Run with task_id " << task_id;
-    RunnerContext ctx(&std::dynamic_pointer_cast<SqlCompileInfo>(compile_info_)->get_sql_context().cluster_job, in_row,
-                      sp_name_, is_debug_);
+    auto& sql_context = std::dynamic_pointer_cast<SqlCompileInfo>(compile_info_)->get_sql_context();
+    // only the results of the main task are cached, the version is taken before the run so that
+    // the writes during the run invalidate the result
+    auto cache = task_id == sql_context.cluster_job.main_task_id() ? sql_context.request_result_cache : nullptr;
+    uint64_t version = 0;
+    if (cache && !cache->GetDataVersion(&version)) {
+        cache = nullptr;
+    }
+    traces_.clear();
+    if (cache && cache->Get(in_row, version, out_row)) {
+        return 0;
+    }
+    RunnerContext ctx(&sql_context.cluster_job, in_row, sp_name_, is_debug_);
+    ctx.SetBranchThreadNum(sql_context.request_branch_thread_num);
+    if (is_trace_) {
+        ctx.EnableTrace();
+    }
+    ctx.SetDeadline(deadline_us_);
+    // the memory of the run steps is sized by the last runs of the sql, so
+    // the pool of a thread new to the sql doesn't grow chunk by chunk
+    auto runtime = JitRuntime::get();
+    runtime->ReserveRunStep(sql_context.run_step_bytes.load(std::memory_order_relaxed));
+    runtime->ResetPeakRunStepBytes();
     auto output = task->RunWithCache(ctx);
+    uint64_t step_bytes = std::min<uint64_t>(runtime->GetPeakRunStepBytes(), base::ByteMemoryPool::MAX_RETAINED_SIZE);
+    uint64_t last_step_bytes = sql_context.run_step_bytes.load(std::memory_order_relaxed);
+    while (step_bytes > last_step_bytes &&
+           !sql_context.run_step_bytes.compare_exchange_weak(last_step_bytes, step_bytes, std::memory_order_relaxed)) {
+    }
+    if (is_trace_) {
+        traces_ = ctx.GetTraces();
+    }
+    if (ctx.is_expired()) {
+        LOG(WARNING) << "the request plan is stopped by the deadline";
+        return kRunDeadlineExceeded;
+    }
     if (!output) {
         LOG(WARNING) << "run request plan output is null";
         return -1;
     }
     bool ok = Runner::ExtractRow(output, out_row);
     if (ok) {
+        if (cache) {
+            cache->Put(in_row, version, *out_row);
+        }
         return 0;
     }
     return -1;
@@ -441,8 +548,19 @@ int32_t BatchRunSession::Run(std::vector<Row>& rows, uint64_t limit) {
 }
 int32_t BatchRunSession::Run(const Row& parameter_row, std::vector<Row>& rows, uint64_t limit) {
     auto& sql_ctx = std::dynamic_pointer_cast<SqlCompileInfo>(compile_info_)->get_sql_context();
-    RunnerContext ctx(&sql_ctx.cluster_job, parameter_row, is_debug_);
+    RunnerContext ctx(&sql_ctx.cluster_job,
+                      literal_parameterized_ && parameter_row.empty() ? literal_parameter_row_ : parameter_row,
+                      is_debug_);
+    ctx.SetMemoryBudget(memory_budget_, spill_dir_);
     auto output = sql_ctx.cluster_job.GetTask(0).GetRoot()->RunWithCache(ctx);
+    if (ctx.spill_bytes() > 0) {
+        LOG(INFO) << "the batch plan spilled " << ctx.spill_bytes() << " bytes beyond the memory budget "
+                  << memory_budget_;
+    }
+    if (ctx.is_memory_exceeded()) {
+        LOG(WARNING) << "the batch plan is stopped by the memory budget " << memory_budget_;
+        return kRunMemoryExceeded;
+    }
     if (!output) {
         LOG(WARNING) << "run batch plan output is null";
         return -1;
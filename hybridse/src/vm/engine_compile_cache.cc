@@ -0,0 +1,137 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "vm/engine_compile_cache.h"
+
+#include <algorithm>
+#include <functional>
+#include <mutex>  // NOLINT
+
+namespace hybridse {
+namespace vm {
+
+// a shard holds at least kMinShardCapacity results unless the capacity is
+// smaller, so that a small cache is not split into shards of a few slots
+static constexpr uint32_t kMinShardCapacity = 8;
+static constexpr uint32_t kMaxShardNum = 16;
+
+EngineCompileCache::EngineCompileCache(uint32_t capacity)
+    : capacity_(capacity), mu_(), dbs_(), hit_count_(0), miss_count_(0) {}
+
+std::shared_ptr<CompileInfo> EngineCompileCache::Get(EngineMode engine_mode, const std::string& db,
+                                                     const std::string& sql) {
+    auto shards = GetShards(engine_mode, db, false);
+    std::shared_ptr<CompileInfo> info;
+    if (shards) {
+        info = (*shards)[std::hash<std::string>()(sql) % shards->size()]->Get(sql);
+    }
+    if (info) {
+        hit_count_.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        miss_count_.fetch_add(1, std::memory_order_relaxed);
+    }
+    return info;
+}
+
+bool EngineCompileCache::Put(EngineMode engine_mode, const std::string& db, const std::string& sql,
+                             const std::shared_ptr<CompileInfo>& info, bool replace) {
+    auto shards = GetShards(engine_mode, db, true);
+    if (!shards) {
+        return false;
+    }
+    return (*shards)[std::hash<std::string>()(sql) % shards->size()]->Put(sql, info, replace);
+}
+
+void EngineCompileCache::Clear(const std::string& db) {
+    std::lock_guard<std::shared_mutex> lock(mu_);
+    for (auto iter = dbs_.begin(); iter != dbs_.end();) {
+        if (iter->first.second == db) {
+            iter = dbs_.erase(iter);
+        } else {
+            ++iter;
+        }
+    }
+}
+
+std::shared_ptr<EngineCompileCache::Shards> EngineCompileCache::GetShards(EngineMode engine_mode,
+                                                                          const std::string& db, bool create) {
+    auto key = std::make_pair(engine_mode, db);
+    {
+        std::shared_lock<std::shared_mutex> lock(mu_);
+        auto iter = dbs_.find(key);
+        if (iter != dbs_.end()) {
+            return iter->second;
+        }
+    }
+    if (!create || capacity_ == 0) {
+        return nullptr;
+    }
+    uint32_t shard_num = std::max(1u, std::min(kMaxShardNum, capacity_ / kMinShardCapacity));
+    size_t shard_capacity = (capacity_ + shard_num - 1) / shard_num;
+    auto shards = std::make_shared<Shards>();
+    for (uint32_t i = 0; i < shard_num; i++) {
+        shards->emplace_back(new Shard(shard_capacity));
+    }
+    std::lock_guard<std::shared_mutex> lock(mu_);
+    return dbs_.insert({key, shards}).first->second;
+}
+
+std::shared_ptr<CompileInfo> EngineCompileCache::Shard::Get(const std::string& sql) {
+    std::shared_lock<std::shared_mutex> lock(mu_);
+    auto iter = index_.find(sql);
+    if (iter == index_.end()) {
+        return nullptr;
+    }
+    auto& slot = slots_[iter->second];
+    if (!slot.referenced.load(std::memory_order_relaxed)) {
+        slot.referenced.store(true, std::memory_order_relaxed);
+    }
+    return slot.info;
+}
+
+bool EngineCompileCache::Shard::Put(const std::string& sql, const std::shared_ptr<CompileInfo>& info, bool replace) {
+    std::lock_guard<std::shared_mutex> lock(mu_);
+    auto iter = index_.find(sql);
+    if (iter != index_.end()) {
+        if (!replace) {
+            return false;
+        }
+        slots_[iter->second].info = info;
+        return true;
+    }
+    size_t pos;
+    if (index_.size() < slots_.size()) {
+        // the slots are filled in order before any eviction
+        pos = index_.size();
+    } else {
+        // give the referenced results a second chance
+        while (slots_[hand_].referenced.exchange(false, std::memory_order_relaxed)) {
+            hand_ = (hand_ + 1) % slots_.size();
+        }
+        pos = hand_;
+        hand_ = (hand_ + 1) % slots_.size();
+        index_.erase(slots_[pos].sql);
+    }
+    auto& slot = slots_[pos];
+    slot.sql = sql;
+    slot.info = info;
+    slot.referenced.store(false, std::memory_order_relaxed);
+    index_[sql] = pos;
+    return true;
+}
+
+}  // namespace vm
+}  // namespace hybridse
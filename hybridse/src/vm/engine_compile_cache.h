@@ -0,0 +1,87 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_VM_ENGINE_COMPILE_CACHE_H_
+#define SRC_VM_ENGINE_COMPILE_CACHE_H_
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <shared_mutex>  // NOLINT
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "vm/engine_context.h"
+
+namespace hybridse {
+namespace vm {
+
+/// \brief The compiling results of an engine, keyed by engine mode, db and sql.
+///
+/// Each db of an engine mode holds at most about `capacity` results, which
+/// are spread over several shards. A lookup only takes the read lock of a
+/// shard and marks the result as referenced, a result is evicted by the
+/// clock (second chance) algorithm when its shard is full.
+class EngineCompileCache {
+ public:
+    explicit EngineCompileCache(uint32_t capacity);
+
+    std::shared_ptr<CompileInfo> Get(EngineMode engine_mode, const std::string& db, const std::string& sql);
+
+    // return false if the sql is cached already and `replace` is false
+    bool Put(EngineMode engine_mode, const std::string& db, const std::string& sql,
+             const std::shared_ptr<CompileInfo>& info, bool replace);
+
+    // drop the results of the db in all the engine modes
+    void Clear(const std::string& db);
+
+    uint64_t hit_count() const { return hit_count_.load(std::memory_order_relaxed); }
+    uint64_t miss_count() const { return miss_count_.load(std::memory_order_relaxed); }
+
+ private:
+    class Shard {
+     public:
+        explicit Shard(size_t capacity) : slots_(capacity) {}
+        std::shared_ptr<CompileInfo> Get(const std::string& sql);
+        bool Put(const std::string& sql, const std::shared_ptr<CompileInfo>& info, bool replace);
+
+     private:
+        struct Slot {
+            std::string sql;
+            std::shared_ptr<CompileInfo> info;
+            std::atomic<bool> referenced{false};
+        };
+
+        std::shared_mutex mu_;
+        std::vector<Slot> slots_;
+        std::unordered_map<std::string, size_t> index_;
+        size_t hand_ = 0;
+    };
+    typedef std::vector<std::unique_ptr<Shard>> Shards;
+
+    std::shared_ptr<Shards> GetShards(EngineMode engine_mode, const std::string& db, bool create);
+
+    const uint32_t capacity_;
+    std::shared_mutex mu_;
+    std::map<std::pair<EngineMode, std::string>, std::shared_ptr<Shards>> dbs_;
+    std::atomic<uint64_t> hit_count_;
+    std::atomic<uint64_t> miss_count_;
+};
+
+}  // namespace vm
+}  // namespace hybridse
+#endif  // SRC_VM_ENGINE_COMPILE_CACHE_H_
@@ -0,0 +1,132 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "vm/engine_compile_cache.h"
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+#include "gtest/gtest.h"
+#include "vm/sql_compiler.h"
+
+namespace hybridse {
+namespace vm {
+
+class EngineCompileCacheTest : public ::testing::Test {
+ public:
+    EngineCompileCacheTest() {}
+    ~EngineCompileCacheTest() {}
+};
+
+static std::string Sql(int i) { return "select " + std::to_string(i) + ";"; }
+
+TEST_F(EngineCompileCacheTest, GetAndPut) {
+    EngineCompileCache cache(8);
+    auto info = std::make_shared<SqlCompileInfo>();
+    ASSERT_EQ(nullptr, cache.Get(kBatchMode, "db", Sql(0)));
+    ASSERT_TRUE(cache.Put(kBatchMode, "db", Sql(0), info, false));
+    ASSERT_EQ(info, cache.Get(kBatchMode, "db", Sql(0)));
+    // keyed by engine mode and db
+    ASSERT_EQ(nullptr, cache.Get(kRequestMode, "db", Sql(0)));
+    ASSERT_EQ(nullptr, cache.Get(kBatchMode, "db2", Sql(0)));
+    ASSERT_EQ(1u, cache.hit_count());
+    ASSERT_EQ(3u, cache.miss_count());
+
+    auto info2 = std::make_shared<SqlCompileInfo>();
+    ASSERT_FALSE(cache.Put(kBatchMode, "db", Sql(0), info2, false));
+    ASSERT_EQ(info, cache.Get(kBatchMode, "db", Sql(0)));
+    ASSERT_TRUE(cache.Put(kBatchMode, "db", Sql(0), info2, true));
+    ASSERT_EQ(info2, cache.Get(kBatchMode, "db", Sql(0)));
+
+    ASSERT_TRUE(cache.Put(kRequestMode, "db", Sql(0), info, false));
+    ASSERT_TRUE(cache.Put(kBatchMode, "db2", Sql(0), info, false));
+    cache.Clear("db");
+    ASSERT_EQ(nullptr, cache.Get(kBatchMode, "db", Sql(0)));
+    ASSERT_EQ(nullptr, cache.Get(kRequestMode, "db", Sql(0)));
+    ASSERT_EQ(info, cache.Get(kBatchMode, "db2", Sql(0)));
+
+    EngineCompileCache disabled(0);
+    ASSERT_FALSE(disabled.Put(kBatchMode, "db", Sql(0), info, false));
+    ASSERT_EQ(nullptr, disabled.Get(kBatchMode, "db", Sql(0)));
+}
+
+TEST_F(EngineCompileCacheTest, SecondChance) {
+    // a single shard
+    EngineCompileCache cache(8);
+    std::vector<std::shared_ptr<CompileInfo>> infos;
+    for (int i = 0; i < 10; i++) {
+        infos.push_back(std::make_shared<SqlCompileInfo>());
+    }
+    for (int i = 0; i < 8; i++) {
+        ASSERT_TRUE(cache.Put(kBatchMode, "db", Sql(i), infos[i], false));
+    }
+    for (int i = 0; i < 4; i++) {
+        ASSERT_EQ(infos[i], cache.Get(kBatchMode, "db", Sql(i)));
+    }
+    // the first unreferenced one is evicted
+    ASSERT_TRUE(cache.Put(kBatchMode, "db", Sql(8), infos[8], false));
+    ASSERT_EQ(nullptr, cache.Get(kBatchMode, "db", Sql(4)));
+    ASSERT_TRUE(cache.Put(kBatchMode, "db", Sql(9), infos[9], false));
+    ASSERT_EQ(nullptr, cache.Get(kBatchMode, "db", Sql(5)));
+    for (int i : {0, 1, 2, 3, 6, 7, 8, 9}) {
+        ASSERT_EQ(infos[i], cache.Get(kBatchMode, "db", Sql(i)));
+    }
+}
+
+TEST_F(EngineCompileCacheTest, Capacity) {
+    EngineCompileCache cache(100);
+    auto info = std::make_shared<SqlCompileInfo>();
+    for (int i = 0; i < 1000; i++) {
+        cache.Put(kBatchMode, "db", Sql(i), info, false);
+    }
+    size_t cached = 0;
+    for (int i = 0; i < 1000; i++) {
+        if (cache.Get(kBatchMode, "db", Sql(i))) {
+            cached++;
+        }
+    }
+    // the shards round the capacity up
+    ASSERT_GE(cached, 90u);
+    ASSERT_LE(cached, 112u);
+}
+
+TEST_F(EngineCompileCacheTest, Concurrent) {
+    EngineCompileCache cache(64);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back([&cache, t]() {
+            for (int i = 0; i < 10000; i++) {
+                auto sql = Sql((i * 7 + t) % 128);
+                if (!cache.Get(kRequestMode, "db", sql)) {
+                    cache.Put(kRequestMode, "db", sql, std::make_shared<SqlCompileInfo>(), false);
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    ASSERT_EQ(40000u, cache.hit_count() + cache.miss_count());
+    ASSERT_LT(0u, cache.hit_count());
+}
+
+}  // namespace vm
+}  // namespace hybridse
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -158,6 +158,102 @@ TEST_F(EngineCompileTest, EngineWithParameterizedLRUCacheTest) {
     }
 }
 
+TEST_F(EngineCompileTest, EngineBatchRequestCacheTest) {
+    auto catalog = BuildSimpleCatalog();
+    hybridse::type::Database db;
+    db.set_name("simple_db");
+    hybridse::type::TableDef table_def;
+    sqlcase::CaseSchemaMock::BuildTableDef(table_def);
+    table_def.set_name("t1");
+    ::hybridse::type::IndexDef* index = table_def.add_indexes();
+    index->set_name("index2");
+    index->add_first_keys("col2");
+    index->set_second_key("col5");
+    AddTable(db, table_def);
+    catalog->AddDatabase(db);
+
+    std::string sql =
+        "select col0, col1, col2, sum(col1) over w1 from t1 \n"
+        "window w1 as (partition by col2 \n"
+        "order by col5 rows between 3 preceding and current row);";
+    EngineOptions options;
+    options.set_compile_only(true);
+    Engine engine(catalog, options);
+    base::Status status;
+    BatchRequestRunSession session1;
+    session1.AddCommonColumnIdx(2);
+    session1.AddCommonColumnIdx(5);
+    ASSERT_TRUE(engine.Get(sql, "simple_db", session1, status)) << status;
+    BatchRequestRunSession session2;
+    ASSERT_TRUE(engine.Get(sql, "simple_db", session2, status)) << status;
+    ASSERT_NE(session1.GetCompileInfo().get(), session2.GetCompileInfo().get());
+
+    // the sessions with either of the common column sets reuse their plans
+    BatchRequestRunSession session3;
+    session3.AddCommonColumnIdx(2);
+    session3.AddCommonColumnIdx(5);
+    ASSERT_TRUE(engine.Get(sql, "simple_db", session3, status)) << status;
+    ASSERT_EQ(session1.GetCompileInfo().get(), session3.GetCompileInfo().get());
+    BatchRequestRunSession session4;
+    ASSERT_TRUE(engine.Get(sql, "simple_db", session4, status)) << status;
+    ASSERT_EQ(session2.GetCompileInfo().get(), session4.GetCompileInfo().get());
+    uint64_t hit_count = 0;
+    uint64_t miss_count = 0;
+    engine.GetCacheStats(&hit_count, &miss_count);
+    ASSERT_EQ(2u, hit_count);
+    ASSERT_EQ(2u, miss_count);
+}
+
+TEST_F(EngineCompileTest, EngineLiteralParameterizeTest) {
+    auto catalog = BuildSimpleCatalog();
+    hybridse::type::Database db;
+    db.set_name("simple_db");
+    hybridse::type::TableDef table_def;
+    sqlcase::CaseSchemaMock::BuildTableDef(table_def);
+    table_def.set_name("t1");
+    ::hybridse::type::IndexDef* index = table_def.add_indexes();
+    index->set_name("index0");
+    index->add_first_keys("col0");
+    index->set_second_key("col5");
+    AddTable(db, table_def);
+    catalog->AddDatabase(db);
+
+    EngineOptions options;
+    options.set_compile_only(true);
+    options.set_enable_literal_parameterize(true);
+    Engine engine(catalog, options);
+
+    std::string sql = "select col1, col2 from t1 where col0='a123' and col5<10;";
+    std::string sql2 = "select col1, col2 from t1 where col0='b4' and col5<20;";
+    std::string sql3 = "select col1, col2 from t1 where col0='b4' and col5<20.5;";
+    base::Status get_status;
+    BatchRunSession bsession1;
+    ASSERT_TRUE(engine.Get(sql, "simple_db", bsession1, get_status)) << get_status;
+    ASSERT_TRUE(bsession1.IsLiteralParameterized());
+    ASSERT_EQ(2, bsession1.GetParameterSchema().size());
+    BatchRunSession bsession2;
+    ASSERT_TRUE(engine.Get(sql2, "simple_db", bsession2, get_status)) << get_status;
+    ASSERT_EQ(bsession1.GetCompileInfo().get(), bsession2.GetCompileInfo().get());
+    // the literals of another type are compiled into another plan
+    BatchRunSession bsession3;
+    ASSERT_TRUE(engine.Get(sql3, "simple_db", bsession3, get_status)) << get_status;
+    ASSERT_NE(bsession1.GetCompileInfo().get(), bsession3.GetCompileInfo().get());
+    // the parameters given are kept
+    BatchRunSession bsession4;
+    hybridse::codec::Schema parameter_schema;
+    parameter_schema.Add()->set_type(hybridse::type::kInt64);
+    bsession4.SetParameterSchema(parameter_schema);
+    ASSERT_TRUE(engine.Get("select col1, col2 from t1 where col0='b4' and col5<?;", "simple_db", bsession4,
+                           get_status))
+        << get_status;
+    ASSERT_FALSE(bsession4.IsLiteralParameterized());
+    ASSERT_EQ(1, bsession4.GetParameterSchema().size());
+    // the session compiles another sql without the parameters of the last one
+    ASSERT_TRUE(engine.Get("select col1, col2 from t1;", "simple_db", bsession1, get_status)) << get_status;
+    ASSERT_FALSE(bsession1.IsLiteralParameterized());
+    ASSERT_EQ(0, bsession1.GetParameterSchema().size());
+}
+
 TEST_F(EngineCompileTest, EngineCompileOnlyTest) {
     // Build Simple Catalog
     auto catalog = BuildSimpleCatalog();
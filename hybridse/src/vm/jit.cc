@@ -15,13 +15,19 @@
  */
 
 #include "vm/jit.h"
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <functional>
 #include <string>
 #include <utility>
+#include <vector>
 extern "C" {
 #include <cmath>
 #include <cstdlib>
 }
+#include "bitcode/builtin_bitcode.h"
 #include "glog/logging.h"
+#include "llvm/Bitcode/BitcodeReader.h"
 #include "llvm/ExecutionEngine/JITEventListener.h"
 #include "llvm/ExecutionEngine/JITSymbol.h"
 #include "llvm/ExecutionEngine/Orc/CompileUtils.h"
@@ -36,10 +42,16 @@ extern "C" {
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/LegacyPassManager.h"
 #include "llvm/IR/Verifier.h"
+#include "llvm/IRReader/IRReader.h"
+#include "llvm/Linker/Linker.h"
+#include "llvm/Support/Host.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Transforms/IPO.h"
 #include "llvm/Transforms/InstCombine/InstCombine.h"
 #include "llvm/Transforms/Scalar.h"
 #include "llvm/Transforms/Scalar/GVN.h"
 #include "llvm/Transforms/Utils.h"
+#include "llvm/Transforms/Utils/SplitModule.h"
 #ifdef LLVM_EXT_ENABLE
 #include "llvm_ext/symbol_resolve.h"
 #endif
@@ -52,6 +64,38 @@ HybridSeJit::HybridSeJit(::llvm::orc::LLJITBuilderState& s, ::llvm::Error& e)
     : LLJIT(s, e) {}
 HybridSeJit::~HybridSeJit() {}
 
+static std::unique_ptr<::llvm::Module> ParseModule(
+    const std::string& ir, ::llvm::LLVMContext* llvm_ctx) {
+    ::llvm::SMDiagnostic diagnostic;
+    auto mem_buf = ::llvm::MemoryBuffer::getMemBuffer(ir);
+    return ::llvm::parseIR(*mem_buf, diagnostic, *llvm_ctx);
+}
+
+// run fn(0) on the calling thread and fn(1) ... fn(n - 1) on new threads
+static void RunOnThreads(size_t n, const std::function<void(size_t)>& fn) {
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < n; i++) {
+        threads.emplace_back(fn, i);
+    }
+    if (n > 0) {
+        fn(0);
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+// the functions which may be looked up from the other modules
+static std::vector<std::string> GetExternalFunctions(::llvm::Module* m) {
+    std::vector<std::string> fns;
+    for (auto& fn : *m) {
+        if (!fn.isDeclaration() && fn.hasExternalLinkage()) {
+            fns.push_back(fn.getName().str());
+        }
+    }
+    return fns;
+}
+
 static void RunDefaultOptPasses(::llvm::Module* m) {
     ::llvm::legacy::FunctionPassManager fpm(m);
     // Add some optimizations.
@@ -66,6 +110,48 @@ static void RunDefaultOptPasses(::llvm::Module* m) {
     }
 }
 
+// Link the definitions of the builtin functions the module calls, see
+// bitcode/builtin_functions.cc. They are available_externally, which are
+// only there to be inlined, the calls left still go to the native symbols.
+static bool LinkBuiltinBitcode(::llvm::Module* m) {
+    if (bitcode::kBuiltinBitcodeSize == 0) {
+        return false;
+    }
+    ::llvm::StringRef buf(
+        reinterpret_cast<const char*>(bitcode::kBuiltinBitcode),
+        bitcode::kBuiltinBitcodeSize);
+    auto builtins = ::llvm::parseBitcodeFile(
+        ::llvm::MemoryBufferRef(buf, "hybridse_builtins"), m->getContext());
+    if (!builtins) {
+        LOG(WARNING) << "fail to parse builtin bitcode: "
+                     << LlvmToString(builtins.takeError());
+        return false;
+    }
+    for (auto& fn : **builtins) {
+        if (!fn.isDeclaration() && fn.hasExternalLinkage()) {
+            fn.setLinkage(::llvm::GlobalValue::AvailableExternallyLinkage);
+        }
+    }
+    (*builtins)->setDataLayout(m->getDataLayout());
+    (*builtins)->setTargetTriple(m->getTargetTriple());
+    // only the functions declared by the module are linked
+    if (::llvm::Linker::linkModules(*m, std::move(*builtins),
+                                    ::llvm::Linker::LinkOnlyNeeded)) {
+        LOG(WARNING) << "fail to link builtin bitcode";
+        return false;
+    }
+    return true;
+}
+
+static void RunInlinePasses(::llvm::Module* m) {
+    ::llvm::legacy::PassManager mpm;
+    mpm.add(::llvm::createFunctionInliningPass());
+    // drop the builtins not inlined and the helpers linked with them
+    mpm.add(::llvm::createEliminateAvailableExternallyPass());
+    mpm.add(::llvm::createGlobalDCEPass());
+    mpm.run(*m);
+}
+
 ::llvm::Error HybridSeJit::AddIRModule(::llvm::orc::JITDylib& jd,  // NOLINT
                                        ::llvm::orc::ThreadSafeModule tsm,
                                        ::llvm::orc::VModuleKey key) {
@@ -83,6 +169,9 @@ bool HybridSeJit::OptModule(::llvm::Module* m) {
         return false;
     }
     DLOG(INFO) << "Module before opt:\n" << LlvmToString(*m);
+    if (inline_builtins_ && LinkBuiltinBitcode(m)) {
+        RunInlinePasses(m);
+    }
     RunDefaultOptPasses(m);
     DLOG(INFO) << "Module after opt:\n" << LlvmToString(*m);
     return true;
@@ -150,8 +239,28 @@ bool HybridSeJit::AddSymbol(::llvm::orc::JITDylib& jd,
 
 bool HybridSeLlvmJitWrapper::Init() {
     DLOG(INFO) << "Start to initialize hybridse jit";
-    auto jit = ::llvm::Expected<std::unique_ptr<HybridSeJit>>(
-        HybridSeJitBuilder().create());
+    HybridSeJitBuilder builder;
+    if (!object_cache_dir_.empty()) {
+        object_cache_ = std::unique_ptr<JitObjectCache>(
+            new JitObjectCache(object_cache_dir_));
+        if (!object_cache_->Init()) {
+            object_cache_.reset();
+        }
+    }
+    // the default compiler shares one target machine, which can not compile
+    // on the tier up or the compile threads concurrently
+    if (object_cache_ || enable_tiered_compile_ || compile_thread_num_ > 1) {
+        auto cache = object_cache_.get();
+        builder.setCompileFunctionCreator(
+            [cache](::llvm::orc::JITTargetMachineBuilder jtmb)
+                -> ::llvm::Expected<
+                    ::llvm::orc::IRCompileLayer::CompileFunction> {
+                return ::llvm::orc::IRCompileLayer::CompileFunction(
+                    ::llvm::orc::ConcurrentIRCompiler(std::move(jtmb), cache));
+            });
+    }
+    auto jit =
+        ::llvm::Expected<std::unique_ptr<HybridSeJit>>(builder.create());
     {
         ::llvm::Error e = jit.takeError();
         if (e) {
@@ -161,20 +270,77 @@ bool HybridSeLlvmJitWrapper::Init() {
     }
     this->jit_ = std::move(jit.get());
     jit_->Init();
+    jit_->SetInlineBuiltins(enable_inline_builtins_);
 
     this->mi_ = std::unique_ptr<::llvm::orc::MangleAndInterner>(
         new ::llvm::orc::MangleAndInterner(jit_->getExecutionSession(),
                                            jit_->getDataLayout()));
+    if (enable_tiered_compile_ && !InitFastJit()) {
+        return false;
+    }
+    return true;
+}
+
+bool HybridSeLlvmJitWrapper::InitFastJit() {
+    auto jtmb = ::llvm::orc::JITTargetMachineBuilder::detectHost();
+    if (!jtmb) {
+        LOG(WARNING) << "fail to detect host: "
+                     << LlvmToString(jtmb.takeError());
+        return false;
+    }
+    jtmb->setCodeGenOptLevel(::llvm::CodeGenOpt::None);
+    HybridSeJitBuilder builder;
+    builder.setJITTargetMachineBuilder(std::move(*jtmb));
+    auto jit =
+        ::llvm::Expected<std::unique_ptr<HybridSeJit>>(builder.create());
+    if (!jit) {
+        LOG(WARNING) << "fail to init fast jit: "
+                     << LlvmToString(jit.takeError());
+        return false;
+    }
+    fast_jit_ = std::move(jit.get());
+    fast_jit_->Init();
+    fast_mi_ = std::unique_ptr<::llvm::orc::MangleAndInterner>(
+        new ::llvm::orc::MangleAndInterner(fast_jit_->getExecutionSession(),
+                                           fast_jit_->getDataLayout()));
+    stubs_ = ::llvm::orc::createLocalIndirectStubsManagerBuilder(
+        ::llvm::Triple(::llvm::sys::getProcessTriple()))();
+    if (stubs_ == nullptr) {
+        LOG(WARNING) << "indirect stubs are not supported on "
+                     << ::llvm::sys::getProcessTriple();
+        return false;
+    }
     return true;
 }
 
 bool HybridSeLlvmJitWrapper::OptModule(::llvm::Module* module) {
+    if (fast_jit_ || compile_thread_num_ > 1) {
+        // optimized by the tier up in background or by the compile threads
+        return true;
+    }
     return jit_->OptModule(module);
 }
 
+bool HybridSeLlvmJitWrapper::LookupObjectCache(::llvm::Module* module) {
+    if (!object_cache_) {
+        return false;
+    }
+    std::string key = JitObjectCache::GetKey(*module);
+    module->setModuleIdentifier(key);
+    return object_cache_->Contains(key);
+}
+
 bool HybridSeLlvmJitWrapper::AddModule(
     std::unique_ptr<llvm::Module> module,
     std::unique_ptr<llvm::LLVMContext> llvm_ctx) {
+    // a cached object is optimized already
+    if (fast_jit_ && !(object_cache_ && object_cache_->Contains(
+                                            module->getModuleIdentifier()))) {
+        return AddTieredModule(std::move(module), std::move(llvm_ctx));
+    }
+    if (compile_thread_num_ > 1 && !fast_jit_) {
+        return AddSplitModule(std::move(module), std::move(llvm_ctx));
+    }
     ::llvm::Error e = jit_->addIRModule(
         ::llvm::orc::ThreadSafeModule(std::move(module), std::move(llvm_ctx)));
     if (e) {
@@ -184,10 +350,210 @@ bool HybridSeLlvmJitWrapper::AddModule(
     return true;
 }
 
+bool HybridSeLlvmJitWrapper::AddTieredModule(
+    std::unique_ptr<llvm::Module> module,
+    std::unique_ptr<llvm::LLVMContext> llvm_ctx) {
+    // the optimized module is parsed into its own context, since the
+    // module is owned by the fast jit from now on
+    std::string ir = LlvmToString(*module);
+    std::vector<std::string> fns = GetExternalFunctions(module.get());
+    JitProfile* profile = nullptr;
+    if (pgo_profile_runs_ > 0) {
+        profiles_.emplace_back(new JitProfile());
+        profile = profiles_.back().get();
+        if (!profile->Instrument(module.get())) {
+            LOG(WARNING) << "fail to instrument module";
+            return false;
+        }
+    }
+    ::llvm::Error e = fast_jit_->addIRModule(
+        ::llvm::orc::ThreadSafeModule(std::move(module), std::move(llvm_ctx)));
+    if (e) {
+        LOG(WARNING) << "fail to add ir module: " << LlvmToString(e);
+        return false;
+    }
+    ::llvm::orc::IndirectStubsManager::StubInitsMap stub_inits;
+    for (auto& fn : fns) {
+        auto symbol = fast_jit_->lookup(fn);
+        if (!symbol) {
+            LOG(WARNING) << "fail to resolve fn address of " << fn << ": "
+                         << LlvmToString(symbol.takeError());
+            return false;
+        }
+        stub_inits[fn] = std::make_pair(symbol->getAddress(),
+                                        ::llvm::JITSymbolFlags::Exported);
+    }
+    {
+        std::lock_guard<std::mutex> lock(stubs_mu_);
+        e = stubs_->createStubs(stub_inits);
+    }
+    if (e) {
+        LOG(WARNING) << "fail to create stubs: " << LlvmToString(e);
+        return false;
+    }
+    tier_up_threads_.emplace_back(&HybridSeLlvmJitWrapper::TierUp, this,
+                                  std::move(ir), std::move(fns), profile);
+    return true;
+}
+
+bool HybridSeLlvmJitWrapper::WaitProfile(const JitProfile* profile) {
+    // the runs are counted by the generated code, so they are polled
+    std::unique_lock<std::mutex> lock(tier_up_mu_);
+    while (!tier_up_stopped_ && profile->runs() < pgo_profile_runs_) {
+        tier_up_cv_.wait_for(lock, std::chrono::milliseconds(10));
+    }
+    return !tier_up_stopped_;
+}
+
+void HybridSeLlvmJitWrapper::StopTierUp() {
+    {
+        std::lock_guard<std::mutex> lock(tier_up_mu_);
+        tier_up_stopped_ = true;
+    }
+    tier_up_cv_.notify_all();
+}
+
+void HybridSeLlvmJitWrapper::TierUp(const std::string& ir,
+                                    const std::vector<std::string>& fns,
+                                    const JitProfile* profile) {
+    if (profile != nullptr && !WaitProfile(profile)) {
+        return;
+    }
+    auto llvm_ctx = ::llvm::make_unique<::llvm::LLVMContext>();
+    auto module = ParseModule(ir, llvm_ctx.get());
+    if (module != nullptr && profile != nullptr) {
+        // optimize without the profile if it does not match
+        profile->Annotate(module.get());
+    }
+    if (module == nullptr || !jit_->OptModule(module.get())) {
+        LOG(WARNING) << "fail to optimize module in tier up";
+        return;
+    }
+    ::llvm::Error e = jit_->addIRModule(
+        ::llvm::orc::ThreadSafeModule(std::move(module), std::move(llvm_ctx)));
+    if (e) {
+        LOG(WARNING) << "fail to add optimized module: " << LlvmToString(e);
+        return;
+    }
+    // the lookup compiles the module, the stubs are switched only after
+    // all the functions are ready
+    std::vector<::llvm::JITTargetAddress> addrs;
+    for (auto& fn : fns) {
+        auto symbol = jit_->lookup(fn);
+        if (!symbol) {
+            LOG(WARNING) << "fail to resolve optimized fn address of " << fn
+                         << ": " << LlvmToString(symbol.takeError());
+            return;
+        }
+        addrs.push_back(symbol->getAddress());
+    }
+    std::lock_guard<std::mutex> lock(stubs_mu_);
+    for (size_t i = 0; i < fns.size(); i++) {
+        e = stubs_->updatePointer(fns[i], addrs[i]);
+        if (e) {
+            LOG(WARNING) << "fail to update stub of " << fns[i] << ": "
+                         << LlvmToString(e);
+        }
+    }
+    DLOG(INFO) << "tier up " << fns.size() << " functions";
+}
+
+bool HybridSeLlvmJitWrapper::AddSplitModule(
+    std::unique_ptr<llvm::Module> module,
+    std::unique_ptr<llvm::LLVMContext> llvm_ctx) {
+    // a context can not be used by several threads, so every part is
+    // parsed into its own context
+    std::string key = module->getModuleIdentifier();
+    std::vector<std::pair<std::string, std::string>> parts;
+    ::llvm::SplitModule(
+        std::move(module), compile_thread_num_,
+        [&](std::unique_ptr<::llvm::Module> part) {
+            bool empty = true;
+            for (auto& global : part->global_objects()) {
+                empty = empty && global.isDeclaration();
+            }
+            if (empty) {
+                return;
+            }
+            parts.emplace_back(key + "_" + std::to_string(parts.size()),
+                               LlvmToString(*part));
+        });
+    DLOG(INFO) << "compile " << parts.size() << " module parts of " << key;
+    // a part may refer to the symbols of the others, so all the parts are
+    // added before any of them is compiled
+    std::vector<::llvm::orc::ThreadSafeModule> modules(parts.size());
+    std::vector<std::vector<std::string>> fns(parts.size());
+    std::atomic<bool> ok(true);
+    RunOnThreads(parts.size(), [&](size_t i) {
+        if (!OptModulePart(parts[i].first, parts[i].second, &modules[i],
+                           &fns[i])) {
+            ok = false;
+        }
+    });
+    if (!ok) {
+        return false;
+    }
+    for (auto& part : modules) {
+        ::llvm::Error e = jit_->addIRModule(std::move(part));
+        if (e) {
+            LOG(WARNING) << "fail to add module part: " << LlvmToString(e);
+            return false;
+        }
+    }
+    // the lookup compiles the part on its thread
+    RunOnThreads(parts.size(), [&](size_t i) {
+        for (auto& fn : fns[i]) {
+            auto symbol = jit_->lookup(fn);
+            if (!symbol) {
+                LOG(WARNING) << "fail to resolve fn address of " << fn << ": "
+                             << LlvmToString(symbol.takeError());
+                ok = false;
+                return;
+            }
+        }
+    });
+    return ok;
+}
+
+bool HybridSeLlvmJitWrapper::OptModulePart(
+    const std::string& id, const std::string& ir,
+    ::llvm::orc::ThreadSafeModule* output, std::vector<std::string>* fns) {
+    auto llvm_ctx = ::llvm::make_unique<::llvm::LLVMContext>();
+    auto module = ParseModule(ir, llvm_ctx.get());
+    if (module == nullptr) {
+        LOG(WARNING) << "fail to parse module part " << id;
+        return false;
+    }
+    module->setModuleIdentifier(id);
+    bool cached = object_cache_ && object_cache_->Contains(id);
+    if (!cached && !jit_->OptModule(module.get())) {
+        LOG(WARNING) << "fail to opt module part " << id;
+        return false;
+    }
+    *fns = GetExternalFunctions(module.get());
+    *output =
+        ::llvm::orc::ThreadSafeModule(std::move(module), std::move(llvm_ctx));
+    return true;
+}
+
+void HybridSeLlvmJitWrapper::WaitTierUp() {
+    for (auto& thread : tier_up_threads_) {
+        thread.join();
+    }
+    tier_up_threads_.clear();
+}
+
 RawPtrHandle HybridSeLlvmJitWrapper::FindFunction(const std::string& funcname) {
     if (funcname == "") {
         return 0;
     }
+    if (stubs_) {
+        std::lock_guard<std::mutex> lock(stubs_mu_);
+        auto stub = stubs_->findStub(funcname, true);
+        if (stub) {
+            return reinterpret_cast<const int8_t*>(stub.getAddress());
+        }
+    }
     ::llvm::Expected<::llvm::JITEvaluatedSymbol> symbol(jit_->lookup(funcname));
     ::llvm::Error e = symbol.takeError();
     if (e) {
@@ -200,6 +566,10 @@ RawPtrHandle HybridSeLlvmJitWrapper::FindFunction(const std::string& funcname) {
 
 bool HybridSeLlvmJitWrapper::AddExternalFunction(const std::string& name,
                                                void* addr) {
+    if (fast_jit_ && !hybridse::vm::HybridSeJit::AddSymbol(
+                         fast_jit_->getMainJITDylib(), *fast_mi_, name, addr)) {
+        return false;
+    }
     return hybridse::vm::HybridSeJit::AddSymbol(jit_->getMainJITDylib(), *mi_,
                                                 name, addr);
 }
@@ -17,11 +17,18 @@
 #ifndef SRC_VM_JIT_H_
 #define SRC_VM_JIT_H_
 
+#include <condition_variable>  // NOLINT
 #include <map>
 #include <memory>
+#include <mutex>  // NOLINT
 #include <string>
+#include <thread>  // NOLINT
+#include <vector>
 #include "llvm/ExecutionEngine/GenericValue.h"
+#include "llvm/ExecutionEngine/Orc/IndirectionUtils.h"
 #include "llvm/ExecutionEngine/Orc/LLJIT.h"
+#include "vm/jit_object_cache.h"
+#include "vm/jit_profile.h"
 #include "vm/jit_wrapper.h"
 
 #ifdef LLVM_EXT_ENABLE
@@ -50,6 +57,9 @@ class HybridSeJit : public ::llvm::orc::LLJIT {
 
     bool OptModule(::llvm::Module* m);
 
+    // link the builtin bitcode into the modules optimized by OptModule
+    void SetInlineBuiltins(bool flag) { inline_builtins_ = flag; }
+
     ::llvm::orc::VModuleKey CreateVModule();
 
     void ReleaseVModule(::llvm::orc::VModuleKey key);
@@ -68,6 +78,9 @@ class HybridSeJit : public ::llvm::orc::LLJIT {
 
  protected:
     HybridSeJit(::llvm::orc::LLJITBuilderState& s, ::llvm::Error& e);  // NOLINT
+
+ private:
+    bool inline_builtins_ = false;
 };
 
 class HybridSeJitBuilder
@@ -88,12 +101,23 @@ std::string LlvmToString(const T& value) {
 class HybridSeLlvmJitWrapper : public HybridSeJitWrapper {
  public:
     HybridSeLlvmJitWrapper() {}
-    ~HybridSeLlvmJitWrapper() {}
+    explicit HybridSeLlvmJitWrapper(const JitOptions& jit_options)
+        : object_cache_dir_(jit_options.object_cache_dir()),
+          enable_tiered_compile_(jit_options.is_enable_tiered_compile()),
+          compile_thread_num_(jit_options.compile_thread_num()),
+          pgo_profile_runs_(jit_options.pgo_profile_runs()),
+          enable_inline_builtins_(jit_options.is_enable_inline_builtins()) {}
+    ~HybridSeLlvmJitWrapper() {
+        StopTierUp();
+        WaitTierUp();
+    }
 
     bool Init() override;
 
     bool OptModule(::llvm::Module* module) override;
 
+    bool LookupObjectCache(::llvm::Module* module) override;
+
     bool AddModule(std::unique_ptr<llvm::Module> module,
                    std::unique_ptr<llvm::LLVMContext> llvm_ctx) override;
 
@@ -102,9 +126,51 @@ class HybridSeLlvmJitWrapper : public HybridSeJitWrapper {
     hybridse::vm::RawPtrHandle FindFunction(
         const std::string& funcname) override;
 
+    // wait until the modules added in tiered mode are optimized
+    void WaitTierUp();
+
  private:
+    bool InitFastJit();
+    bool AddTieredModule(std::unique_ptr<llvm::Module> module,
+                         std::unique_ptr<llvm::LLVMContext> llvm_ctx);
+    void TierUp(const std::string& ir, const std::vector<std::string>& fns,
+                const JitProfile* profile);
+    // wait until the module is profiled by enough runs, return false if
+    // the tier up is stopped
+    bool WaitProfile(const JitProfile* profile);
+    void StopTierUp();
+    bool AddSplitModule(std::unique_ptr<llvm::Module> module,
+                        std::unique_ptr<llvm::LLVMContext> llvm_ctx);
+    bool OptModulePart(const std::string& id, const std::string& ir,
+                       ::llvm::orc::ThreadSafeModule* output,
+                       std::vector<std::string>* fns);
+
+    std::string object_cache_dir_;
+    bool enable_tiered_compile_ = false;
+    uint32_t compile_thread_num_ = 1;
+    // the cache outlives the jit, whose compiler refers to it
+    std::unique_ptr<JitObjectCache> object_cache_;
     std::unique_ptr<HybridSeJit> jit_;
     std::unique_ptr<::llvm::orc::MangleAndInterner> mi_;
+
+    // in tiered mode a module is compiled by the fast jit at first, the
+    // functions are called through stubs which are pointed to the code of
+    // jit_ once the module is optimized
+    std::unique_ptr<HybridSeJit> fast_jit_;
+    std::unique_ptr<::llvm::orc::MangleAndInterner> fast_mi_;
+    std::unique_ptr<::llvm::orc::IndirectStubsManager> stubs_;
+    std::mutex stubs_mu_;
+    std::vector<std::thread> tier_up_threads_;
+
+    // the unoptimized code keeps counting after the tier up, so the
+    // profiles live as long as the jit
+    uint32_t pgo_profile_runs_ = 0;
+    std::vector<std::unique_ptr<JitProfile>> profiles_;
+    std::mutex tier_up_mu_;
+    std::condition_variable tier_up_cv_;
+    bool tier_up_stopped_ = false;
+
+    bool enable_inline_builtins_ = false;
 };
 
 #ifdef LLVM_EXT_ENABLE
@@ -0,0 +1,131 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "vm/jit_object_cache.h"
+#include <unistd.h>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <thread>  // NOLINT
+#include <utility>
+#include "glog/logging.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Host.h"
+#include "llvm/Support/SHA1.h"
+#include "llvm/Support/raw_ostream.h"
+
+namespace hybridse {
+namespace vm {
+
+static const char OBJECT_KEY_PREFIX[] = "hybridse_obj_";
+
+JitObjectCache::JitObjectCache(const std::string& dir) : dir_(dir) {}
+
+bool JitObjectCache::Init() {
+    std::error_code ec = ::llvm::sys::fs::create_directories(dir_);
+    if (ec) {
+        LOG(WARNING) << "fail to create jit object cache dir " << dir_ << ": "
+                     << ec.message();
+        return false;
+    }
+    return true;
+}
+
+std::string JitObjectCache::GetKey(const ::llvm::Module& module) {
+    ::llvm::SHA1 sha;
+    {
+        std::string ir;
+        ::llvm::raw_string_ostream ss(ir);
+        module.print(ss, nullptr);
+        ss.flush();
+        sha.update(ir);
+    }
+    // the machine code depends on the compiler and the cpu
+    sha.update(LLVM_VERSION_STRING);
+    sha.update(::llvm::sys::getProcessTriple());
+    sha.update(::llvm::sys::getHostCPUName());
+    ::llvm::StringMap<bool> features;
+    if (::llvm::sys::getHostCPUFeatures(features)) {
+        std::map<std::string, bool> sorted_features;
+        for (const auto& feature : features) {
+            sorted_features.emplace(feature.first().str(), feature.second);
+        }
+        for (const auto& feature : sorted_features) {
+            sha.update(feature.second ? "+" : "-");
+            sha.update(feature.first);
+        }
+    }
+    return OBJECT_KEY_PREFIX + ::llvm::toHex(sha.final(), true);
+}
+
+bool JitObjectCache::IsKey(const std::string& id) {
+    return 0 == id.compare(0, sizeof(OBJECT_KEY_PREFIX) - 1, OBJECT_KEY_PREFIX);
+}
+
+std::string JitObjectCache::GetPath(const std::string& key) const {
+    return dir_ + "/" + key + ".o";
+}
+
+bool JitObjectCache::Contains(const std::string& key) const {
+    return IsKey(key) && ::llvm::sys::fs::exists(GetPath(key));
+}
+
+void JitObjectCache::notifyObjectCompiled(const ::llvm::Module* module,
+                                          ::llvm::MemoryBufferRef obj) {
+    std::string key = module->getModuleIdentifier();
+    if (!IsKey(key)) {
+        return;
+    }
+    // written aside and renamed, the readers never see a partial object
+    std::ostringstream tmp_path;
+    tmp_path << GetPath(key) << ".tmp." << getpid() << "."
+             << std::this_thread::get_id();
+    {
+        std::ofstream out(tmp_path.str(), std::ios::binary | std::ios::trunc);
+        out.write(obj.getBufferStart(), obj.getBufferSize());
+        if (!out.good()) {
+            LOG(WARNING) << "fail to write jit object " << tmp_path.str();
+            out.close();
+            std::remove(tmp_path.str().c_str());
+            return;
+        }
+    }
+    if (0 != std::rename(tmp_path.str().c_str(), GetPath(key).c_str())) {
+        LOG(WARNING) << "fail to rename jit object " << tmp_path.str();
+        std::remove(tmp_path.str().c_str());
+    }
+}
+
+std::unique_ptr<::llvm::MemoryBuffer> JitObjectCache::getObject(
+    const ::llvm::Module* module) {
+    std::string key = module->getModuleIdentifier();
+    if (!IsKey(key)) {
+        return nullptr;
+    }
+    auto buf = ::llvm::MemoryBuffer::getFile(GetPath(key));
+    if (!buf || 0 == (*buf)->getBufferSize()) {
+        return nullptr;
+    }
+    DLOG(INFO) << "load jit object " << key;
+    return std::move(*buf);
+}
+
+}  // namespace vm
+}  // namespace hybridse
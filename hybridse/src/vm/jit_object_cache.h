@@ -0,0 +1,62 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_VM_JIT_OBJECT_CACHE_H_
+#define SRC_VM_JIT_OBJECT_CACHE_H_
+
+#include <memory>
+#include <string>
+#include "llvm/ExecutionEngine/ObjectCache.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/MemoryBuffer.h"
+
+namespace hybridse {
+namespace vm {
+
+/// \brief The objects compiled from the sql modules, kept as files of a
+/// directory so that they outlive the process.
+///
+/// An object is keyed by the digest of the module ir before optimization,
+/// the llvm version and the host cpu, so the same sql over the same schemas
+/// and udfs is not compiled again after a restart.
+class JitObjectCache : public ::llvm::ObjectCache {
+ public:
+    explicit JitObjectCache(const std::string& dir);
+    ~JitObjectCache() {}
+
+    bool Init();
+
+    /// Return the key of the object compiled from `module` on this host.
+    static std::string GetKey(const ::llvm::Module& module);
+
+    bool Contains(const std::string& key) const;
+
+    void notifyObjectCompiled(const ::llvm::Module* module,
+                              ::llvm::MemoryBufferRef obj) override;
+
+    std::unique_ptr<::llvm::MemoryBuffer> getObject(
+        const ::llvm::Module* module) override;
+
+ private:
+    static bool IsKey(const std::string& id);
+    std::string GetPath(const std::string& key) const;
+
+    const std::string dir_;
+};
+
+}  // namespace vm
+}  // namespace hybridse
+#endif  // SRC_VM_JIT_OBJECT_CACHE_H_
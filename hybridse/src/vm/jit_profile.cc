@@ -0,0 +1,161 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "vm/jit_profile.h"
+
+#include <algorithm>
+#include "glog/logging.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/MDBuilder.h"
+
+namespace hybridse {
+namespace vm {
+
+static ::llvm::Value* GetCounterPtr(::llvm::IRBuilder<>* builder,
+                                    std::atomic<uint64_t>* counter) {
+    return ::llvm::ConstantExpr::getIntToPtr(
+        builder->getInt64(reinterpret_cast<uint64_t>(counter)),
+        builder->getInt64Ty()->getPointerTo());
+}
+
+static void CreateCounterAdd(::llvm::IRBuilder<>* builder,
+                             std::atomic<uint64_t>* counter,
+                             ::llvm::Value* value) {
+    // the counters are shared by the threads running the module
+#if LLVM_VERSION_MAJOR >= 13
+    builder->CreateAtomicRMW(::llvm::AtomicRMWInst::Add,
+                             GetCounterPtr(builder, counter), value,
+                             ::llvm::MaybeAlign(8),
+                             ::llvm::AtomicOrdering::Monotonic);
+#else
+    builder->CreateAtomicRMW(::llvm::AtomicRMWInst::Add,
+                             GetCounterPtr(builder, counter), value,
+                             ::llvm::AtomicOrdering::Monotonic);
+#endif
+}
+
+void JitProfile::Collect(::llvm::Module* module,
+                         std::vector<::llvm::Function*>* functions,
+                         std::vector<::llvm::Instruction*>* branches) {
+    for (auto& function : *module) {
+        if (function.isDeclaration()) {
+            continue;
+        }
+        functions->push_back(&function);
+        for (auto& block : function) {
+            for (auto& inst : block) {
+                if (auto br = ::llvm::dyn_cast<::llvm::BranchInst>(&inst)) {
+                    if (br->isConditional()) {
+                        branches->push_back(br);
+                    }
+                } else if (auto select =
+                               ::llvm::dyn_cast<::llvm::SelectInst>(&inst)) {
+                    if (select->getCondition()->getType()->isIntegerTy(1)) {
+                        branches->push_back(select);
+                    }
+                }
+            }
+        }
+    }
+}
+
+bool JitProfile::Instrument(::llvm::Module* module) {
+    std::vector<::llvm::Function*> functions;
+    std::vector<::llvm::Instruction*> branches;
+    Collect(module, &functions, &branches);
+    function_num_ = functions.size();
+    branch_num_ = branches.size();
+    size_t counter_num = function_num_ + branch_num_ * 2;
+    counters_.reset(new std::atomic<uint64_t>[counter_num]);
+    for (size_t i = 0; i < counter_num; i++) {
+        counters_[i].store(0, std::memory_order_relaxed);
+    }
+
+    ::llvm::IRBuilder<> builder(module->getContext());
+    exported_.clear();
+    for (size_t i = 0; i < function_num_; i++) {
+        exported_.push_back(!functions[i]->hasLocalLinkage());
+        builder.SetInsertPoint(&*functions[i]->getEntryBlock().getFirstInsertionPt());
+        CreateCounterAdd(&builder, &counters_[i], builder.getInt64(1));
+    }
+    for (size_t i = 0; i < branch_num_; i++) {
+        ::llvm::Value* cond = nullptr;
+        if (auto br = ::llvm::dyn_cast<::llvm::BranchInst>(branches[i])) {
+            cond = br->getCondition();
+        } else {
+            cond = ::llvm::cast<::llvm::SelectInst>(branches[i])->getCondition();
+        }
+        builder.SetInsertPoint(branches[i]);
+        size_t pos = function_num_ + i * 2;
+        CreateCounterAdd(&builder, &counters_[pos],
+                         builder.CreateZExt(cond, builder.getInt64Ty()));
+        CreateCounterAdd(&builder, &counters_[pos + 1], builder.getInt64(1));
+    }
+    DLOG(INFO) << "instrument " << function_num_ << " functions and "
+               << branch_num_ << " branches of " << module->getModuleIdentifier();
+    return true;
+}
+
+uint64_t JitProfile::runs() const {
+    uint64_t runs = 0;
+    for (size_t i = 0; i < function_num_; i++) {
+        if (exported_[i]) {
+            runs = std::max(runs, counters_[i].load(std::memory_order_relaxed));
+        }
+    }
+    return runs;
+}
+
+bool JitProfile::Annotate(::llvm::Module* module) const {
+    std::vector<::llvm::Function*> functions;
+    std::vector<::llvm::Instruction*> branches;
+    Collect(module, &functions, &branches);
+    if (functions.size() != function_num_ || branches.size() != branch_num_) {
+        LOG(WARNING) << "the profile does not match module "
+                     << module->getModuleIdentifier();
+        return false;
+    }
+    for (size_t i = 0; i < function_num_; i++) {
+        functions[i]->setEntryCount(::llvm::Function::ProfileCount(
+            counters_[i].load(std::memory_order_relaxed),
+            ::llvm::Function::PCT_Real));
+    }
+    ::llvm::MDBuilder md_builder(module->getContext());
+    for (size_t i = 0; i < branch_num_; i++) {
+        size_t pos = function_num_ + i * 2;
+        uint64_t true_count = counters_[pos].load(std::memory_order_relaxed);
+        uint64_t total = counters_[pos + 1].load(std::memory_order_relaxed);
+        if (total == 0) {
+            // not reached in the profile
+            continue;
+        }
+        // the counters grow independently
+        true_count = std::min(true_count, total);
+        uint64_t false_count = total - true_count;
+        // the weights are 32 bits
+        uint64_t scale = total / UINT32_MAX + 1;
+        branches[i]->setMetadata(
+            ::llvm::LLVMContext::MD_prof,
+            md_builder.createBranchWeights(
+                static_cast<uint32_t>(true_count / scale),
+                static_cast<uint32_t>(false_count / scale)));
+    }
+    return true;
+}
+
+}  // namespace vm
+}  // namespace hybridse
@@ -0,0 +1,64 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_VM_JIT_PROFILE_H_
+#define SRC_VM_JIT_PROFILE_H_
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include "llvm/IR/Instruction.h"
+#include "llvm/IR/Module.h"
+
+namespace hybridse {
+namespace vm {
+
+/// \brief The counters of the function entries and the conditional
+/// branches of a module, collected by the instrumented code at runtime.
+///
+/// The branches and selects are numbered in the order of the module, so
+/// the profile collected by an instrumented module can be attached to
+/// another copy of the module before instrumentation.
+class JitProfile {
+ public:
+    JitProfile() : counters_(nullptr), function_num_(0), branch_num_(0) {}
+
+    /// Add the counting code to `module`, which must not be freed before
+    /// the profile.
+    bool Instrument(::llvm::Module* module);
+
+    /// Return the max entry count of the exported functions.
+    uint64_t runs() const;
+
+    /// Attach the entry counts and the branch weights to `module`.
+    bool Annotate(::llvm::Module* module) const;
+
+ private:
+    static void Collect(::llvm::Module* module,
+                        std::vector<::llvm::Function*>* functions,
+                        std::vector<::llvm::Instruction*>* branches);
+
+    // the entry counters of the functions, followed by the true and the
+    // total counters of each branch
+    std::unique_ptr<std::atomic<uint64_t>[]> counters_;
+    size_t function_num_;
+    size_t branch_num_;
+    std::vector<bool> exported_;
+};
+
+}  // namespace vm
+}  // namespace hybridse
+#endif  // SRC_VM_JIT_PROFILE_H_
@@ -56,7 +56,28 @@ class JitRuntime {
      */
     void ReleaseRunStep();
 
+    /**
+     * Make the allocations of the next run step up to the bytes in total
+     * fit in one chunk of the pool.
+     */
+    void ReserveRunStep(size_t bytes) { mem_pool_.Reserve(bytes); }
+
+    /**
+     * Return the max bytes allocated in a run step since the last
+     * `ResetPeakRunStepBytes()`.
+     */
+    size_t GetPeakRunStepBytes() const { return mem_pool_.peak_used_size(); }
+    void ResetPeakRunStepBytes() { mem_pool_.ResetPeak(); }
+
+    /**
+     * Return the heap allocations of the runtime pools of all threads.
+     */
+    static base::MemPoolStats GetMemPoolStats() {
+        return base::ByteMemoryPool::GetStats();
+    }
+
  private:
+    // the memory is kept by the pool for the next run steps of the thread
     base::ByteMemoryPool mem_pool_;
     std::list<base::FeBaseObject*> allocated_obj_pool_;
 
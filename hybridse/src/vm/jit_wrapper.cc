@@ -15,8 +15,10 @@
  */
 #include "vm/jit_wrapper.h"
 
+#include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 #include "glog/logging.h"
 #include "llvm/ExecutionEngine/JITSymbol.h"
 #include "llvm/ExecutionEngine/Orc/CompileUtils.h"
@@ -43,10 +45,10 @@
 namespace hybridse {
 namespace vm {
 
-bool HybridSeJitWrapper::AddModuleFromBuffer(const base::RawBuffer& buf) {
+static std::unique_ptr<::llvm::Module> ParseModuleBuffer(
+    const base::RawBuffer& buf, ::llvm::LLVMContext* llvm_ctx) {
     std::string buf_str(buf.addr, buf.size);
     ::llvm::SMDiagnostic diagnostic;
-    auto llvm_ctx = ::llvm::make_unique<::llvm::LLVMContext>();
     auto mem_buf = ::llvm::MemoryBuffer::getMemBuffer(buf_str);
     auto llvm_module = parseIR(*mem_buf, diagnostic, *llvm_ctx);
     if (llvm_module == nullptr) {
@@ -54,11 +56,49 @@ bool HybridSeJitWrapper::AddModuleFromBuffer(const base::RawBuffer& buf) {
         std::string err_msg;
         llvm::raw_string_ostream err_msg_stream(err_msg);
         diagnostic.print("", err_msg_stream);
+        return nullptr;
+    }
+    return llvm_module;
+}
+
+bool HybridSeJitWrapper::AddModuleFromBuffer(const base::RawBuffer& buf) {
+    auto llvm_ctx = ::llvm::make_unique<::llvm::LLVMContext>();
+    auto llvm_module = ParseModuleBuffer(buf, llvm_ctx.get());
+    if (llvm_module == nullptr) {
         return false;
     }
+    // the module compiled by the other processes with the same cache dir
+    // on the same kind of host is loaded from the cache
+    LookupObjectCache(llvm_module.get());
     return this->AddModule(std::move(llvm_module), std::move(llvm_ctx));
 }
 
+bool HybridSeJitWrapper::CompileModuleFromBuffer(const base::RawBuffer& buf) {
+    auto llvm_ctx = ::llvm::make_unique<::llvm::LLVMContext>();
+    auto llvm_module = ParseModuleBuffer(buf, llvm_ctx.get());
+    if (llvm_module == nullptr) {
+        return false;
+    }
+    std::vector<std::string> fns;
+    for (auto& fn : *llvm_module) {
+        if (!fn.isDeclaration() && fn.hasExternalLinkage()) {
+            fns.push_back(fn.getName().str());
+        }
+    }
+    LookupObjectCache(llvm_module.get());
+    if (!this->AddModule(std::move(llvm_module), std::move(llvm_ctx))) {
+        return false;
+    }
+    // the module is compiled lazily on the first lookup of its functions
+    for (auto& fn : fns) {
+        if (FindFunction(fn) == nullptr) {
+            LOG(WARNING) << "fail to compile fn " << fn;
+            return false;
+        }
+    }
+    return true;
+}
+
 bool HybridSeJitWrapper::InitJitSymbols(HybridSeJitWrapper* jit) {
     InitBuiltinJitSymbols(jit);
     udf::DefaultUdfLibrary::get()->InitJITSymbols(jit);
@@ -83,7 +123,7 @@ HybridSeJitWrapper* HybridSeJitWrapper::Create(const JitOptions& jit_options) {
             jit_options.is_enable_gdb()) {
             LOG(WARNING) << "LLJIT do not support jit events";
         }
-        return new HybridSeLlvmJitWrapper();
+        return new HybridSeLlvmJitWrapper(jit_options);
     }
 }
 
@@ -193,6 +233,9 @@ void InitBuiltinJitSymbols(HybridSeJitWrapper* jit) {
     jit->AddExternalFunction(
         "hybridse_storage_row_iter_get_cur_slice_size",
         reinterpret_cast<void*>(&hybridse::vm::RowIterGetCurSliceSize));
+    jit->AddExternalFunction(
+        "hybridse_storage_row_iter_get_cur_row",
+        reinterpret_cast<void*>(&hybridse::vm::RowIterGetCurRow));
 
     jit->AddExternalFunction(
         "hybridse_storage_row_iter_delete",
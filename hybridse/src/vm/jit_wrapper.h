@@ -41,6 +41,10 @@ class HybridSeJitWrapper {
     virtual bool Init() = 0;
     virtual bool OptModule(::llvm::Module* module) = 0;
 
+    // Tag the module with the key of its object in the object cache, return
+    // true if the object is cached so that the optimization can be skipped.
+    virtual bool LookupObjectCache(::llvm::Module* module) { return false; }
+
     virtual bool AddModule(std::unique_ptr<llvm::Module> module,
                            std::unique_ptr<llvm::LLVMContext> llvm_ctx) = 0;
 
@@ -48,6 +52,10 @@ class HybridSeJitWrapper {
 
     bool AddModuleFromBuffer(const base::RawBuffer&);
 
+    // Add the module and compile all of its functions now, which writes the
+    // objects to the object cache if it is enabled.
+    bool CompileModuleFromBuffer(const base::RawBuffer&);
+
     virtual hybridse::vm::RawPtrHandle FindFunction(
         const std::string& funcname) = 0;
 
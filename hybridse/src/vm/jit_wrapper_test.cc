@@ -15,10 +15,13 @@
  */
 
 #include "vm/jit_wrapper.h"
+#include <unistd.h>
 #include "codec/fe_row_codec.h"
 #include "gtest/gtest.h"
+#include "llvm/Support/FileSystem.h"
 #include "udf/udf.h"
 #include "vm/engine.h"
+#include "vm/jit.h"
 #include "vm/simple_catalog.h"
 #include "vm/sql_compiler.h"
 
@@ -150,6 +153,171 @@ TEST_F(JitWrapperTest, test_window) {
     delete jit;
 }
 
+TEST_F(JitWrapperTest, test_object_cache) {
+    std::string dir = "/tmp/jit_object_cache_test_" + std::to_string(getpid());
+    EngineOptions options;
+    options.jit_options().set_object_cache_dir(dir);
+    auto catalog = GetTestCatalog();
+    std::string sql = "select col_1, col_2 + 1 from t1;";
+    // the second compile loads the object of the first one
+    for (int i = 0; i < 2; i++) {
+        auto compile_info = Compile(sql, options, catalog);
+        ASSERT_TRUE(compile_info != nullptr);
+        auto &sql_context = compile_info->get_sql_context();
+        auto fn_name = sql_context.physical_plan->GetFnInfos()[0]->fn_name();
+        auto fn = sql_context.jit->FindFunction(fn_name);
+        ASSERT_TRUE(fn != nullptr);
+
+        int8_t buf[1024];
+        auto schema = catalog->GetTable("db", "t1")->GetSchema();
+        codec::RowBuilder row_builder(*schema);
+        row_builder.SetBuffer(buf, 1024);
+        row_builder.AppendDouble(3.14);
+        row_builder.AppendInt64(42);
+        hybridse::codec::Row row(base::RefCountedSlice::Create(buf, 1024));
+        hybridse::codec::Row output = CoreAPI::RowProject(fn, row, hybridse::codec::Row());
+        codec::RowView row_view(*schema, output.buf(), output.size());
+        int64_t c2;
+        ASSERT_EQ(row_view.GetInt64(1, &c2), 0);
+        ASSERT_EQ(c2, 43);
+
+        size_t objects = 0;
+        std::error_code ec;
+        for (::llvm::sys::fs::directory_iterator it(dir, ec), end; it != end && !ec; it.increment(ec)) {
+            objects++;
+        }
+        ASSERT_EQ(1u, objects);
+    }
+    ::llvm::sys::fs::remove_directories(dir);
+}
+
+TEST_F(JitWrapperTest, test_tiered_compile) {
+    EngineOptions options;
+    options.jit_options().set_enable_tiered_compile(true);
+    auto catalog = GetTestCatalog();
+    std::string sql = "select col_1, col_2 + 1 from t1;";
+    auto compile_info = Compile(sql, options, catalog);
+    ASSERT_TRUE(compile_info != nullptr);
+    auto &sql_context = compile_info->get_sql_context();
+    auto fn_name = sql_context.physical_plan->GetFnInfos()[0]->fn_name();
+    auto fn = sql_context.jit->FindFunction(fn_name);
+    ASSERT_TRUE(fn != nullptr);
+
+    int8_t buf[1024];
+    auto schema = catalog->GetTable("db", "t1")->GetSchema();
+    codec::RowBuilder row_builder(*schema);
+    row_builder.SetBuffer(buf, 1024);
+    row_builder.AppendDouble(3.14);
+    row_builder.AppendInt64(42);
+    hybridse::codec::Row row(base::RefCountedSlice::Create(buf, 1024));
+    // the same fn address before and after the tier up
+    for (int i = 0; i < 2; i++) {
+        hybridse::codec::Row output = CoreAPI::RowProject(fn, row, hybridse::codec::Row());
+        codec::RowView row_view(*schema, output.buf(), output.size());
+        int64_t c2;
+        ASSERT_EQ(row_view.GetInt64(1, &c2), 0);
+        ASSERT_EQ(c2, 43);
+        auto jit = dynamic_cast<HybridSeLlvmJitWrapper *>(sql_context.jit.get());
+        ASSERT_TRUE(jit != nullptr);
+        jit->WaitTierUp();
+        ASSERT_EQ(fn, sql_context.jit->FindFunction(fn_name));
+    }
+}
+
+TEST_F(JitWrapperTest, test_pgo_tiered_compile) {
+    EngineOptions options;
+    options.jit_options().set_enable_tiered_compile(true);
+    options.jit_options().set_pgo_profile_runs(10);
+    auto catalog = GetTestCatalog();
+    std::string sql = "select col_1, case when col_2 > 40 then col_2 + 1 else col_2 - 1 end from t1;";
+    auto compile_info = Compile(sql, options, catalog);
+    ASSERT_TRUE(compile_info != nullptr);
+    auto &sql_context = compile_info->get_sql_context();
+    auto fn_name = sql_context.physical_plan->GetFnInfos()[0]->fn_name();
+    auto fn = sql_context.jit->FindFunction(fn_name);
+    ASSERT_TRUE(fn != nullptr);
+
+    int8_t buf[1024];
+    auto schema = catalog->GetTable("db", "t1")->GetSchema();
+    codec::RowBuilder row_builder(*schema);
+    row_builder.SetBuffer(buf, 1024);
+    row_builder.AppendDouble(3.14);
+    row_builder.AppendInt64(42);
+    hybridse::codec::Row row(base::RefCountedSlice::Create(buf, 1024));
+    // optimized after the profiled runs
+    for (int i = 0; i < 20; i++) {
+        hybridse::codec::Row output = CoreAPI::RowProject(fn, row, hybridse::codec::Row());
+        codec::RowView row_view(*schema, output.buf(), output.size());
+        int64_t c2;
+        ASSERT_EQ(row_view.GetInt64(1, &c2), 0);
+        ASSERT_EQ(c2, 43);
+        if (i == 10) {
+            auto jit = dynamic_cast<HybridSeLlvmJitWrapper *>(sql_context.jit.get());
+            ASSERT_TRUE(jit != nullptr);
+            jit->WaitTierUp();
+            ASSERT_EQ(fn, sql_context.jit->FindFunction(fn_name));
+        }
+    }
+}
+
+TEST_F(JitWrapperTest, test_compile_threads) {
+    EngineOptions options;
+    options.jit_options().set_compile_thread_num(4);
+    auto catalog = GetTestCatalog();
+    std::string sql = "select col_1, col_2 + 1, substring(string(col_2), 1, 1) as c3, col_2 * 2 from t1;";
+    auto compile_info = Compile(sql, options, catalog);
+    ASSERT_TRUE(compile_info != nullptr);
+    auto &sql_context = compile_info->get_sql_context();
+    auto fn_name = sql_context.physical_plan->GetFnInfos()[0]->fn_name();
+    auto fn = sql_context.jit->FindFunction(fn_name);
+    ASSERT_TRUE(fn != nullptr);
+
+    int8_t buf[1024];
+    auto schema = catalog->GetTable("db", "t1")->GetSchema();
+    codec::RowBuilder row_builder(*schema);
+    row_builder.SetBuffer(buf, 1024);
+    row_builder.AppendDouble(3.14);
+    row_builder.AppendInt64(42);
+    hybridse::codec::Row row(base::RefCountedSlice::Create(buf, 1024));
+    hybridse::codec::Row output = CoreAPI::RowProject(fn, row, hybridse::codec::Row());
+    codec::RowView row_view(sql_context.schema, output.buf(), output.size());
+    int64_t c2;
+    ASSERT_EQ(row_view.GetInt64(1, &c2), 0);
+    ASSERT_EQ(c2, 43);
+    ASSERT_EQ("4", row_view.GetAsString(2));
+    int64_t c4;
+    ASSERT_EQ(row_view.GetInt64(3, &c4), 0);
+    ASSERT_EQ(c4, 84);
+}
+
+TEST_F(JitWrapperTest, test_inline_builtins) {
+    EngineOptions options;
+    options.jit_options().set_enable_inline_builtins(true);
+    auto catalog = GetTestCatalog();
+    std::string sql = "select col_1, abs(col_2 - 50) + year(col_2) as c2, floor(col_1) as c3 from t1;";
+    auto compile_info = Compile(sql, options, catalog);
+    ASSERT_TRUE(compile_info != nullptr);
+    auto &sql_context = compile_info->get_sql_context();
+    auto fn_name = sql_context.physical_plan->GetFnInfos()[0]->fn_name();
+    auto fn = sql_context.jit->FindFunction(fn_name);
+    ASSERT_TRUE(fn != nullptr);
+
+    int8_t buf[1024];
+    auto schema = catalog->GetTable("db", "t1")->GetSchema();
+    codec::RowBuilder row_builder(*schema);
+    row_builder.SetBuffer(buf, 1024);
+    row_builder.AppendDouble(3.14);
+    row_builder.AppendInt64(42);
+    hybridse::codec::Row row(base::RefCountedSlice::Create(buf, 1024));
+    // the same results whether or not the build has the builtin bitcode
+    hybridse::codec::Row output = CoreAPI::RowProject(fn, row, hybridse::codec::Row());
+    codec::RowView row_view(sql_context.schema, output.buf(), output.size());
+    int64_t c2;
+    ASSERT_EQ(row_view.GetInt64(1, &c2), 0);
+    ASSERT_EQ(c2, 8 + 1970);
+    ASSERT_EQ("3", row_view.GetAsString(2));
+}
+
 }  // namespace vm
 }  // namespace hybridse
 
@@ -16,8 +16,59 @@
 
 #include "vm/mem_catalog.h"
 #include <algorithm>
+#include <utility>
+#include <vector>
 namespace hybridse {
 namespace vm {
+
+// the tables of fewer rows are sorted by the comparison
+static const size_t RADIX_SORT_MIN_ROWS = 64;
+
+void SortMemTimeTable(MemTimeTable* table, bool is_asc) {
+    size_t size = table->size();
+    if (size < RADIX_SORT_MIN_ROWS) {
+        if (is_asc) {
+            std::stable_sort(table->begin(), table->end(), AscComparor());
+        } else {
+            std::stable_sort(table->begin(), table->end(), DescComparor());
+        }
+        return;
+    }
+    // the lsd radix sort of the keys and the row positions by bytes, the
+    // complement of the keys are sorted for the descending order. The bytes
+    // all the keys share are skipped
+    std::vector<std::pair<uint64_t, uint32_t>> keys(size);
+    std::vector<std::pair<uint64_t, uint32_t>> buf(size);
+    uint32_t counts[8][256] = {};
+    for (size_t i = 0; i < size; i++) {
+        uint64_t key = is_asc ? (*table)[i].first : ~(*table)[i].first;
+        keys[i] = std::make_pair(key, static_cast<uint32_t>(i));
+        for (size_t b = 0; b < 8; b++) {
+            counts[b][(key >> (b * 8)) & 0xFF]++;
+        }
+    }
+    for (size_t b = 0; b < 8; b++) {
+        uint32_t* count = counts[b];
+        if (count[(keys[0].first >> (b * 8)) & 0xFF] == size) {
+            continue;
+        }
+        uint32_t offset = 0;
+        for (size_t d = 0; d < 256; d++) {
+            uint32_t cnt = count[d];
+            count[d] = offset;
+            offset += cnt;
+        }
+        for (const auto& key : keys) {
+            buf[count[(key.first >> (b * 8)) & 0xFF]++] = key;
+        }
+        keys.swap(buf);
+    }
+    MemTimeTable sorted;
+    for (const auto& key : keys) {
+        sorted.push_back((*table)[key.second]);
+    }
+    table->swap(sorted);
+}
 MemTimeTableIterator::MemTimeTableIterator(const MemTimeTable* table,
                                            const vm::Schema* schema)
     : table_(table),
@@ -136,15 +187,8 @@ void MemTimeTableHandler::PopFrontRow() { table_.pop_front(); }
 const Types& MemTimeTableHandler::GetTypes() { return types_; }
 
 void MemTimeTableHandler::Sort(const bool is_asc) {
-    if (is_asc) {
-        AscComparor comparor;
-        std::sort(table_.begin(), table_.end(), comparor);
-        order_type_ = kAscOrder;
-    } else {
-        DescComparor comparor;
-        std::sort(table_.begin(), table_.end(), comparor);
-        order_type_ = kDescOrder;
-    }
+    SortMemTimeTable(&table_, is_asc);
+    order_type_ = is_asc ? kAscOrder : kDescOrder;
 }
 void MemTimeTableHandler::Reverse() {
     std::reverse(table_.begin(), table_.end());
@@ -199,19 +243,10 @@ std::unique_ptr<WindowIterator> MemPartitionHandler::GetWindowIterator() {
         new MemWindowIterator(&partitions_, schema_));
 }
 void MemPartitionHandler::Sort(const bool is_asc) {
-    if (is_asc) {
-        AscComparor comparor;
-        for (auto& segment : partitions_) {
-            std::sort(segment.second.begin(), segment.second.end(), comparor);
-        }
-        order_type_ = kAscOrder;
-    } else {
-        DescComparor comparor;
-        for (auto& segment : partitions_) {
-            std::sort(segment.second.begin(), segment.second.end(), comparor);
-        }
-        order_type_ = kDescOrder;
+    for (auto& segment : partitions_) {
+        SortMemTimeTable(&segment.second, is_asc);
     }
+    order_type_ = is_asc ? kAscOrder : kDescOrder;
 }
 void MemPartitionHandler::Reverse() {
     for (auto& segment : partitions_) {
@@ -412,6 +447,12 @@ size_t RowIterGetCurSliceSize(int8_t* iter_ptr, size_t idx) {
     const Row& row = local_iter->GetValue();
     return row.size(idx);
 }
+int8_t* RowIterGetCurRow(int8_t* iter_ptr) {
+    auto& local_iter =
+        *reinterpret_cast<std::unique_ptr<RowIterator>*>(iter_ptr);
+    const Row& row = local_iter->GetValue();
+    return reinterpret_cast<int8_t*>(const_cast<Row*>(&row));
+}
 void RowIterDelete(int8_t* iter_ptr) {
     auto& local_iter =
         *reinterpret_cast<std::unique_ptr<RowIterator>*>(iter_ptr);
@@ -15,6 +15,7 @@
  */
 
 #include "vm/mem_catalog.h"
+#include <algorithm>
 #include "gtest/gtest.h"
 #include "vm/catalog_wrapper.h"
 #include "testing/test_base.h"
@@ -421,6 +422,27 @@ TEST_F(MemCataLogTest, mem_partition_test) {
     }
 }
 
+TEST_F(MemCataLogTest, mem_segment_at_test) {
+    std::vector<Row> rows;
+    ::hybridse::type::TableDef table;
+    BuildRows(table, rows);
+    auto partition_handler = std::make_shared<MemPartitionHandler>(
+        "t1", "temp", &(table.columns()));
+    uint64_t ts = 1;
+    for (auto row : rows) {
+        partition_handler->AddRow("group1", ts++, row);
+    }
+    partition_handler->Sort(false);
+    auto segment = partition_handler->GetSegment("group1");
+    // the positions are served in any order, back and forth
+    ASSERT_TRUE(segment->At(2).buf() == rows[2].buf());
+    ASSERT_TRUE(segment->At(0).buf() == rows[4].buf());
+    ASSERT_TRUE(segment->At(4).buf() == rows[0].buf());
+    ASSERT_TRUE(segment->At(1).buf() == rows[3].buf());
+    ASSERT_TRUE(segment->At(5).empty());
+    ASSERT_TRUE(segment->At(3).buf() == rows[1].buf());
+}
+
 TEST_F(MemCataLogTest, mem_row_handler_test) {
     std::vector<Row> rows;
     ::hybridse::type::TableDef table;
@@ -465,6 +487,37 @@ TEST_F(MemCataLogTest, mem_row_comcat_test) {
     }
 }
 
+TEST_F(MemCataLogTest, mem_time_table_sort_test) {
+    std::vector<Row> rows;
+    ::hybridse::type::TableDef table;
+    BuildRows(table, rows);
+    // the small tables are sorted by the comparison and the others by radix
+    for (size_t size : {10, 63, 64, 1000}) {
+        for (bool is_asc : {true, false}) {
+            MemTimeTable time_table;
+            for (size_t i = 0; i < size; i++) {
+                // the negative keys, the ties and the keys of distinct bytes
+                uint64_t key = i % 3 == 0 ? static_cast<uint64_t>(-1 - i % 7)
+                                          : (i * 7919 % 101) << (i % 5 * 8);
+                time_table.push_back(std::make_pair(key, rows[i % 5]));
+            }
+            MemTimeTable expect = time_table;
+            if (is_asc) {
+                std::stable_sort(expect.begin(), expect.end(), AscComparor());
+            } else {
+                std::stable_sort(expect.begin(), expect.end(), DescComparor());
+            }
+            SortMemTimeTable(&time_table, is_asc);
+            ASSERT_EQ(expect.size(), time_table.size());
+            for (size_t i = 0; i < size; i++) {
+                ASSERT_EQ(expect[i].first, time_table[i].first);
+                ASSERT_TRUE(expect[i].second.buf() ==
+                            time_table[i].second.buf());
+            }
+        }
+    }
+}
+
 }  // namespace vm
 }  // namespace hybridse
 int main(int argc, char** argv) {
@@ -0,0 +1,149 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "vm/request_result_cache.h"
+#include <chrono>  // NOLINT
+#include <cstring>
+
+namespace hybridse {
+namespace vm {
+
+RequestResultCache::RequestResultCache(uint32_t capacity, uint32_t ttl_ms,
+                                       const std::vector<std::shared_ptr<TableHandler>>& tables)
+    : capacity_(capacity), ttl_ms_(ttl_ms), tables_(tables), mu_(), lru_(), entries_() {}
+
+void RequestResultCache::CollectTables(const PhysicalOpNode* node,
+                                       std::vector<std::shared_ptr<TableHandler>>* tables) {
+    if (node == nullptr) {
+        return;
+    }
+    if (node->GetOpType() == kPhysicalOpDataProvider) {
+        auto provider = dynamic_cast<const PhysicalDataProviderNode*>(node);
+        if (provider->provider_type_ != kProviderTypeRequest && provider->table_handler_) {
+            for (const auto& table : *tables) {
+                if (table == provider->table_handler_) {
+                    return;
+                }
+            }
+            tables->push_back(provider->table_handler_);
+        }
+        return;
+    }
+    for (auto producer : node->GetProducers()) {
+        CollectTables(producer, tables);
+    }
+}
+
+bool RequestResultCache::GetDataVersion(uint64_t* version) const {
+    uint64_t combined = 0;
+    for (const auto& table : tables_) {
+        uint64_t table_version = 0;
+        if (!table->GetDataVersion(&table_version)) {
+            return false;
+        }
+        combined ^= table_version + 0x9e3779b97f4a7c15 + (combined << 6) + (combined >> 2);
+    }
+    *version = combined;
+    return true;
+}
+
+bool RequestResultCache::Get(const codec::Row& request, uint64_t version, codec::Row* output) {
+    std::string key = EncodeKey(request);
+    std::lock_guard<std::mutex> lock(mu_);
+    auto it = entries_.find(key);
+    if (it == entries_.end()) {
+        return false;
+    }
+    if (it->second.version != version || it->second.expire_time <= NowMs()) {
+        lru_.erase(it->second.lru_pos);
+        entries_.erase(it);
+        return false;
+    }
+    lru_.splice(lru_.begin(), lru_, it->second.lru_pos);
+    *output = it->second.output;
+    return true;
+}
+
+void RequestResultCache::Put(const codec::Row& request, uint64_t version, const codec::Row& output) {
+    if (capacity_ == 0) {
+        return;
+    }
+    std::string key = EncodeKey(request);
+    codec::Row copied = CopyRow(output);
+    uint64_t expire_time = NowMs() + ttl_ms_;
+    std::lock_guard<std::mutex> lock(mu_);
+    auto it = entries_.find(key);
+    if (it != entries_.end()) {
+        // keep the result of the newer version
+        if (it->second.version == version || it->second.expire_time > expire_time) {
+            return;
+        }
+        lru_.splice(lru_.begin(), lru_, it->second.lru_pos);
+        it->second.version = version;
+        it->second.expire_time = expire_time;
+        it->second.output = copied;
+        return;
+    }
+    if (entries_.size() >= capacity_) {
+        entries_.erase(lru_.back());
+        lru_.pop_back();
+    }
+    lru_.push_front(key);
+    entries_.emplace(key, Entry{version, expire_time, copied, lru_.begin()});
+}
+
+size_t RequestResultCache::GetSize() {
+    std::lock_guard<std::mutex> lock(mu_);
+    return entries_.size();
+}
+
+std::string RequestResultCache::EncodeKey(const codec::Row& row) {
+    std::string key;
+    for (int32_t i = 0; i < row.GetRowPtrCnt(); i++) {
+        uint32_t size = row.size(i);
+        key.append(reinterpret_cast<const char*>(&size), sizeof(size));
+        if (size > 0) {
+            key.append(reinterpret_cast<const char*>(row.buf(i)), size);
+        }
+    }
+    return key;
+}
+
+codec::Row RequestResultCache::CopyRow(const codec::Row& row) {
+    codec::Row copied;
+    for (int32_t i = 0; i < row.GetRowPtrCnt(); i++) {
+        base::RefCountedSlice slice;
+        if (row.size(i) > 0) {
+            slice = base::RefCountedSlice::Allocate(row.size(i));
+            memcpy(slice.buf(), row.buf(i), row.size(i));
+        }
+        if (i == 0) {
+            copied = codec::Row(slice);
+        } else {
+            copied.Append(slice);
+        }
+    }
+    return copied;
+}
+
+uint64_t RequestResultCache::NowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+}  // namespace vm
+}  // namespace hybridse
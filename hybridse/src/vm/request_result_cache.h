@@ -0,0 +1,87 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_VM_REQUEST_RESULT_CACHE_H_
+#define SRC_VM_REQUEST_RESULT_CACHE_H_
+
+#include <list>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "codec/row.h"
+#include "vm/catalog.h"
+#include "vm/physical_op.h"
+
+namespace hybridse {
+namespace vm {
+
+/// \brief The results of the request mode runs of a sql.
+///
+/// A result is keyed by the encoded request row and tagged with the data
+/// version of the tables read by the sql. It is returned only while the
+/// version is unchanged and the result is not expired.
+class RequestResultCache {
+ public:
+    RequestResultCache(uint32_t capacity, uint32_t ttl_ms,
+                       const std::vector<std::shared_ptr<TableHandler>>& tables);
+    ~RequestResultCache() {}
+
+    /// Collect the tables read by the plan into `tables`.
+    static void CollectTables(const PhysicalOpNode* node,
+                              std::vector<std::shared_ptr<TableHandler>>* tables);
+
+    /// Combine the data versions of the tables into `version`, return
+    /// `false` if any of the tables does not keep a version.
+    bool GetDataVersion(uint64_t* version) const;
+
+    /// Set the cached result of `request` into `output`, return `false` if
+    /// it is missing, expired or of another version.
+    bool Get(const codec::Row& request, uint64_t version, codec::Row* output);
+
+    void Put(const codec::Row& request, uint64_t version, const codec::Row& output);
+
+    size_t GetSize();
+
+ private:
+    struct Entry {
+        uint64_t version;
+        uint64_t expire_time;
+        codec::Row output;
+        std::list<std::string>::iterator lru_pos;
+    };
+
+    static std::string EncodeKey(const codec::Row& row);
+
+    // the output may refer to the buffers of the run, it is copied to outlive them
+    static codec::Row CopyRow(const codec::Row& row);
+
+    static uint64_t NowMs();
+
+    const uint32_t capacity_;
+    const uint32_t ttl_ms_;
+    const std::vector<std::shared_ptr<TableHandler>> tables_;
+    std::mutex mu_;
+    // the keys of the most recently used entries at the front
+    std::list<std::string> lru_;
+    std::unordered_map<std::string, Entry> entries_;
+};
+
+}  // namespace vm
+}  // namespace hybridse
+#endif  // SRC_VM_REQUEST_RESULT_CACHE_H_
@@ -0,0 +1,107 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "vm/request_result_cache.h"
+#include <memory>
+#include <string>
+#include <chrono>  // NOLINT
+#include <cstring>
+#include <thread>  // NOLINT
+#include <vector>
+#include "gtest/gtest.h"
+#include "vm/mem_catalog.h"
+
+namespace hybridse {
+namespace vm {
+using hybridse::codec::Row;
+
+class VersionedTableHandler : public MemTableHandler {
+ public:
+    VersionedTableHandler() : MemTableHandler(), has_version_(true), version_(0) {}
+    bool GetDataVersion(uint64_t* version) override {
+        *version = version_;
+        return has_version_;
+    }
+    bool has_version_;
+    uint64_t version_;
+};
+
+class RequestResultCacheTest : public ::testing::Test {
+ public:
+    RequestResultCacheTest() {}
+    ~RequestResultCacheTest() {}
+};
+
+static Row MakeRow(const std::string& str) {
+    int8_t* buf = reinterpret_cast<int8_t*>(malloc(str.size()));
+    memcpy(buf, str.data(), str.size());
+    return Row(base::RefCountedSlice::CreateManaged(buf, str.size()));
+}
+
+TEST_F(RequestResultCacheTest, GetAndPut) {
+    auto table = std::make_shared<VersionedTableHandler>();
+    RequestResultCache cache(2, 100000, {table});
+    uint64_t version = 0;
+    ASSERT_TRUE(cache.GetDataVersion(&version));
+    Row output;
+    ASSERT_FALSE(cache.Get(MakeRow("r1"), version, &output));
+    {
+        Row result = MakeRow("o1");
+        cache.Put(MakeRow("r1"), version, result);
+    }
+    ASSERT_TRUE(cache.Get(MakeRow("r1"), version, &output));
+    ASSERT_EQ("o1", output.ToString());
+    ASSERT_FALSE(cache.Get(MakeRow("r11"), version, &output));
+
+    // the writes of the table invalidate the results
+    table->version_ = 1;
+    uint64_t new_version = 0;
+    ASSERT_TRUE(cache.GetDataVersion(&new_version));
+    ASSERT_NE(version, new_version);
+    ASSERT_FALSE(cache.Get(MakeRow("r1"), new_version, &output));
+    ASSERT_EQ(0u, cache.GetSize());
+
+    table->has_version_ = false;
+    ASSERT_FALSE(cache.GetDataVersion(&new_version));
+}
+
+TEST_F(RequestResultCacheTest, EvictAndExpire) {
+    auto table = std::make_shared<VersionedTableHandler>();
+    RequestResultCache cache(2, 100000, {table});
+    Row output;
+    cache.Put(MakeRow("r1"), 0, MakeRow("o1"));
+    cache.Put(MakeRow("r2"), 0, MakeRow("o2"));
+    ASSERT_TRUE(cache.Get(MakeRow("r1"), 0, &output));
+    // r2 is the least recently used
+    cache.Put(MakeRow("r3"), 0, MakeRow("o3"));
+    ASSERT_EQ(2u, cache.GetSize());
+    ASSERT_FALSE(cache.Get(MakeRow("r2"), 0, &output));
+    ASSERT_TRUE(cache.Get(MakeRow("r1"), 0, &output));
+    ASSERT_TRUE(cache.Get(MakeRow("r3"), 0, &output));
+
+    RequestResultCache short_cache(2, 10, {table});
+    short_cache.Put(MakeRow("r1"), 0, MakeRow("o1"));
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    ASSERT_FALSE(short_cache.Get(MakeRow("r1"), 0, &output));
+}
+
+}  // namespace vm
+}  // namespace hybridse
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
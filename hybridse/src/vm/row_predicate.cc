@@ -0,0 +1,297 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "vm/row_predicate.h"
+#include <cstring>
+#include <utility>
+#include "codec/fe_row_codec.h"
+#include "codec/type_codec.h"
+#include "gflags/gflags.h"
+
+DECLARE_bool(enable_spark_unsaferow_format);
+
+namespace hybridse {
+namespace vm {
+
+static void SplitAndConditions(const node::ExprNode* condition,
+                               std::vector<const node::ExprNode*>* output) {
+    if (condition->GetExprType() == node::kExprUnary) {
+        auto expr = dynamic_cast<const node::UnaryExpr*>(condition);
+        if (expr->GetOp() == node::kFnOpBracket) {
+            SplitAndConditions(expr->GetChild(0), output);
+            return;
+        }
+    } else if (condition->GetExprType() == node::kExprBinary) {
+        auto expr = dynamic_cast<const node::BinaryExpr*>(condition);
+        if (expr->GetOp() == node::kFnOpAnd) {
+            SplitAndConditions(expr->GetChild(0), output);
+            SplitAndConditions(expr->GetChild(1), output);
+            return;
+        }
+    }
+    output->push_back(condition);
+}
+
+// the operator when the operands are swapped
+static node::FnOperator FlipOp(node::FnOperator op) {
+    switch (op) {
+        case node::kFnOpLt:
+            return node::kFnOpGt;
+        case node::kFnOpLe:
+            return node::kFnOpGe;
+        case node::kFnOpGt:
+            return node::kFnOpLt;
+        case node::kFnOpGe:
+            return node::kFnOpLe;
+        default:
+            return op;
+    }
+}
+
+template <typename T>
+static bool Compare(node::FnOperator op, const T& left, const T& right) {
+    switch (op) {
+        case node::kFnOpEq:
+            return left == right;
+        case node::kFnOpNeq:
+            return left != right;
+        case node::kFnOpLt:
+            return left < right;
+        case node::kFnOpLe:
+            return left <= right;
+        case node::kFnOpGt:
+            return left > right;
+        case node::kFnOpGe:
+            return left >= right;
+        default:
+            return true;
+    }
+}
+
+static bool IsIntegerType(node::DataType type) {
+    return type == node::kInt16 || type == node::kInt32 ||
+           type == node::kInt64;
+}
+
+std::shared_ptr<ColumnPredicate> ColumnPredicate::Build(
+    const node::ExprNode* condition, const SchemasContext* schemas_ctx) {
+    // the fields are located as the codegen does only in the default format
+    if (condition == nullptr || schemas_ctx == nullptr ||
+        schemas_ctx->GetSchemaSourceSize() != 1 ||
+        FLAGS_enable_spark_unsaferow_format) {
+        return nullptr;
+    }
+    const Schema* schema = schemas_ctx->GetSchemaSource(0)->GetSchema();
+    if (schema == nullptr) {
+        return nullptr;
+    }
+    codec::RowFormat format(schema);
+    std::vector<const node::ExprNode*> conditions;
+    SplitAndConditions(condition, &conditions);
+    std::shared_ptr<ColumnPredicate> predicate(new ColumnPredicate());
+    predicate->schema_.CopyFrom(*schema);
+    for (auto expr : conditions) {
+        predicate->AddTerm(expr, schemas_ctx, format);
+    }
+    if (predicate->terms_.empty()) {
+        return nullptr;
+    }
+    return predicate;
+}
+
+bool ColumnPredicate::AddTerm(const node::ExprNode* expr,
+                              const SchemasContext* ctx,
+                              const codec::RowFormat& format) {
+    if (expr->GetExprType() != node::kExprBinary) {
+        return false;
+    }
+    auto binary = dynamic_cast<const node::BinaryExpr*>(expr);
+    node::FnOperator op = binary->GetOp();
+    switch (op) {
+        case node::kFnOpEq:
+        case node::kFnOpNeq:
+        case node::kFnOpLt:
+        case node::kFnOpLe:
+        case node::kFnOpGt:
+        case node::kFnOpGe:
+            break;
+        default:
+            return false;
+    }
+    const node::ExprNode* column = binary->GetChild(0);
+    const node::ExprNode* value = binary->GetChild(1);
+    if (column->GetExprType() == node::kExprPrimary) {
+        std::swap(column, value);
+        op = FlipOp(op);
+    }
+    if (value->GetExprType() != node::kExprPrimary) {
+        return false;
+    }
+    size_t schema_idx = 0;
+    size_t col_idx = 0;
+    base::Status status;
+    if (column->GetExprType() == node::kExprColumnRef) {
+        status = ctx->ResolveColumnRefIndex(
+            dynamic_cast<const node::ColumnRefNode*>(column), &schema_idx,
+            &col_idx);
+    } else if (column->GetExprType() == node::kExprColumnId) {
+        status = ctx->ResolveColumnIndexByID(
+            dynamic_cast<const node::ColumnIdNode*>(column)->GetColumnID(),
+            &schema_idx, &col_idx);
+    } else {
+        return false;
+    }
+    if (!status.isOK() || schema_idx != 0) {
+        return false;
+    }
+    auto const_node = dynamic_cast<const node::ConstNode*>(value);
+    if (const_node->IsNull()) {
+        return false;
+    }
+    auto const_type = const_node->GetDataType();
+    const codec::ColInfo* info = format.GetColumnInfo(col_idx);
+    if (info == nullptr) {
+        return false;
+    }
+    Term term;
+    term.op = op;
+    term.type = info->type;
+    term.col_idx = info->idx;
+    term.offset = info->offset;
+    term.next_str_offset = 0;
+    term.str_start_offset = 0;
+    term.cmp_double = true;
+    term.int_value = 0;
+    term.double_value = 0;
+    switch (info->type) {
+        case type::kInt16:
+        case type::kInt32:
+        case type::kInt64:
+        case type::kTimestamp:
+        case type::kFloat:
+        case type::kDouble: {
+            if (IsIntegerType(const_type) && info->type != type::kFloat &&
+                info->type != type::kDouble) {
+                term.cmp_double = false;
+                term.int_value = const_node->GetAsInt64();
+            } else if (IsIntegerType(const_type) ||
+                       const_type == node::kFloat ||
+                       const_type == node::kDouble) {
+                // the operands are promoted to double as the codegen does
+                term.double_value = const_node->GetAsDouble();
+            } else {
+                return false;
+            }
+            break;
+        }
+        case type::kVarchar: {
+            if (const_type != node::kVarchar ||
+                (op != node::kFnOpEq && op != node::kFnOpNeq)) {
+                return false;
+            }
+            codec::StringColInfo str_info;
+            if (!format.GetStringColumnInfo(col_idx, &str_info)) {
+                return false;
+            }
+            term.next_str_offset = str_info.str_next_offset;
+            term.str_start_offset = str_info.str_start_offset;
+            term.cmp_double = false;
+            term.str_value = const_node->GetStr();
+            break;
+        }
+        default:
+            return false;
+    }
+    terms_.push_back(std::move(term));
+    return true;
+}
+
+bool ColumnPredicate::IsSchemaOf(const Schema* schema) const {
+    if (schema == nullptr || schema->size() != schema_.size()) {
+        return false;
+    }
+    for (int32_t i = 0; i < schema_.size(); i++) {
+        if (schema->Get(i).type() != schema_.Get(i).type() ||
+            schema->Get(i).name() != schema_.Get(i).name()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ColumnPredicate::Match(const int8_t* buf, uint32_t size) const {
+    if (buf == nullptr || size <= codec::HEADER_LENGTH) {
+        return true;
+    }
+    for (const auto& term : terms_) {
+        if (!MatchTerm(term, buf, size)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ColumnPredicate::MatchTerm(const Term& term, const int8_t* buf,
+                                uint32_t size) const {
+    if (codec::v1::IsNullAt(buf, term.col_idx)) {
+        return false;
+    }
+    int64_t int_value = 0;
+    double double_value = 0;
+    switch (term.type) {
+        case type::kInt16:
+            int_value = codec::v1::GetInt16FieldUnsafe(buf, term.offset);
+            double_value = static_cast<double>(int_value);
+            break;
+        case type::kInt32:
+            int_value = codec::v1::GetInt32FieldUnsafe(buf, term.offset);
+            double_value = static_cast<double>(int_value);
+            break;
+        case type::kInt64:
+        case type::kTimestamp:
+            int_value = codec::v1::GetInt64FieldUnsafe(buf, term.offset);
+            double_value = static_cast<double>(int_value);
+            break;
+        case type::kFloat:
+            double_value = codec::v1::GetFloatFieldUnsafe(buf, term.offset);
+            break;
+        case type::kDouble:
+            double_value = codec::v1::GetDoubleFieldUnsafe(buf, term.offset);
+            break;
+        case type::kVarchar: {
+            const char* data = nullptr;
+            uint32_t len = 0;
+            if (codec::v1::GetStrFieldUnsafe(
+                    buf, term.col_idx, term.offset, term.next_str_offset,
+                    term.str_start_offset, codec::GetAddrLength(size), &data,
+                    &len) != 0) {
+                return true;
+            }
+            bool equal = len == term.str_value.size() &&
+                         memcmp(data, term.str_value.data(), len) == 0;
+            return term.op == node::kFnOpEq ? equal : !equal;
+        }
+        default:
+            return true;
+    }
+    if (term.cmp_double) {
+        return Compare(term.op, double_value, term.double_value);
+    }
+    return Compare(term.op, int_value, term.int_value);
+}
+
+}  // namespace vm
+}  // namespace hybridse
@@ -0,0 +1,78 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_VM_ROW_PREDICATE_H_
+#define SRC_VM_ROW_PREDICATE_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "node/sql_node.h"
+#include "vm/catalog.h"
+#include "vm/schemas_context.h"
+
+namespace hybridse {
+namespace vm {
+
+/// \brief The conjunction of the comparisons between a column and a constant
+/// extracted from a filter condition.
+///
+/// The comparisons are evaluated on the fields of the encoded row in place.
+/// A row with a null field compared is not matched, as the condition is not
+/// true for it.
+class ColumnPredicate : public RowPredicate {
+ public:
+    /// Return the predicate of the `col op const` conjuncts of `condition`,
+    /// or null if there is none. The other conjuncts are ignored, so the
+    /// predicate matches a superset of the rows of the condition.
+    static std::shared_ptr<ColumnPredicate> Build(
+        const node::ExprNode* condition, const SchemasContext* schemas_ctx);
+
+    bool Match(const int8_t* buf, uint32_t size) const override;
+
+    size_t GetSize() const { return terms_.size(); }
+
+    /// Return whether the fields are located by `schema` as the predicate
+    /// does.
+    bool IsSchemaOf(const Schema* schema) const;
+
+ private:
+    struct Term {
+        node::FnOperator op;
+        type::Type type;
+        uint32_t col_idx;
+        uint32_t offset;
+        // the str fields of a string column
+        uint32_t next_str_offset;
+        uint32_t str_start_offset;
+        // the field is compared with double_value, or int_value otherwise
+        bool cmp_double;
+        int64_t int_value;
+        double double_value;
+        std::string str_value;
+    };
+
+    bool AddTerm(const node::ExprNode* expr, const SchemasContext* ctx,
+                 const codec::RowFormat& format);
+    bool MatchTerm(const Term& term, const int8_t* buf, uint32_t size) const;
+
+    Schema schema_;
+    std::vector<Term> terms_;
+};
+
+}  // namespace vm
+}  // namespace hybridse
+#endif  // SRC_VM_ROW_PREDICATE_H_
@@ -15,22 +15,39 @@
  */
 
 #include "vm/runner.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <functional>
 #include <memory>
 #include <string>
+#include <thread>  // NOLINT
 #include <utility>
 #include <vector>
+#include "base/kway_merger.h"
 #include "base/texttable.h"
 #include "udf/udf.h"
 #include "vm/catalog_wrapper.h"
 #include "vm/core_api.h"
 #include "vm/jit_runtime.h"
 #include "vm/mem_catalog.h"
+#include "vm/spill_handler.h"
 
 namespace hybridse {
 namespace vm {
 #define MAX_DEBUG_BATCH_SiZE 5
 #define MAX_DEBUG_LINES_CNT 20
 #define MAX_DEBUG_COLUMN_MAX 20
+// the rows projected in one run step of the jit runtime in batch mode
+#define RUN_STEP_BATCH_SIZE 1024
+
+static uint64_t NowMicros() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+// the rows read by a window between two checks of the deadline
+#define DEADLINE_CHECK_ROW_CNT 1024
 
 // Build Runner for each physical node
 // return cluster task of given runner
@@ -66,6 +83,114 @@ namespace vm {
 // kPhysicalOpFilter
 // kPhysicalOpLimit
 // kPhysicalOpRename
+void RunnerBuilder::SetWindowColumnMask(const PhysicalProjectNode* op,
+                                        Runner* input) {
+    if (input == nullptr || input->type_ != kRunnerRequestUnion) {
+        return;
+    }
+    auto runner = dynamic_cast<RequestUnionRunner*>(input);
+    auto schemas_ctx = op->GetProducer(0)->schemas_ctx();
+    if (schemas_ctx->GetSchemaSourceSize() != 1) {
+        runner->DisableColumnMask();
+        return;
+    }
+    // the columns of the window read by the projects, as WindowColumnPruning
+    // resolves them
+    std::vector<bool> mask(schemas_ctx->GetSchemaSource(0)->size(), false);
+    const auto& projects = op->project();
+    for (size_t i = 0; i < projects.size(); ++i) {
+        std::vector<const node::ExprNode*> depend_columns;
+        if (!schemas_ctx
+                 ->ResolveExprDependentColumns(projects.GetExpr(i),
+                                               &depend_columns)
+                 .isOK()) {
+            runner->DisableColumnMask();
+            return;
+        }
+        for (auto col_expr : depend_columns) {
+            size_t schema_idx = 0;
+            size_t col_idx = 0;
+            base::Status status;
+            if (col_expr->GetExprType() == node::kExprColumnRef) {
+                status = schemas_ctx->ResolveColumnRefIndex(
+                    dynamic_cast<const node::ColumnRefNode*>(col_expr),
+                    &schema_idx, &col_idx);
+            } else if (col_expr->GetExprType() == node::kExprColumnId) {
+                status = schemas_ctx->ResolveColumnIndexByID(
+                    dynamic_cast<const node::ColumnIdNode*>(col_expr)
+                        ->GetColumnID(),
+                    &schema_idx, &col_idx);
+            } else {
+                status = base::Status(common::kPlanError, "unknown column");
+            }
+            if (!status.isOK() || schema_idx != 0 || col_idx >= mask.size()) {
+                runner->DisableColumnMask();
+                return;
+            }
+            mask[col_idx] = true;
+        }
+    }
+    runner->AddColumnMask(mask);
+}
+
+void RunnerBuilder::ShareRequestWindow(const PhysicalRequestUnionNode* op,
+                                       const Runner* left, const Runner* right,
+                                       RequestUnionRunner* runner) {
+    const Range& range = op->window().range_;
+    if (left == nullptr || right == nullptr || !range.Valid() ||
+        range.frame() == nullptr) {
+        return;
+    }
+    const WindowRange& window_range = runner->range_gen_.window_range_;
+    // the frames with the same end are the prefixes of the merged frame
+    std::ostringstream oss;
+    oss << left->id_ << "|" << right->id_ << "|"
+        << op->window().index_key_.ToString() << "|"
+        << op->window().partition_.ToString() << "|"
+        << op->window().sort_.ToString() << "|"
+        << node::ExprString(range.range_key()) << "|"
+        << op->exclude_current_time() << "|" << op->output_request_row() << "|"
+        << window_range.end_offset_ << "|" << window_range.end_row_;
+    auto& shared = shared_windows_[oss.str()];
+    if (!shared) {
+        shared = std::make_shared<SharedRequestWindow>();
+        shared->id = -static_cast<int64_t>(shared_windows_.size());
+        shared->window_range = window_range;
+        // the member windows are sampled from the merged window
+        shared->window_range.sample_size_ = 0;
+        shared->member_cnt = 0;
+    }
+    // the rows preceding of a range frame and the range of a rows frame are
+    // not the bounds of the frame, so they are not merged
+    WindowRange& merged = shared->window_range;
+    bool with_rows = window_range.frame_type_ != Window::kFrameRowsRange;
+    bool with_range = window_range.frame_type_ != Window::kFrameRows;
+    if (shared->member_cnt == 0) {
+        merged.start_row_ = with_rows ? window_range.start_row_ : 0;
+        merged.start_offset_ = with_range ? window_range.start_offset_ : 0;
+    } else {
+        if (merged.frame_type_ != window_range.frame_type_) {
+            merged.frame_type_ = Window::kFrameRowsMergeRowsRange;
+        }
+        if (with_rows) {
+            merged.start_row_ =
+                std::max(merged.start_row_, window_range.start_row_);
+        }
+        if (with_range) {
+            merged.start_offset_ =
+                std::min(merged.start_offset_, window_range.start_offset_);
+        }
+        if (merged.max_size_ == 0 || window_range.max_size_ == 0) {
+            merged.max_size_ = 0;
+        } else {
+            merged.max_size_ =
+                std::max(merged.max_size_, window_range.max_size_);
+        }
+    }
+    shared->member_cnt++;
+    runner->SetSharedWindow(shared);
+}
+
 ClusterTask RunnerBuilder::Build(PhysicalOpNode* node, Status& status) {
     auto fail = InvalidTask();
     if (nullptr == node) {
@@ -77,6 +202,11 @@ ClusterTask RunnerBuilder::Build(PhysicalOpNode* node, Status& status) {
     auto iter = task_map_.find(node);
     if (iter != task_map_.cend()) {
         iter->second.GetRoot()->EnableCache();
+        if (iter->second.GetRoot()->type_ == kRunnerRequestUnion) {
+            // the window is read by more than one consumer
+            dynamic_cast<RequestUnionRunner*>(iter->second.GetRoot())
+                ->DisableColumnMask();
+        }
         return iter->second;
     }
     switch (node->GetOpType()) {
@@ -184,10 +314,12 @@ ClusterTask RunnerBuilder::Build(PhysicalOpNode* node, Status& status) {
                     CreateRunner<TableProjectRunner>(
                         &runner, id_++, node->schemas_ctx(), op->GetLimitCnt(),
                         op->project().fn_info());
+                    runner->set_thread_num(window_thread_num_);
                     return RegisterTask(node,
                                         UnaryInheritTask(cluster_task, runner));
                 }
                 case kAggregation: {
+                    SetWindowColumnMask(op, input);
                     AggRunner* runner = nullptr;
                     CreateRunner<AggRunner>(&runner, id_++, node->schemas_ctx(),
                                             op->GetLimitCnt(),
@@ -207,6 +339,21 @@ ClusterTask RunnerBuilder::Build(PhysicalOpNode* node, Status& status) {
                     auto op =
                         dynamic_cast<const PhysicalGroupAggrerationNode*>(node);
                     GroupAggRunner* runner = nullptr;
+                    auto group_op = dynamic_cast<const PhysicalGroupNode*>(
+                        node->producers().at(0));
+                    if (group_op != nullptr && kRunnerGroup == input->type_ &&
+                        1u == input->GetProducers().size()) {
+                        // the rows are grouped by the aggregation instead of
+                        // being copied into the partitions of a group runner
+                        CreateRunner<GroupAggRunner>(
+                            &runner, id_++, node->schemas_ctx(),
+                            op->GetLimitCnt(), op->group_,
+                            op->project().fn_info(), group_op->group());
+                        ClusterTask input_task = cluster_task;
+                        input_task.SetRoot(input->GetProducers()[0]);
+                        return RegisterTask(
+                            node, UnaryInheritTask(input_task, runner));
+                    }
                     CreateRunner<GroupAggRunner>(
                         &runner, id_++, node->schemas_ctx(), op->GetLimitCnt(),
                         op->group_, op->project().fn_info());
@@ -231,6 +378,8 @@ ClusterTask RunnerBuilder::Build(PhysicalOpNode* node, Status& status) {
                         op->window_, op->project().fn_info(),
                         op->instance_not_in_window(),
                         op->exclude_current_time(), op->need_append_input());
+                    runner->set_thread_num(window_thread_num_);
+                    runner->set_split_rows(window_split_rows_);
                     size_t input_slices =
                         input->output_schemas()->GetSchemaSourceSize();
                     if (!op->window_unions_.Empty()) {
@@ -301,6 +450,11 @@ ClusterTask RunnerBuilder::Build(PhysicalOpNode* node, Status& status) {
                 &runner, id_++, node->schemas_ctx(), op->GetLimitCnt(),
                 op->window().range_, op->exclude_current_time(),
                 op->output_request_row());
+            auto sample_iter = window_sample_sizes_.find(op->window().name());
+            if (sample_iter != window_sample_sizes_.end()) {
+                runner->range_gen_.window_range_.sample_size_ =
+                    sample_iter->second;
+            }
             Key index_key;
             if (!op->instance_not_in_window()) {
                 runner->AddWindowUnion(op->window_, right);
@@ -325,6 +479,9 @@ ClusterTask RunnerBuilder::Build(PhysicalOpNode* node, Status& status) {
                     }
                 }
             }
+            if (!op->instance_not_in_window() && op->window_unions_.Empty()) {
+                ShareRequestWindow(op, left_task.GetRoot(), right, runner);
+            }
             return RegisterTask(
                 node, BinaryInherit(left_task, right_task, runner, index_key,
                                     kRightBias));
@@ -475,8 +632,9 @@ ClusterTask RunnerBuilder::Build(PhysicalOpNode* node, Status& status) {
             }
             auto op = dynamic_cast<const PhysicalFilterNode*>(node);
             FilterRunner* runner = nullptr;
-            CreateRunner<FilterRunner>(&runner, id_++, node->schemas_ctx(),
-                                       op->GetLimitCnt(), op->filter_);
+            CreateRunner<FilterRunner>(
+                &runner, id_++, node->schemas_ctx(), op->GetLimitCnt(),
+                op->filter_, node->producers().at(0)->schemas_ctx());
             return RegisterTask(node, UnaryInheritTask(cluster_task, runner));
         }
         case kPhysicalOpLimit: {
@@ -497,6 +655,20 @@ ClusterTask RunnerBuilder::Build(PhysicalOpNode* node, Status& status) {
                                       op->GetLimitCnt());
             return RegisterTask(node, UnaryInheritTask(cluster_task, runner));
         }
+        case kPhysicalOpSortBy: {
+            auto cluster_task = Build(node->producers().at(0), status);
+            if (!cluster_task.IsValid()) {
+                status.msg = "fail to build input runner";
+                status.code = common::kOpGenError;
+                LOG(WARNING) << status;
+                return fail;
+            }
+            auto op = dynamic_cast<const PhysicalSortNode*>(node);
+            SortRunner* runner = nullptr;
+            CreateRunner<SortRunner>(&runner, id_++, node->schemas_ctx(),
+                                     op->GetLimitCnt(), op->sort_);
+            return RegisterTask(node, UnaryInheritTask(cluster_task, runner));
+        }
         case kPhysicalOpRename: {
             return Build(node->producers().at(0), status);
         }
@@ -979,8 +1151,6 @@ std::shared_ptr<DataHandlerList> Runner::BatchRequestRun(RunnerContext& ctx) {
             return cached;
         }
     }
-    std::shared_ptr<DataHandlerVector> outputs =
-        std::make_shared<DataHandlerVector>();
     std::vector<std::shared_ptr<DataHandler>> inputs(producers_.size());
     std::vector<std::shared_ptr<DataHandlerList>> batch_inputs(
         producers_.size());
@@ -988,7 +1158,16 @@ std::shared_ptr<DataHandlerList> Runner::BatchRequestRun(RunnerContext& ctx) {
         batch_inputs[idx - 1] = producers_[idx - 1]->BatchRequestRun(ctx);
     }
 
-    for (size_t idx = 0; idx < ctx.GetRequestSize(); idx++) {
+    // the common outputs are run once below
+    std::shared_ptr<DataHandlerVector> outputs =
+        need_batch_cache_ ? nullptr : RunBatchRequests(ctx, batch_inputs);
+    size_t request_size = ctx.GetRequestSize();
+    if (outputs) {
+        request_size = 0;
+    } else {
+        outputs = std::make_shared<DataHandlerVector>();
+    }
+    for (size_t idx = 0; idx < request_size; idx++) {
         inputs.clear();
         for (size_t producer_idx = 0; producer_idx < producers_.size();
              producer_idx++) {
@@ -1040,11 +1219,26 @@ std::shared_ptr<DataHandler> Runner::RunWithCache(RunnerContext& ctx) {
         }
     }
     std::vector<std::shared_ptr<DataHandler>> inputs(producers_.size());
-    for (size_t idx = producers_.size(); idx > 0; idx--) {
-        inputs[idx - 1] = producers_[idx - 1]->RunWithCache(ctx);
+    RunProducers(ctx, &inputs);
+    if (ctx.IsExpired() || ctx.is_memory_exceeded()) {
+        if (need_cache_) {
+            ctx.SetCache(id_, std::shared_ptr<DataHandler>());
+        }
+        return std::shared_ptr<DataHandler>();
     }
 
+    bool timed = ctx.is_trace() || stats_;
+    uint64_t start_us = timed ? NowMicros() : 0;
     auto res = Run(ctx, inputs);
+    if (timed) {
+        uint64_t time_us = NowMicros() - start_us;
+        if (ctx.is_trace()) {
+            ctx.AddTrace(id_, RunnerTypeName(type_), time_us);
+        }
+        if (stats_) {
+            RecordStats(res, time_us);
+        }
+    }
     if (ctx.is_debug()) {
         std::ostringstream oss;
         oss << "RUNNER TYPE: " << RunnerTypeName(type_) << ", ID: " << id_
@@ -1057,6 +1251,53 @@ std::shared_ptr<DataHandler> Runner::RunWithCache(RunnerContext& ctx) {
     }
     return res;
 }
+void Runner::RecordStats(const std::shared_ptr<DataHandler>& output,
+                         uint64_t time_us) {
+    stats_->run_cnt.fetch_add(1, std::memory_order_relaxed);
+    stats_->time_us.fetch_add(time_us, std::memory_order_relaxed);
+    // only the rows at hand are counted, a lazy table is not iterated for it
+    uint64_t row_cnt = 0;
+    if (!output) {
+        row_cnt = 0;
+    } else if (output->GetHanlderType() == kRowHandler) {
+        row_cnt = 1;
+    } else if (auto table = dynamic_cast<MemTableHandler*>(output.get())) {
+        row_cnt = table->GetCount();
+    } else if (auto table = dynamic_cast<MemTimeTableHandler*>(output.get())) {
+        row_cnt = table->GetCount();
+    } else {
+        return;
+    }
+    stats_->counted_run_cnt.fetch_add(1, std::memory_order_relaxed);
+    stats_->row_cnt.fetch_add(row_cnt, std::memory_order_relaxed);
+}
+void Runner::RunProducers(RunnerContext& ctx,
+                          std::vector<std::shared_ptr<DataHandler>>* inputs) {
+    if (!is_parallel_producers_ || ctx.branch_thread_num() <= 1 ||
+        producers_.size() < 2) {
+        for (size_t idx = producers_.size(); idx > 0; idx--) {
+            (*inputs)[idx - 1] = producers_[idx - 1]->RunWithCache(ctx);
+        }
+        return;
+    }
+    // the branches are handed to free threads, the first one and the ones
+    // without a free thread run on the current thread
+    std::vector<std::thread> threads;
+    for (size_t idx = producers_.size() - 1; idx > 0; idx--) {
+        if (ctx.AcquireBranchThread()) {
+            threads.emplace_back([this, &ctx, inputs, idx]() {
+                (*inputs)[idx] = producers_[idx]->RunWithCache(ctx);
+                ctx.ReleaseBranchThread();
+            });
+        } else {
+            (*inputs)[idx] = producers_[idx]->RunWithCache(ctx);
+        }
+    }
+    (*inputs)[0] = producers_[0]->RunWithCache(ctx);
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
 std::shared_ptr<DataHandler> DataRunner::Run(
     RunnerContext& ctx,
     const std::vector<std::shared_ptr<DataHandler>>& inputs) {
@@ -1089,7 +1330,7 @@ std::shared_ptr<DataHandlerList> DataRunner::BatchRequestRun(
 std::shared_ptr<DataHandler> RequestRunner::Run(
     RunnerContext& ctx,
     const std::vector<std::shared_ptr<DataHandler>>& inputs) {
-    return std::shared_ptr<MemRowHandler>(new MemRowHandler(ctx.GetRequest()));
+    return std::make_shared<MemRowHandler>(ctx.GetRequest());
 }
 std::shared_ptr<DataHandlerList> RequestRunner::BatchRequestRun(
     RunnerContext& ctx) {
@@ -1103,8 +1344,7 @@ std::shared_ptr<DataHandlerList> RequestRunner::BatchRequestRun(
     std::shared_ptr<DataHandlerVector> res =
         std::shared_ptr<DataHandlerVector>(new DataHandlerVector());
     for (size_t idx = 0; idx < ctx.GetRequestSize(); idx++) {
-        res->Add(std::shared_ptr<MemRowHandler>(
-            new MemRowHandler(ctx.GetRequest(idx))));
+        res->Add(std::make_shared<MemRowHandler>(ctx.GetRequest(idx)));
     }
 
     if (ctx.is_debug()) {
@@ -1138,7 +1378,7 @@ std::shared_ptr<DataHandler> GroupRunner::Run(
         LOG(WARNING) << "input is empty";
         return fail_ptr;
     }
-    return partition_gen_.Partition(input, ctx.GetParameterRow());
+    return partition_gen_.Partition(input, ctx.GetParameterRow(), &ctx);
 }
 std::shared_ptr<DataHandler> SortRunner::Run(
     RunnerContext& ctx,
@@ -1153,7 +1393,31 @@ std::shared_ptr<DataHandler> SortRunner::Run(
         LOG(WARNING) << "input is empty";
         return fail_ptr;
     }
-    return sort_gen_.Sort(input);
+    // the limit pushed down to the sort is applied by it
+    if (limit_cnt_ > 0 && kTableHandler == input->GetHanlderType() &&
+        sort_gen_.Valid() && sort_gen_.order_gen().Valid()) {
+        return sort_gen_.TopK(std::dynamic_pointer_cast<TableHandler>(input),
+                              static_cast<size_t>(limit_cnt_));
+    }
+    auto output = sort_gen_.Sort(input, false, &ctx);
+    if (limit_cnt_ <= 0 || !output ||
+        kTableHandler != output->GetHanlderType()) {
+        return output;
+    }
+    auto iter = std::dynamic_pointer_cast<TableHandler>(output)->GetIterator();
+    if (!iter) {
+        LOG(WARNING) << "fail to get table it";
+        return fail_ptr;
+    }
+    iter->SeekToFirst();
+    auto output_table = std::shared_ptr<MemTableHandler>(
+        new MemTableHandler(output->GetSchema()));
+    int32_t cnt = 0;
+    while (cnt++ < limit_cnt_ && iter->Valid()) {
+        output_table->AddRow(iter->GetValue());
+        iter->Next();
+    }
+    return output_table;
 }
 
 std::shared_ptr<DataHandler> ConstProjectRunner::Run(
@@ -1178,23 +1442,97 @@ std::shared_ptr<DataHandler> TableProjectRunner::Run(
     if (kTableHandler != input->GetHanlderType()) {
         return std::shared_ptr<DataHandler>();
     }
+    auto table = std::dynamic_pointer_cast<TableHandler>(input);
+    auto& parameter = ctx.GetParameterRow();
     auto output_table = std::shared_ptr<MemTableHandler>(new MemTableHandler());
-    auto iter = std::dynamic_pointer_cast<TableHandler>(input)->GetIterator();
+    // the limit counts the rows of all the parts, so it runs serially
+    std::vector<std::shared_ptr<TableHandler>> parts;
+    if (thread_num_ > 1 && limit_cnt_ <= 0) {
+        parts = table->GetParts();
+    }
+    if (parts.size() <= 1) {
+        if (!Project(table, parameter, limit_cnt_, output_table.get())) {
+            return std::shared_ptr<DataHandler>();
+        }
+        return output_table;
+    }
+    // the threads take the parts in turn, each part has its own output so
+    // that the rows keep the order of the serial run after the merge
+    uint32_t thread_num =
+        std::min(thread_num_, static_cast<uint32_t>(parts.size()));
+    std::vector<std::shared_ptr<MemTableHandler>> part_outputs(parts.size());
+    std::atomic<size_t> next_part(0);
+    std::atomic<bool> ok(true);
+    auto run_parts = [&]() {
+        while (true) {
+            size_t part = next_part.fetch_add(1, std::memory_order_relaxed);
+            if (part >= parts.size()) {
+                return;
+            }
+            part_outputs[part] =
+                std::shared_ptr<MemTableHandler>(new MemTableHandler());
+            if (!Project(parts[part], parameter, 0,
+                         part_outputs[part].get())) {
+                ok.store(false, std::memory_order_relaxed);
+            }
+        }
+    };
+    std::vector<std::thread> threads;
+    for (uint32_t i = 1; i < thread_num; i++) {
+        threads.emplace_back(run_parts);
+    }
+    run_parts();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    if (!ok.load(std::memory_order_relaxed)) {
+        return std::shared_ptr<DataHandler>();
+    }
+    for (const auto& part_output : part_outputs) {
+        auto iter = part_output->GetIterator();
+        for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+            output_table->AddRow(iter->GetValue());
+        }
+    }
+    return output_table;
+}
+
+bool TableProjectRunner::Project(std::shared_ptr<TableHandler> table,
+                                 const Row& parameter, int32_t limit_cnt,
+                                 MemTableHandler* output) {
+    auto iter = table->GetIterator();
     if (!iter) {
         LOG(WARNING) << "Table Project Fail: table iter is Empty";
-        return std::shared_ptr<DataHandler>();
+        return false;
     }
-    auto& parameter = ctx.GetParameterRow();
     iter->SeekToFirst();
     int32_t cnt = 0;
+    std::vector<Row> rows;
+    std::vector<Row> outputs;
+    rows.reserve(RUN_STEP_BATCH_SIZE);
+    outputs.reserve(RUN_STEP_BATCH_SIZE);
     while (iter->Valid()) {
-        if (limit_cnt_ > 0 && cnt++ >= limit_cnt_) {
+        if (limit_cnt > 0 && cnt++ >= limit_cnt) {
             break;
         }
-        output_table->AddRow(project_gen_.Gen(iter->GetValue(), parameter));
+        rows.push_back(iter->GetValue());
         iter->Next();
+        if (rows.size() >= RUN_STEP_BATCH_SIZE) {
+            project_gen_.GenBatch(rows, parameter, &outputs);
+            for (auto& row : outputs) {
+                output->AddRow(row);
+            }
+            rows.clear();
+            outputs.clear();
+        }
     }
-    return output_table;
+    if (!rows.empty()) {
+        project_gen_.GenBatch(rows, parameter, &outputs);
+        for (auto& row : outputs) {
+            output->AddRow(row);
+        }
+    }
+    return true;
 }
 
 std::shared_ptr<DataHandler> RowProjectRunner::Run(
@@ -1236,9 +1574,9 @@ std::shared_ptr<DataHandler> SimpleProjectRunner::Run(
                 parameter, &project_gen_.fun_));
         }
         case kRowHandler: {
-            return std::shared_ptr<RowHandler>(new RowProjectWrapper(
-                std::dynamic_pointer_cast<RowHandler>(input),
-                parameter, &project_gen_.fun_));
+            return std::make_shared<RowProjectWrapper>(
+                std::dynamic_pointer_cast<RowHandler>(input), parameter,
+                &project_gen_.fun_);
         }
         default: {
             LOG(WARNING) << "Fail run simple project, invalid handler type "
@@ -1309,7 +1647,7 @@ std::shared_ptr<DataHandler> WindowAggRunner::Run(
     auto& parameter = ctx.GetParameterRow();
     // Partition Instance Table
     auto instance_partition =
-        instance_window_gen_.partition_gen_.Partition(input, parameter);
+        instance_window_gen_.partition_gen_.Partition(input, parameter, &ctx);
     if (!instance_partition) {
         LOG(WARNING) << "Window Aggregation Fail: input partition is empty";
         return fail_ptr;
@@ -1331,12 +1669,62 @@ std::shared_ptr<DataHandler> WindowAggRunner::Run(
     // Compute output
     std::shared_ptr<MemTableHandler> output_table =
         std::shared_ptr<MemTableHandler>(new MemTableHandler());
+    // the limit counts the rows of all the keys, so it runs serially
+    if (thread_num_ <= 1 || limit_cnt_ > 0) {
+        while (instance_partition_iter->Valid()) {
+            auto key = instance_partition_iter->GetKey().ToString();
+            RunWindowAggOnKey(parameter, instance_partition, union_partitions,
+                              join_right_tables, key, output_table);
+            instance_partition_iter->Next();
+        }
+        return output_table;
+    }
+    std::vector<std::string> keys;
     while (instance_partition_iter->Valid()) {
-        auto key = instance_partition_iter->GetKey().ToString();
-        RunWindowAggOnKey(parameter, instance_partition, union_partitions,
-                          join_right_tables, key, output_table);
+        keys.push_back(instance_partition_iter->GetKey().ToString());
         instance_partition_iter->Next();
     }
+    // the keys are split into small batches and the threads take them in
+    // turn, each batch has its own output so that the rows keep the order
+    // of the serial run after the merge
+    uint32_t thread_num =
+        std::min(thread_num_, static_cast<uint32_t>(keys.size()));
+    size_t batch_size =
+        std::max(static_cast<size_t>(1), keys.size() / (thread_num * 16));
+    size_t batch_num = (keys.size() + batch_size - 1) / batch_size;
+    std::vector<std::shared_ptr<MemTableHandler>> batch_outputs(batch_num);
+    std::atomic<size_t> next_batch(0);
+    auto run_batches = [&]() {
+        while (true) {
+            size_t batch = next_batch.fetch_add(1, std::memory_order_relaxed);
+            if (batch >= batch_num) {
+                return;
+            }
+            auto batch_output =
+                std::shared_ptr<MemTableHandler>(new MemTableHandler());
+            size_t end = std::min(keys.size(), (batch + 1) * batch_size);
+            for (size_t i = batch * batch_size; i < end; i++) {
+                RunWindowAggOnKey(parameter, instance_partition,
+                                  union_partitions, join_right_tables, keys[i],
+                                  batch_output);
+            }
+            batch_outputs[batch] = batch_output;
+        }
+    };
+    std::vector<std::thread> threads;
+    for (uint32_t i = 1; i < thread_num; i++) {
+        threads.emplace_back(run_batches);
+    }
+    run_batches();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    for (const auto& batch_output : batch_outputs) {
+        auto iter = batch_output->GetIterator();
+        for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+            output_table->AddRow(iter->GetValue());
+        }
+    }
     return output_table;
 }
 
@@ -1354,6 +1742,21 @@ void WindowAggRunner::RunWindowAggOnKey(
         LOG(WARNING) << "Instance Segment is Empty";
         return;
     }
+    // the window of a row depends on the rows before it only through the
+    // frame, so a large key runs as the time ranges which replay the rows of
+    // the frame of their first rows. The limit counts the rows of all the
+    // ranges and the other windows keep the rows out of the frame, they run
+    // serially.
+    const WindowRange& window_range =
+        instance_window_gen_.range_gen_.window_range_;
+    if (split_rows_ > 0 && thread_num_ > 1 && limit_cnt_ <= 0 &&
+        !instance_not_in_window_ && !exclude_current_time_ &&
+        0 == window_range.end_offset_ &&
+        instance_segment->GetCount() >= split_rows_ &&
+        RunSplitWindowAgg(parameter, instance_segment, union_partitions,
+                          join_right_tables, key, output_table)) {
+        return;
+    }
 
     auto instance_segment_iter = instance_segment->GetIterator();
     if (!instance_segment_iter) {
@@ -1366,7 +1769,8 @@ void WindowAggRunner::RunWindowAggOnKey(
     size_t unions_cnt = windows_union_gen_.inputs_cnt_;
     std::vector<std::shared_ptr<TableHandler>> union_segments(unions_cnt);
     std::vector<std::unique_ptr<RowIterator>> union_segment_iters(unions_cnt);
-    std::vector<IteratorStatus> union_segment_status(unions_cnt);
+    base::KWayMerger<uint64_t> union_merger;
+    union_merger.Reset(unions_cnt);
 
     for (size_t i = 0; i < unions_cnt; i++) {
         if (!union_partitions[i]) {
@@ -1376,27 +1780,19 @@ void WindowAggRunner::RunWindowAggOnKey(
         segment = windows_union_gen_.windows_gen_[i].sort_gen_.Sort(segment);
         union_segments[i] = segment;
         if (!segment) {
-            union_segment_status[i] = IteratorStatus();
             continue;
         }
         union_segment_iters[i] = segment->GetIterator();
         if (!union_segment_iters[i]) {
-            union_segment_status[i] = IteratorStatus();
             continue;
         }
         union_segment_iters[i]->SeekToFirst();
         if (!union_segment_iters[i]->Valid()) {
-            union_segment_status[i] = IteratorStatus();
             continue;
         }
-        uint64_t ts = union_segment_iters[i]->GetKey();
-        union_segment_status[i] = IteratorStatus(ts);
+        union_merger.Add(i, union_segment_iters[i]->GetKey());
     }
 
-    int32_t min_union_pos =
-        0 == unions_cnt
-            ? -1
-            : IteratorStatus::PickIteratorWithMininumKey(&union_segment_status);
     int32_t cnt = output_table->GetCount();
     HistoryWindow window(instance_window_gen_.range_gen_.window_range_);
     window.set_instance_not_in_window(instance_not_in_window_);
@@ -1408,27 +1804,22 @@ void WindowAggRunner::RunWindowAggOnKey(
         }
         const Row& instance_row = instance_segment_iter->GetValue();
         uint64_t instance_order = instance_segment_iter->GetKey();
-        while (min_union_pos >= 0 &&
-               union_segment_status[min_union_pos].key_ < instance_order) {
-            Row row = union_segment_iters[min_union_pos]->GetValue();
+        while (!union_merger.Empty() &&
+               union_merger.TopKey() < instance_order) {
+            auto& union_iter = union_segment_iters[union_merger.Top()];
+            Row row = union_iter->GetValue();
             if (windows_join_gen_.Valid()) {
                 row = windows_join_gen_.Join(row, join_right_tables, parameter);
             }
-            window_project_gen_.Gen(
-                union_segment_iters[min_union_pos]->GetKey(), row, parameter,
-                false, append_slices_, &window);
+            window_project_gen_.Gen(union_iter->GetKey(), row, parameter,
+                                    false, append_slices_, &window);
 
-            // Update Iterator Status
-            union_segment_iters[min_union_pos]->Next();
-            if (!union_segment_iters[min_union_pos]->Valid()) {
-                union_segment_status[min_union_pos].MarkInValid();
+            union_iter->Next();
+            if (!union_iter->Valid()) {
+                union_merger.Pop();
             } else {
-                union_segment_status[min_union_pos].set_key(
-                    union_segment_iters[min_union_pos]->GetKey());
+                union_merger.Next(union_iter->GetKey());
             }
-            // Pick new mininum union pos
-            min_union_pos = IteratorStatus::PickIteratorWithMininumKey(
-                &union_segment_status);
         }
         if (windows_join_gen_.Valid()) {
             Row row = instance_row;
@@ -1446,6 +1837,180 @@ void WindowAggRunner::RunWindowAggOnKey(
     }
 }
 
+static void CollectOrderedRows(std::shared_ptr<TableHandler> segment,
+                               WindowAggRunner::OrderedRows* output) {
+    if (!segment) {
+        return;
+    }
+    auto iter = segment->GetIterator();
+    if (!iter) {
+        return;
+    }
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+        output->keys.push_back(iter->GetKey());
+        output->rows.push_back(iter->GetValue());
+    }
+}
+
+bool WindowAggRunner::RunSplitWindowAgg(
+    const Row& parameter, std::shared_ptr<TableHandler> instance_segment,
+    const std::vector<std::shared_ptr<PartitionHandler>>& union_partitions,
+    const std::vector<std::shared_ptr<DataHandler>>& join_right_tables,
+    const std::string& key, std::shared_ptr<MemTableHandler> output_table) {
+    OrderedRows instances;
+    CollectOrderedRows(instance_segment, &instances);
+    size_t cnt = instances.keys.size();
+    size_t range_size =
+        std::max(static_cast<size_t>(1), cnt / (thread_num_ * 4));
+    size_t range_num = (cnt + range_size - 1) / range_size;
+    if (range_num <= 1) {
+        return false;
+    }
+    // the replay of a range is not longer than the range, or it costs more
+    // than the parallelism saves, e.g. the unbounded windows
+    std::vector<uint64_t> replay_keys(range_num);
+    for (size_t range = 0; range < range_num; range++) {
+        size_t begin = range * range_size;
+        replay_keys[range] = GetReplayKey(instances, begin);
+        size_t replay_begin =
+            std::lower_bound(instances.keys.begin(),
+                             instances.keys.begin() + begin,
+                             replay_keys[range]) -
+            instances.keys.begin();
+        if (begin - replay_begin > range_size) {
+            return false;
+        }
+    }
+    size_t unions_cnt = windows_union_gen_.inputs_cnt_;
+    std::vector<OrderedRows> unions(unions_cnt);
+    for (size_t i = 0; i < unions_cnt; i++) {
+        if (!union_partitions[i]) {
+            continue;
+        }
+        auto segment = union_partitions[i]->GetSegment(key);
+        CollectOrderedRows(
+            windows_union_gen_.windows_gen_[i].sort_gen_.Sort(segment),
+            &unions[i]);
+    }
+    // each range has its own output so that the rows keep the order of the
+    // serial run after the merge
+    uint32_t thread_num =
+        std::min(thread_num_, static_cast<uint32_t>(range_num));
+    std::vector<std::unique_ptr<MemTableHandler>> range_outputs(range_num);
+    std::atomic<size_t> next_range(0);
+    auto run_ranges = [&]() {
+        while (true) {
+            size_t range = next_range.fetch_add(1, std::memory_order_relaxed);
+            if (range >= range_num) {
+                return;
+            }
+            range_outputs[range].reset(new MemTableHandler());
+            RunWindowAggOnRange(parameter, instances, unions,
+                                join_right_tables, replay_keys[range],
+                                range * range_size,
+                                std::min(cnt, (range + 1) * range_size),
+                                range_outputs[range].get());
+        }
+    };
+    std::vector<std::thread> threads;
+    for (uint32_t i = 1; i < thread_num; i++) {
+        threads.emplace_back(run_ranges);
+    }
+    run_ranges();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    for (const auto& range_output : range_outputs) {
+        auto iter = range_output->GetIterator();
+        for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+            output_table->AddRow(iter->GetValue());
+        }
+    }
+    return true;
+}
+
+uint64_t WindowAggRunner::GetReplayKey(const OrderedRows& instances,
+                                       size_t begin) const {
+    const WindowRange& window_range =
+        instance_window_gen_.range_gen_.window_range_;
+    uint64_t order = instances.keys[begin];
+    uint64_t replay_key = order;
+    if (Window::kFrameRows != window_range.frame_type_) {
+        // the rows before the start of the frame are slided out of the window
+        // once the row begin is buffered
+        int64_t sub = static_cast<int64_t>(order) + window_range.start_offset_;
+        replay_key = sub <= 0 ? 0u : static_cast<uint64_t>(sub - 1);
+    }
+    if (Window::kFrameRowsRange != window_range.frame_type_) {
+        // the start_row rows before the row begin are all after the instance
+        // row start_row + 1 rows before it
+        if (window_range.start_row_ >= begin) {
+            return 0;
+        }
+        replay_key = std::min(
+            replay_key, instances.keys[begin - window_range.start_row_ - 1]);
+    }
+    return replay_key;
+}
+
+void WindowAggRunner::RunWindowAggOnRange(
+    const Row& parameter, const OrderedRows& instances,
+    const std::vector<OrderedRows>& unions,
+    const std::vector<std::shared_ptr<DataHandler>>& join_right_tables,
+    uint64_t replay_key, size_t begin, size_t end,
+    MemTableHandler* output_table) {
+    size_t replay_begin =
+        std::lower_bound(instances.keys.begin(),
+                         instances.keys.begin() + begin, replay_key) -
+        instances.keys.begin();
+    std::vector<size_t> union_pos(unions.size(), 0);
+    base::KWayMerger<uint64_t> union_merger;
+    union_merger.Reset(unions.size());
+    for (size_t i = 0; i < unions.size(); i++) {
+        const auto& keys = unions[i].keys;
+        union_pos[i] =
+            std::lower_bound(keys.begin(), keys.end(), replay_key) -
+            keys.begin();
+        if (union_pos[i] < keys.size()) {
+            union_merger.Add(i, keys[union_pos[i]]);
+        }
+    }
+    HistoryWindow window(instance_window_gen_.range_gen_.window_range_);
+    window.set_instance_not_in_window(instance_not_in_window_);
+    window.set_exclude_current_time(exclude_current_time_);
+    for (size_t i = replay_begin; i < end; i++) {
+        uint64_t instance_order = instances.keys[i];
+        while (!union_merger.Empty() &&
+               union_merger.TopKey() < instance_order) {
+            size_t idx = union_merger.Top();
+            const auto& union_rows = unions[idx];
+            Row row = union_rows.rows[union_pos[idx]];
+            if (windows_join_gen_.Valid()) {
+                row = windows_join_gen_.Join(row, join_right_tables, parameter);
+            }
+            window_project_gen_.Gen(union_rows.keys[union_pos[idx]], row,
+                                    parameter, false, append_slices_, &window);
+            if (++union_pos[idx] < union_rows.keys.size()) {
+                union_merger.Next(union_rows.keys[union_pos[idx]]);
+            } else {
+                union_merger.Pop();
+            }
+        }
+        Row row = instances.rows[i];
+        if (windows_join_gen_.Valid()) {
+            row = windows_join_gen_.Join(row, join_right_tables, parameter);
+        }
+        // the replayed rows are buffered into the window only
+        bool is_output = i >= begin;
+        Row output = window_project_gen_.Gen(instance_order, row, parameter,
+                                             is_output, append_slices_,
+                                             &window);
+        if (is_output) {
+            output_table->AddRow(output);
+        }
+    }
+}
+
 std::shared_ptr<DataHandler> RequestLastJoinRunner::Run(
     RunnerContext& ctx,
     const std::vector<std::shared_ptr<DataHandler>>& inputs) {  // NOLINT
@@ -1465,12 +2030,49 @@ std::shared_ptr<DataHandler> RequestLastJoinRunner::Run(
     auto left_row = std::dynamic_pointer_cast<RowHandler>(left)->GetValue();
     auto &parameter = ctx.GetParameterRow();
     if (output_right_only_) {
-        return std::shared_ptr<RowHandler>(new MemRowHandler(
-            join_gen_.RowLastJoinDropLeftSlices(left_row, right, parameter)));
+        return std::make_shared<MemRowHandler>(
+            join_gen_.RowLastJoinDropLeftSlices(left_row, right, parameter));
     } else {
-        return std::shared_ptr<RowHandler>(
-            new MemRowHandler(join_gen_.RowLastJoin(left_row, right, parameter)));
+        return std::make_shared<MemRowHandler>(
+            join_gen_.RowLastJoin(left_row, right, parameter));
+    }
+}
+
+std::shared_ptr<DataHandlerVector> RequestLastJoinRunner::RunBatchRequests(
+    RunnerContext& ctx,
+    const std::vector<std::shared_ptr<DataHandlerList>>& batch_inputs) {
+    size_t size = ctx.GetRequestSize();
+    if (batch_inputs.size() < 2u || !batch_inputs[0] || !batch_inputs[1] ||
+        size < 2u) {
+        return std::shared_ptr<DataHandlerVector>();
+    }
+    // the keys are looked up together only if the requests join the same
+    // partition, the other cases run one by one
+    auto right = batch_inputs[1]->Get(0);
+    if (!right || kPartitionHandler != right->GetHanlderType() ||
+        !join_gen_.index_key_gen_.Valid()) {
+        return std::shared_ptr<DataHandlerVector>();
+    }
+    std::vector<Row> left_rows(size);
+    for (size_t idx = 0; idx < size; idx++) {
+        auto left = batch_inputs[0]->Get(idx);
+        if (!left || kRowHandler != left->GetHanlderType() ||
+            batch_inputs[1]->Get(idx) != right) {
+            return std::shared_ptr<DataHandlerVector>();
+        }
+        left_rows[idx] = std::dynamic_pointer_cast<RowHandler>(left)->GetValue();
+    }
+    std::vector<Row> joined_rows;
+    if (!join_gen_.RowLastJoinBatch(
+            left_rows, std::dynamic_pointer_cast<PartitionHandler>(right),
+            ctx.GetParameterRow(), output_right_only_, &joined_rows)) {
+        return std::shared_ptr<DataHandlerVector>();
+    }
+    auto outputs = std::make_shared<DataHandlerVector>();
+    for (auto& row : joined_rows) {
+        outputs->Add(std::make_shared<MemRowHandler>(row));
     }
+    return outputs;
 }
 
 std::shared_ptr<DataHandler> LastJoinRunner::Run(
@@ -1495,6 +2097,18 @@ std::shared_ptr<DataHandler> LastJoinRunner::Run(
 
     switch (left->GetHanlderType()) {
         case kTableHandler: {
+            if (join_gen_.IsHashJoin(right)) {
+                auto left_table = std::dynamic_pointer_cast<TableHandler>(left);
+                auto output_table = std::shared_ptr<MemTimeTableHandler>(
+                    new MemTimeTableHandler());
+                output_table->SetOrderType(left_table->GetOrderType());
+                if (!join_gen_.TableHashJoin(
+                        left_table, std::dynamic_pointer_cast<TableHandler>(right),
+                        parameter, output_table)) {
+                    return fail_ptr;
+                }
+                return output_table;
+            }
             if (join_gen_.right_group_gen_.Valid()) {
                 right = join_gen_.right_group_gen_.Partition(right, parameter);
             }
@@ -1528,6 +2142,20 @@ std::shared_ptr<DataHandler> LastJoinRunner::Run(
             return output_table;
         }
         case kPartitionHandler: {
+            if (join_gen_.IsHashJoin(right)) {
+                auto left_partition =
+                    std::dynamic_pointer_cast<PartitionHandler>(left);
+                auto output_partition = std::shared_ptr<MemPartitionHandler>(
+                    new MemPartitionHandler());
+                output_partition->SetOrderType(left_partition->GetOrderType());
+                if (!join_gen_.PartitionHashJoin(
+                        left_partition,
+                        std::dynamic_pointer_cast<TableHandler>(right),
+                        parameter, output_partition)) {
+                    return fail_ptr;
+                }
+                return output_partition;
+            }
             if (join_gen_.right_group_gen_.Valid()) {
                 right = join_gen_.right_group_gen_.Partition(right, parameter);
             }
@@ -1572,14 +2200,17 @@ std::shared_ptr<DataHandler> LastJoinRunner::Run(
 }
 
 std::shared_ptr<PartitionHandler> PartitionGenerator::Partition(
-    std::shared_ptr<DataHandler> input, const Row& parameter) {
+    std::shared_ptr<DataHandler> input, const Row& parameter,
+    RunnerContext* ctx) {
     switch (input->GetHanlderType()) {
         case kPartitionHandler: {
             return Partition(
-                std::dynamic_pointer_cast<PartitionHandler>(input), parameter);
+                std::dynamic_pointer_cast<PartitionHandler>(input), parameter,
+                ctx);
         }
         case kTableHandler: {
-            return Partition(std::dynamic_pointer_cast<TableHandler>(input), parameter);
+            return Partition(std::dynamic_pointer_cast<TableHandler>(input),
+                             parameter, ctx);
         }
         default: {
             LOG(WARNING) << "Partition Fail: input isn't partition or table";
@@ -1588,15 +2219,15 @@ std::shared_ptr<PartitionHandler> PartitionGenerator::Partition(
     }
 }
 std::shared_ptr<PartitionHandler> PartitionGenerator::Partition(
-    std::shared_ptr<PartitionHandler> table, const Row& parameter) {
+    std::shared_ptr<PartitionHandler> table, const Row& parameter,
+    RunnerContext* ctx) {
     if (!key_gen_.Valid()) {
         return table;
     }
     if (!table) {
         return std::shared_ptr<PartitionHandler>();
     }
-    auto output_partitions = std::shared_ptr<MemPartitionHandler>(
-        new MemPartitionHandler(table->GetSchema()));
+    PartitionBuilder output_partitions(table->GetSchema(), ctx);
     auto partitions = std::dynamic_pointer_cast<PartitionHandler>(table);
     auto iter = partitions->GetWindowIterator();
     if (!iter) {
@@ -1604,7 +2235,6 @@ std::shared_ptr<PartitionHandler> PartitionGenerator::Partition(
         return std::shared_ptr<PartitionHandler>();
     }
     iter->SeekToFirst();
-    output_partitions->SetOrderType(table->GetOrderType());
     while (iter->Valid()) {
         auto segment_iter = iter->GetValue();
         if (!segment_iter) {
@@ -1615,17 +2245,20 @@ std::shared_ptr<PartitionHandler> PartitionGenerator::Partition(
         segment_iter->SeekToFirst();
         while (segment_iter->Valid()) {
             std::string keys = key_gen_.Gen(segment_iter->GetValue(), parameter);
-            output_partitions->AddRow(segment_key + "|" + keys,
-                                      segment_iter->GetKey(),
-                                      segment_iter->GetValue());
+            if (!output_partitions.AddRow(segment_key + "|" + keys,
+                                          segment_iter->GetKey(),
+                                          segment_iter->GetValue())) {
+                return std::shared_ptr<PartitionHandler>();
+            }
             segment_iter->Next();
         }
         iter->Next();
     }
-    return output_partitions;
+    return output_partitions.Finish(table->GetOrderType());
 }
 std::shared_ptr<PartitionHandler> PartitionGenerator::Partition(
-    std::shared_ptr<TableHandler> table, const Row& parameter) {
+    std::shared_ptr<TableHandler> table, const Row& parameter,
+    RunnerContext* ctx) {
     auto fail_ptr = std::shared_ptr<PartitionHandler>();
     if (!key_gen_.Valid()) {
         return fail_ptr;
@@ -1637,9 +2270,7 @@ std::shared_ptr<PartitionHandler> PartitionGenerator::Partition(
         return fail_ptr;
     }
 
-    auto output_partitions = std::shared_ptr<MemPartitionHandler>(
-        new MemPartitionHandler(table->GetSchema()));
-
+    PartitionBuilder output_partitions(table->GetSchema(), ctx);
     auto iter = std::dynamic_pointer_cast<TableHandler>(table)->GetIterator();
     if (!iter) {
         LOG(WARNING) << "Fail to group empty table: table is empty";
@@ -1648,24 +2279,26 @@ std::shared_ptr<PartitionHandler> PartitionGenerator::Partition(
     iter->SeekToFirst();
     while (iter->Valid()) {
         std::string keys = key_gen_.Gen(iter->GetValue(), parameter);
-        output_partitions->AddRow(keys, iter->GetKey(), iter->GetValue());
+        if (!output_partitions.AddRow(keys, iter->GetKey(), iter->GetValue())) {
+            return fail_ptr;
+        }
         iter->Next();
     }
-    output_partitions->SetOrderType(table->GetOrderType());
-    return output_partitions;
+    return output_partitions.Finish(table->GetOrderType());
 }
 std::shared_ptr<DataHandler> SortGenerator::Sort(
-    std::shared_ptr<DataHandler> input, const bool reverse) {
+    std::shared_ptr<DataHandler> input, const bool reverse,
+    RunnerContext* ctx) {
     if (!input || !is_valid_ || !order_gen_.Valid()) {
         return input;
     }
     switch (input->GetHanlderType()) {
         case kTableHandler:
             return Sort(std::dynamic_pointer_cast<TableHandler>(input),
-                        reverse);
+                        reverse, ctx);
         case kPartitionHandler:
             return Sort(std::dynamic_pointer_cast<PartitionHandler>(input),
-                        reverse);
+                        reverse, ctx);
         default: {
             LOG(WARNING) << "Sort Fail: input isn't partition or table";
             return std::shared_ptr<PartitionHandler>();
@@ -1674,7 +2307,8 @@ std::shared_ptr<DataHandler> SortGenerator::Sort(
 }
 
 std::shared_ptr<PartitionHandler> SortGenerator::Sort(
-    std::shared_ptr<PartitionHandler> partition, const bool reverse) {
+    std::shared_ptr<PartitionHandler> partition, const bool reverse,
+    RunnerContext* ctx) {
     bool is_asc = reverse ? !is_asc_ : is_asc_;
     if (!is_valid_) {
         return partition;
@@ -1687,11 +2321,20 @@ std::shared_ptr<PartitionHandler> SortGenerator::Sort(
         DLOG(INFO) << "match the order redirect the table";
         return partition;
     }
+    // the spilled partitions are sorted bucket by bucket as they are loaded
+    auto spilled = std::dynamic_pointer_cast<SpillPartitionHandler>(partition);
+    if (spilled) {
+        SortGenerator sort_gen(*this);
+        return spilled->Transform(
+            [sort_gen, reverse](
+                std::shared_ptr<PartitionHandler> bucket) mutable {
+                return sort_gen.Sort(bucket, reverse);
+            },
+            is_asc ? kAscOrder : kDescOrder);
+    }
 
     DLOG(INFO) << "mismatch the order and sort it";
-    auto output =
-        std::shared_ptr<MemPartitionHandler>(new MemPartitionHandler());
-
+    PartitionBuilder builder(partition->GetSchema(), ctx);
     auto iter = partition->GetWindowIterator();
     if (!iter) {
         LOG(WARNING) << "Sort partition fail: partition is Empty";
@@ -1708,11 +2351,21 @@ std::shared_ptr<PartitionHandler> SortGenerator::Sort(
         auto key = iter->GetKey().ToString();
         segment_iter->SeekToFirst();
         while (segment_iter->Valid()) {
-            int64_t ts = order_gen_.Gen(segment_iter->GetValue());
-            output->AddRow(key, static_cast<uint64_t>(ts),
-                           segment_iter->GetValue());
+            uint64_t ts = order_gen_.Valid()
+                              ? static_cast<uint64_t>(
+                                    order_gen_.Gen(segment_iter->GetValue()))
+                              : segment_iter->GetKey();
+            if (!builder.AddRow(key, ts, segment_iter->GetValue())) {
+                return std::shared_ptr<PartitionHandler>();
+            }
             segment_iter->Next();
         }
+        iter->Next();
+    }
+    auto sorted = builder.Finish(partition->GetOrderType());
+    auto output = std::dynamic_pointer_cast<MemPartitionHandler>(sorted);
+    if (!output) {
+        return sorted ? Sort(sorted, reverse) : sorted;
     }
     if (order_gen_.Valid()) {
         output->Sort(is_asc);
@@ -1723,7 +2376,8 @@ std::shared_ptr<PartitionHandler> SortGenerator::Sort(
 }
 
 std::shared_ptr<TableHandler> SortGenerator::Sort(
-    std::shared_ptr<TableHandler> table, const bool reverse) {
+    std::shared_ptr<TableHandler> table, const bool reverse,
+    RunnerContext* ctx) {
     bool is_asc = reverse ? !is_asc_ : is_asc_;
     if (!table || !is_valid_) {
         return table;
@@ -1732,50 +2386,98 @@ std::shared_ptr<TableHandler> SortGenerator::Sort(
         is_asc == (table->GetOrderType() == kAscOrder)) {
         return table;
     }
+    auto iter = std::dynamic_pointer_cast<TableHandler>(table)->GetIterator();
+    if (!iter) {
+        LOG(WARNING) << "Sort table fail: table is Empty";
+        return std::shared_ptr<TableHandler>();
+    }
+    if (order_gen_.Valid()) {
+        // the sorted runs beyond the memory budget are spilled and merged
+        SortedTableBuilder builder(table->GetSchema(), ctx, is_asc);
+        iter->SeekToFirst();
+        while (iter->Valid()) {
+            int64_t key = order_gen_.Gen(iter->GetValue());
+            if (!builder.AddRow(static_cast<uint64_t>(key), iter->GetValue())) {
+                return std::shared_ptr<TableHandler>();
+            }
+            iter->Next();
+        }
+        return builder.Finish();
+    }
     auto output_table = std::shared_ptr<MemTimeTableHandler>(
         new MemTimeTableHandler(table->GetSchema()));
     output_table->SetOrderType(table->GetOrderType());
-    auto iter = std::dynamic_pointer_cast<TableHandler>(table)->GetIterator();
+    iter->SeekToFirst();
+    while (iter->Valid()) {
+        output_table->AddRow(iter->GetKey(), iter->GetValue());
+        iter->Next();
+    }
+    switch (table->GetOrderType()) {
+        case kDescOrder:
+            if (is_asc) {
+                output_table->Reverse();
+            }
+            break;
+        case kAscOrder:
+            if (!is_asc) {
+                output_table->Reverse();
+            }
+            break;
+        default: {
+            LOG(WARNING) << "Fail to Sort, order type invalid";
+            return std::shared_ptr<TableHandler>();
+        }
+    }
+    return output_table;
+}
+std::shared_ptr<TableHandler> SortGenerator::TopK(
+    std::shared_ptr<TableHandler> table, size_t k) {
+    if (!table || !is_valid_ || !order_gen_.Valid() || k == 0) {
+        return Sort(table);
+    }
+    auto iter = table->GetIterator();
     if (!iter) {
         LOG(WARNING) << "Sort table fail: table is Empty";
         return std::shared_ptr<TableHandler>();
     }
+    // the top of the heap is the last of the rows kept, the largest one for
+    // the ascending order and the smallest one for the descending order
+    std::vector<std::pair<uint64_t, Row>> heap;
+    heap.reserve(k);
+    AscComparor asc;
+    DescComparor desc;
+    auto less = [this, &asc, &desc](const std::pair<uint64_t, Row>& l,
+                                    const std::pair<uint64_t, Row>& r) {
+        return is_asc_ ? asc(l, r) : desc(l, r);
+    };
     iter->SeekToFirst();
     while (iter->Valid()) {
-        if (order_gen_.Valid()) {
-            int64_t key = order_gen_.Gen(iter->GetValue());
-            output_table->AddRow(static_cast<uint64_t>(key), iter->GetValue());
-        } else {
-            output_table->AddRow(iter->GetKey(), iter->GetValue());
+        uint64_t key = static_cast<uint64_t>(order_gen_.Gen(iter->GetValue()));
+        if (heap.size() < k) {
+            heap.emplace_back(key, iter->GetValue());
+            std::push_heap(heap.begin(), heap.end(), less);
+        } else if (is_asc_ ? key < heap.front().first
+                           : key > heap.front().first) {
+            std::pop_heap(heap.begin(), heap.end(), less);
+            heap.back() = std::make_pair(key, iter->GetValue());
+            std::push_heap(heap.begin(), heap.end(), less);
         }
         iter->Next();
     }
-
-    if (order_gen_.Valid()) {
-        output_table->Sort(is_asc);
-    } else {
-        switch (table->GetOrderType()) {
-            case kDescOrder:
-                if (is_asc) {
-                    output_table->Reverse();
-                }
-                break;
-            case kAscOrder:
-                if (!is_asc) {
-                    output_table->Reverse();
-                }
-                break;
-            default: {
-                LOG(WARNING) << "Fail to Sort, order type invalid";
-                return std::shared_ptr<TableHandler>();
-            }
-        }
+    std::sort_heap(heap.begin(), heap.end(), less);
+    auto output_table = std::shared_ptr<MemTimeTableHandler>(
+        new MemTimeTableHandler(table->GetSchema()));
+    for (auto& pair : heap) {
+        output_table->AddRow(pair.first, pair.second);
     }
+    output_table->SetOrderType(is_asc_ ? kAscOrder : kDescOrder);
     return output_table;
 }
 Row JoinGenerator::RowLastJoinDropLeftSlices(
     const Row& left_row, std::shared_ptr<DataHandler> right, const Row& parameter) {
-    Row joined = RowLastJoin(left_row, right, parameter);
+    return DropLeftSlices(RowLastJoin(left_row, right, parameter));
+}
+Row JoinGenerator::DropLeftSlices(const Row& joined) const {
     Row right_row(joined.GetSlice(left_slices_));
     for (size_t offset = 1; offset < right_slices_; offset++) {
         right_row.Append(joined.GetSlice(left_slices_ + offset));
@@ -1807,6 +2509,45 @@ Row JoinGenerator::RowLastJoin(const Row& left_row,
         }
     }
 }
+bool JoinGenerator::RowLastJoinBatch(
+    const std::vector<Row>& left_rows,
+    std::shared_ptr<PartitionHandler> partition, const Row& parameter,
+    bool drop_left_slices, std::vector<Row>* output) {
+    if (!partition || !index_key_gen_.Valid() || output == nullptr) {
+        return false;
+    }
+    std::vector<std::string> keys(left_rows.size());
+    std::vector<size_t> order(left_rows.size());
+    for (size_t idx = 0; idx < left_rows.size(); idx++) {
+        keys[idx] = index_key_gen_.Gen(left_rows[idx], parameter);
+        order[idx] = idx;
+    }
+    std::sort(order.begin(), order.end(), [&keys](size_t l, size_t r) {
+        return keys[l] < keys[r];
+    });
+    std::vector<std::string> distinct_keys;
+    for (size_t pos = 0; pos < order.size(); pos++) {
+        if (pos == 0 || keys[order[pos]] != keys[order[pos - 1]]) {
+            distinct_keys.push_back(keys[order[pos]]);
+        }
+    }
+    auto segments = partition->GetSegments(distinct_keys);
+    if (segments.size() != distinct_keys.size()) {
+        return false;
+    }
+    output->resize(left_rows.size());
+    size_t segment_idx = 0;
+    for (size_t pos = 0; pos < order.size(); pos++) {
+        size_t idx = order[pos];
+        if (pos > 0 && keys[idx] != keys[order[pos - 1]]) {
+            segment_idx++;
+        }
+        Row joined =
+            RowLastJoinTable(left_rows[idx], segments[segment_idx], parameter);
+        (*output)[idx] = drop_left_slices ? DropLeftSlices(joined) : joined;
+    }
+    return true;
+}
 Row JoinGenerator::RowLastJoinPartition(
     const Row& left_row, std::shared_ptr<PartitionHandler> partition,
     const Row& parameter) {
@@ -2008,6 +2749,151 @@ bool JoinGenerator::PartitionJoin(std::shared_ptr<PartitionHandler> left,
     }
     return true;
 }
+bool JoinGenerator::IsHashJoin(std::shared_ptr<DataHandler> right) const {
+    // a sort without order function keeps the order of the right table,
+    // which the hash table does not track
+    return right && kTableHandler == right->GetHanlderType() &&
+           right_group_gen_.Valid() && left_key_gen_.Valid() &&
+           !index_key_gen_.Valid() && !condition_gen_.Valid() &&
+           (!right_sort_gen_.Valid() || right_sort_gen_.order_gen().Valid());
+}
+bool JoinGenerator::BuildHashTable(std::shared_ptr<TableHandler> right,
+                                   const Row& parameter,
+                                   LastJoinHashTable* hash_table) {
+    auto right_iter = right->GetIterator();
+    if (!right_iter) {
+        LOG(WARNING) << "fail to run hash join: right input empty";
+        return false;
+    }
+    bool has_order = right_sort_gen_.Valid();
+    right_iter->SeekToFirst();
+    while (right_iter->Valid()) {
+        const Row& right_row = right_iter->GetValue();
+        int64_t order = has_order ? right_sort_gen_.order_gen().Gen(right_row) : 0;
+        hash_table->Put(right_group_gen_.GetKey(right_row, parameter), order,
+                        right_row);
+        right_iter->Next();
+    }
+    return true;
+}
+Row JoinGenerator::RowHashJoin(const Row& left_row,
+                               const LastJoinHashTable& hash_table,
+                               const Row& parameter) {
+    const Row* right_row =
+        hash_table.Get(left_key_gen_.Gen(left_row, parameter));
+    return Row(left_slices_, left_row, right_slices_,
+               nullptr == right_row ? Row() : *right_row);
+}
+bool JoinGenerator::TableHashJoin(std::shared_ptr<TableHandler> left,
+                                  std::shared_ptr<TableHandler> right,
+                                  const Row& parameter,
+                                  std::shared_ptr<MemTimeTableHandler> output) {
+    auto left_iter = left->GetIterator();
+    if (!left_iter) {
+        LOG(WARNING) << "fail to run hash join: left input empty";
+        return false;
+    }
+    // the last join takes the first row of the right segment sorted in
+    // reverse, i.e. the max order for an ascending sort
+    LastJoinHashTable hash_table(
+        right_sort_gen_.Valid() ? (right_sort_gen_.is_asc() ? 1 : -1) : 0);
+    if (!BuildHashTable(right, parameter, &hash_table)) {
+        return false;
+    }
+    left_iter->SeekToFirst();
+    while (left_iter->Valid()) {
+        output->AddRow(left_iter->GetKey(),
+                       RowHashJoin(left_iter->GetValue(), hash_table, parameter));
+        left_iter->Next();
+    }
+    return true;
+}
+bool JoinGenerator::PartitionHashJoin(
+    std::shared_ptr<PartitionHandler> left, std::shared_ptr<TableHandler> right,
+    const Row& parameter, std::shared_ptr<MemPartitionHandler> output) {
+    auto left_partition_iter = left ? left->GetWindowIterator() : nullptr;
+    if (!left_partition_iter) {
+        LOG(WARNING) << "fail to run hash join: left input empty";
+        return false;
+    }
+    LastJoinHashTable hash_table(
+        right_sort_gen_.Valid() ? (right_sort_gen_.is_asc() ? 1 : -1) : 0);
+    if (!BuildHashTable(right, parameter, &hash_table)) {
+        return false;
+    }
+    left_partition_iter->SeekToFirst();
+    while (left_partition_iter->Valid()) {
+        auto left_iter = left_partition_iter->GetValue();
+        auto left_key = left_partition_iter->GetKey();
+        if (!left_iter) {
+            left_partition_iter->Next();
+            continue;
+        }
+        auto left_key_str = std::string(
+            reinterpret_cast<const char*>(left_key.buf()), left_key.size());
+        left_iter->SeekToFirst();
+        while (left_iter->Valid()) {
+            output->AddRow(left_key_str, left_iter->GetKey(),
+                           RowHashJoin(left_iter->GetValue(), hash_table,
+                                       parameter));
+            left_iter->Next();
+        }
+        left_partition_iter->Next();
+    }
+    return true;
+}
+
+void LastJoinHashTable::Put(const std::string& key, int64_t order,
+                            const Row& row) {
+    if (entries_.size() * 2 >= slots_.size()) {
+        Grow();
+    }
+    uint64_t hash = std::hash<std::string>()(key);
+    size_t slot = FindSlot(hash, key);
+    if (-1 == slots_[slot]) {
+        slots_[slot] = static_cast<int32_t>(entries_.size());
+        entries_.push_back(Entry{hash, key, order, row});
+        return;
+    }
+    // the first row is kept when the orders are equal
+    Entry& entry = entries_[slots_[slot]];
+    if ((order_direction_ > 0 && order > entry.order) ||
+        (order_direction_ < 0 && order < entry.order)) {
+        entry.order = order;
+        entry.row = row;
+    }
+}
+const Row* LastJoinHashTable::Get(const std::string& key) const {
+    if (entries_.empty()) {
+        return nullptr;
+    }
+    size_t slot = FindSlot(std::hash<std::string>()(key), key);
+    return -1 == slots_[slot] ? nullptr : &entries_[slots_[slot]].row;
+}
+size_t LastJoinHashTable::FindSlot(uint64_t hash,
+                                   const std::string& key) const {
+    size_t slot = hash & mask_;
+    while (-1 != slots_[slot]) {
+        const Entry& entry = entries_[slots_[slot]];
+        if (entry.hash == hash && entry.key == key) {
+            break;
+        }
+        slot = (slot + 1) & mask_;
+    }
+    return slot;
+}
+void LastJoinHashTable::Grow() {
+    size_t capacity = slots_.empty() ? 16 : slots_.size() * 2;
+    slots_.assign(capacity, -1);
+    mask_ = capacity - 1;
+    for (size_t i = 0; i < entries_.size(); i++) {
+        size_t slot = entries_[i].hash & mask_;
+        while (-1 != slots_[slot]) {
+            slot = (slot + 1) & mask_;
+        }
+        slots_[slot] = static_cast<int32_t>(i);
+    }
+}
 const Row Runner::RowLastJoinTable(size_t left_slices, const Row& left_row,
                                    size_t right_slices,
                                    std::shared_ptr<TableHandler> right_table,
@@ -2360,9 +3246,9 @@ std::shared_ptr<DataHandler> ConcatRunner::Run(
     }
     switch (left->GetHanlderType()) {
         case kRowHandler:
-            return std::shared_ptr<RowHandler>(new RowCombineWrapper(
+            return std::make_shared<RowCombineWrapper>(
                 std::dynamic_pointer_cast<RowHandler>(left), left_slices,
-                std::dynamic_pointer_cast<RowHandler>(right), right_slices));
+                std::dynamic_pointer_cast<RowHandler>(right), right_slices);
         case kTableHandler:
             return std::shared_ptr<TableHandler>(new ConcatTableHandler(
                 std::dynamic_pointer_cast<TableHandler>(left), left_slices,
@@ -2461,20 +3347,83 @@ std::shared_ptr<DataHandler> GroupAggRunner::Run(
         return std::shared_ptr<DataHandler>();
     }
 
+    if (input_group_gen_.Valid()) {
+        if (kTableHandler == input->GetHanlderType()) {
+            return HashAggregate(ctx,
+                                 std::dynamic_pointer_cast<TableHandler>(input));
+        }
+        input = input_group_gen_.Partition(input, ctx.GetParameterRow(), &ctx);
+        if (!input) {
+            LOG(WARNING) << "group aggregation fail: fail to group input";
+            return std::shared_ptr<DataHandler>();
+        }
+    }
     if (kPartitionHandler != input->GetHanlderType()) {
         LOG(WARNING) << "group aggregation fail: input isn't partition ";
         return std::shared_ptr<DataHandler>();
     }
-    auto partition = std::dynamic_pointer_cast<PartitionHandler>(input);
+    return Aggregate(ctx, std::dynamic_pointer_cast<PartitionHandler>(input));
+}
+std::shared_ptr<TableHandler> GroupAggRunner::HashAggregate(
+    RunnerContext& ctx, std::shared_ptr<TableHandler> table) {
+    auto iter = table->GetIterator();
+    if (!iter) {
+        LOG(WARNING) << "group aggregation fail: input iterator is null";
+        return std::shared_ptr<TableHandler>();
+    }
+    auto& parameter = ctx.GetParameterRow();
+    // the rows are referred by the groups without the partition copies, and
+    // the groups are aggregated in the order of the keys as partitions are
+    std::unordered_map<std::string, std::shared_ptr<MemTimeTableHandler>>
+        groups;
+    iter->SeekToFirst();
+    while (iter->Valid()) {
+        auto& group = groups[input_group_gen_.GetKey(iter->GetValue(), parameter)];
+        if (!group) {
+            group = std::make_shared<MemTimeTableHandler>(table->GetSchema());
+            group->SetOrderType(table->GetOrderType());
+        }
+        group->AddRow(iter->GetKey(), iter->GetValue());
+        iter->Next();
+    }
+    std::vector<const std::string*> keys;
+    keys.reserve(groups.size());
+    for (auto& group : groups) {
+        keys.push_back(&group.first);
+    }
+    std::sort(keys.begin(), keys.end(),
+              [](const std::string* l, const std::string* r) { return *l < *r; });
+    auto output_table = std::shared_ptr<MemTableHandler>(new MemTableHandler());
+    size_t step_cnt = 0;
+    JitRuntime::get()->InitRunStep();
+    for (size_t idx = 0; idx < keys.size(); idx++) {
+        if (limit_cnt_ > 0 && idx >= static_cast<size_t>(limit_cnt_)) {
+            break;
+        }
+        output_table->AddRow(agg_gen_.Gen(parameter, groups[*keys[idx]]));
+        if (++step_cnt >= RUN_STEP_BATCH_SIZE) {
+            JitRuntime::get()->ReleaseRunStep();
+            JitRuntime::get()->InitRunStep();
+            step_cnt = 0;
+        }
+    }
+    JitRuntime::get()->ReleaseRunStep();
+    return output_table;
+}
+std::shared_ptr<TableHandler> GroupAggRunner::Aggregate(
+    RunnerContext& ctx, std::shared_ptr<PartitionHandler> partition) {
     auto output_table = std::shared_ptr<MemTableHandler>(new MemTableHandler());
     auto iter = partition->GetWindowIterator();
     if (!iter) {
         LOG(WARNING) << "group aggregation fail: input iterator is null";
-        return std::shared_ptr<DataHandler>();
+        return std::shared_ptr<TableHandler>();
     }
     auto& parameter = ctx.GetParameterRow();
     iter->SeekToFirst();
     int32_t cnt = 0;
+    // the memory allocated by the aggregations is released once per batch of groups
+    size_t step_cnt = 0;
+    JitRuntime::get()->InitRunStep();
     while (iter->Valid()) {
         if (limit_cnt_ > 0 && cnt++ >= limit_cnt_) {
             break;
@@ -2482,18 +3431,78 @@ std::shared_ptr<DataHandler> GroupAggRunner::Run(
         auto segment_iter = iter->GetValue();
         if (!segment_iter) {
             LOG(WARNING) << "group aggregation fail: segment iterator is null";
-            return std::shared_ptr<DataHandler>();
+            JitRuntime::get()->ReleaseRunStep();
+            return std::shared_ptr<TableHandler>();
         }
         auto key = iter->GetKey().ToString();
         auto segment = partition->GetSegment(key);
         output_table->AddRow(agg_gen_.Gen(parameter, segment));
+        if (++step_cnt >= RUN_STEP_BATCH_SIZE) {
+            JitRuntime::get()->ReleaseRunStep();
+            JitRuntime::get()->InitRunStep();
+            step_cnt = 0;
+        }
         iter->Next();
     }
+    JitRuntime::get()->ReleaseRunStep();
     return output_table;
 }
 std::shared_ptr<DataHandler> RequestUnionRunner::Run(
     RunnerContext& ctx,
     const std::vector<std::shared_ptr<DataHandler>>& inputs) {
+    return RunRequest(ctx, inputs, nullptr);
+}
+std::shared_ptr<DataHandlerList> RequestUnionRunner::BatchRequestRun(
+    RunnerContext& ctx) {
+    // a common window is built once by the default run
+    if (need_batch_cache_) {
+        return Runner::BatchRequestRun(ctx);
+    }
+    if (need_cache_) {
+        auto cached = ctx.GetBatchCache(id_);
+        if (cached != nullptr) {
+            DLOG(INFO) << "RUNNER ID " << id_ << " HIT CACHE!";
+            return cached;
+        }
+    }
+    std::vector<std::shared_ptr<DataHandlerList>> batch_inputs(
+        producers_.size());
+    for (size_t idx = producers_.size(); idx > 0; idx--) {
+        batch_inputs[idx - 1] = producers_[idx - 1]->BatchRequestRun(ctx);
+    }
+    std::shared_ptr<DataHandlerVector> outputs =
+        std::make_shared<DataHandlerVector>();
+    RequestWindowCache window_cache;
+    std::vector<std::shared_ptr<DataHandler>> inputs(producers_.size());
+    for (size_t idx = 0; idx < ctx.GetRequestSize(); idx++) {
+        for (size_t producer_idx = 0; producer_idx < producers_.size();
+             producer_idx++) {
+            inputs[producer_idx] = batch_inputs[producer_idx]->Get(idx);
+        }
+        outputs->Add(RunRequest(ctx, inputs, &window_cache));
+    }
+    if (ctx.is_debug()) {
+        std::ostringstream oss;
+        oss << "RUNNER TYPE: " << RunnerTypeName(type_) << ", ID: " << id_
+            << ", SHARED SEGMENTS: " << window_cache.size() << "\n";
+        for (size_t idx = 0; idx < outputs->GetSize(); idx++) {
+            if (idx >= MAX_DEBUG_BATCH_SiZE) {
+                oss << ">= MAX_DEBUG_BATCH_SiZE...\n";
+                break;
+            }
+            Runner::PrintData(oss, output_schemas_, outputs->Get(idx));
+        }
+        LOG(INFO) << oss.str();
+    }
+    if (need_cache_) {
+        ctx.SetBatchCache(id_, outputs);
+    }
+    return outputs;
+}
+std::shared_ptr<DataHandler> RequestUnionRunner::RunRequest(
+    RunnerContext& ctx,
+    const std::vector<std::shared_ptr<DataHandler>>& inputs,
+    RequestWindowCache* window_cache) {
     auto fail_ptr = std::shared_ptr<DataHandler>();
     if (inputs.size() < 2u) {
         LOG(WARNING) << "inputs size < 2";
@@ -2512,20 +3521,63 @@ std::shared_ptr<DataHandler> RequestUnionRunner::Run(
 
     int64_t ts_gen = range_gen_.Valid() ? range_gen_.ts_gen_.Gen(request) : -1;
 
+    // the window of the merged frame is shared by the runners of a request
+    if (shared_window_ && shared_window_->member_cnt > 1 &&
+        window_cache == nullptr && ts_gen >= 0) {
+        auto window = std::dynamic_pointer_cast<TableHandler>(
+            ctx.GetCache(shared_window_->id));
+        if (!window) {
+            auto union_inputs = windows_union_gen_.RunInputs(ctx);
+            auto union_segments = windows_union_gen_.GetRequestWindows(
+                request, ctx.GetParameterRow(), union_inputs, window_cache);
+            window = RequestUnionWindow(
+                request, union_segments, ts_gen, shared_window_->window_range,
+                false, exclude_current_time_, &ctx);
+            ctx.SetCache(shared_window_->id, window);
+            if (!window) {
+                return fail_ptr;
+            }
+        }
+        return RequestUnionWindow(request, {window}, ts_gen,
+                                  range_gen_.window_range_, output_request_row_,
+                                  exclude_current_time_, &ctx);
+    }
+
     // Prepare Union Window
     auto union_inputs = windows_union_gen_.RunInputs(ctx);
-    auto union_segments =
-        windows_union_gen_.GetRequestWindows(request, ctx.GetParameterRow(), union_inputs);
+    auto union_segments = windows_union_gen_.GetRequestWindows(
+        request, ctx.GetParameterRow(), union_inputs, window_cache);
+    // the columns not read are left out when the rows are decoded
+    if (column_mask_ && !column_mask_disabled_ && union_segments.size() == 1 &&
+        union_segments[0]) {
+        union_segments[0]->SetColumnMask(column_mask_);
+    }
     // build window with start and end offset
     return RequestUnionWindow(request, union_segments, ts_gen,
                               range_gen_.window_range_, output_request_row_,
-                              exclude_current_time_);
+                              exclude_current_time_, &ctx);
 }
+void RequestUnionRunner::AddColumnMask(const std::vector<bool>& mask) {
+    if (!column_mask_) {
+        column_mask_ = std::make_shared<const std::vector<bool>>(mask);
+        return;
+    }
+    if (column_mask_->size() != mask.size()) {
+        column_mask_disabled_ = true;
+        return;
+    }
+    std::vector<bool> merged(*column_mask_);
+    for (size_t i = 0; i < mask.size(); ++i) {
+        merged[i] = merged[i] || mask[i];
+    }
+    column_mask_ = std::make_shared<const std::vector<bool>>(merged);
+}
+
 std::shared_ptr<TableHandler> RequestUnionRunner::RequestUnionWindow(
     const Row& request,
     std::vector<std::shared_ptr<TableHandler>> union_segments, int64_t ts_gen,
     const WindowRange& window_range, const bool output_request_row,
-    const bool exclude_current_time) {
+    const bool exclude_current_time, RunnerContext* ctx) {
     uint64_t start = 0;
     uint64_t end = UINT64_MAX;
     uint64_t rows_start_preceding = 0;
@@ -2546,36 +3598,48 @@ std::shared_ptr<TableHandler> RequestUnionRunner::RequestUnionWindow(
     }
     uint64_t request_key = ts_gen > 0 ? static_cast<uint64_t>(ts_gen) : 0;
 
+    // no segment has more rows in the window than the frame does, so the
+    // iteration of the segments can stop at the bounds of the frame
+    uint64_t bound_key = 0;
+    uint64_t bound_cnt = 0;
+    if (ts_gen >= 0) {
+        if (window_range.frame_type_ == Window::kFrameRowsRange) {
+            bound_key = start;
+        } else if (window_range.frame_type_ == Window::kFrameRows) {
+            bound_cnt = rows_start_preceding + 1;
+        }
+        if (max_size > 0 && (bound_cnt == 0 || max_size < bound_cnt)) {
+            bound_cnt = max_size;
+        }
+    }
+
     auto window_table =
         std::shared_ptr<MemTimeTableHandler>(new MemTimeTableHandler());
 
     size_t unions_cnt = union_segments.size();
     // Prepare Union Segment Iterators
     std::vector<std::unique_ptr<RowIterator>> union_segment_iters(unions_cnt);
-    std::vector<IteratorStatus> union_segment_status(unions_cnt);
+    // the rows of the same key are read from the last union first
+    base::KWayMerger<uint64_t, std::greater<uint64_t>, false> union_merger;
+    union_merger.Reset(unions_cnt);
 
     for (size_t i = 0; i < unions_cnt; i++) {
         if (!union_segments[i]) {
-            union_segment_status[i] = IteratorStatus();
             continue;
         }
         union_segment_iters[i] = union_segments[i]->GetIterator();
         if (!union_segment_iters[i]) {
-            union_segment_status[i] = IteratorStatus();
             continue;
         }
+        if (bound_key > 0 || bound_cnt > 0) {
+            union_segment_iters[i]->SetBound(bound_key, bound_cnt);
+        }
         union_segment_iters[i]->Seek(end);
         if (!union_segment_iters[i]->Valid()) {
-            union_segment_status[i] = IteratorStatus();
             continue;
         }
-        uint64_t ts = union_segment_iters[i]->GetKey();
-        union_segment_status[i] = IteratorStatus(ts);
+        union_merger.Add(i, union_segment_iters[i]->GetKey());
     }
-    int32_t max_union_pos = 0 == unions_cnt
-                                ? -1
-                                : IteratorStatus::PickIteratorWithMaximizeKey(
-                                      &union_segment_status);
     uint64_t cnt = 0;
     auto range_status = window_range.GetWindowPositionStatus(
         cnt > rows_start_preceding, window_range.end_offset_ < 0,
@@ -2587,34 +3651,63 @@ std::shared_ptr<TableHandler> RequestUnionRunner::RequestUnionWindow(
         cnt++;
     }
 
-    while (-1 != max_union_pos) {
+    // the rows of a sampled window are kept with a stride, which is doubled
+    // and every other kept row dropped once more rows than the sample size
+    // are kept, so the kept rows are spread evenly over the window. The rows
+    // skipped are not read from the segments
+    uint64_t sample_size = ts_gen >= 0 ? window_range.sample_size_ : 0;
+    uint64_t sample_stride = 1;
+    uint64_t sample_cnt = 0;
+    std::vector<std::pair<uint64_t, Row>> samples;
+
+    uint64_t read_cnt = 0;
+    while (!union_merger.Empty()) {
         if (max_size > 0 && cnt >= max_size) {
             break;
         }
+        if (ctx != nullptr && ++read_cnt % DEADLINE_CHECK_ROW_CNT == 0 &&
+            ctx->IsExpired()) {
+            return std::shared_ptr<TableHandler>();
+        }
+        uint64_t key = union_merger.TopKey();
+        auto& union_iter = union_segment_iters[union_merger.Top()];
         auto range_status = window_range.GetWindowPositionStatus(
-            cnt > rows_start_preceding,
-            union_segment_status[max_union_pos].key_ > end,
-            union_segment_status[max_union_pos].key_ < start);
+            cnt > rows_start_preceding, key > end, key < start);
         if (WindowRange::kExceedWindow == range_status) {
             break;
         }
         if (WindowRange::kInWindow == range_status) {
-            window_table->AddRow(
-                union_segment_status[max_union_pos].key_,
-                union_segment_iters[max_union_pos]->GetValue());
+            if (sample_size == 0) {
+                window_table->AddRow(key, union_iter->GetValue());
+            } else if (sample_cnt++ % sample_stride == 0) {
+                samples.emplace_back(key, union_iter->GetValue());
+                if (samples.size() > sample_size) {
+                    for (size_t i = 0; 2 * i < samples.size(); i++) {
+                        samples[i] = samples[2 * i];
+                    }
+                    samples.resize((samples.size() + 1) / 2);
+                    sample_stride *= 2;
+                }
+            }
             cnt++;
         }
-        // Update Iterator Status
-        union_segment_iters[max_union_pos]->Next();
-        if (!union_segment_iters[max_union_pos]->Valid()) {
-            union_segment_status[max_union_pos].MarkInValid();
+        union_iter->Next();
+        if (!union_iter->Valid()) {
+            union_merger.Pop();
         } else {
-            union_segment_status[max_union_pos].set_key(
-                union_segment_iters[max_union_pos]->GetKey());
+            union_merger.Next(union_iter->GetKey());
+        }
+    }
+    if (sample_size > 0) {
+        for (auto& sample : samples) {
+            window_table->AddRow(sample.first, sample.second);
+        }
+        if (sample_stride > 1) {
+            // the request row is never dropped
+            double request_cnt = output_request_row ? 1.0 : 0.0;
+            window_table->SetSampleScale((sample_cnt + request_cnt) /
+                                         (samples.size() + request_cnt));
         }
-        // Pick new mininum union pos
-        max_union_pos =
-            IteratorStatus::PickIteratorWithMaximizeKey(&union_segment_status);
     }
     DLOG(INFO) << "REQUEST UNION cnt = " << window_table->GetCount();
     return window_table;
@@ -2665,9 +3758,8 @@ std::shared_ptr<DataHandler> AggRunner::Run(
     if (kTableHandler != input->GetHanlderType()) {
         return std::shared_ptr<DataHandler>();
     }
-    auto row_handler = std::shared_ptr<RowHandler>(new MemRowHandler(
-        agg_gen_.Gen(ctx.GetParameterRow(), std::dynamic_pointer_cast<TableHandler>(input))));
-    return row_handler;
+    return std::make_shared<MemRowHandler>(agg_gen_.Gen(
+        ctx.GetParameterRow(), std::dynamic_pointer_cast<TableHandler>(input)));
 }
 std::shared_ptr<DataHandlerList> ProxyRequestRunner::BatchRequestRun(
     RunnerContext& ctx) {
@@ -3152,7 +4244,7 @@ const std::string KeyGenerator::Gen(const Row& row, const Row& parameter) {
     return keys;
 }
 
-const int64_t OrderGenerator::Gen(const Row& row) {
+const int64_t OrderGenerator::Gen(const Row& row) const {
     Row order_row = CoreAPI::RowProject(fn_, row, Row(), true);
     return Runner::GetColumnInt64(order_row.buf(), &row_view_, idxs_[0],
                                   fn_schema_.Get(idxs_[0]).type());
@@ -3164,6 +4256,28 @@ const bool ConditionGenerator::Gen(const Row& row, const Row& parameter) const {
 const Row ProjectGenerator::Gen(const Row& row, const Row& parameter) {
     return CoreAPI::RowProject(fn_, row, parameter, false);
 }
+void ProjectGenerator::GenBatch(const std::vector<Row>& rows, const Row& parameter, std::vector<Row>* outputs) {
+    auto udf = reinterpret_cast<int32_t (*)(const int64_t, const int8_t*, const int8_t*, const int8_t*, int8_t**)>(
+        const_cast<int8_t*>(fn_));
+    auto parameter_ptr = reinterpret_cast<const int8_t*>(&parameter);
+    // the temporaries of the whole batch are released at once
+    JitRuntime::get()->InitRunStep();
+    for (const auto& row : rows) {
+        if (row.empty()) {
+            outputs->push_back(Row());
+            continue;
+        }
+        int8_t* buf = nullptr;
+        uint32_t ret = udf(0, reinterpret_cast<const int8_t*>(&row), nullptr, parameter_ptr, &buf);
+        if (ret != 0) {
+            LOG(WARNING) << "fail to run udf " << ret;
+            outputs->push_back(Row());
+            continue;
+        }
+        outputs->push_back(Row(base::RefCountedSlice::CreateManaged(buf, RowView::GetSize(buf))));
+    }
+    JitRuntime::get()->ReleaseRunStep();
+}
 
 const Row ConstProjectGenerator::Gen(const Row& parameter) {
     return CoreAPI::RowConstProject(fn_, parameter, false);
@@ -3238,33 +4352,6 @@ WindowUnionGenerator::PartitionEach(
     }
     return union_partitions;
 }
-int32_t IteratorStatus::PickIteratorWithMininumKey(
-    std::vector<IteratorStatus>* status_list_ptr) {
-    const auto& status_list = *status_list_ptr;
-    int32_t min_union_pos = -1;
-    uint64_t min_union_order = UINT64_MAX;
-    for (size_t i = 0; i < status_list.size(); i++) {
-        if (status_list[i].is_valid_ && status_list[i].key_ < min_union_order) {
-            min_union_order = status_list[i].key_;
-            min_union_pos = static_cast<int32_t>(i);
-        }
-    }
-    return min_union_pos;
-}
-int32_t IteratorStatus::PickIteratorWithMaximizeKey(
-    std::vector<IteratorStatus>* status_list_ptr) {
-    const auto& status_list = *status_list_ptr;
-    int32_t min_union_pos = -1;
-    uint64_t min_union_order = 0;
-    for (size_t i = 0; i < status_list.size(); i++) {
-        if (status_list[i].is_valid_ &&
-            status_list[i].key_ >= min_union_order) {
-            min_union_order = status_list[i].key_;
-            min_union_pos = static_cast<int32_t>(i);
-        }
-    }
-    return min_union_pos;
-}
 std::vector<std::shared_ptr<DataHandler>> WindowJoinGenerator::RunInputs(
     RunnerContext& ctx) {
     std::vector<std::shared_ptr<DataHandler>> union_inputs;
@@ -3365,7 +4452,12 @@ std::shared_ptr<TableHandler> IndexSeekGenerator::SegmentOfKey(
 
 std::shared_ptr<TableHandler> FilterGenerator::Filter(
     std::shared_ptr<PartitionHandler> table, const Row& parameter) {
-    return Filter(index_seek_gen_.SegmnetOfConstKey(parameter, table), parameter);
+    auto segment = index_seek_gen_.SegmnetOfConstKey(parameter, table);
+    if (segment && row_predicate_ && condition_gen_.Valid() &&
+        row_predicate_->IsSchemaOf(segment->GetSchema())) {
+        segment->SetRowPredicate(row_predicate_);
+    }
+    return Filter(segment, parameter);
 }
 std::shared_ptr<TableHandler> FilterGenerator::Filter(
     std::shared_ptr<TableHandler> table,
@@ -3382,33 +4474,177 @@ std::shared_ptr<TableHandler> FilterGenerator::Filter(
     return std::shared_ptr<TableHandler>(new TableFilterWrapper(table, parameter, this));
 }
 
+void RunnerContext::InitCache() {
+    if (cluster_job_ != nullptr) {
+        cache_.resize(cluster_job_->runner_cnt());
+        window_cache_.resize(cluster_job_->shared_window_cnt());
+        if (!requests_.empty()) {
+            batch_cache_.resize(cluster_job_->runner_cnt());
+        }
+    }
+}
+
+void RunnerContext::ClearCache() {
+    // keep the entries of the runners for the next run
+    for (auto& entry : cache_) {
+        entry = CacheEntry();
+    }
+    for (auto& entry : window_cache_) {
+        entry = CacheEntry();
+    }
+}
+
+RunnerContext::CacheEntry& RunnerContext::GetCacheEntry(int64_t id) {
+    auto& cache = id < 0 ? window_cache_ : cache_;
+    size_t pos = id < 0 ? static_cast<size_t>(-1 - id)
+                        : static_cast<size_t>(id);
+    if (pos >= cache.size()) {
+        cache.resize(pos + 1);
+    }
+    return cache[pos];
+}
+
 std::shared_ptr<DataHandlerList> RunnerContext::GetBatchCache(
     int64_t id) const {
-    auto iter = batch_cache_.find(id);
-    if (iter == batch_cache_.end()) {
+    if (id < 0 || static_cast<size_t>(id) >= batch_cache_.size()) {
         return std::shared_ptr<DataHandlerList>();
-    } else {
-        return iter->second;
     }
+    return batch_cache_[id];
 }
 
 void RunnerContext::SetBatchCache(int64_t id,
                                   std::shared_ptr<DataHandlerList> data) {
+    if (static_cast<size_t>(id) >= batch_cache_.size()) {
+        batch_cache_.resize(id + 1);
+    }
     batch_cache_[id] = data;
 }
 
-std::shared_ptr<DataHandler> RunnerContext::GetCache(int64_t id) const {
-    auto iter = cache_.find(id);
-    if (iter == cache_.end()) {
-        return std::shared_ptr<DataHandler>();
-    } else {
-        return iter->second;
-    }
+std::shared_ptr<DataHandler> RunnerContext::GetCache(int64_t id) {
+    if (branch_thread_num_ <= 1) {
+        return GetCacheEntry(id).data;
+    }
+    std::unique_lock<std::mutex> lock(cache_mu_);
+    // the runners form a dag, so a running id never waits for the thread
+    // waiting for it, the entry is looked up again after the wait since the
+    // cache may grow meanwhile
+    cache_cv_.wait(lock, [this, id]() { return !GetCacheEntry(id).running; });
+    auto& entry = GetCacheEntry(id);
+    if (entry.data) {
+        return entry.data;
+    }
+    entry.running = true;
+    return std::shared_ptr<DataHandler>();
 }
 
 void RunnerContext::SetCache(int64_t id,
                              const std::shared_ptr<DataHandler> data) {
-    cache_[id] = data;
+    if (branch_thread_num_ <= 1) {
+        GetCacheEntry(id).data = data;
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(cache_mu_);
+        auto& entry = GetCacheEntry(id);
+        entry.data = data;
+        entry.running = false;
+    }
+    cache_cv_.notify_all();
+}
+
+bool RunnerContext::IsExpired() {
+    if (deadline_us_ == 0) {
+        return false;
+    }
+    if (expired_.load(std::memory_order_relaxed)) {
+        return true;
+    }
+    uint64_t now = std::chrono::duration_cast<std::chrono::microseconds>(
+                       std::chrono::system_clock::now().time_since_epoch())
+                       .count();
+    if (now < deadline_us_) {
+        return false;
+    }
+    expired_.store(true, std::memory_order_relaxed);
+    return true;
+}
+
+void RunnerContext::AddTrace(int64_t id, const std::string& name,
+                             uint64_t time_us) {
+    std::lock_guard<std::mutex> lock(trace_mu_);
+    traces_.push_back({id, name, time_us});
+}
+
+std::vector<RunnerTrace> RunnerContext::GetTraces() {
+    std::lock_guard<std::mutex> lock(trace_mu_);
+    return traces_;
+}
+
+void RunnerContext::SetBranchThreadNum(uint32_t num) {
+    branch_thread_num_ = num;
+    free_branch_threads_.store(num > 1 ? static_cast<int32_t>(num - 1) : 0,
+                               std::memory_order_relaxed);
+}
+
+bool RunnerContext::AcquireBranchThread() {
+    if (free_branch_threads_.fetch_sub(1, std::memory_order_relaxed) > 0) {
+        return true;
+    }
+    free_branch_threads_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+void RunnerContext::ReleaseBranchThread() {
+    free_branch_threads_.fetch_add(1, std::memory_order_relaxed);
+}
+
+static void PrintRunnerStats(std::ostream& output, const Runner* runner,
+                             std::set<int32_t>* visited_ids) {
+    if (runner == nullptr || !visited_ids->insert(runner->id_).second) {
+        return;
+    }
+    auto stats = runner->stats();
+    if (stats != nullptr) {
+        uint64_t run_cnt = stats->run_cnt.load(std::memory_order_relaxed);
+        uint64_t counted_run_cnt =
+            stats->counted_run_cnt.load(std::memory_order_relaxed);
+        output << "[" << runner->id_ << "]" << RunnerTypeName(runner->type_)
+               << " node=" << runner->plan_node_id() << " runs=" << run_cnt
+               << " time_us="
+               << stats->time_us.load(std::memory_order_relaxed);
+        if (counted_run_cnt > 0) {
+            output << " rows=" << stats->row_cnt.load(std::memory_order_relaxed)
+                   << " counted_runs=" << counted_run_cnt;
+        }
+        output << "\n";
+    }
+    for (auto producer : runner->GetProducers()) {
+        PrintRunnerStats(output, producer, visited_ids);
+    }
+}
+
+void ClusterJob::PrintStats(std::ostream& output) const {
+    std::set<int32_t> visited_ids;
+    for (const auto& task : tasks_) {
+        PrintRunnerStats(output, task.GetRoot(), &visited_ids);
+    }
+}
+
+static void ResetRunnerStats(Runner* runner, std::set<int32_t>* visited_ids) {
+    if (runner == nullptr || !visited_ids->insert(runner->id_).second) {
+        return;
+    }
+    runner->ResetStats();
+    for (auto producer : runner->GetProducers()) {
+        ResetRunnerStats(producer, visited_ids);
+    }
+}
+
+void ClusterJob::ResetStats() {
+    std::set<int32_t> visited_ids;
+    for (auto& task : tasks_) {
+        ResetRunnerStats(task.GetRoot(), &visited_ids);
+    }
 }
 
 void RunnerContext::SetRequest(const hybridse::codec::Row& request) {
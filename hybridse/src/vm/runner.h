@@ -17,10 +17,14 @@
 #ifndef SRC_VM_RUNNER_H_
 #define SRC_VM_RUNNER_H_
 
+#include <atomic>
+#include <condition_variable>  // NOLINT
 #include <map>
 #include <memory>
+#include <mutex>  // NOLINT
 #include <set>
 #include <string>
+#include <tuple>
 #include <unordered_map>
 #include <utility>
 #include <vector>
@@ -30,8 +34,10 @@
 #include "vm/catalog.h"
 #include "vm/catalog_wrapper.h"
 #include "vm/core_api.h"
+#include "vm/engine_context.h"
 #include "vm/mem_catalog.h"
 #include "vm/physical_op.h"
+#include "vm/row_predicate.h"
 namespace hybridse {
 namespace vm {
 
@@ -80,6 +86,8 @@ class ProjectGenerator : public FnGenerator {
         : FnGenerator(info), fun_(info.fn_ptr()) {}
     virtual ~ProjectGenerator() {}
     const Row Gen(const Row& row, const Row& parameter);
+    // project a batch of rows in one run step, the results are appended to outputs
+    void GenBatch(const std::vector<Row>& rows, const Row& parameter, std::vector<Row>* outputs);
     RowProjectFun fun_;
 };
 
@@ -115,7 +123,7 @@ class OrderGenerator : public FnGenerator {
  public:
     explicit OrderGenerator(const FnInfo& info) : FnGenerator(info) {}
     virtual ~OrderGenerator() {}
-    const int64_t Gen(const Row& row);
+    const int64_t Gen(const Row& row) const;
 };
 class ConditionGenerator : public FnGenerator {
  public:
@@ -199,12 +207,17 @@ class PartitionGenerator {
     virtual ~PartitionGenerator() {}
 
     const bool Valid() const { return key_gen_.Valid(); }
+    // the rows partitioned are charged to the memory budget of ctx, and
+    // spilled beyond it
     std::shared_ptr<PartitionHandler> Partition(
-        std::shared_ptr<DataHandler> input, const Row& parameter);
+        std::shared_ptr<DataHandler> input, const Row& parameter,
+        RunnerContext* ctx = nullptr);
     std::shared_ptr<PartitionHandler> Partition(
-        std::shared_ptr<PartitionHandler> table, const Row& parameter);
+        std::shared_ptr<PartitionHandler> table, const Row& parameter,
+        RunnerContext* ctx = nullptr);
     std::shared_ptr<PartitionHandler> Partition(
-        std::shared_ptr<TableHandler> table, const Row& parameter);
+        std::shared_ptr<TableHandler> table, const Row& parameter,
+        RunnerContext* ctx = nullptr);
     const std::string GetKey(const Row& row, const Row& parameter) { return key_gen_.Gen(row, parameter); }
 
  private:
@@ -219,14 +232,24 @@ class SortGenerator {
     virtual ~SortGenerator() {}
 
     const bool Valid() const { return is_valid_; }
+    const bool is_asc() const { return is_asc_; }
 
+    // the rows sorted are charged to the memory budget of ctx, and spilled
+    // beyond it. The spilled partitions are sorted bucket by bucket as they
+    // are read
     std::shared_ptr<DataHandler> Sort(std::shared_ptr<DataHandler> input,
-                                      const bool reverse = false);
+                                      const bool reverse = false,
+                                      RunnerContext* ctx = nullptr);
     std::shared_ptr<PartitionHandler> Sort(
         std::shared_ptr<PartitionHandler> partition,
-        const bool reverse = false);
+        const bool reverse = false, RunnerContext* ctx = nullptr);
     std::shared_ptr<TableHandler> Sort(std::shared_ptr<TableHandler> table,
-                                       const bool reverse = false);
+                                       const bool reverse = false,
+                                       RunnerContext* ctx = nullptr);
+    // the first `k` rows of the sorted table, selected with a heap of `k`
+    // rows instead of sorting the whole table
+    std::shared_ptr<TableHandler> TopK(std::shared_ptr<TableHandler> table,
+                                       size_t k);
     const OrderGenerator& order_gen() const { return order_gen_; }
 
  private:
@@ -245,6 +268,9 @@ class IndexSeekGenerator {
         std::shared_ptr<DataHandler> input);
     std::shared_ptr<TableHandler> SegmentOfKey(
         const Row& row, const Row& parameter, std::shared_ptr<DataHandler> input);
+    const std::string GetKey(const Row& row, const Row& parameter) {
+        return index_key_gen_.Valid() ? index_key_gen_.Gen(row, parameter) : "";
+    }
     const bool Valid() const { return index_key_gen_.Valid(); }
 
  private:
@@ -253,9 +279,12 @@ class IndexSeekGenerator {
 
 class FilterGenerator : public PredicateFun {
  public:
-    explicit FilterGenerator(const Filter& filter)
+    explicit FilterGenerator(const Filter& filter,
+                             const SchemasContext* input_schema = nullptr)
         : condition_gen_(filter.condition_.fn_info()),
-          index_seek_gen_(filter.index_key_) {}
+          index_seek_gen_(filter.index_key_),
+          row_predicate_(ColumnPredicate::Build(filter.condition_.condition(),
+                                                input_schema)) {}
 
     const bool Valid() const {
         return index_seek_gen_.Valid() || condition_gen_.Valid();
@@ -274,6 +303,8 @@ class FilterGenerator : public PredicateFun {
  private:
     ConditionGenerator condition_gen_;
     IndexSeekGenerator index_seek_gen_;
+    // the simple conjuncts of the condition evaluated by the storage
+    std::shared_ptr<ColumnPredicate> row_predicate_;
 };
 class WindowGenerator {
  public:
@@ -314,6 +345,12 @@ class RequestWindowGenertor {
         }
         return segment;
     }
+    // the rows with the same key share the segment of the same input
+    const std::string GetRequestWindowKey(const Row& row, const Row& parameter) {
+        std::string index_key = index_seek_gen_.GetKey(row, parameter);
+        return std::to_string(index_key.size()) + ":" + index_key +
+               filter_gen_.GetKey(row, parameter);
+    }
     RequestWindowOp window_op_;
     FilterKeyGenerator filter_gen_;
     SortGenerator sort_gen_;
@@ -397,6 +434,23 @@ inline const std::string RunnerTypeName(const RunnerType& type) {
             return "UNKNOW";
     }
 }
+/// \brief The runtime statistics of a runner accumulated over the runs of
+/// its compiled plan.
+struct RunnerStats {
+    std::atomic<uint64_t> run_cnt{0};
+    std::atomic<uint64_t> time_us{0};
+    // the runs whose output rows are counted and the rows they output, the
+    // rows of the lazy tables are not counted
+    std::atomic<uint64_t> counted_run_cnt{0};
+    std::atomic<uint64_t> row_cnt{0};
+
+    void Reset() {
+        run_cnt.store(0, std::memory_order_relaxed);
+        time_us.store(0, std::memory_order_relaxed);
+        counted_run_cnt.store(0, std::memory_order_relaxed);
+        row_cnt.store(0, std::memory_order_relaxed);
+    }
+};
 class Runner : public node::NodeBase<Runner> {
  public:
     explicit Runner(const int32_t id)
@@ -404,8 +458,11 @@ class Runner : public node::NodeBase<Runner> {
           type_(kRunnerUnknow),
           limit_cnt_(0),
           is_lazy_(false),
+          is_parallel_producers_(false),
           need_cache_(false),
           need_batch_cache_(false),
+          plan_node_id_(-1),
+          stats_(nullptr),
           producers_(),
           output_schemas_() {}
     Runner(const int32_t id, const RunnerType type,
@@ -414,8 +471,11 @@ class Runner : public node::NodeBase<Runner> {
           type_(type),
           limit_cnt_(0),
           is_lazy_(false),
+          is_parallel_producers_(false),
           need_cache_(false),
           need_batch_cache_(false),
+          plan_node_id_(-1),
+          stats_(nullptr),
           producers_(),
           output_schemas_(output_schemas) {}
     Runner(const int32_t id, const RunnerType type,
@@ -424,8 +484,11 @@ class Runner : public node::NodeBase<Runner> {
           type_(type),
           limit_cnt_(limit_cnt),
           is_lazy_(false),
+          is_parallel_producers_(false),
           need_cache_(false),
           need_batch_cache_(false),
+          plan_node_id_(-1),
+          stats_(nullptr),
           producers_(),
           output_schemas_(output_schemas) {}
     virtual ~Runner() {}
@@ -471,6 +534,23 @@ class Runner : public node::NodeBase<Runner> {
     void DisableCache() { need_cache_ = false; }
     void EnableBatchCache() { need_batch_cache_ = true; }
     void DisableBatchCache() { need_batch_cache_ = false; }
+    /// Record the runs of the runner into its stats.
+    void EnableStats() {
+        if (!stats_) {
+            stats_ = std::make_shared<RunnerStats>();
+        }
+    }
+    /// Return the stats of the runner, or null if they are not recorded.
+    const RunnerStats* stats() const { return stats_.get(); }
+    /// Clear the stats recorded so far, the runs are still recorded.
+    void ResetStats() {
+        if (stats_) {
+            stats_->Reset();
+        }
+    }
+    /// Set the id of the physical node the runner is built from.
+    void SetPlanNodeId(int64_t id) { plan_node_id_ = id; }
+    const int64_t plan_node_id() const { return plan_node_id_; }
 
     const int32_t id_;
     const RunnerType type_;
@@ -482,6 +562,13 @@ class Runner : public node::NodeBase<Runner> {
         RunnerContext& ctx);  // NOLINT
     virtual std::shared_ptr<DataHandler> RunWithCache(
         RunnerContext& ctx);  // NOLINT
+    /// Run all the requests of a batch on the outputs of the producers at
+    /// once. Return null by default to run the requests one by one.
+    virtual std::shared_ptr<DataHandlerVector> RunBatchRequests(
+        RunnerContext& ctx,  // NOLINT
+        const std::vector<std::shared_ptr<DataHandlerList>>& batch_inputs) {
+        return std::shared_ptr<DataHandlerVector>();
+    }
 
     static int64_t GetColumnInt64(const int8_t* buf, const RowView* view,
                                   int pos, type::Type type);
@@ -531,6 +618,9 @@ class Runner : public node::NodeBase<Runner> {
 
  protected:
     bool is_lazy_;
+    // the producers are independent branches, which may run on different
+    // threads in request mode
+    bool is_parallel_producers_;
 
     void PrintCacheInfo(std::ostream& output) const {
         if (need_cache_ && need_batch_cache_) {
@@ -544,27 +634,18 @@ class Runner : public node::NodeBase<Runner> {
 
     bool need_cache_;
     bool need_batch_cache_;
+    // the id of the physical node, -1 if the runner is not built from one
+    int64_t plan_node_id_;
+    std::shared_ptr<RunnerStats> stats_;
     std::vector<Runner*> producers_;
     const vm::SchemasContext* output_schemas_;
-};
 
-class IteratorStatus {
- public:
-    IteratorStatus() : is_valid_(false), key_(0) {}
-    explicit IteratorStatus(uint64_t key) : is_valid_(true), key_(key) {}
-    virtual ~IteratorStatus() {}
-    static int32_t PickIteratorWithMininumKey(
-        std::vector<IteratorStatus>* status_list_ptr);
-    static int32_t PickIteratorWithMaximizeKey(
-        std::vector<IteratorStatus>* status_list_ptr);
-    void MarkInValid() {
-        is_valid_ = false;
-        key_ = 0;
-    }
-    void set_key(uint64_t key) { key_ = key; }
-    bool is_valid_;
-    uint64_t key_;
-};  // namespace vm
+ private:
+    void RunProducers(RunnerContext& ctx,  // NOLINT
+                      std::vector<std::shared_ptr<DataHandler>>* inputs);
+    void RecordStats(const std::shared_ptr<DataHandler>& output,
+                     uint64_t time_us);
+};
 
 class InputsGenerator {
  public:
@@ -595,6 +676,13 @@ class WindowUnionGenerator : public InputsGenerator {
     std::vector<WindowGenerator> windows_gen_;
 };
 
+// the segments of the request windows shared by the rows of a batch, keyed
+// by the union position, the input and the segment key. The input is held
+// by the entry, so its address is not reused while the entry lives.
+typedef std::map<std::tuple<size_t, const DataHandler*, std::string>,
+                 std::pair<std::shared_ptr<DataHandler>,
+                           std::shared_ptr<TableHandler>>>
+    RequestWindowCache;
 class RequestWindowUnionGenerator : public InputsGenerator {
  public:
     RequestWindowUnionGenerator() : InputsGenerator() {}
@@ -608,18 +696,67 @@ class RequestWindowUnionGenerator : public InputsGenerator {
     }
     std::vector<std::shared_ptr<TableHandler>> GetRequestWindows(
         const Row& row, const Row& parameter,
-        std::vector<std::shared_ptr<DataHandler>> union_inputs) {
+        std::vector<std::shared_ptr<DataHandler>> union_inputs,
+        RequestWindowCache* window_cache = nullptr) {
         std::vector<std::shared_ptr<TableHandler>> union_segments(inputs_cnt_);
         if (!windows_gen_.empty()) {
             for (size_t i = 0; i < inputs_cnt_; i++) {
-                union_segments[i] =
-                    windows_gen_[i].GetRequestWindow(row, parameter, union_inputs[i]);
+                if (nullptr == window_cache) {
+                    union_segments[i] = windows_gen_[i].GetRequestWindow(
+                        row, parameter, union_inputs[i]);
+                    continue;
+                }
+                auto key = std::make_tuple(
+                    i, union_inputs[i].get(),
+                    windows_gen_[i].GetRequestWindowKey(row, parameter));
+                auto iter = window_cache->find(key);
+                if (iter == window_cache->end()) {
+                    auto segment = windows_gen_[i].GetRequestWindow(
+                        row, parameter, union_inputs[i]);
+                    iter = window_cache
+                               ->emplace(key, std::make_pair(union_inputs[i],
+                                                             segment))
+                               .first;
+                }
+                union_segments[i] = iter->second.second;
             }
         }
         return union_segments;
     }
     std::vector<RequestWindowGenertor> windows_gen_;
 };
+// An open addressing hash table from the join keys of the right table to
+// their last rows under the join order. A last join probes it instead of
+// partitioning and sorting the right table.
+class LastJoinHashTable {
+ public:
+    // `order_direction` is `1` to keep the row with the max order of a key,
+    // `-1` for the min order and `0` for the first row of the key
+    explicit LastJoinHashTable(int order_direction)
+        : order_direction_(order_direction), mask_(0), slots_(), entries_() {}
+    ~LastJoinHashTable() {}
+    void Put(const std::string& key, int64_t order, const Row& row);
+    // return null if the key is missing
+    const Row* Get(const std::string& key) const;
+    size_t GetSize() const { return entries_.size(); }
+
+ private:
+    struct Entry {
+        uint64_t hash;
+        std::string key;
+        int64_t order;
+        Row row;
+    };
+    size_t FindSlot(uint64_t hash, const std::string& key) const;
+    void Grow();
+
+    const int order_direction_;
+    size_t mask_;
+    // the positions of the entries, -1 for empty slots
+    std::vector<int32_t> slots_;
+    std::vector<Entry> entries_;
+};
+
 class JoinGenerator {
  public:
     explicit JoinGenerator(const Join& join, size_t left_slices,
@@ -647,8 +784,25 @@ class JoinGenerator {
                        const Row& parameter,
                        std::shared_ptr<MemPartitionHandler>);  // NOLINT
 
+    // the right table has no index for the join keys and no other condition
+    // applies, so the last rows of the right keys can be hashed in one scan
+    bool IsHashJoin(std::shared_ptr<DataHandler> right) const;
+    bool TableHashJoin(std::shared_ptr<TableHandler> left, std::shared_ptr<TableHandler> right,
+                       const Row& parameter,
+                       std::shared_ptr<MemTimeTableHandler> output);  // NOLINT
+    bool PartitionHashJoin(std::shared_ptr<PartitionHandler> left,
+                           std::shared_ptr<TableHandler> right,
+                           const Row& parameter,
+                           std::shared_ptr<MemPartitionHandler> output);  // NOLINT
+
     Row RowLastJoin(const Row& left_row, std::shared_ptr<DataHandler> right, const Row& parameter);
     Row RowLastJoinDropLeftSlices(const Row& left_row, std::shared_ptr<DataHandler> right, const Row& parameter);
+    // join the rows with the segments of their keys, the segments are got
+    // together in the order of the keys and once per key
+    bool RowLastJoinBatch(const std::vector<Row>& left_rows,
+                          std::shared_ptr<PartitionHandler> partition,
+                          const Row& parameter, bool drop_left_slices,
+                          std::vector<Row>* output);
     ConditionGenerator condition_gen_;
     KeyGenerator left_key_gen_;
     PartitionGenerator right_group_gen_;
@@ -663,6 +817,11 @@ class JoinGenerator {
     Row RowLastJoinTable(const Row& left_row,
                          std::shared_ptr<TableHandler> table,
                          const Row& parameter);
+    Row DropLeftSlices(const Row& joined) const;
+    bool BuildHashTable(std::shared_ptr<TableHandler> right,
+                        const Row& parameter, LastJoinHashTable* hash_table);
+    Row RowHashJoin(const Row& left_row, const LastJoinHashTable& hash_table,
+                    const Row& parameter);
 
     size_t left_slices_;
     size_t right_slices_;
@@ -725,8 +884,10 @@ class GroupRunner : public Runner {
 class FilterRunner : public Runner {
  public:
     FilterRunner(const int32_t id, const SchemasContext* schema,
-                 const int32_t limit_cnt, const Filter& filter)
-        : Runner(id, kRunnerFilter, schema, limit_cnt), filter_gen_(filter) {
+                 const int32_t limit_cnt, const Filter& filter,
+                 const SchemasContext* input_schema = nullptr)
+        : Runner(id, kRunnerFilter, schema, limit_cnt),
+          filter_gen_(filter, input_schema) {
         is_lazy_ = true;
     }
     ~FilterRunner() {}
@@ -775,7 +936,16 @@ class TableProjectRunner : public Runner {
         RunnerContext& ctx,  // NOLINT
         const std::vector<std::shared_ptr<DataHandler>>& inputs)
         override;  // NOLINT
+    // project the parts of the table on thread_num threads in batch mode
+    void set_thread_num(uint32_t thread_num) { thread_num_ = thread_num; }
     ProjectGenerator project_gen_;
+
+ private:
+    // project the rows of the table into the output, at most limit_cnt rows
+    // if limit_cnt is positive
+    bool Project(std::shared_ptr<TableHandler> table, const Row& parameter,
+                 int32_t limit_cnt, MemTableHandler* output);
+    uint32_t thread_num_ = 1;
 };
 class RowProjectRunner : public Runner {
  public:
@@ -839,12 +1009,14 @@ class SelectSliceRunner : public Runner {
 
 class GroupAggRunner : public Runner {
  public:
+    // the input is grouped by the runner itself if `input_group` is valid
     GroupAggRunner(const int32_t id, const SchemasContext* schema,
                    const int32_t limit_cnt, const Key& group,
-                   const FnInfo& project)
+                   const FnInfo& project, const Key& input_group = Key())
         : Runner(id, kRunnerGroupAgg, schema, limit_cnt),
           group_(group.fn_info()),
-          agg_gen_(project) {}
+          agg_gen_(project),
+          input_group_gen_(input_group) {}
     ~GroupAggRunner() {}
     std::shared_ptr<DataHandler> Run(
         RunnerContext& ctx,  // NOLINT
@@ -852,6 +1024,15 @@ class GroupAggRunner : public Runner {
         override;  // NOLINT
     KeyGenerator group_;
     AggGenerator agg_gen_;
+    PartitionGenerator input_group_gen_;
+
+ private:
+    std::shared_ptr<TableHandler> HashAggregate(
+        RunnerContext& ctx,  // NOLINT
+        std::shared_ptr<TableHandler> table);
+    std::shared_ptr<TableHandler> Aggregate(
+        RunnerContext& ctx,  // NOLINT
+        std::shared_ptr<PartitionHandler> partition);
 };
 class AggRunner : public Runner {
  public:
@@ -888,6 +1069,11 @@ class WindowAggRunner : public Runner {
     void AddWindowUnion(const WindowOp& window, Runner* runner) {
         windows_union_gen_.AddWindowUnion(window, runner);
     }
+    // run the partition keys on thread_num threads in batch mode
+    void set_thread_num(uint32_t thread_num) { thread_num_ = thread_num; }
+    // split the keys of split_rows rows at least into the time ranges run on
+    // the threads, 0 to run every key on one thread
+    void set_split_rows(uint32_t split_rows) { split_rows_ = split_rows; }
     std::shared_ptr<DataHandler> Run(
         RunnerContext& ctx,  // NOLINT
         const std::vector<std::shared_ptr<DataHandler>>& inputs)
@@ -899,16 +1085,50 @@ class WindowAggRunner : public Runner {
         std::vector<std::shared_ptr<DataHandler>> joins, const std::string& key,
         std::shared_ptr<MemTableHandler> output_table);
 
+    // the rows of a segment in the window order
+    struct OrderedRows {
+        std::vector<uint64_t> keys;
+        std::vector<Row> rows;
+    };
+    // Run the key split into the time ranges on the threads, return false
+    // if the key can not be split so that it runs serially
+    bool RunSplitWindowAgg(
+        const Row& parameter, std::shared_ptr<TableHandler> instance_segment,
+        const std::vector<std::shared_ptr<PartitionHandler>>& union_partitions,
+        const std::vector<std::shared_ptr<DataHandler>>& joins,
+        const std::string& key, std::shared_ptr<MemTableHandler> output_table);
+    // the order key from which the rows are replayed into the window first,
+    // so that the window of the instance row begin is the one of the serial
+    // run
+    uint64_t GetReplayKey(const OrderedRows& instances, size_t begin) const;
+    // run the instance rows [begin, end) after the rows since replay_key
+    void RunWindowAggOnRange(
+        const Row& parameter, const OrderedRows& instances,
+        const std::vector<OrderedRows>& unions,
+        const std::vector<std::shared_ptr<DataHandler>>& joins,
+        uint64_t replay_key, size_t begin, size_t end,
+        MemTableHandler* output_table);
+
     const bool instance_not_in_window_;
     const bool exclude_current_time_;
     const bool need_append_input_;
     const size_t append_slices_;
+    uint32_t thread_num_ = 1;
+    uint32_t split_rows_ = 0;
     WindowGenerator instance_window_gen_;
     WindowUnionGenerator windows_union_gen_;
     WindowJoinGenerator windows_join_gen_;
     WindowProjectGenerator window_project_gen_;
 };
 
+// the request unions of the windows differing only in the frames scan the
+// window of the merged frame once, and take their own frames from it
+struct SharedRequestWindow {
+    int64_t id;
+    WindowRange window_range;
+    uint32_t member_cnt;
+};
+
 class RequestUnionRunner : public Runner {
  public:
     RequestUnionRunner(const int32_t id, const SchemasContext* schema,
@@ -917,24 +1137,49 @@ class RequestUnionRunner : public Runner {
         : Runner(id, kRunnerRequestUnion, schema, limit_cnt),
           range_gen_(range),
           exclude_current_time_(exclude_current_time),
-          output_request_row_(output_request_row) {}
+          output_request_row_(output_request_row),
+          column_mask_(),
+          column_mask_disabled_(false) {}
 
     std::shared_ptr<DataHandler> Run(
         RunnerContext& ctx,  // NOLINT
         const std::vector<std::shared_ptr<DataHandler>>& inputs)
         override;  // NOLINT
+    // the rows of the batch with the same window keys share the segments
+    std::shared_ptr<DataHandlerList> BatchRequestRun(
+        RunnerContext& ctx) override;  // NOLINT
     static std::shared_ptr<TableHandler> RequestUnionWindow(
         const Row& request,
         std::vector<std::shared_ptr<TableHandler>> union_segments,
         int64_t request_ts, const WindowRange& window_range,
-        const bool output_request_row, const bool exclude_current_time);
+        const bool output_request_row, const bool exclude_current_time,
+        RunnerContext* ctx = nullptr);
     void AddWindowUnion(const RequestWindowOp& window, Runner* runner) {
         windows_union_gen_.AddWindowUnion(window, runner);
     }
+    void SetSharedWindow(const std::shared_ptr<SharedRequestWindow>& shared) {
+        shared_window_ = shared;
+    }
+    // add the columns of the window rows read by a consumer, only the
+    // columns added are decoded from the storage
+    void AddColumnMask(const std::vector<bool>& mask);
+    // all the columns are decoded once the window is read by a consumer not
+    // adding its columns
+    void DisableColumnMask() { column_mask_disabled_ = true; }
     RequestWindowUnionGenerator windows_union_gen_;
     RangeGenerator range_gen_;
     bool exclude_current_time_;
     bool output_request_row_;
+    std::shared_ptr<SharedRequestWindow> shared_window_;
+
+ private:
+    std::shared_ptr<const std::vector<bool>> column_mask_;
+    bool column_mask_disabled_;
+
+    std::shared_ptr<DataHandler> RunRequest(
+        RunnerContext& ctx,  // NOLINT
+        const std::vector<std::shared_ptr<DataHandler>>& inputs,
+        RequestWindowCache* window_cache);
 };
 
 class PostRequestUnionRunner : public Runner {
@@ -981,6 +1226,10 @@ class RequestLastJoinRunner : public Runner {
     std::shared_ptr<DataHandler> Run(
         RunnerContext& ctx,                                        // NOLINT
         const std::vector<std::shared_ptr<DataHandler>>& inputs);  // NOLINT
+    std::shared_ptr<DataHandlerVector> RunBatchRequests(
+        RunnerContext& ctx,  // NOLINT
+        const std::vector<std::shared_ptr<DataHandlerList>>& batch_inputs)
+        override;
     virtual void PrintRunnerInfo(std::ostream& output,
                                  const std::string& tab) const {
         output << tab << "[" << id_ << "]" << RunnerTypeName(type_);
@@ -1000,6 +1249,7 @@ class ConcatRunner : public Runner {
                  const int32_t limit_cnt)
         : Runner(id, kRunnerConcat, schema, limit_cnt) {
         is_lazy_ = true;
+        is_parallel_producers_ = true;
     }
     ~ConcatRunner() {}
     std::shared_ptr<DataHandler> Run(
@@ -1262,13 +1512,20 @@ class ClusterTask {
 class ClusterJob {
  public:
     ClusterJob()
-        : tasks_(), main_task_id_(-1), sql_(""), common_column_indices_() {}
+        : tasks_(),
+          main_task_id_(-1),
+          sql_(""),
+          common_column_indices_(),
+          runner_cnt_(0),
+          shared_window_cnt_(0) {}
     explicit ClusterJob(const std::string& sql,
                         const std::set<size_t>& common_column_indices)
         : tasks_(),
           main_task_id_(-1),
           sql_(sql),
-          common_column_indices_(common_column_indices) {}
+          common_column_indices_(common_column_indices),
+          runner_cnt_(0),
+          shared_window_cnt_(0) {}
     ClusterTask GetTask(int32_t id) {
         if (id < 0 || id >= static_cast<int32_t>(tasks_.size())) {
             LOG(WARNING) << "fail get task: task " << id << " not exist";
@@ -1297,7 +1554,19 @@ class ClusterJob {
     }
 
     void AddMainTask(const ClusterTask& task) { main_task_id_ = AddTask(task); }
-    void Reset() { tasks_.clear(); }
+    void Reset() {
+        tasks_.clear();
+        runner_cnt_ = 0;
+        shared_window_cnt_ = 0;
+    }
+    // the runners are numbered from 0 and the shared windows from -1 down,
+    // so the caches of a run are sized by the counts
+    void SetCacheSize(size_t runner_cnt, size_t shared_window_cnt) {
+        runner_cnt_ = runner_cnt;
+        shared_window_cnt_ = shared_window_cnt;
+    }
+    size_t runner_cnt() const { return runner_cnt_; }
+    size_t shared_window_cnt() const { return shared_window_cnt_; }
     const size_t GetTaskSize() const { return tasks_.size(); }
     const bool IsValid() const { return !tasks_.empty(); }
     const int32_t main_task_id() const { return main_task_id_; }
@@ -1321,12 +1590,19 @@ class ClusterJob {
         return common_column_indices_;
     }
     void Print() const { this->Print(std::cout, "    "); }
+    /// Print the stats of the runners of the tasks, one line per runner with
+    /// the stats recorded.
+    void PrintStats(std::ostream& output) const;
+    /// Clear the stats of the runners of the tasks.
+    void ResetStats();
 
  private:
     std::vector<ClusterTask> tasks_;
     int32_t main_task_id_;
     std::string sql_;
     std::set<size_t> common_column_indices_;
+    size_t runner_cnt_;
+    size_t shared_window_cnt_;
 };
 class RunnerBuilder {
     enum TaskBiasType { kLeftBias, kRightBias, kNoBias };
@@ -1335,17 +1611,34 @@ class RunnerBuilder {
     explicit RunnerBuilder(node::NodeManager* nm, const std::string& sql,
                            bool support_cluster_optimized,
                            const std::set<size_t>& common_column_indices,
-                           const std::set<size_t>& batch_common_node_set)
+                           const std::set<size_t>& batch_common_node_set,
+                           uint32_t window_thread_num = 1,
+                           bool enable_stats = false)
         : nm_(nm),
           support_cluster_optimized_(support_cluster_optimized),
           id_(0),
           cluster_job_(sql, common_column_indices),
           task_map_(),
           proxy_runner_map_(),
-          batch_common_node_set_(batch_common_node_set) {}
+          batch_common_node_set_(batch_common_node_set),
+          window_thread_num_(window_thread_num),
+          window_split_rows_(0),
+          enable_stats_(enable_stats) {}
     virtual ~RunnerBuilder() {}
+    void set_window_split_rows(uint32_t rows) { window_split_rows_ = rows; }
+    // the request windows of the names are sampled to the sizes
+    void set_window_sample_sizes(
+        const std::map<std::string, uint64_t>& sizes) {
+        window_sample_sizes_ = sizes;
+    }
     ClusterTask RegisterTask(PhysicalOpNode* node, ClusterTask task) {
         task_map_[node] = task;
+        if (task.IsValid() && task.GetRoot()->plan_node_id() < 0) {
+            task.GetRoot()->SetPlanNodeId(node->node_id());
+            if (enable_stats_) {
+                task.GetRoot()->EnableStats();
+            }
+        }
         if (batch_common_node_set_.find(node->node_id()) !=
             batch_common_node_set_.end()) {
             task.GetRoot()->EnableBatchCache();
@@ -1358,6 +1651,7 @@ class RunnerBuilder {
                                Status& status) {  // NOLINT
         id_ = 0;
         cluster_job_.Reset();
+        shared_windows_.clear();
         auto task =  // NOLINT whitespace/braces
             Build(node, status);
         if (!status.isOK()) {
@@ -1383,6 +1677,7 @@ class RunnerBuilder {
         } else {
             cluster_job_.AddMainTask(task);
         }
+        cluster_job_.SetCacheSize(id_, shared_windows_.size());
         return cluster_job_;
     }
 
@@ -1405,6 +1700,10 @@ class RunnerBuilder {
     std::unordered_map<hybridse::vm::Runner*, ::hybridse::vm::Runner*>
         proxy_runner_map_;
     std::set<size_t> batch_common_node_set_;
+    uint32_t window_thread_num_;
+    uint32_t window_split_rows_;
+    std::map<std::string, uint64_t> window_sample_sizes_;
+    bool enable_stats_;
     ClusterTask BinaryInherit(const ClusterTask& left, const ClusterTask& right,
                               Runner* runner, const Key& index_key,
                               const TaskBiasType bias = kNoBias);
@@ -1424,6 +1723,13 @@ class RunnerBuilder {
         std::string index);
     ClusterTask BuildRequestTask(RequestRunner* runner);
     ClusterTask UnaryInheritTask(const ClusterTask& input, Runner* runner);
+    void SetWindowColumnMask(const PhysicalProjectNode* op, Runner* input);
+    void ShareRequestWindow(const PhysicalRequestUnionNode* op,
+                            const Runner* left, const Runner* right,
+                            RequestUnionRunner* runner);
+    // the shared windows keyed by the inputs and the window without the frame
+    std::map<std::string, std::shared_ptr<SharedRequestWindow>>
+        shared_windows_;
 };
 
 class RunnerContext {
@@ -1437,7 +1743,11 @@ class RunnerContext {
           requests_(),
           parameter_(parameter),
           is_debug_(is_debug),
-          batch_cache_() {}
+          branch_thread_num_(1),
+          free_branch_threads_(0),
+          batch_cache_() {
+        InitCache();
+    }
     explicit RunnerContext(hybridse::vm::ClusterJob* cluster_job,
                            const hybridse::codec::Row& request,
                            const std::string& sp_name = "",
@@ -1448,7 +1758,11 @@ class RunnerContext {
           requests_(),
           parameter_(),
           is_debug_(is_debug),
-          batch_cache_() {}
+          branch_thread_num_(1),
+          free_branch_threads_(0),
+          batch_cache_() {
+        InitCache();
+    }
     explicit RunnerContext(hybridse::vm::ClusterJob* cluster_job,
                            const std::vector<Row>& request_batch,
                            const std::string& sp_name = "",
@@ -1459,7 +1773,11 @@ class RunnerContext {
           requests_(request_batch),
           parameter_(),
           is_debug_(is_debug),
-          batch_cache_() {}
+          branch_thread_num_(1),
+          free_branch_threads_(0),
+          batch_cache_() {
+        InitCache();
+    }
 
     const size_t GetRequestSize() const { return requests_.size(); }
     const hybridse::codec::Row& GetRequest() const { return request_; }
@@ -1473,12 +1791,74 @@ class RunnerContext {
     bool is_debug() const { return is_debug_; }
 
     const std::string& sp_name() { return sp_name_; }
-    std::shared_ptr<DataHandler> GetCache(int64_t id) const;
+    // with branch threads, a runner missing the cache is marked running until
+    // its output is set, then the other threads wait for it instead of
+    // running it again
+    std::shared_ptr<DataHandler> GetCache(int64_t id);
     void SetCache(int64_t id, std::shared_ptr<DataHandler> data);
-    void ClearCache() { cache_.clear(); }
+    void ClearCache();
+
+    // set the max threads to run the branches of the plan, including the
+    // thread calling run
+    void SetBranchThreadNum(uint32_t num);
+    uint32_t branch_thread_num() const { return branch_thread_num_; }
+    // take a thread to run a branch, return false if all of them are busy
+    bool AcquireBranchThread();
+    void ReleaseBranchThread();
     std::shared_ptr<DataHandlerList> GetBatchCache(int64_t id) const;
     void SetBatchCache(int64_t id, std::shared_ptr<DataHandlerList> data);
 
+    // the runners stop and return null once the deadline in the micros since the epoch is passed, 0 is
+    // no deadline
+    void SetDeadline(uint64_t deadline_us) { deadline_us_ = deadline_us; }
+    bool IsExpired();
+    bool is_expired() const { return expired_.load(std::memory_order_relaxed); }
+
+    // the runners record the time they take when the trace is enabled
+    void EnableTrace() { is_trace_ = true; }
+    bool is_trace() const { return is_trace_; }
+    void AddTrace(int64_t id, const std::string& name, uint64_t time_us);
+    std::vector<RunnerTrace> GetTraces();
+
+    // the rows kept by the runners are charged to the memory budget of the
+    // run, 0 is no budget. The rows beyond the budget are spilled to the
+    // files in spill_dir, or the runners stop and return null if it is empty
+    void SetMemoryBudget(uint64_t budget, const std::string& spill_dir) {
+        memory_budget_ = budget;
+        spill_dir_ = spill_dir;
+    }
+    uint64_t memory_budget() const { return memory_budget_; }
+    const std::string& spill_dir() const { return spill_dir_; }
+    // charge the bytes even if they are beyond the budget, return false then
+    bool ChargeMemory(uint64_t bytes) {
+        if (memory_budget_ == 0) {
+            return true;
+        }
+        return memory_used_.fetch_add(bytes, std::memory_order_relaxed) +
+                   bytes <=
+               memory_budget_;
+    }
+    void ReleaseMemory(uint64_t bytes) {
+        if (memory_budget_ > 0) {
+            memory_used_.fetch_sub(bytes, std::memory_order_relaxed);
+        }
+    }
+    uint64_t memory_used() const {
+        return memory_used_.load(std::memory_order_relaxed);
+    }
+    void AddSpillBytes(uint64_t bytes) {
+        spill_bytes_.fetch_add(bytes, std::memory_order_relaxed);
+    }
+    uint64_t spill_bytes() const {
+        return spill_bytes_.load(std::memory_order_relaxed);
+    }
+    void SetMemoryExceeded() {
+        memory_exceeded_.store(true, std::memory_order_relaxed);
+    }
+    bool is_memory_exceeded() const {
+        return memory_exceeded_.load(std::memory_order_relaxed);
+    }
+
  private:
     hybridse::vm::ClusterJob* cluster_job_;
     const std::string sp_name_;
@@ -1487,9 +1867,35 @@ class RunnerContext {
     hybridse::codec::Row parameter_;
     size_t idx_;
     const bool is_debug_;
-    // TODO(chenjing): optimize
-    std::map<int64_t, std::shared_ptr<DataHandler>> cache_;
-    std::map<int64_t, std::shared_ptr<DataHandlerList>> batch_cache_;
+    uint32_t branch_thread_num_;
+    std::atomic<int32_t> free_branch_threads_;
+    struct CacheEntry {
+        std::shared_ptr<DataHandler> data;
+        // the runner is run by a branch thread
+        bool running = false;
+    };
+    // size the caches by the runners of the job
+    void InitCache();
+    // the entry of the runner or the shared window of id, the caches grow
+    // for the ids beyond the job
+    CacheEntry& GetCacheEntry(int64_t id);
+
+    std::mutex cache_mu_;
+    std::condition_variable cache_cv_;
+    // indexed by the runner id, and by -1 - id for the shared windows
+    std::vector<CacheEntry> cache_;
+    std::vector<CacheEntry> window_cache_;
+    std::vector<std::shared_ptr<DataHandlerList>> batch_cache_;
+    uint64_t deadline_us_ = 0;
+    std::atomic<bool> expired_{false};
+    bool is_trace_ = false;
+    std::mutex trace_mu_;
+    std::vector<RunnerTrace> traces_;
+    uint64_t memory_budget_ = 0;
+    std::string spill_dir_;
+    std::atomic<uint64_t> memory_used_{0};
+    std::atomic<uint64_t> spill_bytes_{0};
+    std::atomic<bool> memory_exceeded_{false};
 };
 }  // namespace vm
 }  // namespace hybridse
@@ -14,8 +14,12 @@
  * limitations under the License.
  */
 
+#include <chrono>  // NOLINT
 #include <memory>
+#include <string>
+#include <thread>  // NOLINT
 #include <utility>
+#include <vector>
 #include "boost/algorithm/string.hpp"
 #include "case/sql_case.h"
 #include "gtest/gtest.h"
@@ -34,6 +38,7 @@
 #include "llvm/Transforms/Scalar/GVN.h"
 #include "plan/plan_api.h"
 #include "testing/test_base.h"
+#include "vm/row_predicate.h"
 #include "vm/sql_compiler.h"
 
 using namespace llvm;       // NOLINT
@@ -410,6 +415,281 @@ TEST_F(RunnerTest, RunnerPrintDataMemTimeTableTest) {
         LOG(INFO) << oss.str();
     }
 }
+TEST_F(RunnerTest, LastJoinHashTableTest) {
+    std::vector<std::string> values = {"a0", "a1", "a2", "b0", "b1"};
+    std::vector<Row> rows;
+    for (auto& value : values) {
+        rows.push_back(Row(value));
+    }
+    LastJoinHashTable max_table(1);
+    LastJoinHashTable min_table(-1);
+    LastJoinHashTable first_table(0);
+    std::vector<std::pair<std::string, int64_t>> puts = {
+        {"a", 5}, {"a", 9}, {"a", 1}, {"b", 3}, {"b", 3}};
+    for (size_t i = 0; i < puts.size(); i++) {
+        max_table.Put(puts[i].first, puts[i].second, rows[i]);
+        min_table.Put(puts[i].first, puts[i].second, rows[i]);
+        first_table.Put(puts[i].first, puts[i].second, rows[i]);
+    }
+    ASSERT_EQ(2u, max_table.GetSize());
+    ASSERT_EQ("a1", max_table.Get("a")->ToString());
+    ASSERT_EQ("a2", min_table.Get("a")->ToString());
+    ASSERT_EQ("a0", first_table.Get("a")->ToString());
+    // the first row is kept for the equal orders
+    ASSERT_EQ("b0", max_table.Get("b")->ToString());
+    ASSERT_EQ("b0", min_table.Get("b")->ToString());
+    ASSERT_TRUE(nullptr == max_table.Get("c"));
+
+    // grow past the initial slots
+    LastJoinHashTable large_table(1);
+    for (int64_t i = 0; i < 1000; i++) {
+        large_table.Put("key" + std::to_string(i % 100), i, rows[i % rows.size()]);
+    }
+    ASSERT_EQ(100u, large_table.GetSize());
+    for (int64_t i = 0; i < 100; i++) {
+        ASSERT_EQ(values[(900 + i) % rows.size()],
+                  large_table.Get("key" + std::to_string(i))->ToString());
+    }
+}
+
+
+TEST_F(RunnerTest, RunnerContextTraceTest) {
+    RunnerContext ctx(nullptr, Row(), std::string("sp"));
+    ASSERT_FALSE(ctx.is_trace());
+    ctx.EnableTrace();
+    ASSERT_TRUE(ctx.is_trace());
+    // the branches of the plan add their traces from their own threads
+    std::vector<std::thread> threads;
+    for (int64_t i = 0; i < 4; i++) {
+        threads.emplace_back([&ctx, i]() {
+            ctx.AddTrace(i, "RunnerType", static_cast<uint64_t>(i * 10));
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    auto traces = ctx.GetTraces();
+    ASSERT_EQ(4u, traces.size());
+    uint64_t total_us = 0;
+    for (const auto& trace : traces) {
+        ASSERT_EQ("RunnerType", trace.name);
+        ASSERT_EQ(static_cast<uint64_t>(trace.id * 10), trace.time_us);
+        total_us += trace.time_us;
+    }
+    ASSERT_EQ(60u, total_us);
+}
+
+TEST_F(RunnerTest, RunnerContextDeadlineTest) {
+    RunnerContext ctx(nullptr, Row(), std::string("sp"));
+    ASSERT_FALSE(ctx.IsExpired());
+    auto now = std::chrono::duration_cast<std::chrono::microseconds>(
+                   std::chrono::system_clock::now().time_since_epoch())
+                   .count();
+    ctx.SetDeadline(now + 3600 * 1000000ull);
+    ASSERT_FALSE(ctx.IsExpired());
+    ASSERT_FALSE(ctx.is_expired());
+    ctx.SetDeadline(now - 1);
+    ASSERT_TRUE(ctx.IsExpired());
+    ASSERT_TRUE(ctx.is_expired());
+}
+
+TEST_F(RunnerTest, RunnerContextCacheTest) {
+    ClusterJob job;
+    job.SetCacheSize(2, 1);
+    RunnerContext ctx(&job, Row(), std::string("sp"));
+    auto row = std::make_shared<MemRowHandler>(Row());
+    auto window = std::make_shared<MemTableHandler>();
+    ASSERT_FALSE(ctx.GetCache(0));
+    ctx.SetCache(0, row);
+    ctx.SetCache(-1, window);
+    // the ids beyond the job grow the caches
+    ctx.SetCache(5, row);
+    ctx.SetCache(-3, window);
+    ASSERT_EQ(row, ctx.GetCache(0));
+    ASSERT_FALSE(ctx.GetCache(1));
+    ASSERT_EQ(row, ctx.GetCache(5));
+    ASSERT_EQ(window, ctx.GetCache(-1));
+    ASSERT_FALSE(ctx.GetCache(-2));
+    ASSERT_EQ(window, ctx.GetCache(-3));
+    ctx.ClearCache();
+    ASSERT_FALSE(ctx.GetCache(0));
+    ASSERT_FALSE(ctx.GetCache(-1));
+    ASSERT_FALSE(ctx.GetCache(5));
+
+    RunnerContext no_job_ctx(nullptr, Row(), std::string("sp"));
+    ASSERT_FALSE(no_job_ctx.GetCache(3));
+    ASSERT_FALSE(no_job_ctx.GetBatchCache(3));
+    no_job_ctx.SetCache(3, row);
+    ASSERT_EQ(row, no_job_ctx.GetCache(3));
+
+    // a runner run by a branch thread is waited for by the others
+    ctx.SetBranchThreadNum(2);
+    ASSERT_FALSE(ctx.GetCache(1));
+    std::thread setter([&ctx, row]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        ctx.SetCache(1, row);
+    });
+    ASSERT_EQ(row, ctx.GetCache(1));
+    setter.join();
+}
+
+TEST_F(RunnerTest, RunnerStatsTest) {
+    hybridse::type::TableDef table_def;
+    BuildTableDef(table_def);
+    table_def.set_name("t1");
+    hybridse::type::Database db;
+    db.set_name("db");
+    AddTable(db, table_def);
+    auto catalog = BuildSimpleCatalog(db);
+
+    SqlCompiler sql_compiler(catalog);
+    SqlContext sql_context;
+    sql_context.sql = "select col1, col2 + 1 as c2 from t1 limit 10;";
+    sql_context.db = "db";
+    sql_context.engine_mode = kBatchMode;
+    sql_context.enable_runner_stats = true;
+    base::Status status;
+    ASSERT_TRUE(sql_compiler.Compile(sql_context, status)) << status;
+    ASSERT_TRUE(sql_compiler.BuildClusterJob(sql_context, status)) << status;
+    auto root = sql_context.cluster_job.GetMainTask().GetRoot();
+    ASSERT_TRUE(root != nullptr);
+    ASSERT_EQ(static_cast<int64_t>(sql_context.physical_plan->node_id()),
+              root->plan_node_id());
+    ASSERT_TRUE(root->stats() != nullptr);
+    ASSERT_EQ(0u, root->stats()->run_cnt.load());
+
+    std::ostringstream oss;
+    sql_context.cluster_job.PrintStats(oss);
+    ASSERT_NE(std::string::npos,
+              oss.str().find("[" + std::to_string(root->id_) + "]" +
+                             RunnerTypeName(root->type_) + " node=" +
+                             std::to_string(root->plan_node_id()) +
+                             " runs=0 time_us=0\n"))
+        << oss.str();
+
+    // the stats are not recorded by default
+    SqlContext default_context;
+    default_context.sql = sql_context.sql;
+    default_context.db = "db";
+    default_context.engine_mode = kBatchMode;
+    ASSERT_TRUE(sql_compiler.Compile(default_context, status)) << status;
+    ASSERT_TRUE(sql_compiler.BuildClusterJob(default_context, status)) << status;
+    ASSERT_TRUE(default_context.cluster_job.GetMainTask().GetRoot()->stats() == nullptr);
+    std::ostringstream default_oss;
+    default_context.cluster_job.PrintStats(default_oss);
+    ASSERT_EQ("", default_oss.str());
+}
+
+TEST_F(RunnerTest, RunnerStatsResetAndFnSymbolsTest) {
+    RunnerStats stats;
+    stats.run_cnt.store(3);
+    stats.time_us.store(100);
+    stats.counted_run_cnt.store(2);
+    stats.row_cnt.store(20);
+    stats.Reset();
+    ASSERT_EQ(0u, stats.run_cnt.load());
+    ASSERT_EQ(0u, stats.time_us.load());
+    ASSERT_EQ(0u, stats.counted_run_cnt.load());
+    ASSERT_EQ(0u, stats.row_cnt.load());
+
+    hybridse::type::TableDef table_def;
+    BuildTableDef(table_def);
+    table_def.set_name("t1");
+    hybridse::type::Database db;
+    db.set_name("db");
+    AddTable(db, table_def);
+    auto catalog = BuildSimpleCatalog(db);
+
+    SqlCompiler sql_compiler(catalog);
+    SqlCompileInfo compile_info;
+    SqlContext& sql_context = compile_info.get_sql_context();
+    sql_context.sql = "select col1, col2 + 1 as c2 from t1 limit 10;";
+    sql_context.db = "db";
+    sql_context.engine_mode = kBatchMode;
+    sql_context.enable_runner_stats = true;
+    base::Status status;
+    ASSERT_TRUE(sql_compiler.Compile(sql_context, status)) << status;
+    ASSERT_TRUE(sql_compiler.BuildClusterJob(sql_context, status)) << status;
+    compile_info.ResetRunnerStats();
+    std::ostringstream stats_oss;
+    compile_info.DumpRunnerStats(stats_oss);
+    ASSERT_NE(std::string::npos, stats_oss.str().find(" runs=0 time_us=0\n"))
+        << stats_oss.str();
+
+    // the project fn is listed with its output columns
+    std::ostringstream symbols_oss;
+    compile_info.DumpFnSymbols(symbols_oss);
+    ASSERT_NE(std::string::npos,
+              symbols_oss.str().find("PROJECT columns=col1,c2\n"))
+        << symbols_oss.str();
+}
+
+TEST_F(RunnerTest, ColumnPredicateTest) {
+    hybridse::type::TableDef table_def;
+    std::vector<Row> rows;
+    BuildRows(table_def, rows);
+    SchemasContext schemas_ctx;
+    auto source = schemas_ctx.AddSource();
+    source->SetSourceName("t1");
+    source->SetSchema(&table_def.columns());
+    for (int i = 0; i < table_def.columns_size(); ++i) {
+        source->SetColumnID(i, i);
+    }
+    schemas_ctx.Build();
+
+    auto match = [&](const std::shared_ptr<ColumnPredicate>& predicate) {
+        std::vector<int32_t> matched;
+        for (size_t i = 0; i < rows.size(); i++) {
+            if (predicate->Match(rows[i].buf(), rows[i].size())) {
+                matched.push_back(i);
+            }
+        }
+        return matched;
+    };
+    node::NodeManager nm;
+    {
+        // col0 = "1" and 2 < col1 and col2 + 1 > 0
+        auto condition = nm.MakeBinaryExprNode(
+            nm.MakeBinaryExprNode(
+                nm.MakeBinaryExprNode(nm.MakeColumnRefNode("col0", "t1"),
+                                      nm.MakeConstNode(std::string("1")), node::kFnOpEq),
+                nm.MakeBinaryExprNode(nm.MakeConstNode(2),
+                                      nm.MakeColumnRefNode("col1", "t1"),
+                                      node::kFnOpLt),
+                node::kFnOpAnd),
+            nm.MakeBinaryExprNode(
+                nm.MakeBinaryExprNode(nm.MakeColumnRefNode("col2", "t1"),
+                                      nm.MakeConstNode(1), node::kFnOpAdd),
+                nm.MakeConstNode(0), node::kFnOpGt),
+            node::kFnOpAnd);
+        auto predicate = ColumnPredicate::Build(condition, &schemas_ctx);
+        ASSERT_TRUE(predicate != nullptr);
+        ASSERT_EQ(2u, predicate->GetSize());
+        ASSERT_TRUE(predicate->IsSchemaOf(&table_def.columns()));
+        ASSERT_EQ(std::vector<int32_t>({2, 3}), match(predicate));
+    }
+    {
+        // col6 != "22" and col4 >= 22.2
+        auto condition = nm.MakeBinaryExprNode(
+            nm.MakeBinaryExprNode(nm.MakeColumnRefNode("col6", "t1"),
+                                  nm.MakeConstNode(std::string("22")), node::kFnOpNeq),
+            nm.MakeBinaryExprNode(nm.MakeColumnRefNode("col4", "t1"),
+                                  nm.MakeConstNode(22.2), node::kFnOpGe),
+            node::kFnOpAnd);
+        auto predicate = ColumnPredicate::Build(condition, &schemas_ctx);
+        ASSERT_TRUE(predicate != nullptr);
+        ASSERT_EQ(std::vector<int32_t>({2, 3, 4}), match(predicate));
+    }
+    {
+        // no column is compared with a constant
+        auto condition = nm.MakeBinaryExprNode(
+            nm.MakeColumnRefNode("col1", "t1"),
+            nm.MakeColumnRefNode("col2", "t1"), node::kFnOpLt);
+        ASSERT_TRUE(ColumnPredicate::Build(condition, &schemas_ctx) ==
+                    nullptr);
+    }
+}
+
 }  // namespace vm
 }  // namespace hybridse
 
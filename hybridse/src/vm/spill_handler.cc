@@ -0,0 +1,715 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "vm/spill_handler.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include "base/kway_merger.h"
+#include "glog/logging.h"
+#include "vm/runner.h"
+
+namespace hybridse {
+namespace vm {
+
+// the bytes buffered by a spill file before they are written
+#define SPILL_WRITE_BUFFER_SIZE (1 << 20)
+// the bytes read at once by an iterator merging the sorted runs
+#define SPILL_READ_BLOCK_SIZE (64 << 10)
+// the buckets of the partitions spilled, and the buckets kept in memory
+#define SPILL_BUCKET_CNT 64
+#define SPILL_BUCKET_CACHE_SIZE 4
+
+uint64_t GetRowMemory(const Row& row) {
+    uint64_t bytes = sizeof(std::pair<uint64_t, Row>);
+    for (int32_t i = 0; i < row.GetRowPtrCnt(); i++) {
+        bytes += row.size(i);
+    }
+    return bytes;
+}
+
+static void PutFixed32(std::string* buf, uint32_t val) {
+    buf->append(reinterpret_cast<const char*>(&val), sizeof(val));
+}
+
+static void PutFixed64(std::string* buf, uint64_t val) {
+    buf->append(reinterpret_cast<const char*>(&val), sizeof(val));
+}
+
+SpillFile::~SpillFile() {
+    if (fd_ >= 0) {
+        close(fd_);
+    }
+}
+
+std::shared_ptr<SpillFile> SpillFile::Create(const std::string& dir) {
+    std::string path = dir + "/hybridse_spill_XXXXXX";
+    std::vector<char> name(path.begin(), path.end());
+    name.push_back('\0');
+    int fd = mkstemp(name.data());
+    if (fd < 0) {
+        LOG(WARNING) << "fail to create spill file in " << dir << ": "
+                     << strerror(errno);
+        return std::shared_ptr<SpillFile>();
+    }
+    unlink(name.data());
+    return std::shared_ptr<SpillFile>(new SpillFile(fd));
+}
+
+// a row is the key, the ts and the slices with their sizes
+bool SpillFile::Append(const std::string& key, uint64_t ts, const Row& row) {
+    PutFixed32(&buffer_, key.size());
+    buffer_.append(key);
+    PutFixed64(&buffer_, ts);
+    uint32_t slice_cnt = row.GetRowPtrCnt();
+    PutFixed32(&buffer_, slice_cnt);
+    for (uint32_t i = 0; i < slice_cnt; i++) {
+        PutFixed32(&buffer_, row.size(i));
+        buffer_.append(reinterpret_cast<const char*>(row.buf(i)), row.size(i));
+    }
+    cnt_++;
+    if (buffer_.size() >= SPILL_WRITE_BUFFER_SIZE) {
+        return Flush();
+    }
+    return true;
+}
+
+bool SpillFile::Flush() {
+    size_t pos = 0;
+    while (pos < buffer_.size()) {
+        ssize_t n = write(fd_, buffer_.data() + pos, buffer_.size() - pos);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            LOG(WARNING) << "fail to write spill file: " << strerror(errno);
+            return false;
+        }
+        pos += n;
+    }
+    size_ += buffer_.size();
+    buffer_.clear();
+    return true;
+}
+
+bool SpillFile::Read(uint64_t offset, size_t len, char* buf) const {
+    size_t pos = 0;
+    while (pos < len) {
+        ssize_t n = pread(fd_, buf + pos, len - pos, offset + pos);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            LOG(WARNING) << "fail to read spill file at " << offset + pos
+                         << ": " << (n < 0 ? strerror(errno) : "eof");
+            return false;
+        }
+        pos += n;
+    }
+    return true;
+}
+
+SpillFileReader::SpillFileReader(std::shared_ptr<SpillFile> file,
+                                 bool read_all)
+    : file_(file),
+      buffer_(std::make_shared<std::string>()),
+      pos_(0),
+      offset_(0),
+      read_all_(read_all),
+      ok_(true) {
+    if (read_all_) {
+        buffer_->resize(file_->GetSize());
+        offset_ = file_->GetSize();
+        if (!buffer_->empty() &&
+            !file_->Read(0, buffer_->size(), &(*buffer_)[0])) {
+            buffer_->clear();
+            ok_ = false;
+        }
+    }
+}
+
+bool SpillFileReader::Fill(size_t n) {
+    size_t buffered = buffer_->size() - pos_;
+    if (buffered >= n) {
+        return true;
+    }
+    uint64_t remaining = file_->GetSize() - offset_;
+    if (read_all_ || remaining < n - buffered) {
+        return false;
+    }
+    buffer_->erase(0, pos_);
+    pos_ = 0;
+    size_t len = std::min<uint64_t>(
+        remaining, std::max<size_t>(n - buffered, SPILL_READ_BLOCK_SIZE));
+    buffer_->resize(buffered + len);
+    if (!file_->Read(offset_, len, &(*buffer_)[buffered])) {
+        ok_ = false;
+        return false;
+    }
+    offset_ += len;
+    return true;
+}
+
+bool SpillFileReader::Next(std::string* key, uint64_t* ts, Row* row) {
+    if (!ok_) {
+        return false;
+    }
+    if (!Fill(sizeof(uint32_t))) {
+        // a row is cut off if the file is not read to the end
+        if (ok_ && (pos_ < buffer_->size() || offset_ < file_->GetSize())) {
+            LOG(WARNING) << "spill file is truncated";
+            ok_ = false;
+        }
+        return false;
+    }
+    uint32_t key_len = 0;
+    memcpy(&key_len, buffer_->data() + pos_, sizeof(key_len));
+    pos_ += sizeof(key_len);
+    uint32_t slice_cnt = 0;
+    if (!Fill(key_len + sizeof(uint64_t) + sizeof(slice_cnt))) {
+        ok_ = false;
+        return false;
+    }
+    key->assign(buffer_->data() + pos_, key_len);
+    pos_ += key_len;
+    memcpy(ts, buffer_->data() + pos_, sizeof(uint64_t));
+    pos_ += sizeof(uint64_t);
+    memcpy(&slice_cnt, buffer_->data() + pos_, sizeof(slice_cnt));
+    pos_ += sizeof(slice_cnt);
+    for (uint32_t i = 0; i < slice_cnt; i++) {
+        uint32_t size = 0;
+        if (!Fill(sizeof(size))) {
+            ok_ = false;
+            return false;
+        }
+        memcpy(&size, buffer_->data() + pos_, sizeof(size));
+        pos_ += sizeof(size);
+        if (!Fill(size)) {
+            ok_ = false;
+            return false;
+        }
+        base::RefCountedSlice slice;
+        if (read_all_) {
+            slice = base::RefCountedSlice::CreateShared(
+                buffer_->data() + pos_, size, buffer_);
+        } else if (size > 0) {
+            slice = base::RefCountedSlice::Allocate(size);
+            memcpy(slice.buf(), buffer_->data() + pos_, size);
+        }
+        pos_ += size;
+        if (i == 0) {
+            *row = Row(slice);
+        } else {
+            row->Append(slice);
+        }
+    }
+    return true;
+}
+
+namespace {
+
+// the iterator of a segment, which keeps its bucket in memory
+class BucketRowIterator : public RowIterator {
+ public:
+    BucketRowIterator(std::shared_ptr<PartitionHandler> bucket,
+                      RowIterator* iter)
+        : bucket_(bucket), iter_(iter) {}
+    ~BucketRowIterator() {}
+    bool Valid() const override { return iter_->Valid(); }
+    void Next() override { iter_->Next(); }
+    const uint64_t& GetKey() const override { return iter_->GetKey(); }
+    const Row& GetValue() override { return iter_->GetValue(); }
+    bool IsSeekable() const override { return iter_->IsSeekable(); }
+    void Seek(const uint64_t& key) override { iter_->Seek(key); }
+    void SeekToFirst() override { iter_->SeekToFirst(); }
+    bool SetBound(const uint64_t& bound, uint64_t limit) override {
+        return iter_->SetBound(bound, limit);
+    }
+
+ private:
+    std::shared_ptr<PartitionHandler> bucket_;
+    std::unique_ptr<RowIterator> iter_;
+};
+
+// iterate the segments bucket by bucket
+class SpillWindowIterator : public WindowIterator {
+ public:
+    explicit SpillWindowIterator(SpillPartitionHandler* partitions)
+        : partitions_(partitions), idx_(0), bucket_(), iter_() {}
+    ~SpillWindowIterator() {}
+
+    void Seek(const std::string& key) override {
+        if (LoadBucket(partitions_->GetBucketIdx(key))) {
+            iter_->Seek(key);
+        }
+    }
+    void SeekToFirst() override {
+        LoadBucket(0);
+        SkipEmptyBuckets();
+    }
+    void Next() override {
+        iter_->Next();
+        SkipEmptyBuckets();
+    }
+    bool Valid() override { return iter_ && iter_->Valid(); }
+    std::unique_ptr<RowIterator> GetValue() override {
+        return std::unique_ptr<RowIterator>(GetRawValue());
+    }
+    RowIterator* GetRawValue() override {
+        auto iter = iter_->GetRawValue();
+        return iter == nullptr ? nullptr : new BucketRowIterator(bucket_, iter);
+    }
+    const Row GetKey() override { return iter_->GetKey(); }
+
+ private:
+    bool LoadBucket(uint32_t idx) {
+        idx_ = idx;
+        iter_.reset();
+        bucket_ = partitions_->GetBucket(idx);
+        if (!bucket_) {
+            return false;
+        }
+        iter_ = bucket_->GetWindowIterator();
+        if (iter_) {
+            iter_->SeekToFirst();
+        }
+        return iter_ != nullptr;
+    }
+    void SkipEmptyBuckets() {
+        while (iter_ && !iter_->Valid() &&
+               idx_ + 1 < partitions_->GetBucketCnt()) {
+            LoadBucket(idx_ + 1);
+        }
+    }
+
+    SpillPartitionHandler* partitions_;
+    uint32_t idx_;
+    std::shared_ptr<PartitionHandler> bucket_;
+    std::unique_ptr<WindowIterator> iter_;
+};
+
+// merge the sorted runs, the ties go to the run spilled first so the rows of
+// the same key keep their order
+class SpillMergeIterator : public RowIterator {
+ public:
+    SpillMergeIterator(const std::vector<std::shared_ptr<SpillFile>>& runs,
+                       bool is_asc)
+        : runs_(runs),
+          is_asc_(is_asc),
+          readers_(),
+          keys_(runs.size()),
+          rows_(runs.size()),
+          merger_() {
+        SeekToFirst();
+    }
+    ~SpillMergeIterator() {}
+
+    bool Valid() const override { return !merger_.Empty(); }
+    void Next() override {
+        size_t top = merger_.Top();
+        if (ReadRow(top)) {
+            merger_.Next(SortKey(keys_[top]));
+        } else {
+            merger_.Pop();
+        }
+    }
+    const uint64_t& GetKey() const override { return keys_[merger_.Top()]; }
+    const Row& GetValue() override { return rows_[merger_.Top()]; }
+    bool IsSeekable() const override { return false; }
+    // move to the first row whose key is no more than the key
+    void Seek(const uint64_t& key) override {
+        SeekToFirst();
+        while (Valid() && GetKey() > key) {
+            Next();
+        }
+    }
+    void SeekToFirst() override {
+        readers_.clear();
+        merger_.Reset(runs_.size());
+        for (size_t i = 0; i < runs_.size(); i++) {
+            readers_.emplace_back(new SpillFileReader(runs_[i], false));
+            if (ReadRow(i)) {
+                merger_.Add(i, SortKey(keys_[i]));
+            }
+        }
+    }
+
+ private:
+    // the keys of the descending runs are merged in the ascending order
+    uint64_t SortKey(uint64_t key) const {
+        return is_asc_ ? key : UINT64_MAX - key;
+    }
+    bool ReadRow(size_t idx) {
+        std::string key;
+        return readers_[idx]->Next(&key, &keys_[idx], &rows_[idx]);
+    }
+
+    std::vector<std::shared_ptr<SpillFile>> runs_;
+    const bool is_asc_;
+    std::vector<std::unique_ptr<SpillFileReader>> readers_;
+    std::vector<uint64_t> keys_;
+    std::vector<Row> rows_;
+    base::KWayMerger<uint64_t> merger_;
+};
+
+}  // namespace
+
+SpillPartitionHandler::SpillPartitionHandler(const Schema* schema,
+                                             const std::string& spill_dir,
+                                             uint32_t bucket_cnt)
+    : PartitionHandler(),
+      table_name_(""),
+      db_(""),
+      schema_(schema),
+      types_(),
+      index_hint_(),
+      order_type_(kNoneOrder),
+      bucket_order_type_(kNoneOrder),
+      spill_dir_(spill_dir),
+      bucket_cnt_(std::max<uint32_t>(bucket_cnt, 1)),
+      files_(bucket_cnt_),
+      transform_(),
+      mu_(),
+      buckets_(),
+      cnt_(-1) {}
+
+uint32_t SpillPartitionHandler::GetBucketIdx(const std::string& key) const {
+    return std::hash<std::string>()(key) % bucket_cnt_;
+}
+
+bool SpillPartitionHandler::AddRow(const std::string& key, uint64_t ts,
+                                   const Row& row) {
+    auto& file = files_[GetBucketIdx(key)];
+    if (!file) {
+        file = SpillFile::Create(spill_dir_);
+        if (!file) {
+            return false;
+        }
+    }
+    return file->Append(key, ts, row);
+}
+
+bool SpillPartitionHandler::Flush() {
+    for (auto& file : files_) {
+        if (file && !file->Flush()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+uint64_t SpillPartitionHandler::GetSpillBytes() const {
+    uint64_t bytes = 0;
+    for (auto& file : files_) {
+        if (file) {
+            bytes += file->GetSize();
+        }
+    }
+    return bytes;
+}
+
+std::shared_ptr<SpillPartitionHandler> SpillPartitionHandler::Transform(
+    BucketTransform transform, OrderType order_type) {
+    auto view = std::make_shared<SpillPartitionHandler>(schema_, spill_dir_,
+                                                        bucket_cnt_);
+    view->files_ = files_;
+    view->bucket_order_type_ = bucket_order_type_;
+    view->order_type_ = order_type;
+    if (transform_) {
+        auto prev = transform_;
+        view->transform_ = [prev, transform](
+                               std::shared_ptr<PartitionHandler> bucket) {
+            auto output = prev(bucket);
+            return output ? transform(output) : output;
+        };
+    } else {
+        view->transform_ = transform;
+    }
+    return view;
+}
+
+std::shared_ptr<PartitionHandler> SpillPartitionHandler::LoadBucket(
+    uint32_t idx) {
+    auto bucket = std::make_shared<MemPartitionHandler>(schema_);
+    if (files_[idx]) {
+        SpillFileReader reader(files_[idx], true);
+        std::string key;
+        uint64_t ts = 0;
+        Row row;
+        while (reader.Next(&key, &ts, &row)) {
+            bucket->AddRow(key, ts, row);
+        }
+        if (!reader.ok()) {
+            LOG(WARNING) << "fail to load the spilled bucket " << idx;
+            return std::shared_ptr<PartitionHandler>();
+        }
+    }
+    bucket->SetOrderType(bucket_order_type_);
+    if (transform_) {
+        return transform_(bucket);
+    }
+    return bucket;
+}
+
+std::shared_ptr<PartitionHandler> SpillPartitionHandler::GetBucket(
+    uint32_t idx) {
+    std::lock_guard<std::mutex> lock(mu_);
+    for (auto it = buckets_.begin(); it != buckets_.end(); ++it) {
+        if (it->first == idx) {
+            buckets_.splice(buckets_.begin(), buckets_, it);
+            return it->second;
+        }
+    }
+    auto bucket = LoadBucket(idx);
+    if (!bucket) {
+        return bucket;
+    }
+    buckets_.emplace_front(idx, bucket);
+    if (buckets_.size() > SPILL_BUCKET_CACHE_SIZE) {
+        buckets_.pop_back();
+    }
+    return bucket;
+}
+
+std::unique_ptr<WindowIterator> SpillPartitionHandler::GetWindowIterator() {
+    return std::unique_ptr<WindowIterator>(new SpillWindowIterator(this));
+}
+
+std::shared_ptr<TableHandler> SpillPartitionHandler::GetSegment(
+    const std::string& key) {
+    auto bucket = GetBucket(GetBucketIdx(key));
+    return bucket ? bucket->GetSegment(key) : std::shared_ptr<TableHandler>();
+}
+
+const uint64_t SpillPartitionHandler::GetCount() {
+    int64_t cnt = cnt_.load(std::memory_order_relaxed);
+    if (cnt >= 0) {
+        return cnt;
+    }
+    cnt = 0;
+    for (uint32_t i = 0; i < bucket_cnt_; i++) {
+        auto bucket = GetBucket(i);
+        if (bucket) {
+            cnt += bucket->GetCount();
+        }
+    }
+    cnt_.store(cnt, std::memory_order_relaxed);
+    return cnt;
+}
+
+SpillTableHandler::SpillTableHandler(const Schema* schema, bool is_asc)
+    : TableHandler(),
+      table_name_(""),
+      db_(""),
+      schema_(schema),
+      types_(),
+      index_hint_(),
+      is_asc_(is_asc),
+      runs_(),
+      cnt_(0) {}
+
+bool SpillTableHandler::AddRun(std::shared_ptr<TableHandler> rows,
+                               const std::string& spill_dir) {
+    auto file = SpillFile::Create(spill_dir);
+    if (!file) {
+        return false;
+    }
+    auto iter = rows->GetIterator();
+    if (iter) {
+        for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+            if (!file->Append("", iter->GetKey(), iter->GetValue())) {
+                return false;
+            }
+        }
+    }
+    if (!file->Flush()) {
+        return false;
+    }
+    cnt_ += file->GetCount();
+    runs_.push_back(file);
+    return true;
+}
+
+uint64_t SpillTableHandler::GetSpillBytes() const {
+    uint64_t bytes = 0;
+    for (auto& run : runs_) {
+        bytes += run->GetSize();
+    }
+    return bytes;
+}
+
+std::unique_ptr<RowIterator> SpillTableHandler::GetIterator() {
+    return std::unique_ptr<RowIterator>(GetRawIterator());
+}
+
+RowIterator* SpillTableHandler::GetRawIterator() {
+    return new SpillMergeIterator(runs_, is_asc_);
+}
+
+Row SpillTableHandler::At(uint64_t pos) {
+    if (pos >= cnt_) {
+        return Row();
+    }
+    SpillMergeIterator iter(runs_, is_asc_);
+    for (uint64_t i = 0; i < pos && iter.Valid(); i++) {
+        iter.Next();
+    }
+    return iter.Valid() ? iter.GetValue() : Row();
+}
+
+PartitionBuilder::PartitionBuilder(const Schema* schema, RunnerContext* ctx)
+    : schema_(schema),
+      ctx_(ctx),
+      mem_(std::make_shared<MemPartitionHandler>(schema)),
+      spill_(),
+      charged_(0),
+      failed_(false) {}
+
+bool PartitionBuilder::AddRow(const std::string& key, uint64_t ts,
+                              const Row& row) {
+    if (failed_) {
+        return false;
+    }
+    if (spill_) {
+        failed_ = !spill_->AddRow(key, ts, row);
+        return !failed_;
+    }
+    mem_->AddRow(key, ts, row);
+    if (ctx_ == nullptr) {
+        return true;
+    }
+    uint64_t bytes = GetRowMemory(row) + key.size();
+    charged_ += bytes;
+    if (!ctx_->ChargeMemory(bytes)) {
+        failed_ = !Spill();
+    }
+    return !failed_;
+}
+
+bool PartitionBuilder::Spill() {
+    if (ctx_->spill_dir().empty()) {
+        LOG(WARNING) << "the rows partitioned are beyond the memory budget "
+                     << ctx_->memory_budget() << " without the spill dir";
+        ctx_->SetMemoryExceeded();
+        return false;
+    }
+    // the rows of a key keep their order in the bucket of the key
+    spill_ = std::make_shared<SpillPartitionHandler>(
+        schema_, ctx_->spill_dir(), SPILL_BUCKET_CNT);
+    auto iter = mem_->GetWindowIterator();
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+        auto key = iter->GetKey().ToString();
+        auto segment_iter = iter->GetValue();
+        for (segment_iter->SeekToFirst(); segment_iter->Valid();
+             segment_iter->Next()) {
+            if (!spill_->AddRow(key, segment_iter->GetKey(),
+                                segment_iter->GetValue())) {
+                return false;
+            }
+        }
+    }
+    iter.reset();
+    mem_.reset();
+    ctx_->ReleaseMemory(charged_);
+    charged_ = 0;
+    return true;
+}
+
+std::shared_ptr<PartitionHandler> PartitionBuilder::Finish(
+    OrderType order_type) {
+    if (failed_) {
+        return std::shared_ptr<PartitionHandler>();
+    }
+    if (!spill_) {
+        mem_->SetOrderType(order_type);
+        return mem_;
+    }
+    if (!spill_->Flush()) {
+        return std::shared_ptr<PartitionHandler>();
+    }
+    spill_->SetOrderType(order_type);
+    ctx_->AddSpillBytes(spill_->GetSpillBytes());
+    return spill_;
+}
+
+SortedTableBuilder::SortedTableBuilder(const Schema* schema,
+                                       RunnerContext* ctx, bool is_asc)
+    : schema_(schema),
+      ctx_(ctx),
+      is_asc_(is_asc),
+      mem_(std::make_shared<MemTimeTableHandler>(schema)),
+      spill_(),
+      charged_(0),
+      failed_(false) {}
+
+bool SortedTableBuilder::AddRow(uint64_t key, const Row& row) {
+    if (failed_) {
+        return false;
+    }
+    mem_->AddRow(key, row);
+    if (ctx_ == nullptr) {
+        return true;
+    }
+    uint64_t bytes = GetRowMemory(row);
+    charged_ += bytes;
+    if (!ctx_->ChargeMemory(bytes)) {
+        failed_ = !Spill();
+    }
+    return !failed_;
+}
+
+bool SortedTableBuilder::Spill() {
+    if (ctx_->spill_dir().empty()) {
+        LOG(WARNING) << "the rows sorted are beyond the memory budget "
+                     << ctx_->memory_budget() << " without the spill dir";
+        ctx_->SetMemoryExceeded();
+        return false;
+    }
+    if (!spill_) {
+        spill_ = std::make_shared<SpillTableHandler>(schema_, is_asc_);
+    }
+    mem_->Sort(is_asc_);
+    if (!spill_->AddRun(mem_, ctx_->spill_dir())) {
+        return false;
+    }
+    mem_ = std::make_shared<MemTimeTableHandler>(schema_);
+    ctx_->ReleaseMemory(charged_);
+    charged_ = 0;
+    return true;
+}
+
+std::shared_ptr<TableHandler> SortedTableBuilder::Finish() {
+    if (failed_) {
+        return std::shared_ptr<TableHandler>();
+    }
+    if (!spill_) {
+        mem_->Sort(is_asc_);
+        return mem_;
+    }
+    if (mem_->GetCount() > 0 && !Spill()) {
+        return std::shared_ptr<TableHandler>();
+    }
+    ctx_->AddSpillBytes(spill_->GetSpillBytes());
+    return spill_;
+}
+
+}  // namespace vm
+}  // namespace hybridse
@@ -0,0 +1,263 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef HYBRIDSE_SRC_VM_SPILL_HANDLER_H_
+#define HYBRIDSE_SRC_VM_SPILL_HANDLER_H_
+
+#include <atomic>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "vm/catalog.h"
+#include "vm/mem_catalog.h"
+
+namespace hybridse {
+namespace vm {
+
+class RunnerContext;
+
+// the bytes of the row kept in a table in memory
+uint64_t GetRowMemory(const Row& row);
+
+// SpillFile keeps the rows spilled by a run in a temporary file, which is
+// unlinked as it is created, so it is removed as the file is closed even if
+// the process crashes. The rows are appended with their keys and read back
+// by SpillFileReader after Flush.
+class SpillFile {
+ public:
+    ~SpillFile();
+    SpillFile(const SpillFile&) = delete;
+    SpillFile& operator=(const SpillFile&) = delete;
+
+    // null if the file fails to be created in dir
+    static std::shared_ptr<SpillFile> Create(const std::string& dir);
+
+    bool Append(const std::string& key, uint64_t ts, const Row& row);
+    bool Flush();
+
+    // the bytes flushed
+    uint64_t GetSize() const { return size_; }
+    uint64_t GetCount() const { return cnt_; }
+
+    bool Read(uint64_t offset, size_t len, char* buf) const;
+
+ private:
+    explicit SpillFile(int fd) : fd_(fd), buffer_(), size_(0), cnt_(0) {}
+
+    int fd_;
+    std::string buffer_;
+    uint64_t size_;
+    uint64_t cnt_;
+};
+
+// SpillFileReader reads the rows of a spill file in the order they are
+// appended. The rows read at once share the buffer of the whole file, or
+// else every row has its own buffer, as the file is read block by block.
+class SpillFileReader {
+ public:
+    SpillFileReader(std::shared_ptr<SpillFile> file, bool read_all);
+
+    // false at the end of the file or if it fails to be read
+    bool Next(std::string* key, uint64_t* ts, Row* row);
+    // false if the file fails to be read
+    bool ok() const { return ok_; }
+
+ private:
+    // at least n bytes after pos_ in the buffer
+    bool Fill(size_t n);
+
+    std::shared_ptr<SpillFile> file_;
+    std::shared_ptr<std::string> buffer_;
+    size_t pos_;
+    uint64_t offset_;
+    bool read_all_;
+    bool ok_;
+};
+
+// SpillPartitionHandler keeps the partitions in the files of the buckets
+// hashed by their keys. A bucket is loaded as the partitions in memory when
+// its segments are read, so a run iterating the segments holds the rows of a
+// few buckets only. The buckets loaded lately are cached, as the segments of
+// a bucket are read one by one.
+class SpillPartitionHandler : public PartitionHandler {
+ public:
+    // transform the partitions of a bucket loaded, e.g. sort them
+    typedef std::function<std::shared_ptr<PartitionHandler>(
+        std::shared_ptr<PartitionHandler>)>
+        BucketTransform;
+
+    SpillPartitionHandler(const Schema* schema, const std::string& spill_dir,
+                          uint32_t bucket_cnt);
+    ~SpillPartitionHandler() {}
+
+    bool AddRow(const std::string& key, uint64_t ts, const Row& row);
+    bool Flush();
+    uint64_t GetSpillBytes() const;
+
+    // the view of the partitions transformed as their buckets are loaded, it
+    // shares the files of this handler
+    std::shared_ptr<SpillPartitionHandler> Transform(BucketTransform transform,
+                                                     OrderType order_type);
+
+    const Types& GetTypes() override { return types_; }
+    const IndexHint& GetIndex() override { return index_hint_; }
+    const Schema* GetSchema() override { return schema_; }
+    const std::string& GetName() override { return table_name_; }
+    const std::string& GetDatabase() override { return db_; }
+    std::unique_ptr<WindowIterator> GetWindowIterator() override;
+    std::shared_ptr<TableHandler> GetSegment(const std::string& key) override;
+    // the keys are counted by loading all the buckets
+    const uint64_t GetCount() override;
+    // the order of the rows spilled, which is the order of the buckets loaded
+    void SetOrderType(const OrderType order_type) {
+        order_type_ = order_type;
+        bucket_order_type_ = order_type;
+    }
+    const OrderType GetOrderType() const override { return order_type_; }
+    const std::string GetHandlerTypeName() override {
+        return "SpillPartitionHandler";
+    }
+
+    uint32_t GetBucketCnt() const { return bucket_cnt_; }
+    uint32_t GetBucketIdx(const std::string& key) const;
+    // the partitions of the bucket in memory
+    std::shared_ptr<PartitionHandler> GetBucket(uint32_t idx);
+
+ private:
+    std::shared_ptr<PartitionHandler> LoadBucket(uint32_t idx);
+
+    const std::string table_name_;
+    const std::string db_;
+    const Schema* schema_;
+    Types types_;
+    IndexHint index_hint_;
+    OrderType order_type_;
+    OrderType bucket_order_type_;
+    const std::string spill_dir_;
+    const uint32_t bucket_cnt_;
+    std::vector<std::shared_ptr<SpillFile>> files_;
+    BucketTransform transform_;
+    std::mutex mu_;
+    // the buckets loaded lately, the latest is at the front
+    std::list<std::pair<uint32_t, std::shared_ptr<PartitionHandler>>> buckets_;
+    std::atomic<int64_t> cnt_;
+};
+
+// SpillTableHandler keeps the rows in the files of the runs sorted by their
+// keys. Its iterators merge the runs as they read them block by block, so
+// the rows iterated are not kept in memory.
+class SpillTableHandler : public TableHandler {
+ public:
+    SpillTableHandler(const Schema* schema, bool is_asc);
+    ~SpillTableHandler() {}
+
+    // write the rows sorted in the order of the handler as a run
+    bool AddRun(std::shared_ptr<TableHandler> rows,
+                const std::string& spill_dir);
+    uint64_t GetSpillBytes() const;
+
+    const Types& GetTypes() override { return types_; }
+    const IndexHint& GetIndex() override { return index_hint_; }
+    const Schema* GetSchema() override { return schema_; }
+    const std::string& GetName() override { return table_name_; }
+    const std::string& GetDatabase() override { return db_; }
+    std::unique_ptr<RowIterator> GetIterator() override;
+    RowIterator* GetRawIterator() override;
+    std::unique_ptr<WindowIterator> GetWindowIterator(
+        const std::string& idx_name) override {
+        return std::unique_ptr<WindowIterator>();
+    }
+    const uint64_t GetCount() override { return cnt_; }
+    // the rows before pos are iterated to reach it
+    Row At(uint64_t pos) override;
+    const OrderType GetOrderType() const override {
+        return is_asc_ ? kAscOrder : kDescOrder;
+    }
+    const std::string GetHandlerTypeName() override {
+        return "SpillTableHandler";
+    }
+
+ private:
+    const std::string table_name_;
+    const std::string db_;
+    const Schema* schema_;
+    Types types_;
+    IndexHint index_hint_;
+    const bool is_asc_;
+    std::vector<std::shared_ptr<SpillFile>> runs_;
+    uint64_t cnt_;
+};
+
+// PartitionBuilder groups the rows into the partitions in memory, which are
+// moved into the files of a SpillPartitionHandler once the rows are beyond
+// the memory budget of the run. The rows are not charged without a context.
+class PartitionBuilder {
+ public:
+    PartitionBuilder(const Schema* schema, RunnerContext* ctx);
+
+    // false if the budget is exceeded without the spill dir of the run, or
+    // the spill fails
+    bool AddRow(const std::string& key, uint64_t ts, const Row& row);
+
+    // null if a row fails to be added
+    std::shared_ptr<PartitionHandler> Finish(OrderType order_type);
+
+ private:
+    bool Spill();
+
+    const Schema* schema_;
+    RunnerContext* ctx_;
+    std::shared_ptr<MemPartitionHandler> mem_;
+    std::shared_ptr<SpillPartitionHandler> spill_;
+    uint64_t charged_;
+    bool failed_;
+};
+
+// SortedTableBuilder sorts the rows by their keys in memory, and writes them
+// as the sorted runs of a SpillTableHandler whenever the rows are beyond the
+// memory budget of the run. The rows are not charged without a context.
+class SortedTableBuilder {
+ public:
+    SortedTableBuilder(const Schema* schema, RunnerContext* ctx, bool is_asc);
+
+    // false if the budget is exceeded without the spill dir of the run, or
+    // the spill fails
+    bool AddRow(uint64_t key, const Row& row);
+
+    // null if a row fails to be added
+    std::shared_ptr<TableHandler> Finish();
+
+ private:
+    bool Spill();
+
+    const Schema* schema_;
+    RunnerContext* ctx_;
+    const bool is_asc_;
+    std::shared_ptr<MemTimeTableHandler> mem_;
+    std::shared_ptr<SpillTableHandler> spill_;
+    uint64_t charged_;
+    bool failed_;
+};
+
+}  // namespace vm
+}  // namespace hybridse
+
+#endif  // HYBRIDSE_SRC_VM_SPILL_HANDLER_H_
@@ -0,0 +1,200 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "vm/spill_handler.h"
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+#include "gtest/gtest.h"
+#include "vm/runner.h"
+
+namespace hybridse {
+namespace vm {
+using hybridse::codec::Row;
+class SpillHandlerTest : public ::testing::Test {
+ public:
+    SpillHandlerTest() {}
+    ~SpillHandlerTest() {}
+};
+
+static Row BuildRow(uint64_t id) {
+    std::string str = "row_" + std::to_string(id) + std::string(64, 'x');
+    auto slice = base::RefCountedSlice::Allocate(str.size());
+    memcpy(slice.buf(), str.data(), str.size());
+    return Row(slice);
+}
+
+TEST_F(SpillHandlerTest, spill_file_test) {
+    auto file = SpillFile::Create("/tmp");
+    ASSERT_TRUE(file != nullptr);
+    for (uint64_t i = 0; i < 1000; i++) {
+        Row row = BuildRow(i);
+        row.Append(BuildRow(i + 1).GetSlice(0));
+        ASSERT_TRUE(file->Append("key" + std::to_string(i % 7), i, row));
+    }
+    ASSERT_TRUE(file->Flush());
+    ASSERT_EQ(1000u, file->GetCount());
+    for (bool read_all : {true, false}) {
+        SpillFileReader reader(file, read_all);
+        std::string key;
+        uint64_t ts = 0;
+        Row row;
+        uint64_t cnt = 0;
+        while (reader.Next(&key, &ts, &row)) {
+            ASSERT_EQ("key" + std::to_string(cnt % 7), key);
+            ASSERT_EQ(cnt, ts);
+            ASSERT_EQ(2, row.GetRowPtrCnt());
+            ASSERT_EQ(BuildRow(cnt).ToString(), row.ToString());
+            ASSERT_EQ(BuildRow(cnt + 1).ToString(),
+                      Row(row.GetSlice(1)).ToString());
+            cnt++;
+        }
+        ASSERT_TRUE(reader.ok());
+        ASSERT_EQ(1000u, cnt);
+    }
+}
+
+TEST_F(SpillHandlerTest, partition_spill_test) {
+    RunnerContext ctx(nullptr, Row(), false);
+    ctx.SetMemoryBudget(4096, "/tmp");
+    PartitionBuilder builder(nullptr, &ctx);
+    std::map<std::string, std::vector<uint64_t>> expect;
+    for (uint64_t i = 0; i < 2000; i++) {
+        std::string key = "key" + std::to_string(i % 100);
+        ASSERT_TRUE(builder.AddRow(key, i, BuildRow(i)));
+        expect[key].push_back(i);
+    }
+    auto partitions = builder.Finish(kNoneOrder);
+    ASSERT_TRUE(partitions != nullptr);
+    ASSERT_EQ("SpillPartitionHandler", partitions->GetHandlerTypeName());
+    ASSERT_EQ(0u, ctx.memory_used());
+    ASSERT_GT(ctx.spill_bytes(), 0u);
+    ASSERT_FALSE(ctx.is_memory_exceeded());
+    ASSERT_EQ(100u, partitions->GetCount());
+
+    // the rows of a key keep their order
+    std::map<std::string, std::vector<uint64_t>> actual;
+    auto window_iter = partitions->GetWindowIterator();
+    for (window_iter->SeekToFirst(); window_iter->Valid();
+         window_iter->Next()) {
+        auto key = window_iter->GetKey().ToString();
+        ASSERT_EQ(0u, actual.count(key));
+        auto iter = window_iter->GetValue();
+        for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+            ASSERT_EQ(BuildRow(iter->GetKey()).ToString(),
+                      iter->GetValue().ToString());
+            actual[key].push_back(iter->GetKey());
+        }
+    }
+    ASSERT_EQ(expect, actual);
+
+    auto segment = partitions->GetSegment("key42");
+    ASSERT_TRUE(segment != nullptr);
+    ASSERT_EQ(20u, segment->GetCount());
+    ASSERT_EQ(BuildRow(42).ToString(),
+              segment->GetIterator()->GetValue().ToString());
+}
+
+TEST_F(SpillHandlerTest, partition_in_memory_test) {
+    RunnerContext ctx(nullptr, Row(), false);
+    ctx.SetMemoryBudget(1 << 20, "/tmp");
+    PartitionBuilder builder(nullptr, &ctx);
+    for (uint64_t i = 0; i < 100; i++) {
+        ASSERT_TRUE(builder.AddRow("key" + std::to_string(i % 10), i,
+                                   BuildRow(i)));
+    }
+    auto partitions = builder.Finish(kDescOrder);
+    ASSERT_TRUE(partitions != nullptr);
+    ASSERT_EQ("MemPartitionHandler", partitions->GetHandlerTypeName());
+    ASSERT_EQ(kDescOrder, partitions->GetOrderType());
+    ASSERT_GT(ctx.memory_used(), 0u);
+    ASSERT_EQ(0u, ctx.spill_bytes());
+}
+
+TEST_F(SpillHandlerTest, memory_exceeded_test) {
+    RunnerContext ctx(nullptr, Row(), false);
+    ctx.SetMemoryBudget(1024, "");
+    PartitionBuilder builder(nullptr, &ctx);
+    bool ok = true;
+    for (uint64_t i = 0; ok && i < 100; i++) {
+        ok = builder.AddRow("key", i, BuildRow(i));
+    }
+    ASSERT_FALSE(ok);
+    ASSERT_TRUE(ctx.is_memory_exceeded());
+    ASSERT_TRUE(builder.Finish(kNoneOrder) == nullptr);
+
+    RunnerContext sort_ctx(nullptr, Row(), false);
+    sort_ctx.SetMemoryBudget(1024, "");
+    SortedTableBuilder sorted(nullptr, &sort_ctx, true);
+    ok = true;
+    for (uint64_t i = 0; ok && i < 100; i++) {
+        ok = sorted.AddRow(i, BuildRow(i));
+    }
+    ASSERT_FALSE(ok);
+    ASSERT_TRUE(sort_ctx.is_memory_exceeded());
+    ASSERT_TRUE(sorted.Finish() == nullptr);
+}
+
+TEST_F(SpillHandlerTest, sorted_table_spill_test) {
+    for (bool is_asc : {true, false}) {
+        RunnerContext ctx(nullptr, Row(), false);
+        ctx.SetMemoryBudget(4096, "/tmp");
+        SortedTableBuilder builder(nullptr, &ctx, is_asc);
+        // the keys repeat, the rows of a key keep their order
+        for (uint64_t i = 0; i < 3000; i++) {
+            ASSERT_TRUE(builder.AddRow((i * 7919) % 500, BuildRow(i)));
+        }
+        auto table = builder.Finish();
+        ASSERT_TRUE(table != nullptr);
+        ASSERT_EQ("SpillTableHandler", table->GetHandlerTypeName());
+        ASSERT_EQ(3000u, table->GetCount());
+        ASSERT_EQ(is_asc ? kAscOrder : kDescOrder, table->GetOrderType());
+        ASSERT_GT(ctx.spill_bytes(), 0u);
+
+        std::vector<std::pair<uint64_t, uint64_t>> expect;
+        for (uint64_t i = 0; i < 3000; i++) {
+            expect.emplace_back((i * 7919) % 500, i);
+        }
+        std::stable_sort(expect.begin(), expect.end(),
+                         [is_asc](const std::pair<uint64_t, uint64_t>& l,
+                                  const std::pair<uint64_t, uint64_t>& r) {
+                             return is_asc ? l.first < r.first
+                                           : l.first > r.first;
+                         });
+        auto iter = table->GetIterator();
+        iter->SeekToFirst();
+        for (auto& pair : expect) {
+            ASSERT_TRUE(iter->Valid());
+            ASSERT_EQ(pair.first, iter->GetKey());
+            ASSERT_EQ(BuildRow(pair.second).ToString(),
+                      iter->GetValue().ToString());
+            iter->Next();
+        }
+        ASSERT_FALSE(iter->Valid());
+        ASSERT_EQ(BuildRow(expect[100].second).ToString(),
+                  table->At(100).ToString());
+    }
+}
+
+}  // namespace vm
+}  // namespace hybridse
+int main(int argc, char** argv) {
+    ::testing::GTEST_FLAG(color) = "yes";
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -16,6 +16,7 @@
 
 #include "vm/sql_compiler.h"
 #include <memory>
+#include <set>
 #include <utility>
 #include <vector>
 #include "boost/filesystem.hpp"
@@ -124,7 +125,8 @@ bool SqlCompiler::Compile(SqlContext& ctx, Status& status) {  // NOLINT
     }
     InitBuiltinJitSymbols(jit.get());
     ctx.udf_library->InitJITSymbols(jit.get());
-    if (!jit->OptModule(m.get())) {
+    // a cached object is compiled from the optimized module already
+    if (!jit->LookupObjectCache(m.get()) && !jit->OptModule(m.get())) {
         LOG(WARNING) << "fail to opt ir module for sql " << ctx.sql;
         return false;
     }
@@ -282,7 +284,11 @@ bool SqlCompiler::BuildClusterJob(SqlContext& ctx, Status& status) {  // NOLINT
     RunnerBuilder runner_builder(&ctx.nm, ctx.sql,
                                  ctx.is_cluster_optimized && is_request_mode,
                                  ctx.batch_request_info.common_column_indices,
-                                 ctx.batch_request_info.common_node_set);
+                                 ctx.batch_request_info.common_node_set,
+                                 vm::kBatchMode == ctx.engine_mode ? ctx.batch_window_thread_num : 1,
+                                 ctx.enable_runner_stats);
+    runner_builder.set_window_split_rows(ctx.batch_window_split_rows);
+    runner_builder.set_window_sample_sizes(ctx.window_sample_sizes);
     ctx.cluster_job = runner_builder.BuildClusterJob(ctx.physical_plan, status);
     return status.isOK();
 }
@@ -386,5 +392,55 @@ bool SqlCompiler::ResolvePlanFnAddress(vm::PhysicalOpNode* node,
     return true;
 }
 
+static void PrintPlanFnSymbols(const PhysicalOpNode* node,
+                               std::ostream& output,
+                               std::set<size_t>* visited_ids) {
+    if (node == nullptr || !visited_ids->insert(node->node_id()).second) {
+        return;
+    }
+    for (auto info : node->GetFnInfos()) {
+        if (info->fn_name().empty()) {
+            continue;
+        }
+        output << info->fn_name() << " addr="
+               << reinterpret_cast<const void*>(info->fn_ptr())
+               << " node=" << node->node_id() << " "
+               << PhysicalOpTypeName(node->GetOpType()) << " columns=";
+        for (int i = 0; i < info->fn_schema()->size(); i++) {
+            output << (i > 0 ? "," : "") << info->fn_schema()->Get(i).name();
+        }
+        output << "\n";
+    }
+    for (auto producer : node->producers()) {
+        PrintPlanFnSymbols(producer, output, visited_ids);
+    }
+    // the plans of the windows are not producers, as the fn address resolving
+    if (node->GetOpType() == kPhysicalOpRequestUnion) {
+        auto request_union_op =
+            dynamic_cast<const PhysicalRequestUnionNode*>(node);
+        for (auto& window_union :
+             request_union_op->window_unions_.window_unions_) {
+            PrintPlanFnSymbols(window_union.first, output, visited_ids);
+        }
+    } else if (node->GetOpType() == kPhysicalOpProject &&
+               dynamic_cast<const PhysicalProjectNode*>(node)->project_type_ ==
+                   kWindowAggregation) {
+        auto window_agg_op =
+            dynamic_cast<const PhysicalWindowAggrerationNode*>(node);
+        for (auto& window_join : window_agg_op->window_joins_.window_joins_) {
+            PrintPlanFnSymbols(window_join.first, output, visited_ids);
+        }
+        for (auto& window_union :
+             window_agg_op->window_unions_.window_unions_) {
+            PrintPlanFnSymbols(window_union.first, output, visited_ids);
+        }
+    }
+}
+
+void SqlCompileInfo::DumpFnSymbols(std::ostream& output) {
+    std::set<size_t> visited_ids;
+    PrintPlanFnSymbols(sql_ctx.physical_plan, output, &visited_ids);
+}
+
 }  // namespace vm
 }  // namespace hybridse
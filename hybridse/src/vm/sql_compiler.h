@@ -17,6 +17,8 @@
 #ifndef SRC_VM_SQL_COMPILER_H_
 #define SRC_VM_SQL_COMPILER_H_
 
+#include <atomic>
+#include <map>
 #include <memory>
 #include <set>
 #include <string>
@@ -29,6 +31,7 @@
 #include "vm/engine_context.h"
 #include "vm/jit_wrapper.h"
 #include "vm/physical_op.h"
+#include "vm/request_result_cache.h"
 #include "vm/runner.h"
 
 namespace hybridse {
@@ -44,6 +47,16 @@ struct SqlContext {
     bool is_batch_request_optimized = false;
     bool enable_expr_optimize = false;
     bool enable_batch_window_parallelization = false;
+    // the thread num to run window aggregation across partition keys in batch mode
+    uint32_t batch_window_thread_num = 1;
+    // the min rows of a partition key to split it across the window threads
+    uint32_t batch_window_split_rows = 0;
+    // the sample sizes of the request windows by the window names
+    std::map<std::string, uint64_t> window_sample_sizes;
+    // the max threads to run the branches of a request mode sql
+    uint32_t request_branch_thread_num = 1;
+    // record the runs of the runners per physical node
+    bool enable_runner_stats = false;
 
     // the sql content
     std::string sql;
@@ -71,6 +84,11 @@ struct SqlContext {
     ::hybridse::udf::UdfLibrary* udf_library = nullptr;
 
     ::hybridse::vm::BatchRequestInfo batch_request_info;
+    // the max bytes allocated by the jit runtime in a run step of the request
+    // mode runs, reserved by the runtime before the next runs
+    std::atomic<uint64_t> run_step_bytes{0};
+    // the results of the request mode runs, null if disabled
+    std::shared_ptr<hybridse::vm::RequestResultCache> request_result_cache = nullptr;
 
     SqlContext() {}
     ~SqlContext() {}
@@ -130,6 +148,11 @@ class SqlCompileInfo : public CompileInfo {
     virtual void DumpClusterJob(std::ostream& output, const std::string& tab) {
         sql_ctx.cluster_job.Print(output, tab);
     }
+    virtual void DumpRunnerStats(std::ostream& output) {
+        sql_ctx.cluster_job.PrintStats(output);
+    }
+    virtual void ResetRunnerStats() { sql_ctx.cluster_job.ResetStats(); }
+    virtual void DumpFnSymbols(std::ostream& output);
     static SqlCompileInfo* CastFrom(CompileInfo* node) {
         return dynamic_cast<SqlCompileInfo*>(node);
     }
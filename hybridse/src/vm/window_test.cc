@@ -1546,6 +1546,86 @@ TEST_F(RequestUnionWindowTest, RequestRowsMergeRowsRangeWindowTest) {
             window_range, keys, current_key, exp_keys, exclude_current_time));
     }
 }
+TEST_F(RequestUnionWindowTest, SharedWindowTest) {
+    Row row;
+    auto table = std::make_shared<MemTimeTableHandler>();
+    std::vector<uint64_t> keys(
+        {20L, 18L, 17L, 15L, 15L, 14L, 12L, 9L, 8L, 8L, 5L, 3L, 2L, 1L});
+    for (uint64_t key : keys) {
+        table->AddRow(key, row);
+    }
+    // the frames of the windows sharing the merged window
+    std::vector<WindowRange> window_ranges = {
+        WindowRange::CreateRowsWindow(3), WindowRange::CreateRowsWindow(8),
+        WindowRange::CreateRowsRangeWindow(-5, 0),
+        WindowRange::CreateRowsRangeWindow(-10, 0, 4),
+        WindowRange::CreateRowsMergeRowsRangeWindow(-2, 6)};
+    WindowRange merged = WindowRange::CreateRowsMergeRowsRangeWindow(-10, 8);
+    auto keys_of = [](std::shared_ptr<TableHandler> window) {
+        std::vector<uint64_t> window_keys;
+        auto iter = window->GetIterator();
+        iter->SeekToFirst();
+        while (iter->Valid()) {
+            window_keys.push_back(iter->GetKey());
+            iter->Next();
+        }
+        return window_keys;
+    };
+    for (uint64_t current_key : {21L, 15L, 9L, 2L}) {
+        for (bool exclude_current_time : {false, true}) {
+            auto shared = RequestUnionRunner::RequestUnionWindow(
+                row, {table}, current_key, merged, false,
+                exclude_current_time);
+            ASSERT_TRUE(shared != nullptr);
+            for (const auto& window_range : window_ranges) {
+                auto window = RequestUnionRunner::RequestUnionWindow(
+                    row, {table}, current_key, window_range, true,
+                    exclude_current_time);
+                auto window_of_shared = RequestUnionRunner::RequestUnionWindow(
+                    row, {shared}, current_key, window_range, true,
+                    exclude_current_time);
+                ASSERT_EQ(keys_of(window), keys_of(window_of_shared))
+                    << "current key " << current_key << ", exclude "
+                    << exclude_current_time;
+            }
+        }
+    }
+}
+TEST_F(RequestUnionWindowTest, SampleWindowTest) {
+    Row row;
+    std::vector<uint64_t> keys;
+    for (uint64_t key = 100; key > 0; key--) {
+        keys.push_back(key);
+    }
+    WindowRange window_range = WindowRange::CreateRowsRangeWindow(-1000, 0);
+    {
+        // the window not larger than the sample size isn't sampled
+        window_range.sample_size_ = 200;
+        auto table = std::make_shared<MemTimeTableHandler>();
+        for (uint64_t key : keys) {
+            table->AddRow(key, row);
+        }
+        auto window = RequestUnionRunner::RequestUnionWindow(
+            row, {table}, 101, window_range, true, false);
+        ASSERT_EQ(101u, window->GetCount());
+        ASSERT_DOUBLE_EQ(1.0, window->GetSampleScale());
+    }
+    {
+        // the rows are kept with the stride doubled to 16
+        window_range.sample_size_ = 8;
+        std::vector<uint64_t> exp_keys(
+            {101L, 100L, 84L, 68L, 52L, 36L, 20L, 4L});
+        ASSERT_NO_FATAL_FAILURE(
+            CHECK_REQUEST_UNION_WINDOW(window_range, keys, 101, exp_keys));
+        auto table = std::make_shared<MemTimeTableHandler>();
+        for (uint64_t key : keys) {
+            table->AddRow(key, row);
+        }
+        auto window = RequestUnionRunner::RequestUnionWindow(
+            row, {table}, 101, window_range, true, false);
+        ASSERT_DOUBLE_EQ(101.0 / 8, window->GetSampleScale());
+    }
+}
 }  // namespace vm
 }  // namespace hybridse
 int main(int argc, char** argv) {
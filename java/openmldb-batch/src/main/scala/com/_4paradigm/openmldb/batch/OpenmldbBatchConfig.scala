@@ -111,6 +111,10 @@ class OpenmldbBatchConfig extends Serializable {
   @ConfigOption(name="openmldb.unsaferow.opt", doc="Enable UnsafeRow optimization or not")
   var enableUnsafeRowOptimization = false
 
+  @ConfigOption(name="openmldb.unsaferow.opt.batch.size",
+    doc="The number of UnsafeRows projected in one native call with UnsafeRow optimization")
+  var unsafeRowBatchSize = 1024
+
   // Switch for disable OpenMLDB
   @ConfigOption(name="openmldb.disable", doc="Disable OpenMLDB optimization or not")
   var disableOpenmldb = false
@@ -119,6 +123,12 @@ class OpenmldbBatchConfig extends Serializable {
   @ConfigOption(name="openmldb.hybridse.jsdk.path", doc="The path of HybridSE jsdk core file path")
   var hybridseJsdkLibraryPath = ""
 
+  @ConfigOption(name="openmldb.jit.shipObject", doc="""
+      | Compile the sql on the driver once and ship the jit objects to the executors, which load them instead of
+      | compiling the sql again
+    """)
+  var enableJitObjectShipping = false
+
   @ConfigOption("openmldb.enable.hive.metastore", "Need to set hive.metastore.uris")
   var enableHiveMetaStore = false
 
@@ -30,7 +30,8 @@ import com._4paradigm.openmldb.batch.nodes.{
   ConstProjectPlan, DataProviderPlan, GroupByAggregationPlan,
   GroupByPlan, JoinPlan, LimitPlan, SortByPlan, RenamePlan, RowProjectPlan, SimpleProjectPlan, WindowAggPlan
 }
-import com._4paradigm.openmldb.batch.utils.{GraphvizUtil, HybridseUtil, NodeIndexInfo, NodeIndexType}
+import com._4paradigm.openmldb.batch.utils.{GraphvizUtil, HybridseUtil, JitObjectUtil, NodeIndexInfo,
+  NodeIndexType}
 import org.apache.hadoop.fs.{FileSystem, Path}
 import org.apache.spark.sql.{DataFrame, SparkSession}
 import org.slf4j.LoggerFactory
@@ -75,6 +76,9 @@ class SparkPlanner(session: SparkSession, config: OpenmldbBatchConfig, dbName: S
     withSQLEngine(sql, HybridseUtil.getDatabase(dbName, tableDict), config) { engine =>
       val irBuffer = engine.getIrBuffer
       planCtx.setModuleBuffer(irBuffer)
+      if (config.enableJitObjectShipping) {
+        JitObjectUtil.shipModule(session, irBuffer)
+      }
 
       val root = engine.getPlan
       logger.info("Get HybridSE physical plan: ")
@@ -20,7 +20,7 @@ import com._4paradigm.hybridse.codec.{Row => NativeRow}
 import com._4paradigm.hybridse.sdk.JitManager
 import com._4paradigm.hybridse.vm.{CoreAPI, GroupbyInterface, PhysicalGroupAggrerationNode}
 import com._4paradigm.openmldb.batch.nodes.RowProjectPlan.ProjectConfig
-import com._4paradigm.openmldb.batch.utils.{HybridseUtil, SparkColumnUtil}
+import com._4paradigm.openmldb.batch.utils.{HybridseUtil, JitObjectUtil, SparkColumnUtil}
 import com._4paradigm.openmldb.batch.{PlanContext, SparkInstance, SparkRowCodec}
 import org.apache.spark.sql.types.LongType
 import org.apache.spark.sql.{Column, Row}
@@ -91,6 +91,7 @@ object GroupByAggregationPlan {
         val tag = projectConfig.moduleTag
         val buffer = projectConfig.moduleNoneBroadcast.getBuffer
 
+        JitObjectUtil.useShippedObjects()
         if (hybridseJsdkLibraryPath.equals("")) {
           JitManager.initJitModule(tag, buffer)
         } else {
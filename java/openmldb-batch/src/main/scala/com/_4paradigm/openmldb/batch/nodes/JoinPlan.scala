@@ -22,7 +22,7 @@ import com._4paradigm.hybridse.codec.RowView
 import com._4paradigm.hybridse.sdk.{HybridSeException, JitManager, SerializableByteBuffer}
 import com._4paradigm.hybridse.node.{ExprListNode, JoinType}
 import com._4paradigm.hybridse.vm.{CoreAPI, HybridSeJitWrapper, PhysicalJoinNode}
-import com._4paradigm.openmldb.batch.utils.{HybridseUtil, SparkColumnUtil, SparkRowUtil, SparkUtil}
+import com._4paradigm.openmldb.batch.utils.{HybridseUtil, JitObjectUtil, SparkColumnUtil, SparkRowUtil, SparkUtil}
 import com._4paradigm.openmldb.batch.{PlanContext, SparkInstance, SparkRowCodec}
 import org.apache.spark.sql.catalyst.encoders.RowEncoder
 import org.apache.spark.sql.types.StructType
@@ -243,6 +243,7 @@ object JoinPlan {
       // ensure worker native
       val buffer = moduleBroadcast.getBuffer
 
+      JitObjectUtil.useShippedObjects()
       if (hybridseJsdkLibraryPath.equals("")) {
         JitManager.initJitModule(moduleTag, buffer)
       } else {
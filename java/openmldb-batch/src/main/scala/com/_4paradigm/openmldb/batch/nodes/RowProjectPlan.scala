@@ -19,10 +19,10 @@ package com._4paradigm.openmldb.batch.nodes
 import com._4paradigm.hybridse.codec
 import com._4paradigm.hybridse.sdk.{JitManager, SerializableByteBuffer}
 import com._4paradigm.hybridse.vm.{CoreAPI, PhysicalTableProjectNode}
-import com._4paradigm.openmldb.batch.utils.{AutoDestructibleIterator, HybridseUtil, SparkUtil, UnsafeRowUtil}
+import com._4paradigm.openmldb.batch.utils.{AutoDestructibleIterator, HybridseUtil, JitObjectUtil, SparkUtil,
+  UnsafeRowUtil}
 import com._4paradigm.openmldb.batch.{PlanContext, SparkInstance, SparkRowCodec}
 import org.apache.spark.sql.Row
-import org.apache.spark.sql.catalyst.expressions.UnsafeRow
 import org.apache.spark.sql.types.{LongType, StructType}
 import org.slf4j.LoggerFactory
 
@@ -69,6 +69,7 @@ object RowProjectPlan {
     }
 
     val hybridseJsdkLibraryPath = ctx.getConf.hybridseJsdkLibraryPath
+    val unsafeRowBatchSize = ctx.getConf.unsafeRowBatchSize
 
     val outputDf = if (ctx.getConf.enableUnsafeRowOptimization) { // Use UnsafeRow optimization
 
@@ -76,6 +77,7 @@ object RowProjectPlan {
         val tag = projectConfig.moduleTag
         val buffer = projectConfig.moduleNoneBroadcast.getBuffer
 
+        JitObjectUtil.useShippedObjects()
         if (hybridseJsdkLibraryPath.equals("")) {
           JitManager.initJitModule(tag, buffer)
         } else {
@@ -85,23 +87,29 @@ object RowProjectPlan {
         val jit = JitManager.getJit(tag)
         val fn = jit.FindFunction(projectConfig.functionName)
 
-        partitionIter.map(internalRow => {
-          val inputRowSize = internalRow.asInstanceOf[UnsafeRow].getBytes.size
+        // Project the rows in batches to call the native method once per batch
+        Iterator.continually(UnsafeRowUtil.nextHybridseRowBatch(partitionIter, unsafeRowBatchSize))
+          .takeWhile(_.rowCnt > 0)
+          .flatMap(batch => {
+            val outputOffsets = new Array[Int](batch.rowCnt + 1)
 
-          // Create native method input from Spark InternalRow
-          val hybridseRowBytes = UnsafeRowUtil.internalRowToHybridseRowBytes(internalRow)
+            // Call native method to compute
+            val outputHybridseRow = CoreAPI.UnsafeRowProjectBatch(fn, batch.bytes, batch.offsets, batch.rowCnt,
+              outputOffsets)
+            if (outputHybridseRow.empty()) {
+              outputHybridseRow.delete()
+              throw new RuntimeException("Fail to project the UnsafeRows with function " + projectConfig.functionName)
+            }
 
-          // Call native method to compute
-          val outputHybridseRow = CoreAPI.UnsafeRowProject(fn, hybridseRowBytes, inputRowSize, false)
+            // Call methods to generate Spark InternalRow
+            val outputInternalRows = UnsafeRowUtil.hybridseRowBatchToInternalRows(outputHybridseRow, outputOffsets,
+              batch.rowCnt, outputSchema.size)
 
-          // Call methods to generate Spark InternalRow
-          val ouputInternalRow = UnsafeRowUtil.hybridseRowToInternalRow(outputHybridseRow, outputSchema.size)
+            // TODO: Add index column if needed
 
-          // TODO: Add index column if needed
-
-          outputHybridseRow.delete()
-          ouputInternalRow
-        })
+            outputHybridseRow.delete()
+            outputInternalRows
+          })
 
       })
 
@@ -114,6 +122,7 @@ object RowProjectPlan {
         val tag = projectConfig.moduleTag
         val buffer = projectConfig.moduleNoneBroadcast
 
+        JitObjectUtil.useShippedObjects()
         if (hybridseJsdkLibraryPath.equals("")) {
           JitManager.initJitModule(tag, buffer.getBuffer)
         } else {
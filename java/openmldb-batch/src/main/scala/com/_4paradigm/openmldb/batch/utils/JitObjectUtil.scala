@@ -0,0 +1,82 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package com._4paradigm.openmldb.batch.utils
+
+import java.io.File
+import java.nio.ByteBuffer
+import java.nio.file.Files
+
+import com._4paradigm.hybridse.sdk.JitManager
+import org.apache.spark.SparkFiles
+import org.apache.spark.sql.SparkSession
+import org.slf4j.LoggerFactory
+
+import scala.collection.mutable
+
+/**
+ * Ship the jit objects compiled on the driver to the executors.
+ *
+ * The driver compiles the module into the object cache format and adds the objects to the files of the spark
+ * context, the executors use the dir of the spark files as the object cache dir, so they load the object instead
+ * of compiling the module again. An object is keyed by the host cpu, the executors on the other kinds of hosts
+ * do not find it and compile the module as before.
+ */
+object JitObjectUtil {
+
+  private val logger = LoggerFactory.getLogger(this.getClass)
+
+  // the file names of the objects in the object cache
+  private val objectPrefix = "hybridse_obj_"
+  private val objectSuffix = ".o"
+
+  private val shippedObjects = mutable.HashSet[String]()
+
+  private def isObject(name: String): Boolean = name.startsWith(objectPrefix) && name.endsWith(objectSuffix)
+
+  def shipModule(sess: SparkSession, moduleBuffer: ByteBuffer): Unit = {
+    val dir = Files.createTempDirectory("openmldb_jit_objects").toFile
+    dir.deleteOnExit()
+    JitManager.compileModule(moduleBuffer, dir.getAbsolutePath)
+    val objects = Option(dir.listFiles()).getOrElse(Array.empty[File]).filter(f => isObject(f.getName))
+    if (objects.isEmpty) {
+      logger.warn("No jit object is compiled, the executors compile the module by themselves")
+    }
+    shippedObjects.synchronized {
+      objects.foreach(obj => {
+        obj.deleteOnExit()
+        // the objects of the same name are the same
+        if (shippedObjects.add(obj.getName)) {
+          logger.info("Ship jit object " + obj.getName)
+          sess.sparkContext.addFile(obj.getAbsolutePath)
+        }
+      })
+    }
+  }
+
+  /**
+   * Load the shipped objects in the jits created from now on, call it on the executors before the jit module
+   * is initialized.
+   */
+  def useShippedObjects(): Unit = {
+    val root = new File(SparkFiles.getRootDirectory())
+    val names = Option(root.list()).getOrElse(Array.empty[String])
+    if (names.exists(isObject)) {
+      JitManager.setObjectCacheDir(root.getAbsolutePath)
+    }
+  }
+
+}
@@ -16,6 +16,7 @@
 
 package com._4paradigm.openmldb.batch.utils
 
+import java.io.ByteArrayOutputStream
 import java.nio.ByteBuffer
 
 import com._4paradigm.hybridse.codec.Row
@@ -23,6 +24,10 @@ import com._4paradigm.hybridse.vm.CoreAPI
 import org.apache.spark.sql.catalyst.InternalRow
 import org.apache.spark.sql.catalyst.expressions.UnsafeRow
 import org.apache.spark.sql.catalyst.expressions.codegen.UnsafeRowWriter
+import org.apache.spark.unsafe.Platform
+
+/** The HybridSE row bytes of a batch of rows, the i-th row is at [offsets(i), offsets(i + 1)) of bytes. */
+case class HybridseRowBatch(bytes: Array[Byte], offsets: Array[Int], rowCnt: Int)
 
 object UnsafeRowUtil {
 
@@ -45,6 +50,42 @@ object UnsafeRowUtil {
   }
 
 
+  /** Pack the next rows of a partition into HybridSE row bytes, at most batchSize rows.
+   *
+   * The bytes of each row are copied once it is read, so the UnsafeRow reused by the iterator is safe.
+   */
+  def nextHybridseRowBatch(iter: Iterator[InternalRow], batchSize: Int): HybridseRowBatch = {
+    val offsets = new Array[Int](batchSize + 1)
+    val buffer = new ByteArrayOutputStream()
+    val hybridseRowHeaderBytes = new Array[Byte](HybridseRowHeaderSize)
+    var rowCnt = 0
+    while (rowCnt < batchSize && iter.hasNext) {
+      val unsafeRow = iter.next().asInstanceOf[UnsafeRow]
+      offsets(rowCnt) = buffer.size()
+      // No need to set version and size in header
+      buffer.write(hybridseRowHeaderBytes)
+      buffer.write(unsafeRow.getBytes)
+      rowCnt += 1
+    }
+    offsets(rowCnt) = buffer.size()
+    HybridseRowBatch(buffer.toByteArray, offsets, rowCnt)
+  }
+
+  /** Convert the HybridSE row packed by CoreAPI.UnsafeRowProjectBatch to Spark InternalRows.
+   *
+   * The output UnsafeRows are copied out in one call and point to the same byte array.
+   */
+  def hybridseRowBatchToInternalRows(hybridseRow: Row, outputOffsets: Array[Int], rowCnt: Int,
+                                     columnNum: Int): Iterator[InternalRow] = {
+    val bytes = new Array[Byte](outputOffsets(rowCnt))
+    CoreAPI.CopyRowToUnsafeRowBytes(hybridseRow, bytes, bytes.length)
+    (0 until rowCnt).iterator.map(i => {
+      val unsafeRow = new UnsafeRow(columnNum)
+      unsafeRow.pointTo(bytes, Platform.BYTE_ARRAY_OFFSET + outputOffsets(i), outputOffsets(i + 1) - outputOffsets(i))
+      unsafeRow.asInstanceOf[InternalRow]
+    })
+  }
+
   /** Convert HybridSE row to Spark InternalRow.
    *
    * The HybridSE row is compatible with UnsafeRow bytes but has 6 bytes as header.
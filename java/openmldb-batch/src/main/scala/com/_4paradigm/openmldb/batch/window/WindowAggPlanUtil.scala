@@ -20,7 +20,7 @@ import com._4paradigm.hybridse.node.FrameType
 import com._4paradigm.hybridse.sdk.{HybridSeException, JitManager, SerializableByteBuffer}
 import com._4paradigm.hybridse.vm.PhysicalWindowAggrerationNode
 import com._4paradigm.hybridse.vm.Window.WindowFrameType
-import com._4paradigm.openmldb.batch.utils.{HybridseUtil, SparkColumnUtil, SparkUtil}
+import com._4paradigm.openmldb.batch.utils.{HybridseUtil, JitObjectUtil, SparkColumnUtil, SparkUtil}
 import com._4paradigm.openmldb.batch.{PlanContext, OpenmldbBatchConfig, SparkInstance}
 import org.apache.hadoop.fs.FileSystem
 import org.apache.spark.sql.{DataFrame, functions}
@@ -208,6 +208,7 @@ object WindowAggPlanUtil {
     // get jit in executor process
     val tag = config.moduleTag
     val buffer = config.moduleNoneBroadcast.getBuffer
+    JitObjectUtil.useShippedObjects()
     JitManager.initJitModule(tag, buffer)
     val jit = JitManager.getJit(tag)
 
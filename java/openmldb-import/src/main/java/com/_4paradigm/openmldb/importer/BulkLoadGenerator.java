@@ -38,6 +38,9 @@ import java.util.Map;
 import java.util.Set;
 import java.util.concurrent.ArrayBlockingQueue;
 import java.util.concurrent.BlockingQueue;
+import java.util.concurrent.ExecutorService;
+import java.util.concurrent.Executors;
+import java.util.concurrent.Semaphore;
 import java.util.concurrent.TimeUnit;
 import java.util.concurrent.atomic.AtomicBoolean;
 import java.util.concurrent.atomic.AtomicInteger;
@@ -75,10 +78,20 @@ public class BulkLoadGenerator implements Runnable {
     private final DataRegionBuilder dataRegionBuilder;
     private final IndexRegionBuilder indexRegionBuilder;
     private final TabletService service;
+    // The tablet needs the parts of a MemTable in order, so they are sent one by one by the sender thread. The next
+    // parts are built while the previous ones are in flight, at most maxPendingRequests parts are waiting.
+    private final ExecutorService sender;
+    private final int maxPendingRequests;
+    private final Semaphore pendingRequests;
 
     private int statistics = 0;
 
     public BulkLoadGenerator(int tid, int pid, NS.TableInfo tableInfo, Tablet.BulkLoadInfoResponse indexInfo, TabletService service, int rpcSizeLimit) {
+        this(tid, pid, tableInfo, indexInfo, service, rpcSizeLimit, 1);
+    }
+
+    public BulkLoadGenerator(int tid, int pid, NS.TableInfo tableInfo, Tablet.BulkLoadInfoResponse indexInfo,
+                             TabletService service, int rpcSizeLimit, int maxPendingRequests) {
         this.tid = tid;
         this.pid = pid;
         this.queue = new ArrayBlockingQueue<>(1000);
@@ -89,6 +102,9 @@ public class BulkLoadGenerator implements Runnable {
         // TODO(hw): size limit improve
         this.indexRegionBuilder = new IndexRegionBuilder(tid, pid, indexInfoFromTablet, rpcSizeLimit); // built from BulkLoadInfoResponse
         this.service = service;
+        this.sender = Executors.newSingleThreadExecutor();
+        this.maxPendingRequests = Math.max(1, maxPendingRequests);
+        this.pendingRequests = new Semaphore(this.maxPendingRequests);
     }
 
     @Override
@@ -100,6 +116,9 @@ public class BulkLoadGenerator implements Runnable {
             long startTime = System.currentTimeMillis();
             long realGenTime = 0;
             while (!shutdown.get() || !queue.isEmpty()) {
+                if (hasInternalError()) {
+                    throw new RuntimeException("send bulk load request failed");
+                }
                 FeedItem item = queue.poll(pollTimeout, TimeUnit.MILLISECONDS);
                 if (item == null) {
                     // poll timeout, queue is still empty
@@ -205,7 +224,7 @@ public class BulkLoadGenerator implements Runnable {
                 ByteArrayOutputStream attachmentStream = new ByteArrayOutputStream();
                 Tablet.BulkLoadRequest request = dataRegionBuilder.buildPartialRequest(false, attachmentStream);
                 if (request != null) {
-                    sendRequest(request, attachmentStream);
+                    sendRequestAsync(request, attachmentStream);
                 }
 
                 long realEndTime = System.currentTimeMillis();
@@ -215,7 +234,7 @@ public class BulkLoadGenerator implements Runnable {
             ByteArrayOutputStream attachmentStream = new ByteArrayOutputStream();
             Tablet.BulkLoadRequest request = dataRegionBuilder.buildPartialRequest(true, attachmentStream);
             if (request != null) {
-                sendRequest(request, attachmentStream);
+                sendRequestAsync(request, attachmentStream);
             }
             Preconditions.checkState(dataRegionBuilder.buildPartialRequest(true, attachmentStream)
                     == null, "shouldn't has more data to send");
@@ -224,6 +243,7 @@ public class BulkLoadGenerator implements Runnable {
             logger.info("Thread {} for MemTable(tid-pid {}-{}), generate cost {} ms, real cost {} ms",
                     Thread.currentThread().getId(), tid, pid, generateTime - startTime, realGenTime);
 
+            waitPendingRequests();
             if (dataRegionBuilder.getNextPartId() == 0) {
                 logger.info("no data sent, skip index region");
                 return;
@@ -236,8 +256,9 @@ public class BulkLoadGenerator implements Runnable {
             while ((req = indexRegionBuilder.buildPartialRequest()) != null) {
                 logger.info("send index region part {}, eof {}, size {}", req.getPartId(), req.getEof(), req.getSerializedSize());
                 logger.debug("{}", req);
-                sendRequest(req, null);
+                sendRequestAsync(req, null);
             }
+            waitPendingRequests();
             long endTime = System.currentTimeMillis();
             logger.info("index region cost {} ms", endTime - generateTime);
 
@@ -246,6 +267,8 @@ public class BulkLoadGenerator implements Runnable {
             logger.error("Thread {} for MemTable(tid-pid {}-{}) got err: {}. Exit...", Thread.currentThread().getId(), tid, pid, e.getMessage());
             internalErrorOcc.set(true);
             e.printStackTrace();
+        } finally {
+            sender.shutdownNow();
         }
     }
 
@@ -264,14 +287,40 @@ public class BulkLoadGenerator implements Runnable {
         return dataBuffer;
     }
 
-    private void sendRequest(Tablet.BulkLoadRequest request, ByteArrayOutputStream attachmentStream) {
-        byte[] attachment = null;
-        if (attachmentStream != null) {
-            attachment = attachmentStream.toByteArray();
+    // The attachment stream is reused by the builder, so it's copied before the request is queued.
+    private void sendRequestAsync(Tablet.BulkLoadRequest request, ByteArrayOutputStream attachmentStream)
+            throws InterruptedException {
+        byte[] attachment = attachmentStream == null ? null : attachmentStream.toByteArray();
+        pendingRequests.acquire();
+        sender.execute(() -> {
+            try {
+                // skip the rest parts if one part failed, the tablet won't accept them
+                if (!hasInternalError()) {
+                    sendRequest(request, attachment);
+                }
+            } catch (Exception e) {
+                logger.error("MemTable(tid-pid {}-{}) send part {} failed: {}", tid, pid, request.getPartId(),
+                        e.getMessage());
+                internalErrorOcc.set(true);
+            } finally {
+                pendingRequests.release();
+            }
+        });
+    }
+
+    private void waitPendingRequests() throws InterruptedException {
+        pendingRequests.acquire(maxPendingRequests);
+        pendingRequests.release(maxPendingRequests);
+        if (hasInternalError()) {
+            throw new RuntimeException("send bulk load request failed");
         }
+    }
+
+    // RpcContext is thread local, the attachment is set in the sender thread.
+    private void sendRequest(Tablet.BulkLoadRequest request, byte[] attachment) {
         RpcContext.getContext().setRequestBinaryAttachment(attachment);
         logger.info("send rpc, message size {}, attachment {}", request.getSerializedSize(),
-                attachmentStream == null ? "empty" : attachmentStream.size());
+                attachment == null ? "empty" : attachment.length);
 
         // com.baidu.brpc.exceptions.RpcException will be thrown up, generator run() will fail immediately
         Tablet.GeneralResponse response = service.bulkLoad(request);
@@ -84,7 +84,12 @@ public class Importer {
     @CommandLine.Option(names = "--rpc_size_limit", description = "should >= " + rpcDataSizeMinLimit, defaultValue = rpcDataSizeMinLimit)
     private int rpcDataSizeLimit;
 
-    FilesReader reader = null;
+    @CommandLine.Option(names = "--reader_threads", description = "the files are read and parsed by the threads", defaultValue = "1")
+    private int readerThreads;
+    @CommandLine.Option(names = "--pending_rpc_per_partition", description = "the max bulk load requests of a partition which are built and waiting to be sent", defaultValue = "2")
+    private int pendingRpcPerPartition;
+
+    List<FilesReader> readers = new ArrayList<>();
     SqlExecutor router = null;
 
     // src: file paths
@@ -96,7 +101,16 @@ public class Importer {
             logger.info("config 'files' is empty");
             return false;
         }
-        reader = new FilesReader(files);
+        // the files are assigned to the readers in turn, a file is read by one reader only
+        int readerNum = Math.max(1, Math.min(readerThreads, files.size()));
+        List<List<String>> readerFiles = new ArrayList<>();
+        for (int i = 0; i < readerNum; i++) {
+            readerFiles.add(new ArrayList<>());
+        }
+        for (int i = 0; i < files.size(); i++) {
+            readerFiles.get(i % readerNum).add(files.get(i));
+        }
+        readers = readerFiles.stream().map(FilesReader::new).collect(Collectors.toList());
         return true;
     }
 
@@ -178,7 +192,7 @@ public class Importer {
 
                 // generate & send requests by BulkLoadGenerator
                 // we need schema to parsing raw data in generator, got from NS.TableInfo
-                BulkLoadGenerator generator = new BulkLoadGenerator(tableMetaData.getTid(), partition.getPid(), tableMetaData, bulkLoadInfo, tabletService, rpcDataSizeLimit);
+                BulkLoadGenerator generator = new BulkLoadGenerator(tableMetaData.getTid(), partition.getPid(), tableMetaData, bulkLoadInfo, tabletService, rpcDataSizeLimit, pendingRpcPerPartition);
                 generators.put(partition.getPid(), generator);
                 threads.add(new Thread(generator));
 
@@ -200,20 +214,18 @@ public class Importer {
         Map<Integer, List<Integer>> keyIndexMap = new HashMap<>();
         Set<Integer> tsIdxSet = new HashSet<>();
         parseIndexMapAndTsSet(tableMetaData, keyIndexMap, tsIdxSet);
-        try {
-            CSVRecord record;
-            while ((record = reader.next()) != null) {
-                Map<Integer, List<Tablet.Dimension>> dims = buildDimensions(record, keyIndexMap, tableMetaData.getPartitionNum());
-
-                // distribute the row to the bulk load generators for each MemTable(tid, pid)
-                for (Integer pid : dims.keySet()) {
-                    // Note: NS pid is int
-                    // no need to calc dims twice, pass it to BulkLoadGenerator
-                    generators.get(pid).feed(new BulkLoadGenerator.FeedItem(dims, tsIdxSet, record));
-                }
+        // The readers feed the generators concurrently, the rows of a partition may be fed in any order.
+        List<Thread> readerThreadList = new ArrayList<>();
+        for (FilesReader reader : readers) {
+            readerThreadList.add(new Thread(() -> feed(reader, generators, keyIndexMap, tsIdxSet, tableMetaData.getPartitionNum())));
+        }
+        readerThreadList.forEach(Thread::start);
+        for (Thread thread : readerThreadList) {
+            try {
+                thread.join();
+            } catch (InterruptedException e) {
+                e.printStackTrace();
             }
-        } catch (Exception e) {
-            logger.error("feeding failed, {}", e.getMessage());
         }
 
         generators.forEach((integer, bulkLoadGenerator) -> bulkLoadGenerator.shutdownGracefully());
@@ -236,6 +248,25 @@ public class Importer {
         rpcClients.forEach(RpcClient::stop);
     }
 
+    private static void feed(FilesReader reader, Map<Integer, BulkLoadGenerator> generators,
+                             Map<Integer, List<Integer>> keyIndexMap, Set<Integer> tsIdxSet, int pidNum) {
+        try {
+            CSVRecord record;
+            while ((record = reader.next()) != null) {
+                Map<Integer, List<Tablet.Dimension>> dims = buildDimensions(record, keyIndexMap, pidNum);
+
+                // distribute the row to the bulk load generators for each MemTable(tid, pid)
+                for (Integer pid : dims.keySet()) {
+                    // Note: NS pid is int
+                    // no need to calc dims twice, pass it to BulkLoadGenerator
+                    generators.get(pid).feed(new BulkLoadGenerator.FeedItem(dims, tsIdxSet, record));
+                }
+            }
+        } catch (Exception e) {
+            logger.error("feeding failed, {}", e.getMessage());
+        }
+    }
+
     private RpcClientOptions getRpcClientOptions() {
         RpcClientOptions clientOption = new RpcClientOptions();
         // clientOption.setWriteTimeoutMillis(1000);
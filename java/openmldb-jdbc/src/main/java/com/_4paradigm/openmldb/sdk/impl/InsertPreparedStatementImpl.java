@@ -26,6 +26,8 @@ import java.io.InputStream;
 import java.io.Reader;
 import java.math.BigDecimal;
 import java.net.URL;
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
 import java.nio.charset.Charset;
 import java.sql.*;
 import java.sql.Date;
@@ -49,6 +51,8 @@ public class InsertPreparedStatementImpl implements PreparedStatement {
     private Map<String, SQLInsertRows> sqlRowsMap = new HashMap<>();
     private List<Integer> scehmaIdxs = null;
     private Map<Integer, Integer> stringsLen = new HashMap<>();
+    // the values of the rows of addBatch, which are put by their columns in executeBatch
+    private List<Object[]> batchDatas = new ArrayList<>();
     public InsertPreparedStatementImpl(String db, String sql, SQLRouter router) throws SQLException {
         Status status = new Status();
         SQLInsertRows rows = router.GetInsertRows(db, sql, status);
@@ -345,7 +349,7 @@ public class InsertPreparedStatementImpl implements PreparedStatement {
         if (closed) {
             throw new SQLException("preparedstatement closed");
         }
-        if (!sqlRowsMap.isEmpty() || this.currentRows.GetCnt() > 1) {
+        if (!sqlRowsMap.isEmpty() || !batchDatas.isEmpty() || this.currentRows.GetCnt() > 1) {
             throw new SQLException("please use executeBatch");
         }
         dataBuild();
@@ -370,7 +374,115 @@ public class InsertPreparedStatementImpl implements PreparedStatement {
         if (closed) {
             throw new SQLException("preparedstatement closed");
         }
-        dataBuild();
+        batchDatas.add(currentDatas.toArray());
+        clearParameters();
+    }
+
+    // the bytes of a value of the column, 0 for a string column
+    private static int columnWidth(DataType type) {
+        if (DataType.kTypeBool.equals(type)) {
+            return 1;
+        } else if (DataType.kTypeInt16.equals(type)) {
+            return 2;
+        } else if (DataType.kTypeInt32.equals(type) || DataType.kTypeDate.equals(type)
+                || DataType.kTypeFloat.equals(type)) {
+            return 4;
+        } else if (DataType.kTypeInt64.equals(type) || DataType.kTypeTimestamp.equals(type)
+                || DataType.kTypeDouble.equals(type)) {
+            return 8;
+        }
+        return 0;
+    }
+
+    private static void putValue(ByteBuffer values, DataType type, Object data) throws SQLException {
+        if (DataType.kTypeBool.equals(type)) {
+            values.put((byte) ((boolean) data ? 1 : 0));
+        } else if (DataType.kTypeInt16.equals(type)) {
+            values.putShort((short) data);
+        } else if (DataType.kTypeInt32.equals(type)) {
+            values.putInt((int) data);
+        } else if (DataType.kTypeDate.equals(type)) {
+            java.sql.Date date = (java.sql.Date) data;
+            values.putInt((date.getYear() << 16) | (date.getMonth() << 8) | date.getDate());
+        } else if (DataType.kTypeFloat.equals(type)) {
+            values.putFloat((float) data);
+        } else if (DataType.kTypeInt64.equals(type) || DataType.kTypeTimestamp.equals(type)) {
+            values.putLong((long) data);
+        } else if (DataType.kTypeDouble.equals(type)) {
+            values.putDouble((double) data);
+        } else {
+            throw new SQLException("unkown data type");
+        }
+    }
+
+    // encode and put the rows of addBatch by their columns, which takes a few jni calls for each column instead
+    // of the ones for each value
+    private boolean executeBatchDatas() throws SQLException {
+        Status status = new Status();
+        SQLInsertRows rows = router.GetInsertRows(db, currentSql, status);
+        if (status.getCode() != 0) {
+            String msg = status.getMsg();
+            status.delete();
+            if (rows != null) {
+                rows.delete();
+            }
+            throw new SQLException("get insertrows fail " + msg);
+        }
+        int rowCnt = batchDatas.size();
+        // the buffers are read by the native side until AppendAddedColumns returns
+        List<ByteBuffer> buffers = new ArrayList<>();
+        for (int i = 0; i < currentDatasType.size(); i++) {
+            DataType type = currentDatasType.get(i);
+            ByteBuffer nulls = ByteBuffer.allocateDirect(rowCnt);
+            int width = columnWidth(type);
+            if (width > 0) {
+                ByteBuffer values = ByteBuffer.allocateDirect(rowCnt * width).order(ByteOrder.nativeOrder());
+                for (Object[] datas : batchDatas) {
+                    if (datas[i] == null) {
+                        nulls.put((byte) 1);
+                        values.position(values.position() + width);
+                    } else {
+                        nulls.put((byte) 0);
+                        putValue(values, type, datas[i]);
+                    }
+                }
+                rows.AddColumn(values, nulls);
+                buffers.add(values);
+            } else {
+                int size = 0;
+                for (Object[] datas : batchDatas) {
+                    if (datas[i] != null) {
+                        size += ((byte[]) datas[i]).length;
+                    }
+                }
+                ByteBuffer values = ByteBuffer.allocateDirect(size);
+                ByteBuffer offsets = ByteBuffer.allocateDirect((rowCnt + 1) * 4).order(ByteOrder.nativeOrder());
+                offsets.putInt(0);
+                for (Object[] datas : batchDatas) {
+                    nulls.put((byte) (datas[i] == null ? 1 : 0));
+                    if (datas[i] != null) {
+                        values.put((byte[]) datas[i]);
+                    }
+                    offsets.putInt(values.position());
+                }
+                rows.AddStringColumn(values, offsets, nulls);
+                buffers.add(values);
+                buffers.add(offsets);
+            }
+            buffers.add(nulls);
+        }
+        boolean ok = rows.AppendAddedColumns(rowCnt, status);
+        buffers.clear();
+        if (ok) {
+            ok = router.ExecuteInsert(db, currentSql, rows, status);
+        }
+        if (!ok) {
+            logger.error("execute batch fail: {}", status.getMsg());
+        }
+        batchDatas.clear();
+        rows.delete();
+        status.delete();
+        return ok;
     }
 
     @Override
@@ -758,7 +870,7 @@ public class InsertPreparedStatementImpl implements PreparedStatement {
     @Override
     @Deprecated
     public void clearBatch() throws SQLException {
-        throw new SQLException("current do not support this method");
+        batchDatas.clear();
     }
 
     @Override
@@ -768,7 +880,12 @@ public class InsertPreparedStatementImpl implements PreparedStatement {
         }
         int result[] = new int[1+sqlRowsMap.size()];
         Status status = new Status();
-        boolean ok = router.ExecuteInsert(db, currentSql, currentRows, status);
+        boolean ok = false;
+        if (!batchDatas.isEmpty()) {
+            ok = executeBatchDatas();
+        } else {
+            ok = router.ExecuteInsert(db, currentSql, currentRows, status);
+        }
         if (!ok) {
             result[0] = -1;
         } else {
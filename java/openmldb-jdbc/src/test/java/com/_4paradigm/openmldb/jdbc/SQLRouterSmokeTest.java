@@ -476,7 +476,7 @@ public class SQLRouterSmokeTest {
                 try {
                     impl.execute();
                 } catch (Exception e) {
-                    if (j > 1) {
+                    if (j > 0) {
                         Assert.assertEquals("please use executeBatch", e.getMessage());
                     } else {
                         Assert.assertEquals("build insert row failed", e.getMessage());
@@ -509,7 +509,7 @@ public class SQLRouterSmokeTest {
                 try {
                     impl2.execute();
                 } catch (Exception e) {
-                    if (j > 1) {
+                    if (j > 0) {
                         Assert.assertEquals("please use executeBatch", e.getMessage());
                     } else {
                         Assert.assertEquals("build insert row failed", e.getMessage());
@@ -531,10 +531,10 @@ public class SQLRouterSmokeTest {
             } catch (Exception e) {
                 Assert.assertEquals("this sql need data", e.getMessage());
             }
-            for (int j = 1; i < datas2.length; i++) {
+            for (int j = 1; j < datas2.length; j++) {
                 impl2.addBatch((String) datas2[j]);
             }
-            impl.executeBatch();
+            impl2.executeBatch();
             Assert.assertTrue(ok);
             String select2 = "select * from tsql1010;";
             com._4paradigm.openmldb.jdbc.SQLResultSet rs2 = (com._4paradigm.openmldb.jdbc.SQLResultSet) router.executeSQL(dbname, select1);
@@ -543,7 +543,8 @@ public class SQLRouterSmokeTest {
             while (rs2.next()) {
                 recordCnt++;
             }
-            Assert.assertEquals(datas1.length + datas2.length, recordCnt);
+            // the rows of the two batches and the sqls without placeholders
+            Assert.assertEquals(((Object[][]) batchData[0][1]).length + datas1.length + datas2.length - 1, recordCnt);
             rs2.close();
             // drop table
             String drop = "drop table tsql1010;";
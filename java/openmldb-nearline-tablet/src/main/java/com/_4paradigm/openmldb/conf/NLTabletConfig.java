@@ -14,6 +14,7 @@ public class NLTabletConfig {
     public static String ZK_ROOTPATH;
     public static int ZK_SESSION_TIMEOUT = 5000;
     public static String HDFS_PATH;
+    public static String BINLOG_PATH;
     static {
         try {
             Properties prop = new Properties();
@@ -26,6 +27,7 @@ public class NLTabletConfig {
             ZK_CLUSTER = prop.getProperty("zookeeper.cluster");
             ZK_ROOTPATH = prop.getProperty("zookeeper.root_path");
             HDFS_PATH = prop.getProperty("iceberg.hdfs.path");
+            BINLOG_PATH = prop.getProperty("binlog.path", "/tmp/nltablet/binlog");
         } catch (Exception e) {
             e.printStackTrace();
         }
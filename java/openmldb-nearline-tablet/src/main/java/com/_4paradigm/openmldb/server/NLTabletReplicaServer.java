@@ -0,0 +1,11 @@
+package com._4paradigm.openmldb.server;
+
+import com._4paradigm.openmldb.proto.Tablet;
+import com.baidu.brpc.protocol.BrpcMeta;
+
+// the nearline tablet is added to a leader partition as a remote replica, the leader pushes the binlog to it by
+// the AppendEntries of the tablet service
+public interface NLTabletReplicaServer {
+    @BrpcMeta(serviceName = "openmldb.api.TabletServer", methodName = "AppendEntries")
+    Tablet.AppendEntriesResponse appendEntries(Tablet.AppendEntriesRequest request);
+}
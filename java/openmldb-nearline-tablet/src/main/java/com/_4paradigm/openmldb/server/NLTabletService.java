@@ -2,6 +2,7 @@ package com._4paradigm.openmldb.server;
 
 import lombok.extern.slf4j.Slf4j;
 import com._4paradigm.openmldb.conf.NLTabletConfig;
+import com._4paradigm.openmldb.server.impl.NLTabletReplicaServerImpl;
 import com._4paradigm.openmldb.server.impl.NLTabletServerImpl;
 import com.baidu.brpc.server.RpcServer;
 import com.baidu.brpc.server.RpcServerOptions;
@@ -19,6 +20,7 @@ public class NLTabletService {
             options.setWorkThreadNum(NLTabletConfig.IO_THREAD);
             final RpcServer rpcServer = new RpcServer(NLTabletConfig.PORT, options);
             rpcServer.registerService(new NLTabletServerImpl());
+            rpcServer.registerService(new NLTabletReplicaServerImpl(NLTabletConfig.BINLOG_PATH));
             rpcServer.start();
 
             log.info("start nearLine tablet on {} with worker thread number {}", NLTabletConfig.PORT, NLTabletConfig.WORKER_THREAD);
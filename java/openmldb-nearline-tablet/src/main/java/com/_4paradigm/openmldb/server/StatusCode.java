@@ -3,4 +3,5 @@ package com._4paradigm.openmldb.server;
 public class StatusCode {
     public static final int SUCCESS = 0;
     public static final int CREATE_TABLE_FAILED = 100;
+    public static final int APPEND_ENTRIES_FAILED = 101;
 }
@@ -0,0 +1,107 @@
+package com._4paradigm.openmldb.server.impl;
+
+import com._4paradigm.openmldb.proto.Tablet;
+import com._4paradigm.openmldb.server.NLTabletReplicaServer;
+import com._4paradigm.openmldb.server.StatusCode;
+import lombok.extern.slf4j.Slf4j;
+
+import java.io.File;
+import java.io.FileOutputStream;
+import java.io.IOException;
+import java.nio.charset.StandardCharsets;
+import java.nio.file.Files;
+import java.nio.file.StandardCopyOption;
+import java.util.Map;
+import java.util.concurrent.ConcurrentHashMap;
+
+@Slf4j
+public class NLTabletReplicaServerImpl implements NLTabletReplicaServer {
+    private final String rootPath;
+    private final Map<String, PartitionLog> partitions = new ConcurrentHashMap<>();
+
+    public NLTabletReplicaServerImpl(String rootPath) {
+        this.rootPath = rootPath;
+    }
+
+    @Override
+    public Tablet.AppendEntriesResponse appendEntries(Tablet.AppendEntriesRequest request) {
+        Tablet.AppendEntriesResponse.Builder builder = Tablet.AppendEntriesResponse.newBuilder();
+        String name = request.getTid() + "_" + request.getPid();
+        try {
+            PartitionLog partition = partitions.computeIfAbsent(name, k -> new PartitionLog(new File(rootPath, k)));
+            if (partition.append(request)) {
+                builder.setCode(StatusCode.SUCCESS).setMsg("ok");
+            } else {
+                builder.setCode(StatusCode.APPEND_ENTRIES_FAILED).setMsg("log mismatch");
+            }
+            // the offset acks all the entries before it, the leader resends from the offset on mismatch
+            builder.setLogOffset(partition.getOffset());
+        } catch (Exception e) {
+            log.warn("fail to append entries of {}. error msg: {}", name, e.getMessage());
+            builder.setCode(StatusCode.APPEND_ENTRIES_FAILED).setMsg(e.getMessage());
+        }
+        return builder.build();
+    }
+
+    // The entries of a partition are appended to its log file in the delimited format of LogEntry, and the offset
+    // of the last entry is written after the entries are synced to the disk, so an acked entry is never lost.
+    static class PartitionLog {
+        private final File offsetFile;
+        private final FileOutputStream out;
+        private long offset = 0;
+
+        PartitionLog(File dir) {
+            try {
+                if (!dir.exists() && !dir.mkdirs()) {
+                    throw new IOException("fail to create dir " + dir);
+                }
+                offsetFile = new File(dir, "offset");
+                if (offsetFile.exists()) {
+                    offset = Long.parseLong(new String(Files.readAllBytes(offsetFile.toPath()),
+                            StandardCharsets.UTF_8).trim());
+                }
+                // the entries after the offset may be written again after a restart, they are skipped by the
+                // log index when the log is read
+                out = new FileOutputStream(new File(dir, "binlog"), true);
+            } catch (IOException e) {
+                throw new RuntimeException(e);
+            }
+            log.info("open partition log {} with offset {}", dir, offset);
+        }
+
+        synchronized long getOffset() {
+            return offset;
+        }
+
+        synchronized boolean append(Tablet.AppendEntriesRequest request) throws IOException {
+            if (request.getEntriesCount() == 0) {
+                // the leader matches the offset by an empty request
+                return true;
+            }
+            if (request.getPreLogIndex() > offset) {
+                log.warn("log mismatch, pre log index {}, offset {}, tid {} pid {}", request.getPreLogIndex(), offset,
+                        request.getTid(), request.getPid());
+                return false;
+            }
+            long lastIndex = offset;
+            for (Tablet.LogEntry entry : request.getEntriesList()) {
+                if (entry.getLogIndex() <= lastIndex) {
+                    continue;
+                }
+                entry.writeDelimitedTo(out);
+                lastIndex = entry.getLogIndex();
+            }
+            if (lastIndex == offset) {
+                return true;
+            }
+            out.flush();
+            out.getFD().sync();
+            File tmp = new File(offsetFile.getPath() + ".tmp");
+            Files.write(tmp.toPath(), Long.toString(lastIndex).getBytes(StandardCharsets.UTF_8));
+            Files.move(tmp.toPath(), offsetFile.toPath(), StandardCopyOption.REPLACE_EXISTING,
+                    StandardCopyOption.ATOMIC_MOVE);
+            offset = lastIndex;
+            return true;
+        }
+    }
+}
@@ -0,0 +1,47 @@
+package com._4paradigm.openmldb;
+
+import com._4paradigm.openmldb.proto.Tablet;
+import com._4paradigm.openmldb.server.StatusCode;
+import com._4paradigm.openmldb.server.impl.NLTabletReplicaServerImpl;
+import org.testng.Assert;
+import org.testng.annotations.Test;
+
+import java.nio.file.Files;
+
+public class NLTabletReplicaTest {
+    private static Tablet.AppendEntriesRequest buildRequest(long preLogIndex, long begin, long end) {
+        Tablet.AppendEntriesRequest.Builder builder = Tablet.AppendEntriesRequest.newBuilder()
+                .setTid(1).setPid(0).setPreLogIndex(preLogIndex);
+        for (long i = begin; i <= end; i++) {
+            builder.addEntries(Tablet.LogEntry.newBuilder().setLogIndex(i).setPk("key" + i).setTs(i)
+                    .setValue(com.google.protobuf.ByteString.copyFromUtf8("value" + i)));
+        }
+        return builder.build();
+    }
+
+    @Test
+    void testAppendEntries() throws Exception {
+        String path = Files.createTempDirectory("nltablet").toString();
+        NLTabletReplicaServerImpl server = new NLTabletReplicaServerImpl(path);
+        Tablet.AppendEntriesResponse response = server.appendEntries(buildRequest(0, 0, -1));
+        Assert.assertEquals(response.getCode(), StatusCode.SUCCESS);
+        Assert.assertEquals(response.getLogOffset(), 0);
+
+        response = server.appendEntries(buildRequest(0, 1, 10));
+        Assert.assertEquals(response.getCode(), StatusCode.SUCCESS);
+        Assert.assertEquals(response.getLogOffset(), 10);
+        // the entries resent are skipped
+        response = server.appendEntries(buildRequest(5, 6, 12));
+        Assert.assertEquals(response.getCode(), StatusCode.SUCCESS);
+        Assert.assertEquals(response.getLogOffset(), 12);
+        // the gap is rejected with the offset to resend from
+        response = server.appendEntries(buildRequest(20, 21, 22));
+        Assert.assertEquals(response.getCode(), StatusCode.APPEND_ENTRIES_FAILED);
+        Assert.assertEquals(response.getLogOffset(), 12);
+
+        // the offset is recovered after a restart
+        server = new NLTabletReplicaServerImpl(path);
+        response = server.appendEntries(buildRequest(0, 0, -1));
+        Assert.assertEquals(response.getLogOffset(), 12);
+    }
+}
@@ -135,6 +135,78 @@ class Driver(object):
             else:
                 return False, status.msg
 
+    def insertDataFrame(self, db, table, df):
+        """insert the rows of a pandas DataFrame, whose columns are named by the columns of the table.
+        The columns are passed to the sdk as numpy arrays and encoded together, and the rows are put
+        to the partitions in batches"""
+        if not self.sdk:
+            return False, "please init driver first"
+        import numpy as np
+        import pandas as pd
+        if len(df.columns) == 0:
+            return False, "no column in dataframe"
+        sql = "insert into {} ({}) values ({});".format(table, ",".join(df.columns), ",".join(["?"] * len(df.columns)))
+        ok, row_builder = self.getInsertBuilder(db, sql)
+        if not ok:
+            return False, row_builder
+        ok, rows_builder = self.getInsertBatchBuilder(db, sql)
+        if not ok:
+            return False, rows_builder
+        schema = row_builder.GetSchema()
+        fixedTypes = {
+            sql_router_sdk.kTypeBool: np.bool_,
+            sql_router_sdk.kTypeInt16: np.int16,
+            sql_router_sdk.kTypeInt32: np.int32,
+            sql_router_sdk.kTypeInt64: np.int64,
+            sql_router_sdk.kTypeFloat: np.float32,
+            sql_router_sdk.kTypeDouble: np.float64,
+            }
+        # the buffers must be alive until the columns are appended
+        buffers = []
+        for idx in row_builder.GetHoleIdx():
+            name = schema.GetColumnName(idx)
+            col = df[name]
+            isNull = col.isna().to_numpy()
+            nulls = np.ascontiguousarray(isNull, dtype=np.uint8) if isNull.any() else b""
+            if len(nulls) > 0 and schema.IsColumnNotNull(idx):
+                return False, "column {} not allow null".format(name)
+            colType = schema.GetColumnType(idx)
+            try:
+                if colType == sql_router_sdk.kTypeString:
+                    data = [b"" if n else str(v).encode("utf-8") for v, n in zip(col, isNull)]
+                    offsets = np.zeros(len(data) + 1, dtype=np.int32)
+                    np.cumsum([len(v) for v in data], out=offsets[1:])
+                    values = b"".join(data)
+                    buffers.append((values, offsets, nulls))
+                    rows_builder.AddStringColumn(values, offsets, nulls)
+                    continue
+                if colType == sql_router_sdk.kTypeTimestamp:
+                    if pd.api.types.is_datetime64_any_dtype(col):
+                        values = col.to_numpy(dtype="datetime64[ms]").astype(np.int64)
+                    else:
+                        values = col.fillna(0).to_numpy(dtype=np.int64)
+                elif colType == sql_router_sdk.kTypeDate:
+                    dt = pd.to_datetime(col)
+                    year = dt.dt.year.fillna(1900).to_numpy(dtype=np.int32)
+                    month = dt.dt.month.fillna(1).to_numpy(dtype=np.int32)
+                    day = dt.dt.day.fillna(0).to_numpy(dtype=np.int32)
+                    values = ((year - 1900) << 16) | ((month - 1) << 8) | day
+                elif colType in fixedTypes:
+                    values = col.fillna(0).to_numpy(dtype=fixedTypes[colType])
+                else:
+                    return False, "unsupported type of column {}".format(name)
+            except (ValueError, TypeError) as e:
+                return False, "fail to convert column {}, {}".format(name, e)
+            values = np.ascontiguousarray(values)
+            buffers.append((values, nulls))
+            rows_builder.AddColumn(values, nulls)
+        status = sql_router_sdk.Status()
+        if not rows_builder.AppendAddedColumns(len(df), status):
+            return False, status.msg
+        if not self.sdk.ExecuteInsert(db, sql, rows_builder, status):
+            return False, status.msg
+        return True, ""
+
     def getRequestBuilder(self, db, sql):
         if not self.sdk:
             return False, "please init driver first"
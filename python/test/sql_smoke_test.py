@@ -80,6 +80,16 @@ def test_smoke():
     assert ok == True
     assert rs.Size() == 4
 
+    # insert a dataframe
+    import pandas as pd
+    df = pd.DataFrame({"col1": ["a", None, "bcd"], "col2": [1, 2, None], "col3": [1.5, 2.5, 3.5],
+                       "col4": [1004, 1005, 1006]})
+    ok, error = sdk.insertDataFrame(db_name, table_name, df)
+    assert ok == True
+    ok, rs = sdk.executeQuery(db_name, select)
+    assert ok == True
+    assert rs.Size() == 7
+
     # drop not empty db
     ok, error = sdk.dropDB(db_name)
     assert ok == False
@@ -21,6 +21,7 @@
 #include <string>
 
 #include "apiserver/interface_provider.h"
+#include "boost/lexical_cast.hpp"
 #include "brpc/server.h"
 
 namespace openmldb {
@@ -42,7 +43,7 @@ bool APIServerImpl::Init(const sdk::ClusterOptions& options) {
 bool APIServerImpl::Init(::openmldb::sdk::ClusterSDK* cluster) {
     // If cluster sdk is needed, use ptr, don't own it. SQLClusterRouter owns it.
     cluster_sdk_ = cluster;
-    auto router = std::make_shared<::openmldb::sdk::SQLClusterRouter>(cluster_sdk_);
+    auto router = std::make_shared<::openmldb::sdk::SQLClusterRouter>(router_options_, cluster_sdk_);
     if (!router->Init()) {
         LOG(ERROR) << "Fail to connect to db";
         return false;
@@ -75,12 +76,23 @@ void APIServerImpl::Process(google::protobuf::RpcController* cntl_base, const Ht
     DLOG(INFO) << "unresolved path: " << unresolved_path << ", method: " << HttpMethod2Str(method);
     const butil::IOBuf& req_body = cntl->request_attachment();
 
+    // the body of the request and the response is a protobuf message instead of json
+    if (IsProtoContentType(cntl->http_request().content_type())) {
+        cntl->http_response().set_content_type(PROTO_CONTENT_TYPE);
+        provider_.handleProto(unresolved_path, method, req_body, &cntl->response_attachment());
+        return;
+    }
+
     JsonWriter writer;
     provider_.handle(unresolved_path, method, req_body, writer);
 
     cntl->response_attachment().append(writer.GetString());
 }
 
+bool APIServerImpl::IsProtoContentType(const std::string& content_type) {
+    return content_type == PROTO_CONTENT_TYPE || content_type == "application/x-protobuf";
+}
+
 bool APIServerImpl::Json2SQLRequestRow(const butil::rapidjson::Value& non_common_cols_v,
                                        const butil::rapidjson::Value& common_cols_v,
                                        std::shared_ptr<openmldb::sdk::SQLRequestRow> row) {
@@ -121,6 +133,50 @@ bool APIServerImpl::Json2SQLRequestRow(const butil::rapidjson::Value& non_common
     return true;
 }
 
+bool APIServerImpl::Proto2SQLRequestRow(const Row& non_common_cols,
+                                        const ::google::protobuf::RepeatedPtrField<Value>& common_cols,
+                                        std::shared_ptr<openmldb::sdk::SQLRequestRow> row) {
+    auto sch = row->GetSchema();
+
+    // the sizes have been checked, scan all strings to init the total string length
+    int str_len_sum = 0;
+    int non_common_idx = 0, common_idx = 0;
+    for (int i = 0; i < sch->GetColumnCnt(); ++i) {
+        const auto& v = sch->IsConstant(i) ? common_cols.Get(common_idx++) : non_common_cols.values(non_common_idx++);
+        if (sch->GetColumnType(i) == hybridse::sdk::kTypeString) {
+            str_len_sum += v.string_value().size();
+        }
+    }
+    row->Init(str_len_sum);
+
+    non_common_idx = 0, common_idx = 0;
+    for (int i = 0; i < sch->GetColumnCnt(); ++i) {
+        const auto& v = sch->IsConstant(i) ? common_cols.Get(common_idx++) : non_common_cols.values(non_common_idx++);
+        if (!AppendProtoValue(v, sch->GetColumnType(i), sch->IsColumnNotNull(i), row)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template <typename T>
+bool APIServerImpl::AppendDate(const char* s, T row) {
+    std::vector<std::string> parts;
+    ::openmldb::base::SplitString(s, "-", parts);
+    if (parts.size() != 3) {
+        return false;
+    }
+    int32_t year = 0;
+    int32_t mon = 0;
+    int32_t day = 0;
+    if (!boost::conversion::try_lexical_convert(parts[0], year) ||
+        !boost::conversion::try_lexical_convert(parts[1], mon) ||
+        !boost::conversion::try_lexical_convert(parts[2], day)) {
+        return false;
+    }
+    return row->AppendDate(year, mon, day);
+}
+
 template <typename T>
 bool APIServerImpl::AppendJsonValue(const butil::rapidjson::Value& v, hybridse::sdk::DataType type, bool is_not_null,
                                     T row) {
@@ -179,15 +235,7 @@ bool APIServerImpl::AppendJsonValue(const butil::rapidjson::Value& v, hybridse::
             if (!v.IsString()) {
                 return false;
             }
-            std::vector<std::string> parts;
-            ::openmldb::base::SplitString(v.GetString(), "-", parts);
-            if (parts.size() != 3) {
-                return false;
-            }
-            auto year = boost::lexical_cast<int32_t>(parts[0]);
-            auto mon = boost::lexical_cast<int32_t>(parts[1]);
-            auto day = boost::lexical_cast<int32_t>(parts[2]);
-            return row->AppendDate(year, mon, day);
+            return AppendDate(v.GetString(), row);
         }
         case hybridse::sdk::kTypeTimestamp: {
             if (!v.IsInt64()) {
@@ -200,6 +248,124 @@ bool APIServerImpl::AppendJsonValue(const butil::rapidjson::Value& v, hybridse::
     }
 }
 
+template <typename T>
+bool APIServerImpl::AppendProtoValue(const Value& v, hybridse::sdk::DataType type, bool is_not_null, T row) {
+    // no field is set if null
+    if (!v.has_bool_value() && !v.has_int_value() && !v.has_float_value() && !v.has_double_value() &&
+        !v.has_string_value()) {
+        if (is_not_null) {
+            return false;
+        }
+        return row->AppendNULL();
+    }
+
+    switch (type) {
+        case hybridse::sdk::kTypeBool:
+            return v.has_bool_value() && row->AppendBool(v.bool_value());
+        case hybridse::sdk::kTypeInt16: {
+            if (!v.has_int_value() || v.int_value() < INT16_MIN || v.int_value() > INT16_MAX) {
+                return false;
+            }
+            return row->AppendInt16(static_cast<int16_t>(v.int_value()));
+        }
+        case hybridse::sdk::kTypeInt32: {
+            if (!v.has_int_value() || v.int_value() < INT32_MIN || v.int_value() > INT32_MAX) {
+                return false;
+            }
+            return row->AppendInt32(static_cast<int32_t>(v.int_value()));
+        }
+        case hybridse::sdk::kTypeInt64:
+            return v.has_int_value() && row->AppendInt64(v.int_value());
+        case hybridse::sdk::kTypeFloat:
+            return v.has_float_value() && row->AppendFloat(v.float_value());
+        case hybridse::sdk::kTypeDouble:
+            return v.has_double_value() && row->AppendDouble(v.double_value());
+        case hybridse::sdk::kTypeString:
+            return v.has_string_value() && row->AppendString(v.string_value().data(), v.string_value().size());
+        case hybridse::sdk::kTypeDate:
+            return v.has_string_value() && AppendDate(v.string_value().c_str(), row);
+        case hybridse::sdk::kTypeTimestamp:
+            return v.has_int_value() && row->AppendTimestamp(v.int_value());
+        default:
+            return false;
+    }
+}
+
+std::shared_ptr<openmldb::sdk::SQLCache> APIServerImpl::GetInsertTemplate(const std::string& db,
+                                                                       const std::string& table,
+                                                                       hybridse::sdk::Status* status) {
+    auto table_info = cluster_sdk_->GetTableInfo(db, table);
+    if (!table_info) {
+        status->code = -1;
+        status->msg = "table with name " + table + " in db " + db + " does not exist";
+        return std::shared_ptr<openmldb::sdk::SQLCache>();
+    }
+    std::string key = db + "." + table;
+    {
+        std::lock_guard<std::mutex> lock(insert_mu_);
+        auto it = insert_templates_.find(key);
+        // the table info is replaced when the catalog refreshes it, then the template is built again
+        if (it != insert_templates_.end() && it->second->table_info == table_info) {
+            return it->second;
+        }
+    }
+    std::string holders;
+    for (int i = 0; i < table_info->column_desc_size(); ++i) {
+        holders += ((i == 0) ? "?" : ",?");
+    }
+    std::string insert_sql = "insert into " + table + " values(" + holders + ");";
+    auto insert_template = sql_router_->PrepareInsert(db, insert_sql, status);
+    if (!insert_template) {
+        return insert_template;
+    }
+    std::lock_guard<std::mutex> lock(insert_mu_);
+    insert_templates_[key] = insert_template;
+    return insert_template;
+}
+
+bool APIServerImpl::GetProcedureInput(const std::string& db, const std::string& sp, ProcedureInput* input,
+                                      hybridse::sdk::Status* status) {
+    // We need to use ShowProcedure to get input schema(should know which column is constant).
+    // GetRequestRowByProcedure can't do that.
+    input->sp_info = sql_router_->ShowProcedure(db, sp, status);
+    if (!input->sp_info) {
+        return false;
+    }
+    const auto& schema_impl = dynamic_cast<const ::hybridse::sdk::SchemaImpl&>(input->sp_info->GetInputSchema());
+    // Hard copy, and RequestRow needs shared schema
+    input->input_schema = std::make_shared<::hybridse::sdk::SchemaImpl>(schema_impl.GetSchema());
+    input->common_column_indices = std::make_shared<openmldb::sdk::ColumnIndicesSet>(input->input_schema);
+    input->common_size = 0;
+    for (int i = 0; i < input->input_schema->GetColumnCnt(); ++i) {
+        if (input->input_schema->IsConstant(i)) {
+            input->common_column_indices->AddCommonColumnIdx(i);
+            ++input->common_size;
+        }
+    }
+    return true;
+}
+
+std::shared_ptr<hybridse::sdk::ResultSet> APIServerImpl::CallProcedure(
+    const std::string& db, const std::string& sp, const ProcedureInput& input,
+    const std::vector<std::shared_ptr<openmldb::sdk::SQLRequestRow>>& rows, hybridse::sdk::Status* status) {
+    std::shared_ptr<sdk::QueryFuture> future;
+    if (rows.size() == 1 && input.common_size == 0) {
+        future = sql_router_->CallProcedure(db, sp, router_options_.request_timeout, rows[0], status);
+    } else {
+        // TODO(hw): SQLRequestRowBatch should add common & non-common cols directly
+        auto row_batch = std::make_shared<sdk::SQLRequestRowBatch>(input.input_schema, input.common_column_indices);
+        for (const auto& row : rows) {
+            row_batch->AddRow(row);
+        }
+        future = sql_router_->CallSQLBatchRequestProcedure(db, sp, router_options_.request_timeout, row_batch, status);
+    }
+    if (!future) {
+        return nullptr;
+    }
+    // the handler runs in a bthread, which is parked rather than the worker while the rpc is on the way
+    return future->GetResultSet(status);
+}
+
 void APIServerImpl::RegisterPut() {
     provider_.put("/dbs/:db_name/tables/:table_name", [this](const InterfaceProvider::Params& param,
                                                              const butil::IOBuf& req_body, JsonWriter& writer) {
@@ -213,64 +379,126 @@ void APIServerImpl::RegisterPut() {
         auto db = db_it->second;
         auto table = table_it->second;
 
-        // json2doc, then generate an insert sql
+        // json2doc in situ, the strings of the doc reference the body, then generate an insert sql
+        std::string body = req_body.to_string();
         Document document;
-        if (document.Parse(req_body.to_string().c_str()).HasParseError()) {
-            DLOG(INFO) << "rapidjson doc parse [" << req_body.to_string().c_str() << "] failed, code "
+        if (document.ParseInsitu(&body[0]).HasParseError()) {
+            DLOG(INFO) << "rapidjson doc parse [" << req_body.to_string() << "] failed, code "
                        << document.GetParseError() << ", offset " << document.GetErrorOffset();
             writer << err.Set("Json parse failed, error code: " + std::to_string(document.GetParseError()));
             return;
         }
 
-        const auto& value = document["value"];
-        // value should be array, and multi put is not supported now
-        if (!value.IsArray() || value.Empty() || value.Size() > 1 || !value[0].IsArray()) {
-            writer << err.Set("Invalid value in body, only support to put one row");
+        // value is an array of rows, and every row is an array of all the columns
+        if (!document.IsObject() || !document.HasMember("value") || !document["value"].IsArray() ||
+            document["value"].Empty()) {
+            writer << err.Set("Invalid value in body");
             return;
         }
-        const auto& arr = value[0];
-        std::string holders;
-        for (decltype(arr.Size()) i = 0; i < arr.Size(); ++i) {
-            holders += ((i == 0) ? "?" : ",?");
-        }
+        const auto& value = document["value"];
         hybridse::sdk::Status status;
-        std::string insert_placeholder = "insert into " + table + " values(" + holders + ");";
-        auto row = sql_router_->GetInsertRow(db, insert_placeholder, &status);
-        if (!row) {
+        auto insert_template = GetInsertTemplate(db, table, &status);
+        if (!insert_template) {
             writer << err.Set(status.msg);
             return;
         }
-        auto schema = row->GetSchema();
+        const auto& schema = insert_template->column_schema;
         auto cnt = schema->GetColumnCnt();
-        if (cnt != static_cast<int>(arr.Size())) {
-            writer << err.Set("column size != schema size");
-            return;
-        }
-
-        // scan all strings , calc the sum, to init SQLInsertRow's string length
-        decltype(arr.Size()) str_len_sum = 0;
-        for (int i = 0; i < cnt; ++i) {
-            if (schema->GetColumnType(i) == hybridse::sdk::kTypeString) {
-                str_len_sum += arr[i].GetStringLength();
-            }
-        }
-        row->Init(static_cast<int>(str_len_sum));
-
-        for (int i = 0; i < cnt; ++i) {
-            if (!AppendJsonValue(arr[i], schema->GetColumnType(i), schema->IsColumnNotNull(i), row)) {
-                writer << err.Set("Translate to insert row failed");
+        auto rows = std::make_shared<openmldb::sdk::SQLInsertRows>(
+            insert_template->table_info, schema, insert_template->default_map, insert_template->str_length);
+        for (const auto& arr : value.GetArray()) {
+            if (!arr.IsArray() || static_cast<int>(arr.Size()) != cnt) {
+                writer << err.Set("column size != schema size");
                 return;
             }
+            // scan all strings , calc the sum, to init SQLInsertRow's string length
+            decltype(arr.Size()) str_len_sum = 0;
+            for (int i = 0; i < cnt; ++i) {
+                if (schema->GetColumnType(i) == hybridse::sdk::kTypeString && arr[i].IsString()) {
+                    str_len_sum += arr[i].GetStringLength();
+                }
+            }
+            auto row = rows->NewRow();
+            row->Init(static_cast<int>(str_len_sum));
+            for (int i = 0; i < cnt; ++i) {
+                if (!AppendJsonValue(arr[i], schema->GetColumnType(i), schema->IsColumnNotNull(i), row)) {
+                    writer << err.Set("Translate to insert row failed");
+                    return;
+                }
+            }
         }
 
-        auto ok = sql_router_->ExecuteInsert(db, insert_placeholder, row, &status);
-        if (ok) {
+        // the rows are grouped by partition and put in batches
+        if (sql_router_->ExecuteInsert(db, *insert_template, rows, &status)) {
             PutResp resp;
             writer << resp;
         } else {
             writer << err.Set(status.msg);
         }
     });
+
+    provider_.putProto("/dbs/:db_name/tables/:table_name", [this](const InterfaceProvider::Params& param,
+                                                                  const butil::IOBuf& req_body,
+                                                                  butil::IOBuf* resp_body) {
+        auto db_it = param.find("db_name");
+        auto table_it = param.find("table_name");
+        if (db_it == param.end() || table_it == param.end()) {
+            WriteProtoError("Invalid path", resp_body);
+            return;
+        }
+        const auto& db = db_it->second;
+        const auto& table = table_it->second;
+
+        PutRequest request;
+        if (!ReadProto(req_body, &request)) {
+            WriteProtoError("Proto parse failed", resp_body);
+            return;
+        }
+        if (request.value_size() == 0) {
+            WriteProtoError("Invalid value in body", resp_body);
+            return;
+        }
+        hybridse::sdk::Status status;
+        auto insert_template = GetInsertTemplate(db, table, &status);
+        if (!insert_template) {
+            WriteProtoError(status.msg, resp_body);
+            return;
+        }
+        const auto& schema = insert_template->column_schema;
+        auto cnt = schema->GetColumnCnt();
+        auto rows = std::make_shared<openmldb::sdk::SQLInsertRows>(
+            insert_template->table_info, schema, insert_template->default_map, insert_template->str_length);
+        for (const auto& value : request.value()) {
+            const auto& values = value.values();
+            if (values.size() != cnt) {
+                WriteProtoError("column size != schema size", resp_body);
+                return;
+            }
+            int str_len_sum = 0;
+            for (int i = 0; i < cnt; ++i) {
+                if (schema->GetColumnType(i) == hybridse::sdk::kTypeString) {
+                    str_len_sum += values.Get(i).string_value().size();
+                }
+            }
+            auto row = rows->NewRow();
+            row->Init(str_len_sum);
+            for (int i = 0; i < cnt; ++i) {
+                if (!AppendProtoValue(values.Get(i), schema->GetColumnType(i), schema->IsColumnNotNull(i), row)) {
+                    WriteProtoError("Translate to insert row failed", resp_body);
+                    return;
+                }
+            }
+        }
+
+        if (!sql_router_->ExecuteInsert(db, *insert_template, rows, &status)) {
+            WriteProtoError(status.msg, resp_body);
+            return;
+        }
+        PutResponse response;
+        response.set_code(0);
+        response.set_msg("ok");
+        WriteProto(response, resp_body);
+    });
 }
 
 void APIServerImpl::RegisterExecSP() {
@@ -286,8 +514,10 @@ void APIServerImpl::RegisterExecSP() {
         auto db = db_it->second;
         auto sp = sp_it->second;
 
+        // parse in situ, the strings of the doc reference the body
+        std::string body = req_body.to_string();
         Document document;
-        if (document.Parse(req_body.to_string().c_str()).HasParseError()) {
+        if (document.ParseInsitu(&body[0]).HasParseError()) {
             writer << err.Set("Json parse failed");
             return;
         }
@@ -312,41 +542,26 @@ void APIServerImpl::RegisterExecSP() {
         const auto& rows = input->value;
 
         hybridse::sdk::Status status;
-        // We need to use ShowProcedure to get input schema(should know which column is constant).
-        // GetRequestRowByProcedure can't do that.
-        auto sp_info = sql_router_->ShowProcedure(db, sp, &status);
-        if (!sp_info) {
+        ProcedureInput sp_input;
+        if (!GetProcedureInput(db, sp, &sp_input, &status)) {
             writer << err.Set(status.msg);
             return;
         }
-
-        const auto& schema_impl = dynamic_cast<const ::hybridse::sdk::SchemaImpl&>(sp_info->GetInputSchema());
-        // Hard copy, and RequestRow needs shared schema
-        auto input_schema = std::make_shared<::hybridse::sdk::SchemaImpl>(schema_impl.GetSchema());
-        auto common_column_indices = std::make_shared<openmldb::sdk::ColumnIndicesSet>(input_schema);
-        decltype(common_cols_v.Size()) expected_common_size = 0;
-        for (int i = 0; i < input_schema->GetColumnCnt(); ++i) {
-            if (input_schema->IsConstant(i)) {
-                common_column_indices->AddCommonColumnIdx(i);
-                ++expected_common_size;
-            }
-        }
-
-        if (common_cols_v.Size() != expected_common_size) {
+        if (static_cast<int>(common_cols_v.Size()) != sp_input.common_size) {
             writer << err.Set("Invalid common cols size");
             return;
         }
-        auto expected_input_size = input_schema->GetColumnCnt() - expected_common_size;
+        auto expected_input_size = sp_input.input_schema->GetColumnCnt() - sp_input.common_size;
 
-        // TODO(hw): SQLRequestRowBatch should add common & non-common cols directly
-        auto row_batch = std::make_shared<sdk::SQLRequestRowBatch>(input_schema, common_column_indices);
+        std::vector<std::shared_ptr<sdk::SQLRequestRow>> request_rows;
+        request_rows.reserve(rows.Size());
         std::set<std::string> col_set;
         for (decltype(rows.Size()) i = 0; i < rows.Size(); ++i) {
-            if (!rows[i].IsArray() || rows[i].Size() != expected_input_size) {
+            if (!rows[i].IsArray() || static_cast<int>(rows[i].Size()) != expected_input_size) {
                 writer << err.Set("Invalid input data row");
                 return;
             }
-            auto row = std::make_shared<sdk::SQLRequestRow>(input_schema, col_set);
+            auto row = std::make_shared<sdk::SQLRequestRow>(sp_input.input_schema, col_set);
 
             // sizes have been checked
             if (!Json2SQLRequestRow(rows[i], common_cols_v, row)) {
@@ -354,10 +569,10 @@ void APIServerImpl::RegisterExecSP() {
                 return;
             }
             row->Build();
-            row_batch->AddRow(row);
+            request_rows.push_back(std::move(row));
         }
 
-        auto rs = sql_router_->CallSQLBatchRequestProcedure(db, sp, row_batch, &status);
+        auto rs = CallProcedure(db, sp, sp_input, request_rows, &status);
         if (!rs) {
             writer << err.Set(status.msg);
             return;
@@ -366,7 +581,7 @@ void APIServerImpl::RegisterExecSP() {
         ExecSPResp resp;
         // output schema in sp_info is needed for encoding data, so we need a bool in ExecSPResp to know whether to
         // print schema
-        resp.sp_info = sp_info;
+        resp.sp_info = sp_input.sp_info;
         if (document.HasMember("need_schema") && document["need_schema"].IsBool() &&
             document["need_schema"].GetBool()) {
             resp.need_schema = true;
@@ -374,6 +589,72 @@ void APIServerImpl::RegisterExecSP() {
         resp.rs = rs;
         writer << resp;
     });
+
+    provider_.postProto("/dbs/:db_name/procedures/:sp_name", [this](const InterfaceProvider::Params& param,
+                                                                    const butil::IOBuf& req_body,
+                                                                    butil::IOBuf* resp_body) {
+        auto db_it = param.find("db_name");
+        auto sp_it = param.find("sp_name");
+        if (db_it == param.end() || sp_it == param.end()) {
+            WriteProtoError("Invalid path", resp_body);
+            return;
+        }
+        const auto& db = db_it->second;
+        const auto& sp = sp_it->second;
+
+        ExecSPRequest request;
+        if (!ReadProto(req_body, &request)) {
+            WriteProtoError("Proto parse failed", resp_body);
+            return;
+        }
+        if (request.input_size() == 0) {
+            WriteProtoError("Invalid input", resp_body);
+            return;
+        }
+
+        hybridse::sdk::Status status;
+        ProcedureInput sp_input;
+        if (!GetProcedureInput(db, sp, &sp_input, &status)) {
+            WriteProtoError(status.msg, resp_body);
+            return;
+        }
+        if (request.common_cols_size() != sp_input.common_size) {
+            WriteProtoError("Invalid common cols size", resp_body);
+            return;
+        }
+        int expected_input_size = sp_input.input_schema->GetColumnCnt() - sp_input.common_size;
+
+        std::vector<std::shared_ptr<sdk::SQLRequestRow>> request_rows;
+        request_rows.reserve(request.input_size());
+        std::set<std::string> col_set;
+        for (const auto& input_row : request.input()) {
+            if (input_row.values_size() != expected_input_size) {
+                WriteProtoError("Invalid input data row", resp_body);
+                return;
+            }
+            auto row = std::make_shared<sdk::SQLRequestRow>(sp_input.input_schema, col_set);
+            if (!Proto2SQLRequestRow(input_row, request.common_cols(), row)) {
+                WriteProtoError("Translate to request row failed", resp_body);
+                return;
+            }
+            row->Build();
+            request_rows.push_back(std::move(row));
+        }
+
+        auto rs = CallProcedure(db, sp, sp_input, request_rows, &status);
+        if (!rs) {
+            WriteProtoError(status.msg, resp_body);
+            return;
+        }
+
+        ExecSPResp resp;
+        resp.sp_info = sp_input.sp_info;
+        resp.need_schema = request.need_schema();
+        resp.rs = rs;
+        ExecSPResponse response;
+        WriteExecSPResponse(resp, &response);
+        WriteProto(response, resp_body);
+    });
 }
 
 void APIServerImpl::RegisterGetSP() {
@@ -656,6 +937,104 @@ JsonWriter& operator&(JsonWriter& ar, ExecSPResp& s) {  // NOLINT
     return ar.EndObject();
 }
 
+void WriteProtoValue(std::shared_ptr<hybridse::sdk::ResultSet> rs, int i, Value* value) {
+    auto schema = rs->GetSchema();
+    if (rs->IsNULL(i)) {
+        if (schema->IsColumnNotNull(i)) {
+            LOG(ERROR) << "Value in " << schema->GetColumnName(i) << " is null but it can't be null";
+        }
+        return;
+    }
+    switch (schema->GetColumnType(i)) {
+        case hybridse::sdk::kTypeInt32: {
+            int32_t v = 0;
+            rs->GetInt32(i, &v);
+            value->set_int_value(v);
+            break;
+        }
+        case hybridse::sdk::kTypeInt64: {
+            int64_t v = 0;
+            rs->GetInt64(i, &v);
+            value->set_int_value(v);
+            break;
+        }
+        case hybridse::sdk::kTypeInt16: {
+            int16_t v = 0;
+            rs->GetInt16(i, &v);
+            value->set_int_value(v);
+            break;
+        }
+        case hybridse::sdk::kTypeFloat: {
+            float v = 0;
+            rs->GetFloat(i, &v);
+            value->set_float_value(v);
+            break;
+        }
+        case hybridse::sdk::kTypeDouble: {
+            double v = 0;
+            rs->GetDouble(i, &v);
+            value->set_double_value(v);
+            break;
+        }
+        case hybridse::sdk::kTypeString: {
+            rs->GetString(i, value->mutable_string_value());
+            break;
+        }
+        case hybridse::sdk::kTypeTimestamp: {
+            int64_t ts = 0;
+            rs->GetTime(i, &ts);
+            value->set_int_value(ts);
+            break;
+        }
+        case hybridse::sdk::kTypeDate: {
+            int32_t year = 0;
+            int32_t month = 0;
+            int32_t day = 0;
+            rs->GetDate(i, &year, &month, &day);
+            value->set_string_value(std::to_string(year) + "-" + std::to_string(month) + "-" + std::to_string(day));
+            break;
+        }
+        case hybridse::sdk::kTypeBool: {
+            bool v = false;
+            rs->GetBool(i, &v);
+            value->set_bool_value(v);
+            break;
+        }
+        default: {
+            LOG(ERROR) << "Invalid Column Type";
+            break;
+        }
+    }
+}
+
+void WriteExecSPResponse(ExecSPResp& s, ExecSPResponse* response) {  // NOLINT
+    response->set_code(s.code);
+    response->set_msg(s.msg);
+    auto& schema = s.sp_info->GetOutputSchema();
+    if (s.need_schema) {
+        for (decltype(schema.GetColumnCnt()) i = 0; i < schema.GetColumnCnt(); i++) {
+            auto column = response->add_schema();
+            column->set_name(schema.GetColumnName(i));
+            column->set_type(DataTypeName(schema.GetColumnType(i)));
+        }
+    }
+    auto& rs = s.rs;
+    bool first = true;
+    rs->Reset();
+    while (rs->Next()) {
+        auto row = response->add_data();
+        for (decltype(schema.GetColumnCnt()) i = 0; i < schema.GetColumnCnt(); i++) {
+            if (!schema.IsConstant(i)) {
+                WriteProtoValue(rs, i, row->add_values());
+            } else if (first) {
+                // the common cols are the same in all rows
+                WriteProtoValue(rs, i, response->mutable_common_cols_data()->add_values());
+            }
+        }
+        first = false;
+    }
+}
+
 JsonWriter& operator&(JsonWriter& ar, std::shared_ptr<hybridse::sdk::ProcedureInfo> sp_info) {  // NOLINT
     ar.StartObject();
     ar.Member("name") & sp_info->GetSpName();
@@ -17,7 +17,9 @@
 #ifndef SRC_APISERVER_API_SERVER_IMPL_H_
 #define SRC_APISERVER_API_SERVER_IMPL_H_
 
+#include <map>
 #include <memory>
+#include <mutex>  // NOLINT
 #include <string>
 #include <utility>
 #include <vector>
@@ -36,20 +38,26 @@ using butil::rapidjson::Document;
 using butil::rapidjson::StringBuffer;
 using butil::rapidjson::Writer;
 
+const char PROTO_CONTENT_TYPE[] = "application/proto";
+
 // APIServer is a service for brpc::Server. The entire implement is `StartAPIServer()` in src/cmd/openmldb.cc
 // Every request is handled by `Process()`, we will choose the right method of the request by `InterfaceProvider`.
 // InterfaceProvider's url parser supports to parse urls like "/a/:arg1/b/:arg2/:arg3", but doesn't support wildcards.
 // Methods should be registered in `InterfaceProvider` in the init phase.
-// Both input and output are json data. We use rapidjson to handle it.
+// Both input and output are json data. We use rapidjson to handle it. Put and ExecSP also accept the protobuf
+// messages in api_server.proto, if the content type of the request is application/proto.
 class APIServerImpl : public APIServer {
  public:
     APIServerImpl() = default;
+    // the procedure calls are coalesced into batch requests by the router if the batch window of options is set
+    explicit APIServerImpl(const sdk::SQLRouterOptions& options) : router_options_(options) {}
     ~APIServerImpl() override;
     bool Init(const sdk::ClusterOptions& options);
     bool Init(::openmldb::sdk::ClusterSDK* cluster);
     void Process(google::protobuf::RpcController* cntl_base, const HttpRequest*, HttpResponse*,
                  google::protobuf::Closure* done) override;
     static std::string InnerTypeTransform(const std::string& s);
+    static bool IsProtoContentType(const std::string& content_type);
 
     void Refresh(google::protobuf::RpcController* cntl_base, const HttpRequest*, HttpResponse*,
                  google::protobuf::Closure* done) override;
@@ -68,8 +76,43 @@ class APIServerImpl : public APIServer {
     static bool AppendJsonValue(const butil::rapidjson::Value& v, hybridse::sdk::DataType type, bool is_not_null,
                                 T row);
 
+    static bool Proto2SQLRequestRow(const Row& non_common_cols,
+                                    const ::google::protobuf::RepeatedPtrField<Value>& common_cols,
+                                    std::shared_ptr<openmldb::sdk::SQLRequestRow> row);
+    template <typename T>
+    static bool AppendProtoValue(const Value& v, hybridse::sdk::DataType type, bool is_not_null, T row);
+
+    // date is in the format yyyy-mm-dd
+    template <typename T>
+    static bool AppendDate(const char* s, T row);
+
+    // the parsed placeholder insert sql of all the columns of the table, which is kept per table, so that the puts
+    // build the rows by it without parsing the sql or looking up the sql cache of the router
+    std::shared_ptr<openmldb::sdk::SQLCache> GetInsertTemplate(const std::string& db, const std::string& table,
+                                                               hybridse::sdk::Status* status);
+
+    // the procedure with its input schema, in which the constant columns are the common columns
+    struct ProcedureInput {
+        std::shared_ptr<hybridse::sdk::ProcedureInfo> sp_info;
+        std::shared_ptr<::hybridse::sdk::SchemaImpl> input_schema;
+        std::shared_ptr<openmldb::sdk::ColumnIndicesSet> common_column_indices;
+        int common_size = 0;
+    };
+    bool GetProcedureInput(const std::string& db, const std::string& sp, ProcedureInput* input,
+                           hybridse::sdk::Status* status);
+
+    // call the procedure by the async sdk api and wait for the result set. a single row without common columns is
+    // called by CallProcedure, so that the concurrent calls of the procedure are coalesced by the router
+    std::shared_ptr<hybridse::sdk::ResultSet> CallProcedure(
+        const std::string& db, const std::string& sp, const ProcedureInput& input,
+        const std::vector<std::shared_ptr<openmldb::sdk::SQLRequestRow>>& rows, hybridse::sdk::Status* status);
+
  private:
-    std::shared_ptr<sdk::SQLRouter> sql_router_;
+    sdk::SQLRouterOptions router_options_;
+    std::shared_ptr<sdk::SQLClusterRouter> sql_router_;
+    // the insert templates keyed by db.table
+    std::mutex insert_mu_;
+    std::map<std::string, std::shared_ptr<openmldb::sdk::SQLCache>> insert_templates_;
     InterfaceProvider provider_;
     // cluster_sdk_ is not owned by this class.
     ::openmldb::sdk::ClusterSDK* cluster_sdk_;
@@ -106,6 +149,10 @@ void WriteValue(JsonWriter& ar, std::shared_ptr<hybridse::sdk::ResultSet> rs, in
 // ExecSPResp reading is unsupported now, cuz we decode ResultSet with Schema here, it's irreversible
 JsonWriter& operator&(JsonWriter& ar, ExecSPResp& s);  // NOLINT
 
+void WriteProtoValue(std::shared_ptr<hybridse::sdk::ResultSet> rs, int i, Value* value);
+
+void WriteExecSPResponse(ExecSPResp& s, ExecSPResponse* response);  // NOLINT
+
 struct GetSPResp {
     GetSPResp() = default;
     int code = 0;
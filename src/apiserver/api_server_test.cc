@@ -14,6 +14,10 @@
  * limitations under the License.
  */
 
+#include <atomic>
+#include <thread>  // NOLINT
+#include <vector>
+
 #include "apiserver/api_server_impl.h"
 #include "brpc/channel.h"
 #include "brpc/restful.h"
@@ -47,7 +51,10 @@ class APIServerTestEnv : public testing::Environment {
         // Owned by queue_svc
         cluster_sdk = new ::openmldb::sdk::ClusterSDK(cluster_options);
         ASSERT_TRUE(cluster_sdk->Init()) << "Fail to connect to db";
-        queue_svc.reset(new APIServerImpl);
+        // the single row procedure calls are coalesced into batches
+        sdk::SQLRouterOptions router_options;
+        router_options.procedure_batch_window_us = 1000;
+        queue_svc.reset(new APIServerImpl(router_options));
         ASSERT_TRUE(queue_svc->Init(cluster_sdk));
 
         sdk::SQLRouterOptions sql_opt;
@@ -239,6 +246,37 @@ TEST_F(APIServerTest, valid_put) {
         ASSERT_STREQ("ok", resp.msg.c_str());
     }
 
+    // multi rows in one put
+    {
+        brpc::Controller cntl;
+        cntl.http_request().set_method(brpc::HTTP_METHOD_PUT);
+        cntl.http_request().uri() = "http://127.0.0.1:8010/dbs/" + env->db + "/tables/" + table;
+        cntl.request_attachment().append(
+            R"({"value": [["m1", 111, 1.4, "2021-04-27", 1620471840256, true, "more str", null],)"
+            R"(["m2", 112, 1.5, "2021-04-28", 1620471840257, false, null, 1]]})");
+        env->http_channel.CallMethod(NULL, &cntl, NULL, NULL, NULL);
+        ASSERT_FALSE(cntl.Failed()) << cntl.ErrorText();
+        PutResp resp;
+        JsonReader reader(cntl.response_attachment().to_string().c_str());
+        reader >> resp;
+        ASSERT_EQ(0, resp.code) << resp.msg;
+        insert_cnt += 2;
+    }
+    // nothing is put if one of the rows is invalid
+    {
+        brpc::Controller cntl;
+        cntl.http_request().set_method(brpc::HTTP_METHOD_PUT);
+        cntl.http_request().uri() = "http://127.0.0.1:8010/dbs/" + env->db + "/tables/" + table;
+        cntl.request_attachment().append(
+            R"({"value": [["m3", 111, 1.4, "2021-04-27", 1620471840256, true, "more str", null], ["m4", 112]]})");
+        env->http_channel.CallMethod(NULL, &cntl, NULL, NULL, NULL);
+        ASSERT_FALSE(cntl.Failed()) << cntl.ErrorText();
+        PutResp resp;
+        JsonReader reader(cntl.response_attachment().to_string().c_str());
+        reader >> resp;
+        ASSERT_EQ(-1, resp.code);
+    }
+
     // Check data
     std::string select_all = "select * from " + table + ";";
     auto rs = env->cluster_remote->ExecuteSQL(env->db, select_all, &status);
@@ -258,6 +296,65 @@ TEST_F(APIServerTest, valid_put) {
     ASSERT_TRUE(env->cluster_remote->ExecuteDDL(env->db, "drop table " + table + ";", &status)) << status.msg;
 }
 
+TEST_F(APIServerTest, proto_put) {
+    const auto env = APIServerTestEnv::Instance();
+
+    std::string table = "proto_put";
+    std::string ddl = "create table if not exists " + table +
+                      "(field1 string, field2 timestamp, field3 double, field4 date, field5 int, field6 bool, "
+                      "index(key=field1, ts=field2));";
+    hybridse::sdk::Status status;
+    ASSERT_TRUE(env->cluster_remote->ExecuteDDL(env->db, ddl, &status)) << status.msg;
+    ASSERT_TRUE(env->cluster_sdk->Refresh());
+
+    PutRequest request;
+    auto row = request.add_value();
+    row->add_values()->set_string_value("k1");
+    row->add_values()->set_int_value(111);
+    row->add_values()->set_double_value(1.4);
+    row->add_values()->set_string_value("2021-04-27");
+    // null
+    row->add_values();
+    row->add_values()->set_bool_value(true);
+    {
+        brpc::Controller cntl;
+        cntl.http_request().set_method(brpc::HTTP_METHOD_PUT);
+        cntl.http_request().set_content_type("application/proto");
+        cntl.http_request().uri() = "http://127.0.0.1:8010/dbs/" + env->db + "/tables/" + table;
+        ASSERT_TRUE(WriteProto(request, &cntl.request_attachment()));
+        env->http_channel.CallMethod(NULL, &cntl, NULL, NULL, NULL);
+        ASSERT_FALSE(cntl.Failed()) << cntl.ErrorText();
+        PutResponse response;
+        ASSERT_TRUE(ReadProto(cntl.response_attachment(), &response));
+        ASSERT_EQ(0, response.code()) << response.msg();
+    }
+    // the value of the wrong type
+    row->mutable_values(1)->set_string_value("111");
+    row->mutable_values(1)->clear_int_value();
+    {
+        brpc::Controller cntl;
+        cntl.http_request().set_method(brpc::HTTP_METHOD_PUT);
+        cntl.http_request().set_content_type("application/proto");
+        cntl.http_request().uri() = "http://127.0.0.1:8010/dbs/" + env->db + "/tables/" + table;
+        ASSERT_TRUE(WriteProto(request, &cntl.request_attachment()));
+        env->http_channel.CallMethod(NULL, &cntl, NULL, NULL, NULL);
+        ASSERT_FALSE(cntl.Failed()) << cntl.ErrorText();
+        PutResponse response;
+        ASSERT_TRUE(ReadProto(cntl.response_attachment(), &response));
+        ASSERT_EQ(-1, response.code());
+    }
+
+    auto rs = env->cluster_remote->ExecuteSQL(env->db, "select * from " + table + ";", &status);
+    ASSERT_TRUE(rs) << "fail to execute sql";
+    ASSERT_EQ(1, rs->Size());
+    ASSERT_TRUE(rs->Next());
+    int64_t ts = 0;
+    ASSERT_TRUE(rs->GetTime(1, &ts));
+    ASSERT_EQ(111, ts);
+    ASSERT_TRUE(rs->IsNULL(4));
+    ASSERT_TRUE(env->cluster_remote->ExecuteDDL(env->db, "drop table " + table + ";", &status)) << status.msg;
+}
+
 TEST_F(APIServerTest, put_case1) {
     const auto env = APIServerTestEnv::Instance();
 
@@ -474,12 +571,112 @@ TEST_F(APIServerTest, procedure) {
         ASSERT_EQ(2, document["data"]["common_cols_data"].Size());
     }
 
+    // call procedure with protobuf body
+    {
+        ExecSPRequest request;
+        request.add_common_cols()->set_string_value("bb");
+        request.add_common_cols()->set_int_value(23);
+        request.add_common_cols()->set_int_value(1590738994000);
+        for (int i = 0; i < 2; i++) {
+            auto row = request.add_input();
+            row->add_values()->set_int_value(123 + i);
+            row->add_values()->set_float_value(5.1 + i);
+            row->add_values()->set_double_value(6.1 + i);
+            row->add_values()->set_string_value("2021-08-0" + std::to_string(i + 1));
+        }
+        request.set_need_schema(true);
+        brpc::Controller cntl;
+        cntl.http_request().set_method(brpc::HTTP_METHOD_POST);
+        cntl.http_request().set_content_type("application/proto");
+        cntl.http_request().uri() = "http://127.0.0.1:8010/dbs/" + env->db + "/procedures/" + sp_name;
+        ASSERT_TRUE(WriteProto(request, &cntl.request_attachment()));
+        env->http_channel.CallMethod(NULL, &cntl, NULL, NULL, NULL);
+        ASSERT_FALSE(cntl.Failed()) << cntl.ErrorText();
+
+        ExecSPResponse response;
+        ASSERT_TRUE(ReadProto(cntl.response_attachment(), &response));
+        ASSERT_EQ(0, response.code()) << response.msg();
+        ASSERT_EQ(3, response.schema_size());
+        ASSERT_EQ(2, response.data_size());
+        ASSERT_EQ(1, response.data(0).values_size());
+        ASSERT_EQ(2, response.common_cols_data().values_size());
+        ASSERT_EQ("bb", response.common_cols_data().values(0).string_value());
+
+        // the row of the wrong size
+        request.mutable_input(0)->add_values()->set_int_value(1);
+        brpc::Controller invalid_cntl;
+        invalid_cntl.http_request().set_method(brpc::HTTP_METHOD_POST);
+        invalid_cntl.http_request().set_content_type("application/proto");
+        invalid_cntl.http_request().uri() = "http://127.0.0.1:8010/dbs/" + env->db + "/procedures/" + sp_name;
+        ASSERT_TRUE(WriteProto(request, &invalid_cntl.request_attachment()));
+        env->http_channel.CallMethod(NULL, &invalid_cntl, NULL, NULL, NULL);
+        ASSERT_FALSE(invalid_cntl.Failed()) << invalid_cntl.ErrorText();
+        GeneralResponse error;
+        ASSERT_TRUE(ReadProto(invalid_cntl.response_attachment(), &error));
+        ASSERT_EQ(-1, error.code());
+    }
+
     // drop procedure and table
     std::string drop_sp_sql = "drop procedure " + sp_name + ";";
     ASSERT_TRUE(env->cluster_remote->ExecuteDDL(env->db, drop_sp_sql, &status));
     ASSERT_TRUE(env->cluster_remote->ExecuteDDL(env->db, "drop table trans;", &status));
 }
 
+TEST_F(APIServerTest, procedure_single_row) {
+    const auto env = APIServerTestEnv::Instance();
+
+    std::string ddl = "create table trans1(c1 string, c3 int, c4 bigint, c7 timestamp, index(key=c1, ts=c7));";
+    hybridse::sdk::Status status;
+    env->cluster_remote->ExecuteDDL(env->db, "drop table trans1;", &status);
+    ASSERT_TRUE(env->cluster_sdk->Refresh());
+    ASSERT_TRUE(env->cluster_remote->ExecuteDDL(env->db, ddl, &status)) << "fail to create table";
+    ASSERT_TRUE(env->cluster_sdk->Refresh());
+    ASSERT_TRUE(env->cluster_remote->ExecuteInsert(env->db, "insert into trans1 values(\"bb\",24,34,1590738994000);",
+                                                   &status));
+    // no constant columns, so the single row calls are batched
+    std::string sp_name = "sp1";
+    std::string sp_ddl =
+        "create procedure " + sp_name +
+        " (c1 string, c3 int, c4 bigint, c7 timestamp) begin SELECT c1, c3, sum(c4) OVER w1 as w1_c4_sum FROM trans1 "
+        "WINDOW w1 AS (PARTITION BY trans1.c1 ORDER BY trans1.c7 ROWS BETWEEN 2 PRECEDING AND CURRENT ROW); end;";
+    ASSERT_TRUE(env->cluster_remote->ExecuteDDL(env->db, sp_ddl, &status)) << "fail to create procedure";
+    ASSERT_TRUE(env->cluster_sdk->Refresh());
+
+    // the concurrent calls are answered with the rows of their own requests
+    std::vector<std::thread> threads;
+    std::atomic<int> ok_cnt(0);
+    for (int i = 0; i < 8; i++) {
+        threads.emplace_back([env, &sp_name, &ok_cnt, i]() {
+            brpc::Controller cntl;
+            cntl.http_request().set_method(brpc::HTTP_METHOD_POST);
+            cntl.http_request().uri() = "http://127.0.0.1:8010/dbs/" + env->db + "/procedures/" + sp_name;
+            cntl.request_attachment().append(R"({"input": [["bb", )" + std::to_string(i) +
+                                             R"(, 100, 1590738995000]]})");
+            env->http_channel.CallMethod(NULL, &cntl, NULL, NULL, NULL);
+            if (cntl.Failed()) {
+                return;
+            }
+            butil::rapidjson::Document document;
+            if (document.Parse(cntl.response_attachment().to_string().c_str()).HasParseError() ||
+                document["code"].GetInt() != 0 || document["data"]["data"].Size() != 1) {
+                LOG(WARNING) << "exec procedure resp: " << cntl.response_attachment().to_string();
+                return;
+            }
+            const auto& row = document["data"]["data"][0];
+            if (row[1].GetInt() == i && row[2].GetInt64() == 134) {
+                ok_cnt++;
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    ASSERT_EQ(8, ok_cnt.load());
+
+    ASSERT_TRUE(env->cluster_remote->ExecuteDDL(env->db, "drop procedure " + sp_name + ";", &status));
+    ASSERT_TRUE(env->cluster_remote->ExecuteDDL(env->db, "drop table trans1;", &status));
+}
+
 TEST_F(APIServerTest, getDBs) {
     const auto env = APIServerTestEnv::Instance();
     {
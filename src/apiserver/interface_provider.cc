@@ -112,6 +112,16 @@ InterfaceProvider& InterfaceProvider::post(const std::string& path, std::functio
     return *this;
 }
 
+InterfaceProvider& InterfaceProvider::putProto(const std::string& path, std::function<proto_func> callback) {
+    registerProtoRequest(brpc::HttpMethod::HTTP_METHOD_PUT, path, std::move(callback));
+    return *this;
+}
+
+InterfaceProvider& InterfaceProvider::postProto(const std::string& path, std::function<proto_func> callback) {
+    registerProtoRequest(brpc::HttpMethod::HTTP_METHOD_POST, path, std::move(callback));
+    return *this;
+}
+
 bool InterfaceProvider::matching(const Url& received, const Url& registered) {
     auto registeredParts = registered.parsePath();
     auto receivedParts = received.parsePath(true);
@@ -157,6 +167,17 @@ void InterfaceProvider::registerRequest(brpc::HttpMethod type, std::string const
     requests_[type].push_back(req);
 }
 
+void InterfaceProvider::registerProtoRequest(brpc::HttpMethod type, std::string const& url,
+                                             std::function<proto_func>&& callback) {
+    Url parsed;
+    if (!ReducedUrlParser::parse(url, &parsed)) {
+        LOG(ERROR) << "Fail to parse url " << url;
+        return;
+    }
+    BuiltProtoRequest req{parsed, callback};
+    proto_requests_[type].push_back(req);
+}
+
 bool InterfaceProvider::handle(const std::string& path, const brpc::HttpMethod& method, const butil::IOBuf& req_body,
                                JsonWriter& writer) {
     auto err = GeneralError();
@@ -193,5 +214,46 @@ bool InterfaceProvider::handle(const std::string& path, const brpc::HttpMethod&
     request->callback(params, req_body, writer);
     return true;
 }
+
+bool InterfaceProvider::handleProto(const std::string& path, const brpc::HttpMethod& method,
+                                    const butil::IOBuf& req_body, butil::IOBuf* resp_body) {
+    Url url;
+    if (!ReducedUrlParser::parse(path, &url)) {
+        WriteProtoError("invalid url", resp_body);
+        return false;
+    }
+    auto requestList = proto_requests_.find(method);
+    if (requestList == std::end(proto_requests_)) {
+        WriteProtoError("unsupported method", resp_body);
+        return false;
+    }
+    auto request = std::find_if(std::begin(requestList->second), std::end(requestList->second),
+                                [&](BuiltProtoRequest const& request) { return matching(url, request.url); });
+    if (request == std::end(requestList->second)) {
+        WriteProtoError("no match method", resp_body);
+        return false;
+    }
+    auto params = extractParameters(url, request->url);
+    request->callback(params, req_body, resp_body);
+    return true;
+}
+
+bool ReadProto(const butil::IOBuf& buf, google::protobuf::Message* message) {
+    butil::IOBufAsZeroCopyInputStream stream(buf);
+    return message->ParseFromZeroCopyStream(&stream);
+}
+
+bool WriteProto(const google::protobuf::Message& message, butil::IOBuf* buf) {
+    butil::IOBufAsZeroCopyOutputStream stream(buf);
+    return message.SerializeToZeroCopyStream(&stream);
+}
+
+void WriteProtoError(const std::string& msg, butil::IOBuf* buf) {
+    GeneralResponse response;
+    response.set_code(-1);
+    response.set_msg(msg);
+    WriteProto(response, buf);
+}
+
 }  // namespace apiserver
 }  // namespace openmldb
@@ -32,6 +32,7 @@
 #include "apiserver/json_helper.h"
 #include "brpc/http_method.h"  // HttpMethod
 #include "butil/iobuf.h"       // IOBuf
+#include "google/protobuf/message.h"
 #include "proto/api_server.pb.h"
 
 namespace openmldb {
@@ -117,6 +118,8 @@ class InterfaceProvider {
 
     typedef std::unordered_map<std::string, std::string> Params;
     using func = void(const Params& params, const butil::IOBuf& req_body, JsonWriter& writer);  // NOLINT
+    // the handler of the request whose body is a protobuf message, it writes the response message to resp_body
+    using proto_func = void(const Params& params, const butil::IOBuf& req_body, butil::IOBuf* resp_body);
     /**
      *  Registers a new get request handler.
      *
@@ -144,25 +147,51 @@ class InterfaceProvider {
      */
     InterfaceProvider& post(std::string const& path, std::function<func> callback);
 
+    /**
+     *  Registers a new put request handler of the protobuf body.
+     */
+    InterfaceProvider& putProto(std::string const& path, std::function<proto_func> callback);
+
+    /**
+     *  Registers a new post request handler of the protobuf body.
+     */
+    InterfaceProvider& postProto(std::string const& path, std::function<proto_func> callback);
+
     bool handle(const std::string& path, const brpc::HttpMethod& method, const butil::IOBuf& req_body,
                 JsonWriter& writer);  // NOLINT
 
+    // an error GeneralResponse is written if no handler matches
+    bool handleProto(const std::string& path, const brpc::HttpMethod& method, const butil::IOBuf& req_body,
+                     butil::IOBuf* resp_body);
+
  private:
     struct BuiltRequest {
         Url url;
         std::function<func> callback;
     };
 
+    struct BuiltProtoRequest {
+        Url url;
+        std::function<proto_func> callback;
+    };
+
     static bool matching(const Url& received, const Url& registered);
     static std::unordered_map<std::string, std::string> extractParameters(const Url& received, const Url& registered);
 
  private:
     void registerRequest(brpc::HttpMethod, const std::string& path, std::function<func>&& callback);
+    void registerProtoRequest(brpc::HttpMethod, const std::string& path, std::function<proto_func>&& callback);
 
  private:
     std::unordered_map<int, std::vector<BuiltRequest>> requests_;
+    std::unordered_map<int, std::vector<BuiltProtoRequest>> proto_requests_;
 };
 
+// read or write the protobuf message of the body without a copy of it
+bool ReadProto(const butil::IOBuf& buf, google::protobuf::Message* message);
+bool WriteProto(const google::protobuf::Message& message, butil::IOBuf* buf);
+void WriteProtoError(const std::string& msg, butil::IOBuf* buf);
+
 struct GeneralError {
     GeneralError() = default;
     explicit GeneralError(std::string m) : msg(std::move(m)) {}
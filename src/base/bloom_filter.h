@@ -0,0 +1,113 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_BASE_BLOOM_FILTER_H_
+#define SRC_BASE_BLOOM_FILTER_H_
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+#include "base/hash.h"
+#include "base/slice.h"
+
+namespace openmldb {
+namespace base {
+
+// BlockedBloomFilter is sized for capacity keys and never grows. All the probes of a key are
+// in one block of a cache line, so a lookup touches one cache line. Add may be called
+// concurrently with Add and MayContain. Once more keys than twice the capacity are added, the
+// filter is too full to filter anything and MayContain always returns true, so the owner
+// should build a new one
+class BlockedBloomFilter {
+ public:
+    BlockedBloomFilter(uint64_t capacity, uint32_t bits_per_key)
+        : capacity_(std::max<uint64_t>(capacity, 1)), probe_num_(0), block_num_(0), added_cnt_(0) {
+        bits_per_key = std::max<uint32_t>(bits_per_key, 1);
+        // ln(2) * bits_per_key probes give the lowest false positive rate
+        probe_num_ = std::min<uint32_t>(std::max<uint32_t>(bits_per_key * 69 / 100, 1), 30);
+        block_num_ = (capacity_ * bits_per_key + kBlockBits - 1) / kBlockBits;
+        bits_.reset(new std::atomic<uint64_t>[block_num_ * kWordsPerBlock]);
+        for (uint64_t i = 0; i < block_num_ * kWordsPerBlock; i++) {
+            bits_[i].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    void Add(const Slice& key) {
+        if (added_cnt_.fetch_add(1, std::memory_order_relaxed) >= capacity_ * 2) {
+            return;
+        }
+        uint64_t h = MurmurHash64A(key.data(), key.size(), kSeed);
+        std::atomic<uint64_t>* block = GetBlock(h);
+        uint32_t bit = static_cast<uint32_t>(h);
+        uint32_t delta = (bit >> 17) | (bit << 15);
+        for (uint32_t i = 0; i < probe_num_; i++) {
+            uint32_t pos = bit % kBlockBits;
+            block[pos / 64].fetch_or(1ull << (pos % 64), std::memory_order_relaxed);
+            bit += delta;
+        }
+    }
+
+    // return false if the key is not added for sure
+    bool MayContain(const Slice& key) const {
+        if (IsFull()) {
+            return true;
+        }
+        uint64_t h = MurmurHash64A(key.data(), key.size(), kSeed);
+        const std::atomic<uint64_t>* block = GetBlock(h);
+        uint32_t bit = static_cast<uint32_t>(h);
+        uint32_t delta = (bit >> 17) | (bit << 15);
+        for (uint32_t i = 0; i < probe_num_; i++) {
+            uint32_t pos = bit % kBlockBits;
+            if ((block[pos / 64].load(std::memory_order_relaxed) & (1ull << (pos % 64))) == 0) {
+                return false;
+            }
+            bit += delta;
+        }
+        return true;
+    }
+
+    inline bool IsFull() const { return added_cnt_.load(std::memory_order_relaxed) > capacity_ * 2; }
+
+    inline uint64_t GetCapacity() const { return capacity_; }
+
+    // the count of the calls of Add, the same key is counted every time it is added
+    inline uint64_t GetAddedCnt() const { return added_cnt_.load(std::memory_order_relaxed); }
+
+    inline uint64_t GetByteSize() const { return block_num_ * kWordsPerBlock * sizeof(uint64_t); }
+
+ private:
+    inline std::atomic<uint64_t>* GetBlock(uint64_t h) const {
+        // the high bits choose the block and the low bits choose the bits in the block
+        return &bits_[((h >> 32) * block_num_ >> 32) * kWordsPerBlock];
+    }
+
+ private:
+    static constexpr uint32_t kBlockBits = 512;
+    static constexpr uint32_t kWordsPerBlock = kBlockBits / 64;
+    static constexpr uint32_t kSeed = 0xbc9f1d34;
+    const uint64_t capacity_;
+    uint32_t probe_num_;
+    uint64_t block_num_;
+    std::atomic<uint64_t> added_cnt_;
+    std::unique_ptr<std::atomic<uint64_t>[]> bits_;
+};
+
+}  // namespace base
+}  // namespace openmldb
+#endif  // SRC_BASE_BLOOM_FILTER_H_
@@ -0,0 +1,149 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_BASE_EPOCH_H_
+#define SRC_BASE_EPOCH_H_
+
+#include <atomic>
+#include <functional>
+#include <map>
+#include <mutex>   // NOLINT
+#include <thread>  // NOLINT
+
+namespace openmldb {
+namespace base {
+
+// EpochManager tells when the memory unlinked from a structure is not referenced by any reader.
+// A reader announces the epoch it starts at in a slot for as long as it reads, and a writer stamps
+// the memory it unlinks with the current epoch. The memory stamped with an epoch less than the
+// epochs of all the readers can be freed.
+// The slots are held by the readers rather than the threads, as a bthread may move to another
+// thread while it reads. The readers which find no free slot are kept in a map under a lock.
+class EpochManager {
+ public:
+    static constexpr uint32_t kSlotCnt = 256;
+
+    EpochManager() : epoch_(1), slots_(), overflow_mu_(), overflow_(), overflow_cnt_(0) {}
+    EpochManager(const EpochManager&) = delete;
+    EpochManager& operator=(const EpochManager&) = delete;
+
+    // the manager shared by the tables of the process
+    static EpochManager* Default() {
+        static EpochManager manager;
+        return &manager;
+    }
+
+    // announce a reader at the current epoch and return its slot, kSlotCnt if it is in the overflow map
+    uint32_t Enter(uint64_t* epoch_out) {
+        uint64_t epoch = epoch_.load(std::memory_order_seq_cst);
+        *epoch_out = epoch;
+        uint32_t start = std::hash<std::thread::id>()(std::this_thread::get_id()) % kSlotCnt;
+        for (uint32_t i = 0; i < kSlotCnt; i++) {
+            auto& slot = slots_[(start + i) % kSlotCnt].epoch;
+            uint64_t expected = 0;
+            if (slot.load(std::memory_order_relaxed) == 0 &&
+                slot.compare_exchange_strong(expected, epoch, std::memory_order_seq_cst)) {
+                return (start + i) % kSlotCnt;
+            }
+        }
+        std::lock_guard<std::mutex> lock(overflow_mu_);
+        overflow_[epoch]++;
+        overflow_cnt_.fetch_add(1, std::memory_order_seq_cst);
+        return kSlotCnt;
+    }
+
+    void Exit(uint32_t slot, uint64_t epoch) {
+        if (slot < kSlotCnt) {
+            slots_[slot].epoch.store(0, std::memory_order_release);
+            return;
+        }
+        std::lock_guard<std::mutex> lock(overflow_mu_);
+        auto iter = overflow_.find(epoch);
+        if (iter != overflow_.end() && --iter->second == 0) {
+            overflow_.erase(iter);
+        }
+        overflow_cnt_.fetch_sub(1, std::memory_order_seq_cst);
+    }
+
+    // the epoch the unlinked memory is stamped with
+    uint64_t GetEpoch() const { return epoch_.load(std::memory_order_seq_cst); }
+    const std::atomic<uint64_t>* GetEpochPtr() const { return &epoch_; }
+
+    // advance the epoch and return the greatest epoch whose memory can be freed
+    uint64_t Advance() {
+        uint64_t min_epoch = epoch_.fetch_add(1, std::memory_order_seq_cst) + 1;
+        for (uint32_t i = 0; i < kSlotCnt; i++) {
+            uint64_t epoch = slots_[i].epoch.load(std::memory_order_seq_cst);
+            if (epoch > 0 && epoch < min_epoch) {
+                min_epoch = epoch;
+            }
+        }
+        if (overflow_cnt_.load(std::memory_order_seq_cst) > 0) {
+            std::lock_guard<std::mutex> lock(overflow_mu_);
+            if (!overflow_.empty() && overflow_.begin()->first < min_epoch) {
+                min_epoch = overflow_.begin()->first;
+            }
+        }
+        return min_epoch - 1;
+    }
+
+ private:
+    struct alignas(64) Slot {
+        std::atomic<uint64_t> epoch{0};
+    };
+
+    std::atomic<uint64_t> epoch_;
+    Slot slots_[kSlotCnt];
+    std::mutex overflow_mu_;
+    std::map<uint64_t, uint32_t> overflow_;
+    std::atomic<uint32_t> overflow_cnt_;
+};
+
+// EpochGuard keeps the reader announced during its lifetime, it does nothing without a manager
+class EpochGuard {
+ public:
+    EpochGuard() : manager_(NULL), slot_(0), epoch_(0) {}
+    explicit EpochGuard(EpochManager* manager) : manager_(NULL), slot_(0), epoch_(0) { Enter(manager); }
+    ~EpochGuard() { Exit(); }
+    EpochGuard(const EpochGuard&) = delete;
+    EpochGuard& operator=(const EpochGuard&) = delete;
+
+    void Enter(EpochManager* manager) {
+        if (manager_ != NULL || manager == NULL) {
+            return;
+        }
+        manager_ = manager;
+        slot_ = manager->Enter(&epoch_);
+    }
+
+    void Exit() {
+        if (manager_ != NULL) {
+            manager_->Exit(slot_, epoch_);
+            manager_ = NULL;
+        }
+    }
+
+    bool IsEntered() const { return manager_ != NULL; }
+
+ private:
+    EpochManager* manager_;
+    uint32_t slot_;
+    uint64_t epoch_;
+};
+
+}  // namespace base
+}  // namespace openmldb
+#endif  // SRC_BASE_EPOCH_H_
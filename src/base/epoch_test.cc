@@ -0,0 +1,77 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "base/epoch.h"
+
+#include <memory>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace openmldb {
+namespace base {
+
+class EpochTest : public ::testing::Test {
+ public:
+    EpochTest() {}
+    ~EpochTest() {}
+};
+
+TEST_F(EpochTest, Advance) {
+    EpochManager manager;
+    uint64_t retired = manager.GetEpoch();
+    // nothing is reading
+    ASSERT_GE(manager.Advance(), retired);
+    {
+        EpochGuard guard(&manager);
+        retired = manager.GetEpoch();
+        // the reader may read the memory retired at its epoch
+        ASSERT_LT(manager.Advance(), retired);
+        ASSERT_LT(manager.Advance(), retired);
+        {
+            // the later readers do not hold the earlier memory
+            EpochGuard guard2(&manager);
+            ASSERT_LT(manager.Advance(), retired);
+        }
+    }
+    ASSERT_GE(manager.Advance(), retired);
+    EpochGuard guard;
+    ASSERT_FALSE(guard.IsEntered());
+}
+
+TEST_F(EpochTest, Overflow) {
+    EpochManager manager;
+    std::vector<std::unique_ptr<EpochGuard>> guards;
+    for (uint32_t i = 0; i < EpochManager::kSlotCnt; i++) {
+        guards.emplace_back(new EpochGuard(&manager));
+        manager.Advance();
+    }
+    uint64_t retired = manager.GetEpoch();
+    guards.emplace_back(new EpochGuard(&manager));
+    // the first reader holds the earliest epoch
+    guards.erase(guards.begin(), guards.begin() + EpochManager::kSlotCnt);
+    ASSERT_LT(manager.Advance(), retired);
+    guards.clear();
+    ASSERT_GE(manager.Advance(), retired);
+}
+
+}  // namespace base
+}  // namespace openmldb
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
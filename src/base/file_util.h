@@ -29,6 +29,7 @@
 #include <vector>
 
 #include "base/glog_wapper.h"  // NOLINT
+#include "base/rate_limiter.h"
 
 namespace openmldb {
 namespace base {
@@ -219,6 +220,32 @@ inline static bool RemoveDirRecursive(const std::string& path) {
     return rmdir(path.c_str()) == 0;
 }
 
+// remove the files one by one, every file waits for the limiter by its size first, so the extents freed by
+// the removes do not burst on the disk
+inline static bool RemoveDirRecursive(const std::string& path, RateLimiter* limiter) {
+    std::vector<std::string> file_vec;
+    if (GetChildFileName(path, file_vec) != 0) {
+        return false;
+    }
+    for (const auto& file : file_vec) {
+        struct stat st;
+        bool exists = lstat(file.c_str(), &st) == 0;
+        if (exists && S_ISDIR(st.st_mode)) {
+            if (!RemoveDirRecursive(file, limiter)) {
+                return false;
+            }
+            continue;
+        }
+        if (limiter != NULL && exists && st.st_size > 0) {
+            limiter->Throttle(st.st_size);
+        }
+        if (remove(file.c_str()) != 0) {
+            return false;
+        }
+    }
+    return rmdir(path.c_str()) == 0;
+}
+
 inline static std::string ParseFileNameFromPath(const std::string& path) {
     size_t index = path.rfind('/');
     if (index == std::string::npos) {
@@ -69,6 +69,26 @@ TEST_F(FileUtilTest, RemoveDirRecursive) {
     ASSERT_FALSE(IsExists("/tmp/gtest"));
 }
 
+TEST_F(FileUtilTest, RemoveDirRecursiveLimited) {
+    ASSERT_TRUE(MkdirRecur("/tmp/gtest/test/"));
+    FILE* f = fopen("/tmp/gtest/test0.txt", "w");
+    if (f != nullptr) {
+        fputs(std::string(1024, 'a').c_str(), f);
+        fclose(f);
+    }
+    f = fopen("/tmp/gtest/test/test1.txt", "w");
+    if (f != nullptr) {
+        fputs(std::string(1024, 'a').c_str(), f);
+        fclose(f);
+    }
+    // the second file waits for the 1KB of the first one
+    RateLimiter limiter(10 * 1024);
+    uint64_t start = ::baidu::common::timer::get_micros();
+    ASSERT_TRUE(RemoveDirRecursive("/tmp/gtest", &limiter));
+    ASSERT_GE(::baidu::common::timer::get_micros() - start, 90000u);
+    ASSERT_FALSE(IsExists("/tmp/gtest"));
+}
+
 TEST_F(FileUtilTest, ParseFileNameFromPath) {
     ASSERT_EQ("test.txt", ParseFileNameFromPath("test.txt"));
     ASSERT_EQ("test", ParseFileNameFromPath("/home/rtidb/test"));
@@ -20,82 +20,55 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
+#include <algorithm>
+#include <list>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "base/slice.h"
+#include "butil/iobuf.h"
 #include "proto/tablet.pb.h"
 
 namespace openmldb {
 namespace base {
 
+// KvIterator decodes the pairs of a scan or traverse response, which are in the pairs field or the attachment of it.
+// The values reference the buffer decoded rather than copies, except the ones spanning several blocks of the
+// attachment. They are valid as long as the iterator.
 class KvIterator {
  public:
-    explicit KvIterator(::openmldb::api::ScanResponse* response)
-        : response_(response),
-          buffer_(NULL),
-          tsize_(0),
-          offset_(0),
-          c_size_(0),
-          tmp_(NULL),
-          has_pk_(false),
-          auto_clean_(true) {
-        buffer_ = reinterpret_cast<char*>(&((*response->mutable_pairs())[0]));
-        tmp_ = new Slice();
-        tsize_ = response->pairs().size();
-        Next();
-    }
+    explicit KvIterator(::openmldb::api::ScanResponse* response) : KvIterator(response, true) {}
 
-    explicit KvIterator(::openmldb::api::TraverseResponse* response)
-        : response_(response),
-          buffer_(NULL),
-          tsize_(0),
-          offset_(0),
-          c_size_(0),
-          tmp_(NULL),
-          has_pk_(true),
-          auto_clean_(true) {
-        buffer_ = reinterpret_cast<char*>(&((*response->mutable_pairs())[0]));
-        tmp_ = new Slice();
-        tsize_ = response->pairs().size();
-        Next();
-    }
+    explicit KvIterator(::openmldb::api::TraverseResponse* response) : KvIterator(response, true) {}
 
     KvIterator(::openmldb::api::ScanResponse* response, bool clean)
-        : response_(response),
-          buffer_(NULL),
-          tsize_(0),
-          offset_(0),
-          c_size_(0),
-          tmp_(NULL),
-          has_pk_(false),
-          auto_clean_(clean) {
-        buffer_ = reinterpret_cast<char*>(&((*response->mutable_pairs())[0]));
-        tsize_ = response->pairs().size();
-        tmp_ = new Slice();
-        Next();
+        : response_(response), has_pk_(false), auto_clean_(clean) {
+        Init(response->mutable_pairs(), NULL);
     }
 
     KvIterator(::openmldb::api::TraverseResponse* response, bool clean)
-        : response_(response),
-          buffer_(NULL),
-          tsize_(0),
-          offset_(0),
-          c_size_(0),
-          tmp_(NULL),
-          has_pk_(true),
-          auto_clean_(clean) {
-        buffer_ = reinterpret_cast<char*>(&((*response->mutable_pairs())[0]));
-        tsize_ = response->pairs().size();
-        tmp_ = new Slice();
-        Next();
+        : response_(response), has_pk_(true), auto_clean_(clean) {
+        Init(response->mutable_pairs(), NULL);
+    }
+
+    // the pairs are taken from attachment if it is not empty, or the response for the servers without the support
+    KvIterator(::openmldb::api::ScanResponse* response, butil::IOBuf* attachment)
+        : response_(response), has_pk_(false), auto_clean_(true) {
+        Init(response->mutable_pairs(), attachment);
+    }
+
+    KvIterator(::openmldb::api::TraverseResponse* response, butil::IOBuf* attachment)
+        : response_(response), has_pk_(true), auto_clean_(true) {
+        Init(response->mutable_pairs(), attachment);
     }
 
     ~KvIterator() {
         if (auto_clean_) {
             delete response_;
         }
-        delete tmp_;
     }
 
     bool Valid() {
@@ -120,31 +93,43 @@ class KvIterator {
                 offset_ += 8;
                 return;
             }
+            const char* header = Read(16, &scratch_);
+            if (header == NULL) {
+                offset_ = tsize_ + 1;
+                return;
+            }
             uint32_t total_size = 0;
-            memcpy(static_cast<void*>(&total_size), buffer_, 4);
-            buffer_ += 4;
+            memcpy(static_cast<void*>(&total_size), header, 4);
             uint32_t pk_size = 0;
-            memcpy(static_cast<void*>(&pk_size), buffer_, 4);
-            buffer_ += 4;
-            memcpy(static_cast<void*>(&time_), buffer_, 8);
-            buffer_ += 8;
-            pk_.assign(buffer_, pk_size);
-            buffer_ += pk_size;
-            tmp_->reset(buffer_, total_size - pk_size - 8);
-            buffer_ += (total_size - pk_size - 8);
+            memcpy(static_cast<void*>(&pk_size), header + 4, 4);
+            memcpy(static_cast<void*>(&time_), header + 8, 8);
+            const char* pk = Read(pk_size, &scratch_);
+            if (pk == NULL || total_size < pk_size + 8) {
+                offset_ = tsize_ + 1;
+                return;
+            }
+            pk_.assign(pk, pk_size);
+            if (!ReadValue(total_size - pk_size - 8)) {
+                return;
+            }
             offset_ += (8 + total_size);
         } else {
             if (offset_ + 4 > tsize_) {
                 offset_ += 4;
                 return;
             }
+            const char* header = Read(12, &scratch_);
+            if (header == NULL) {
+                offset_ = tsize_ + 1;
+                return;
+            }
             uint32_t block_size = 0;
-            memcpy(static_cast<void*>(&block_size), buffer_, 4);
-            buffer_ += 4;
-            memcpy(static_cast<void*>(&time_), buffer_, 8);
-            buffer_ += 8;
-            tmp_->reset(buffer_, block_size - 8);
-            buffer_ += (block_size - 8);
+            memcpy(static_cast<void*>(&block_size), header, 4);
+            memcpy(static_cast<void*>(&time_), header + 4, 8);
+            if (block_size < 8 || !ReadValue(block_size - 8)) {
+                offset_ = tsize_ + 1;
+                return;
+            }
             offset_ += (4 + block_size);
         }
     }
@@ -153,17 +138,85 @@ class KvIterator {
 
     std::string GetPK() const { return pk_; }
 
-    Slice GetValue() const { return *tmp_; }
+    Slice GetValue() const { return value_; }
+
+ private:
+    void Init(std::string* pairs, butil::IOBuf* attachment) {
+        offset_ = 0;
+        time_ = 0;
+        block_idx_ = 0;
+        block_offset_ = 0;
+        if (attachment != NULL && !attachment->empty()) {
+            attachment_.swap(*attachment);
+            for (size_t i = 0; i < attachment_.backing_block_num(); i++) {
+                butil::StringPiece block = attachment_.backing_block(i);
+                blocks_.emplace_back(block.data(), block.size());
+            }
+            tsize_ = attachment_.size();
+        } else {
+            blocks_.emplace_back(pairs->data(), pairs->size());
+            tsize_ = pairs->size();
+        }
+        Next();
+    }
+
+    // return the next size bytes, they are copied to scratch if they span several blocks. NULL if there are not
+    // enough bytes left
+    const char* Read(uint32_t size, std::string* scratch) {
+        while (block_idx_ < blocks_.size() && block_offset_ == blocks_[block_idx_].second) {
+            block_idx_++;
+            block_offset_ = 0;
+        }
+        if (block_idx_ < blocks_.size() && blocks_[block_idx_].second - block_offset_ >= size) {
+            const char* data = blocks_[block_idx_].first + block_offset_;
+            block_offset_ += size;
+            return data;
+        }
+        scratch->resize(size);
+        uint32_t copied = 0;
+        while (copied < size && block_idx_ < blocks_.size()) {
+            size_t n = std::min<size_t>(size - copied, blocks_[block_idx_].second - block_offset_);
+            memcpy(&(*scratch)[copied], blocks_[block_idx_].first + block_offset_, n);
+            copied += n;
+            block_offset_ += n;
+            if (block_offset_ == blocks_[block_idx_].second) {
+                block_idx_++;
+                block_offset_ = 0;
+            }
+        }
+        return copied == size ? scratch->data() : NULL;
+    }
+
+    bool ReadValue(uint32_t size) {
+        const char* data = Read(size, &scratch_);
+        if (data == NULL) {
+            offset_ = tsize_ + 1;
+            return false;
+        }
+        if (data == scratch_.data()) {
+            // the value spanning several blocks is kept until the iterator is destroyed
+            copied_.emplace_back(std::move(scratch_));
+            scratch_.clear();
+            data = copied_.back().data();
+        }
+        value_.reset(data, size);
+        return true;
+    }
 
  private:
     ::google::protobuf::Message* response_;
-    char* buffer_;
+    butil::IOBuf attachment_;
+    // the data and size of each block of the pairs
+    std::vector<std::pair<const char*, size_t>> blocks_;
+    size_t block_idx_;
+    size_t block_offset_;
     uint32_t tsize_;
     uint32_t offset_;
-    uint32_t c_size_;
     uint64_t time_;
-    Slice* tmp_;
+    Slice value_;
     std::string pk_;
+    std::string scratch_;
+    std::list<std::string> copied_;
     bool has_pk_;
     bool auto_clean_;
 };
@@ -17,6 +17,8 @@
 #include "base/kv_iterator.h"
 
 #include <iostream>
+#include <string>
+#include <vector>
 
 #include "base/strings.h"
 #include "codec/row_codec.h"
@@ -100,6 +102,55 @@ TEST_F(KvIteratorTest, HasPK) {
     ASSERT_FALSE(kv_it.Valid());
 }
 
+static void NoDelete(void* data) {}
+
+TEST_F(KvIteratorTest, Attachment) {
+    std::string pairs;
+    pairs.resize(26 * 3);
+    ::openmldb::codec::EncodeFull("test1", 9527, "hello", 5, &pairs[0], 0);
+    ::openmldb::codec::EncodeFull("test2", 9528, "hell1", 5, &pairs[0], 26);
+    ::openmldb::codec::EncodeFull("test3", 9529, "hell2", 5, &pairs[0], 52);
+    // the second value and the third header span the blocks
+    butil::IOBuf buf;
+    buf.append_user_data(&pairs[0], 48, NoDelete);
+    buf.append_user_data(&pairs[48], 10, NoDelete);
+    buf.append_user_data(&pairs[58], pairs.size() - 58, NoDelete);
+    ASSERT_EQ(3u, buf.backing_block_num());
+    ::openmldb::api::TraverseResponse* response = new ::openmldb::api::TraverseResponse();
+    KvIterator kv_it(response, &buf);
+    ASSERT_TRUE(buf.empty());
+    std::vector<Slice> values;
+    for (int i = 0; i < 3; i++) {
+        ASSERT_TRUE(kv_it.Valid());
+        ASSERT_EQ("test" + std::to_string(i + 1), kv_it.GetPK());
+        ASSERT_EQ(9527u + i, kv_it.GetKey());
+        values.push_back(kv_it.GetValue());
+        kv_it.Next();
+    }
+    ASSERT_FALSE(kv_it.Valid());
+    // the values within a block reference it, and all of them are valid until the iterator is destroyed
+    ASSERT_EQ(&pairs[21], values[0].data());
+    ASSERT_EQ(&pairs[73], values[2].data());
+    ASSERT_EQ("hello", values[0].ToString());
+    ASSERT_EQ("hell1", values[1].ToString());
+    ASSERT_EQ("hell2", values[2].ToString());
+}
+
+TEST_F(KvIteratorTest, EmptyAttachment) {
+    ::openmldb::api::ScanResponse* response = new ::openmldb::api::ScanResponse();
+    std::string* pairs = response->mutable_pairs();
+    pairs->resize(17);
+    ::openmldb::codec::Encode(9527, "hello", 5, &(*pairs)[0], 0);
+    // the servers not knowing the attachment return the pairs in the response
+    butil::IOBuf buf;
+    KvIterator kv_it(response, &buf);
+    ASSERT_TRUE(kv_it.Valid());
+    ASSERT_EQ(9527u, kv_it.GetKey());
+    ASSERT_EQ("hello", kv_it.GetValue().ToString());
+    kv_it.Next();
+    ASSERT_FALSE(kv_it.Valid());
+}
+
 }  // namespace base
 }  // namespace openmldb
 
@@ -0,0 +1,175 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "base/priority_executor.h"
+
+#include <algorithm>
+
+namespace openmldb {
+namespace base {
+
+PriorityExecutor::PriorityExecutor(uint32_t thread_num, const std::vector<uint32_t>& limits)
+    : limits_(kClassCnt, 1),
+      mu_(),
+      cv_(),
+      pending_(kClassCnt),
+      running_(kClassCnt, 0),
+      delayed_(),
+      delayed_seq_(0),
+      stop_(false),
+      threads_() {
+    uint32_t limit_sum = 0;
+    for (uint32_t i = 0; i < kClassCnt; i++) {
+        if (i < limits.size()) {
+            limits_[i] = std::max<uint32_t>(limits[i], 1);
+        }
+        limit_sum += limits_[i];
+    }
+    if (thread_num == 0) {
+        thread_num = limit_sum;
+    }
+    for (uint32_t i = 0; i < thread_num; i++) {
+        threads_.emplace_back(&PriorityExecutor::Run, this);
+    }
+}
+
+PriorityExecutor::~PriorityExecutor() { Stop(); }
+
+void PriorityExecutor::AddTask(Class cls, const Task& task) {
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        if (stop_) {
+            return;
+        }
+        pending_[cls].push_back(task);
+    }
+    cv_.notify_one();
+}
+
+void PriorityExecutor::DelayTask(Class cls, uint64_t delay, const Task& task) {
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        if (stop_) {
+            return;
+        }
+        delayed_.push({Clock::now() + std::chrono::milliseconds(delay), delayed_seq_++, cls, task});
+    }
+    // the waiting threads wait until the due of the earliest delayed task
+    cv_.notify_one();
+}
+
+void PriorityExecutor::Stop() {
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        if (stop_) {
+            return;
+        }
+        stop_ = true;
+        while (!delayed_.empty()) {
+            delayed_.pop();
+        }
+    }
+    cv_.notify_all();
+    for (auto& thread : threads_) {
+        thread.join();
+    }
+}
+
+uint64_t PriorityExecutor::GetPendingCnt(Class cls) const {
+    std::lock_guard<std::mutex> lock(mu_);
+    return pending_[cls].size();
+}
+
+uint64_t PriorityExecutor::GetRunningCnt(Class cls) const {
+    std::lock_guard<std::mutex> lock(mu_);
+    return running_[cls];
+}
+
+uint64_t PriorityExecutor::GetDelayedCnt() const {
+    std::lock_guard<std::mutex> lock(mu_);
+    return delayed_.size();
+}
+
+const char* PriorityExecutor::GetClassName(Class cls) {
+    switch (cls) {
+        case kKeepAlive:
+            return "keep_alive";
+        case kReplication:
+            return "replication";
+        case kTask:
+            return "task";
+        case kGc:
+            return "gc";
+        case kSnapshot:
+            return "snapshot";
+        default:
+            return "unknown";
+    }
+}
+
+PriorityExecutor::Class PriorityExecutor::PickClass() const {
+    for (uint32_t i = 0; i < kClassCnt; i++) {
+        if (!pending_[i].empty() && running_[i] < limits_[i]) {
+            return static_cast<Class>(i);
+        }
+    }
+    return kClassCnt;
+}
+
+void PriorityExecutor::Run() {
+    std::unique_lock<std::mutex> lock(mu_);
+    while (true) {
+        auto now = Clock::now();
+        while (!delayed_.empty() && delayed_.top().due <= now) {
+            // the task is a const member of the top, copy it out before the pop
+            pending_[delayed_.top().cls].push_back(delayed_.top().task);
+            delayed_.pop();
+        }
+        Class cls = PickClass();
+        if (cls != kClassCnt) {
+            Task task;
+            task.swap(pending_[cls].front());
+            pending_[cls].pop_front();
+            running_[cls]++;
+            lock.unlock();
+            task();
+            lock.lock();
+            running_[cls]--;
+            continue;
+        }
+        if (stop_) {
+            bool idle = true;
+            for (const auto& tasks : pending_) {
+                idle = idle && tasks.empty();
+            }
+            if (idle) {
+                // the threads waiting for the classes at their limits exit too
+                cv_.notify_all();
+                break;
+            }
+        }
+        if (delayed_.empty()) {
+            cv_.wait(lock);
+        } else {
+            // the heap may be changed while waiting, so wait on a copy of the due
+            Clock::time_point due = delayed_.top().due;
+            cv_.wait_until(lock, due);
+        }
+    }
+}
+
+}  // namespace base
+}  // namespace openmldb
@@ -0,0 +1,116 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_BASE_PRIORITY_EXECUTOR_H_
+#define SRC_BASE_PRIORITY_EXECUTOR_H_
+
+#include <stdint.h>
+
+#include <chrono>              // NOLINT
+#include <condition_variable>  // NOLINT
+#include <deque>
+#include <mutex>               // NOLINT
+#include <queue>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include <boost/function.hpp>
+
+namespace openmldb {
+namespace base {
+
+// PriorityExecutor runs the background tasks of the classes on one set of threads. A free thread takes the
+// task of the class with the highest priority among the classes running less tasks than their limits, so the
+// thread num caps the cpu of all the background work and the limit of a class caps its share.
+class PriorityExecutor {
+ public:
+    typedef boost::function<void()> Task;
+
+    // the classes in the order of their priority
+    enum Class : uint32_t {
+        kKeepAlive = 0,
+        kReplication,
+        kTask,
+        kGc,
+        kSnapshot,
+        kClassCnt,
+    };
+
+    // the tasks of one class, which is posted to like a thread pool
+    class Queue {
+     public:
+        Queue(PriorityExecutor* executor, Class cls) : executor_(executor), cls_(cls) {}
+        void AddTask(const Task& task) { executor_->AddTask(cls_, task); }
+        // run the task after delay ms
+        void DelayTask(uint64_t delay, const Task& task) { executor_->DelayTask(cls_, delay, task); }
+
+     private:
+        PriorityExecutor* executor_;
+        Class cls_;
+    };
+
+    // limits are the max running tasks of the classes, thread_num 0 is the sum of them so that no class waits
+    // for the others
+    PriorityExecutor(uint32_t thread_num, const std::vector<uint32_t>& limits);
+    ~PriorityExecutor();
+
+    PriorityExecutor(const PriorityExecutor&) = delete;
+    PriorityExecutor& operator=(const PriorityExecutor&) = delete;
+
+    void AddTask(Class cls, const Task& task);
+    void DelayTask(Class cls, uint64_t delay, const Task& task);
+
+    // run the pending tasks and drop the delayed ones, then join the threads
+    void Stop();
+
+    uint32_t GetThreadNum() const { return threads_.size(); }
+    uint64_t GetPendingCnt(Class cls) const;
+    uint64_t GetRunningCnt(Class cls) const;
+    uint64_t GetDelayedCnt() const;
+
+    static const char* GetClassName(Class cls);
+
+ private:
+    typedef std::chrono::steady_clock Clock;
+
+    struct DelayedTask {
+        Clock::time_point due;
+        uint64_t seq;
+        Class cls;
+        Task task;
+        bool operator<(const DelayedTask& other) const {
+            return due != other.due ? due > other.due : seq > other.seq;
+        }
+    };
+
+    void Run();
+    // the class of the next task to run, kClassCnt if none
+    Class PickClass() const;
+
+    std::vector<uint32_t> limits_;
+    mutable std::mutex mu_;
+    std::condition_variable cv_;
+    std::vector<std::deque<Task>> pending_;
+    std::vector<uint32_t> running_;
+    std::priority_queue<DelayedTask> delayed_;
+    uint64_t delayed_seq_;
+    bool stop_;
+    std::vector<std::thread> threads_;
+};
+
+}  // namespace base
+}  // namespace openmldb
+#endif  // SRC_BASE_PRIORITY_EXECUTOR_H_
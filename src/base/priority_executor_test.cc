@@ -0,0 +1,134 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "base/priority_executor.h"
+
+#include <atomic>
+#include <vector>
+
+#include "base/count_down_latch.h"
+#include "gtest/gtest.h"
+
+namespace openmldb {
+namespace base {
+
+class PriorityExecutorTest : public ::testing::Test {
+ public:
+    PriorityExecutorTest() {}
+    ~PriorityExecutorTest() {}
+};
+
+TEST_F(PriorityExecutorTest, Priority) {
+    PriorityExecutor executor(1, {1, 1, 1, 1, 1});
+    ASSERT_EQ(1u, executor.GetThreadNum());
+    // hold the only thread until all the tasks are pending
+    CountDownLatch hold(1);
+    CountDownLatch started(1);
+    executor.AddTask(PriorityExecutor::kTask, [&]() {
+        started.CountDown();
+        hold.Wait();
+    });
+    started.Wait();
+    std::mutex mu;
+    std::vector<int> order;
+    auto record = [&](int cls) {
+        std::lock_guard<std::mutex> lock(mu);
+        order.push_back(cls);
+    };
+    executor.AddTask(PriorityExecutor::kSnapshot, [&]() { record(PriorityExecutor::kSnapshot); });
+    executor.AddTask(PriorityExecutor::kGc, [&]() { record(PriorityExecutor::kGc); });
+    executor.AddTask(PriorityExecutor::kKeepAlive, [&]() { record(PriorityExecutor::kKeepAlive); });
+    executor.AddTask(PriorityExecutor::kReplication, [&]() { record(PriorityExecutor::kReplication); });
+    ASSERT_EQ(1u, executor.GetPendingCnt(PriorityExecutor::kGc));
+    ASSERT_EQ(1u, executor.GetRunningCnt(PriorityExecutor::kTask));
+    hold.CountDown();
+    executor.Stop();
+    std::vector<int> expect = {PriorityExecutor::kKeepAlive, PriorityExecutor::kReplication, PriorityExecutor::kGc,
+                               PriorityExecutor::kSnapshot};
+    ASSERT_EQ(expect, order);
+}
+
+TEST_F(PriorityExecutorTest, Limit) {
+    // the gc class runs at most 2 tasks at once even if the threads are free
+    PriorityExecutor executor(0, {1, 1, 1, 2, 1});
+    ASSERT_EQ(6u, executor.GetThreadNum());
+    std::atomic<uint32_t> running(0);
+    std::atomic<uint32_t> max_running(0);
+    CountDownLatch done(20);
+    for (int i = 0; i < 20; i++) {
+        executor.AddTask(PriorityExecutor::kGc, [&]() {
+            uint32_t cur = ++running;
+            uint32_t max = max_running.load();
+            while (cur > max && !max_running.compare_exchange_weak(max, cur)) {
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            running--;
+            done.CountDown();
+        });
+    }
+    done.Wait();
+    ASSERT_LE(max_running.load(), 2u);
+    ASSERT_GE(max_running.load(), 1u);
+
+    // the pending tasks are run by the stop
+    std::atomic<uint32_t> run_cnt(0);
+    for (int i = 0; i < 20; i++) {
+        executor.AddTask(PriorityExecutor::kGc, [&]() {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            run_cnt++;
+        });
+    }
+    executor.Stop();
+    ASSERT_EQ(20u, run_cnt.load());
+}
+
+TEST_F(PriorityExecutorTest, DelayTask) {
+    PriorityExecutor executor(2, {1, 1, 1, 1, 1});
+    CountDownLatch done(2);
+    std::vector<int> order;
+    std::mutex mu;
+    auto start = std::chrono::steady_clock::now();
+    executor.DelayTask(PriorityExecutor::kGc, 60, [&]() {
+        std::lock_guard<std::mutex> lock(mu);
+        order.push_back(2);
+        done.CountDown();
+    });
+    executor.DelayTask(PriorityExecutor::kGc, 20, [&]() {
+        std::lock_guard<std::mutex> lock(mu);
+        order.push_back(1);
+        done.CountDown();
+    });
+    ASSERT_EQ(2u, executor.GetDelayedCnt());
+    done.Wait();
+    ASSERT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(60));
+    ASSERT_EQ((std::vector<int>{1, 2}), order);
+
+    // the delayed tasks are dropped by the stop
+    std::atomic<bool> run(false);
+    executor.DelayTask(PriorityExecutor::kGc, 3600 * 1000, [&]() { run = true; });
+    executor.Stop();
+    ASSERT_FALSE(run.load());
+    executor.AddTask(PriorityExecutor::kGc, [&]() { run = true; });
+    ASSERT_FALSE(run.load());
+}
+
+}  // namespace base
+}  // namespace openmldb
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
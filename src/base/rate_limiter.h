@@ -0,0 +1,109 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_BASE_RATE_LIMITER_H_
+#define SRC_BASE_RATE_LIMITER_H_
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <map>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <string>
+#include <thread>  // NOLINT
+
+#include "common/timer.h"
+
+namespace openmldb {
+namespace base {
+
+// RateLimiter shares a budget of bytes per second among the threads. every caller reserves the
+// time slot of its bytes and waits for the returned time before sending them
+class RateLimiter {
+ public:
+    explicit RateLimiter(uint64_t bytes_per_second) : bytes_per_second_(bytes_per_second), next_time_(0), mu_() {}
+
+    void SetLimit(uint64_t bytes_per_second) { bytes_per_second_.store(bytes_per_second, std::memory_order_relaxed); }
+
+    uint64_t GetLimit() const { return bytes_per_second_.load(std::memory_order_relaxed); }
+
+    // the microseconds to wait before the bytes are sent, 0 if there is no limit
+    uint64_t Acquire(uint64_t bytes) { return Acquire(bytes, ::baidu::common::timer::get_micros()); }
+
+    uint64_t Acquire(uint64_t bytes, uint64_t now_us) {
+        uint64_t limit = GetLimit();
+        if (limit == 0) {
+            return 0;
+        }
+        std::lock_guard<std::mutex> lock(mu_);
+        // the time not used is not saved up, so a burst is at most one slot
+        next_time_ = std::max(next_time_, now_us);
+        uint64_t wait_time = next_time_ - now_us;
+        next_time_ += bytes * 1000000 / limit;
+        return wait_time;
+    }
+
+    // wait for the time slot of the bytes
+    void Throttle(uint64_t bytes) {
+        uint64_t wait_time = Acquire(bytes);
+        if (wait_time > 0) {
+            std::this_thread::sleep_for(std::chrono::microseconds(wait_time));
+        }
+    }
+
+ private:
+    std::atomic<uint64_t> bytes_per_second_;
+    uint64_t next_time_;
+    std::mutex mu_;
+};
+
+// the rate limiter of the background io on the disk of the path. The paths on one device share a limiter, so the
+// snapshots, the deletes and the sends of all the data dirs on a disk take their bytes from one budget. The binlog
+// appends do not take it, so they go before the background work
+inline RateLimiter* GetDiskRateLimiter(const std::string& path, uint64_t bytes_per_second) {
+    static std::mutex mu;
+    static std::map<dev_t, std::unique_ptr<RateLimiter>> limiters;
+    // the path may not be created yet, take the device of the nearest existing parent
+    dev_t dev = 0;
+    std::string cur = path;
+    struct stat st;
+    while (true) {
+        if (stat(cur.c_str(), &st) == 0) {
+            dev = st.st_dev;
+            break;
+        }
+        size_t pos = cur.rfind('/');
+        if (pos == std::string::npos || cur == "/") {
+            break;
+        }
+        cur = pos == 0 ? "/" : cur.substr(0, pos);
+    }
+    std::lock_guard<std::mutex> lock(mu);
+    auto& limiter = limiters[dev];
+    if (!limiter) {
+        limiter.reset(new RateLimiter(bytes_per_second));
+    } else {
+        limiter->SetLimit(bytes_per_second);
+    }
+    return limiter.get();
+}
+
+}  // namespace base
+}  // namespace openmldb
+#endif  // SRC_BASE_RATE_LIMITER_H_
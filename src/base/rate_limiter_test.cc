@@ -0,0 +1,64 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "base/rate_limiter.h"
+
+#include "gtest/gtest.h"
+
+namespace openmldb {
+namespace base {
+
+class RateLimiterTest : public ::testing::Test {
+ public:
+    RateLimiterTest() {}
+    ~RateLimiterTest() {}
+};
+
+TEST_F(RateLimiterTest, NoLimit) {
+    RateLimiter limiter(0);
+    ASSERT_EQ(0u, limiter.Acquire(1024 * 1024, 100));
+    ASSERT_EQ(0u, limiter.Acquire(1024 * 1024, 100));
+}
+
+TEST_F(RateLimiterTest, Acquire) {
+    // 1MB per second
+    RateLimiter limiter(1024 * 1024);
+    ASSERT_EQ(0u, limiter.Acquire(1024 * 1024, 1000));
+    // the second MB waits for the first one
+    ASSERT_EQ(1000000u, limiter.Acquire(512 * 1024, 1000));
+    ASSERT_EQ(1000000u, limiter.Acquire(512 * 1024, 501000));
+    // the time not used is not saved up
+    ASSERT_EQ(0u, limiter.Acquire(1024, 10000000));
+    limiter.SetLimit(0);
+    ASSERT_EQ(0u, limiter.Acquire(1024 * 1024, 10000000));
+}
+
+TEST_F(RateLimiterTest, DiskRateLimiter) {
+    // the paths on one device share the limiter, the paths not created yet take the one of their parent
+    RateLimiter* limiter = GetDiskRateLimiter("/tmp", 1024);
+    ASSERT_EQ(limiter, GetDiskRateLimiter("/tmp/not_exist_dir/file", 2048));
+    ASSERT_EQ(2048u, limiter->GetLimit());
+    GetDiskRateLimiter("/tmp", 0);
+    ASSERT_EQ(0u, limiter->GetLimit());
+}
+
+}  // namespace base
+}  // namespace openmldb
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -54,6 +54,9 @@ class RingQueue {
         head_ = (head_ + 1) % max_size_;
         full_ = head_ == tail_;
     }
+    // the idx-th item from the oldest one
+    const T& at(uint32_t idx) const { return buf_[(tail_ + idx) % max_size_]; }
+
     const T& pop() {
         const auto& val = buf_[tail_];
 
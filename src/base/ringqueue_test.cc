@@ -38,6 +38,19 @@ TEST_F(RingQueueTest, full) {
     ASSERT_FALSE(rq.full());
 }
 
+TEST_F(RingQueueTest, at) {
+    uint32_t size = 3;
+    RingQueue<uint32_t> rq(size);
+    for (uint32_t i = 0; i < size; i++) {
+        rq.put(i);
+    }
+    rq.pop();
+    rq.put(size);
+    for (uint32_t i = 0; i < size; i++) {
+        ASSERT_EQ(i + 1, rq.at(i));
+    }
+}
+
 TEST_F(RingQueueTest, empty) {
     uint32_t size = 10;
     RingQueue<uint32_t> rq(size);
@@ -20,14 +20,27 @@
 #include <assert.h>
 #include <stdint.h>
 
+#include <algorithm>
 #include <atomic>
+#include <functional>
 #include <iostream>
+#include <new>
+#include <thread>  // NOLINT
+#include <utility>
+#include <vector>
 
 #include "base/random.h"
 
 namespace openmldb {
 namespace base {
 
+// hint the cache line of addr to be read soon, it does nothing for NULL
+static inline void Prefetch(const void* addr) {
+#if defined(__GNUC__)
+    __builtin_prefetch(addr, 0, 3);
+#endif
+}
+
 struct DefaultComparator {
     int operator()(const uint64_t a, const uint64_t b) const {
         if (a > b) {
@@ -40,19 +53,28 @@ struct DefaultComparator {
 };
 
 // Skiplist node , a thread safe structure
+// The tower of next pointers is allocated inline after the node, so a node must
+// be created by New and released by delete
 template <class K, class V>
 class Node {
  public:
-    // Set data reference and Node height
-    Node(const K& key, V& value, uint8_t height)  // NOLINT
-        : height_(height), key_(key), value_(value) {
-        nexts_ = new std::atomic<Node<K, V>*>[height];
+    static Node<K, V>* New(const K& key, V& value, uint8_t height) {  // NOLINT
+        void* mem = ::operator new(AllocSize(height));
+        return new (mem) Node<K, V>(key, value, height);
     }
 
-    Node(uint8_t height) : height_(height), key_(), value_() {  // NOLINT
-        nexts_ = new std::atomic<Node<K, V>*>[height];
+    static Node<K, V>* New(uint8_t height) {
+        void* mem = ::operator new(AllocSize(height));
+        return new (mem) Node<K, V>(height);
+    }
+
+    // the size of node and its tower
+    static size_t AllocSize(uint8_t height) {
+        return sizeof(Node<K, V>) + sizeof(std::atomic<Node<K, V>*>) * (height - 1);
     }
 
+    static void operator delete(void* ptr) { ::operator delete(ptr); }
+
     // Set the next node with memory barrier
     void SetNext(uint8_t level, Node<K, V>* node) {
         assert(level < height_ && level >= 0);
@@ -65,6 +87,13 @@ class Node {
         nexts_[level].store(node, std::memory_order_relaxed);
     }
 
+    // Set the next node only if the current next is expected
+    bool CasNext(uint8_t level, Node<K, V>* expected, Node<K, V>* node) {
+        assert(level < height_ && level >= 0);
+        return nexts_[level].compare_exchange_strong(expected, node, std::memory_order_release,
+                                                     std::memory_order_relaxed);
+    }
+
     uint8_t Height() { return height_; }
 
     Node<K, V>* GetNext(uint8_t level) {
@@ -81,19 +110,42 @@ class Node {
 
     const K& GetKey() const { return key_; }
 
-    ~Node() { delete[] nexts_; }
+    ~Node() {}
+
+ private:
+    // Set data reference and Node height
+    Node(const K& key, V& value, uint8_t height)  // NOLINT
+        : height_(height), key_(key), value_(value) {
+        InitTower();
+    }
+
+    Node(uint8_t height) : height_(height), key_(), value_() {  // NOLINT
+        InitTower();
+    }
+
+    void InitTower() {
+        for (uint8_t i = 1; i < height_; i++) {
+            new (&nexts_[i]) std::atomic<Node<K, V>*>(NULL);
+        }
+        nexts_[0].store(NULL, std::memory_order_relaxed);
+    }
 
  private:
     uint8_t const height_;
     K const key_;
     V value_;
-    std::atomic<Node<K, V>*>* nexts_;
+    // must be the last member, the other levels follow it in the same allocation
+    std::atomic<Node<K, V>*> nexts_[1];
 };
 
 template <class K, class V, class Comparator>
 class Skiplist {
  public:
     Skiplist(uint8_t max_height, uint8_t branch, const Comparator& compare)
+        : Skiplist(max_height, max_height, branch, compare) {}
+
+    // the head has init_height levels and so do the nodes until the head grows by Grow
+    Skiplist(uint8_t max_height, uint8_t init_height, uint8_t branch, const Comparator& compare)
         : MaxHeight(max_height),
           Branch(branch),
           max_height_(0),
@@ -101,22 +153,25 @@ class Skiplist {
           rand_(0xdeadbeef),
           head_(NULL),
           tail_(NULL) {
-        head_ = new Node<K, V>(MaxHeight);
-        for (uint8_t i = 0; i < head_->Height(); i++) {
-            head_->SetNext(i, NULL);
+        uint8_t height = init_height == 0 || init_height > MaxHeight ? MaxHeight : init_height;
+        Node<K, V>* head = Node<K, V>::New(height);
+        for (uint8_t i = 0; i < head->Height(); i++) {
+            head->SetNext(i, NULL);
         }
+        head_.store(head, std::memory_order_relaxed);
         max_height_.store(1, std::memory_order_relaxed);
     }
-    ~Skiplist() { delete head_; }
+    ~Skiplist() { delete head_.load(std::memory_order_relaxed); }
 
     // Insert need external synchronized
     uint8_t Insert(const K& key, V& value) {  // NOLINT
+        Node<K, V>* head = GetHead();
         uint8_t height = RandomHeight();
         Node<K, V>* pre[MaxHeight];
         FindLessOrEqual(key, pre);
         if (height > GetMaxHeight()) {
             for (uint8_t i = GetMaxHeight(); i < height; i++) {
-                pre[i] = head_;
+                pre[i] = head;
             }
             max_height_.store(height, std::memory_order_relaxed);
         }
@@ -131,8 +186,62 @@ class Skiplist {
         return height;
     }
 
+    // Lock free insert, it can run with other InsertConcurrently and readers at the same time.
+    // Remove, Split and Clear still need external synchronized with it
+    uint8_t InsertConcurrently(const K& key, V& value) {  // NOLINT
+        Node<K, V>* exist = NULL;
+        return InsertConcurrently(key, value, false, &exist);
+    }
+
+    // Insert the key only if it is not in the list. If the key exists, value
+    // will be assigned with the existing value and return false
+    bool InsertIfAbsentConcurrently(const K& key, V& value, uint8_t* height) {  // NOLINT
+        Node<K, V>* exist = NULL;
+        uint8_t cur_height = InsertConcurrently(key, value, true, &exist);
+        if (exist != NULL) {
+            value = exist->GetValue();
+            return false;
+        }
+        if (height != NULL) {
+            *height = cur_height;
+        }
+        return true;
+    }
+
+    // Build an empty list from the pairs sorted in the order of the comparator, the nodes are linked one by
+    // one at the end of every level without searching. It needs external synchronized, e.g. the list is not
+    // visible to the others yet. The heights of the nodes are appended to heights if it is not null
+    bool BuildSorted(const std::vector<std::pair<K, V>>& sorted, std::vector<uint8_t>* heights) {
+        if (!IsEmpty()) {
+            return false;
+        }
+        Node<K, V>* head = GetHead();
+        Node<K, V>* last[MaxHeight];
+        for (uint8_t i = 0; i < MaxHeight; i++) {
+            last[i] = head;
+        }
+        uint8_t max_height = GetMaxHeight();
+        Node<K, V>* node = NULL;
+        for (const auto& kv : sorted) {
+            uint8_t height = RandomHeight();
+            V value = kv.second;
+            node = NewNode(kv.first, value, height);
+            for (uint8_t i = 0; i < height; i++) {
+                last[i]->SetNextNoBarrier(i, node);
+                last[i] = node;
+            }
+            max_height = std::max(max_height, height);
+            if (heights != NULL) {
+                heights->push_back(height);
+            }
+        }
+        max_height_.store(max_height, std::memory_order_relaxed);
+        tail_.store(node, std::memory_order_release);
+        return true;
+    }
+
     bool IsEmpty() {
-        if (head_->GetNextNoBarrier(0) == NULL) {
+        if (GetHead()->GetNextNoBarrier(0) == NULL) {
             return true;
         }
         return false;
@@ -140,9 +249,10 @@ class Skiplist {
 
     // Remove need external synchronized
     Node<K, V>* Remove(const K& key) {
+        Node<K, V>* head = GetHead();
         Node<K, V>* pre[MaxHeight];
         for (uint8_t i = 0; i < MaxHeight; i++) {
-            pre[i] = head_;
+            pre[i] = head;
         }
         Node<K, V>* target = FindLessOrEqual(key, pre);
         if (target == NULL) {
@@ -157,7 +267,7 @@ class Skiplist {
             result->SetNextNoBarrier(i, NULL);
         }
         if (result == tail_) {
-            pre[0] == head_ ? tail_.store(NULL, std::memory_order_relaxed)
+            pre[0] == head ? tail_.store(NULL, std::memory_order_relaxed)
                             : tail_.store(pre[0], std::memory_order_relaxed);
         }
         return result;
@@ -185,7 +295,7 @@ class Skiplist {
     }
 
     Node<K, V>* SplitByPos(uint64_t pos) {
-        Node<K, V>* pos_node = head_->GetNext(0);
+        Node<K, V>* pos_node = GetHead()->GetNext(0);
         for (uint64_t idx = 0; idx < pos; idx++) {
             if (pos_node == NULL) {
                 return NULL;
@@ -199,7 +309,7 @@ class Skiplist {
     }
 
     Node<K, V>* SplitByKeyOrPos(const K& key, uint64_t pos) {
-        Node<K, V>* pos_node = head_->GetNext(0);
+        Node<K, V>* pos_node = GetHead()->GetNext(0);
         for (uint64_t idx = 0; idx < pos; idx++) {
             if (pos_node == NULL) {  // doesnt find key or pos, just return
                 return NULL;
@@ -216,7 +326,7 @@ class Skiplist {
     }
 
     Node<K, V>* SplitByKeyAndPos(const K& key, uint64_t pos) {
-        Node<K, V>* pos_node = head_->GetNext(0);
+        Node<K, V>* pos_node = GetHead()->GetNext(0);
         bool find_key = false;
         for (uint64_t idx = 0; idx < pos; idx++) {
             if (pos_node == NULL) {  // doesnt find pos, just return
@@ -237,6 +347,38 @@ class Skiplist {
         }
     }
 
+    // Cut the nodes from start to end out of the list, the return part is just a linkedlist. A reader on the
+    // nodes cut stops at the last of them. It needs external synchronization like Remove
+    Node<K, V>* SplitRange(const K& start, const K& end) {
+        if (compare_(start, end) > 0) {
+            return NULL;
+        }
+        Node<K, V>* pre[MaxHeight];
+        Node<K, V>* last[MaxHeight];
+        for (uint8_t i = 0; i < MaxHeight; i++) {
+            pre[i] = NULL;
+            last[i] = NULL;
+        }
+        Node<K, V>* target = FindLessOrEqual(start, pre);
+        Node<K, V>* result = target->GetNextNoBarrier(0);
+        if (result == NULL || compare_(result->GetKey(), end) > 0) {
+            return NULL;
+        }
+        FindLastNotAfter(end, last);
+        for (uint8_t i = 0; i < MaxHeight; i++) {
+            if (pre[i] == NULL || last[i] == NULL || pre[i] == last[i]) {
+                continue;
+            }
+            pre[i]->SetNext(i, last[i]->GetNextNoBarrier(i));
+        }
+        if (last[0] == tail_.load(std::memory_order_relaxed)) {
+            target == GetHead() ? tail_.store(NULL, std::memory_order_release)
+                                : tail_.store(target, std::memory_order_release);
+        }
+        last[0]->SetNextNoBarrier(0, NULL);
+        return result;
+    }
+
     const V& Get(const K& key) {
         Node<K, V>* node = FindEqual(key);
         return node->GetValue();
@@ -251,11 +393,23 @@ class Skiplist {
         return -1;
     }
 
+    // return the node of key, NULL if it is not found
+    Node<K, V>* GetNode(const K& key) {
+        Node<K, V>* node = FindEqual(key);
+        if (node != NULL && compare_(node->GetKey(), key) == 0) {
+            return node;
+        }
+        return NULL;
+    }
+
+    // the first node, NULL if the list is empty
+    Node<K, V>* GetFirst() { return GetHead()->GetNext(0); }
+
     Node<K, V>* GetLast() { return tail_.load(std::memory_order_acquire); }
 
     uint32_t GetSize() {
         uint32_t cnt = 0;
-        Node<K, V>* node = head_->GetNext(0);
+        Node<K, V>* node = GetHead()->GetNext(0);
         while (node != NULL) {
             cnt++;
             Node<K, V>* tmp = node->GetNext(0);
@@ -271,10 +425,11 @@ class Skiplist {
     // Need external synchronized
     uint64_t Clear() {
         uint64_t cnt = 0;
-        Node<K, V>* node = head_->GetNext(0);
+        Node<K, V>* head = GetHead();
+        Node<K, V>* node = head->GetNext(0);
         // Unlink all next node
-        for (uint8_t i = 0; i < head_->Height(); i++) {
-            head_->SetNextNoBarrier(i, NULL);
+        for (uint8_t i = 0; i < head->Height(); i++) {
+            head->SetNextNoBarrier(i, NULL);
         }
         tail_.store(NULL, std::memory_order_relaxed);
 
@@ -293,8 +448,9 @@ class Skiplist {
 
     // Need external synchronized
     bool AddToFirst(const K& key, V& value) {  // NOLINT
+        Node<K, V>* head = GetHead();
         {
-            Node<K, V>* node = head_->GetNext(0);
+            Node<K, V>* node = head->GetNext(0);
             if (node != NULL && compare_(key, node->GetKey()) > 0) {
                 return false;
             }
@@ -302,7 +458,7 @@ class Skiplist {
         uint8_t height = RandomHeight();
         Node<K, V>* pre[MaxHeight];
         for (uint8_t i = 0; i < height; i++) {
-            pre[i] = head_;
+            pre[i] = head;
         }
         if (height > GetMaxHeight()) {
             max_height_.store(height, std::memory_order_relaxed);
@@ -318,6 +474,25 @@ class Skiplist {
         return true;
     }
 
+    // Replace the head with one of MaxHeight levels, so the nodes inserted later can be as high as the list
+    // allows. The nodes already in the list keep their heights. It needs external synchronized with the writers,
+    // Remove, Split and Clear. The old head is returned as the readers may still use it, and it should be
+    // deleted after them. NULL if the head is of MaxHeight already
+    Node<K, V>* Grow() {
+        Node<K, V>* old = GetHead();
+        if (old->Height() >= MaxHeight) {
+            return NULL;
+        }
+        Node<K, V>* head = Node<K, V>::New(MaxHeight);
+        for (uint8_t i = 0; i < old->Height(); i++) {
+            head->SetNextNoBarrier(i, old->GetNextNoBarrier(i));
+        }
+        head_.store(head, std::memory_order_release);
+        return old;
+    }
+
+    uint8_t GetHeadHeight() const { return GetHead()->Height(); }
+
     class Iterator {
      public:
         Iterator(Skiplist<K, V, Comparator>* list) : node_(NULL), list_(list) {}  // NOLINT
@@ -328,6 +503,18 @@ class Skiplist {
         void Next() {
             assert(Valid());
             node_ = node_->GetNext(0);
+            // the iterations mostly go on, so fetch the next node while the current one is read
+            if (node_ != NULL) {
+                Prefetch(node_->GetNextNoBarrier(0));
+            }
+        }
+
+        // the value of the node after the current one, NULL if it is the last. The caller may prefetch the
+        // memory the value points to before it steps there
+        V* PeekNextValue() {
+            assert(Valid());
+            Node<K, V>* next = node_->GetNext(0);
+            return next == NULL ? NULL : &next->GetValue();
         }
 
         const K& GetKey() const {
@@ -346,7 +533,7 @@ class Skiplist {
         }
 
         void SeekToFirst() {
-            node_ = list_->head_;
+            node_ = list_->GetHead();
             Next();
         }
 
@@ -364,22 +551,111 @@ class Skiplist {
 
  private:
     Node<K, V>* NewNode(const K& key, V& value, uint8_t height) {  // NOLINT
-        Node<K, V>* node = new Node<K, V>(key, value, height);
-        return node;
+        return Node<K, V>::New(key, value, height);
     }
 
     uint8_t RandomHeight() {
+        uint8_t max_height = GetHead()->Height();
+        uint8_t height = 1;
+        while (height < max_height && (rand_.Next() % Branch) == 0) {
+            height++;
+        }
+        return height;
+    }
+
+    // rand_ is not thread safe, every writer thread uses its own generator
+    uint8_t RandomHeightConcurrently() {
+        static thread_local Random rand(std::hash<std::thread::id>()(std::this_thread::get_id()));
+        uint8_t max_height = GetHead()->Height();
         uint8_t height = 1;
-        while (height < MaxHeight && (rand_.Next() % Branch) == 0) {
+        while (height < max_height && (rand.Next() % Branch) == 0) {
             height++;
         }
         return height;
     }
 
+    // return 0 and set exist if unique is true and the key is found
+    uint8_t InsertConcurrently(const K& key, V& value, bool unique, Node<K, V>** exist) {  // NOLINT
+        uint8_t height = RandomHeightConcurrently();
+        uint8_t max_height = GetMaxHeight();
+        while (height > max_height) {
+            if (max_height_.compare_exchange_weak(max_height, height, std::memory_order_relaxed)) {
+                max_height = height;
+                break;
+            }
+        }
+        Node<K, V>* pre[MaxHeight];
+        Node<K, V>* succ[MaxHeight];
+        Node<K, V>* head = GetHead();
+        Node<K, V>* before = head;
+        for (int level = max_height - 1; level >= 0; level--) {
+            FindSpliceForLevel(key, before, level, &pre[level], &succ[level]);
+            before = pre[level];
+        }
+        if (unique && IsEqualNode(key, succ[0])) {
+            *exist = succ[0];
+            return 0;
+        }
+        Node<K, V>* node = NewNode(key, value, height);
+        for (uint8_t i = 0; i < height; i++) {
+            while (true) {
+                node->SetNextNoBarrier(i, succ[i]);
+                if (pre[i]->CasNext(i, succ[i], node)) {
+                    break;
+                }
+                // other writer has changed the splice, nodes are never removed concurrently
+                // so search again from the old predecessor
+                FindSpliceForLevel(key, pre[i], i, &pre[i], &succ[i]);
+                if (i == 0 && unique && IsEqualNode(key, succ[0])) {
+                    delete node;
+                    *exist = succ[0];
+                    return 0;
+                }
+            }
+        }
+        if (succ[0] == NULL) {
+            // the new node may be linked after by other writers before tail_ is updated,
+            // so walk to the real end before publishing it
+            Node<K, V>* cur_tail = tail_.load(std::memory_order_acquire);
+            while (true) {
+                Node<K, V>* last = node;
+                Node<K, V>* next = last->GetNext(0);
+                while (next != NULL) {
+                    last = next;
+                    next = last->GetNext(0);
+                }
+                if (tail_.compare_exchange_weak(cur_tail, last, std::memory_order_release,
+                                                std::memory_order_acquire)) {
+                    break;
+                }
+            }
+        }
+        return height;
+    }
+
+    void FindSpliceForLevel(const K& key, Node<K, V>* before, uint8_t level, Node<K, V>** pre,
+                            Node<K, V>** succ) {
+        Node<K, V>* node = before;
+        while (true) {
+            Node<K, V>* next = node->GetNext(level);
+            if (!IsAfterNode(key, next)) {
+                *pre = node;
+                *succ = next;
+                return;
+            }
+            node = next;
+        }
+    }
+
+    bool IsEqualNode(const K& key, Node<K, V>* node) const {
+        return (node != NULL) && (compare_(key, node->GetKey()) == 0);
+    }
+
     Node<K, V>* FindLessOrEqual(const K& key, Node<K, V>** nodes) {
         assert(nodes != NULL);
-        Node<K, V>* node = head_;
-        uint8_t level = GetMaxHeight() - 1;
+        Node<K, V>* head = GetHead();
+        Node<K, V>* node = head;
+        uint8_t level = GetLevel(head) - 1;
         while (true) {
             Node<K, V>* next = node->GetNext(level);
             if (IsAfterNode(key, next)) {
@@ -394,9 +670,29 @@ class Skiplist {
         }
     }
 
+    // the last nodes of every level not after the key
+    Node<K, V>* FindLastNotAfter(const K& key, Node<K, V>** nodes) {
+        Node<K, V>* head = GetHead();
+        Node<K, V>* node = head;
+        uint8_t level = GetLevel(head) - 1;
+        while (true) {
+            Node<K, V>* next = node->GetNext(level);
+            if (next != NULL && compare_(next->GetKey(), key) <= 0) {
+                node = next;
+            } else {
+                nodes[level] = node;
+                if (level <= 0) {
+                    return node;
+                }
+                level--;
+            }
+        }
+    }
+
     Node<K, V>* FindEqual(const K& key) {
-        Node<K, V>* node = head_;
-        uint8_t level = GetMaxHeight() - 1;
+        Node<K, V>* head = GetHead();
+        Node<K, V>* node = head;
+        uint8_t level = GetLevel(head) - 1;
         while (true) {
             Node<K, V>* next = node->GetNext(level);
             if (next == NULL || compare_(next->GetKey(), key) > 0) {
@@ -411,10 +707,11 @@ class Skiplist {
     }
 
     Node<K, V>* FindLessThan(const K& key) {
-        Node<K, V>* node = head_;
-        uint8_t level = GetMaxHeight() - 1;
+        Node<K, V>* head = GetHead();
+        Node<K, V>* node = head;
+        uint8_t level = GetLevel(head) - 1;
         while (true) {
-            assert(node == head_ || compare_(node->GetKey(), key) < 0);
+            assert(node == head || compare_(node->GetKey(), key) < 0);
             Node<K, V>* next = node->GetNext(level);
             if (next == NULL || compare_(next->GetKey(), key) >= 0) {
                 if (level <= 0) {
@@ -433,9 +730,16 @@ class Skiplist {
 
     uint8_t GetMaxHeight() const { return max_height_.load(std::memory_order_relaxed); }
 
+    Node<K, V>* GetHead() const { return head_.load(std::memory_order_acquire); }
+
+    // the levels to search from head. A reader may still hold the head replaced by Grow, which is lower than
+    // the nodes inserted after it
+    uint8_t GetLevel(Node<K, V>* head) const { return std::min(GetMaxHeight(), head->Height()); }
+
     Node<K, V>* SplitOnPosNode(uint64_t pos, Node<K, V>* pos_node) {
-        Node<K, V>* node = head_;
-        Node<K, V>* pre = head_;
+        Node<K, V>* head = GetHead();
+        Node<K, V>* node = head;
+        Node<K, V>* pre = head;
         pos++;
         uint64_t cnt = 0;
         while (node != NULL) {
@@ -465,7 +769,8 @@ class Skiplist {
     std::atomic<uint8_t> max_height_;
     Comparator const compare_;
     Random rand_;
-    Node<K, V>* head_;
+    // only replaced by Grow
+    std::atomic<Node<K, V>*> head_;
     std::atomic<Node<K, V>*> tail_;
     friend Iterator;
 };
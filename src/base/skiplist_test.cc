@@ -16,7 +16,11 @@
 
 #include "base/skiplist.h"
 
+#include <memory>
+#include <random>
+#include <set>
 #include <string>
+#include <thread>  // NOLINT
 #include <vector>
 
 #include "base/slice.h"
@@ -77,14 +81,18 @@ struct StrComparator {
 TEST_F(NodeTest, SetNext) {
     uint32_t key = 1;
     uint32_t value = 2;
-    Node<uint32_t, uint32_t> node(key, value, 2);
+    Node<uint32_t, uint32_t>* node = Node<uint32_t, uint32_t>::New(key, value, 2);
     uint32_t key2 = 3;
     uint32_t value2 = 3;
-    Node<uint32_t, uint32_t> node2(key2, value2, 2);
-    node.SetNext(1, &node2);
-    Node<uint32_t, uint32_t>* node_ptr = node.GetNext(1);
+    Node<uint32_t, uint32_t>* node2 = Node<uint32_t, uint32_t>::New(key2, value2, 2);
+    ASSERT_TRUE(node->GetNext(0) == NULL);
+    ASSERT_TRUE(node->GetNext(1) == NULL);
+    node->SetNext(1, node2);
+    Node<uint32_t, uint32_t>* node_ptr = node->GetNext(1);
     ASSERT_EQ(3, (signed)node_ptr->GetValue());
     ASSERT_EQ(3, (signed)node_ptr->GetKey());
+    delete node;
+    delete node2;
 }
 
 TEST_F(NodeTest, NodeByteSize) {
@@ -92,6 +100,9 @@ TEST_F(NodeTest, NodeByteSize) {
     ASSERT_EQ(96u, sizeof(node0));
     ASSERT_EQ(32u, sizeof(Node<uint64_t, void*>));
     ASSERT_EQ(40u, sizeof(Node<Slice, void*>));
+    // the tower is inlined after the node
+    ASSERT_EQ(32u, (Node<uint64_t, void*>::AllocSize(1)));
+    ASSERT_EQ(120u, (Node<uint64_t, void*>::AllocSize(12)));
 }
 
 TEST_F(NodeTest, SliceTest) {
@@ -178,6 +189,44 @@ TEST_F(SkiplistTest, InsertAndIterator) {
     }
 }
 
+TEST_F(SkiplistTest, BuildSorted) {
+    Comparator cmp;
+    for (auto height : vec) {
+        Skiplist<uint32_t, uint32_t, Comparator> sl(height, 4, cmp);
+        std::vector<std::pair<uint32_t, uint32_t>> sorted;
+        for (uint32_t i = 0; i < 1000; i++) {
+            sorted.emplace_back(i * 2, i);
+        }
+        std::vector<uint8_t> heights;
+        ASSERT_TRUE(sl.BuildSorted(sorted, &heights));
+        ASSERT_EQ(1000u, heights.size());
+        ASSERT_EQ(1000u, sl.GetSize());
+        ASSERT_EQ(1998u, sl.GetLast()->GetKey());
+        Skiplist<uint32_t, uint32_t, Comparator>::Iterator* it = sl.NewIterator();
+        it->SeekToFirst();
+        for (uint32_t i = 0; i < 1000; i++) {
+            ASSERT_TRUE(it->Valid());
+            ASSERT_EQ(i * 2, it->GetKey());
+            ASSERT_EQ(i, it->GetValue());
+            it->Next();
+        }
+        ASSERT_FALSE(it->Valid());
+        // the search by the levels finds the nodes as the inserted ones
+        it->Seek(501);
+        ASSERT_TRUE(it->Valid());
+        ASSERT_EQ(502u, it->GetKey());
+        delete it;
+        uint32_t value = 0;
+        ASSERT_EQ(0, sl.Get(1000, value));
+        ASSERT_EQ(500u, value);
+        // the list is built only when it is empty
+        ASSERT_FALSE(sl.BuildSorted(sorted, NULL));
+        uint32_t key = 1;
+        sl.Insert(key, value);
+        ASSERT_EQ(1001u, sl.GetSize());
+    }
+}
+
 TEST_F(SkiplistTest, GetSize) {
     Comparator cmp;
     Skiplist<uint32_t, uint32_t, Comparator> sl(12, 4, cmp);
@@ -346,6 +395,57 @@ TEST_F(SkiplistTest, SplitByPos1) {
 }
 
 // key before pos , key without pos
+TEST_F(SkiplistTest, SplitRange) {
+    Comparator cmp;
+    for (auto height : vec) {
+        std::mt19937 rand(height);
+        for (int round = 0; round < 200; round++) {
+            Skiplist<uint32_t, uint32_t, Comparator> sl(height, 4, cmp);
+            std::set<uint32_t> keys;
+            uint32_t cnt = rand() % 50;
+            for (uint32_t i = 0; i < cnt; i++) {
+                uint32_t key = rand() % 100;
+                if (keys.insert(key).second) {
+                    sl.Insert(key, key);
+                }
+            }
+            uint32_t start = rand() % 100;
+            uint32_t end = start + rand() % 30;
+            std::vector<uint32_t> expect_cut;
+            for (uint32_t key : keys) {
+                if (key >= start && key <= end) {
+                    expect_cut.push_back(key);
+                }
+            }
+            std::vector<uint32_t> cut;
+            Node<uint32_t, uint32_t>* node = sl.SplitRange(start, end);
+            while (node != NULL) {
+                cut.push_back(node->GetKey());
+                keys.erase(node->GetKey());
+                Node<uint32_t, uint32_t>* tmp = node;
+                node = node->GetNextNoBarrier(0);
+                delete tmp;
+            }
+            ASSERT_EQ(expect_cut, cut);
+            std::vector<uint32_t> left;
+            std::unique_ptr<Skiplist<uint32_t, uint32_t, Comparator>::Iterator> it(sl.NewIterator());
+            for (it->SeekToFirst(); it->Valid(); it->Next()) {
+                left.push_back(it->GetKey());
+            }
+            ASSERT_EQ(std::vector<uint32_t>(keys.begin(), keys.end()), left);
+            if (keys.empty()) {
+                ASSERT_TRUE(sl.GetLast() == NULL);
+            } else {
+                ASSERT_EQ(*keys.rbegin(), sl.GetLast()->GetKey());
+                for (uint32_t key : keys) {
+                    ASSERT_EQ(key, sl.Get(key));
+                }
+            }
+            sl.Clear();
+        }
+    }
+}
+
 TEST_F(SkiplistTest, SplitByKeyOrPos1) {
     Comparator cmp;
     for (auto height : vec) {
@@ -663,6 +763,109 @@ TEST_F(SkiplistTest, Duplicate) {
     ASSERT_FALSE(it->Valid());
 }
 
+TEST_F(SkiplistTest, InsertConcurrently) {
+    DescComparator cmp;
+    Skiplist<uint32_t, uint32_t, DescComparator> sl(12, 4, cmp);
+    std::vector<std::thread> threads;
+    for (uint32_t i = 0; i < 4; i++) {
+        threads.emplace_back([&sl, i] {
+            for (uint32_t j = 0; j < 1000; j++) {
+                uint32_t value = i;
+                sl.InsertConcurrently(j, value);
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    ASSERT_EQ(4000u, sl.GetSize());
+    Skiplist<uint32_t, uint32_t, DescComparator>::Iterator* it = sl.NewIterator();
+    it->SeekToFirst();
+    uint32_t pre_key = UINT32_MAX;
+    while (it->Valid()) {
+        ASSERT_LE(it->GetKey(), pre_key);
+        pre_key = it->GetKey();
+        it->Next();
+    }
+    ASSERT_EQ(0u, sl.GetLast()->GetKey());
+    delete it;
+}
+
+TEST_F(SkiplistTest, InsertIfAbsentConcurrently) {
+    Comparator cmp;
+    Skiplist<uint32_t, uint32_t, Comparator> sl(12, 4, cmp);
+    std::atomic<uint32_t> inserted(0);
+    std::vector<std::thread> threads;
+    for (uint32_t i = 0; i < 4; i++) {
+        threads.emplace_back([&sl, &inserted, i] {
+            for (uint32_t j = 0; j < 1000; j++) {
+                uint32_t value = i;
+                uint8_t height = 0;
+                if (sl.InsertIfAbsentConcurrently(j, value, &height)) {
+                    inserted.fetch_add(1);
+                    ASSERT_GT(height, 0);
+                }
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    ASSERT_EQ(1000u, inserted.load());
+    ASSERT_EQ(1000u, sl.GetSize());
+    uint32_t key = 100;
+    uint32_t value = 10;
+    ASSERT_FALSE(sl.InsertIfAbsentConcurrently(key, value, NULL));
+    ASSERT_LT(value, 4u);
+}
+
+TEST_F(SkiplistTest, Grow) {
+    Comparator cmp;
+    Skiplist<uint32_t, uint32_t, Comparator> sl(12, 1, 4, cmp);
+    ASSERT_EQ(1, sl.GetHeadHeight());
+    for (uint32_t i = 0; i < 100; i += 2) {
+        uint32_t value = i + 1;
+        // a list of one level before it grows
+        ASSERT_EQ(1, sl.Insert(i, value));
+    }
+    Skiplist<uint32_t, uint32_t, Comparator>::Iterator* old_it = sl.NewIterator();
+    old_it->Seek(50);
+    Node<uint32_t, uint32_t>* old_head = sl.Grow();
+    ASSERT_TRUE(old_head != NULL);
+    ASSERT_EQ(1, old_head->Height());
+    ASSERT_EQ(12, sl.GetHeadHeight());
+    ASSERT_TRUE(sl.Grow() == NULL);
+    uint8_t max_height = 1;
+    for (uint32_t i = 1; i < 1000; i += 2) {
+        uint32_t value = i + 1;
+        max_height = std::max(max_height, sl.Insert(i, value));
+    }
+    ASSERT_GT(max_height, 1);
+    ASSERT_EQ(550u, sl.GetSize());
+    // the iterator positioned before Grow goes on
+    ASSERT_TRUE(old_it->Valid());
+    ASSERT_EQ(50u, old_it->GetKey());
+    old_it->Next();
+    ASSERT_EQ(51u, old_it->GetKey());
+    delete old_it;
+    Skiplist<uint32_t, uint32_t, Comparator>::Iterator* it = sl.NewIterator();
+    it->SeekToFirst();
+    for (uint32_t i = 0; i < 100; i++) {
+        ASSERT_TRUE(it->Valid());
+        ASSERT_EQ(i, it->GetKey());
+        ASSERT_EQ(i + 1, it->GetValue());
+        it->Next();
+    }
+    it->Seek(777);
+    ASSERT_EQ(777u, it->GetKey());
+    delete it;
+    uint32_t value = 0;
+    ASSERT_EQ(0, sl.Get(98, value));
+    ASSERT_EQ(99u, value);
+    ASSERT_EQ(-1, sl.Get(200, value));
+    delete old_head;
+}
+
 }  // namespace base
 }  // namespace openmldb
 
@@ -187,6 +187,9 @@ enum ReturnCode {
     kSdkEndpointDuplicate = 156,
     kProcedureAlreadyExists = 157,
     kProcedureNotFound = 158,
+    kQueryOverloaded = 159,
+    kQueryDeadlineExceeded = 160,
+    kExceedMemoryLimit = 161,
     kNameserverIsNotLeader = 300,
     kAutoFailoverIsEnabled = 301,
     kEndpointIsNotExist = 302,
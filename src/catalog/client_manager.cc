@@ -16,6 +16,8 @@
 
 #include "catalog/client_manager.h"
 
+#include <algorithm>
+#include <map>
 #include <utility>
 
 #include "codec/fe_schema_codec.h"
@@ -27,20 +29,66 @@ namespace openmldb {
 namespace catalog {
 
 TabletRowHandler::TabletRowHandler(const std::string& db, openmldb::RpcCallback<openmldb::api::QueryResponse>* callback)
-    : db_(db), name_(), status_(::hybridse::base::Status::Running()), row_(), callback_(callback) {
+    : db_(db),
+      name_(),
+      status_(::hybridse::base::Status::Running()),
+      row_(),
+      callback_(callback),
+      batch_(),
+      batch_callback_(nullptr),
+      batch_idx_(0) {
     callback_->Ref();
 }
 
+TabletRowHandler::TabletRowHandler(const std::string& db, const std::shared_ptr<SubQueryBatch>& batch)
+    : db_(db),
+      name_(),
+      status_(::hybridse::base::Status::Running()),
+      row_(),
+      callback_(nullptr),
+      batch_(batch),
+      batch_callback_(nullptr),
+      batch_idx_(0) {}
+
 TabletRowHandler::TabletRowHandler(::hybridse::base::Status status)
-    : db_(), name_(), status_(status), row_(), callback_(nullptr) {}
+    : db_(),
+      name_(),
+      status_(status),
+      row_(),
+      callback_(nullptr),
+      batch_(),
+      batch_callback_(nullptr),
+      batch_idx_(0) {}
 
 TabletRowHandler::~TabletRowHandler() {
     if (callback_ != nullptr) {
         callback_->UnRef();
     }
+    if (batch_callback_ != nullptr) {
+        batch_callback_->UnRef();
+    }
+}
+
+void TabletRowHandler::SetCallback(openmldb::RpcCallback<openmldb::api::QueryResponse>* callback) {
+    callback->Ref();
+    callback_ = callback;
+}
+
+void TabletRowHandler::SetCallback(openmldb::RpcCallback<openmldb::api::SubQueryBatchResponse>* callback, int idx) {
+    callback->Ref();
+    batch_callback_ = callback;
+    batch_idx_ = idx;
 }
 
 const ::hybridse::codec::Row& TabletRowHandler::GetValue() {
+    if (batch_) {
+        std::shared_ptr<SubQueryBatch> batch;
+        batch.swap(batch_);
+        batch->Flush();
+    }
+    if (status_.isRunning() && batch_callback_) {
+        return GetBatchValue();
+    }
     if (!status_.isRunning() || !callback_) {
         return row_;
     }
@@ -72,6 +120,144 @@ const ::hybridse::codec::Row& TabletRowHandler::GetValue() {
     return row_;
 }
 
+const ::hybridse::codec::Row& TabletRowHandler::GetBatchValue() {
+    auto cntl = batch_callback_->GetController();
+    auto response = batch_callback_->GetResponse();
+    if (!cntl || !response) {
+        status_.code = hybridse::common::kRpcError;
+        return row_;
+    }
+    brpc::Join(cntl->call_id());
+    if (cntl->Failed()) {
+        status_ = ::hybridse::base::Status(::hybridse::common::kRpcError, "request error. " + cntl->ErrorText());
+        return row_;
+    }
+    if (response->code() != ::openmldb::base::kOk || response->responses_size() <= batch_idx_) {
+        status_ = ::hybridse::base::Status(::hybridse::common::kResponseError, "request error. " + response->msg());
+        return row_;
+    }
+    // the rows of the responses before are ahead of the row in the attachment
+    size_t offset = 0;
+    for (int i = 0; i < batch_idx_; i++) {
+        offset += response->responses(i).byte_size();
+    }
+    const auto& sub_response = response->responses(batch_idx_);
+    if (sub_response.code() != ::openmldb::base::kOk) {
+        status_ = ::hybridse::base::Status(::hybridse::common::kResponseError, "request error. " + sub_response.msg());
+        return row_;
+    }
+    row_ = hybridse::codec::Row();
+    if (0 != sub_response.byte_size() &&
+        !codec::DecodeRpcRow(cntl->response_attachment(), offset, sub_response.byte_size(),
+                             sub_response.row_slices(), &row_)) {
+        status_.code = hybridse::common::kRpcError;
+        status_.msg = "response content decode fail";
+        return row_;
+    }
+    status_.code = ::hybridse::common::kOk;
+    return row_;
+}
+
+std::shared_ptr<TabletRowHandler> SubQueryBatch::Add(const std::shared_ptr<::openmldb::client::TabletClient>& client,
+                                                     const std::string& db,
+                                                     const ::openmldb::api::QueryRequest& request,
+                                                     butil::IOBuf* row_buf) {
+    auto handler = std::make_shared<TabletRowHandler>(db, shared_from_this());
+    std::lock_guard<std::mutex> lock(mu_);
+    pending_.emplace_back();
+    auto& sub_query = pending_.back();
+    sub_query.client = client;
+    sub_query.request = request;
+    sub_query.row_buf.swap(*row_buf);
+    sub_query.handler = handler;
+    return handler;
+}
+
+void SubQueryBatch::Flush() {
+    std::lock_guard<std::mutex> lock(mu_);
+    if (pending_.empty()) {
+        return;
+    }
+    // group the sub queries by the tablet in the order they are made
+    std::map<std::string, std::vector<SubQuery>> tablet_sub_queries;
+    for (auto& sub_query : pending_) {
+        if (sub_query.handler.expired()) {
+            continue;
+        }
+        tablet_sub_queries[sub_query.client->GetEndpoint()].push_back(std::move(sub_query));
+    }
+    pending_.clear();
+    for (auto& kv : tablet_sub_queries) {
+        Send(&kv.second);
+    }
+}
+
+void SubQueryBatch::Send(std::vector<SubQuery>* sub_queries) {
+    auto client = sub_queries->front().client;
+    if (sub_queries->size() == 1) {
+        auto& sub_query = sub_queries->front();
+        auto handler = sub_query.handler.lock();
+        if (!handler) {
+            return;
+        }
+        auto cntl = std::make_shared<brpc::Controller>();
+        cntl->request_attachment().swap(sub_query.row_buf);
+        cntl->set_timeout_ms(FLAGS_request_timeout_ms);
+        auto callback = new openmldb::RpcCallback<openmldb::api::QueryResponse>(
+            std::make_shared<::openmldb::api::QueryResponse>(), cntl);
+        handler->SetCallback(callback);
+        if (!client->SubQuery(sub_query.request, callback)) {
+            handler->SetStatus(::hybridse::base::Status(::hybridse::common::kRpcError, "send request failed"));
+            // the callback is not run by the rpc
+            callback->UnRef();
+        }
+        return;
+    }
+    auto cntl = std::make_shared<brpc::Controller>();
+    ::openmldb::api::SubQueryBatchRequest request;
+    for (auto& sub_query : *sub_queries) {
+        request.add_requests()->Swap(&sub_query.request);
+        cntl->request_attachment().append(sub_query.row_buf);
+    }
+    cntl->set_timeout_ms(FLAGS_request_timeout_ms);
+    auto callback = new openmldb::RpcCallback<openmldb::api::SubQueryBatchResponse>(
+        std::make_shared<::openmldb::api::SubQueryBatchResponse>(), cntl);
+    std::vector<std::shared_ptr<TabletRowHandler>> handlers;
+    for (size_t idx = 0; idx < sub_queries->size(); idx++) {
+        auto handler = (*sub_queries)[idx].handler.lock();
+        if (handler) {
+            handler->SetCallback(callback, idx);
+            handlers.push_back(handler);
+        }
+    }
+    DLOG(INFO) << "send " << sub_queries->size() << " sub queries to " << client->GetEndpoint() << " in one batch";
+    if (!client->SubQueryBatch(request, callback)) {
+        for (auto& handler : handlers) {
+            handler->SetStatus(::hybridse::base::Status(::hybridse::common::kRpcError, "send request failed"));
+        }
+        callback->UnRef();
+    }
+}
+
+// the innermost scope of the thread
+static thread_local SubQueryBatchScope* current_batch_scope = nullptr;
+
+SubQueryBatchScope::SubQueryBatchScope() : batch_(std::make_shared<SubQueryBatch>()), prev_(current_batch_scope) {
+    current_batch_scope = this;
+}
+
+SubQueryBatchScope::~SubQueryBatchScope() {
+    current_batch_scope = prev_;
+    batch_->Flush();
+}
+
+std::shared_ptr<SubQueryBatch> SubQueryBatchScope::Current() {
+    if (current_batch_scope == nullptr) {
+        return std::shared_ptr<SubQueryBatch>();
+    }
+    return current_batch_scope->batch_;
+}
+
 AsyncTableHandler::AsyncTableHandler(openmldb::RpcCallback<openmldb::api::SQLBatchRequestQueryResponse>* callback,
                                      const bool is_common)
     : hybridse::vm::MemTableHandler("", "", nullptr),
@@ -127,12 +313,13 @@ void AsyncTableHandler::SyncRpcResponse() {
         LOG(WARNING) << status_.msg;
         return;
     }
+    // the rows reference the blocks of the attachment rather than copies
+    codec::RpcRowDecoder decoder(cntl->response_attachment());
     size_t buf_offset = 0;
     for (int i = 0; i < response->row_sizes_size(); ++i) {
         size_t row_size = response->row_sizes(i);
         hybridse::codec::Row row;
-        if (0 != row_size && !codec::DecodeRpcRow(cntl->response_attachment(), buf_offset, row_size,
-                                                  response->non_common_slices(), &row)) {
+        if (0 != row_size && !decoder.Decode(buf_offset, row_size, response->non_common_slices(), &row)) {
             status_.code = hybridse::common::kResponseError;
             status_.msg = "response error: content decode fail";
             LOG(WARNING) << status_.msg;
@@ -242,6 +429,10 @@ std::shared_ptr<::hybridse::vm::RowHandler> TabletAccessor::SubQuery(uint32_t ta
         request.set_row_size(row_size);
         request.set_row_slices(row.GetRowPtrCnt());
     }
+    auto batch = SubQueryBatchScope::Current();
+    if (batch) {
+        return batch->Add(client, db, request, &cntl->request_attachment());
+    }
     auto response = std::make_shared<::openmldb::api::QueryResponse>();
     cntl->set_timeout_ms(FLAGS_request_timeout_ms);
     auto callback = new openmldb::RpcCallback<openmldb::api::QueryResponse>(response, cntl);
@@ -350,9 +541,36 @@ std::shared_ptr<hybridse::vm::TableHandler> TabletsAccessor::SubQuery(uint32_t t
     }
     return tables_handler;
 }
+bool ParseReadPolicy(const std::string& name, ReadPolicy* policy) {
+    if (name == "leader") {
+        *policy = kReadLeader;
+    } else if (name == "round_robin") {
+        *policy = kReadRoundRobin;
+    } else if (name == "least_outstanding") {
+        *policy = kReadLeastOutstanding;
+    } else if (name == "ewma_latency") {
+        *policy = kReadEWMALatency;
+    } else {
+        return false;
+    }
+    return true;
+}
+
 PartitionClientManager::PartitionClientManager(uint32_t pid, const std::shared_ptr<TabletAccessor>& leader,
                                                const std::vector<std::shared_ptr<TabletAccessor>>& followers)
-    : pid_(pid), leader_(leader), followers_(followers), rand_(0xdeadbeef) {}
+    : PartitionClientManager(pid, leader, followers, std::vector<uint64_t>(followers.size(), 0)) {}
+
+PartitionClientManager::PartitionClientManager(uint32_t pid, const std::shared_ptr<TabletAccessor>& leader,
+                                               const std::vector<std::shared_ptr<TabletAccessor>>& followers,
+                                               const std::vector<uint64_t>& follower_lags)
+    : pid_(pid),
+      leader_(leader),
+      followers_(followers),
+      follower_lags_(follower_lags),
+      rand_(0xdeadbeef),
+      read_seq_(0) {
+    follower_lags_.resize(followers_.size(), 0);
+}
 
 std::shared_ptr<TabletAccessor> PartitionClientManager::GetFollower() {
     if (!followers_.empty()) {
@@ -362,6 +580,51 @@ std::shared_ptr<TabletAccessor> PartitionClientManager::GetFollower() {
     return std::shared_ptr<TabletAccessor>();
 }
 
+std::shared_ptr<TabletAccessor> PartitionClientManager::GetReadTablet(ReadPolicy policy, uint64_t max_lag) {
+    if (policy == kReadLeader || followers_.empty()) {
+        return leader_;
+    }
+    std::vector<std::shared_ptr<TabletAccessor>> candidates;
+    candidates.reserve(followers_.size() + 1);
+    if (leader_) {
+        candidates.push_back(leader_);
+    }
+    for (size_t i = 0; i < followers_.size(); i++) {
+        if (follower_lags_[i] <= max_lag) {
+            candidates.push_back(followers_[i]);
+        }
+    }
+    if (candidates.empty()) {
+        return leader_;
+    }
+    switch (policy) {
+        case kReadRoundRobin:
+            return candidates[read_seq_.fetch_add(1, std::memory_order_relaxed) % candidates.size()];
+        case kReadLeastOutstanding: {
+            auto it = std::min_element(candidates.begin(), candidates.end(),
+                                       [](const std::shared_ptr<TabletAccessor>& l,
+                                          const std::shared_ptr<TabletAccessor>& r) {
+                                           return l->GetOutstanding() < r->GetOutstanding();
+                                       });
+            return *it;
+        }
+        case kReadEWMALatency: {
+            // the replica without any read is tried first, and the requests on the way add to the latency
+            auto cost = [](const std::shared_ptr<TabletAccessor>& tablet) {
+                return tablet->GetLatency() * (tablet->GetOutstanding() + 1);
+            };
+            auto it = std::min_element(candidates.begin(), candidates.end(),
+                                       [&cost](const std::shared_ptr<TabletAccessor>& l,
+                                               const std::shared_ptr<TabletAccessor>& r) {
+                                           return cost(l) < cost(r);
+                                       });
+            return *it;
+        }
+        default:
+            return leader_;
+    }
+}
+
 TableClientManager::TableClientManager(const TablePartitions& partitions, const ClientManager& client_manager) {
     for (const auto& table_partition : partitions) {
         uint32_t pid = table_partition.pid();
@@ -369,7 +632,9 @@ TableClientManager::TableClientManager(const TablePartitions& partitions, const
             continue;
         }
         std::shared_ptr<TabletAccessor> leader;
+        uint64_t leader_offset = 0;
         std::vector<std::shared_ptr<TabletAccessor>> follower;
+        std::vector<uint64_t> follower_offsets;
         for (const auto& meta : table_partition.partition_meta()) {
             if (meta.is_alive()) {
                 auto client = client_manager.GetTablet(meta.endpoint());
@@ -378,12 +643,18 @@ TableClientManager::TableClientManager(const TablePartitions& partitions, const
                 }
                 if (meta.is_leader()) {
                     leader = client;
+                    leader_offset = meta.offset();
                 } else {
                     follower.push_back(client);
+                    follower_offsets.push_back(meta.offset());
                 }
             }
         }
-        partition_managers_.push_back(std::make_shared<PartitionClientManager>(pid, leader, follower));
+        std::vector<uint64_t> follower_lags;
+        for (uint64_t offset : follower_offsets) {
+            follower_lags.push_back(leader_offset > offset ? leader_offset - offset : 0);
+        }
+        partition_managers_.push_back(std::make_shared<PartitionClientManager>(pid, leader, follower, follower_lags));
     }
 }
 
@@ -454,6 +725,15 @@ std::shared_ptr<TabletAccessor> ClientManager::GetTablet() const {
     return std::shared_ptr<TabletAccessor>();
 }
 
+std::vector<std::shared_ptr<TabletAccessor>> ClientManager::GetTablets() const {
+    std::lock_guard<::openmldb::base::SpinMutex> lock(mu_);
+    std::vector<std::shared_ptr<TabletAccessor>> tablets;
+    for (const auto& kv : clients_) {
+        tablets.push_back(kv.second);
+    }
+    return tablets;
+}
+
 bool ClientManager::UpdateClient(const std::map<std::string, std::string>& endpoint_map) {
     if (endpoint_map.empty()) {
         DLOG(INFO) << "endpoint_map is empty";
@@ -464,7 +744,7 @@ bool ClientManager::UpdateClient(const std::map<std::string, std::string>& endpo
         auto it = real_endpoint_map_.find(kv.first);
         if (it == real_endpoint_map_.end()) {
             auto wrapper = std::make_shared<TabletAccessor>(kv.first);
-            if (!wrapper->UpdateClient(kv.second)) {
+            if (!wrapper->UpdateClient(kv.second, connection_type_, channel_num_)) {
                 LOG(WARNING) << "add client failed. name " << kv.first << ", endpoint " << kv.second;
                 continue;
             }
@@ -476,7 +756,7 @@ bool ClientManager::UpdateClient(const std::map<std::string, std::string>& endpo
         if (it->second != kv.second) {
             auto client_it = clients_.find(kv.first);
             LOG(INFO) << "update client " << kv.first << "from " << it->second << " to " << kv.second;
-            if (!client_it->second->UpdateClient(kv.second)) {
+            if (!client_it->second->UpdateClient(kv.second, connection_type_, channel_num_)) {
                 LOG(WARNING) << "update client failed. name " << kv.first << ", endpoint " << kv.second;
                 continue;
             }
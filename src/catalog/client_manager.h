@@ -17,8 +17,11 @@
 #ifndef SRC_CATALOG_CLIENT_MANAGER_H_
 #define SRC_CATALOG_CLIENT_MANAGER_H_
 
+#include <algorithm>
+#include <atomic>
 #include <map>
 #include <memory>
+#include <mutex>  // NOLINT
 #include <set>
 #include <string>
 #include <unordered_map>
@@ -28,6 +31,7 @@
 #include "base/random.h"
 #include "base/spinlock.h"
 #include "client/tablet_client.h"
+#include "common/timer.h"
 #include "storage/schema.h"
 #include "vm/catalog.h"
 #include "vm/mem_catalog.h"
@@ -37,9 +41,26 @@ namespace catalog {
 
 using TablePartitions = ::google::protobuf::RepeatedPtrField<::openmldb::nameserver::TablePartition>;
 
+// the policy to choose the replica of a partition for the read requests
+enum ReadPolicy {
+    kReadLeader = 0,
+    kReadRoundRobin,
+    // the replica with the least requests on the way
+    kReadLeastOutstanding,
+    // the replica with the least moving average of the latency
+    kReadEWMALatency
+};
+
+// parse leader, round_robin, least_outstanding or ewma_latency
+bool ParseReadPolicy(const std::string& name, ReadPolicy* policy);
+
+class SubQueryBatch;
+
 class TabletRowHandler : public ::hybridse::vm::RowHandler {
  public:
     TabletRowHandler(const std::string& db, openmldb::RpcCallback<openmldb::api::QueryResponse>* callback);
+    // the sub query is deferred by the batch and sent when the value is read
+    TabletRowHandler(const std::string& db, const std::shared_ptr<SubQueryBatch>& batch);
     ~TabletRowHandler();
     explicit TabletRowHandler(::hybridse::base::Status status);
     const ::hybridse::vm::Schema* GetSchema() override { return nullptr; }
@@ -49,13 +70,71 @@ class TabletRowHandler : public ::hybridse::vm::RowHandler {
     ::hybridse::base::Status GetStatus() override { return status_; }
     const ::hybridse::codec::Row& GetValue() override;
 
+    // set by the batch when the deferred sub query is sent alone, in a batch of idx or fails
+    void SetCallback(openmldb::RpcCallback<openmldb::api::QueryResponse>* callback);
+    void SetCallback(openmldb::RpcCallback<openmldb::api::SubQueryBatchResponse>* callback, int idx);
+    void SetStatus(const ::hybridse::base::Status& status) { status_ = status; }
+
  private:
+    const ::hybridse::codec::Row& GetBatchValue();
+
     std::string db_;
     std::string name_;
     ::hybridse::base::Status status_;
     ::hybridse::codec::Row row_;
     openmldb::RpcCallback<openmldb::api::QueryResponse>* callback_;
+    std::shared_ptr<SubQueryBatch> batch_;
+    openmldb::RpcCallback<openmldb::api::SubQueryBatchResponse>* batch_callback_;
+    int batch_idx_;
+};
+
+// SubQueryBatch holds the request mode sub queries deferred in a SubQueryBatchScope. they are sent when the
+// value of any of them is read, the ones to the same tablet in one rpc
+class SubQueryBatch : public std::enable_shared_from_this<SubQueryBatch> {
+ public:
+    SubQueryBatch() : mu_(), pending_() {}
+
+    // the row of the request is in row_buf
+    std::shared_ptr<TabletRowHandler> Add(const std::shared_ptr<::openmldb::client::TabletClient>& client,
+                                          const std::string& db, const ::openmldb::api::QueryRequest& request,
+                                          butil::IOBuf* row_buf);
+
+    // send the sub queries deferred
+    void Flush();
+
+ private:
+    struct SubQuery {
+        std::shared_ptr<::openmldb::client::TabletClient> client;
+        ::openmldb::api::QueryRequest request;
+        butil::IOBuf row_buf;
+        // the sub query is dropped if its handler is released before it is sent
+        std::weak_ptr<TabletRowHandler> handler;
+    };
+
+    void Send(std::vector<SubQuery>* sub_queries);
+
+    std::mutex mu_;
+    std::vector<SubQuery> pending_;
 };
+
+// the sub queries made on the current thread during the scope are deferred by its batch, which are sent
+// when the scope ends if none of them is read
+class SubQueryBatchScope {
+ public:
+    SubQueryBatchScope();
+    ~SubQueryBatchScope();
+
+    SubQueryBatchScope(const SubQueryBatchScope&) = delete;
+    SubQueryBatchScope& operator=(const SubQueryBatchScope&) = delete;
+
+    // the batch of the innermost scope on the current thread, null if there is none
+    static std::shared_ptr<SubQueryBatch> Current();
+
+ private:
+    std::shared_ptr<SubQueryBatch> batch_;
+    SubQueryBatchScope* prev_;
+};
+
 class AsyncTableHandler : public ::hybridse::vm::MemTableHandler {
  public:
     explicit AsyncTableHandler(openmldb::RpcCallback<openmldb::api::SQLBatchRequestQueryResponse>* callback,
@@ -128,31 +207,59 @@ class AsyncTablesHandler : public ::hybridse::vm::MemTableHandler {
     std::vector<std::shared_ptr<TableHandler>> handlers_;
 };
 
+using TabletClients = std::vector<std::shared_ptr<::openmldb::client::TabletClient>>;
+
 class TabletAccessor : public ::hybridse::vm::Tablet {
  public:
-    explicit TabletAccessor(const std::string& name) : name_(name), tablet_client_() {}
+    explicit TabletAccessor(const std::string& name)
+        : name_(name), tablet_clients_(), client_seq_(0), outstanding_(0), latency_us_(0) {}
 
     TabletAccessor(const std::string& name, const std::shared_ptr<::openmldb::client::TabletClient>& client)
-        : name_(name), tablet_client_(client) {}
+        : name_(name),
+          tablet_clients_(std::make_shared<TabletClients>(1, client)),
+          client_seq_(0),
+          outstanding_(0),
+          latency_us_(0) {}
 
+    // the requests are sent through the channels to the tablet in turn
     std::shared_ptr<::openmldb::client::TabletClient> GetClient() {
-        return std::atomic_load_explicit(&tablet_client_, std::memory_order_relaxed);
+        auto clients = std::atomic_load_explicit(&tablet_clients_, std::memory_order_relaxed);
+        if (!clients || clients->empty()) {
+            return std::shared_ptr<::openmldb::client::TabletClient>();
+        }
+        if (clients->size() == 1) {
+            return clients->front();
+        }
+        return (*clients)[client_seq_.fetch_add(1, std::memory_order_relaxed) % clients->size()];
     }
 
-    bool UpdateClient(const std::string& endpoint) {
-        auto client = std::make_shared<::openmldb::client::TabletClient>(name_, endpoint);
-        if (client->Init() != 0) {
-            return false;
+    // connect the tablet with channel_num channels of the connection type, which do not share the connections
+    bool UpdateClient(const std::string& endpoint, const std::string& connection_type = "",
+                      uint32_t channel_num = 1) {
+        auto clients = std::make_shared<TabletClients>();
+        for (uint32_t i = 0; i < std::max(channel_num, 1u); i++) {
+            auto client = std::make_shared<::openmldb::client::TabletClient>(name_, endpoint);
+            client->SetConnectionOptions(connection_type, i == 0 ? "" : std::to_string(i));
+            if (client->Init() != 0) {
+                return false;
+            }
+            clients->push_back(client);
         }
-        std::atomic_store_explicit(&tablet_client_, client, std::memory_order_relaxed);
+        std::atomic_store_explicit(&tablet_clients_, clients, std::memory_order_relaxed);
         return true;
     }
 
     bool UpdateClient(const std::shared_ptr<::openmldb::client::TabletClient>& client) {
-        std::atomic_store_explicit(&tablet_client_, client, std::memory_order_relaxed);
+        std::atomic_store_explicit(&tablet_clients_, std::make_shared<TabletClients>(1, client),
+                                   std::memory_order_relaxed);
         return true;
     }
 
+    uint32_t GetChannelNum() const {
+        auto clients = std::atomic_load_explicit(&tablet_clients_, std::memory_order_relaxed);
+        return clients ? clients->size() : 0;
+    }
+
     std::shared_ptr<::hybridse::vm::RowHandler> SubQuery(uint32_t task_id, const std::string& db,
                                                          const std::string& sql, const ::hybridse::codec::Row& row,
                                                          const bool is_procedure, const bool is_debug) override;
@@ -165,9 +272,48 @@ class TabletAccessor : public ::hybridse::vm::Tablet {
                                                            const bool is_debug) override;
     const std::string& GetName() const { return name_; }
 
+    // the stats of the reads through the accessor, with which the replica to read is chosen
+    void BeginRead() { outstanding_.fetch_add(1, std::memory_order_relaxed); }
+
+    void EndRead(uint64_t latency_us) {
+        outstanding_.fetch_sub(1, std::memory_order_relaxed);
+        // the moving average with the weight 1/8 of the new sample, the concurrent updates may lose a sample
+        uint64_t old_latency = latency_us_.load(std::memory_order_relaxed);
+        uint64_t new_latency = old_latency == 0 ? latency_us : old_latency - old_latency / 8 + latency_us / 8;
+        latency_us_.store(std::max(new_latency, static_cast<uint64_t>(1)), std::memory_order_relaxed);
+    }
+
+    int32_t GetOutstanding() const { return outstanding_.load(std::memory_order_relaxed); }
+
+    // 0 if no read is done yet
+    uint64_t GetLatency() const { return latency_us_.load(std::memory_order_relaxed); }
+
  private:
     std::string name_;
-    std::shared_ptr<::openmldb::client::TabletClient> tablet_client_;
+    std::shared_ptr<TabletClients> tablet_clients_;
+    std::atomic<uint64_t> client_seq_;
+    std::atomic<int32_t> outstanding_;
+    std::atomic<uint64_t> latency_us_;
+};
+
+// count a read through the accessor during the scope
+class ReadStatsGuard {
+ public:
+    explicit ReadStatsGuard(const std::shared_ptr<TabletAccessor>& tablet)
+        : tablet_(tablet), start_(::baidu::common::timer::get_micros()) {
+        if (tablet_) {
+            tablet_->BeginRead();
+        }
+    }
+    ~ReadStatsGuard() {
+        if (tablet_) {
+            tablet_->EndRead(::baidu::common::timer::get_micros() - start_);
+        }
+    }
+
+ private:
+    std::shared_ptr<TabletAccessor> tablet_;
+    uint64_t start_;
 };
 class TabletsAccessor : public ::hybridse::vm::Tablet {
  public:
@@ -214,15 +360,25 @@ class PartitionClientManager {
     PartitionClientManager(uint32_t pid, const std::shared_ptr<TabletAccessor>& leader,
                            const std::vector<std::shared_ptr<TabletAccessor>>& followers);
 
+    // the lags are the offsets of the followers behind the leader
+    PartitionClientManager(uint32_t pid, const std::shared_ptr<TabletAccessor>& leader,
+                           const std::vector<std::shared_ptr<TabletAccessor>>& followers,
+                           const std::vector<uint64_t>& follower_lags);
+
     inline std::shared_ptr<TabletAccessor> GetLeader() const { return leader_; }
 
     std::shared_ptr<TabletAccessor> GetFollower();
 
+    // choose the leader or the follower within max_lag to read
+    std::shared_ptr<TabletAccessor> GetReadTablet(ReadPolicy policy, uint64_t max_lag);
+
  private:
     uint32_t pid_;
     std::shared_ptr<TabletAccessor> leader_;
     std::vector<std::shared_ptr<TabletAccessor>> followers_;
+    std::vector<uint64_t> follower_lags_;
     ::openmldb::base::Random rand_;
+    std::atomic<uint32_t> read_seq_;
 };
 
 class ClientManager;
@@ -265,6 +421,13 @@ class TableClientManager {
         }
         return std::shared_ptr<TabletAccessor>();
     }
+    std::shared_ptr<TabletAccessor> GetReadTablet(uint32_t pid, ReadPolicy policy, uint64_t max_lag) const {
+        auto partition_manager = GetPartitionClientManager(pid);
+        if (partition_manager) {
+            return partition_manager->GetReadTablet(policy, max_lag);
+        }
+        return std::shared_ptr<TabletAccessor>();
+    }
     std::shared_ptr<TabletsAccessor> GetTablet(std::vector<uint32_t> pids) const {
         std::shared_ptr<TabletsAccessor> tablets_accessor = std::shared_ptr<TabletsAccessor>(new TabletsAccessor());
         for (size_t idx = 0; idx < pids.size(); idx++) {
@@ -290,9 +453,23 @@ class TableClientManager {
 
 class ClientManager {
  public:
-    ClientManager() : real_endpoint_map_(), clients_(), mu_(), rand_(0xdeadbeef) {}
+    ClientManager()
+        : real_endpoint_map_(), clients_(), mu_(), rand_(0xdeadbeef), connection_type_(), channel_num_(1) {}
     std::shared_ptr<TabletAccessor> GetTablet(const std::string& name) const;
     std::shared_ptr<TabletAccessor> GetTablet() const;
+    std::vector<std::shared_ptr<TabletAccessor>> GetTablets() const;
+
+    // the channels to the tablets connected by endpoints later, see TabletAccessor::UpdateClient
+    void SetConnectionOptions(const std::string& connection_type, uint32_t channel_num) {
+        std::lock_guard<::openmldb::base::SpinMutex> lock(mu_);
+        connection_type_ = connection_type;
+        channel_num_ = channel_num;
+    }
+
+    std::string GetConnectionType() const {
+        std::lock_guard<::openmldb::base::SpinMutex> lock(mu_);
+        return connection_type_;
+    }
 
     bool UpdateClient(const std::map<std::string, std::string>& real_ep_map);
 
@@ -303,6 +480,8 @@ class ClientManager {
     std::unordered_map<std::string, std::shared_ptr<TabletAccessor>> clients_;
     mutable ::openmldb::base::SpinMutex mu_;
     mutable ::openmldb::base::Random rand_;
+    std::string connection_type_;
+    uint32_t channel_num_;
 };
 
 }  // namespace catalog
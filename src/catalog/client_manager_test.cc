@@ -16,6 +16,12 @@
 
 #include "catalog/client_manager.h"
 
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
 #include "gtest/gtest.h"
 
 namespace openmldb {
@@ -72,6 +78,124 @@ TEST_F(ClientManagerTest, client_manager_test) {
               table_client_manager.GetPartitionClientManager(0)->GetLeader()->GetClient()->GetRealEndpoint());
 }
 
+TEST_F(ClientManagerTest, read_policy_test) {
+    ::openmldb::nameserver::TableInfo table_info;
+    auto pt = table_info.add_table_partition();
+    pt->set_pid(0);
+    std::vector<uint64_t> offsets = {100, 95, 10};
+    std::map<std::string, std::shared_ptr<::openmldb::client::TabletClient>> tablet_clients;
+    for (int j = 0; j < 3; j++) {
+        auto meta = pt->add_partition_meta();
+        meta->set_is_leader(j == 0);
+        meta->set_is_alive(true);
+        meta->set_endpoint("name" + std::to_string(j));
+        meta->set_offset(offsets[j]);
+        tablet_clients.emplace(meta->endpoint(), std::make_shared<::openmldb::client::TabletClient>(
+                                                     meta->endpoint(), "endpoint" + std::to_string(j)));
+    }
+    ClientManager manager;
+    manager.UpdateClient(tablet_clients);
+    TableClientManager table_client_manager(table_info.table_partition(), manager);
+    auto leader = manager.GetTablet("name0");
+    auto follower = manager.GetTablet("name1");
+
+    ReadPolicy policy = kReadLeader;
+    ASSERT_FALSE(ParseReadPolicy("follower", &policy));
+    ASSERT_TRUE(ParseReadPolicy("round_robin", &policy));
+    ASSERT_EQ(kReadRoundRobin, policy);
+    for (int i = 0; i < 4; i++) {
+        ASSERT_EQ(leader, table_client_manager.GetReadTablet(0, kReadLeader, 10));
+    }
+    // name2 is 90 offsets behind the leader
+    std::set<std::string> names;
+    for (int i = 0; i < 4; i++) {
+        names.insert(table_client_manager.GetReadTablet(0, kReadRoundRobin, 10)->GetName());
+    }
+    ASSERT_EQ(std::set<std::string>({"name0", "name1"}), names);
+    names.clear();
+    for (int i = 0; i < 6; i++) {
+        names.insert(table_client_manager.GetReadTablet(0, kReadRoundRobin, 100)->GetName());
+    }
+    ASSERT_EQ(3u, names.size());
+
+    leader->BeginRead();
+    ASSERT_EQ(follower, table_client_manager.GetReadTablet(0, kReadLeastOutstanding, 10));
+    leader->EndRead(100);
+    ASSERT_EQ(leader, table_client_manager.GetReadTablet(0, kReadLeastOutstanding, 10));
+
+    // the follower without any read is tried first
+    ASSERT_EQ(follower, table_client_manager.GetReadTablet(0, kReadEWMALatency, 10));
+    follower->BeginRead();
+    follower->EndRead(800);
+    ASSERT_EQ(leader, table_client_manager.GetReadTablet(0, kReadEWMALatency, 10));
+    for (int i = 0; i < 20; i++) {
+        leader->BeginRead();
+        leader->EndRead(2000);
+    }
+    ASSERT_GT(leader->GetLatency(), follower->GetLatency());
+    ASSERT_EQ(follower, table_client_manager.GetReadTablet(0, kReadEWMALatency, 10));
+}
+
+TEST_F(ClientManagerTest, channel_test) {
+    ClientManager client_manager;
+    client_manager.SetConnectionOptions("pooled", 3);
+    std::map<std::string, std::string> endpoints = {{"127.0.0.1:9527", "127.0.0.1:9527"}};
+    ASSERT_TRUE(client_manager.UpdateClient(endpoints));
+    auto tablet = client_manager.GetTablet("127.0.0.1:9527");
+    ASSERT_TRUE(tablet);
+    ASSERT_EQ(3u, tablet->GetChannelNum());
+    ASSERT_EQ(1u, client_manager.GetTablets().size());
+    // the requests are sent through the channels in turn
+    std::set<std::shared_ptr<::openmldb::client::TabletClient>> clients;
+    for (int i = 0; i < 6; i++) {
+        auto client = tablet->GetClient();
+        ASSERT_TRUE(client);
+        ASSERT_EQ("127.0.0.1:9527", client->GetEndpoint());
+        clients.insert(client);
+    }
+    ASSERT_EQ(3u, clients.size());
+
+    auto client = std::make_shared<::openmldb::client::TabletClient>("127.0.0.1:9528", "");
+    ASSERT_TRUE(tablet->UpdateClient(client));
+    ASSERT_EQ(1u, tablet->GetChannelNum());
+    ASSERT_EQ(client, tablet->GetClient());
+}
+
+TEST_F(ClientManagerTest, sub_query_batch_test) {
+    ASSERT_FALSE(SubQueryBatchScope::Current());
+    {
+        SubQueryBatchScope scope;
+        auto batch = SubQueryBatchScope::Current();
+        ASSERT_TRUE(batch);
+        {
+            SubQueryBatchScope inner_scope;
+            ASSERT_TRUE(SubQueryBatchScope::Current());
+            ASSERT_NE(batch, SubQueryBatchScope::Current());
+        }
+        ASSERT_EQ(batch, SubQueryBatchScope::Current());
+
+        // the client is not inited, so the batch fails to be sent
+        auto client = std::make_shared<::openmldb::client::TabletClient>("name0", "endpoint0");
+        std::vector<std::shared_ptr<TabletRowHandler>> handlers;
+        for (int i = 0; i < 3; i++) {
+            ::openmldb::api::QueryRequest request;
+            request.set_db("db1");
+            request.set_sql("select * from t1;");
+            request.set_task_id(i);
+            butil::IOBuf row_buf;
+            handlers.push_back(batch->Add(client, "db1", request, &row_buf));
+            ASSERT_TRUE(handlers.back()->GetStatus().isRunning());
+        }
+        // the sub query whose handler is released is dropped
+        handlers.pop_back();
+        handlers[0]->GetValue();
+        for (auto& handler : handlers) {
+            ASSERT_EQ(::hybridse::common::kRpcError, handler->GetStatus().code);
+        }
+    }
+    ASSERT_FALSE(SubQueryBatchScope::Current());
+}
+
 }  // namespace catalog
 }  // namespace openmldb
 
@@ -16,22 +16,44 @@
 
 #include "catalog/distribute_iterator.h"
 
+#include <utility>
+
+#include "gflags/gflags.h"
+
+DECLARE_uint32(partition_prefetch_num);
+
 namespace openmldb {
 namespace catalog {
 
+uint32_t GetPrefetchNum(const std::shared_ptr<Tables>& tables) {
+    if (!tables || tables->empty()) {
+        return 0;
+    }
+    auto table_meta = tables->begin()->second->GetTableMeta();
+    if (!table_meta || table_meta->storage_mode() == ::openmldb::type::StorageMode::kMemory) {
+        return 0;
+    }
+    return FLAGS_partition_prefetch_num;
+}
+
 FullTableIterator::FullTableIterator(std::shared_ptr<Tables> tables)
-    : tables_(tables), cur_pid_(0), it_(), key_(0), value_() {}
+    : tables_(tables),
+      cur_pid_(0),
+      it_(),
+      key_(0),
+      value_(),
+      prefetcher_(tables, [](const std::shared_ptr<::openmldb::storage::Table>& table) {
+          std::unique_ptr<::openmldb::storage::TableIterator> it(table->NewTraverseIterator(0));
+          if (it) {
+              it->SeekToFirst();
+          }
+          return it;
+      }) {}
 
 void FullTableIterator::SeekToFirst() {
-    it_.reset();
-    for (const auto& kv : *tables_) {
-        it_.reset(kv.second->NewTraverseIterator(0));
-        it_->SeekToFirst();
-        if (it_->Valid()) {
-            cur_pid_ = kv.first;
-            key_ = it_->GetKey();
-            break;
-        }
+    it_ = prefetcher_.Open(0, &cur_pid_);
+    if (it_) {
+        key_ = it_->GetKey();
     }
 }
 
@@ -40,17 +62,9 @@ bool FullTableIterator::Valid() const { return it_ && it_->Valid(); }
 void FullTableIterator::Next() {
     it_->Next();
     if (!it_->Valid()) {
-        auto iter = tables_->find(cur_pid_);
-        if (iter == tables_->end()) {
-            return;
-        }
-        for (iter++; iter != tables_->end(); iter++) {
-            it_.reset(iter->second->NewTraverseIterator(0));
-            it_->SeekToFirst();
-            if (it_->Valid()) {
-                cur_pid_ = iter->first;
-                break;
-            }
+        auto it = prefetcher_.Open(cur_pid_ + 1, &cur_pid_);
+        if (it) {
+            it_ = std::move(it);
         }
     }
     if (it_ && it_->Valid()) {
@@ -65,7 +79,18 @@ const ::hybridse::codec::Row& FullTableIterator::GetValue() {
 }
 
 DistributeWindowIterator::DistributeWindowIterator(std::shared_ptr<Tables> tables, uint32_t index)
-    : tables_(tables), index_(index), cur_pid_(0), pid_num_(1), it_() {
+    : tables_(tables),
+      index_(index),
+      cur_pid_(0),
+      pid_num_(1),
+      it_(),
+      prefetcher_(tables, [index](const std::shared_ptr<::openmldb::storage::Table>& table) {
+          std::unique_ptr<::hybridse::codec::WindowIterator> it(table->NewWindowIterator(index));
+          if (it) {
+              it->SeekToFirst();
+          }
+          return it;
+      }) {
     if (tables && !tables->empty()) {
         pid_num_ = tables->begin()->second->GetTableMeta()->table_partition_size();
     }
@@ -89,16 +114,9 @@ void DistributeWindowIterator::Seek(const std::string& key) {
             return;
         }
     }
-    for (const auto& kv : *tables_) {
-        if (kv.first <= cur_pid_) {
-            continue;
-        }
-        it_.reset(kv.second->NewWindowIterator(index_));
-        it_->SeekToFirst();
-        if (it_->Valid()) {
-            cur_pid_ = kv.first;
-            break;
-        }
+    auto it = prefetcher_.Open(cur_pid_ + 1, &cur_pid_);
+    if (it) {
+        it_ = std::move(it);
     }
 }
 
@@ -108,30 +126,15 @@ void DistributeWindowIterator::SeekToFirst() {
     if (!tables_) {
         return;
     }
-    for (const auto& kv : *tables_) {
-        it_.reset(kv.second->NewWindowIterator(index_));
-        it_->SeekToFirst();
-        if (it_->Valid()) {
-            cur_pid_ = kv.first;
-            break;
-        }
-    }
+    it_ = prefetcher_.Open(0, &cur_pid_);
 }
 
 void DistributeWindowIterator::Next() {
     it_->Next();
     if (!it_->Valid()) {
-        auto iter = tables_->find(cur_pid_);
-        if (iter == tables_->end()) {
-            return;
-        }
-        for (iter++; iter != tables_->end(); iter++) {
-            it_.reset(iter->second->NewWindowIterator(index_));
-            it_->SeekToFirst();
-            if (it_->Valid()) {
-                cur_pid_ = iter->first;
-                break;
-            }
+        auto it = prefetcher_.Open(cur_pid_ + 1, &cur_pid_);
+        if (it) {
+            it_ = std::move(it);
         }
     }
 }
@@ -17,9 +17,13 @@
 #ifndef SRC_CATALOG_DISTRIBUTE_ITERATOR_H_
 #define SRC_CATALOG_DISTRIBUTE_ITERATOR_H_
 
+#include <deque>
+#include <functional>
+#include <future>  // NOLINT
 #include <map>
 #include <memory>
 #include <string>
+#include <utility>
 
 #include "base/hash.h"
 #include "storage/table.h"
@@ -30,6 +34,65 @@ namespace catalog {
 
 using Tables = std::map<uint32_t, std::shared_ptr<::openmldb::storage::Table>>;
 
+// the number of the partitions to open ahead, which is 0 for the tables in memory
+uint32_t GetPrefetchNum(const std::shared_ptr<Tables>& tables);
+
+// PartitionPrefetcher opens the iterators of the partitions after the current one in the background,
+// so that the iteration of a disk table does not wait on the disk when it moves to the next partition
+template <class It>
+class PartitionPrefetcher {
+ public:
+    // open the iterator of a partition and seek it to the first
+    using Opener = std::function<std::unique_ptr<It>(const std::shared_ptr<::openmldb::storage::Table>&)>;
+
+    PartitionPrefetcher(const std::shared_ptr<Tables>& tables, const Opener& opener)
+        : tables_(tables), opener_(opener), num_(GetPrefetchNum(tables)), pending_() {}
+
+    // the iterator of the first partition not empty from pid on, null if there is none
+    std::unique_ptr<It> Open(uint32_t pid, uint32_t* valid_pid) {
+        if (!tables_) {
+            return std::unique_ptr<It>();
+        }
+        for (auto iter = tables_->lower_bound(pid); iter != tables_->end(); ++iter) {
+            while (!pending_.empty() && pending_.front().first < iter->first) {
+                pending_.pop_front();
+            }
+            std::unique_ptr<It> it;
+            if (!pending_.empty() && pending_.front().first == iter->first) {
+                it = pending_.front().second.get();
+                pending_.pop_front();
+            } else {
+                it = opener_(iter->second);
+            }
+            if (it && it->Valid()) {
+                *valid_pid = iter->first;
+                Prefetch(std::next(iter));
+                return it;
+            }
+        }
+        return std::unique_ptr<It>();
+    }
+
+ private:
+    void Prefetch(Tables::const_iterator iter) {
+        if (!pending_.empty()) {
+            iter = tables_->upper_bound(pending_.back().first);
+        }
+        for (; iter != tables_->end() && pending_.size() < num_; ++iter) {
+            auto table = iter->second;
+            auto opener = opener_;
+            pending_.emplace_back(iter->first,
+                                  std::async(std::launch::async, [opener, table] { return opener(table); }));
+        }
+    }
+
+    std::shared_ptr<Tables> tables_;
+    Opener opener_;
+    uint32_t num_;
+    // the partitions opened ahead in the order of the pids
+    std::deque<std::pair<uint32_t, std::future<std::unique_ptr<It>>>> pending_;
+};
+
 class FullTableIterator : public ::hybridse::codec::ConstIterator<uint64_t, ::hybridse::codec::Row> {
  public:
     explicit FullTableIterator(std::shared_ptr<Tables> tables);
@@ -48,6 +111,7 @@ class FullTableIterator : public ::hybridse::codec::ConstIterator<uint64_t, ::hy
     std::unique_ptr<::openmldb::storage::TableIterator> it_;
     uint64_t key_;
     ::hybridse::codec::Row value_;
+    PartitionPrefetcher<::openmldb::storage::TableIterator> prefetcher_;
 };
 
 class DistributeWindowIterator : public ::hybridse::codec::WindowIterator {
@@ -67,6 +131,7 @@ class DistributeWindowIterator : public ::hybridse::codec::WindowIterator {
     uint32_t cur_pid_;
     uint32_t pid_num_;
     std::unique_ptr<::hybridse::codec::WindowIterator> it_;
+    PartitionPrefetcher<::hybridse::codec::WindowIterator> prefetcher_;
 };
 
 }  // namespace catalog
@@ -116,6 +116,7 @@ bool SDKTableHandler::GetTablet(std::vector<std::shared_ptr<TabletAccessor>>* ta
 }
 
 bool SDKCatalog::Init(const std::vector<::openmldb::nameserver::TableInfo>& tables, const Procedures& db_sp_map) {
+    std::vector<std::shared_ptr<SDKTableHandler>> handlers;
     for (size_t i = 0; i < tables.size(); i++) {
         const ::openmldb::nameserver::TableInfo& table_meta = tables[i];
         std::shared_ptr<SDKTableHandler> table = std::make_shared<SDKTableHandler>(table_meta, *client_manager_);
@@ -123,6 +124,13 @@ bool SDKCatalog::Init(const std::vector<::openmldb::nameserver::TableInfo>& tabl
             LOG(WARNING) << "fail to init table " << table_meta.name();
             return false;
         }
+        handlers.push_back(table);
+    }
+    return Init(handlers, db_sp_map);
+}
+
+bool SDKCatalog::Init(const std::vector<std::shared_ptr<SDKTableHandler>>& tables, const Procedures& db_sp_map) {
+    for (const auto& table : tables) {
         auto db_it = tables_.find(table->GetDatabase());
         if (db_it == tables_.end()) {
             auto result_pair = tables_.insert(
@@ -74,6 +74,10 @@ class SDKTableHandler : public ::hybridse::vm::TableHandler {
 
     std::shared_ptr<TabletAccessor> GetTablet(uint32_t pid);
 
+    std::shared_ptr<TabletAccessor> GetReadTablet(uint32_t pid, ReadPolicy policy, uint64_t max_lag) {
+        return table_client_manager_->GetReadTablet(pid, policy, max_lag);
+    }
+
     bool GetTablet(std::vector<std::shared_ptr<TabletAccessor>>* tablets);
 
     inline uint32_t GetTid() const { return meta_.tid(); }
@@ -112,6 +116,8 @@ class SDKCatalog : public ::hybridse::vm::Catalog {
     ~SDKCatalog() {}
 
     bool Init(const std::vector<::openmldb::nameserver::TableInfo>& tables, const Procedures& db_sp_map);
+    // init with the handlers built already, e.g. the ones of the tables not changed since the last catalog
+    bool Init(const std::vector<std::shared_ptr<SDKTableHandler>>& tables, const Procedures& db_sp_map);
 
     std::shared_ptr<::hybridse::type::Database> GetDatabase(const std::string& db) override {
         return std::shared_ptr<::hybridse::type::Database>();
@@ -26,11 +26,32 @@
 #include "catalog/schema_adapter.h"
 #include "codec/list_iterator_codec.h"
 #include "glog/logging.h"
+#include "storage/mem_table.h"
 DECLARE_bool(enable_distsql);
 DECLARE_bool(enable_localtablet);
 namespace openmldb {
 namespace catalog {
 
+void TabletSegmentHandler::SetPredicate(::hybridse::vm::WindowIterator* iter) {
+    if (!predicate_) {
+        return;
+    }
+    auto mem_iter = dynamic_cast<::openmldb::storage::MemTableKeyIterator*>(iter);
+    if (mem_iter != nullptr) {
+        mem_iter->SetPredicate(predicate_);
+    }
+}
+
+void TabletSegmentHandler::SetMask(::hybridse::vm::WindowIterator* iter) {
+    if (!mask_) {
+        return;
+    }
+    auto mem_iter = dynamic_cast<::openmldb::storage::MemTableKeyIterator*>(iter);
+    if (mem_iter != nullptr) {
+        mem_iter->SetColumnMask(mask_);
+    }
+}
+
 TabletTableHandler::TabletTableHandler(const ::openmldb::api::TableMeta& meta,
                                        std::shared_ptr<hybridse::vm::Tablet> local_tablet)
     : schema_(),
@@ -147,6 +168,20 @@ const ::hybridse::codec::Row TabletTableHandler::Get(int32_t pos) {
     return nullptr;
 }
 
+std::vector<std::shared_ptr<::hybridse::vm::TableHandler>> TabletTableHandler::GetParts() {
+    auto tables = std::atomic_load_explicit(&tables_, std::memory_order_acquire);
+    std::vector<std::shared_ptr<::hybridse::vm::TableHandler>> parts;
+    if (tables->size() <= 1) {
+        return parts;
+    }
+    for (const auto& kv : *tables) {
+        auto part = std::make_shared<Tables>();
+        part->emplace(kv.first, kv.second);
+        parts.push_back(std::make_shared<TabletTablePartHandler>(shared_from_this(), part));
+    }
+    return parts;
+}
+
 const uint64_t TabletTableHandler::GetCount() {
     auto iter = GetIterator();
     uint64_t cnt = 0;
@@ -165,6 +200,47 @@ const uint64_t TabletTableHandler::GetCount() {
     return iter->Valid() ? iter->GetValue() : ::hybridse::codec::Row();
 }
 
+bool TabletTableHandler::GetDataVersion(uint64_t* version) {
+    auto tables = std::atomic_load_explicit(&tables_, std::memory_order_acquire);
+    if (tables->size() != table_st_.GetPartitionNum()) {
+        return false;
+    }
+    uint64_t combined = 0;
+    for (const auto& kv : *tables) {
+        auto table = std::dynamic_pointer_cast<::openmldb::storage::MemTable>(kv.second);
+        if (!table) {
+            return false;
+        }
+        uint64_t value = table->GetWriteVersion() ^ (static_cast<uint64_t>(kv.first) << 32);
+        combined ^= value + 0x9e3779b97f4a7c15 + (combined << 6) + (combined >> 2);
+    }
+    *version = combined;
+    return true;
+}
+
+bool TabletTableHandler::GetIndexStats(const std::string& index_name, ::hybridse::vm::IndexStats* stats) {
+    auto tables = std::atomic_load_explicit(&tables_, std::memory_order_acquire);
+    ::hybridse::vm::IndexStats sum;
+    for (const auto& kv : *tables) {
+        auto table = std::dynamic_pointer_cast<::openmldb::storage::MemTable>(kv.second);
+        if (!table) {
+            continue;
+        }
+        uint64_t pk_cnt = 0;
+        uint64_t row_cnt = 0;
+        if (!table->GetIndexStats(index_name, &pk_cnt, &row_cnt)) {
+            return false;
+        }
+        sum.pk_cnt += pk_cnt;
+        sum.row_cnt += row_cnt;
+    }
+    if (sum.pk_cnt == 0) {
+        return false;
+    }
+    *stats = sum;
+    return true;
+}
+
 std::shared_ptr<::hybridse::vm::PartitionHandler> TabletTableHandler::GetPartition(const std::string& index_name) {
     if (index_hint_.find(index_name) == index_hint_.cend()) {
         LOG(WARNING) << "fail to get partition for tablet table handler, index name " << index_name;
@@ -41,7 +41,7 @@ class TabletSegmentHandler;
 class TabletSegmentHandler : public ::hybridse::vm::TableHandler {
  public:
     TabletSegmentHandler(std::shared_ptr<::hybridse::vm::PartitionHandler> partition_handler, const std::string &key)
-        : TableHandler(), partition_handler_(partition_handler), key_(key) {}
+        : TableHandler(), partition_handler_(partition_handler), key_(key), predicate_(), mask_(), positions_(this) {}
 
     ~TabletSegmentHandler() {}
 
@@ -60,6 +60,8 @@ class TabletSegmentHandler : public ::hybridse::vm::TableHandler {
     std::unique_ptr<::hybridse::vm::RowIterator> GetIterator() override {
         auto iter = partition_handler_->GetWindowIterator();
         if (iter) {
+            SetPredicate(iter.get());
+            SetMask(iter.get());
             DLOG(INFO) << "seek to pk " << key_;
             iter->Seek(key_);
             if (iter->Valid() && 0 == iter->GetKey().compare(hybridse::codec::Row(key_))) {
@@ -74,6 +76,8 @@ class TabletSegmentHandler : public ::hybridse::vm::TableHandler {
     ::hybridse::vm::RowIterator *GetRawIterator() override {
         auto iter = partition_handler_->GetWindowIterator();
         if (iter) {
+            SetPredicate(iter.get());
+            SetMask(iter.get());
             DLOG(INFO) << "seek to pk " << key_;
             iter->Seek(key_);
             if (iter->Valid() && 0 == iter->GetKey().compare(hybridse::codec::Row(key_))) {
@@ -100,19 +104,77 @@ class TabletSegmentHandler : public ::hybridse::vm::TableHandler {
         return cnt;
     }
 
-    ::hybridse::vm::Row At(uint64_t pos) override {
-        auto iter = GetIterator();
-        if (!iter) return ::hybridse::vm::Row();
-        while (pos-- > 0 && iter->Valid()) {
-            iter->Next();
+    // the rows are read from the storage once for all the calls of lag, at and first_value over the window
+    ::hybridse::vm::Row At(uint64_t pos) override { return positions_.At(pos); }
+    const std::string GetHandlerTypeName() override { return "TabletSegmentHandler"; }
+
+    bool SetRowPredicate(const std::shared_ptr<::hybridse::vm::RowPredicate> &predicate) override {
+        predicate_ = predicate;
+        positions_.Reset();
+        return true;
+    }
+
+    bool SetColumnMask(const std::shared_ptr<const std::vector<bool>> &mask) override {
+        if (!mask || mask->size() != static_cast<size_t>(GetSchema()->size())) {
+            return false;
         }
-        return iter->Valid() ? iter->GetValue() : ::hybridse::vm::Row();
+        mask_ = mask;
+        positions_.Reset();
+        return true;
     }
-    const std::string GetHandlerTypeName() override { return "TabletSegmentHandler"; }
+
+ private:
+    // the predicate is evaluated by the iterators of the local memory tables only
+    void SetPredicate(::hybridse::vm::WindowIterator *iter);
+    // the mask is applied to the compact rows of the local memory tables only
+    void SetMask(::hybridse::vm::WindowIterator *iter);
 
  private:
     std::shared_ptr<::hybridse::vm::PartitionHandler> partition_handler_;
     std::string key_;
+    std::shared_ptr<::hybridse::vm::RowPredicate> predicate_;
+    std::shared_ptr<const std::vector<bool>> mask_;
+    ::hybridse::vm::RowPositionIndex positions_;
+};
+
+// a local partition of a table, iterated by its own thread in the batch queries
+class TabletTablePartHandler : public ::hybridse::vm::TableHandler {
+ public:
+    TabletTablePartHandler(std::shared_ptr<::hybridse::vm::TableHandler> table_handler, std::shared_ptr<Tables> tables)
+        : TableHandler(), table_handler_(table_handler), tables_(tables) {}
+
+    ~TabletTablePartHandler() {}
+
+    const ::hybridse::vm::Schema *GetSchema() override { return table_handler_->GetSchema(); }
+
+    const std::string &GetName() override { return table_handler_->GetName(); }
+
+    const std::string &GetDatabase() override { return table_handler_->GetDatabase(); }
+
+    const ::hybridse::vm::Types &GetTypes() override { return table_handler_->GetTypes(); }
+
+    const ::hybridse::vm::IndexHint &GetIndex() override { return table_handler_->GetIndex(); }
+
+    std::unique_ptr<::hybridse::codec::RowIterator> GetIterator() override {
+        return std::unique_ptr<::hybridse::codec::RowIterator>(new FullTableIterator(tables_));
+    }
+
+    ::hybridse::codec::RowIterator *GetRawIterator() override { return new FullTableIterator(tables_); }
+
+    std::unique_ptr<::hybridse::codec::WindowIterator> GetWindowIterator(const std::string &idx_name) override {
+        auto iter = GetIndex().find(idx_name);
+        if (iter == GetIndex().end()) {
+            return std::unique_ptr<::hybridse::codec::WindowIterator>();
+        }
+        return std::unique_ptr<::hybridse::codec::WindowIterator>(
+            new DistributeWindowIterator(tables_, iter->second.index));
+    }
+
+    const std::string GetHandlerTypeName() override { return "TabletTablePartHandler"; }
+
+ private:
+    std::shared_ptr<::hybridse::vm::TableHandler> table_handler_;
+    std::shared_ptr<Tables> tables_;
 };
 
 class TabletPartitionHandler : public ::hybridse::vm::PartitionHandler,
@@ -195,9 +257,18 @@ class TabletTableHandler : public ::hybridse::vm::TableHandler,
 
     ::hybridse::codec::Row At(uint64_t pos) override;
 
+    // the version is kept only when all the partitions are local memory tables
+    bool GetDataVersion(uint64_t *version) override;
+
+    // the statistics are summed up from the local memory tables, which are taken as a sample of all the partitions
+    bool GetIndexStats(const std::string &index_name, ::hybridse::vm::IndexStats *stats) override;
+
     std::shared_ptr<::hybridse::vm::PartitionHandler> GetPartition(const std::string &index_name) override;
     const std::string GetHandlerTypeName() override { return "TabletTableHandler"; }
 
+    // one part per local partition
+    std::vector<std::shared_ptr<::hybridse::vm::TableHandler>> GetParts() override;
+
     std::shared_ptr<::hybridse::vm::Tablet> GetTablet(const std::string &index_name, const std::string &pk) override;
     std::shared_ptr<::hybridse::vm::Tablet> GetTablet(const std::string &index_name,
                                                       const std::vector<std::string> &pks) override;
@@ -198,6 +198,22 @@ TEST_F(TabletCatalogTest, segment_handler_pk_not_exist_test) {
     }
     delete args;
 }
+TEST_F(TabletCatalogTest, index_stats_test) {
+    TestArgs *args = PrepareMultiPartitionTable("t1", 2);
+    TabletTableHandler handler(args->meta[0], std::shared_ptr<hybridse::vm::Tablet>());
+    ClientManager client_manager;
+    ASSERT_TRUE(handler.Init(client_manager));
+    ::hybridse::vm::IndexStats stats;
+    ASSERT_FALSE(handler.GetIndexStats(args->idx_name, &stats));
+    handler.AddTable(args->tables[0]);
+    handler.AddTable(args->tables[1]);
+    ASSERT_TRUE(handler.GetIndexStats(args->idx_name, &stats));
+    ASSERT_EQ(100u, stats.pk_cnt);
+    ASSERT_EQ(500u, stats.row_cnt);
+    ASSERT_FALSE(handler.GetIndexStats("index_not_exist", &stats));
+    delete args;
+}
+
 TEST_F(TabletCatalogTest, sql_smoke_test) {
     std::shared_ptr<TabletCatalog> catalog(new TabletCatalog());
     ASSERT_TRUE(catalog->Init());
@@ -421,6 +437,34 @@ TEST_F(TabletCatalogTest, iterator_test) {
     }
     ASSERT_EQ(record_num, 500);
 }
+TEST_F(TabletCatalogTest, sql_parallel_table_project_test) {
+    std::shared_ptr<TabletCatalog> catalog(new TabletCatalog());
+    ASSERT_TRUE(catalog->Init());
+    uint32_t pid_num = 8;
+    TestArgs *args = PrepareMultiPartitionTable("t1", pid_num);
+    for (uint32_t pid = 0; pid < pid_num; pid++) {
+        ASSERT_TRUE(catalog->AddTable(args->meta[pid], args->tables[pid]));
+    }
+    ASSERT_EQ(pid_num, catalog->GetTable("db1", "t1")->GetParts().size());
+    std::string sql = "select col1, col2 + 1 from t1 where col2 % 2 = 0;";
+    std::vector<std::vector<hybridse::codec::Row>> outputs(2);
+    for (uint32_t thread_num : {1, 4}) {
+        ::hybridse::vm::EngineOptions options;
+        options.set_batch_window_thread_num(thread_num);
+        ::hybridse::vm::Engine engine(catalog, options);
+        ::hybridse::vm::BatchRunSession session;
+        ::hybridse::base::Status status;
+        ASSERT_TRUE(engine.Get(sql, "db1", session, status)) << status.msg;
+        auto &output = outputs[thread_num == 1 ? 0 : 1];
+        ASSERT_EQ(0, session.Run(output));
+        ASSERT_EQ(300u, output.size());
+    }
+    // the rows of the parts are merged in the order of the serial run
+    for (size_t i = 0; i < outputs[0].size(); i++) {
+        ASSERT_EQ(outputs[0][i].ToString(), outputs[1][i].ToString());
+    }
+}
+
 TEST_F(TabletCatalogTest, window_iterator_seek_test_discontinuous) {
     std::vector<std::shared_ptr<TabletCatalog>> catalog_vec;
     for (int i = 0; i < 2; i++) {
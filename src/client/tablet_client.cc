@@ -19,8 +19,11 @@
 #include <algorithm>
 #include <iostream>
 #include <set>
+#include <string>
+#include <vector>
 
 #include "base/glog_wapper.h"  // NOLINT
+#include "base/strings.h"
 #include "brpc/channel.h"
 #include "codec/codec.h"
 #include "codec/sql_rpc_row_codec.h"
@@ -32,10 +35,21 @@ DECLARE_int32(request_timeout_ms);
 DECLARE_uint32(latest_ttl_max);
 DECLARE_uint32(absolute_ttl_max);
 DECLARE_bool(enable_show_tp);
+DECLARE_string(attachment_accept_compress);
 
 namespace openmldb {
 namespace client {
 
+// the compress type the client accepts for the response attachments of the method
+static ::openmldb::type::CompressType AcceptCompressType(const std::string& method) {
+    static const std::set<std::string> methods = [] {
+        std::vector<std::string> vec;
+        ::openmldb::base::SplitString(FLAGS_attachment_accept_compress, ",", vec);
+        return std::set<std::string>(vec.begin(), vec.end());
+    }();
+    return methods.count(method) > 0 ? ::openmldb::type::kSnappy : ::openmldb::type::kNoCompress;
+}
+
 TabletClient::TabletClient(const std::string& endpoint, const std::string& real_endpoint)
     : Client(endpoint, real_endpoint), client_(real_endpoint.empty() ? endpoint : real_endpoint) {}
 
@@ -46,6 +60,10 @@ TabletClient::~TabletClient() {}
 
 int TabletClient::Init() { return client_.Init(); }
 
+void TabletClient::SetConnectionOptions(const std::string& connection_type, const std::string& connection_group) {
+    client_.SetConnectionOptions(connection_type, connection_group);
+}
+
 bool TabletClient::Query(const std::string& db, const std::string& sql, const std::string& row, brpc::Controller* cntl,
                          openmldb::api::QueryResponse* response, const bool is_debug) {
     if (cntl == NULL || response == NULL) return false;
@@ -61,7 +79,9 @@ bool TabletClient::Query(const std::string& db, const std::string& sql, const st
         LOG(WARNING) << "Encode row buffer failed";
         return false;
     }
-    bool ok = client_.SendRequest(&::openmldb::api::TabletServer_Stub::Query, cntl, &request, response);
+    request.set_accept_compress_type(AcceptCompressType("query"));
+    bool ok = client_.SendRequest(&::openmldb::api::TabletServer_Stub::Query, cntl, &request, response) &&
+              codec::UncompressResponseAttachment(response, &cntl->response_attachment());
     if (!ok || response->code() != 0) {
         LOG(WARNING) << "fail to query tablet";
         return false;
@@ -72,13 +92,17 @@ bool TabletClient::Query(const std::string& db, const std::string& sql, const st
 bool TabletClient::Query(const std::string& db, const std::string& sql,
                          const std::vector<openmldb::type::DataType>& parameter_types,
                          const std::string& parameter_row,
-                         brpc::Controller* cntl, ::openmldb::api::QueryResponse* response, const bool is_debug) {
+                         brpc::Controller* cntl, ::openmldb::api::QueryResponse* response, const bool is_debug,
+                         uint32_t stream_chunk_size) {
     if (cntl == NULL || response == NULL) return false;
     ::openmldb::api::QueryRequest request;
     request.set_sql(sql);
     request.set_db(db);
     request.set_is_batch(true);
     request.set_is_debug(is_debug);
+    if (stream_chunk_size > 0) {
+        request.set_stream_chunk_size(stream_chunk_size);
+    }
     request.set_parameter_row_size(parameter_row.size());
     request.set_parameter_row_slices(1);
     for (auto& type : parameter_types) {
@@ -89,7 +113,9 @@ bool TabletClient::Query(const std::string& db, const std::string& sql,
         LOG(WARNING) << "Encode parameter buffer failed";
         return false;
     }
-    bool ok = client_.SendRequest(&::openmldb::api::TabletServer_Stub::Query, cntl, &request, response);
+    request.set_accept_compress_type(AcceptCompressType("query"));
+    bool ok = client_.SendRequest(&::openmldb::api::TabletServer_Stub::Query, cntl, &request, response) &&
+              codec::UncompressResponseAttachment(response, &cntl->response_attachment());
 
     if (!ok || response->code() != 0) {
         LOG(WARNING) << "fail to query tablet";
@@ -146,7 +172,10 @@ bool TabletClient::SQLBatchRequestQuery(const std::string& db, const std::string
         return false;
     }
 
-    bool ok = client_.SendRequest(&::openmldb::api::TabletServer_Stub::SQLBatchRequestQuery, cntl, &request, response);
+    request.set_accept_compress_type(AcceptCompressType("batch_request_query"));
+    bool ok = client_.SendRequest(&::openmldb::api::TabletServer_Stub::SQLBatchRequestQuery, cntl, &request,
+                                  response) &&
+              codec::UncompressResponseAttachment(response, &cntl->response_attachment());
     if (!ok || response->code() != ::openmldb::base::kOk) {
         LOG(WARNING) << "fail to query tablet" << response->msg();
         return false;
@@ -154,6 +183,85 @@ bool TabletClient::SQLBatchRequestQuery(const std::string& db, const std::string
     return true;
 }
 
+bool TabletClient::Query(const std::string& db, const std::string& sql, const std::string& row, uint64_t timeout_ms,
+                         bool is_debug, openmldb::RpcCallback<openmldb::api::QueryResponse>* callback) {
+    if (callback == nullptr) {
+        return false;
+    }
+    ::openmldb::api::QueryRequest request;
+    request.set_sql(sql);
+    request.set_db(db);
+    request.set_is_batch(false);
+    request.set_is_debug(is_debug);
+    request.set_row_size(row.size());
+    request.set_row_slices(1);
+    request.set_timeout_ms(timeout_ms);
+    auto& io_buf = callback->GetController()->request_attachment();
+    if (!codec::EncodeRpcRow(reinterpret_cast<const int8_t*>(row.data()), row.size(), &io_buf)) {
+        LOG(WARNING) << "Encode row buffer failed";
+        return false;
+    }
+    callback->GetController()->set_timeout_ms(timeout_ms);
+    // the attachment is uncompressed by the future reading the response
+    request.set_accept_compress_type(AcceptCompressType("query"));
+    return client_.SendRequest(&::openmldb::api::TabletServer_Stub::Query, callback->GetController().get(), &request,
+                               callback->GetResponse().get(), callback);
+}
+
+bool TabletClient::Query(const std::string& db, const std::string& sql,
+                         const std::vector<openmldb::type::DataType>& parameter_types,
+                         const std::string& parameter_row, uint64_t timeout_ms, bool is_debug,
+                         openmldb::RpcCallback<openmldb::api::QueryResponse>* callback) {
+    if (callback == nullptr) {
+        return false;
+    }
+    ::openmldb::api::QueryRequest request;
+    request.set_sql(sql);
+    request.set_db(db);
+    request.set_is_batch(true);
+    request.set_is_debug(is_debug);
+    request.set_parameter_row_size(parameter_row.size());
+    request.set_parameter_row_slices(1);
+    for (auto& type : parameter_types) {
+        request.add_parameter_types(type);
+    }
+    auto& io_buf = callback->GetController()->request_attachment();
+    if (!codec::EncodeRpcRow(reinterpret_cast<const int8_t*>(parameter_row.data()), parameter_row.size(), &io_buf)) {
+        LOG(WARNING) << "Encode parameter buffer failed";
+        return false;
+    }
+    callback->GetController()->set_timeout_ms(timeout_ms);
+    // the attachment is uncompressed by the future reading the response
+    request.set_accept_compress_type(AcceptCompressType("query"));
+    return client_.SendRequest(&::openmldb::api::TabletServer_Stub::Query, callback->GetController().get(), &request,
+                               callback->GetResponse().get(), callback);
+}
+
+bool TabletClient::SQLBatchRequestQuery(const std::string& db, const std::string& sql,
+                                        std::shared_ptr<::openmldb::sdk::SQLRequestRowBatch> row_batch,
+                                        uint64_t timeout_ms, bool is_debug,
+                                        openmldb::RpcCallback<openmldb::api::SQLBatchRequestQueryResponse>* callback) {
+    if (callback == nullptr) {
+        return false;
+    }
+    ::openmldb::api::SQLBatchRequestQueryRequest request;
+    request.set_sql(sql);
+    request.set_db(db);
+    request.set_is_debug(is_debug);
+    for (size_t idx : row_batch->common_column_indices()) {
+        request.add_common_column_indices(idx);
+    }
+    auto& io_buf = callback->GetController()->request_attachment();
+    if (!EncodeRowBatch(row_batch, &request, &io_buf)) {
+        return false;
+    }
+    callback->GetController()->set_timeout_ms(timeout_ms);
+    // the attachment is uncompressed by the future reading the response
+    request.set_accept_compress_type(AcceptCompressType("batch_request_query"));
+    return client_.SendRequest(&::openmldb::api::TabletServer_Stub::SQLBatchRequestQuery,
+                               callback->GetController().get(), &request, callback->GetResponse().get(), callback);
+}
+
 bool TabletClient::CreateTable(const std::string& name, uint32_t tid, uint32_t pid, uint64_t abs_ttl, uint64_t lat_ttl,
                                bool leader, const std::vector<std::string>& endpoints,
                                const ::openmldb::type::TTLType& type, uint32_t seg_cnt, uint64_t term,
@@ -325,6 +433,16 @@ bool TabletClient::Put(uint32_t tid, uint32_t pid, const std::string& pk, uint64
     return Put(tid, pid, pk.c_str(), time, value.c_str(), value.size(), format_version);
 }
 
+bool TabletClient::AsyncPutBatch(const ::openmldb::api::PutBatchRequest& request, uint64_t timeout_ms,
+                                 openmldb::RpcCallback<openmldb::api::PutBatchResponse>* callback) {
+    if (callback == nullptr) {
+        return false;
+    }
+    callback->GetController()->set_timeout_ms(timeout_ms);
+    return client_.SendRequest(&::openmldb::api::TabletServer_Stub::PutBatch, callback->GetController().get(),
+                               &request, callback->GetResponse().get(), callback);
+}
+
 bool TabletClient::MakeSnapshot(uint32_t tid, uint32_t pid, uint64_t offset, std::shared_ptr<TaskInfo> task_info) {
     ::openmldb::api::GeneralRequest request;
     request.set_tid(tid);
@@ -359,6 +477,20 @@ bool TabletClient::FollowOfNoOne(uint32_t tid, uint32_t pid, uint64_t term, uint
     return false;
 }
 
+bool TabletClient::FollowOfNoOne(uint32_t tid, uint32_t pid, uint64_t term,
+                                 openmldb::RpcCallback<openmldb::api::AppendEntriesResponse>* callback) {
+    if (callback == nullptr) {
+        return false;
+    }
+    ::openmldb::api::AppendEntriesRequest request;
+    request.set_tid(tid);
+    request.set_pid(pid);
+    request.set_term(term);
+    callback->GetController()->set_timeout_ms(FLAGS_request_timeout_ms);
+    return client_.SendRequest(&::openmldb::api::TabletServer_Stub::AppendEntries, callback->GetController().get(),
+                               &request, callback->GetResponse().get(), callback);
+}
+
 bool TabletClient::PauseSnapshot(uint32_t tid, uint32_t pid, std::shared_ptr<TaskInfo> task_info) {
     ::openmldb::api::GeneralRequest request;
     request.set_tid(tid);
@@ -595,6 +727,22 @@ bool TabletClient::GetTableStatus(::openmldb::api::GetTableStatusResponse& respo
     return false;
 }
 
+bool TabletClient::GetTableStatus(const ::openmldb::api::GetTableStatusRequest& request,
+                                  ::openmldb::api::GetTableStatusResponse* response) {
+    return client_.SendRequest(&::openmldb::api::TabletServer_Stub::GetTableStatus, &request, response,
+                               FLAGS_request_timeout_ms, 1);
+}
+
+bool TabletClient::GetTableStatus(const ::openmldb::api::GetTableStatusRequest& request,
+                                  openmldb::RpcCallback<openmldb::api::GetTableStatusResponse>* callback) {
+    if (callback == nullptr) {
+        return false;
+    }
+    callback->GetController()->set_timeout_ms(FLAGS_request_timeout_ms);
+    return client_.SendRequest(&::openmldb::api::TabletServer_Stub::GetTableStatus, callback->GetController().get(),
+                               &request, callback->GetResponse().get(), callback);
+}
+
 bool TabletClient::GetTableStatus(uint32_t tid, uint32_t pid, ::openmldb::api::TableStatus& table_status) {
     return GetTableStatus(tid, pid, false, table_status);
 }
@@ -637,16 +785,20 @@ bool TabletClient::GetTableStatus(uint32_t tid, uint32_t pid, bool need_schema,
         request.set_idx_name(idx_name);
     }
     request.set_limit(limit);
+    request.set_attachment_with_ts(true);
     ::openmldb::api::ScanResponse* response = new ::openmldb::api::ScanResponse();
-    bool ok =
-        client_.SendRequest(&::openmldb::api::TabletServer_Stub::Scan, &request, response, FLAGS_request_timeout_ms, 1);
+    butil::IOBuf buf;
+    request.set_accept_compress_type(AcceptCompressType("scan"));
+    bool ok = client_.SendRequestGetAttachment(&::openmldb::api::TabletServer_Stub::Scan, &request, response,
+                                               FLAGS_request_timeout_ms, 1, &buf) &&
+              codec::UncompressResponseAttachment(response, &buf);
     if (response->has_msg()) {
         msg = response->msg();
     }
     if (!ok || response->code() != 0) {
         return NULL;
     }
-    ::openmldb::base::KvIterator* kv_it = new ::openmldb::base::KvIterator(response);
+    ::openmldb::base::KvIterator* kv_it = new ::openmldb::base::KvIterator(response, &buf);
     return kv_it;
 }
 
@@ -670,17 +822,21 @@ bool TabletClient::GetTableStatus(uint32_t tid, uint32_t pid, bool need_schema,
     request.set_pid(pid);
     request.set_limit(limit);
     request.set_atleast(atleast);
+    request.set_attachment_with_ts(true);
     ::openmldb::api::ScanResponse* response = new ::openmldb::api::ScanResponse();
     uint64_t consumed = ::baidu::common::timer::get_micros();
-    bool ok =
-        client_.SendRequest(&::openmldb::api::TabletServer_Stub::Scan, &request, response, FLAGS_request_timeout_ms, 1);
+    butil::IOBuf buf;
+    request.set_accept_compress_type(AcceptCompressType("scan"));
+    bool ok = client_.SendRequestGetAttachment(&::openmldb::api::TabletServer_Stub::Scan, &request, response,
+                                               FLAGS_request_timeout_ms, 1, &buf) &&
+              codec::UncompressResponseAttachment(response, &buf);
     if (response->has_msg()) {
         msg = response->msg();
     }
     if (!ok || response->code() != 0) {
         return NULL;
     }
-    ::openmldb::base::KvIterator* kv_it = new ::openmldb::base::KvIterator(response);
+    ::openmldb::base::KvIterator* kv_it = new ::openmldb::base::KvIterator(response, &buf);
     if (FLAGS_enable_show_tp) {
         consumed = ::baidu::common::timer::get_micros() - consumed;
         percentile_.push_back(consumed);
@@ -710,17 +866,21 @@ bool TabletClient::GetTableSchema(uint32_t tid, uint32_t pid, ::openmldb::api::T
     request.set_et(etime);
     request.set_tid(tid);
     request.set_pid(pid);
+    request.set_attachment_with_ts(true);
     ::openmldb::api::ScanResponse* response = new ::openmldb::api::ScanResponse();
     uint64_t consumed = ::baidu::common::timer::get_micros();
-    bool ok =
-        client_.SendRequest(&::openmldb::api::TabletServer_Stub::Scan, &request, response, FLAGS_request_timeout_ms, 1);
+    butil::IOBuf buf;
+    request.set_accept_compress_type(AcceptCompressType("scan"));
+    bool ok = client_.SendRequestGetAttachment(&::openmldb::api::TabletServer_Stub::Scan, &request, response,
+                                               FLAGS_request_timeout_ms, 1, &buf) &&
+              codec::UncompressResponseAttachment(response, &buf);
     if (response->has_msg()) {
         msg = response->msg();
     }
     if (!ok || response->code() != 0) {
         return NULL;
     }
-    ::openmldb::base::KvIterator* kv_it = new ::openmldb::base::KvIterator(response);
+    ::openmldb::base::KvIterator* kv_it = new ::openmldb::base::KvIterator(response, &buf);
     if (showm) {
         while (kv_it->Valid()) {
             kv_it->Next();
@@ -864,6 +1024,17 @@ bool TabletClient::GetTableFollower(uint32_t tid, uint32_t pid, uint64_t& offset
     return true;
 }
 
+bool TabletClient::GetHotKeys(uint32_t tid, uint32_t pid, uint32_t limit,
+                              ::openmldb::api::GetHotKeysResponse* response) {
+    ::openmldb::api::GetHotKeysRequest request;
+    request.set_tid(tid);
+    request.set_pid(pid);
+    request.set_limit(limit);
+    bool ok = client_.SendRequest(&::openmldb::api::TabletServer_Stub::GetHotKeys, &request, response,
+                                  FLAGS_request_timeout_ms, 1);
+    return ok && response->code() == 0;
+}
+
 void TabletClient::ShowTp() {
     if (!FLAGS_enable_show_tp) {
         return;
@@ -959,6 +1130,47 @@ bool TabletClient::Get(uint32_t tid, uint32_t pid, const std::string& pk, uint64
     return true;
 }
 
+bool TabletClient::BatchGet(const ::openmldb::api::BatchGetRequest& request,
+                            ::openmldb::api::BatchGetResponse* response,
+                            std::vector<std::pair<uint64_t, std::string>>* values) {
+    if (response == nullptr || values == nullptr) {
+        return false;
+    }
+    butil::IOBuf buf;
+    bool ok = client_.SendRequestGetAttachment(&::openmldb::api::TabletServer_Stub::BatchGet, &request, response,
+                                               FLAGS_request_timeout_ms, 1, &buf);
+    if (!ok || response->code() != 0) {
+        return false;
+    }
+    if (response->codes_size() != request.keys_size() || response->buf_size() != buf.size()) {
+        PDLOG(WARNING, "invalid batch get response. tid %u, pid %u", request.tid(), request.pid());
+        return false;
+    }
+    values->clear();
+    values->resize(request.keys_size());
+    for (int i = 0; i < response->codes_size(); i++) {
+        if (response->codes(i) != 0) {
+            continue;
+        }
+        uint32_t total_size = 0;
+        uint64_t ts = 0;
+        if (buf.cutn(&total_size, 4) != 4) {
+            return false;
+        }
+        memrev32ifbe(&total_size);
+        if (total_size < 8 || buf.cutn(&ts, 8) != 8) {
+            return false;
+        }
+        memrev64ifbe(&ts);
+        std::pair<uint64_t, std::string>& value = (*values)[i];
+        value.first = ts;
+        if (buf.cutn(&value.second, total_size - 8) != total_size - 8) {
+            return false;
+        }
+    }
+    return true;
+}
+
 bool TabletClient::Delete(uint32_t tid, uint32_t pid, const std::string& pk, const std::string& idx_name,
                           std::string& msg) {
     ::openmldb::api::DeleteRequest request;
@@ -1018,6 +1230,15 @@ bool TabletClient::DeleteBinlog(uint32_t tid, uint32_t pid) {
 ::openmldb::base::KvIterator* TabletClient::Traverse(uint32_t tid, uint32_t pid, const std::string& idx_name,
                                                      const std::string& pk, uint64_t ts, uint32_t limit,
                                                      uint32_t& count) {
+    TraversePos pos;
+    pos.pk = pk;
+    pos.ts = ts;
+    return Traverse(tid, pid, idx_name, limit, false, &pos, count);
+}
+
+::openmldb::base::KvIterator* TabletClient::Traverse(uint32_t tid, uint32_t pid, const std::string& idx_name,
+                                                     uint32_t limit, bool use_cursor, TraversePos* pos,
+                                                     uint32_t& count) {
     ::openmldb::api::TraverseRequest request;
     ::openmldb::api::TraverseResponse* response = new ::openmldb::api::TraverseResponse();
     request.set_tid(tid);
@@ -1026,16 +1247,27 @@ bool TabletClient::DeleteBinlog(uint32_t tid, uint32_t pid) {
     if (!idx_name.empty()) {
         request.set_idx_name(idx_name);
     }
-    if (!pk.empty()) {
-        request.set_pk(pk);
-        request.set_ts(ts);
+    if (!pos->pk.empty()) {
+        request.set_pk(pos->pk);
+        request.set_ts(pos->ts);
     }
-    bool ok = client_.SendRequest(&::openmldb::api::TabletServer_Stub::Traverse, &request, response,
-                                  FLAGS_request_timeout_ms, FLAGS_request_max_retry);
+    if (use_cursor) {
+        request.set_use_cursor(true);
+        request.set_cursor_id(pos->cursor_id);
+    }
+    request.set_use_attachment(true);
+    butil::IOBuf buf;
+    bool ok = client_.SendRequestGetAttachment(&::openmldb::api::TabletServer_Stub::Traverse, &request, response,
+                                               FLAGS_request_timeout_ms, FLAGS_request_max_retry, &buf);
     if (!ok || response->code() != 0) {
+        delete response;
         return NULL;
     }
-    ::openmldb::base::KvIterator* kv_it = new ::openmldb::base::KvIterator(response);
+    pos->pk = response->pk();
+    pos->ts = response->ts();
+    pos->cursor_id = response->cursor_id();
+    pos->is_finish = response->is_finish();
+    ::openmldb::base::KvIterator* kv_it = new ::openmldb::base::KvIterator(response, &buf);
     count = response->count();
     return kv_it;
 }
@@ -1277,13 +1509,16 @@ bool TabletClient::CallProcedure(const std::string& db, const std::string& sp_na
     request.set_is_procedure(true);
     request.set_row_size(row.size());
     request.set_row_slices(1);
+    request.set_timeout_ms(timeout_ms);
     cntl->set_timeout_ms(timeout_ms);
     auto& io_buf = cntl->request_attachment();
     if (!codec::EncodeRpcRow(reinterpret_cast<const int8_t*>(row.data()), row.size(), &io_buf)) {
         LOG(WARNING) << "encode row buf failed";
         return false;
     }
-    bool ok = client_.SendRequest(&::openmldb::api::TabletServer_Stub::Query, cntl, &request, response);
+    request.set_accept_compress_type(AcceptCompressType("query"));
+    bool ok = client_.SendRequest(&::openmldb::api::TabletServer_Stub::Query, cntl, &request, response) &&
+              codec::UncompressResponseAttachment(response, &cntl->response_attachment());
     if (!ok || response->code() != 0) {
         LOG(WARNING) << "fail to query tablet";
         return false;
@@ -1299,6 +1534,15 @@ bool TabletClient::SubQuery(const ::openmldb::api::QueryRequest& request,
     return client_.SendRequest(&::openmldb::api::TabletServer_Stub::SubQuery, callback->GetController().get(), &request,
                                callback->GetResponse().get(), callback);
 }
+
+bool TabletClient::SubQueryBatch(const ::openmldb::api::SubQueryBatchRequest& request,
+                                 openmldb::RpcCallback<openmldb::api::SubQueryBatchResponse>* callback) {
+    if (callback == nullptr) {
+        return false;
+    }
+    return client_.SendRequest(&::openmldb::api::TabletServer_Stub::SubQueryBatch, callback->GetController().get(),
+                               &request, callback->GetResponse().get(), callback);
+}
 bool TabletClient::SubBatchRequestQuery(const ::openmldb::api::SQLBatchRequestQueryRequest& request,
                                         openmldb::RpcCallback<openmldb::api::SQLBatchRequestQueryResponse>* callback) {
     if (callback == nullptr) {
@@ -1328,7 +1572,10 @@ bool TabletClient::CallSQLBatchRequestProcedure(const std::string& db, const std
         return false;
     }
 
-    bool ok = client_.SendRequest(&::openmldb::api::TabletServer_Stub::SQLBatchRequestQuery, cntl, &request, response);
+    request.set_accept_compress_type(AcceptCompressType("batch_request_query"));
+    bool ok = client_.SendRequest(&::openmldb::api::TabletServer_Stub::SQLBatchRequestQuery, cntl, &request,
+                                  response) &&
+              codec::UncompressResponseAttachment(response, &cntl->response_attachment());
     if (!ok || response->code() != ::openmldb::base::kOk) {
         LOG(WARNING) << "fail to query tablet";
         return false;
@@ -1363,12 +1610,15 @@ bool TabletClient::CallProcedure(const std::string& db, const std::string& sp_na
     request.set_is_procedure(true);
     request.set_row_size(row.size());
     request.set_row_slices(1);
+    request.set_timeout_ms(timeout_ms);
     auto& io_buf = callback->GetController()->request_attachment();
     if (!codec::EncodeRpcRow(reinterpret_cast<const int8_t*>(row.data()), row.size(), &io_buf)) {
         LOG(WARNING) << "Encode row buf failed";
         return false;
     }
     callback->GetController()->set_timeout_ms(timeout_ms);
+    // the attachment is uncompressed by the future reading the response
+    request.set_accept_compress_type(AcceptCompressType("query"));
     return client_.SendRequest(&::openmldb::api::TabletServer_Stub::Query, callback->GetController().get(), &request,
                                callback->GetResponse().get(), callback);
 }
@@ -1391,6 +1641,8 @@ bool TabletClient::CallSQLBatchRequestProcedure(
     }
 
     callback->GetController()->set_timeout_ms(timeout_ms);
+    // the attachment is uncompressed by the future reading the response
+    request.set_accept_compress_type(AcceptCompressType("batch_request_query"));
     return client_.SendRequest(&::openmldb::api::TabletServer_Stub::SQLBatchRequestQuery,
                                callback->GetController().get(), &request, callback->GetResponse().get(), callback);
 }
@@ -45,6 +45,15 @@ namespace client {
 using ::openmldb::api::TaskInfo;
 const uint32_t INVALID_REMOTE_TID = UINT32_MAX;
 
+// the position a page of a traverse stops at, the next page goes on from it
+struct TraversePos {
+    std::string pk;
+    uint64_t ts = 0;
+    // the iterator kept by the tablet for the next page, 0 if there is none
+    uint64_t cursor_id = 0;
+    bool is_finish = false;
+};
+
 class TabletClient : public Client {
  public:
     TabletClient(const std::string& endpoint, const std::string& real_endpoint);
@@ -55,6 +64,9 @@ class TabletClient : public Client {
 
     int Init() override;
 
+    // see RpcClient::SetConnectionOptions, it must be set before Init
+    void SetConnectionOptions(const std::string& connection_type, const std::string& connection_group);
+
     bool CreateTable(const std::string& name, uint32_t tid, uint32_t pid, uint64_t abs_ttl, uint64_t lat_ttl,
                      bool leader, const std::vector<std::string>& endpoints, const ::openmldb::type::TTLType& type,
                      uint32_t seg_cnt, uint64_t term, const ::openmldb::type::CompressType compress_type);
@@ -67,7 +79,8 @@ class TabletClient : public Client {
 
     bool Query(const std::string& db, const std::string& sql,
                const std::vector<openmldb::type::DataType>& parameter_types, const std::string& parameter_row,
-               brpc::Controller* cntl, ::openmldb::api::QueryResponse* response, const bool is_debug = false);
+               brpc::Controller* cntl, ::openmldb::api::QueryResponse* response, const bool is_debug = false,
+               uint32_t stream_chunk_size = 0);
 
     bool Query(const std::string& db, const std::string& sql, const std::string& row, brpc::Controller* cntl,
                ::openmldb::api::QueryResponse* response, const bool is_debug = false);
@@ -76,6 +89,19 @@ class TabletClient : public Client {
                               std::shared_ptr<::openmldb::sdk::SQLRequestRowBatch>, brpc::Controller* cntl,
                               ::openmldb::api::SQLBatchRequestQueryResponse* response, const bool is_debug = false);
 
+    // the async variants of the queries, the response is set to the callback
+    bool Query(const std::string& db, const std::string& sql, const std::string& row, uint64_t timeout_ms,
+               bool is_debug, openmldb::RpcCallback<openmldb::api::QueryResponse>* callback);
+
+    bool Query(const std::string& db, const std::string& sql,
+               const std::vector<openmldb::type::DataType>& parameter_types, const std::string& parameter_row,
+               uint64_t timeout_ms, bool is_debug, openmldb::RpcCallback<openmldb::api::QueryResponse>* callback);
+
+    bool SQLBatchRequestQuery(const std::string& db, const std::string& sql,
+                              std::shared_ptr<::openmldb::sdk::SQLRequestRowBatch> row_batch, uint64_t timeout_ms,
+                              bool is_debug,
+                              openmldb::RpcCallback<openmldb::api::SQLBatchRequestQueryResponse>* callback);
+
     bool Put(uint32_t tid, uint32_t pid, const std::string& pk, uint64_t time, const std::string& value,
              uint32_t format_version = 0);
 
@@ -94,6 +120,10 @@ class TabletClient : public Client {
     bool Put(uint32_t tid, uint32_t pid, const std::vector<std::pair<std::string, uint32_t>>& dimensions,
              const std::vector<uint64_t>& ts_dimensions, const std::string& value, uint32_t format_version);
 
+    // put the rows of a partition in one request, the callback is run once the response is back
+    bool AsyncPutBatch(const ::openmldb::api::PutBatchRequest& request, uint64_t timeout_ms,
+                       openmldb::RpcCallback<openmldb::api::PutBatchResponse>* callback);
+
     bool Get(uint32_t tid, uint32_t pid, const std::string& pk, uint64_t time, std::string& value,  // NOLINT
              uint64_t& ts,                                                                          // NOLINT
              std::string& msg);                        ;                                             // NOLINT
@@ -106,6 +136,11 @@ class TabletClient : public Client {
     bool Get(uint32_t tid, uint32_t pid, const std::string& pk, uint64_t time, const std::string& idx_name,
              const std::string& ts_name, std::string& value, uint64_t& ts, std::string& msg);  // NOLINT
 
+    // get all the keys of request in one rpc. values are in the order of the keys
+    // and the code of each key is in response->codes(), the value of a key not found is empty
+    bool BatchGet(const ::openmldb::api::BatchGetRequest& request, ::openmldb::api::BatchGetResponse* response,
+                  std::vector<std::pair<uint64_t, std::string>>* values);
+
     bool Delete(uint32_t tid, uint32_t pid, const std::string& pk, const std::string& idx_name,
                 std::string& msg);  // NOLINT
 
@@ -195,6 +230,12 @@ class TabletClient : public Client {
                      ::openmldb::api::Manifest& manifest);  // NOLINT
 
     bool GetTableStatus(::openmldb::api::GetTableStatusResponse& response);  // NOLINT
+    bool GetTableStatus(const ::openmldb::api::GetTableStatusRequest& request,
+                        ::openmldb::api::GetTableStatusResponse* response);
+    // the status of all the partitions in the tablet, only the ones changed after the
+    // status_version of the request are in the response if the status_epoch matches
+    bool GetTableStatus(const ::openmldb::api::GetTableStatusRequest& request,
+                        openmldb::RpcCallback<openmldb::api::GetTableStatusResponse>* callback);
     bool GetTableStatus(uint32_t tid, uint32_t pid,
                         ::openmldb::api::TableStatus& table_status);  // NOLINT
     bool GetTableStatus(uint32_t tid, uint32_t pid, bool need_schema,
@@ -202,6 +243,12 @@ class TabletClient : public Client {
 
     bool FollowOfNoOne(uint32_t tid, uint32_t pid, uint64_t term,
                        uint64_t& offset);  // NOLINT
+    bool FollowOfNoOne(uint32_t tid, uint32_t pid, uint64_t term,
+                       openmldb::RpcCallback<openmldb::api::AppendEntriesResponse>* callback);
+
+    // the hot keys of every index of the table, at most limit keys of an index if limit is not 0
+    bool GetHotKeys(uint32_t tid, uint32_t pid, uint32_t limit,
+                    ::openmldb::api::GetHotKeysResponse* response);
 
     bool GetTableFollower(uint32_t tid, uint32_t pid,
                           uint64_t& offset,                           // NOLINT
@@ -218,6 +265,12 @@ class TabletClient : public Client {
                                            const std::string& pk, uint64_t ts, uint32_t limit,
                                            uint32_t& count);  // NOLINT
 
+    // get the page from pos and update pos to the end of it. With use_cursor the tablet keeps the iterator for
+    // the next page, so it goes on without seeking the pk again
+    ::openmldb::base::KvIterator* Traverse(uint32_t tid, uint32_t pid, const std::string& idx_name, uint32_t limit,
+                                           bool use_cursor, TraversePos* pos,
+                                           uint32_t& count);  // NOLINT
+
     void ShowTp();
 
     bool SetMode(bool mode);
@@ -265,6 +318,9 @@ class TabletClient : public Client {
     bool SubQuery(const ::openmldb::api::QueryRequest& request,
                   openmldb::RpcCallback<openmldb::api::QueryResponse>* callback);
 
+    bool SubQueryBatch(const ::openmldb::api::SubQueryBatchRequest& request,
+                       openmldb::RpcCallback<openmldb::api::SubQueryBatchResponse>* callback);
+
     bool SubBatchRequestQuery(const ::openmldb::api::SQLBatchRequestQueryRequest& request,
                               openmldb::RpcCallback<openmldb::api::SQLBatchRequestQueryResponse>* callback);
     bool CallProcedure(const std::string& db, const std::string& sp_name, const std::string& row, uint64_t timeout_ms,
@@ -58,6 +58,7 @@
 #include "proto/name_server.pb.h"
 #include "proto/tablet.pb.h"
 #include "proto/type.pb.h"
+#include "storage/mem_estimator.h"
 #include "version.h"  // NOLINT
 #include "vm/engine.h"
 
@@ -84,12 +85,17 @@ DEFINE_string(log_level, "debug", "Set the log level, eg: debug or info");
 DECLARE_uint32(latest_ttl_max);
 DECLARE_uint32(absolute_ttl_max);
 DECLARE_uint32(skiplist_max_height);
+DECLARE_uint32(key_entry_grow_cnt);
+DECLARE_uint32(absolute_default_skiplist_height);
+DECLARE_uint32(latest_default_skiplist_height);
 DECLARE_uint32(preview_limit_max_num);
 DECLARE_uint32(preview_default_limit);
 DECLARE_uint32(max_col_display_length);
 DECLARE_bool(version);
 DECLARE_bool(use_name);
 DECLARE_string(data_dir);
+DECLARE_uint32(api_server_procedure_batch_window_us);
+DECLARE_uint32(api_server_max_procedure_batch_size);
 
 const std::string OPENMLDB_VERSION = std::to_string(OPENMLDB_VERSION_MAJOR) + "." +  // NOLINT
                                  std::to_string(OPENMLDB_VERSION_MINOR) + "." +
@@ -1122,6 +1128,88 @@ void HandleNSClientShowSchema(const std::vector<std::string>& parts, ::openmldb:
     ::openmldb::cmd::PrintColumnKey(tables[0].column_key());
 }
 
+void HandleNSClientEstimateMem(const std::vector<std::string>& parts, ::openmldb::client::NsClient* client) {
+    if (parts.size() < 4) {
+        std::cout << "estimatemem format error. eg: estimatemem table_name key_cnt put_qps [write_seconds] "
+                     "[string_size]"
+                  << std::endl;
+        return;
+    }
+    std::vector<::openmldb::nameserver::TableInfo> tables;
+    std::string msg;
+    if (!client->ShowTable(parts[1], tables, msg)) {
+        std::cout << "failed to estimatemem. error msg: " << msg << std::endl;
+        return;
+    }
+    if (tables.empty()) {
+        printf("table %s is not exist\n", parts[1].c_str());
+        return;
+    }
+    const auto& table = tables[0];
+    ::openmldb::storage::MemEstimateOption option;
+    uint32_t string_size = 16;
+    try {
+        option.key_cnt = boost::lexical_cast<uint64_t>(parts[2]);
+        option.put_qps = boost::lexical_cast<double>(parts[3]);
+        if (parts.size() > 4) {
+            option.write_seconds = boost::lexical_cast<uint64_t>(parts[4]);
+        }
+        if (parts.size() > 5) {
+            string_size = boost::lexical_cast<uint32_t>(parts[5]);
+        }
+    } catch (boost::bad_lexical_cast& e) {
+        std::cout << "failed to estimatemem. bad number format" << std::endl;
+        return;
+    }
+    // the keys and the rows are spread over the partitions evenly
+    uint32_t partition_num = std::max<uint32_t>(table.partition_num(), 1);
+    option.key_cnt = std::max<uint64_t>(option.key_cnt / partition_num, 1);
+    option.put_qps /= partition_num;
+    option.key_size = string_size;
+    ::openmldb::codec::Schema schema = table.column_desc();
+    schema.MergeFrom(table.added_column_desc());
+    uint32_t string_cnt = 0;
+    for (const auto& column : schema) {
+        if (column.data_type() == ::openmldb::type::kVarchar || column.data_type() == ::openmldb::type::kString) {
+            string_cnt++;
+        }
+    }
+    ::openmldb::codec::RowBuilder builder(schema);
+    option.row_size = builder.CalTotalLength(string_cnt * string_size);
+    option.key_entry_grow_cnt = FLAGS_key_entry_grow_cnt;
+    if (table.key_entry_max_height() > 0) {
+        option.abs_max_height = table.key_entry_max_height();
+        option.lat_max_height = table.key_entry_max_height();
+    } else {
+        option.abs_max_height = FLAGS_absolute_default_skiplist_height;
+        option.lat_max_height = FLAGS_latest_default_skiplist_height;
+    }
+    option.pk_max_height = FLAGS_skiplist_max_height;
+    ::openmldb::storage::MemEstimate estimate;
+    if (!::openmldb::storage::EstimateMemory(table.column_key(), option, &estimate, &msg)) {
+        std::cout << "failed to estimatemem. error msg: " << msg << std::endl;
+        return;
+    }
+    uint64_t replica_cnt = static_cast<uint64_t>(partition_num) * std::max<uint32_t>(table.replica_num(), 1);
+    std::vector<std::string> row = {"part", "partition", "total"};
+    ::baidu::common::TPrinter tp(row.size(), FLAGS_max_col_display_length);
+    tp.AddRow(row);
+    std::vector<std::pair<std::string, uint64_t>> parts_byte_size = {
+        {"row", estimate.record_byte_size},
+        {"pk_node", estimate.pk_node_byte_size},
+        {"key_entry", estimate.key_entry_byte_size},
+        {"ts_node", estimate.ts_node_byte_size},
+        {"sum", estimate.GetTotalByteSize()}};
+    for (const auto& kv : parts_byte_size) {
+        std::vector<std::string> part_row = {kv.first, ::openmldb::base::HumanReadableString(kv.second),
+                                             ::openmldb::base::HumanReadableString(kv.second * replica_cnt)};
+        tp.AddRow(part_row);
+    }
+    tp.Print(true);
+    printf("%lu rows of %u bytes in a partition, %lu partition replicas. the allocator overhead is not included\n",
+           estimate.row_cnt, option.row_size, replica_cnt);
+}
+
 void HandleNSDelete(const std::vector<std::string>& parts, ::openmldb::client::NsClient* client) {
     std::vector<std::string> vec;
     ::openmldb::base::SplitString(parts[1], "=", vec);
@@ -2506,6 +2594,7 @@ void HandleNSClientHelp(const std::vector<std::string>& parts, ::openmldb::clien
         printf("delete - delete pk\n");
         printf("delreplica - delete replica from leader\n");
         printf("drop - drop table\n");
+        printf("estimatemem - estimate the memory of table\n");
         printf("exit - exit client\n");
         printf("get - get only one record\n");
         printf("gettablepartition - get partition info\n");
@@ -2619,6 +2708,11 @@ void HandleNSClientHelp(const std::vector<std::string>& parts, ::openmldb::clien
             printf("desc: show nameserver info\n");
             printf("usage: showns\n");
             printf("ex: showns\n");
+        } else if (parts[1] == "estimatemem") {
+            printf("desc: estimate the memory of the table with the key count and the write rate\n");
+            printf("usage: estimatemem table_name key_cnt put_qps [write_seconds] [string_size]\n");
+            printf("ex: estimatemem table1 1000000 5000\n");
+            printf("ex: estimatemem table1 1000000 5000 86400 32\n");
         } else if (parts[1] == "showschema") {
             printf("desc: show schema info\n");
             printf("usage: showschema table_name\n");
@@ -3443,6 +3537,7 @@ void HandleClientHelp(const std::vector<std::string> parts, ::openmldb::client::
         printf("sendsnapshot - send snapshot to another endpoint\n");
         printf("setexpire - enable or disable ttl\n");
         printf("showschema - show schema\n");
+        printf("showmem - show the memory of the indexes\n");
         printf("setttl - set ttl for partition\n");
     } else if (parts.size() == 2) {
         if (parts[1] == "create") {
@@ -3568,6 +3663,11 @@ void HandleClientHelp(const std::vector<std::string> parts, ::openmldb::client::
             printf("usage: gettablestatus [tid pid]\n");
             printf("ex: gettablestatus\n");
             printf("ex: gettablestatus 1 0\n");
+        } else if (parts[1] == "showmem") {
+            printf("desc: show the bytes of the rows and the parts of the indexes, and the allocator\n");
+            printf("usage: showmem [tid pid]\n");
+            printf("ex: showmem\n");
+            printf("ex: showmem 1 0\n");
         } else if (parts[1] == "getfollower") {
             printf("desc: get table follower\n");
             printf("usage: getfollower tid pid\n");
@@ -3631,6 +3731,67 @@ void HandleClientGetTableStatus(const std::vector<std::string> parts, ::openmldb
     ::openmldb::cmd::PrintTableStatus(status_vec);
 }
 
+void HandleClientShowMem(const std::vector<std::string> parts, ::openmldb::client::TabletClient* client) {
+    ::openmldb::api::GetTableStatusRequest request;
+    request.set_need_mem_status(true);
+    if (parts.size() == 3) {
+        try {
+            request.set_tid(boost::lexical_cast<uint32_t>(parts[1]));
+            request.set_pid(boost::lexical_cast<uint32_t>(parts[2]));
+        } catch (boost::bad_lexical_cast& e) {
+            std::cout << "Bad showmem format" << std::endl;
+            return;
+        }
+    } else if (parts.size() != 1) {
+        std::cout << "Bad showmem format" << std::endl;
+        return;
+    }
+    ::openmldb::api::GetTableStatusResponse response;
+    if (!client->GetTableStatus(request, &response)) {
+        std::cout << "showmem failed" << std::endl;
+        return;
+    }
+    std::vector<std::string> row = {"tid",     "pid",       "index",   "row",      "row_pool",
+                                    "pk_node", "key_entry", "ts_node", "pk_index", "pk_filter"};
+    ::baidu::common::TPrinter tp(row.size(), FLAGS_max_col_display_length);
+    tp.AddRow(row);
+    uint64_t table_byte_size = 0;
+    for (const auto& status : response.all_table_status()) {
+        table_byte_size += std::max(status.record_byte_size(), status.data_block_pool_byte_size());
+        for (int i = 0; i < status.idx_mem_status_size(); i++) {
+            const auto& idx_status = status.idx_mem_status(i);
+            // the rows are shared by the indexes, so they are shown with the first one
+            std::vector<std::string> idx_row = {
+                std::to_string(status.tid()),
+                std::to_string(status.pid()),
+                idx_status.idx_name(),
+                i == 0 ? ::openmldb::base::HumanReadableString(status.record_byte_size()) : "-",
+                i == 0 ? ::openmldb::base::HumanReadableString(status.data_block_pool_byte_size()) : "-",
+                ::openmldb::base::HumanReadableString(idx_status.pk_node_byte_size()),
+                ::openmldb::base::HumanReadableString(idx_status.key_entry_byte_size()),
+                ::openmldb::base::HumanReadableString(idx_status.ts_node_byte_size()),
+                ::openmldb::base::HumanReadableString(idx_status.pk_index_byte_size()),
+                ::openmldb::base::HumanReadableString(idx_status.pk_filter_byte_size())};
+            tp.AddRow(idx_row);
+            table_byte_size += idx_status.pk_node_byte_size() + idx_status.key_entry_byte_size() +
+                               idx_status.ts_node_byte_size() + idx_status.pk_index_byte_size() +
+                               idx_status.pk_filter_byte_size();
+        }
+    }
+    tp.Print(true);
+    if (response.has_heap_byte_size()) {
+        uint64_t allocated = response.allocated_byte_size();
+        uint64_t heap = response.heap_byte_size();
+        printf("tables %s, allocated %s, heap %s, the others allocated %s, free in the allocator %s\n",
+               ::openmldb::base::HumanReadableString(table_byte_size).c_str(),
+               ::openmldb::base::HumanReadableString(allocated).c_str(),
+               ::openmldb::base::HumanReadableString(heap).c_str(),
+               ::openmldb::base::HumanReadableString(allocated > table_byte_size ? allocated - table_byte_size : 0)
+                   .c_str(),
+               ::openmldb::base::HumanReadableString(heap > allocated ? heap - allocated : 0).c_str());
+    }
+}
+
 void HandleClientMakeSnapshot(const std::vector<std::string> parts, ::openmldb::client::TabletClient* client) {
     if (parts.size() < 3) {
         std::cout << "Bad MakeSnapshot format" << std::endl;
@@ -4610,6 +4771,8 @@ void StartClient() {
             HandleClientChangeRole(parts, &client);
         } else if (parts[0] == "gettablestatus") {
             HandleClientGetTableStatus(parts, &client);
+        } else if (parts[0] == "showmem") {
+            HandleClientShowMem(parts, &client);
         } else if (parts[0] == "setexpire") {
             HandleClientSetExpire(parts, &client);
         } else if (parts[0] == "connectzk") {
@@ -4777,6 +4940,8 @@ void StartNsClient() {
             HandleNSClientShowTable(parts, &client);
         } else if (parts[0] == "showschema") {
             HandleNSClientShowSchema(parts, &client);
+        } else if (parts[0] == "estimatemem") {
+            HandleNSClientEstimateMem(parts, &client);
         } else if (parts[0] == "confset") {
             HandleNSClientConfSet(parts, &client);
         } else if (parts[0] == "confget") {
@@ -4860,7 +5025,10 @@ void StartAPIServer() {
         GetRealEndpoint(&real_endpoint);
     }
 
-    auto api_service = std::make_unique<::openmldb::apiserver::APIServerImpl>();
+    ::openmldb::sdk::SQLRouterOptions router_options;
+    router_options.procedure_batch_window_us = FLAGS_api_server_procedure_batch_window_us;
+    router_options.max_procedure_batch_size = FLAGS_api_server_max_procedure_batch_size;
+    auto api_service = std::make_unique<::openmldb::apiserver::APIServerImpl>(router_options);
     ::openmldb::sdk::ClusterOptions cluster_options;
     cluster_options.zk_cluster = FLAGS_zk_cluster;
     cluster_options.zk_path = FLAGS_zk_root_path;
@@ -0,0 +1,183 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "codec/batch_row_builder.h"
+
+#include <string.h>
+
+namespace openmldb {
+namespace codec {
+
+static inline void SetStrAddr(int8_t* ptr, uint8_t addr_length, uint32_t addr) {
+    if (addr_length == 1) {
+        *(reinterpret_cast<uint8_t*>(ptr)) = (uint8_t)addr;
+    } else if (addr_length == 2) {
+        *(reinterpret_cast<uint16_t*>(ptr)) = (uint16_t)addr;
+    } else if (addr_length == 3) {
+        *(reinterpret_cast<uint8_t*>(ptr)) = addr >> 16;
+        *(reinterpret_cast<uint8_t*>(ptr + 1)) = (addr & 0xFF00) >> 8;
+        *(reinterpret_cast<uint8_t*>(ptr + 2)) = addr & 0x00FF;
+    } else {
+        *(reinterpret_cast<uint32_t*>(ptr)) = addr;
+    }
+}
+
+static inline bool IsStringType(::openmldb::type::DataType type) {
+    return type == ::openmldb::type::kVarchar || type == ::openmldb::type::kString;
+}
+
+BatchRowBuilder::BatchRowBuilder(const Schema& schema)
+    : schema_(schema),
+      fields_(),
+      bitmap_size_((schema.size() + 7) / 8),
+      str_field_start_offset_(HEADER_LENGTH + bitmap_size_),
+      str_field_cnt_(0),
+      schema_version_(1) {
+    for (const auto& column : schema_) {
+        ::openmldb::type::DataType type = column.data_type();
+        if (IsStringType(type)) {
+            fields_.push_back({type, str_field_cnt_++, 0, column.not_null()});
+        } else {
+            uint32_t size = GetFixedTypeSize(type);
+            fields_.push_back({type, str_field_start_offset_, size, column.not_null()});
+            str_field_start_offset_ += size;
+        }
+    }
+}
+
+bool BatchRowBuilder::CheckColumns(const std::vector<ColumnBuffer>& columns, uint32_t row_cnt,
+                                   std::string* msg) const {
+    if (columns.size() != fields_.size()) {
+        *msg = "column count mismatch, expect " + std::to_string(fields_.size()) + " but " +
+               std::to_string(columns.size());
+        return false;
+    }
+    for (uint32_t idx = 0; idx < fields_.size(); idx++) {
+        const Field& field = fields_[idx];
+        const ColumnBuffer& column = columns[idx];
+        const std::string& name = schema_.Get(idx).name();
+        if (!IsStringType(field.type) && field.size == 0) {
+            *msg = "type of column " + name + " is not supported";
+            return false;
+        }
+        bool has_buffer = IsStringType(field.type) ? (column.offsets != nullptr && column.data != nullptr)
+                                                   : column.values != nullptr;
+        for (uint32_t i = 0; i < row_cnt; i++) {
+            if (column.IsNull(i)) {
+                if (field.not_null) {
+                    *msg = "column " + name + " can not be null";
+                    return false;
+                }
+            } else if (!has_buffer) {
+                *msg = "column " + name + " has no values";
+                return false;
+            }
+            if (column.repeated) {
+                break;
+            }
+        }
+    }
+    return true;
+}
+
+bool BatchRowBuilder::Build(const std::vector<ColumnBuffer>& columns, uint32_t row_cnt,
+                            std::vector<std::string>* rows, std::string* msg) {
+    if (rows == nullptr || msg == nullptr || schema_.size() == 0) {
+        return false;
+    }
+    if (!CheckColumns(columns, row_cnt, msg)) {
+        return false;
+    }
+    std::vector<uint32_t> str_columns;
+    for (uint32_t idx = 0; idx < fields_.size(); idx++) {
+        if (IsStringType(fields_[idx].type)) {
+            str_columns.push_back(idx);
+        }
+    }
+    rows->reserve(rows->size() + row_cnt);
+    for (uint32_t i = 0; i < row_cnt; i++) {
+        uint64_t str_length = 0;
+        for (uint32_t idx : str_columns) {
+            const ColumnBuffer& column = columns[idx];
+            if (!column.IsNull(i)) {
+                uint32_t pos = column.Index(i);
+                str_length += column.offsets[pos + 1] - column.offsets[pos];
+            }
+        }
+        // the same size as RowBuilder::CalTotalLength
+        uint64_t total_length = str_field_start_offset_ + str_length;
+        uint8_t addr_length = 0;
+        for (uint64_t limit : {static_cast<uint64_t>(UINT8_MAX), static_cast<uint64_t>(UINT16_MAX),
+                               static_cast<uint64_t>(UINT24_MAX), static_cast<uint64_t>(UINT32_MAX)}) {
+            addr_length++;
+            if (total_length + str_field_cnt_ * addr_length <= limit) {
+                break;
+            }
+        }
+        uint64_t size = total_length + str_field_cnt_ * addr_length;
+        if (size > UINT32_MAX) {
+            *msg = "row " + std::to_string(i) + " is too large";
+            return false;
+        }
+        rows->emplace_back(size, '\0');
+        int8_t* buf = reinterpret_cast<int8_t*>(&rows->back()[0]);
+        *(buf) = 1;                    // FVersion
+        *(buf + 1) = schema_version_;  // SVersion
+        *(reinterpret_cast<uint32_t*>(buf + VERSION_LENGTH)) = size;
+        uint8_t* bitmap = reinterpret_cast<uint8_t*>(buf + HEADER_LENGTH);
+        memset(bitmap, 0xFF, bitmap_size_);
+        uint32_t str_offset = str_field_start_offset_ + addr_length * str_field_cnt_;
+        for (uint32_t idx = 0; idx < fields_.size(); idx++) {
+            const Field& field = fields_[idx];
+            const ColumnBuffer& column = columns[idx];
+            bool is_null = column.IsNull(i);
+            if (!is_null) {
+                bitmap[idx >> 3] &= ~(1 << (idx & 0x07));
+            }
+            uint32_t pos = column.Index(i);
+            if (!IsStringType(field.type)) {
+                if (is_null) {
+                    continue;
+                }
+                const char* value = reinterpret_cast<const char*>(column.values) + pos * field.size;
+                if (field.type == ::openmldb::type::kBool) {
+                    *(reinterpret_cast<uint8_t*>(buf + field.offset)) = *value ? 1 : 0;
+                } else {
+                    memcpy(buf + field.offset, value, field.size);
+                }
+                continue;
+            }
+            int8_t* addr = buf + str_field_start_offset_ + addr_length * field.offset;
+            if (!is_null) {
+                if (field.offset == 0) {
+                    SetStrAddr(addr, addr_length, str_offset);
+                }
+                uint32_t length = column.offsets[pos + 1] - column.offsets[pos];
+                if (length != 0) {
+                    memcpy(buf + str_offset, column.data + column.offsets[pos], length);
+                }
+                str_offset += length;
+            }
+            if (field.offset + 1 < str_field_cnt_) {
+                SetStrAddr(addr + addr_length, addr_length, str_offset);
+            }
+        }
+    }
+    return true;
+}
+
+}  // namespace codec
+}  // namespace openmldb
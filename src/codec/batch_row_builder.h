@@ -0,0 +1,84 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_CODEC_BATCH_ROW_BUILDER_H_
+#define SRC_CODEC_BATCH_ROW_BUILDER_H_
+
+#include <string>
+#include <vector>
+
+#include "codec/codec.h"
+
+namespace openmldb {
+namespace codec {
+
+// The values of one column of a batch of rows, laid out as the buffers of an Arrow array
+struct ColumnBuffer {
+    // the fixed length values, a bool takes one byte and a date is the encoded int32
+    const void* values = nullptr;
+    // bit i is set if the value of row i is valid, all the values are valid if it is NULL
+    const uint8_t* validity = nullptr;
+    // the string of row i is data[offsets[i], offsets[i + 1])
+    const int32_t* offsets = nullptr;
+    const char* data = nullptr;
+    // the value of row 0 is used by all the rows, e.g. a constant of the insert sql
+    bool repeated = false;
+
+    inline uint32_t Index(uint32_t row) const { return repeated ? 0 : row; }
+
+    inline bool IsNull(uint32_t row) const {
+        uint32_t i = Index(row);
+        return validity != nullptr && !(validity[i >> 3] & (1 << (i & 0x07)));
+    }
+};
+
+// Build the rows of a schema from columns in one pass. The position of every field is computed once,
+// so each row is sized by one scan of the string columns and the fields are copied without the type
+// check and dispatch of RowBuilder. The rows are the same as the ones of RowBuilder
+class BatchRowBuilder {
+ public:
+    explicit BatchRowBuilder(const Schema& schema);
+
+    void SetSchemaVersion(uint8_t version) { schema_version_ = version; }
+
+    // Encode the rows [0, row_cnt) of columns, which are in the order of the schema. Return false if
+    // a column has no buffer for its type, or a column of not null has a null value
+    bool Build(const std::vector<ColumnBuffer>& columns, uint32_t row_cnt, std::vector<std::string>* rows,
+               std::string* msg);
+
+ private:
+    struct Field {
+        ::openmldb::type::DataType type;
+        // the offset of the fixed length field, or the position of the string field
+        uint32_t offset;
+        uint32_t size;
+        bool not_null;
+    };
+
+    bool CheckColumns(const std::vector<ColumnBuffer>& columns, uint32_t row_cnt, std::string* msg) const;
+
+ private:
+    const Schema& schema_;
+    std::vector<Field> fields_;
+    uint32_t bitmap_size_;
+    uint32_t str_field_start_offset_;
+    uint32_t str_field_cnt_;
+    uint8_t schema_version_;
+};
+
+}  // namespace codec
+}  // namespace openmldb
+#endif  // SRC_CODEC_BATCH_ROW_BUILDER_H_
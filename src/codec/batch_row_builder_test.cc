@@ -0,0 +1,203 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "codec/batch_row_builder.h"
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "proto/common.pb.h"
+
+namespace openmldb {
+namespace codec {
+
+class BatchRowBuilderTest : public ::testing::Test {
+ public:
+    BatchRowBuilderTest() {}
+    ~BatchRowBuilderTest() {}
+};
+
+static void AddColumn(Schema* schema, const std::string& name, ::openmldb::type::DataType type,
+                      bool not_null = false) {
+    auto column = schema->Add();
+    column->set_name(name);
+    column->set_data_type(type);
+    column->set_not_null(not_null);
+}
+
+static void SetValid(std::vector<uint8_t>* validity, uint32_t i, bool valid) {
+    if (validity->size() <= (i >> 3)) {
+        validity->resize((i >> 3) + 1, 0);
+    }
+    if (valid) {
+        (*validity)[i >> 3] |= 1 << (i & 0x07);
+    }
+}
+
+TEST_F(BatchRowBuilderTest, SameAsRowBuilder) {
+    Schema schema;
+    AddColumn(&schema, "card", ::openmldb::type::kString, true);
+    AddColumn(&schema, "flag", ::openmldb::type::kBool);
+    AddColumn(&schema, "cnt", ::openmldb::type::kSmallInt);
+    AddColumn(&schema, "id", ::openmldb::type::kInt);
+    AddColumn(&schema, "ts", ::openmldb::type::kTimestamp, true);
+    AddColumn(&schema, "memo", ::openmldb::type::kVarchar);
+    AddColumn(&schema, "amt", ::openmldb::type::kDouble);
+    AddColumn(&schema, "price", ::openmldb::type::kFloat);
+    AddColumn(&schema, "day", ::openmldb::type::kDate);
+    AddColumn(&schema, "total", ::openmldb::type::kBigInt);
+
+    const uint32_t row_cnt = 200;
+    std::mt19937 rng(42);
+    std::vector<std::string> cards;
+    std::vector<std::string> memos;
+    std::vector<int32_t> card_offsets = {0};
+    std::vector<int32_t> memo_offsets = {0};
+    std::string card_data;
+    std::string memo_data;
+    std::vector<uint8_t> flags;
+    std::vector<int16_t> cnts;
+    std::vector<int32_t> ids;
+    std::vector<int64_t> tss;
+    std::vector<double> amts;
+    std::vector<float> prices;
+    std::vector<int32_t> days;
+    std::vector<int64_t> totals;
+    std::vector<uint8_t> validity;
+    for (uint32_t i = 0; i < row_cnt; i++) {
+        cards.push_back("card" + std::to_string(rng() % 100));
+        card_data += cards.back();
+        card_offsets.push_back(card_data.size());
+        // some rows need the string addresses of two bytes
+        memos.push_back(std::string(rng() % 3 == 0 ? 300 : rng() % 10, 'a' + i % 26));
+        memo_data += memos.back();
+        memo_offsets.push_back(memo_data.size());
+        flags.push_back(rng() % 2);
+        cnts.push_back(rng());
+        ids.push_back(rng());
+        tss.push_back(1600000000000 + i);
+        amts.push_back(rng() / 3.0);
+        prices.push_back(rng() / 7.0);
+        days.push_back(((2021 - 1900) << 16) | ((i % 12) << 8) | (i % 28 + 1));
+        totals.push_back(static_cast<int64_t>(rng()) << 20);
+        SetValid(&validity, i, i % 5 != 0);
+    }
+    std::vector<ColumnBuffer> columns(schema.size());
+    columns[0].offsets = card_offsets.data();
+    columns[0].data = card_data.data();
+    columns[1].values = flags.data();
+    columns[2].values = cnts.data();
+    columns[2].validity = validity.data();
+    columns[3].values = ids.data();
+    columns[4].values = tss.data();
+    columns[5].offsets = memo_offsets.data();
+    columns[5].data = memo_data.data();
+    columns[5].validity = validity.data();
+    columns[6].values = amts.data();
+    columns[7].values = prices.data();
+    columns[7].validity = validity.data();
+    columns[8].values = days.data();
+    columns[9].values = totals.data();
+    columns[9].validity = validity.data();
+
+    BatchRowBuilder batch_builder(schema);
+    std::vector<std::string> rows;
+    std::string msg;
+    ASSERT_TRUE(batch_builder.Build(columns, row_cnt, &rows, &msg)) << msg;
+    ASSERT_EQ(row_cnt, rows.size());
+
+    RowBuilder builder(schema);
+    RowView view(schema);
+    for (uint32_t i = 0; i < row_cnt; i++) {
+        bool valid = i % 5 != 0;
+        uint32_t str_length = cards[i].size() + (valid ? memos[i].size() : 0);
+        std::string row(builder.CalTotalLength(str_length), '\0');
+        builder.SetBuffer(reinterpret_cast<int8_t*>(&row[0]), row.size());
+        builder.AppendString(cards[i].data(), cards[i].size());
+        builder.AppendBool(flags[i]);
+        valid ? builder.AppendInt16(cnts[i]) : builder.AppendNULL();
+        builder.AppendInt32(ids[i]);
+        builder.AppendTimestamp(tss[i]);
+        valid ? builder.AppendString(memos[i].data(), memos[i].size()) : builder.AppendNULL();
+        builder.AppendDouble(amts[i]);
+        valid ? builder.AppendFloat(prices[i]) : builder.AppendNULL();
+        builder.AppendDate(days[i]);
+        valid ? builder.AppendInt64(totals[i]) : builder.AppendNULL();
+        ASSERT_EQ(row, rows[i]) << "row " << i;
+
+        ASSERT_TRUE(view.Reset(reinterpret_cast<const int8_t*>(rows[i].data()), rows[i].size()));
+        std::string memo;
+        if (valid) {
+            ASSERT_EQ(0, view.GetStrValue(5, &memo));
+            ASSERT_EQ(memos[i], memo);
+        } else {
+            ASSERT_TRUE(view.IsNULL(5));
+        }
+    }
+}
+
+TEST_F(BatchRowBuilderTest, RepeatedAndInvalid) {
+    Schema schema;
+    AddColumn(&schema, "card", ::openmldb::type::kString);
+    AddColumn(&schema, "ts", ::openmldb::type::kBigInt, true);
+    std::string card = "card0";
+    std::vector<int32_t> card_offsets = {0, static_cast<int32_t>(card.size())};
+    std::vector<int64_t> tss = {1, 2, 3};
+    std::vector<ColumnBuffer> columns(2);
+    columns[0].offsets = card_offsets.data();
+    columns[0].data = card.data();
+    columns[0].repeated = true;
+    columns[1].values = tss.data();
+
+    BatchRowBuilder batch_builder(schema);
+    std::vector<std::string> rows;
+    std::string msg;
+    ASSERT_TRUE(batch_builder.Build(columns, 3, &rows, &msg)) << msg;
+    RowView view(schema);
+    for (uint32_t i = 0; i < 3; i++) {
+        ASSERT_TRUE(view.Reset(reinterpret_cast<const int8_t*>(rows[i].data()), rows[i].size()));
+        std::string value;
+        ASSERT_EQ(0, view.GetStrValue(0, &value));
+        ASSERT_EQ(card, value);
+        int64_t ts = 0;
+        ASSERT_EQ(0, view.GetInt64(1, &ts));
+        ASSERT_EQ(tss[i], ts);
+    }
+
+    // a not null column with null
+    std::vector<uint8_t> validity = {0x05};
+    columns[1].validity = validity.data();
+    rows.clear();
+    ASSERT_FALSE(batch_builder.Build(columns, 3, &rows, &msg));
+    // a column without values
+    columns[1].validity = nullptr;
+    columns[0].data = nullptr;
+    ASSERT_FALSE(batch_builder.Build(columns, 3, &rows, &msg));
+    // the column count mismatch
+    columns.pop_back();
+    ASSERT_FALSE(batch_builder.Build(columns, 3, &rows, &msg));
+    ASSERT_TRUE(rows.empty());
+}
+
+}  // namespace codec
+}  // namespace openmldb
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
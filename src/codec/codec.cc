@@ -57,6 +57,13 @@ static inline uint8_t GetAddrLength(uint32_t size) {
     }
 }
 
+uint32_t GetFixedTypeSize(::openmldb::type::DataType type) {
+    if (type < TYPE_SIZE_ARRAY.size() && type > 0) {
+        return TYPE_SIZE_ARRAY[type];
+    }
+    return 0;
+}
+
 RowBuilder::RowBuilder(const Schema& schema)
     : schema_(schema),
       buf_(NULL),
@@ -901,161 +908,234 @@ int32_t GetStrField(const int8_t* row, uint32_t field_offset, uint32_t next_str_
 
 }  // namespace v1
 
-RowProject::RowProject(const std::map<int32_t, std::shared_ptr<Schema>>& vers_schema, const ProjectList& plist)
-    : plist_(plist),
-      output_schema_(),
-      row_builder_(NULL),
-      cur_rv_(nullptr),
-      max_idx_(0),
-      vers_views_(),
-      vers_schema_(vers_schema),
-      cur_ver_(1) {}
+static inline bool IsFieldNULL(const int8_t* row, uint32_t idx) {
+    return *(reinterpret_cast<const uint8_t*>(row + HEADER_LENGTH + (idx >> 3))) & (1 << (idx & 0x07));
+}
 
-RowProject::~RowProject() { delete row_builder_; }
+static inline void SetStrAddr(int8_t* ptr, uint8_t addr_length, uint32_t str_offset) {
+    if (addr_length == 1) {
+        *(reinterpret_cast<uint8_t*>(ptr)) = (uint8_t)str_offset;
+    } else if (addr_length == 2) {
+        *(reinterpret_cast<uint16_t*>(ptr)) = (uint16_t)str_offset;
+    } else if (addr_length == 3) {
+        *(reinterpret_cast<uint8_t*>(ptr)) = str_offset >> 16;
+        *(reinterpret_cast<uint8_t*>(ptr + 1)) = (str_offset & 0xFF00) >> 8;
+        *(reinterpret_cast<uint8_t*>(ptr + 2)) = str_offset & 0x00FF;
+    } else {
+        *(reinterpret_cast<uint32_t*>(ptr)) = str_offset;
+    }
+}
 
-bool RowProject::Init() {
-    if (plist_.size() <= 0) {
+static inline bool IsStringType(::openmldb::type::DataType type) {
+    return type == ::openmldb::type::kVarchar || type == ::openmldb::type::kString;
+}
+
+std::shared_ptr<const RowProjectPlan> RowProjectPlan::New(
+    const std::map<int32_t, std::shared_ptr<Schema>>& vers_schema, const ProjectList& plist, bool null_missing) {
+    std::shared_ptr<RowProjectPlan> plan(new RowProjectPlan());
+    if (!plan->Init(vers_schema, plist, null_missing)) {
+        return std::shared_ptr<const RowProjectPlan>();
+    }
+    return plan;
+}
+
+bool RowProjectPlan::Init(const std::map<int32_t, std::shared_ptr<Schema>>& vers_schema, const ProjectList& plist,
+                          bool null_missing) {
+    if (plist.size() <= 0) {
         LOG(WARNING) << "projection list is empty";
         return false;
     }
-    for (int32_t i = 0; i < plist_.size(); i++) {
-        uint32_t idx = plist_.Get(i);
+    for (int32_t i = 0; i < plist.size(); i++) {
+        uint32_t idx = plist.Get(i);
         if (idx >= max_idx_) {
             max_idx_ = idx;
         }
     }
-    for (const auto it : vers_schema_) {
+    // the output columns are of the first version with all of them
+    for (const auto& it : vers_schema) {
         if (max_idx_ >= (uint32_t)it.second->size()) {
             continue;
         }
-        std::shared_ptr<RowView> rv = std::make_shared<RowView>(*it.second);
-        vers_views_.insert(std::make_pair(it.first, rv));
+        for (int32_t i = 0; i < plist.size(); i++) {
+            output_schema_.Add()->CopyFrom(it.second->Get(plist.Get(i)));
+        }
+        uint32_t offset = HEADER_LENGTH + BitMapSize(output_schema_.size());
+        uint32_t str_pos = 0;
+        for (const auto& column : output_schema_) {
+            if (IsStringType(column.data_type())) {
+                output_offset_.push_back(str_pos++);
+            } else if (column.data_type() < TYPE_SIZE_ARRAY.size() && column.data_type() > 0) {
+                output_offset_.push_back(offset);
+                offset += TYPE_SIZE_ARRAY[column.data_type()];
+            } else {
+                LOG(WARNING) << "not supported type of column " << column.name();
+                return false;
+            }
+        }
+        output_str_field_start_offset_ = offset;
+        break;
+    }
+    for (const auto& it : vers_schema) {
+        if (output_schema_.empty() || (max_idx_ >= (uint32_t)it.second->size() && !null_missing)) {
+            continue;
+        }
+        VersionPlan plan;
+        if (!BuildPlan(*it.second, plist, &plan)) {
+            LOG(WARNING) << "fail to build the projection of schema version " << it.first;
+            return false;
+        }
+        vers_plans_.emplace(it.first, std::move(plan));
     }
-    if (vers_views_.empty()) {
+    if (vers_plans_.empty()) {
         LOG(WARNING) << "empty row views";
         return false;
     }
-    const auto it = vers_views_.begin();
-    cur_schema_ = vers_schema_.find(it->first)->second;
-    cur_rv_ = it->second;
-    for (int32_t i = 0; i < plist_.size(); i++) {
-        uint32_t idx = plist_.Get(i);
-        const ::openmldb::common::ColumnDesc& column = cur_schema_->Get(idx);
-        output_schema_.Add()->CopyFrom(column);
+    return true;
+}
+
+bool RowProjectPlan::BuildPlan(const Schema& schema, const ProjectList& plist, VersionPlan* plan) {
+    // the layout of the source row, the same as RowView
+    std::vector<uint32_t> offset_vec;
+    uint32_t offset = HEADER_LENGTH + BitMapSize(schema.size());
+    for (const auto& column : schema) {
+        if (IsStringType(column.data_type())) {
+            offset_vec.push_back(plan->str_field_cnt++);
+        } else if (column.data_type() < TYPE_SIZE_ARRAY.size() && column.data_type() > 0) {
+            offset_vec.push_back(offset);
+            offset += TYPE_SIZE_ARRAY[column.data_type()];
+        } else {
+            return false;
+        }
+    }
+    plan->str_field_start_offset = offset;
+    for (int32_t i = 0; i < plist.size(); i++) {
+        uint32_t idx = plist.Get(i);
+        if (idx >= (uint32_t)schema.size()) {
+            // the column is added after the version, so it is null in the rows of the version
+            plan->src_idx.push_back(VersionPlan::MISSING_IDX);
+            if (IsStringType(output_schema_.Get(i).data_type())) {
+                plan->str_fields.emplace_back(VersionPlan::MISSING_IDX, 0);
+            }
+            continue;
+        }
+        ::openmldb::type::DataType type = schema.Get(idx).data_type();
+        if (type != output_schema_.Get(i).data_type()) {
+            LOG(WARNING) << "the type of column " << schema.Get(idx).name() << " is changed";
+            return false;
+        }
+        plan->src_idx.push_back(idx);
+        if (IsStringType(type)) {
+            plan->str_fields.emplace_back(idx, offset_vec[idx]);
+            continue;
+        }
+        uint32_t length = TYPE_SIZE_ARRAY[type];
+        auto& copies = plan->fixed_copies;
+        if (!copies.empty() && copies.back().src_offset + copies.back().length == offset_vec[idx] &&
+            copies.back().dst_offset + copies.back().length == output_offset_[i]) {
+            copies.back().length += length;
+        } else {
+            copies.push_back({offset_vec[idx], output_offset_[i], length});
+        }
+    }
+    return true;
+}
+
+RowProject::RowProject(const std::map<int32_t, std::shared_ptr<Schema>>& vers_schema, const ProjectList& plist)
+    : plist_(&plist),
+      vers_schema_(vers_schema),
+      plan_(),
+      row_builder_(NULL),
+      cur_plan_(nullptr),
+      cur_ver_(0),
+      str_values_() {}
+
+RowProject::RowProject(const std::shared_ptr<const RowProjectPlan>& plan)
+    : plist_(nullptr), vers_schema_(), plan_(), row_builder_(NULL), cur_plan_(nullptr), cur_ver_(0), str_values_() {
+    if (plan) {
+        plan_ = plan;
+        row_builder_ = new RowBuilder(plan_->GetOutputSchema());
+    }
+}
+
+RowProject::~RowProject() { delete row_builder_; }
+
+bool RowProject::Init() {
+    if (plan_) {
+        return true;
+    }
+    if (plist_ == nullptr) {
+        return false;
+    }
+    plan_ = RowProjectPlan::New(vers_schema_, *plist_);
+    if (!plan_) {
+        return false;
     }
-    row_builder_ = new RowBuilder(output_schema_);
+    row_builder_ = new RowBuilder(plan_->GetOutputSchema());
     return true;
 }
 
 bool RowProject::Project(const int8_t* row_ptr, uint32_t size, int8_t** output_ptr, uint32_t* out_size) {
     if (row_ptr == NULL || output_ptr == NULL || out_size == NULL) return false;
+    if (size <= HEADER_LENGTH || RowView::GetSize(row_ptr) != size) return false;
+    if (!plan_) return false;
     uint8_t version = openmldb::codec::RowView::GetSchemaVersion(row_ptr);
-    if (version != cur_ver_) {
-        auto it = vers_views_.find(version);
-        if (it == vers_views_.end()) {
+    if (cur_plan_ == nullptr || version != cur_ver_) {
+        auto it = plan_->vers_plans_.find(version);
+        if (it == plan_->vers_plans_.end()) {
             LOG(WARNING) << "not found valid row view for ver " << unsigned(version);
             return false;
         }
-        cur_rv_ = it->second;
+        cur_plan_ = &it->second;
         cur_ver_ = version;
-        cur_schema_ = vers_schema_.find(version)->second;
     }
-    bool ok = cur_rv_->Reset(row_ptr, size);
-    if (!ok) return false;
+    const RowProjectPlan::VersionPlan& plan = *cur_plan_;
+    uint8_t addr_length = GetAddrLength(size);
     uint32_t str_size = 0;
-    for (int32_t i = 0; i < plist_.size(); i++) {
-        uint32_t idx = plist_.Get(i);
-        const ::openmldb::common::ColumnDesc& column = cur_schema_->Get(idx);
-        if (column.data_type() == ::openmldb::type::kVarchar || column.data_type() == ::openmldb::type::kString) {
-            if (cur_rv_->IsNULL(idx)) continue;
-            uint32_t length = 0;
-            char* content = nullptr;
-            int32_t ret = cur_rv_->GetString(idx, &content, &length);
-            if (ret != 0) {
-                return false;
-            }
-            str_size += length;
-        }
-    }
-    uint32_t total_size = row_builder_->CalTotalLength(str_size);
-    char* ptr = new char[total_size];
-    row_builder_->SetBuffer(reinterpret_cast<int8_t*>(ptr), total_size);
-    for (int32_t i = 0; i < plist_.size(); i++) {
-        uint32_t idx = plist_.Get(i);
-        const ::openmldb::common::ColumnDesc& column = cur_schema_->Get(idx);
-        int32_t ret = 0;
-        if (cur_rv_->IsNULL(idx)) {
-            row_builder_->AppendNULL();
+    str_values_.clear();
+    for (const auto& field : plan.str_fields) {
+        if (field.first == RowProjectPlan::VersionPlan::MISSING_IDX || IsFieldNULL(row_ptr, field.first)) {
+            str_values_.emplace_back(nullptr, 0);
             continue;
         }
-        switch (column.data_type()) {
-            case ::openmldb::type::kBool: {
-                bool val = false;
-                ret = cur_rv_->GetBool(idx, &val);
-                if (ret == 0) row_builder_->AppendBool(val);
-                break;
-            }
-            case ::openmldb::type::kSmallInt: {
-                int16_t val = 0;
-                ret = cur_rv_->GetInt16(idx, &val);
-                if (ret == 0) row_builder_->AppendInt16(val);
-                break;
-            }
-            case ::openmldb::type::kInt: {
-                int32_t val = 0;
-                ret = cur_rv_->GetInt32(idx, &val);
-                if (ret == 0) row_builder_->AppendInt32(val);
-                break;
-            }
-            case ::openmldb::type::kDate: {
-                int32_t val = 0;
-                ret = cur_rv_->GetDate(idx, &val);
-                if (ret == 0) row_builder_->AppendDate(val);
-                break;
-            }
-            case ::openmldb::type::kBigInt: {
-                int64_t val = 0;
-                ret = cur_rv_->GetInt64(idx, &val);
-                if (ret == 0) row_builder_->AppendInt64(val);
-                break;
-            }
-            case ::openmldb::type::kTimestamp: {
-                int64_t val = 0;
-                ret = cur_rv_->GetTimestamp(idx, &val);
-                if (ret == 0) row_builder_->AppendTimestamp(val);
-                break;
-            }
-            case ::openmldb::type::kFloat: {
-                float val = 0;
-                ret = cur_rv_->GetFloat(idx, &val);
-                if (ret == 0) row_builder_->AppendFloat(val);
-                break;
-            }
-            case ::openmldb::type::kDouble: {
-                double val = 0;
-                ret = cur_rv_->GetDouble(idx, &val);
-                if (ret == 0) row_builder_->AppendDouble(val);
-                break;
-            }
-            case ::openmldb::type::kString:
-            case ::openmldb::type::kVarchar: {
-                char* val = NULL;
-                uint32_t size = 0;
-                ret = cur_rv_->GetString(idx, &val, &size);
-                if (ret == 0) row_builder_->AppendString(val, size);
-                break;
-            }
-            default: {
-                PDLOG(WARNING, "not supported type");
-            }
+        uint32_t next_str_field_offset = 0;
+        if (field.second < plan.str_field_cnt - 1) {
+            next_str_field_offset = field.second + 1;
         }
-        if (ret != 0) {
-            delete[] ptr;
-            PDLOG(WARNING, "fail to project column %s with idx %u", column.name().c_str(), idx);
+        int8_t* data = nullptr;
+        uint32_t length = 0;
+        if (v1::GetStrField(row_ptr, field.second, next_str_field_offset, plan.str_field_start_offset, addr_length,
+                            &data, &length) != 0 ||
+            data + length > row_ptr + size) {
             return false;
         }
+        str_values_.emplace_back(data, length);
+        str_size += length;
+    }
+    uint32_t total_size = row_builder_->CalTotalLength(str_size);
+    if (total_size == 0) return false;
+    int8_t* ptr = reinterpret_cast<int8_t*>(new char[total_size]);
+    *(ptr) = 1;      // FVersion
+    *(ptr + 1) = 1;  // SVersion
+    *(reinterpret_cast<uint32_t*>(ptr + VERSION_LENGTH)) = total_size;
+    memset(ptr + HEADER_LENGTH, 0xFF, BitMapSize(plan_->output_schema_.size()));
+    for (uint32_t i = 0; i < plan.src_idx.size(); i++) {
+        if (plan.src_idx[i] != RowProjectPlan::VersionPlan::MISSING_IDX && !IsFieldNULL(row_ptr, plan.src_idx[i])) {
+            *(reinterpret_cast<uint8_t*>(ptr + HEADER_LENGTH + (i >> 3))) &= ~(1 << (i & 0x07));
+        }
+    }
+    for (const auto& copy : plan.fixed_copies) {
+        memcpy(ptr + copy.dst_offset, row_ptr + copy.src_offset, copy.length);
+    }
+    uint8_t out_addr_length = GetAddrLength(total_size);
+    uint32_t str_offset = plan_->output_str_field_start_offset_ + out_addr_length * str_values_.size();
+    for (uint32_t i = 0; i < str_values_.size(); i++) {
+        SetStrAddr(ptr + plan_->output_str_field_start_offset_ + out_addr_length * i, out_addr_length, str_offset);
+        if (str_values_[i].second > 0) {
+            memcpy(ptr + str_offset, str_values_[i].first, str_values_[i].second);
+            str_offset += str_values_[i].second;
+        }
     }
-    *output_ptr = reinterpret_cast<int8_t*>(ptr);
+    *output_ptr = ptr;
     *out_size = total_size;
     return true;
 }
@@ -43,35 +43,92 @@ static constexpr uint32_t UINT24_MAX = (1 << 24) - 1;
 
 struct RowContext;
 class RowBuilder;
+
+// the encoded size of a fixed length type, 0 for the strings and the unsupported types
+uint32_t GetFixedTypeSize(::openmldb::type::DataType type);
 class RowView;
+class RowProjectPlan;
 class RowProject;
 
 // TODO(wangtaize) share the row codec context
 struct RowContext {};
 
+// RowProjectPlan is the compiled projection of a projection list over all the schema versions of a
+// table. It is immutable once built, so a table caches it and the RowProjects of the reads share it
+class RowProjectPlan {
+ public:
+    // return NULL if the projection list is invalid for the schemas. The versions without some of the
+    // columns are skipped, or their rows are projected with the columns as null if null_missing
+    static std::shared_ptr<const RowProjectPlan> New(const std::map<int32_t, std::shared_ptr<Schema>>& vers_schema,
+                                                     const ProjectList& plist, bool null_missing = false);
+
+    const Schema& GetOutputSchema() const { return output_schema_; }
+
+    uint32_t GetMaxIdx() const { return max_idx_; }
+
+ private:
+    friend class RowProject;
+
+    // the copies to project the rows of one schema version, so that RowProject only copies the
+    // fixed length fields in runs and the strings
+    struct VersionPlan {
+        // the source index of the output columns added after the version
+        static constexpr uint32_t MISSING_IDX = UINT32_MAX;
+        struct FieldCopy {
+            uint32_t src_offset;
+            uint32_t dst_offset;
+            uint32_t length;
+        };
+        // the source index of each output column
+        std::vector<uint32_t> src_idx;
+        // the fixed length fields contiguous in both rows are merged into one copy
+        std::vector<FieldCopy> fixed_copies;
+        // the source index and string position of the output string columns in order
+        std::vector<std::pair<uint32_t, uint32_t>> str_fields;
+        uint32_t str_field_start_offset = 0;
+        uint32_t str_field_cnt = 0;
+    };
+
+    RowProjectPlan()
+        : output_schema_(), max_idx_(0), vers_plans_(), output_offset_(), output_str_field_start_offset_(0) {}
+
+    bool Init(const std::map<int32_t, std::shared_ptr<Schema>>& vers_schema, const ProjectList& plist,
+              bool null_missing);
+
+    bool BuildPlan(const Schema& schema, const ProjectList& plist, VersionPlan* plan);
+
+ private:
+    Schema output_schema_;
+    uint32_t max_idx_;
+    std::map<int32_t, VersionPlan> vers_plans_;
+    // the offset of each output column in the fixed part, or its string position
+    std::vector<uint32_t> output_offset_;
+    uint32_t output_str_field_start_offset_;
+};
+
 class RowProject {
  public:
     RowProject(const std::map<int32_t, std::shared_ptr<Schema>>& vers_schema, const ProjectList& plist);
 
+    // project with a plan built before, Init is not needed
+    explicit RowProject(const std::shared_ptr<const RowProjectPlan>& plan);
+
     ~RowProject();
 
     bool Init();
 
     bool Project(const int8_t* row_ptr, uint32_t row_size, int8_t** out_ptr, uint32_t* out_size);
 
-    uint32_t GetMaxIdx() { return max_idx_; }
+    uint32_t GetMaxIdx() { return plan_ ? plan_->GetMaxIdx() : 0; }
 
  private:
-    const ProjectList& plist_;
-    Schema output_schema_;
-    // TODO(wangtaize) share the init overhead
-    RowBuilder* row_builder_;
-    std::shared_ptr<Schema> cur_schema_;
-    std::shared_ptr<RowView> cur_rv_;
-    uint32_t max_idx_;
-    std::map<int32_t, std::shared_ptr<RowView>> vers_views_;
+    const ProjectList* plist_;
     std::map<int32_t, std::shared_ptr<Schema>> vers_schema_;
+    std::shared_ptr<const RowProjectPlan> plan_;
+    RowBuilder* row_builder_;
+    const RowProjectPlan::VersionPlan* cur_plan_;
     uint32_t cur_ver_;
+    std::vector<std::pair<const int8_t*, uint32_t>> str_values_;
 };
 
 class RowBuilder {
@@ -398,6 +398,70 @@ TEST_P(ProjectCodecTest, common_case) {
     CompareRow(&left, &right, args->output_schema);
 }
 
+TEST_F(ProjectCodecTest, multi_version) {
+    auto schema = std::make_shared<Schema>();
+    std::vector<type::DataType> types = {type::kInt,    type::kBigInt, type::kString,
+                                         type::kDouble, type::kString, type::kSmallInt};
+    for (uint32_t i = 0; i < types.size(); i++) {
+        common::ColumnDesc* column = schema->Add();
+        column->set_name("col" + std::to_string(i));
+        column->set_data_type(types[i]);
+    }
+    auto schema2 = std::make_shared<Schema>(*schema);
+    common::ColumnDesc* column = schema2->Add();
+    column->set_name("col6");
+    column->set_data_type(type::kString);
+    std::map<int32_t, std::shared_ptr<Schema>> vers_schema = {{1, schema}, {2, schema2}};
+    ProjectList plist;
+    for (uint32_t idx : {0, 1, 4, 3, 2}) {
+        plist.Add(idx);
+    }
+    RowProject rp(vers_schema, plist);
+    ASSERT_TRUE(rp.Init());
+    Schema output_schema;
+    for (uint32_t idx : plist) {
+        output_schema.Add()->CopyFrom(schema->Get(idx));
+    }
+    std::string long_str(300, 'a');
+    for (uint32_t version : {1, 2}) {
+        const Schema& cur_schema = version == 1 ? *schema : *schema2;
+        RowBuilder rb(cur_schema);
+        rb.SetSchemaVersion(version);
+        std::string str = version == 1 ? "hello" : long_str;
+        uint32_t row_size = rb.CalTotalLength(str.size() + (version == 1 ? 0 : 3));
+        std::string row(row_size, '\0');
+        rb.SetBuffer(reinterpret_cast<int8_t*>(&row[0]), row_size);
+        ASSERT_TRUE(rb.AppendInt32(version));
+        ASSERT_TRUE(rb.AppendInt64(100 + version));
+        ASSERT_TRUE(rb.AppendString(str.c_str(), str.size()));
+        ASSERT_TRUE(rb.AppendDouble(1.5));
+        ASSERT_TRUE(rb.AppendNULL());
+        ASSERT_TRUE(rb.AppendInt16(7));
+        if (version == 2) {
+            ASSERT_TRUE(rb.AppendString("abc", 3));
+        }
+        int8_t* output = NULL;
+        uint32_t output_size = 0;
+        ASSERT_TRUE(rp.Project(reinterpret_cast<int8_t*>(&row[0]), row_size, &output, &output_size));
+        RowView rv(output_schema, output, output_size);
+        int32_t int_val = 0;
+        ASSERT_EQ(0, rv.GetInt32(0, &int_val));
+        ASSERT_EQ((int32_t)version, int_val);
+        int64_t bigint_val = 0;
+        ASSERT_EQ(0, rv.GetInt64(1, &bigint_val));
+        ASSERT_EQ(100 + version, (uint64_t)bigint_val);
+        ASSERT_TRUE(rv.IsNULL(2));
+        double double_val = 0;
+        ASSERT_EQ(0, rv.GetDouble(3, &double_val));
+        ASSERT_EQ(1.5, double_val);
+        char* str_val = NULL;
+        uint32_t str_size = 0;
+        ASSERT_EQ(0, rv.GetString(4, &str_val, &str_size));
+        ASSERT_EQ(str, std::string(str_val, str_size));
+        delete[] output;
+    }
+}
+
 INSTANTIATE_TEST_SUITE_P(ProjectCodecTestPrefix, ProjectCodecTest, testing::ValuesIn(GenCommonCase()));
 
 }  // namespace codec
@@ -0,0 +1,418 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "codec/compact_row.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <new>
+#include <utility>
+
+namespace openmldb {
+namespace codec {
+
+static inline bool IsStringType(::openmldb::type::DataType type) {
+    return type == ::openmldb::type::kVarchar || type == ::openmldb::type::kString;
+}
+
+static inline uint8_t GetAddrLength(uint32_t size) {
+    if (size <= UINT8_MAX) {
+        return 1;
+    } else if (size <= UINT16_MAX) {
+        return 2;
+    } else if (size <= UINT24_MAX) {
+        return 3;
+    }
+    return 4;
+}
+
+static inline uint32_t GetStrAddr(const int8_t* ptr, uint8_t addr_length) {
+    if (addr_length == 1) {
+        return *(reinterpret_cast<const uint8_t*>(ptr));
+    } else if (addr_length == 2) {
+        uint16_t addr = 0;
+        memcpy(&addr, ptr, sizeof(uint16_t));
+        return addr;
+    } else if (addr_length == 3) {
+        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(ptr);
+        return (static_cast<uint32_t>(bytes[0]) << 16) | (static_cast<uint32_t>(bytes[1]) << 8) | bytes[2];
+    }
+    uint32_t addr = 0;
+    memcpy(&addr, ptr, sizeof(uint32_t));
+    return addr;
+}
+
+static inline void SetStrAddr(char* ptr, uint8_t addr_length, uint32_t addr) {
+    if (addr_length == 1) {
+        *(reinterpret_cast<uint8_t*>(ptr)) = (uint8_t)addr;
+    } else if (addr_length == 2) {
+        uint16_t value = (uint16_t)addr;
+        memcpy(ptr, &value, sizeof(uint16_t));
+    } else if (addr_length == 3) {
+        *(reinterpret_cast<uint8_t*>(ptr)) = addr >> 16;
+        *(reinterpret_cast<uint8_t*>(ptr + 1)) = (addr & 0xFF00) >> 8;
+        *(reinterpret_cast<uint8_t*>(ptr + 2)) = addr & 0x00FF;
+    } else {
+        memcpy(ptr, &addr, sizeof(uint32_t));
+    }
+}
+
+static inline void PutVarint(uint64_t value, std::string* buf) {
+    while (value >= 0x80) {
+        buf->push_back(static_cast<char>(value | 0x80));
+        value >>= 7;
+    }
+    buf->push_back(static_cast<char>(value));
+}
+
+static inline bool GetVarint(const int8_t** ptr, const int8_t* end, uint64_t* value) {
+    uint64_t result = 0;
+    for (uint32_t shift = 0; shift <= 63 && *ptr < end; shift += 7) {
+        uint64_t byte = *(reinterpret_cast<const uint8_t*>(*ptr));
+        (*ptr)++;
+        result |= (byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            *value = result;
+            return true;
+        }
+    }
+    return false;
+}
+
+static inline uint64_t ZigZag(int64_t value) {
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+static inline int64_t UnZigZag(uint64_t value) {
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+template <typename T>
+static inline T LoadField(const int8_t* row, uint32_t offset) {
+    T value;
+    memcpy(&value, row + offset, sizeof(T));
+    return value;
+}
+
+template <typename T>
+static inline bool StoreVarint(const int8_t** ptr, const int8_t* end, char* field) {
+    uint64_t encoded = 0;
+    if (!GetVarint(ptr, end, &encoded)) {
+        return false;
+    }
+    int64_t value = UnZigZag(encoded);
+    T narrowed = static_cast<T>(value);
+    if (static_cast<int64_t>(narrowed) != value) {
+        return false;
+    }
+    memcpy(field, &narrowed, sizeof(T));
+    return true;
+}
+
+RowBlob* RowBlob::New(const char* data, uint32_t size) {
+    void* mem = malloc(sizeof(RowBlob) + size);
+    if (mem == NULL) {
+        return NULL;
+    }
+    RowBlob* blob = reinterpret_cast<RowBlob*>(mem);
+    new (&blob->refs_) std::atomic<uint32_t>(1);
+    blob->size_ = size;
+    memcpy(reinterpret_cast<char*>(blob + 1), data, size);
+    return blob;
+}
+
+void RowBlob::UnRef() {
+    if (refs_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        free(this);
+    }
+}
+
+void CompactRowCodec::UnRefBlobs(const int8_t* data, uint32_t size) {
+    uint32_t cnt = GetBlobCnt(data, size);
+    for (uint32_t pos = 0; pos < cnt; pos++) {
+        GetBlob(data, size, pos)->UnRef();
+    }
+}
+
+bool CompactRowCodec::AddSchema(uint8_t version, const Schema& schema) {
+    if (schema.size() == 0) {
+        return false;
+    }
+    auto layout = std::make_shared<Layout>();
+    layout->bitmap_size = (schema.size() + 7) / 8;
+    layout->str_field_start_offset = HEADER_LENGTH + layout->bitmap_size;
+    layout->str_field_cnt = 0;
+    for (const auto& column : schema) {
+        ::openmldb::type::DataType type = column.data_type();
+        layout->types.push_back(type);
+        if (IsStringType(type)) {
+            layout->offsets.push_back(layout->str_field_cnt++);
+            continue;
+        }
+        uint32_t size = GetFixedTypeSize(type);
+        if (size == 0) {
+            return false;
+        }
+        layout->offsets.push_back(layout->str_field_start_offset);
+        layout->str_field_start_offset += size;
+    }
+    std::shared_ptr<const Layout> value = std::move(layout);
+    std::atomic_store_explicit(&layouts_[version], value, std::memory_order_release);
+    return true;
+}
+
+bool CompactRowCodec::Encode(const int8_t* row, uint32_t size, std::string* buf) const {
+    if (row == nullptr || buf == nullptr || size < HEADER_LENGTH || *(reinterpret_cast<const uint8_t*>(row)) != 1 ||
+        RowView::GetSize(row) != size) {
+        return false;
+    }
+    auto layout = GetLayout(RowView::GetSchemaVersion(row));
+    if (!layout) {
+        return false;
+    }
+    uint8_t addr_length = GetAddrLength(size);
+    uint32_t str_start = layout->str_field_start_offset + addr_length * layout->str_field_cnt;
+    if (size < str_start) {
+        return false;
+    }
+    const uint8_t* bitmap = reinterpret_cast<const uint8_t*>(row + HEADER_LENGTH);
+    buf->clear();
+    buf->reserve(size);
+    buf->append(reinterpret_cast<const char*>(row), VERSION_LENGTH);
+    (*buf)[0] = COMPACT_FORMAT_VERSION;
+    buf->append(reinterpret_cast<const char*>(bitmap), layout->bitmap_size);
+    // the blob bitmap is dropped if no string is moved to a blob
+    bool with_blobs = blob_min_size_ > 0 && size >= blob_min_size_;
+    size_t blob_bitmap_offset = buf->size();
+    if (with_blobs) {
+        buf->append(layout->bitmap_size, '\0');
+    }
+    std::vector<std::pair<const int8_t*, uint32_t>> blob_strs;
+    for (uint32_t idx = 0; idx < layout->types.size(); idx++) {
+        if (bitmap[idx >> 3] & (1 << (idx & 0x07))) {
+            continue;
+        }
+        uint32_t offset = layout->offsets[idx];
+        switch (layout->types[idx]) {
+            case ::openmldb::type::kBool:
+                buf->push_back(*(row + offset));
+                break;
+            case ::openmldb::type::kSmallInt:
+                PutVarint(ZigZag(LoadField<int16_t>(row, offset)), buf);
+                break;
+            case ::openmldb::type::kInt:
+            case ::openmldb::type::kDate:
+                PutVarint(ZigZag(LoadField<int32_t>(row, offset)), buf);
+                break;
+            case ::openmldb::type::kBigInt:
+            case ::openmldb::type::kTimestamp:
+                PutVarint(ZigZag(LoadField<int64_t>(row, offset)), buf);
+                break;
+            case ::openmldb::type::kFloat:
+                buf->append(reinterpret_cast<const char*>(row + offset), sizeof(float));
+                break;
+            case ::openmldb::type::kDouble:
+                buf->append(reinterpret_cast<const char*>(row + offset), sizeof(double));
+                break;
+            default: {
+                // the string of position offset ends at the start of the next one
+                const int8_t* addr = row + layout->str_field_start_offset + addr_length * offset;
+                uint32_t begin = GetStrAddr(addr, addr_length);
+                uint32_t end = offset + 1 < layout->str_field_cnt ? GetStrAddr(addr + addr_length, addr_length) : size;
+                if (begin < str_start || begin > end || end > size) {
+                    return false;
+                }
+                uint32_t length = end - begin;
+                PutVarint(length, buf);
+                if (with_blobs && length >= blob_min_size_ && blob_strs.size() < UINT8_MAX) {
+                    (*buf)[blob_bitmap_offset + (idx >> 3)] |= static_cast<char>(1 << (idx & 0x07));
+                    blob_strs.push_back({row + begin, length});
+                } else {
+                    buf->append(reinterpret_cast<const char*>(row + begin), length);
+                }
+            }
+        }
+    }
+    if (blob_strs.empty()) {
+        if (with_blobs) {
+            buf->erase(blob_bitmap_offset, layout->bitmap_size);
+        }
+        return true;
+    }
+    // the blobs are created after the row is known to be valid
+    std::vector<RowBlob*> blobs;
+    for (const auto& str : blob_strs) {
+        RowBlob* blob = RowBlob::New(reinterpret_cast<const char*>(str.first), str.second);
+        if (blob == NULL) {
+            for (auto created : blobs) {
+                created->UnRef();
+            }
+            return false;
+        }
+        blobs.push_back(blob);
+        buf->append(reinterpret_cast<const char*>(&blob), sizeof(RowBlob*));
+    }
+    buf->push_back(static_cast<char>(blobs.size()));
+    (*buf)[0] = BLOB_FORMAT_VERSION;
+    return true;
+}
+
+bool CompactRowCodec::Decode(const int8_t* data, uint32_t size, std::string* row,
+                             const std::vector<bool>* mask) const {
+    if (data == nullptr || row == nullptr || !IsCompact(data, size)) {
+        return false;
+    }
+    uint8_t version = *(reinterpret_cast<const uint8_t*>(data + 1));
+    auto layout = GetLayout(version);
+    if (!layout) {
+        return false;
+    }
+    // the blob pointers and their count are at the end of a row of format version 3
+    uint32_t blob_cnt = GetBlobCnt(data, size);
+    bool blob_row = *(reinterpret_cast<const uint8_t*>(data)) == BLOB_FORMAT_VERSION;
+    uint32_t head_size = VERSION_LENGTH + layout->bitmap_size * (blob_row ? 2 : 1);
+    uint32_t tail_size = blob_row ? 1 + sizeof(RowBlob*) * blob_cnt : 0;
+    if ((blob_row && blob_cnt == 0) || size < head_size + tail_size) {
+        return false;
+    }
+    const uint8_t* bitmap = reinterpret_cast<const uint8_t*>(data + VERSION_LENGTH);
+    const uint8_t* blob_bitmap = blob_row ? bitmap + layout->bitmap_size : nullptr;
+    uint32_t blob_pos = 0;
+    const int8_t* ptr = data + head_size;
+    const int8_t* end = data + size - tail_size;
+    row->assign(layout->str_field_start_offset, '\0');
+    char* buf = &(*row)[0];
+    *(buf) = 1;  // FVersion
+    *(buf + 1) = version;
+    memcpy(buf + HEADER_LENGTH, bitmap, layout->bitmap_size);
+    // the fixed length fields are decoded in place, the strings are copied after the size is known
+    std::vector<std::pair<const int8_t*, uint32_t>> strs(layout->str_field_cnt, {nullptr, 0});
+    uint64_t str_length = 0;
+    for (uint32_t idx = 0; idx < layout->types.size(); idx++) {
+        if (bitmap[idx >> 3] & (1 << (idx & 0x07))) {
+            continue;
+        }
+        uint32_t offset = layout->offsets[idx];
+        bool ok = true;
+        switch (layout->types[idx]) {
+            case ::openmldb::type::kBool:
+                ok = ptr < end;
+                if (ok) {
+                    *(buf + offset) = *(ptr++);
+                }
+                break;
+            case ::openmldb::type::kSmallInt:
+                ok = StoreVarint<int16_t>(&ptr, end, buf + offset);
+                break;
+            case ::openmldb::type::kInt:
+            case ::openmldb::type::kDate:
+                ok = StoreVarint<int32_t>(&ptr, end, buf + offset);
+                break;
+            case ::openmldb::type::kBigInt:
+            case ::openmldb::type::kTimestamp:
+                ok = StoreVarint<int64_t>(&ptr, end, buf + offset);
+                break;
+            case ::openmldb::type::kFloat:
+            case ::openmldb::type::kDouble: {
+                uint32_t width = GetFixedTypeSize(layout->types[idx]);
+                ok = static_cast<uint32_t>(end - ptr) >= width;
+                if (ok) {
+                    memcpy(buf + offset, ptr, width);
+                    ptr += width;
+                }
+                break;
+            }
+            default: {
+                uint64_t length = 0;
+                ok = GetVarint(&ptr, end, &length);
+                if (!ok) {
+                    break;
+                }
+                if (blob_bitmap != nullptr && (blob_bitmap[idx >> 3] & (1 << (idx & 0x07)))) {
+                    // the blob is not touched here, so a string not read is never loaded
+                    ok = blob_pos < blob_cnt && length <= UINT32_MAX;
+                    if (ok) {
+                        RowBlob* blob = GetBlob(data, size, blob_pos++);
+                        strs[offset] = {reinterpret_cast<const int8_t*>(blob->GetData()),
+                                        static_cast<uint32_t>(length)};
+                        str_length += length;
+                    }
+                    break;
+                }
+                ok = static_cast<uint64_t>(end - ptr) >= length;
+                if (ok) {
+                    strs[offset] = {ptr, static_cast<uint32_t>(length)};
+                    str_length += length;
+                    ptr += length;
+                }
+            }
+        }
+        if (!ok) {
+            return false;
+        }
+        if (mask != nullptr && idx < mask->size() && !(*mask)[idx]) {
+            // the field is parsed to reach the next one and left out as null
+            *(buf + HEADER_LENGTH + (idx >> 3)) |= static_cast<char>(1 << (idx & 0x07));
+            if (IsStringType(layout->types[idx])) {
+                str_length -= strs[offset].second;
+                strs[offset] = {nullptr, 0};
+            } else {
+                memset(buf + offset, 0, GetFixedTypeSize(layout->types[idx]));
+            }
+        }
+    }
+    if (ptr != end || blob_pos != blob_cnt) {
+        return false;
+    }
+    // the same size as RowBuilder::CalTotalLength
+    uint64_t total_length = layout->str_field_start_offset + str_length;
+    uint8_t addr_length = 0;
+    for (uint64_t limit : {static_cast<uint64_t>(UINT8_MAX), static_cast<uint64_t>(UINT16_MAX),
+                           static_cast<uint64_t>(UINT24_MAX), static_cast<uint64_t>(UINT32_MAX)}) {
+        addr_length++;
+        if (total_length + layout->str_field_cnt * addr_length <= limit) {
+            break;
+        }
+    }
+    uint64_t row_size = total_length + layout->str_field_cnt * addr_length;
+    if (row_size > UINT32_MAX) {
+        return false;
+    }
+    row->resize(row_size, '\0');
+    buf = &(*row)[0];
+    uint32_t total_size = row_size;
+    memcpy(buf + VERSION_LENGTH, &total_size, SIZE_LENGTH);
+    char* addr = buf + layout->str_field_start_offset;
+    uint32_t str_offset = layout->str_field_start_offset + addr_length * layout->str_field_cnt;
+    for (uint32_t pos = 0; pos < layout->str_field_cnt; pos++) {
+        // the address of a string is written by the previous one, see RowBuilder::AppendString
+        if (strs[pos].first != nullptr) {
+            if (pos == 0) {
+                SetStrAddr(addr, addr_length, str_offset);
+            }
+            memcpy(buf + str_offset, strs[pos].first, strs[pos].second);
+            str_offset += strs[pos].second;
+        }
+        if (pos + 1 < layout->str_field_cnt) {
+            SetStrAddr(addr + addr_length * (pos + 1), addr_length, str_offset);
+        }
+    }
+    return true;
+}
+
+}  // namespace codec
+}  // namespace openmldb
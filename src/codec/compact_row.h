@@ -0,0 +1,133 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_CODEC_COMPACT_ROW_H_
+#define SRC_CODEC_COMPACT_ROW_H_
+
+#include <string.h>
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "codec/codec.h"
+
+namespace openmldb {
+namespace codec {
+
+static constexpr uint8_t COMPACT_FORMAT_VERSION = 2;
+static constexpr uint8_t BLOB_FORMAT_VERSION = 3;
+
+// A large string of a compact row which is kept out of the row. It is referred to by the data block
+// of the row and the cold block packing it, and released with the last of them
+class RowBlob {
+ public:
+    // the blob is returned with one reference
+    static RowBlob* New(const char* data, uint32_t size);
+
+    void Ref() { refs_.fetch_add(1, std::memory_order_relaxed); }
+
+    void UnRef();
+
+    inline const char* GetData() const { return reinterpret_cast<const char*>(this + 1); }
+    inline uint32_t GetSize() const { return size_; }
+
+ private:
+    RowBlob() = delete;
+    ~RowBlob() = delete;
+
+ private:
+    std::atomic<uint32_t> refs_;
+    uint32_t size_;
+    // followed by the bytes of the string
+};
+
+// The compact row of storage is the format version 2 of the row header. The null fields are left
+// out, the integers are zigzag varints and a string is its varint length followed by its bytes
+//   | FVersion(2) | SVersion | null bitmap | the non null fields in the order of the schema |
+// With blob_min_size, the strings of at least the size are moved to blobs and the row is of format
+// version 3, in which a string in a blob is only its varint length
+//   | FVersion(3) | SVersion | null bitmap | blob bitmap | the fields | blob pointers | blob cnt |
+// A compact row is converted from and back to the same row of format version 1, so it never goes
+// beyond storage
+class CompactRowCodec {
+ public:
+    // 0 means the strings are always kept in the rows
+    explicit CompactRowCodec(uint32_t blob_min_size = 0) : blob_min_size_(blob_min_size) {}
+    CompactRowCodec(const CompactRowCodec&) = delete;
+    CompactRowCodec& operator=(const CompactRowCodec&) = delete;
+
+    // the schema versions can be added while the rows are encoded and decoded
+    bool AddSchema(uint8_t version, const Schema& schema);
+
+    bool HasSchema(uint8_t version) const { return GetLayout(version) != nullptr; }
+
+    static inline bool IsCompact(const int8_t* data, uint32_t size) {
+        return size >= VERSION_LENGTH && (*(reinterpret_cast<const uint8_t*>(data)) == COMPACT_FORMAT_VERSION ||
+                                          *(reinterpret_cast<const uint8_t*>(data)) == BLOB_FORMAT_VERSION);
+    }
+
+    // the blobs of a compact row, 0 if it is not of format version 3
+    static inline uint32_t GetBlobCnt(const int8_t* data, uint32_t size) {
+        if (size <= VERSION_LENGTH || *(reinterpret_cast<const uint8_t*>(data)) != BLOB_FORMAT_VERSION) {
+            return 0;
+        }
+        uint32_t cnt = *(reinterpret_cast<const uint8_t*>(data + size - 1));
+        return size > VERSION_LENGTH + 1 + sizeof(RowBlob*) * cnt ? cnt : 0;
+    }
+
+    static inline RowBlob* GetBlob(const int8_t* data, uint32_t size, uint32_t pos) {
+        RowBlob* blob = nullptr;
+        memcpy(&blob, data + size - 1 - sizeof(RowBlob*) * (GetBlobCnt(data, size) - pos), sizeof(RowBlob*));
+        return blob;
+    }
+
+    // drop the references of the row to its blobs
+    static void UnRefBlobs(const int8_t* data, uint32_t size);
+
+    // return false if the row is not a valid row of format version 1 or its schema version is unknown.
+    // The row encoded holds a reference of every blob of it, see UnRefBlobs
+    bool Encode(const int8_t* row, uint32_t size, std::string* buf) const;
+
+    // rebuild the row of format version 1 from a compact row. the columns not set in mask are
+    // rebuilt as null, so the strings not read are not copied
+    bool Decode(const int8_t* data, uint32_t size, std::string* row,
+                const std::vector<bool>* mask = nullptr) const;
+
+ private:
+    struct Layout {
+        std::vector<::openmldb::type::DataType> types;
+        // the offset of the fixed length field, or the position of the string field
+        std::vector<uint32_t> offsets;
+        uint32_t bitmap_size;
+        uint32_t str_field_start_offset;
+        uint32_t str_field_cnt;
+    };
+
+    std::shared_ptr<const Layout> GetLayout(uint8_t version) const {
+        return std::atomic_load_explicit(&layouts_[version], std::memory_order_acquire);
+    }
+
+ private:
+    std::array<std::shared_ptr<const Layout>, UINT8_MAX + 1> layouts_;
+    const uint32_t blob_min_size_;
+};
+
+}  // namespace codec
+}  // namespace openmldb
+#endif  // SRC_CODEC_COMPACT_ROW_H_
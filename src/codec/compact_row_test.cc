@@ -0,0 +1,259 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "codec/compact_row.h"
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "proto/common.pb.h"
+
+namespace openmldb {
+namespace codec {
+
+class CompactRowTest : public ::testing::Test {
+ public:
+    CompactRowTest() {}
+    ~CompactRowTest() {}
+};
+
+static void AddColumn(Schema* schema, const std::string& name, ::openmldb::type::DataType type) {
+    auto column = schema->Add();
+    column->set_name(name);
+    column->set_data_type(type);
+}
+
+static const int8_t* ToRow(const std::string& row) { return reinterpret_cast<const int8_t*>(row.data()); }
+
+TEST_F(CompactRowTest, RoundTrip) {
+    Schema schema;
+    AddColumn(&schema, "card", ::openmldb::type::kString);
+    AddColumn(&schema, "flag", ::openmldb::type::kBool);
+    AddColumn(&schema, "cnt", ::openmldb::type::kSmallInt);
+    AddColumn(&schema, "id", ::openmldb::type::kInt);
+    AddColumn(&schema, "ts", ::openmldb::type::kTimestamp);
+    AddColumn(&schema, "memo", ::openmldb::type::kVarchar);
+    AddColumn(&schema, "amt", ::openmldb::type::kDouble);
+    AddColumn(&schema, "price", ::openmldb::type::kFloat);
+    AddColumn(&schema, "day", ::openmldb::type::kDate);
+    AddColumn(&schema, "total", ::openmldb::type::kBigInt);
+    CompactRowCodec codec;
+    ASSERT_TRUE(codec.AddSchema(1, schema));
+
+    std::mt19937 rng(7);
+    RowBuilder builder(schema);
+    for (uint32_t i = 0; i < 500; i++) {
+        // every field is null in turn, and some rows need the string addresses of two bytes
+        std::string card = i % 11 == 0 ? "" : "card" + std::to_string(rng() % 1000);
+        std::string memo(rng() % 4 == 0 ? 400 : rng() % 20, 'a' + i % 26);
+        uint32_t null_idx = i % (schema.size() + 1);
+        uint32_t str_length = (null_idx == 0 ? 0 : card.size()) + (null_idx == 5 ? 0 : memo.size());
+        std::string row(builder.CalTotalLength(str_length), '\0');
+        builder.SetBuffer(reinterpret_cast<int8_t*>(&row[0]), row.size());
+        null_idx == 0 ? builder.AppendNULL() : builder.AppendString(card.data(), card.size());
+        null_idx == 1 ? builder.AppendNULL() : builder.AppendBool(rng() % 2);
+        null_idx == 2 ? builder.AppendNULL() : builder.AppendInt16(static_cast<int16_t>(rng()));
+        null_idx == 3 ? builder.AppendNULL() : builder.AppendInt32(static_cast<int32_t>(rng()));
+        null_idx == 4 ? builder.AppendNULL() : builder.AppendTimestamp(1600000000000 + i);
+        null_idx == 5 ? builder.AppendNULL() : builder.AppendString(memo.data(), memo.size());
+        null_idx == 6 ? builder.AppendNULL() : builder.AppendDouble(rng() / 3.0);
+        null_idx == 7 ? builder.AppendNULL() : builder.AppendFloat(rng() / 7.0);
+        null_idx == 8 ? builder.AppendNULL() : builder.AppendDate(2021, i % 12 + 1, i % 28 + 1);
+        null_idx == 9 ? builder.AppendNULL() : builder.AppendInt64(-(static_cast<int64_t>(rng()) << (i % 30)));
+
+        std::string compact;
+        ASSERT_TRUE(codec.Encode(ToRow(row), row.size(), &compact)) << "row " << i;
+        ASSERT_TRUE(CompactRowCodec::IsCompact(ToRow(compact), compact.size()));
+        ASSERT_LT(compact.size(), row.size());
+        std::string decoded;
+        ASSERT_TRUE(codec.Decode(ToRow(compact), compact.size(), &decoded)) << "row " << i;
+        ASSERT_EQ(row, decoded) << "row " << i;
+    }
+}
+
+TEST_F(CompactRowTest, SparseRow) {
+    Schema schema;
+    AddColumn(&schema, "id", ::openmldb::type::kBigInt);
+    for (uint32_t i = 0; i < 40; i++) {
+        auto type = i % 2 == 0 ? ::openmldb::type::kDouble : ::openmldb::type::kString;
+        AddColumn(&schema, "col" + std::to_string(i), type);
+    }
+    CompactRowCodec codec;
+    ASSERT_TRUE(codec.AddSchema(1, schema));
+    RowBuilder builder(schema);
+    std::string row(builder.CalTotalLength(0), '\0');
+    builder.SetBuffer(reinterpret_cast<int8_t*>(&row[0]), row.size());
+    builder.AppendInt64(1);
+    for (uint32_t i = 0; i < 40; i++) {
+        builder.AppendNULL();
+    }
+    std::string compact;
+    ASSERT_TRUE(codec.Encode(ToRow(row), row.size(), &compact));
+    // the header, the bitmap and one byte of the id
+    ASSERT_EQ(2u + 6u + 1u, compact.size());
+    std::string decoded;
+    ASSERT_TRUE(codec.Decode(ToRow(compact), compact.size(), &decoded));
+    ASSERT_EQ(row, decoded);
+    RowView view(schema, ToRow(decoded), decoded.size());
+    int64_t id = 0;
+    ASSERT_EQ(0, view.GetInt64(0, &id));
+    ASSERT_EQ(1, id);
+    ASSERT_TRUE(view.IsNULL(40));
+}
+
+TEST_F(CompactRowTest, SchemaVersion) {
+    Schema schema;
+    AddColumn(&schema, "card", ::openmldb::type::kString);
+    AddColumn(&schema, "ts", ::openmldb::type::kBigInt);
+    CompactRowCodec codec;
+    ASSERT_TRUE(codec.AddSchema(1, schema));
+    Schema new_schema = schema;
+    AddColumn(&new_schema, "memo", ::openmldb::type::kString);
+    ASSERT_FALSE(codec.HasSchema(2));
+
+    RowBuilder builder(new_schema);
+    builder.SetSchemaVersion(2);
+    std::string row(builder.CalTotalLength(8), '\0');
+    builder.SetBuffer(reinterpret_cast<int8_t*>(&row[0]), row.size());
+    builder.AppendString("card", 4);
+    builder.AppendInt64(100);
+    builder.AppendString("memo", 4);
+    std::string compact;
+    ASSERT_FALSE(codec.Encode(ToRow(row), row.size(), &compact));
+    ASSERT_TRUE(codec.AddSchema(2, new_schema));
+    ASSERT_TRUE(codec.Encode(ToRow(row), row.size(), &compact));
+    std::string decoded;
+    ASSERT_TRUE(codec.Decode(ToRow(compact), compact.size(), &decoded));
+    ASSERT_EQ(row, decoded);
+    ASSERT_EQ(2, RowView::GetSchemaVersion(ToRow(decoded)));
+
+    // a truncated or a padded row can not be decoded
+    ASSERT_FALSE(codec.Decode(ToRow(compact), compact.size() - 1, &decoded));
+    compact.push_back('\0');
+    ASSERT_FALSE(codec.Decode(ToRow(compact), compact.size(), &decoded));
+    // a compact row is not encoded again
+    ASSERT_FALSE(codec.Encode(ToRow(compact), compact.size(), &decoded));
+    ASSERT_FALSE(CompactRowCodec::IsCompact(ToRow(row), row.size()));
+}
+
+TEST_F(CompactRowTest, ColumnMask) {
+    Schema schema;
+    AddColumn(&schema, "card", ::openmldb::type::kString);
+    AddColumn(&schema, "ts", ::openmldb::type::kTimestamp);
+    AddColumn(&schema, "memo", ::openmldb::type::kString);
+    AddColumn(&schema, "amt", ::openmldb::type::kDouble);
+    AddColumn(&schema, "flag", ::openmldb::type::kBool);
+    CompactRowCodec codec;
+    ASSERT_TRUE(codec.AddSchema(1, schema));
+    RowBuilder builder(schema);
+    std::string row(builder.CalTotalLength(12), '\0');
+    builder.SetBuffer(reinterpret_cast<int8_t*>(&row[0]), row.size());
+    builder.AppendString("card0001", 8);
+    builder.AppendTimestamp(1600000000000);
+    builder.AppendString("memo", 4);
+    builder.AppendDouble(1.5);
+    builder.AppendBool(true);
+    std::string compact;
+    ASSERT_TRUE(codec.Encode(ToRow(row), row.size(), &compact));
+
+    // the columns not in the mask are decoded as they were null
+    std::vector<bool> mask = {false, true, true, false, true};
+    std::string expect(builder.CalTotalLength(4), '\0');
+    builder.SetBuffer(reinterpret_cast<int8_t*>(&expect[0]), expect.size());
+    builder.AppendNULL();
+    builder.AppendTimestamp(1600000000000);
+    builder.AppendString("memo", 4);
+    builder.AppendNULL();
+    builder.AppendBool(true);
+    std::string decoded;
+    ASSERT_TRUE(codec.Decode(ToRow(compact), compact.size(), &decoded, &mask));
+    ASSERT_EQ(expect, decoded);
+    ASSERT_LT(decoded.size(), row.size());
+    // the columns out of the mask are decoded
+    mask.resize(2);
+    ASSERT_TRUE(codec.Decode(ToRow(compact), compact.size(), &decoded, &mask));
+    RowView view(schema, ToRow(decoded), decoded.size());
+    ASSERT_TRUE(view.IsNULL(0));
+    std::string memo;
+    ASSERT_EQ(0, view.GetStrValue(2, &memo));
+    ASSERT_EQ("memo", memo);
+    ASSERT_FALSE(view.IsNULL(3));
+    // an invalid row is not decoded with a mask either
+    ASSERT_FALSE(codec.Decode(ToRow(compact), compact.size() - 1, &decoded, &mask));
+}
+
+TEST_F(CompactRowTest, Blob) {
+    Schema schema;
+    AddColumn(&schema, "card", ::openmldb::type::kString);
+    AddColumn(&schema, "ts", ::openmldb::type::kTimestamp);
+    AddColumn(&schema, "doc", ::openmldb::type::kString);
+    AddColumn(&schema, "memo", ::openmldb::type::kString);
+    CompactRowCodec codec(100);
+    ASSERT_TRUE(codec.AddSchema(1, schema));
+    RowBuilder builder(schema);
+    for (uint32_t i = 0; i < 4; i++) {
+        // the doc is large, null or small in turn, and the memo is large in the last row
+        std::string doc(i == 2 ? 10 : 1000 + i, 'a' + i);
+        std::string memo(i == 3 ? 200 : 20, 'm');
+        uint32_t str_length = 4 + (i == 1 ? 0 : doc.size()) + memo.size();
+        std::string row(builder.CalTotalLength(str_length), '\0');
+        builder.SetBuffer(reinterpret_cast<int8_t*>(&row[0]), row.size());
+        builder.AppendString("card", 4);
+        builder.AppendTimestamp(1600000000000 + i);
+        i == 1 ? builder.AppendNULL() : builder.AppendString(doc.data(), doc.size());
+        builder.AppendString(memo.data(), memo.size());
+
+        std::string compact;
+        ASSERT_TRUE(codec.Encode(ToRow(row), row.size(), &compact)) << "row " << i;
+        ASSERT_TRUE(CompactRowCodec::IsCompact(ToRow(compact), compact.size()));
+        uint32_t blob_cnt = CompactRowCodec::GetBlobCnt(ToRow(compact), compact.size());
+        ASSERT_EQ(i == 3 ? 2u : (i == 0 ? 1u : 0u), blob_cnt) << "row " << i;
+        if (blob_cnt == 0) {
+            ASSERT_EQ(COMPACT_FORMAT_VERSION, static_cast<uint8_t>(compact[0]));
+        } else {
+            ASSERT_LT(compact.size(), 100u);
+            ASSERT_EQ(doc, std::string(CompactRowCodec::GetBlob(ToRow(compact), compact.size(), 0)->GetData(),
+                                       doc.size()));
+        }
+        std::string decoded;
+        ASSERT_TRUE(codec.Decode(ToRow(compact), compact.size(), &decoded)) << "row " << i;
+        ASSERT_EQ(row, decoded) << "row " << i;
+
+        // the blobs of the columns not in the mask are not read
+        std::vector<bool> mask = {true, true, false, true};
+        ASSERT_TRUE(codec.Decode(ToRow(compact), compact.size(), &decoded, &mask));
+        RowView view(schema, ToRow(decoded), decoded.size());
+        ASSERT_TRUE(view.IsNULL(2));
+        std::string value;
+        ASSERT_EQ(0, view.GetStrValue(3, &value));
+        ASSERT_EQ(memo, value);
+        // a row losing its blob pointers is not decoded
+        if (blob_cnt > 0) {
+            ASSERT_FALSE(codec.Decode(ToRow(compact), compact.size() - 1, &decoded));
+        }
+        CompactRowCodec::UnRefBlobs(ToRow(compact), compact.size());
+    }
+}
+
+}  // namespace codec
+}  // namespace openmldb
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
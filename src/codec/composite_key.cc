@@ -0,0 +1,116 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "codec/composite_key.h"
+
+#include "base/glog_wapper.h"
+#include "codec/field_codec.h"
+#include "codec/memcomparable_format.h"
+#include "codec/schema_codec.h"
+
+namespace openmldb {
+namespace codec {
+
+CompositeKeyCodec::CompositeKeyCodec(const Schema& schema, const std::vector<uint32_t>& cols)
+    : schema_(schema), cols_(cols), types_(), row_view_(schema_), is_valid_(!cols.empty()) {
+    for (uint32_t idx : cols_) {
+        if (idx >= static_cast<uint32_t>(schema_.size())) {
+            PDLOG(WARNING, "index column %u is out of the schema of %d columns", idx, schema_.size());
+            is_valid_ = false;
+            return;
+        }
+        auto type = schema_.Get(idx).data_type();
+        switch (type) {
+            case ::openmldb::type::kBool:
+            case ::openmldb::type::kSmallInt:
+            case ::openmldb::type::kInt:
+            case ::openmldb::type::kDate:
+            case ::openmldb::type::kBigInt:
+            case ::openmldb::type::kTimestamp:
+            case ::openmldb::type::kFloat:
+            case ::openmldb::type::kDouble:
+            case ::openmldb::type::kString:
+            case ::openmldb::type::kVarchar:
+                break;
+            default:
+                PDLOG(WARNING, "unsupported index column type %s",
+                      ::openmldb::type::DataType_Name(type).c_str());
+                is_valid_ = false;
+                return;
+        }
+        types_.push_back(type);
+    }
+}
+
+bool CompositeKeyCodec::AppendString(const char* data, uint32_t size, std::string* key) {
+    size_t k_size = key->size();
+    key->resize(k_size + GetDstStrSize(size));
+    void* to = &(*key)[k_size];
+    return PackString(size == 0 ? "" : data, size, &to) == 0;
+}
+
+bool CompositeKeyCodec::Encode(const int8_t* row, uint32_t size, std::string* key) {
+    if (!is_valid_ || row == NULL || key == NULL || size <= HEADER_LENGTH || RowView::GetSize(row) != size) {
+        return false;
+    }
+    key->clear();
+    for (uint32_t i = 0; i < cols_.size(); i++) {
+        if (row_view_.IsNULL(row, cols_[i])) {
+            key->push_back(COMPOSITE_KEY_NULL);
+            continue;
+        }
+        key->push_back(COMPOSITE_KEY_NOT_NULL);
+        if (types_[i] == ::openmldb::type::kString || types_[i] == ::openmldb::type::kVarchar) {
+            char* data = NULL;
+            uint32_t length = 0;
+            if (row_view_.GetValue(row, cols_[i], &data, &length) != 0 || !AppendString(data, length, key)) {
+                return false;
+            }
+            continue;
+        }
+        int64_t value = 0;
+        if (row_view_.GetValue(row, cols_[i], types_[i], &value) != 0 || !PackValue(&value, types_[i], key)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool CompositeKeyCodec::Encode(const std::vector<std::string>& values, std::string* key) const {
+    if (!is_valid_ || key == NULL || values.size() > types_.size()) {
+        return false;
+    }
+    key->clear();
+    std::string value;
+    for (uint32_t i = 0; i < values.size(); i++) {
+        if (values[i] == NONETOKEN) {
+            key->push_back(COMPOSITE_KEY_NULL);
+            continue;
+        }
+        key->push_back(COMPOSITE_KEY_NOT_NULL);
+        if (types_[i] == ::openmldb::type::kString || types_[i] == ::openmldb::type::kVarchar) {
+            if (!AppendString(values[i].data(), values[i].size(), key)) {
+                return false;
+            }
+        } else if (!Convert(values[i], types_[i], &value) || !PackValue(value.data(), types_[i], key)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+}  // namespace codec
+}  // namespace openmldb
@@ -0,0 +1,73 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_CODEC_COMPOSITE_KEY_H_
+#define SRC_CODEC_COMPOSITE_KEY_H_
+
+#include <string>
+#include <vector>
+
+#include "base/hash.h"
+#include "codec/codec.h"
+
+namespace openmldb {
+namespace codec {
+
+static constexpr char COMPOSITE_KEY_NULL = 0x00;
+static constexpr char COMPOSITE_KEY_NOT_NULL = 0x01;
+
+// CompositeKeyCodec encodes the columns of a multi-column index into one memcomparable key. Every
+// column is a null flag followed by the memcomparable value of its type, so
+//   - memcmp of two keys orders them column by column and the null sorts first
+//   - no separator is needed and a value never has to be escaped
+//   - the key of the first n columns is a byte prefix of the key of all the columns
+class CompositeKeyCodec {
+ public:
+    // cols are the positions of the index columns in the schema
+    CompositeKeyCodec(const Schema& schema, const std::vector<uint32_t>& cols);
+    CompositeKeyCodec(const CompositeKeyCodec&) = delete;
+    CompositeKeyCodec& operator=(const CompositeKeyCodec&) = delete;
+
+    bool IsValid() const { return is_valid_; }
+
+    uint32_t GetColumnCnt() const { return types_.size(); }
+
+    // encode the index columns of a row of format version 1
+    bool Encode(const int8_t* row, uint32_t size, std::string* key);
+
+    // encode the values of the first values.size() index columns, NONETOKEN is the null value.
+    // The key of fewer values than the index columns is the prefix to seek
+    bool Encode(const std::vector<std::string>& values, std::string* key) const;
+
+    // the hash of the partition and of the segment, which is kept along with the key
+    static inline uint64_t Hash(const std::string& key) {
+        return static_cast<uint64_t>(::openmldb::base::hash64(key));
+    }
+
+ private:
+    static bool AppendString(const char* data, uint32_t size, std::string* key);
+
+ private:
+    Schema schema_;
+    std::vector<uint32_t> cols_;
+    std::vector<::openmldb::type::DataType> types_;
+    RowView row_view_;
+    bool is_valid_;
+};
+
+}  // namespace codec
+}  // namespace openmldb
+#endif  // SRC_CODEC_COMPOSITE_KEY_H_
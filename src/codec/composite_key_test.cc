@@ -0,0 +1,137 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "codec/composite_key.h"
+
+#include <algorithm>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "codec/schema_codec.h"
+#include "gtest/gtest.h"
+
+namespace openmldb {
+namespace codec {
+
+class CompositeKeyTest : public ::testing::Test {
+ public:
+    CompositeKeyTest() {}
+    ~CompositeKeyTest() {}
+};
+
+static void AddColumn(Schema* schema, const std::string& name, ::openmldb::type::DataType type) {
+    auto column = schema->Add();
+    column->set_name(name);
+    column->set_data_type(type);
+}
+
+static std::string BuildRow(const Schema& schema, const std::string& card, int32_t id, double amt, int64_t ts) {
+    RowBuilder builder(schema);
+    std::string row(builder.CalTotalLength(card.size()), '\0');
+    builder.SetBuffer(reinterpret_cast<int8_t*>(&row[0]), row.size());
+    builder.AppendString(card.data(), card.size());
+    builder.AppendInt32(id);
+    builder.AppendDouble(amt);
+    builder.AppendInt64(ts);
+    return row;
+}
+
+TEST_F(CompositeKeyTest, Order) {
+    Schema schema;
+    AddColumn(&schema, "card", ::openmldb::type::kString);
+    AddColumn(&schema, "id", ::openmldb::type::kInt);
+    AddColumn(&schema, "amt", ::openmldb::type::kDouble);
+    AddColumn(&schema, "ts", ::openmldb::type::kBigInt);
+    CompositeKeyCodec codec(schema, {0, 1, 2});
+    ASSERT_TRUE(codec.IsValid());
+
+    std::vector<std::tuple<std::string, int32_t, double>> values;
+    for (const std::string& card : {"", "a", "ab", "abcdefgh", "abcdefghi", "a|b", "b"}) {
+        for (int32_t id : {-100, -1, 0, 1, 65536}) {
+            for (double amt : {-2.5, 0.0, 1.5, 1e10}) {
+                values.emplace_back(card, id, amt);
+            }
+        }
+    }
+    std::vector<std::string> keys;
+    for (const auto& value : values) {
+        std::string row = BuildRow(schema, std::get<0>(value), std::get<1>(value), std::get<2>(value), 1);
+        std::string key;
+        ASSERT_TRUE(codec.Encode(reinterpret_cast<const int8_t*>(row.data()), row.size(), &key));
+        std::string expect;
+        ASSERT_TRUE(codec.Encode({std::get<0>(value), std::to_string(std::get<1>(value)),
+                                  std::to_string(std::get<2>(value))}, &expect));
+        ASSERT_EQ(expect, key);
+        keys.push_back(key);
+    }
+    // the values are in order, so are their keys
+    for (uint32_t i = 1; i < keys.size(); i++) {
+        ASSERT_LT(keys[i - 1], keys[i]) << "key " << i;
+    }
+    std::vector<std::string> sorted = keys;
+    std::sort(sorted.begin(), sorted.end());
+    ASSERT_EQ(sorted.size(), std::unique(sorted.begin(), sorted.end()) - sorted.begin());
+}
+
+TEST_F(CompositeKeyTest, PrefixAndNull) {
+    Schema schema;
+    AddColumn(&schema, "card", ::openmldb::type::kString);
+    AddColumn(&schema, "id", ::openmldb::type::kInt);
+    AddColumn(&schema, "amt", ::openmldb::type::kDouble);
+    AddColumn(&schema, "ts", ::openmldb::type::kBigInt);
+    CompositeKeyCodec codec(schema, {0, 1});
+    std::string row = BuildRow(schema, "card0", 7, 1.0, 1);
+    std::string key;
+    ASSERT_TRUE(codec.Encode(reinterpret_cast<const int8_t*>(row.data()), row.size(), &key));
+    std::string prefix;
+    ASSERT_TRUE(codec.Encode({"card0"}, &prefix));
+    ASSERT_EQ(0u, key.compare(0, prefix.size(), prefix));
+    // the key of card00 does not start with the prefix of card0
+    std::string other;
+    ASSERT_TRUE(codec.Encode({"card00", "7"}, &other));
+    ASSERT_NE(0u, other.compare(0, prefix.size(), prefix));
+    ASSERT_EQ(CompositeKeyCodec::Hash(key), CompositeKeyCodec::Hash(std::string(key)));
+
+    // the null is not the empty string and it sorts first
+    std::string null_key;
+    ASSERT_TRUE(codec.Encode({NONETOKEN, "7"}, &null_key));
+    std::string empty_key;
+    ASSERT_TRUE(codec.Encode({"", "7"}, &empty_key));
+    ASSERT_LT(null_key, empty_key);
+    RowBuilder builder(schema);
+    std::string null_row(builder.CalTotalLength(0), '\0');
+    builder.SetBuffer(reinterpret_cast<int8_t*>(&null_row[0]), null_row.size());
+    builder.AppendNULL();
+    builder.AppendInt32(7);
+    builder.AppendNULL();
+    builder.AppendInt64(1);
+    ASSERT_TRUE(codec.Encode(reinterpret_cast<const int8_t*>(null_row.data()), null_row.size(), &key));
+    ASSERT_EQ(null_key, key);
+
+    ASSERT_FALSE(codec.Encode({"card0", "7", "1.0"}, &key));
+    ASSERT_FALSE(codec.Encode({"card0", "abc"}, &key));
+    CompositeKeyCodec invalid_codec(schema, {0, 4});
+    ASSERT_FALSE(invalid_codec.IsValid());
+}
+
+}  // namespace codec
+}  // namespace openmldb
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -366,15 +366,20 @@ __attribute__((unused)) static bool DecodeRows(const std::string& data, uint32_t
     return true;
 }
 
-static inline void Encode(uint64_t time, const char* data, const size_t size, char* buffer, uint32_t offset) {
-    buffer += offset;
+// encode the size and time of a value of size bytes into the 12 bytes before it
+static inline void EncodeHeader(uint64_t time, const size_t size, char* buffer) {
     uint32_t total_size = 8 + size;
     memcpy(buffer, static_cast<const void*>(&total_size), 4);
     memrev32ifbe(buffer);
     buffer += 4;
     memcpy(buffer, static_cast<const void*>(&time), 8);
     memrev64ifbe(buffer);
-    buffer += 8;
+}
+
+static inline void Encode(uint64_t time, const char* data, const size_t size, char* buffer, uint32_t offset) {
+    buffer += offset;
+    EncodeHeader(time, size, buffer);
+    buffer += 12;
     memcpy(buffer, static_cast<const void*>(data), size);
 }
 
@@ -435,9 +440,8 @@ static inline int32_t EncodeRows(const boost::container::deque<std::pair<uint64_
 }
 
 // encode pk, ts and value
-static inline void EncodeFull(const std::string& pk, uint64_t time, const char* data, const size_t size, char* buffer,
-                              uint32_t offset) {
-    buffer += offset;
+// encode the sizes, time and pk of a value of size bytes into the 16 + pk size bytes before it
+static inline void EncodeFullHeader(const std::string& pk, uint64_t time, const size_t size, char* buffer) {
     uint32_t pk_size = pk.length();
     uint32_t total_size = 8 + pk_size + size;
     DEBUGLOG("encode total size %u pk size %u", total_size, pk_size);
@@ -451,7 +455,13 @@ static inline void EncodeFull(const std::string& pk, uint64_t time, const char*
     memrev64ifbe(buffer);
     buffer += 8;
     memcpy(buffer, static_cast<const void*>(pk.c_str()), pk_size);
-    buffer += pk_size;
+}
+
+static inline void EncodeFull(const std::string& pk, uint64_t time, const char* data, const size_t size, char* buffer,
+                              uint32_t offset) {
+    buffer += offset;
+    EncodeFullHeader(pk, time, size, buffer);
+    buffer += 16 + pk.length();
     memcpy(buffer, static_cast<const void*>(data), size);
 }
 static inline void EncodeFull(const std::string& pk, uint64_t time, const DataBlock* data, char* buffer,
@@ -16,6 +16,11 @@
 
 #include "codec/sql_rpc_row_codec.h"
 
+#include <snappy.h>
+
+#include <algorithm>
+#include <string>
+
 namespace openmldb {
 namespace codec {
 
@@ -53,12 +58,12 @@ bool DecodeRpcRow(const butil::IOBuf& buf, size_t offset, size_t size, size_t sl
                 row->Append(hybridse::base::RefCountedSlice());
             }
         } else {
-            int8_t* slice_buf = reinterpret_cast<int8_t*>(malloc(slice_size));
-            buf.copy_to(slice_buf, slice_size, cur_offset);
+            auto slice = hybridse::base::RefCountedSlice::Allocate(slice_size);
+            buf.copy_to(slice.buf(), slice_size, cur_offset);
             if (i == 0) {
-                *row = hybridse::codec::Row(hybridse::base::RefCountedSlice::CreateManaged(slice_buf, slice_size));
+                *row = hybridse::codec::Row(slice);
             } else {
-                row->Append(hybridse::base::RefCountedSlice::CreateManaged(slice_buf, slice_size));
+                row->Append(slice);
             }
         }
         cur_offset = next_offset;
@@ -70,6 +75,75 @@ bool DecodeRpcRow(const butil::IOBuf& buf, size_t offset, size_t size, size_t sl
     return true;
 }
 
+RpcRowDecoder::RpcRowDecoder(const butil::IOBuf& buf) : buf_(std::make_shared<butil::IOBuf>(buf)) {
+    size_t block_num = buf_->backing_block_num();
+    block_offsets_.reserve(block_num + 1);
+    size_t block_offset = 0;
+    for (size_t i = 0; i < block_num; ++i) {
+        block_offsets_.push_back(block_offset);
+        block_offset += buf_->backing_block(i).size();
+    }
+    block_offsets_.push_back(block_offset);
+}
+
+hybridse::base::RefCountedSlice RpcRowDecoder::GetSlice(size_t offset, size_t size) const {
+    // the last block starting at or before offset
+    auto iter = std::upper_bound(block_offsets_.begin(), block_offsets_.end(), offset);
+    size_t block_idx = iter - block_offsets_.begin() - 1;
+    if (offset + size <= block_offsets_[block_idx + 1]) {
+        const char* data = buf_->backing_block(block_idx).data() + (offset - block_offsets_[block_idx]);
+        return hybridse::base::RefCountedSlice::CreateShared(data, size, buf_);
+    }
+    auto slice = hybridse::base::RefCountedSlice::Allocate(size);
+    buf_->copy_to(slice.buf(), size, offset);
+    return slice;
+}
+
+bool RpcRowDecoder::Decode(size_t offset, size_t size, size_t slice_num, hybridse::codec::Row* row) const {
+    if (row == nullptr) {
+        return false;
+    }
+    if (slice_num == 0 || size == 0) {
+        *row = hybridse::codec::Row();
+        return true;
+    }
+    size_t cur_offset = offset;
+    if (cur_offset >= buf_->size()) {
+        LOG(WARNING) << "Offset " << cur_offset << " out of bound, buf size=" << buf_->size();
+        return false;
+    }
+    for (size_t i = 0; i < slice_num; ++i) {
+        uint32_t slice_size;
+        buf_->copy_to(&slice_size, sizeof(uint32_t), cur_offset + 2);
+        size_t next_offset;
+        if (slice_size == 0) {
+            next_offset = cur_offset + 2 + sizeof(uint32_t);
+        } else {
+            next_offset = cur_offset + slice_size;
+        }
+        if (next_offset > buf_->size()) {
+            LOG(WARNING) << "Size " << slice_size << " for " << i
+                         << "th row slice out of bound, buf size=" << buf_->size() << " cur offset=" << cur_offset;
+            return false;
+        }
+        hybridse::base::RefCountedSlice slice;
+        if (slice_size != 0) {
+            slice = GetSlice(cur_offset, slice_size);
+        }
+        if (i == 0) {
+            *row = slice_size == 0 ? hybridse::codec::Row() : hybridse::codec::Row(slice);
+        } else {
+            row->Append(slice);
+        }
+        cur_offset = next_offset;
+    }
+    if (offset + size != cur_offset) {
+        LOG(WARNING) << "Illegal total row size " << (cur_offset - offset) << ", expect size=" << size;
+        return false;
+    }
+    return true;
+}
+
 bool EncodeRpcRow(const hybridse::codec::Row& row, butil::IOBuf* buf, size_t* total_size) {
     if (buf == nullptr) {
         return false;
@@ -105,5 +179,40 @@ bool EncodeRpcRow(const int8_t* buf, size_t size, butil::IOBuf* io_buf) {
     return true;
 }
 
+::openmldb::type::CompressType CompressAttachment(::openmldb::type::CompressType accept, size_t min_size,
+                                                  butil::IOBuf* buf) {
+    if (accept != ::openmldb::type::kSnappy || min_size == 0 || buf->size() < min_size) {
+        return ::openmldb::type::kNoCompress;
+    }
+    std::string raw = buf->to_string();
+    std::string compressed;
+    ::snappy::Compress(raw.data(), raw.size(), &compressed);
+    if (compressed.size() >= raw.size()) {
+        return ::openmldb::type::kNoCompress;
+    }
+    buf->clear();
+    buf->append(compressed);
+    return ::openmldb::type::kSnappy;
+}
+
+bool UncompressAttachment(::openmldb::type::CompressType compress_type, butil::IOBuf* buf) {
+    if (compress_type == ::openmldb::type::kNoCompress) {
+        return true;
+    }
+    if (compress_type != ::openmldb::type::kSnappy) {
+        LOG(WARNING) << "unsupported attachment compress type " << compress_type;
+        return false;
+    }
+    std::string compressed = buf->to_string();
+    std::string raw;
+    if (!::snappy::Uncompress(compressed.data(), compressed.size(), &raw)) {
+        LOG(WARNING) << "fail to uncompress the attachment of size " << compressed.size();
+        return false;
+    }
+    buf->clear();
+    buf->append(raw);
+    return true;
+}
+
 }  // namespace codec
 }  // namespace openmldb
@@ -26,6 +26,7 @@
 #include "butil/iobuf.h"
 #include "codec/fe_row_codec.h"
 #include "codec/row.h"
+#include "proto/type.pb.h"
 #include "sdk/base.h"
 
 namespace openmldb {
@@ -33,10 +34,51 @@ namespace codec {
 
 bool DecodeRpcRow(const butil::IOBuf& buf, size_t offset, size_t size, size_t slice_num, hybridse::codec::Row* row);
 
+// Decode the rows of an rpc attachment without copying them. The decoder shares the blocks of the IOBuf, and each row
+// slice references the block holding it, so the blocks stay pinned as long as any slice is alive. Only a slice which
+// spans several blocks is copied out.
+class RpcRowDecoder {
+ public:
+    explicit RpcRowDecoder(const butil::IOBuf& buf);
+
+    // same as DecodeRpcRow
+    bool Decode(size_t offset, size_t size, size_t slice_num, hybridse::codec::Row* row) const;
+
+    size_t size() const { return buf_->size(); }
+
+ private:
+    hybridse::base::RefCountedSlice GetSlice(size_t offset, size_t size) const;
+
+    std::shared_ptr<butil::IOBuf> buf_;
+    // the start offset of each backing block, and the buf size at last
+    std::vector<size_t> block_offsets_;
+};
+
 bool EncodeRpcRow(const hybridse::codec::Row& row, butil::IOBuf* buf, size_t* total_size);
 
 bool EncodeRpcRow(const int8_t* buf, size_t size, butil::IOBuf* io_buf);
 
+// Compress the attachment of a response in place by the compress type which the request accepts, if it takes at
+// least min_size bytes and it gets smaller. Return the compress type of the attachment, which is kNoCompress if it is
+// kept raw, e.g. min_size is 0 or the client does not know the compression
+::openmldb::type::CompressType CompressAttachment(::openmldb::type::CompressType accept, size_t min_size,
+                                                  butil::IOBuf* buf);
+
+bool UncompressAttachment(::openmldb::type::CompressType compress_type, butil::IOBuf* buf);
+
+// uncompress the attachment by the compress type in the response, and mark the response raw so it is done once
+template <class Response>
+bool UncompressResponseAttachment(Response* response, butil::IOBuf* buf) {
+    if (response->attachment_compress_type() == ::openmldb::type::kNoCompress) {
+        return true;
+    }
+    if (!UncompressAttachment(response->attachment_compress_type(), buf)) {
+        return false;
+    }
+    response->set_attachment_compress_type(::openmldb::type::kNoCompress);
+    return true;
+}
+
 }  // namespace codec
 }  // namespace openmldb
 #endif  // SRC_CODEC_SQL_RPC_ROW_CODEC_H_
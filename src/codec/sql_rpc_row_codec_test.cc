@@ -123,6 +123,81 @@ TEST_F(SqlRpcRowCodecTest, TestMultiSlice) {
     ASSERT_EQ(0, decoded.size(3));
 }
 
+TEST_F(SqlRpcRowCodecTest, TestDecoderWithoutCopy) {
+    hybridse::codec::Schema schema;
+    InitSchema(&schema);
+    hybridse::codec::RowBuilder builder(schema);
+
+    // enough rows to fill several blocks, so some rows span two blocks
+    const int row_num = 2000;
+    auto iobuf = std::make_unique<butil::IOBuf>();
+    std::vector<size_t> row_sizes;
+    for (int i = 0; i < row_num; ++i) {
+        std::string str = "row_" + std::to_string(i);
+        size_t buf_size = builder.CalTotalLength(str.size());
+        int8_t* buf = reinterpret_cast<int8_t*>(malloc(buf_size));
+        builder.SetBuffer(buf, buf_size);
+        builder.AppendInt32(i);
+        builder.AppendFloat(0.5);
+        builder.AppendString(str.data(), str.size());
+        hybridse::codec::Row row(hybridse::codec::RefCountedSlice::CreateManaged(buf, buf_size));
+        size_t total_size;
+        ASSERT_TRUE(EncodeRpcRow(row, iobuf.get(), &total_size));
+        row_sizes.push_back(total_size);
+    }
+    ASSERT_LT(1u, iobuf->backing_block_num());
+
+    std::vector<hybridse::codec::Row> rows(row_num);
+    {
+        RpcRowDecoder decoder(*iobuf);
+        size_t offset = 0;
+        for (int i = 0; i < row_num; ++i) {
+            ASSERT_TRUE(decoder.Decode(offset, row_sizes[i], 1, &rows[i]));
+            offset += row_sizes[i];
+        }
+        ASSERT_FALSE(decoder.Decode(offset, 10, 1, &rows[0]));
+    }
+    // the rows keep the blocks alive
+    iobuf.reset();
+
+    hybridse::codec::RowView row_view(schema);
+    for (int i = 0; i < row_num; ++i) {
+        row_view.Reset(rows[i].buf(0), rows[i].size(0));
+        ASSERT_EQ(i, row_view.GetInt32Unsafe(0));
+        ASSERT_FLOAT_EQ(0.5, row_view.GetFloatUnsafe(1));
+        ASSERT_EQ("row_" + std::to_string(i), row_view.GetStringUnsafe(2));
+    }
+}
+
+TEST_F(SqlRpcRowCodecTest, CompressAttachment) {
+    std::string rows;
+    for (int i = 0; i < 10000; ++i) {
+        rows.append("row_" + std::to_string(i % 100));
+    }
+    butil::IOBuf buf;
+    buf.append(rows);
+    // not compressed if the client does not accept it, the compression is off or the attachment is small
+    ASSERT_EQ(::openmldb::type::kNoCompress, CompressAttachment(::openmldb::type::kNoCompress, 1024, &buf));
+    ASSERT_EQ(::openmldb::type::kNoCompress, CompressAttachment(::openmldb::type::kSnappy, 0, &buf));
+    ASSERT_EQ(::openmldb::type::kNoCompress, CompressAttachment(::openmldb::type::kSnappy, rows.size() + 1, &buf));
+    ASSERT_EQ(rows, buf.to_string());
+
+    ASSERT_EQ(::openmldb::type::kSnappy, CompressAttachment(::openmldb::type::kSnappy, rows.size(), &buf));
+    ASSERT_LT(buf.size(), rows.size());
+    ASSERT_TRUE(UncompressAttachment(::openmldb::type::kSnappy, &buf));
+    ASSERT_EQ(rows, buf.to_string());
+
+    // the attachment not getting smaller is sent as it is
+    butil::IOBuf small;
+    small.append("abc");
+    ASSERT_EQ(::openmldb::type::kNoCompress, CompressAttachment(::openmldb::type::kSnappy, 1, &small));
+    ASSERT_EQ("abc", small.to_string());
+
+    butil::IOBuf broken;
+    broken.append("not snappy");
+    ASSERT_FALSE(UncompressAttachment(::openmldb::type::kSnappy, &broken));
+}
+
 }  // namespace codec
 }  // namespace openmldb
 
@@ -33,7 +33,26 @@ DEFINE_uint32(name_server_task_concurrency, 2, "config the concurrency of name_s
 DEFINE_uint32(name_server_task_concurrency_for_replica_cluster, 2,
               "config the concurrency of name_server_task for replica cluster");
 DEFINE_uint32(name_server_task_max_concurrency, 8, "config the max concurrency of name_server_task");
+DEFINE_uint32(name_server_task_lane_num, 0,
+              "config the count of the lanes the ops of the different partitions are hashed to and run in parallel, "
+              "the concurrency of the ops is not used then. 0 is disabled");
+DEFINE_uint32(name_server_task_concurrency_per_tablet, 0,
+              "config the max count of the running tasks of name_server_task on one tablet, 0 is unlimited");
+DEFINE_uint32(name_server_tablet_rpc_concurrency, 16,
+              "config the max count of the rpcs sent to the tablets at once to create or drop the partitions of a "
+              "table, 1 sends them one by one");
 DEFINE_int32(name_server_task_wait_time, 1000, "config the time of task wait");
+DEFINE_uint32(name_server_table_update_window_ms, 0,
+              "config the window in ms within which the partition status updates of the tables are written to "
+              "zookeeper together, 0 writes every update at once");
+DEFINE_uint32(name_server_zk_multi_max_bytes, 512 * 1024,
+              "config the max bytes of the table nodes written to zookeeper in one transaction");
+DEFINE_uint32(name_server_balance_interval_ms, 0,
+              "config the interval to move the leaders of the partitions from the tablet written most to the one "
+              "written least, 0 is disabled");
+DEFINE_double(name_server_balance_threshold, 1.5,
+              "config the ratio of the write rate of the tablet written most to the average above which a leader "
+              "is moved");
 DEFINE_uint32(name_server_op_execute_timeout, 2 * 60 * 60 * 1000, "config the timeout of nameserver op");
 DEFINE_bool(auto_failover, false, "enable or disable auto failover");
 DEFINE_bool(enable_timeseries_table, true, "enable or disable timeseries table");
@@ -48,28 +67,126 @@ DEFINE_int32(gc_pool_size, 2, "the size of tablet gc thread pool");
 DEFINE_int32(gc_safe_offset, 1, "the safe offset of tablet gc in minute");
 DEFINE_uint64(gc_on_table_recover_count, 10000000, "make a gc on recover count");
 DEFINE_uint32(gc_deleted_pk_version_delta, 2, "config the gc version delta");
+DEFINE_bool(enable_epoch_reclaim, false,
+            "free the memory retired by the gc once the readers started before are finished rather than after "
+            "gc_deleted_pk_version_delta rounds of the gc, a long scan delays the reclamation then");
+DEFINE_uint32(gc_slice_key_cnt, 0,
+              "the max count of keys visited in one gc slice of a segment, 0 means the whole segment in one gc");
+DEFINE_int32(gc_slice_interval, 100, "the interval in ms between two gc slices of a table");
+DEFINE_uint32(gc_expire_bucket_span, 0,
+              "the time span in minute of a bucket of the expire index which lets the absolute ttl gc only visit "
+              "the keys with expired rows, 0 is disabled");
+DEFINE_uint32(max_rows_per_key, 0,
+              "gc keeps at most the count of rows of the hot keys of an index beyond the ttl, 0 is disabled");
+DEFINE_uint32(cold_data_age, 0,
+              "the rows elder than it in minute are packed into compressed cold blocks by gc, 0 is disabled");
+DEFINE_uint32(cold_block_row_cnt, 64, "the max row count of a cold block");
+DEFINE_uint32(cold_block_dict_size, 0,
+              "the max size of the dictionary sampled from the rows of a segment to deflate its cold blocks, "
+              "0 is disabled and the cold blocks are compressed by snappy");
+DEFINE_uint32(schema_upgrade_row_cnt, 0,
+              "the max count of the rows of the older schema versions upgraded to the latest version in a round of "
+              "gc, then the reads of the table skip the dispatch of the versions. 0 is disabled");
 DEFINE_double(mem_release_rate, 5, "specify memory release rate, which should be in 0 ~ 10");
+DEFINE_uint32(max_memory_mb, 0, "the put is rejected if the memory tables of the tablet use more, 0 is disabled");
+DEFINE_uint32(max_table_memory_mb, 0,
+              "the put of a partition is rejected if its memory table uses more, 0 is disabled");
+DEFINE_double(soft_memory_limit_ratio, 0.8,
+              "a gc is made once the memory used reaches the ratio of max_memory_mb or max_table_memory_mb");
+DEFINE_int32(memory_check_interval, 1000, "the interval in ms of accounting the memory of the tables");
+DEFINE_bool(enable_warm_up, false, "compile the procedures before the tablet registers to zookeeper");
+DEFINE_uint32(procedure_compile_thread_num, 4, "the max count of threads compiling the procedures in parallel");
 DEFINE_int32(task_pool_size, 3, "the size of tablet task thread pool");
 DEFINE_int32(io_pool_size, 2, "the size of tablet io task thread pool");
 DEFINE_bool(use_name, false, "enable or disable use server name");
 DEFINE_string(data_dir, "./data", "the path of data dir");
 DEFINE_bool(enable_distsql, false, "enable or disable distribute sql");
 DEFINE_bool(enable_localtablet, true, "enable or disable local tablet opt when distribute sql circumstance");
+DEFINE_bool(enable_local_call, true,
+            "call the service in the same process, eg, the embedded tablet, directly instead of by the rpc");
+DEFINE_uint32(request_result_cache_size, 0,
+              "config the max number of cached results per request mode sql, 0 to disable the cache");
+DEFINE_string(jit_object_cache_dir, "",
+              "config the dir to keep the compiled sql objects across restarts, empty to disable");
+DEFINE_bool(enable_jit_tiered_compile, false,
+            "enable or disable compiling sql without optimization first and optimizing it in background");
+DEFINE_uint32(jit_compile_thread_num, 1, "config the max threads to optimize and compile a sql, 1 to compile serially");
+DEFINE_uint32(jit_pgo_profile_runs, 0,
+              "config the runs to profile a sql before it is optimized in tiered compile mode, 0 to disable");
+DEFINE_bool(enable_jit_inline_builtins, false,
+            "enable or disable linking the builtin function bitcode into the sql modules to inline the calls");
+DEFINE_uint32(batch_query_thread_num, 1,
+              "config the max threads to run a batch query across the local partitions or the window keys, "
+              "1 to run serially");
+DEFINE_uint32(request_branch_thread_num, 1,
+              "config the max threads to run the independent branches of a request mode sql, 1 to run serially");
+DEFINE_uint32(request_result_cache_ttl_ms, 1000, "config the ttl of the cached results of request mode sql");
+DEFINE_bool(enable_literal_parameterize, false,
+            "enable or disable compiling the batch queries differing only in the literals of where into one plan");
+DEFINE_bool(enable_sub_query_batch, true,
+            "config whether the sub queries of a request mode sql to the same tablet are sent in one rpc");
+DEFINE_uint32(batch_query_memory_budget_mb, 0,
+              "config the max memory of the rows partitioned and sorted by a batch query, 0 is unlimited");
+DEFINE_string(batch_query_spill_dir, "",
+              "config the dir of the temporary files of the rows beyond batch_query_memory_budget_mb, the query "
+              "fails beyond the budget if it is empty");
 
 // scan configuration
 DEFINE_uint32(scan_max_bytes_size, 2 * 1024 * 1024, "config the max size of scan bytes size");
+DEFINE_uint32(scan_zero_copy_min_size, 1024,
+              "the rows of a scan in memory not smaller than it are appended to the response attachment by "
+              "reference, 0 means always copy");
 DEFINE_uint32(scan_reserve_size, 1024, "config the size of vec reserve");
+DEFINE_uint32(partition_prefetch_num, 2,
+              "config the number of the partitions of a disk table opened ahead when a query iterates them");
+DEFINE_uint32(stream_max_bytes_size, 1024 * 1024 * 1024, "config the max size of the rows of a streamed query");
+DEFINE_uint32(stream_write_timeout_ms, 60000, "config the max time to wait for the client to read a streamed chunk");
+DEFINE_uint32(attachment_compress_min_size, 64 * 1024,
+              "the rows of a query or scan response are compressed by snappy if the client accepts it and they take "
+              "at least the bytes, 0 means never compress");
+DEFINE_string(attachment_accept_compress, "",
+              "the methods whose large response rows the client asks the tablets to compress by snappy, a comma "
+              "separated list of query, batch_request_query and scan, empty means none");
 DEFINE_uint32(preview_limit_max_num, 1000, "config the max num of preview limit");
 DEFINE_uint32(preview_default_limit, 100, "config the default limit of preview");
 // binlog configuration
 DEFINE_int32(binlog_single_file_max_size, 1024 * 4, "the max size of single binlog file");
 DEFINE_int32(binlog_sync_batch_size, 32, "the batch size of sync binlog");
 DEFINE_bool(binlog_notify_on_put, false, "config the sync log to follower strategy");
-DEFINE_bool(binlog_enable_crc, false, "enable crc");
+DEFINE_bool(binlog_enable_crc, true, "enable crc");
 DEFINE_int32(binlog_coffee_time, 1000, "config the coffee time");
 DEFINE_int32(binlog_sync_wait_time, 100, "config the sync log wait time");
 DEFINE_int32(binlog_sync_to_disk_interval, 20000, "config the interval of sync binlog to disk time");
+DEFINE_uint32(binlog_durability, 0,
+              "the durability of the binlog append of put, 0 means the binlog is synced to disk periodically and 1 "
+              "means it is synced before the put returns");
+DEFINE_uint32(binlog_group_commit_size, 128, "the max count of entries committed to binlog in one group");
+DEFINE_uint32(binlog_cache_entry_cnt, 1024,
+              "the count of the latest binlog entries of a leader kept in memory for replication, 0 is disabled");
+DEFINE_string(binlog_compression, "off",
+              "Type of binlog record compression, can be off, snappy, zlib. The requests to followers are compressed "
+              "too");
+DEFINE_string(binlog_direct_io_root_path, "",
+              "the db root paths whose binlog is written with direct io and preallocation, separated by comma");
+DEFINE_uint32(binlog_preallocate_size, 64, "the size in MB of binlog space preallocated at a time for direct io");
+DEFINE_bool(binlog_async_io, false,
+            "write binlog on the io threads, so that the puts are not blocked by the disk");
+DEFINE_uint32(binlog_io_thread_num, 2, "the thread num of binlog async io");
+DEFINE_uint32(binlog_sync_window, 1,
+              "the count of append entries requests to a follower sent without waiting for the responses");
+DEFINE_uint32(replica_cluster_sync_window, 0,
+              "the binlog_sync_window of the followers in the replica clusters, which are across the wan and wait "
+              "longer for the responses. 0 is the same as binlog_sync_window");
+DEFINE_uint32(replica_cluster_sync_batch_size, 0,
+              "the binlog_sync_batch_size of the followers in the replica clusters. 0 is the same as "
+              "binlog_sync_batch_size");
+DEFINE_string(replica_cluster_binlog_compression, "",
+              "the compression of the requests to the followers in the replica clusters, can be off, snappy, zlib. "
+              "empty is the same as binlog_compression");
 DEFINE_int32(binlog_delete_interval, 60000, "config the interval of delete binlog");
+DEFINE_int32(binlog_aggregate_interval, 10000,
+             "the interval in ms to aggregate the binlog into the pre-aggregation tables");
+DEFINE_uint32(binlog_aggregate_max_cnt, 100000, "the max count of binlog entries aggregated at a time");
 DEFINE_int32(binlog_match_logoffset_interval, 1000, "config the interval of match log offset ");
 DEFINE_int32(binlog_name_length, 8, "binlog name length");
 DEFINE_uint32(check_binlog_sync_progress_delta, 100000, "config the delta of check binlog sync progress");
@@ -77,6 +194,15 @@ DEFINE_uint32(go_back_max_try_cnt, 10, "config max try time of go back");
 
 DEFINE_uint32(put_slow_log_threshold, 50000, "config the threshold of put slow log");
 DEFINE_uint32(query_slow_log_threshold, 50000, "config the threshold of query slow log");
+DEFINE_uint32(query_trace_sample_interval, 0,
+              "record the time of the stages of one in the interval requests of a deployment to bvars, 0 to disable");
+DEFINE_string(workload_capture_path, "",
+              "capture the query, batch request query and put requests to the file to be replayed, empty to disable");
+DEFINE_uint32(workload_capture_sample_interval, 1, "capture one in the interval requests");
+DEFINE_uint64(workload_capture_max_size, 1024 * 1024 * 1024, "stop the capture when the file reaches the bytes");
+DEFINE_bool(enable_procedure_profile, false,
+            "record the runs of the plan nodes of the compiled sql and register the jit functions to perf, "
+            "for ProfileProcedure");
 
 // local db config
 DEFINE_string(db_root_path, "/tmp/", "the root path of db");
@@ -84,21 +210,47 @@ DEFINE_string(db_root_path, "/tmp/", "the root path of db");
 // thread pool config
 DEFINE_int32(scan_concurrency_limit, 8, "the limit of scan concurrency");
 DEFINE_int32(put_concurrency_limit, 8, "the limit of put concurrency");
+DEFINE_uint32(put_worker_num, 0,
+              "the count of the workers the puts of a partition are hashed to and run by one after another, "
+              "0 runs the puts on the rpc threads");
 DEFINE_int32(thread_pool_size, 16, "the size of thread pool for other api");
 DEFINE_int32(get_concurrency_limit, 8, "the limit of get concurrency");
+DEFINE_uint32(query_procedure_concurrency_limit, 0,
+              "the max requests of a deployment running on a tablet, the others are rejected. 0 is unlimited");
+DEFINE_uint32(query_batch_concurrency_limit, 0,
+              "the max queries not of the deployments running on a tablet, the half while deployments are running. "
+              "0 is unlimited");
+DEFINE_uint32(query_batch_wait_ms, 1000, "the time a query not of the deployments waits to run before it is rejected");
 DEFINE_int32(request_max_retry, 3, "max retry time when request error");
 DEFINE_int32(request_timeout_ms, 20000, "request timeout");
 DEFINE_int32(request_sleep_time, 1000, "the sleep time when request error");
 
 DEFINE_uint32(max_traverse_cnt, 50000, "max traverse iter loop cnt");
+DEFINE_uint32(traverse_cursor_ttl, 60000,
+              "the ms the iterator of a traverse is kept for the next page asked with its cursor, 0 means no cursor");
+DEFINE_uint32(traverse_cursor_max_cnt, 1024, "the max count of the traverse cursors kept by a tablet");
+
+// apiserver config
+DEFINE_uint32(api_server_procedure_batch_window_us, 0,
+              "config the window in us within which the single row calls of a procedure in apiserver are sent in "
+              "one batch request, 0 is disabled");
+DEFINE_uint32(api_server_max_procedure_batch_size, 64,
+              "config the max number of the procedure calls in apiserver sent in one batch request");
 
 DEFINE_uint32(task_check_interval, 1000, "config the check interval of task");
 
 DEFINE_int32(send_file_max_try, 3, "the max retry time when send file failed");
 DEFINE_int32(retry_send_file_wait_time_ms, 3000, "conf the wait time when retry send file");
+DEFINE_uint32(send_file_thread_num, 4, "the thread num to send the files of a snapshot in parallel");
 DEFINE_int32(stream_close_wait_time_ms, 1000, "the wait time before close stream");
 DEFINE_uint32(stream_block_size, 1 * 1204 * 1024, "config the write/read block size in streaming");
 DEFINE_int32(stream_bandwidth_limit, 10 * 1204 * 1024, "the limit bandwidth. Byte/Second");
+DEFINE_uint64(background_disk_io_limit, 0,
+              "the bytes per second of the background io on a disk, which the snapshot and index dump writes, the "
+              "snapshot sends and the deletes of the binlogs and the recycle bin take from. The data dirs on one "
+              "device share the limit and the binlog appends are not limited. 0 is no limit");
+DEFINE_uint64(stream_node_bandwidth_limit, 0,
+              "the limit bandwidth of all the files sent by the tablet. Byte/Second, 0 means no limit");
 
 // if set 23, the task will execute 23:00 every day
 DEFINE_int32(make_snapshot_time, 23, "config the time to make snapshot");
@@ -109,7 +261,16 @@ DEFINE_uint32(make_snapshot_offline_interval, 60 * 60 * 24,
               "config tablet self makesnapshot when how long time do not "
               "makesnapshot from ns. unit is second");
 DEFINE_string(snapshot_compression, "off", "Type of snapshot compression, can be off, snappy, zlib");
+DEFINE_bool(snapshot_mmap, false,
+            "write a mapped sidecar with every snapshot and recover the table from it without copying the rows");
+DEFINE_uint32(snapshot_delta_max_num, 0,
+              "the max count of delta snapshots written from binlog before they are merged into a full snapshot, "
+              "0 disables delta snapshot");
 DEFINE_int32(snapshot_pool_size, 1, "the size of tablet thread pool for making snapshot");
+DEFINE_uint32(background_thread_num, 0,
+              "the threads running the background tasks of the tablet, the tasks of keep alive, io, task, gc and "
+              "snapshot pools are run in the order of the priority and each pool runs at most its size of them. 0 "
+              "is the sum of the pool sizes plus one for keep alive");
 
 DEFINE_uint32(load_index_max_wait_time, 120 * 60 * 1000, "config the max wait time of load index");
 
@@ -120,9 +281,31 @@ DEFINE_uint32(recycle_ttl, 0, "ttl of recycle in minute");
 DEFINE_uint32(latest_ttl_max, 1000, "the max ttl of latest");
 DEFINE_uint32(absolute_ttl_max, 60 * 24 * 365 * 30, "the max ttl of absolute time");
 DEFINE_uint32(skiplist_max_height, 12, "the max height of skiplist");
+DEFINE_uint32(pk_bloom_filter_bits_per_key, 0,
+              "the bits per key of the bloom filter of the keys of a segment, which answers the lookups of the "
+              "missing keys without searching the skiplist, 0 is disabled");
+DEFINE_bool(enable_pk_hash_index, false,
+            "keep a hash index of the keys of a segment besides the skiplist for the point lookups of the keys");
 DEFINE_uint32(key_entry_max_height, 8, "the max height of key entry");
+DEFINE_uint32(key_entry_grow_cnt, 8,
+              "a key entry is a sorted list until it has more rows than it and grows into a skiplist then, "
+              "0 means it is a skiplist from the start");
+DEFINE_uint32(latest_ttl_trim_slack, 0,
+              "the keys of a latest ttl index are trimmed at put once they have it more rows than the ttl "
+              "rather than by the gc, 0 is disabled");
 DEFINE_uint32(latest_default_skiplist_height, 1, "the default height of skiplist for latest table");
 DEFINE_uint32(absolute_default_skiplist_height, 4, "the default height of skiplist for absolute table");
+DEFINE_bool(enable_concurrent_put, false, "enable or disable lock free concurrent put in segment");
+DEFINE_bool(enable_datablock_pool, false, "enable or disable the slab pool of data block in memtable");
+DEFINE_uint32(numa_node_cnt, 0,
+              "spread the partitions over the numa nodes and put the rows of a partition in the pool on its node, "
+              "the data block pool is enabled with it. 0 is disabled");
+DEFINE_bool(datablock_pool_huge_page, false,
+            "carve the slabs of the data block pool out of the 2MB huge pages, which are mapped from hugetlbfs or "
+            "the transparent huge pages if none is reserved");
+DEFINE_uint32(datablock_pool_time_bucket, 0,
+              "the minutes of a time bucket of the data block pool of the absolute ttl tables, the rows of a bucket "
+              "share the slabs so they are released together as the rows expire, 0 is disabled");
 DEFINE_bool(enable_show_tp, false, "enable show tp");
 DEFINE_uint32(max_col_display_length, 256, "config the max length of column display");
 
@@ -140,6 +323,11 @@ DEFINE_bool(verify_compression, false, "For debug");
 DEFINE_uint32(load_table_batch, 30, "set laod table batch size");
 DEFINE_uint32(load_table_thread_num, 3, "set load tabale thread pool size");
 DEFINE_uint32(load_table_queue_size, 1000, "set load tabale queue size");
+DEFINE_uint32(extract_index_thread_num, 1,
+              "the count of threads to extract the data of a new index from the snapshot, in batches of "
+              "load_table_batch records");
+DEFINE_uint32(binlog_replay_thread_num, 1,
+              "the count of threads to replay the binlog on table loading, the binlog is replayed in order if it is 1");
 
 // multiple data center
 DEFINE_uint32(get_replica_status_interval, 10000, "config the interval to sync replica cluster status time");
@@ -0,0 +1,240 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "log/async_writable_file.h"
+
+#include <gflags/gflags.h>
+
+#include <algorithm>
+#include <utility>
+
+using ::openmldb::base::Slice;
+using ::openmldb::base::Status;
+
+DECLARE_uint32(binlog_io_thread_num);
+
+namespace openmldb {
+namespace log {
+
+// the appends block when the bytes not written reach the limit
+static const uint64_t kMaxPendingBytes = 64 * 1024 * 1024;
+
+LogIOService::LogIOService(uint32_t thread_num) : workers_(), next_shard_(0) {
+    thread_num = std::max(thread_num, 1u);
+    for (uint32_t i = 0; i < thread_num; i++) {
+        workers_.emplace_back(new Worker());
+        Worker* worker = workers_.back().get();
+        worker->thread = std::thread(&LogIOService::Run, this, worker);
+    }
+}
+
+LogIOService::~LogIOService() {
+    for (auto& worker : workers_) {
+        {
+            std::lock_guard<std::mutex> lock(worker->mu);
+            worker->stop = true;
+        }
+        worker->cv.notify_one();
+        worker->thread.join();
+    }
+}
+
+LogIOService* LogIOService::Default() {
+    // never destroyed, the files may be closed during the exit
+    static LogIOService* service = new LogIOService(FLAGS_binlog_io_thread_num);
+    return service;
+}
+
+uint32_t LogIOService::NextShard() { return next_shard_.fetch_add(1, std::memory_order_relaxed) % workers_.size(); }
+
+void LogIOService::Submit(uint32_t shard, std::function<void()>&& task) {
+    Worker* worker = workers_[shard % workers_.size()].get();
+    {
+        std::lock_guard<std::mutex> lock(worker->mu);
+        worker->tasks.push_back(std::move(task));
+    }
+    worker->cv.notify_one();
+}
+
+void LogIOService::Run(Worker* worker) {
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(worker->mu);
+            worker->cv.wait(lock, [worker] { return worker->stop || !worker->tasks.empty(); });
+            if (worker->tasks.empty()) {
+                return;
+            }
+            task = std::move(worker->tasks.front());
+            worker->tasks.pop_front();
+        }
+        task();
+    }
+}
+
+AsyncWritableFile::AsyncWritableFile(WritableFile* file, LogIOService* service)
+    : file_(file),
+      service_(service),
+      shard_(service->NextShard()),
+      mu_(),
+      cv_(),
+      buf_(),
+      pending_bytes_(0),
+      write_scheduled_(false),
+      closed_(false),
+      status_() {}
+
+AsyncWritableFile::~AsyncWritableFile() {
+    // Ignoring any potential errors
+    Close();
+}
+
+Status AsyncWritableFile::Append(const Slice& data) {
+    std::unique_lock<std::mutex> lock(mu_);
+    if (pending_bytes_ >= kMaxPendingBytes) {
+        ScheduleWrite();
+        cv_.wait(lock, [this] { return pending_bytes_ < kMaxPendingBytes || !status_.ok(); });
+    }
+    if (!status_.ok()) {
+        return status_;
+    }
+    buf_.append(data.data(), data.size());
+    pending_bytes_ += data.size();
+    wsize_ += data.size();
+    return Status::OK();
+}
+
+Status AsyncWritableFile::Flush() {
+    std::lock_guard<std::mutex> lock(mu_);
+    if (!status_.ok()) {
+        return status_;
+    }
+    ScheduleWrite();
+    return Status::OK();
+}
+
+Status AsyncWritableFile::Sync() {
+    std::mutex mu;
+    std::condition_variable cv;
+    bool done = false;
+    Status result;
+    SyncAsync([&](const Status& status) {
+        std::lock_guard<std::mutex> lock(mu);
+        result = status;
+        done = true;
+        cv.notify_one();
+    });
+    std::unique_lock<std::mutex> lock(mu);
+    cv.wait(lock, [&done] { return done; });
+    return result;
+}
+
+void AsyncWritableFile::SyncAsync(const IOCallback& done) {
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        ScheduleWrite();
+    }
+    // the write scheduled before runs ahead on the same thread
+    service_->Submit(shard_, [this, done] {
+        Status status = GetStatus();
+        if (status.ok()) {
+            status = file_->Sync();
+            if (!status.ok()) {
+                std::lock_guard<std::mutex> lock(mu_);
+                status_ = status;
+            }
+        }
+        done(status);
+    });
+}
+
+Status AsyncWritableFile::Close() {
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        if (closed_) {
+            return status_;
+        }
+        closed_ = true;
+        ScheduleWrite();
+    }
+    return RunAndWait([this] {
+        Status status = GetStatus();
+        Status close_status = file_->Close();
+        return status.ok() ? close_status : status;
+    });
+}
+
+void AsyncWritableFile::ScheduleWrite() {
+    if (write_scheduled_ || buf_.empty()) {
+        return;
+    }
+    write_scheduled_ = true;
+    service_->Submit(shard_, [this] { WriteBuffer(); });
+}
+
+void AsyncWritableFile::WriteBuffer() {
+    std::string data;
+    while (true) {
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            pending_bytes_ -= data.size();
+            // the data left is dropped after an io error
+            if (buf_.empty() || !status_.ok()) {
+                buf_.clear();
+                pending_bytes_ = 0;
+                write_scheduled_ = false;
+                cv_.notify_all();
+                return;
+            }
+            data.clear();
+            data.swap(buf_);
+            cv_.notify_all();
+        }
+        Status status = file_->Append(Slice(data));
+        if (status.ok()) {
+            status = file_->Flush();
+        }
+        if (!status.ok()) {
+            std::lock_guard<std::mutex> lock(mu_);
+            status_ = status;
+        }
+    }
+}
+
+Status AsyncWritableFile::GetStatus() {
+    std::lock_guard<std::mutex> lock(mu_);
+    return status_;
+}
+
+Status AsyncWritableFile::RunAndWait(const std::function<Status()>& task) {
+    std::mutex mu;
+    std::condition_variable cv;
+    bool done = false;
+    Status result;
+    service_->Submit(shard_, [&] {
+        Status status = task();
+        std::lock_guard<std::mutex> lock(mu);
+        result = status;
+        done = true;
+        cv.notify_one();
+    });
+    std::unique_lock<std::mutex> lock(mu);
+    cv.wait(lock, [&done] { return done; });
+    return result;
+}
+
+}  // namespace log
+}  // namespace openmldb
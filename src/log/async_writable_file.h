@@ -0,0 +1,110 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_LOG_ASYNC_WRITABLE_FILE_H_
+#define SRC_LOG_ASYNC_WRITABLE_FILE_H_
+
+#include <stdint.h>
+
+#include <atomic>
+#include <condition_variable>  // NOLINT
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "base/slice.h"
+#include "base/status.h"
+#include "log/writable_file.h"
+
+namespace openmldb {
+namespace log {
+
+// Runs the io of log files on background threads. The tasks submitted to the
+// same shard run in order on one thread
+class LogIOService {
+ public:
+    explicit LogIOService(uint32_t thread_num);
+    ~LogIOService();
+
+    // the service shared by all log files, its thread num is binlog_io_thread_num
+    static LogIOService* Default();
+
+    // pick the shard of a new file in turn
+    uint32_t NextShard();
+
+    void Submit(uint32_t shard, std::function<void()>&& task);
+
+ private:
+    struct Worker {
+        std::mutex mu;
+        std::condition_variable cv;
+        std::deque<std::function<void()>> tasks;
+        bool stop = false;
+        std::thread thread;
+    };
+
+    void Run(Worker* worker);
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::atomic<uint32_t> next_shard_;
+};
+
+// Appends to a memory buffer and writes it to the wrapped file on the io
+// service, so the writers are not blocked by the disk. Flush only schedules
+// the write and Sync blocks until the data is synced, use SyncAsync to get
+// notified instead. An io error fails all the following calls
+class AsyncWritableFile : public WritableFile {
+ public:
+    // take the ownership of file
+    AsyncWritableFile(WritableFile* file, LogIOService* service);
+    ~AsyncWritableFile();
+
+    base::Status Append(const base::Slice& data) override;
+    base::Status Close() override;
+    base::Status Flush() override;
+    base::Status Sync() override;
+    void SyncAsync(const IOCallback& done) override;
+
+ private:
+    // schedule a write of the buffer if there is none, mu_ must be held
+    void ScheduleWrite();
+    // write the buffer until it is empty, it runs on the io thread
+    void WriteBuffer();
+    base::Status GetStatus();
+    // run task on the io thread after the tasks submitted before and wait for it
+    base::Status RunAndWait(const std::function<base::Status()>& task);
+
+    std::unique_ptr<WritableFile> file_;
+    LogIOService* service_;
+    uint32_t shard_;
+    std::mutex mu_;
+    std::condition_variable cv_;
+    std::string buf_;
+    // the bytes appended but not written yet
+    uint64_t pending_bytes_;
+    bool write_scheduled_;
+    bool closed_;
+    base::Status status_;
+};
+
+}  // namespace log
+}  // namespace openmldb
+
+#endif  // SRC_LOG_ASYNC_WRITABLE_FILE_H_
@@ -19,11 +19,21 @@
 // found in the LICENSE file. See the AUTHORS file for names of contributors.
 //
 // A portable implementation of crc32c, optimized to handle
-// four bytes at a time.
+// four bytes at a time. The crc instructions of sse4.2 or armv8 are used
+// instead if the cpu supports them.
 
 #include "log/crc32c.h"
 
 #include <stdint.h>
+#include <string.h>
+
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#elif defined(__aarch64__) && defined(__linux__)
+#include <arm_acle.h>
+#include <asm/hwcap.h>
+#include <sys/auxv.h>
+#endif
 
 #include "base/port.h"
 #include "log/coding.h"
@@ -155,7 +165,7 @@ static const uint32_t table3_[256] = {
 // Used to fetch a naturally-aligned 32-bit word in little endian byte-order
 static inline uint32_t LE_LOAD32(const uint8_t *p) { return DecodeFixed32(reinterpret_cast<const char *>(p)); }
 
-uint32_t Extend(uint32_t crc, const char *buf, size_t size) {
+static uint32_t ExtendPortable(uint32_t crc, const char *buf, size_t size) {
     const uint8_t *p = reinterpret_cast<const uint8_t *>(buf);
     const uint8_t *e = p + size;
     uint32_t l = crc ^ 0xffffffffu;
@@ -202,5 +212,132 @@ uint32_t Extend(uint32_t crc, const char *buf, size_t size) {
     return l ^ 0xffffffffu;
 }
 
+#if defined(__x86_64__) || (defined(__aarch64__) && defined(__linux__))
+// The crc instruction has a latency of 3 cycles but a throughput of 1, so a
+// large block is split into three streams computed together, and their crcs
+// are combined by the tables appending the zeros of the length of a stream.
+static const size_t kLongStream = 8192;
+static const size_t kShortStream = 256;
+
+typedef uint32_t ZeroTable[4][256];
+
+// the crc of x followed by len zero bytes, before the final xor
+static uint32_t AppendZeros(uint32_t x, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        x = table0_[x & 0xff] ^ (x >> 8);
+    }
+    return x;
+}
+
+// appending zeros is linear, so a 32 bit crc is shifted by the xor of the
+// shifts of its bytes
+static void InitZeroTable(size_t len, ZeroTable table) {
+    uint32_t bits[32];
+    for (int i = 0; i < 32; i++) {
+        bits[i] = AppendZeros(1u << i, len);
+    }
+    for (int k = 0; k < 4; k++) {
+        for (uint32_t n = 0; n < 256; n++) {
+            uint32_t v = 0;
+            for (int b = 0; b < 8; b++) {
+                if (n & (1u << b)) {
+                    v ^= bits[8 * k + b];
+                }
+            }
+            table[k][n] = v;
+        }
+    }
+}
+
+struct ZeroTables {
+    ZeroTable long_stream;
+    ZeroTable short_stream;
+    ZeroTables() {
+        InitZeroTable(kLongStream, long_stream);
+        InitZeroTable(kShortStream, short_stream);
+    }
+};
+
+static const ZeroTables &GetZeroTables() {
+    static const ZeroTables tables;
+    return tables;
+}
+
+static inline uint32_t Shift(const ZeroTable table, uint32_t crc) {
+    return table[0][crc & 0xff] ^ table[1][(crc >> 8) & 0xff] ^ table[2][(crc >> 16) & 0xff] ^ table[3][crc >> 24];
+}
+
+static inline uint64_t Load64(const uint8_t *p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+#if defined(__x86_64__)
+#define CRC_TARGET __attribute__((target("sse4.2")))
+CRC_TARGET static inline uint32_t Crc8(uint32_t crc, uint8_t v) { return _mm_crc32_u8(crc, v); }
+CRC_TARGET static inline uint32_t Crc64(uint32_t crc, uint64_t v) {
+    return static_cast<uint32_t>(_mm_crc32_u64(crc, v));
+}
+static bool HasCrcInstruction() { return __builtin_cpu_supports("sse4.2"); }
+#else
+#define CRC_TARGET __attribute__((target("+crc")))
+CRC_TARGET static inline uint32_t Crc8(uint32_t crc, uint8_t v) { return __crc32cb(crc, v); }
+CRC_TARGET static inline uint32_t Crc64(uint32_t crc, uint64_t v) { return __crc32cd(crc, v); }
+static bool HasCrcInstruction() { return (getauxval(AT_HWCAP) & HWCAP_CRC32) != 0; }
+#endif
+
+// Process the streams of len bytes from p, return the crc of all of them
+CRC_TARGET static inline uint32_t ExtendStreams(uint32_t l, const uint8_t *p, size_t len, const ZeroTable table) {
+    uint32_t l1 = 0;
+    uint32_t l2 = 0;
+    const uint8_t *e = p + len;
+    do {
+        l = Crc64(l, Load64(p));
+        l1 = Crc64(l1, Load64(p + len));
+        l2 = Crc64(l2, Load64(p + 2 * len));
+        p += 8;
+    } while (p < e);
+    l = Shift(table, l) ^ l1;
+    return Shift(table, l) ^ l2;
+}
+
+CRC_TARGET static uint32_t ExtendHardware(uint32_t crc, const char *buf, size_t size) {
+    const uint8_t *p = reinterpret_cast<const uint8_t *>(buf);
+    const uint8_t *e = p + size;
+    uint32_t l = crc ^ 0xffffffffu;
+    const ZeroTables &tables = GetZeroTables();
+    while (p != e && (reinterpret_cast<uintptr_t>(p) & 7) != 0) {
+        l = Crc8(l, *p++);
+    }
+    while (static_cast<size_t>(e - p) >= 3 * kLongStream) {
+        l = ExtendStreams(l, p, kLongStream, tables.long_stream);
+        p += 3 * kLongStream;
+    }
+    while (static_cast<size_t>(e - p) >= 3 * kShortStream) {
+        l = ExtendStreams(l, p, kShortStream, tables.short_stream);
+        p += 3 * kShortStream;
+    }
+    while (e - p >= 8) {
+        l = Crc64(l, Load64(p));
+        p += 8;
+    }
+    while (p != e) {
+        l = Crc8(l, *p++);
+    }
+    return l ^ 0xffffffffu;
+}
+#undef CRC_TARGET
+
+typedef uint32_t (*ExtendFunc)(uint32_t, const char *, size_t);
+
+uint32_t Extend(uint32_t crc, const char *buf, size_t size) {
+    static const ExtendFunc extend = HasCrcInstruction() ? ExtendHardware : ExtendPortable;
+    return extend(crc, buf, size);
+}
+#else
+uint32_t Extend(uint32_t crc, const char *buf, size_t size) { return ExtendPortable(crc, buf, size); }
+#endif
+
 }  // namespace log
 }  // namespace openmldb
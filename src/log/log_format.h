@@ -38,12 +38,16 @@ enum RecordType {
     kMiddleType = 3,
     kLastType = 4,
     // The end of log file
-    kEofType = 5
+    kEofType = 5,
+    // For the records whose payload is compressed by the writer,
+    // the following fragments are kMiddleType and kLastType
+    kCompressedFullType = 6,
+    kCompressedFirstType = 7
 };
 
 enum CompressType { kNoCompress = 0, kZlib = 1, kSnappy = 2 };
 
-static const int kMaxRecordType = kEofType;
+static const int kMaxRecordType = kCompressedFirstType;
 
 static const uint32_t kBlockSize = 4 * 1024;
 
@@ -60,6 +64,13 @@ static const uint32_t kHeaderSizeForCompress = 4 + 4 + 1;
 // compress_len(4 bytes), compress_type(1 byte)
 static const uint32_t kHeaderSizeOfCompressBlock = 64;
 
+// the payload of a compressed record is
+// compress_type(1 byte), uncompressed length(4 bytes), compressed data
+static const uint32_t kHeaderSizeOfCompressRecord = 1 + 4;
+
+// the smaller records are not worth compressing
+static const uint32_t kMinCompressRecordSize = 256;
+
 static const std::string ZLIB_COMPRESS_SUFFIX = ".zlib";      // NOLINT
 static const std::string SNAPPY_COMPRESS_SUFFIX = ".snappy";  // NOLINT
 
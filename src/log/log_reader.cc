@@ -110,6 +110,8 @@ Status Reader::ReadRecord(Slice* record, std::string* scratch) {
     scratch->clear();
     record->clear();
     bool in_fragmented_record = false;
+    // the payload of the fragmented record is compressed
+    bool compressed_record = false;
     // Record offset of the logical record that we're reading
     // 0 is a dummy value to make compilers happy
     uint64_t prospective_record_offset = 0;
@@ -137,6 +139,7 @@ Status Reader::ReadRecord(Slice* record, std::string* scratch) {
 
         switch (record_type) {
             case kFullType:
+            case kCompressedFullType:
                 if (in_fragmented_record) {
                     // Handle bug in earlier versions of log::Writer where
                     // it could emit an empty kFirstType record at the tail end
@@ -149,6 +152,10 @@ Status Reader::ReadRecord(Slice* record, std::string* scratch) {
                 prospective_record_offset = physical_record_offset;
                 scratch->clear();
                 *record = fragment;
+                if (record_type == kCompressedFullType && !UncompressRecord(fragment, scratch, record)) {
+                    ReportCorruption(fragment.size(), "fail to uncompress record");
+                    return Status::InvalidRecord(Slice("fail to uncompress record"));
+                }
                 last_record_offset_ = prospective_record_offset;
                 last_record_end_offset_ = end_of_buffer_offset_ - buffer_.size();
                 if (offset) {
@@ -168,6 +175,7 @@ Status Reader::ReadRecord(Slice* record, std::string* scratch) {
                 return Status::WaitRecord();
 
             case kFirstType:
+            case kCompressedFirstType:
                 if (in_fragmented_record) {
                     // Handle bug in earlier versions of log::Writer where
                     // it could emit an empty kFirstType record at the tail end
@@ -180,6 +188,7 @@ Status Reader::ReadRecord(Slice* record, std::string* scratch) {
                 prospective_record_offset = physical_record_offset;
                 scratch->assign(fragment.data(), fragment.size());
                 in_fragmented_record = true;
+                compressed_record = record_type == kCompressedFirstType;
                 break;
 
             case kMiddleType:
@@ -202,6 +211,11 @@ Status Reader::ReadRecord(Slice* record, std::string* scratch) {
                 } else {
                     scratch->append(fragment.data(), fragment.size());
                     *record = Slice(*scratch);
+                    if (compressed_record && !UncompressRecord(Slice(*scratch), scratch, record)) {
+                        ReportCorruption(scratch->size(), "fail to uncompress record");
+                        scratch->clear();
+                        return Status::InvalidRecord(Slice("fail to uncompress record"));
+                    }
                     last_record_offset_ = prospective_record_offset;
                     last_record_end_offset_ = end_of_buffer_offset_ - buffer_.size();
                     if (offset) {
@@ -243,6 +257,47 @@ Status Reader::ReadRecord(Slice* record, std::string* scratch) {
     return Status::IOError("");
 }
 
+bool Reader::UncompressRecord(const Slice& payload, std::string* scratch, Slice* record) {
+    if (payload.size() < kHeaderSizeOfCompressRecord) {
+        PDLOG(WARNING, "bad compressed record size %lu", payload.size());
+        return false;
+    }
+    CompressType compress_type = static_cast<CompressType>(payload.data()[0]);
+    uint32_t raw_len = DecodeFixed32(payload.data() + 1);
+    const char* data = payload.data() + kHeaderSizeOfCompressRecord;
+    size_t len = payload.size() - kHeaderSizeOfCompressRecord;
+    // payload may refer to scratch
+    std::string raw(raw_len, '\0');
+    switch (compress_type) {
+        case kSnappy: {
+            size_t uncompress_len = 0;
+            if (!snappy::GetUncompressedLength(data, len, &uncompress_len) || uncompress_len != raw_len ||
+                !snappy::RawUncompress(data, len, &raw[0])) {
+                PDLOG(WARNING, "fail to uncompress record, compress type: %d", compress_type);
+                return false;
+            }
+            break;
+        }
+        case kZlib: {
+            uLongf uncompress_len = raw_len;
+            int res = uncompress(reinterpret_cast<Bytef*>(&raw[0]), &uncompress_len,
+                                 reinterpret_cast<const Bytef*>(data), len);
+            if (res != Z_OK || uncompress_len != raw_len) {
+                PDLOG(WARNING, "fail to uncompress record, error code: %d, compress type: %d", res, compress_type);
+                return false;
+            }
+            break;
+        }
+        default: {
+            PDLOG(WARNING, "unsupported record compress type: %d", compress_type);
+            return false;
+        }
+    }
+    scratch->swap(raw);
+    *record = Slice(*scratch);
+    return true;
+}
+
 uint64_t Reader::LastRecordOffset() { return last_record_offset_; }
 
 uint64_t Reader::LastRecordEndOffset() { return last_record_end_offset_; }
@@ -383,6 +438,12 @@ unsigned int Reader::ReadPhysicalRecord(Slice* result, uint64_t& offset) {
         DEBUGLOG("end of file %d, header size %d data length %d", buffer_.size(), header_size_, length);
         return kWaitRecord;
     }
+    // the tail page of a file written with direct io is padded with zeros
+    if (type == kZeroType && length == 0 && DecodeFixed32(header) == 0) {
+        DEBUGLOG("reach the padding of file");
+        buffer_.clear();
+        return kWaitRecord;
+    }
     // Check crc
     if (checksum_) {
         uint32_t expected_crc = Unmask(DecodeFixed32(header));
@@ -448,6 +509,31 @@ LogReader::~LogReader() {
 
 void LogReader::SetOffset(uint64_t start_offset) { start_offset_ = start_offset; }
 
+int LogReader::GetLogPartIndex(uint64_t offset) {
+    int index = -1;
+    LogParts::Iterator* it = logs_->NewIterator();
+    it->SeekToFirst();
+    while (it->Valid()) {
+        if (it->GetValue() <= offset) {
+            index = (int)it->GetKey();  // NOLINT
+            break;
+        }
+        it->Next();
+    }
+    delete it;
+    return index;
+}
+
+void LogReader::Reset(uint64_t start_offset) {
+    delete reader_;
+    reader_ = NULL;
+    delete sf_;
+    sf_ = NULL;
+    log_part_index_ = -1;
+    start_offset_ = start_offset;
+    RollRLogFile();
+}
+
 void LogReader::GoBackToLastBlock() {
     if (sf_ == NULL || reader_ == NULL) {
         return;
@@ -145,6 +145,9 @@ class Reader {
     void ReportCorruption(uint64_t bytes, const char* reason);
     void ReportDrop(uint64_t bytes, const base::Status& reason);
 
+    // uncompress the payload of a compressed record into scratch
+    bool UncompressRecord(const Slice& payload, std::string* scratch, Slice* record);
+
     // No copying allowed
     Reader(const Reader&);
     void operator=(const Reader&);
@@ -165,6 +168,11 @@ class LogReader {
     int GetEndLogIndex();
     uint64_t GetLastRecordEndOffset();
     void SetOffset(uint64_t start_offset);
+    // the log part which has the entry after the offset, -1 if there is not
+    int GetLogPartIndex(uint64_t offset);
+    // reopen the log part which has the entry after the offset, the records
+    // before it have to be skipped by the caller
+    void Reset(uint64_t start_offset);
     LogReader(const LogReader&) = delete;
     LogReader& operator=(const LogReader&) = delete;
 
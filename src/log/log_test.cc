@@ -21,12 +21,18 @@
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <condition_variable>  // NOLINT
 #include <iostream>
+#include <mutex>  // NOLINT
+#include <string>
 #include <vector>
 
 #include "base/file_util.h"
 #include "base/glog_wapper.h"
+#include "common/timer.h"
 #include "config.h"  // NOLINT
+#include "log/async_writable_file.h"
 #include "log/coding.h"
 #include "log/crc32c.h"
 #include "log/log_reader.h"
@@ -285,6 +291,218 @@ TEST_F(LogWRTest, TestLogEntry) {
     }
 }
 
+TEST_F(LogWRTest, TestRecordCompress) {
+    std::string log_dir = "/tmp/" + GenRand() + "/";
+    ::openmldb::base::MkdirRecur(log_dir);
+    std::string fname = "test.log";
+    std::string full_path = log_dir + "/" + fname;
+    FILE* fd_w = fopen(full_path.c_str(), "ab+");
+    ASSERT_TRUE(fd_w != NULL);
+    WritableFile* wf = NewWritableFile(fname, fd_w);
+    Writer writer("off", wf);
+    writer.SetRecordCompressType(FLAGS_snapshot_compression);
+    ASSERT_EQ(writer.GetCompressType(FLAGS_snapshot_compression), writer.GetRecordCompressType());
+    std::vector<std::string> val_vec;
+    // a small record, a record across blocks and a record which can not be compressed
+    val_vec.push_back("small value");
+    std::string val(10000, '0');
+    val_vec.push_back(val);
+    val.clear();
+    for (int i = 0; i < 1000; i++) {
+        val.push_back(static_cast<char>(rand() % 256));  // NOLINT
+    }
+    val_vec.push_back(val);
+    for (const auto& value : val_vec) {
+        Status status = writer.AddRecord(value);
+        ASSERT_TRUE(status.ok());
+    }
+    if (FLAGS_snapshot_compression != "off") {
+        ASSERT_LT(wf->GetSize(), val_vec[0].size() + val_vec[1].size() + val_vec[2].size());
+    }
+    FILE* fd_r = fopen(full_path.c_str(), "rb");
+    ASSERT_TRUE(fd_r != NULL);
+    SequentialFile* rf = NewSeqFile(fname, fd_r);
+    Reader reader(rf, NULL, true, 0, false);
+    std::string scratch;
+    for (const auto& value : val_vec) {
+        Slice record;
+        Status status = reader.ReadRecord(&record, &scratch);
+        ASSERT_TRUE(status.ok());
+        ASSERT_EQ(value, record.ToString());
+    }
+    Slice record;
+    ASSERT_TRUE(reader.ReadRecord(&record, &scratch).IsWaitRecord());
+}
+
+TEST_F(LogWRTest, TestDirectIO) {
+    std::string log_dir = "/tmp/" + GenRand() + "/";
+    ::openmldb::base::MkdirRecur(log_dir);
+    std::string full_path = log_dir + "/test.log";
+    FILE* fd_w = fopen(full_path.c_str(), "wb");
+    ASSERT_TRUE(fd_w != NULL);
+    WritableFile* wf = NewDirectWritableFile("test.log", fd_w);
+    Writer writer("off", wf);
+    FILE* fd_r = fopen(full_path.c_str(), "rb");
+    ASSERT_TRUE(fd_r != NULL);
+    SequentialFile* rf = NewSeqFile("test.log", fd_r);
+    Reader reader(rf, NULL, true, 0, false);
+    std::string scratch;
+    Slice record;
+    std::vector<std::string> values;
+    for (int round = 0; round < 2; round++) {
+        uint32_t begin = values.size();
+        for (int i = 0; i < 1000; i++) {
+            values.push_back("value" + std::to_string(values.size()) + std::string(i % 100, 'x'));
+            ASSERT_TRUE(writer.AddRecord(values.back()).ok());
+        }
+        ASSERT_TRUE(wf->Sync().ok());
+        // the reader goes back to the last block after waiting, skip the records read before
+        uint32_t idx = 0;
+        while (idx < values.size()) {
+            ASSERT_TRUE(reader.ReadRecord(&record, &scratch).ok());
+            idx = std::find(values.begin(), values.end(), record.ToString()) - values.begin();
+            if (idx >= begin) {
+                break;
+            }
+        }
+        ASSERT_EQ(begin, idx);
+        for (idx = begin + 1; idx < values.size(); idx++) {
+            ASSERT_TRUE(reader.ReadRecord(&record, &scratch).ok());
+            ASSERT_EQ(values[idx], record.ToString());
+        }
+        // stop at the padding of the tail page
+        ASSERT_TRUE(reader.ReadRecord(&record, &scratch).IsWaitRecord());
+    }
+    uint64_t file_size = wf->GetSize();
+    delete wf;
+    delete rf;
+    // the padding is dropped when the file is closed
+    struct stat st;
+    ASSERT_EQ(0, stat(full_path.c_str(), &st));
+    ASSERT_EQ(file_size, static_cast<uint64_t>(st.st_size));
+}
+
+TEST_F(LogWRTest, TestAsyncWrite) {
+    std::string log_dir = "/tmp/" + GenRand() + "/";
+    ::openmldb::base::MkdirRecur(log_dir);
+    std::string full_path = log_dir + "/test.log";
+    FILE* fd_w = fopen(full_path.c_str(), "wb");
+    ASSERT_TRUE(fd_w != NULL);
+    LogIOService service(2);
+    WritableFile* wf = new AsyncWritableFile(NewWritableFile("test.log", fd_w), &service);
+    Writer writer("off", wf);
+    std::vector<std::string> values;
+    for (int i = 0; i < 1000; i++) {
+        values.push_back("value" + std::to_string(i) + std::string(i % 1000, 'x'));
+        ASSERT_TRUE(writer.AddRecord(values.back()).ok());
+    }
+    std::mutex mu;
+    std::condition_variable cv;
+    bool done = false;
+    wf->SyncAsync([&](const Status& status) {
+        ASSERT_TRUE(status.ok());
+        std::lock_guard<std::mutex> lock(mu);
+        done = true;
+        cv.notify_one();
+    });
+    {
+        std::unique_lock<std::mutex> lock(mu);
+        cv.wait(lock, [&done] { return done; });
+    }
+    // the data appended before the sync is written
+    FILE* fd_r = fopen(full_path.c_str(), "rb");
+    ASSERT_TRUE(fd_r != NULL);
+    SequentialFile* rf = NewSeqFile("test.log", fd_r);
+    Reader reader(rf, NULL, true, 0, false);
+    std::string scratch;
+    Slice record;
+    for (const auto& value : values) {
+        ASSERT_TRUE(reader.ReadRecord(&record, &scratch).ok());
+        ASSERT_EQ(value, record.ToString());
+    }
+    ASSERT_TRUE(writer.AddRecord("last").ok());
+    ASSERT_TRUE(wf->Sync().ok());
+    ASSERT_TRUE(reader.ReadRecord(&record, &scratch).ok());
+    ASSERT_EQ("last", record.ToString());
+    uint64_t size = wf->GetSize();
+    delete wf;
+    delete rf;
+    struct stat st;
+    ASSERT_EQ(0, stat(full_path.c_str(), &st));
+    ASSERT_EQ(size, static_cast<uint64_t>(st.st_size));
+}
+
+TEST_F(LogWRTest, WriteBenchmark) {
+    std::string value(128, 'v');
+    LogIOService service(1);
+    for (bool direct_io : {false, true}) {
+        for (bool async_io : {false, true}) {
+            std::string log_dir = "/tmp/" + GenRand() + "/";
+            ::openmldb::base::MkdirRecur(log_dir);
+            std::string full_path = log_dir + "/test.log";
+            FILE* fd_w = fopen(full_path.c_str(), "wb");
+            ASSERT_TRUE(fd_w != NULL);
+            WritableFile* wf =
+                direct_io ? NewDirectWritableFile("test.log", fd_w) : NewWritableFile("test.log", fd_w);
+            if (async_io) {
+                wf = new AsyncWritableFile(wf, &service);
+            }
+            Writer writer("off", wf);
+            uint64_t consumed = ::baidu::common::timer::get_micros();
+            for (int i = 0; i < 10000; i++) {
+                ASSERT_TRUE(writer.AddRecord(value).ok());
+                if (i % 100 == 0) {
+                    ASSERT_TRUE(wf->Sync().ok());
+                }
+            }
+            ASSERT_TRUE(wf->Sync().ok());
+            consumed = ::baidu::common::timer::get_micros() - consumed;
+            std::cout << "direct io " << direct_io << " async io " << async_io
+                      << " write 10000 records use time in us: " << consumed << std::endl;
+            delete wf;
+        }
+    }
+}
+
+// the crc32c computed bit by bit
+static uint32_t BitwiseCrc32c(uint32_t crc, const char* buf, size_t size) {
+    crc = ~crc;
+    for (size_t i = 0; i < size; i++) {
+        crc ^= static_cast<uint8_t>(buf[i]);
+        for (int k = 0; k < 8; k++) {
+            crc = (crc >> 1) ^ (0x82f63b78 & (0u - (crc & 1)));
+        }
+    }
+    return ~crc;
+}
+
+TEST_F(LogWRTest, Crc32c) {
+    // the values from the rfc 3720
+    char buf[32];
+    memset(buf, 0, sizeof(buf));
+    ASSERT_EQ(0x8a9136aau, Value(buf, sizeof(buf)));
+    memset(buf, 0xff, sizeof(buf));
+    ASSERT_EQ(0x62a8ab43u, Value(buf, sizeof(buf)));
+    for (int i = 0; i < 32; i++) {
+        buf[i] = i;
+    }
+    ASSERT_EQ(0x46dd794eu, Value(buf, sizeof(buf)));
+    ASSERT_EQ(0xe3069283u, Value("123456789", 9));
+
+    // the sizes around the streams of the large blocks at all the alignments
+    std::string data(100000, 0);
+    for (auto& c : data) {
+        c = static_cast<char>(rand());  // NOLINT
+    }
+    for (size_t size : {0, 1, 7, 8, 9, 767, 768, 769, 1000, 24575, 24576, 24577, 50000, 99990}) {
+        for (size_t offset = 0; offset < 9; offset++) {
+            ASSERT_EQ(BitwiseCrc32c(0, data.data() + offset, size), Value(data.data() + offset, size));
+        }
+        uint32_t crc = Value(data.data(), size / 3);
+        ASSERT_EQ(Value(data.data(), size), Extend(crc, data.data() + size / 3, size - size / 3));
+    }
+}
+
 TEST_F(LogWRTest, TestWait) {
     std::string log_dir = "/tmp/" + GenRand() + "/";
     ::openmldb::base::MkdirRecur(log_dir);
@@ -45,7 +45,9 @@ Writer::Writer(const std::string& compress_type, WritableFile* dest)
       compress_type_(GetCompressType(compress_type)),
       header_size_(compress_type_ != kNoCompress ? kHeaderSizeForCompress : kHeaderSize),
       buffer_(nullptr),
-      compress_buf_(nullptr) {
+      compress_buf_(nullptr),
+      record_compress_type_(kNoCompress),
+      record_buf_() {
     InitTypeCrc(type_crc_);
     if (compress_type_ != kNoCompress) {
         block_size_ = kCompressBlockSize;
@@ -64,7 +66,9 @@ Writer::Writer(const std::string& compress_type, WritableFile* dest, uint64_t de
       compress_type_(GetCompressType(compress_type)),
       header_size_(compress_type_ != kNoCompress ? kHeaderSizeForCompress : kHeaderSize),
       buffer_(nullptr),
-      compress_buf_(nullptr) {
+      compress_buf_(nullptr),
+      record_compress_type_(kNoCompress),
+      record_buf_() {
     InitTypeCrc(type_crc_);
     if (compress_type_ != kNoCompress) {
         block_size_ = kCompressBlockSize;
@@ -129,6 +133,12 @@ Status Writer::EndLog() {
 Status Writer::AddRecord(const Slice& slice) {
     const char* ptr = slice.data();
     size_t left = slice.size();
+    bool compressed = false;
+    if (record_compress_type_ != kNoCompress && slice.size() >= kMinCompressRecordSize && CompressPayload(slice)) {
+        ptr = record_buf_.data();
+        left = record_buf_.size();
+        compressed = true;
+    }
 
     // Fragment the record if necessary and emit it.  Note that if slice
     // is empty, we still want to iterate once to emit a single
@@ -164,9 +174,9 @@ Status Writer::AddRecord(const Slice& slice) {
         RecordType type;
         const bool end = (left == fragment_length);
         if (begin && end) {
-            type = kFullType;
+            type = compressed ? kCompressedFullType : kFullType;
         } else if (begin) {
-            type = kFirstType;
+            type = compressed ? kCompressedFirstType : kFirstType;
         } else if (end) {
             type = kLastType;
         } else {
@@ -307,6 +317,46 @@ CompressType Writer::GetCompressType(const std::string& compress_type) {
     }
 }
 
+void Writer::SetRecordCompressType(const std::string& compress_type) {
+    if (compress_type_ != kNoCompress) {
+        return;
+    }
+    record_compress_type_ = GetCompressType(compress_type);
+}
+
+bool Writer::CompressPayload(const Slice& slice) {
+    size_t compress_len = 0;
+    switch (record_compress_type_) {
+        case kSnappy: {
+            record_buf_.resize(kHeaderSizeOfCompressRecord + snappy::MaxCompressedLength(slice.size()));
+            snappy::RawCompress(slice.data(), slice.size(), &record_buf_[kHeaderSizeOfCompressRecord], &compress_len);
+            break;
+        }
+        case kZlib: {
+            uLongf dest_len = compressBound(slice.size());
+            record_buf_.resize(kHeaderSizeOfCompressRecord + dest_len);
+            int res = compress(reinterpret_cast<Bytef*>(&record_buf_[kHeaderSizeOfCompressRecord]), &dest_len,
+                               reinterpret_cast<const Bytef*>(slice.data()), slice.size());
+            if (res != Z_OK) {
+                PDLOG(WARNING, "fail to compress record, error code: %d", res);
+                return false;
+            }
+            compress_len = dest_len;
+            break;
+        }
+        default:
+            return false;
+    }
+    // keep the record as it is if it does not get smaller
+    if (kHeaderSizeOfCompressRecord + compress_len >= slice.size()) {
+        return false;
+    }
+    record_buf_[0] = static_cast<char>(record_compress_type_);
+    EncodeFixed32(&record_buf_[1], static_cast<uint32_t>(slice.size()));
+    record_buf_.resize(kHeaderSizeOfCompressRecord + compress_len);
+    return true;
+}
+
 Status Writer::AppendInternal(WritableFile* wf, int32_t leftover) {
     Slice fill_slice("\x00\x00\x00\x00\x00\x00", leftover);
     if (compress_type_ == kNoCompress) {
@@ -25,8 +25,10 @@
 
 #include <string>
 
+#include "base/rate_limiter.h"
 #include "base/slice.h"
 #include "base/status.h"
+#include "log/async_writable_file.h"
 #include "log/log_format.h"
 #include "log/writable_file.h"
 
@@ -61,6 +63,12 @@ class Writer {
 
     CompressType GetCompressType(const std::string& compress_type);
 
+    // compress the payload of every record with compress_type. It only works
+    // for the writer without block compression, e.g. the binlog writer
+    void SetRecordCompressType(const std::string& compress_type);
+
+    inline CompressType GetRecordCompressType() { return record_compress_type_; }
+
  private:
     WritableFile* dest_;
     uint32_t block_offset_;  // Current offset in block
@@ -77,7 +85,11 @@ class Writer {
     char* buffer_;
     // buffer for compressed block
     char* compress_buf_;
+    CompressType record_compress_type_;
+    // buffer for compressed record payload
+    std::string record_buf_;
     Status CompressRecord();
+    bool CompressPayload(const Slice& slice);
     Status AppendInternal(WritableFile* wf, int leftover);
 
     Status EmitPhysicalRecord(RecordType type, const char* ptr, size_t length);
@@ -91,16 +103,39 @@ struct WriteHandle {
     FILE* fd_;
     WritableFile* wf_;
     Writer* lw_;
-    WriteHandle(const std::string& compress_type, const std::string& fname, FILE* fd, uint64_t dest_length = 0)
-        : fd_(fd), wf_(NULL), lw_(NULL) {
-        wf_ = ::openmldb::log::NewWritableFile(fname, fd);
+    // the records wait for it before they are written, the binlog writes have none
+    ::openmldb::base::RateLimiter* limiter_;
+    WriteHandle(const std::string& compress_type, const std::string& fname, FILE* fd, uint64_t dest_length = 0,
+                bool direct_io = false, bool async_io = false)
+        : fd_(fd), wf_(NULL), lw_(NULL), limiter_(NULL) {
+        if (direct_io && dest_length == 0) {
+            wf_ = ::openmldb::log::NewDirectWritableFile(fname, fd);
+        } else {
+            wf_ = ::openmldb::log::NewWritableFile(fname, fd);
+        }
+        if (async_io) {
+            wf_ = new AsyncWritableFile(wf_, LogIOService::Default());
+        }
         lw_ = new Writer(compress_type, wf_, dest_length);
     }
 
-    ::openmldb::base::Status Write(const ::openmldb::base::Slice& slice) { return lw_->AddRecord(slice); }
+    ::openmldb::base::Status Write(const ::openmldb::base::Slice& slice) {
+        if (limiter_ != NULL) {
+            limiter_->Throttle(slice.size());
+        }
+        return lw_->AddRecord(slice);
+    }
+
+    void SetRateLimiter(::openmldb::base::RateLimiter* limiter) { limiter_ = limiter; }
+
+    ::openmldb::base::Status Flush() { return wf_->Flush(); }
+
+    void SetRecordCompressType(const std::string& compress_type) { lw_->SetRecordCompressType(compress_type); }
 
     ::openmldb::base::Status Sync() { return wf_->Sync(); }
 
+    void SyncAsync(const IOCallback& done) { wf_->SyncAsync(done); }
+
     ::openmldb::base::Status EndLog() { return lw_->EndLog(); }
 
     uint64_t GetSize() { return wf_->GetSize(); }
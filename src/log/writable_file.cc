@@ -22,18 +22,29 @@
 #include "log/writable_file.h"
 
 #include <errno.h>
+#include <fcntl.h>
+#include <gflags/gflags.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 
+#include <algorithm>
+
+#include "base/glog_wapper.h"
 #include "base/slice.h"
 #include "base/status.h"
 
 using ::openmldb::base::Slice;
 using ::openmldb::base::Status;
 
+DECLARE_uint32(binlog_preallocate_size);
+
 namespace openmldb {
 namespace log {
 
+void WritableFile::SyncAsync(const IOCallback& done) { done(Sync()); }
+
 static Status IOError(const std::string& context, int err_number) {
     return Status::IOError(context, strerror(err_number));
 }
@@ -104,7 +115,160 @@ class PosixWritableFile : public WritableFile {
     FILE* file_;
 };
 
+#if __linux__
+static const size_t kDirectIOAlignment = 4096;
+static const size_t kDirectIOBufferSize = 1024 * 1024;
+
+static inline uint64_t AlignDown(uint64_t size) { return size & ~(kDirectIOAlignment - 1); }
+
+static inline uint64_t AlignUp(uint64_t size) { return AlignDown(size + kDirectIOAlignment - 1); }
+
+class PosixDirectWritableFile : public WritableFile {
+ public:
+    PosixDirectWritableFile(const std::string& fname, FILE* f, char* buf)
+        : filename_(fname),
+          file_(f),
+          fd_(fileno(f)),
+          buf_(buf),
+          buf_len_(0),
+          dirty_(false),
+          file_offset_(0),
+          preallocated_size_(0) {}
+
+    ~PosixDirectWritableFile() {
+        if (file_ != NULL) {
+            // Ignoring any potential errors
+            Close();
+        }
+        free(buf_);
+    }
+
+    virtual Status Append(const Slice& data) {
+        const char* ptr = data.data();
+        size_t left = data.size();
+        while (left > 0) {
+            size_t n = std::min(left, kDirectIOBufferSize - buf_len_);
+            memcpy(buf_ + buf_len_, ptr, n);
+            buf_len_ += n;
+            ptr += n;
+            left -= n;
+            dirty_ = true;
+            if (buf_len_ == kDirectIOBufferSize) {
+                Status s = WriteBuffer();
+                if (!s.ok()) {
+                    return s;
+                }
+            }
+        }
+        wsize_ += data.size();
+        return Status::OK();
+    }
+
+    virtual Status Close() {
+        Status result = Flush();
+        // drop the padding and the preallocated space
+        if (ftruncate(fd_, wsize_) != 0 && result.ok()) {
+            result = IOError(filename_, errno);
+        }
+        if (fclose(file_) != 0 && result.ok()) {
+            result = IOError(filename_, errno);
+        }
+        file_ = NULL;
+        return result;
+    }
+
+    virtual Status Flush() {
+        if (!dirty_) {
+            return Status::OK();
+        }
+        return WriteBuffer();
+    }
+
+    virtual Status Sync() {
+        Status s = Flush();
+        if (!s.ok()) {
+            return s;
+        }
+        if (fdatasync(fd_) != 0) {
+            return IOError(filename_, errno);
+        }
+        return Status::OK();
+    }
+
+ private:
+    // write the buffer with the tail page padded, the tail page is kept in the
+    // buffer and written again with the following data
+    Status WriteBuffer() {
+        uint64_t write_len = AlignUp(buf_len_);
+        memset(buf_ + buf_len_, 0, write_len - buf_len_);
+        Preallocate(file_offset_ + write_len);
+        uint64_t written = 0;
+        while (written < write_len) {
+            ssize_t r = pwrite(fd_, buf_ + written, write_len - written, file_offset_ + written);
+            if (r < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return IOError(filename_, errno);
+            }
+            written += r;
+        }
+        dirty_ = false;
+        uint64_t full_len = AlignDown(buf_len_);
+        if (full_len > 0) {
+            memmove(buf_, buf_ + full_len, buf_len_ - full_len);
+            buf_len_ -= full_len;
+            file_offset_ += full_len;
+        }
+        return Status::OK();
+    }
+
+    void Preallocate(uint64_t end) {
+        uint64_t step = static_cast<uint64_t>(FLAGS_binlog_preallocate_size) * 1024 * 1024;
+        if (step == 0 || end <= preallocated_size_) {
+            return;
+        }
+        uint64_t len = std::max(step, end - preallocated_size_);
+        // keep the file size, so the readers see the end of file as usual
+        if (fallocate(fd_, FALLOC_FL_KEEP_SIZE, preallocated_size_, len) != 0) {
+            PDLOG(WARNING, "fail to preallocate file %s for error %s", filename_.c_str(), strerror(errno));
+        }
+        preallocated_size_ += len;
+    }
+
+ private:
+    std::string filename_;
+    FILE* file_;
+    int fd_;
+    // aligned buffer of kDirectIOBufferSize, it starts at file_offset_
+    char* buf_;
+    size_t buf_len_;
+    bool dirty_;
+    uint64_t file_offset_;
+    uint64_t preallocated_size_;
+};
+#endif
+
 WritableFile* NewWritableFile(const std::string& fname, FILE* f) { return new PosixWritableFile(fname, f); }
 
+WritableFile* NewDirectWritableFile(const std::string& fname, FILE* f) {
+#if __linux__
+    int fd = fileno(f);
+    int flags = fcntl(fd, F_GETFL);
+    if (flags < 0 || (flags & O_APPEND) || fcntl(fd, F_SETFL, flags | O_DIRECT) != 0) {
+        PDLOG(WARNING, "direct io is not supported by file %s, use buffered io", fname.c_str());
+        return NewWritableFile(fname, f);
+    }
+    void* buf = NULL;
+    if (posix_memalign(&buf, kDirectIOAlignment, kDirectIOBufferSize) != 0) {
+        fcntl(fd, F_SETFL, flags);
+        return NewWritableFile(fname, f);
+    }
+    return new PosixDirectWritableFile(fname, f, reinterpret_cast<char*>(buf));
+#else
+    return NewWritableFile(fname, f);
+#endif
+}
+
 }  // namespace log
 }  // namespace openmldb
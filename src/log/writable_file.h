@@ -17,6 +17,7 @@
 #ifndef SRC_LOG_WRITABLE_FILE_H_
 #define SRC_LOG_WRITABLE_FILE_H_
 
+#include <functional>
 #include <string>
 
 namespace openmldb {
@@ -28,6 +29,9 @@ class Slice;
 
 namespace log {
 
+// the callback of an async io, it is called on the io thread
+typedef std::function<void(const base::Status&)> IOCallback;
+
 class WritableFile {
  public:
     WritableFile() { wsize_ = 0; }
@@ -37,6 +41,8 @@ class WritableFile {
     virtual base::Status Close() = 0;
     virtual base::Status Flush() = 0;
     virtual base::Status Sync() = 0;
+    // call done once the data appended before is synced, the file syncs in place by default
+    virtual void SyncAsync(const IOCallback& done);
     uint64_t GetSize() { return wsize_; }
 
  protected:
@@ -50,6 +56,12 @@ class WritableFile {
 
 WritableFile* NewWritableFile(const std::string& fname, FILE* f);
 
+// The file is written with O_DIRECT through an aligned buffer and its space is
+// preallocated by binlog_preallocate_size. The tail page is padded with zeros until
+// the file is closed. f must not be opened in append mode, fall back to
+// NewWritableFile if direct io is not supported
+WritableFile* NewDirectWritableFile(const std::string& fname, FILE* f);
+
 }  // namespace log
 }  // namespace openmldb
 
@@ -21,6 +21,7 @@
 #include <strings.h>
 
 #include <algorithm>
+#include <functional>
 #include <set>
 #ifdef DISALLOW_COPY_AND_ASSIGN
 #undef DISALLOW_COPY_AND_ASSIGN
@@ -53,6 +54,13 @@ DECLARE_uint32(absolute_ttl_max);
 DECLARE_uint32(latest_ttl_max);
 DECLARE_uint32(get_table_status_interval);
 DECLARE_uint32(name_server_task_max_concurrency);
+DECLARE_uint32(name_server_task_lane_num);
+DECLARE_uint32(name_server_table_update_window_ms);
+DECLARE_uint32(name_server_balance_interval_ms);
+DECLARE_double(name_server_balance_threshold);
+DECLARE_uint32(name_server_zk_multi_max_bytes);
+DECLARE_uint32(name_server_task_concurrency_per_tablet);
+DECLARE_uint32(name_server_tablet_rpc_concurrency);
 DECLARE_uint32(check_binlog_sync_progress_delta);
 DECLARE_uint32(name_server_op_execute_timeout);
 DECLARE_uint32(get_replica_status_interval);
@@ -705,6 +713,7 @@ NameServerImpl::NameServerImpl()
       dist_lock_(NULL),
       thread_pool_(1),
       task_thread_pool_(FLAGS_name_server_task_pool_size),
+      balance_time_(0),
       cv_(),
       rand_(0xdeadbeef),
       session_term_(0) {}
@@ -1587,7 +1596,9 @@ bool NameServerImpl::Init(const std::string& zk_cluster, const std::string& zk_p
             n_it->second = real_endpoint;
         }
     }
-    task_vec_.resize(FLAGS_name_server_task_max_concurrency + FLAGS_name_server_task_concurrency_for_replica_cluster);
+    // the lanes of the ops limited by concurrency, the lanes of the replica clusters and the parallel lanes
+    task_vec_.resize(FLAGS_name_server_task_max_concurrency + FLAGS_name_server_task_concurrency_for_replica_cluster +
+                     FLAGS_name_server_task_lane_num);
     std::string value;
     std::vector<std::string> endpoints;
     if (!zk_client_->GetNodes(endpoints)) {
@@ -1739,6 +1750,10 @@ int NameServerImpl::UpdateTaskStatusRemote(bool is_recover_op) {
                 if (index <= FLAGS_name_server_task_max_concurrency) {
                     continue;
                 }
+                if (index > FLAGS_name_server_task_max_concurrency +
+                                FLAGS_name_server_task_concurrency_for_replica_cluster) {
+                    break;
+                }
                 std::string endpoint_role = "replica cluster";
                 if (UpdateTask(op_list, endpoint, endpoint_role, is_recover_op, response) < 0) {
                     continue;
@@ -2113,6 +2128,19 @@ void NameServerImpl::ProcessTask() {
                 }
             }
 
+            // the count of the running tasks on every tablet
+            std::map<std::string, uint32_t> running_tasks;
+            if (FLAGS_name_server_task_concurrency_per_tablet > 0) {
+                for (const auto& op_list : task_vec_) {
+                    if (op_list.empty() || op_list.front()->task_list_.empty()) {
+                        continue;
+                    }
+                    const auto& task_info = op_list.front()->task_list_.front()->task_info_;
+                    if (task_info->status() == ::openmldb::api::kDoing && task_info->has_endpoint()) {
+                        running_tasks[task_info->endpoint()]++;
+                    }
+                }
+            }
             for (const auto& op_list : task_vec_) {
                 if (op_list.empty()) {
                     continue;
@@ -2122,6 +2150,16 @@ void NameServerImpl::ProcessTask() {
                     op_data->op_info_.task_status() == ::openmldb::api::kCanceled) {
                     continue;
                 }
+                const auto& first_task_info = op_data->task_list_.front()->task_info_;
+                if (FLAGS_name_server_task_concurrency_per_tablet > 0 &&
+                    first_task_info->status() == ::openmldb::api::kInited && first_task_info->has_endpoint()) {
+                    // the task waits in its lane until a task on the tablet is done
+                    auto& running = running_tasks[first_task_info->endpoint()];
+                    if (running >= FLAGS_name_server_task_concurrency_per_tablet) {
+                        continue;
+                    }
+                    running++;
+                }
                 if (op_data->op_info_.task_status() == ::openmldb::api::kInited) {
                     op_data->op_info_.set_start_time(::baidu::common::timer::now_time());
                     op_data->op_info_.set_task_status(::openmldb::api::kDoing);
@@ -2506,6 +2544,32 @@ int NameServerImpl::SetPartitionInfo(TableInfo& table_info) {
     return 0;
 }
 
+// run the rpcs to the tablets with at most name_server_tablet_rpc_concurrency of them at once, return the count
+// of the failed ones
+static uint32_t RunTabletCalls(const std::vector<std::function<bool()>>& calls) {
+    uint32_t concurrency = std::min<uint32_t>(FLAGS_name_server_tablet_rpc_concurrency, calls.size());
+    std::atomic<uint32_t> failed(0);
+    if (concurrency <= 1) {
+        for (const auto& call : calls) {
+            if (!call()) {
+                failed++;
+            }
+        }
+        return failed.load();
+    }
+    ::baidu::common::ThreadPool pool(concurrency);
+    for (const auto& call : calls) {
+        pool.AddTask([&call, &failed]() {
+            if (!call()) {
+                failed.fetch_add(1, std::memory_order_relaxed);
+            }
+        });
+    }
+    // wait for all of the calls done
+    pool.Stop(true);
+    return failed.load();
+}
+
 int NameServerImpl::CreateTableOnTablet(std::shared_ptr<::openmldb::nameserver::TableInfo> table_info, bool is_leader,
                                         std::map<uint32_t, std::vector<std::string>>& endpoint_map, uint64_t term) {
     ::openmldb::type::CompressType compress_type = ::openmldb::type::CompressType::kNoCompress;
@@ -2540,6 +2604,8 @@ int NameServerImpl::CreateTableOnTablet(std::shared_ptr<::openmldb::nameserver::
             meta->set_is_alive(true);
         }
     }
+    // check all the tablets before any partition is created, then create the partitions at once
+    std::vector<std::function<bool()>> calls;
     for (int idx = 0; idx < table_info->table_partition_size(); idx++) {
         uint32_t pid = table_info->table_partition(idx).pid();
         table_meta.set_pid(pid);
@@ -2582,20 +2648,28 @@ int NameServerImpl::CreateTableOnTablet(std::shared_ptr<::openmldb::nameserver::
                 endpoint_map[pid].push_back(endpoint);
                 table_meta.set_mode(::openmldb::api::TableMode::kTableFollower);
             }
-            if (!tablet_ptr->client_->CreateTable(table_meta)) {
-                PDLOG(WARNING, "create table failed. tid[%u] pid[%u] endpoint[%s]", table_info->tid(), pid,
-                      endpoint.c_str());
-                return -1;
-            }
-            PDLOG(INFO, "create table success. tid[%u] pid[%u] endpoint[%s] idx[%d]", table_info->tid(), pid,
-                  endpoint.c_str(), idx);
+            auto meta = std::make_shared<::openmldb::api::TableMeta>(table_meta);
+            calls.push_back([tablet_ptr, meta, endpoint, idx]() {
+                if (!tablet_ptr->client_->CreateTable(*meta)) {
+                    PDLOG(WARNING, "create table failed. tid[%u] pid[%u] endpoint[%s]", meta->tid(), meta->pid(),
+                          endpoint.c_str());
+                    return false;
+                }
+                PDLOG(INFO, "create table success. tid[%u] pid[%u] endpoint[%s] idx[%d]", meta->tid(), meta->pid(),
+                      endpoint.c_str(), idx);
+                return true;
+            });
         }
     }
+    if (RunTabletCalls(calls) > 0) {
+        return -1;
+    }
     return 0;
 }
 
 int NameServerImpl::DropTableOnTablet(std::shared_ptr<::openmldb::nameserver::TableInfo> table_info) {
     uint32_t tid = table_info->tid();
+    std::vector<std::function<bool()>> calls;
     for (int idx = 0; idx < table_info->table_partition_size(); idx++) {
         uint32_t pid = table_info->table_partition(idx).pid();
         for (int meta_idx = 0; meta_idx < table_info->table_partition(idx).partition_meta_size(); meta_idx++) {
@@ -2616,13 +2690,17 @@ int NameServerImpl::DropTableOnTablet(std::shared_ptr<::openmldb::nameserver::Ta
                     continue;
                 }
             }
-            if (!tablet_ptr->client_->DropTable(tid, pid)) {
-                PDLOG(WARNING, "drop table failed. tid[%u] pid[%u] endpoint[%s]", tid, pid, endpoint.c_str());
-            } else {
+            calls.push_back([tablet_ptr, tid, pid, endpoint]() {
+                if (!tablet_ptr->client_->DropTable(tid, pid)) {
+                    PDLOG(WARNING, "drop table failed. tid[%u] pid[%u] endpoint[%s]", tid, pid, endpoint.c_str());
+                    return false;
+                }
                 PDLOG(INFO, "drop table success. tid[%u] pid[%u] endpoint[%s]", tid, pid, endpoint.c_str());
-            }
+                return true;
+            });
         }
     }
+    RunTabletCalls(calls);
     return 0;
 }
 
@@ -4759,9 +4837,12 @@ void NameServerImpl::Migrate(RpcController* controller, const MigrateRequest* re
     }
     char error_msg[1024];
     bool has_error = false;
+    // the offset of the leader and the pid
+    std::vector<std::pair<uint64_t, uint32_t>> pid_vec;
     for (int i = 0; i < request->pid_size(); i++) {
         uint32_t pid = request->pid(i);
         std::string leader_endpoint;
+        uint64_t leader_offset = 0;
         bool has_found_src_endpoint = false;
         bool has_found_des_endpoint = false;
         for (int idx = 0; idx < table_info->table_partition_size(); idx++) {
@@ -4773,6 +4854,7 @@ void NameServerImpl::Migrate(RpcController* controller, const MigrateRequest* re
                     std::string endpoint = table_info->table_partition(idx).partition_meta(meta_idx).endpoint();
                     if (table_info->table_partition(idx).partition_meta(meta_idx).is_leader()) {
                         leader_endpoint = endpoint;
+                        leader_offset = table_info->table_partition(idx).partition_meta(meta_idx).offset();
                     }
                     if (request->src_endpoint() == endpoint) {
                         has_found_src_endpoint = true;
@@ -4816,6 +4898,7 @@ void NameServerImpl::Migrate(RpcController* controller, const MigrateRequest* re
             has_error = true;
             break;
         }
+        pid_vec.emplace_back(leader_offset, pid);
     }
     if (has_error) {
         response->set_code(::openmldb::base::ReturnCode::kMigrateFailed);
@@ -4823,9 +4906,13 @@ void NameServerImpl::Migrate(RpcController* controller, const MigrateRequest* re
         PDLOG(WARNING, "%s", error_msg);
         return;
     }
-    for (int i = 0; i < request->pid_size(); i++) {
-        uint32_t pid = request->pid(i);
-        CreateMigrateOP(request->src_endpoint(), request->name(), request->db(), pid, request->des_endpoint());
+    // the partitions written most are moved first, they are the ones loading the src_endpoint
+    std::stable_sort(pid_vec.begin(), pid_vec.end(),
+                     [](const std::pair<uint64_t, uint32_t>& a, const std::pair<uint64_t, uint32_t>& b) {
+                         return a.first > b.first;
+                     });
+    for (const auto& kv : pid_vec) {
+        CreateMigrateOP(request->src_endpoint(), request->name(), request->db(), kv.second, request->des_endpoint());
     }
     response->set_code(::openmldb::base::ReturnCode::kOk);
     response->set_msg("ok");
@@ -5174,6 +5261,26 @@ int NameServerImpl::AddOPData(const std::shared_ptr<OPData>& op_data, uint32_t c
         } else {
             idx = FLAGS_name_server_task_max_concurrency + (rand_.Next() % concurrency);
         }
+    } else if (FLAGS_name_server_task_lane_num > 0) {
+        // the ops of one partition are in one lane, so they run in order, and the ops of the different
+        // partitions run in parallel. the child op follows its parent in the lane of the parent
+        uint32_t lane_offset =
+            FLAGS_name_server_task_max_concurrency + FLAGS_name_server_task_concurrency_for_replica_cluster;
+        std::string key = op_data->op_info_.db() + "." + op_data->op_info_.name() + "." +
+                          std::to_string(op_data->op_info_.pid());
+        idx = lane_offset + ::openmldb::base::hash64(key) % FLAGS_name_server_task_lane_num;
+        if (op_data->op_info_.parent_id() != INVALID_PARENT_ID) {
+            for (uint32_t i = 0; i < task_vec_.size(); i++) {
+                auto it = std::find_if(task_vec_[i].begin(), task_vec_[i].end(),
+                                       [&op_data](const std::shared_ptr<OPData>& cur) {
+                                           return cur->op_info_.op_id() == op_data->op_info_.parent_id();
+                                       });
+                if (it != task_vec_[i].end()) {
+                    idx = i;
+                    break;
+                }
+            }
+        }
     } else {
         idx = op_data->op_info_.pid() % task_vec_.size();
         if (concurrency < task_vec_.size() && concurrency > 0) {
@@ -5395,18 +5502,73 @@ void NameServerImpl::UpdateTableStatus() {
             tablet_ptr_map.insert(std::make_pair(kv.first, kv.second));
         }
     }
-    std::unordered_map<std::string, ::openmldb::api::TableStatus> pos_response;
-    pos_response.reserve(16);
+    std::lock_guard<std::mutex> status_lock(table_status_mu_);
+    for (auto it = tablet_status_cache_.begin(); it != tablet_status_cache_.end();) {
+        if (tablet_ptr_map.find(it->first) == tablet_ptr_map.end()) {
+            it = tablet_status_cache_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    // get the status from all the tablets at the same time
+    std::vector<std::pair<std::string, openmldb::RpcCallback<::openmldb::api::GetTableStatusResponse>*>> callbacks;
+    callbacks.reserve(tablet_ptr_map.size());
     for (const auto& kv : tablet_ptr_map) {
-        ::openmldb::api::GetTableStatusResponse tablet_status_response;
-        if (!kv.second->client_->GetTableStatus(tablet_status_response)) {
+        ::openmldb::api::GetTableStatusRequest request;
+        auto cache_it = tablet_status_cache_.find(kv.first);
+        if (cache_it != tablet_status_cache_.end() && cache_it->second.has_version_) {
+            request.set_status_version(cache_it->second.version_);
+            request.set_status_epoch(cache_it->second.epoch_);
+        }
+        auto callback = new openmldb::RpcCallback<::openmldb::api::GetTableStatusResponse>(
+            std::make_shared<::openmldb::api::GetTableStatusResponse>(), std::make_shared<brpc::Controller>());
+        // one reference is released by the rpc and the other one after the response is handled
+        callback->Ref();
+        if (!kv.second->client_->GetTableStatus(request, callback)) {
             PDLOG(WARNING, "get table status failed! endpoint[%s]", kv.first.c_str());
+            callback->UnRef();
+            callback->UnRef();
+            continue;
+        }
+        callbacks.emplace_back(kv.first, callback);
+    }
+    std::unordered_map<std::string, ::openmldb::api::TableStatus> pos_response;
+    pos_response.reserve(16);
+    for (const auto& kv : callbacks) {
+        auto callback = kv.second;
+        brpc::Join(callback->GetController()->call_id());
+        const auto& response = callback->GetResponse();
+        if (callback->GetController()->Failed()) {
+            PDLOG(WARNING, "get table status failed! endpoint[%s] error[%s]", kv.first.c_str(),
+                  callback->GetController()->ErrorText().c_str());
+            tablet_status_cache_.erase(kv.first);
+            callback->UnRef();
             continue;
         }
-        for (int pos = 0; pos < tablet_status_response.all_table_status_size(); pos++) {
-            std::string key = std::to_string(tablet_status_response.all_table_status(pos).tid()) + "_" +
-                              std::to_string(tablet_status_response.all_table_status(pos).pid()) + "_" + kv.first;
-            pos_response.insert(std::make_pair(key, tablet_status_response.all_table_status(pos)));
+        auto& cache = tablet_status_cache_[kv.first];
+        std::unordered_map<uint64_t, ::openmldb::api::TableStatus> status;
+        status.reserve(response->all_table_status_size() + response->unchanged_partitions_size());
+        if (response->is_incremental()) {
+            for (const auto key : response->unchanged_partitions()) {
+                auto status_it = cache.status_.find(key);
+                if (status_it != cache.status_.end()) {
+                    status.emplace(key, std::move(status_it->second));
+                }
+            }
+        }
+        for (auto& table_status : *response->mutable_all_table_status()) {
+            uint64_t key = static_cast<uint64_t>(table_status.tid()) << 32 | table_status.pid();
+            status[key].Swap(&table_status);
+        }
+        cache.status_.swap(status);
+        cache.has_version_ = response->has_status_version();
+        cache.version_ = response->status_version();
+        cache.epoch_ = response->status_epoch();
+        callback->UnRef();
+        for (const auto& status_kv : cache.status_) {
+            std::string key = std::to_string(status_kv.second.tid()) + "_" + std::to_string(status_kv.second.pid()) +
+                              "_" + kv.first;
+            pos_response.insert(std::make_pair(key, status_kv.second));
         }
     }
     if (pos_response.empty()) {
@@ -5479,6 +5641,133 @@ void NameServerImpl::UpdateTableStatusFun(
     }
 }
 
+void NameServerImpl::BalanceLeader() {
+    if (!running_.load(std::memory_order_acquire)) {
+        return;
+    }
+    do {
+        std::lock_guard<std::mutex> lock(mu_);
+        uint64_t cur_time = ::baidu::common::timer::get_micros();
+        uint64_t time_used = cur_time - balance_time_;
+        balance_time_ = cur_time;
+        // the write rate of the leaders got from the offsets reported by UpdateTableStatus
+        std::map<std::string, uint64_t> offsets;
+        std::map<std::string, double> tablet_load;
+        for (const auto& kv : tablets_) {
+            if (kv.second->Health()) {
+                tablet_load.emplace(kv.first, 0);
+            }
+        }
+        struct Candidate {
+            std::string name;
+            std::string db;
+            uint32_t pid;
+            std::string leader;
+            std::vector<std::string> followers;
+            double rate;
+        };
+        std::vector<Candidate> candidates;
+        auto collect = [&](const TableInfos& table_infos) {
+            for (const auto& kv : table_infos) {
+                const auto& table_info = kv.second;
+                for (const auto& table_partition : table_info->table_partition()) {
+                    Candidate candidate{table_info->name(), table_info->db(), table_partition.pid(), "", {}, 0};
+                    uint64_t offset = 0;
+                    for (const auto& meta : table_partition.partition_meta()) {
+                        if (!meta.is_alive()) {
+                            continue;
+                        }
+                        if (meta.is_leader()) {
+                            candidate.leader = meta.endpoint();
+                            offset = meta.offset();
+                        } else if (tablet_load.find(meta.endpoint()) != tablet_load.end()) {
+                            candidate.followers.push_back(meta.endpoint());
+                        }
+                    }
+                    auto load_it = tablet_load.find(candidate.leader);
+                    if (load_it == tablet_load.end()) {
+                        continue;
+                    }
+                    std::string key = table_info->db() + "." + table_info->name() + "." +
+                                      std::to_string(table_partition.pid());
+                    offsets.emplace(key, offset);
+                    auto offset_it = balance_offsets_.find(key);
+                    if (offset_it == balance_offsets_.end() || offset < offset_it->second || time_used == 0) {
+                        continue;
+                    }
+                    candidate.rate = (offset - offset_it->second) * 1000000.0 / time_used;
+                    load_it->second += candidate.rate;
+                    if (!candidate.followers.empty()) {
+                        candidates.push_back(std::move(candidate));
+                    }
+                }
+            }
+        };
+        collect(table_info_);
+        for (const auto& kv : db_table_info_) {
+            collect(kv.second);
+        }
+        balance_offsets_.swap(offsets);
+        if (auto_failover_.load(std::memory_order_acquire) || tablet_load.size() < 2) {
+            break;
+        }
+        bool has_op = false;
+        for (const auto& op_list : task_vec_) {
+            has_op = has_op || !op_list.empty();
+        }
+        if (has_op) {
+            DEBUGLOG("there are ops running, the leaders are not balanced");
+            break;
+        }
+        double total_load = 0;
+        auto max_it = tablet_load.begin();
+        for (auto it = tablet_load.begin(); it != tablet_load.end(); ++it) {
+            total_load += it->second;
+            if (it->second > max_it->second) {
+                max_it = it;
+            }
+        }
+        double avg_load = total_load / tablet_load.size();
+        if (avg_load <= 0 || max_it->second <= avg_load * FLAGS_name_server_balance_threshold) {
+            break;
+        }
+        // the move which makes the loads of the two tablets closest
+        const Candidate* best = nullptr;
+        std::string best_follower;
+        double best_diff = max_it->second;
+        for (const auto& candidate : candidates) {
+            if (candidate.leader != max_it->first) {
+                continue;
+            }
+            for (const auto& follower : candidate.followers) {
+                double src_load = max_it->second - candidate.rate;
+                double des_load = tablet_load[follower] + candidate.rate;
+                double diff = std::max(src_load, des_load) - std::min(src_load, des_load);
+                if (des_load < max_it->second && diff < best_diff) {
+                    best = &candidate;
+                    best_follower = follower;
+                    best_diff = diff;
+                }
+            }
+        }
+        if (best == nullptr) {
+            PDLOG(INFO, "endpoint[%s] is written %.0f/s while the average is %.0f/s, migrate its partitions to balance",
+                  max_it->first.c_str(), max_it->second, avg_load);
+            break;
+        }
+        PDLOG(INFO, "change the leader of table[%s] db[%s] pid[%u] from[%s] to[%s] to balance. rate[%.0f/s]",
+              best->name.c_str(), best->db.c_str(), best->pid, best->leader.c_str(), best_follower.c_str(),
+              best->rate);
+        if (CreateChangeLeaderOP(best->name, best->db, best->pid, best_follower, false) < 0) {
+            PDLOG(WARNING, "change leader failed. name[%s] pid[%u]", best->name.c_str(), best->pid);
+        }
+    } while (false);
+    if (running_.load(std::memory_order_acquire)) {
+        task_thread_pool_.DelayTask(FLAGS_name_server_balance_interval_ms,
+                                    boost::bind(&NameServerImpl::BalanceLeader, this));
+    }
+}
+
 int NameServerImpl::CreateDelReplicaOP(const std::string& name, const std::string& db, uint32_t pid,
                                        const std::string& endpoint) {
     std::string value = endpoint;
@@ -5791,6 +6080,10 @@ void NameServerImpl::OnLocked() {
                                 boost::bind(&NameServerImpl::UpdateTaskStatus, this, false));
     task_thread_pool_.AddTask(boost::bind(&NameServerImpl::UpdateTableStatus, this));
     task_thread_pool_.AddTask(boost::bind(&NameServerImpl::ProcessTask, this));
+    if (FLAGS_name_server_balance_interval_ms > 0) {
+        task_thread_pool_.DelayTask(FLAGS_name_server_balance_interval_ms,
+                                    boost::bind(&NameServerImpl::BalanceLeader, this));
+    }
     thread_pool_.AddTask(boost::bind(&NameServerImpl::DistributeTabletMode, this));
     task_thread_pool_.DelayTask(FLAGS_get_replica_status_interval,
                                 boost::bind(&NameServerImpl::CheckClusterInfo, this));
@@ -7622,15 +7915,7 @@ void NameServerImpl::UpdatePartitionStatus(const std::string& name, const std::s
                     table_partition->mutable_partition_meta(meta_idx);
                 partition_meta->set_is_leader(is_leader);
                 partition_meta->set_is_alive(is_alive);
-                if (!UpdateZkTableNode(table_info)) {
-                    task_info->set_status(::openmldb::api::TaskStatus::kFailed);
-                    return;
-                }
-                task_info->set_status(::openmldb::api::TaskStatus::kDone);
-                PDLOG(INFO,
-                      "update task status from[kDoing] to[kDone]. op_id[%lu], "
-                      "task_type[%s]",
-                      task_info->op_id(), ::openmldb::api::TaskType_Name(task_info->task_type()).c_str());
+                UpdateZkTableNodeDelayed(table_info, task_info);
                 return;
             }
         }
@@ -7709,8 +7994,8 @@ void NameServerImpl::UpdateTableAliveStatus(RpcController* controller, const Upd
     }
 }
 
-int NameServerImpl::UpdateEndpointTableAliveHandle(const std::string& endpoint, TableInfos& table_infos,
-                                                   bool is_alive) {  // NOLINT
+int NameServerImpl::UpdateEndpointTableAliveHandle(const std::string& endpoint, TableInfos& table_infos,  // NOLINT
+                                                   bool is_alive, std::vector<const TableInfo*>* updated_tables) {
     for (const auto& kv : table_infos) {
         ::google::protobuf::RepeatedPtrField<TablePartition>* table_parts = kv.second->mutable_table_partition();
         bool has_update = false;
@@ -7739,13 +8024,8 @@ int NameServerImpl::UpdateEndpointTableAliveHandle(const std::string& endpoint,
             }
         }
         if (has_update) {
-            if (!UpdateZkTableNodeWithoutNotify(kv.second.get())) {
-                LOG(WARNING) << "update fail. table[" << kv.first << "] endpoint[" << endpoint << "] is_alive["
-                             << is_alive << "]";
-                return -1;
-            }
-            LOG(INFO) << "update success. table[" << kv.first << "] endpoint[" << endpoint << "] is_alive[" << is_alive
-                      << "]";
+            updated_tables->push_back(kv.second.get());
+            LOG(INFO) << "update table[" << kv.first << "] endpoint[" << endpoint << "] is_alive[" << is_alive << "]";
         }
     }
     return 0;
@@ -7757,16 +8037,22 @@ int NameServerImpl::UpdateEndpointTableAlive(const std::string& endpoint, bool i
         return 0;
     }
     std::lock_guard<std::mutex> lock(mu_);
-    int ret = UpdateEndpointTableAliveHandle(endpoint, table_info_, is_alive);
+    // the tables hosted by the endpoint are written in transactions rather than one by one
+    std::vector<const TableInfo*> updated_tables;
+    int ret = UpdateEndpointTableAliveHandle(endpoint, table_info_, is_alive, &updated_tables);
     if (ret != 0) {
         return ret;
     }
     for (auto& kv : db_table_info_) {
-        ret = UpdateEndpointTableAliveHandle(endpoint, kv.second, is_alive);
+        ret = UpdateEndpointTableAliveHandle(endpoint, kv.second, is_alive, &updated_tables);
         if (ret != 0) {
             return ret;
         }
     }
+    if (!updated_tables.empty() && !UpdateZkTableNodes(updated_tables)) {
+        LOG(WARNING) << "update the tables of endpoint[" << endpoint << "] failed. is_alive[" << is_alive << "]";
+        return -1;
+    }
     NotifyTableChanged();
     return 0;
 }
@@ -7865,13 +8151,10 @@ void NameServerImpl::SelectLeader(const std::string& name, const std::string& db
         cur_term = term_ + 1;
         term_ += 2;
     }
-    // select the max offset endpoint as leader
-    uint64_t max_offset = 0;
-    std::vector<std::string> leader_endpoint_vec;
-    for (const auto& endpoint : follower_endpoint) {
-        std::shared_ptr<TabletInfo> tablet_ptr;
-        {
-            std::lock_guard<std::mutex> lock(mu_);
+    std::vector<std::shared_ptr<TabletInfo>> tablets;
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        for (const auto& endpoint : follower_endpoint) {
             auto it = tablets_.find(endpoint);
             if (it == tablets_.end() || it->second->state_ != ::openmldb::type::EndpointState::kHealthy) {
                 PDLOG(WARNING, "endpoint[%s] is offline. table[%s] pid[%u]  op_id[%lu]", endpoint.c_str(), name.c_str(),
@@ -7879,15 +8162,41 @@ void NameServerImpl::SelectLeader(const std::string& name, const std::string& db
                 task_info->set_status(::openmldb::api::TaskStatus::kFailed);
                 return;
             }
-            tablet_ptr = it->second;
+            tablets.push_back(it->second);
         }
-        uint64_t offset = 0;
-        if (!tablet_ptr->client_->FollowOfNoOne(tid, pid, cur_term, offset)) {
+    }
+    // stop all the followers following the old leader at the same time, the offsets are got after
+    // they are fenced by the new term so they can not be taken from the status reported before
+    std::vector<openmldb::RpcCallback<::openmldb::api::AppendEntriesResponse>*> callbacks;
+    for (const auto& tablet_ptr : tablets) {
+        auto callback = new openmldb::RpcCallback<::openmldb::api::AppendEntriesResponse>(
+            std::make_shared<::openmldb::api::AppendEntriesResponse>(), std::make_shared<brpc::Controller>());
+        // one reference is released by the rpc and the other one after the response is handled
+        callback->Ref();
+        if (!tablet_ptr->client_->FollowOfNoOne(tid, pid, cur_term, callback)) {
+            // the response is left failed
+            callback->GetController()->SetFailed("fail to send the request");
+            callback->UnRef();
+        }
+        callbacks.push_back(callback);
+    }
+    bool ok = true;
+    // select the max offset endpoint as leader
+    uint64_t max_offset = 0;
+    std::vector<std::string> leader_endpoint_vec;
+    for (size_t idx = 0; idx < callbacks.size(); idx++) {
+        auto callback = callbacks[idx];
+        const std::string& endpoint = follower_endpoint[idx];
+        brpc::Join(callback->GetController()->call_id());
+        if (callback->GetController()->Failed() || callback->GetResponse()->code() != 0) {
             PDLOG(WARNING, "followOfNoOne failed. tid[%u] pid[%u] endpoint[%s] op_id[%lu]", tid, pid, endpoint.c_str(),
                   task_info->op_id());
-            task_info->set_status(::openmldb::api::TaskStatus::kFailed);
-            return;
+            ok = false;
+            callback->UnRef();
+            continue;
         }
+        uint64_t offset = callback->GetResponse()->log_offset();
+        callback->UnRef();
         PDLOG(INFO,
               "FollowOfNoOne ok. term[%lu] offset[%lu] name[%s] tid[%u] "
               "pid[%u] endpoint[%s]",
@@ -7900,6 +8209,10 @@ void NameServerImpl::SelectLeader(const std::string& name, const std::string& db
             leader_endpoint_vec.push_back(endpoint);
         }
     }
+    if (!ok) {
+        task_info->set_status(::openmldb::api::TaskStatus::kFailed);
+        return;
+    }
     std::shared_ptr<OPData> op_data = FindRunningOP(task_info->op_id());
     if (!op_data) {
         PDLOG(WARNING, "cannot find op[%lu] in running op", task_info->op_id());
@@ -8121,18 +8434,9 @@ void NameServerImpl::UpdateLeaderInfo(std::shared_ptr<::openmldb::api::TaskInfo>
         ::openmldb::nameserver::TermPair* term_offset = table_partition->add_term_offset();
         term_offset->set_term(change_leader_data.term());
         term_offset->set_offset(change_leader_data.offset() + 1);
-        if (!UpdateZkTableNode(table_info)) {
-            task_info->set_status(::openmldb::api::TaskStatus::kFailed);
-            return;
-        }
-        PDLOG(INFO, "change leader success. name[%s] pid[%u] new leader[%s]", name.c_str(), pid,
-              leader_endpoint.c_str());
-        task_info->set_status(::openmldb::api::TaskStatus::kDone);
+        PDLOG(INFO, "change leader. name[%s] pid[%u] new leader[%s]", name.c_str(), pid, leader_endpoint.c_str());
         // notify client to update table partition information
-        PDLOG(INFO,
-              "update task status from[kDoing] to[kDone]. op_id[%lu], "
-              "task_type[%s]",
-              task_info->op_id(), ::openmldb::api::TaskType_Name(task_info->task_type()).c_str());
+        UpdateZkTableNodeDelayed(table_info, task_info);
         return;
     }
     PDLOG(WARNING, "partition[%u] is not exist. name[%s] op_id[%lu]", pid, name.c_str(), task_info->op_id());
@@ -9129,15 +9433,17 @@ bool NameServerImpl::UpdateZkTableNode(const std::shared_ptr<::openmldb::nameser
     return false;
 }
 
+std::string NameServerImpl::GetZkTableNode(const TableInfo* table_info) {
+    if (table_info->db().empty()) {
+        return zk_table_data_path_ + "/" + table_info->name();
+    }
+    return zk_db_table_data_path_ + "/" + std::to_string(table_info->tid());
+}
+
 bool NameServerImpl::UpdateZkTableNodeWithoutNotify(const TableInfo* table_info) {
     std::string table_value;
     table_info->SerializeToString(&table_value);
-    std::string temp_path;
-    if (table_info->db().empty()) {
-        temp_path = zk_table_data_path_ + "/" + table_info->name();
-    } else {
-        temp_path = zk_db_table_data_path_ + "/" + std::to_string(table_info->tid());
-    }
+    std::string temp_path = GetZkTableNode(table_info);
     if (!zk_client_->SetNodeValue(temp_path, table_value)) {
         LOG(WARNING) << "update table node[" << temp_path << "] failed!";
         return false;
@@ -9146,6 +9452,82 @@ bool NameServerImpl::UpdateZkTableNodeWithoutNotify(const TableInfo* table_info)
     return true;
 }
 
+bool NameServerImpl::UpdateZkTableNodes(const std::vector<const TableInfo*>& table_infos) {
+    std::vector<std::string> nodes;
+    std::vector<std::string> values;
+    uint64_t bytes = 0;
+    for (uint32_t i = 0; i < table_infos.size(); i++) {
+        nodes.push_back(GetZkTableNode(table_infos[i]));
+        values.emplace_back();
+        table_infos[i]->SerializeToString(&values.back());
+        bytes += values.back().size();
+        if (i + 1 < table_infos.size() && bytes < FLAGS_name_server_zk_multi_max_bytes) {
+            continue;
+        }
+        if (nodes.size() == 1 ? !zk_client_->SetNodeValue(nodes[0], values[0])
+                              : !zk_client_->SetNodesValue(nodes, values)) {
+            LOG(WARNING) << "update " << nodes.size() << " table nodes failed";
+            return false;
+        }
+        LOG(INFO) << "update " << nodes.size() << " table nodes success";
+        nodes.clear();
+        values.clear();
+        bytes = 0;
+    }
+    return true;
+}
+
+void NameServerImpl::UpdateZkTableNodeDelayed(const std::shared_ptr<TableInfo>& table_info,
+                                              const std::shared_ptr<::openmldb::api::TaskInfo>& task_info) {
+    if (FLAGS_name_server_table_update_window_ms == 0) {
+        if (!UpdateZkTableNode(table_info)) {
+            task_info->set_status(::openmldb::api::TaskStatus::kFailed);
+            return;
+        }
+        task_info->set_status(::openmldb::api::TaskStatus::kDone);
+        PDLOG(INFO, "update task status from[kDoing] to[kDone]. op_id[%lu], task_type[%s]", task_info->op_id(),
+              ::openmldb::api::TaskType_Name(task_info->task_type()).c_str());
+        return;
+    }
+    if (delayed_table_nodes_.empty()) {
+        thread_pool_.DelayTask(FLAGS_name_server_table_update_window_ms,
+                               boost::bind(&NameServerImpl::FlushZkTableNodes, this));
+    }
+    delayed_table_nodes_[GetZkTableNode(table_info.get())] = table_info;
+    delayed_table_tasks_.push_back(task_info);
+}
+
+void NameServerImpl::FlushZkTableNodes() {
+    std::lock_guard<std::mutex> lock(mu_);
+    if (delayed_table_nodes_.empty()) {
+        return;
+    }
+    // the nodes take the latest values of the tables, which include all the updates in the window
+    bool ok = false;
+    if (running_.load(std::memory_order_acquire)) {
+        std::vector<const TableInfo*> table_infos;
+        for (const auto& kv : delayed_table_nodes_) {
+            table_infos.push_back(kv.second.get());
+        }
+        ok = UpdateZkTableNodes(table_infos);
+        if (ok) {
+            NotifyTableChanged();
+        }
+    } else {
+        PDLOG(WARNING, "cur nameserver is not leader");
+    }
+    for (const auto& task_info : delayed_table_tasks_) {
+        task_info->set_status(ok ? ::openmldb::api::TaskStatus::kDone : ::openmldb::api::TaskStatus::kFailed);
+        PDLOG(INFO, "update task status from[kDoing] to[%s]. op_id[%lu], task_type[%s]",
+              ::openmldb::api::TaskStatus_Name(task_info->status()).c_str(), task_info->op_id(),
+              ::openmldb::api::TaskType_Name(task_info->task_type()).c_str());
+    }
+    PDLOG(INFO, "flush %u table nodes of %u tasks", static_cast<uint32_t>(delayed_table_nodes_.size()),
+          static_cast<uint32_t>(delayed_table_tasks_.size()));
+    delayed_table_nodes_.clear();
+    delayed_table_tasks_.clear();
+}
+
 void NameServerImpl::AddIndex(RpcController* controller, const AddIndexRequest* request, GeneralResponse* response,
                               Closure* done) {
     brpc::ClosureGuard done_guard(done);
@@ -78,6 +78,16 @@ struct TabletInfo {
     bool Health() { return state_ == ::openmldb::type::EndpointState::kHealthy; }
 };
 
+// the status of the partitions got from one tablet, the tablet only returns the ones changed
+// after the version if the epoch is not changed
+struct TabletStatusCache {
+    uint64_t epoch_ = 0;
+    uint64_t version_ = 0;
+    bool has_version_ = false;
+    // keyed by tid << 32 | pid
+    std::unordered_map<uint64_t, ::openmldb::api::TableStatus> status_;
+};
+
 struct NearLineTabletInfo : public EndpointInfo {
     std::shared_ptr<::openmldb::client::NearLineTabletClient> client_;
 };
@@ -468,7 +478,8 @@ class NameServerImpl : public NameServer {
                                uint32_t pid, bool is_leader, bool is_alive,
                                std::shared_ptr<::openmldb::api::TaskInfo> task_info);
 
-    int UpdateEndpointTableAliveHandle(const std::string& endpoint, TableInfos& table_infos, bool is_alive);  // NOLINT
+    int UpdateEndpointTableAliveHandle(const std::string& endpoint, TableInfos& table_infos, bool is_alive,  // NOLINT
+                                       std::vector<const TableInfo*>* updated_tables);
 
     int UpdateEndpointTableAlive(const std::string& endpoint, bool is_alive);
 
@@ -681,6 +692,8 @@ class NameServerImpl : public NameServer {
     void NotifyTableChanged();
     void DeleteDoneOP();
     void UpdateTableStatus();
+    // move one leader from the tablet written most to the one written least if the load is not even
+    void BalanceLeader();
     int DropTableOnTablet(std::shared_ptr<::openmldb::nameserver::TableInfo> table_info);
 
     void CheckBinlogSyncProgress(const std::string& name, const std::string& db, uint32_t pid,
@@ -751,6 +764,18 @@ class NameServerImpl : public NameServer {
 
     bool UpdateZkTableNodeWithoutNotify(const TableInfo* table_info);
 
+    std::string GetZkTableNode(const TableInfo* table_info);
+
+    // write the table nodes in the transactions of at most name_server_zk_multi_max_bytes
+    bool UpdateZkTableNodes(const std::vector<const TableInfo*>& table_infos);
+
+    // the table node is written with the other updates in name_server_table_update_window_ms, and the task is
+    // done when it is written. mu_ should be held
+    void UpdateZkTableNodeDelayed(const std::shared_ptr<TableInfo>& table_info,
+                                  const std::shared_ptr<::openmldb::api::TaskInfo>& task_info);
+
+    void FlushZkTableNodes();
+
     void ShowDbTable(const std::map<std::string, std::shared_ptr<TableInfo>>& table_infos,
                      const ShowTableRequest* request, ShowTableResponse* response);
 
@@ -795,6 +820,14 @@ class NameServerImpl : public NameServer {
     std::atomic<bool> running_;
     std::list<std::shared_ptr<OPData>> done_op_list_;
     std::vector<std::list<std::shared_ptr<OPData>>> task_vec_;
+    // the tables to write to zk in the window keyed by the node, and the tasks waiting for them
+    std::map<std::string, std::shared_ptr<TableInfo>> delayed_table_nodes_;
+    std::vector<std::shared_ptr<::openmldb::api::TaskInfo>> delayed_table_tasks_;
+    std::mutex table_status_mu_;
+    std::map<std::string, TabletStatusCache> tablet_status_cache_;
+    // the leader offsets of the partitions keyed by db.name.pid in the last round of BalanceLeader
+    std::map<std::string, uint64_t> balance_offsets_;
+    uint64_t balance_time_;
     std::condition_variable cv_;
     std::atomic<bool> auto_failover_;
     std::atomic<uint32_t> mode_;
@@ -0,0 +1,405 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "replica/binlog_aggregator.h"
+
+#include <snappy.h>
+
+#include <algorithm>
+
+#include "base/glog_wapper.h"
+#include "codec/codec.h"
+#include "codec/schema_codec.h"
+#include "common/timer.h"
+#include "log/log_reader.h"
+#include "storage/ticket.h"
+
+namespace openmldb {
+namespace replica {
+
+using ::openmldb::storage::AggrBucket;
+using ::openmldb::storage::PreAggregator;
+using ::openmldb::storage::TableIterator;
+using ::openmldb::storage::Ticket;
+
+// the columns of the aggr table
+enum AggrColumn : uint32_t {
+    kAggrKey = 0,
+    kAggrTsStart,
+    kAggrNumRows,
+    kAggrIntSum,
+    kAggrDoubleSum,
+    kAggrMin,
+    kAggrMax,
+    kAggrBinlogOffset,
+};
+
+// the rows of the key record the binlog offset consumed by every sync
+static const char BINLOG_OFFSET_KEY[] = "\x01__binlog_offset__";
+
+static uint32_t GetColumnCount(Table* table, const int8_t* row, uint32_t size) {
+    if (size < ::openmldb::codec::HEADER_LENGTH) {
+        return 0;
+    }
+    auto schema = table->GetVersionSchema(::openmldb::codec::RowView::GetSchemaVersion(row));
+    return schema ? schema->size() : 0;
+}
+
+BinlogAggregator::BinlogAggregator(const ::openmldb::api::PreAggregation& desc, std::shared_ptr<Table> base_table,
+                                   std::shared_ptr<LogReplicator> base_replicator, std::shared_ptr<Table> aggr_table,
+                                   std::shared_ptr<LogReplicator> aggr_replicator)
+    : desc_(desc),
+      base_table_(base_table),
+      base_replicator_(base_replicator),
+      aggr_table_(aggr_table),
+      aggr_replicator_(aggr_replicator),
+      index_id_(0),
+      buckets_(),
+      mu_(),
+      offset_(0) {}
+
+void BinlogAggregator::SetAggrTableSchema(::openmldb::api::TableMeta* table_meta) {
+    using ::openmldb::codec::SchemaCodec;
+    table_meta->clear_column_desc();
+    table_meta->clear_column_key();
+    SchemaCodec::SetColumnDesc(table_meta->add_column_desc(), "key", ::openmldb::type::kString);
+    SchemaCodec::SetColumnDesc(table_meta->add_column_desc(), "ts_start", ::openmldb::type::kTimestamp);
+    SchemaCodec::SetColumnDesc(table_meta->add_column_desc(), "num_rows", ::openmldb::type::kBigInt);
+    SchemaCodec::SetColumnDesc(table_meta->add_column_desc(), "int_sum", ::openmldb::type::kBigInt);
+    SchemaCodec::SetColumnDesc(table_meta->add_column_desc(), "double_sum", ::openmldb::type::kDouble);
+    SchemaCodec::SetColumnDesc(table_meta->add_column_desc(), "min_val", ::openmldb::type::kDouble);
+    SchemaCodec::SetColumnDesc(table_meta->add_column_desc(), "max_val", ::openmldb::type::kDouble);
+    SchemaCodec::SetColumnDesc(table_meta->add_column_desc(), "binlog_offset", ::openmldb::type::kBigInt);
+    SchemaCodec::SetIndex(table_meta->add_column_key(), "key", "key", "ts_start", ::openmldb::type::kAbsoluteTime, 0,
+                          0);
+    table_meta->set_format_version(1);
+}
+
+bool BinlogAggregator::Init() {
+    auto base_meta = base_table_->GetTableMeta();
+    if (base_meta->format_version() != 1) {
+        PDLOG(WARNING, "pre-aggregation needs the rows of format version 1. tid %u pid %u", base_table_->GetId(),
+              base_table_->GetPid());
+        return false;
+    }
+    auto index_def = base_table_->GetIndex(desc_.index_name());
+    if (!index_def) {
+        PDLOG(WARNING, "index %s of pre-aggregation is not found. tid %u pid %u", desc_.index_name().c_str(),
+              base_table_->GetId(), base_table_->GetPid());
+        return false;
+    }
+    index_id_ = index_def->GetId();
+    auto ts_col = index_def->GetTsColumn();
+    buckets_.reset(new PreAggregator(desc_, index_id_, ts_col ? static_cast<int32_t>(ts_col->GetTsIdx()) : -1));
+    if (!buckets_->Init(base_meta->column_desc())) {
+        return false;
+    }
+    ::openmldb::api::TableMeta expect_meta;
+    SetAggrTableSchema(&expect_meta);
+    auto aggr_meta = aggr_table_->GetTableMeta();
+    bool schema_matched = aggr_meta->format_version() == 1 &&
+                          aggr_meta->column_desc_size() == expect_meta.column_desc_size() &&
+                          aggr_meta->column_key_size() > 0 &&
+                          aggr_meta->column_key(0).ts_name() == expect_meta.column_key(0).ts_name();
+    for (int i = 0; schema_matched && i < expect_meta.column_desc_size(); i++) {
+        schema_matched = aggr_meta->column_desc(i).name() == expect_meta.column_desc(i).name() &&
+                         aggr_meta->column_desc(i).data_type() == expect_meta.column_desc(i).data_type();
+    }
+    if (!schema_matched) {
+        PDLOG(WARNING, "the schema of aggr table tid %u is mismatched", aggr_table_->GetId());
+        return false;
+    }
+    // recover the offset by the latest row of the offset key
+    Ticket ticket;
+    std::unique_ptr<TableIterator> it(aggr_table_->NewIterator(0, BINLOG_OFFSET_KEY, ticket));
+    if (it) {
+        it->SeekToFirst();
+        if (it->Valid()) {
+            auto value = it->GetValue();
+            ::openmldb::codec::RowView view(aggr_meta->column_desc(), reinterpret_cast<const int8_t*>(value.data()),
+                                           value.size());
+            int64_t offset = 0;
+            if (view.GetInt64(kAggrBinlogOffset, &offset) == 0) {
+                offset_.store(offset, std::memory_order_relaxed);
+            }
+        }
+    }
+    PDLOG(INFO, "init aggregator of %s on index %s with aggr table tid %u, offset %lu. tid %u pid %u",
+          desc_.aggr_col().c_str(), desc_.index_name().c_str(), aggr_table_->GetId(), GetOffset(),
+          base_table_->GetId(), base_table_->GetPid());
+    return true;
+}
+
+int BinlogAggregator::GetLogPartIndex() {
+    ::openmldb::log::LogReader log_reader(base_replicator_->GetLogPart(), base_replicator_->GetLogPath(), false);
+    return log_reader.GetLogPartIndex(GetOffset());
+}
+
+bool BinlogAggregator::ParseEntry(const ::openmldb::api::LogEntry& entry, std::string* buffer) {
+    if (entry.has_method_type() && entry.method_type() == ::openmldb::api::MethodType::kDelete &&
+        entry.has_end_ts()) {
+        // the buckets are kept for the deletes of a ts range like MemTable::DeleteRange
+        return true;
+    }
+    const std::string* key = NULL;
+    if (entry.dimensions_size() == 0) {
+        if (index_id_ == 0) {
+            key = &entry.pk();
+        }
+    } else {
+        for (const auto& dimension : entry.dimensions()) {
+            if (dimension.idx() == index_id_) {
+                key = &dimension.key();
+                break;
+            }
+        }
+    }
+    if (key == NULL) {
+        return true;
+    }
+    if (entry.has_method_type() && entry.method_type() == ::openmldb::api::MethodType::kDelete) {
+        // the buckets of the key before the delete are written first
+        if (!WriteBuckets(entry.log_index() - 1)) {
+            return false;
+        }
+        aggr_table_->Delete(*key, 0);
+        ::openmldb::api::LogEntry delete_entry;
+        delete_entry.set_method_type(::openmldb::api::MethodType::kDelete);
+        delete_entry.set_term(aggr_replicator_->GetLeaderTerm());
+        auto dimension = delete_entry.add_dimensions();
+        dimension->set_key(*key);
+        dimension->set_idx(0);
+        return aggr_replicator_->AppendEntry(delete_entry);
+    }
+    uint64_t ts = entry.ts();
+    if (buckets_->GetTsIdx() >= 0) {
+        bool has_found_ts = false;
+        for (const auto& ts_dimension : entry.ts_dimensions()) {
+            if (static_cast<int32_t>(ts_dimension.idx()) == buckets_->GetTsIdx()) {
+                ts = ts_dimension.ts();
+                has_found_ts = true;
+                break;
+            }
+        }
+        if (!has_found_ts) {
+            return true;
+        }
+    }
+    const char* data = entry.value().data();
+    uint32_t size = entry.value().size();
+    if (base_table_->GetCompressType() == ::openmldb::type::kSnappy) {
+        buffer->clear();
+        snappy::Uncompress(data, size, buffer);
+        data = buffer->data();
+        size = buffer->size();
+    }
+    const int8_t* row = reinterpret_cast<const int8_t*>(data);
+    uint32_t col_cnt = GetColumnCount(base_table_.get(), row, size);
+    if (col_cnt > 0) {
+        buckets_->Update(::openmldb::base::Slice(*key), ts, row, size, col_cnt);
+    }
+    return true;
+}
+
+void BinlogAggregator::DropBuckets() {
+    // the entries after the offset are consumed again by the next sync
+    std::vector<AggrBucket> buckets;
+    buckets_->TakeBuckets(&buckets);
+}
+
+bool BinlogAggregator::WriteBuckets(uint64_t offset) {
+    std::vector<AggrBucket> buckets;
+    buckets_->TakeBuckets(&buckets);
+    // the offset row goes last, so the offset is recovered only if the buckets are written
+    buckets.push_back({BINLOG_OFFSET_KEY, ::baidu::common::timer::get_micros() / 1000, AggrState()});
+    auto aggr_meta = aggr_table_->GetTableMeta();
+    ::openmldb::codec::RowBuilder builder(aggr_meta->column_desc());
+    std::string row;
+    for (const auto& bucket : buckets) {
+        uint32_t size = builder.CalTotalLength(bucket.pk.size());
+        row.resize(size);
+        builder.SetBuffer(reinterpret_cast<int8_t*>(&row[0]), size);
+        builder.AppendString(bucket.pk.c_str(), bucket.pk.size());
+        builder.AppendTimestamp(bucket.start);
+        builder.AppendInt64(bucket.state.count);
+        builder.AppendInt64(bucket.state.int_sum);
+        builder.AppendDouble(bucket.state.double_sum);
+        builder.AppendDouble(bucket.state.min);
+        builder.AppendDouble(bucket.state.max);
+        builder.AppendInt64(offset);
+        ::openmldb::api::LogEntry entry;
+        entry.set_term(aggr_replicator_->GetLeaderTerm());
+        entry.set_value(row);
+        auto dimension = entry.add_dimensions();
+        dimension->set_key(bucket.pk);
+        dimension->set_idx(0);
+        auto ts_dimension = entry.add_ts_dimensions();
+        ts_dimension->set_ts(bucket.start);
+        ts_dimension->set_idx(0);
+        if (!aggr_table_->Put(entry) || !aggr_replicator_->AppendEntry(entry)) {
+            PDLOG(WARNING, "fail to write the bucket of aggr table tid %u. tid %u pid %u", aggr_table_->GetId(),
+                  base_table_->GetId(), base_table_->GetPid());
+            return false;
+        }
+    }
+    aggr_replicator_->Notify();
+    offset_.store(offset, std::memory_order_relaxed);
+    return true;
+}
+
+bool BinlogAggregator::Sync(uint64_t max_cnt) {
+    std::lock_guard<std::mutex> lock(mu_);
+    uint64_t cur_offset = GetOffset();
+    uint64_t end_offset = base_replicator_->GetOffset();
+    if (cur_offset >= end_offset) {
+        return true;
+    }
+    ::openmldb::log::LogReader log_reader(base_replicator_->GetLogPart(), base_replicator_->GetLogPath(), false);
+    log_reader.SetOffset(cur_offset);
+    int last_log_index = log_reader.GetLogIndex();
+    uint64_t cnt = 0;
+    std::string buffer;
+    std::string value_buffer;
+    ::openmldb::api::LogEntry entry;
+    while (cur_offset < end_offset && cnt < max_cnt) {
+        buffer.clear();
+        ::openmldb::base::Slice record;
+        ::openmldb::base::Status status = log_reader.ReadNextRecord(&record, &buffer);
+        if (status.IsWaitRecord()) {
+            int end_log_index = log_reader.GetEndLogIndex();
+            if (end_log_index >= 0 && end_log_index > log_reader.GetLogIndex()) {
+                log_reader.RollRLogFile();
+                continue;
+            }
+            break;
+        }
+        if (status.IsEof()) {
+            if (log_reader.GetLogIndex() != last_log_index) {
+                last_log_index = log_reader.GetLogIndex();
+                continue;
+            }
+            break;
+        }
+        if (!status.ok()) {
+            continue;
+        }
+        if (!entry.ParseFromArray(record.data(), record.size())) {
+            PDLOG(WARNING, "fail to parse the binlog record. tid %u pid %u", base_table_->GetId(),
+                  base_table_->GetPid());
+            continue;
+        }
+        if (entry.log_index() <= cur_offset) {
+            continue;
+        }
+        if (!ParseEntry(entry, &value_buffer)) {
+            DropBuckets();
+            return false;
+        }
+        cur_offset = entry.log_index();
+        cnt++;
+    }
+    if (cnt == 0) {
+        return true;
+    }
+    if (!WriteBuckets(cur_offset)) {
+        DropBuckets();
+        return false;
+    }
+    DEBUGLOG("aggregate %lu binlog entries to offset %lu. tid %u pid %u", cnt, cur_offset, base_table_->GetId(),
+             base_table_->GetPid());
+    return true;
+}
+
+void BinlogAggregator::Query(const std::string& pk, uint64_t st, uint64_t et, AggrState* state,
+                             std::vector<std::pair<uint64_t, uint64_t>>* edges) {
+    if (st > et) {
+        return;
+    }
+    uint64_t first_start = 0;
+    uint64_t last_end = 0;
+    Ticket ticket;
+    std::unique_ptr<TableIterator> it(aggr_table_->NewIterator(0, pk, ticket));
+    if (!PreAggregator::GetCoveredBuckets(st, et, desc_.bucket_size(), &first_start, &last_end) || !it) {
+        edges->emplace_back(st, et);
+        return;
+    }
+    it->SeekToFirst();
+    // the latest bucket may be still receiving rows
+    if (it->Valid()) {
+        last_end = std::min(last_end, it->GetKey());
+    }
+    if (last_end <= first_start) {
+        edges->emplace_back(st, et);
+        return;
+    }
+    if (st < first_start) {
+        edges->emplace_back(st, first_start - 1);
+    }
+    if (last_end <= et) {
+        edges->emplace_back(last_end, et);
+    }
+    auto aggr_meta = aggr_table_->GetTableMeta();
+    ::openmldb::codec::RowView view(aggr_meta->column_desc());
+    // the rows of a bucket written by several syncs are all merged
+    for (it->Seek(last_end - 1); it->Valid() && it->GetKey() >= first_start; it->Next()) {
+        auto value = it->GetValue();
+        if (!view.Reset(reinterpret_cast<const int8_t*>(value.data()), value.size())) {
+            continue;
+        }
+        AggrState bucket;
+        int64_t count = 0;
+        view.GetInt64(kAggrNumRows, &count);
+        bucket.count = count;
+        view.GetInt64(kAggrIntSum, &bucket.int_sum);
+        view.GetDouble(kAggrDoubleSum, &bucket.double_sum);
+        view.GetDouble(kAggrMin, &bucket.min);
+        view.GetDouble(kAggrMax, &bucket.max);
+        state->Merge(bucket);
+    }
+}
+
+bool BinlogAggregator::Aggregate(const std::string& pk, uint64_t st, uint64_t et, AggrState* state) {
+    std::vector<std::pair<uint64_t, uint64_t>> edges;
+    Query(pk, st, et, state, &edges);
+    if (edges.empty()) {
+        return true;
+    }
+    Ticket ticket;
+    std::unique_ptr<TableIterator> it(base_table_->NewIterator(index_id_, pk, ticket));
+    if (!it) {
+        return false;
+    }
+    std::string buffer;
+    for (const auto& edge : edges) {
+        for (it->Seek(edge.second); it->Valid() && it->GetKey() >= edge.first; it->Next()) {
+            auto value = it->GetValue();
+            const char* data = value.data();
+            uint32_t size = value.size();
+            if (base_table_->GetCompressType() == ::openmldb::type::kSnappy) {
+                buffer.clear();
+                snappy::Uncompress(data, size, &buffer);
+                data = buffer.data();
+                size = buffer.size();
+            }
+            const int8_t* row = reinterpret_cast<const int8_t*>(data);
+            buckets_->Fold(row, size, GetColumnCount(base_table_.get(), row, size), state);
+        }
+    }
+    return true;
+}
+
+}  // namespace replica
+}  // namespace openmldb
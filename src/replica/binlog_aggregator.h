@@ -0,0 +1,100 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_REPLICA_BINLOG_AGGREGATOR_H_
+#define SRC_REPLICA_BINLOG_AGGREGATOR_H_
+
+#include <atomic>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "proto/tablet.pb.h"
+#include "replica/log_replicator.h"
+#include "storage/pre_aggregator.h"
+#include "storage/table.h"
+
+namespace openmldb {
+namespace replica {
+
+using ::openmldb::storage::AggrState;
+
+// Consumes the binlog of a table and writes the aggregation of a column in the
+// buckets of every key of an index into a companion table. Each sync writes a
+// row for every key and bucket it touches, so the aggregation over a long
+// window merges a few rows per bucket instead of scanning all the rows of the
+// base table.
+class BinlogAggregator {
+ public:
+    BinlogAggregator(const ::openmldb::api::PreAggregation& desc, std::shared_ptr<Table> base_table,
+                     std::shared_ptr<LogReplicator> base_replicator, std::shared_ptr<Table> aggr_table,
+                     std::shared_ptr<LogReplicator> aggr_replicator);
+    BinlogAggregator(const BinlogAggregator&) = delete;
+    BinlogAggregator& operator=(const BinlogAggregator&) = delete;
+
+    // check the schema of the aggr table and recover the binlog offset consumed from it
+    bool Init();
+
+    // the schema of the companion table, it is indexed by key and ts_start
+    static void SetAggrTableSchema(::openmldb::api::TableMeta* table_meta);
+
+    // consume at most max_cnt entries of the binlog and write the buckets into the aggr table
+    bool Sync(uint64_t max_cnt);
+
+    // the last binlog offset consumed
+    inline uint64_t GetOffset() const { return offset_.load(std::memory_order_relaxed); }
+
+    // the log part of the binlog not consumed yet
+    int GetLogPartIndex();
+
+    inline uint32_t GetAggrTid() const { return aggr_table_->GetId(); }
+
+    // merge the rows of the buckets of pk covered by [st, et] into state. The latest
+    // bucket of pk may be consumed partially, so it is left in edges with the
+    // ranges at the edges of the window
+    void Query(const std::string& pk, uint64_t st, uint64_t et, AggrState* state,
+               std::vector<std::pair<uint64_t, uint64_t>>* edges);
+
+    // aggregate the rows of pk with ts in [st, et], the rows at the edges are scanned in the base table
+    bool Aggregate(const std::string& pk, uint64_t st, uint64_t et, AggrState* state);
+
+ private:
+    bool ParseEntry(const ::openmldb::api::LogEntry& entry, std::string* buffer);
+
+    bool WriteBuckets(uint64_t offset);
+
+    void DropBuckets();
+
+ private:
+    ::openmldb::api::PreAggregation desc_;
+    std::shared_ptr<Table> base_table_;
+    std::shared_ptr<LogReplicator> base_replicator_;
+    std::shared_ptr<Table> aggr_table_;
+    std::shared_ptr<LogReplicator> aggr_replicator_;
+    uint32_t index_id_;
+    // the buckets of the entries consumed by the running sync
+    std::unique_ptr<::openmldb::storage::PreAggregator> buckets_;
+    // serialize the syncs
+    std::mutex mu_;
+    std::atomic<uint64_t> offset_;
+};
+
+}  // namespace replica
+}  // namespace openmldb
+
+#endif  // SRC_REPLICA_BINLOG_AGGREGATOR_H_
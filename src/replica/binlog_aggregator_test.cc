@@ -0,0 +1,203 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "replica/binlog_aggregator.h"
+
+#include <gflags/gflags.h>
+#include <gtest/gtest.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/glog_wapper.h"
+#include "codec/codec.h"
+#include "codec/schema_codec.h"
+#include "storage/mem_table.h"
+#include "storage/ticket.h"
+
+using ::openmldb::codec::SchemaCodec;
+using ::openmldb::storage::MemTable;
+using ::openmldb::storage::PreAggregator;
+using ::openmldb::storage::TableIterator;
+using ::openmldb::storage::Ticket;
+
+namespace openmldb {
+namespace replica {
+
+class BinlogAggregatorTest : public ::testing::Test {
+ public:
+    BinlogAggregatorTest() {}
+    ~BinlogAggregatorTest() {}
+};
+
+inline std::string GenRand() { return std::to_string(rand() % 10000000 + 1); }  // NOLINT
+
+static std::shared_ptr<MemTable> CreateBaseTable() {
+    ::openmldb::api::TableMeta table_meta;
+    table_meta.set_name("t1");
+    table_meta.set_tid(1);
+    table_meta.set_pid(0);
+    table_meta.set_format_version(1);
+    SchemaCodec::SetColumnDesc(table_meta.add_column_desc(), "card", ::openmldb::type::kString);
+    SchemaCodec::SetColumnDesc(table_meta.add_column_desc(), "price", ::openmldb::type::kBigInt);
+    SchemaCodec::SetColumnDesc(table_meta.add_column_desc(), "ts1", ::openmldb::type::kTimestamp);
+    SchemaCodec::SetIndex(table_meta.add_column_key(), "card", "card", "ts1", ::openmldb::type::kAbsoluteTime, 0, 0);
+    auto table = std::make_shared<MemTable>(table_meta);
+    table->Init();
+    return table;
+}
+
+static std::shared_ptr<MemTable> CreateAggrTable() {
+    ::openmldb::api::TableMeta table_meta;
+    table_meta.set_name("t1_aggr");
+    table_meta.set_tid(2);
+    table_meta.set_pid(0);
+    BinlogAggregator::SetAggrTableSchema(&table_meta);
+    auto table = std::make_shared<MemTable>(table_meta);
+    table->Init();
+    return table;
+}
+
+static void PutRow(MemTable* table, LogReplicator* replicator, const std::string& card, int64_t price,
+                   uint64_t ts) {
+    ::openmldb::codec::RowBuilder builder(table->GetTableMeta()->column_desc());
+    uint32_t size = builder.CalTotalLength(card.size());
+    std::string row;
+    row.resize(size);
+    builder.SetBuffer(reinterpret_cast<int8_t*>(&row[0]), size);
+    builder.AppendString(card.c_str(), card.size());
+    builder.AppendInt64(price);
+    builder.AppendTimestamp(ts);
+    ::openmldb::api::LogEntry entry;
+    entry.set_value(row);
+    auto dim = entry.add_dimensions();
+    dim->set_idx(0);
+    dim->set_key(card);
+    auto ts_dim = entry.add_ts_dimensions();
+    ts_dim->set_idx(0);
+    ts_dim->set_ts(ts);
+    ASSERT_TRUE(table->Table::Put(entry));
+    ASSERT_TRUE(replicator->AppendEntry(entry));
+}
+
+static void ScanAggregate(MemTable* table, const PreAggregator& aggr, const std::string& pk, uint64_t st,
+                          uint64_t et, AggrState* state) {
+    Ticket ticket;
+    std::unique_ptr<TableIterator> it(table->NewIterator(0, pk, ticket));
+    for (it->Seek(et); it->Valid() && it->GetKey() >= st; it->Next()) {
+        auto value = it->GetValue();
+        aggr.Fold(reinterpret_cast<const int8_t*>(value.data()), value.size(), 3, state);
+    }
+}
+
+TEST_F(BinlogAggregatorTest, SyncAndAggregate) {
+    std::string folder = "/tmp/" + GenRand() + "/";
+    std::atomic<bool> follower(false);
+    auto base_table = CreateBaseTable();
+    auto base_replicator =
+        std::make_shared<LogReplicator>(folder + "1_0", std::map<std::string, std::string>(), kLeaderNode,
+                                        base_table, &follower);
+    ASSERT_TRUE(base_replicator->Init());
+    auto aggr_table = CreateAggrTable();
+    auto aggr_replicator =
+        std::make_shared<LogReplicator>(folder + "2_0", std::map<std::string, std::string>(), kLeaderNode,
+                                        aggr_table, &follower);
+    ASSERT_TRUE(aggr_replicator->Init());
+    ::openmldb::api::PreAggregation desc;
+    desc.set_index_name("card");
+    desc.set_aggr_col("price");
+    desc.set_bucket_size(100);
+    desc.set_aggr_tid(2);
+    PreAggregator folder_aggr(desc, 0, 0);
+    ASSERT_TRUE(folder_aggr.Init(base_table->GetTableMeta()->column_desc()));
+
+    auto aggregator =
+        std::make_shared<BinlogAggregator>(desc, base_table, base_replicator, aggr_table, aggr_replicator);
+    ASSERT_TRUE(aggregator->Init());
+    ASSERT_EQ(0u, aggregator->GetOffset());
+    for (int i = 0; i < 1000; i++) {
+        PutRow(base_table.get(), base_replicator.get(), "card" + std::to_string(i % 3), i % 17, 1000 + i * 3);
+    }
+    // consumed by two syncs, the rows of a bucket may be split into two rows of the aggr table
+    ASSERT_TRUE(aggregator->Sync(500));
+    ASSERT_EQ(500u, aggregator->GetOffset());
+    ASSERT_TRUE(aggregator->Sync(1000));
+    ASSERT_EQ(1000u, aggregator->GetOffset());
+    for (int i = 1000; i < 1100; i++) {
+        PutRow(base_table.get(), base_replicator.get(), "card" + std::to_string(i % 3), i % 17, 1000 + i * 3);
+    }
+    std::vector<std::pair<uint64_t, uint64_t>> windows = {{0, 100}, {1000, 1299}, {1050, 3999}, {0, 10000}};
+    for (const auto& window : windows) {
+        for (int k = 0; k < 3; k++) {
+            std::string pk = "card" + std::to_string(k);
+            AggrState expect;
+            ScanAggregate(base_table.get(), folder_aggr, pk, window.first, window.second, &expect);
+            AggrState state;
+            ASSERT_TRUE(aggregator->Aggregate(pk, window.first, window.second, &state));
+            ASSERT_EQ(expect.count, state.count);
+            ASSERT_EQ(expect.int_sum, state.int_sum);
+            ASSERT_EQ(expect.min, state.min);
+            ASSERT_EQ(expect.max, state.max);
+        }
+    }
+    // the offset is recovered from the aggr table
+    aggregator = std::make_shared<BinlogAggregator>(desc, base_table, base_replicator, aggr_table, aggr_replicator);
+    ASSERT_TRUE(aggregator->Init());
+    ASSERT_EQ(1000u, aggregator->GetOffset());
+    ASSERT_TRUE(aggregator->Sync(1000));
+    ASSERT_EQ(1100u, aggregator->GetOffset());
+    AggrState expect;
+    ScanAggregate(base_table.get(), folder_aggr, "card1", 0, 10000, &expect);
+    AggrState state;
+    std::vector<std::pair<uint64_t, uint64_t>> edges;
+    aggregator->Query("card1", 0, 10000, &state, &edges);
+    // the latest bucket is scanned
+    ASSERT_EQ(1u, edges.size());
+    ASSERT_EQ(10000u, edges[0].second);
+    ASSERT_LT(0u, state.count);
+    ASSERT_GT(expect.count, state.count);
+    state = AggrState();
+    ASSERT_TRUE(aggregator->Aggregate("card1", 0, 10000, &state));
+    ASSERT_EQ(expect.count, state.count);
+    ASSERT_EQ(expect.int_sum, state.int_sum);
+}
+
+TEST_F(BinlogAggregatorTest, SchemaMismatched) {
+    std::string folder = "/tmp/" + GenRand() + "/";
+    std::atomic<bool> follower(false);
+    auto base_table = CreateBaseTable();
+    auto base_replicator =
+        std::make_shared<LogReplicator>(folder + "1_0", std::map<std::string, std::string>(), kLeaderNode,
+                                        base_table, &follower);
+    ASSERT_TRUE(base_replicator->Init());
+    ::openmldb::api::PreAggregation desc;
+    desc.set_index_name("card");
+    desc.set_aggr_col("price");
+    desc.set_bucket_size(100);
+    BinlogAggregator aggregator(desc, base_table, base_replicator, base_table, base_replicator);
+    ASSERT_FALSE(aggregator.Init());
+}
+
+}  // namespace replica
+}  // namespace openmldb
+
+int main(int argc, char** argv) {
+    srand(time(NULL));
+    ::openmldb::base::SetLogLevel(INFO);
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,90 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "replica/binlog_cache.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace openmldb {
+namespace replica {
+
+BinlogCache::BinlogCache(uint32_t capacity) : capacity_(capacity), mu_(), entries_(), first_index_(0) {
+    if (capacity_ > 0) {
+        entries_.reset(new ::openmldb::base::RingQueue<std::shared_ptr<::openmldb::api::LogEntry>>(capacity_));
+    }
+}
+
+void BinlogCache::Append(const ::openmldb::api::LogEntry& entry) {
+    if (capacity_ == 0) {
+        return;
+    }
+    Append(std::make_shared<::openmldb::api::LogEntry>(entry));
+}
+
+void BinlogCache::Append(const std::shared_ptr<::openmldb::api::LogEntry>& cached) {
+    if (capacity_ == 0) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mu_);
+    if (entries_->empty() || first_index_ + entries_->size() != cached->log_index()) {
+        while (!entries_->empty()) {
+            entries_->pop();
+        }
+        first_index_ = cached->log_index();
+    } else if (entries_->full()) {
+        entries_->pop();
+        first_index_++;
+    }
+    entries_->put(cached);
+}
+
+uint32_t BinlogCache::Read(uint64_t offset, uint32_t max_cnt, ::openmldb::api::AppendEntriesRequest* request) {
+    if (capacity_ == 0) {
+        return 0;
+    }
+    std::vector<std::shared_ptr<::openmldb::api::LogEntry>> hits;
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        uint64_t end_index = first_index_ + entries_->size();
+        if (entries_->empty() || offset + 1 < first_index_ || offset + 1 >= end_index) {
+            return 0;
+        }
+        uint32_t cnt = std::min(static_cast<uint64_t>(max_cnt), end_index - offset - 1);
+        hits.reserve(cnt);
+        for (uint32_t i = 0; i < cnt; i++) {
+            hits.push_back(entries_->at(offset + 1 - first_index_ + i));
+        }
+    }
+    // copy the entries out of the lock so the appender is not blocked
+    for (const auto& entry : hits) {
+        request->add_entries()->CopyFrom(*entry);
+    }
+    return hits.size();
+}
+
+void BinlogCache::Clear() {
+    if (capacity_ == 0) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mu_);
+    // the popped entries are held by the queue until they are overwritten, so renew it to release them
+    entries_.reset(new ::openmldb::base::RingQueue<std::shared_ptr<::openmldb::api::LogEntry>>(capacity_));
+    first_index_ = 0;
+}
+
+}  // namespace replica
+}  // namespace openmldb
@@ -0,0 +1,61 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_REPLICA_BINLOG_CACHE_H_
+#define SRC_REPLICA_BINLOG_CACHE_H_
+
+#include <memory>
+#include <mutex>  // NOLINT
+
+#include "base/ringqueue.h"
+#include "proto/tablet.pb.h"
+
+namespace openmldb {
+namespace replica {
+
+// The latest entries appended to the binlog of a leader, shared by all of its
+// replicate nodes so the followers which keep up are synced without reading the binlog
+class BinlogCache {
+ public:
+    // the cache is disabled if capacity is 0
+    explicit BinlogCache(uint32_t capacity);
+    BinlogCache(const BinlogCache&) = delete;
+    BinlogCache& operator=(const BinlogCache&) = delete;
+
+    // the entries are appended in the order of log index, the cache restarts
+    // from the entry if it does not follow the last one
+    void Append(const ::openmldb::api::LogEntry& entry);
+    // the entry is held by the cache without copy
+    void Append(const std::shared_ptr<::openmldb::api::LogEntry>& entry);
+
+    // add at most max_cnt entries after the offset to the request, return the count
+    // of the added entries, 0 if the entry after the offset is not cached
+    uint32_t Read(uint64_t offset, uint32_t max_cnt, ::openmldb::api::AppendEntriesRequest* request);
+
+    void Clear();
+
+ private:
+    const uint32_t capacity_;
+    std::mutex mu_;
+    std::unique_ptr<::openmldb::base::RingQueue<std::shared_ptr<::openmldb::api::LogEntry>>> entries_;
+    // the log index of the oldest cached entry
+    uint64_t first_index_;
+};
+
+}  // namespace replica
+}  // namespace openmldb
+
+#endif  // SRC_REPLICA_BINLOG_CACHE_H_
@@ -0,0 +1,102 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "replica/binlog_cache.h"
+
+#include <string>
+
+#include "gtest/gtest.h"
+
+namespace openmldb {
+namespace replica {
+
+class BinlogCacheTest : public ::testing::Test {
+ public:
+    BinlogCacheTest() {}
+    ~BinlogCacheTest() {}
+};
+
+void AppendEntry(BinlogCache* cache, uint64_t log_index) {
+    ::openmldb::api::LogEntry entry;
+    entry.set_log_index(log_index);
+    entry.set_pk("pk");
+    entry.set_ts(log_index);
+    entry.set_value("value" + std::to_string(log_index));
+    cache->Append(entry);
+}
+
+TEST_F(BinlogCacheTest, Read) {
+    BinlogCache cache(4);
+    ::openmldb::api::AppendEntriesRequest request;
+    ASSERT_EQ(0u, cache.Read(0, 10, &request));
+    for (uint64_t i = 1; i <= 6; i++) {
+        AppendEntry(&cache, i);
+    }
+    // only the latest 4 entries are cached
+    ASSERT_EQ(0u, cache.Read(1, 10, &request));
+    ASSERT_EQ(0u, cache.Read(6, 10, &request));
+    ASSERT_EQ(4u, cache.Read(2, 10, &request));
+    ASSERT_EQ(4, request.entries_size());
+    for (int i = 0; i < request.entries_size(); i++) {
+        ASSERT_EQ(3u + i, request.entries(i).log_index());
+        ASSERT_EQ("value" + std::to_string(3 + i), request.entries(i).value());
+    }
+    request.Clear();
+    ASSERT_EQ(2u, cache.Read(3, 2, &request));
+    ASSERT_EQ(4u, request.entries(0).log_index());
+    ASSERT_EQ(5u, request.entries(1).log_index());
+
+    // the cache restarts if the entry does not follow the last one
+    AppendEntry(&cache, 10);
+    request.Clear();
+    ASSERT_EQ(0u, cache.Read(5, 10, &request));
+    ASSERT_EQ(1u, cache.Read(9, 10, &request));
+    ASSERT_EQ(10u, request.entries(0).log_index());
+
+    cache.Clear();
+    request.Clear();
+    ASSERT_EQ(0u, cache.Read(9, 10, &request));
+}
+
+TEST_F(BinlogCacheTest, SharedEntry) {
+    BinlogCache cache(4);
+    auto entry = std::make_shared<::openmldb::api::LogEntry>();
+    entry->set_log_index(1);
+    entry->set_value("value1");
+    cache.Append(entry);
+    // the entry is held by the cache
+    ASSERT_EQ(2, entry.use_count());
+    ::openmldb::api::AppendEntriesRequest request;
+    ASSERT_EQ(1u, cache.Read(0, 10, &request));
+    ASSERT_EQ("value1", request.entries(0).value());
+    cache.Clear();
+    ASSERT_EQ(1, entry.use_count());
+}
+
+TEST_F(BinlogCacheTest, Disabled) {
+    BinlogCache cache(0);
+    AppendEntry(&cache, 1);
+    ::openmldb::api::AppendEntriesRequest request;
+    ASSERT_EQ(0u, cache.Read(0, 10, &request));
+}
+
+}  // namespace replica
+}  // namespace openmldb
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -30,11 +30,20 @@
 #include "base/file_util.h"
 #include "base/glog_wapper.h"  // NOLINT
 #include "base/strings.h"
+#include "bvar/latency_recorder.h"
 #include "log/log_format.h"
 #include "storage/segment.h"
 
 DECLARE_int32(binlog_single_file_max_size);
+DECLARE_uint32(binlog_durability);
+DECLARE_uint32(binlog_group_commit_size);
+DECLARE_uint32(binlog_cache_entry_cnt);
+DECLARE_int32(binlog_sync_wait_time);
+DECLARE_string(binlog_compression);
+DECLARE_string(binlog_direct_io_root_path);
+DECLARE_bool(binlog_async_io);
 DECLARE_int32(binlog_name_length);
+DECLARE_uint64(background_disk_io_limit);
 DECLARE_string(zk_cluster);
 
 namespace openmldb {
@@ -42,11 +51,16 @@ namespace replica {
 
 static const ::openmldb::base::DefaultComparator scmp;
 
+// the latency of the appends to the binlogs and of the syncs of the binlog files of all the partitions
+static bvar::LatencyRecorder g_binlog_append_latency("binlog_append");
+static bvar::LatencyRecorder g_binlog_sync_latency("binlog_sync");
+
 LogReplicator::LogReplicator(const std::string& path, const std::map<std::string, std::string>& real_ep_map,
                              const ReplicatorRole& role, std::shared_ptr<Table> table, std::atomic<bool>* follower)
     : path_(path),
       log_path_(),
       log_offset_(0),
+      log_bytes_(0),
       logs_(NULL),
       wh_(NULL),
       role_(role),
@@ -57,10 +71,17 @@ LogReplicator::LogReplicator(const std::string& path, const std::map<std::string
       mu_(),
       cv_(),
       wmu_(),
-      follower_(follower) {
+      append_cv_(),
+      append_mu_(),
+      append_writers_(),
+      follower_(follower),
+      binlog_cache_(FLAGS_binlog_cache_entry_cnt),
+      direct_io_(false),
+      async_io_(FLAGS_binlog_async_io) {
     table_ = table;
     binlog_index_ = 0;
     snapshot_log_part_index_.store(-1, std::memory_order_relaxed);
+    consumer_log_part_index_.store(-1, std::memory_order_relaxed);
     snapshot_last_offset_.store(0, std::memory_order_relaxed);
     follower_offset_.store(0);
 }
@@ -77,26 +98,63 @@ LogReplicator::~LogReplicator() {
     nodes_.clear();
 }
 
-void LogReplicator::SetRole(const ReplicatorRole& role) { role_ = role; }
+void LogReplicator::SetRole(const ReplicatorRole& role) {
+    role_ = role;
+    if (role_ != kLeaderNode) {
+        binlog_cache_.Clear();
+    }
+}
 
 void LogReplicator::SyncToDisk() {
-    std::lock_guard<std::mutex> lock(wmu_);
-    if (wh_ != NULL) {
-        uint64_t consumed = ::baidu::common::timer::get_micros();
-        ::openmldb::base::Status status = wh_->Sync();
-        if (!status.ok()) {
-            PDLOG(WARNING, "fail to sync data for path %s", path_.c_str());
+    int fd = -1;
+    {
+        std::lock_guard<std::mutex> lock(wmu_);
+        if (wh_ == NULL) {
+            return;
         }
-        consumed = ::baidu::common::timer::get_micros() - consumed;
-        if (consumed > 20000) {
-            PDLOG(INFO, "sync to disk for path %s consumed %lld ms", path_.c_str(), consumed / 1000);
+        if (async_io_) {
+            std::string path = path_;
+            wh_->SyncAsync([path](const ::openmldb::base::Status& status) {
+                if (!status.ok()) {
+                    PDLOG(WARNING, "fail to sync data for path %s", path.c_str());
+                }
+            });
+            return;
         }
+        if (!wh_->Flush().ok()) {
+            PDLOG(WARNING, "fail to flush data for path %s", path_.c_str());
+            return;
+        }
+        // sync with a duplicated fd out of the lock, so the appends are not blocked
+        // and the file may be rolled meanwhile
+        fd = dup(fileno(wh_->fd_));
+    }
+    if (fd < 0) {
+        PDLOG(WARNING, "fail to dup fd for path %s for error %s", path_.c_str(), strerror(errno));
+        return;
+    }
+    uint64_t consumed = ::baidu::common::timer::get_micros();
+    if (fdatasync(fd) != 0) {
+        PDLOG(WARNING, "fail to sync data for path %s for error %s", path_.c_str(), strerror(errno));
+    }
+    close(fd);
+    consumed = ::baidu::common::timer::get_micros() - consumed;
+    if (consumed > 20000) {
+        PDLOG(INFO, "sync to disk for path %s consumed %lld ms", path_.c_str(), consumed / 1000);
     }
 }
 
 bool LogReplicator::Init() {
     logs_ = new LogParts(12, 4, scmp);
     log_path_ = path_ + "/binlog/";
+    std::vector<std::string> direct_io_paths;
+    ::openmldb::base::SplitString(FLAGS_binlog_direct_io_root_path, ",", direct_io_paths);
+    for (const auto& root_path : direct_io_paths) {
+        if (!root_path.empty() && path_.compare(0, root_path.size(), root_path) == 0) {
+            direct_io_ = true;
+            break;
+        }
+    }
     if (!::openmldb::base::MkdirRecur(log_path_)) {
         PDLOG(WARNING, "fail to log dir %s", log_path_.c_str());
         return false;
@@ -105,7 +163,8 @@ bool LogReplicator::Init() {
         for (const auto& kv : real_ep_map_) {
             std::shared_ptr<ReplicateNode> replicate_node =
                 std::make_shared<ReplicateNode>(kv.first, logs_, log_path_, table_->GetId(), table_->GetPid(), &term_,
-                                                &log_offset_, &mu_, &cv_, false, &follower_offset_, kv.second);
+                                                &log_offset_, &mu_, &cv_, false, &follower_offset_, kv.second,
+                                                &binlog_cache_, &log_bytes_);
             if (replicate_node->Init() < 0) {
                 PDLOG(WARNING, "init replicate node %s error", kv.first.c_str());
                 return false;
@@ -238,12 +297,20 @@ void LogReplicator::SetSnapshotLogPartIndex(uint64_t offset) {
     snapshot_log_part_index_.store(log_part_index, std::memory_order_relaxed);
 }
 
+void LogReplicator::SetConsumerLogPartIndex(int log_part_index) {
+    consumer_log_part_index_.store(log_part_index, std::memory_order_relaxed);
+}
+
 void LogReplicator::DeleteBinlog() {
     if (logs_->GetSize() <= 1) {
         DEBUGLOG("log part size is one or less, need not delete");
         return;
     }
     int min_log_index = snapshot_log_part_index_.load(std::memory_order_relaxed);
+    int consumer_log_index = consumer_log_part_index_.load(std::memory_order_relaxed);
+    if (consumer_log_index >= 0) {
+        min_log_index = std::min(min_log_index, consumer_log_index);
+    }
     {
         std::lock_guard<bthread::Mutex> lock(mu_);
         for (auto iter = nodes_.begin(); iter != nodes_.end(); ++iter) {
@@ -268,6 +335,11 @@ void LogReplicator::DeleteBinlog() {
         node = node->GetNextNoBarrier(0);
         std::string full_path =
             log_path_ + "/" + ::openmldb::base::FormatToString(tmp_node->GetKey(), FLAGS_binlog_name_length) + ".log";
+        uint64_t file_size = 0;
+        if (::openmldb::base::GetFileSize(full_path, file_size)) {
+            // the binlog appends are not limited, only the deletes wait for the disk limiter
+            ::openmldb::base::GetDiskRateLimiter(log_path_, FLAGS_background_disk_io_limit)->Throttle(file_size);
+        }
         if (unlink(full_path.c_str()) < 0) {
             PDLOG(WARNING, "delete binlog[%s] failed! errno[%d] errinfo[%s]", full_path.c_str(), errno,
                   strerror(errno));
@@ -284,11 +356,11 @@ void LogReplicator::SetLeaderTerm(uint64_t term) { term_.store(term, std::memory
 
 bool LogReplicator::ApplyEntryToTable(const LogEntry& entry) {
     if (entry.has_method_type() && entry.method_type() == ::openmldb::api::MethodType::kDelete) {
-        if (entry.dimensions_size() == 0) {
+        if (entry.dimensions_size() == 0 && !entry.has_end_ts()) {
             PDLOG(WARNING, "no dimesion. tid %u pid %u", table_->GetId(), table_->GetPid());
             return false;
         }
-        table_->Delete(entry.dimensions(0).key(), entry.dimensions(0).idx());
+        table_->Delete(entry);
         return true;
     }
     return table_->Put(entry);
@@ -305,7 +377,7 @@ bool LogReplicator::AppendEntries(const ::openmldb::api::AppendEntriesRequest* r
             return false;
         }
     }
-    std::lock_guard<std::mutex> lock(wmu_);
+    std::unique_lock<std::mutex> lock(wmu_);
     uint64_t last_log_offset = GetOffset();
     if (request->pre_log_index() == 0 && request->entries_size() == 0) {
         response->set_log_offset(last_log_offset);
@@ -326,6 +398,12 @@ bool LogReplicator::AppendEntries(const ::openmldb::api::AppendEntriesRequest* r
             return false;
         }
     }
+    if (request->pre_log_index() > last_log_offset) {
+        // the leader may pipeline the requests, so wait a while for the former ones to fill the gap
+        append_cv_.wait_for(lock, std::chrono::milliseconds(FLAGS_binlog_sync_wait_time),
+                            [&] { return request->pre_log_index() <= GetOffset(); });
+        last_log_offset = GetOffset();
+    }
     if (request->pre_log_index() > last_log_offset) {
         PDLOG(WARNING,
               "log mismatch for path %s, pre_log_index %lu, come log index "
@@ -354,6 +432,7 @@ bool LogReplicator::AppendEntries(const ::openmldb::api::AppendEntriesRequest* r
         log_offset_.store(request->entries(i).log_index(), std::memory_order_relaxed);
         response->set_log_offset(GetOffset());
     }
+    append_cv_.notify_all();
     DEBUGLOG("sync log entry to offset %lu for %s", GetOffset(), path_.c_str());
     return true;
 }
@@ -385,11 +464,12 @@ int LogReplicator::AddReplicateNode(const std::map<std::string, std::string>& re
         if (tid == UINT32_MAX) {
             replicate_node =
                 std::make_shared<ReplicateNode>(endpoint, logs_, log_path_, table_->GetId(), table_->GetPid(), &term_,
-                                                &log_offset_, &mu_, &cv_, false, &follower_offset_, kv.second);
+                                                &log_offset_, &mu_, &cv_, false, &follower_offset_, kv.second,
+                                                &binlog_cache_, &log_bytes_);
         } else {
             replicate_node =
                 std::make_shared<ReplicateNode>(endpoint, logs_, log_path_, tid, table_->GetPid(), &term_, &log_offset_,
-                                                &mu_, &cv_, true, &follower_offset_, kv.second);
+                                                &mu_, &cv_, true, &follower_offset_, kv.second, &binlog_cache_, &log_bytes_);
         }
         if (replicate_node->Init() < 0) {
             PDLOG(WARNING, "init replicate node %s error", endpoint.c_str());
@@ -456,6 +536,17 @@ void LogReplicator::GetReplicateInfo(std::map<std::string, uint64_t>& info_map)
     }
 }
 
+void LogReplicator::GetReplicateLagBytes(std::map<std::string, uint64_t>& lag_map) {
+    std::lock_guard<bthread::Mutex> lock(mu_);
+    if (role_ != kLeaderNode) {
+        DEBUGLOG("cur table is not leader");
+        return;
+    }
+    for (const auto& node : nodes_) {
+        lag_map.insert(std::make_pair(node->GetEndPoint(), node->GetLagBytes()));
+    }
+}
+
 bool LogReplicator::DelAllReplicateNode() {
     std::vector<std::shared_ptr<ReplicateNode>> copied_nodes = nodes_;
     {
@@ -479,29 +570,121 @@ bool LogReplicator::DelAllReplicateNode() {
 }
 
 bool LogReplicator::AppendEntry(LogEntry& entry) {
-    std::lock_guard<std::mutex> lock(wmu_);
-    if (wh_ == NULL || wh_->GetSize() / (1024 * 1024) > (uint32_t)FLAGS_binlog_single_file_max_size) {
-        bool ok = RollWLogFile();
-        if (!ok) {
-            return false;
+    return AppendEntry(entry, static_cast<BinlogDurability>(FLAGS_binlog_durability));
+}
+
+bool LogReplicator::AppendEntry(LogEntry& entry, BinlogDurability durability) {
+    AppendWriter writer(&entry, durability == kBinlogSync);
+    return AppendEntry(&writer);
+}
+
+bool LogReplicator::AppendEntry(const std::shared_ptr<LogEntry>& entry) {
+    AppendWriter writer(entry.get(), static_cast<BinlogDurability>(FLAGS_binlog_durability) == kBinlogSync);
+    writer.shared_entry = entry;
+    return AppendEntry(&writer);
+}
+
+bool LogReplicator::AppendEntry(AppendWriter* appender) {
+    AppendWriter& writer = *appender;
+    uint64_t start_time = ::baidu::common::timer::get_micros();
+    std::unique_lock<bthread::Mutex> lock(append_mu_);
+    append_writers_.push_back(&writer);
+    while (!writer.done && &writer != append_writers_.front()) {
+        writer.cv.wait(lock);
+    }
+    if (writer.done) {
+        g_binlog_append_latency << ::baidu::common::timer::get_micros() - start_time;
+        return writer.ok;
+    }
+    // the writer becomes the leader of the group, the later appenders queue up
+    // while the group is written
+    std::vector<AppendWriter*> group;
+    bool sync = false;
+    uint32_t max_size = std::max(FLAGS_binlog_group_commit_size, 1u);
+    for (auto it = append_writers_.begin(); it != append_writers_.end() && group.size() < max_size; ++it) {
+        group.push_back(*it);
+        sync = sync || (*it)->sync;
+    }
+    lock.unlock();
+    WriteGroup(group, sync);
+    lock.lock();
+    for (auto* member : group) {
+        append_writers_.pop_front();
+        if (member != &writer) {
+            member->done = true;
+            member->cv.notify_one();
         }
     }
-    uint64_t cur_offset = log_offset_.load(std::memory_order_relaxed);
-    entry.set_log_index(1 + cur_offset);
+    if (!append_writers_.empty()) {
+        append_writers_.front()->cv.notify_one();
+    }
+    lock.unlock();
+    g_binlog_append_latency << ::baidu::common::timer::get_micros() - start_time;
+    return writer.ok;
+}
+
+void LogReplicator::WriteGroup(const std::vector<AppendWriter*>& group, bool sync) {
+    std::unique_lock<std::mutex> lock(wmu_);
     std::string buffer;
-    entry.SerializeToString(&buffer);
-    ::openmldb::base::Slice slice(buffer);
-    ::openmldb::base::Status status = wh_->Write(slice);
-    if (!status.ok()) {
-        PDLOG(WARNING, "fail to write replication log in dir %s for %s", path_.c_str(), status.ToString().c_str());
-        return false;
+    for (auto* writer : group) {
+        if (wh_ == NULL || wh_->GetSize() / (1024 * 1024) > (uint32_t)FLAGS_binlog_single_file_max_size) {
+            bool ok = RollWLogFile();
+            if (!ok) {
+                continue;
+            }
+        }
+        uint64_t cur_offset = log_offset_.load(std::memory_order_relaxed);
+        writer->entry->set_log_index(1 + cur_offset);
+        buffer.clear();
+        writer->entry->SerializeToString(&buffer);
+        ::openmldb::base::Slice slice(buffer);
+        ::openmldb::base::Status status = wh_->Write(slice);
+        if (!status.ok()) {
+            PDLOG(WARNING, "fail to write replication log in dir %s for %s", path_.c_str(),
+                  status.ToString().c_str());
+            continue;
+        }
+        // cache the entry before the offset is visible to the replicate nodes
+        if (writer->shared_entry) {
+            binlog_cache_.Append(writer->shared_entry);
+        } else {
+            binlog_cache_.Append(*writer->entry);
+        }
+        log_bytes_.fetch_add(buffer.size(), std::memory_order_relaxed);
+        log_offset_.fetch_add(1, std::memory_order_relaxed);
+        if (local_endpoints_.empty()) {  // if local replica are dead, leader direct
+                                         // sync to remote replica
+            follower_offset_.store(cur_offset + 1, std::memory_order_relaxed);
+        }
+        writer->ok = true;
     }
-    log_offset_.fetch_add(1, std::memory_order_relaxed);
-    if (local_endpoints_.empty()) {  // if local replica are dead, leader direct
-                                     // sync to remote replica
-        follower_offset_.store(cur_offset + 1, std::memory_order_relaxed);
+    if (!sync || wh_ == NULL) {
+        return;
+    }
+    // an async file syncs on the io thread, the appenders to the new file go on
+    // and the bthread of the group leader yields while waiting
+    uint64_t sync_start_time = ::baidu::common::timer::get_micros();
+    auto waiter = std::make_shared<SyncWaiter>();
+    wh_->SyncAsync([waiter](const ::openmldb::base::Status& status) {
+        std::lock_guard<bthread::Mutex> waiter_lock(waiter->mu);
+        waiter->status = status;
+        waiter->done = true;
+        waiter->cv.notify_one();
+    });
+    lock.unlock();
+    std::unique_lock<bthread::Mutex> waiter_lock(waiter->mu);
+    while (!waiter->done) {
+        waiter->cv.wait(waiter_lock);
+    }
+    g_binlog_sync_latency << ::baidu::common::timer::get_micros() - sync_start_time;
+    if (!waiter->status.ok()) {
+        PDLOG(WARNING, "fail to sync data for path %s", path_.c_str());
+        for (auto* writer : group) {
+            if (writer->sync) {
+                writer->ok = false;
+            }
+        }
     }
-    return true;
 }
 
 bool LogReplicator::RollWLogFile() {
@@ -523,7 +706,11 @@ bool LogReplicator::RollWLogFile() {
     logs_->Insert(binlog_index_.load(std::memory_order_relaxed), offset);
     binlog_index_.fetch_add(1, std::memory_order_relaxed);
     PDLOG(INFO, "roll write log for name %s and start offset %lld", name.c_str(), offset);
-    wh_ = new WriteHandle("off", name, fd);
+    wh_ = new WriteHandle("off", name, fd, 0, direct_io_, async_io_);
+    // the values of a snappy compressed table need no more compression
+    if (table_->GetCompressType() != ::openmldb::type::kSnappy) {
+        wh_->SetRecordCompressType(FLAGS_binlog_compression);
+    }
     return true;
 }
 
@@ -19,6 +19,7 @@
 
 #include <atomic>
 #include <condition_variable>  // NOLINT
+#include <deque>
 #include <map>
 #include <memory>
 #include <mutex>  // NOLINT
@@ -33,6 +34,7 @@
 #include "log/log_writer.h"
 #include "log/sequential_file.h"
 #include "proto/tablet.pb.h"
+#include "replica/binlog_cache.h"
 #include "replica/replicate_node.h"
 #include "storage/table.h"
 
@@ -48,6 +50,13 @@ using ::openmldb::storage::Table;
 
 enum ReplicatorRole { kLeaderNode = 1, kFollowerNode };
 
+enum BinlogDurability {
+    // the entry is synced to disk by the periodic SyncToDisk
+    kBinlogAsync = 0,
+    // the entry is synced to disk before AppendEntry returns
+    kBinlogSync = 1,
+};
+
 class LogReplicator {
  public:
     LogReplicator(const std::string& path, const std::map<std::string, std::string>& real_ep_map,
@@ -63,9 +72,16 @@ class LogReplicator {
     bool AppendEntries(const ::openmldb::api::AppendEntriesRequest* request,
                        ::openmldb::api::AppendEntriesResponse* response);
 
-    // the master node append entry
+    // the master node append entry with the durability of binlog_durability
     bool AppendEntry(::openmldb::api::LogEntry& entry);  // NOLINT
 
+    // the concurrent appenders are committed in groups by the first of them,
+    // so one write pass and one disk sync serve the whole group
+    bool AppendEntry(::openmldb::api::LogEntry& entry, BinlogDurability durability);  // NOLINT
+
+    // the entry is held by the binlog cache instead of copied to it, it should not be changed after
+    bool AppendEntry(const std::shared_ptr<::openmldb::api::LogEntry>& entry);
+
     //  data to slave nodes
     void Notify();
     // recover logs meta
@@ -84,6 +100,9 @@ class LogReplicator {
 
     void GetReplicateInfo(std::map<std::string, uint64_t>& info_map);  // NOLINT
 
+    // the bytes of binlog which are not acked by each follower yet
+    void GetReplicateLagBytes(std::map<std::string, uint64_t>& lag_map);  // NOLINT
+
     void MatchLogOffset();
 
     void ReplicateToNode(const std::string& endpoint);
@@ -96,6 +115,8 @@ class LogReplicator {
 
     LogParts* GetLogPart();
 
+    inline const std::string& GetLogPath() const { return log_path_; }
+
     inline uint64_t GetLogOffset() { return log_offset_.load(std::memory_order_relaxed); }
     void SetRole(const ReplicatorRole& role);
 
@@ -104,6 +125,9 @@ class LogReplicator {
 
     void SetSnapshotLogPartIndex(uint64_t offset);
 
+    // the binlog from the log part is kept for the consumer of the binlog, -1 if there is no consumer
+    void SetConsumerLogPartIndex(int log_part_index);
+
     bool ParseBinlogIndex(const std::string& path, uint32_t& index);  // NOLINT
 
     bool DelAllReplicateNode();
@@ -113,12 +137,39 @@ class LogReplicator {
 
     bool ApplyEntryToTable(const LogEntry& entry);
 
+    struct AppendWriter {
+        explicit AppendWriter(LogEntry* log_entry, bool need_sync)
+            : entry(log_entry), shared_entry(), sync(need_sync), done(false), ok(false) {}
+        LogEntry* entry;
+        // the entry cached without copy if it is set
+        std::shared_ptr<LogEntry> shared_entry;
+        bool sync;
+        bool done;
+        bool ok;
+        bthread::ConditionVariable cv;
+    };
+
+    struct SyncWaiter {
+        SyncWaiter() : done(false), status() {}
+        bool done;
+        ::openmldb::base::Status status;
+        bthread::Mutex mu;
+        bthread::ConditionVariable cv;
+    };
+
+    // queue the writer and write its group if it is the first one
+    bool AppendEntry(AppendWriter* writer);
+    // write the entries of a group to binlog and sync it if any of them requires
+    void WriteGroup(const std::vector<AppendWriter*>& group, bool sync);
+
  private:
     // the replicator root data path
     std::string path_;
     std::string log_path_;
     // the term for leader judgement
     std::atomic<uint64_t> log_offset_;
+    // the serialized bytes of the entries appended by the leader
+    std::atomic<uint64_t> log_bytes_;
     std::atomic<uint64_t> follower_offset_;
     std::atomic<uint32_t> binlog_index_;
     LogParts* logs_;
@@ -134,12 +185,23 @@ class LogReplicator {
     bthread::ConditionVariable cv_;
 
     std::atomic<int> snapshot_log_part_index_;
+    std::atomic<int> consumer_log_part_index_;
     std::atomic<uint64_t> snapshot_last_offset_;
 
     std::shared_ptr<Table> table_;
 
     std::mutex wmu_;
+    // notified when the entries from the leader are appended
+    std::condition_variable append_cv_;
+    // the appenders waiting to be committed, the front one commits the group
+    bthread::Mutex append_mu_;
+    std::deque<AppendWriter*> append_writers_;
     std::atomic<bool>* follower_;
+    BinlogCache binlog_cache_;
+    // write the binlog with direct io and preallocation
+    bool direct_io_;
+    // write the binlog on the io threads of LogIOService
+    bool async_io_;
 };
 
 }  // namespace replica
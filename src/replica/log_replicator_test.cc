@@ -17,6 +17,7 @@
 #include "replica/log_replicator.h"
 
 #include <brpc/server.h>
+#include <gflags/gflags.h>
 #include <gtest/gtest.h>
 #include <sched.h>
 #include <stdio.h>
@@ -24,6 +25,7 @@
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <thread>  // NOLINT
 #include <utility>
 
 #include "base/glog_wapper.h"
@@ -44,6 +46,9 @@ using ::openmldb::storage::Table;
 using ::openmldb::storage::TableIterator;
 using ::openmldb::storage::Ticket;
 
+DECLARE_int32(binlog_sync_batch_size);
+DECLARE_uint32(binlog_sync_window);
+
 namespace openmldb {
 namespace replica {
 
@@ -148,6 +153,58 @@ TEST_F(LogReplicatorTest, BenchMark) {
     ASSERT_TRUE(ok);
 }
 
+TEST_F(LogReplicatorTest, GroupCommit) {
+    std::map<std::string, std::string> map;
+    std::string folder = "/tmp/" + GenRand() + "/";
+    std::map<std::string, uint32_t> mapping;
+    std::atomic<bool> follower(false);
+    mapping.insert(std::make_pair("idx", 0));
+    std::shared_ptr<MemTable> table =
+        std::make_shared<MemTable>("test", 1, 1, 8, mapping, 0, ::openmldb::type::TTLType::kAbsoluteTime);
+    table->Init();
+    LogReplicator replicator(folder, map, kLeaderNode, table, &follower);
+    ASSERT_TRUE(replicator.Init());
+    std::atomic<uint32_t> failed_cnt(0);
+    std::vector<std::thread> threads;
+    for (uint32_t i = 0; i < 4; i++) {
+        threads.emplace_back([&replicator, &failed_cnt, i]() {
+            for (uint32_t j = 0; j < 100; j++) {
+                ::openmldb::api::LogEntry entry;
+                entry.set_term(1);
+                entry.set_pk("test" + std::to_string(i));
+                entry.set_value("value");
+                entry.set_ts(j);
+                if (!replicator.AppendEntry(entry, j % 2 == 0 ? kBinlogSync : kBinlogAsync)) {
+                    failed_cnt.fetch_add(1);
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    ASSERT_EQ(0u, failed_cnt.load());
+    ASSERT_EQ(400u, replicator.GetOffset());
+    // the entries are written in the order of the log index
+    ::openmldb::log::LogReader log_reader(replicator.GetLogPart(), folder + "/binlog/", false);
+    log_reader.SetOffset(0);
+    std::string buffer;
+    uint64_t expect_index = 1;
+    while (true) {
+        buffer.clear();
+        ::openmldb::base::Slice record;
+        ::openmldb::base::Status status = log_reader.ReadNextRecord(&record, &buffer);
+        if (!status.ok()) {
+            break;
+        }
+        ::openmldb::api::LogEntry entry;
+        ASSERT_TRUE(entry.ParseFromString(record.ToString()));
+        ASSERT_EQ(expect_index, entry.log_index());
+        expect_index++;
+    }
+    ASSERT_EQ(401u, expect_index);
+}
+
 TEST_F(LogReplicatorTest, LeaderAndFollowerMulti) {
     brpc::ServerOptions options;
     brpc::Server server0;
@@ -648,6 +705,58 @@ TEST_F(LogReplicatorTest, Leader_Remove_local_follower) {
     }
 }
 
+TEST_F(LogReplicatorTest, PipelinedSync) {
+    FLAGS_binlog_sync_batch_size = 8;
+    FLAGS_binlog_sync_window = 4;
+    brpc::ServerOptions options;
+    brpc::Server server;
+    std::map<std::string, uint32_t> mapping;
+    mapping.insert(std::make_pair("idx", 0));
+    std::shared_ptr<MemTable> t1 =
+        std::make_shared<MemTable>("test", 1, 1, 8, mapping, 0, ::openmldb::type::TTLType::kAbsoluteTime);
+    t1->Init();
+    std::shared_ptr<MemTable> t2 =
+        std::make_shared<MemTable>("test", 1, 1, 8, mapping, 0, ::openmldb::type::TTLType::kAbsoluteTime);
+    t2->Init();
+    std::string follower_addr = "127.0.0.1:18530";
+    MockTabletImpl* follower_tablet = new MockTabletImpl(kFollowerNode, "/tmp/" + GenRand() + "/", g_endpoints, t2);
+    ASSERT_TRUE(follower_tablet->Init());
+    ASSERT_EQ(0, server.AddService(follower_tablet, brpc::SERVER_OWNS_SERVICE));
+    ASSERT_EQ(0, server.Start(follower_addr.c_str(), &options));
+
+    std::map<std::string, std::string> real_ep_map;
+    real_ep_map.insert(std::make_pair(follower_addr, ""));
+    std::atomic<bool> follower(false);
+    LogReplicator leader("/tmp/" + GenRand() + "/", real_ep_map, kLeaderNode, t1, &follower);
+    ASSERT_TRUE(leader.Init());
+    ASSERT_TRUE(leader.StartSyncing());
+    for (int i = 0; i < 500; i++) {
+        ::openmldb::api::LogEntry entry;
+        entry.set_pk("test_pk" + std::to_string(i % 10));
+        entry.set_value("value" + std::to_string(i));
+        entry.set_ts(9527 + i);
+        ASSERT_TRUE(leader.AppendEntry(entry));
+    }
+    leader.Notify();
+    std::map<std::string, uint64_t> lag_map;
+    for (int i = 0; i < 100; i++) {
+        lag_map.clear();
+        leader.GetReplicateLagBytes(lag_map);
+        if (t2->GetRecordCnt() == 500 && lag_map[follower_addr] == 0) {
+            break;
+        }
+        usleep(100000);
+    }
+    ASSERT_EQ(500u, t2->GetRecordCnt());
+    ASSERT_EQ(0u, lag_map[follower_addr]);
+    std::map<std::string, uint64_t> info_map;
+    leader.GetReplicateInfo(info_map);
+    ASSERT_EQ(500u, info_map[follower_addr]);
+    leader.DelAllReplicateNode();
+    FLAGS_binlog_sync_batch_size = 32;
+    FLAGS_binlog_sync_window = 1;
+}
+
 }  // namespace replica
 }  // namespace openmldb
 
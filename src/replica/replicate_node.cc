@@ -19,11 +19,15 @@
 #include <gflags/gflags.h>
 
 #include <algorithm>
+#include <deque>
+#include <memory>
+#include <utility>
 
 #include "base/glog_wapper.h"  // NOLINT
 #include "base/strings.h"
 
 DECLARE_int32(binlog_sync_batch_size);
+DECLARE_uint32(binlog_sync_window);
 DECLARE_int32(binlog_sync_wait_time);
 DECLARE_int32(binlog_coffee_time);
 DECLARE_int32(binlog_match_logoffset_interval);
@@ -31,6 +35,10 @@ DECLARE_int32(request_max_retry);
 DECLARE_int32(request_timeout_ms);
 DECLARE_string(zk_cluster);
 DECLARE_uint32(go_back_max_try_cnt);
+DECLARE_string(binlog_compression);
+DECLARE_uint32(replica_cluster_sync_window);
+DECLARE_uint32(replica_cluster_sync_batch_size);
+DECLARE_string(replica_cluster_binlog_compression);
 
 namespace openmldb {
 namespace replica {
@@ -46,10 +54,13 @@ static void* RunSyncTask(void* args) {
     return NULL;
 }
 
+static uint64_t GetNodeLagBytes(void* arg) { return static_cast<ReplicateNode*>(arg)->GetLagBytes(); }
+
 ReplicateNode::ReplicateNode(const std::string& point, LogParts* logs, const std::string& log_path, uint32_t tid,
                              uint32_t pid, std::atomic<uint64_t>* term, std::atomic<uint64_t>* leader_log_offset,
                              bthread::Mutex* mu, bthread::ConditionVariable* cv, bool rep_follower,
-                             std::atomic<uint64_t>* follower_offset, const std::string& real_point)
+                             std::atomic<uint64_t>* follower_offset, const std::string& real_point,
+                             BinlogCache* binlog_cache, std::atomic<uint64_t>* leader_log_bytes)
     : log_reader_(logs, log_path, false),
       cache_(),
       endpoint_(point),
@@ -66,13 +77,47 @@ ReplicateNode::ReplicateNode(const std::string& point, LogParts* logs, const std
       cv_(cv),
       go_back_cnt_(0),
       rep_node_(rep_follower),
-      follower_offset_(follower_offset) {
+      follower_offset_(follower_offset),
+      binlog_cache_(binlog_cache),
+      leader_log_bytes_(leader_log_bytes),
+      match_log_offset_(0),
+      synced_bytes_(0),
+      sync_window_(FLAGS_binlog_sync_window),
+      sync_batch_size_(FLAGS_binlog_sync_batch_size),
+      lag_bytes_("replicate_" + std::to_string(tid) + "_" + std::to_string(pid) + "_" + point + "_lag_bytes",
+                 GetNodeLagBytes, this) {
     if (!real_point.empty()) {
         rpc_client_ = openmldb::RpcClient<::openmldb::api::TabletServer_Stub>(real_point);
     }
 }
 
+static brpc::CompressType GetRequestCompressType(const std::string& compress_type) {
+    if (compress_type == "snappy") {
+        return brpc::COMPRESS_TYPE_SNAPPY;
+    } else if (compress_type == "zlib") {
+        return brpc::COMPRESS_TYPE_ZLIB;
+    }
+    return brpc::COMPRESS_TYPE_NONE;
+}
+
 int ReplicateNode::Init() {
+    std::string compress_type = FLAGS_binlog_compression;
+    if (rep_node_.load(std::memory_order_relaxed)) {
+        // the follower of a replica cluster is across the wan, so more requests are in flight and they are larger
+        if (FLAGS_replica_cluster_sync_window > 0) {
+            sync_window_ = FLAGS_replica_cluster_sync_window;
+        }
+        if (FLAGS_replica_cluster_sync_batch_size > 0) {
+            sync_batch_size_ = FLAGS_replica_cluster_sync_batch_size;
+        }
+        if (!FLAGS_replica_cluster_binlog_compression.empty()) {
+            compress_type = FLAGS_replica_cluster_binlog_compression;
+        }
+        // the partitions replicated to a tablet of the replica cluster share one connection, which is not shared
+        // with the local followers
+        rpc_client_.SetConnectionOptions("single", "replica_cluster");
+    }
+    rpc_client_.SetRequestCompressType(GetRequestCompressType(compress_type));
     int ok = rpc_client_.Init();
     if (ok != 0) {
         PDLOG(WARNING, "fail to open rpc client with errno %d", ok);
@@ -162,6 +207,11 @@ int ReplicateNode::MatchLogOffsetFromNode() {
                                        FLAGS_request_timeout_ms, FLAGS_request_max_retry);
     if (ret && response.code() == 0) {
         last_sync_offset_ = response.log_offset();
+        // the lag in bytes counts the entries appended after the match
+        match_log_offset_ = leader_log_offset_->load(std::memory_order_relaxed);
+        if (leader_log_bytes_ != NULL) {
+            synced_bytes_.store(leader_log_bytes_->load(std::memory_order_relaxed), std::memory_order_relaxed);
+        }
         log_matched_ = true;
         log_reader_.SetOffset(last_sync_offset_);
         PDLOG(INFO, "match node %s log offset %lu for table tid %u pid %u", endpoint_.c_str(), last_sync_offset_, tid_,
@@ -172,12 +222,121 @@ int ReplicateNode::MatchLogOffsetFromNode() {
     return -1;
 }
 
+bool ReplicateNode::ReadEntries(uint64_t log_offset, uint64_t* sync_log_offset,
+                                ::openmldb::api::AppendEntriesRequest* request) {
+    request->set_tid(tid_);
+    request->set_pid(pid_);
+    request->set_pre_log_index(*sync_log_offset);
+    if (!FLAGS_zk_cluster.empty()) {
+        request->set_term(term_->load(std::memory_order_relaxed));
+    }
+    uint32_t batchSize = log_offset - *sync_log_offset;
+    batchSize = std::min(batchSize, sync_batch_size_);
+    uint32_t cached_cnt = binlog_cache_ == NULL ? 0 : binlog_cache_->Read(*sync_log_offset, batchSize, request);
+    if (cached_cnt > 0) {
+        *sync_log_offset += cached_cnt;
+        // move the log reader along, as the binlog older than its log part is not deleted
+        if (log_reader_.GetLogPartIndex(*sync_log_offset) > log_reader_.GetLogIndex()) {
+            log_reader_.Reset(*sync_log_offset);
+        }
+        return false;
+    }
+    bool need_wait = false;
+    for (uint64_t i = 0; i < batchSize;) {
+        std::string buffer;
+        ::openmldb::base::Slice record;
+        ::openmldb::base::Status status = log_reader_.ReadNextRecord(&record, &buffer);
+        if (status.ok()) {
+            ::openmldb::api::LogEntry* entry = request->add_entries();
+            if (!entry->ParseFromString(record.ToString())) {
+                PDLOG(WARNING, "bad protobuf format %s size %ld. tid %u pid %u",
+                      ::openmldb::base::DebugString(record.ToString()).c_str(), record.ToString().size(), tid_, pid_);
+                request->mutable_entries()->RemoveLast();
+                break;
+            }
+            DEBUGLOG("entry val %s log index %lld", entry->value().c_str(), entry->log_index());
+            if (entry->log_index() <= *sync_log_offset) {
+                DEBUGLOG("skip duplicate log offset %lld", entry->log_index());
+                request->mutable_entries()->RemoveLast();
+                continue;
+            }
+            // the log index should incr by 1
+            if ((*sync_log_offset + 1) != entry->log_index()) {
+                PDLOG(WARNING, "log missing expect offset %lu but %ld. tid %u pid %u", *sync_log_offset + 1,
+                      entry->log_index(), tid_, pid_);
+                request->mutable_entries()->RemoveLast();
+                if (go_back_cnt_ > FLAGS_go_back_max_try_cnt) {
+                    log_reader_.GoBackToStart();
+                    go_back_cnt_ = 0;
+                    PDLOG(WARNING, "go back to start. tid %u pid %u endpoint %s", tid_, pid_, endpoint_.c_str());
+                } else {
+                    log_reader_.GoBackToLastBlock();
+                    go_back_cnt_++;
+                }
+                need_wait = true;
+                break;
+            }
+            *sync_log_offset = entry->log_index();
+        } else if (status.IsWaitRecord()) {
+            DEBUGLOG("got a coffee time for[%s]", endpoint_.c_str());
+            need_wait = true;
+            break;
+        } else if (status.IsInvalidRecord()) {
+            DEBUGLOG("fail to get record. %s. tid %u pid %u", status.ToString().c_str(), tid_, pid_);
+            need_wait = true;
+            if (go_back_cnt_ > FLAGS_go_back_max_try_cnt) {
+                log_reader_.GoBackToStart();
+                go_back_cnt_ = 0;
+                PDLOG(WARNING, "go back to start. tid %u pid %u endpoint %s", tid_, pid_, endpoint_.c_str());
+            } else {
+                log_reader_.GoBackToLastBlock();
+                go_back_cnt_++;
+            }
+            break;
+        } else {
+            PDLOG(WARNING, "fail to get record: %s. tid %u pid %u", status.ToString().c_str(), tid_, pid_);
+            need_wait = true;
+            break;
+        }
+        i++;
+        go_back_cnt_ = 0;
+    }
+    return need_wait;
+}
+
+void ReplicateNode::AckEntries(const ::openmldb::api::AppendEntriesRequest& request, uint64_t sync_log_offset) {
+    last_sync_offset_ = sync_log_offset;
+    if (!rep_node_.load(std::memory_order_relaxed) &&
+        (last_sync_offset_ > follower_offset_->load(std::memory_order_relaxed))) {
+        follower_offset_->store(last_sync_offset_, std::memory_order_relaxed);
+    }
+    uint64_t bytes = 0;
+    for (const auto& entry : request.entries()) {
+        if (entry.log_index() > match_log_offset_) {
+            bytes += entry.ByteSizeLong();
+        }
+    }
+    synced_bytes_.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+uint64_t ReplicateNode::GetLagBytes() {
+    if (leader_log_bytes_ == NULL) {
+        return 0;
+    }
+    uint64_t leader_bytes = leader_log_bytes_->load(std::memory_order_relaxed);
+    uint64_t synced_bytes = synced_bytes_.load(std::memory_order_relaxed);
+    return leader_bytes > synced_bytes ? leader_bytes - synced_bytes : 0;
+}
+
 int ReplicateNode::SyncData(uint64_t log_offset) {
     DEBUGLOG("node[%s] offset[%lu] log offset[%lu]", endpoint_.c_str(), last_sync_offset_, log_offset);
     if (log_offset <= last_sync_offset_) {
         PDLOG(WARNING, "log offset [%lu] le last sync offset [%lu], do nothing", log_offset, last_sync_offset_);
         return 1;
     }
+    if (sync_window_ > 1 && cache_.empty()) {
+        return SyncDataPipelined(log_offset);
+    }
     ::openmldb::api::AppendEntriesRequest request;
     ::openmldb::api::AppendEntriesResponse response;
     uint64_t sync_log_offset = last_sync_offset_;
@@ -200,85 +359,14 @@ int ReplicateNode::SyncData(uint64_t log_offset) {
         PDLOG(INFO, "use cached request to send last index %lu. tid %u pid %u", entry.log_index(), tid_, pid_);
         sync_log_offset = entry.log_index();
     } else {
-        request.set_tid(tid_);
-        request.set_pid(pid_);
-        request.set_pre_log_index(last_sync_offset_);
-        if (!FLAGS_zk_cluster.empty()) {
-            request.set_term(term_->load(std::memory_order_relaxed));
-        }
-        uint32_t batchSize = log_offset - last_sync_offset_;
-        batchSize = std::min(batchSize, (uint32_t)FLAGS_binlog_sync_batch_size);
-        for (uint64_t i = 0; i < batchSize;) {
-            std::string buffer;
-            ::openmldb::base::Slice record;
-            ::openmldb::base::Status status = log_reader_.ReadNextRecord(&record, &buffer);
-            if (status.ok()) {
-                ::openmldb::api::LogEntry* entry = request.add_entries();
-                if (!entry->ParseFromString(record.ToString())) {
-                    PDLOG(WARNING, "bad protobuf format %s size %ld. tid %u pid %u",
-                          ::openmldb::base::DebugString(record.ToString()).c_str(), record.ToString().size(), tid_,
-                          pid_);
-                    request.mutable_entries()->RemoveLast();
-                    break;
-                }
-                DEBUGLOG("entry val %s log index %lld", entry->value().c_str(), entry->log_index());
-                if (entry->log_index() <= sync_log_offset) {
-                    DEBUGLOG("skip duplicate log offset %lld", entry->log_index());
-                    request.mutable_entries()->RemoveLast();
-                    continue;
-                }
-                // the log index should incr by 1
-                if ((sync_log_offset + 1) != entry->log_index()) {
-                    PDLOG(WARNING, "log missing expect offset %lu but %ld. tid %u pid %u", sync_log_offset + 1,
-                          entry->log_index(), tid_, pid_);
-                    request.mutable_entries()->RemoveLast();
-                    if (go_back_cnt_ > FLAGS_go_back_max_try_cnt) {
-                        log_reader_.GoBackToStart();
-                        go_back_cnt_ = 0;
-                        PDLOG(WARNING, "go back to start. tid %u pid %u endpoint %s", tid_, pid_, endpoint_.c_str());
-                    } else {
-                        log_reader_.GoBackToLastBlock();
-                        go_back_cnt_++;
-                    }
-                    need_wait = true;
-                    break;
-                }
-                sync_log_offset = entry->log_index();
-            } else if (status.IsWaitRecord()) {
-                DEBUGLOG("got a coffee time for[%s]", endpoint_.c_str());
-                need_wait = true;
-                break;
-            } else if (status.IsInvalidRecord()) {
-                DEBUGLOG("fail to get record. %s. tid %u pid %u", status.ToString().c_str(), tid_, pid_);
-                need_wait = true;
-                if (go_back_cnt_ > FLAGS_go_back_max_try_cnt) {
-                    log_reader_.GoBackToStart();
-                    go_back_cnt_ = 0;
-                    PDLOG(WARNING, "go back to start. tid %u pid %u endpoint %s", tid_, pid_, endpoint_.c_str());
-                } else {
-                    log_reader_.GoBackToLastBlock();
-                    go_back_cnt_++;
-                }
-                break;
-            } else {
-                PDLOG(WARNING, "fail to get record: %s. tid %u pid %u", status.ToString().c_str(), tid_, pid_);
-                need_wait = true;
-                break;
-            }
-            i++;
-            go_back_cnt_ = 0;
-        }
+        need_wait = ReadEntries(log_offset, &sync_log_offset, &request);
     }
     if (request.entries_size() > 0) {
         bool ret = rpc_client_.SendRequest(&::openmldb::api::TabletServer_Stub::AppendEntries, &request, &response,
                                            FLAGS_request_timeout_ms, FLAGS_request_max_retry);
         if (ret && response.code() == 0) {
             DEBUGLOG("sync log to node[%s] to offset %lld", endpoint_.c_str(), sync_log_offset);
-            last_sync_offset_ = sync_log_offset;
-            if (!rep_node_.load(std::memory_order_relaxed) &&
-                (last_sync_offset_ > follower_offset_->load(std::memory_order_relaxed))) {
-                follower_offset_->store(last_sync_offset_, std::memory_order_relaxed);
-            }
+            AckEntries(request, sync_log_offset);
             if (request_from_cache) {
                 cache_.clear();
             }
@@ -296,6 +384,73 @@ int ReplicateNode::SyncData(uint64_t log_offset) {
     return 0;
 }
 
+int ReplicateNode::SyncDataPipelined(uint64_t log_offset) {
+    struct InflightRequest {
+        ::openmldb::api::AppendEntriesRequest request;
+        std::shared_ptr<::openmldb::api::AppendEntriesResponse> response;
+        std::shared_ptr<brpc::Controller> cntl;
+        ::openmldb::RpcCallback<::openmldb::api::AppendEntriesResponse>* callback;
+        uint64_t sync_log_offset;
+    };
+    std::deque<std::unique_ptr<InflightRequest>> window;
+    uint64_t sent_log_offset = last_sync_offset_;
+    bool need_wait = false;
+    bool failed = false;
+    while (true) {
+        // fill the window before waiting for the oldest request
+        while (!failed && !need_wait && window.size() < sync_window_ && sent_log_offset < log_offset) {
+            std::unique_ptr<InflightRequest> inflight(new InflightRequest());
+            need_wait = ReadEntries(log_offset, &sent_log_offset, &inflight->request);
+            if (inflight->request.entries_size() <= 0) {
+                break;
+            }
+            inflight->sync_log_offset = sent_log_offset;
+            inflight->response = std::make_shared<::openmldb::api::AppendEntriesResponse>();
+            inflight->cntl = std::make_shared<brpc::Controller>();
+            inflight->cntl->set_timeout_ms(FLAGS_request_timeout_ms);
+            inflight->cntl->set_request_compress_type(rpc_client_.GetRequestCompressType());
+            inflight->callback =
+                new ::openmldb::RpcCallback<::openmldb::api::AppendEntriesResponse>(inflight->response, inflight->cntl);
+            // keep the callback until the response is handled
+            inflight->callback->Ref();
+            if (!rpc_client_.SendRequest(&::openmldb::api::TabletServer_Stub::AppendEntries, inflight->cntl.get(),
+                                         &inflight->request, inflight->response.get(), inflight->callback)) {
+                // the callback is never run
+                inflight->callback->UnRef();
+                inflight->callback->UnRef();
+                failed = true;
+                break;
+            }
+            window.push_back(std::move(inflight));
+        }
+        if (window.empty()) {
+            break;
+        }
+        // the responses are handled in the order of the requests, so an ack received
+        // out of order takes effect after the former ones are acked
+        std::unique_ptr<InflightRequest> inflight = std::move(window.front());
+        window.pop_front();
+        brpc::Join(inflight->cntl->call_id());
+        if (!failed) {
+            if (!inflight->cntl->Failed() && inflight->response->code() == 0) {
+                DEBUGLOG("sync log to node[%s] to offset %lld", endpoint_.c_str(), inflight->sync_log_offset);
+                AckEntries(inflight->request, inflight->sync_log_offset);
+            } else {
+                PDLOG(WARNING, "fail to sync log to node %s at offset %lu. tid %u pid %u", endpoint_.c_str(),
+                      inflight->request.pre_log_index(), tid_, pid_);
+                failed = true;
+            }
+        }
+        inflight->callback->UnRef();
+    }
+    if (failed) {
+        // the entries after the last acked one are read again
+        log_reader_.Reset(last_sync_offset_);
+        return 1;
+    }
+    return need_wait ? 1 : 0;
+}
+
 void ReplicateNode::Stop() {
     is_running_.store(false, std::memory_order_relaxed);
     if (worker_ == 0) {
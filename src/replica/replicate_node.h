@@ -24,10 +24,12 @@
 #include "base/skiplist.h"
 #include "bthread/bthread.h"
 #include "bthread/condition_variable.h"
+#include "bvar/passive_status.h"
 #include "log/log_reader.h"
 #include "log/log_writer.h"
 #include "log/sequential_file.h"
 #include "proto/tablet.pb.h"
+#include "replica/binlog_cache.h"
 #include "rpc/rpc_client.h"
 
 namespace openmldb {
@@ -41,7 +43,8 @@ class ReplicateNode {
     ReplicateNode(const std::string& point, LogParts* logs, const std::string& log_path, uint32_t tid, uint32_t pid,
                   std::atomic<uint64_t>* term, std::atomic<uint64_t>* leader_log_offset, bthread::Mutex* mu,
                   bthread::ConditionVariable* cv, bool rep_follower, std::atomic<uint64_t>* follower_offset,
-                  const std::string& real_point);
+                  const std::string& real_point, BinlogCache* binlog_cache = NULL,
+                  std::atomic<uint64_t>* leader_log_bytes = NULL);
     int Init();
 
     int Start();
@@ -63,6 +66,9 @@ class ReplicateNode {
 
     int GetLogIndex();
 
+    // the bytes of the entries appended after the node matched the follower and not acked yet
+    uint64_t GetLagBytes();
+
     void Stop();
 
     ReplicateNode(const ReplicateNode&) = delete;
@@ -72,6 +78,15 @@ class ReplicateNode {
  private:
     int MatchLogOffsetFromNode();
 
+    // read the entries after sync_log_offset into the request from the binlog cache or the binlog,
+    // sync_log_offset is moved to the last read entry, return true if there are no more entries to read
+    bool ReadEntries(uint64_t log_offset, uint64_t* sync_log_offset, ::openmldb::api::AppendEntriesRequest* request);
+
+    // send sync_window_ requests at most without waiting for the responses
+    int SyncDataPipelined(uint64_t log_offset);
+
+    void AckEntries(const ::openmldb::api::AppendEntriesRequest& request, uint64_t sync_log_offset);
+
  private:
     LogReader log_reader_;
     std::vector<::openmldb::api::AppendEntriesRequest> cache_;
@@ -90,6 +105,16 @@ class ReplicateNode {
     uint32_t go_back_cnt_;
     std::atomic<bool> rep_node_;
     std::atomic<uint64_t>* follower_offset_;  // max local cluster follower offset
+    // the latest entries of the leader, the binlog is read only if the entries are not cached
+    BinlogCache* binlog_cache_;
+    std::atomic<uint64_t>* leader_log_bytes_;
+    uint64_t match_log_offset_;
+    std::atomic<uint64_t> synced_bytes_;
+    // binlog_sync_window and binlog_sync_batch_size, or the replica_cluster ones for a follower in a replica cluster
+    uint32_t sync_window_;
+    uint32_t sync_batch_size_;
+    // GetLagBytes exported as the bvar replicate_<tid>_<pid>_<endpoint>_lag_bytes
+    bvar::PassiveStatus<uint64_t> lag_bytes_;
 };
 
 }  // namespace replica
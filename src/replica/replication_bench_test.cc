@@ -0,0 +1,207 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <brpc/server.h>
+#include <gflags/gflags.h>
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/glog_wapper.h"
+#include "base/strings.h"
+#include "common/timer.h"
+#include "proto/tablet.pb.h"
+#include "replica/log_replicator.h"
+#include "replica/replicate_node.h"
+#include "storage/binlog.h"
+#include "storage/mem_table.h"
+#include "storage/mem_table_snapshot.h"
+
+using ::google::protobuf::Closure;
+using ::google::protobuf::RpcController;
+using ::openmldb::storage::Binlog;
+using ::openmldb::storage::MemTable;
+using ::openmldb::storage::MemTableSnapshot;
+
+DEFINE_string(bench_entry_cnt, "10000,100000,500000", "the binlog entry counts of the rounds");
+DEFINE_uint32(bench_value_size, 100, "the byte size of the value of every entry");
+DEFINE_uint32(bench_catch_up_timeout_s, 600, "the max seconds the follower takes to catch up");
+
+namespace openmldb {
+namespace replica {
+
+static const uint32_t TID = 1;
+static const uint32_t PID = 1;
+static const uint32_t KEY_NUM = 1000;
+
+// the follower only applies the entries from the leader
+class FollowerTabletImpl : public ::openmldb::api::TabletServer {
+ public:
+    FollowerTabletImpl(const std::string& path, std::shared_ptr<MemTable> table)
+        : follower_(true), replicator_(path, std::map<std::string, std::string>(), kFollowerNode, table, &follower_) {}
+
+    ~FollowerTabletImpl() {}
+
+    bool Init() { return replicator_.Init(); }
+
+    void AppendEntries(RpcController* controller, const ::openmldb::api::AppendEntriesRequest* request,
+                       ::openmldb::api::AppendEntriesResponse* response, Closure* done) {
+        response->set_code(replicator_.AppendEntries(request, response) ? 0 : 1);
+        done->Run();
+        replicator_.Notify();
+    }
+
+ private:
+    std::atomic<bool> follower_;
+    LogReplicator replicator_;
+};
+
+class ReplicationBenchmarkTest : public ::testing::Test {
+ public:
+    ReplicationBenchmarkTest() {}
+    ~ReplicationBenchmarkTest() {}
+};
+
+inline std::string GenRand() { return std::to_string(rand() % 10000000 + 1); }  // NOLINT
+
+static std::shared_ptr<MemTable> NewTable() {
+    std::map<std::string, uint32_t> mapping;
+    mapping.insert(std::make_pair("idx0", 0));
+    auto table = std::make_shared<MemTable>("t1", TID, PID, 8, mapping, 0, ::openmldb::type::TTLType::kAbsoluteTime);
+    table->Init();
+    return table;
+}
+
+// the results are printed as one json object per line to be collected by the scripts
+static void PrintResult(const std::string& stage, uint64_t entry_cnt, uint64_t consumed_us) {
+    uint64_t throughput = entry_cnt * 1000000 / std::max<uint64_t>(consumed_us, 1);
+    std::cout << "{\"stage\": \"" << stage << "\", \"entry_cnt\": " << entry_cnt << ", \"value_size\": "
+              << FLAGS_bench_value_size << ", \"consumed_us\": " << consumed_us << ", \"entries_per_s\": " << throughput
+              << "}" << std::endl;
+}
+
+static bool WaitRecordCnt(const std::shared_ptr<MemTable>& table, uint64_t cnt, uint64_t timeout_us) {
+    uint64_t start = ::baidu::common::timer::get_micros();
+    while (table->GetRecordCnt() < cnt) {
+        if (::baidu::common::timer::get_micros() - start > timeout_us) {
+            return false;
+        }
+        usleep(1000);
+    }
+    return true;
+}
+
+TEST_F(ReplicationBenchmarkTest, AppendReplicateSnapshotRecover) {
+    std::vector<std::string> cnt_vec;
+    ::openmldb::base::SplitString(FLAGS_bench_entry_cnt, ",", cnt_vec);
+    uint32_t port = 18650 + rand() % 1000;  // NOLINT
+    for (const auto& cnt_str : cnt_vec) {
+        uint64_t entry_cnt = std::stoull(cnt_str);
+        std::string root_path = "/tmp/replication_bench" + GenRand();
+        std::string table_path = root_path + "/" + std::to_string(TID) + "_" + std::to_string(PID);
+        std::shared_ptr<MemTable> leader_table = NewTable();
+        std::atomic<bool> follower(false);
+        LogReplicator leader(table_path, std::map<std::string, std::string>(), kLeaderNode, leader_table, &follower);
+        ASSERT_TRUE(leader.Init());
+
+        // append to the binlog of the leader
+        std::string value(FLAGS_bench_value_size, 'v');
+        uint64_t consumed = ::baidu::common::timer::get_micros();
+        for (uint64_t i = 0; i < entry_cnt; i++) {
+            ::openmldb::api::LogEntry entry;
+            ::openmldb::api::Dimension* dim = entry.add_dimensions();
+            dim->set_key("key" + std::to_string(i % KEY_NUM));
+            dim->set_idx(0);
+            entry.set_ts(i + 1);
+            entry.set_value(value);
+            ASSERT_TRUE(leader.AppendEntry(entry));
+        }
+        leader.SyncToDisk();
+        consumed = ::baidu::common::timer::get_micros() - consumed;
+        PrintResult("append", entry_cnt, consumed);
+
+        // a new follower catches up with the whole binlog
+        brpc::Server server;
+        std::shared_ptr<MemTable> follower_table = NewTable();
+        FollowerTabletImpl* follower_tablet =
+            new FollowerTabletImpl("/tmp/replication_bench" + GenRand(), follower_table);
+        ASSERT_TRUE(follower_tablet->Init());
+        ASSERT_EQ(0, server.AddService(follower_tablet, brpc::SERVER_OWNS_SERVICE));
+        std::string endpoint = "127.0.0.1:" + std::to_string(port++);
+        brpc::ServerOptions options;
+        ASSERT_EQ(0, server.Start(endpoint.c_str(), &options));
+        consumed = ::baidu::common::timer::get_micros();
+        std::map<std::string, std::string> follower_map;
+        follower_map.insert(std::make_pair(endpoint, ""));
+        ASSERT_EQ(0, leader.AddReplicateNode(follower_map));
+        leader.Notify();
+        ASSERT_TRUE(WaitRecordCnt(follower_table, entry_cnt, FLAGS_bench_catch_up_timeout_s * 1000000ull));
+        consumed = ::baidu::common::timer::get_micros() - consumed;
+        PrintResult("catch_up", entry_cnt, consumed);
+        leader.DelAllReplicateNode();
+        server.Stop(0);
+        server.Join();
+
+        // snapshot the binlog of the leader
+        MemTableSnapshot snapshot(TID, PID, leader.GetLogPart(), root_path);
+        ASSERT_TRUE(snapshot.Init());
+        uint64_t snapshot_offset = 0;
+        consumed = ::baidu::common::timer::get_micros();
+        ASSERT_EQ(0, snapshot.MakeSnapshot(leader_table, snapshot_offset, 0));
+        consumed = ::baidu::common::timer::get_micros() - consumed;
+        ASSERT_EQ(entry_cnt, snapshot_offset);
+        PrintResult("make_snapshot", entry_cnt, consumed);
+
+        // recover a table from the snapshot, as a tablet restarts
+        std::shared_ptr<MemTable> recovered_table = NewTable();
+        MemTableSnapshot recovered_snapshot(TID, PID, leader.GetLogPart(), root_path);
+        ASSERT_TRUE(recovered_snapshot.Init());
+        Binlog binlog(leader.GetLogPart(), table_path + "/binlog/");
+        uint64_t recovered_offset = 0;
+        uint64_t latest_offset = 0;
+        consumed = ::baidu::common::timer::get_micros();
+        ASSERT_TRUE(recovered_snapshot.Recover(recovered_table, recovered_offset));
+        ASSERT_TRUE(binlog.RecoverFromBinlog(recovered_table, recovered_offset, latest_offset));
+        consumed = ::baidu::common::timer::get_micros() - consumed;
+        ASSERT_EQ(entry_cnt, recovered_table->GetRecordCnt());
+        PrintResult("recover_snapshot", entry_cnt, consumed);
+
+        // recover a table by replaying the whole binlog
+        std::shared_ptr<MemTable> replayed_table = NewTable();
+        consumed = ::baidu::common::timer::get_micros();
+        ASSERT_TRUE(binlog.RecoverFromBinlog(replayed_table, 0, latest_offset));
+        consumed = ::baidu::common::timer::get_micros() - consumed;
+        ASSERT_EQ(entry_cnt, replayed_table->GetRecordCnt());
+        PrintResult("recover_binlog", entry_cnt, consumed);
+    }
+}
+
+}  // namespace replica
+}  // namespace openmldb
+
+int main(int argc, char** argv) {
+    srand(time(NULL));
+    ::openmldb::base::SetLogLevel(WARNING);
+    ::testing::InitGoogleTest(&argc, argv);
+    ::google::ParseCommandLineFlags(&argc, &argv, true);
+    return RUN_ALL_TESTS();
+}
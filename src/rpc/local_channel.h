@@ -0,0 +1,104 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_RPC_LOCAL_CHANNEL_H_
+#define SRC_RPC_LOCAL_CHANNEL_H_
+
+#include <google/protobuf/service.h>
+
+#include <map>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <string>
+
+#include "base/count_down_latch.h"
+
+namespace openmldb {
+
+// the services running in the process by their endpoints, eg, the embedded tablet. The clients of them created
+// after the registration call the services directly instead of sending the requests by the sockets
+class LocalServiceRegistry {
+ public:
+    static void Register(const std::string& endpoint, const std::shared_ptr<google::protobuf::Service>& service) {
+        std::lock_guard<std::mutex> lock(GetMutex());
+        GetServices()[endpoint] = service;
+    }
+
+    static void Unregister(const std::string& endpoint) {
+        std::lock_guard<std::mutex> lock(GetMutex());
+        GetServices().erase(endpoint);
+    }
+
+    static std::shared_ptr<google::protobuf::Service> Find(const std::string& endpoint) {
+        std::lock_guard<std::mutex> lock(GetMutex());
+        auto& services = GetServices();
+        auto it = services.find(endpoint);
+        return it == services.end() ? std::shared_ptr<google::protobuf::Service>() : it->second;
+    }
+
+ private:
+    static std::mutex& GetMutex() {
+        static std::mutex mu;
+        return mu;
+    }
+    static std::map<std::string, std::shared_ptr<google::protobuf::Service>>& GetServices() {
+        static std::map<std::string, std::shared_ptr<google::protobuf::Service>> services;
+        return services;
+    }
+};
+
+// LocalChannel passes the controller, the request and the response of a call to the service in the process as
+// they are, so the attachments of the controller are not copied and no socket is used. The local calls are not
+// bounded by the timeout of the controller.
+//
+// Only the synchronous calls are local. The caller of an asynchronous call joins the call id of the controller,
+// which is never destroyed without the rpc, so the calls with done are sent by the remote channel.
+class LocalChannel : public google::protobuf::RpcChannel {
+ public:
+    LocalChannel(const std::shared_ptr<google::protobuf::Service>& service, google::protobuf::RpcChannel* remote)
+        : service_(service), remote_(remote) {}
+    ~LocalChannel() override {}
+
+    void CallMethod(const google::protobuf::MethodDescriptor* method, google::protobuf::RpcController* controller,
+                    const google::protobuf::Message* request, google::protobuf::Message* response,
+                    google::protobuf::Closure* done) override {
+        if (done != nullptr) {
+            remote_->CallMethod(method, controller, request, response, done);
+            return;
+        }
+        // the service may run the call on its own threads, eg, the put of the tablet
+        LatchClosure latch;
+        service_->CallMethod(method, controller, request, response, &latch);
+        latch.Wait();
+    }
+
+ private:
+    class LatchClosure : public google::protobuf::Closure {
+     public:
+        LatchClosure() : latch_(1) {}
+        void Run() override { latch_.CountDown(); }
+        void Wait() { latch_.Wait(); }
+
+     private:
+        ::openmldb::base::CountDownLatch latch_;
+    };
+
+    std::shared_ptr<google::protobuf::Service> service_;
+    google::protobuf::RpcChannel* remote_;
+};
+
+}  // namespace openmldb
+#endif  // SRC_RPC_LOCAL_CHANNEL_H_
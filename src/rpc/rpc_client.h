@@ -44,8 +44,10 @@
 
 #include "base/glog_wapper.h"  // NOLINT
 #include "proto/tablet.pb.h"
+#include "rpc/local_channel.h"
 
 DECLARE_int32(request_sleep_time);
+DECLARE_bool(enable_local_call);
 
 namespace openmldb {
 
@@ -75,12 +77,29 @@ template <class T>
 class RpcClient {
  public:
     explicit RpcClient(const std::string& endpoint)
-        : endpoint_(endpoint), use_sleep_policy_(false), log_id_(0), stub_(NULL), channel_(NULL) {}
+        : endpoint_(endpoint),
+          use_sleep_policy_(false),
+          log_id_(0),
+          request_compress_type_(brpc::COMPRESS_TYPE_NONE),
+          connection_type_(),
+          connection_group_(),
+          stub_(NULL),
+          channel_(NULL),
+          local_channel_(NULL) {}
     RpcClient(const std::string& endpoint, bool use_sleep_policy)
-        : endpoint_(endpoint), use_sleep_policy_(use_sleep_policy), log_id_(0), stub_(NULL), channel_(NULL) {}
+        : endpoint_(endpoint),
+          use_sleep_policy_(use_sleep_policy),
+          log_id_(0),
+          request_compress_type_(brpc::COMPRESS_TYPE_NONE),
+          connection_type_(),
+          connection_group_(),
+          stub_(NULL),
+          channel_(NULL),
+          local_channel_(NULL) {}
     ~RpcClient() {
-        delete channel_;
         delete stub_;
+        delete local_channel_;
+        delete channel_;
     }
 
     int Init() {
@@ -89,13 +108,35 @@ class RpcClient {
         if (use_sleep_policy_) {
             options.retry_policy = &sleep_retry_policy;
         }
+        if (!connection_type_.empty()) {
+            options.connection_type = connection_type_.c_str();
+        }
+        options.connection_group = connection_group_;
         if (channel_->Init(endpoint_.c_str(), "", &options) != 0) {
             return -1;
         }
-        stub_ = new T(channel_);
+        auto service = FLAGS_enable_local_call ? LocalServiceRegistry::Find(endpoint_) : nullptr;
+        if (service) {
+            local_channel_ = new LocalChannel(service, channel_);
+            stub_ = new T(local_channel_);
+        } else {
+            stub_ = new T(channel_);
+        }
         return 0;
     }
 
+    // the compress type of the requests sent with the controllers created by the client
+    void SetRequestCompressType(brpc::CompressType compress_type) { request_compress_type_ = compress_type; }
+
+    inline brpc::CompressType GetRequestCompressType() const { return request_compress_type_; }
+
+    // the connection type of the channel is single, pooled or short, and the channels in different
+    // groups do not share the connections. it must be set before Init
+    void SetConnectionOptions(const std::string& connection_type, const std::string& connection_group) {
+        connection_type_ = connection_type;
+        connection_group_ = connection_group;
+    }
+
     template <class Request, class Response, class Callback>
     bool SendRequest(void (T::*func)(google::protobuf::RpcController*, const Request*, Response*, Callback*),
                      brpc::Controller* cntl, const Request* request, Response* response, Callback* callback) {
@@ -126,6 +167,7 @@ class RpcClient {
                      const Request* request, Response* response, uint64_t rpc_timeout, int retry_times) {
         brpc::Controller cntl;
         cntl.set_log_id(log_id_++);
+        cntl.set_request_compress_type(request_compress_type_);
         if (rpc_timeout > 0) {
             cntl.set_timeout_ms(rpc_timeout);
         }
@@ -151,6 +193,7 @@ class RpcClient {
                                   butil::IOBuf* buff) {
         brpc::Controller cntl;
         cntl.set_log_id(log_id_++);
+        cntl.set_request_compress_type(request_compress_type_);
         if (rpc_timeout > 0) {
             cntl.set_timeout_ms(rpc_timeout);
         }
@@ -187,8 +230,13 @@ class RpcClient {
     std::string endpoint_;
     bool use_sleep_policy_;
     uint64_t log_id_;
+    brpc::CompressType request_compress_type_;
+    std::string connection_type_;
+    std::string connection_group_;
     T* stub_;
     brpc::Channel* channel_;
+    // the channel to the service in the process, if any
+    LocalChannel* local_channel_;
 };
 
 template <class Response>
@@ -52,7 +52,12 @@ ClusterSDK::ClusterSDK(const ClusterOptions& options)
       session_id_(0),
       rand_(0xdeadbeef),
       sp_root_path_(options.zk_path + "/store_procedure/db_sp_data"),
-      engine_(NULL) {}
+      engine_(NULL),
+      refresh_mu_(),
+      table_nodes_(),
+      sp_nodes_() {
+    client_manager_->SetConnectionOptions(options.connection_type, options.channel_num);
+}
 
 ClusterSDK::~ClusterSDK() {
     pool_.Stop(false);
@@ -137,12 +142,33 @@ bool ClusterSDK::CreateNsClient() {
     }
 }
 
+std::vector<int64_t> ClusterSDK::GetNodesVersion(const std::string& root, const std::vector<std::string>& nodes) {
+    std::vector<std::string> paths;
+    paths.reserve(nodes.size());
+    for (const auto& node : nodes) {
+        paths.push_back(root + "/" + node);
+    }
+    std::vector<int64_t> versions;
+    if (!zk_client_->GetNodesVersion(paths, &versions)) {
+        LOG(WARNING) << "fail to get the versions of the nodes in " << root << ", load all of them";
+        versions.assign(nodes.size(), -2);
+    }
+    return versions;
+}
+
 bool ClusterSDK::RefreshCatalog(const std::vector<std::string>& table_datas, const std::vector<std::string>& sp_datas) {
-    std::vector<::openmldb::nameserver::TableInfo> tables;
-    std::map<std::string, std::map<std::string, std::shared_ptr<::openmldb::nameserver::TableInfo>>> mapping;
-    auto new_catalog = std::make_shared<::openmldb::catalog::SDKCatalog>(client_manager_);
+    std::lock_guard<std::mutex> refresh_lock(refresh_mu_);
+    // only the nodes changed since the last refresh are loaded, and the handlers of the others are reused
+    uint32_t changed_cnt = 0;
+    std::map<std::string, TableNode> table_nodes;
+    std::vector<int64_t> versions = GetNodesVersion(table_root_path_, table_datas);
     for (uint32_t i = 0; i < table_datas.size(); i++) {
         if (table_datas[i].empty()) continue;
+        auto node_it = table_nodes_.find(table_datas[i]);
+        if (node_it != table_nodes_.end() && versions[i] >= 0 && node_it->second.version == versions[i]) {
+            table_nodes.emplace(table_datas[i], node_it->second);
+            continue;
+        }
         std::string value;
         bool ok = zk_client_->GetNodeValue(table_root_path_ + "/" + table_datas[i], value);
         if (!ok) {
@@ -159,21 +185,26 @@ bool ClusterSDK::RefreshCatalog(const std::vector<std::string>& table_datas, con
         if (table_info->format_version() != 1) {
             continue;
         }
-        tables.push_back(*(table_info.get()));
-        auto it = mapping.find(table_info->db());
-        if (it == mapping.end()) {
-            std::map<std::string, std::shared_ptr<::openmldb::nameserver::TableInfo>> table_in_db;
-            table_in_db.insert(std::make_pair(table_info->name(), table_info));
-            mapping.insert(std::make_pair(table_info->db(), table_in_db));
-        } else {
-            it->second.insert(std::make_pair(table_info->name(), table_info));
+        auto table = std::make_shared<::openmldb::catalog::SDKTableHandler>(*table_info, *client_manager_);
+        if (!table->Init()) {
+            LOG(WARNING) << "fail to init table " << table_info->name();
+            return false;
         }
+        table_nodes.emplace(table_datas[i], TableNode{versions[i], table_info, table});
+        changed_cnt++;
         DLOG(INFO) << "load table info with name " << table_info->name() << " in db " << table_info->db();
     }
 
-    Procedures db_sp_map;
-    for (const auto& node : sp_datas) {
+    std::map<std::string, ProcedureNode> sp_nodes;
+    versions = GetNodesVersion(sp_root_path_, sp_datas);
+    for (uint32_t i = 0; i < sp_datas.size(); i++) {
+        const auto& node = sp_datas[i];
         if (node.empty()) continue;
+        auto node_it = sp_nodes_.find(node);
+        if (node_it != sp_nodes_.end() && versions[i] >= 0 && node_it->second.version == versions[i]) {
+            sp_nodes.emplace(node, node_it->second);
+            continue;
+        }
         std::string value;
         bool ok = zk_client_->GetNodeValue(sp_root_path_ + "/" + node, value);
         if (!ok) {
@@ -196,16 +227,31 @@ bool ClusterSDK::RefreshCatalog(const std::vector<std::string>& table_datas, con
                          << " db: " << sp_info_pb.db_name();
             continue;
         }
-        auto it = db_sp_map.find(sp_info->GetDbName());
-        if (it == db_sp_map.end()) {
-            std::map<std::string, std::shared_ptr<hybridse::sdk::ProcedureInfo>> sp_in_db = {
-                {sp_info->GetSpName(), sp_info}};
-            db_sp_map.insert(std::make_pair(sp_info->GetDbName(), sp_in_db));
-        } else {
-            it->second.insert(std::make_pair(sp_info->GetSpName(), sp_info));
-        }
+        sp_nodes.emplace(node, ProcedureNode{versions[i], sp_info});
+        changed_cnt++;
         DLOG(INFO) << "load procedure info with sp name " << sp_info->GetSpName() << " in db " << sp_info->GetDbName();
     }
+    // the nodes kept are all from the last refresh, so nothing is changed if none is loaded or removed
+    if (changed_cnt == 0 && table_nodes.size() == table_nodes_.size() && sp_nodes.size() == sp_nodes_.size()) {
+        DLOG(INFO) << "the catalog is not changed";
+        return true;
+    }
+    LOG(INFO) << "refresh catalog with " << changed_cnt << " nodes changed, " << table_nodes.size() << " tables and "
+              << sp_nodes.size() << " procedures";
+
+    std::vector<std::shared_ptr<::openmldb::catalog::SDKTableHandler>> tables;
+    std::map<std::string, std::map<std::string, std::shared_ptr<::openmldb::nameserver::TableInfo>>> mapping;
+    for (const auto& kv : table_nodes) {
+        const auto& table_info = kv.second.table_info;
+        tables.push_back(kv.second.table);
+        mapping[table_info->db()].insert(std::make_pair(table_info->name(), table_info));
+    }
+    Procedures db_sp_map;
+    for (const auto& kv : sp_nodes) {
+        const auto& sp_info = kv.second.sp_info;
+        db_sp_map[sp_info->GetDbName()].insert(std::make_pair(sp_info->GetSpName(), sp_info));
+    }
+    auto new_catalog = std::make_shared<::openmldb::catalog::SDKCatalog>(client_manager_);
     if (!new_catalog->Init(tables, db_sp_map)) {
         LOG(WARNING) << "fail to init catalog";
         return false;
@@ -215,6 +261,8 @@ bool ClusterSDK::RefreshCatalog(const std::vector<std::string>& table_datas, con
         table_to_tablets_ = mapping;
         catalog_ = new_catalog;
     }
+    table_nodes_.swap(table_nodes);
+    sp_nodes_.swap(sp_nodes);
     engine_->UpdateCatalog(new_catalog);
     return true;
 }
@@ -388,6 +436,45 @@ std::shared_ptr<::openmldb::catalog::TabletAccessor> ClusterSDK::GetTablet(const
     return std::shared_ptr<::openmldb::catalog::TabletAccessor>();
 }
 
+std::shared_ptr<::openmldb::catalog::TabletAccessor> ClusterSDK::GetReadTablet(const std::string& db,
+                                                                               const std::string& name) {
+    auto table_handler = GetCatalog()->GetTable(db, name);
+    return GetReadTablet(std::dynamic_pointer_cast<::openmldb::catalog::SDKTableHandler>(table_handler));
+}
+
+std::shared_ptr<::openmldb::catalog::TabletAccessor> ClusterSDK::GetReadTablet(const std::string& db,
+                                                                               const std::string& name,
+                                                                               const std::string& pk) {
+    auto table_handler = GetCatalog()->GetTable(db, name);
+    return GetReadTablet(std::dynamic_pointer_cast<::openmldb::catalog::SDKTableHandler>(table_handler), pk);
+}
+
+std::shared_ptr<::openmldb::catalog::TabletAccessor> ClusterSDK::GetReadTablet(
+    const std::shared_ptr<::openmldb::catalog::SDKTableHandler>& table) {
+    if (!table) {
+        return std::shared_ptr<::openmldb::catalog::TabletAccessor>();
+    }
+    uint32_t pid_num = table->GetPartitionNum();
+    uint32_t pid = 0;
+    if (pid_num > 0) {
+        pid = rand_.Uniform(pid_num);
+    }
+    return table->GetReadTablet(pid, options_.read_policy, options_.max_follower_lag);
+}
+
+std::shared_ptr<::openmldb::catalog::TabletAccessor> ClusterSDK::GetReadTablet(
+    const std::shared_ptr<::openmldb::catalog::SDKTableHandler>& table, const std::string& pk) {
+    if (!table) {
+        return std::shared_ptr<::openmldb::catalog::TabletAccessor>();
+    }
+    uint32_t pid_num = table->GetPartitionNum();
+    uint32_t pid = 0;
+    if (pid_num > 0) {
+        pid = ::openmldb::base::hash64(pk) % pid_num;
+    }
+    return table->GetReadTablet(pid, options_.read_policy, options_.max_follower_lag);
+}
+
 std::shared_ptr<hybridse::sdk::ProcedureInfo> ClusterSDK::GetProcedureInfo(const std::string& db,
                                                                            const std::string& sp_name,
                                                                            std::string* msg) {
@@ -19,6 +19,7 @@
 
 #include <map>
 #include <memory>
+#include <mutex>  // NOLINT
 #include <string>
 #include <vector>
 
@@ -40,6 +41,13 @@ struct ClusterOptions {
     std::string zk_cluster;
     std::string zk_path;
     int32_t session_timeout = 2000;
+    ::openmldb::catalog::ReadPolicy read_policy = ::openmldb::catalog::kReadLeader;
+    // the followers behind the leader more than the offsets are not read
+    uint64_t max_follower_lag = 10000;
+    // the connection type of the channels to the tablets: single, pooled or short
+    std::string connection_type;
+    // the number of the channels to a tablet, the requests are sent through them in turn
+    uint32_t channel_num = 1;
 };
 
 class ClusterSDK {
@@ -80,6 +88,21 @@ class ClusterSDK {
     std::shared_ptr<::openmldb::catalog::TabletAccessor> GetTablet(const std::string& db, const std::string& name,
                                                                    const std::string& pk);
 
+    // the replica to read by the read policy, in a random partition or in the partition of pk
+    std::shared_ptr<::openmldb::catalog::TabletAccessor> GetReadTablet(const std::string& db, const std::string& name);
+    std::shared_ptr<::openmldb::catalog::TabletAccessor> GetReadTablet(const std::string& db, const std::string& name,
+                                                                       const std::string& pk);
+    std::shared_ptr<::openmldb::catalog::TabletAccessor> GetReadTablet(
+        const std::shared_ptr<::openmldb::catalog::SDKTableHandler>& table);
+    std::shared_ptr<::openmldb::catalog::TabletAccessor> GetReadTablet(
+        const std::shared_ptr<::openmldb::catalog::SDKTableHandler>& table, const std::string& pk);
+
+    inline std::vector<std::shared_ptr<::openmldb::catalog::TabletAccessor>> GetTabletAccessors() {
+        return client_manager_->GetTablets();
+    }
+
+    inline const ClusterOptions& GetOptions() const { return options_; }
+
     std::shared_ptr<hybridse::sdk::ProcedureInfo> GetProcedureInfo(const std::string& db, const std::string& sp_name,
                                                                    std::string* msg);
 
@@ -94,8 +117,21 @@ class ClusterSDK {
     bool CreateNsClient();
     void WatchNotify();
     void CheckZk();
+    // the versions of the nodes under root, and -2 for the nodes whose versions are unknown
+    std::vector<int64_t> GetNodesVersion(const std::string& root, const std::vector<std::string>& nodes);
 
  private:
+    // the nodes loaded from zookeeper with the versions, which are not loaded again until they are changed
+    struct TableNode {
+        int64_t version;
+        std::shared_ptr<::openmldb::nameserver::TableInfo> table_info;
+        std::shared_ptr<::openmldb::catalog::SDKTableHandler> table;
+    };
+    struct ProcedureNode {
+        int64_t version;
+        std::shared_ptr<hybridse::sdk::ProcedureInfo> sp_info;
+    };
+
     std::atomic<uint64_t> cluster_version_;
     ClusterOptions options_;
     std::string nodes_root_path_;
@@ -112,6 +148,10 @@ class ClusterSDK {
     ::openmldb::base::Random rand_;
     std::string sp_root_path_;
     ::hybridse::vm::Engine* engine_;
+    // serializes the refreshes of the catalog, which own the nodes below
+    std::mutex refresh_mu_;
+    std::map<std::string, TableNode> table_nodes_;
+    std::map<std::string, ProcedureNode> sp_nodes_;
 };
 
 }  // namespace sdk
@@ -0,0 +1,305 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "sdk/procedure_batcher.h"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "base/count_down_latch.h"
+#include "base/status.h"
+#include "brpc/controller.h"
+#include "common/timer.h"
+#include "glog/logging.h"
+#include "rpc/rpc_client.h"
+#include "sdk/batch_request_result_set_sql.h"
+
+namespace openmldb {
+namespace sdk {
+
+struct ProcedureBatch {
+    ProcedureBatch(const std::string& db, const std::string& sp_name,
+                   const std::shared_ptr<::openmldb::client::TabletClient>& tablet,
+                   const std::shared_ptr<SQLRequestRowBatch>& row_batch, uint64_t deadline)
+        : db(db),
+          sp_name(sp_name),
+          tablet(tablet),
+          row_batch(row_batch),
+          timeout_ms(0),
+          deadline(deadline),
+          sent(1),
+          callback(nullptr) {}
+
+    ~ProcedureBatch() {
+        if (callback) {
+            callback->UnRef();
+        }
+    }
+
+    std::string db;
+    std::string sp_name;
+    std::shared_ptr<::openmldb::client::TabletClient> tablet;
+    std::shared_ptr<SQLRequestRowBatch> row_batch;
+    // the max timeout of the requests in the batch
+    uint64_t timeout_ms;
+    uint64_t deadline;
+    // the count down is done when the batch is sent, the callback is null if it fails
+    ::openmldb::base::CountDownLatch sent;
+    openmldb::RpcCallback<openmldb::api::SQLBatchRequestQueryResponse>* callback;
+};
+
+// the result of one request of the batch, which reads the row through its own cursor on the
+// response shared by the batch
+class BatchRowResultSet : public ::hybridse::sdk::ResultSet {
+ public:
+    BatchRowResultSet(std::unique_ptr<SQLBatchRequestResultSet> rs, int32_t idx)
+        : rs_(std::move(rs)), idx_(idx), visited_(false) {}
+
+    bool Reset() override {
+        visited_ = false;
+        return true;
+    }
+
+    bool Next() override {
+        if (visited_) {
+            return false;
+        }
+        visited_ = true;
+        rs_->Reset();
+        for (int32_t i = 0; i <= idx_; i++) {
+            if (!rs_->Next()) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool GetString(uint32_t index, std::string* val) override { return rs_->GetString(index, val); }
+    bool GetBool(uint32_t index, bool* result) override { return rs_->GetBool(index, result); }
+    bool GetChar(uint32_t index, char* result) override { return rs_->GetChar(index, result); }
+    bool GetInt16(uint32_t index, int16_t* result) override { return rs_->GetInt16(index, result); }
+    bool GetInt32(uint32_t index, int32_t* result) override { return rs_->GetInt32(index, result); }
+    bool GetInt64(uint32_t index, int64_t* result) override { return rs_->GetInt64(index, result); }
+    bool GetFloat(uint32_t index, float* result) override { return rs_->GetFloat(index, result); }
+    bool GetDouble(uint32_t index, double* result) override { return rs_->GetDouble(index, result); }
+    bool GetDate(uint32_t index, int32_t* year, int32_t* month, int32_t* day) override {
+        return rs_->GetDate(index, year, month, day);
+    }
+    bool GetDate(uint32_t index, int32_t* days) override { return rs_->GetDate(index, days); }
+    bool GetTime(uint32_t index, int64_t* mills) override { return rs_->GetTime(index, mills); }
+    const ::hybridse::sdk::Schema* GetSchema() override { return rs_->GetSchema(); }
+    bool IsNULL(int index) override { return rs_->IsNULL(index); }
+    int32_t Size() override { return 1; }
+
+ private:
+    std::unique_ptr<SQLBatchRequestResultSet> rs_;
+    int32_t idx_;
+    bool visited_;
+};
+
+class ProcedureBatchFuture : public QueryFuture {
+ public:
+    ProcedureBatchFuture(const std::shared_ptr<ProcedureBatch>& batch, int32_t idx) : batch_(batch), idx_(idx) {}
+
+    std::shared_ptr<hybridse::sdk::ResultSet> GetResultSet(hybridse::sdk::Status* status) override {
+        if (!status) {
+            return nullptr;
+        }
+        batch_->sent.Wait();
+        auto callback = batch_->callback;
+        if (!callback) {
+            status->code = hybridse::common::kRpcError;
+            status->msg = "request error, fail to send the batch of procedure " + batch_->sp_name;
+            return nullptr;
+        }
+        brpc::Join(callback->GetController()->call_id());
+        if (callback->GetController()->Failed()) {
+            status->code = hybridse::common::kRpcError;
+            status->msg = "request error, " + callback->GetController()->ErrorText();
+            return nullptr;
+        }
+        const auto& response = callback->GetResponse();
+        if (response->code() != ::openmldb::base::kOk) {
+            status->code = response->code();
+            status->msg = "request error, " + response->msg();
+            return nullptr;
+        }
+        if (static_cast<int32_t>(response->count()) <= idx_) {
+            status->code = -1;
+            status->msg = "request error, the row of the request is not in the batch response";
+            return nullptr;
+        }
+        std::unique_ptr<SQLBatchRequestResultSet> rs(
+            new SQLBatchRequestResultSet(response, callback->GetController()));
+        if (!rs->Init()) {
+            status->code = -1;
+            status->msg = "request error, batch request result set init failed";
+            return nullptr;
+        }
+        return std::make_shared<BatchRowResultSet>(std::move(rs), idx_);
+    }
+
+    bool IsDone() const override {
+        if (!batch_->sent.IsDone()) {
+            return false;
+        }
+        return !batch_->callback || batch_->callback->IsDone();
+    }
+
+ private:
+    std::shared_ptr<ProcedureBatch> batch_;
+    int32_t idx_;
+};
+
+ProcedureBatcher::ProcedureBatcher(uint32_t window_us, uint32_t max_batch_size, bool is_debug)
+    : window_us_(window_us),
+      max_batch_size_(std::max(max_batch_size, 1u)),
+      is_debug_(is_debug),
+      batches_(),
+      mu_(),
+      cv_(),
+      running_(false),
+      thread_() {}
+
+ProcedureBatcher::~ProcedureBatcher() { Stop(); }
+
+void ProcedureBatcher::Start() {
+    std::lock_guard<std::mutex> lock(mu_);
+    if (running_) {
+        return;
+    }
+    running_ = true;
+    thread_ = std::thread(&ProcedureBatcher::Run, this);
+}
+
+void ProcedureBatcher::Stop() {
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        if (!running_) {
+            return;
+        }
+        running_ = false;
+    }
+    cv_.notify_all();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+std::shared_ptr<QueryFuture> ProcedureBatcher::CallProcedure(
+    const std::string& db, const std::string& sp_name, const std::shared_ptr<::openmldb::client::TabletClient>& tablet,
+    uint64_t timeout_ms, const std::shared_ptr<SQLRequestRow>& row, ::hybridse::sdk::Status* status) {
+    std::string key = db + "|" + sp_name + "|" + tablet->GetEndpoint();
+    std::shared_ptr<ProcedureBatch> full_batch;
+    std::shared_ptr<QueryFuture> future;
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        if (!running_) {
+            status->code = -1;
+            status->msg = "the procedure batcher is stopped";
+            return nullptr;
+        }
+        auto& batch = batches_[key];
+        if (!batch) {
+            auto row_batch = std::make_shared<SQLRequestRowBatch>(
+                row->GetSchema(), std::make_shared<ColumnIndicesSet>(row->GetSchema()));
+            batch = std::make_shared<ProcedureBatch>(db, sp_name, tablet, row_batch,
+                                                     ::baidu::common::timer::get_micros() + window_us_);
+            cv_.notify_one();
+        }
+        int32_t idx = batch->row_batch->Size();
+        if (!batch->row_batch->AddRow(row)) {
+            if (idx == 0) {
+                batches_.erase(key);
+            }
+            status->code = -1;
+            status->msg = "fail to add the row to the batch of procedure " + sp_name;
+            LOG(WARNING) << status->msg;
+            return nullptr;
+        }
+        batch->timeout_ms = std::max(batch->timeout_ms, timeout_ms);
+        future = std::make_shared<ProcedureBatchFuture>(batch, idx);
+        if (static_cast<uint32_t>(batch->row_batch->Size()) >= max_batch_size_) {
+            full_batch = std::move(batch);
+            batches_.erase(key);
+        }
+    }
+    if (full_batch) {
+        Send(full_batch);
+    }
+    return future;
+}
+
+void ProcedureBatcher::Run() {
+    std::vector<std::shared_ptr<ProcedureBatch>> ready;
+    std::unique_lock<std::mutex> lock(mu_);
+    while (running_) {
+        if (batches_.empty()) {
+            cv_.wait(lock);
+            continue;
+        }
+        uint64_t now = ::baidu::common::timer::get_micros();
+        uint64_t next_deadline = UINT64_MAX;
+        for (auto it = batches_.begin(); it != batches_.end();) {
+            if (it->second->deadline <= now) {
+                ready.push_back(std::move(it->second));
+                it = batches_.erase(it);
+            } else {
+                next_deadline = std::min(next_deadline, it->second->deadline);
+                ++it;
+            }
+        }
+        if (ready.empty()) {
+            cv_.wait_for(lock, std::chrono::microseconds(next_deadline - now));
+            continue;
+        }
+        lock.unlock();
+        for (const auto& batch : ready) {
+            Send(batch);
+        }
+        ready.clear();
+        lock.lock();
+    }
+    for (auto& kv : batches_) {
+        ready.push_back(std::move(kv.second));
+    }
+    batches_.clear();
+    lock.unlock();
+    for (const auto& batch : ready) {
+        Send(batch);
+    }
+}
+
+void ProcedureBatcher::Send(const std::shared_ptr<ProcedureBatch>& batch) {
+    auto callback = new openmldb::RpcCallback<openmldb::api::SQLBatchRequestQueryResponse>(
+        std::make_shared<openmldb::api::SQLBatchRequestQueryResponse>(), std::make_shared<brpc::Controller>());
+    // one reference is released by the rpc and the other one by the batch
+    callback->Ref();
+    if (batch->tablet->CallSQLBatchRequestProcedure(batch->db, batch->sp_name, batch->row_batch, is_debug_,
+                                                    batch->timeout_ms, callback)) {
+        batch->callback = callback;
+    } else {
+        LOG(WARNING) << "fail to send the batch of procedure " << batch->sp_name << " to "
+                     << batch->tablet->GetEndpoint();
+        callback->UnRef();
+        callback->UnRef();
+    }
+    batch->sent.CountDown();
+}
+
+}  // namespace sdk
+}  // namespace openmldb
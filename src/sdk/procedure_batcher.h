@@ -0,0 +1,74 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_SDK_PROCEDURE_BATCHER_H_
+#define SRC_SDK_PROCEDURE_BATCHER_H_
+
+#include <condition_variable>  // NOLINT
+#include <map>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <string>
+#include <thread>  // NOLINT
+
+#include "client/tablet_client.h"
+#include "sdk/sql_request_row.h"
+#include "sdk/sql_router.h"
+
+namespace openmldb {
+namespace sdk {
+
+struct ProcedureBatch;
+
+// ProcedureBatcher coalesces the CallProcedure requests of one procedure to one tablet made within
+// window_us into one CallSQLBatchRequestProcedure request, and every caller gets the row of its
+// request from the batch response
+class ProcedureBatcher {
+ public:
+    ProcedureBatcher(uint32_t window_us, uint32_t max_batch_size, bool is_debug);
+    ~ProcedureBatcher();
+
+    ProcedureBatcher(const ProcedureBatcher&) = delete;
+    ProcedureBatcher& operator=(const ProcedureBatcher&) = delete;
+
+    // the batches left are sent when the batcher stops
+    void Start();
+    void Stop();
+
+    std::shared_ptr<QueryFuture> CallProcedure(const std::string& db, const std::string& sp_name,
+                                               const std::shared_ptr<::openmldb::client::TabletClient>& tablet,
+                                               uint64_t timeout_ms, const std::shared_ptr<SQLRequestRow>& row,
+                                               ::hybridse::sdk::Status* status);
+
+ private:
+    void Run();
+    void Send(const std::shared_ptr<ProcedureBatch>& batch);
+
+ private:
+    uint32_t window_us_;
+    uint32_t max_batch_size_;
+    bool is_debug_;
+    // the batches in the window, keyed by the db, the procedure and the endpoint of the tablet
+    std::map<std::string, std::shared_ptr<ProcedureBatch>> batches_;
+    std::mutex mu_;
+    std::condition_variable cv_;
+    bool running_;
+    std::thread thread_;
+};
+
+}  // namespace sdk
+}  // namespace openmldb
+#endif  // SRC_SDK_PROCEDURE_BATCHER_H_
@@ -16,12 +16,18 @@
 
 #include "sdk/sql_cluster_router.h"
 
+#include <algorithm>
+#include <deque>
+#include <map>
 #include <memory>
 #include <string>
+#include <unordered_map>
 #include <utility>
+#include <vector>
 
 #include "boost/none.hpp"
 #include "brpc/channel.h"
+#include "codec/sql_rpc_row_codec.h"
 #include "common/timer.h"
 #include "glog/logging.h"
 #include "plan/plan_api.h"
@@ -31,6 +37,7 @@
 #include "sdk/base_impl.h"
 #include "sdk/batch_request_result_set_sql.h"
 #include "sdk/result_set_sql.h"
+#include "sdk/stream_result_set_sql.h"
 
 DECLARE_int32(request_timeout_ms);
 
@@ -104,6 +111,12 @@ class QueryFutureImpl : public QueryFuture {
             status->msg = "request error, " + callback_->GetResponse()->msg();
             return nullptr;
         }
+        if (!codec::UncompressResponseAttachment(callback_->GetResponse().get(),
+                                                 &callback_->GetController()->response_attachment())) {
+            status->code = hybridse::common::kRpcError;
+            status->msg = "request error, fail to uncompress the response";
+            return nullptr;
+        }
         auto rs = ResultSetSQL::MakeResultSet(callback_->GetResponse(), callback_->GetController(), status);
         return rs;
     }
@@ -147,6 +160,12 @@ class BatchQueryFutureImpl : public QueryFuture {
             status->msg = "request error. " + callback_->GetController()->ErrorText();
             return nullptr;
         }
+        if (!codec::UncompressResponseAttachment(callback_->GetResponse().get(),
+                                                 &callback_->GetController()->response_attachment())) {
+            status->code = hybridse::common::kRpcError;
+            status->msg = "request error, fail to uncompress the response";
+            return nullptr;
+        }
         std::shared_ptr<::openmldb::sdk::SQLBatchRequestResultSet> rs =
             std::make_shared<openmldb::sdk::SQLBatchRequestResultSet>(callback_->GetResponse(),
                                                                       callback_->GetController());
@@ -166,12 +185,29 @@ class BatchQueryFutureImpl : public QueryFuture {
 };
 
 SQLClusterRouter::SQLClusterRouter(const SQLRouterOptions& options)
-    : options_(options), cluster_sdk_(NULL), input_lru_cache_(), mu_(), rand_(::baidu::common::timer::now_time()) {}
-
-SQLClusterRouter::SQLClusterRouter(ClusterSDK* sdk)
-    : options_(), cluster_sdk_(sdk), input_lru_cache_(), mu_(), rand_(::baidu::common::timer::now_time()) {}
-
-SQLClusterRouter::~SQLClusterRouter() { delete cluster_sdk_; }
+    : options_(options),
+      cluster_sdk_(NULL),
+      input_lru_cache_(),
+      mu_(),
+      router_cache_(std::make_shared<RouterCacheMap>()),
+      router_mu_(),
+      rand_(::baidu::common::timer::now_time()) {}
+
+SQLClusterRouter::SQLClusterRouter(ClusterSDK* sdk) : SQLClusterRouter(SQLRouterOptions(), sdk) {}
+
+SQLClusterRouter::SQLClusterRouter(const SQLRouterOptions& options, ClusterSDK* sdk)
+    : options_(options),
+      cluster_sdk_(sdk),
+      input_lru_cache_(),
+      mu_(),
+      router_cache_(std::make_shared<RouterCacheMap>()),
+      router_mu_(),
+      rand_(::baidu::common::timer::now_time()) {}
+
+SQLClusterRouter::~SQLClusterRouter() {
+    procedure_batcher_.reset();
+    delete cluster_sdk_;
+}
 
 bool SQLClusterRouter::Init() {
     if (cluster_sdk_ == NULL) {
@@ -179,6 +215,18 @@ bool SQLClusterRouter::Init() {
         coptions.zk_cluster = options_.zk_cluster;
         coptions.zk_path = options_.zk_path;
         coptions.session_timeout = options_.session_timeout;
+        coptions.max_follower_lag = options_.max_follower_lag;
+        if (!::openmldb::catalog::ParseReadPolicy(options_.read_policy, &coptions.read_policy)) {
+            LOG(WARNING) << "invalid read policy " << options_.read_policy;
+            return false;
+        }
+        if (options_.connection_type != "single" && options_.connection_type != "pooled" &&
+            options_.connection_type != "short") {
+            LOG(WARNING) << "invalid connection type " << options_.connection_type;
+            return false;
+        }
+        coptions.connection_type = options_.connection_type;
+        coptions.channel_num = options_.channel_num;
         cluster_sdk_ = new ClusterSDK(coptions);
         bool ok = cluster_sdk_->Init();
         if (!ok) {
@@ -186,6 +234,11 @@ bool SQLClusterRouter::Init() {
             return false;
         }
     }
+    if (options_.procedure_batch_window_us > 0 && !procedure_batcher_) {
+        procedure_batcher_.reset(new ProcedureBatcher(options_.procedure_batch_window_us,
+                                                      options_.max_procedure_batch_size, options_.enable_debug));
+        procedure_batcher_->Start();
+    }
     return true;
 }
 
@@ -522,6 +575,22 @@ std::shared_ptr<SQLInsertRows> SQLClusterRouter::GetInsertRows(const std::string
     return std::make_shared<SQLInsertRows>(table_info, cache->column_schema, default_map, str_length);
 }
 
+std::shared_ptr<SQLCache> SQLClusterRouter::PrepareInsert(const std::string& db, const std::string& sql,
+                                                          ::hybridse::sdk::Status* status) {
+    if (status == NULL) return std::shared_ptr<SQLCache>();
+    std::shared_ptr<::openmldb::nameserver::TableInfo> table_info;
+    DefaultValueMap default_map;
+    uint32_t str_length = 0;
+    if (!GetInsertInfo(db, sql, status, &table_info, &default_map, &str_length)) {
+        status->code = 1;
+        return std::shared_ptr<SQLCache>();
+    }
+    status->code = 0;
+    auto cache = std::make_shared<SQLCache>(table_info, default_map, str_length);
+    SetCache(db, sql, cache);
+    return cache;
+}
+
 bool SQLClusterRouter::ExecuteDDL(const std::string& db, const std::string& sql, hybridse::sdk::Status* status) {
     auto ns_ptr = cluster_sdk_->GetNsClient();
     if (!ns_ptr) {
@@ -637,60 +706,25 @@ std::shared_ptr<::openmldb::client::TabletClient> SQLClusterRouter::GetTabletCli
 std::shared_ptr<::openmldb::client::TabletClient> SQLClusterRouter::GetTabletClient(
     const std::string& db, const std::string& sql, const std::shared_ptr<SQLRequestRow>& row,
     const std::shared_ptr<openmldb::sdk::SQLRequestRow>& parameter) {
-    ::hybridse::codec::Schema parameter_schema_raw;
-    if (parameter) {
-        for (int i = 0; i < parameter->GetSchema()->GetColumnCnt(); i++) {
-            auto column = parameter_schema_raw.Add();
-            hybridse::type::Type hybridse_type;
-            if (!openmldb::catalog::SchemaAdapter::ConvertType(parameter->GetSchema()->GetColumnType(i),
-                                                               &hybridse_type)) {
-                LOG(WARNING) << "Invalid parameter type ";
-                return std::shared_ptr<::openmldb::client::TabletClient>();
-            }
-            column->set_type(hybridse_type);
-        }
+    auto tablet = GetReadTablet(db, sql, row, parameter);
+    if (!tablet) {
+        return std::shared_ptr<::openmldb::client::TabletClient>();
     }
+    return tablet->GetClient();
+}
+
+std::shared_ptr<::openmldb::catalog::TabletAccessor> SQLClusterRouter::GetReadTablet(
+    const std::string& db, const std::string& sql, const std::shared_ptr<SQLRequestRow>& row,
+    const std::shared_ptr<openmldb::sdk::SQLRequestRow>& parameter) {
     std::shared_ptr<::openmldb::catalog::TabletAccessor> tablet;
-    auto cache = GetCache(db, sql);
-    auto parameter_schema = std::make_shared<::hybridse::sdk::SchemaImpl>(parameter_schema_raw);
-    if (cache && cache->IsCompatibleCache(parameter_schema)) {
-        cache = std::shared_ptr<SQLCache>();
-    }
-    if (!cache) {
-        ::hybridse::vm::ExplainOutput explain;
-        ::hybridse::base::Status vm_status;
-        if (cluster_sdk_->GetEngine()->Explain(sql, db, ::hybridse::vm::kBatchMode, parameter_schema_raw, &explain,
-                                               &vm_status)) {
-            std::shared_ptr<::hybridse::sdk::SchemaImpl> schema;
-            if (explain.input_schema.size() > 0) {
-                schema = std::make_shared<::hybridse::sdk::SchemaImpl>(explain.input_schema);
-            } else {
-                auto table_info = cluster_sdk_->GetTableInfo(db, explain.router.GetMainTable());
-                ::hybridse::codec::Schema raw_schema;
-                if (table_info &&
-                    ::openmldb::catalog::SchemaAdapter::ConvertSchema(table_info->column_desc(), &raw_schema)) {
-                    schema = std::make_shared<::hybridse::sdk::SchemaImpl>(raw_schema);
-                }
-            }
-            if (schema) {
-                cache = std::make_shared<SQLCache>(
-                    schema, parameter_schema, explain.router);
-                SetCache(db, sql, cache);
-            }
+    auto cache = GetRouterCache(db, sql, parameter);
+    if (cache && cache->table) {
+        std::string val;
+        if (!cache->router_col.empty() && row && row->GetRecordVal(cache->router_col, &val)) {
+            tablet = cluster_sdk_->GetReadTablet(cache->table, val);
         }
-    }
-    if (cache) {
-        const std::string& col = cache->router.GetRouterCol();
-        const std::string& main_table = cache->router.GetMainTable();
-        if (!main_table.empty()) {
-            DLOG(INFO) << "get main table" << main_table;
-            std::string val;
-            if (!col.empty() && row && row->GetRecordVal(col, &val)) {
-                tablet = cluster_sdk_->GetTablet(db, main_table, val);
-            }
-            if (!tablet) {
-                tablet = cluster_sdk_->GetTablet(db, main_table);
-            }
+        if (!tablet) {
+            tablet = cluster_sdk_->GetReadTablet(cache->table);
         }
     }
     if (!tablet) {
@@ -698,9 +732,65 @@ std::shared_ptr<::openmldb::client::TabletClient> SQLClusterRouter::GetTabletCli
     }
     if (!tablet) {
         LOG(WARNING) << "fail to get tablet";
-        return std::shared_ptr<::openmldb::client::TabletClient>();
     }
-    return tablet->GetClient();
+    return tablet;
+}
+
+std::shared_ptr<const RouterCache> SQLClusterRouter::GetRouterCache(
+    const std::string& db, const std::string& sql, const std::shared_ptr<SQLRequestRow>& parameter) {
+    std::vector<::hybridse::sdk::DataType> parameter_types;
+    if (parameter) {
+        for (int i = 0; i < parameter->GetSchema()->GetColumnCnt(); i++) {
+            parameter_types.push_back(parameter->GetSchema()->GetColumnType(i));
+        }
+    }
+    auto catalog = cluster_sdk_->GetCatalog();
+    auto caches = std::atomic_load_explicit(&router_cache_, std::memory_order_acquire);
+    auto db_it = caches->find(db);
+    if (db_it != caches->end()) {
+        auto it = db_it->second.find(sql);
+        // the routing is built again if the catalog is refreshed or the types of the parameters are changed
+        if (it != db_it->second.end() && it->second->catalog == catalog &&
+            it->second->parameter_types == parameter_types) {
+            return it->second;
+        }
+    }
+    ::hybridse::codec::Schema parameter_schema_raw;
+    for (auto type : parameter_types) {
+        hybridse::type::Type hybridse_type;
+        if (!openmldb::catalog::SchemaAdapter::ConvertType(type, &hybridse_type)) {
+            LOG(WARNING) << "Invalid parameter type ";
+            return std::shared_ptr<const RouterCache>();
+        }
+        parameter_schema_raw.Add()->set_type(hybridse_type);
+    }
+    ::hybridse::vm::ExplainOutput explain;
+    ::hybridse::base::Status vm_status;
+    if (!cluster_sdk_->GetEngine()->Explain(sql, db, ::hybridse::vm::kBatchMode, parameter_schema_raw, &explain,
+                                            &vm_status)) {
+        LOG(WARNING) << "fail to explain sql " << sql << " for " << vm_status.msg;
+        return std::shared_ptr<const RouterCache>();
+    }
+    auto cache = std::make_shared<RouterCache>();
+    cache->parameter_types = std::move(parameter_types);
+    cache->main_table = explain.router.GetMainTable();
+    cache->router_col = explain.router.GetRouterCol();
+    cache->catalog = catalog;
+    if (!cache->main_table.empty()) {
+        cache->table = std::dynamic_pointer_cast<::openmldb::catalog::SDKTableHandler>(
+            catalog->GetTable(db, cache->main_table));
+    }
+    std::lock_guard<::openmldb::base::SpinMutex> lock(router_mu_);
+    auto new_caches = std::make_shared<RouterCacheMap>(*std::atomic_load_explicit(&router_cache_,
+                                                                                   std::memory_order_acquire));
+    auto& db_caches = (*new_caches)[db];
+    if (db_caches.size() >= options_.max_sql_cache_size && db_caches.find(sql) == db_caches.end()) {
+        db_caches.clear();
+    }
+    db_caches[sql] = cache;
+    std::atomic_store_explicit(&router_cache_, std::shared_ptr<const RouterCacheMap>(std::move(new_caches)),
+                               std::memory_order_release);
+    return cache;
 }
 
 std::shared_ptr<TableReader> SQLClusterRouter::GetTableReader() {
@@ -711,6 +801,15 @@ std::shared_ptr<TableReader> SQLClusterRouter::GetTableReader() {
 std::shared_ptr<openmldb::client::TabletClient> SQLClusterRouter::GetTablet(const std::string& db,
                                                                             const std::string& sp_name,
                                                                             hybridse::sdk::Status* status) {
+    auto tablet = GetProcedureTablet(db, sp_name, status);
+    if (!tablet) {
+        return nullptr;
+    }
+    return tablet->GetClient();
+}
+
+std::shared_ptr<::openmldb::catalog::TabletAccessor> SQLClusterRouter::GetProcedureTablet(
+    const std::string& db, const std::string& sp_name, hybridse::sdk::Status* status) {
     if (status == nullptr) return nullptr;
     std::shared_ptr<hybridse::sdk::ProcedureInfo> sp_info = cluster_sdk_->GetProcedureInfo(db, sp_name, &status->msg);
     if (!sp_info) {
@@ -720,14 +819,32 @@ std::shared_ptr<openmldb::client::TabletClient> SQLClusterRouter::GetTablet(cons
         return nullptr;
     }
     const std::string& table = sp_info->GetMainTable();
-    auto tablet = cluster_sdk_->GetTablet(db, table);
+    auto tablet = cluster_sdk_->GetReadTablet(db, table);
     if (!tablet) {
         status->code = -1;
         status->msg = "fail to get tablet, table " + table;
         LOG(WARNING) << status->msg;
         return nullptr;
     }
-    return tablet->GetClient();
+    return tablet;
+}
+
+bool SQLClusterRouter::CanBatchProcedure(const std::string& db, const std::string& sp_name) {
+    if (!procedure_batcher_) {
+        return false;
+    }
+    std::string msg;
+    auto sp_info = cluster_sdk_->GetProcedureInfo(db, sp_name, &msg);
+    if (!sp_info) {
+        return false;
+    }
+    const auto& input_schema = sp_info->GetInputSchema();
+    for (int32_t i = 0; i < input_schema.GetColumnCnt(); i++) {
+        if (input_schema.IsConstant(i)) {
+            return false;
+        }
+    }
+    return true;
 }
 
 bool SQLClusterRouter::IsConstQuery(::hybridse::vm::PhysicalOpNode* node) {
@@ -776,11 +893,13 @@ std::shared_ptr<hybridse::sdk::ResultSet> SQLClusterRouter::ExecuteSQLRequest(co
     auto cntl = std::make_shared<::brpc::Controller>();
     cntl->set_timeout_ms(options_.request_timeout);
     auto response = std::make_shared<::openmldb::api::QueryResponse>();
-    auto client = GetTabletClient(db, sql, row);
+    auto tablet = GetReadTablet(db, sql, row, std::shared_ptr<SQLRequestRow>());
+    auto client = tablet ? tablet->GetClient() : nullptr;
     if (!client) {
         status->msg = "not tablet found";
         return std::shared_ptr<::hybridse::sdk::ResultSet>();
     }
+    ::openmldb::catalog::ReadStatsGuard read_guard(tablet);
     if (!client->Query(db, sql, row->GetRow(), cntl.get(), response.get(), options_.enable_debug)) {
         status->msg = "request server error, msg: " + response->msg();
         return std::shared_ptr<::hybridse::sdk::ResultSet>();
@@ -811,18 +930,34 @@ std::shared_ptr<::hybridse::sdk::ResultSet> SQLClusterRouter::ExecuteSQLParamete
         return std::shared_ptr<::hybridse::sdk::ResultSet>();
     }
 
-    auto client = GetTabletClient(db, sql, std::shared_ptr<SQLRequestRow>(), parameter);
+    auto tablet = GetReadTablet(db, sql, std::shared_ptr<SQLRequestRow>(), parameter);
+    auto client = tablet ? tablet->GetClient() : nullptr;
     if (!client) {
         DLOG(INFO) << "no tablet avilable for sql " << sql;
         return std::shared_ptr<::hybridse::sdk::ResultSet>();
     }
+    ::openmldb::catalog::ReadStatsGuard read_guard(tablet);
     DLOG(INFO) << " send query to tablet " << client->GetEndpoint();
+    std::shared_ptr<StreamRows> stream_rows;
+    if (options_.stream_chunk_size > 0) {
+        stream_rows = StreamRows::Create(options_.max_stream_buffer_size);
+        if (!stream_rows->CreateStream(cntl.get())) {
+            stream_rows.reset();
+        }
+    }
     if (!client->Query(db, sql, parameter_types, parameter ? parameter->GetRow() : "", cntl.get(), response.get(),
-                       options_.enable_debug)) {
+                       options_.enable_debug, stream_rows ? options_.stream_chunk_size : 0)) {
         status->msg = response->msg();
         status->code = -1;
         return std::shared_ptr<::hybridse::sdk::ResultSet>();
     }
+    if (stream_rows) {
+        if (response->stream()) {
+            return StreamResultSetSQL::MakeResultSet(response, stream_rows, status);
+        }
+        // the tablet does not support the stream and the rows are in the response
+        stream_rows->Close();
+    }
     auto rs = ResultSetSQL::MakeResultSet(response, cntl, status);
     return rs;
 }
@@ -837,12 +972,14 @@ std::shared_ptr<hybridse::sdk::ResultSet> SQLClusterRouter::ExecuteSQLBatchReque
     auto cntl = std::make_shared<::brpc::Controller>();
     cntl->set_timeout_ms(options_.request_timeout);
     auto response = std::make_shared<::openmldb::api::SQLBatchRequestQueryResponse>();
-    auto client = GetTabletClient(db, sql, std::shared_ptr<SQLRequestRow>(), std::shared_ptr<SQLRequestRow>());
+    auto tablet = GetReadTablet(db, sql, std::shared_ptr<SQLRequestRow>(), std::shared_ptr<SQLRequestRow>());
+    auto client = tablet ? tablet->GetClient() : nullptr;
     if (!client) {
         status->code = -1;
         status->msg = "no tablet found";
         return nullptr;
     }
+    ::openmldb::catalog::ReadStatsGuard read_guard(tablet);
     if (!client->SQLBatchRequestQuery(db, sql, row_batch, cntl.get(), response.get(), options_.enable_debug)) {
         status->code = -1;
         status->msg = "request server error " + response->msg();
@@ -862,6 +999,91 @@ std::shared_ptr<hybridse::sdk::ResultSet> SQLClusterRouter::ExecuteSQLBatchReque
     return rs;
 }
 
+std::shared_ptr<QueryFuture> SQLClusterRouter::ExecuteSQLRequestAsync(const std::string& db, const std::string& sql,
+                                                                     std::shared_ptr<SQLRequestRow> row,
+                                                                     hybridse::sdk::Status* status) {
+    if (!row || !status) {
+        LOG(WARNING) << "input is invalid";
+        return nullptr;
+    }
+    if (!row->OK()) {
+        status->code = -1;
+        status->msg = "make sure the request row is built before execute sql";
+        LOG(WARNING) << status->msg;
+        return nullptr;
+    }
+    auto client = GetTabletClient(db, sql, row);
+    if (!client) {
+        status->code = -1;
+        status->msg = "not tablet found";
+        return nullptr;
+    }
+    auto callback = new openmldb::RpcCallback<openmldb::api::QueryResponse>(
+        std::make_shared<openmldb::api::QueryResponse>(), std::make_shared<brpc::Controller>());
+    auto future = std::make_shared<QueryFutureImpl>(callback);
+    if (!client->Query(db, sql, row->GetRow(), options_.request_timeout, options_.enable_debug, callback)) {
+        status->code = -1;
+        status->msg = "request server error";
+        LOG(WARNING) << status->msg;
+        callback->UnRef();
+        return nullptr;
+    }
+    return future;
+}
+
+std::shared_ptr<QueryFuture> SQLClusterRouter::ExecuteSQLAsync(const std::string& db, const std::string& sql,
+                                                              hybridse::sdk::Status* status) {
+    if (!status) {
+        LOG(WARNING) << "input is invalid";
+        return nullptr;
+    }
+    auto client = GetTabletClient(db, sql, std::shared_ptr<SQLRequestRow>(), std::shared_ptr<SQLRequestRow>());
+    if (!client) {
+        status->code = -1;
+        status->msg = "no tablet avilable for sql " + sql;
+        return nullptr;
+    }
+    auto callback = new openmldb::RpcCallback<openmldb::api::QueryResponse>(
+        std::make_shared<openmldb::api::QueryResponse>(), std::make_shared<brpc::Controller>());
+    auto future = std::make_shared<QueryFutureImpl>(callback);
+    if (!client->Query(db, sql, std::vector<openmldb::type::DataType>(), "", options_.request_timeout,
+                       options_.enable_debug, callback)) {
+        status->code = -1;
+        status->msg = "request server error";
+        LOG(WARNING) << status->msg;
+        callback->UnRef();
+        return nullptr;
+    }
+    return future;
+}
+
+std::shared_ptr<QueryFuture> SQLClusterRouter::ExecuteSQLBatchRequestAsync(
+    const std::string& db, const std::string& sql, std::shared_ptr<SQLRequestRowBatch> row_batch,
+    hybridse::sdk::Status* status) {
+    if (!row_batch || !status) {
+        LOG(WARNING) << "input is invalid";
+        return nullptr;
+    }
+    auto client = GetTabletClient(db, sql, std::shared_ptr<SQLRequestRow>(), std::shared_ptr<SQLRequestRow>());
+    if (!client) {
+        status->code = -1;
+        status->msg = "no tablet found";
+        return nullptr;
+    }
+    auto callback = new openmldb::RpcCallback<openmldb::api::SQLBatchRequestQueryResponse>(
+        std::make_shared<openmldb::api::SQLBatchRequestQueryResponse>(), std::make_shared<brpc::Controller>());
+    auto future = std::make_shared<BatchQueryFutureImpl>(callback);
+    if (!client->SQLBatchRequestQuery(db, sql, row_batch, options_.request_timeout, options_.enable_debug,
+                                      callback)) {
+        status->code = -1;
+        status->msg = "request server error";
+        LOG(WARNING) << status->msg;
+        callback->UnRef();
+        return nullptr;
+    }
+    return future;
+}
+
 bool SQLClusterRouter::ExecuteInsert(const std::string& db, const std::string& sql, ::hybridse::sdk::Status* status) {
     if (status == NULL) return false;
     std::shared_ptr<::openmldb::nameserver::TableInfo> table_info;
@@ -942,34 +1164,255 @@ bool SQLClusterRouter::PutRow(uint32_t tid, const std::shared_ptr<SQLInsertRow>&
     return true;
 }
 
-bool SQLClusterRouter::ExecuteInsert(const std::string& db, const std::string& sql, std::shared_ptr<SQLInsertRows> rows,
-                                     hybridse::sdk::Status* status) {
-    if (!rows || !status) {
-        LOG(WARNING) << "input is invalid";
-        return false;
+// the rows put to a partition in one request, with the ts of the rows without ts column to
+// put them one by one to a tablet without PutBatch
+struct PutBatchContext {
+    uint32_t pid;
+    std::vector<std::pair<uint32_t, uint64_t>> rows;
+    openmldb::RpcCallback<openmldb::api::PutBatchResponse>* callback;
+};
+
+// put the rows grouped by partition. At most max_inflight batches are outstanding, so Send blocks only
+// when the tablets fall behind and Get waits for the batches left
+class PutRowsFuture : public InsertFuture {
+ public:
+    PutRowsFuture(uint32_t tid, const std::shared_ptr<SQLInsertRows>& rows,
+                  const std::vector<std::shared_ptr<::openmldb::catalog::TabletAccessor>>& tablets,
+                  uint32_t batch_size, uint32_t max_inflight, uint64_t timeout_ms)
+        : tid_(tid),
+          rows_(rows),
+          clients_(tablets.size()),
+          batch_size_(std::max(batch_size, 1u)),
+          max_inflight_(std::max(max_inflight, 1u)),
+          timeout_ms_(timeout_ms),
+          ok_(true) {
+        for (uint32_t pid = 0; pid < tablets.size(); pid++) {
+            if (tablets[pid]) {
+                clients_[pid] = tablets[pid]->GetClient();
+            }
+        }
     }
-    std::shared_ptr<SQLCache> cache = GetCache(db, sql);
-    if (cache) {
-        std::shared_ptr<::openmldb::nameserver::TableInfo> table_info = cache->table_info;
-        std::vector<std::shared_ptr<::openmldb::catalog::TabletAccessor>> tablets;
-        bool ret = cluster_sdk_->GetTablet(db, table_info->name(), &tablets);
-        if (!ret || tablets.empty()) {
-            status->msg = "fail to get table " + table_info->name() + " tablet";
-            LOG(WARNING) << status->msg;
-            return false;
+
+    // the rows of the batches outstanding are put before the future goes away
+    ~PutRowsFuture() { Wait(); }
+
+    bool Send();
+
+    bool Get(hybridse::sdk::Status* status) override {
+        Wait();
+        if (!ok_ && status) {
+            status->code = -1;
+            status->msg = msg_;
         }
-        for (uint32_t i = 0; i < rows->GetCnt(); ++i) {
-            std::shared_ptr<SQLInsertRow> row = rows->GetRow(i);
-            if (!PutRow(table_info->tid(), row, tablets, status)) {
+        return ok_;
+    }
+
+    // the rows of a tablet without PutBatch are still put one by one in Get
+    bool IsDone() const override {
+        for (const auto& context : inflight_) {
+            if (!context.callback->IsDone()) {
                 return false;
             }
         }
         return true;
+    }
+
+ private:
+    void Send(uint32_t pid);
+    void Wait(PutBatchContext* context);
+    void Wait() {
+        for (auto& context : inflight_) {
+            Wait(&context);
+        }
+        inflight_.clear();
+    }
+    void SetError(const std::string& msg) {
+        msg_ = msg;
+        LOG(WARNING) << msg_;
+        ok_ = false;
+    }
+
+ private:
+    uint32_t tid_;
+    std::shared_ptr<SQLInsertRows> rows_;
+    std::vector<std::shared_ptr<::openmldb::client::TabletClient>> clients_;
+    uint32_t batch_size_;
+    uint32_t max_inflight_;
+    uint64_t timeout_ms_;
+    std::map<uint32_t, ::openmldb::api::PutBatchRequest> requests_;
+    std::map<uint32_t, std::vector<std::pair<uint32_t, uint64_t>>> request_rows_;
+    std::deque<PutBatchContext> inflight_;
+    bool ok_;
+    std::string msg_;
+};
+
+void PutRowsFuture::Wait(PutBatchContext* context) {
+    auto callback = context->callback;
+    const auto& cntl = callback->GetController();
+    brpc::Join(cntl->call_id());
+    if (cntl->Failed() && cntl->ErrorCode() == brpc::ENOMETHOD) {
+        // the tablet is not upgraded yet
+        const auto& client = clients_[context->pid];
+        for (const auto& kv : context->rows) {
+            auto row = rows_->GetRow(kv.first);
+            const auto& dimensions = row->GetDimensions().at(context->pid);
+            bool ret = false;
+            if (row->GetTs().empty()) {
+                ret = client->Put(tid_, context->pid, kv.second, row->GetRow(), dimensions, 1);
+            } else {
+                ret = client->Put(tid_, context->pid, dimensions, row->GetTs(), row->GetRow(), 1);
+            }
+            if (!ret) {
+                SetError("fail to make a put request to table. tid " + std::to_string(tid_));
+                break;
+            }
+        }
+    } else if (cntl->Failed()) {
+        SetError("fail to make a put request to table. tid " + std::to_string(tid_) + " pid " +
+                 std::to_string(context->pid) + ", " + cntl->ErrorText());
+    } else if (callback->GetResponse()->code() != ::openmldb::base::kOk) {
+        SetError("fail to put rows to table. tid " + std::to_string(tid_) + " pid " + std::to_string(context->pid) +
+                 ", " + callback->GetResponse()->msg());
+    }
+    callback->UnRef();
+}
+
+void PutRowsFuture::Send(uint32_t pid) {
+    auto& request = requests_[pid];
+    if (request.rows_size() == 0) {
+        return;
+    }
+    while (inflight_.size() >= max_inflight_) {
+        Wait(&inflight_.front());
+        inflight_.pop_front();
+    }
+    if (!ok_) {
+        return;
+    }
+    auto callback = new openmldb::RpcCallback<openmldb::api::PutBatchResponse>(
+        std::make_shared<openmldb::api::PutBatchResponse>(), std::make_shared<brpc::Controller>());
+    // one reference is released by the rpc and the other one after wait
+    callback->Ref();
+    if (!clients_[pid]->AsyncPutBatch(request, timeout_ms_, callback)) {
+        SetError("fail to make a put request to table. tid " + std::to_string(tid_));
+        callback->UnRef();
+        callback->UnRef();
     } else {
+        inflight_.push_back({pid, std::move(request_rows_[pid]), callback});
+    }
+    request.clear_rows();
+    request_rows_[pid].clear();
+}
+
+bool PutRowsFuture::Send() {
+    for (uint32_t i = 0; i < rows_->GetCnt() && ok_; ++i) {
+        std::shared_ptr<SQLInsertRow> row = rows_->GetRow(i);
+        const auto& ts_dimensions = row->GetTs();
+        uint64_t cur_ts = 0;
+        if (ts_dimensions.empty()) {
+            cur_ts = ::baidu::common::timer::get_micros() / 1000;
+        }
+        for (const auto& kv : row->GetDimensions()) {
+            uint32_t pid = kv.first;
+            if (pid >= clients_.size() || !clients_[pid]) {
+                SetError("fail to get tablet client. pid " + std::to_string(pid));
+                break;
+            }
+            auto& request = requests_[pid];
+            if (request.rows_size() == 0) {
+                request.set_tid(tid_);
+                request.set_pid(pid);
+                request.set_format_version(1);
+            }
+            auto put = request.add_rows();
+            put->set_value(row->GetRow());
+            for (const auto& dimension : kv.second) {
+                auto d = put->add_dimensions();
+                d->set_key(dimension.first);
+                d->set_idx(dimension.second);
+            }
+            if (ts_dimensions.empty()) {
+                put->set_time(cur_ts);
+            } else {
+                for (size_t idx = 0; idx < ts_dimensions.size(); idx++) {
+                    auto d = put->add_ts_dimensions();
+                    d->set_ts(ts_dimensions[idx]);
+                    d->set_idx(idx);
+                }
+            }
+            request_rows_[pid].emplace_back(i, cur_ts);
+            if (static_cast<uint32_t>(request.rows_size()) >= batch_size_) {
+                Send(pid);
+            }
+        }
+    }
+    if (ok_) {
+        for (const auto& kv : requests_) {
+            Send(kv.first);
+        }
+    }
+    return ok_;
+}
+
+std::shared_ptr<PutRowsFuture> SQLClusterRouter::PutRows(const std::string& db, const std::string& sql,
+                                                         const std::shared_ptr<SQLInsertRows>& rows,
+                                                         hybridse::sdk::Status* status) {
+    std::shared_ptr<SQLCache> cache = GetCache(db, sql);
+    if (!cache) {
         status->msg = "please use getInsertRow with " + sql + " first";
         LOG(WARNING) << status->msg;
+        return nullptr;
+    }
+    return PutRows(db, cache->table_info, rows, status);
+}
+
+std::shared_ptr<PutRowsFuture> SQLClusterRouter::PutRows(
+    const std::string& db, const std::shared_ptr<::openmldb::nameserver::TableInfo>& table_info,
+    const std::shared_ptr<SQLInsertRows>& rows, hybridse::sdk::Status* status) {
+    std::vector<std::shared_ptr<::openmldb::catalog::TabletAccessor>> tablets;
+    bool ret = cluster_sdk_->GetTablet(db, table_info->name(), &tablets);
+    if (!ret || tablets.empty()) {
+        status->msg = "fail to get table " + table_info->name() + " tablet";
+        LOG(WARNING) << status->msg;
+        return nullptr;
+    }
+    auto future = std::make_shared<PutRowsFuture>(table_info->tid(), rows, tablets, options_.put_batch_size,
+                                                  options_.max_put_inflight, options_.request_timeout);
+    if (!future->Send()) {
+        future->Get(status);
+        return nullptr;
+    }
+    return future;
+}
+
+bool SQLClusterRouter::ExecuteInsert(const std::string& db, const std::string& sql, std::shared_ptr<SQLInsertRows> rows,
+                                     hybridse::sdk::Status* status) {
+    if (!rows || !status) {
+        LOG(WARNING) << "input is invalid";
+        return false;
+    }
+    auto future = PutRows(db, sql, rows, status);
+    return future && future->Get(status);
+}
+
+bool SQLClusterRouter::ExecuteInsert(const std::string& db, const SQLCache& insert_info,
+                                     std::shared_ptr<SQLInsertRows> rows, hybridse::sdk::Status* status) {
+    if (!rows || !status || !insert_info.table_info) {
+        LOG(WARNING) << "input is invalid";
         return false;
     }
+    auto future = PutRows(db, insert_info.table_info, rows, status);
+    return future && future->Get(status);
+}
+
+std::shared_ptr<InsertFuture> SQLClusterRouter::ExecuteInsertAsync(const std::string& db, const std::string& sql,
+                                                                   std::shared_ptr<SQLInsertRows> rows,
+                                                                   hybridse::sdk::Status* status) {
+    if (!rows || !status) {
+        LOG(WARNING) << "input is invalid";
+        return nullptr;
+    }
+    return PutRows(db, sql, rows, status);
 }
 
 bool SQLClusterRouter::ExecuteInsert(const std::string& db, const std::string& sql, std::shared_ptr<SQLInsertRow> row,
@@ -1013,6 +1456,25 @@ bool SQLClusterRouter::GetSQLPlan(const std::string& sql, ::hybridse::node::Node
 
 bool SQLClusterRouter::RefreshCatalog() { return cluster_sdk_->Refresh(); }
 
+std::vector<ConnectionStats> SQLClusterRouter::GetConnectionStats() {
+    std::vector<ConnectionStats> stats;
+    const std::string& connection_type = cluster_sdk_->GetOptions().connection_type;
+    for (const auto& tablet : cluster_sdk_->GetTabletAccessors()) {
+        ConnectionStats stat;
+        stat.endpoint = tablet->GetName();
+        auto client = tablet->GetClient();
+        if (client) {
+            stat.real_endpoint = client->GetRealEndpoint();
+        }
+        stat.connection_type = connection_type.empty() ? "single" : connection_type;
+        stat.channel_num = tablet->GetChannelNum();
+        stat.outstanding = tablet->GetOutstanding();
+        stat.latency_us = tablet->GetLatency();
+        stats.push_back(stat);
+    }
+    return stats;
+}
+
 std::shared_ptr<ExplainInfo> SQLClusterRouter::Explain(const std::string& db, const std::string& sql,
                                                        ::hybridse::sdk::Status* status) {
     ::hybridse::vm::ExplainOutput explain_output;
@@ -1048,11 +1510,18 @@ std::shared_ptr<hybridse::sdk::ResultSet> SQLClusterRouter::CallProcedure(const
         LOG(WARNING) << "make sure the request row is built before execute sql";
         return nullptr;
     }
-    auto tablet = GetTablet(db, sp_name, status);
+    auto accessor = GetProcedureTablet(db, sp_name, status);
+    auto tablet = accessor ? accessor->GetClient() : nullptr;
     if (!tablet) {
         return nullptr;
     }
+    if (CanBatchProcedure(db, sp_name)) {
+        auto future =
+            procedure_batcher_->CallProcedure(db, sp_name, tablet, options_.request_timeout, row, status);
+        return future ? future->GetResultSet(status) : nullptr;
+    }
 
+    ::openmldb::catalog::ReadStatsGuard read_guard(accessor);
     auto cntl = std::make_shared<::brpc::Controller>();
     auto response = std::make_shared<::openmldb::api::QueryResponse>();
     bool ok = tablet->CallProcedure(db, sp_name, row->GetRow(), cntl.get(), response.get(), options_.enable_debug,
@@ -1079,11 +1548,13 @@ std::shared_ptr<hybridse::sdk::ResultSet> SQLClusterRouter::CallSQLBatchRequestP
     if (!row_batch || !status) {
         return nullptr;
     }
-    auto tablet = GetTablet(db, sp_name, status);
+    auto accessor = GetProcedureTablet(db, sp_name, status);
+    auto tablet = accessor ? accessor->GetClient() : nullptr;
     if (!tablet) {
         return nullptr;
     }
 
+    ::openmldb::catalog::ReadStatsGuard read_guard(accessor);
     auto cntl = std::make_shared<::brpc::Controller>();
     auto response = std::make_shared<::openmldb::api::SQLBatchRequestQueryResponse>();
     bool ok = tablet->CallSQLBatchRequestProcedure(db, sp_name, row_batch, cntl.get(), response.get(),
@@ -1306,6 +1777,9 @@ std::shared_ptr<openmldb::sdk::QueryFuture> SQLClusterRouter::CallProcedure(cons
     if (!tablet) {
         return std::shared_ptr<openmldb::sdk::QueryFuture>();
     }
+    if (CanBatchProcedure(db, sp_name)) {
+        return procedure_batcher_->CallProcedure(db, sp_name, tablet, timeout_ms, row, status);
+    }
 
     std::shared_ptr<openmldb::api::QueryResponse> response = std::make_shared<openmldb::api::QueryResponse>();
     std::shared_ptr<brpc::Controller> cntl = std::make_shared<brpc::Controller>();
@@ -21,6 +21,7 @@
 #include <memory>
 #include <set>
 #include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -30,6 +31,7 @@
 #include "catalog/schema_adapter.h"
 #include "client/tablet_client.h"
 #include "sdk/cluster_sdk.h"
+#include "sdk/procedure_batcher.h"
 #include "sdk/sql_router.h"
 #include "sdk/table_reader_impl.h"
 
@@ -98,10 +100,28 @@ struct SQLCache {
     ::hybridse::vm::Router router;
 };
 
+// the routing of a query, which is not changed once it is published so that the callers read it without locks
+struct RouterCache {
+    std::vector<::hybridse::sdk::DataType> parameter_types;
+    std::string main_table;
+    std::string router_col;
+    // the handler of the main table in the catalog the routing is built on
+    std::shared_ptr<::openmldb::catalog::SDKCatalog> catalog;
+    std::shared_ptr<::openmldb::catalog::SDKTableHandler> table;
+};
+
+// the router caches keyed by the db and the sql
+using RouterCacheMap =
+    std::unordered_map<std::string, std::unordered_map<std::string, std::shared_ptr<const RouterCache>>>;
+
+class PutRowsFuture;
+
 class SQLClusterRouter : public SQLRouter {
  public:
     explicit SQLClusterRouter(const SQLRouterOptions& options);
     explicit SQLClusterRouter(ClusterSDK* sdk);
+    // the router takes the ownership of the sdk, the cluster options in options are not used
+    SQLClusterRouter(const SQLRouterOptions& options, ClusterSDK* sdk);
 
     ~SQLClusterRouter();
 
@@ -138,6 +158,15 @@ class SQLClusterRouter : public SQLRouter {
     std::shared_ptr<SQLInsertRows> GetInsertRows(const std::string& db, const std::string& sql,
                                                  ::hybridse::sdk::Status* status) override;
 
+    // parse the insert sql without looking up the sql cache, and cache the result. the callers can keep it
+    // to build and put the rows of the sql, even after it is evicted from the cache
+    std::shared_ptr<SQLCache> PrepareInsert(const std::string& db, const std::string& sql,
+                                            ::hybridse::sdk::Status* status);
+
+    // put the rows built from the insert info got by PrepareInsert
+    bool ExecuteInsert(const std::string& db, const SQLCache& insert_info, std::shared_ptr<SQLInsertRows> rows,
+                       hybridse::sdk::Status* status);
+
     std::shared_ptr<hybridse::sdk::ResultSet> ExecuteSQLRequest(const std::string& db, const std::string& sql,
                                                                 std::shared_ptr<SQLRequestRow> row,
                                                                 hybridse::sdk::Status* status) override;
@@ -152,8 +181,26 @@ class SQLClusterRouter : public SQLRouter {
                                                                      std::shared_ptr<SQLRequestRowBatch> row_batch,
                                                                      ::hybridse::sdk::Status* status) override;
 
+    // the async variants return once the request is sent, the result is got from the future
+    std::shared_ptr<QueryFuture> ExecuteSQLRequestAsync(const std::string& db, const std::string& sql,
+                                                        std::shared_ptr<SQLRequestRow> row,
+                                                        hybridse::sdk::Status* status) override;
+
+    std::shared_ptr<QueryFuture> ExecuteSQLAsync(const std::string& db, const std::string& sql,
+                                                 hybridse::sdk::Status* status) override;
+
+    std::shared_ptr<QueryFuture> ExecuteSQLBatchRequestAsync(const std::string& db, const std::string& sql,
+                                                             std::shared_ptr<SQLRequestRowBatch> row_batch,
+                                                             hybridse::sdk::Status* status) override;
+
+    std::shared_ptr<InsertFuture> ExecuteInsertAsync(const std::string& db, const std::string& sql,
+                                                     std::shared_ptr<SQLInsertRows> rows,
+                                                     hybridse::sdk::Status* status) override;
+
     bool RefreshCatalog() override;
 
+    std::vector<ConnectionStats> GetConnectionStats() override;
+
     std::shared_ptr<hybridse::sdk::ResultSet> CallProcedure(const std::string& db, const std::string& sp_name,
                                                             std::shared_ptr<SQLRequestRow> row,
                                                             hybridse::sdk::Status* status) override;
@@ -191,6 +238,18 @@ class SQLClusterRouter : public SQLRouter {
                 const std::vector<std::shared_ptr<::openmldb::catalog::TabletAccessor>>& tablets,
                 ::hybridse::sdk::Status* status);
 
+    // send the rows grouped by partition, the batches of the partitions are sent in parallel
+    std::shared_ptr<PutRowsFuture> PutRows(const std::string& db, const std::string& sql,
+                                           const std::shared_ptr<SQLInsertRows>& rows,
+                                           ::hybridse::sdk::Status* status);
+    std::shared_ptr<PutRowsFuture> PutRows(const std::string& db,
+                                           const std::shared_ptr<::openmldb::nameserver::TableInfo>& table_info,
+                                           const std::shared_ptr<SQLInsertRows>& rows,
+                                           ::hybridse::sdk::Status* status);
+
+    // the requests of a procedure with common columns can not be coalesced
+    bool CanBatchProcedure(const std::string& db, const std::string& sp_name);
+
     bool IsConstQuery(::hybridse::vm::PhysicalOpNode* node);
     std::shared_ptr<SQLCache> GetCache(const std::string& db, const std::string& sql);
 
@@ -220,14 +279,28 @@ class SQLClusterRouter : public SQLRouter {
 
     std::shared_ptr<openmldb::client::TabletClient> GetTablet(const std::string& db, const std::string& sp_name,
                                                               hybridse::sdk::Status* status);
+    // the replica of the main table of the procedure to read
+    std::shared_ptr<::openmldb::catalog::TabletAccessor> GetProcedureTablet(const std::string& db,
+                                                                            const std::string& sp_name,
+                                                                            hybridse::sdk::Status* status);
+    // the replica to run the sql by the read policy
+    std::shared_ptr<::openmldb::catalog::TabletAccessor> GetReadTablet(
+        const std::string& db, const std::string& sql, const std::shared_ptr<SQLRequestRow>& row,
+        const std::shared_ptr<SQLRequestRow>& parameter_row);
+    std::shared_ptr<const RouterCache> GetRouterCache(const std::string& db, const std::string& sql,
+                                                      const std::shared_ptr<SQLRequestRow>& parameter_row);
     bool ExtractDBTypes(const std::shared_ptr<hybridse::sdk::Schema> schema,
                                std::vector<openmldb::type::DataType>& parameter_types);  // NOLINT
 
  private:
     SQLRouterOptions options_;
     ClusterSDK* cluster_sdk_;
+    std::unique_ptr<ProcedureBatcher> procedure_batcher_;
     std::map<std::string, boost::compute::detail::lru_cache<std::string, std::shared_ptr<SQLCache>>> input_lru_cache_;
     ::openmldb::base::SpinMutex mu_;
+    // the snapshot of the router caches is replaced as a whole by the writers, which are serialized by router_mu_
+    std::shared_ptr<const RouterCacheMap> router_cache_;
+    ::openmldb::base::SpinMutex router_mu_;
     ::openmldb::base::Random rand_;
 };
 
@@ -17,7 +17,9 @@
 #include "sdk/sql_insert_row.h"
 
 #include <stdint.h>
+#include <string.h>
 
+#include <array>
 #include <string>
 
 #include "glog/logging.h"
@@ -40,6 +42,240 @@ std::shared_ptr<SQLInsertRow> SQLInsertRows::NewRow() {
     return row;
 }
 
+// the dimension of a value, the same as the one packed by SQLInsertRow::Append*
+static std::string DimensionValue(const ::openmldb::codec::ColumnBuffer& column, ::openmldb::type::DataType type,
+                                  uint32_t row) {
+    if (column.IsNull(row)) {
+        return hybridse::codec::NONETOKEN;
+    }
+    uint32_t pos = column.Index(row);
+    switch (type) {
+        case openmldb::type::kBool:
+            return reinterpret_cast<const uint8_t*>(column.values)[pos] ? "true" : "false";
+        case openmldb::type::kSmallInt:
+            return std::to_string(reinterpret_cast<const int16_t*>(column.values)[pos]);
+        case openmldb::type::kInt:
+        case openmldb::type::kDate:
+            return std::to_string(reinterpret_cast<const int32_t*>(column.values)[pos]);
+        case openmldb::type::kBigInt:
+        case openmldb::type::kTimestamp:
+            return std::to_string(reinterpret_cast<const int64_t*>(column.values)[pos]);
+        case openmldb::type::kVarchar:
+        case openmldb::type::kString: {
+            int32_t length = column.offsets[pos + 1] - column.offsets[pos];
+            if (length == 0) {
+                return hybridse::codec::EMPTY_STRING;
+            }
+            return std::string(column.data + column.offsets[pos], length);
+        }
+        default:
+            // the float columns are not packed as dimensions
+            return hybridse::codec::NONETOKEN;
+    }
+}
+
+bool SQLInsertRows::AppendColumns(const std::vector<::openmldb::codec::ColumnBuffer>& columns, uint32_t row_cnt,
+                                  hybridse::sdk::Status* status) {
+    if (status == NULL) {
+        return false;
+    }
+    if (!rows_.empty() && !rows_.back()->IsComplete()) {
+        status->code = -1;
+        status->msg = "the last row is not complete";
+        return false;
+    }
+    const auto& schema = table_info_->column_desc();
+    // the values in the sql are the repeated columns
+    std::vector<::openmldb::codec::ColumnBuffer> all_columns(schema.size());
+    std::vector<int64_t> const_values(schema.size(), 0);
+    std::vector<std::array<int32_t, 2>> const_offsets(schema.size());
+    uint8_t null_validity = 0;
+    uint32_t hole_pos = 0;
+    for (int idx = 0; idx < schema.size(); idx++) {
+        auto it = default_map_->find(idx);
+        if (it == default_map_->end()) {
+            if (hole_pos < columns.size()) {
+                all_columns[idx] = columns[hole_pos];
+            }
+            hole_pos++;
+            continue;
+        }
+        auto& column = all_columns[idx];
+        column.repeated = true;
+        if (it->second->IsNull()) {
+            column.validity = &null_validity;
+            continue;
+        }
+        void* value = &const_values[idx];
+        column.values = value;
+        switch (schema.Get(idx).data_type()) {
+            case openmldb::type::kBool:
+                *reinterpret_cast<uint8_t*>(value) = it->second->GetInt() ? 1 : 0;
+                break;
+            case openmldb::type::kSmallInt:
+                *reinterpret_cast<int16_t*>(value) = it->second->GetSmallInt();
+                break;
+            case openmldb::type::kInt:
+            case openmldb::type::kDate:
+                *reinterpret_cast<int32_t*>(value) = it->second->GetInt();
+                break;
+            case openmldb::type::kBigInt:
+            case openmldb::type::kTimestamp:
+                *reinterpret_cast<int64_t*>(value) = it->second->GetLong();
+                break;
+            case openmldb::type::kFloat:
+                *reinterpret_cast<float*>(value) = it->second->GetFloat();
+                break;
+            case openmldb::type::kDouble:
+                *reinterpret_cast<double*>(value) = it->second->GetDouble();
+                break;
+            case openmldb::type::kVarchar:
+            case openmldb::type::kString:
+                column.values = nullptr;
+                column.data = it->second->GetStr();
+                const_offsets[idx] = {0, static_cast<int32_t>(strlen(column.data))};
+                column.offsets = const_offsets[idx].data();
+                break;
+            default:
+                break;
+        }
+    }
+    if (hole_pos != columns.size()) {
+        status->code = -1;
+        status->msg = "column count mismatch, expect " + std::to_string(hole_pos) + " but " +
+                      std::to_string(columns.size());
+        return false;
+    }
+    auto prototype = std::make_shared<SQLInsertRow>(table_info_, schema_, default_map_, default_str_length_);
+    for (uint32_t idx : prototype->ts_set_) {
+        for (uint32_t i = 0; i < row_cnt; i++) {
+            if (all_columns[idx].IsNull(i)) {
+                status->code = -1;
+                status->msg = "ts column " + schema.Get(idx).name() + " can not be null";
+                return false;
+            }
+        }
+    }
+    if (!batch_builder_) {
+        batch_builder_.reset(new ::openmldb::codec::BatchRowBuilder(schema));
+    }
+    std::vector<std::string> encoded_rows;
+    if (!batch_builder_->Build(all_columns, row_cnt, &encoded_rows, &status->msg)) {
+        status->code = -1;
+        return false;
+    }
+    rows_.reserve(rows_.size() + row_cnt);
+    for (uint32_t i = 0; i < row_cnt; i++) {
+        // copy the index positions instead of building them from the table info for every row
+        auto row = std::make_shared<SQLInsertRow>(*prototype);
+        for (auto& kv : row->raw_dimensions_) {
+            kv.second = DimensionValue(all_columns[kv.first], schema.Get(kv.first).data_type(), i);
+        }
+        for (uint32_t idx : row->ts_set_) {
+            const auto& column = all_columns[idx];
+            row->ts_.push_back(reinterpret_cast<const int64_t*>(column.values)[column.Index(i)]);
+        }
+        row->SetEncodedRow(&encoded_rows[i]);
+        rows_.push_back(row);
+    }
+    status->code = 0;
+    return true;
+}
+
+void SQLInsertRows::AddColumn(const char* values, uint32_t values_size, const char* nulls, uint32_t nulls_size) {
+    added_columns_.push_back({values, values_size, nullptr, 0, nulls, nulls_size});
+}
+
+void SQLInsertRows::AddStringColumn(const char* values, uint32_t values_size, const char* offsets,
+                                    uint32_t offsets_size, const char* nulls, uint32_t nulls_size) {
+    added_columns_.push_back({values, values_size, offsets, offsets_size, nulls, nulls_size});
+}
+
+// the bytes of a value of the fixed length column, 0 for a string column
+static uint32_t ColumnWidth(::openmldb::type::DataType type) {
+    switch (type) {
+        case openmldb::type::kBool:
+            return 1;
+        case openmldb::type::kSmallInt:
+            return sizeof(int16_t);
+        case openmldb::type::kInt:
+        case openmldb::type::kDate:
+            return sizeof(int32_t);
+        case openmldb::type::kFloat:
+            return sizeof(float);
+        case openmldb::type::kBigInt:
+        case openmldb::type::kTimestamp:
+            return sizeof(int64_t);
+        case openmldb::type::kDouble:
+            return sizeof(double);
+        default:
+            return 0;
+    }
+}
+
+bool SQLInsertRows::AppendAddedColumns(uint32_t row_cnt, hybridse::sdk::Status* status) {
+    if (status == NULL) {
+        return false;
+    }
+    std::vector<AddedColumn> added;
+    added.swap(added_columns_);
+    const auto& schema = table_info_->column_desc();
+    std::vector<::openmldb::codec::ColumnBuffer> columns(added.size());
+    std::vector<std::vector<uint8_t>> validity(added.size());
+    uint32_t hole_pos = 0;
+    for (int idx = 0; idx < schema.size() && hole_pos < added.size(); idx++) {
+        if (default_map_->find(idx) != default_map_->end()) {
+            continue;
+        }
+        const auto& column = added[hole_pos];
+        auto& buf = columns[hole_pos];
+        const std::string& name = schema.Get(idx).name();
+        hole_pos++;
+        if (column.nulls_size > 0) {
+            if (column.nulls_size < row_cnt) {
+                status->code = -1;
+                status->msg = "the nulls of column " + name + " are less than the rows";
+                return false;
+            }
+            auto& bits = validity[hole_pos - 1];
+            bits.assign((row_cnt + 7) / 8, 0);
+            for (uint32_t i = 0; i < row_cnt; i++) {
+                if (!column.nulls[i]) {
+                    bits[i >> 3] |= 1 << (i & 0x07);
+                }
+            }
+            buf.validity = bits.data();
+        }
+        uint32_t width = ColumnWidth(schema.Get(idx).data_type());
+        if (width > 0) {
+            if (column.offsets != nullptr || static_cast<uint64_t>(width) * row_cnt > column.values_size) {
+                status->code = -1;
+                status->msg = "the values of column " + name + " do not match its type or the rows";
+                return false;
+            }
+            buf.values = column.values;
+            continue;
+        }
+        if (column.offsets == nullptr || (static_cast<uint64_t>(row_cnt) + 1) * sizeof(int32_t) > column.offsets_size) {
+            status->code = -1;
+            status->msg = "the offsets of string column " + name + " are less than the rows";
+            return false;
+        }
+        const int32_t* offsets = reinterpret_cast<const int32_t*>(column.offsets);
+        for (uint32_t i = 0; i < row_cnt; i++) {
+            if (offsets[i] < 0 || offsets[i] > offsets[i + 1] ||
+                static_cast<uint32_t>(offsets[i + 1]) > column.values_size) {
+                status->code = -1;
+                status->msg = "the offsets of string column " + name + " are out of the values";
+                return false;
+            }
+        }
+        buf.offsets = offsets;
+        buf.data = column.values;
+    }
+    return AppendColumns(columns, row_cnt, status);
+}
+
 SQLInsertRow::SQLInsertRow(std::shared_ptr<::openmldb::nameserver::TableInfo> table_info,
                            std::shared_ptr<hybridse::sdk::Schema> schema, DefaultValueMap default_map,
                            uint32_t default_string_length)
@@ -287,7 +523,13 @@ bool SQLInsertRow::AppendNULL() {
     return false;
 }
 
-bool SQLInsertRow::IsComplete() { return rb_.IsComplete(); }
+void SQLInsertRow::SetEncodedRow(std::string* row) {
+    val_.swap(*row);
+    str_size_ = 0;
+    encoded_ = true;
+}
+
+bool SQLInsertRow::IsComplete() { return encoded_ || rb_.IsComplete(); }
 
 bool SQLInsertRow::Build() { return str_size_ == 0; }
 
@@ -25,6 +25,7 @@
 #include <vector>
 
 #include "base/hash.h"
+#include "codec/batch_row_builder.h"
 #include "codec/codec.h"
 #include "codec/fe_row_codec.h"
 #include "node/sql_node.h"
@@ -98,6 +99,9 @@ class SQLInsertRow {
     bool AppendString(const char* string_buffer_var_name, uint32_t length);
 
  private:
+    friend class SQLInsertRows;
+    // take the row encoded by SQLInsertRows::AppendColumns, which packs the dimensions and ts
+    void SetEncodedRow(std::string* row);
     bool DateToString(uint32_t year, uint32_t month, uint32_t day, std::string* date);
     bool MakeDefault();
     bool PackTs(uint64_t ts);
@@ -117,6 +121,7 @@ class SQLInsertRow {
     ::openmldb::codec::RowBuilder rb_;
     std::string val_;
     uint32_t str_size_;
+    bool encoded_ = false;
 };
 
 class SQLInsertRows {
@@ -133,12 +138,40 @@ class SQLInsertRows {
         return rows_[i];
     }
 
+    // Append row_cnt rows of the column buffers in one pass, e.g. the arrays of an Arrow record batch.
+    // The columns are the placeholders of the insert sql in order, see SQLInsertRow::GetHoleIdx, and the
+    // other columns take the values in the sql. Nothing is appended if it fails
+    bool AppendColumns(const std::vector<::openmldb::codec::ColumnBuffer>& columns, uint32_t row_cnt,
+                       hybridse::sdk::Status* status);
+
+    // Add the buffers of the next placeholder column for AppendAddedColumns, e.g. the numpy arrays of a
+    // DataFrame. The values are packed as the ones of ResultSet::GetColumn, and nulls holds a byte per row which
+    // is 1 for a null, or it is empty if there is no null. The buffers must be alive until AppendAddedColumns
+    void AddColumn(const char* values, uint32_t values_size, const char* nulls, uint32_t nulls_size);
+    // the string of row i is values[offsets[i], offsets[i + 1]) of the int32 offsets
+    void AddStringColumn(const char* values, uint32_t values_size, const char* offsets, uint32_t offsets_size,
+                         const char* nulls, uint32_t nulls_size);
+    // Append row_cnt rows of the added columns by AppendColumns and clear them, the sizes of the buffers are
+    // checked against the types of the columns
+    bool AppendAddedColumns(uint32_t row_cnt, hybridse::sdk::Status* status);
+
  private:
+    struct AddedColumn {
+        const char* values;
+        uint32_t values_size;
+        const char* offsets;
+        uint32_t offsets_size;
+        const char* nulls;
+        uint32_t nulls_size;
+    };
+
     std::shared_ptr<::openmldb::nameserver::TableInfo> table_info_;
     std::shared_ptr<hybridse::sdk::Schema> schema_;
     DefaultValueMap default_map_;
     uint32_t default_str_length_;
     std::vector<std::shared_ptr<SQLInsertRow>> rows_;
+    std::unique_ptr<::openmldb::codec::BatchRowBuilder> batch_builder_;
+    std::vector<AddedColumn> added_columns_;
 };
 
 }  // namespace sdk
@@ -0,0 +1,185 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "sdk/sql_insert_row.h"
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "sdk/base_impl.h"
+
+namespace openmldb {
+namespace sdk {
+
+class SQLInsertRowTest : public ::testing::Test {};
+
+static std::shared_ptr<::openmldb::nameserver::TableInfo> NewTableInfo() {
+    auto table_info = std::make_shared<::openmldb::nameserver::TableInfo>();
+    table_info->set_name("t1");
+    auto add_column = [&table_info](const std::string& name, ::openmldb::type::DataType type) {
+        auto column = table_info->add_column_desc();
+        column->set_name(name);
+        column->set_data_type(type);
+    };
+    add_column("card", ::openmldb::type::kString);
+    add_column("ts", ::openmldb::type::kBigInt);
+    add_column("id", ::openmldb::type::kInt);
+    add_column("amt", ::openmldb::type::kDouble);
+    auto index = table_info->add_column_key();
+    index->set_index_name("index1");
+    index->add_col_name("card");
+    index->set_ts_name("ts");
+    index = table_info->add_column_key();
+    index->set_index_name("index2");
+    index->add_col_name("id");
+    index->set_ts_name("ts");
+    table_info->add_table_partition()->set_pid(0);
+    table_info->add_table_partition()->set_pid(1);
+    return table_info;
+}
+
+TEST_F(SQLInsertRowTest, AppendColumns) {
+    auto table_info = NewTableInfo();
+    ::hybridse::vm::Schema hybridse_schema;
+    std::shared_ptr<::hybridse::sdk::Schema> schema = std::make_shared<::hybridse::sdk::SchemaImpl>(hybridse_schema);
+    // insert into t1 values (?, ?, ?, 1.5);
+    DefaultValueMap default_map = std::make_shared<std::map<uint32_t, std::shared_ptr<::hybridse::node::ConstNode>>>();
+    default_map->emplace(3, std::make_shared<::hybridse::node::ConstNode>(1.5));
+
+    const uint32_t row_cnt = 100;
+    std::vector<std::string> cards;
+    std::string card_data;
+    std::vector<int32_t> card_offsets = {0};
+    std::vector<int64_t> tss;
+    std::vector<int32_t> ids;
+    std::vector<uint8_t> id_validity((row_cnt + 7) / 8, 0);
+    SQLInsertRows expect_rows(table_info, schema, default_map, 0);
+    for (uint32_t i = 0; i < row_cnt; i++) {
+        cards.push_back(i % 7 == 0 ? "" : "card" + std::to_string(i % 13));
+        card_data += cards.back();
+        card_offsets.push_back(card_data.size());
+        tss.push_back(1600000000000 + i);
+        ids.push_back(i % 3);
+        bool valid = i % 4 != 0;
+        if (valid) {
+            id_validity[i >> 3] |= 1 << (i & 0x07);
+        }
+        auto row = expect_rows.NewRow();
+        ASSERT_TRUE(row->Init(cards.back().size()));
+        ASSERT_TRUE(row->AppendString(cards.back()));
+        ASSERT_TRUE(row->AppendInt64(tss.back()));
+        ASSERT_TRUE(valid ? row->AppendInt32(ids.back()) : row->AppendNULL());
+        ASSERT_TRUE(row->Build());
+    }
+
+    std::vector<::openmldb::codec::ColumnBuffer> columns(3);
+    columns[0].offsets = card_offsets.data();
+    columns[0].data = card_data.data();
+    columns[1].values = tss.data();
+    columns[2].values = ids.data();
+    columns[2].validity = id_validity.data();
+    SQLInsertRows rows(table_info, schema, default_map, 0);
+    ::hybridse::sdk::Status status;
+    ASSERT_TRUE(rows.AppendColumns(columns, row_cnt, &status)) << status.msg;
+    ASSERT_EQ(row_cnt, rows.GetCnt());
+    for (uint32_t i = 0; i < row_cnt; i++) {
+        auto row = rows.GetRow(i);
+        auto expect_row = expect_rows.GetRow(i);
+        ASSERT_TRUE(row->IsComplete());
+        ASSERT_TRUE(row->Build());
+        ASSERT_EQ(expect_row->GetRow(), row->GetRow()) << "row " << i;
+        ASSERT_EQ(expect_row->GetTs(), row->GetTs());
+        ASSERT_EQ(expect_row->GetDimensions(), row->GetDimensions());
+    }
+    // a row can follow the batch
+    ASSERT_TRUE(rows.NewRow());
+
+    // the ts can not be null
+    std::vector<uint8_t> ts_validity((row_cnt + 7) / 8, 0xFF);
+    ts_validity[0] = 0xFE;
+    columns[1].validity = ts_validity.data();
+    SQLInsertRows invalid_rows(table_info, schema, default_map, 0);
+    ASSERT_FALSE(invalid_rows.AppendColumns(columns, row_cnt, &status));
+    ASSERT_EQ(0u, invalid_rows.GetCnt());
+    // the columns are the placeholders
+    columns.resize(4);
+    ASSERT_FALSE(invalid_rows.AppendColumns(columns, row_cnt, &status));
+}
+
+TEST_F(SQLInsertRowTest, AppendAddedColumns) {
+    auto table_info = NewTableInfo();
+    ::hybridse::vm::Schema hybridse_schema;
+    std::shared_ptr<::hybridse::sdk::Schema> schema = std::make_shared<::hybridse::sdk::SchemaImpl>(hybridse_schema);
+    // insert into t1 values (?, ?, ?, 1.5);
+    DefaultValueMap default_map = std::make_shared<std::map<uint32_t, std::shared_ptr<::hybridse::node::ConstNode>>>();
+    default_map->emplace(3, std::make_shared<::hybridse::node::ConstNode>(1.5));
+
+    std::string card_data = "abcd";
+    std::vector<int32_t> card_offsets = {0, 1, 1, 4};
+    std::vector<int64_t> tss = {3, 2, 1};
+    std::vector<int32_t> ids = {7, 0, 9};
+    std::vector<char> id_nulls = {0, 1, 0};
+    SQLInsertRows expect_rows(table_info, schema, default_map, 0);
+    for (uint32_t i = 0; i < tss.size(); i++) {
+        std::string card = card_data.substr(card_offsets[i], card_offsets[i + 1] - card_offsets[i]);
+        auto row = expect_rows.NewRow();
+        ASSERT_TRUE(row->Init(card.size()));
+        ASSERT_TRUE(row->AppendString(card));
+        ASSERT_TRUE(row->AppendInt64(tss[i]));
+        ASSERT_TRUE(id_nulls[i] ? row->AppendNULL() : row->AppendInt32(ids[i]));
+        ASSERT_TRUE(row->Build());
+    }
+
+    auto add_columns = [&](SQLInsertRows* rows, uint32_t ts_size) {
+        rows->AddStringColumn(card_data.data(), card_data.size(), reinterpret_cast<const char*>(card_offsets.data()),
+                              card_offsets.size() * sizeof(int32_t), nullptr, 0);
+        rows->AddColumn(reinterpret_cast<const char*>(tss.data()), ts_size, nullptr, 0);
+        rows->AddColumn(reinterpret_cast<const char*>(ids.data()), ids.size() * sizeof(int32_t), id_nulls.data(),
+                        id_nulls.size());
+    };
+    SQLInsertRows rows(table_info, schema, default_map, 0);
+    ::hybridse::sdk::Status status;
+    add_columns(&rows, tss.size() * sizeof(int64_t));
+    ASSERT_TRUE(rows.AppendAddedColumns(tss.size(), &status)) << status.msg;
+    ASSERT_EQ(tss.size(), rows.GetCnt());
+    for (uint32_t i = 0; i < tss.size(); i++) {
+        auto row = rows.GetRow(i);
+        auto expect_row = expect_rows.GetRow(i);
+        ASSERT_TRUE(row->Build());
+        ASSERT_EQ(expect_row->GetRow(), row->GetRow()) << "row " << i;
+        ASSERT_EQ(expect_row->GetDimensions(), row->GetDimensions());
+    }
+
+    // the buffers are checked against the rows
+    SQLInsertRows invalid_rows(table_info, schema, default_map, 0);
+    add_columns(&invalid_rows, sizeof(int64_t));
+    ASSERT_FALSE(invalid_rows.AppendAddedColumns(tss.size(), &status));
+    card_offsets[3] = 5;
+    add_columns(&invalid_rows, tss.size() * sizeof(int64_t));
+    ASSERT_FALSE(invalid_rows.AppendAddedColumns(tss.size(), &status));
+    ASSERT_EQ(0u, invalid_rows.GetCnt());
+}
+
+}  // namespace sdk
+}  // namespace openmldb
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
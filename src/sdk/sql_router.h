@@ -37,6 +37,40 @@ struct SQLRouterOptions {
     uint32_t session_timeout = 2000;
     uint32_t max_sql_cache_size = 10;
     uint32_t request_timeout = 60000;
+    // the max number of rows put to a partition in one request
+    uint32_t put_batch_size = 1000;
+    // the max number of put requests on the way at a time
+    uint32_t max_put_inflight = 8;
+    // the CallProcedure requests of a procedure to a tablet within the window are coalesced into one
+    // batch request, 0 disables it
+    uint32_t procedure_batch_window_us = 0;
+    // the max number of requests coalesced into one batch request
+    uint32_t max_procedure_batch_size = 64;
+    // the replica to read: leader, round_robin, least_outstanding or ewma_latency
+    std::string read_policy = "leader";
+    // the followers behind the leader more than the offsets are not read
+    uint64_t max_follower_lag = 10000;
+    // the connection type of the channels to the tablets: single, pooled or short. the requests with
+    // large responses do not block each other on pooled connections
+    std::string connection_type = "single";
+    // the number of the channels to a tablet, the requests are sent through them in turn
+    uint32_t channel_num = 1;
+    // the rows of ExecuteSQL are streamed from the tablet in the chunks of the bytes while they are read,
+    // 0 to get them all in the response
+    uint32_t stream_chunk_size = 0;
+    // the max bytes of the streamed rows not read yet, the tablet waits when they are reached
+    uint64_t max_stream_buffer_size = 16 * 1024 * 1024;
+};
+
+// the stats of the connections to a tablet
+struct ConnectionStats {
+    std::string endpoint;
+    std::string real_endpoint;
+    std::string connection_type;
+    uint32_t channel_num = 0;
+    // the reads on the way and the moving average of the latencies of the reads
+    int32_t outstanding = 0;
+    uint64_t latency_us = 0;
 };
 
 class ExplainInfo {
@@ -60,6 +94,16 @@ class QueryFuture {
     virtual bool IsDone() const = 0;
 };
 
+class InsertFuture {
+ public:
+    InsertFuture() {}
+    virtual ~InsertFuture() {}
+
+    // wait for all the rows to be put, return false if any of them fails
+    virtual bool Get(hybridse::sdk::Status* status) = 0;
+    virtual bool IsDone() const = 0;
+};
+
 class SQLRouter {
  public:
     SQLRouter() {}
@@ -112,6 +156,22 @@ class SQLRouter {
         const std::string& db, const std::string& sql, std::shared_ptr<openmldb::sdk::SQLRequestRowBatch> row_batch,
         ::hybridse::sdk::Status* status) = 0;
 
+    virtual std::shared_ptr<openmldb::sdk::QueryFuture> ExecuteSQLRequestAsync(
+        const std::string& db, const std::string& sql, std::shared_ptr<openmldb::sdk::SQLRequestRow> row,
+        hybridse::sdk::Status* status) = 0;
+
+    virtual std::shared_ptr<openmldb::sdk::QueryFuture> ExecuteSQLAsync(const std::string& db,
+                                                                        const std::string& sql,
+                                                                        hybridse::sdk::Status* status) = 0;
+
+    virtual std::shared_ptr<openmldb::sdk::QueryFuture> ExecuteSQLBatchRequestAsync(
+        const std::string& db, const std::string& sql, std::shared_ptr<openmldb::sdk::SQLRequestRowBatch> row_batch,
+        hybridse::sdk::Status* status) = 0;
+
+    virtual std::shared_ptr<openmldb::sdk::InsertFuture> ExecuteInsertAsync(
+        const std::string& db, const std::string& sql, std::shared_ptr<openmldb::sdk::SQLInsertRows> rows,
+        hybridse::sdk::Status* status) = 0;
+
     virtual bool RefreshCatalog() = 0;
 
     virtual std::shared_ptr<hybridse::sdk::ResultSet> CallProcedure(const std::string& db, const std::string& sp_name,
@@ -134,6 +194,8 @@ class SQLRouter {
     virtual std::shared_ptr<openmldb::sdk::QueryFuture> CallSQLBatchRequestProcedure(
         const std::string& db, const std::string& sp_name, int64_t timeout_ms,
         std::shared_ptr<openmldb::sdk::SQLRequestRowBatch> row_batch, hybridse::sdk::Status* status) = 0;
+
+    virtual std::vector<ConnectionStats> GetConnectionStats() = 0;
 };
 
 std::shared_ptr<SQLRouter> NewClusterSQLRouter(const SQLRouterOptions& options);
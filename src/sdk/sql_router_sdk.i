@@ -24,6 +24,42 @@
 #ifdef SWIGJAVA
 %include various.i
 %apply char *BYTE { char *string_buffer_var_name };
+
+// the column buffers of ResultSet::GetColumn and GetStringColumn, and of
+// SQLInsertRows::AddColumn and AddStringColumn are the direct
+// java.nio.ByteBuffer, which are read and written in place without a copy
+%typemap(jni) (char* buf, uint32_t buf_size) "jobject"
+%typemap(jtype) (char* buf, uint32_t buf_size) "java.nio.ByteBuffer"
+%typemap(jstype) (char* buf, uint32_t buf_size) "java.nio.ByteBuffer"
+%typemap(javain) (char* buf, uint32_t buf_size) "$javainput"
+%typemap(in) (char* buf, uint32_t buf_size) {
+    $1 = static_cast<char*>(jenv->GetDirectBufferAddress($input));
+    if ($1 == nullptr) {
+        SWIG_JavaThrowException(jenv, SWIG_JavaIllegalArgumentException,
+                                "the buffer must be a direct ByteBuffer");
+        return $null;
+    }
+    $2 = static_cast<uint32_t>(jenv->GetDirectBufferCapacity($input));
+}
+%apply (char* buf, uint32_t buf_size) {
+    (char* values, uint32_t values_size), (char* nulls, uint32_t nulls_size),
+    (char* offsets, uint32_t offsets_size),
+    (const char* values, uint32_t values_size), (const char* nulls, uint32_t nulls_size),
+    (const char* offsets, uint32_t offsets_size)
+};
+#endif
+
+#ifdef SWIGPYTHON
+// the column buffers of ResultSet::GetColumn and GetStringColumn are the
+// writable objects of the buffer protocol, e.g. the numpy arrays
+%include <pybuffer.i>
+%pybuffer_mutable_binary(char* values, uint32_t values_size);
+%pybuffer_mutable_binary(char* nulls, uint32_t nulls_size);
+%pybuffer_mutable_binary(char* offsets, uint32_t offsets_size);
+// and the column buffers of SQLInsertRows::AddColumn and AddStringColumn
+%pybuffer_binary(const char* values, uint32_t values_size);
+%pybuffer_binary(const char* nulls, uint32_t nulls_size);
+%pybuffer_binary(const char* offsets, uint32_t offsets_size);
 #endif
 
 %shared_ptr(hybridse::sdk::ResultSet);
@@ -38,6 +74,7 @@
 %shared_ptr(openmldb::sdk::ExplainInfo);
 %shared_ptr(hybridse::sdk::ProcedureInfo);
 %shared_ptr(openmldb::sdk::QueryFuture);
+%shared_ptr(openmldb::sdk::InsertFuture);
 %shared_ptr(openmldb::sdk::TableReader);
 %template(VectorUint32) std::vector<uint32_t>;
 %template(VectorString) std::vector<std::string>;
@@ -55,6 +92,7 @@ using hybridse::sdk::ColumnTypes;
 using hybridse::sdk::ResultSet;
 using openmldb::sdk::SQLRouter;
 using openmldb::sdk::SQLRouterOptions;
+using openmldb::sdk::ConnectionStats;
 using openmldb::sdk::SQLRequestRow;
 using openmldb::sdk::SQLRequestRowBatch;
 using openmldb::sdk::ColumnIndicesSet;
@@ -63,10 +101,12 @@ using openmldb::sdk::SQLInsertRows;
 using openmldb::sdk::ExplainInfo;
 using hybridse::sdk::ProcedureInfo;
 using openmldb::sdk::QueryFuture;
+using openmldb::sdk::InsertFuture;
 using openmldb::sdk::TableReader;
 %}
 
 %include "sdk/sql_router.h"
+%template(VectorConnectionStats) std::vector<openmldb::sdk::ConnectionStats>;
 %include "sdk/base.h"
 %include "sdk/result_set.h"
 %include "sdk/sql_request_row.h"
@@ -859,6 +859,133 @@ TEST_F(SQLRouterTest, smoketest_on_sql) {
     ASSERT_TRUE(ok);
 }
 
+TEST_F(SQLRouterTest, smoketest_async_on_sql) {
+    SQLRouterOptions sql_opt;
+    sql_opt.zk_cluster = mc_->GetZkCluster();
+    sql_opt.zk_path = mc_->GetZkPath();
+    sql_opt.enable_debug = hybridse::sqlcase::SqlCase::IsDebug();
+    auto router = NewClusterSQLRouter(sql_opt);
+    ASSERT_TRUE(router != nullptr);
+    std::string name = "test" + GenRand();
+    std::string db = "db" + GenRand();
+    ::hybridse::sdk::Status status;
+    ASSERT_TRUE(router->CreateDB(db, &status));
+    std::string ddl = "create table " + name +
+                      "("
+                      "col1 string, col2 bigint,"
+                      "index(key=col1, ts=col2));";
+    ASSERT_TRUE(router->ExecuteDDL(db, ddl, &status));
+    ASSERT_TRUE(router->RefreshCatalog());
+    std::string insert = "insert into " + name + " values(?, ?);";
+    auto insert_rows = router->GetInsertRows(db, insert, &status);
+    ASSERT_TRUE(insert_rows != nullptr);
+    for (int64_t i = 0; i < 10; i++) {
+        auto row = insert_rows->NewRow();
+        ASSERT_TRUE(row->Init(5));
+        ASSERT_TRUE(row->AppendString("hello"));
+        ASSERT_TRUE(row->AppendInt64(1590 + i));
+        ASSERT_TRUE(row->Build());
+    }
+    auto insert_future = router->ExecuteInsertAsync(db, insert, insert_rows, &status);
+    ASSERT_TRUE(insert_future != nullptr) << status.msg;
+    ASSERT_TRUE(insert_future->Get(&status)) << status.msg;
+    ASSERT_TRUE(insert_future->IsDone());
+
+    std::string sql_select = "select col1 from " + name + " ;";
+    auto future = router->ExecuteSQLAsync(db, sql_select, &status);
+    ASSERT_TRUE(future != nullptr);
+    auto rs = future->GetResultSet(&status);
+    ASSERT_TRUE(rs != nullptr) << status.msg;
+    ASSERT_EQ(10, rs->Size());
+    ASSERT_TRUE(rs->Next());
+    ASSERT_EQ("hello", rs->GetStringUnsafe(0));
+
+    std::string sql_window_request = "select sum(col2) over w as sum_col2 from " + name +
+                                     " window w as (partition by " + name + ".col1 order by " + name +
+                                     ".col2 ROWS BETWEEN 3 PRECEDING AND CURRENT ROW);";
+    std::shared_ptr<SQLRequestRow> row = router->GetRequestRow(db, sql_window_request, &status);
+    ASSERT_TRUE(row != nullptr);
+    ASSERT_TRUE(row->Init(5));
+    ASSERT_TRUE(row->AppendString("hello"));
+    ASSERT_TRUE(row->AppendInt64(1700));
+    ASSERT_TRUE(row->Build());
+    future = router->ExecuteSQLRequestAsync(db, sql_window_request, row, &status);
+    ASSERT_TRUE(future != nullptr);
+    rs = future->GetResultSet(&status);
+    ASSERT_TRUE(rs != nullptr) << status.msg;
+    ASSERT_EQ(1, rs->Size());
+    ASSERT_TRUE(rs->Next());
+    ASSERT_EQ(1700 + 1599 + 1598 + 1597, rs->GetInt64Unsafe(0));
+
+    auto row_batch = std::make_shared<SQLRequestRowBatch>(
+        row->GetSchema(), std::make_shared<ColumnIndicesSet>(row->GetSchema()));
+    ASSERT_TRUE(row_batch->AddRow(row));
+    ASSERT_TRUE(row_batch->AddRow(row));
+    future = router->ExecuteSQLBatchRequestAsync(db, sql_window_request, row_batch, &status);
+    ASSERT_TRUE(future != nullptr);
+    rs = future->GetResultSet(&status);
+    ASSERT_TRUE(rs != nullptr) << status.msg;
+    ASSERT_EQ(2, rs->Size());
+
+    ASSERT_TRUE(router->ExecuteDDL(db, "drop table " + name + ";", &status));
+    ASSERT_TRUE(router->DropDB(db, &status));
+}
+
+TEST_F(SQLRouterTest, smoketest_stream_on_sql) {
+    SQLRouterOptions sql_opt;
+    sql_opt.zk_cluster = mc_->GetZkCluster();
+    sql_opt.zk_path = mc_->GetZkPath();
+    sql_opt.enable_debug = hybridse::sqlcase::SqlCase::IsDebug();
+    // a few rows in a chunk and a buffer of a few chunks
+    sql_opt.stream_chunk_size = 64;
+    sql_opt.max_stream_buffer_size = 256;
+    auto router = NewClusterSQLRouter(sql_opt);
+    ASSERT_TRUE(router != nullptr);
+    std::string name = "test" + GenRand();
+    std::string db = "db" + GenRand();
+    ::hybridse::sdk::Status status;
+    ASSERT_TRUE(router->CreateDB(db, &status));
+    std::string ddl = "create table " + name +
+                      "("
+                      "col1 string, col2 bigint,"
+                      "index(key=col1, ts=col2));";
+    ASSERT_TRUE(router->ExecuteDDL(db, ddl, &status));
+    ASSERT_TRUE(router->RefreshCatalog());
+    std::string insert = "insert into " + name + " values(?, ?);";
+    auto insert_rows = router->GetInsertRows(db, insert, &status);
+    ASSERT_TRUE(insert_rows != nullptr);
+    for (int64_t i = 0; i < 1000; i++) {
+        auto row = insert_rows->NewRow();
+        ASSERT_TRUE(row->Init(5));
+        ASSERT_TRUE(row->AppendString("hello"));
+        ASSERT_TRUE(row->AppendInt64(i));
+        ASSERT_TRUE(row->Build());
+    }
+    ASSERT_TRUE(router->ExecuteInsert(db, insert, insert_rows, &status)) << status.msg;
+
+    auto rs = router->ExecuteSQL(db, "select col1, col2 from " + name + " ;", &status);
+    ASSERT_TRUE(rs != nullptr) << status.msg;
+    ASSERT_EQ(1000, rs->Size());
+    int64_t sum = 0;
+    int32_t cnt = 0;
+    while (rs->Next()) {
+        ASSERT_EQ("hello", rs->GetStringUnsafe(0));
+        sum += rs->GetInt64Unsafe(1);
+        cnt++;
+    }
+    ASSERT_EQ(1000, cnt);
+    ASSERT_EQ(999 * 1000 / 2, sum);
+
+    // the rows left are dropped with the result set
+    rs = router->ExecuteSQL(db, "select col1, col2 from " + name + " ;", &status);
+    ASSERT_TRUE(rs != nullptr) << status.msg;
+    ASSERT_TRUE(rs->Next());
+    rs.reset();
+
+    ASSERT_TRUE(router->ExecuteDDL(db, "drop table " + name + ";", &status));
+    ASSERT_TRUE(router->DropDB(db, &status));
+}
+
 TEST_F(SQLRouterTest, smoke_explain_on_sql) {
     SQLRouterOptions sql_opt;
     sql_opt.zk_cluster = mc_->GetZkCluster();
@@ -965,6 +1092,68 @@ TEST_F(SQLRouterTest, smoketimestamptest_on_sql) {
     ASSERT_TRUE(ok);
 }
 
+TEST_F(SQLRouterTest, result_set_read_column) {
+    SQLRouterOptions sql_opt;
+    sql_opt.zk_cluster = mc_->GetZkCluster();
+    sql_opt.zk_path = mc_->GetZkPath();
+    auto router = NewClusterSQLRouter(sql_opt);
+    ASSERT_TRUE(router != nullptr);
+    std::string name = "test" + GenRand();
+    std::string db = "db" + GenRand();
+    ::hybridse::sdk::Status status;
+    bool ok = router->CreateDB(db, &status);
+    ASSERT_TRUE(ok);
+    std::string ddl = "create table " + name +
+                      "("
+                      "col1 string, col2 bigint, col3 double, col4 string,"
+                      "index(key=col1, ts=col2));";
+    ok = router->ExecuteDDL(db, ddl, &status);
+    ASSERT_TRUE(ok);
+    ASSERT_TRUE(router->RefreshCatalog());
+    ASSERT_TRUE(router->ExecuteInsert(db, "insert into " + name + " values('k', 1, 1.5, 'a');", &status));
+    ASSERT_TRUE(router->ExecuteInsert(db, "insert into " + name + " values('k', 2, null, null);", &status));
+    ASSERT_TRUE(router->ExecuteInsert(db, "insert into " + name + " values('k', 3, 3.5, 'bcd');", &status));
+    auto rs = router->ExecuteSQL(db, "select col2, col3, col4 from " + name + ";", &status);
+    ASSERT_TRUE(rs != nullptr);
+    ASSERT_EQ(3, rs->Size());
+
+    // the rows are in the order of the ts desc
+    std::vector<int64_t> col2(3);
+    std::vector<double> col3(3);
+    std::vector<char> nulls(3);
+    ASSERT_EQ(3, rs->GetColumn(0, reinterpret_cast<char*>(col2.data()), col2.size() * sizeof(int64_t), nulls.data(),
+                               nulls.size()));
+    ASSERT_EQ((std::vector<int64_t>{3, 2, 1}), col2);
+    ASSERT_EQ((std::vector<char>{0, 0, 0}), nulls);
+    ASSERT_EQ(3, rs->GetColumn(1, reinterpret_cast<char*>(col3.data()), col3.size() * sizeof(double), nulls.data(),
+                               nulls.size()));
+    ASSERT_EQ((std::vector<double>{3.5, 0, 1.5}), col3);
+    ASSERT_EQ((std::vector<char>{0, 1, 0}), nulls);
+    // a string column or a short buffer is refused
+    ASSERT_EQ(-1, rs->GetColumn(2, reinterpret_cast<char*>(col3.data()), col3.size() * sizeof(double), nulls.data(),
+                                nulls.size()));
+    ASSERT_EQ(-1, rs->GetColumn(0, reinterpret_cast<char*>(col2.data()), sizeof(int64_t), nulls.data(),
+                                nulls.size()));
+
+    ASSERT_EQ(4, rs->GetStringColumnSize(2));
+    std::vector<char> values(4);
+    std::vector<int32_t> offsets(4);
+    ASSERT_EQ(3, rs->GetStringColumn(2, values.data(), values.size(), reinterpret_cast<char*>(offsets.data()),
+                                     offsets.size() * sizeof(int32_t), nulls.data(), nulls.size()));
+    ASSERT_EQ("bcda", std::string(values.data(), values.size()));
+    ASSERT_EQ((std::vector<int32_t>{0, 3, 3, 4}), offsets);
+    ASSERT_EQ((std::vector<char>{0, 1, 0}), nulls);
+
+    // the cursor is reset after the column reads
+    ASSERT_TRUE(rs->Next());
+    ASSERT_EQ(3, rs->GetInt64Unsafe(0));
+
+    ok = router->ExecuteDDL(db, "drop table " + name + ";", &status);
+    ASSERT_TRUE(ok);
+    ok = router->DropDB(db, &status);
+    ASSERT_TRUE(ok);
+}
+
 TEST_F(SQLRouterTest, smoketest_on_muti_partitions) {
     SQLRouterOptions sql_opt;
     sql_opt.zk_cluster = mc_->GetZkCluster();
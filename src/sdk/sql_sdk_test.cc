@@ -499,6 +499,79 @@ TEST_F(SQLSDKQueryTest, request_procedure_test) {
     ASSERT_TRUE(router->ExecuteDDL(db, "drop table trans;", &status));
 }
 
+TEST_F(SQLSDKQueryTest, request_procedure_coalesce_test) {
+    std::string ddl =
+        "create table trans(c1 string,\n"
+        "                   c4 bigint,\n"
+        "                   c7 timestamp,\n"
+        "                   index(key=c1, ts=c7));";
+    SQLRouterOptions sql_opt;
+    sql_opt.zk_cluster = mc_->GetZkCluster();
+    sql_opt.zk_path = mc_->GetZkPath();
+    sql_opt.session_timeout = 30000;
+    sql_opt.enable_debug = hybridse::sqlcase::SqlCase::IsDebug();
+    sql_opt.procedure_batch_window_us = 10000;
+    sql_opt.max_procedure_batch_size = 4;
+    auto router = NewClusterSQLRouter(sql_opt);
+    if (!router) {
+        FAIL() << "Fail new cluster sql router";
+    }
+    std::string db = "test";
+    hybridse::sdk::Status status;
+    router->CreateDB(db, &status);
+    router->ExecuteDDL(db, "drop table trans;", &status);
+    ASSERT_TRUE(router->RefreshCatalog());
+    ASSERT_TRUE(router->ExecuteDDL(db, ddl, &status)) << status.msg;
+    ASSERT_TRUE(router->RefreshCatalog());
+    ASSERT_TRUE(router->ExecuteInsert(db, "insert into trans values(\"bb\",24,1590738994000);", &status));
+    std::string sp_name = "sp";
+    std::string sql =
+        "SELECT c1, sum(c4) OVER w1 as w1_c4_sum FROM trans WINDOW w1 AS"
+        " (PARTITION BY trans.c1 ORDER BY trans.c7 ROWS BETWEEN 2 PRECEDING AND CURRENT ROW);";
+    std::string sp_ddl = "create procedure " + sp_name + " (c1 string, c4 bigint, c7 timestamp) begin " + sql + " end;";
+    ASSERT_TRUE(router->ExecuteDDL(db, sp_ddl, &status)) << status.msg;
+    ASSERT_TRUE(router->RefreshCatalog());
+
+    // the requests are coalesced into the batches of at most 4 rows, every future gets its own row
+    std::vector<std::shared_ptr<QueryFuture>> futures;
+    for (int64_t i = 0; i < 10; i++) {
+        auto request_row = router->GetRequestRowByProcedure(db, sp_name, &status);
+        ASSERT_TRUE(request_row);
+        request_row->Init(2);
+        ASSERT_TRUE(request_row->AppendString("bb"));
+        ASSERT_TRUE(request_row->AppendInt64(i));
+        ASSERT_TRUE(request_row->AppendTimestamp(1590738994000 + i));
+        ASSERT_TRUE(request_row->Build());
+        auto future = router->CallProcedure(db, sp_name, 1000, request_row, &status);
+        ASSERT_TRUE(future) << status.msg;
+        futures.push_back(future);
+    }
+    for (int64_t i = 0; i < 10; i++) {
+        auto rs = futures[i]->GetResultSet(&status);
+        ASSERT_TRUE(rs) << status.msg;
+        ASSERT_TRUE(futures[i]->IsDone());
+        ASSERT_EQ(1, rs->Size());
+        ASSERT_TRUE(rs->Next());
+        ASSERT_EQ(rs->GetStringUnsafe(0), "bb");
+        ASSERT_EQ(rs->GetInt64Unsafe(1), 24 + i);
+        ASSERT_FALSE(rs->Next());
+    }
+    auto request_row = router->GetRequestRowByProcedure(db, sp_name, &status);
+    ASSERT_TRUE(request_row);
+    request_row->Init(2);
+    ASSERT_TRUE(request_row->AppendString("bb"));
+    ASSERT_TRUE(request_row->AppendInt64(100));
+    ASSERT_TRUE(request_row->AppendTimestamp(1590738995000));
+    ASSERT_TRUE(request_row->Build());
+    auto rs = router->CallProcedure(db, sp_name, request_row, &status);
+    ASSERT_TRUE(rs) << status.msg;
+    ASSERT_TRUE(rs->Next());
+    ASSERT_EQ(rs->GetInt64Unsafe(1), 124);
+
+    ASSERT_TRUE(router->ExecuteDDL(db, "drop procedure " + sp_name + ";", &status));
+    ASSERT_TRUE(router->ExecuteDDL(db, "drop table trans;", &status));
+}
+
 TEST_F(SQLSDKTest, table_reader_scan) {
     SQLRouterOptions sql_opt;
     sql_opt.zk_cluster = mc_->GetZkCluster();
@@ -0,0 +1,172 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "sdk/stream_result_set_sql.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "codec/fe_schema_codec.h"
+#include "glog/logging.h"
+#include "sdk/codec_sdk.h"
+
+namespace openmldb {
+namespace sdk {
+
+StreamRows::StreamRows(uint64_t max_bytes)
+    : max_bytes_(max_bytes),
+      stream_(brpc::INVALID_STREAM_ID),
+      mu_(),
+      cv_(),
+      chunks_(),
+      bytes_(0),
+      closed_(false),
+      dropped_(false),
+      self_() {}
+
+std::shared_ptr<StreamRows> StreamRows::Create(uint64_t max_bytes) {
+    return std::shared_ptr<StreamRows>(new StreamRows(max_bytes));
+}
+
+bool StreamRows::CreateStream(brpc::Controller* cntl) {
+    brpc::StreamOptions options;
+    options.handler = this;
+    options.max_buf_size = static_cast<int>(std::min(max_bytes_, static_cast<uint64_t>(INT32_MAX)));
+    std::lock_guard<bthread::Mutex> lock(mu_);
+    if (brpc::StreamCreate(&stream_, *cntl, &options) != 0) {
+        LOG(WARNING) << "fail to create the stream of the query";
+        stream_ = brpc::INVALID_STREAM_ID;
+        closed_ = true;
+        return false;
+    }
+    self_ = shared_from_this();
+    return true;
+}
+
+bool StreamRows::Pop(butil::IOBuf* chunk) {
+    std::unique_lock<bthread::Mutex> lock(mu_);
+    while (chunks_.empty() && !closed_) {
+        cv_.wait(lock);
+    }
+    if (chunks_.empty()) {
+        return false;
+    }
+    chunk->swap(chunks_.front());
+    chunks_.pop_front();
+    bytes_ -= chunk->size();
+    cv_.notify_all();
+    return true;
+}
+
+void StreamRows::Close() {
+    brpc::StreamId stream = brpc::INVALID_STREAM_ID;
+    {
+        std::lock_guard<bthread::Mutex> lock(mu_);
+        dropped_ = true;
+        chunks_.clear();
+        bytes_ = 0;
+        stream = stream_;
+        cv_.notify_all();
+    }
+    if (stream != brpc::INVALID_STREAM_ID) {
+        brpc::StreamClose(stream);
+    }
+}
+
+int StreamRows::on_received_messages(brpc::StreamId id, butil::IOBuf* const messages[], size_t size) {
+    std::unique_lock<bthread::Mutex> lock(mu_);
+    if (dropped_) {
+        return 0;
+    }
+    for (size_t i = 0; i < size; i++) {
+        bytes_ += messages[i]->size();
+        chunks_.emplace_back();
+        chunks_.back().swap(*messages[i]);
+    }
+    cv_.notify_all();
+    // the messages are taken as consumed after the return, so the writer is blocked by the flow
+    // control of the stream until the chunks are read
+    while (bytes_ > max_bytes_ && !dropped_) {
+        cv_.wait(lock);
+    }
+    return 0;
+}
+
+void StreamRows::on_closed(brpc::StreamId id) {
+    std::shared_ptr<StreamRows> self;
+    {
+        std::lock_guard<bthread::Mutex> lock(mu_);
+        closed_ = true;
+        stream_ = brpc::INVALID_STREAM_ID;
+        cv_.notify_all();
+        self.swap(self_);
+    }
+}
+
+StreamResultSetSQL::StreamResultSetSQL(const ::hybridse::vm::Schema& schema, uint32_t record_cnt,
+                                       const std::shared_ptr<StreamRows>& rows)
+    : schema_(schema), schema_impl_(), record_cnt_(record_cnt), read_cnt_(0), rows_(rows), result_set_base_() {
+    schema_impl_.SetSchema(schema_);
+    std::unique_ptr<::hybridse::sdk::RowIOBufView> row_view(new ::hybridse::sdk::RowIOBufView(schema_));
+    result_set_base_.reset(
+        new ResultSetBase(std::make_shared<brpc::Controller>(), 0, 0, std::move(row_view), schema_));
+}
+
+StreamResultSetSQL::~StreamResultSetSQL() { rows_->Close(); }
+
+std::shared_ptr<::hybridse::sdk::ResultSet> StreamResultSetSQL::MakeResultSet(
+    const std::shared_ptr<::openmldb::api::QueryResponse>& response, const std::shared_ptr<StreamRows>& rows,
+    ::hybridse::sdk::Status* status) {
+    if (!status || !response || !rows) {
+        return std::shared_ptr<ResultSet>();
+    }
+    ::hybridse::vm::Schema schema;
+    if (!::hybridse::codec::SchemaCodec::Decode(response->schema(), &schema)) {
+        status->code = -1;
+        status->msg = "request error, fail to decodec schema";
+        rows->Close();
+        return std::shared_ptr<ResultSet>();
+    }
+    return std::make_shared<StreamResultSetSQL>(schema, response->count(), rows);
+}
+
+bool StreamResultSetSQL::Next() {
+    if (read_cnt_ >= record_cnt_) {
+        return false;
+    }
+    if (!result_set_base_->Next()) {
+        butil::IOBuf chunk;
+        if (!rows_->Pop(&chunk)) {
+            LOG(WARNING) << "the stream is closed with " << read_cnt_ << " rows read in " << record_cnt_;
+            return false;
+        }
+        // the rows of the chunk are read by a result set on it, which counts the rows by the size
+        auto cntl = std::make_shared<brpc::Controller>();
+        uint32_t chunk_size = chunk.size();
+        cntl->response_attachment().swap(chunk);
+        std::unique_ptr<::hybridse::sdk::RowIOBufView> row_view(new ::hybridse::sdk::RowIOBufView(schema_));
+        result_set_base_.reset(new ResultSetBase(cntl, record_cnt_ - read_cnt_, chunk_size, std::move(row_view),
+                                                 schema_));
+        if (!result_set_base_->Next()) {
+            return false;
+        }
+    }
+    read_cnt_++;
+    return true;
+}
+
+}  // namespace sdk
+}  // namespace openmldb
@@ -0,0 +1,115 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_SDK_STREAM_RESULT_SET_SQL_H_
+#define SRC_SDK_STREAM_RESULT_SET_SQL_H_
+
+#include <deque>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <string>
+
+#include "brpc/controller.h"
+#include "brpc/stream.h"
+#include "bthread/condition_variable.h"
+#include "bthread/mutex.h"
+#include "butil/iobuf.h"
+#include "proto/tablet.pb.h"
+#include "sdk/base_impl.h"
+#include "sdk/result_set.h"
+#include "sdk/result_set_base.h"
+
+namespace openmldb {
+namespace sdk {
+
+// StreamRows receives the chunks of rows written to the stream of a query. the stream is blocked
+// when the chunks not read reach max_bytes, so the memory of a result set is bounded
+class StreamRows : public brpc::StreamInputHandler, public std::enable_shared_from_this<StreamRows> {
+ public:
+    static std::shared_ptr<StreamRows> Create(uint64_t max_bytes);
+
+    // create the stream with the controller of the query before the request is sent
+    bool CreateStream(brpc::Controller* cntl);
+
+    // false if the stream is closed and all the chunks are read
+    bool Pop(butil::IOBuf* chunk);
+
+    // close the stream, the chunks not read are dropped
+    void Close();
+
+    int on_received_messages(brpc::StreamId id, butil::IOBuf* const messages[], size_t size) override;
+    void on_idle_timeout(brpc::StreamId id) override {}
+    void on_closed(brpc::StreamId id) override;
+
+ private:
+    explicit StreamRows(uint64_t max_bytes);
+
+    uint64_t max_bytes_;
+    brpc::StreamId stream_;
+    bthread::Mutex mu_;
+    bthread::ConditionVariable cv_;
+    std::deque<butil::IOBuf> chunks_;
+    uint64_t bytes_;
+    bool closed_;
+    bool dropped_;
+    // the handler lives until the stream is closed, even if the result set is released first
+    std::shared_ptr<StreamRows> self_;
+};
+
+// the result set of a batch query whose rows are read from the stream chunk by chunk
+class StreamResultSetSQL : public ::hybridse::sdk::ResultSet {
+ public:
+    StreamResultSetSQL(const ::hybridse::vm::Schema& schema, uint32_t record_cnt,
+                       const std::shared_ptr<StreamRows>& rows);
+    ~StreamResultSetSQL();
+
+    static std::shared_ptr<::hybridse::sdk::ResultSet> MakeResultSet(
+        const std::shared_ptr<::openmldb::api::QueryResponse>& response, const std::shared_ptr<StreamRows>& rows,
+        ::hybridse::sdk::Status* status);
+
+    // the rows read can not be read again
+    bool Reset() override { return false; }
+    bool Next() override;
+    bool IsNULL(int index) override { return result_set_base_->IsNULL(index); }
+    bool GetString(uint32_t index, std::string* str) override { return result_set_base_->GetString(index, str); }
+    bool GetBool(uint32_t index, bool* result) override { return result_set_base_->GetBool(index, result); }
+    bool GetChar(uint32_t index, char* result) override { return result_set_base_->GetChar(index, result); }
+    bool GetInt16(uint32_t index, int16_t* result) override { return result_set_base_->GetInt16(index, result); }
+    bool GetInt32(uint32_t index, int32_t* result) override { return result_set_base_->GetInt32(index, result); }
+    bool GetInt64(uint32_t index, int64_t* result) override { return result_set_base_->GetInt64(index, result); }
+    bool GetFloat(uint32_t index, float* result) override { return result_set_base_->GetFloat(index, result); }
+    bool GetDouble(uint32_t index, double* result) override { return result_set_base_->GetDouble(index, result); }
+    bool GetDate(uint32_t index, int32_t* date) override { return result_set_base_->GetDate(index, date); }
+    bool GetDate(uint32_t index, int32_t* year, int32_t* month, int32_t* day) override {
+        return result_set_base_->GetDate(index, year, month, day);
+    }
+    bool GetTime(uint32_t index, int64_t* mills) override { return result_set_base_->GetTime(index, mills); }
+    const ::hybridse::sdk::Schema* GetSchema() override { return &schema_impl_; }
+    int32_t Size() override { return record_cnt_; }
+
+ private:
+    ::hybridse::vm::Schema schema_;
+    ::hybridse::sdk::SchemaImpl schema_impl_;
+    uint32_t record_cnt_;
+    uint32_t read_cnt_;
+    std::shared_ptr<StreamRows> rows_;
+    // the rows of the current chunk
+    std::unique_ptr<ResultSetBase> result_set_base_;
+};
+
+}  // namespace sdk
+}  // namespace openmldb
+#endif  // SRC_SDK_STREAM_RESULT_SET_SQL_H_
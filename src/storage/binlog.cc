@@ -16,7 +16,10 @@
 
 #include "storage/binlog.h"
 
+#include <boost/bind.hpp>
+#include <condition_variable>  // NOLINT
 #include <map>
+#include <mutex>  // NOLINT
 #include <set>
 #include <utility>
 #include <vector>
@@ -26,20 +29,99 @@
 #include "base/kv_iterator.h"
 #include "base/status.h"
 #include "base/strings.h"
+#include "base/taskpool.hpp"
 #include "codec/flat_array.h"
 #include "codec/schema_codec.h"
 #include "common/timer.h"
 #include "gflags/gflags.h"
 #include "log/log_writer.h"
+#include "storage/mem_table.h"
 
 DECLARE_uint64(gc_on_table_recover_count);
 DECLARE_int32(binlog_name_length);
+DECLARE_uint32(binlog_replay_thread_num);
+DECLARE_uint32(load_table_batch);
+DECLARE_uint32(load_table_queue_size);
 
 namespace openmldb {
 namespace storage {
 
 Binlog::Binlog(LogParts* log_part, const std::string& binlog_path) : log_part_(log_part), log_path_(binlog_path) {}
 
+// Apply the put entries on a put pool for each shard. The entries are sharded by
+// the segment of their first dimension, so the entries of a pk keep their order
+class BinlogReplayer {
+ public:
+    BinlogReplayer(std::shared_ptr<Table> table, uint32_t shard_cnt)
+        : table_(table), mem_table_(dynamic_cast<MemTable*>(table.get())), batches_(shard_cnt), pending_(0) {
+        for (uint32_t i = 0; i < shard_cnt; i++) {
+            put_pools_.push_back(std::make_shared<::openmldb::base::TaskPool>(1, FLAGS_load_table_queue_size));
+        }
+    }
+
+    ~BinlogReplayer() {
+        Wait();
+        for (auto& pool : put_pools_) {
+            pool->Stop();
+        }
+    }
+
+    // take the ownership of entry
+    void Put(::openmldb::api::LogEntry* entry) {
+        uint32_t shard = 0;
+        if (mem_table_ != NULL) {
+            const std::string& pk = entry->dimensions_size() > 0 ? entry->dimensions(0).key() : entry->pk();
+            shard = mem_table_->GetSegIdx(pk) % batches_.size();
+        }
+        batches_[shard].push_back(entry);
+        if (batches_[shard].size() >= FLAGS_load_table_batch) {
+            Dispatch(shard);
+        }
+    }
+
+    // wait for all of the entries put before are applied
+    void Wait() {
+        for (uint32_t i = 0; i < batches_.size(); i++) {
+            Dispatch(i);
+        }
+        std::unique_lock<std::mutex> lock(mu_);
+        cv_.wait(lock, [this] { return pending_ == 0; });
+    }
+
+ private:
+    void Dispatch(uint32_t shard) {
+        if (batches_[shard].empty()) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            pending_++;
+        }
+        put_pools_[shard]->AddTask(boost::bind(&BinlogReplayer::Apply, this, batches_[shard]));
+        batches_[shard].clear();
+    }
+
+    void Apply(std::vector<::openmldb::api::LogEntry*> entries) {
+        for (auto entry : entries) {
+            table_->Put(*entry);
+            delete entry;
+        }
+        std::lock_guard<std::mutex> lock(mu_);
+        if (--pending_ == 0) {
+            cv_.notify_all();
+        }
+    }
+
+ private:
+    std::shared_ptr<Table> table_;
+    MemTable* mem_table_;
+    std::vector<std::vector<::openmldb::api::LogEntry*>> batches_;
+    std::vector<std::shared_ptr<::openmldb::base::TaskPool>> put_pools_;
+    std::mutex mu_;
+    std::condition_variable cv_;
+    uint64_t pending_;
+};
+
 bool Binlog::RecoverFromBinlog(std::shared_ptr<Table> table, uint64_t offset, uint64_t& latest_offset) {
     uint32_t tid = table->GetId();
     uint32_t pid = table->GetPid();
@@ -54,6 +136,10 @@ bool Binlog::RecoverFromBinlog(std::shared_ptr<Table> table, uint64_t offset, ui
     uint64_t consumed = ::baidu::common::timer::now_time();
     int last_log_index = log_reader.GetLogIndex();
     bool reach_end_log = true;
+    std::unique_ptr<BinlogReplayer> replayer;
+    if (FLAGS_binlog_replay_thread_num > 1) {
+        replayer.reset(new BinlogReplayer(table, FLAGS_binlog_replay_thread_num));
+    }
     while (true) {
         buffer.clear();
         ::openmldb::base::Slice record;
@@ -109,16 +195,24 @@ bool Binlog::RecoverFromBinlog(std::shared_ptr<Table> table, uint64_t offset, ui
                   cur_offset, entry.log_index(), tid, pid);
         }
 
+        cur_offset = entry.log_index();
         if (entry.has_method_type() && entry.method_type() == ::openmldb::api::MethodType::kDelete) {
-            if (entry.dimensions_size() == 0) {
+            if (entry.dimensions_size() == 0 && !entry.has_end_ts()) {
                 PDLOG(WARNING, "no dimesion. tid %u pid %u offset %lu", tid, pid, entry.log_index());
             } else {
-                table->Delete(entry.dimensions(0).key(), entry.dimensions(0).idx());
+                // the delete may cover the rows of any shard, so apply the former puts first
+                if (replayer) {
+                    replayer->Wait();
+                }
+                table->Delete(entry);
             }
+        } else if (replayer) {
+            auto* put_entry = new ::openmldb::api::LogEntry();
+            put_entry->Swap(&entry);
+            replayer->Put(put_entry);
         } else {
             table->Put(entry);
         }
-        cur_offset = entry.log_index();
         succ_cnt++;
         if (succ_cnt % 100000 == 0) {
             PDLOG(INFO,
@@ -130,6 +224,8 @@ bool Binlog::RecoverFromBinlog(std::shared_ptr<Table> table, uint64_t offset, ui
             table->SchedGc();
         }
     }
+    // the table is loaded when all of the puts are applied
+    replayer.reset();
     latest_offset = cur_offset;
     if (!reach_end_log) {
         int log_index = log_reader.GetLogIndex();
@@ -0,0 +1,318 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "storage/cold_block.h"
+
+#include <snappy.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+
+#include <algorithm>
+
+#include "storage/segment.h"
+
+namespace openmldb {
+namespace storage {
+
+// the raw deflate without the zlib header, the dictionary is known by both sides
+static constexpr int DEFLATE_WINDOW_BITS = -15;
+static constexpr uint32_t DEFLATE_MAX_DICT_SIZE = 1 << 15;
+
+static bool Deflate(const std::string& raw, const std::string& dict, std::string* compressed) {
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, DEFLATE_WINDOW_BITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return false;
+    }
+    bool ok = false;
+    if (deflateSetDictionary(&stream, reinterpret_cast<const Bytef*>(dict.data()), dict.size()) == Z_OK) {
+        compressed->resize(deflateBound(&stream, raw.size()));
+        stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(raw.data()));
+        stream.avail_in = raw.size();
+        stream.next_out = reinterpret_cast<Bytef*>(&(*compressed)[0]);
+        stream.avail_out = compressed->size();
+        ok = deflate(&stream, Z_FINISH) == Z_STREAM_END;
+        compressed->resize(stream.total_out);
+    }
+    deflateEnd(&stream);
+    return ok;
+}
+
+static bool Inflate(const char* compressed, uint32_t size, const std::string& dict, uint32_t raw_size,
+                    std::string* raw) {
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    if (inflateInit2(&stream, DEFLATE_WINDOW_BITS) != Z_OK) {
+        return false;
+    }
+    bool ok = false;
+    if (inflateSetDictionary(&stream, reinterpret_cast<const Bytef*>(dict.data()), dict.size()) == Z_OK) {
+        raw->resize(raw_size);
+        stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(compressed));
+        stream.avail_in = size;
+        stream.next_out = reinterpret_cast<Bytef*>(&(*raw)[0]);
+        stream.avail_out = raw_size;
+        ok = inflate(&stream, Z_FINISH) == Z_STREAM_END && stream.total_out == raw_size;
+    }
+    inflateEnd(&stream);
+    return ok;
+}
+
+ColdBlockDict* ColdBlockDict::New(const std::vector<DataBlock*>& samples, uint32_t max_size) {
+    max_size = std::min(max_size, DEFLATE_MAX_DICT_SIZE);
+    uint64_t total_size = 0;
+    size_t first = samples.size();
+    while (first > 0 && total_size < max_size) {
+        first--;
+        total_size += samples[first]->size;
+    }
+    if (total_size == 0) {
+        return NULL;
+    }
+    ColdBlockDict* dict = new ColdBlockDict();
+    dict->data_.reserve(std::min(total_size, static_cast<uint64_t>(max_size)));
+    for (size_t i = first; i < samples.size(); i++) {
+        const DataBlock* block = samples[i];
+        // the head of the first sample is cut to fit in the max size
+        uint32_t skip = i == first && total_size > max_size ? total_size - max_size : 0;
+        dict->data_.append(block->data + skip, block->size - skip);
+    }
+    return dict;
+}
+
+void ColdBlockDict::UnRef() {
+    if (refs_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        delete this;
+    }
+}
+
+bool ColdBlockLayout::Init(const ::openmldb::codec::Schema& schema, uint8_t version) {
+    widths.clear();
+    widths.push_back(::openmldb::codec::HEADER_LENGTH);
+    widths.push_back((schema.size() + 7) / 8);
+    fixed_size = widths[0] + widths[1];
+    for (const auto& column : schema) {
+        uint32_t size = ::openmldb::codec::GetFixedTypeSize(column.data_type());
+        if (size > 0) {
+            widths.push_back(size);
+            fixed_size += size;
+        }
+    }
+    schema_version = version;
+    return widths.size() > 2;
+}
+
+bool ColdBlock::MatchLayout(const std::vector<DataBlock*>& rows, const ColdBlockLayout* layout) {
+    if (layout == NULL || layout->widths.empty()) {
+        return false;
+    }
+    // the rows of the other schema versions and the compact rows have the different fixed parts
+    for (const auto block : rows) {
+        if (block->size < layout->fixed_size || block->data[0] != 1 ||
+            static_cast<uint8_t>(block->data[1]) != layout->schema_version) {
+            return false;
+        }
+    }
+    return true;
+}
+
+ColdBlock* ColdBlock::New(const std::vector<DataBlock*>& rows, const ColdBlockLayout* layout, ColdBlockDict* dict) {
+    if (rows.empty() || rows.size() >= DataBlock::MAPPED_POS) {
+        return NULL;
+    }
+    std::string raw;
+    std::vector<uint32_t> offsets;
+    offsets.reserve(rows.size() + 1);
+    uint32_t raw_size = 0;
+    for (const auto block : rows) {
+        offsets.push_back(raw_size);
+        raw_size += block->size;
+    }
+    offsets.push_back(raw_size);
+    raw.reserve(raw_size);
+    bool columnar = MatchLayout(rows, layout);
+    if (columnar) {
+        uint32_t page_offset = 0;
+        for (uint16_t width : layout->widths) {
+            for (const auto block : rows) {
+                raw.append(block->data + page_offset, width);
+            }
+            page_offset += width;
+        }
+        for (const auto block : rows) {
+            raw.append(block->data + layout->fixed_size, block->size - layout->fixed_size);
+        }
+    } else {
+        for (const auto block : rows) {
+            raw.append(block->data, block->size);
+        }
+    }
+    std::string compressed;
+    if (dict == NULL) {
+        ::snappy::Compress(raw.data(), raw.size(), &compressed);
+    } else if (!Deflate(raw, dict->GetData(), &compressed)) {
+        return NULL;
+    }
+    // the packed rows keep the pointers to their blobs
+    std::vector<::openmldb::codec::RowBlob*> blobs;
+    for (const auto block : rows) {
+        if (block->has_blobs) {
+            const int8_t* data = reinterpret_cast<const int8_t*>(block->data);
+            uint32_t cnt = ::openmldb::codec::CompactRowCodec::GetBlobCnt(data, block->size);
+            for (uint32_t pos = 0; pos < cnt; pos++) {
+                blobs.push_back(::openmldb::codec::CompactRowCodec::GetBlob(data, block->size, pos));
+            }
+        }
+    }
+    size_t blobs_size = sizeof(::openmldb::codec::RowBlob*) * blobs.size();
+    size_t offsets_size = sizeof(uint32_t) * offsets.size();
+    size_t widths_size = columnar ? sizeof(uint16_t) * layout->widths.size() : 0;
+    size_t total_size = sizeof(ColdBlock) + blobs_size + offsets_size + widths_size + compressed.size();
+    if (total_size >= raw.size()) {
+        return NULL;
+    }
+    void* mem = malloc(total_size);
+    if (mem == NULL) {
+        return NULL;
+    }
+    ColdBlock* block = reinterpret_cast<ColdBlock*>(mem);
+    new (&block->refs_) std::atomic<uint32_t>(0);
+    block->blob_cnt_ = blobs.size();
+    block->row_cnt_ = rows.size();
+    block->raw_size_ = raw.size();
+    block->compressed_size_ = compressed.size();
+    block->page_cnt_ = columnar ? layout->widths.size() : 0;
+    block->dict_ = dict;
+    if (dict != NULL) {
+        dict->Ref();
+    }
+    char* ptr = reinterpret_cast<char*>(block + 1);
+    for (auto blob : blobs) {
+        blob->Ref();
+    }
+    memcpy(ptr, blobs.data(), blobs_size);
+    ptr += blobs_size;
+    memcpy(ptr, offsets.data(), offsets_size);
+    if (columnar) {
+        memcpy(ptr + offsets_size, layout->widths.data(), widths_size);
+    }
+    memcpy(ptr + offsets_size + widths_size, compressed.data(), compressed.size());
+    return block;
+}
+
+void ColdBlock::UnRef() {
+    if (refs_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        if (dict_ != NULL) {
+            dict_->UnRef();
+        }
+        for (uint32_t pos = 0; pos < blob_cnt_; pos++) {
+            Blobs()[pos]->UnRef();
+        }
+        free(this);
+    }
+}
+
+bool ColdBlock::Decompress(std::string* buf) const {
+    if (dict_ != NULL) {
+        return Inflate(CompressedData(), compressed_size_, dict_->GetData(), raw_size_, buf);
+    }
+    if (!::snappy::Uncompress(CompressedData(), compressed_size_, buf)) {
+        return false;
+    }
+    return buf->size() == raw_size_;
+}
+
+bool ColdBlock::Unpack(std::string* buf) const {
+    if (!IsColumnar()) {
+        return Decompress(buf);
+    }
+    std::string pages;
+    if (!Decompress(&pages)) {
+        return false;
+    }
+    // gather the minipages and the tails back into rows
+    buf->resize(raw_size_);
+    char* dst = &(*buf)[0];
+    const char* src = pages.data();
+    const uint32_t* offsets = Offsets();
+    const uint16_t* widths = Widths();
+    uint32_t page_offset = 0;
+    for (uint16_t i = 0; i < page_cnt_; i++) {
+        for (uint32_t pos = 0; pos < row_cnt_; pos++) {
+            memcpy(dst + offsets[pos] + page_offset, src, widths[i]);
+            src += widths[i];
+        }
+        page_offset += widths[i];
+    }
+    for (uint32_t pos = 0; pos < row_cnt_; pos++) {
+        uint32_t tail_size = offsets[pos + 1] - offsets[pos] - page_offset;
+        memcpy(dst + offsets[pos] + page_offset, src, tail_size);
+        src += tail_size;
+    }
+    return true;
+}
+
+ColdRowReader::~ColdRowReader() {
+    for (auto& kv : unpacked_) {
+        kv.first->UnRef();
+    }
+}
+
+::openmldb::base::Slice ColdRowReader::Read(const DataBlock* block) {
+    ::openmldb::base::Slice value = ReadBlock(block);
+    const int8_t* row = reinterpret_cast<const int8_t*>(value.data());
+    last_decoded_ = false;
+    if (!codec_ || !::openmldb::codec::CompactRowCodec::IsCompact(row, value.size())) {
+        return value;
+    }
+    last_decoded_ = true;
+    if (block != compact_block_) {
+        compact_block_ = NULL;
+        if (!codec_->Decode(row, value.size(), &compact_buf_, mask_.get())) {
+            return ::openmldb::base::Slice();
+        }
+        compact_block_ = block;
+    }
+    return ::openmldb::base::Slice(compact_buf_.data(), compact_buf_.size());
+}
+
+::openmldb::base::Slice ColdRowReader::ReadBlock(const DataBlock* block) {
+    if (!block->IsCold()) {
+        return ::openmldb::base::Slice(block->data, block->size);
+    }
+    ColdBlock* cold_block = block->GetColdBlock();
+    if (cold_block != last_block_) {
+        auto iter = unpacked_.find(cold_block);
+        if (iter == unpacked_.end()) {
+            iter = unpacked_.emplace(cold_block, std::string()).first;
+            cold_block->Ref();
+            if (!cold_block->Unpack(&iter->second)) {
+                iter->second.clear();
+            }
+        }
+        last_block_ = cold_block;
+        last_buf_ = &iter->second;
+    }
+    uint32_t offset = cold_block->GetRowOffset(block->cold_pos);
+    if (offset + block->size > last_buf_->size()) {
+        return ::openmldb::base::Slice();
+    }
+    return ::openmldb::base::Slice(last_buf_->data() + offset, block->size);
+}
+
+}  // namespace storage
+}  // namespace openmldb
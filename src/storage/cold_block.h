@@ -0,0 +1,174 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_STORAGE_COLD_BLOCK_H_
+#define SRC_STORAGE_COLD_BLOCK_H_
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/slice.h"
+#include "codec/codec.h"
+#include "codec/compact_row.h"
+
+namespace openmldb {
+namespace storage {
+
+struct DataBlock;
+
+// The columnar layout of the cold blocks of a table. The fixed length part of the
+// rows of schema_version is split into minipages, the header, the null bitmap and
+// every fixed length field, so the values of one field of all the rows in a block
+// are stored together. The string addresses and the strings remain row by row
+// after the minipages
+struct ColdBlockLayout {
+    // return false if the schema has no fixed length field
+    bool Init(const ::openmldb::codec::Schema& schema, uint8_t version);
+
+    inline uint32_t GetFixedSize() const { return fixed_size; }
+
+    uint8_t schema_version = 0;
+    uint32_t fixed_size = 0;
+    std::vector<uint16_t> widths;
+};
+
+// The preset dictionary of zlib shared by the cold blocks of a segment. It is sampled from
+// the rows of the segment, so a small block of one key is compressed against the strings
+// which are common in the other keys. It is released with the last block referring to it
+class ColdBlockDict {
+ public:
+    // the latest samples are put at the end of the dictionary, where the matches are the
+    // cheapest. Return NULL if there is no sample
+    static ColdBlockDict* New(const std::vector<DataBlock*>& samples, uint32_t max_size);
+
+    void Ref() { refs_.fetch_add(1, std::memory_order_relaxed); }
+
+    void UnRef();
+
+    inline const std::string& GetData() const { return data_; }
+
+ private:
+    ColdBlockDict() : refs_(1), data_() {}
+    ~ColdBlockDict() = default;
+
+ private:
+    std::atomic<uint32_t> refs_;
+    std::string data_;
+};
+
+// A cold block packs the old rows of one key entry into a snappy compressed buffer, or a
+// deflated buffer if there is a dictionary. Every packed row is represented by a DataBlock
+// which refers to the cold block and its position, the cold block is released when all of
+// its rows are released. The cold block refers to the blobs of its compact rows on its own
+class ColdBlock {
+ public:
+    // return NULL if the rows can not be compressed to a smaller block. The rows are
+    // stored in the columnar layout if it is given and all the rows match it, and the
+    // block refers to dict if it is given
+    static ColdBlock* New(const std::vector<DataBlock*>& rows, const ColdBlockLayout* layout = NULL,
+                          ColdBlockDict* dict = NULL);
+
+    void Ref() { refs_.fetch_add(1, std::memory_order_relaxed); }
+
+    void UnRef();
+
+    // decompress the whole block into buf, the rows are rebuilt one after another
+    bool Unpack(std::string* buf) const;
+
+    inline uint32_t GetRowCnt() const { return row_cnt_; }
+
+    inline uint32_t GetRowOffset(uint32_t pos) const { return Offsets()[pos]; }
+
+    // the memory allocated for the block
+    inline uint64_t GetByteSize() const {
+        return sizeof(ColdBlock) + sizeof(::openmldb::codec::RowBlob*) * blob_cnt_ + sizeof(uint32_t) * (row_cnt_ + 1) +
+               sizeof(uint16_t) * page_cnt_ + compressed_size_;
+    }
+
+    inline uint64_t GetRawSize() const { return raw_size_; }
+
+    inline bool IsColumnar() const { return page_cnt_ > 0; }
+
+ private:
+    ColdBlock() = delete;
+    ~ColdBlock() = delete;
+    inline ::openmldb::codec::RowBlob* const* Blobs() const {
+        return reinterpret_cast<::openmldb::codec::RowBlob* const*>(this + 1);
+    }
+    inline const uint32_t* Offsets() const { return reinterpret_cast<const uint32_t*>(Blobs() + blob_cnt_); }
+    inline const uint16_t* Widths() const { return reinterpret_cast<const uint16_t*>(Offsets() + row_cnt_ + 1); }
+    inline const char* CompressedData() const { return reinterpret_cast<const char*>(Widths() + page_cnt_); }
+
+    static bool MatchLayout(const std::vector<DataBlock*>& rows, const ColdBlockLayout* layout);
+
+    bool Decompress(std::string* buf) const;
+
+ private:
+    std::atomic<uint32_t> refs_;
+    uint32_t blob_cnt_;
+    uint32_t row_cnt_;
+    uint32_t raw_size_;
+    uint32_t compressed_size_;
+    // the minipage count of the columnar layout, 0 if the rows are stored one after another
+    uint16_t page_cnt_;
+    // the dictionary of the deflated data, NULL if the data is compressed by snappy
+    ColdBlockDict* dict_;
+    // followed by blob_cnt_ blobs, row_cnt_ + 1 offsets, page_cnt_ minipage widths and the compressed data
+};
+
+// Read the rows of data blocks for an iterator. The cold blocks are unpacked on
+// demand and the unpacked rows are valid until the reader is destroyed. A compact
+// row is decoded with the codec of the table and is valid until the next read
+class ColdRowReader {
+ public:
+    ColdRowReader() : last_block_(NULL), last_buf_(NULL), compact_block_(NULL), last_decoded_(false) {}
+    ~ColdRowReader();
+    ColdRowReader(const ColdRowReader&) = delete;
+    ColdRowReader& operator=(const ColdRowReader&) = delete;
+
+    void SetCompactCodec(const std::shared_ptr<::openmldb::codec::CompactRowCodec>& codec) { codec_ = codec; }
+
+    // the columns not set in the mask are decoded as null from the compact rows
+    void SetColumnMask(const std::shared_ptr<const std::vector<bool>>& mask) {
+        mask_ = mask;
+        compact_block_ = NULL;
+    }
+
+    ::openmldb::base::Slice Read(const DataBlock* block);
+
+    // whether the row of the last read is valid until the reader is destroyed rather than the next read
+    inline bool IsLastPinned() const { return !last_decoded_; }
+
+ private:
+    ::openmldb::base::Slice ReadBlock(const DataBlock* block);
+
+ private:
+    std::map<ColdBlock*, std::string> unpacked_;
+    ColdBlock* last_block_;
+    const std::string* last_buf_;
+    std::shared_ptr<::openmldb::codec::CompactRowCodec> codec_;
+    std::shared_ptr<const std::vector<bool>> mask_;
+    const DataBlock* compact_block_;
+    std::string compact_buf_;
+    bool last_decoded_;
+};
+
+}  // namespace storage
+}  // namespace openmldb
+#endif  // SRC_STORAGE_COLD_BLOCK_H_
@@ -0,0 +1,335 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "storage/data_block_pool.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#ifdef __linux__
+#include <linux/mempolicy.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <mutex>  // NOLINT
+
+#include "storage/cold_block.h"
+#include "storage/segment.h"
+
+namespace openmldb {
+namespace storage {
+
+const uint32_t DataBlockPool::CELL_SIZES[DataBlockPool::CLASS_NUM] = {
+    32,  48,  64,  80,   96,   112,  128,  160,  192,  224,  256,  320,  384, 448,
+    512, 640, 768, 896, 1024, 1280, 1536, 1792, 2048, 2560, 3072, 3584, 4096};
+
+struct DataBlockPool::Slab {
+    DataBlockPool* pool;
+    Slab* prev;
+    Slab* next;
+    // the freed cells
+    void* free_list;
+    uint32_t class_idx;
+    uint64_t bucket;
+    uint32_t capacity;
+    uint32_t used;
+    // the number of cells which have never been allocated
+    uint32_t untouched;
+};
+
+// the cells start after the slab header with 16 bytes alignment
+static const uint32_t SLAB_HEADER_SIZE = 64;
+
+static inline char* GetCell(void* slab, uint32_t cell_size, uint32_t pos) {
+    return reinterpret_cast<char*>(slab) + SLAB_HEADER_SIZE + (uint64_t)cell_size * pos;
+}
+
+// prefer the pages of mem on the node and move the ones touched already, it is done by the syscall
+// as libnuma is not a dependency
+static void BindNumaNode(void* mem, size_t len, int32_t node) {
+#ifdef __linux__
+    if (node < 0 || node >= 64) {
+        return;
+    }
+    uint64_t mask = 1ULL << node;
+    syscall(SYS_mbind, mem, len, MPOL_PREFERRED, &mask, 64 + 1, MPOL_MF_MOVE);
+#endif
+}
+
+void DeleteDataBlock(DataBlock* block) {
+    if (block == NULL) {
+        return;
+    }
+    if (block->IsCold()) {
+        ColdBlock* cold_block = block->GetColdBlock();
+        delete block;
+        cold_block->UnRef();
+        return;
+    }
+    if (block->has_blobs) {
+        ::openmldb::codec::CompactRowCodec::UnRefBlobs(reinterpret_cast<const int8_t*>(block->data), block->size);
+    }
+    if (!block->pooled) {
+        delete block;
+        return;
+    }
+    // slabs are aligned with SLAB_SIZE, so the slab header can be found by the address
+    auto* slab = reinterpret_cast<DataBlockPool::Slab*>(reinterpret_cast<uintptr_t>(block) &
+                                                        ~(uintptr_t)(DataBlockPool::SLAB_SIZE - 1));
+    block->~DataBlock();
+    slab->pool->FreeCell(slab, block);
+}
+
+DataBlockPool::DataBlockPool(uint64_t bucket_ms)
+    : slab_cnt_(0),
+      bucket_ms_(bucket_ms),
+      numa_node_(-1),
+      huge_page_(false),
+      chunk_mu_(),
+      chunks_(),
+      free_slabs_(),
+      chunk_cnt_(0),
+      hugetlb_chunk_cnt_(0) {
+    static_assert(sizeof(Slab) <= SLAB_HEADER_SIZE, "slab header is too large");
+    for (uint32_t i = 0; i < CLASS_NUM; i++) {
+        classes_[i].cell_size = CELL_SIZES[i];
+        classes_[i].slab_cnt.store(0, std::memory_order_relaxed);
+        classes_[i].used_cell_cnt.store(0, std::memory_order_relaxed);
+    }
+}
+
+DataBlockPool::~DataBlockPool() {
+    // the blocks still in use are owned by nobody after the table is released,
+    // only the partial slabs can be found here
+    for (uint32_t i = 0; i < CLASS_NUM; i++) {
+        for (auto& kv : classes_[i].partial) {
+            Slab* slab = kv.second;
+            while (slab != NULL) {
+                Slab* next = slab->next;
+                FreeSlabMem(slab);
+                slab = next;
+            }
+        }
+        classes_[i].partial.clear();
+    }
+}
+
+int32_t DataBlockPool::GetClassIdx(uint32_t size) const {
+    const uint32_t* pos = std::lower_bound(CELL_SIZES, CELL_SIZES + CLASS_NUM, size);
+    if (pos == CELL_SIZES + CLASS_NUM) {
+        return -1;
+    }
+    return pos - CELL_SIZES;
+}
+
+void* DataBlockPool::AllocSlabMem() {
+    if (huge_page_) {
+        std::lock_guard<std::mutex> lock(chunk_mu_);
+        if (free_slabs_.empty()) {
+            bool hugetlb = true;
+            void* chunk =
+                mmap(NULL, CHUNK_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            if (chunk == MAP_FAILED) {
+                // fall back to the transparent huge pages
+                hugetlb = false;
+                chunk = aligned_alloc(CHUNK_SIZE, CHUNK_SIZE);
+                if (chunk != NULL) {
+                    madvise(chunk, CHUNK_SIZE, MADV_HUGEPAGE);
+                }
+            }
+            if (chunk != NULL) {
+                if (numa_node_ >= 0) {
+                    BindNumaNode(chunk, CHUNK_SIZE, numa_node_);
+                }
+                chunks_.emplace(reinterpret_cast<uintptr_t>(chunk), Chunk{0, hugetlb});
+                for (uint32_t pos = CHUNK_SIZE / SLAB_SIZE; pos > 0; pos--) {
+                    free_slabs_.push_back(reinterpret_cast<char*>(chunk) + (uint64_t)(pos - 1) * SLAB_SIZE);
+                }
+                chunk_cnt_.fetch_add(1, std::memory_order_relaxed);
+                if (hugetlb) {
+                    hugetlb_chunk_cnt_.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+        }
+        if (!free_slabs_.empty()) {
+            void* mem = free_slabs_.back();
+            free_slabs_.pop_back();
+            chunks_[reinterpret_cast<uintptr_t>(mem) & ~(uintptr_t)(CHUNK_SIZE - 1)].used++;
+            return mem;
+        }
+    }
+    // the slab is allocated alone without the huge pages
+    void* mem = aligned_alloc(SLAB_SIZE, SLAB_SIZE);
+    if (mem != NULL && numa_node_ >= 0) {
+        BindNumaNode(mem, SLAB_SIZE, numa_node_);
+    }
+    return mem;
+}
+
+void DataBlockPool::FreeSlabMem(void* mem) {
+    if (huge_page_) {
+        uintptr_t addr = reinterpret_cast<uintptr_t>(mem) & ~(uintptr_t)(CHUNK_SIZE - 1);
+        std::lock_guard<std::mutex> lock(chunk_mu_);
+        auto iter = chunks_.find(addr);
+        if (iter != chunks_.end()) {
+            if (--iter->second.used > 0) {
+                free_slabs_.push_back(mem);
+                return;
+            }
+            // release the chunk once all of its slabs are freed
+            auto pos = std::remove_if(free_slabs_.begin(), free_slabs_.end(), [addr](void* slab) {
+                return (reinterpret_cast<uintptr_t>(slab) & ~(uintptr_t)(CHUNK_SIZE - 1)) == addr;
+            });
+            free_slabs_.erase(pos, free_slabs_.end());
+            if (iter->second.hugetlb) {
+                munmap(reinterpret_cast<void*>(addr), CHUNK_SIZE);
+                hugetlb_chunk_cnt_.fetch_sub(1, std::memory_order_relaxed);
+            } else {
+                free(reinterpret_cast<void*>(addr));
+            }
+            chunks_.erase(iter);
+            chunk_cnt_.fetch_sub(1, std::memory_order_relaxed);
+            return;
+        }
+    }
+    free(mem);
+}
+
+DataBlockPool::Slab* DataBlockPool::NewSlab(uint32_t class_idx, uint64_t bucket) {
+    void* mem = AllocSlabMem();
+    if (mem == NULL) {
+        return NULL;
+    }
+    Slab* slab = reinterpret_cast<Slab*>(mem);
+    slab->pool = this;
+    slab->prev = NULL;
+    slab->next = NULL;
+    slab->free_list = NULL;
+    slab->class_idx = class_idx;
+    slab->bucket = bucket;
+    slab->capacity = (SLAB_SIZE - SLAB_HEADER_SIZE) / CELL_SIZES[class_idx];
+    slab->used = 0;
+    slab->untouched = slab->capacity;
+    classes_[class_idx].slab_cnt.fetch_add(1, std::memory_order_relaxed);
+    slab_cnt_.fetch_add(1, std::memory_order_relaxed);
+    return slab;
+}
+
+void DataBlockPool::AddToPartial(SizeClass* size_class, Slab* slab) {
+    Slab*& head = size_class->partial[slab->bucket];
+    slab->prev = NULL;
+    slab->next = head;
+    if (head != NULL) {
+        head->prev = slab;
+    }
+    head = slab;
+}
+
+void DataBlockPool::RemoveFromPartial(SizeClass* size_class, Slab* slab) {
+    if (slab->prev != NULL) {
+        slab->prev->next = slab->next;
+    } else if (slab->next != NULL) {
+        size_class->partial[slab->bucket] = slab->next;
+    } else {
+        size_class->partial.erase(slab->bucket);
+    }
+    if (slab->next != NULL) {
+        slab->next->prev = slab->prev;
+    }
+    slab->prev = NULL;
+    slab->next = NULL;
+}
+
+DataBlock* DataBlockPool::New(uint8_t dim_cnt, const char* data, uint32_t len, uint64_t time) {
+    int32_t class_idx = GetClassIdx(sizeof(DataBlock) + len);
+    if (class_idx < 0) {
+        return NULL;
+    }
+    SizeClass* size_class = &classes_[class_idx];
+    uint64_t bucket = bucket_ms_ > 0 ? time / bucket_ms_ : 0;
+    char* cell = NULL;
+    {
+        std::lock_guard<::openmldb::base::SpinMutex> lock(size_class->mu);
+        auto iter = size_class->partial.find(bucket);
+        Slab* slab = iter == size_class->partial.end() ? NULL : iter->second;
+        if (slab == NULL) {
+            slab = NewSlab(class_idx, bucket);
+            if (slab == NULL) {
+                return NULL;
+            }
+            AddToPartial(size_class, slab);
+        }
+        if (slab->free_list != NULL) {
+            cell = reinterpret_cast<char*>(slab->free_list);
+            slab->free_list = *reinterpret_cast<void**>(cell);
+        } else {
+            cell = GetCell(slab, size_class->cell_size, slab->capacity - slab->untouched);
+            slab->untouched--;
+        }
+        slab->used++;
+        if (slab->used == slab->capacity) {
+            RemoveFromPartial(size_class, slab);
+        }
+    }
+    size_class->used_cell_cnt.fetch_add(1, std::memory_order_relaxed);
+    char* payload = cell + sizeof(DataBlock);
+    memcpy(payload, data, len);
+    DataBlock* block = new (cell) DataBlock(dim_cnt, payload, len, true);
+    block->pooled = true;
+    return block;
+}
+
+void DataBlockPool::Free(DataBlock* block) { DeleteDataBlock(block); }
+
+void DataBlockPool::FreeCell(Slab* slab, void* cell) {
+    SizeClass* size_class = &classes_[slab->class_idx];
+    size_class->used_cell_cnt.fetch_sub(1, std::memory_order_relaxed);
+    std::lock_guard<::openmldb::base::SpinMutex> lock(size_class->mu);
+    bool is_full = slab->used == slab->capacity;
+    *reinterpret_cast<void**>(cell) = slab->free_list;
+    slab->free_list = cell;
+    slab->used--;
+    // keep at least one partial slab of the latest bucket to avoid allocating slab repeatedly,
+    // the rows of the earlier buckets are not put any more mostly
+    if (slab->used == 0 && !is_full &&
+        (slab->prev != NULL || slab->next != NULL || slab->bucket < size_class->partial.rbegin()->first)) {
+        RemoveFromPartial(size_class, slab);
+        size_class->slab_cnt.fetch_sub(1, std::memory_order_relaxed);
+        slab_cnt_.fetch_sub(1, std::memory_order_relaxed);
+        FreeSlabMem(slab);
+    } else if (is_full) {
+        AddToPartial(size_class, slab);
+    }
+}
+
+void DataBlockPool::GetStat(std::vector<DataBlockPoolStat>* stats) {
+    if (stats == NULL) {
+        return;
+    }
+    for (uint32_t i = 0; i < CLASS_NUM; i++) {
+        uint64_t slab_cnt = classes_[i].slab_cnt.load(std::memory_order_relaxed);
+        if (slab_cnt == 0) {
+            continue;
+        }
+        stats->push_back({classes_[i].cell_size, slab_cnt,
+                          classes_[i].used_cell_cnt.load(std::memory_order_relaxed)});
+    }
+}
+
+}  // namespace storage
+}  // namespace openmldb
@@ -0,0 +1,127 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_STORAGE_DATA_BLOCK_POOL_H_
+#define SRC_STORAGE_DATA_BLOCK_POOL_H_
+
+#include <atomic>
+#include <map>
+#include <mutex>  // NOLINT
+#include <vector>
+
+#include "base/spinlock.h"
+
+namespace openmldb {
+namespace storage {
+
+struct DataBlock;
+class DataBlockPool;
+
+// release a data block whether it is allocated by DataBlockPool, new or packed into a cold block
+void DeleteDataBlock(DataBlock* block);
+
+struct DataBlockPoolStat {
+    uint32_t cell_size;
+    uint64_t slab_cnt;
+    uint64_t used_cell_cnt;
+};
+
+// Size class slab allocator of DataBlock. The header and the payload of a block
+// are put in one cell, and a slab is returned to system as soon as all of
+// its cells are freed, so the memory of expired rows can be released in whole slabs.
+// With a bucket time, the rows are put in the slabs of the bucket of their time, so the
+// slabs of a bucket are released together as the rows expire rather than kept by a few
+// newer rows mixed in them
+class DataBlockPool {
+ public:
+    DataBlockPool() : DataBlockPool(0) {}
+    // bucket_ms is the time span of a bucket in ms, 0 means all the rows share the slabs
+    explicit DataBlockPool(uint64_t bucket_ms);
+    ~DataBlockPool();
+    DataBlockPool(const DataBlockPool&) = delete;
+    DataBlockPool& operator=(const DataBlockPool&) = delete;
+
+    // return NULL if the block is larger than the biggest size class
+    DataBlock* New(uint8_t dim_cnt, const char* data, uint32_t len) { return New(dim_cnt, data, len, 0); }
+    // the block is put in the slabs of the bucket of time
+    DataBlock* New(uint8_t dim_cnt, const char* data, uint32_t len, uint64_t time);
+
+    void Free(DataBlock* block);
+
+    uint64_t GetSlabByteSize() const { return slab_cnt_.load(std::memory_order_relaxed) * SLAB_SIZE; }
+
+    void GetStat(std::vector<DataBlockPoolStat>* stats);
+
+    // the slabs allocated later prefer the memory of the numa node, -1 means no preference
+    void SetNumaNode(int32_t node) { numa_node_ = node; }
+    int32_t GetNumaNode() const { return numa_node_; }
+
+    // carve the slabs out of the chunks of huge pages to reduce the tlb misses of reading the rows. A chunk is
+    // mapped from hugetlbfs, or it is advised to be backed by the transparent huge pages if there is no huge
+    // page reserved. It should be set before any block is allocated
+    void SetHugePage(bool huge_page) { huge_page_ = huge_page; }
+    // the bytes of the chunks, and the ones mapped from hugetlbfs among them
+    uint64_t GetHugePageByteSize() const { return chunk_cnt_.load(std::memory_order_relaxed) * CHUNK_SIZE; }
+    uint64_t GetHugeTlbByteSize() const { return hugetlb_chunk_cnt_.load(std::memory_order_relaxed) * CHUNK_SIZE; }
+
+    static constexpr uint32_t SLAB_SIZE = 64 * 1024;
+    static constexpr uint32_t CHUNK_SIZE = 2 * 1024 * 1024;
+
+ private:
+    struct Slab;
+    struct SizeClass {
+        ::openmldb::base::SpinMutex mu;
+        uint32_t cell_size;
+        // slabs which have free cells by the bucket
+        std::map<uint64_t, Slab*> partial;
+        std::atomic<uint64_t> slab_cnt;
+        std::atomic<uint64_t> used_cell_cnt;
+    };
+
+    static constexpr uint32_t CLASS_NUM = 27;
+    static const uint32_t CELL_SIZES[CLASS_NUM];
+
+    int32_t GetClassIdx(uint32_t size) const;
+    Slab* NewSlab(uint32_t class_idx, uint64_t bucket);
+    void* AllocSlabMem();
+    void FreeSlabMem(void* mem);
+    void RemoveFromPartial(SizeClass* size_class, Slab* slab);
+    void AddToPartial(SizeClass* size_class, Slab* slab);
+    void FreeCell(Slab* slab, void* cell);
+
+    friend void DeleteDataBlock(DataBlock* block);
+
+ private:
+    SizeClass classes_[CLASS_NUM];
+    std::atomic<uint64_t> slab_cnt_;
+    uint64_t bucket_ms_;
+    int32_t numa_node_;
+    bool huge_page_;
+    struct Chunk {
+        uint32_t used;
+        bool hugetlb;
+    };
+    // the chunks by the address and the slabs not used in them
+    std::mutex chunk_mu_;
+    std::map<uintptr_t, Chunk> chunks_;
+    std::vector<void*> free_slabs_;
+    std::atomic<uint64_t> chunk_cnt_;
+    std::atomic<uint64_t> hugetlb_chunk_cnt_;
+};
+
+}  // namespace storage
+}  // namespace openmldb
+#endif  // SRC_STORAGE_DATA_BLOCK_POOL_H_
@@ -0,0 +1,155 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "storage/data_block_pool.h"
+
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "storage/segment.h"
+
+namespace openmldb {
+namespace storage {
+
+class DataBlockPoolTest : public ::testing::Test {
+ public:
+    DataBlockPoolTest() {}
+    ~DataBlockPoolTest() {}
+};
+
+TEST_F(DataBlockPoolTest, NewAndFree) {
+    DataBlockPool pool;
+    std::string value = "test_value";
+    DataBlock* block = pool.New(2, value.c_str(), value.size());
+    ASSERT_TRUE(block != NULL);
+    ASSERT_TRUE(block->pooled);
+    ASSERT_EQ(2, block->dim_cnt_down);
+    ASSERT_EQ(value, std::string(block->data, block->size));
+    ASSERT_EQ(DataBlockPool::SLAB_SIZE, pool.GetSlabByteSize());
+    DeleteDataBlock(block);
+    std::vector<DataBlockPoolStat> stats;
+    pool.GetStat(&stats);
+    ASSERT_EQ(1u, stats.size());
+    ASSERT_EQ(0u, stats[0].used_cell_cnt);
+}
+
+TEST_F(DataBlockPoolTest, LargeBlock) {
+    DataBlockPool pool;
+    std::string value(8192, 'a');
+    ASSERT_TRUE(pool.New(1, value.c_str(), value.size()) == NULL);
+    DataBlock* block = new DataBlock(1, value.c_str(), value.size());
+    ASSERT_FALSE(block->pooled);
+    DeleteDataBlock(block);
+}
+
+TEST_F(DataBlockPoolTest, ReleaseSlab) {
+    DataBlockPool pool;
+    std::string value(100, 'a');
+    std::vector<DataBlock*> blocks;
+    for (uint32_t i = 0; i < 10000; i++) {
+        blocks.push_back(pool.New(1, value.c_str(), value.size()));
+    }
+    uint64_t slab_byte_size = pool.GetSlabByteSize();
+    ASSERT_GT(slab_byte_size, 10000u * 100);
+    for (auto block : blocks) {
+        DeleteDataBlock(block);
+    }
+    // only one empty slab is kept
+    ASSERT_EQ(DataBlockPool::SLAB_SIZE, pool.GetSlabByteSize());
+    blocks.clear();
+    for (uint32_t i = 0; i < 10000; i++) {
+        DataBlock* block = pool.New(1, value.c_str(), value.size());
+        ASSERT_EQ(value, std::string(block->data, block->size));
+        blocks.push_back(block);
+    }
+    ASSERT_EQ(slab_byte_size, pool.GetSlabByteSize());
+    for (auto block : blocks) {
+        DeleteDataBlock(block);
+    }
+}
+
+TEST_F(DataBlockPoolTest, NumaNode) {
+    DataBlockPool pool;
+    ASSERT_EQ(-1, pool.GetNumaNode());
+    pool.SetNumaNode(0);
+    ASSERT_EQ(0, pool.GetNumaNode());
+    std::string value = "test_value";
+    DataBlock* block = pool.New(1, value.c_str(), value.size());
+    ASSERT_TRUE(block != NULL);
+    ASSERT_EQ(value, std::string(block->data, block->size));
+    DeleteDataBlock(block);
+}
+
+TEST_F(DataBlockPoolTest, HugePage) {
+    DataBlockPool pool;
+    pool.SetHugePage(true);
+    std::string value(100, 'a');
+    std::vector<DataBlock*> blocks;
+    for (uint32_t i = 0; i < 20000; i++) {
+        DataBlock* block = pool.New(1, value.c_str(), value.size());
+        ASSERT_TRUE(block != NULL);
+        blocks.push_back(block);
+    }
+    // the slabs are carved out of the chunks
+    uint64_t slab_byte_size = pool.GetSlabByteSize();
+    ASSERT_GT(slab_byte_size, DataBlockPool::CHUNK_SIZE);
+    ASSERT_GE(pool.GetHugePageByteSize(), slab_byte_size);
+    ASSERT_LT(pool.GetHugePageByteSize(), slab_byte_size + DataBlockPool::CHUNK_SIZE);
+    ASSERT_LE(pool.GetHugeTlbByteSize(), pool.GetHugePageByteSize());
+    for (uint32_t i = 0; i < blocks.size(); i++) {
+        ASSERT_EQ(value, std::string(blocks[i]->data, blocks[i]->size));
+        DeleteDataBlock(blocks[i]);
+    }
+    // only the chunk of the slab kept is left
+    ASSERT_EQ(DataBlockPool::SLAB_SIZE, pool.GetSlabByteSize());
+    ASSERT_EQ(DataBlockPool::CHUNK_SIZE, pool.GetHugePageByteSize());
+}
+
+TEST_F(DataBlockPoolTest, TimeBucket) {
+    std::string value(100, 'a');
+    DataBlockPool pool(1000);
+    DataBlockPool mixed_pool;
+    DataBlockPool new_pool(1000);
+    std::vector<DataBlock*> old_blocks;
+    std::vector<DataBlock*> new_blocks;
+    for (uint32_t i = 0; i < 2000; i++) {
+        old_blocks.push_back(pool.New(1, value.c_str(), value.size(), 500));
+        new_blocks.push_back(pool.New(1, value.c_str(), value.size(), 1500));
+        old_blocks.push_back(mixed_pool.New(1, value.c_str(), value.size(), 500));
+        new_blocks.push_back(mixed_pool.New(1, value.c_str(), value.size(), 1500));
+        new_blocks.push_back(new_pool.New(1, value.c_str(), value.size(), 1500));
+    }
+    for (auto block : old_blocks) {
+        DeleteDataBlock(block);
+    }
+    // the slabs of the expired bucket are released as a whole
+    ASSERT_EQ(new_pool.GetSlabByteSize(), pool.GetSlabByteSize());
+    // the mixed slabs are kept by the newer rows
+    ASSERT_GT(mixed_pool.GetSlabByteSize(), pool.GetSlabByteSize());
+    for (auto block : new_blocks) {
+        DeleteDataBlock(block);
+    }
+    ASSERT_EQ(DataBlockPool::SLAB_SIZE, pool.GetSlabByteSize());
+}
+
+}  // namespace storage
+}  // namespace openmldb
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,782 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "storage/disk_table.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <utility>
+#include <vector>
+
+#include "base/file_util.h"
+#include "base/glog_wapper.h"
+#include "common/timer.h"
+#include "gflags/gflags.h"
+#include "leveldb/cache.h"
+#include "leveldb/write_batch.h"
+
+DECLARE_string(file_compression);
+DECLARE_uint32(block_cache_mb);
+DECLARE_uint32(write_buffer_mb);
+DECLARE_uint32(max_traverse_cnt);
+
+using ::openmldb::base::Slice;
+
+namespace openmldb {
+namespace storage {
+
+// the max rows in a write batch when gc
+static const uint32_t GC_BATCH_SIZE = 1000;
+
+// all of the disk tables share one block cache, so the memory is bounded by block_cache_mb
+static leveldb::Cache* GetBlockCache() {
+    static leveldb::Cache* cache = leveldb::NewLRUCache(static_cast<size_t>(FLAGS_block_cache_mb) << 20);
+    return cache;
+}
+
+static inline void PutFixed32BE(std::string* dst, uint32_t value) {
+    char buf[4];
+    for (int i = 3; i >= 0; i--) {
+        buf[i] = static_cast<char>(value & 0xff);
+        value >>= 8;
+    }
+    dst->append(buf, 4);
+}
+
+static inline void PutFixed64BE(std::string* dst, uint64_t value) {
+    char buf[8];
+    for (int i = 7; i >= 0; i--) {
+        buf[i] = static_cast<char>(value & 0xff);
+        value >>= 8;
+    }
+    dst->append(buf, 8);
+}
+
+static inline uint32_t GetFixed32BE(const char* ptr) {
+    uint32_t value = 0;
+    for (int i = 0; i < 4; i++) {
+        value = (value << 8) | static_cast<uint8_t>(ptr[i]);
+    }
+    return value;
+}
+
+static inline uint64_t GetFixed64BE(const char* ptr) {
+    uint64_t value = 0;
+    for (int i = 0; i < 8; i++) {
+        value = (value << 8) | static_cast<uint8_t>(ptr[i]);
+    }
+    return value;
+}
+
+static inline bool StartsWith(const leveldb::Slice& key, const std::string& prefix) {
+    return key.size() >= prefix.size() && memcmp(key.data(), prefix.data(), prefix.size()) == 0;
+}
+
+std::string DiskTableKey::EncodeIndexPrefix(uint32_t index_id) {
+    std::string key;
+    PutFixed32BE(&key, index_id);
+    return key;
+}
+
+std::string DiskTableKey::EncodePrefix(uint32_t index_id, const ::openmldb::base::Slice& pk) {
+    std::string key;
+    key.reserve(8 + pk.size() + 8);
+    PutFixed32BE(&key, index_id);
+    PutFixed32BE(&key, pk.size());
+    key.append(pk.data(), pk.size());
+    return key;
+}
+
+std::string DiskTableKey::Encode(uint32_t index_id, const ::openmldb::base::Slice& pk, uint64_t ts) {
+    std::string key = EncodePrefix(index_id, pk);
+    PutFixed64BE(&key, ~ts);
+    return key;
+}
+
+bool DiskTableKey::Decode(const ::openmldb::base::Slice& key, uint32_t* index_id, ::openmldb::base::Slice* pk,
+                          uint64_t* ts) {
+    if (key.size() < 16) {
+        return false;
+    }
+    uint32_t pk_size = GetFixed32BE(key.data() + 4);
+    if (key.size() != 16 + pk_size) {
+        return false;
+    }
+    *index_id = GetFixed32BE(key.data());
+    pk->reset(key.data() + 8, pk_size);
+    *ts = ~GetFixed64BE(key.data() + 8 + pk_size);
+    return true;
+}
+
+static inline uint64_t DecodeTs(const leveldb::Slice& key) { return ~GetFixed64BE(key.data() + key.size() - 8); }
+
+DiskTable::DiskTable(const ::openmldb::api::TableMeta& table_meta, const std::string& db_path)
+    : Table(table_meta.name(), table_meta.tid(), table_meta.pid(), 0, true, 60 * 1000,
+            std::map<std::string, uint32_t>(), ::openmldb::type::TTLType::kAbsoluteTime,
+            ::openmldb::type::CompressType::kNoCompress),
+      db_path_(db_path),
+      db_(NULL),
+      enable_gc_(true),
+      record_cnt_(0),
+      count_index_id_(0) {
+    diskused_ = 0;
+    table_meta_ = std::make_shared<::openmldb::api::TableMeta>(table_meta);
+}
+
+DiskTable::~DiskTable() {
+    delete db_;
+    db_ = NULL;
+    PDLOG(INFO, "drop disktable. tid %u pid %u", id_, pid_);
+}
+
+bool DiskTable::Init() {
+    if (!InitFromMeta()) {
+        return false;
+    }
+    if (!::openmldb::base::MkdirRecur(db_path_)) {
+        PDLOG(WARNING, "fail to create path %s. tid %u pid %u", db_path_.c_str(), id_, pid_);
+        return false;
+    }
+    leveldb::Options options;
+    options.create_if_missing = true;
+    options.block_cache = GetBlockCache();
+    options.write_buffer_size = static_cast<size_t>(FLAGS_write_buffer_mb) << 20;
+    if (FLAGS_file_compression == "off") {
+        options.compression = leveldb::kNoCompression;
+    } else {
+        // snappy is the only compression supported by leveldb
+        options.compression = leveldb::kSnappyCompression;
+    }
+    leveldb::Status status = leveldb::DB::Open(options, db_path_, &db_);
+    if (!status.ok()) {
+        PDLOG(WARNING, "fail to open db %s: %s. tid %u pid %u", db_path_.c_str(), status.ToString().c_str(), id_,
+              pid_);
+        db_ = NULL;
+        return false;
+    }
+    auto index_def = GetIndex(0);
+    if (index_def) {
+        count_index_id_ = index_def->GetId();
+    }
+    // count the rows left by the last run
+    uint64_t cnt = 0;
+    std::string prefix = DiskTableKey::EncodeIndexPrefix(count_index_id_);
+    leveldb::Iterator* it = db_->NewIterator(leveldb::ReadOptions());
+    for (it->Seek(prefix); it->Valid() && StartsWith(it->key(), prefix); it->Next()) {
+        cnt++;
+    }
+    delete it;
+    record_cnt_.store(cnt, std::memory_order_relaxed);
+    PDLOG(INFO, "init disk table name %s, id %d, pid %d, path %s, record cnt %lu", name_.c_str(), id_, pid_,
+          db_path_.c_str(), cnt);
+    return true;
+}
+
+bool DiskTable::Put(const std::string& pk, uint64_t time, const char* data, uint32_t size) {
+    auto index_def = GetIndex(0);
+    if (!index_def || !index_def->IsReady()) {
+        return false;
+    }
+    leveldb::Status status = db_->Put(leveldb::WriteOptions(), DiskTableKey::Encode(index_def->GetId(), pk, time),
+                                      leveldb::Slice(data, size));
+    if (!status.ok()) {
+        PDLOG(WARNING, "fail to put pk %s: %s. tid %u pid %u", pk.c_str(), status.ToString().c_str(), id_, pid_);
+        return false;
+    }
+    record_cnt_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+bool DiskTable::Put(uint64_t time, const std::string& value, const Dimensions& dimensions) {
+    leveldb::WriteBatch batch;
+    bool has_count_index = false;
+    std::map<int32_t, Slice> inner_index_key_map;
+    for (auto iter = dimensions.begin(); iter != dimensions.end(); iter++) {
+        int32_t inner_pos = table_index_.GetInnerIndexPos(iter->idx());
+        if (inner_pos < 0) {
+            PDLOG(WARNING, "invalid dimesion. dimesion idx %u, tid %u pid %u", iter->idx(), id_, pid_);
+            return false;
+        }
+        inner_index_key_map.emplace(inner_pos, iter->key());
+    }
+    for (const auto& kv : inner_index_key_map) {
+        auto inner_index = table_index_.GetInnerIndex(kv.first);
+        if (!inner_index) {
+            PDLOG(WARNING, "invalid inner index pos %d. tid %u pid %u", kv.first, id_, pid_);
+            return false;
+        }
+        for (const auto& index_def : inner_index->GetIndex()) {
+            if (index_def->GetTsColumn()) {
+                PDLOG(WARNING, "has set col. tid %u pid %u", id_, pid_);
+                return false;
+            }
+            if (!index_def->IsReady()) {
+                continue;
+            }
+            batch.Put(DiskTableKey::Encode(index_def->GetId(), kv.second, time), value);
+            has_count_index = has_count_index || index_def->GetId() == count_index_id_;
+        }
+    }
+    leveldb::Status status = db_->Write(leveldb::WriteOptions(), &batch);
+    if (!status.ok()) {
+        PDLOG(WARNING, "fail to put: %s. tid %u pid %u", status.ToString().c_str(), id_, pid_);
+        return false;
+    }
+    if (has_count_index) {
+        record_cnt_.fetch_add(1, std::memory_order_relaxed);
+    }
+    return true;
+}
+
+bool DiskTable::Put(const Dimensions& dimensions, const TSDimensions& ts_dimensions, const std::string& value) {
+    if (dimensions.empty() || ts_dimensions.empty()) {
+        PDLOG(WARNING, "empty dimension. tid %u pid %u", id_, pid_);
+        return false;
+    }
+    leveldb::WriteBatch batch;
+    bool has_count_index = false;
+    std::map<int32_t, Slice> inner_index_key_map;
+    for (auto iter = dimensions.begin(); iter != dimensions.end(); iter++) {
+        int32_t inner_pos = table_index_.GetInnerIndexPos(iter->idx());
+        if (inner_pos < 0) {
+            PDLOG(WARNING, "invalid dimension. dimension idx %u, tid %u pid %u", iter->idx(), id_, pid_);
+            return false;
+        }
+        inner_index_key_map.emplace(inner_pos, iter->key());
+    }
+    for (const auto& kv : inner_index_key_map) {
+        auto inner_index = table_index_.GetInnerIndex(kv.first);
+        if (!inner_index) {
+            PDLOG(WARNING, "invalid inner index pos %d. tid %u pid %u", kv.first, id_, pid_);
+            return false;
+        }
+        for (const auto& index_def : inner_index->GetIndex()) {
+            if (!index_def->IsReady()) {
+                continue;
+            }
+            auto ts_col = index_def->GetTsColumn();
+            // the index without ts column uses the first ts like the segment does
+            const ::openmldb::api::TSDimension* ts_dimension = ts_col ? NULL : &ts_dimensions.Get(0);
+            if (ts_col) {
+                for (const auto& cur_ts : ts_dimensions) {
+                    if (static_cast<int>(cur_ts.idx()) == ts_col->GetTsIdx()) {
+                        ts_dimension = &cur_ts;
+                        break;
+                    }
+                }
+            }
+            if (ts_dimension == NULL) {
+                DEBUGLOG("cannot find ts col %d. tid %u pid %u", ts_col->GetTsIdx(), id_, pid_);
+                continue;
+            }
+            batch.Put(DiskTableKey::Encode(index_def->GetId(), kv.second, ts_dimension->ts()), value);
+            has_count_index = has_count_index || index_def->GetId() == count_index_id_;
+        }
+    }
+    leveldb::Status status = db_->Write(leveldb::WriteOptions(), &batch);
+    if (!status.ok()) {
+        PDLOG(WARNING, "fail to put: %s. tid %u pid %u", status.ToString().c_str(), id_, pid_);
+        return false;
+    }
+    if (has_count_index) {
+        record_cnt_.fetch_add(1, std::memory_order_relaxed);
+    }
+    return true;
+}
+
+bool DiskTable::Delete(const std::string& pk, uint32_t idx) {
+    std::shared_ptr<IndexDef> index_def = GetIndex(idx);
+    if (!index_def || !index_def->IsReady()) {
+        return false;
+    }
+    std::string prefix = DiskTableKey::EncodePrefix(index_def->GetId(), pk);
+    leveldb::WriteBatch batch;
+    leveldb::Iterator* it = db_->NewIterator(leveldb::ReadOptions());
+    uint64_t cnt = 0;
+    for (it->Seek(prefix); it->Valid() && StartsWith(it->key(), prefix); it->Next()) {
+        if (it->key().size() != prefix.size() + 8) {
+            continue;
+        }
+        batch.Delete(it->key());
+        cnt++;
+    }
+    delete it;
+    if (cnt == 0) {
+        return false;
+    }
+    return db_->Write(leveldb::WriteOptions(), &batch).ok();
+}
+
+TableIterator* DiskTable::NewIterator(const std::string& pk, Ticket& ticket) { return NewIterator(0, pk, ticket); }
+
+TableIterator* DiskTable::NewIterator(uint32_t index, const std::string& pk, Ticket& ticket) {
+    std::shared_ptr<IndexDef> index_def = table_index_.GetIndex(index);
+    if (!index_def || !index_def->IsReady()) {
+        PDLOG(WARNING, "index %d not found in table, tid %u pid %u", index, id_, pid_);
+        return NULL;
+    }
+    return new DiskTableIterator(db_->NewIterator(leveldb::ReadOptions()),
+                                 DiskTableKey::EncodePrefix(index_def->GetId(), pk));
+}
+
+TableIterator* DiskTable::NewTraverseIterator(uint32_t index) {
+    std::shared_ptr<IndexDef> index_def = GetIndex(index);
+    if (!index_def || !index_def->IsReady()) {
+        PDLOG(WARNING, "index %u not found. tid %u pid %u", index, id_, pid_);
+        return NULL;
+    }
+    uint64_t expire_time = 0;
+    uint64_t expire_cnt = 0;
+    auto ttl = index_def->GetTTL();
+    if (enable_gc_.load(std::memory_order_relaxed)) {
+        expire_time = GetExpireTime(*ttl);
+        expire_cnt = ttl->lat_ttl;
+    }
+    return new DiskTableTraverseIterator(db_->NewIterator(leveldb::ReadOptions()), index_def->GetId(),
+                                         ttl->ttl_type, expire_time, expire_cnt);
+}
+
+::hybridse::vm::WindowIterator* DiskTable::NewWindowIterator(uint32_t index) {
+    std::shared_ptr<IndexDef> index_def = table_index_.GetIndex(index);
+    if (!index_def || !index_def->IsReady()) {
+        LOG(WARNING) << "index" << index << "  not found. tid " << id_ << " pid " << pid_;
+        return NULL;
+    }
+    uint64_t expire_time = 0;
+    uint64_t expire_cnt = 0;
+    auto ttl = index_def->GetTTL();
+    if (enable_gc_.load(std::memory_order_relaxed)) {
+        expire_time = GetExpireTime(*ttl);
+        expire_cnt = ttl->lat_ttl;
+    }
+    return new DiskTableKeyIterator(db_, index_def->GetId(), ttl->ttl_type, expire_time, expire_cnt);
+}
+
+uint64_t DiskTable::GcIndex(const std::shared_ptr<IndexDef>& index_def, uint64_t expire_time,
+                            uint64_t expire_cnt) {
+    TTLSt expire_value(expire_time, expire_cnt, index_def->GetTTLType());
+    std::string prefix = DiskTableKey::EncodeIndexPrefix(index_def->GetId());
+    leveldb::WriteBatch batch;
+    uint32_t batch_cnt = 0;
+    uint64_t gc_cnt = 0;
+    std::string last_pk;
+    uint32_t record_idx = 0;
+    leveldb::Iterator* it = db_->NewIterator(leveldb::ReadOptions());
+    for (it->Seek(prefix); it->Valid() && StartsWith(it->key(), prefix); it->Next()) {
+        uint32_t index_id = 0;
+        ::openmldb::base::Slice pk;
+        uint64_t ts = 0;
+        if (!DiskTableKey::Decode(::openmldb::base::Slice(it->key().data(), it->key().size()), &index_id, &pk,
+                                  &ts)) {
+            continue;
+        }
+        if (last_pk.size() != pk.size() || memcmp(last_pk.data(), pk.data(), pk.size()) != 0) {
+            last_pk.assign(pk.data(), pk.size());
+            record_idx = 0;
+        }
+        record_idx++;
+        if (!expire_value.IsExpired(ts, record_idx)) {
+            continue;
+        }
+        batch.Delete(it->key());
+        gc_cnt++;
+        if (++batch_cnt >= GC_BATCH_SIZE) {
+            db_->Write(leveldb::WriteOptions(), &batch);
+            batch.Clear();
+            batch_cnt = 0;
+        }
+    }
+    delete it;
+    if (batch_cnt > 0) {
+        db_->Write(leveldb::WriteOptions(), &batch);
+    }
+    return gc_cnt;
+}
+
+void DiskTable::SchedGc() {
+    uint64_t consumed = ::baidu::common::timer::get_micros();
+    PDLOG(INFO, "start making gc for disk table %s, tid %u, pid %u", name_.c_str(), id_, pid_);
+    uint64_t gc_record_cnt = 0;
+    if (enable_gc_.load(std::memory_order_relaxed)) {
+        for (const auto& index_def : table_index_.GetAllIndex()) {
+            if (!index_def || !index_def->IsReady()) {
+                continue;
+            }
+            auto ttl = index_def->GetTTL();
+            if (!ttl->NeedGc()) {
+                continue;
+            }
+            uint64_t gc_cnt = GcIndex(index_def, GetExpireTime(*ttl), ttl->lat_ttl);
+            if (index_def->GetId() == count_index_id_) {
+                gc_record_cnt = gc_cnt;
+            }
+        }
+    }
+    record_cnt_.fetch_sub(std::min(gc_record_cnt, record_cnt_.load(std::memory_order_relaxed)),
+                          std::memory_order_relaxed);
+    consumed = ::baidu::common::timer::get_micros() - consumed;
+    PDLOG(INFO, "gc finished, gc_record_cnt %lu consumed %lu ms for disk table %s tid %u pid %u", gc_record_cnt,
+          consumed / 1000, name_.c_str(), id_, pid_);
+    UpdateTTL();
+}
+
+// tll as ms
+uint64_t DiskTable::GetExpireTime(const TTLSt& ttl_st) {
+    if (!enable_gc_.load(std::memory_order_relaxed) || ttl_st.abs_ttl == 0 ||
+        ttl_st.ttl_type == ::openmldb::storage::TTLType::kLatestTime) {
+        return 0;
+    }
+    uint64_t cur_time = ::baidu::common::timer::get_micros() / 1000;
+    return cur_time - ttl_st.abs_ttl;
+}
+
+bool DiskTable::IsExpire(const ::openmldb::api::LogEntry& entry) {
+    if (!enable_gc_.load(std::memory_order_relaxed)) {
+        return false;
+    }
+    std::map<uint32_t, uint64_t> ts_dimemsions_map;
+    for (auto iter = entry.ts_dimensions().begin(); iter != entry.ts_dimensions().end(); iter++) {
+        ts_dimemsions_map.insert(std::make_pair(iter->idx(), iter->ts()));
+    }
+    std::vector<std::pair<uint32_t, std::string>> index_key_vec;
+    if (entry.dimensions_size() > 0) {
+        for (auto iter = entry.dimensions().begin(); iter != entry.dimensions().end(); iter++) {
+            index_key_vec.emplace_back(iter->idx(), iter->key());
+        }
+    } else {
+        index_key_vec.emplace_back(0, entry.pk());
+    }
+    for (const auto& kv : index_key_vec) {
+        int32_t inner_pos = table_index_.GetInnerIndexPos(kv.first);
+        auto inner_index = inner_pos < 0 ? nullptr : table_index_.GetInnerIndex(inner_pos);
+        if (!inner_index) {
+            continue;
+        }
+        for (const auto& index_def : inner_index->GetIndex()) {
+            if (!index_def || !index_def->IsReady()) {
+                continue;
+            }
+            auto ttl = index_def->GetTTL();
+            if (!ttl->NeedGc()) {
+                return false;
+            }
+            uint64_t ts = entry.ts();
+            auto ts_col = index_def->GetTsColumn();
+            if (ts_col) {
+                auto iter = ts_dimemsions_map.find(ts_col->GetTsIdx());
+                if (iter == ts_dimemsions_map.end()) {
+                    continue;
+                }
+                ts = iter->second;
+            }
+            // the record is older than the lat_ttl-th newest record of the pk
+            bool latest_expire = false;
+            if (ttl->lat_ttl > 0) {
+                std::string prefix = DiskTableKey::EncodePrefix(index_def->GetId(), kv.second);
+                leveldb::Iterator* it = db_->NewIterator(leveldb::ReadOptions());
+                uint64_t cnt = 0;
+                for (it->Seek(prefix); it->Valid() && StartsWith(it->key(), prefix); it->Next()) {
+                    if (++cnt >= ttl->lat_ttl) {
+                        latest_expire = ts < DecodeTs(it->key());
+                        break;
+                    }
+                }
+                delete it;
+            }
+            bool abs_expire = ts < GetExpireTime(*ttl);
+            bool is_expire = false;
+            switch (index_def->GetTTLType()) {
+                case ::openmldb::storage::TTLType::kLatestTime:
+                    is_expire = latest_expire;
+                    break;
+                case ::openmldb::storage::TTLType::kAbsoluteTime:
+                    is_expire = abs_expire;
+                    break;
+                case ::openmldb::storage::TTLType::kAbsOrLat:
+                    is_expire = abs_expire || latest_expire;
+                    break;
+                case ::openmldb::storage::TTLType::kAbsAndLat:
+                    is_expire = abs_expire && latest_expire;
+                    break;
+                default:
+                    return true;
+            }
+            if (!is_expire) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+DiskTableIterator::DiskTableIterator(leveldb::Iterator* it, const std::string& prefix) : it_(it), prefix_(prefix) {}
+
+DiskTableIterator::~DiskTableIterator() { delete it_; }
+
+bool DiskTableIterator::Valid() {
+    return it_->Valid() && StartsWith(it_->key(), prefix_) && it_->key().size() == prefix_.size() + 8;
+}
+
+void DiskTableIterator::Next() { it_->Next(); }
+
+openmldb::base::Slice DiskTableIterator::GetValue() const {
+    return openmldb::base::Slice(it_->value().data(), it_->value().size());
+}
+
+std::string DiskTableIterator::GetPK() const { return prefix_.substr(8); }
+
+uint64_t DiskTableIterator::GetKey() const { return DecodeTs(it_->key()); }
+
+void DiskTableIterator::SeekToFirst() { it_->Seek(prefix_); }
+
+void DiskTableIterator::Seek(uint64_t time) {
+    std::string key = prefix_;
+    PutFixed64BE(&key, ~time);
+    it_->Seek(key);
+}
+
+DiskTableTraverseIterator::DiskTableTraverseIterator(leveldb::Iterator* it, uint32_t index_id,
+                                                     ::openmldb::storage::TTLType ttl_type, uint64_t expire_time,
+                                                     uint64_t expire_cnt)
+    : it_(it),
+      index_id_(index_id),
+      prefix_(DiskTableKey::EncodeIndexPrefix(index_id)),
+      expire_value_(expire_time, expire_cnt, ttl_type),
+      pk_(),
+      ts_(0),
+      record_idx_(0),
+      traverse_cnt_(0) {}
+
+DiskTableTraverseIterator::~DiskTableTraverseIterator() { delete it_; }
+
+bool DiskTableTraverseIterator::ParseKey() {
+    if (!it_->Valid() || !StartsWith(it_->key(), prefix_)) {
+        return false;
+    }
+    uint32_t index_id = 0;
+    ::openmldb::base::Slice pk;
+    uint64_t ts = 0;
+    if (!DiskTableKey::Decode(::openmldb::base::Slice(it_->key().data(), it_->key().size()), &index_id, &pk, &ts)) {
+        return false;
+    }
+    if (pk_.size() != pk.size() || memcmp(pk_.data(), pk.data(), pk.size()) != 0) {
+        pk_.assign(pk.data(), pk.size());
+        record_idx_ = 0;
+    }
+    record_idx_++;
+    ts_ = ts;
+    return true;
+}
+
+void DiskTableTraverseIterator::NextPK() {
+    // the smallest ts of the pk is the last one
+    std::string last = DiskTableKey::Encode(index_id_, pk_, 0);
+    it_->Seek(last);
+    if (it_->Valid() && it_->key() == leveldb::Slice(last)) {
+        it_->Next();
+    }
+    traverse_cnt_++;
+}
+
+void DiskTableTraverseIterator::SkipExpired() {
+    while (ParseKey() && expire_value_.IsExpired(ts_, record_idx_)) {
+        // the rest rows of the pk are expired too
+        NextPK();
+        if (traverse_cnt_ >= FLAGS_max_traverse_cnt) {
+            ParseKey();
+            break;
+        }
+    }
+}
+
+bool DiskTableTraverseIterator::Valid() {
+    return it_->Valid() && StartsWith(it_->key(), prefix_) && !expire_value_.IsExpired(ts_, record_idx_);
+}
+
+void DiskTableTraverseIterator::Next() {
+    it_->Next();
+    traverse_cnt_++;
+    SkipExpired();
+}
+
+uint64_t DiskTableTraverseIterator::GetCount() const { return traverse_cnt_; }
+
+openmldb::base::Slice DiskTableTraverseIterator::GetValue() const {
+    return openmldb::base::Slice(it_->value().data(), it_->value().size());
+}
+
+std::string DiskTableTraverseIterator::GetPK() const { return pk_; }
+
+uint64_t DiskTableTraverseIterator::GetKey() const { return ts_; }
+
+void DiskTableTraverseIterator::SeekToFirst() {
+    pk_.clear();
+    record_idx_ = 0;
+    it_->Seek(prefix_);
+    traverse_cnt_++;
+    SkipExpired();
+}
+
+void DiskTableTraverseIterator::Seek(const std::string& pk, uint64_t ts) {
+    pk_.clear();
+    record_idx_ = 0;
+    if (expire_value_.ttl_type == ::openmldb::storage::TTLType::kLatestTime ||
+        expire_value_.ttl_type == ::openmldb::storage::TTLType::kAbsAndLat ||
+        expire_value_.ttl_type == ::openmldb::storage::TTLType::kAbsOrLat) {
+        // the record index is needed to check the latest ttl, so walk from the first row of the pk
+        it_->Seek(DiskTableKey::EncodePrefix(index_id_, pk));
+        while (ParseKey()) {
+            traverse_cnt_++;
+            if (pk_ == pk && ts_ >= ts) {
+                it_->Next();
+                continue;
+            }
+            if (!expire_value_.IsExpired(ts_, record_idx_)) {
+                return;
+            }
+            NextPK();
+            break;
+        }
+        SkipExpired();
+        return;
+    }
+    std::string key = DiskTableKey::Encode(index_id_, pk, ts);
+    it_->Seek(key);
+    if (it_->Valid() && it_->key() == leveldb::Slice(key)) {
+        it_->Next();
+    }
+    traverse_cnt_++;
+    SkipExpired();
+}
+
+DiskTableRowIterator::DiskTableRowIterator(leveldb::Iterator* it, const std::string& prefix,
+                                           ::openmldb::storage::TTLType ttl_type, uint64_t expire_time,
+                                           uint64_t expire_cnt)
+    : it_(it), prefix_(prefix), record_idx_(1), expire_value_(expire_time, expire_cnt, ttl_type), ts_(0), row_() {}
+
+DiskTableRowIterator::~DiskTableRowIterator() { delete it_; }
+
+void DiskTableRowIterator::ParseTs() {
+    if (it_->Valid() && StartsWith(it_->key(), prefix_) && it_->key().size() == prefix_.size() + 8) {
+        ts_ = DecodeTs(it_->key());
+    }
+}
+
+bool DiskTableRowIterator::Valid() const {
+    if (!it_->Valid() || !StartsWith(it_->key(), prefix_) || it_->key().size() != prefix_.size() + 8) {
+        return false;
+    }
+    return !expire_value_.IsExpired(ts_, record_idx_);
+}
+
+void DiskTableRowIterator::Next() {
+    it_->Next();
+    record_idx_++;
+    ParseTs();
+}
+
+const uint64_t& DiskTableRowIterator::GetKey() const { return ts_; }
+
+const ::hybridse::codec::Row& DiskTableRowIterator::GetValue() {
+    // the value is owned by leveldb and may be released by Next, so the row keeps a copy
+    size_t size = it_->value().size();
+    auto slice = ::hybridse::base::RefCountedSlice::Allocate(size);
+    memcpy(slice.buf(), it_->value().data(), size);
+    row_ = ::hybridse::codec::Row(slice);
+    return row_;
+}
+
+void DiskTableRowIterator::Seek(const uint64_t& key) {
+    std::string seek_key = prefix_;
+    PutFixed64BE(&seek_key, ~key);
+    it_->Seek(seek_key);
+    ParseTs();
+}
+
+void DiskTableRowIterator::SeekToFirst() {
+    it_->Seek(prefix_);
+    record_idx_ = 1;
+    ParseTs();
+}
+
+DiskTableKeyIterator::DiskTableKeyIterator(leveldb::DB* db, uint32_t index_id, ::openmldb::storage::TTLType ttl_type,
+                                           uint64_t expire_time, uint64_t expire_cnt)
+    : db_(db),
+      it_(db->NewIterator(leveldb::ReadOptions())),
+      index_id_(index_id),
+      index_prefix_(DiskTableKey::EncodeIndexPrefix(index_id)),
+      ttl_type_(ttl_type),
+      expire_time_(expire_time),
+      expire_cnt_(expire_cnt),
+      pk_() {}
+
+DiskTableKeyIterator::~DiskTableKeyIterator() { delete it_; }
+
+void DiskTableKeyIterator::ParseKey() {
+    if (!Valid()) {
+        return;
+    }
+    uint32_t index_id = 0;
+    ::openmldb::base::Slice pk;
+    uint64_t ts = 0;
+    if (DiskTableKey::Decode(::openmldb::base::Slice(it_->key().data(), it_->key().size()), &index_id, &pk, &ts)) {
+        pk_.assign(pk.data(), pk.size());
+    }
+}
+
+void DiskTableKeyIterator::SeekToFirst() {
+    it_->Seek(index_prefix_);
+    ParseKey();
+}
+
+void DiskTableKeyIterator::Seek(const std::string& key) {
+    it_->Seek(DiskTableKey::EncodePrefix(index_id_, key));
+    ParseKey();
+}
+
+bool DiskTableKeyIterator::Valid() { return it_->Valid() && StartsWith(it_->key(), index_prefix_); }
+
+void DiskTableKeyIterator::Next() {
+    // the smallest ts of the pk is the last one
+    std::string last = DiskTableKey::Encode(index_id_, pk_, 0);
+    it_->Seek(last);
+    if (it_->Valid() && it_->key() == leveldb::Slice(last)) {
+        it_->Next();
+    }
+    ParseKey();
+}
+
+::hybridse::vm::RowIterator* DiskTableKeyIterator::GetRawValue() {
+    DiskTableRowIterator* it = new DiskTableRowIterator(db_->NewIterator(leveldb::ReadOptions()),
+                                                        DiskTableKey::EncodePrefix(index_id_, pk_), ttl_type_,
+                                                        expire_time_, expire_cnt_);
+    it->SeekToFirst();
+    return it;
+}
+
+std::unique_ptr<::hybridse::vm::RowIterator> DiskTableKeyIterator::GetValue() {
+    return std::unique_ptr<::hybridse::vm::RowIterator>(GetRawValue());
+}
+
+const hybridse::codec::Row DiskTableKeyIterator::GetKey() {
+    auto slice = ::hybridse::base::RefCountedSlice::Allocate(pk_.size());
+    memcpy(slice.buf(), pk_.data(), pk_.size());
+    return hybridse::codec::Row(slice);
+}
+
+}  // namespace storage
+}  // namespace openmldb
@@ -0,0 +1,211 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_STORAGE_DISK_TABLE_H_
+#define SRC_STORAGE_DISK_TABLE_H_
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <string>
+
+#include "base/slice.h"
+#include "leveldb/db.h"
+#include "proto/tablet.pb.h"
+#include "storage/iterator.h"
+#include "storage/table.h"
+#include "storage/ticket.h"
+#include "vm/catalog.h"
+
+namespace openmldb {
+namespace storage {
+
+// The key layout of a row in leveldb is
+// | index id (4 bytes) | pk size (4 bytes) | pk | ~ts (8 bytes) |
+// all in big endian, so the rows of one pk are adjacent and the newer one comes first
+class DiskTableKey {
+ public:
+    static std::string Encode(uint32_t index_id, const ::openmldb::base::Slice& pk, uint64_t ts);
+    // the prefix of all rows of the pk in the index
+    static std::string EncodePrefix(uint32_t index_id, const ::openmldb::base::Slice& pk);
+    // the prefix of all rows in the index
+    static std::string EncodeIndexPrefix(uint32_t index_id);
+    // return false if the key is not encoded by Encode
+    static bool Decode(const ::openmldb::base::Slice& key, uint32_t* index_id, ::openmldb::base::Slice* pk,
+                       uint64_t* ts);
+};
+
+class DiskTableIterator : public TableIterator {
+ public:
+    // take the ownership of it
+    DiskTableIterator(leveldb::Iterator* it, const std::string& prefix);
+    ~DiskTableIterator() override;
+    bool Valid() override;
+    void Next() override;
+    openmldb::base::Slice GetValue() const override;
+    std::string GetPK() const override;
+    uint64_t GetKey() const override;
+    void SeekToFirst() override;
+    void Seek(uint64_t time) override;
+
+ private:
+    leveldb::Iterator* it_;
+    std::string prefix_;
+};
+
+class DiskTableTraverseIterator : public TableIterator {
+ public:
+    DiskTableTraverseIterator(leveldb::Iterator* it, uint32_t index_id, ::openmldb::storage::TTLType ttl_type,
+                              uint64_t expire_time, uint64_t expire_cnt);
+    ~DiskTableTraverseIterator() override;
+    bool Valid() override;
+    void Next() override;
+    openmldb::base::Slice GetValue() const override;
+    std::string GetPK() const override;
+    uint64_t GetKey() const override;
+    void SeekToFirst() override;
+    // seek to the first row after the pk and ts
+    void Seek(const std::string& pk, uint64_t time) override;
+    uint64_t GetCount() const override;
+    void ResetCount() override { traverse_cnt_ = 0; }
+
+ private:
+    // parse the current row and skip it if it is expired
+    void SkipExpired();
+    // jump to the first row of the next pk
+    void NextPK();
+    // parse the current key, return false if it is out of the index
+    bool ParseKey();
+
+ private:
+    leveldb::Iterator* it_;
+    uint32_t index_id_;
+    std::string prefix_;
+    TTLSt expire_value_;
+    std::string pk_;
+    uint64_t ts_;
+    uint32_t record_idx_;
+    uint64_t traverse_cnt_;
+};
+
+class DiskTableRowIterator : public ::hybridse::vm::RowIterator {
+ public:
+    DiskTableRowIterator(leveldb::Iterator* it, const std::string& prefix, ::openmldb::storage::TTLType ttl_type,
+                         uint64_t expire_time, uint64_t expire_cnt);
+    ~DiskTableRowIterator() override;
+    bool Valid() const override;
+    void Next() override;
+    const uint64_t& GetKey() const override;
+    const ::hybridse::codec::Row& GetValue() override;
+    void Seek(const uint64_t& key) override;
+    void SeekToFirst() override;
+    bool IsSeekable() const override { return true; }
+
+ private:
+    void ParseTs();
+
+ private:
+    leveldb::Iterator* it_;
+    std::string prefix_;
+    uint32_t record_idx_;
+    TTLSt expire_value_;
+    uint64_t ts_;
+    ::hybridse::codec::Row row_;
+};
+
+class DiskTableKeyIterator : public ::hybridse::vm::WindowIterator {
+ public:
+    DiskTableKeyIterator(leveldb::DB* db, uint32_t index_id, ::openmldb::storage::TTLType ttl_type,
+                         uint64_t expire_time, uint64_t expire_cnt);
+    ~DiskTableKeyIterator() override;
+    void Seek(const std::string& key) override;
+    void SeekToFirst() override;
+    void Next() override;
+    bool Valid() override;
+    std::unique_ptr<::hybridse::vm::RowIterator> GetValue() override;
+    ::hybridse::vm::RowIterator* GetRawValue() override;
+    const hybridse::codec::Row GetKey() override;
+
+ private:
+    void ParseKey();
+
+ private:
+    leveldb::DB* db_;
+    leveldb::Iterator* it_;
+    uint32_t index_id_;
+    std::string index_prefix_;
+    ::openmldb::storage::TTLType ttl_type_;
+    uint64_t expire_time_;
+    uint64_t expire_cnt_;
+    std::string pk_;
+};
+
+// Table whose rows are stored in leveldb, the hot blocks are cached in a block cache
+// shared by all of the disk tables in the process
+class DiskTable : public Table {
+ public:
+    DiskTable(const ::openmldb::api::TableMeta& table_meta, const std::string& db_path);
+    virtual ~DiskTable();
+    DiskTable(const DiskTable&) = delete;
+    DiskTable& operator=(const DiskTable&) = delete;
+
+    bool Init() override;
+
+    bool Put(const std::string& pk, uint64_t time, const char* data, uint32_t size) override;
+
+    bool Put(uint64_t time, const std::string& value, const Dimensions& dimensions) override;
+
+    bool Put(const Dimensions& dimensions, const TSDimensions& ts_dimensions, const std::string& value) override;
+
+    bool Delete(const std::string& pk, uint32_t idx) override;
+
+    // the ticket is useless as the iterator holds a leveldb snapshot
+    TableIterator* NewIterator(const std::string& pk, Ticket& ticket) override;
+
+    TableIterator* NewIterator(uint32_t index, const std::string& pk, Ticket& ticket) override;
+
+    TableIterator* NewTraverseIterator(uint32_t index) override;
+
+    ::hybridse::vm::WindowIterator* NewWindowIterator(uint32_t index) override;
+
+    void SchedGc() override;
+
+    uint64_t GetRecordCnt() const override { return record_cnt_.load(std::memory_order_relaxed); }
+
+    bool IsExpire(const ::openmldb::api::LogEntry& entry) override;
+
+    uint64_t GetExpireTime(const TTLSt& ttl_st) override;
+
+    inline void SetExpire(bool is_expire) { enable_gc_.store(is_expire, std::memory_order_relaxed); }
+
+    const std::string& GetDBPath() const { return db_path_; }
+
+ private:
+    uint64_t GcIndex(const std::shared_ptr<IndexDef>& index_def, uint64_t expire_time, uint64_t expire_cnt);
+
+ private:
+    std::string db_path_;
+    leveldb::DB* db_;
+    std::atomic<bool> enable_gc_;
+    std::atomic<uint64_t> record_cnt_;
+    // the first ready index which is used to count the records
+    uint32_t count_index_id_;
+};
+
+}  // namespace storage
+}  // namespace openmldb
+
+#endif  // SRC_STORAGE_DISK_TABLE_H_
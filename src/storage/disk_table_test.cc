@@ -0,0 +1,227 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "storage/disk_table.h"
+
+#include <gflags/gflags.h>
+
+#include <string>
+
+#include "base/file_util.h"
+#include "base/glog_wapper.h"
+#include "codec/schema_codec.h"
+#include "common/timer.h"
+#include "gtest/gtest.h"
+#include "storage/ticket.h"
+
+DECLARE_uint32(max_traverse_cnt);
+
+namespace openmldb {
+namespace storage {
+
+using ::openmldb::codec::SchemaCodec;
+
+class DiskTableTest : public ::testing::Test {
+ public:
+    DiskTableTest() {}
+    ~DiskTableTest() {}
+};
+
+inline std::string GenDBPath() { return "/tmp/disk_table_test/" + std::to_string(rand() % 10000000 + 1); }  // NOLINT
+
+void BuildDiskTableMeta(::openmldb::api::TableMeta* table_meta, const std::string& ts_name,
+                        ::openmldb::type::TTLType ttl_type, uint64_t abs_ttl, uint64_t lat_ttl) {
+    table_meta->set_name("table1");
+    table_meta->set_tid(1);
+    table_meta->set_pid(0);
+    table_meta->set_mode(::openmldb::api::TableMode::kTableLeader);
+    table_meta->set_storage_mode(::openmldb::type::kSSD);
+    SchemaCodec::SetColumnDesc(table_meta->add_column_desc(), "card", ::openmldb::type::kString);
+    SchemaCodec::SetColumnDesc(table_meta->add_column_desc(), "mcc", ::openmldb::type::kString);
+    SchemaCodec::SetColumnDesc(table_meta->add_column_desc(), "ts1", ::openmldb::type::kBigInt);
+    SchemaCodec::SetIndex(table_meta->add_column_key(), "card", "card", ts_name, ttl_type, abs_ttl, lat_ttl);
+    SchemaCodec::SetIndex(table_meta->add_column_key(), "mcc", "mcc", ts_name, ttl_type, abs_ttl, lat_ttl);
+}
+
+TEST_F(DiskTableTest, KeyCodec) {
+    std::string key = DiskTableKey::Encode(3, "pk", 9527);
+    uint32_t index_id = 0;
+    ::openmldb::base::Slice pk;
+    uint64_t ts = 0;
+    ASSERT_TRUE(DiskTableKey::Decode(key, &index_id, &pk, &ts));
+    ASSERT_EQ(3u, index_id);
+    ASSERT_EQ("pk", pk.ToString());
+    ASSERT_EQ(9527u, ts);
+    ASSERT_EQ(0, key.compare(0, 10, DiskTableKey::EncodePrefix(3, "pk")));
+    // the newer row comes first
+    ASSERT_LT(DiskTableKey::Encode(3, "pk", 9528), DiskTableKey::Encode(3, "pk", 9527));
+    ASSERT_FALSE(DiskTableKey::Decode(DiskTableKey::EncodePrefix(3, "pk"), &index_id, &pk, &ts));
+}
+
+TEST_F(DiskTableTest, Put) {
+    ::openmldb::api::TableMeta table_meta;
+    BuildDiskTableMeta(&table_meta, "", ::openmldb::type::kAbsoluteTime, 0, 0);
+    std::string path = GenDBPath();
+    DiskTable* table = new DiskTable(table_meta, path);
+    ASSERT_TRUE(table->Init());
+    ASSERT_TRUE(table->Put("card0", 9527, "value1", 6));
+    ASSERT_TRUE(table->Put("card0", 9528, "value2", 6));
+    ASSERT_TRUE(table->Put("card1", 100, "value3", 6));
+    ASSERT_EQ(3u, table->GetRecordCnt());
+    Ticket ticket;
+    TableIterator* it = table->NewIterator(0, "card0", ticket);
+    it->SeekToFirst();
+    ASSERT_TRUE(it->Valid());
+    ASSERT_EQ(9528u, it->GetKey());
+    ASSERT_EQ("value2", it->GetValue().ToString());
+    it->Next();
+    ASSERT_TRUE(it->Valid());
+    ASSERT_EQ(9527u, it->GetKey());
+    ASSERT_EQ("value1", it->GetValue().ToString());
+    it->Next();
+    ASSERT_FALSE(it->Valid());
+    it->Seek(9527);
+    ASSERT_TRUE(it->Valid());
+    ASSERT_EQ(9527u, it->GetKey());
+    delete it;
+    delete table;
+
+    // the rows are reloaded after the table is reopened
+    table = new DiskTable(table_meta, path);
+    ASSERT_TRUE(table->Init());
+    ASSERT_EQ(3u, table->GetRecordCnt());
+    ASSERT_TRUE(table->Delete("card0", 0));
+    it = table->NewIterator(0, "card0", ticket);
+    it->SeekToFirst();
+    ASSERT_FALSE(it->Valid());
+    delete it;
+    delete table;
+    ::openmldb::base::RemoveDirRecursive(path);
+}
+
+TEST_F(DiskTableTest, MultiDimensionPut) {
+    ::openmldb::api::TableMeta table_meta;
+    BuildDiskTableMeta(&table_meta, "ts1", ::openmldb::type::kAbsoluteTime, 0, 0);
+    std::string path = GenDBPath();
+    DiskTable table(table_meta, path);
+    ASSERT_TRUE(table.Init());
+    Dimensions dimensions;
+    auto dim = dimensions.Add();
+    dim->set_key("card0");
+    dim->set_idx(0);
+    dim = dimensions.Add();
+    dim->set_key("mcc0");
+    dim->set_idx(1);
+    TSDimensions ts_dimensions;
+    auto ts_dim = ts_dimensions.Add();
+    ts_dim->set_ts(9527);
+    ts_dim->set_idx(0);
+    ASSERT_TRUE(table.Put(dimensions, ts_dimensions, "value"));
+    ASSERT_EQ(1u, table.GetRecordCnt());
+    Ticket ticket;
+    TableIterator* it = table.NewIterator(1, "mcc0", ticket);
+    it->SeekToFirst();
+    ASSERT_TRUE(it->Valid());
+    ASSERT_EQ(9527u, it->GetKey());
+    ASSERT_EQ("value", it->GetValue().ToString());
+    delete it;
+
+    ::hybridse::vm::WindowIterator* wit = table.NewWindowIterator(0);
+    wit->SeekToFirst();
+    ASSERT_TRUE(wit->Valid());
+    ASSERT_EQ("card0", wit->GetKey().ToString());
+    auto row_it = wit->GetValue();
+    ASSERT_TRUE(row_it->Valid());
+    ASSERT_EQ(9527u, row_it->GetKey());
+    ASSERT_EQ("value", row_it->GetValue().ToString());
+    row_it->Next();
+    ASSERT_FALSE(row_it->Valid());
+    wit->Next();
+    ASSERT_FALSE(wit->Valid());
+    delete wit;
+    ::openmldb::base::RemoveDirRecursive(path);
+}
+
+TEST_F(DiskTableTest, TraverseIterator) {
+    ::openmldb::api::TableMeta table_meta;
+    BuildDiskTableMeta(&table_meta, "", ::openmldb::type::kLatestTime, 0, 2);
+    std::string path = GenDBPath();
+    DiskTable table(table_meta, path);
+    ASSERT_TRUE(table.Init());
+    table.Put("pk", 9527, "test1", 5);
+    table.Put("pk1", 9527, "test2", 5);
+    table.Put("pk", 9528, "test3", 5);
+    table.Put("pk1", 100, "test4", 5);
+    table.Put("test", 20, "test5", 5);
+    table.Put("pk", 200, "test6", 5);
+    TableIterator* it = table.NewTraverseIterator(0);
+    it->SeekToFirst();
+    uint32_t cnt = 0;
+    while (it->Valid()) {
+        cnt++;
+        it->Next();
+    }
+    // only the latest two rows of each pk are visible
+    ASSERT_EQ(5u, cnt);
+    it->Seek("pk", 9528);
+    ASSERT_TRUE(it->Valid());
+    ASSERT_EQ("pk", it->GetPK());
+    ASSERT_EQ(9527u, it->GetKey());
+    it->Next();
+    ASSERT_TRUE(it->Valid());
+    ASSERT_EQ("pk1", it->GetPK());
+    ASSERT_EQ(9527u, it->GetKey());
+    delete it;
+    ::openmldb::base::RemoveDirRecursive(path);
+}
+
+TEST_F(DiskTableTest, SchedGc) {
+    ::openmldb::api::TableMeta table_meta;
+    BuildDiskTableMeta(&table_meta, "", ::openmldb::type::kAbsoluteTime, 1, 0);
+    std::string path = GenDBPath();
+    DiskTable table(table_meta, path);
+    ASSERT_TRUE(table.Init());
+    uint64_t now = ::baidu::common::timer::get_micros() / 1000;
+    table.Put("card0", now, "value1", 6);
+    table.Put("card0", now - 2 * 60 * 1000, "value2", 6);
+    table.Put("card1", now - 3 * 60 * 1000, "value3", 6);
+    ASSERT_EQ(3u, table.GetRecordCnt());
+    ::openmldb::api::LogEntry entry;
+    entry.set_pk("card1");
+    entry.set_ts(now - 3 * 60 * 1000);
+    ASSERT_TRUE(table.IsExpire(entry));
+    table.SchedGc();
+    ASSERT_EQ(1u, table.GetRecordCnt());
+    Ticket ticket;
+    TableIterator* it = table.NewIterator(0, "card0", ticket);
+    it->SeekToFirst();
+    ASSERT_TRUE(it->Valid());
+    ASSERT_EQ(now, it->GetKey());
+    it->Next();
+    ASSERT_FALSE(it->Valid());
+    delete it;
+    ::openmldb::base::RemoveDirRecursive(path);
+}
+
+}  // namespace storage
+}  // namespace openmldb
+
+int main(int argc, char** argv) {
+    FLAGS_max_traverse_cnt = 200000;
+    ::testing::InitGoogleTest(&argc, argv);
+    ::openmldb::base::SetLogLevel(INFO);
+    return RUN_ALL_TESTS();
+}
@@ -39,6 +39,10 @@ class TableIterator {
     virtual void Seek(const std::string& pk, uint64_t time) {}
     virtual void Seek(uint64_t time) {}
     virtual uint64_t GetCount() const { return 0; }
+    // restart the count, e.g. for the next page of a traverse
+    virtual void ResetCount() {}
+    // whether the value got last stays valid as long as the iterator rather than until it moves
+    virtual bool IsValuePinned() const { return false; }
 };
 
 }  // namespace storage
@@ -0,0 +1,169 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "storage/mapped_snapshot.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "base/glog_wapper.h"
+
+namespace openmldb {
+namespace storage {
+
+static const uint32_t MAPPED_SNAPSHOT_MAGIC = 0x4d4d5344;
+static const uint32_t MAPPED_SNAPSHOT_VERSION = 1;
+static const uint64_t MAPPED_SNAPSHOT_HEADER_SIZE = 16;
+static const uint64_t MAPPED_RECORD_HEADER_SIZE = 8;
+static const uint64_t MAPPED_RECORD_ALIGN = 8;
+
+static inline uint64_t AlignRecord(uint64_t size) {
+    return (size + MAPPED_RECORD_ALIGN - 1) & ~(MAPPED_RECORD_ALIGN - 1);
+}
+
+MappedSnapshotWriter::MappedSnapshotWriter(const std::string& path) : path_(path), fd_(NULL), count_(0), buf_() {}
+
+MappedSnapshotWriter::~MappedSnapshotWriter() {
+    if (fd_ != NULL) {
+        fclose(fd_);
+        fd_ = NULL;
+    }
+}
+
+bool MappedSnapshotWriter::Open() {
+    fd_ = fopen(path_.c_str(), "wb");
+    if (fd_ == NULL) {
+        PDLOG(WARNING, "fail to create file %s for error %s", path_.c_str(), strerror(errno));
+        return false;
+    }
+    // the count is filled by Close, so a broken file is never taken as complete
+    char header[MAPPED_SNAPSHOT_HEADER_SIZE] = {0};
+    memcpy(header, &MAPPED_SNAPSHOT_MAGIC, 4);
+    memcpy(header + 4, &MAPPED_SNAPSHOT_VERSION, 4);
+    return WriteBytes(header, sizeof(header));
+}
+
+bool MappedSnapshotWriter::WriteBytes(const void* data, size_t size) {
+    if (fwrite(data, 1, size, fd_) != size) {
+        PDLOG(WARNING, "fail to write file %s for error %s", path_.c_str(), strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+bool MappedSnapshotWriter::Write(::openmldb::api::LogEntry* entry) {
+    std::string value;
+    value.swap(*entry->mutable_value());
+    entry->clear_value();
+    buf_.clear();
+    entry->SerializeToString(&buf_);
+    uint32_t sizes[2] = {static_cast<uint32_t>(buf_.size()), static_cast<uint32_t>(value.size())};
+    uint64_t record_size = MAPPED_RECORD_HEADER_SIZE + buf_.size() + value.size();
+    static const char padding[MAPPED_RECORD_ALIGN] = {0};
+    if (!WriteBytes(sizes, sizeof(sizes)) || !WriteBytes(buf_.data(), buf_.size()) ||
+        !WriteBytes(value.data(), value.size()) ||
+        !WriteBytes(padding, AlignRecord(record_size) - record_size)) {
+        return false;
+    }
+    count_++;
+    return true;
+}
+
+bool MappedSnapshotWriter::Close() {
+    if (fd_ == NULL) {
+        return false;
+    }
+    bool ok = fseek(fd_, 8, SEEK_SET) == 0 && WriteBytes(&count_, sizeof(count_)) && fflush(fd_) == 0 &&
+              fsync(fileno(fd_)) == 0;
+    if (fclose(fd_) != 0) {
+        ok = false;
+    }
+    fd_ = NULL;
+    if (!ok) {
+        PDLOG(WARNING, "fail to close file %s", path_.c_str());
+    }
+    return ok;
+}
+
+std::shared_ptr<MappedSnapshot> MappedSnapshot::Open(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return std::shared_ptr<MappedSnapshot>();
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<uint64_t>(st.st_size) < MAPPED_SNAPSHOT_HEADER_SIZE) {
+        PDLOG(WARNING, "invalid mapped snapshot %s", path.c_str());
+        close(fd);
+        return std::shared_ptr<MappedSnapshot>();
+    }
+    uint64_t size = st.st_size;
+    void* base = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // the mapping is still valid after the fd is closed
+    close(fd);
+    if (base == MAP_FAILED) {
+        PDLOG(WARNING, "fail to mmap %s for error %s", path.c_str(), strerror(errno));
+        return std::shared_ptr<MappedSnapshot>();
+    }
+    const char* ptr = reinterpret_cast<const char*>(base);
+    uint32_t magic = 0;
+    uint32_t version = 0;
+    uint64_t count = 0;
+    memcpy(&magic, ptr, 4);
+    memcpy(&version, ptr + 4, 4);
+    memcpy(&count, ptr + 8, 8);
+    if (magic != MAPPED_SNAPSHOT_MAGIC || version != MAPPED_SNAPSHOT_VERSION) {
+        PDLOG(WARNING, "invalid mapped snapshot %s, magic %u version %u", path.c_str(), magic, version);
+        munmap(base, size);
+        return std::shared_ptr<MappedSnapshot>();
+    }
+    madvise(base, size, MADV_WILLNEED);
+    return std::shared_ptr<MappedSnapshot>(new MappedSnapshot(ptr, size, count));
+}
+
+MappedSnapshot::~MappedSnapshot() { munmap(const_cast<char*>(base_), size_); }
+
+uint64_t MappedSnapshot::FirstOffset() { return MAPPED_SNAPSHOT_HEADER_SIZE; }
+
+bool MappedSnapshot::Read(uint64_t* offset, ::openmldb::api::LogEntry* meta, ::openmldb::base::Slice* value) const {
+    uint64_t pos = *offset;
+    if (pos + MAPPED_RECORD_HEADER_SIZE > size_) {
+        return false;
+    }
+    uint32_t meta_size = 0;
+    uint32_t value_size = 0;
+    memcpy(&meta_size, base_ + pos, 4);
+    memcpy(&value_size, base_ + pos + 4, 4);
+    uint64_t record_size = MAPPED_RECORD_HEADER_SIZE + meta_size + value_size;
+    if (pos + record_size > size_) {
+        PDLOG(WARNING, "truncated record at offset %lu", pos);
+        return false;
+    }
+    const char* meta_data = base_ + pos + MAPPED_RECORD_HEADER_SIZE;
+    if (!meta->ParseFromArray(meta_data, meta_size)) {
+        PDLOG(WARNING, "fail to parse record at offset %lu", pos);
+        return false;
+    }
+    value->reset(meta_data + meta_size, value_size);
+    *offset = pos + AlignRecord(record_size);
+    return true;
+}
+
+}  // namespace storage
+}  // namespace openmldb
@@ -0,0 +1,96 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_STORAGE_MAPPED_SNAPSHOT_H_
+#define SRC_STORAGE_MAPPED_SNAPSHOT_H_
+
+#include <stdio.h>
+
+#include <memory>
+#include <string>
+
+#include "base/slice.h"
+#include "proto/tablet.pb.h"
+
+namespace openmldb {
+namespace storage {
+
+const std::string MAPPED_SNAPSHOT_SUFFIX = ".mmap";  // NOLINT
+
+// The mapped snapshot is a sidecar of a snapshot file which holds the same records,
+// the values are stored apart from the entries so a table can be recovered by
+// referring to the values in the mapped file instead of copying them. The layout is
+// | magic (4 bytes) | version (4 bytes) | record count (8 bytes) | record ... |
+// and every record is
+// | meta size (4 bytes) | value size (4 bytes) | LogEntry without value | value | padding |
+// the records are padded to 8 bytes
+class MappedSnapshotWriter {
+ public:
+    explicit MappedSnapshotWriter(const std::string& path);
+    ~MappedSnapshotWriter();
+    MappedSnapshotWriter(const MappedSnapshotWriter&) = delete;
+    MappedSnapshotWriter& operator=(const MappedSnapshotWriter&) = delete;
+
+    bool Open();
+
+    // the value of the entry is cleared
+    bool Write(::openmldb::api::LogEntry* entry);
+
+    // write the record count to the header and sync the file
+    bool Close();
+
+    inline uint64_t GetCount() const { return count_; }
+
+ private:
+    bool WriteBytes(const void* data, size_t size);
+
+ private:
+    std::string path_;
+    FILE* fd_;
+    uint64_t count_;
+    std::string buf_;
+};
+
+class MappedSnapshot {
+ public:
+    // return NULL if the file is not a complete mapped snapshot
+    static std::shared_ptr<MappedSnapshot> Open(const std::string& path);
+
+    ~MappedSnapshot();
+    MappedSnapshot(const MappedSnapshot&) = delete;
+    MappedSnapshot& operator=(const MappedSnapshot&) = delete;
+
+    inline uint64_t GetCount() const { return count_; }
+
+    // the offset of the first record
+    static uint64_t FirstOffset();
+
+    // parse the record at offset and move offset to the next record. The value refers
+    // to the mapped memory, return false if there are no more valid records
+    bool Read(uint64_t* offset, ::openmldb::api::LogEntry* meta, ::openmldb::base::Slice* value) const;
+
+ private:
+    MappedSnapshot(const char* base, uint64_t size, uint64_t count) : base_(base), size_(size), count_(count) {}
+
+ private:
+    const char* base_;
+    uint64_t size_;
+    uint64_t count_;
+};
+
+}  // namespace storage
+}  // namespace openmldb
+#endif  // SRC_STORAGE_MAPPED_SNAPSHOT_H_
@@ -0,0 +1,134 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "storage/mem_estimator.h"
+
+#include <algorithm>
+#include <limits>
+#include <map>
+#include <vector>
+
+#include "storage/record.h"
+
+namespace openmldb {
+namespace storage {
+
+namespace {
+
+const double kUnbounded = std::numeric_limits<double>::max();
+
+// the bytes of the levels of a skiplist node above the first on average, the skiplists have the branch 4
+double GetAvgTowerByteSize(uint32_t max_height) {
+    double levels = 0;
+    double p = 1;
+    for (uint32_t i = 1; i < max_height; i++) {
+        p /= 4;
+        levels += p;
+    }
+    return levels * 8;
+}
+
+// the rows of all the keys kept by the ttl
+double GetKeptRowCnt(const ::openmldb::common::TTLSt& ttl, const MemEstimateOption& option) {
+    double abs_rows = ttl.abs_ttl() > 0 ? option.put_qps * ttl.abs_ttl() * 60 : kUnbounded;
+    double lat_rows = ttl.lat_ttl() > 0 ? static_cast<double>(option.key_cnt) * ttl.lat_ttl() : kUnbounded;
+    double rows = abs_rows;
+    switch (ttl.ttl_type()) {
+        case ::openmldb::type::TTLType::kLatestTime:
+            rows = lat_rows;
+            break;
+        case ::openmldb::type::TTLType::kAbsAndLat:
+            // a row is expired only if both of the ttls expire it
+            rows = std::max(abs_rows, lat_rows);
+            break;
+        case ::openmldb::type::TTLType::kAbsOrLat:
+            rows = std::min(abs_rows, lat_rows);
+            break;
+        default:
+            break;
+    }
+    if (option.write_seconds > 0) {
+        rows = std::min(rows, option.put_qps * option.write_seconds);
+    }
+    return rows;
+}
+
+}  // namespace
+
+bool EstimateMemory(const ::google::protobuf::RepeatedPtrField<::openmldb::common::ColumnKey>& column_keys,
+                    const MemEstimateOption& option, MemEstimate* estimate, std::string* msg) {
+    if (option.key_cnt == 0) {
+        *msg = "key_cnt should be large than 0";
+        return false;
+    }
+    // the indexes on the same key columns share the keys as one inner index, see TableIndex
+    std::map<std::string, std::vector<const ::openmldb::common::TTLSt*>> inner_indexes;
+    for (const auto& column_key : column_keys) {
+        if (column_key.flag() != 0) {
+            continue;
+        }
+        std::string key;
+        for (const auto& col_name : column_key.col_name()) {
+            key.append(key.empty() ? "" : "|").append(col_name);
+        }
+        inner_indexes[key].push_back(&column_key.ttl());
+    }
+    double key_cnt = static_cast<double>(option.key_cnt);
+    double row_cnt = 0;
+    double pk_node_byte_size = 0;
+    double key_entry_byte_size = 0;
+    double ts_node_byte_size = 0;
+    for (const auto& kv : inner_indexes) {
+        bool has_abs_ttl = false;
+        for (const auto* ttl : kv.second) {
+            if (ttl->ttl_type() == ::openmldb::type::TTLType::kAbsoluteTime ||
+                ttl->ttl_type() == ::openmldb::type::TTLType::kAbsAndLat) {
+                has_abs_ttl = true;
+            }
+        }
+        uint32_t max_height = has_abs_ttl ? option.abs_max_height : option.lat_max_height;
+        uint32_t init_height = option.key_entry_grow_cnt > 0 ? 1 : max_height;
+        pk_node_byte_size +=
+            key_cnt * (GetRecordPkNodeSize(1, option.key_size) + GetAvgTowerByteSize(option.pk_max_height));
+        key_entry_byte_size += key_cnt * GetRecordKeyEntrySize(init_height, kv.second.size());
+        for (const auto* ttl : kv.second) {
+            double rows = GetKeptRowCnt(*ttl, option);
+            if (rows == kUnbounded) {
+                *msg = "the rows of the index on " + kv.first + " are not expired, write_seconds should be set";
+                return false;
+            }
+            // a row is freed after all the indexes expire it
+            row_cnt = std::max(row_cnt, rows);
+            ts_node_byte_size += rows * DATA_NODE_SIZE;
+            double key_rows = rows / key_cnt;
+            if (key_rows > option.key_entry_grow_cnt) {
+                // the rows after the growth are put to the skiplist
+                key_entry_byte_size += key_cnt * (max_height - init_height) * 8;
+                ts_node_byte_size +=
+                    key_cnt * (key_rows - option.key_entry_grow_cnt) * GetAvgTowerByteSize(max_height);
+            }
+        }
+    }
+    estimate->row_cnt = static_cast<uint64_t>(row_cnt);
+    estimate->record_byte_size = static_cast<uint64_t>(row_cnt * GetRecordSize(option.row_size));
+    estimate->pk_node_byte_size = static_cast<uint64_t>(pk_node_byte_size);
+    estimate->key_entry_byte_size = static_cast<uint64_t>(key_entry_byte_size);
+    estimate->ts_node_byte_size = static_cast<uint64_t>(ts_node_byte_size);
+    return true;
+}
+
+}  // namespace storage
+}  // namespace openmldb
@@ -0,0 +1,68 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_STORAGE_MEM_ESTIMATOR_H_
+#define SRC_STORAGE_MEM_ESTIMATOR_H_
+
+#include <string>
+
+#include "google/protobuf/repeated_field.h"
+#include "proto/common.pb.h"
+
+namespace openmldb {
+namespace storage {
+
+struct MemEstimateOption {
+    // the distinct keys of every index
+    uint64_t key_cnt = 0;
+    // the average bytes of a key and an encoded row
+    uint32_t key_size = 16;
+    uint32_t row_size = 0;
+    // the rows put per second
+    double put_qps = 0;
+    // how long the rows are put, which bounds the rows of the indexes without ttl. 0 if it is unbounded
+    uint64_t write_seconds = 0;
+    // the key entries of the keys with more rows than key_entry_grow_cnt grow into the skiplists of the max height,
+    // which is abs_max_height if the inner index has an absolute ttl and lat_max_height otherwise
+    uint32_t key_entry_grow_cnt = 8;
+    uint32_t abs_max_height = 4;
+    uint32_t lat_max_height = 1;
+    // the max height of the skiplist of the keys
+    uint32_t pk_max_height = 12;
+};
+
+// the estimated memory of one replica of a table by the parts counted by Segment::GetMemStat
+struct MemEstimate {
+    uint64_t row_cnt = 0;
+    uint64_t record_byte_size = 0;
+    uint64_t pk_node_byte_size = 0;
+    uint64_t key_entry_byte_size = 0;
+    uint64_t ts_node_byte_size = 0;
+
+    uint64_t GetTotalByteSize() const {
+        return record_byte_size + pk_node_byte_size + key_entry_byte_size + ts_node_byte_size;
+    }
+};
+
+// estimate the memory of one replica of a table with the column keys by the sizes of storage/record.h, the
+// allocator overhead is not included. It returns false with msg if the rows kept by an index are unbounded,
+// which are the indexes without ttl if option.write_seconds is 0
+bool EstimateMemory(const ::google::protobuf::RepeatedPtrField<::openmldb::common::ColumnKey>& column_keys,
+                    const MemEstimateOption& option, MemEstimate* estimate, std::string* msg);
+
+}  // namespace storage
+}  // namespace openmldb
+#endif  // SRC_STORAGE_MEM_ESTIMATOR_H_
@@ -0,0 +1,97 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "storage/mem_estimator.h"
+
+#include <string>
+
+#include "base/glog_wapper.h"
+#include "gtest/gtest.h"
+#include "storage/record.h"
+
+namespace openmldb {
+namespace storage {
+
+class MemEstimatorTest : public ::testing::Test {};
+
+void AddColumnKey(const std::string& col_name, const std::string& ts_name, ::openmldb::type::TTLType ttl_type,
+                  uint64_t abs_ttl, uint64_t lat_ttl,
+                  ::google::protobuf::RepeatedPtrField<::openmldb::common::ColumnKey>* column_keys) {
+    auto* column_key = column_keys->Add();
+    column_key->set_index_name(col_name + ts_name);
+    column_key->add_col_name(col_name);
+    column_key->set_ts_name(ts_name);
+    column_key->mutable_ttl()->set_ttl_type(ttl_type);
+    column_key->mutable_ttl()->set_abs_ttl(abs_ttl);
+    column_key->mutable_ttl()->set_lat_ttl(lat_ttl);
+}
+
+TEST_F(MemEstimatorTest, Latest) {
+    ::google::protobuf::RepeatedPtrField<::openmldb::common::ColumnKey> column_keys;
+    AddColumnKey("card", "ts", ::openmldb::type::TTLType::kLatestTime, 0, 4, &column_keys);
+    MemEstimateOption option;
+    option.key_cnt = 1000;
+    option.key_size = 10;
+    option.row_size = 100;
+    MemEstimate estimate;
+    std::string msg;
+    ASSERT_TRUE(EstimateMemory(column_keys, option, &estimate, &msg)) << msg;
+    ASSERT_EQ(4000u, estimate.row_cnt);
+    ASSERT_EQ(4000u * GetRecordSize(100), estimate.record_byte_size);
+    // the key entries do not grow with 4 rows
+    ASSERT_EQ(1000u * GetRecordKeyEntrySize(1, 1), estimate.key_entry_byte_size);
+    ASSERT_EQ(4000u * DATA_NODE_SIZE, estimate.ts_node_byte_size);
+    ASSERT_GE(estimate.pk_node_byte_size, 1000u * GetRecordPkNodeSize(1, 10));
+    ASSERT_EQ(estimate.record_byte_size + estimate.pk_node_byte_size + estimate.key_entry_byte_size +
+                  estimate.ts_node_byte_size,
+              estimate.GetTotalByteSize());
+}
+
+TEST_F(MemEstimatorTest, Absolute) {
+    ::google::protobuf::RepeatedPtrField<::openmldb::common::ColumnKey> column_keys;
+    AddColumnKey("card", "ts", ::openmldb::type::TTLType::kAbsoluteTime, 10, 0, &column_keys);
+    AddColumnKey("card", "ts2", ::openmldb::type::TTLType::kAbsoluteTime, 20, 0, &column_keys);
+    AddColumnKey("mcc", "ts", ::openmldb::type::TTLType::kAbsOrLat, 10, 1, &column_keys);
+    MemEstimateOption option;
+    option.key_cnt = 100;
+    option.row_size = 100;
+    option.put_qps = 10;
+    MemEstimate estimate;
+    std::string msg;
+    ASSERT_TRUE(EstimateMemory(column_keys, option, &estimate, &msg)) << msg;
+    // the rows are kept by the longest ttl
+    ASSERT_EQ(10u * 20 * 60, estimate.row_cnt);
+    // card has 6000 + 12000 rows with the towers, mcc keeps the latest row of every key
+    ASSERT_GT(estimate.ts_node_byte_size, (18000u + 100) * DATA_NODE_SIZE);
+    ASSERT_EQ(100u * (GetRecordKeyEntrySize(1, 2) + 2 * 3 * 8) + 100u * GetRecordKeyEntrySize(1, 1),
+              estimate.key_entry_byte_size);
+
+    // the rows of the index without ttl are bounded by the write seconds only
+    AddColumnKey("id", "ts", ::openmldb::type::TTLType::kAbsoluteTime, 0, 0, &column_keys);
+    ASSERT_FALSE(EstimateMemory(column_keys, option, &estimate, &msg));
+    option.write_seconds = 3600;
+    ASSERT_TRUE(EstimateMemory(column_keys, option, &estimate, &msg)) << msg;
+    ASSERT_EQ(36000u, estimate.row_cnt);
+}
+
+}  // namespace storage
+}  // namespace openmldb
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    ::openmldb::base::SetLogLevel(INFO);
+    return RUN_ALL_TESTS();
+}
@@ -17,11 +17,14 @@
 #include "storage/mem_table.h"
 
 #include <algorithm>
+#include <unordered_map>
 #include <utility>
 
 #include "base/glog_wapper.h"
 #include "base/hash.h"
 #include "base/slice.h"
+#include "bvar/bvar.h"
+#include "codec/codec.h"
 #include "common/timer.h"
 #include "gflags/gflags.h"
 #include "storage/record.h"
@@ -33,12 +36,31 @@ DECLARE_uint32(key_entry_max_height);
 DECLARE_uint32(absolute_default_skiplist_height);
 DECLARE_uint32(latest_default_skiplist_height);
 DECLARE_uint32(max_traverse_cnt);
+DECLARE_bool(enable_datablock_pool);
+DECLARE_uint32(datablock_pool_time_bucket);
+DECLARE_uint32(numa_node_cnt);
+DECLARE_bool(datablock_pool_huge_page);
+DECLARE_uint32(cold_data_age);
+DECLARE_uint32(cold_block_row_cnt);
+DECLARE_uint32(cold_block_dict_size);
+DECLARE_uint32(gc_slice_key_cnt);
+DECLARE_uint32(max_rows_per_key);
+DECLARE_uint32(schema_upgrade_row_cnt);
 
 namespace openmldb {
 namespace storage {
 
 static const uint32_t SEED = 0xe17a1465;
 
+// the gc of all the tables on the tablet
+static bvar::LatencyRecorder g_gc_latency("table_gc");
+static bvar::Adder<uint64_t> g_gc_freed_records("table_gc_freed_records");
+static bvar::Adder<uint64_t> g_gc_freed_bytes("table_gc_freed_bytes");
+// the write versions of a table start from a distinct base, the writes of a table never reach the next base
+static std::atomic<uint64_t> write_version_base(0);
+
+static uint64_t NewWriteVersion() { return (write_version_base.fetch_add(1, std::memory_order_relaxed) + 1) << 40; }
+
 MemTable::MemTable(const std::string& name, uint32_t id, uint32_t pid, uint32_t seg_cnt,
                    const std::map<std::string, uint32_t>& mapping, uint64_t ttl, ::openmldb::type::TTLType ttl_type)
     : Table(name, id, pid, ttl * 60 * 1000, true, 60 * 1000, mapping, ttl_type,
@@ -46,17 +68,21 @@ MemTable::MemTable(const std::string& name, uint32_t id, uint32_t pid, uint32_t
       seg_cnt_(seg_cnt),
       segments_(MAX_INDEX_NUM, NULL),
       enable_gc_(true),
+      gc_sweeping_(false),
       record_cnt_(0),
       segment_released_(false),
-      record_byte_size_(0) {}
+      record_byte_size_(0),
+      write_version_(NewWriteVersion()) {}
 
 MemTable::MemTable(const ::openmldb::api::TableMeta& table_meta)
     : Table(table_meta.name(), table_meta.tid(), table_meta.pid(), 0, true, 60 * 1000,
             std::map<std::string, uint32_t>(), ::openmldb::type::TTLType::kAbsoluteTime,
             ::openmldb::type::CompressType::kNoCompress),
-      segments_(MAX_INDEX_NUM, NULL) {
+      segments_(MAX_INDEX_NUM, NULL),
+      write_version_(NewWriteVersion()) {
     seg_cnt_ = 8;
     enable_gc_ = true;
+    gc_sweeping_ = false;
     record_cnt_ = 0;
     segment_released_ = false;
     record_byte_size_ = 0;
@@ -120,30 +146,384 @@ bool MemTable::Init() {
         segments_[i] = seg_arr;
         key_entry_max_height_ = cur_key_entry_max_height;
     }
+    UpdateLatestKeepCnt();
+    if (FLAGS_numa_node_cnt > 0) {
+        // spread the partitions of a table over the nodes
+        numa_node_ = static_cast<int32_t>((id_ + pid_) % FLAGS_numa_node_cnt);
+    }
+    // the rows are put in the slabs of the pool on the node of the partition
+    if (FLAGS_enable_datablock_pool || numa_node_ >= 0) {
+        // the rows of a latest ttl table expire by the count of the key rather than the time
+        uint64_t bucket_ms = 0;
+        auto index = table_index_.GetIndex(0);
+        if (index && index->GetTTL()->ttl_type != ::openmldb::storage::TTLType::kLatestTime) {
+            bucket_ms = static_cast<uint64_t>(FLAGS_datablock_pool_time_bucket) * 60 * 1000;
+        }
+        block_pool_.reset(new DataBlockPool(bucket_ms));
+        block_pool_->SetNumaNode(numa_node_);
+        block_pool_->SetHugePage(FLAGS_datablock_pool_huge_page);
+    }
+    if (!InitPreAggregators()) {
+        return false;
+    }
+    if (table_meta_->columnar_cold_block()) {
+        // the fields are located in place only in the uncompressed rows of format version 1
+        std::unique_ptr<ColdBlockLayout> layout(new ColdBlockLayout());
+        if (table_meta_->format_version() != 1 || table_meta_->compress_type() != ::openmldb::type::kNoCompress ||
+            !layout->Init(table_meta_->column_desc(), 1)) {
+            PDLOG(WARNING, "columnar cold block is ignored for the row format. tid %u pid %u", id_, pid_);
+        } else {
+            cold_layout_ = std::move(layout);
+        }
+    }
+    if (table_meta_->compact_row_format() || table_meta_->blob_min_size() > 0) {
+        // the compact rows are converted from the uncompressed rows of format version 1
+        if (table_meta_->format_version() != 1 || table_meta_->compress_type() != ::openmldb::type::kNoCompress) {
+            PDLOG(WARNING, "compact row format and blobs are ignored for the row format. tid %u pid %u", id_, pid_);
+        } else {
+            compact_codec_ = std::make_shared<::openmldb::codec::CompactRowCodec>(table_meta_->blob_min_size());
+        }
+    }
     PDLOG(INFO, "init table name %s, id %d, pid %d, seg_cnt %d", name_.c_str(), id_, pid_, seg_cnt_);
     return true;
 }
 
+bool MemTable::InitPreAggregators() {
+    bool in_memory = false;
+    for (const auto& desc : table_meta_->pre_aggregations()) {
+        in_memory |= !desc.has_aggr_tid();
+    }
+    if (!in_memory) {
+        return true;
+    }
+    // the aggregated column is read from the rows in place
+    if (table_meta_->format_version() != 1 || table_meta_->compress_type() != ::openmldb::type::kNoCompress) {
+        PDLOG(WARNING, "pre-aggregation needs the uncompressed rows of format version 1. tid %u pid %u", id_, pid_);
+        return false;
+    }
+    for (const auto& desc : table_meta_->pre_aggregations()) {
+        // maintained from the binlog by the tablet
+        if (desc.has_aggr_tid()) {
+            continue;
+        }
+        auto index_def = GetIndex(desc.index_name());
+        if (!index_def) {
+            PDLOG(WARNING, "index %s of pre-aggregation is not found. tid %u pid %u", desc.index_name().c_str(), id_,
+                  pid_);
+            return false;
+        }
+        // the buckets are only dropped by time
+        if (index_def->GetTTLType() != ::openmldb::storage::TTLType::kAbsoluteTime) {
+            PDLOG(WARNING, "the ttl type of index %s of pre-aggregation is not absolute. tid %u pid %u",
+                  desc.index_name().c_str(), id_, pid_);
+            return false;
+        }
+        auto ts_col = index_def->GetTsColumn();
+        std::unique_ptr<PreAggregator> aggr(
+            new PreAggregator(desc, index_def->GetId(), ts_col ? static_cast<int32_t>(ts_col->GetTsIdx()) : -1));
+        if (!aggr->Init(table_meta_->column_desc())) {
+            PDLOG(WARNING, "fail to init pre-aggregation of %s on index %s. tid %u pid %u", desc.aggr_col().c_str(),
+                  desc.index_name().c_str(), id_, pid_);
+            return false;
+        }
+        PDLOG(INFO, "init pre-aggregation of %s on index %s, bucket size %lu. tid %u pid %u", desc.aggr_col().c_str(),
+              desc.index_name().c_str(), desc.bucket_size(), id_, pid_);
+        pre_aggregators_.push_back(std::move(aggr));
+    }
+    return true;
+}
+
+uint32_t MemTable::GetColumnCount(const int8_t* row, uint32_t size) {
+    if (size < ::openmldb::codec::HEADER_LENGTH) {
+        return 0;
+    }
+    auto schema = GetVersionSchema(::openmldb::codec::RowView::GetSchemaVersion(row));
+    if (!schema) {
+        return 0;
+    }
+    return schema->size();
+}
+
+void MemTable::UpdatePreAggregators(const Dimensions& dimensions, const TSDimensions* ts_dimensions, uint64_t time,
+                                    const char* data, uint32_t size) {
+    const int8_t* row = reinterpret_cast<const int8_t*>(data);
+    uint32_t col_cnt = GetColumnCount(row, size);
+    if (col_cnt == 0) {
+        return;
+    }
+    for (const auto& aggr : pre_aggregators_) {
+        uint64_t ts = time;
+        if (aggr->GetTsIdx() >= 0) {
+            if (ts_dimensions == NULL) {
+                continue;
+            }
+            bool has_found_ts = false;
+            for (const auto& ts_dimension : *ts_dimensions) {
+                if (static_cast<int32_t>(ts_dimension.idx()) == aggr->GetTsIdx()) {
+                    ts = ts_dimension.ts();
+                    has_found_ts = true;
+                    break;
+                }
+            }
+            if (!has_found_ts) {
+                continue;
+            }
+        }
+        for (const auto& dimension : dimensions) {
+            if (dimension.idx() == aggr->GetIndexId()) {
+                aggr->Update(Slice(dimension.key()), ts, row, size, col_cnt);
+                break;
+            }
+        }
+    }
+}
+
+bool MemTable::PreAggregate(uint32_t index_id, const std::string& aggr_col, const std::string& pk, uint64_t st,
+                            uint64_t et, AggrState* state) {
+    PreAggregator* aggr = NULL;
+    for (const auto& cur_aggr : pre_aggregators_) {
+        if (cur_aggr->GetIndexId() == index_id && cur_aggr->GetColName() == aggr_col) {
+            aggr = cur_aggr.get();
+            break;
+        }
+    }
+    if (aggr == NULL) {
+        return false;
+    }
+    std::vector<std::pair<uint64_t, uint64_t>> edges;
+    aggr->Query(pk, st, et, state, &edges);
+    if (edges.empty()) {
+        return true;
+    }
+    Ticket ticket;
+    std::unique_ptr<TableIterator> it(NewIterator(index_id, pk, ticket));
+    if (!it) {
+        return false;
+    }
+    // the rows at the edges are scanned from the end of the range
+    for (const auto& edge : edges) {
+        for (it->Seek(edge.second); it->Valid() && it->GetKey() >= edge.first; it->Next()) {
+            Slice value = it->GetValue();
+            const int8_t* row = reinterpret_cast<const int8_t*>(value.data());
+            aggr->Fold(row, value.size(), GetColumnCount(row, value.size()), state);
+        }
+    }
+    return true;
+}
+
+DataBlock* MemTable::NewDataBlock(uint8_t dim_cnt, const char* data, uint32_t len, uint64_t time, bool mapped) {
+    std::string upgraded;
+    if (len >= ::openmldb::codec::HEADER_LENGTH &&
+        ::openmldb::codec::RowView::GetSchemaVersion(reinterpret_cast<const int8_t*>(data)) != GetLatestVersion() &&
+        (FLAGS_schema_upgrade_row_cnt > 0 || IsSingleVersion()) && CanUpgradeRows() &&
+        UpgradeRow(data, len, &upgraded)) {
+        // the rows of the older versions put by the stale clients are upgraded at once, so the table is
+        // kept single version
+        data = upgraded.data();
+        len = upgraded.size();
+        mapped = false;
+    }
+    if (mapped) {
+        DataBlock* block = new DataBlock(dim_cnt, const_cast<char*>(data), len, true);
+        block->SetMapped();
+        return block;
+    }
+    std::string compact;
+    bool has_blobs = false;
+    if (compact_codec_ && EncodeCompactRow(data, len, &compact)) {
+        data = compact.data();
+        len = compact.size();
+        has_blobs = ::openmldb::codec::CompactRowCodec::GetBlobCnt(reinterpret_cast<const int8_t*>(data), len) > 0;
+    }
+    DataBlock* block = block_pool_ ? block_pool_->New(dim_cnt, data, len, time) : NULL;
+    if (block == NULL) {
+        block = new DataBlock(dim_cnt, data, len);
+    }
+    // the block takes over the references of the row to its blobs
+    block->has_blobs = has_blobs;
+    return block;
+}
+
+bool MemTable::EncodeCompactRow(const char* data, uint32_t size, std::string* buf) {
+    const int8_t* row = reinterpret_cast<const int8_t*>(data);
+    if (size < ::openmldb::codec::HEADER_LENGTH) {
+        return false;
+    }
+    uint8_t version = ::openmldb::codec::RowView::GetSchemaVersion(row);
+    if (!compact_codec_->HasSchema(version)) {
+        // the schema versions are added by adding columns after the table is created
+        auto schema = GetVersionSchema(version);
+        if (!schema || !compact_codec_->AddSchema(version, *schema)) {
+            return false;
+        }
+    }
+    if (!compact_codec_->Encode(row, size, buf)) {
+        return false;
+    }
+    // without the compact row format, only the rows with blobs are kept compact
+    const int8_t* compact = reinterpret_cast<const int8_t*>(buf->data());
+    uint32_t blob_cnt = ::openmldb::codec::CompactRowCodec::GetBlobCnt(compact, buf->size());
+    if (buf->size() >= size || (blob_cnt == 0 && !table_meta_->compact_row_format())) {
+        ::openmldb::codec::CompactRowCodec::UnRefBlobs(compact, buf->size());
+        return false;
+    }
+    return true;
+}
+
+bool MemTable::UpgradeRow(const char* data, uint32_t size, std::string* buf) {
+    const int8_t* row = reinterpret_cast<const int8_t*>(data);
+    uint8_t version = GetLatestVersion();
+    if (size < ::openmldb::codec::HEADER_LENGTH || ::openmldb::codec::RowView::GetSchemaVersion(row) == version) {
+        return false;
+    }
+    auto plan = GetUpgradePlan();
+    if (!plan) {
+        return false;
+    }
+    ::openmldb::codec::RowProject row_project(plan);
+    int8_t* output = NULL;
+    uint32_t output_size = 0;
+    if (!row_project.Project(row, size, &output, &output_size)) {
+        return false;
+    }
+    buf->assign(reinterpret_cast<char*>(output), output_size);
+    delete[] reinterpret_cast<char*>(output);
+    // the projected row is of the columns of the latest version
+    (*buf)[1] = static_cast<char>(version);
+    return true;
+}
+
+bool MemTable::CanUpgradeRows() {
+    return compress_type_ != ::openmldb::type::kSnappy && GetTableMeta()->format_version() == 1;
+}
+
+void MemTable::UpgradeRows(uint64_t max_row_cnt) {
+    if (max_row_cnt == 0 || IsSingleVersion() || !GetUpgradePlan() || !CanUpgradeRows()) {
+        return;
+    }
+    uint64_t consumed = ::baidu::common::timer::get_micros();
+    uint8_t version = GetLatestVersion();
+    ColdRowReader reader;
+    reader.SetCompactCodec(compact_codec_);
+    // a row is shared by the segments of its indexes, so it is upgraded once and shared by them too
+    std::unordered_map<DataBlock*, DataBlock*> upgraded;
+    std::string buf;
+    RowUpgrader upgrade = [&](uint64_t time, DataBlock* block) -> DataBlock* {
+        auto iter = upgraded.find(block);
+        if (iter != upgraded.end()) {
+            iter->second->dim_cnt_down++;
+            return iter->second;
+        }
+        Slice value = reader.Read(block);
+        if (value.size() < ::openmldb::codec::HEADER_LENGTH) {
+            return NULL;
+        }
+        if (::openmldb::codec::RowView::GetSchemaVersion(reinterpret_cast<const int8_t*>(value.data())) == version) {
+            return block;
+        }
+        if (!UpgradeRow(value.data(), value.size(), &buf)) {
+            return NULL;
+        }
+        DataBlock* new_block = NewDataBlock(1, buf.data(), buf.size(), time, false);
+        upgraded.emplace(block, new_block);
+        // the replaced rows are counted by the gc as they are released
+        record_cnt_.fetch_add(1, std::memory_order_relaxed);
+        record_byte_size_.fetch_add(GetRecordSize(new_block->size));
+        return new_block;
+    };
+    uint64_t upgrade_cnt = 0;
+    bool finished = true;
+    auto inner_indexs = table_index_.GetAllInnerIndex();
+    for (uint32_t i = 0; i < inner_indexs->size() && finished; i++) {
+        bool is_ready = false;
+        for (const auto& index_def : inner_indexs->at(i)->GetIndex()) {
+            if (index_def->IsReady()) {
+                is_ready = true;
+                break;
+            }
+        }
+        if (!is_ready || segments_[i] == NULL) {
+            continue;
+        }
+        for (uint32_t j = 0; j < seg_cnt_; j++) {
+            if (upgrade_cnt >= max_row_cnt ||
+                !segments_[i][j]->Upgrade(version, max_row_cnt - upgrade_cnt, upgrade, upgrade_cnt)) {
+                finished = false;
+                break;
+            }
+        }
+    }
+    consumed = ::baidu::common::timer::get_micros() - consumed;
+    if (upgrade_cnt > 0) {
+        PDLOG(INFO, "upgrade %lu records to schema version %u consumed %lu ms for table %s tid %u pid %u",
+              upgrade_cnt, version, consumed / 1000, name_.c_str(), id_, pid_);
+    }
+    if (finished) {
+        SetSingleVersion(version);
+        PDLOG(INFO, "all the records are of schema version %u for table %s tid %u pid %u", version, name_.c_str(),
+              id_, pid_);
+    }
+}
+
 void MemTable::SetCompressType(::openmldb::type::CompressType compress_type) { compress_type_ = compress_type; }
 
 ::openmldb::type::CompressType MemTable::GetCompressType() { return compress_type_; }
 
 bool MemTable::Put(const std::string& pk, uint64_t time, const char* data, uint32_t size) {
+    return Put(pk, time, data, size, false);
+}
+
+bool MemTable::Put(uint64_t time, const std::string& value, const Dimensions& dimensions) {
+    return Put(time, dimensions, value.c_str(), value.length(), false);
+}
+
+bool MemTable::Put(const Dimensions& dimensions, const TSDimensions& ts_dimensions, const std::string& value) {
+    return Put(dimensions, ts_dimensions, value.c_str(), value.length(), false);
+}
+
+bool MemTable::PutMapped(const ::openmldb::api::LogEntry& entry, const ::openmldb::base::Slice& value) {
+    if (entry.dimensions_size() > 0) {
+        return entry.ts_dimensions_size() > 0
+                   ? Put(entry.dimensions(), entry.ts_dimensions(), value.data(), value.size(), true)
+                   : Put(entry.ts(), entry.dimensions(), value.data(), value.size(), true);
+    }
+    return Put(entry.pk(), entry.ts(), value.data(), value.size(), true);
+}
+
+void MemTable::AddMappedSnapshot(const std::shared_ptr<MappedSnapshot>& mapped_snapshot) {
+    std::lock_guard<std::mutex> lock(mapped_mu_);
+    mapped_snapshots_.push_back(mapped_snapshot);
+}
+
+bool MemTable::Put(const std::string& pk, uint64_t time, const char* data, uint32_t size, bool mapped) {
     if (segments_.empty()) return false;
     uint32_t index = 0;
     if (seg_cnt_ > 1) {
         index = ::openmldb::base::hash(pk.c_str(), pk.length(), SEED) % seg_cnt_;
     }
     Segment* segment = segments_[0][index];
+    if (segment->GetTsCnt() > 1) {
+        // the segment with multi ts can only be put with ts dimensions
+        return false;
+    }
     Slice spk(pk);
-    segment->Put(spk, time, data, size);
+    DataBlock* block = NewDataBlock(1, data, size, time, mapped);
+    segment->Put(spk, time, block);
+    if (!pre_aggregators_.empty()) {
+        Dimensions dimensions;
+        auto dimension = dimensions.Add();
+        dimension->set_key(pk);
+        dimension->set_idx(0);
+        UpdatePreAggregators(dimensions, NULL, time, data, size);
+    }
     record_cnt_.fetch_add(1, std::memory_order_relaxed);
-    record_byte_size_.fetch_add(GetRecordSize(size));
+    IncrWriteVersion();
+    record_byte_size_.fetch_add(GetRecordSize(block->size));
     return true;
 }
 
 // Put a multi dimension record
-bool MemTable::Put(uint64_t time, const std::string& value, const Dimensions& dimensions) {
+bool MemTable::Put(uint64_t time, const Dimensions& dimensions, const char* data, uint32_t size, bool mapped) {
     std::map<int32_t, Slice> inner_index_key_map;
     for (auto iter = dimensions.begin(); iter != dimensions.end(); iter++) {
         int32_t inner_pos = table_index_.GetInnerIndexPos(iter->idx());
@@ -171,7 +551,7 @@ bool MemTable::Put(uint64_t time, const std::string& value, const Dimensions& di
             }
         }
     }
-    DataBlock* block = new DataBlock(real_ref_cnt, value.c_str(), value.length());
+    DataBlock* block = NewDataBlock(real_ref_cnt, data, size, time, mapped);
     for (const auto& kv : inner_index_key_map) {
         auto inner_index = table_index_.GetInnerIndex(kv.first);
         bool need_put = false;
@@ -190,12 +570,17 @@ bool MemTable::Put(uint64_t time, const std::string& value, const Dimensions& di
             segment->Put(::openmldb::base::Slice(kv.second), time, block);
         }
     }
+    if (!pre_aggregators_.empty()) {
+        UpdatePreAggregators(dimensions, NULL, time, data, size);
+    }
     record_cnt_.fetch_add(1, std::memory_order_relaxed);
-    record_byte_size_.fetch_add(GetRecordSize(value.length()));
+    IncrWriteVersion();
+    record_byte_size_.fetch_add(GetRecordSize(block->size));
     return true;
 }
 
-bool MemTable::Put(const Dimensions& dimensions, const TSDimensions& ts_dimensions, const std::string& value) {
+bool MemTable::Put(const Dimensions& dimensions, const TSDimensions& ts_dimensions, const char* data,
+                   uint32_t size, bool mapped) {
     if (dimensions.empty() || ts_dimensions.empty()) {
         PDLOG(WARNING, "empty dimension. tid %u pid %u", id_, pid_);
         return false;
@@ -236,7 +621,12 @@ bool MemTable::Put(const Dimensions& dimensions, const TSDimensions& ts_dimensio
             }
         }
     }
-    auto* block = new DataBlock(real_ref_cnt, value.c_str(), value.length());
+    // the row is released after the latest ts of it expires
+    uint64_t max_ts = 0;
+    for (const auto& ts_dimension : ts_dimensions) {
+        max_ts = std::max(max_ts, ts_dimension.ts());
+    }
+    auto* block = NewDataBlock(real_ref_cnt, data, size, max_ts, mapped);
     for (const auto& kv : inner_index_key_map) {
         auto inner_index = table_index_.GetInnerIndex(kv.first);
         bool need_put = false;
@@ -256,8 +646,12 @@ bool MemTable::Put(const Dimensions& dimensions, const TSDimensions& ts_dimensio
             segment->Put(::openmldb::base::Slice(kv.second), ts_dimensions, block);
         }
     }
+    if (!pre_aggregators_.empty()) {
+        UpdatePreAggregators(dimensions, &ts_dimensions, 0, data, size);
+    }
     record_cnt_.fetch_add(1, std::memory_order_relaxed);
-    record_byte_size_.fetch_add(GetRecordSize(value.length()));
+    IncrWriteVersion();
+    record_byte_size_.fetch_add(GetRecordSize(block->size));
     return true;
 }
 
@@ -273,6 +667,7 @@ bool MemTable::Put(const Slice& pk, uint64_t time, DataBlock* row, uint32_t idx)
     uint32_t real_idx = index_def->GetInnerPos();
     Segment* segment = segments_[real_idx][seg_idx];
     segment->Put(pk, time, row);
+    IncrWriteVersion();
     return true;
 }
 
@@ -288,7 +683,53 @@ bool MemTable::Delete(const std::string& pk, uint32_t idx) {
     }
     uint32_t real_idx = index_def->GetInnerPos();
     Segment* segment = segments_[real_idx][seg_idx];
-    return segment->Delete(spk);
+    for (const auto& aggr : pre_aggregators_) {
+        if (aggr->GetIndexId() == idx) {
+            aggr->Delete(pk);
+        }
+    }
+    bool ok = segment->Delete(spk);
+    IncrWriteVersion();
+    return ok;
+}
+
+bool MemTable::DeleteRange(const std::string& pk, uint32_t idx, uint64_t start_ts, uint64_t end_ts) {
+    std::shared_ptr<IndexDef> index_def = GetIndex(idx);
+    if (!index_def || !index_def->IsReady() || start_ts < end_ts) {
+        return false;
+    }
+    Slice spk(pk);
+    uint32_t seg_idx = 0;
+    if (seg_cnt_ > 1) {
+        seg_idx = ::openmldb::base::hash(spk.data(), spk.size(), SEED) % seg_cnt_;
+    }
+    Segment* segment = segments_[index_def->GetInnerPos()][seg_idx];
+    auto ts_col = index_def->GetTsColumn();
+    uint32_t ts_idx = ts_col ? ts_col->GetTsIdx() : 0;
+    // the pre-aggregated buckets of the key are kept, they still cover the rows deleted until they expire
+    bool ok = segment->Delete(spk, ts_idx, start_ts, end_ts);
+    IncrWriteVersion();
+    return ok;
+}
+
+bool MemTable::DeleteRange(uint64_t start_ts, uint64_t end_ts) {
+    if (start_ts < end_ts) {
+        return false;
+    }
+    uint64_t cnt = 0;
+    for (const auto& index_def : table_index_.GetAllIndex()) {
+        if (!index_def || !index_def->IsReady()) {
+            continue;
+        }
+        auto ts_col = index_def->GetTsColumn();
+        uint32_t ts_idx = ts_col ? ts_col->GetTsIdx() : 0;
+        for (uint32_t i = 0; i < seg_cnt_; i++) {
+            cnt += segments_[index_def->GetInnerPos()][i]->Delete(ts_idx, start_ts, end_ts);
+        }
+    }
+    PDLOG(INFO, "delete %lu rows of ts from %lu to %lu. tid %u pid %u", cnt, end_ts, start_ts, id_, pid_);
+    IncrWriteVersion();
+    return true;
 }
 
 uint64_t MemTable::Release() {
@@ -312,11 +753,32 @@ uint64_t MemTable::Release() {
 }
 
 void MemTable::SchedGc() {
+    std::lock_guard<std::mutex> lock(gc_mu_);
     uint64_t consumed = ::baidu::common::timer::get_micros();
-    PDLOG(INFO, "start making gc for table %s, tid %u, pid %u", name_.c_str(), id_, pid_);
+    // a round of gc may be split into several slices, the index status only changes between rounds
+    bool new_round = !gc_sweeping_.load(std::memory_order_relaxed);
+    if (new_round) {
+        PDLOG(INFO, "start making gc for table %s, tid %u, pid %u", name_.c_str(), id_, pid_);
+        for (const auto& aggr : pre_aggregators_) {
+            auto index_def = GetIndex(aggr->GetIndexId());
+            if (index_def) {
+                uint64_t expire_time = GetExpireTime(*(index_def->GetTTL()));
+                if (expire_time > 0) {
+                    aggr->Gc(expire_time);
+                }
+            }
+        }
+    }
     uint64_t gc_idx_cnt = 0;
     uint64_t gc_record_cnt = 0;
     uint64_t gc_record_byte_size = 0;
+    uint64_t demote_cnt = 0;
+    uint64_t demote_saved_byte_size = 0;
+    uint64_t cold_time = 0;
+    if (FLAGS_cold_data_age > 0) {
+        cold_time = ::baidu::common::timer::get_micros() / 1000 - static_cast<uint64_t>(FLAGS_cold_data_age) * 60 * 1000;
+    }
+    bool sweeping = false;
     auto inner_indexs = table_index_.GetAllInnerIndex();
     for (uint32_t i = 0; i < inner_indexs->size(); i++) {
         const std::vector<std::shared_ptr<IndexDef>>& real_index = inner_indexs->at(i)->GetIndex();
@@ -332,9 +794,14 @@ void MemTable::SchedGc() {
                 ttl_st_map.emplace(0, *(cur_index->GetTTL()));
             }
             if (cur_index->GetStatus() == IndexStatus::kWaiting) {
-                cur_index->SetStatus(IndexStatus::kDeleting);
+                if (new_round) {
+                    cur_index->SetStatus(IndexStatus::kDeleting);
+                }
                 need_gc = false;
             } else if (cur_index->GetStatus() == IndexStatus::kDeleting) {
+                if (!new_round) {
+                    continue;
+                }
                 if (real_index.size() == 1) {
                     if (segments_[i] != NULL) {
                         for (uint32_t k = 0; k < seg_cnt_; k++) {
@@ -359,26 +826,147 @@ void MemTable::SchedGc() {
         for (uint32_t j = 0; j < seg_cnt_; j++) {
             uint64_t seg_gc_time = ::baidu::common::timer::get_micros() / 1000;
             Segment* segment = segments_[i][j];
-            segment->IncrGcVersion();
-            segment->GcFreeList(gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
-            if (ttl_st_map.size() == 1) {
-                segment->ExecuteGc(ttl_st_map.begin()->second, gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
-            } else {
-                segment->ExecuteGc(ttl_st_map, gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
+            if (!segment->IsGcSweeping()) {
+                segment->IncrGcVersion();
+                segment->GcFreeList(gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
+            }
+            if (!segment->ExecuteGcSlice(ttl_st_map, FLAGS_gc_slice_key_cnt, gc_idx_cnt, gc_record_cnt,
+                                         gc_record_byte_size)) {
+                sweeping = true;
+                continue;
+            }
+            if (FLAGS_max_rows_per_key > 0) {
+                segment->GcHotKeys(FLAGS_max_rows_per_key, gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
+            }
+            if (cold_time > 0) {
+                segment->Demote(cold_time, FLAGS_cold_block_row_cnt, cold_layout_.get(), FLAGS_cold_block_dict_size,
+                                demote_cnt, demote_saved_byte_size);
             }
             seg_gc_time = ::baidu::common::timer::get_micros() / 1000 - seg_gc_time;
             PDLOG(INFO, "gc segment[%u][%u] done consumed %lu for table %s tid %u pid %u", i, j, seg_gc_time,
                   name_.c_str(), id_, pid_);
         }
     }
+    gc_sweeping_.store(sweeping, std::memory_order_relaxed);
+    if (!sweeping && enable_gc_.load(std::memory_order_relaxed)) {
+        UpgradeRows(FLAGS_schema_upgrade_row_cnt);
+    }
     consumed = ::baidu::common::timer::get_micros() - consumed;
     record_cnt_.fetch_sub(gc_record_cnt, std::memory_order_relaxed);
     record_byte_size_.fetch_sub(gc_record_byte_size, std::memory_order_relaxed);
-    PDLOG(INFO,
-          "gc finished, gc_idx_cnt %lu, gc_record_cnt %lu consumed %lu ms for "
-          "table %s tid %u pid %u",
-          gc_idx_cnt, gc_record_cnt, consumed / 1000, name_.c_str(), id_, pid_);
+    g_gc_latency << consumed;
+    g_gc_freed_records << gc_record_cnt;
+    g_gc_freed_bytes << gc_record_byte_size;
+    if (gc_idx_cnt > 0 || gc_record_cnt > 0) {
+        IncrWriteVersion();
+    }
+    if (sweeping) {
+        DEBUGLOG("gc slice finished, gc_idx_cnt %lu, gc_record_cnt %lu consumed %lu ms for table %s tid %u pid %u",
+                 gc_idx_cnt, gc_record_cnt, consumed / 1000, name_.c_str(), id_, pid_);
+    } else {
+        PDLOG(INFO,
+              "gc finished, gc_idx_cnt %lu, gc_record_cnt %lu consumed %lu ms for "
+              "table %s tid %u pid %u",
+              gc_idx_cnt, gc_record_cnt, consumed / 1000, name_.c_str(), id_, pid_);
+    }
+    if (demote_cnt > 0) {
+        PDLOG(INFO, "demote %lu records to cold blocks and save %lu bytes for table %s tid %u pid %u", demote_cnt,
+              demote_saved_byte_size, name_.c_str(), id_, pid_);
+    }
     UpdateTTL();
+    UpdateLatestKeepCnt();
+}
+
+void MemTable::UpdateLatestKeepCnt() {
+    auto inner_indexs = table_index_.GetAllInnerIndex();
+    for (uint32_t i = 0; i < inner_indexs->size(); i++) {
+        if (segments_[i] == NULL) {
+            continue;
+        }
+        const std::vector<std::shared_ptr<IndexDef>>& real_index = inner_indexs->at(i)->GetIndex();
+        uint64_t keep_cnt = 0;
+        // the inner index shared by multiple indexes is left to the gc
+        if (real_index.size() == 1 && real_index[0]->GetStatus() == IndexStatus::kReady) {
+            auto ttl = real_index[0]->GetTTL();
+            if (ttl->ttl_type == ::openmldb::storage::TTLType::kLatestTime) {
+                keep_cnt = ttl->lat_ttl;
+            }
+        }
+        for (uint32_t j = 0; j < seg_cnt_; j++) {
+            if (segments_[i][j] != NULL) {
+                segments_[i][j]->SetLatestKeepCnt(keep_cnt);
+            }
+        }
+    }
+}
+
+void MemTable::GetHotKeys(uint32_t limit, ::openmldb::api::GetHotKeysResponse* response) {
+    auto inner_indexs = table_index_.GetAllInnerIndex();
+    for (uint32_t i = 0; i < inner_indexs->size(); i++) {
+        std::string index_name;
+        for (const auto& index_def : inner_indexs->at(i)->GetIndex()) {
+            if (index_def->GetStatus() == IndexStatus::kReady) {
+                index_name = index_def->GetName();
+                break;
+            }
+        }
+        if (index_name.empty() || segments_[i] == NULL) {
+            continue;
+        }
+        std::vector<std::pair<std::string, uint64_t>> hot_keys;
+        for (uint32_t j = 0; j < seg_cnt_; j++) {
+            segments_[i][j]->GetHotKeys(&hot_keys);
+        }
+        std::sort(hot_keys.begin(), hot_keys.end(),
+                  [](const std::pair<std::string, uint64_t>& a, const std::pair<std::string, uint64_t>& b) {
+                      return a.second > b.second;
+                  });
+        if (limit > 0 && hot_keys.size() > limit) {
+            hot_keys.resize(limit);
+        }
+        for (const auto& kv : hot_keys) {
+            auto hot_key = response->add_hot_keys();
+            hot_key->set_index_name(index_name);
+            hot_key->set_key(kv.first);
+            hot_key->set_count(kv.second);
+        }
+    }
+}
+
+uint32_t MemTable::GetSegIdx(const std::string& pk) const {
+    if (seg_cnt_ <= 1) {
+        return 0;
+    }
+    return ::openmldb::base::hash(pk.data(), pk.size(), SEED) % seg_cnt_;
+}
+
+uint64_t MemTable::GetGcLag() {
+    uint64_t gc_lag = 0;
+    auto inner_indexs = table_index_.GetAllInnerIndex();
+    for (size_t i = 0; i < inner_indexs->size(); i++) {
+        if (segments_[i] == NULL) {
+            continue;
+        }
+        for (uint32_t j = 0; j < seg_cnt_; j++) {
+            gc_lag = std::max(gc_lag, segments_[i][j]->GetGcLag());
+        }
+    }
+    return gc_lag;
+}
+
+void MemTable::GetPkFilterStat(uint64_t* lookup_cnt, uint64_t* filtered_cnt) {
+    *lookup_cnt = 0;
+    *filtered_cnt = 0;
+    auto inner_indexs = table_index_.GetAllInnerIndex();
+    for (size_t i = 0; i < inner_indexs->size(); i++) {
+        if (segments_[i] == NULL) {
+            continue;
+        }
+        for (uint32_t j = 0; j < seg_cnt_; j++) {
+            *lookup_cnt += segments_[i][j]->GetPkLookupCnt();
+            *filtered_cnt += segments_[i][j]->GetPkFilteredCnt();
+        }
+    }
 }
 
 // tll as ms
@@ -505,6 +1093,23 @@ int MemTable::GetCount(uint32_t index, const std::string& pk, uint64_t& count) {
     return segment->GetCount(spk, count);
 }
 
+int MemTable::GetLiveCount(uint32_t index, const std::string& pk, uint64_t expire_time, uint64_t expire_cnt,
+                           bool skip_zero_ts, uint64_t* count) {
+    std::shared_ptr<IndexDef> index_def = table_index_.GetIndex(index);
+    if (!index_def || !index_def->IsReady()) {
+        return -1;
+    }
+    uint32_t seg_idx = 0;
+    if (seg_cnt_ > 1) {
+        seg_idx = ::openmldb::base::hash(pk.c_str(), pk.length(), SEED) % seg_cnt_;
+    }
+    Segment* segment = segments_[index_def->GetInnerPos()][seg_idx];
+    auto ts_col = index_def->GetTsColumn();
+    uint32_t ts_idx = ts_col ? ts_col->GetTsIdx() : 0;
+    return segment->GetLiveCount(Slice(pk), ts_idx, expire_time, expire_cnt, index_def->GetTTLType(), skip_zero_ts,
+                                 count);
+}
+
 TableIterator* MemTable::NewIterator(const std::string& pk, Ticket& ticket) { return NewIterator(0, pk, ticket); }
 
 TableIterator* MemTable::NewIterator(uint32_t index, const std::string& pk, Ticket& ticket) {
@@ -521,10 +1126,12 @@ TableIterator* MemTable::NewIterator(uint32_t index, const std::string& pk, Tick
     uint32_t real_idx = index_def->GetInnerPos();
     Segment* segment = segments_[real_idx][seg_idx];
     auto ts_col = index_def->GetTsColumn();
-    if (ts_col) {
-        return segment->NewIterator(spk, ts_col->GetTsIdx(), ticket);
+    MemTableIterator* it = ts_col ? segment->NewIterator(spk, ts_col->GetTsIdx(), ticket)
+                                  : segment->NewIterator(spk, ticket);
+    if (compact_codec_) {
+        it->SetCompactCodec(compact_codec_);
     }
-    return segment->NewIterator(spk, ticket);
+    return it;
 }
 
 uint64_t MemTable::GetRecordIdxByteSize() {
@@ -547,6 +1154,26 @@ uint64_t MemTable::GetRecordIdxByteSize() {
     return record_idx_byte_size;
 }
 
+void MemTable::GetIndexMemStat(std::vector<std::pair<std::string, SegmentMemStat>>* stats) {
+    auto inner_indexs = table_index_.GetAllInnerIndex();
+    for (size_t i = 0; i < inner_indexs->size(); i++) {
+        std::string name;
+        for (const auto& index_def : inner_indexs->at(i)->GetIndex()) {
+            if (index_def && index_def->IsReady()) {
+                name.append(name.empty() ? "" : ",").append(index_def->GetName());
+            }
+        }
+        if (name.empty()) {
+            continue;
+        }
+        SegmentMemStat stat;
+        for (uint32_t j = 0; j < seg_cnt_; j++) {
+            segments_[i][j]->GetMemStat(&stat);
+        }
+        stats->emplace_back(name, stat);
+    }
+}
+
 uint64_t MemTable::GetRecordIdxCnt() {
     uint64_t record_idx_cnt = 0;
     auto inner_indexs = table_index_.GetAllInnerIndex();
@@ -605,6 +1232,31 @@ bool MemTable::GetRecordIdxCnt(uint32_t idx, uint64_t** stat, uint32_t* size) {
     return true;
 }
 
+bool MemTable::GetIndexStats(const std::string& index_name, uint64_t* pk_cnt, uint64_t* row_cnt) {
+    std::shared_ptr<IndexDef> index_def = table_index_.GetIndex(index_name);
+    if (!index_def || !index_def->IsReady()) {
+        return false;
+    }
+    uint32_t real_idx = index_def->GetInnerPos();
+    auto ts_col = index_def->GetTsColumn();
+    *pk_cnt = 0;
+    *row_cnt = 0;
+    for (uint32_t i = 0; i < seg_cnt_; i++) {
+        Segment* segment = segments_[real_idx][i];
+        *pk_cnt += segment->GetPkCnt();
+        uint64_t cnt = 0;
+        if (segment->GetTsCnt() > 1 && ts_col) {
+            if (segment->GetIdxCnt(ts_col->GetTsIdx(), cnt) < 0) {
+                return false;
+            }
+        } else {
+            cnt = segment->GetIdxCnt();
+        }
+        *row_cnt += cnt;
+    }
+    return true;
+}
+
 bool MemTable::AddIndex(const ::openmldb::common::ColumnKey& column_key) {
     // TODO(denglong): support ttl type and merge index
     auto table_meta = GetTableMeta();
@@ -715,7 +1367,17 @@ bool MemTable::DeleteIndex(const std::string& idx_name) {
     if (ts_col) {
         ts_idx = ts_col->GetTsIdx();
     }
-    return new MemTableKeyIterator(segments_[real_idx], seg_cnt_, ttl->ttl_type, expire_time, expire_cnt, ts_idx);
+    auto it = new MemTableKeyIterator(segments_[real_idx], seg_cnt_, ttl->ttl_type, expire_time, expire_cnt, ts_idx);
+    if (compact_codec_) {
+        it->SetCompactCodec(compact_codec_);
+    }
+    // the rows written before a column is added are encoded with the old schema
+    auto table_meta = GetTableMeta();
+    if (table_meta->format_version() == 1 && table_meta->compress_type() == ::openmldb::type::kNoCompress &&
+        table_meta->added_column_desc_size() == 0) {
+        it->EnablePredicate();
+    }
+    return it;
 }
 
 TableIterator* MemTable::NewTraverseIterator(uint32_t index) {
@@ -733,11 +1395,12 @@ TableIterator* MemTable::NewTraverseIterator(uint32_t index) {
     }
     uint32_t real_idx = index_def->GetInnerPos();
     auto ts_col = index_def->GetTsColumn();
-    if (ts_col) {
-        return new MemTableTraverseIterator(segments_[real_idx], seg_cnt_, ttl->ttl_type, expire_time, expire_cnt,
-                                            ts_col->GetTsIdx());
+    auto it = new MemTableTraverseIterator(segments_[real_idx], seg_cnt_, ttl->ttl_type, expire_time, expire_cnt,
+                                           ts_col ? ts_col->GetTsIdx() : 0);
+    if (compact_codec_) {
+        it->SetCompactCodec(compact_codec_);
     }
-    return new MemTableTraverseIterator(segments_[real_idx], seg_cnt_, ttl->ttl_type, expire_time, expire_cnt, 0);
+    return it;
 }
 
 bool MemTable::GetBulkLoadInfo(::openmldb::api::BulkLoadInfoResponse* response) {
@@ -787,6 +1450,7 @@ bool MemTable::GetBulkLoadInfo(::openmldb::api::BulkLoadInfoResponse* response)
 bool MemTable::BulkLoad(const std::vector<DataBlock*>& data_blocks,
                         const ::google::protobuf::RepeatedPtrField<::openmldb::api::BulkLoadIndex>& indexes) {
     // data_block[i] is the block which id == i
+    std::vector<std::pair<uint64_t, DataBlock*>> rows;
     for (int i = 0; i < indexes.size(); ++i) {
         const auto& inner_index = indexes.Get(i);
         auto real_idx = inner_index.inner_index_id();
@@ -800,6 +1464,8 @@ bool MemTable::BulkLoad(const std::vector<DataBlock*>& data_blocks,
                 for (int key_entry_idx = 0; key_entry_idx < key_entries.key_entry_size(); ++key_entry_idx) {
                     const auto& key_entry = key_entries.key_entry(key_entry_idx);
                     auto key_entry_id = key_entry.key_entry_id();
+                    rows.clear();
+                    rows.reserve(key_entry.time_entry_size());
                     for (int time_idx = 0; time_idx < key_entry.time_entry_size(); ++time_idx) {
                         const auto& time_entry = key_entry.time_entry(time_idx);
                         auto* block =
@@ -813,9 +1479,13 @@ bool MemTable::BulkLoad(const std::vector<DataBlock*>& data_blocks,
                         VLOG(1) << "do segment(" << real_idx << "-" << seg_idx << ") put, key" << pk.ToString()
                                 << ", time " << time_entry.time() << ", key_entry_id " << key_entry_id << ", block id "
                                 << time_entry.block_id();
-                        block->dim_cnt_down++;
-                        segment->BulkLoadPut(key_entry_id, pk, time_entry.time(), block);
+                        rows.emplace_back(time_entry.time(), block);
                     }
+                    for (auto& row : rows) {
+                        row.second->dim_cnt_down++;
+                    }
+                    // the rows of a key entry are loaded with one lock of the segment
+                    segment->BulkLoad(key_entry_id, pk, &rows);
                 }
             }
         }
@@ -824,6 +1494,21 @@ bool MemTable::BulkLoad(const std::vector<DataBlock*>& data_blocks,
     return true;
 }
 
+// the key entry of the ts index at the key of pk_it
+static KeyEntry* GetKeyEntry(Segment* segment, KeyEntries::Iterator* pk_it, uint32_t ts_idx) {
+    if (segment->GetTsCnt() > 1) {
+        return ((KeyEntry**)pk_it->GetValue())[ts_idx];  // NOLINT
+    }
+    return (KeyEntry*)pk_it->GetValue();  // NOLINT
+}
+
+// the rows are in the descending order of ts, so all the rows of a key are expired if the newest one is. It is
+// checked on the first node of the list without an iterator
+static bool IsKeyExpired(KeyEntry* entry, const TTLSt& expire_value) {
+    auto node = entry->entries.GetFirst();
+    return node == NULL || expire_value.IsExpired(node->GetKey(), 1);
+}
+
 MemTableKeyIterator::MemTableKeyIterator(Segment** segments, uint32_t seg_cnt, ::openmldb::storage::TTLType ttl_type,
                                          uint64_t expire_time, uint64_t expire_cnt, uint32_t ts_index)
     : segments_(segments),
@@ -834,6 +1519,7 @@ MemTableKeyIterator::MemTableKeyIterator(Segment** segments, uint32_t seg_cnt, :
       ttl_type_(ttl_type),
       expire_time_(expire_time),
       expire_cnt_(expire_cnt),
+      expire_value_(expire_time, expire_cnt, ttl_type),
       ticket_(),
       ts_idx_(0) {
     uint32_t idx = 0;
@@ -855,7 +1541,10 @@ void MemTableKeyIterator::SeekToFirst() {
     for (seg_idx_ = 0; seg_idx_ < seg_cnt_; seg_idx_++) {
         pk_it_ = segments_[seg_idx_]->GetKeyEntries()->NewIterator();
         pk_it_->SeekToFirst();
-        if (pk_it_->Valid()) return;
+        if (pk_it_->Valid()) {
+            SkipExpiredPK();
+            return;
+        }
         delete pk_it_;
         pk_it_ = NULL;
     }
@@ -875,6 +1564,8 @@ void MemTableKeyIterator::Seek(const std::string& key) {
     pk_it_->Seek(spk);
     if (!pk_it_->Valid()) {
         NextPK();
+    } else {
+        SkipExpiredPK();
     }
 }
 
@@ -885,6 +1576,22 @@ bool MemTableKeyIterator::Valid() {
 
 void MemTableKeyIterator::Next() { NextPK(); }
 
+bool MemTableKeyIterator::SetPredicate(const std::shared_ptr<::hybridse::vm::RowPredicate>& predicate) {
+    if (!predicate_enabled_) {
+        return false;
+    }
+    predicate_ = predicate;
+    return true;
+}
+
+bool MemTableKeyIterator::SetColumnMask(const std::shared_ptr<const std::vector<bool>>& mask) {
+    if (!codec_ || predicate_) {
+        return false;
+    }
+    mask_ = mask;
+    return true;
+}
+
 ::hybridse::vm::RowIterator* MemTableKeyIterator::GetRawValue() {
     TimeEntries::Iterator* it = NULL;
     if (segments_[seg_idx_]->GetTsCnt() > 1) {
@@ -897,7 +1604,16 @@ void MemTableKeyIterator::Next() { NextPK(); }
         ticket_.Push((KeyEntry*)pk_it_->GetValue());  // NOLINT
     }
     it->SeekToFirst();
-    return new MemTableWindowIterator(it, ttl_type_, expire_time_, expire_cnt_);
+    auto wit = new MemTableWindowIterator(it, ttl_type_, expire_time_, expire_cnt_);
+    if (codec_) {
+        wit->SetCompactCodec(codec_);
+    }
+    if (predicate_) {
+        wit->SetPredicate(predicate_);
+    } else if (mask_) {
+        wit->SetColumnMask(mask_);
+    }
+    return wit;
 }
 
 std::unique_ptr<::hybridse::vm::RowIterator> MemTableKeyIterator::GetValue() {
@@ -913,6 +1629,14 @@ std::unique_ptr<::hybridse::vm::RowIterator> MemTableKeyIterator::GetValue() {
     }
     it->SeekToFirst();
     std::unique_ptr<MemTableWindowIterator> wit(new MemTableWindowIterator(it, ttl_type_, expire_time_, expire_cnt_));
+    if (codec_) {
+        wit->SetCompactCodec(codec_);
+    }
+    if (predicate_) {
+        wit->SetPredicate(predicate_);
+    } else if (mask_) {
+        wit->SetColumnMask(mask_);
+    }
     return std::move(wit);
 }
 
@@ -942,6 +1666,29 @@ void MemTableKeyIterator::NextPK() {
         }
         break;
     } while (true);
+    SkipExpiredPK();
+}
+
+void MemTableKeyIterator::SkipExpiredPK() {
+    while (Valid()) {
+        KeyEntry* entry = GetKeyEntry(segments_[seg_idx_], pk_it_, ts_idx_);
+        ticket_.Push(entry);
+        bool expired = IsKeyExpired(entry, expire_value_);
+        ticket_.Pop();
+        if (!expired) {
+            return;
+        }
+        pk_it_->Next();
+        while (!pk_it_->Valid()) {
+            delete pk_it_;
+            pk_it_ = NULL;
+            if (++seg_idx_ >= seg_cnt_) {
+                return;
+            }
+            pk_it_ = segments_[seg_idx_]->GetKeyEntries()->NewIterator();
+            pk_it_->SeekToFirst();
+        }
+    }
 }
 
 MemTableTraverseIterator::MemTableTraverseIterator(Segment** segments, uint32_t seg_cnt,
@@ -981,6 +1728,7 @@ void MemTableTraverseIterator::Next() {
         NextPK();
         return;
     }
+    PrefetchNextRow(it_);
 }
 uint64_t MemTableTraverseIterator::GetCount() const { return traverse_cnt_; }
 
@@ -1006,26 +1754,20 @@ void MemTableTraverseIterator::NextPK() {
                 break;
             }
         }
-        if (it_ != NULL) {
-            delete it_;
-            it_ = NULL;
-        }
-        if (segments_[seg_idx_]->GetTsCnt() > 1) {
-            KeyEntry* entry = ((KeyEntry**)pk_it_->GetValue())[0];  // NOLINT
+        KeyEntry* entry = GetKeyEntry(segments_[seg_idx_], pk_it_, ts_idx_);
+        ticket_.Push(entry);
+        traverse_cnt_++;
+        // the keys expired are skipped without the iterators of their rows
+        if (!IsKeyExpired(entry, expire_value_)) {
             it_ = entry->entries.NewIterator();
-            ticket_.Push(entry);
-        } else {
-            it_ = ((KeyEntry*)pk_it_->GetValue())  // NOLINT
-                      ->entries.NewIterator();
-            ticket_.Push((KeyEntry*)pk_it_->GetValue());  // NOLINT
+            it_->SeekToFirst();
+            record_idx_ = 1;
+            break;
         }
-        it_->SeekToFirst();
-        record_idx_ = 1;
-        traverse_cnt_++;
         if (traverse_cnt_ >= FLAGS_max_traverse_cnt) {
             break;
         }
-    } while (it_ == NULL || !it_->Valid() || expire_value_.IsExpired(it_->GetKey(), record_idx_));
+    } while (true);
 }
 
 void MemTableTraverseIterator::Seek(const std::string& key, uint64_t ts) {
@@ -1091,7 +1833,7 @@ void MemTableTraverseIterator::Seek(const std::string& key, uint64_t ts) {
 }
 
 openmldb::base::Slice MemTableTraverseIterator::GetValue() const {
-    return openmldb::base::Slice(it_->GetValue()->data, it_->GetValue()->size);
+    return cold_reader_.Read(it_->GetValue());
 }
 
 uint64_t MemTableTraverseIterator::GetKey() const {
@@ -1122,23 +1864,15 @@ void MemTableTraverseIterator::SeekToFirst() {
         pk_it_ = segments_[seg_idx_]->GetKeyEntries()->NewIterator();
         pk_it_->SeekToFirst();
         while (pk_it_->Valid()) {
-            if (segments_[seg_idx_]->GetTsCnt() > 1) {
-                KeyEntry* entry = ((KeyEntry**)pk_it_->GetValue())[ts_idx_];  // NOLINT
-                ticket_.Push(entry);
-                it_ = entry->entries.NewIterator();
-            } else {
-                ticket_.Push((KeyEntry*)pk_it_->GetValue());  // NOLINT
-                it_ = ((KeyEntry*)pk_it_->GetValue())         // NOLINT
-                          ->entries.NewIterator();
-            }
-            it_->SeekToFirst();
+            KeyEntry* entry = GetKeyEntry(segments_[seg_idx_], pk_it_, ts_idx_);
+            ticket_.Push(entry);
             traverse_cnt_++;
-            if (it_->Valid() && !expire_value_.IsExpired(it_->GetKey(), record_idx_)) {
+            if (!IsKeyExpired(entry, expire_value_)) {
+                it_ = entry->entries.NewIterator();
+                it_->SeekToFirst();
                 record_idx_ = 1;
                 return;
             }
-            delete it_;
-            it_ = NULL;
             pk_it_->Next();
             ticket_.Pop();
             if (traverse_cnt_ >= FLAGS_max_traverse_cnt) {
@@ -17,14 +17,22 @@
 #ifndef SRC_STORAGE_MEM_TABLE_H_
 #define SRC_STORAGE_MEM_TABLE_H_
 
+#include <stdlib.h>
+#include <string.h>
+
 #include <atomic>
 #include <map>
 #include <memory>
+#include <mutex>  // NOLINT
 #include <string>
 #include <vector>
 
+#include "codec/compact_row.h"
 #include "proto/tablet.pb.h"
+#include "storage/data_block_pool.h"
 #include "storage/iterator.h"
+#include "storage/mapped_snapshot.h"
+#include "storage/pre_aggregator.h"
 #include "storage/segment.h"
 #include "storage/table.h"
 #include "storage/ticket.h"
@@ -42,38 +50,109 @@ class MemTableWindowIterator : public ::hybridse::vm::RowIterator {
  public:
     MemTableWindowIterator(TimeEntries::Iterator* it, ::openmldb::storage::TTLType ttl_type, uint64_t expire_time,
                            uint64_t expire_cnt)
-        : it_(it), record_idx_(0), expire_value_(expire_time, expire_cnt, ttl_type), row_() {}
+        : it_(it),
+          record_idx_(0),
+          expire_value_(expire_time, expire_cnt, ttl_type),
+          row_(),
+          predicate_(),
+          bound_key_(0),
+          bound_cnt_(0),
+          seek_cnt_(0) {}
 
     ~MemTableWindowIterator() { delete it_; }
 
+    void SetCompactCodec(const std::shared_ptr<::openmldb::codec::CompactRowCodec>& codec) {
+        cold_reader_.SetCompactCodec(codec);
+    }
+
+    // the rows not matched by the predicate are skipped without being materialized
+    void SetPredicate(const std::shared_ptr<::hybridse::vm::RowPredicate>& predicate) {
+        predicate_ = predicate;
+        SkipUnmatched();
+    }
+
+    // the columns not set are read as null from the compact rows
+    void SetColumnMask(const std::shared_ptr<const std::vector<bool>>& mask) { cold_reader_.SetColumnMask(mask); }
+
+    bool SetBound(const uint64_t& bound, uint64_t limit) override {
+        bound_key_ = bound;
+        bound_cnt_ = limit;
+        return true;
+    }
+
     inline bool Valid() const {
         if (!it_->Valid() || expire_value_.IsExpired(it_->GetKey(), record_idx_)) {
             return false;
         }
+        if (it_->GetKey() < bound_key_ || (bound_cnt_ > 0 && seek_cnt_ >= bound_cnt_)) {
+            return false;
+        }
         return true;
     }
 
     inline void Next() {
         it_->Next();
         record_idx_++;
+        seek_cnt_++;
+        SkipUnmatched();
+        PrefetchNextRow(it_);
     }
 
     inline const uint64_t& GetKey() const { return it_->GetKey(); }
 
     // TODO(wangtaize) unify the row object
     inline const ::hybridse::codec::Row& GetValue() {
-        row_.Reset(reinterpret_cast<const int8_t*>(it_->GetValue()->data), it_->GetValue()->size);
+        const DataBlock* block = it_->GetValue();
+        ::openmldb::base::Slice value = cold_reader_.Read(block);
+        if (value.data() != block->data) {
+            // the row outlives the iterator, so copy the unpacked or decoded row into a managed buffer
+            auto slice = ::hybridse::base::RefCountedSlice::Allocate(value.size());
+            memcpy(slice.buf(), value.data(), value.size());
+            row_ = ::hybridse::codec::Row(slice);
+        } else {
+            row_.Reset(reinterpret_cast<const int8_t*>(block->data), block->size);
+        }
         return row_;
     }
-    inline void Seek(const uint64_t& key) { it_->Seek(key); }
-    inline void SeekToFirst() { it_->SeekToFirst(); }
+    inline void Seek(const uint64_t& key) {
+        it_->Seek(key);
+        seek_cnt_ = 0;
+        SkipUnmatched();
+    }
+    inline void SeekToFirst() {
+        it_->SeekToFirst();
+        seek_cnt_ = 0;
+        SkipUnmatched();
+    }
     inline bool IsSeekable() const { return true; }
 
+ private:
+    // the skipped rows are still counted by record_idx_, so the latest ttl is applied as before
+    inline void SkipUnmatched() {
+        if (!predicate_) {
+            return;
+        }
+        while (Valid()) {
+            ::openmldb::base::Slice value = cold_reader_.Read(it_->GetValue());
+            if (predicate_->Match(reinterpret_cast<const int8_t*>(value.data()), value.size())) {
+                break;
+            }
+            it_->Next();
+            record_idx_++;
+        }
+    }
+
  private:
     TimeEntries::Iterator* it_;
     uint32_t record_idx_;
     TTLSt expire_value_;
     ::hybridse::codec::Row row_;
+    ColdRowReader cold_reader_;
+    std::shared_ptr<::hybridse::vm::RowPredicate> predicate_;
+    // the iteration stops at the rows with the keys less than bound_key_ or after bound_cnt_ rows since the seek
+    uint64_t bound_key_;
+    uint64_t bound_cnt_;
+    uint64_t seek_cnt_;
 };
 
 class MemTableKeyIterator : public ::hybridse::vm::WindowIterator {
@@ -83,6 +162,16 @@ class MemTableKeyIterator : public ::hybridse::vm::WindowIterator {
 
     ~MemTableKeyIterator() override;
 
+    void SetCompactCodec(const std::shared_ptr<::openmldb::codec::CompactRowCodec>& codec) { codec_ = codec; }
+
+    // the predicate is evaluated only on the rows encoded in place with the schema of sql
+    void EnablePredicate() { predicate_enabled_ = true; }
+    // the predicate is set to the iterators of the keys, return false if it is ignored
+    bool SetPredicate(const std::shared_ptr<::hybridse::vm::RowPredicate>& predicate);
+    // the mask is set to the iterators of the keys, return false if it is ignored. only the compact
+    // rows are decoded by the mask and the mask is ignored with a predicate, which reads the full rows
+    bool SetColumnMask(const std::shared_ptr<const std::vector<bool>>& mask);
+
     void Seek(const std::string& key) override;
 
     void SeekToFirst() override;
@@ -98,6 +187,8 @@ class MemTableKeyIterator : public ::hybridse::vm::WindowIterator {
 
  private:
     void NextPK();
+    // move past the keys whose rows are all expired before the gc
+    void SkipExpiredPK();
 
  private:
     Segment** segments_;
@@ -108,9 +199,14 @@ class MemTableKeyIterator : public ::hybridse::vm::WindowIterator {
     ::openmldb::storage::TTLType ttl_type_;
     uint64_t expire_time_;
     uint64_t expire_cnt_;
+    TTLSt expire_value_;
     uint32_t ts_index_{};
     Ticket ticket_;
     uint32_t ts_idx_;
+    std::shared_ptr<::openmldb::codec::CompactRowCodec> codec_;
+    bool predicate_enabled_ = false;
+    std::shared_ptr<::hybridse::vm::RowPredicate> predicate_;
+    std::shared_ptr<const std::vector<bool>> mask_;
 };
 
 class MemTableTraverseIterator : public TableIterator {
@@ -118,6 +214,9 @@ class MemTableTraverseIterator : public TableIterator {
     MemTableTraverseIterator(Segment** segments, uint32_t seg_cnt, ::openmldb::storage::TTLType ttl_type,
                              uint64_t expire_time, uint64_t expire_cnt, uint32_t ts_index);
     ~MemTableTraverseIterator() override;
+    void SetCompactCodec(const std::shared_ptr<::openmldb::codec::CompactRowCodec>& codec) {
+        cold_reader_.SetCompactCodec(codec);
+    }
     inline bool Valid() override;
     void Next() override;
     void Seek(const std::string& key, uint64_t time) override;
@@ -126,6 +225,7 @@ class MemTableTraverseIterator : public TableIterator {
     uint64_t GetKey() const override;
     void SeekToFirst() override;
     uint64_t GetCount() const override;
+    void ResetCount() override { traverse_cnt_ = 0; }
 
  private:
     void NextPK();
@@ -142,6 +242,7 @@ class MemTableTraverseIterator : public TableIterator {
     TTLSt expire_value_;
     Ticket ticket_;
     uint64_t traverse_cnt_;
+    mutable ColdRowReader cold_reader_;
 };
 
 class MemTable : public Table {
@@ -167,6 +268,13 @@ class MemTable : public Table {
 
     bool Put(const Dimensions& dimensions, const TSDimensions& ts_dimensions, const std::string& value) override;
 
+    // Put a record of a mapped snapshot, the row refers to the value in place
+    // and the snapshot should be added by AddMappedSnapshot
+    bool PutMapped(const ::openmldb::api::LogEntry& entry, const ::openmldb::base::Slice& value);
+
+    // keep the snapshot mapped until the table is destroyed
+    void AddMappedSnapshot(const std::shared_ptr<MappedSnapshot>& mapped_snapshot);
+
     bool GetBulkLoadInfo(::openmldb::api::BulkLoadInfoResponse* response);
 
     bool BulkLoad(const std::vector<DataBlock*>& data_blocks,
@@ -174,6 +282,10 @@ class MemTable : public Table {
 
     bool Delete(const std::string& pk, uint32_t idx) override;
 
+    bool DeleteRange(const std::string& pk, uint32_t idx, uint64_t start_ts, uint64_t end_ts) override;
+
+    bool DeleteRange(uint64_t start_ts, uint64_t end_ts) override;
+
     // use the first demission
     TableIterator* NewIterator(const std::string& pk, Ticket& ticket) override;
 
@@ -186,15 +298,38 @@ class MemTable : public Table {
     // release all memory allocated
     uint64_t Release();
 
+    // execute a slice of gc if gc_slice_key_cnt is set, otherwise a whole round of gc
     void SchedGc() override;
 
+    // whether the round of gc is not finished by the last SchedGc
+    inline bool IsGcSweeping() const { return gc_sweeping_.load(std::memory_order_relaxed); }
+
+    // the max time in ms since the unfinished gc rounds of segments started
+    uint64_t GetGcLag();
+
+    // the lookups of the keys checked by the pk filters of all the segments, and the ones filtered
+    void GetPkFilterStat(uint64_t* lookup_cnt, uint64_t* filtered_cnt);
+
+    // the hot keys of every index whose rows are not deleted, at most limit keys of an index
+    // if limit is not 0
+    void GetHotKeys(uint32_t limit, ::openmldb::api::GetHotKeysResponse* response);
+
     int GetCount(uint32_t index, const std::string& pk,
                  uint64_t& count);  // NOLINT
+    // the count of the rows of pk not expired, see Segment::GetLiveCount
+    int GetLiveCount(uint32_t index, const std::string& pk, uint64_t expire_time, uint64_t expire_cnt,
+                     bool skip_zero_ts, uint64_t* count);
 
     uint64_t GetRecordIdxCnt();
     bool GetRecordIdxCnt(uint32_t idx, uint64_t** stat, uint32_t* size);
+    // the count of the keys and the rows of the index, false if the index is not ready
+    bool GetIndexStats(const std::string& index_name, uint64_t* pk_cnt, uint64_t* row_cnt);
     uint64_t GetRecordIdxByteSize();
+    // the bytes of the rows and the indexes, including the nodes of the skiplists and the key entries
+    uint64_t GetMemoryUsage() { return GetRecordByteSize() + GetRecordIdxByteSize(); }
     uint64_t GetRecordPkCnt();
+    // the bytes of the parts of every ready inner index with the names of its indexes
+    void GetIndexMemStat(std::vector<std::pair<std::string, SegmentMemStat>>* stats);
 
     void SetCompressType(::openmldb::type::CompressType compress_type);
     ::openmldb::type::CompressType GetCompressType();
@@ -205,6 +340,9 @@ class MemTable : public Table {
 
     inline uint32_t GetSegCnt() const { return seg_cnt_; }
 
+    // the segment of the pk in every index
+    uint32_t GetSegIdx(const std::string& pk) const;
+
     inline void SetExpire(bool is_expire) { enable_gc_.store(is_expire, std::memory_order_relaxed); }
 
     uint64_t GetExpireTime(const TTLSt& ttl_st) override;
@@ -219,24 +357,92 @@ class MemTable : public Table {
 
     inline uint32_t GetKeyEntryHeight() const { return key_entry_max_height_; }
 
+    // the version changes after every write and gc, the versions of two tables never equal
+    inline uint64_t GetWriteVersion() const { return write_version_.load(std::memory_order_acquire); }
+
     bool DeleteIndex(const std::string& idx_name);
 
     bool AddIndex(const ::openmldb::common::ColumnKey& column_key);
 
+    // return NULL if the data block pool is disabled
+    DataBlockPool* GetDataBlockPool() { return block_pool_.get(); }
+
+    int32_t GetNumaNode() const { return numa_node_; }
+
+    // aggregate aggr_col of the rows of pk in the index with ts in [st, et] by the
+    // pre-aggregated buckets, return false if there is no such pre-aggregation
+    bool PreAggregate(uint32_t index_id, const std::string& aggr_col, const std::string& pk, uint64_t st,
+                      uint64_t et, AggrState* state);
+
  private:
     bool CheckAbsolute(const TTLSt& ttl, uint64_t ts);
 
+    bool Put(const std::string& pk, uint64_t time, const char* data, uint32_t size, bool mapped);
+
+    bool Put(uint64_t time, const Dimensions& dimensions, const char* data, uint32_t size, bool mapped);
+
+    bool Put(const Dimensions& dimensions, const TSDimensions& ts_dimensions, const char* data, uint32_t size,
+             bool mapped);
+
+    // the data is not copied if it is mapped, and it is stored as a compact row if it is smaller.
+    // time decides the bucket of the pool the row is put in
+    DataBlock* NewDataBlock(uint8_t dim_cnt, const char* data, uint32_t len, uint64_t time, bool mapped);
+
+    // return false if the row is not smaller in the compact format, or it has no blob without the compact row format
+    bool EncodeCompactRow(const char* data, uint32_t size, std::string* buf);
+
+    // project the row of an older schema version to the latest version, return false if the row is of the latest
+    // version already or it can not be upgraded
+    bool UpgradeRow(const char* data, uint32_t size, std::string* buf);
+
+    // whether the rows are put and upgraded as rows of format version 1
+    bool CanUpgradeRows();
+
+    // upgrade at most max_row_cnt rows of the older schema versions to the latest version, the table is single
+    // version once a sweep of all the segments finds no row of the older versions. It is called by the gc thread
+    void UpgradeRows(uint64_t max_row_cnt);
+
     bool CheckLatest(uint32_t index_id, const std::string& key, uint64_t ts);
 
+    bool InitPreAggregators();
+
+    // set the latest keep count of the segments of the ready latest ttl indexes, see Segment::SetLatestKeepCnt
+    void UpdateLatestKeepCnt();
+
+    // the ts_dimensions is NULL if all the indexes use time
+    // bump the write version after the write is visible
+    inline void IncrWriteVersion() { write_version_.fetch_add(1, std::memory_order_release); }
+
+    void UpdatePreAggregators(const Dimensions& dimensions, const TSDimensions* ts_dimensions, uint64_t time,
+                              const char* data, uint32_t size);
+
+    // the column count of the schema version of row, 0 if the version is unknown
+    uint32_t GetColumnCount(const int8_t* row, uint32_t size);
+
  private:
     uint32_t seg_cnt_;
     std::vector<Segment**> segments_;
     std::atomic<bool> enable_gc_;
+    // serialize the gc slices as the gc may be triggered by the periodic task and the rpc at the same time
+    std::mutex gc_mu_;
+    std::atomic<bool> gc_sweeping_;
     uint64_t ttl_offset_;
     std::atomic<uint64_t> record_cnt_;
     bool segment_released_;
     std::atomic<uint64_t> record_byte_size_;
     uint32_t key_entry_max_height_;
+    std::unique_ptr<DataBlockPool> block_pool_;
+    // the numa node the rows of the partition are put on, -1 if it is not numa aware
+    int32_t numa_node_ = -1;
+    std::mutex mapped_mu_;
+    // the snapshots referred by the mapped rows
+    std::vector<std::shared_ptr<MappedSnapshot>> mapped_snapshots_;
+    std::vector<std::unique_ptr<PreAggregator>> pre_aggregators_;
+    // the layout of the cold blocks, NULL if the cold rows are packed one after another
+    std::unique_ptr<ColdBlockLayout> cold_layout_;
+    // the codec of the compact rows, NULL if the rows are kept as they are put
+    std::shared_ptr<::openmldb::codec::CompactRowCodec> compact_codec_;
+    std::atomic<uint64_t> write_version_;
 };
 
 }  // namespace storage
@@ -14,6 +14,9 @@
  * limitations under the License.
  */
 
+#include <set>
+#include <string>
+
 #include "common/timer.h"
 #include "gtest/gtest.h"
 #include "storage/mem_table.h"
@@ -48,6 +51,81 @@ TEST_F(MemTableIteratorTest, smoketest) {
     ASSERT_FALSE(it->Valid());
 }
 
+TEST_F(MemTableIteratorTest, bound) {
+    std::map<std::string, uint32_t> mapping;
+    mapping.insert(std::make_pair("idx0", 0));
+    MemTable* table = new MemTable("tx_log", 1, 1, 8, mapping, 10, ::openmldb::type::TTLType::kAbsoluteTime);
+    std::string key = "test";
+    std::string value = "test";
+    uint64_t now = ::baidu::common::timer::get_micros() / 1000;
+    table->Init();
+    for (uint64_t i = 0; i < 10; i++) {
+        table->Put(key, now - i, value.c_str(), value.size());
+    }
+    std::unique_ptr<::hybridse::vm::WindowIterator> it(table->NewWindowIterator(0));
+    it->SeekToFirst();
+    ASSERT_TRUE(it->Valid());
+    auto count = [](::hybridse::vm::RowIterator* wit, uint64_t seek_key) {
+        uint64_t cnt = 0;
+        wit->Seek(seek_key);
+        while (wit->Valid()) {
+            cnt++;
+            wit->Next();
+        }
+        return cnt;
+    };
+    std::unique_ptr<::hybridse::vm::RowIterator> wit = it->GetValue();
+    ASSERT_EQ(8u, count(wit.get(), now - 2));
+    ASSERT_TRUE(wit->SetBound(now - 5, 0));
+    ASSERT_EQ(4u, count(wit.get(), now - 2));
+    ASSERT_TRUE(wit->SetBound(0, 3));
+    ASSERT_EQ(3u, count(wit.get(), now - 1));
+    ASSERT_TRUE(wit->SetBound(now - 5, 3));
+    ASSERT_EQ(2u, count(wit.get(), now - 4));
+}
+
+TEST_F(MemTableIteratorTest, skip_expired_key) {
+    std::map<std::string, uint32_t> mapping;
+    mapping.insert(std::make_pair("idx0", 0));
+    MemTable* table = new MemTable("tx_log", 1, 1, 8, mapping, 10, ::openmldb::type::TTLType::kAbsoluteTime);
+    std::string value = "test";
+    uint64_t now = ::baidu::common::timer::get_micros() / 1000;
+    table->Init();
+    // the rows older than the ttl of 10 minutes are kept until the gc
+    for (int i = 0; i < 100; i++) {
+        std::string key = "key" + std::to_string(i);
+        uint64_t ts = i % 10 == 0 ? now - i : now - 20 * 60 * 1000 - i;
+        table->Put(key, ts, value.c_str(), value.size());
+        table->Put(key, ts - 1, value.c_str(), value.size());
+    }
+    std::set<std::string> keys;
+    std::unique_ptr<::hybridse::vm::WindowIterator> it(table->NewWindowIterator(0));
+    for (it->SeekToFirst(); it->Valid(); it->Next()) {
+        keys.insert(it->GetKey().ToString());
+        std::unique_ptr<::hybridse::vm::RowIterator> wit = it->GetValue();
+        wit->SeekToFirst();
+        ASSERT_TRUE(wit->Valid());
+    }
+    ASSERT_EQ(10u, keys.size());
+    // the key expired is skipped by the seek too
+    it->Seek("key1");
+    ASSERT_TRUE(!it->Valid() || it->GetKey().ToString() != "key1");
+
+    keys.clear();
+    std::unique_ptr<TableIterator> traverse_it(table->NewTraverseIterator(0));
+    uint64_t cnt = 0;
+    for (traverse_it->SeekToFirst(); traverse_it->Valid(); traverse_it->Next()) {
+        keys.insert(traverse_it->GetPK());
+        cnt++;
+    }
+    ASSERT_EQ(10u, keys.size());
+    ASSERT_EQ(20u, cnt);
+    for (const auto& key : keys) {
+        ASSERT_EQ(0, std::stoi(key.substr(3)) % 10);
+    }
+    delete table;
+}
+
 }  // namespace storage
 }  // namespace openmldb
 
@@ -23,6 +23,7 @@
 #include <snappy.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <set>
 #include <utility>
 
@@ -43,6 +44,8 @@
 #include "log/log_reader.h"
 #include "log/sequential_file.h"
 #include "proto/tablet.pb.h"
+#include "storage/mapped_snapshot.h"
+#include "storage/mem_table.h"
 
 using google::protobuf::RepeatedPtrField;
 using ::openmldb::codec::SchemaCodec;
@@ -53,14 +56,19 @@ DECLARE_uint32(make_snapshot_max_deleted_keys);
 DECLARE_uint32(load_table_batch);
 DECLARE_uint32(load_table_thread_num);
 DECLARE_uint32(load_table_queue_size);
+DECLARE_uint32(extract_index_thread_num);
 DECLARE_string(snapshot_compression);
+DECLARE_uint64(background_disk_io_limit);
+DECLARE_bool(snapshot_mmap);
+DECLARE_uint32(snapshot_delta_max_num);
 
 namespace openmldb {
 namespace storage {
 
-const std::string SNAPSHOT_SUBFIX = ".sdb";  // NOLINT
-const uint32_t KEY_NUM_DISPLAY = 1000000;    // NOLINT
-const std::string MANIFEST = "MANIFEST";     // NOLINT
+const std::string SNAPSHOT_SUBFIX = ".sdb";              // NOLINT
+const uint32_t KEY_NUM_DISPLAY = 1000000;                // NOLINT
+const std::string MANIFEST = "MANIFEST";                 // NOLINT
+const std::string DELTA_SNAPSHOT_SUBFIX = ".delta.sdb";  // NOLINT
 
 MemTableSnapshot::MemTableSnapshot(uint32_t tid, uint32_t pid, LogParts* log_part, const std::string& db_root_path)
     : Snapshot(tid, pid), log_part_(log_part), db_root_path_(db_root_path) {}
@@ -88,6 +96,9 @@ bool MemTableSnapshot::Recover(std::shared_ptr<Table> table, uint64_t& latest_of
     }
     if (ret == 0) {
         RecoverFromSnapshot(manifest.name(), manifest.count(), table);
+        if (manifest.deltas_size() > 0) {
+            RecoverFromDelta(manifest, table);
+        }
         latest_offset = manifest.offset();
         offset_ = latest_offset;
     }
@@ -99,7 +110,12 @@ void MemTableSnapshot::RecoverFromSnapshot(const std::string& snapshot_name, uin
     std::string full_path = snapshot_path_ + "/" + snapshot_name;
     std::atomic<uint64_t> g_succ_cnt(0);
     std::atomic<uint64_t> g_failed_cnt(0);
-    RecoverSingleSnapshot(full_path, table, &g_succ_cnt, &g_failed_cnt);
+    recovered_cnt_.store(0, std::memory_order_relaxed);
+    recover_expect_cnt_.store(expect_cnt, std::memory_order_relaxed);
+    if (!FLAGS_snapshot_mmap ||
+        !RecoverMappedSnapshot(full_path + MAPPED_SNAPSHOT_SUFFIX, expect_cnt, table, &g_succ_cnt, &g_failed_cnt)) {
+        RecoverSingleSnapshot(full_path, table, &g_succ_cnt, &g_failed_cnt);
+    }
     PDLOG(INFO, "[Recover] progress done stat: success count %lu, failed count %lu",
           g_succ_cnt.load(std::memory_order_relaxed), g_failed_cnt.load(std::memory_order_relaxed));
     if (g_succ_cnt.load(std::memory_order_relaxed) != expect_cnt) {
@@ -108,9 +124,55 @@ void MemTableSnapshot::RecoverFromSnapshot(const std::string& snapshot_name, uin
     }
 }
 
+void MemTableSnapshot::RecoverFromDelta(const ::openmldb::api::Manifest& manifest, std::shared_ptr<Table> table) {
+    uint64_t succ_cnt = 0;
+    uint64_t failed_cnt = 0;
+    std::string buffer;
+    ::openmldb::api::LogEntry entry;
+    for (const auto& delta : manifest.deltas()) {
+        std::string path = snapshot_path_ + delta.name();
+        FILE* fd = fopen(path.c_str(), "rb");
+        if (fd == NULL) {
+            PDLOG(WARNING, "fail to open path %s for error %s", path.c_str(), strerror(errno));
+            continue;
+        }
+        ::openmldb::log::SequentialFile* seq_file = ::openmldb::log::NewSeqFile(path, fd);
+        ::openmldb::log::Reader reader(seq_file, NULL, false, 0, IsCompressed(path));
+        // the deletes apply to the rows put before, so the records are replayed in order
+        while (true) {
+            buffer.clear();
+            ::openmldb::base::Slice record;
+            ::openmldb::base::Status status = reader.ReadRecord(&record, &buffer);
+            if (status.IsWaitRecord() || status.IsEof()) {
+                break;
+            }
+            if (!status.ok() || !entry.ParseFromArray(record.data(), record.size())) {
+                PDLOG(WARNING, "fail to read record of %s for tid %u, pid %u", path.c_str(), tid_, pid_);
+                failed_cnt++;
+                continue;
+            }
+            if (entry.has_method_type() && entry.method_type() == ::openmldb::api::MethodType::kDelete) {
+                table->Delete(entry);
+            } else {
+                table->Put(entry);
+            }
+            succ_cnt++;
+        }
+        delete seq_file;
+    }
+    PDLOG(INFO, "load %d deltas for table tid %u pid %u completed, succ_cnt %lu, failed_cnt %lu",
+          manifest.deltas_size(), tid_, pid_, succ_cnt, failed_cnt);
+}
+
 void MemTableSnapshot::RecoverSingleSnapshot(const std::string& path, std::shared_ptr<Table> table,
                                              std::atomic<uint64_t>* g_succ_cnt, std::atomic<uint64_t>* g_failed_cnt) {
-    ::openmldb::base::TaskPool load_pool_(FLAGS_load_table_thread_num, FLAGS_load_table_batch);
+    uint32_t thread_num = std::max(FLAGS_load_table_thread_num, 1u);
+    ::openmldb::base::TaskPool load_pool_(thread_num, FLAGS_load_table_queue_size);
+    // one thread for each put pool, so the segments of the first index are not contended
+    std::vector<std::shared_ptr<::openmldb::base::TaskPool>> put_pools;
+    for (uint32_t i = 0; i < thread_num; i++) {
+        put_pools.push_back(std::make_shared<::openmldb::base::TaskPool>(1, FLAGS_load_table_queue_size));
+    }
     std::atomic<uint64_t> succ_cnt, failed_cnt;
     succ_cnt = failed_cnt = 0;
 
@@ -139,11 +201,8 @@ void MemTableSnapshot::RecoverSingleSnapshot(const std::string& path, std::share
             ::openmldb::base::Status status = reader.ReadRecord(&record, &buffer);
             if (status.IsWaitRecord() || status.IsEof()) {
                 consumed = ::baidu::common::timer::now_time() - consumed;
-                PDLOG(INFO,
-                      "read path %s for table tid %u pid %u completed, "
-                      "succ_cnt %lu, failed_cnt %lu, consumed %us",
-                      path.c_str(), tid_, pid_, succ_cnt.load(std::memory_order_relaxed),
-                      failed_cnt.load(std::memory_order_relaxed), consumed);
+                PDLOG(INFO, "read path %s for table tid %u pid %u completed, consumed %us", path.c_str(), tid_,
+                      pid_, consumed);
                 break;
             }
 
@@ -156,47 +215,170 @@ void MemTableSnapshot::RecoverSingleSnapshot(const std::string& path, std::share
             std::string* sp = new std::string(record.data(), record.size());
             recordPtr.push_back(sp);
             if (recordPtr.size() >= FLAGS_load_table_batch) {
-                load_pool_.AddTask(
-                    boost::bind(&MemTableSnapshot::Put, this, path, table, recordPtr, &succ_cnt, &failed_cnt));
+                load_pool_.AddTask(boost::bind(&MemTableSnapshot::Decode, this, path, table, recordPtr, &put_pools,
+                                               &succ_cnt, &failed_cnt));
                 recordPtr.clear();
             }
         }
         if (recordPtr.size() > 0) {
-            load_pool_.AddTask(
-                boost::bind(&MemTableSnapshot::Put, this, path, table, recordPtr, &succ_cnt, &failed_cnt));
+            load_pool_.AddTask(boost::bind(&MemTableSnapshot::Decode, this, path, table, recordPtr, &put_pools,
+                                           &succ_cnt, &failed_cnt));
         }
         // will close the fd atomic
         delete seq_file;
-        if (g_succ_cnt) {
-            g_succ_cnt->fetch_add(succ_cnt, std::memory_order_relaxed);
-        }
-        if (g_failed_cnt) {
-            g_failed_cnt->fetch_add(failed_cnt, std::memory_order_relaxed);
-        }
     } while (false);
+    // the decode tasks dispatch records to the put pools, so stop them first
     load_pool_.Stop();
+    for (auto& pool : put_pools) {
+        pool->Stop();
+    }
+    PDLOG(INFO, "load path %s for table tid %u pid %u completed, succ_cnt %lu, failed_cnt %lu", path.c_str(), tid_,
+          pid_, succ_cnt.load(std::memory_order_relaxed), failed_cnt.load(std::memory_order_relaxed));
+    if (g_succ_cnt) {
+        g_succ_cnt->fetch_add(succ_cnt, std::memory_order_relaxed);
+    }
+    if (g_failed_cnt) {
+        g_failed_cnt->fetch_add(failed_cnt, std::memory_order_relaxed);
+    }
 }
 
-void MemTableSnapshot::Put(std::string& path, std::shared_ptr<Table>& table, std::vector<std::string*> recordPtr,
-                           std::atomic<uint64_t>* succ_cnt, std::atomic<uint64_t>* failed_cnt) {
-    ::openmldb::api::LogEntry entry;
+void MemTableSnapshot::Decode(std::string& path, std::shared_ptr<Table>& table, std::vector<std::string*> recordPtr,
+                              std::vector<std::shared_ptr<::openmldb::base::TaskPool>>* put_pools,
+                              std::atomic<uint64_t>* succ_cnt, std::atomic<uint64_t>* failed_cnt) {
+    MemTable* mem_table = dynamic_cast<MemTable*>(table.get());
+    std::vector<std::vector<::openmldb::api::LogEntry*>> shards(put_pools->size());
     for (auto it = recordPtr.cbegin(); it != recordPtr.cend(); it++) {
-        bool ok = entry.ParseFromString(**it);
+        auto* entry = new ::openmldb::api::LogEntry();
+        bool ok = entry->ParseFromString(**it);
+        delete *it;
         if (!ok) {
             failed_cnt->fetch_add(1, std::memory_order_relaxed);
-            delete *it;
+            delete entry;
             continue;
         }
+        uint32_t shard = 0;
+        if (mem_table != NULL) {
+            const std::string& pk = entry->dimensions_size() > 0 ? entry->dimensions(0).key() : entry->pk();
+            shard = mem_table->GetSegIdx(pk) % shards.size();
+        }
+        shards[shard].push_back(entry);
+    }
+    for (uint32_t i = 0; i < shards.size(); i++) {
+        if (!shards[i].empty()) {
+            put_pools->at(i)->AddTask(
+                boost::bind(&MemTableSnapshot::Put, this, path, table, shards[i], succ_cnt, failed_cnt));
+        }
+    }
+}
+
+void MemTableSnapshot::Put(std::string& path, std::shared_ptr<Table>& table,
+                           std::vector<::openmldb::api::LogEntry*> entries, std::atomic<uint64_t>* succ_cnt,
+                           std::atomic<uint64_t>* failed_cnt) {
+    for (auto it = entries.cbegin(); it != entries.cend(); it++) {
         auto scount = succ_cnt->fetch_add(1, std::memory_order_relaxed);
         if (scount % 100000 == 0) {
             PDLOG(INFO, "load snapshot %s with succ_cnt %lu, failed_cnt %lu", path.c_str(), scount,
                   failed_cnt->load(std::memory_order_relaxed));
         }
-        table->Put(entry);
+        table->Put(**it);
+        recovered_cnt_.fetch_add(1, std::memory_order_relaxed);
         delete *it;
     }
 }
 
+bool MemTableSnapshot::RecoverMappedSnapshot(const std::string& path, uint64_t expect_cnt,
+                                             std::shared_ptr<Table> table, std::atomic<uint64_t>* g_succ_cnt,
+                                             std::atomic<uint64_t>* g_failed_cnt) {
+    std::shared_ptr<MemTable> mem_table = std::dynamic_pointer_cast<MemTable>(table);
+    if (!mem_table) {
+        return false;
+    }
+    std::shared_ptr<MappedSnapshot> mapped_snapshot = MappedSnapshot::Open(path);
+    if (!mapped_snapshot) {
+        return false;
+    }
+    if (mapped_snapshot->GetCount() != expect_cnt) {
+        PDLOG(WARNING, "mapped snapshot %s has %lu records but expect %lu, tid %u pid %u", path.c_str(),
+              mapped_snapshot->GetCount(), expect_cnt, tid_, pid_);
+        return false;
+    }
+    // the rows refer to the mapping, so it has to be kept before any row is put
+    mem_table->AddMappedSnapshot(mapped_snapshot);
+    uint64_t consumed = ::baidu::common::timer::now_time();
+    uint64_t succ_cnt = 0;
+    uint64_t failed_cnt = 0;
+    uint64_t offset = MappedSnapshot::FirstOffset();
+    ::openmldb::api::LogEntry entry;
+    ::openmldb::base::Slice value;
+    while (succ_cnt + failed_cnt < expect_cnt && mapped_snapshot->Read(&offset, &entry, &value)) {
+        if (mem_table->PutMapped(entry, value)) {
+            succ_cnt++;
+        } else {
+            failed_cnt++;
+        }
+        recovered_cnt_.fetch_add(1, std::memory_order_relaxed);
+        if ((succ_cnt + failed_cnt) % KEY_NUM_DISPLAY == 0) {
+            PDLOG(INFO, "load mapped snapshot %s with succ_cnt %lu, failed_cnt %lu", path.c_str(), succ_cnt,
+                  failed_cnt);
+        }
+    }
+    if (succ_cnt + failed_cnt < expect_cnt) {
+        PDLOG(WARNING, "mapped snapshot %s is truncated at offset %lu", path.c_str(), offset);
+        failed_cnt = expect_cnt - succ_cnt;
+    }
+    consumed = ::baidu::common::timer::now_time() - consumed;
+    PDLOG(INFO, "load mapped snapshot %s for table tid %u pid %u completed, succ_cnt %lu, failed_cnt %lu, consumed %us",
+          path.c_str(), tid_, pid_, succ_cnt, failed_cnt, consumed);
+    g_succ_cnt->fetch_add(succ_cnt, std::memory_order_relaxed);
+    g_failed_cnt->fetch_add(failed_cnt, std::memory_order_relaxed);
+    return true;
+}
+
+bool MemTableSnapshot::MakeMappedSnapshot(const std::string& snapshot_name, uint64_t expect_cnt) {
+    std::string full_path = snapshot_path_ + snapshot_name;
+    std::string mapped_path = full_path + MAPPED_SNAPSHOT_SUFFIX;
+    std::string tmp_path = mapped_path + ".tmp";
+    FILE* fd = fopen(full_path.c_str(), "rb");
+    if (fd == NULL) {
+        PDLOG(WARNING, "fail to open path %s for error %s", full_path.c_str(), strerror(errno));
+        return false;
+    }
+    ::openmldb::log::SequentialFile* seq_file = ::openmldb::log::NewSeqFile(full_path, fd);
+    ::openmldb::log::Reader reader(seq_file, NULL, false, 0, IsCompressed(full_path));
+    MappedSnapshotWriter writer(tmp_path);
+    bool has_error = !writer.Open();
+    std::string buffer;
+    ::openmldb::api::LogEntry entry;
+    while (!has_error) {
+        buffer.clear();
+        ::openmldb::base::Slice record;
+        ::openmldb::base::Status status = reader.ReadRecord(&record, &buffer);
+        if (status.IsWaitRecord() || status.IsEof()) {
+            break;
+        }
+        if (!status.ok() || !entry.ParseFromArray(record.data(), record.size())) {
+            PDLOG(WARNING, "fail to read record of %s", full_path.c_str());
+            has_error = true;
+            break;
+        }
+        has_error = !writer.Write(&entry);
+    }
+    delete seq_file;
+    if (!writer.Close() || has_error || writer.GetCount() != expect_cnt) {
+        PDLOG(WARNING, "fail to make mapped snapshot %s, write %lu records expect %lu", mapped_path.c_str(),
+              writer.GetCount(), expect_cnt);
+        unlink(tmp_path.c_str());
+        return false;
+    }
+    if (rename(tmp_path.c_str(), mapped_path.c_str()) != 0) {
+        PDLOG(WARNING, "rename[%s] failed", tmp_path.c_str());
+        unlink(tmp_path.c_str());
+        return false;
+    }
+    PDLOG(INFO, "make mapped snapshot[%s] success. write key %lu", mapped_path.c_str(), expect_cnt);
+    return true;
+}
+
 int MemTableSnapshot::TTLSnapshot(std::shared_ptr<Table> table, const ::openmldb::api::Manifest& manifest,
                                   WriteHandle* wh, uint64_t& count, uint64_t& expired_key_num,
                                   uint64_t& deleted_key_num) {
@@ -238,7 +420,12 @@ int MemTableSnapshot::TTLSnapshot(std::shared_ptr<Table> table, const ::openmldb
             has_error = true;
             break;
         }
-        int ret = RemoveDeletedKey(entry, deleted_index, &tmp_buf);
+        // the deletes of a delta are collected by CollectDeletedKey already
+        if (entry.has_method_type() && entry.method_type() == ::openmldb::api::MethodType::kDelete) {
+            deleted_key_num++;
+            continue;
+        }
+        int ret = RemoveDeletedKey(table, entry, deleted_index, &tmp_buf);
         if (ret == 1) {
             deleted_key_num++;
             continue;
@@ -275,8 +462,99 @@ int MemTableSnapshot::TTLSnapshot(std::shared_ptr<Table> table, const ::openmldb
     return 0;
 }
 
-uint64_t MemTableSnapshot::CollectDeletedKey(uint64_t end_offset) {
+void MemTableSnapshot::CollectDeltaDeletedKey(const ::openmldb::api::Manifest& manifest) {
+    std::string buffer;
+    ::openmldb::api::LogEntry entry;
+    for (const auto& delta : manifest.deltas()) {
+        std::string path = snapshot_path_ + delta.name();
+        FILE* fd = fopen(path.c_str(), "rb");
+        if (fd == NULL) {
+            PDLOG(WARNING, "fail to open path %s for error %s", path.c_str(), strerror(errno));
+            continue;
+        }
+        ::openmldb::log::SequentialFile* seq_file = ::openmldb::log::NewSeqFile(path, fd);
+        ::openmldb::log::Reader reader(seq_file, NULL, false, 0, IsCompressed(path));
+        while (true) {
+            buffer.clear();
+            ::openmldb::base::Slice record;
+            ::openmldb::base::Status status = reader.ReadRecord(&record, &buffer);
+            if (!status.ok() || !entry.ParseFromArray(record.data(), record.size())) {
+                break;
+            }
+            if (entry.has_method_type() && entry.method_type() == ::openmldb::api::MethodType::kDelete) {
+                CollectDeletedEntry(entry, entry.log_index());
+            }
+        }
+        delete seq_file;
+    }
+}
+
+void MemTableSnapshot::CollectDeletedEntry(const ::openmldb::api::LogEntry& entry, uint64_t offset) {
+    if (entry.has_end_ts()) {
+        DeletedRange range = {offset, entry.ts(), entry.end_ts()};
+        if (entry.dimensions_size() == 0) {
+            deleted_all_ranges_.push_back(range);
+        } else {
+            std::string combined_key = entry.dimensions(0).key() + "|" + std::to_string(entry.dimensions(0).idx());
+            deleted_ranges_[combined_key].push_back(range);
+        }
+        return;
+    }
+    if (entry.dimensions_size() == 0) {
+        return;
+    }
+    std::string combined_key = entry.dimensions(0).key() + "|" + std::to_string(entry.dimensions(0).idx());
+    deleted_keys_[combined_key] = offset;
+    DEBUGLOG("insert key %s offset %lu. tid %u pid %u", combined_key.c_str(), offset, tid_, pid_);
+}
+
+void MemTableSnapshot::ClearDeletedKey() {
     deleted_keys_.clear();
+    deleted_ranges_.clear();
+    deleted_all_ranges_.clear();
+}
+
+bool MemTableSnapshot::IsDeletedByRange(const std::shared_ptr<Table>& table, const ::openmldb::api::LogEntry& entry,
+                                        const std::string& combined_key, uint32_t idx) {
+    auto iter = deleted_ranges_.find(combined_key);
+    if (iter == deleted_ranges_.end() && deleted_all_ranges_.empty()) {
+        return false;
+    }
+    // the ts of the row in the index, as MemTable::Put takes it
+    uint64_t ts = entry.ts();
+    std::shared_ptr<IndexDef> index_def = table->GetIndex(idx);
+    auto ts_col = index_def ? index_def->GetTsColumn() : nullptr;
+    if (ts_col) {
+        bool has_found_ts = false;
+        for (const auto& ts_dimension : entry.ts_dimensions()) {
+            if (static_cast<int>(ts_dimension.idx()) == ts_col->GetTsIdx()) {
+                ts = ts_dimension.ts();
+                has_found_ts = true;
+                break;
+            }
+        }
+        if (!has_found_ts) {
+            return false;
+        }
+    }
+    auto covered = [&entry, ts](const std::vector<DeletedRange>& ranges) {
+        for (const auto& range : ranges) {
+            if (entry.log_index() <= range.offset && ts >= range.end_ts && ts <= range.start_ts) {
+                return true;
+            }
+        }
+        return false;
+    };
+    return covered(deleted_all_ranges_) || (iter != deleted_ranges_.end() && covered(iter->second));
+}
+
+uint64_t MemTableSnapshot::CollectDeletedKey(uint64_t end_offset) {
+    ClearDeletedKey();
+    ::openmldb::api::Manifest manifest;
+    if (GetLocalManifest(snapshot_path_ + MANIFEST, manifest) == 0) {
+        // the deletes in deltas are not applied to the snapshot yet
+        CollectDeltaDeletedKey(manifest);
+    }
     ::openmldb::log::LogReader log_reader(log_part_, log_path_, false);
     log_reader.SetOffset(offset_);
     uint64_t cur_offset = offset_;
@@ -311,13 +589,11 @@ uint64_t MemTableSnapshot::CollectDeletedKey(uint64_t end_offset) {
             }
             cur_offset = entry.log_index();
             if (entry.has_method_type() && entry.method_type() == ::openmldb::api::MethodType::kDelete) {
-                if (entry.dimensions_size() == 0) {
+                if (entry.dimensions_size() == 0 && !entry.has_end_ts()) {
                     PDLOG(WARNING, "no dimesion. tid %u pid %u offset %lu", tid_, pid_, cur_offset);
                     continue;
                 }
-                std::string combined_key = entry.dimensions(0).key() + "|" + std::to_string(entry.dimensions(0).idx());
-                deleted_keys_[combined_key] = cur_offset;
-                DEBUGLOG("insert key %s offset %lu. tid %u pid %u", combined_key.c_str(), cur_offset, tid_, pid_);
+                CollectDeletedEntry(entry, cur_offset);
             }
         } else if (status.IsEof()) {
             continue;
@@ -344,6 +620,20 @@ uint64_t MemTableSnapshot::CollectDeletedKey(uint64_t end_offset) {
 }
 
 int MemTableSnapshot::MakeSnapshot(std::shared_ptr<Table> table, uint64_t& out_offset, uint64_t end_offset) {
+    return MakeSnapshot(table, out_offset, end_offset, FLAGS_snapshot_delta_max_num > 0);
+}
+
+int MemTableSnapshot::MergeDeltaSnapshot(std::shared_ptr<Table> table) {
+    ::openmldb::api::Manifest manifest;
+    if (GetLocalManifest(snapshot_path_ + MANIFEST, manifest) != 0 || manifest.deltas_size() == 0) {
+        return 0;
+    }
+    uint64_t offset = 0;
+    return MakeSnapshot(table, offset, 0, false);
+}
+
+int MemTableSnapshot::MakeSnapshot(std::shared_ptr<Table> table, uint64_t& out_offset, uint64_t end_offset,
+                                   bool allow_delta) {
     if (making_snapshot_.load(std::memory_order_acquire)) {
         PDLOG(INFO, "snapshot is doing now!");
         return 0;
@@ -353,6 +643,22 @@ int MemTableSnapshot::MakeSnapshot(std::shared_ptr<Table> table, uint64_t& out_o
         return -1;
     }
     making_snapshot_.store(true, std::memory_order_release);
+    if (allow_delta) {
+        ::openmldb::api::Manifest manifest;
+        bool has_deleted_index = false;
+        for (const auto& it : table->GetAllIndex()) {
+            if (it->GetStatus() == ::openmldb::storage::IndexStatus::kDeleted) {
+                has_deleted_index = true;
+            }
+        }
+        // the deleted index and the expired rows of the snapshot are cleaned when the deltas are merged
+        if (GetLocalManifest(snapshot_path_ + MANIFEST, manifest) == 0 &&
+            manifest.deltas_size() < static_cast<int>(FLAGS_snapshot_delta_max_num) && !has_deleted_index) {
+            int ret = MakeDeltaSnapshot(table, &manifest, out_offset, end_offset);
+            making_snapshot_.store(false, std::memory_order_release);
+            return ret;
+        }
+    }
     std::string now_time = ::openmldb::base::GetNowTime();
     std::string snapshot_name = now_time.substr(0, now_time.length() - 2) + ".sdb";
     if (FLAGS_snapshot_compression != "off") {
@@ -371,6 +677,7 @@ int MemTableSnapshot::MakeSnapshot(std::shared_ptr<Table> table, uint64_t& out_o
     uint64_t collected_offset = CollectDeletedKey(end_offset);
     uint64_t start_time = ::baidu::common::timer::now_time();
     WriteHandle* wh = new WriteHandle(FLAGS_snapshot_compression, snapshot_name_tmp, fd);
+    wh->SetRateLimiter(::openmldb::base::GetDiskRateLimiter(snapshot_path_, FLAGS_background_disk_io_limit));
     ::openmldb::api::Manifest manifest;
     bool has_error = false;
     uint64_t write_count = 0;
@@ -383,6 +690,22 @@ int MemTableSnapshot::MakeSnapshot(std::shared_ptr<Table> table, uint64_t& out_o
         if (TTLSnapshot(table, manifest, wh, write_count, expired_key_num, deleted_key_num) < 0) {
             has_error = true;
         }
+        // merge the deltas into the new snapshot
+        for (int i = 0; i < manifest.deltas_size() && !has_error; i++) {
+            ::openmldb::api::Manifest delta_manifest;
+            delta_manifest.set_name(manifest.deltas(i).name());
+            delta_manifest.set_count(manifest.deltas(i).count());
+            uint64_t delta_write_count = 0;
+            uint64_t delta_expired_key_num = 0;
+            uint64_t delta_deleted_key_num = 0;
+            if (TTLSnapshot(table, delta_manifest, wh, delta_write_count, delta_expired_key_num,
+                            delta_deleted_key_num) < 0) {
+                has_error = true;
+            }
+            write_count += delta_write_count;
+            expired_key_num += delta_expired_key_num;
+            deleted_key_num += delta_deleted_key_num;
+        }
         last_term = manifest.term();
         DEBUGLOG("old manifest term is %lu", last_term);
     } else if (result < 0) {
@@ -428,7 +751,7 @@ int MemTableSnapshot::MakeSnapshot(std::shared_ptr<Table> table, uint64_t& out_o
             if (entry.has_term()) {
                 last_term = entry.term();
             }
-            int ret = RemoveDeletedKey(entry, deleted_index, &tmp_buf);
+            int ret = RemoveDeletedKey(table, entry, deleted_index, &tmp_buf);
             if (ret == 1) {
                 deleted_key_num++;
                 continue;
@@ -488,6 +811,13 @@ int MemTableSnapshot::MakeSnapshot(std::shared_ptr<Table> table, uint64_t& out_o
                 if (manifest.has_name() && manifest.name() != snapshot_name) {
                     DEBUGLOG("old snapshot[%s] has deleted", manifest.name().c_str());
                     unlink((snapshot_path_ + manifest.name()).c_str());
+                    unlink((snapshot_path_ + manifest.name() + MAPPED_SNAPSHOT_SUFFIX).c_str());
+                }
+                for (const auto& delta : manifest.deltas()) {
+                    unlink((snapshot_path_ + delta.name()).c_str());
+                }
+                if (FLAGS_snapshot_mmap) {
+                    MakeMappedSnapshot(snapshot_name, write_count);
                 }
                 uint64_t consumed = ::baidu::common::timer::now_time() - start_time;
                 PDLOG(INFO,
@@ -509,18 +839,138 @@ int MemTableSnapshot::MakeSnapshot(std::shared_ptr<Table> table, uint64_t& out_o
             ret = -1;
         }
     }
-    deleted_keys_.clear();
+    ClearDeletedKey();
     making_snapshot_.store(false, std::memory_order_release);
     return ret;
 }
 
-int MemTableSnapshot::RemoveDeletedKey(const ::openmldb::api::LogEntry& entry, const std::set<uint32_t>& deleted_index,
-                                       std::string* buffer) {
+int MemTableSnapshot::MakeDeltaSnapshot(std::shared_ptr<Table> table, ::openmldb::api::Manifest* manifest,
+                                        uint64_t& out_offset, uint64_t end_offset) {
+    std::string now_time = ::openmldb::base::GetNowTime();
+    // the deltas made in the same minute are told apart by the start offset
+    std::string delta_name =
+        now_time.substr(0, now_time.length() - 2) + "_" + std::to_string(offset_) + DELTA_SNAPSHOT_SUBFIX;
+    if (FLAGS_snapshot_compression != "off") {
+        delta_name.append(".");
+        delta_name.append(FLAGS_snapshot_compression);
+    }
+    std::string tmp_file_path = snapshot_path_ + delta_name + ".tmp";
+    FILE* fd = fopen(tmp_file_path.c_str(), "ab+");
+    if (fd == NULL) {
+        PDLOG(WARNING, "fail to create file %s", tmp_file_path.c_str());
+        return -1;
+    }
+    uint64_t start_time = ::baidu::common::timer::now_time();
+    WriteHandle* wh = new WriteHandle(FLAGS_snapshot_compression, delta_name + ".tmp", fd);
+    wh->SetRateLimiter(::openmldb::base::GetDiskRateLimiter(snapshot_path_, FLAGS_background_disk_io_limit));
+    bool has_error = false;
+    uint64_t write_count = 0;
+    uint64_t expired_key_num = 0;
+    uint64_t last_term = manifest->term();
+    ::openmldb::log::LogReader log_reader(log_part_, log_path_, false);
+    log_reader.SetOffset(offset_);
+    uint64_t cur_offset = offset_;
+    std::string buffer;
+    while (!has_error && (end_offset == 0 || cur_offset < end_offset)) {
+        buffer.clear();
+        ::openmldb::base::Slice record;
+        ::openmldb::base::Status status = log_reader.ReadNextRecord(&record, &buffer);
+        if (status.ok()) {
+            ::openmldb::api::LogEntry entry;
+            if (!entry.ParseFromString(record.ToString())) {
+                PDLOG(WARNING, "fail to parse LogEntry. record[%s] size[%ld]",
+                      ::openmldb::base::DebugString(record.ToString()).c_str(), record.ToString().size());
+                has_error = true;
+                break;
+            }
+            if (entry.log_index() <= cur_offset) {
+                continue;
+            }
+            if (cur_offset + 1 != entry.log_index()) {
+                PDLOG(WARNING, "log missing expect offset %lu but %ld", cur_offset + 1, entry.log_index());
+                continue;
+            }
+            cur_offset = entry.log_index();
+            if (entry.has_term()) {
+                last_term = entry.term();
+            }
+            // the deletes are kept, they apply to the snapshot and the former deltas
+            if (entry.has_method_type() && entry.method_type() == ::openmldb::api::MethodType::kDelete) {
+                if (entry.dimensions_size() == 0 && !entry.has_end_ts()) {
+                    PDLOG(WARNING, "no dimesion. tid %u pid %u offset %lu", tid_, pid_, cur_offset);
+                    continue;
+                }
+            } else if (table->IsExpire(entry)) {
+                expired_key_num++;
+                continue;
+            }
+            status = wh->Write(record);
+            if (!status.ok()) {
+                PDLOG(WARNING, "fail to write snapshot. path[%s] status[%s]", tmp_file_path.c_str(),
+                      status.ToString().c_str());
+                has_error = true;
+                break;
+            }
+            write_count++;
+        } else if (status.IsEof()) {
+            continue;
+        } else if (status.IsWaitRecord()) {
+            int end_log_index = log_reader.GetEndLogIndex();
+            int cur_log_index = log_reader.GetLogIndex();
+            if (end_log_index >= 0 && end_log_index > cur_log_index) {
+                log_reader.RollRLogFile();
+                continue;
+            }
+            DEBUGLOG("has read all record!");
+            break;
+        } else {
+            PDLOG(WARNING, "fail to get record. status is %s", status.ToString().c_str());
+            has_error = true;
+            break;
+        }
+    }
+    wh->EndLog();
+    delete wh;
+    std::string full_path = snapshot_path_ + delta_name;
+    if (has_error || cur_offset == offset_) {
+        unlink(tmp_file_path.c_str());
+        out_offset = offset_;
+        return has_error ? -1 : 0;
+    }
+    if (rename(tmp_file_path.c_str(), full_path.c_str()) != 0) {
+        PDLOG(WARNING, "rename[%s] failed", tmp_file_path.c_str());
+        unlink(tmp_file_path.c_str());
+        return -1;
+    }
+    ::openmldb::api::SnapshotDelta* delta = manifest->add_deltas();
+    delta->set_name(delta_name);
+    delta->set_count(write_count);
+    delta->set_offset(cur_offset);
+    manifest->set_offset(cur_offset);
+    manifest->set_term(last_term);
+    if (GenManifest(*manifest) != 0) {
+        PDLOG(WARNING, "GenManifest failed. delete delta snapshot file[%s]", full_path.c_str());
+        unlink(full_path.c_str());
+        return -1;
+    }
+    uint64_t consumed = ::baidu::common::timer::now_time() - start_time;
+    PDLOG(INFO,
+          "make delta snapshot[%s] success. update offset from %lu to %lu. use %lu second. write key %lu expired "
+          "key %lu, delta num %d",
+          delta_name.c_str(), offset_, cur_offset, consumed, write_count, expired_key_num, manifest->deltas_size());
+    offset_ = cur_offset;
+    out_offset = cur_offset;
+    return 0;
+}
+
+int MemTableSnapshot::RemoveDeletedKey(std::shared_ptr<Table> table, const ::openmldb::api::LogEntry& entry,
+                                       const std::set<uint32_t>& deleted_index, std::string* buffer) {
     uint64_t cur_offset = entry.log_index();
     if (entry.dimensions_size() == 0) {
         std::string combined_key = entry.pk() + "|0";
         auto iter = deleted_keys_.find(combined_key);
-        if (iter != deleted_keys_.end() && cur_offset <= iter->second) {
+        if ((iter != deleted_keys_.end() && cur_offset <= iter->second) ||
+            IsDeletedByRange(table, entry, combined_key, 0)) {
             DEBUGLOG("delete key %s  offset %lu", entry.pk().c_str(), entry.log_index());
             return 1;
         }
@@ -530,7 +980,8 @@ int MemTableSnapshot::RemoveDeletedKey(const ::openmldb::api::LogEntry& entry, c
             std::string combined_key = entry.dimensions(pos).key() + "|" + std::to_string(entry.dimensions(pos).idx());
             auto iter = deleted_keys_.find(combined_key);
             if ((iter != deleted_keys_.end() && cur_offset <= iter->second) ||
-                deleted_index.count(entry.dimensions(pos).idx())) {
+                deleted_index.count(entry.dimensions(pos).idx()) ||
+                IsDeletedByRange(table, entry, combined_key, entry.dimensions(pos).idx())) {
                 deleted_pos_set.insert(pos);
             }
         }
@@ -555,6 +1006,169 @@ int MemTableSnapshot::RemoveDeletedKey(const ::openmldb::api::LogEntry& entry, c
     return 0;
 }
 
+int MemTableSnapshot::ExtractIndexRecord(std::shared_ptr<Table> table, const std::string& data, uint32_t idx,
+                                         uint32_t partition_num, uint32_t max_idx,
+                                         const std::vector<uint32_t>& index_cols, std::string* out) {
+    ::openmldb::api::LogEntry entry;
+    if (!entry.ParseFromString(data)) {
+        PDLOG(WARNING, "fail parse record for tid %u, pid %u with value %s", tid_, pid_,
+              ::openmldb::base::DebugString(data).c_str());
+        return kExtractError;
+    }
+    bool changed = false;
+    // deleted key
+    if (entry.dimensions_size() == 0) {
+        std::string combined_key = entry.pk() + "|0";
+        if (deleted_keys_.find(combined_key) != deleted_keys_.end()) {
+            return kExtractDeleted;
+        }
+    } else {
+        std::set<int> deleted_pos_set;
+        for (int pos = 0; pos < entry.dimensions_size(); pos++) {
+            std::string combined_key = entry.dimensions(pos).key() + "|" + std::to_string(entry.dimensions(pos).idx());
+            if (deleted_keys_.find(combined_key) != deleted_keys_.end() ||
+                !table->GetIndex(entry.dimensions(pos).idx())->IsReady()) {
+                deleted_pos_set.insert(pos);
+            }
+        }
+        if (!deleted_pos_set.empty()) {
+            if ((int)deleted_pos_set.size() == entry.dimensions_size()) {  // NOLINT
+                return kExtractDeleted;
+            }
+            ::openmldb::api::LogEntry tmp_entry(entry);
+            entry.clear_dimensions();
+            for (int pos = 0; pos < tmp_entry.dimensions_size(); pos++) {
+                if (deleted_pos_set.find(pos) == deleted_pos_set.end()) {
+                    ::openmldb::api::Dimension* dimension = entry.add_dimensions();
+                    dimension->CopyFrom(tmp_entry.dimensions(pos));
+                }
+            }
+            changed = true;
+        }
+    }
+    // delete timeout key
+    if (table->IsExpire(entry)) {
+        return kExtractExpired;
+    }
+    if (!(entry.has_method_type() && entry.method_type() == ::openmldb::api::MethodType::kDelete)) {
+        // new column_key
+        std::vector<std::string> row;
+        int ret = DecodeData(table, entry, max_idx, row);
+        if (ret == 2) {
+            if (changed) {
+                entry.SerializeToString(out);
+                return kExtractChanged;
+            }
+            return kExtractKept;
+        } else if (ret != 0) {
+            DLOG(INFO) << "skip current data";
+            return kExtractSkipped;
+        }
+        std::string cur_key;
+        for (uint32_t i : index_cols) {
+            if (cur_key.empty()) {
+                cur_key = row[i];
+            } else {
+                cur_key += "|" + row[i];
+            }
+        }
+        if (cur_key.empty()) {
+            DLOG(INFO) << "skip empty key";
+            return kExtractSkipped;
+        }
+        uint32_t index_pid = ::openmldb::base::hash64(cur_key) % partition_num;
+        // update entry and write entry into memory
+        if (index_pid == pid_) {
+            if (entry.dimensions_size() == 1 && entry.dimensions(0).idx() == idx) {
+                DLOG(INFO) << "skip not default key " << cur_key;
+                return kExtractSkipped;
+            }
+            ::openmldb::api::Dimension* dim = entry.add_dimensions();
+            dim->set_key(cur_key);
+            dim->set_idx(idx);
+            entry.SerializeToString(out);
+            entry.clear_dimensions();
+            dim = entry.add_dimensions();
+            dim->set_key(cur_key);
+            dim->set_idx(idx);
+            table->Put(entry);
+            return kExtractPut;
+        }
+    }
+    if (changed) {
+        entry.SerializeToString(out);
+        return kExtractChanged;
+    }
+    return kExtractKept;
+}
+
+void MemTableSnapshot::ExtractIndexBatch(std::shared_ptr<Table> table, std::vector<std::string*> records,
+                                         uint32_t idx, uint32_t partition_num, uint32_t max_idx,
+                                         const std::vector<uint32_t>* index_cols, WriteHandle* wh,
+                                         ExtractIndexStat* stat) {
+    std::vector<std::string*> outs;
+    outs.reserve(records.size());
+    uint64_t put_cnt = 0;
+    uint64_t expired_cnt = 0;
+    uint64_t deleted_cnt = 0;
+    uint64_t skipped_cnt = 0;
+    bool has_error = false;
+    for (auto record : records) {
+        std::string* out = new std::string();
+        int ret = has_error ? kExtractError
+                            : ExtractIndexRecord(table, *record, idx, partition_num, max_idx, *index_cols, out);
+        switch (ret) {
+            case kExtractPut:
+                put_cnt++;
+                outs.push_back(out);
+                delete record;
+                break;
+            case kExtractChanged:
+                outs.push_back(out);
+                delete record;
+                break;
+            case kExtractKept:
+                outs.push_back(record);
+                delete out;
+                break;
+            default:
+                if (ret == kExtractExpired) {
+                    expired_cnt++;
+                } else if (ret == kExtractDeleted) {
+                    deleted_cnt++;
+                } else if (ret == kExtractSkipped) {
+                    skipped_cnt++;
+                } else {
+                    has_error = true;
+                }
+                delete record;
+                delete out;
+                break;
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(stat->mu);
+        for (auto out : outs) {
+            if (!has_error && !stat->has_error) {
+                ::openmldb::base::Status status = wh->Write(::openmldb::base::Slice(*out));
+                if (!status.ok()) {
+                    PDLOG(WARNING, "fail to extract index from snapshot. status[%s] tid[%u] pid[%u]",
+                          status.ToString().c_str(), tid_, pid_);
+                    has_error = true;
+                } else {
+                    stat->count++;
+                }
+            }
+            delete out;
+        }
+        stat->has_error = stat->has_error || has_error;
+        stat->extract_count += put_cnt;
+        stat->expired_key_num += expired_cnt;
+        stat->deleted_key_num += deleted_cnt;
+        stat->other_error_count += skipped_cnt;
+    }
+}
+
 int MemTableSnapshot::ExtractIndexFromSnapshot(std::shared_ptr<Table> table, const ::openmldb::api::Manifest& manifest,
                                                WriteHandle* wh, const ::openmldb::common::ColumnKey& column_key,
                                                uint32_t idx, uint32_t partition_num, uint32_t max_idx,
@@ -572,148 +1186,71 @@ int MemTableSnapshot::ExtractIndexFromSnapshot(std::shared_ptr<Table> table, con
     bool compressed = IsCompressed(full_path);
     ::openmldb::log::Reader reader(seq_file, NULL, false, 0, compressed);
     std::string buffer;
-    ::openmldb::api::LogEntry entry;
+    ExtractIndexStat stat;
     bool has_error = false;
-    uint64_t extract_count = 0;
-    uint64_t schame_size_less_count = 0;
-    uint64_t other_error_count = 0;
+    uint64_t read_cnt = 0;
     DLOG(INFO) << "extract index data from snapshot";
-    while (true) {
-        ::openmldb::base::Slice record;
-        ::openmldb::base::Status status = reader.ReadRecord(&record, &buffer);
-        if (status.IsEof()) {
-            break;
-        }
-        if (!status.ok()) {
-            PDLOG(WARNING, "fail to read record for tid %u, pid %u with error %s", tid_, pid_,
-                  status.ToString().c_str());
-            has_error = true;
-            break;
-        }
-        if (!entry.ParseFromString(record.ToString())) {
-            PDLOG(WARNING, "fail parse record for tid %u, pid %u with value %s", tid_, pid_,
-                  ::openmldb::base::DebugString(record.ToString()).c_str());
-            has_error = true;
-            break;
-        }
-        // deleted key
-        std::string tmp_buf;
-        if (entry.dimensions_size() == 0) {
-            std::string combined_key = entry.pk() + "|0";
-            if (deleted_keys_.find(combined_key) != deleted_keys_.end()) {
-                deleted_key_num++;
-                continue;
-            }
-        } else {
-            std::set<int> deleted_pos_set;
-            for (int pos = 0; pos < entry.dimensions_size(); pos++) {
-                std::string combined_key =
-                    entry.dimensions(pos).key() + "|" + std::to_string(entry.dimensions(pos).idx());
-                if (deleted_keys_.find(combined_key) != deleted_keys_.end() ||
-                    !table->GetIndex(entry.dimensions(pos).idx())->IsReady()) {
-                    deleted_pos_set.insert(pos);
-                }
-            }
-            if (!deleted_pos_set.empty()) {
-                if ((int)deleted_pos_set.size() ==  // NOLINT
-                    entry.dimensions_size()) {
-                    deleted_key_num++;
-                    continue;
-                } else {
-                    ::openmldb::api::LogEntry tmp_entry(entry);
-                    entry.clear_dimensions();
-                    for (int pos = 0; pos < tmp_entry.dimensions_size(); pos++) {
-                        if (deleted_pos_set.find(pos) == deleted_pos_set.end()) {
-                            ::openmldb::api::Dimension* dimension = entry.add_dimensions();
-                            dimension->CopyFrom(tmp_entry.dimensions(pos));
-                        }
-                    }
-                    entry.SerializeToString(&tmp_buf);
-                    record.reset(tmp_buf.data(), tmp_buf.size());
-                }
-            }
-        }
-        // delete timeout key
-        if (table->IsExpire(entry)) {
-            expired_key_num++;
-            continue;
-        }
-        if (!(entry.has_method_type() && entry.method_type() == ::openmldb::api::MethodType::kDelete)) {
-            // new column_key
-            std::vector<std::string> row;
-            int ret = DecodeData(table, entry, max_idx, row);
-            if (ret == 2) {
-                count++;
-                wh->Write(record);
-                continue;
-            } else if (ret != 0) {
-                DLOG(INFO) << "skip current data";
-                other_error_count++;
-                continue;
+    {
+        // the records of the snapshot are independent puts, so they are extracted by the batches in parallel and
+        // written to the new snapshot in any order
+        uint32_t thread_num = std::max(FLAGS_extract_index_thread_num, 1u);
+        uint32_t batch_size = std::max(FLAGS_load_table_batch, 1u);
+        ::openmldb::base::TaskPool extract_pool(thread_num, FLAGS_load_table_queue_size);
+        std::vector<std::string*> records;
+        records.reserve(batch_size);
+        while (true) {
+            buffer.clear();
+            ::openmldb::base::Slice record;
+            ::openmldb::base::Status status = reader.ReadRecord(&record, &buffer);
+            if (status.IsEof()) {
+                break;
             }
-            std::string cur_key;
-            for (uint32_t i : index_cols) {
-                if (cur_key.empty()) {
-                    cur_key = row[i];
-                } else {
-                    cur_key += "|" + row[i];
-                }
+            if (!status.ok()) {
+                PDLOG(WARNING, "fail to read record for tid %u, pid %u with error %s", tid_, pid_,
+                      status.ToString().c_str());
+                has_error = true;
+                break;
             }
-            if (cur_key.empty()) {
-                other_error_count++;
-                DLOG(INFO) << "skip empty key";
-                continue;
+            records.push_back(new std::string(record.data(), record.size()));
+            if (records.size() >= batch_size) {
+                extract_pool.AddTask(boost::bind(&MemTableSnapshot::ExtractIndexBatch, this, table, records, idx,
+                                                 partition_num, max_idx, &index_cols, wh, &stat));
+                records.clear();
             }
-            uint32_t index_pid = ::openmldb::base::hash64(cur_key) % partition_num;
-            // update entry and write entry into memory
-            if (index_pid == pid) {
-                if (entry.dimensions_size() == 1 && entry.dimensions(0).idx() == idx) {
-                    other_error_count++;
-                    DLOG(INFO) << "skip not default key " << cur_key;
-                    continue;
-                }
-                ::openmldb::api::Dimension* dim = entry.add_dimensions();
-                dim->set_key(cur_key);
-                dim->set_idx(idx);
-                entry.SerializeToString(&tmp_buf);
-                record.reset(tmp_buf.data(), tmp_buf.size());
-                entry.clear_dimensions();
-                dim = entry.add_dimensions();
-                dim->set_key(cur_key);
-                dim->set_idx(idx);
-                table->Put(entry);
-                extract_count++;
+            if (++read_cnt % KEY_NUM_DISPLAY == 0) {
+                PDLOG(INFO, "tackled key num[%lu] total[%lu] tid[%u] pid[%u]", read_cnt, manifest.count(), tid, pid);
             }
         }
-        status = wh->Write(record);
-        if (!status.ok()) {
-            PDLOG(WARNING,
-                  "fail to extract index from snapshot. status[%s] tid[%u] "
-                  "pid[%u]",
-                  status.ToString().c_str(), tid, pid);
-            has_error = true;
-            break;
-        }
-        if ((count + expired_key_num + deleted_key_num) % KEY_NUM_DISPLAY == 0) {
-            PDLOG(INFO, "tackled key num[%lu] total[%lu] tid[%u] pid[%u]", count + expired_key_num, manifest.count(),
-                  tid, pid);
+        if (!records.empty()) {
+            extract_pool.AddTask(boost::bind(&MemTableSnapshot::ExtractIndexBatch, this, table, records, idx,
+                                             partition_num, max_idx, &index_cols, wh, &stat));
         }
-        count++;
+        // wait for the batches added
+        extract_pool.Stop();
     }
     delete seq_file;
-    if (expired_key_num + count + deleted_key_num + schame_size_less_count + other_error_count != manifest.count()) {
-        LOG(WARNING) << "key num not match ! total key num[" << manifest.count() << "] load key num[" << count
-                     << "] ttl key num[" << expired_key_num << "] schema size less num[" << schame_size_less_count
-                     << "] other error count[" << other_error_count << "]"
+    has_error = has_error || stat.has_error;
+    count += stat.count;
+    expired_key_num += stat.expired_key_num;
+    deleted_key_num += stat.deleted_key_num;
+    uint64_t schame_size_less_count = 0;
+    uint64_t other_error_count = stat.other_error_count;
+    uint64_t extract_count = stat.extract_count;
+    if (!has_error &&
+        stat.expired_key_num + stat.count + stat.deleted_key_num + schame_size_less_count + other_error_count !=
+            manifest.count()) {
+        LOG(WARNING) << "key num not match ! total key num[" << manifest.count() << "] load key num[" << stat.count
+                     << "] ttl key num[" << stat.expired_key_num << "] schema size less num["
+                     << schame_size_less_count << "] other error count[" << other_error_count << "]"
                      << " tid[" << tid << "] pid[" << pid << "]";
         has_error = true;
     }
     if (has_error) {
         return -1;
     }
-    LOG(INFO) << "extract index from snapshot success. extract key num[" << extract_count << "] load key num[" << count
-              << "] ttl key num[" << expired_key_num << "] schema size less num[" << schame_size_less_count
-              << "] other error count[" << other_error_count << "]"
+    LOG(INFO) << "extract index from snapshot success. extract key num[" << extract_count << "] load key num["
+              << stat.count << "] ttl key num[" << stat.expired_key_num << "] schema size less num["
+              << schame_size_less_count << "] other error count[" << other_error_count << "]"
               << " tid[" << tid << "] pid[" << pid << "]";
     return 0;
 }
@@ -722,6 +1259,11 @@ int MemTableSnapshot::ExtractIndexData(std::shared_ptr<Table> table, const ::ope
                                        uint32_t idx, uint32_t partition_num, uint64_t& out_offset) {
     uint32_t tid = table->GetId();
     uint32_t pid = table->GetPid();
+    // the index data is extracted from a single snapshot
+    if (MergeDeltaSnapshot(table) < 0) {
+        PDLOG(WARNING, "fail to merge delta snapshot. tid %u, pid %u", tid, pid);
+        return -1;
+    }
     if (making_snapshot_.exchange(true, std::memory_order_consume)) {
         PDLOG(INFO, "snapshot is doing now. tid %u, pid %u", tid, pid);
         return -1;
@@ -744,6 +1286,7 @@ int MemTableSnapshot::ExtractIndexData(std::shared_ptr<Table> table, const ::ope
     uint64_t collected_offset = CollectDeletedKey(0);
     uint64_t start_time = ::baidu::common::timer::now_time();
     WriteHandle* wh = new WriteHandle(FLAGS_snapshot_compression, snapshot_name_tmp, fd);
+    wh->SetRateLimiter(::openmldb::base::GetDiskRateLimiter(snapshot_path_, FLAGS_background_disk_io_limit));
     ::openmldb::api::Manifest manifest;
     bool has_error = false;
     uint64_t write_count = 0;
@@ -959,6 +1502,10 @@ int MemTableSnapshot::ExtractIndexData(std::shared_ptr<Table> table, const ::ope
                 if (manifest.has_name() && manifest.name() != snapshot_name) {
                     DEBUGLOG("old snapshot[%s] has deleted", manifest.name().c_str());
                     unlink((snapshot_path_ + manifest.name()).c_str());
+                    unlink((snapshot_path_ + manifest.name() + MAPPED_SNAPSHOT_SUFFIX).c_str());
+                }
+                if (FLAGS_snapshot_mmap) {
+                    MakeMappedSnapshot(snapshot_name, write_count);
                 }
                 uint64_t consumed = ::baidu::common::timer::now_time() - start_time;
                 PDLOG(INFO,
@@ -980,7 +1527,7 @@ int MemTableSnapshot::ExtractIndexData(std::shared_ptr<Table> table, const ::ope
             ret = -1;
         }
     }
-    deleted_keys_.clear();
+    ClearDeletedKey();
     making_snapshot_.store(false, std::memory_order_release);
     return ret;
 }
@@ -1139,6 +1686,11 @@ bool MemTableSnapshot::DumpIndexData(std::shared_ptr<Table> table, const ::openm
                                      uint32_t idx, const std::vector<::openmldb::log::WriteHandle*>& whs) {
     uint32_t tid = table->GetId();
     uint32_t pid = table->GetPid();
+    // the index data is dumped from a single snapshot
+    if (MergeDeltaSnapshot(table) < 0) {
+        PDLOG(WARNING, "fail to merge delta snapshot. tid %u, pid %u", tid, pid);
+        return false;
+    }
     if (making_snapshot_.exchange(true, std::memory_order_consume)) {
         PDLOG(INFO, "snapshot is doing now. tid %u, pid %u", tid, pid);
         return false;
@@ -1325,5 +1877,131 @@ bool MemTableSnapshot::IsCompressed(const std::string& path) {
     return false;
 }
 
+// quote the value if it has the separator, the quote or the line breaks
+static void AppendCsvValue(const std::string& value, std::string* line) {
+    if (value.find_first_of(",\"\r\n") == std::string::npos) {
+        line->append(value);
+        return;
+    }
+    line->push_back('"');
+    for (char c : value) {
+        if (c == '"') {
+            line->push_back('"');
+        }
+        line->push_back(c);
+    }
+    line->push_back('"');
+}
+
+static bool EncodeCsvLine(const Schema& schema, const int8_t* raw, uint32_t size, std::string* line) {
+    ::openmldb::codec::RowView view(schema, raw, size);
+    line->clear();
+    for (int i = 0; i < schema.size(); i++) {
+        if (i > 0) {
+            line->push_back(',');
+        }
+        if (view.IsNULL(i)) {
+            line->append("null");
+            continue;
+        }
+        std::string value;
+        char buf[32];
+        switch (schema.Get(i).data_type()) {
+            // keep the precision which std::to_string loses
+            case ::openmldb::type::kFloat: {
+                float v = 0;
+                view.GetFloat(i, &v);
+                snprintf(buf, sizeof(buf), "%.9g", v);
+                value.assign(buf);
+                break;
+            }
+            case ::openmldb::type::kDouble: {
+                double v = 0;
+                view.GetDouble(i, &v);
+                snprintf(buf, sizeof(buf), "%.17g", v);
+                value.assign(buf);
+                break;
+            }
+            default:
+                if (view.GetStrValue(i, &value) < 0) {
+                    return false;
+                }
+        }
+        AppendCsvValue(value, line);
+    }
+    line->push_back('\n');
+    return true;
+}
+
+int MemTableSnapshot::ExportToCsv(std::shared_ptr<Table> table, const std::string& file_path, uint64_t* count) {
+    auto index_def = table->GetPkIndex();
+    if (!index_def || !index_def->IsReady()) {
+        PDLOG(WARNING, "no ready index to traverse. tid %u pid %u", tid_, pid_);
+        return -1;
+    }
+    std::string tmp_file_path = file_path + ".tmp";
+    FILE* fd = fopen(tmp_file_path.c_str(), "wb");
+    if (fd == NULL) {
+        PDLOG(WARNING, "fail to create file %s", tmp_file_path.c_str());
+        return -1;
+    }
+    // the latest version has all the columns
+    auto versions = table->GetAllVersionSchema();
+    if (versions.empty()) {
+        fclose(fd);
+        unlink(tmp_file_path.c_str());
+        return -1;
+    }
+    std::shared_ptr<Schema> schema = versions.rbegin()->second;
+    std::string line;
+    for (int i = 0; i < schema->size(); i++) {
+        if (i > 0) {
+            line.push_back(',');
+        }
+        AppendCsvValue(schema->Get(i).name(), &line);
+    }
+    line.push_back('\n');
+    bool has_error = fwrite(line.data(), 1, line.size(), fd) != line.size();
+    uint64_t cnt = 0;
+    std::string buff;
+    std::unique_ptr<TableIterator> it(table->NewTraverseIterator(index_def->GetId()));
+    it->SeekToFirst();
+    while (!has_error && it->Valid()) {
+        ::openmldb::base::Slice data = it->GetValue();
+        if (table->GetCompressType() == ::openmldb::type::kSnappy) {
+            buff.clear();
+            ::snappy::Uncompress(data.data(), data.size(), &buff);
+            data.reset(buff.data(), buff.size());
+        }
+        const int8_t* raw = reinterpret_cast<const int8_t*>(data.data());
+        // the rows are decoded by the schema of their versions and written with the columns of the latest schema
+        auto version_schema = table->GetVersionSchema(::openmldb::codec::RowView::GetSchemaVersion(raw));
+        if (!version_schema || !EncodeCsvLine(*version_schema, raw, data.size(), &line)) {
+            PDLOG(WARNING, "fail to decode the row. tid %u pid %u", tid_, pid_);
+            has_error = true;
+            break;
+        }
+        for (int i = version_schema->size(); i < schema->size(); i++) {
+            line.insert(line.size() - 1, ",null");
+        }
+        has_error = fwrite(line.data(), 1, line.size(), fd) != line.size();
+        cnt++;
+        it->Next();
+    }
+    if (fclose(fd) != 0) {
+        has_error = true;
+    }
+    if (has_error || rename(tmp_file_path.c_str(), file_path.c_str()) != 0) {
+        PDLOG(WARNING, "fail to export table to %s. tid %u pid %u", file_path.c_str(), tid_, pid_);
+        unlink(tmp_file_path.c_str());
+        return -1;
+    }
+    PDLOG(INFO, "export %lu rows to %s. tid %u pid %u", cnt, file_path.c_str(), tid_, pid_);
+    if (count != nullptr) {
+        *count = cnt;
+    }
+    return 0;
+}
+
 }  // namespace storage
 }  // namespace openmldb
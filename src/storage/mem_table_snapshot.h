@@ -19,10 +19,12 @@
 #include <atomic>
 #include <map>
 #include <memory>
+#include <mutex>  // NOLINT
 #include <set>
 #include <string>
 #include <vector>
 
+#include "base/taskpool.hpp"
 #include "codec/schema_codec.h"
 #include "log/log_reader.h"
 #include "log/log_writer.h"
@@ -54,16 +56,25 @@ class MemTableSnapshot : public Snapshot {
 
     void RecoverFromSnapshot(const std::string& snapshot_name, uint64_t expect_cnt, std::shared_ptr<Table> table);
 
+    // replay the puts and deletes of the deltas in order
+    void RecoverFromDelta(const ::openmldb::api::Manifest& manifest, std::shared_ptr<Table> table);
+
+    // write the binlog to a delta file if snapshot_delta_max_num is set and the deltas
+    // do not reach it, otherwise rewrite the snapshot with the deltas merged
     int MakeSnapshot(std::shared_ptr<Table> table,
                      uint64_t& out_offset,  // NOLINT
                      uint64_t end_offset) override;
 
+    // merge the deltas into a full snapshot, do nothing if there is no delta
+    int MergeDeltaSnapshot(std::shared_ptr<Table> table);
+
     int TTLSnapshot(std::shared_ptr<Table> table, const ::openmldb::api::Manifest& manifest, WriteHandle* wh,
                     uint64_t& count, uint64_t& expired_key_num,  // NOLINT
                     uint64_t& deleted_key_num);                  // NOLINT
 
     void Put(std::string& path, std::shared_ptr<Table>& table,  // NOLINT
-             std::vector<std::string*> recordPtr, std::atomic<uint64_t>* succ_cnt, std::atomic<uint64_t>* failed_cnt);
+             std::vector<::openmldb::api::LogEntry*> entries, std::atomic<uint64_t>* succ_cnt,
+             std::atomic<uint64_t>* failed_cnt);
 
     int ExtractIndexFromSnapshot(std::shared_ptr<Table> table, const ::openmldb::api::Manifest& manifest,
                                  WriteHandle* wh,
@@ -88,29 +99,111 @@ class MemTableSnapshot : public Snapshot {
     bool DumpIndexData(std::shared_ptr<Table> table, const ::openmldb::common::ColumnKey& column_key, uint32_t idx,
                        const std::vector<::openmldb::log::WriteHandle*>& whs);
 
+    // export the rows of the table to a csv file with the header of the column names, the file can be read by
+    // spark and loaded back by the importer. null is written as null
+    int ExportToCsv(std::shared_ptr<Table> table, const std::string& file_path, uint64_t* count);
+
     bool PackNewIndexEntry(std::shared_ptr<Table> table, const std::vector<std::vector<uint32_t>>& index_cols,
                            uint32_t max_idx, uint32_t idx, uint32_t partition_num, ::openmldb::api::LogEntry* entry,
                            uint32_t* index_pid);
 
-    int RemoveDeletedKey(const ::openmldb::api::LogEntry& entry, const std::set<uint32_t>& deleted_index,
-                         std::string* buffer);
+    int RemoveDeletedKey(std::shared_ptr<Table> table, const ::openmldb::api::LogEntry& entry,
+                         const std::set<uint32_t>& deleted_index, std::string* buffer);
 
  private:
+    int MakeSnapshot(std::shared_ptr<Table> table, uint64_t& out_offset, uint64_t end_offset,  // NOLINT
+                     bool allow_delta);
+
+    // write the binlog after the snapshot to a new delta and add it to manifest
+    int MakeDeltaSnapshot(std::shared_ptr<Table> table, ::openmldb::api::Manifest* manifest,
+                          uint64_t& out_offset,  // NOLINT
+                          uint64_t end_offset);
+
     // load single snapshot to table
     void RecoverSingleSnapshot(const std::string& path, std::shared_ptr<Table> table, std::atomic<uint64_t>* g_succ_cnt,
                                std::atomic<uint64_t>* g_failed_cnt);
 
+    // decode the records and dispatch them to the put pools by the segment of the first dimension,
+    // so the records of one segment are put by one thread
+    void Decode(std::string& path, std::shared_ptr<Table>& table,  // NOLINT
+                std::vector<std::string*> recordPtr,
+                std::vector<std::shared_ptr<::openmldb::base::TaskPool>>* put_pools,
+                std::atomic<uint64_t>* succ_cnt, std::atomic<uint64_t>* failed_cnt);
+
+    // load the mapped sidecar of a snapshot. The rows refer to the values in the mapped
+    // file instead of copying them, return false if the sidecar is missing or incomplete
+    bool RecoverMappedSnapshot(const std::string& path, uint64_t expect_cnt, std::shared_ptr<Table> table,
+                               std::atomic<uint64_t>* g_succ_cnt, std::atomic<uint64_t>* g_failed_cnt);
+
+    // write the mapped sidecar of the snapshot
+    bool MakeMappedSnapshot(const std::string& snapshot_name, uint64_t expect_cnt);
+
     uint64_t CollectDeletedKey(uint64_t end_offset);
 
+    // record the delete entry at the offset to deleted_keys_ or the deleted ranges
+    void CollectDeletedEntry(const ::openmldb::api::LogEntry& entry, uint64_t offset);
+
+    void ClearDeletedKey();
+
+    // whether the row of the entry in the index idx is in a ts range deleted after it
+    bool IsDeletedByRange(const std::shared_ptr<Table>& table, const ::openmldb::api::LogEntry& entry,
+                          const std::string& combined_key, uint32_t idx);
+
+    // collect the deletes recorded in the deltas
+    void CollectDeltaDeletedKey(const ::openmldb::api::Manifest& manifest);
+
     int DecodeData(std::shared_ptr<Table> table, const openmldb::api::LogEntry& entry, uint32_t maxIdx,
                    std::vector<std::string>& row);  // NOLINT
 
+    // the results of extracting the new index of a snapshot record
+    enum ExtractIndexResult {
+        kExtractError = -1,
+        // the record is written to the new snapshot as it is
+        kExtractKept = 0,
+        // the record is written with the dimensions changed
+        kExtractChanged,
+        // the record is put into the new index and written with the new dimension
+        kExtractPut,
+        kExtractExpired,
+        kExtractDeleted,
+        kExtractSkipped,
+    };
+
+    struct ExtractIndexStat {
+        std::mutex mu;
+        bool has_error = false;
+        uint64_t count = 0;
+        uint64_t extract_count = 0;
+        uint64_t expired_key_num = 0;
+        uint64_t deleted_key_num = 0;
+        uint64_t other_error_count = 0;
+    };
+
+    // extract the new index of a snapshot record, the record written to the new snapshot is set to out if it is
+    // changed
+    int ExtractIndexRecord(std::shared_ptr<Table> table, const std::string& data, uint32_t idx,
+                           uint32_t partition_num, uint32_t max_idx, const std::vector<uint32_t>& index_cols,
+                           std::string* out);
+
+    // extract a batch of the records and write them to the new snapshot under the lock of stat
+    void ExtractIndexBatch(std::shared_ptr<Table> table, std::vector<std::string*> records, uint32_t idx,
+                           uint32_t partition_num, uint32_t max_idx, const std::vector<uint32_t>* index_cols,
+                           WriteHandle* wh, ExtractIndexStat* stat);
+
     inline bool IsCompressed(const std::string& path);
 
  private:
     LogParts* log_part_;
     std::string log_path_;
     std::map<std::string, uint64_t> deleted_keys_;
+    // the deletes of the ts ranges of the keys, and the ones of all the keys
+    struct DeletedRange {
+        uint64_t offset;
+        uint64_t start_ts;
+        uint64_t end_ts;
+    };
+    std::map<std::string, std::vector<DeletedRange>> deleted_ranges_;
+    std::vector<DeletedRange> deleted_all_ranges_;
     std::string db_root_path_;
 };
 
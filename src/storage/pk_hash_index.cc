@@ -0,0 +1,179 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "storage/pk_hash_index.h"
+
+#include <algorithm>
+
+#include "base/hash.h"
+
+namespace openmldb {
+namespace storage {
+
+static const uint64_t kMinCapacity = 64;
+static const uint32_t kHashSeed = 0x4d5a2f1b;
+// the mark of a slot whose node is removed, the probes go on over it
+static KeyEntryNode* const kRemoved = reinterpret_cast<KeyEntryNode*>(1);
+
+PkHashIndex::Table::Table(uint64_t capacity) : mask(capacity - 1), slots(new Slot[capacity]) {
+    for (uint64_t i = 0; i < capacity; i++) {
+        slots[i].node.store(nullptr, std::memory_order_relaxed);
+        slots[i].hash.store(0, std::memory_order_relaxed);
+    }
+}
+
+PkHashIndex::PkHashIndex(const std::atomic<uint64_t>* gc_version)
+    : gc_version_(gc_version),
+      table_(new Table(kMinCapacity)),
+      byte_size_(kMinCapacity * sizeof(Slot)),
+      mu_(),
+      size_(0),
+      used_(0),
+      retired_tables_() {}
+
+PkHashIndex::~PkHashIndex() {
+    delete table_.load(std::memory_order_relaxed);
+    for (auto& kv : retired_tables_) {
+        delete kv.second;
+    }
+}
+
+uint64_t PkHashIndex::Hash(const Slice& key) {
+    // not the hash choosing the segment, all the keys of a segment have the same value of it modulo the segment count
+    return ::openmldb::base::MurmurHash64A(key.data(), key.size(), kHashSeed);
+}
+
+KeyEntryNode* PkHashIndex::Find(const Slice& key) const {
+    const Table* table = table_.load(std::memory_order_acquire);
+    uint64_t hash = Hash(key);
+    uint64_t pos = hash & table->mask;
+    for (uint64_t probe = 0; probe <= table->mask; probe++) {
+        // the hash is stored before the node, so it belongs to the node or a newer one of the slot
+        KeyEntryNode* node = table->slots[pos].node.load(std::memory_order_acquire);
+        if (node == nullptr) {
+            return nullptr;
+        }
+        if (node != kRemoved && table->slots[pos].hash.load(std::memory_order_relaxed) == hash &&
+            node->GetKey().compare(key) == 0) {
+            return node;
+        }
+        pos = (pos + 1) & table->mask;
+    }
+    return nullptr;
+}
+
+bool PkHashIndex::InsertSlot(Table* table, uint64_t hash, KeyEntryNode* node) {
+    uint64_t pos = hash & table->mask;
+    while (true) {
+        KeyEntryNode* cur = table->slots[pos].node.load(std::memory_order_relaxed);
+        if (cur == nullptr || cur == kRemoved) {
+            table->slots[pos].hash.store(hash, std::memory_order_relaxed);
+            table->slots[pos].node.store(node, std::memory_order_release);
+            return cur == nullptr;
+        }
+        pos = (pos + 1) & table->mask;
+    }
+}
+
+void PkHashIndex::Insert(KeyEntryNode* node) {
+    std::lock_guard<std::mutex> lock(mu_);
+    Table* table = table_.load(std::memory_order_relaxed);
+    // keep the load factor with the removed marks under 3/4, or the probes get long
+    if ((used_ + 1) * 4 > (table->mask + 1) * 3) {
+        uint64_t capacity = kMinCapacity;
+        while (capacity < (size_ + 1) * 2) {
+            capacity <<= 1;
+        }
+        Rehash(capacity);
+        table = table_.load(std::memory_order_relaxed);
+    }
+    if (InsertSlot(table, Hash(node->GetKey()), node)) {
+        used_++;
+    }
+    size_++;
+}
+
+void PkHashIndex::Remove(KeyEntryNode* node) {
+    std::lock_guard<std::mutex> lock(mu_);
+    Table* table = table_.load(std::memory_order_relaxed);
+    uint64_t pos = Hash(node->GetKey()) & table->mask;
+    for (uint64_t probe = 0; probe <= table->mask; probe++) {
+        KeyEntryNode* cur = table->slots[pos].node.load(std::memory_order_relaxed);
+        if (cur == nullptr) {
+            return;
+        }
+        if (cur == node) {
+            table->slots[pos].node.store(kRemoved, std::memory_order_release);
+            size_--;
+            return;
+        }
+        pos = (pos + 1) & table->mask;
+    }
+}
+
+void PkHashIndex::Rehash(uint64_t capacity) {
+    Table* table = table_.load(std::memory_order_relaxed);
+    auto* new_table = new Table(capacity);
+    for (uint64_t pos = 0; pos <= table->mask; pos++) {
+        KeyEntryNode* node = table->slots[pos].node.load(std::memory_order_relaxed);
+        if (node != nullptr && node != kRemoved) {
+            InsertSlot(new_table, table->slots[pos].hash.load(std::memory_order_relaxed), node);
+        }
+    }
+    used_ = size_;
+    // the readers may still probe the old table
+    table_.store(new_table, std::memory_order_release);
+    retired_tables_.emplace_back(gc_version_->load(std::memory_order_relaxed), table);
+    uint64_t byte_size = capacity * sizeof(Slot);
+    for (const auto& kv : retired_tables_) {
+        byte_size += (kv.second->mask + 1) * sizeof(Slot);
+    }
+    byte_size_.store(byte_size, std::memory_order_relaxed);
+}
+
+void PkHashIndex::Clear() {
+    std::lock_guard<std::mutex> lock(mu_);
+    delete table_.load(std::memory_order_relaxed);
+    for (auto& kv : retired_tables_) {
+        delete kv.second;
+    }
+    retired_tables_.clear();
+    table_.store(new Table(kMinCapacity), std::memory_order_release);
+    byte_size_.store(kMinCapacity * sizeof(Slot), std::memory_order_relaxed);
+    size_ = 0;
+    used_ = 0;
+}
+
+void PkHashIndex::FreeRetiredTables(uint64_t version) {
+    std::lock_guard<std::mutex> lock(mu_);
+    auto iter = retired_tables_.begin();
+    while (iter != retired_tables_.end() && iter->first <= version) {
+        delete iter->second;
+        iter++;
+    }
+    if (iter == retired_tables_.begin()) {
+        return;
+    }
+    retired_tables_.erase(retired_tables_.begin(), iter);
+    uint64_t byte_size = (table_.load(std::memory_order_relaxed)->mask + 1) * sizeof(Slot);
+    for (const auto& kv : retired_tables_) {
+        byte_size += (kv.second->mask + 1) * sizeof(Slot);
+    }
+    byte_size_.store(byte_size, std::memory_order_relaxed);
+}
+
+}  // namespace storage
+}  // namespace openmldb
@@ -0,0 +1,99 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_STORAGE_PK_HASH_INDEX_H_
+#define SRC_STORAGE_PK_HASH_INDEX_H_
+
+#include <atomic>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <utility>
+#include <vector>
+
+#include "base/skiplist.h"
+#include "base/slice.h"
+
+namespace openmldb {
+namespace storage {
+
+using ::openmldb::base::Slice;
+
+typedef ::openmldb::base::Node<Slice, void*> KeyEntryNode;
+
+// PkHashIndex maps the keys of a segment to the nodes of its key skiplist by open addressing
+// with linear probing, so a point lookup costs one hash and about one key comparison instead
+// of the O(log n) comparisons of the skiplist. The skiplist is still the owner of the nodes
+// and keeps the order of the keys for the traverse.
+// Find is lock free and can run with all the others. Insert, Remove and Clear are serialized
+// by the index itself. A node must be removed from the index before it is released, and the
+// replaced tables are kept until FreeRetiredTables is called with a newer version, as the
+// removed nodes are kept in the entry free list of the segment
+class PkHashIndex {
+ public:
+    explicit PkHashIndex(const std::atomic<uint64_t>* gc_version);
+    ~PkHashIndex();
+
+    // return the node of key, NULL if it is not found
+    KeyEntryNode* Find(const Slice& key) const;
+
+    // the key of node should not be in the index
+    void Insert(KeyEntryNode* node);
+
+    void Remove(KeyEntryNode* node);
+
+    // remove all of the nodes, it needs no reader running
+    void Clear();
+
+    // free the tables replaced before or in version
+    void FreeRetiredTables(uint64_t version);
+
+    inline uint64_t GetByteSize() const { return byte_size_.load(std::memory_order_relaxed); }
+
+ private:
+    struct Slot {
+        std::atomic<KeyEntryNode*> node;
+        std::atomic<uint64_t> hash;
+    };
+
+    struct Table {
+        explicit Table(uint64_t capacity);
+        uint64_t mask;
+        std::unique_ptr<Slot[]> slots;
+    };
+
+    static uint64_t Hash(const Slice& key);
+
+    // put node into the first empty or removed slot of table, return true if the slot is empty
+    static bool InsertSlot(Table* table, uint64_t hash, KeyEntryNode* node);
+
+    // build a new table with at least capacity slots from the nodes of the current one
+    void Rehash(uint64_t capacity);
+
+ private:
+    const std::atomic<uint64_t>* gc_version_;
+    std::atomic<Table*> table_;
+    std::atomic<uint64_t> byte_size_;
+    std::mutex mu_;
+    // the count of nodes and the count of slots taken by the nodes or the removed marks, guarded by mu_
+    uint64_t size_;
+    uint64_t used_;
+    // the replaced tables and the gc version when they are replaced, guarded by mu_
+    std::vector<std::pair<uint64_t, Table*>> retired_tables_;
+};
+
+}  // namespace storage
+}  // namespace openmldb
+#endif  // SRC_STORAGE_PK_HASH_INDEX_H_
@@ -0,0 +1,148 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "storage/pk_hash_index.h"
+
+#include <atomic>
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace openmldb {
+namespace storage {
+
+class PkHashIndexTest : public ::testing::Test {
+ public:
+    PkHashIndexTest() {}
+    ~PkHashIndexTest() {}
+};
+
+struct SliceCmp {
+    int operator()(const Slice& a, const Slice& b) const { return a.compare(b); }
+};
+
+typedef ::openmldb::base::Skiplist<Slice, void*, SliceCmp> Keys;
+
+static KeyEntryNode* InsertKey(Keys* keys, const std::vector<std::string>& pks, uint64_t i) {
+    Slice key(pks[i]);
+    void* value = reinterpret_cast<void*>(i + 1);
+    keys->Insert(key, value);
+    return keys->GetNode(key);
+}
+
+TEST_F(PkHashIndexTest, InsertFindRemove) {
+    std::atomic<uint64_t> gc_version(1);
+    PkHashIndex index(&gc_version);
+    SliceCmp cmp;
+    Keys keys(12, 4, cmp);
+    std::vector<std::string> pks;
+    const uint64_t key_num = 10000;
+    for (uint64_t i = 0; i < key_num; i++) {
+        pks.push_back("pk" + std::to_string(i));
+    }
+    std::vector<KeyEntryNode*> nodes;
+    for (uint64_t i = 0; i < key_num; i++) {
+        nodes.push_back(InsertKey(&keys, pks, i));
+        index.Insert(nodes.back());
+    }
+    for (uint64_t i = 0; i < key_num; i++) {
+        KeyEntryNode* node = index.Find(Slice(pks[i]));
+        ASSERT_TRUE(node == nodes[i]);
+        ASSERT_EQ(reinterpret_cast<void*>(i + 1), node->GetValue());
+    }
+    ASSERT_TRUE(index.Find(Slice("missing")) == NULL);
+    uint64_t byte_size = index.GetByteSize();
+    ASSERT_GT(byte_size, key_num * 16);
+    // the tables replaced by the growth are freed when the gc version they are replaced in is passed
+    index.FreeRetiredTables(0);
+    ASSERT_EQ(byte_size, index.GetByteSize());
+    index.FreeRetiredTables(1);
+    ASSERT_LT(index.GetByteSize(), byte_size);
+
+    for (uint64_t i = 0; i < key_num; i += 2) {
+        index.Remove(nodes[i]);
+    }
+    for (uint64_t i = 0; i < key_num; i++) {
+        KeyEntryNode* node = index.Find(Slice(pks[i]));
+        ASSERT_TRUE(i % 2 == 0 ? node == NULL : node == nodes[i]);
+    }
+    // the removed slots are reused
+    for (uint64_t i = 0; i < key_num; i += 2) {
+        index.Insert(nodes[i]);
+    }
+    for (uint64_t i = 0; i < key_num; i++) {
+        ASSERT_TRUE(index.Find(Slice(pks[i])) == nodes[i]);
+    }
+    index.Clear();
+    ASSERT_TRUE(index.Find(Slice(pks[1])) == NULL);
+}
+
+TEST_F(PkHashIndexTest, FindConcurrently) {
+    std::atomic<uint64_t> gc_version(0);
+    PkHashIndex index(&gc_version);
+    SliceCmp cmp;
+    Keys keys(12, 4, cmp);
+    std::vector<std::string> pks;
+    const uint64_t key_num = 50000;
+    for (uint64_t i = 0; i < key_num; i++) {
+        pks.push_back("pk" + std::to_string(i));
+    }
+    std::vector<KeyEntryNode*> nodes;
+    for (uint64_t i = 0; i < key_num; i++) {
+        nodes.push_back(InsertKey(&keys, pks, i));
+    }
+    // the first half of the keys are always in the index while the others are inserted and removed
+    for (uint64_t i = 0; i < key_num / 2; i++) {
+        index.Insert(nodes[i]);
+    }
+    std::atomic<bool> stop(false);
+    std::atomic<uint64_t> missed(0);
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 4; t++) {
+        readers.emplace_back([&]() {
+            while (!stop.load(std::memory_order_relaxed)) {
+                for (uint64_t i = 0; i < key_num / 2; i += 7) {
+                    if (index.Find(Slice(pks[i])) != nodes[i]) {
+                        missed.fetch_add(1);
+                    }
+                }
+            }
+        });
+    }
+    for (int round = 0; round < 3; round++) {
+        for (uint64_t i = key_num / 2; i < key_num; i++) {
+            index.Insert(nodes[i]);
+        }
+        for (uint64_t i = key_num / 2; i < key_num; i++) {
+            index.Remove(nodes[i]);
+        }
+    }
+    stop.store(true);
+    for (auto& reader : readers) {
+        reader.join();
+    }
+    ASSERT_EQ(0u, missed.load());
+}
+
+}  // namespace storage
+}  // namespace openmldb
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
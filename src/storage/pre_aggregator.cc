@@ -0,0 +1,252 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "storage/pre_aggregator.h"
+
+#include <algorithm>
+
+#include "base/glog_wapper.h"
+#include "base/hash.h"
+#include "codec/codec.h"
+
+namespace openmldb {
+namespace storage {
+
+static const uint32_t PRE_AGGR_SHARD_NUM = 16;
+static const uint32_t SEED = 0xe17a1465;
+
+void AggrState::Merge(const AggrState& other) {
+    if (other.count == 0) {
+        return;
+    }
+    count += other.count;
+    int_sum += other.int_sum;
+    double_sum += other.double_sum;
+    min = std::min(min, other.min);
+    max = std::max(max, other.max);
+}
+
+PreAggregator::PreAggregator(const ::openmldb::api::PreAggregation& desc, uint32_t index_id, int32_t ts_idx)
+    : col_name_(desc.aggr_col()),
+      bucket_size_(desc.bucket_size()),
+      index_id_(index_id),
+      ts_idx_(ts_idx),
+      col_idx_(0),
+      col_type_(::openmldb::type::kBigInt),
+      col_offset_(0),
+      col_size_(0),
+      shards_() {
+    for (uint32_t i = 0; i < PRE_AGGR_SHARD_NUM; i++) {
+        shards_.emplace_back(new Shard());
+    }
+}
+
+bool PreAggregator::Init(const ::google::protobuf::RepeatedPtrField<::openmldb::common::ColumnDesc>& schema) {
+    if (bucket_size_ == 0) {
+        PDLOG(WARNING, "bucket size of pre-aggregation on %s is zero", col_name_.c_str());
+        return false;
+    }
+    uint32_t offset = 0;
+    for (int i = 0; i < schema.size(); i++) {
+        ::openmldb::type::DataType type = schema.Get(i).data_type();
+        uint32_t type_size = 0;
+        switch (type) {
+            case ::openmldb::type::kBool:
+                type_size = sizeof(bool);
+                break;
+            case ::openmldb::type::kSmallInt:
+                type_size = sizeof(int16_t);
+                break;
+            case ::openmldb::type::kInt:
+            case ::openmldb::type::kDate:
+                type_size = sizeof(int32_t);
+                break;
+            case ::openmldb::type::kFloat:
+                type_size = sizeof(float);
+                break;
+            case ::openmldb::type::kBigInt:
+            case ::openmldb::type::kTimestamp:
+                type_size = sizeof(int64_t);
+                break;
+            case ::openmldb::type::kDouble:
+                type_size = sizeof(double);
+                break;
+            default:
+                break;
+        }
+        if (schema.Get(i).name() == col_name_) {
+            if (type == ::openmldb::type::kBool || type == ::openmldb::type::kDate || type_size == 0) {
+                PDLOG(WARNING, "pre-aggregation column %s is not numeric", col_name_.c_str());
+                return false;
+            }
+            col_idx_ = i;
+            col_type_ = type;
+            col_offset_ = offset;
+            col_size_ = type_size;
+            return true;
+        }
+        offset += type_size;
+    }
+    PDLOG(WARNING, "pre-aggregation column %s is not found", col_name_.c_str());
+    return false;
+}
+
+PreAggregator::Shard& PreAggregator::GetShard(const char* pk, size_t size) {
+    return *shards_[::openmldb::base::hash(pk, size, SEED) % shards_.size()];
+}
+
+bool PreAggregator::Fold(const int8_t* row, uint32_t size, uint32_t col_cnt, AggrState* state) const {
+    uint32_t bitmap_size = (col_cnt >> 3) + !!(col_cnt & 0x07);
+    uint32_t offset = ::openmldb::codec::HEADER_LENGTH + bitmap_size + col_offset_;
+    if (col_idx_ >= col_cnt || size < offset + col_size_ ||
+        *(reinterpret_cast<const uint32_t*>(row + ::openmldb::codec::VERSION_LENGTH)) != size) {
+        return false;
+    }
+    const uint8_t* bitmap = reinterpret_cast<const uint8_t*>(row + ::openmldb::codec::HEADER_LENGTH);
+    if (bitmap[col_idx_ >> 3] & (1 << (col_idx_ & 0x07))) {
+        // null
+        return true;
+    }
+    double value = 0;
+    switch (col_type_) {
+        case ::openmldb::type::kSmallInt: {
+            int16_t v = ::openmldb::codec::v1::GetInt16Field(row, offset);
+            state->int_sum += v;
+            value = v;
+            break;
+        }
+        case ::openmldb::type::kInt: {
+            int32_t v = ::openmldb::codec::v1::GetInt32Field(row, offset);
+            state->int_sum += v;
+            value = v;
+            break;
+        }
+        case ::openmldb::type::kBigInt:
+        case ::openmldb::type::kTimestamp: {
+            int64_t v = ::openmldb::codec::v1::GetInt64Field(row, offset);
+            state->int_sum += v;
+            value = v;
+            break;
+        }
+        case ::openmldb::type::kFloat:
+            value = ::openmldb::codec::v1::GetFloatField(row, offset);
+            state->double_sum += value;
+            break;
+        case ::openmldb::type::kDouble:
+            value = ::openmldb::codec::v1::GetDoubleField(row, offset);
+            state->double_sum += value;
+            break;
+        default:
+            return false;
+    }
+    state->count++;
+    state->min = std::min(state->min, value);
+    state->max = std::max(state->max, value);
+    return true;
+}
+
+void PreAggregator::Update(const base::Slice& pk, uint64_t ts, const int8_t* row, uint32_t size, uint32_t col_cnt) {
+    AggrState state;
+    if (!Fold(row, size, col_cnt, &state)) {
+        DEBUGLOG("fail to fold the row of pk %s ts %lu", pk.ToString().c_str(), ts);
+        return;
+    }
+    if (state.count == 0) {
+        return;
+    }
+    uint64_t bucket_start = ts - ts % bucket_size_;
+    Shard& shard = GetShard(pk.data(), pk.size());
+    std::lock_guard<std::mutex> lock(shard.mu);
+    shard.buckets[pk.ToString()][bucket_start].Merge(state);
+}
+
+bool PreAggregator::GetCoveredBuckets(uint64_t st, uint64_t et, uint64_t bucket_size, uint64_t* first_start,
+                                      uint64_t* last_end) {
+    *first_start = st % bucket_size == 0 ? st : st - st % bucket_size + bucket_size;
+    *last_end = et == UINT64_MAX ? et - et % bucket_size : (et + 1) - (et + 1) % bucket_size;
+    // the overflow of first_start included
+    return *first_start >= st && *last_end > *first_start;
+}
+
+void PreAggregator::Query(const std::string& pk, uint64_t st, uint64_t et, AggrState* state,
+                          std::vector<std::pair<uint64_t, uint64_t>>* edges) {
+    if (st > et) {
+        return;
+    }
+    uint64_t first_start = 0;
+    uint64_t last_end = 0;
+    if (!GetCoveredBuckets(st, et, bucket_size_, &first_start, &last_end)) {
+        edges->emplace_back(st, et);
+        return;
+    }
+    if (st < first_start) {
+        edges->emplace_back(st, first_start - 1);
+    }
+    if (last_end <= et) {
+        edges->emplace_back(last_end, et);
+    }
+    Shard& shard = GetShard(pk.data(), pk.size());
+    std::lock_guard<std::mutex> lock(shard.mu);
+    auto it = shard.buckets.find(pk);
+    if (it == shard.buckets.end()) {
+        return;
+    }
+    for (auto bucket = it->second.lower_bound(first_start); bucket != it->second.end() && bucket->first < last_end;
+         ++bucket) {
+        state->Merge(bucket->second);
+    }
+}
+
+void PreAggregator::Delete(const std::string& pk) {
+    Shard& shard = GetShard(pk.data(), pk.size());
+    std::lock_guard<std::mutex> lock(shard.mu);
+    shard.buckets.erase(pk);
+}
+
+void PreAggregator::Gc(uint64_t expire_time) {
+    if (expire_time < bucket_size_) {
+        return;
+    }
+    // the buckets start before it end before expire_time
+    uint64_t bucket_start = expire_time - bucket_size_ + 1;
+    for (auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard->mu);
+        for (auto it = shard->buckets.begin(); it != shard->buckets.end();) {
+            auto& buckets = it->second;
+            buckets.erase(buckets.begin(), buckets.lower_bound(bucket_start));
+            if (buckets.empty()) {
+                it = shard->buckets.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+}
+
+void PreAggregator::TakeBuckets(std::vector<AggrBucket>* buckets) {
+    for (auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard->mu);
+        for (const auto& kv : shard->buckets) {
+            for (const auto& bucket : kv.second) {
+                buckets->push_back({kv.first, bucket.first, bucket.second});
+            }
+        }
+        shard->buckets.clear();
+    }
+}
+
+}  // namespace storage
+}  // namespace openmldb
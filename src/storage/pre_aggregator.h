@@ -0,0 +1,123 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_STORAGE_PRE_AGGREGATOR_H_
+#define SRC_STORAGE_PRE_AGGREGATOR_H_
+
+#include <stdint.h>
+
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "base/slice.h"
+#include "proto/tablet.pb.h"
+
+namespace openmldb {
+namespace storage {
+
+// The aggregation of a column over some rows, the null values are not counted
+struct AggrState {
+    uint64_t count = 0;
+    // the sum of the integer columns
+    int64_t int_sum = 0;
+    // the sum of the floating point columns
+    double double_sum = 0;
+    double min = std::numeric_limits<double>::max();
+    double max = std::numeric_limits<double>::lowest();
+
+    void Merge(const AggrState& other);
+};
+
+struct AggrBucket {
+    std::string pk;
+    uint64_t start;
+    AggrState state;
+};
+
+// Keeps the aggregation of a numeric column in the time buckets of every key of
+// an index, it is updated by the puts of the table. The aggregation over a long
+// window merges the buckets covered by the window, so only the rows in the
+// buckets at the edges need to be scanned
+class PreAggregator {
+ public:
+    PreAggregator(const ::openmldb::api::PreAggregation& desc, uint32_t index_id, int32_t ts_idx);
+    PreAggregator(const PreAggregator&) = delete;
+    PreAggregator& operator=(const PreAggregator&) = delete;
+
+    // find the column in schema, it must be a numeric column
+    bool Init(const ::google::protobuf::RepeatedPtrField<::openmldb::common::ColumnDesc>& schema);
+
+    inline uint32_t GetIndexId() const { return index_id_; }
+    inline const std::string& GetColName() const { return col_name_; }
+    // the ts column of the index, -1 if the index uses the time of the records
+    inline int32_t GetTsIdx() const { return ts_idx_; }
+    inline uint64_t GetBucketSize() const { return bucket_size_; }
+
+    // col_cnt is the column count of the schema version of row
+    void Update(const base::Slice& pk, uint64_t ts, const int8_t* row, uint32_t size, uint32_t col_cnt);
+
+    // add the value of row to state
+    bool Fold(const int8_t* row, uint32_t size, uint32_t col_cnt, AggrState* state) const;
+
+    // the buckets in [first_start, last_end) are covered by [st, et], return false if there is none
+    static bool GetCoveredBuckets(uint64_t st, uint64_t et, uint64_t bucket_size, uint64_t* first_start,
+                                  uint64_t* last_end);
+
+    // merge the buckets of pk covered by [st, et] into state, the ranges of ts
+    // at the edges that are not covered are appended to edges
+    void Query(const std::string& pk, uint64_t st, uint64_t et, AggrState* state,
+               std::vector<std::pair<uint64_t, uint64_t>>* edges);
+
+    void Delete(const std::string& pk);
+
+    // drop the buckets end before expire_time
+    void Gc(uint64_t expire_time);
+
+    // move all the buckets out to flush them somewhere else
+    void TakeBuckets(std::vector<AggrBucket>* buckets);
+
+ private:
+    struct Shard {
+        std::mutex mu;
+        // the buckets of a key by the start ts
+        std::unordered_map<std::string, std::map<uint64_t, AggrState>> buckets;
+    };
+
+    Shard& GetShard(const char* pk, size_t size);
+
+ private:
+    std::string col_name_;
+    uint64_t bucket_size_;
+    uint32_t index_id_;
+    int32_t ts_idx_;
+    uint32_t col_idx_;
+    ::openmldb::type::DataType col_type_;
+    // the offset of the column after the bitmap
+    uint32_t col_offset_;
+    uint32_t col_size_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+};
+
+}  // namespace storage
+}  // namespace openmldb
+
+#endif  // SRC_STORAGE_PRE_AGGREGATOR_H_
@@ -0,0 +1,224 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "storage/pre_aggregator.h"
+
+#include <gflags/gflags.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/glog_wapper.h"
+#include "codec/codec.h"
+#include "codec/schema_codec.h"
+#include "gtest/gtest.h"
+#include "storage/mem_table.h"
+#include "storage/ticket.h"
+
+namespace openmldb {
+namespace storage {
+
+using ::openmldb::codec::SchemaCodec;
+
+class PreAggregatorTest : public ::testing::Test {
+ public:
+    PreAggregatorTest() {}
+    ~PreAggregatorTest() {}
+};
+
+static void CreateTableMeta(::openmldb::type::DataType type, ::openmldb::api::TableMeta* table_meta) {
+    table_meta->set_name("t1");
+    table_meta->set_tid(1);
+    table_meta->set_pid(0);
+    table_meta->set_seg_cnt(8);
+    table_meta->set_format_version(1);
+    SchemaCodec::SetColumnDesc(table_meta->add_column_desc(), "card", ::openmldb::type::kString);
+    SchemaCodec::SetColumnDesc(table_meta->add_column_desc(), "flag", ::openmldb::type::kBool);
+    SchemaCodec::SetColumnDesc(table_meta->add_column_desc(), "price", type);
+    SchemaCodec::SetColumnDesc(table_meta->add_column_desc(), "ts1", ::openmldb::type::kTimestamp);
+    SchemaCodec::SetIndex(table_meta->add_column_key(), "card", "card", "ts1", ::openmldb::type::kAbsoluteTime, 0, 0);
+    auto desc = table_meta->add_pre_aggregations();
+    desc->set_index_name("card");
+    desc->set_aggr_col("price");
+    desc->set_bucket_size(100);
+}
+
+static void PutRow(MemTable* table, const std::string& card, int64_t price, bool is_null, uint64_t ts) {
+    auto meta = table->GetTableMeta();
+    ::openmldb::codec::RowBuilder builder(meta->column_desc());
+    uint32_t size = builder.CalTotalLength(card.size());
+    std::string row;
+    row.resize(size);
+    builder.SetBuffer(reinterpret_cast<int8_t*>(&row[0]), size);
+    builder.AppendString(card.c_str(), card.size());
+    builder.AppendBool(true);
+    if (is_null) {
+        builder.AppendNULL();
+    } else if (meta->column_desc(2).data_type() == ::openmldb::type::kDouble) {
+        builder.AppendDouble(price * 0.5);
+    } else {
+        builder.AppendInt32(price);
+    }
+    builder.AppendTimestamp(ts);
+    ::openmldb::api::PutRequest request;
+    auto dim = request.add_dimensions();
+    dim->set_idx(0);
+    dim->set_key(card);
+    auto ts_dim = request.add_ts_dimensions();
+    ts_dim->set_idx(0);
+    ts_dim->set_ts(ts);
+    ASSERT_TRUE(table->Put(request.dimensions(), request.ts_dimensions(), row));
+}
+
+// aggregate by scanning all the rows in [st, et]
+static void ScanAggregate(MemTable* table, PreAggregator* aggr, const std::string& pk, uint64_t st, uint64_t et,
+                          AggrState* state) {
+    Ticket ticket;
+    std::unique_ptr<TableIterator> it(table->NewIterator(0, pk, ticket));
+    for (it->Seek(et); it->Valid() && it->GetKey() >= st; it->Next()) {
+        auto value = it->GetValue();
+        aggr->Fold(reinterpret_cast<const int8_t*>(value.data()), value.size(), 4, state);
+    }
+}
+
+static void AssertStateEq(const AggrState& expect, const AggrState& state) {
+    ASSERT_EQ(expect.count, state.count);
+    ASSERT_EQ(expect.int_sum, state.int_sum);
+    ASSERT_DOUBLE_EQ(expect.double_sum, state.double_sum);
+    if (expect.count > 0) {
+        ASSERT_DOUBLE_EQ(expect.min, state.min);
+        ASSERT_DOUBLE_EQ(expect.max, state.max);
+    }
+}
+
+TEST_F(PreAggregatorTest, QueryEdges) {
+    ::openmldb::api::PreAggregation desc;
+    desc.set_aggr_col("price");
+    desc.set_bucket_size(100);
+    PreAggregator aggr(desc, 0, 0);
+    AggrState state;
+    std::vector<std::pair<uint64_t, uint64_t>> edges;
+    aggr.Query("k", 150, 180, &state, &edges);
+    ASSERT_EQ(1u, edges.size());
+    ASSERT_EQ(std::make_pair(150ul, 180ul), edges[0]);
+    edges.clear();
+    aggr.Query("k", 100, 299, &state, &edges);
+    ASSERT_TRUE(edges.empty());
+    aggr.Query("k", 50, 350, &state, &edges);
+    ASSERT_EQ(2u, edges.size());
+    ASSERT_EQ(std::make_pair(50ul, 99ul), edges[0]);
+    ASSERT_EQ(std::make_pair(300ul, 350ul), edges[1]);
+    edges.clear();
+    aggr.Query("k", 0, UINT64_MAX, &state, &edges);
+    ASSERT_EQ(1u, edges.size());
+    ASSERT_EQ(UINT64_MAX, edges[0].second);
+    ASSERT_EQ(0u, state.count);
+}
+
+TEST_F(PreAggregatorTest, InitFailed) {
+    ::openmldb::api::TableMeta table_meta;
+    CreateTableMeta(::openmldb::type::kInt, &table_meta);
+    table_meta.mutable_pre_aggregations(0)->set_aggr_col("card");
+    {
+        MemTable table(table_meta);
+        ASSERT_FALSE(table.Init());
+    }
+    table_meta.mutable_pre_aggregations(0)->set_aggr_col("price");
+    table_meta.mutable_pre_aggregations(0)->set_index_name("mcc");
+    {
+        MemTable table(table_meta);
+        ASSERT_FALSE(table.Init());
+    }
+    table_meta.mutable_pre_aggregations(0)->set_index_name("card");
+    table_meta.set_format_version(0);
+    {
+        MemTable table(table_meta);
+        ASSERT_FALSE(table.Init());
+    }
+}
+
+TEST_F(PreAggregatorTest, CompareWithScan) {
+    for (auto type : {::openmldb::type::kInt, ::openmldb::type::kDouble}) {
+        ::openmldb::api::TableMeta table_meta;
+        CreateTableMeta(type, &table_meta);
+        MemTable table(table_meta);
+        ASSERT_TRUE(table.Init());
+        PreAggregator aggr(table_meta.pre_aggregations(0), 0, 0);
+        ASSERT_TRUE(aggr.Init(table_meta.column_desc()));
+        for (int i = 0; i < 2000; i++) {
+            PutRow(&table, "card" + std::to_string(i % 3), (i * 37) % 101 - 50, i % 10 == 0, 1000 + i * 7);
+        }
+        ASSERT_FALSE(table.PreAggregate(0, "flag", "card0", 0, 100, NULL));
+        std::vector<std::pair<uint64_t, uint64_t>> windows = {
+            {0, 100}, {1000, 1099}, {1003, 1531}, {2050, 9000}, {1500, 20000}, {0, UINT64_MAX}, {1777, 1779}};
+        for (const auto& window : windows) {
+            for (int k = 0; k < 4; k++) {
+                std::string pk = "card" + std::to_string(k);
+                AggrState expect;
+                ScanAggregate(&table, &aggr, pk, window.first, window.second, &expect);
+                AggrState state;
+                ASSERT_TRUE(table.PreAggregate(0, "price", pk, window.first, window.second, &state));
+                AssertStateEq(expect, state);
+            }
+        }
+        ASSERT_TRUE(table.Delete("card1", 0));
+        AggrState state;
+        ASSERT_TRUE(table.PreAggregate(0, "price", "card1", 0, UINT64_MAX, &state));
+        ASSERT_EQ(0u, state.count);
+    }
+}
+
+TEST_F(PreAggregatorTest, Gc) {
+    ::openmldb::api::PreAggregation desc;
+    desc.set_aggr_col("price");
+    desc.set_bucket_size(100);
+    ::openmldb::api::TableMeta table_meta;
+    CreateTableMeta(::openmldb::type::kInt, &table_meta);
+    MemTable table(table_meta);
+    ASSERT_TRUE(table.Init());
+    PreAggregator aggr(desc, 0, 0);
+    ASSERT_TRUE(aggr.Init(table_meta.column_desc()));
+    for (int i = 0; i < 10; i++) {
+        PutRow(&table, "card", 1, false, i * 50);
+    }
+    Ticket ticket;
+    std::unique_ptr<TableIterator> it(table.NewIterator(0, "card", ticket));
+    for (it->SeekToFirst(); it->Valid(); it->Next()) {
+        auto value = it->GetValue();
+        aggr.Update(Slice("card"), it->GetKey(), reinterpret_cast<const int8_t*>(value.data()), value.size(), 4);
+    }
+    AggrState state;
+    std::vector<std::pair<uint64_t, uint64_t>> edges;
+    aggr.Query("card", 0, 499, &state, &edges);
+    ASSERT_EQ(10u, state.count);
+    ASSERT_EQ(10, state.int_sum);
+    // the bucket [200, 300) is kept as it is not finished
+    aggr.Gc(250);
+    state = AggrState();
+    aggr.Query("card", 0, 499, &state, &edges);
+    ASSERT_EQ(6u, state.count);
+    ASSERT_TRUE(edges.empty());
+}
+
+}  // namespace storage
+}  // namespace openmldb
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    ::openmldb::base::SetLogLevel(INFO);
+    return RUN_ALL_TESTS();
+}
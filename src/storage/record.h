@@ -30,18 +30,29 @@ static const uint32_t KEY_ENTRY_PTR_SIZE = sizeof(KeyEntry*);
 
 static inline uint32_t GetRecordSize(uint32_t value_size) { return value_size + DATA_BLOCK_BYTE_SIZE; }
 
-// the input height which is the height of skiplist node
+// the input height which is the height of skiplist node.
+// the first level of the tower is included in the node size
+static inline uint32_t GetRecordPkNodeSize(uint8_t height, uint32_t key_size) {
+    return (height - 1) * 8 + ENTRY_NODE_SIZE + key_size;
+}
+
+// the key entries of a pk with their heads, an array of them if the segment has more than one ts
+static inline uint32_t GetRecordKeyEntrySize(uint8_t key_entry_max_height, uint32_t ts_cnt) {
+    uint32_t entry_size = KEY_ENTRY_BYTE_SIZE + (key_entry_max_height - 1) * 8 + DATA_NODE_SIZE;
+    return ts_cnt > 1 ? (KEY_ENTRY_PTR_SIZE + entry_size) * ts_cnt : entry_size;
+}
+
 static inline uint32_t GetRecordPkIdxSize(uint8_t height, uint32_t key_size, uint8_t key_entry_max_height) {
-    return height * 8 + ENTRY_NODE_SIZE + KEY_ENTRY_BYTE_SIZE + key_size + key_entry_max_height * 8 + DATA_NODE_SIZE;
+    return GetRecordPkNodeSize(height, key_size) + GetRecordKeyEntrySize(key_entry_max_height, 1);
 }
 
 static inline uint32_t GetRecordPkMultiIdxSize(uint8_t height, uint32_t key_size, uint8_t key_entry_max_height,
                                                uint32_t ts_cnt) {
-    return height * 8 + ENTRY_NODE_SIZE + key_size +
-           (KEY_ENTRY_PTR_SIZE + KEY_ENTRY_BYTE_SIZE + key_entry_max_height * 8 + DATA_NODE_SIZE) * ts_cnt;
+    return GetRecordPkNodeSize(height, key_size) +
+           (KEY_ENTRY_PTR_SIZE + GetRecordKeyEntrySize(key_entry_max_height, 1)) * ts_cnt;
 }
 
-static inline uint32_t GetRecordTsIdxSize(uint8_t height) { return height * 8 + DATA_NODE_SIZE; }
+static inline uint32_t GetRecordTsIdxSize(uint8_t height) { return (height - 1) * 8 + DATA_NODE_SIZE; }
 
 }  // namespace storage
 }  // namespace openmldb
@@ -18,6 +18,10 @@
 
 #include <gflags/gflags.h>
 
+#include <algorithm>
+#include <memory>
+#include <utility>
+
 #include "base/glog_wapper.h"
 #include "base/strings.h"
 #include "common/timer.h"
@@ -26,50 +30,173 @@
 DECLARE_int32(gc_safe_offset);
 DECLARE_uint32(skiplist_max_height);
 DECLARE_uint32(gc_deleted_pk_version_delta);
+DECLARE_bool(enable_concurrent_put);
+DECLARE_uint32(gc_expire_bucket_span);
+DECLARE_uint32(pk_bloom_filter_bits_per_key);
+DECLARE_bool(enable_pk_hash_index);
+DECLARE_uint32(key_entry_grow_cnt);
+DECLARE_uint32(latest_ttl_trim_slack);
+DECLARE_bool(enable_epoch_reclaim);
 
 namespace openmldb {
 namespace storage {
 
 static const SliceComparator scmp;
+// the capacity of the pk filter of an empty segment
+static const uint64_t kMinPkFilterCapacity = 1024;
 Segment::Segment()
     : entries_(NULL),
       mu_(),
+      concurrent_put_(FLAGS_enable_concurrent_put),
       idx_cnt_(0),
       idx_byte_size_(0),
+      pk_node_byte_size_(0),
+      key_entry_byte_size_(0),
       pk_cnt_(0),
+      key_entry_grow_cnt_(FLAGS_key_entry_grow_cnt),
+      key_entry_init_height_(0),
       ts_cnt_(1),
       gc_version_(0),
-      ttl_offset_(FLAGS_gc_safe_offset * 60 * 1000) {
+      ttl_offset_(FLAGS_gc_safe_offset * 60 * 1000),
+      cold_dict_(NULL),
+      gc_key_budget_(0),
+      gc_key_visited_(0),
+      gc_paused_(false),
+      gc_cursor_(),
+      gc_sweep_start_time_(0),
+      upgrade_version_(0),
+      upgrade_sweeping_(false),
+      upgrade_dirty_(true),
+      upgrade_cursor_(),
+      expire_mu_(),
+      expire_bucket_size_(static_cast<uint64_t>(FLAGS_gc_expire_bucket_span) * 60 * 1000),
+      expire_index_dirty_(false),
+      expire_index_(),
+      hot_key_mu_(),
+      hot_keys_(),
+      pk_filter_bits_per_key_(FLAGS_pk_bloom_filter_bits_per_key),
+      pk_filter_(nullptr),
+      retired_pk_filter_(),
+      pk_lookup_cnt_(0),
+      pk_filtered_cnt_(0),
+      pk_index_(),
+      latest_trim_slack_(FLAGS_latest_ttl_trim_slack),
+      latest_keep_cnt_(0),
+      epoch_(FLAGS_enable_epoch_reclaim ? ::openmldb::base::EpochManager::Default() : NULL) {
+    if (pk_filter_bits_per_key_ > 0) {
+        pk_filter_.store(new ::openmldb::base::BlockedBloomFilter(kMinPkFilterCapacity, pk_filter_bits_per_key_),
+                         std::memory_order_relaxed);
+    }
+    if (FLAGS_enable_pk_hash_index) {
+        pk_index_.reset(new PkHashIndex(epoch_ != NULL ? epoch_->GetEpochPtr() : &gc_version_));
+    }
     entries_ = new KeyEntries((uint8_t)FLAGS_skiplist_max_height, 4, scmp);
     key_entry_max_height_ = (uint8_t)FLAGS_skiplist_max_height;
+    key_entry_init_height_ = key_entry_grow_cnt_ > 0 ? 1 : key_entry_max_height_;
     entry_free_list_ = new KeyEntryNodeList(4, 4, tcmp);
 }
 
 Segment::Segment(uint8_t height)
     : entries_(NULL),
       mu_(),
+      concurrent_put_(FLAGS_enable_concurrent_put),
       idx_cnt_(0),
       idx_byte_size_(0),
+      pk_node_byte_size_(0),
+      key_entry_byte_size_(0),
       pk_cnt_(0),
       key_entry_max_height_(height),
+      key_entry_grow_cnt_(FLAGS_key_entry_grow_cnt),
+      key_entry_init_height_(0),
       ts_cnt_(1),
       gc_version_(0),
-      ttl_offset_(FLAGS_gc_safe_offset * 60 * 1000) {
+      ttl_offset_(FLAGS_gc_safe_offset * 60 * 1000),
+      cold_dict_(NULL),
+      gc_key_budget_(0),
+      gc_key_visited_(0),
+      gc_paused_(false),
+      gc_cursor_(),
+      gc_sweep_start_time_(0),
+      upgrade_version_(0),
+      upgrade_sweeping_(false),
+      upgrade_dirty_(true),
+      upgrade_cursor_(),
+      expire_mu_(),
+      expire_bucket_size_(static_cast<uint64_t>(FLAGS_gc_expire_bucket_span) * 60 * 1000),
+      expire_index_dirty_(false),
+      expire_index_(),
+      hot_key_mu_(),
+      hot_keys_(),
+      pk_filter_bits_per_key_(FLAGS_pk_bloom_filter_bits_per_key),
+      pk_filter_(nullptr),
+      retired_pk_filter_(),
+      pk_lookup_cnt_(0),
+      pk_filtered_cnt_(0),
+      pk_index_(),
+      latest_trim_slack_(FLAGS_latest_ttl_trim_slack),
+      latest_keep_cnt_(0),
+      epoch_(FLAGS_enable_epoch_reclaim ? ::openmldb::base::EpochManager::Default() : NULL) {
+    if (pk_filter_bits_per_key_ > 0) {
+        pk_filter_.store(new ::openmldb::base::BlockedBloomFilter(kMinPkFilterCapacity, pk_filter_bits_per_key_),
+                         std::memory_order_relaxed);
+    }
+    if (FLAGS_enable_pk_hash_index) {
+        pk_index_.reset(new PkHashIndex(epoch_ != NULL ? epoch_->GetEpochPtr() : &gc_version_));
+    }
     entries_ = new KeyEntries((uint8_t)FLAGS_skiplist_max_height, 4, scmp);
+    key_entry_init_height_ = key_entry_grow_cnt_ > 0 ? 1 : key_entry_max_height_;
     entry_free_list_ = new KeyEntryNodeList(4, 4, tcmp);
 }
 
 Segment::Segment(uint8_t height, const std::vector<uint32_t>& ts_idx_vec)
     : entries_(NULL),
       mu_(),
+      concurrent_put_(FLAGS_enable_concurrent_put),
       idx_cnt_(0),
       idx_byte_size_(0),
+      pk_node_byte_size_(0),
+      key_entry_byte_size_(0),
       pk_cnt_(0),
       key_entry_max_height_(height),
+      key_entry_grow_cnt_(FLAGS_key_entry_grow_cnt),
+      key_entry_init_height_(0),
       ts_cnt_(ts_idx_vec.size()),
       gc_version_(0),
-      ttl_offset_(FLAGS_gc_safe_offset * 60 * 1000) {
+      ttl_offset_(FLAGS_gc_safe_offset * 60 * 1000),
+      cold_dict_(NULL),
+      gc_key_budget_(0),
+      gc_key_visited_(0),
+      gc_paused_(false),
+      gc_cursor_(),
+      gc_sweep_start_time_(0),
+      upgrade_version_(0),
+      upgrade_sweeping_(false),
+      upgrade_dirty_(true),
+      upgrade_cursor_(),
+      expire_mu_(),
+      expire_bucket_size_(ts_idx_vec.size() > 1 ? 0 : static_cast<uint64_t>(FLAGS_gc_expire_bucket_span) * 60 * 1000),
+      expire_index_dirty_(false),
+      expire_index_(),
+      hot_key_mu_(),
+      hot_keys_(),
+      pk_filter_bits_per_key_(FLAGS_pk_bloom_filter_bits_per_key),
+      pk_filter_(nullptr),
+      retired_pk_filter_(),
+      pk_lookup_cnt_(0),
+      pk_filtered_cnt_(0),
+      pk_index_(),
+      latest_trim_slack_(FLAGS_latest_ttl_trim_slack),
+      latest_keep_cnt_(0),
+      epoch_(FLAGS_enable_epoch_reclaim ? ::openmldb::base::EpochManager::Default() : NULL) {
+    if (pk_filter_bits_per_key_ > 0) {
+        pk_filter_.store(new ::openmldb::base::BlockedBloomFilter(kMinPkFilterCapacity, pk_filter_bits_per_key_),
+                         std::memory_order_relaxed);
+    }
+    if (FLAGS_enable_pk_hash_index) {
+        pk_index_.reset(new PkHashIndex(epoch_ != NULL ? epoch_->GetEpochPtr() : &gc_version_));
+    }
     entries_ = new KeyEntries((uint8_t)FLAGS_skiplist_max_height, 4, scmp);
+    key_entry_init_height_ = key_entry_grow_cnt_ > 0 ? 1 : key_entry_max_height_;
     entry_free_list_ = new KeyEntryNodeList(4, 4, tcmp);
     for (uint32_t i = 0; i < ts_idx_vec.size(); i++) {
         ts_idx_map_[ts_idx_vec[i]] = i;
@@ -78,8 +205,20 @@ Segment::Segment(uint8_t height, const std::vector<uint32_t>& ts_idx_vec)
 }
 
 Segment::~Segment() {
+    FreeDemotedList(UINT64_MAX);
+    FreeRetiredHeads(UINT64_MAX);
+    uint64_t gc_idx_cnt = 0;
+    uint64_t gc_record_cnt = 0;
+    uint64_t gc_record_byte_size = 0;
+    FreeTrimmedList(gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
+    FreeRetiredList(UINT64_MAX, gc_record_cnt, gc_record_byte_size);
+    FreeUpgradedList(UINT64_MAX, gc_record_cnt, gc_record_byte_size);
+    delete pk_filter_.load(std::memory_order_relaxed);
     delete entries_;
     delete entry_free_list_;
+    if (cold_dict_ != NULL) {
+        cold_dict_->UnRef();
+    }
 }
 
 uint64_t Segment::Release() {
@@ -106,6 +245,9 @@ uint64_t Segment::Release() {
     }
     entries_->Clear();
     delete it;
+    if (pk_index_) {
+        pk_index_->Clear();
+    }
 
     KeyEntryNodeList::Iterator* f_it = entry_free_list_->NewIterator();
     f_it->SeekToFirst();
@@ -129,6 +271,20 @@ uint64_t Segment::Release() {
     }
     delete f_it;
     entry_free_list_->Clear();
+    FreeDemotedList(UINT64_MAX);
+    FreeRetiredHeads(UINT64_MAX);
+    {
+        uint64_t gc_idx_cnt = 0;
+        uint64_t gc_record_cnt = 0;
+        uint64_t gc_record_byte_size = 0;
+        FreeTrimmedList(gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
+        FreeRetiredList(UINT64_MAX, gc_record_cnt, gc_record_byte_size);
+        FreeUpgradedList(UINT64_MAX, gc_record_cnt, gc_record_byte_size);
+    }
+    {
+        std::lock_guard<std::mutex> lock(expire_mu_);
+        expire_index_.clear();
+    }
     idx_cnt_vec_.clear();
     return cnt;
 }
@@ -140,8 +296,8 @@ void Segment::ReleaseAndCount(uint64_t& gc_idx_cnt, uint64_t& gc_record_cnt, uin
         Slice key = it->GetKey();
         ::openmldb::base::Node<Slice, void*>* entry_node = NULL;
         {
-            std::lock_guard<std::mutex> lock(mu_);
-            entry_node = entries_->Remove(key);
+            std::lock_guard<std::shared_mutex> lock(mu_);
+            entry_node = RemoveEntry(key);
         }
         if (entry_node != NULL) {
             FreeEntry(entry_node, gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
@@ -150,8 +306,10 @@ void Segment::ReleaseAndCount(uint64_t& gc_idx_cnt, uint64_t& gc_record_cnt, uin
         pk_cnt_.fetch_sub(1, std::memory_order_relaxed);
     }
     delete it;
-    uint64_t cur_version = gc_version_.load(std::memory_order_relaxed);
+    uint64_t cur_version = GetRetireVersion();
     GcEntryFreeList(cur_version, gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
+    FreeRetiredList(UINT64_MAX, gc_record_cnt, gc_record_byte_size);
+    FreeUpgradedList(UINT64_MAX, gc_record_cnt, gc_record_byte_size);
     Release();
 }
 
@@ -167,60 +325,250 @@ void Segment::Put(const Slice& key, uint64_t time, DataBlock* row) {
     if (ts_cnt_ > 1) {
         return;
     }
-    std::lock_guard<std::mutex> lock(mu_);
+    if (concurrent_put_) {
+        bool need_update = false;
+        {
+            std::shared_lock<std::shared_mutex> lock(mu_);
+            need_update = PutConcurrently(key, time, row);
+        }
+        if (need_update) {
+            UpdateKeyEntry(key);
+        }
+        return;
+    }
+    std::lock_guard<std::shared_mutex> lock(mu_);
     PutUnlock(key, time, row);
 }
 
-void Segment::PutUnlock(const Slice& key, uint64_t time, DataBlock* row) {
+bool Segment::PutConcurrently(const Slice& key, uint64_t time, DataBlock* row) {
+    void* entry = FindEntry(key);
+    uint32_t byte_size = 0;
+    if (entry == NULL) {
+        entry = GetOrInsertEntryConcurrently(key, &byte_size);
+    }
+    idx_cnt_.fetch_add(1, std::memory_order_relaxed);
+    uint8_t height = ((KeyEntry*)entry)->entries.InsertConcurrently(time, row);  // NOLINT
+    uint64_t cnt = ((KeyEntry*)entry)->count_.fetch_add(1, std::memory_order_relaxed) + 1;  // NOLINT
+    byte_size += GetRecordTsIdxSize(height);
+    idx_byte_size_.fetch_add(byte_size, std::memory_order_relaxed);
+    IndexExpire(key, time);
+    if (cnt % kHotKeyRecordStep == 0) {
+        RecordHotKey(key, cnt);
+    }
+    return NeedGrow((KeyEntry*)entry, cnt) || NeedTrim(cnt);  // NOLINT
+}
+
+void* Segment::GetOrInsertEntryConcurrently(const Slice& key, uint32_t* byte_size) {
+    char* pk = new char[key.size()];
+    memcpy(pk, key.data(), key.size());
+    Slice skey(pk, key.size());
     void* entry = nullptr;
+    if (ts_cnt_ > 1) {
+        auto** entry_arr_tmp = new KeyEntry*[ts_cnt_];
+        for (uint32_t i = 0; i < ts_cnt_; i++) {
+            entry_arr_tmp[i] = NewKeyEntry();
+        }
+        entry = (void*)entry_arr_tmp;  // NOLINT
+    } else {
+        entry = (void*)NewKeyEntry();  // NOLINT
+    }
+    void* new_entry = entry;
+    uint8_t height = 0;
+    AddToPkFilter(skey);
+    if (!entries_->InsertIfAbsentConcurrently(skey, entry, &height)) {
+        // other writer has inserted the same pk
+        FreeUnusedEntry(skey, new_entry);
+        return entry;
+    }
+    if (pk_index_) {
+        pk_index_->Insert(entries_->GetNode(skey));
+    }
+    if (ts_cnt_ > 1) {
+        *byte_size += AddPkByteSize(height, key.size());
+    } else {
+        *byte_size += AddPkByteSize(height, key.size());
+    }
+    pk_cnt_.fetch_add(1, std::memory_order_relaxed);
+    return entry;
+}
+
+void Segment::FreeUnusedEntry(const Slice& key, void* entry) {
+    delete[] key.data();
+    if (ts_cnt_ > 1) {
+        KeyEntry** entry_arr = (KeyEntry**)entry;  // NOLINT
+        for (uint32_t i = 0; i < ts_cnt_; i++) {
+            delete entry_arr[i];
+        }
+        delete[] entry_arr;
+    } else {
+        delete (KeyEntry*)entry;  // NOLINT
+    }
+}
+
+uint32_t Segment::AddPkByteSize(uint8_t height, uint32_t key_size) {
+    uint32_t node_size = GetRecordPkNodeSize(height, key_size);
+    uint32_t entry_size = GetRecordKeyEntrySize(key_entry_init_height_, ts_cnt_);
+    pk_node_byte_size_.fetch_add(node_size, std::memory_order_relaxed);
+    key_entry_byte_size_.fetch_add(entry_size, std::memory_order_relaxed);
+    return node_size + entry_size;
+}
+
+uint32_t Segment::SubPkByteSize(uint8_t height, uint32_t key_size) {
+    uint32_t node_size = GetRecordPkNodeSize(height, key_size);
+    uint32_t entry_size = GetRecordKeyEntrySize(key_entry_init_height_, ts_cnt_);
+    pk_node_byte_size_.fetch_sub(node_size, std::memory_order_relaxed);
+    key_entry_byte_size_.fetch_sub(entry_size, std::memory_order_relaxed);
+    return node_size + entry_size;
+}
+
+void Segment::GetMemStat(SegmentMemStat* stat) {
+    uint64_t idx_byte_size = idx_byte_size_.load(std::memory_order_relaxed);
+    uint64_t pk_node_byte_size = pk_node_byte_size_.load(std::memory_order_relaxed);
+    uint64_t key_entry_byte_size = key_entry_byte_size_.load(std::memory_order_relaxed);
+    stat->pk_node_byte_size += pk_node_byte_size;
+    stat->key_entry_byte_size += key_entry_byte_size;
+    // the time entries are the rest of the index, which saves a counter on the put
+    if (idx_byte_size > pk_node_byte_size + key_entry_byte_size) {
+        stat->ts_node_byte_size += idx_byte_size - pk_node_byte_size - key_entry_byte_size;
+    }
+    if (pk_index_) {
+        stat->pk_index_byte_size += pk_index_->GetByteSize();
+    }
+    ::openmldb::base::BlockedBloomFilter* filter = pk_filter_.load(std::memory_order_acquire);
+    if (filter != nullptr) {
+        stat->pk_filter_byte_size += filter->GetByteSize();
+    }
+}
+
+void Segment::PutUnlock(const Slice& key, uint64_t time, DataBlock* row) {
+    void* entry = FindEntry(key);
     uint32_t byte_size = 0;
-    int ret = entries_->Get(key, entry);
-    if (ret < 0 || entry == NULL) {
+    if (entry == NULL) {
         char* pk = new char[key.size()];
         memcpy(pk, key.data(), key.size());
         // need to delete memory when free node
         Slice skey(pk, key.size());
-        entry = (void*)new KeyEntry(key_entry_max_height_);  // NOLINT
-        uint8_t height = entries_->Insert(skey, entry);
-        byte_size += GetRecordPkIdxSize(height, key.size(), key_entry_max_height_);
+        entry = (void*)NewKeyEntry();  // NOLINT
+        uint8_t height = InsertEntry(skey, entry);
+        byte_size += AddPkByteSize(height, key.size());
         pk_cnt_.fetch_add(1, std::memory_order_relaxed);
     }
     idx_cnt_.fetch_add(1, std::memory_order_relaxed);
-    uint8_t height = ((KeyEntry*)entry)->entries.Insert(time, row);  // NOLINT
-    ((KeyEntry*)entry)                                               // NOLINT
-        ->count_.fetch_add(1, std::memory_order_relaxed);
+    uint8_t height = ((KeyEntry*)entry)->entries.Insert(time, row);                         // NOLINT
+    uint64_t cnt = ((KeyEntry*)entry)->count_.fetch_add(1, std::memory_order_relaxed) + 1;  // NOLINT
     byte_size += GetRecordTsIdxSize(height);
     idx_byte_size_.fetch_add(byte_size, std::memory_order_relaxed);
+    if (NeedGrow((KeyEntry*)entry, cnt)) {  // NOLINT
+        GrowKeyEntry((KeyEntry*)entry);     // NOLINT
+    }
+    if (NeedTrim(cnt)) {
+        TrimKeyEntry((KeyEntry*)entry);  // NOLINT
+    }
+    IndexExpire(key, time);
+    if (cnt % kHotKeyRecordStep == 0) {
+        RecordHotKey(key, cnt);
+    }
 }
 
 void Segment::BulkLoadPut(unsigned int key_entry_id, const Slice& key, uint64_t time, DataBlock* row) {
     void* key_entry_or_list = nullptr;
     uint32_t byte_size = 0;
-    std::lock_guard<std::mutex> lock(mu_);  // TODO(hw): need lock?
-    int ret = entries_->Get(key, key_entry_or_list);
+    std::lock_guard<std::shared_mutex> lock(mu_);  // TODO(hw): need lock?
     if (ts_cnt_ == 1) {
         PutUnlock(key, time, row);
     } else {
-        if (ret < 0 || key_entry_or_list == nullptr) {
+        key_entry_or_list = FindEntry(key);
+        if (key_entry_or_list == nullptr) {
             char* pk = new char[key.size()];
             memcpy(pk, key.data(), key.size());
             Slice skey(pk, key.size());
             auto** entry_arr_tmp = new KeyEntry*[ts_cnt_];
             for (uint32_t i = 0; i < ts_cnt_; i++) {
-                entry_arr_tmp[i] = new KeyEntry(key_entry_max_height_);
+                entry_arr_tmp[i] = NewKeyEntry();
             }
-            auto entry_arr = (void*)entry_arr_tmp;  // NOLINT
-            uint8_t height = entries_->Insert(skey, entry_arr);
-            byte_size += GetRecordPkMultiIdxSize(height, key.size(), key_entry_max_height_, ts_cnt_);
+            key_entry_or_list = (void*)entry_arr_tmp;  // NOLINT
+            uint8_t height = InsertEntry(skey, key_entry_or_list);
+            byte_size += AddPkByteSize(height, key.size());
             pk_cnt_.fetch_add(1, std::memory_order_relaxed);
         }
-        uint8_t height = ((KeyEntry**)key_entry_or_list)[key_entry_id]->entries.Insert(  // NOLINT
-            time, row);
-        ((KeyEntry**)key_entry_or_list)[key_entry_id]->count_.fetch_add(  // NOLINT
-            1, std::memory_order_relaxed);
+        KeyEntry* entry = ((KeyEntry**)key_entry_or_list)[key_entry_id];  // NOLINT
+        uint8_t height = entry->entries.Insert(time, row);
+        uint64_t cnt = entry->count_.fetch_add(1, std::memory_order_relaxed) + 1;
         byte_size += GetRecordTsIdxSize(height);
         idx_byte_size_.fetch_add(byte_size, std::memory_order_relaxed);
         idx_cnt_vec_[key_entry_id]->fetch_add(1, std::memory_order_relaxed);
+        if (NeedGrow(entry, cnt)) {
+            GrowKeyEntry(entry);
+        }
+    }
+}
+
+void Segment::BulkLoad(unsigned int key_entry_id, const Slice& key,
+                       std::vector<std::pair<uint64_t, DataBlock*>>* rows) {
+    if (rows->empty() || key_entry_id >= ts_cnt_) {
+        return;
+    }
+    // the time entries are in the descending order of the time
+    std::stable_sort(rows->begin(), rows->end(),
+                     [](const std::pair<uint64_t, DataBlock*>& a, const std::pair<uint64_t, DataBlock*>& b) {
+                         return a.first > b.first;
+                     });
+    // the list of a key with many rows is built as a skiplist at once
+    auto* entry = rows->size() > key_entry_grow_cnt_ ? new KeyEntry(key_entry_max_height_) : NewKeyEntry();
+    std::vector<uint8_t> heights;
+    heights.reserve(rows->size());
+    entry->entries.BuildSorted(*rows, &heights);
+    entry->count_.store(rows->size(), std::memory_order_relaxed);
+    uint64_t byte_size = 0;
+    std::lock_guard<std::shared_mutex> lock(mu_);
+    void* key_entry_or_list = FindEntry(key);
+    if (key_entry_or_list == nullptr) {
+        char* pk = new char[key.size()];
+        memcpy(pk, key.data(), key.size());
+        Slice skey(pk, key.size());
+        if (ts_cnt_ == 1) {
+            key_entry_or_list = (void*)entry;  // NOLINT
+            uint8_t height = InsertEntry(skey, key_entry_or_list);
+            byte_size += AddPkByteSize(height, key.size());
+        } else {
+            auto** entry_arr = new KeyEntry*[ts_cnt_];
+            for (uint32_t i = 0; i < ts_cnt_; i++) {
+                entry_arr[i] = i == key_entry_id ? entry : NewKeyEntry();
+            }
+            key_entry_or_list = (void*)entry_arr;  // NOLINT
+            uint8_t height = InsertEntry(skey, key_entry_or_list);
+            byte_size += AddPkByteSize(height, key.size());
+        }
+        pk_cnt_.fetch_add(1, std::memory_order_relaxed);
+        key_entry_byte_size_.fetch_add(GetGrownByteSize(entry), std::memory_order_relaxed);
+        byte_size += GetGrownByteSize(entry);
+        for (uint8_t height : heights) {
+            byte_size += GetRecordTsIdxSize(height);
+        }
+    } else {
+        // the nodes of the list are freed without the rows
+        entry->entries.Clear();
+        delete entry;
+        KeyEntry* cur_entry = ts_cnt_ == 1 ? (KeyEntry*)key_entry_or_list                   // NOLINT
+                                           : ((KeyEntry**)key_entry_or_list)[key_entry_id];  // NOLINT
+        if (NeedGrow(cur_entry, cur_entry->GetCount() + rows->size())) {
+            GrowKeyEntry(cur_entry);
+        }
+        for (auto& row : *rows) {
+            uint8_t height = cur_entry->entries.Insert(row.first, row.second);
+            byte_size += GetRecordTsIdxSize(height);
+        }
+        cur_entry->count_.fetch_add(rows->size(), std::memory_order_relaxed);
+    }
+    idx_byte_size_.fetch_add(byte_size, std::memory_order_relaxed);
+    if (ts_cnt_ == 1) {
+        idx_cnt_.fetch_add(rows->size(), std::memory_order_relaxed);
+        KeyEntry* key_entry = (KeyEntry*)key_entry_or_list;  // NOLINT
+        if (NeedTrim(key_entry->GetCount())) {
+            TrimKeyEntry(key_entry);
+        }
+    } else {
+        idx_cnt_vec_[key_entry_id]->fetch_add(rows->size(), std::memory_order_relaxed);
     }
 }
 
@@ -243,8 +591,12 @@ void Segment::Put(const Slice& key, const TSDimensions& ts_dimension, DataBlock*
         }
         return;
     }
+    if (concurrent_put_) {
+        PutConcurrently(key, ts_dimension, row);
+        return;
+    }
     void* entry_arr = NULL;
-    std::lock_guard<std::mutex> lock(mu_);
+    std::lock_guard<std::shared_mutex> lock(mu_);
     for (const auto& cur_ts : ts_dimension) {
         uint32_t byte_size = 0;
         auto pos = ts_idx_map_.find(cur_ts.idx());
@@ -252,37 +604,162 @@ void Segment::Put(const Slice& key, const TSDimensions& ts_dimension, DataBlock*
             continue;
         }
         if (entry_arr == NULL) {
-            int ret = entries_->Get(key, entry_arr);
-            if (ret < 0 || entry_arr == NULL) {
+            entry_arr = FindEntry(key);
+            if (entry_arr == NULL) {
                 char* pk = new char[key.size()];
                 memcpy(pk, key.data(), key.size());
                 Slice skey(pk, key.size());
                 KeyEntry** entry_arr_tmp = new KeyEntry*[ts_cnt_];
                 for (uint32_t i = 0; i < ts_cnt_; i++) {
-                    entry_arr_tmp[i] = new KeyEntry(key_entry_max_height_);
+                    entry_arr_tmp[i] = NewKeyEntry();
                 }
                 entry_arr = (void*)entry_arr_tmp;  // NOLINT
-                uint8_t height = entries_->Insert(skey, entry_arr);
-                byte_size += GetRecordPkMultiIdxSize(height, key.size(), key_entry_max_height_, ts_cnt_);
+                uint8_t height = InsertEntry(skey, entry_arr);
+                byte_size += AddPkByteSize(height, key.size());
                 pk_cnt_.fetch_add(1, std::memory_order_relaxed);
             }
         }
-        uint8_t height = ((KeyEntry**)entry_arr)[pos->second]->entries.Insert(  // NOLINT
-            cur_ts.ts(), row);
-        ((KeyEntry**)entry_arr)[pos->second]->count_.fetch_add(  // NOLINT
-            1, std::memory_order_relaxed);
+        KeyEntry* entry = ((KeyEntry**)entry_arr)[pos->second];  // NOLINT
+        uint8_t height = entry->entries.Insert(cur_ts.ts(), row);
+        uint64_t cnt = entry->count_.fetch_add(1, std::memory_order_relaxed) + 1;
+        byte_size += GetRecordTsIdxSize(height);
+        idx_byte_size_.fetch_add(byte_size, std::memory_order_relaxed);
+        idx_cnt_vec_[pos->second]->fetch_add(1, std::memory_order_relaxed);
+        if (cnt % kHotKeyRecordStep == 0) {
+            RecordHotKey(key, cnt);
+        }
+        if (NeedGrow(entry, cnt)) {
+            GrowKeyEntry(entry);
+        }
+    }
+}
+
+void Segment::PutConcurrently(const Slice& key, const TSDimensions& ts_dimension, DataBlock* row) {
+    void* entry_arr = NULL;
+    bool need_grow = false;
+    std::shared_lock<std::shared_mutex> lock(mu_);
+    for (const auto& cur_ts : ts_dimension) {
+        uint32_t byte_size = 0;
+        auto pos = ts_idx_map_.find(cur_ts.idx());
+        if (pos == ts_idx_map_.end()) {
+            continue;
+        }
+        if (entry_arr == NULL) {
+            entry_arr = FindEntry(key);
+            if (entry_arr == NULL) {
+                entry_arr = GetOrInsertEntryConcurrently(key, &byte_size);
+            }
+        }
+        KeyEntry* entry = ((KeyEntry**)entry_arr)[pos->second];  // NOLINT
+        uint8_t height = entry->entries.InsertConcurrently(cur_ts.ts(), row);
+        uint64_t cnt = entry->count_.fetch_add(1, std::memory_order_relaxed) + 1;
         byte_size += GetRecordTsIdxSize(height);
         idx_byte_size_.fetch_add(byte_size, std::memory_order_relaxed);
         idx_cnt_vec_[pos->second]->fetch_add(1, std::memory_order_relaxed);
+        if (cnt % kHotKeyRecordStep == 0) {
+            RecordHotKey(key, cnt);
+        }
+        need_grow = need_grow || NeedGrow(entry, cnt);
+    }
+    lock.unlock();
+    if (need_grow) {
+        UpdateKeyEntry(key);
+    }
+}
+
+void Segment::GrowKeyEntry(KeyEntry* entry) {
+    ::openmldb::base::Node<uint64_t, DataBlock*>* head = entry->entries.Grow();
+    if (head == NULL) {
+        return;
+    }
+    idx_byte_size_.fetch_add(GetGrownByteSize(entry), std::memory_order_relaxed);
+    key_entry_byte_size_.fetch_add(GetGrownByteSize(entry), std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(gc_mu_);
+    retired_head_list_.emplace_back(GetRetireVersion(), head);
+}
+
+void Segment::UpdateKeyEntry(const Slice& key) {
+    std::lock_guard<std::shared_mutex> lock(mu_);
+    void* entry = FindEntry(key);
+    if (entry == NULL) {
+        return;
+    }
+    if (ts_cnt_ > 1) {
+        KeyEntry** entry_arr = (KeyEntry**)entry;  // NOLINT
+        for (uint32_t i = 0; i < ts_cnt_; i++) {
+            if (NeedGrow(entry_arr[i], entry_arr[i]->GetCount())) {
+                GrowKeyEntry(entry_arr[i]);
+            }
+        }
+        return;
+    }
+    KeyEntry* key_entry = (KeyEntry*)entry;  // NOLINT
+    if (NeedGrow(key_entry, key_entry->GetCount())) {
+        GrowKeyEntry(key_entry);
+    }
+    if (NeedTrim(key_entry->GetCount())) {
+        TrimKeyEntry(key_entry);
+    }
+}
+
+void Segment::TrimKeyEntry(KeyEntry* entry) {
+    uint64_t keep_cnt = latest_keep_cnt_.load(std::memory_order_relaxed);
+    // the entry occupied by the readers is trimmed by the next put of it
+    if (keep_cnt == 0 || entry->refs_.load(std::memory_order_acquire) > 0) {
+        return;
+    }
+    ::openmldb::base::Node<uint64_t, DataBlock*>* node = entry->entries.SplitByPos(keep_cnt);
+    if (node == NULL) {
+        return;
+    }
+    uint64_t cnt = 0;
+    for (auto* cur = node; cur != NULL; cur = cur->GetNextNoBarrier(0)) {
+        cnt++;
+    }
+    entry->count_.fetch_sub(cnt, std::memory_order_relaxed);
+    idx_cnt_.fetch_sub(cnt, std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(gc_mu_);
+    if (epoch_ != NULL) {
+        retired_list_.emplace_back(epoch_->GetEpoch(), node);
+    } else {
+        trimmed_list_.push_back(node);
+    }
+}
+
+void Segment::FreeTrimmedList(uint64_t& gc_idx_cnt, uint64_t& gc_record_cnt, uint64_t& gc_record_byte_size) {
+    std::vector<::openmldb::base::Node<uint64_t, DataBlock*>*> lists;
+    {
+        std::lock_guard<std::mutex> lock(gc_mu_);
+        lists.swap(trimmed_list_);
+    }
+    for (auto node : lists) {
+        FreeList(node, gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
+    }
+}
+
+void Segment::FreeRetiredHeads(uint64_t version) {
+    std::vector<::openmldb::base::Node<uint64_t, DataBlock*>*> heads;
+    {
+        std::lock_guard<std::mutex> lock(gc_mu_);
+        auto iter = retired_head_list_.begin();
+        while (iter != retired_head_list_.end() && iter->first <= version) {
+            heads.push_back(iter->second);
+            iter++;
+        }
+        retired_head_list_.erase(retired_head_list_.begin(), iter);
+    }
+    for (auto head : heads) {
+        delete head;
     }
 }
 
 bool Segment::Get(const Slice& key, const uint64_t time, DataBlock** block) {
+    ::openmldb::base::EpochGuard guard(epoch_);
     if (block == NULL || ts_cnt_ > 1) {
         return false;
     }
-    void* entry = NULL;
-    if (entries_->Get(key, entry) < 0 || entry == NULL) {
+    void* entry = MayContainPk(key) ? FindEntry(key) : NULL;
+    if (entry == NULL) {
         return false;
     }
     *block = ((KeyEntry*)entry)->entries.Get(time);  // NOLINT
@@ -290,6 +767,7 @@ bool Segment::Get(const Slice& key, const uint64_t time, DataBlock** block) {
 }
 
 bool Segment::Get(const Slice& key, uint32_t idx, const uint64_t time, DataBlock** block) {
+    ::openmldb::base::EpochGuard guard(epoch_);
     if (block == NULL) {
         return false;
     }
@@ -300,8 +778,8 @@ bool Segment::Get(const Slice& key, uint32_t idx, const uint64_t time, DataBlock
     if (ts_cnt_ == 1) {
         return Get(key, time, block);
     }
-    void* entry = NULL;
-    if (entries_->Get(key, entry) < 0 || entry == NULL) {
+    void* entry = MayContainPk(key) ? FindEntry(key) : NULL;
+    if (entry == NULL) {
         return false;
     }
     *block = ((KeyEntry**)entry)[pos->second]->entries.Get(time);  // NOLINT
@@ -311,19 +789,126 @@ bool Segment::Get(const Slice& key, uint32_t idx, const uint64_t time, DataBlock
 bool Segment::Delete(const Slice& key) {
     ::openmldb::base::Node<Slice, void*>* entry_node = NULL;
     {
-        std::lock_guard<std::mutex> lock(mu_);
-        entry_node = entries_->Remove(key);
+        std::lock_guard<std::shared_mutex> lock(mu_);
+        entry_node = RemoveEntry(key);
         if (entry_node == NULL) {
             return false;
         }
     }
     {
         std::lock_guard<std::mutex> lock(gc_mu_);
-        entry_free_list_->Insert(gc_version_.load(std::memory_order_relaxed), entry_node);
+        entry_free_list_->Insert(GetRetireVersion(), entry_node);
+    }
+    return true;
+}
+
+bool Segment::Delete(const Slice& key, uint32_t idx, uint64_t start_ts, uint64_t end_ts) {
+    uint32_t pos = 0;
+    if (ts_cnt_ > 1) {
+        auto iter = ts_idx_map_.find(idx);
+        if (iter == ts_idx_map_.end()) {
+            return false;
+        }
+        pos = iter->second;
+    }
+    std::lock_guard<std::shared_mutex> lock(mu_);
+    void* entry_or_arr = FindEntry(key);
+    if (entry_or_arr == NULL) {
+        return false;
     }
+    DeleteRange(key, entry_or_arr, pos, start_ts, end_ts);
     return true;
 }
 
+uint64_t Segment::Delete(uint32_t idx, uint64_t start_ts, uint64_t end_ts) {
+    uint32_t pos = 0;
+    if (ts_cnt_ > 1) {
+        auto iter = ts_idx_map_.find(idx);
+        if (iter == ts_idx_map_.end()) {
+            return 0;
+        }
+        pos = iter->second;
+    }
+    uint64_t cnt = 0;
+    std::lock_guard<std::shared_mutex> lock(mu_);
+    std::unique_ptr<KeyEntries::Iterator> it(entries_->NewIterator());
+    it->SeekToFirst();
+    while (it->Valid()) {
+        Slice key = it->GetKey();
+        void* entry_or_arr = it->GetValue();
+        // the key may be removed as its rows are all deleted
+        it->Next();
+        cnt += DeleteRange(key, entry_or_arr, pos, start_ts, end_ts);
+    }
+    return cnt;
+}
+
+uint64_t Segment::DeleteRange(const Slice& key, void* entry_or_arr, uint32_t pos, uint64_t start_ts,
+                              uint64_t end_ts) {
+    KeyEntry* entry = ts_cnt_ > 1 ? ((KeyEntry**)entry_or_arr)[pos] : (KeyEntry*)entry_or_arr;  // NOLINT
+    ::openmldb::base::Node<uint64_t, DataBlock*>* node = entry->entries.SplitRange(start_ts, end_ts);
+    if (node == NULL) {
+        return 0;
+    }
+    uint64_t cnt = 0;
+    for (auto* cur = node; cur != NULL; cur = cur->GetNextNoBarrier(0)) {
+        cnt++;
+    }
+    entry->count_.fetch_sub(cnt, std::memory_order_relaxed);
+    if (ts_cnt_ > 1) {
+        idx_cnt_vec_[pos]->fetch_sub(cnt, std::memory_order_relaxed);
+    } else {
+        idx_cnt_.fetch_sub(cnt, std::memory_order_relaxed);
+    }
+    bool is_empty = true;
+    for (uint32_t i = 0; i < ts_cnt_ && is_empty; i++) {
+        KeyEntry* cur = ts_cnt_ > 1 ? ((KeyEntry**)entry_or_arr)[i] : entry;  // NOLINT
+        is_empty = cur->entries.IsEmpty();
+    }
+    ::openmldb::base::Node<Slice, void*>* entry_node = is_empty ? RemoveEntry(key) : NULL;
+    // the rows may be shared with the other segments, so they are freed by the gc thread like the retired lists
+    std::lock_guard<std::mutex> lock(gc_mu_);
+    retired_list_.emplace_back(GetRetireVersion(), node);
+    if (entry_node != NULL) {
+        entry_free_list_->Insert(GetRetireVersion(), entry_node);
+    }
+    return cnt;
+}
+
+void Segment::RetireList(::openmldb::base::Node<uint64_t, DataBlock*>* node, uint64_t& gc_idx_cnt,
+                         uint64_t& gc_record_cnt, uint64_t& gc_record_byte_size) {
+    if (epoch_ == NULL) {
+        FreeList(node, gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
+        return;
+    }
+    if (node == NULL) {
+        return;
+    }
+    // the indexes are counted at once as the list is cut off, the rows are counted as they are freed
+    for (auto* cur = node; cur != NULL; cur = cur->GetNextNoBarrier(0)) {
+        gc_idx_cnt++;
+    }
+    std::lock_guard<std::mutex> lock(gc_mu_);
+    retired_list_.emplace_back(epoch_->GetEpoch(), node);
+}
+
+void Segment::FreeRetiredList(uint64_t version, uint64_t& gc_record_cnt, uint64_t& gc_record_byte_size) {
+    std::vector<::openmldb::base::Node<uint64_t, DataBlock*>*> lists;
+    {
+        std::lock_guard<std::mutex> lock(gc_mu_);
+        auto iter = retired_list_.begin();
+        while (iter != retired_list_.end() && iter->first <= version) {
+            lists.push_back(iter->second);
+            iter++;
+        }
+        retired_list_.erase(retired_list_.begin(), iter);
+    }
+    uint64_t gc_idx_cnt = 0;
+    for (auto node : lists) {
+        FreeList(node, gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
+    }
+}
+
 void Segment::FreeList(::openmldb::base::Node<uint64_t, DataBlock*>* node, uint64_t& gc_idx_cnt,
                        uint64_t& gc_record_cnt, uint64_t& gc_record_byte_size) {
     while (node != NULL) {
@@ -337,7 +922,7 @@ void Segment::FreeList(::openmldb::base::Node<uint64_t, DataBlock*>* node, uint6
         } else {
             DEBUGLOG("delele data block for key %lu", tmp->GetKey());
             gc_record_byte_size += GetRecordSize(tmp->GetValue()->size);
-            delete tmp->GetValue();
+            DeleteDataBlock(tmp->GetValue());
             gc_record_cnt++;
         }
         delete tmp;
@@ -353,9 +938,12 @@ void Segment::FreeEntry(::openmldb::base::Node<Slice, void*>* entry_node, uint64
     delete[] entry_node->GetKey().data();
     if (ts_cnt_ > 1) {
         KeyEntry** entry_arr = (KeyEntry**)entry_node->GetValue();  // NOLINT
+        uint64_t byte_size = 0;
         for (uint32_t i = 0; i < ts_cnt_; i++) {
             uint64_t old = gc_idx_cnt;
             KeyEntry* entry = entry_arr[i];
+            byte_size += GetGrownByteSize(entry);
+            key_entry_byte_size_.fetch_sub(GetGrownByteSize(entry), std::memory_order_relaxed);
             TimeEntries::Iterator* it = entry->entries.NewIterator();
             it->SeekToFirst();
             if (it->Valid()) {
@@ -368,12 +956,13 @@ void Segment::FreeEntry(::openmldb::base::Node<Slice, void*>* entry_node, uint64
             idx_cnt_vec_[i]->fetch_sub(gc_idx_cnt - old, std::memory_order_relaxed);
         }
         delete[] entry_arr;
-        uint64_t byte_size =
-            GetRecordPkMultiIdxSize(entry_node->Height(), entry_node->GetKey().size(), key_entry_max_height_, ts_cnt_);
+        byte_size += SubPkByteSize(entry_node->Height(), entry_node->GetKey().size());
         idx_byte_size_.fetch_sub(byte_size, std::memory_order_relaxed);
     } else {
         uint64_t old = gc_idx_cnt;
         KeyEntry* entry = (KeyEntry*)entry_node->GetValue();  // NOLINT
+        uint64_t byte_size = GetGrownByteSize(entry);
+        key_entry_byte_size_.fetch_sub(byte_size, std::memory_order_relaxed);
         TimeEntries::Iterator* it = entry->entries.NewIterator();
         it->SeekToFirst();
         if (it->Valid()) {
@@ -383,8 +972,7 @@ void Segment::FreeEntry(::openmldb::base::Node<Slice, void*>* entry_node, uint64
         }
         delete it;
         delete entry;
-        uint64_t byte_size =
-            GetRecordPkIdxSize(entry_node->Height(), entry_node->GetKey().size(), key_entry_max_height_);
+        byte_size += SubPkByteSize(entry_node->Height(), entry_node->GetKey().size());
         idx_byte_size_.fetch_sub(byte_size, std::memory_order_relaxed);
         idx_cnt_.fetch_sub(gc_idx_cnt - old, std::memory_order_relaxed);
     }
@@ -409,12 +997,374 @@ void Segment::GcEntryFreeList(uint64_t version, uint64_t& gc_idx_cnt, uint64_t&
 }
 
 void Segment::GcFreeList(uint64_t& gc_idx_cnt, uint64_t& gc_record_cnt, uint64_t& gc_record_byte_size) {
-    uint64_t cur_version = gc_version_.load(std::memory_order_relaxed);
-    if (cur_version < FLAGS_gc_deleted_pk_version_delta) {
-        return;
+    // the trimmed lists are not referenced by any reader as Gc4Head, they wait for the gc thread only
+    FreeTrimmedList(gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
+    uint64_t free_list_version = 0;
+    if (epoch_ != NULL) {
+        // the memory is freed once the readers started before it is retired are finished
+        free_list_version = epoch_->Advance();
+        FreeRetiredList(free_list_version, gc_record_cnt, gc_record_byte_size);
+    } else {
+        uint64_t cur_version = gc_version_.load(std::memory_order_relaxed);
+        if (cur_version < FLAGS_gc_deleted_pk_version_delta) {
+            return;
+        }
+        free_list_version = cur_version - FLAGS_gc_deleted_pk_version_delta;
+        // only the rows of the range deletes are retired without the epoch reclamation
+        FreeRetiredList(free_list_version, gc_record_cnt, gc_record_byte_size);
     }
-    uint64_t free_list_version = cur_version - FLAGS_gc_deleted_pk_version_delta;
     GcEntryFreeList(free_list_version, gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
+    FreeDemotedList(free_list_version);
+    FreeUpgradedList(free_list_version, gc_record_cnt, gc_record_byte_size);
+    FreeRetiredHeads(free_list_version);
+    if (pk_index_) {
+        pk_index_->FreeRetiredTables(free_list_version);
+    }
+}
+
+void Segment::FreeDemotedList(uint64_t version) {
+    std::vector<DataBlock*> blocks;
+    {
+        std::lock_guard<std::mutex> lock(gc_mu_);
+        auto iter = demoted_free_list_.begin();
+        while (iter != demoted_free_list_.end() && iter->first <= version) {
+            blocks.push_back(iter->second);
+            iter++;
+        }
+        demoted_free_list_.erase(demoted_free_list_.begin(), iter);
+    }
+    for (auto block : blocks) {
+        // the row may be still referred by the other indexes
+        if (block->dim_cnt_down > 1) {
+            block->dim_cnt_down--;
+        } else {
+            DeleteDataBlock(block);
+        }
+    }
+}
+
+void Segment::Demote(uint64_t time, uint32_t max_row_cnt, const ColdBlockLayout* layout, uint32_t dict_size,
+                     uint64_t& demote_cnt, uint64_t& saved_byte_size) {
+    if (max_row_cnt < 2) {
+        return;
+    }
+    uint64_t consumed = ::baidu::common::timer::get_micros();
+    if (dict_size > 0 && cold_dict_ == NULL) {
+        cold_dict_ = NewColdBlockDict(time, dict_size);
+    }
+    ColdBlockDict* dict = dict_size > 0 ? cold_dict_ : NULL;
+    KeyEntries::Iterator* it = entries_->NewIterator();
+    it->SeekToFirst();
+    while (it->Valid()) {
+        if (ts_cnt_ > 1) {
+            KeyEntry** entry_arr = (KeyEntry**)it->GetValue();  // NOLINT
+            for (uint32_t i = 0; i < ts_cnt_; i++) {
+                DemoteEntry(entry_arr[i], time, max_row_cnt, layout, dict, demote_cnt, saved_byte_size);
+            }
+        } else {
+            KeyEntry* entry = (KeyEntry*)it->GetValue();  // NOLINT
+            DemoteEntry(entry, time, max_row_cnt, layout, dict, demote_cnt, saved_byte_size);
+        }
+        it->Next();
+    }
+    delete it;
+    DEBUGLOG("[Demote] segment demote with key %lu, consumed %lu, count %lu", time,
+             (::baidu::common::timer::get_micros() - consumed) / 1000, demote_cnt);
+}
+
+void Segment::DemoteEntry(KeyEntry* entry, uint64_t time, uint32_t max_row_cnt, const ColdBlockLayout* layout,
+                          ColdBlockDict* dict, uint64_t& demote_cnt, uint64_t& saved_byte_size) {
+    // skip entry that ocupied by reader
+    if (entry->refs_.load(std::memory_order_acquire) > 0) {
+        return;
+    }
+    ::openmldb::base::Node<uint64_t, DataBlock*>* node = entry->entries.GetLast();
+    if (node == NULL || node->GetKey() > time) {
+        return;
+    }
+    std::vector<DataBlock**> slots;
+    std::vector<DataBlock*> rows;
+    TimeEntries::Iterator* it = entry->entries.NewIterator();
+    it->Seek(time);
+    while (it->Valid()) {
+        DataBlock*& block = it->GetValue();
+        if (block->IsCold()) {
+            // the rows after a cold row have been packed
+            break;
+        }
+        slots.push_back(&block);
+        rows.push_back(block);
+        if (rows.size() >= max_row_cnt) {
+            PackRows(slots, rows, layout, dict, demote_cnt, saved_byte_size);
+            slots.clear();
+            rows.clear();
+        }
+        it->Next();
+    }
+    delete it;
+    if (rows.size() > 1) {
+        PackRows(slots, rows, layout, dict, demote_cnt, saved_byte_size);
+    }
+}
+
+void Segment::PackRows(const std::vector<DataBlock**>& slots, const std::vector<DataBlock*>& rows,
+                       const ColdBlockLayout* layout, ColdBlockDict* dict, uint64_t& demote_cnt,
+                       uint64_t& saved_byte_size) {
+    ColdBlock* cold_block = ColdBlock::New(rows, layout, dict);
+    if (cold_block == NULL) {
+        return;
+    }
+    uint64_t version = GetRetireVersion();
+    std::lock_guard<std::mutex> lock(gc_mu_);
+    for (uint32_t i = 0; i < rows.size(); i++) {
+        cold_block->Ref();
+        *slots[i] = new DataBlock(cold_block, i, rows[i]->size);
+        // the replaced row may be read by the iterators created before, so release it later
+        demoted_free_list_.emplace_back(version, rows[i]);
+    }
+    demote_cnt += rows.size();
+    saved_byte_size += cold_block->GetRawSize() - cold_block->GetByteSize();
+}
+
+bool Segment::Upgrade(uint8_t version, uint64_t max_row_cnt, const RowUpgrader& upgrade, uint64_t& upgrade_cnt) {
+    if (upgrade_version_ != version) {
+        // the rows are upgraded to the new version from the beginning
+        upgrade_version_ = version;
+        upgrade_sweeping_ = false;
+        upgrade_dirty_ = true;
+    }
+    if (!upgrade_sweeping_) {
+        if (!upgrade_dirty_) {
+            // the rows put after the sweep are upgraded by the table as they are put
+            return true;
+        }
+        upgrade_sweeping_ = true;
+        upgrade_dirty_ = false;
+        upgrade_cursor_.clear();
+    }
+    uint64_t start_cnt = upgrade_cnt;
+    KeyEntries::Iterator* it = entries_->NewIterator();
+    if (upgrade_cursor_.empty()) {
+        it->SeekToFirst();
+    } else {
+        it->Seek(Slice(upgrade_cursor_));
+    }
+    while (it->Valid()) {
+        if (upgrade_cnt - start_cnt >= max_row_cnt) {
+            Slice key = it->GetKey();
+            upgrade_cursor_.assign(key.data(), key.size());
+            delete it;
+            return false;
+        }
+        for (uint32_t i = 0; i < ts_cnt_; i++) {
+            KeyEntry* entry = ts_cnt_ > 1 ? ((KeyEntry**)it->GetValue())[i] : (KeyEntry*)it->GetValue();  // NOLINT
+            if (!UpgradeEntry(entry, version, upgrade, upgrade_cnt)) {
+                upgrade_dirty_ = true;
+            }
+        }
+        it->Next();
+    }
+    delete it;
+    upgrade_sweeping_ = false;
+    upgrade_cursor_.clear();
+    return !upgrade_dirty_;
+}
+
+bool Segment::UpgradeEntry(KeyEntry* entry, uint8_t version, const RowUpgrader& upgrade, uint64_t& upgrade_cnt) {
+    // skip entry that ocupied by reader
+    if (entry->refs_.load(std::memory_order_acquire) > 0) {
+        return false;
+    }
+    bool upgraded = true;
+    std::vector<std::pair<DataBlock**, DataBlock*>> slots;
+    TimeEntries::Iterator* it = entry->entries.NewIterator();
+    for (it->SeekToFirst(); it->Valid(); it->Next()) {
+        DataBlock*& block = it->GetValue();
+        // the schema version is in the header of a hot row whatever its format is
+        if (!block->IsCold() && static_cast<uint8_t>(block->data[1]) == version) {
+            continue;
+        }
+        DataBlock* new_block = upgrade(it->GetKey(), block);
+        if (new_block == NULL) {
+            upgraded = false;
+        } else if (new_block != block) {
+            slots.emplace_back(&block, new_block);
+        }
+    }
+    delete it;
+    if (slots.empty()) {
+        return upgraded;
+    }
+    uint64_t retire_version = GetRetireVersion();
+    std::lock_guard<std::mutex> lock(gc_mu_);
+    for (const auto& slot : slots) {
+        // the replaced row may be read by the iterators created before, so release it later
+        upgraded_free_list_.emplace_back(retire_version, *slot.first);
+        *slot.first = slot.second;
+    }
+    upgrade_cnt += slots.size();
+    return upgraded;
+}
+
+void Segment::FreeUpgradedList(uint64_t version, uint64_t& gc_record_cnt, uint64_t& gc_record_byte_size) {
+    std::vector<DataBlock*> blocks;
+    {
+        std::lock_guard<std::mutex> lock(gc_mu_);
+        auto iter = upgraded_free_list_.begin();
+        while (iter != upgraded_free_list_.end() && iter->first <= version) {
+            blocks.push_back(iter->second);
+            iter++;
+        }
+        upgraded_free_list_.erase(upgraded_free_list_.begin(), iter);
+    }
+    for (auto block : blocks) {
+        if (block->dim_cnt_down > 1) {
+            block->dim_cnt_down--;
+        } else {
+            gc_record_byte_size += GetRecordSize(block->size);
+            DeleteDataBlock(block);
+            gc_record_cnt++;
+        }
+    }
+}
+
+ColdBlockDict* Segment::NewColdBlockDict(uint64_t time, uint32_t max_size) {
+    std::vector<DataBlock*> samples;
+    uint64_t sample_size = 0;
+    KeyEntries::Iterator* it = entries_->NewIterator();
+    for (it->SeekToFirst(); it->Valid() && sample_size < max_size; it->Next()) {
+        for (uint32_t i = 0; i < ts_cnt_; i++) {
+            KeyEntry* entry = ts_cnt_ > 1 ? ((KeyEntry**)it->GetValue())[i] : (KeyEntry*)it->GetValue();  // NOLINT
+            TimeEntries::Iterator* time_it = entry->entries.NewIterator();
+            time_it->Seek(time);
+            if (time_it->Valid() && !time_it->GetValue()->IsCold()) {
+                samples.push_back(time_it->GetValue());
+                sample_size += samples.back()->size;
+            }
+            delete time_it;
+        }
+    }
+    delete it;
+    return ColdBlockDict::New(samples, max_size);
+}
+
+bool Segment::ExecuteGcSlice(const std::map<uint32_t, TTLSt>& ttl_st_map, uint32_t max_key_cnt,
+                             uint64_t& gc_idx_cnt, uint64_t& gc_record_cnt, uint64_t& gc_record_byte_size) {
+    if (!IsGcSweeping()) {
+        gc_sweep_start_time_.store(::baidu::common::timer::get_micros() / 1000, std::memory_order_relaxed);
+    }
+    gc_key_budget_ = max_key_cnt;
+    gc_key_visited_ = 0;
+    gc_paused_ = false;
+    if (ttl_st_map.size() == 1) {
+        ExecuteGc(ttl_st_map.begin()->second, gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
+    } else {
+        ExecuteGc(ttl_st_map, gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
+    }
+    gc_key_budget_ = 0;
+    if (gc_paused_) {
+        return false;
+    }
+    gc_cursor_.clear();
+    gc_sweep_start_time_.store(0, std::memory_order_relaxed);
+    RebuildPkFilter();
+    return true;
+}
+
+uint64_t Segment::GetGcLag() const {
+    uint64_t start_time = gc_sweep_start_time_.load(std::memory_order_relaxed);
+    if (start_time == 0) {
+        return 0;
+    }
+    uint64_t cur_time = ::baidu::common::timer::get_micros() / 1000;
+    return cur_time > start_time ? cur_time - start_time : 0;
+}
+
+uint8_t Segment::InsertEntry(const Slice& key, void* entry) {
+    AddToPkFilter(key);
+    uint8_t height = entries_->Insert(key, entry);
+    if (pk_index_) {
+        pk_index_->Insert(entries_->GetNode(key));
+    }
+    return height;
+}
+
+KeyEntryNode* Segment::RemoveEntry(const Slice& key) {
+    KeyEntryNode* node = entries_->Remove(key);
+    if (node != NULL && pk_index_) {
+        pk_index_->Remove(node);
+    }
+    return node;
+}
+
+bool Segment::MayContainPk(const Slice& key) {
+    ::openmldb::base::BlockedBloomFilter* filter = pk_filter_.load(std::memory_order_acquire);
+    if (filter == nullptr) {
+        return true;
+    }
+    pk_lookup_cnt_.fetch_add(1, std::memory_order_relaxed);
+    if (filter->MayContain(key)) {
+        return true;
+    }
+    pk_filtered_cnt_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+void Segment::RebuildPkFilter() {
+    ::openmldb::base::BlockedBloomFilter* filter = pk_filter_.load(std::memory_order_acquire);
+    if (filter == nullptr) {
+        return;
+    }
+    uint64_t pk_cnt = GetPkCnt();
+    // the removed keys are still in the filter, and the count of keys may be shrunk a lot by gc
+    if (filter->GetAddedCnt() <= filter->GetCapacity() && filter->GetAddedCnt() <= pk_cnt * 2 &&
+        filter->GetCapacity() <= std::max(pk_cnt * 8, kMinPkFilterCapacity)) {
+        return;
+    }
+    // leave room for the new keys until the next gc
+    auto* new_filter =
+        new ::openmldb::base::BlockedBloomFilter(std::max(pk_cnt * 2, kMinPkFilterCapacity), pk_filter_bits_per_key_);
+    uint64_t key_cnt = 0;
+    {
+        // no key is inserted while the filter is built
+        std::lock_guard<std::shared_mutex> lock(mu_);
+        KeyEntries::Iterator* it = entries_->NewIterator();
+        it->SeekToFirst();
+        while (it->Valid()) {
+            new_filter->Add(it->GetKey());
+            key_cnt++;
+            it->Next();
+        }
+        delete it;
+        pk_filter_.store(new_filter, std::memory_order_release);
+    }
+    retired_pk_filter_.reset(filter);
+    DEBUGLOG("rebuild the pk filter with %lu keys, capacity %lu, byte size %lu", key_cnt, new_filter->GetCapacity(),
+             new_filter->GetByteSize());
+}
+
+KeyEntries::Iterator* Segment::NewGcIterator() {
+    KeyEntries::Iterator* it = entries_->NewIterator();
+    if (gc_key_budget_ > 0 && !gc_cursor_.empty()) {
+        it->Seek(Slice(gc_cursor_));
+    } else {
+        it->SeekToFirst();
+    }
+    return it;
+}
+
+bool Segment::PauseGc(KeyEntries::Iterator* it) {
+    if (gc_key_budget_ == 0) {
+        return false;
+    }
+    if (gc_key_visited_ >= gc_key_budget_) {
+        // the key may be removed before the next slice, so keep a copy of it
+        gc_cursor_.assign(it->GetKey().data(), it->GetKey().size());
+        gc_paused_ = true;
+        return true;
+    }
+    gc_key_visited_++;
+    return false;
 }
 
 void Segment::ExecuteGc(const TTLSt& ttl_st, uint64_t& gc_idx_cnt, uint64_t& gc_record_cnt,
@@ -423,22 +1373,26 @@ void Segment::ExecuteGc(const TTLSt& ttl_st, uint64_t& gc_idx_cnt, uint64_t& gc_
     switch (ttl_st.ttl_type) {
         case ::openmldb::storage::TTLType::kAbsoluteTime: {
             if (ttl_st.abs_ttl == 0) {
-                return;
+                break;
             }
             uint64_t expire_time = cur_time - ttl_offset_ - ttl_st.abs_ttl;
             Gc4TTL(expire_time, gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
-            break;
+            return;
         }
         case ::openmldb::storage::TTLType::kLatestTime: {
             if (ttl_st.lat_ttl == 0) {
-                return;
+                break;
+            }
+            if (GetLatestKeepCnt() == ttl_st.lat_ttl) {
+                // the keys are trimmed at put already
+                break;
             }
             Gc4Head(ttl_st.lat_ttl, gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
             break;
         }
         case ::openmldb::storage::TTLType::kAbsAndLat: {
             if (ttl_st.abs_ttl == 0 || ttl_st.lat_ttl == 0) {
-                return;
+                break;
             }
             uint64_t expire_time = cur_time - ttl_offset_ - ttl_st.abs_ttl;
             Gc4TTLAndHead(expire_time, ttl_st.lat_ttl, gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
@@ -446,7 +1400,7 @@ void Segment::ExecuteGc(const TTLSt& ttl_st, uint64_t& gc_idx_cnt, uint64_t& gc_
         }
         case ::openmldb::storage::TTLType::kAbsOrLat: {
             if (ttl_st.abs_ttl == 0 && ttl_st.lat_ttl == 0) {
-                return;
+                break;
             }
             uint64_t expire_time = ttl_st.abs_ttl == 0 ? 0 : cur_time - ttl_offset_ - ttl_st.abs_ttl;
             Gc4TTLOrHead(expire_time, ttl_st.lat_ttl, gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
@@ -455,6 +1409,8 @@ void Segment::ExecuteGc(const TTLSt& ttl_st, uint64_t& gc_idx_cnt, uint64_t& gc_
         default:
             PDLOG(WARNING, "ttl type %d is unsupported", ttl_st.ttl_type);
     }
+    // only the absolute ttl is executed by the expire index
+    ResetExpireIndex();
 }
 
 void Segment::ExecuteGc(const std::map<uint32_t, TTLSt>& ttl_st_map, uint64_t& gc_idx_cnt, uint64_t& gc_record_cnt,
@@ -488,19 +1444,18 @@ void Segment::Gc4Head(uint64_t keep_cnt, uint64_t& gc_idx_cnt, uint64_t& gc_reco
     }
     uint64_t consumed = ::baidu::common::timer::get_micros();
     uint64_t old = gc_idx_cnt;
-    KeyEntries::Iterator* it = entries_->NewIterator();
-    it->SeekToFirst();
-    while (it->Valid()) {
+    KeyEntries::Iterator* it = NewGcIterator();
+    while (it->Valid() && !PauseGc(it)) {
         KeyEntry* entry = (KeyEntry*)it->GetValue();  // NOLINT
         ::openmldb::base::Node<uint64_t, DataBlock*>* node = NULL;
         {
-            std::lock_guard<std::mutex> lock(mu_);
+            std::lock_guard<std::shared_mutex> lock(mu_);
             if (entry->refs_.load(std::memory_order_acquire) <= 0) {
                 node = entry->entries.SplitByPos(keep_cnt);
             }
         }
         uint64_t entry_gc_idx_cnt = 0;
-        FreeList(node, entry_gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
+        RetireList(node, entry_gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
         entry->count_.fetch_sub(entry_gc_idx_cnt, std::memory_order_relaxed);
         gc_idx_cnt += entry_gc_idx_cnt;
         it->Next();
@@ -515,9 +1470,8 @@ void Segment::GcAllType(const std::map<uint32_t, TTLSt>& ttl_st_map, uint64_t& g
                         uint64_t& gc_record_byte_size) {
     uint64_t old = gc_idx_cnt;
     uint64_t consumed = ::baidu::common::timer::get_micros();
-    KeyEntries::Iterator* it = entries_->NewIterator();
-    it->SeekToFirst();
-    while (it->Valid()) {
+    KeyEntries::Iterator* it = NewGcIterator();
+    while (it->Valid() && !PauseGc(it)) {
         KeyEntry** entry_arr = (KeyEntry**)it->GetValue();  // NOLINT
         Slice key = it->GetKey();
         it->Next();
@@ -540,7 +1494,7 @@ void Segment::GcAllType(const std::map<uint32_t, TTLSt>& ttl_st_map, uint64_t& g
                         continue_flag = true;
                     } else {
                         node = NULL;
-                        std::lock_guard<std::mutex> lock(mu_);
+                        std::lock_guard<std::shared_mutex> lock(mu_);
                         SplitList(entry, kv.second.abs_ttl, &node);
                         if (entry->entries.IsEmpty()) {
                             empty_cnt++;
@@ -549,7 +1503,7 @@ void Segment::GcAllType(const std::map<uint32_t, TTLSt>& ttl_st_map, uint64_t& g
                     break;
                 }
                 case ::openmldb::storage::TTLType::kLatestTime: {
-                    std::lock_guard<std::mutex> lock(mu_);
+                    std::lock_guard<std::shared_mutex> lock(mu_);
                     if (entry->refs_.load(std::memory_order_acquire) <= 0) {
                         node = entry->entries.SplitByPos(kv.second.lat_ttl);
                     }
@@ -561,7 +1515,7 @@ void Segment::GcAllType(const std::map<uint32_t, TTLSt>& ttl_st_map, uint64_t& g
                         continue_flag = true;
                     } else {
                         node = NULL;
-                        std::lock_guard<std::mutex> lock(mu_);
+                        std::lock_guard<std::shared_mutex> lock(mu_);
                         if (entry->refs_.load(std::memory_order_acquire) <= 0) {
                             node = entry->entries.SplitByKeyAndPos(kv.second.abs_ttl, kv.second.lat_ttl);
                         }
@@ -574,7 +1528,7 @@ void Segment::GcAllType(const std::map<uint32_t, TTLSt>& ttl_st_map, uint64_t& g
                         continue_flag = true;
                     } else {
                         node = NULL;
-                        std::lock_guard<std::mutex> lock(mu_);
+                        std::lock_guard<std::shared_mutex> lock(mu_);
                         if (entry->refs_.load(std::memory_order_acquire) <= 0) {
                             if (kv.second.abs_ttl == 0) {
                                 node = entry->entries.SplitByPos(kv.second.lat_ttl);
@@ -597,7 +1551,7 @@ void Segment::GcAllType(const std::map<uint32_t, TTLSt>& ttl_st_map, uint64_t& g
                 continue;
             }
             uint64_t entry_gc_idx_cnt = 0;
-            FreeList(node, entry_gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
+            RetireList(node, entry_gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
             entry->count_.fetch_sub(entry_gc_idx_cnt, std::memory_order_relaxed);
             idx_cnt_vec_[pos->second]->fetch_sub(entry_gc_idx_cnt, std::memory_order_relaxed);
             gc_idx_cnt += entry_gc_idx_cnt;
@@ -606,7 +1560,7 @@ void Segment::GcAllType(const std::map<uint32_t, TTLSt>& ttl_st_map, uint64_t& g
             bool is_empty = true;
             ::openmldb::base::Node<Slice, void*>* entry_node = NULL;
             {
-                std::lock_guard<std::mutex> lock(mu_);
+                std::lock_guard<std::shared_mutex> lock(mu_);
                 for (uint32_t i = 0; i < ts_cnt_; i++) {
                     if (!entry_arr[i]->entries.IsEmpty()) {
                         is_empty = false;
@@ -614,12 +1568,12 @@ void Segment::GcAllType(const std::map<uint32_t, TTLSt>& ttl_st_map, uint64_t& g
                     }
                 }
                 if (is_empty) {
-                    entry_node = entries_->Remove(key);
+                    entry_node = RemoveEntry(key);
                 }
             }
             if (entry_node != NULL) {
                 std::lock_guard<std::mutex> lock(gc_mu_);
-                entry_free_list_->Insert(gc_version_.load(std::memory_order_relaxed), entry_node);
+                entry_free_list_->Insert(GetRetireVersion(), entry_node);
             }
         }
     }
@@ -638,46 +1592,117 @@ void Segment::SplitList(KeyEntry* entry, uint64_t ts, ::openmldb::base::Node<uin
 // fast gc with no global pause
 void Segment::Gc4TTL(const uint64_t time, uint64_t& gc_idx_cnt, uint64_t& gc_record_cnt,
                      uint64_t& gc_record_byte_size) {
+    if (expire_bucket_size_ > 0 && !expire_index_dirty_) {
+        Gc4TTLByIndex(time, gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
+        return;
+    }
     uint64_t consumed = ::baidu::common::timer::get_micros();
     uint64_t old = gc_idx_cnt;
-    KeyEntries::Iterator* it = entries_->NewIterator();
-    it->SeekToFirst();
-    while (it->Valid()) {
+    KeyEntries::Iterator* it = NewGcIterator();
+    while (it->Valid() && !PauseGc(it)) {
         KeyEntry* entry = (KeyEntry*)it->GetValue();  // NOLINT
         Slice key = it->GetKey();
         it->Next();
-        ::openmldb::base::Node<uint64_t, DataBlock*>* node = entry->entries.GetLast();
-        if (node == NULL) {
-            continue;
-        } else if (node->GetKey() > time) {
-            DEBUGLOG(
-                "[Gc4TTL] segment gc with key %lu need not ttl, last node "
-                "key %lu",
-                time, node->GetKey());
-            continue;
-        }
-        node = NULL;
-        ::openmldb::base::Node<Slice, void*>* entry_node = NULL;
-        {
-            std::lock_guard<std::mutex> lock(mu_);
-            SplitList(entry, time, &node);
-            if (entry->entries.IsEmpty()) {
-                entry_node = entries_->Remove(key);
-            }
-        }
-        if (entry_node != NULL) {
-            std::lock_guard<std::mutex> lock(gc_mu_);
-            entry_free_list_->Insert(gc_version_.load(std::memory_order_relaxed), entry_node);
-        }
-        uint64_t entry_gc_idx_cnt = 0;
-        FreeList(node, entry_gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
-        entry->count_.fetch_sub(entry_gc_idx_cnt, std::memory_order_relaxed);
-        gc_idx_cnt += entry_gc_idx_cnt;
+        GcEntry4TTL(key, entry, time, gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
     }
     DEBUGLOG("[Gc4TTL] segment gc with key %lu ,consumed %lu, count %lu", time,
              (::baidu::common::timer::get_micros() - consumed) / 1000, gc_idx_cnt - old);
     idx_cnt_.fetch_sub(gc_idx_cnt - old, std::memory_order_relaxed);
     delete it;
+    if (expire_bucket_size_ > 0 && !gc_paused_) {
+        // all of the keys have been indexed by the sweep
+        expire_index_dirty_ = false;
+    }
+}
+
+void Segment::Gc4TTLByIndex(const uint64_t time, uint64_t& gc_idx_cnt, uint64_t& gc_record_cnt,
+                            uint64_t& gc_record_byte_size) {
+    uint64_t consumed = ::baidu::common::timer::get_micros();
+    uint64_t old = gc_idx_cnt;
+    std::vector<std::string> keys;
+    {
+        std::lock_guard<std::mutex> lock(expire_mu_);
+        uint64_t cur_bucket = time / expire_bucket_size_;
+        auto iter = expire_index_.begin();
+        while (iter != expire_index_.end() && iter->first <= cur_bucket) {
+            keys.insert(keys.end(), iter->second.begin(), iter->second.end());
+            // the bucket of time may have rows which are not expired
+            if (iter->first < cur_bucket) {
+                iter = expire_index_.erase(iter);
+            } else {
+                iter++;
+            }
+        }
+    }
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+    for (const auto& pk : keys) {
+        void* value = NULL;
+        // the key may be deleted after it is indexed
+        if (entries_->Get(Slice(pk), value) < 0 || value == NULL) {
+            continue;
+        }
+        GcEntry4TTL(Slice(pk), (KeyEntry*)value, time, gc_idx_cnt, gc_record_cnt,  // NOLINT
+                    gc_record_byte_size);
+    }
+    DEBUGLOG("[Gc4TTLByIndex] segment gc with key %lu, consumed %lu, visit %lu, count %lu", time,
+             (::baidu::common::timer::get_micros() - consumed) / 1000, keys.size(), gc_idx_cnt - old);
+    idx_cnt_.fetch_sub(gc_idx_cnt - old, std::memory_order_relaxed);
+}
+
+void Segment::GcEntry4TTL(const Slice& key, KeyEntry* entry, const uint64_t time, uint64_t& gc_idx_cnt,
+                          uint64_t& gc_record_cnt, uint64_t& gc_record_byte_size) {
+    ::openmldb::base::Node<uint64_t, DataBlock*>* node = entry->entries.GetLast();
+    if (node == NULL) {
+        return;
+    } else if (node->GetKey() > time) {
+        DEBUGLOG(
+            "[Gc4TTL] segment gc with key %lu need not ttl, last node "
+            "key %lu",
+            time, node->GetKey());
+        IndexExpire(key, node->GetKey());
+        return;
+    }
+    node = NULL;
+    ::openmldb::base::Node<Slice, void*>* entry_node = NULL;
+    {
+        std::lock_guard<std::shared_mutex> lock(mu_);
+        SplitList(entry, time, &node);
+        if (entry->entries.IsEmpty()) {
+            entry_node = RemoveEntry(key);
+        }
+    }
+    if (entry_node != NULL) {
+        std::lock_guard<std::mutex> lock(gc_mu_);
+        entry_free_list_->Insert(GetRetireVersion(), entry_node);
+    } else {
+        // index the key with its oldest row again, which may be skipped as the entry is occupied by reader
+        ::openmldb::base::Node<uint64_t, DataBlock*>* last = entry->entries.GetLast();
+        if (last != NULL) {
+            IndexExpire(key, last->GetKey());
+        }
+    }
+    uint64_t entry_gc_idx_cnt = 0;
+    RetireList(node, entry_gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
+    entry->count_.fetch_sub(entry_gc_idx_cnt, std::memory_order_relaxed);
+    gc_idx_cnt += entry_gc_idx_cnt;
+}
+
+void Segment::IndexExpire(const Slice& key, uint64_t time) {
+    if (expire_bucket_size_ == 0) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(expire_mu_);
+    expire_index_[time / expire_bucket_size_].emplace(key.data(), key.size());
+}
+
+void Segment::ResetExpireIndex() {
+    if (expire_bucket_size_ == 0) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(expire_mu_);
+    expire_index_.clear();
+    expire_index_dirty_ = true;
 }
 
 void Segment::Gc4TTLAndHead(const uint64_t time, const uint64_t keep_cnt, uint64_t& gc_idx_cnt, uint64_t& gc_record_cnt,
@@ -688,9 +1713,8 @@ void Segment::Gc4TTLAndHead(const uint64_t time, const uint64_t keep_cnt, uint64
     }
     uint64_t consumed = ::baidu::common::timer::get_micros();
     uint64_t old = gc_idx_cnt;
-    KeyEntries::Iterator* it = entries_->NewIterator();
-    it->SeekToFirst();
-    while (it->Valid()) {
+    KeyEntries::Iterator* it = NewGcIterator();
+    while (it->Valid() && !PauseGc(it)) {
         KeyEntry* entry = (KeyEntry*)it->GetValue();  // NOLINT
         ::openmldb::base::Node<uint64_t, DataBlock*>* node = entry->entries.GetLast();
         it->Next();
@@ -705,13 +1729,13 @@ void Segment::Gc4TTLAndHead(const uint64_t time, const uint64_t keep_cnt, uint64
         }
         node = NULL;
         {
-            std::lock_guard<std::mutex> lock(mu_);
+            std::lock_guard<std::shared_mutex> lock(mu_);
             if (entry->refs_.load(std::memory_order_acquire) <= 0) {
                 node = entry->entries.SplitByKeyAndPos(time, keep_cnt);
             }
         }
         uint64_t entry_gc_idx_cnt = 0;
-        FreeList(node, entry_gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
+        RetireList(node, entry_gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
         entry->count_.fetch_sub(entry_gc_idx_cnt, std::memory_order_relaxed);
         gc_idx_cnt += entry_gc_idx_cnt;
     }
@@ -737,9 +1761,8 @@ void Segment::Gc4TTLOrHead(const uint64_t time, const uint64_t keep_cnt, uint64_
     }
     uint64_t consumed = ::baidu::common::timer::get_micros();
     uint64_t old = gc_idx_cnt;
-    KeyEntries::Iterator* it = entries_->NewIterator();
-    it->SeekToFirst();
-    while (it->Valid()) {
+    KeyEntries::Iterator* it = NewGcIterator();
+    while (it->Valid() && !PauseGc(it)) {
         KeyEntry* entry = (KeyEntry*)it->GetValue();  // NOLINT
         Slice key = it->GetKey();
         it->Next();
@@ -750,20 +1773,20 @@ void Segment::Gc4TTLOrHead(const uint64_t time, const uint64_t keep_cnt, uint64_
         node = NULL;
         ::openmldb::base::Node<Slice, void*>* entry_node = NULL;
         {
-            std::lock_guard<std::mutex> lock(mu_);
+            std::lock_guard<std::shared_mutex> lock(mu_);
             if (entry->refs_.load(std::memory_order_acquire) <= 0) {
                 node = entry->entries.SplitByKeyOrPos(time, keep_cnt);
             }
             if (entry->entries.IsEmpty()) {
-                entry_node = entries_->Remove(key);
+                entry_node = RemoveEntry(key);
             }
         }
         if (entry_node != NULL) {
             std::lock_guard<std::mutex> lock(gc_mu_);
-            entry_free_list_->Insert(gc_version_.load(std::memory_order_relaxed), entry_node);
+            entry_free_list_->Insert(GetRetireVersion(), entry_node);
         }
         uint64_t entry_gc_idx_cnt = 0;
-        FreeList(node, entry_gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
+        RetireList(node, entry_gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
         entry->count_.fetch_sub(entry_gc_idx_cnt, std::memory_order_relaxed);
         gc_idx_cnt += entry_gc_idx_cnt;
     }
@@ -776,11 +1799,12 @@ void Segment::Gc4TTLOrHead(const uint64_t time, const uint64_t keep_cnt, uint64_
 }
 
 int Segment::GetCount(const Slice& key, uint64_t& count) {
+    ::openmldb::base::EpochGuard guard(epoch_);
     if (ts_cnt_ > 1) {
         return -1;
     }
-    void* entry = NULL;
-    if (entries_->Get(key, entry) < 0 || entry == NULL) {
+    void* entry = MayContainPk(key) ? FindEntry(key) : NULL;
+    if (entry == NULL) {
         return -1;
     }
     count = ((KeyEntry*)entry)->count_.load(std::memory_order_relaxed);  // NOLINT
@@ -788,6 +1812,7 @@ int Segment::GetCount(const Slice& key, uint64_t& count) {
 }
 
 int Segment::GetCount(const Slice& key, uint32_t idx, uint64_t& count) {
+    ::openmldb::base::EpochGuard guard(epoch_);
     auto pos = ts_idx_map_.find(idx);
     if (pos == ts_idx_map_.end()) {
         return -1;
@@ -795,8 +1820,8 @@ int Segment::GetCount(const Slice& key, uint32_t idx, uint64_t& count) {
     if (ts_cnt_ == 1) {
         return GetCount(key, count);
     }
-    void* entry_arr = NULL;
-    if (entries_->Get(key, entry_arr) < 0 || entry_arr == NULL) {
+    void* entry_arr = MayContainPk(key) ? FindEntry(key) : NULL;
+    if (entry_arr == NULL) {
         return -1;
     }
     count = ((KeyEntry**)entry_arr)[pos->second]->count_.load(  // NOLINT
@@ -804,13 +1829,164 @@ int Segment::GetCount(const Slice& key, uint32_t idx, uint64_t& count) {
     return 0;
 }
 
+int Segment::GetLiveCount(const Slice& key, uint32_t idx, uint64_t expire_time, uint64_t expire_cnt,
+                          TTLType ttl_type, bool skip_zero_ts, uint64_t* count) {
+    ::openmldb::base::EpochGuard guard(epoch_);
+    void* entry_or_arr = MayContainPk(key) ? FindEntry(key) : NULL;
+    if (entry_or_arr == NULL) {
+        return -1;
+    }
+    KeyEntry* entry = NULL;
+    if (ts_cnt_ > 1) {
+        auto pos = ts_idx_map_.find(idx);
+        if (pos == ts_idx_map_.end()) {
+            return -1;
+        }
+        entry = ((KeyEntry**)entry_or_arr)[pos->second];  // NOLINT
+    } else {
+        entry = (KeyEntry*)entry_or_arr;  // NOLINT
+    }
+    bool abs_expire = expire_time > 0 && ttl_type != TTLType::kLatestTime;
+    uint64_t total = entry->count_.load(std::memory_order_relaxed);
+    // the rows of ts not greater than the expire time, which gc has not freed yet
+    uint64_t expired_cnt = 0;
+    uint64_t zero_cnt = 0;
+    if (abs_expire || skip_zero_ts) {
+        std::unique_ptr<TimeEntries::Iterator> it(entry->entries.NewIterator());
+        it->Seek(abs_expire ? expire_time : 0);
+        while (it->Valid()) {
+            expired_cnt++;
+            if (it->GetKey() == 0) {
+                zero_cnt++;
+            }
+            it->Next();
+        }
+        if (entry->count_.load(std::memory_order_relaxed) != total || expired_cnt > total) {
+            return -1;
+        }
+    }
+    uint64_t live_cnt = abs_expire ? total - expired_cnt : total;
+    uint64_t latest_cnt = expire_cnt > 0 ? std::min(total, expire_cnt) : total;
+    switch (ttl_type) {
+        case TTLType::kAbsoluteTime:
+            break;
+        case TTLType::kLatestTime:
+            live_cnt = latest_cnt;
+            break;
+        case TTLType::kAbsAndLat:
+            // a row is expired only if it is out of both the latest rows and the time
+            live_cnt = abs_expire && expire_cnt > 0 ? std::max(live_cnt, latest_cnt) : total;
+            break;
+        case TTLType::kAbsOrLat:
+            live_cnt = std::min(live_cnt, latest_cnt);
+            break;
+        default:
+            return -1;
+    }
+    if (skip_zero_ts) {
+        live_cnt = std::min(live_cnt, total - zero_cnt);
+    }
+    *count = live_cnt;
+    return 0;
+}
+
+void Segment::RecordHotKey(const Slice& key, uint64_t count) {
+    std::lock_guard<std::mutex> lock(hot_key_mu_);
+    auto min_it = hot_keys_.end();
+    for (auto it = hot_keys_.begin(); it != hot_keys_.end(); ++it) {
+        if (key.compare(Slice(it->first)) == 0) {
+            it->second = count;
+            return;
+        }
+        if (min_it == hot_keys_.end() || it->second < min_it->second) {
+            min_it = it;
+        }
+    }
+    if (hot_keys_.size() < kMaxHotKeyCnt) {
+        hot_keys_.emplace_back(key.ToString(), count);
+    } else if (min_it->second < count) {
+        min_it->first = key.ToString();
+        min_it->second = count;
+    }
+}
+
+void Segment::GetHotKeys(std::vector<std::pair<std::string, uint64_t>>* hot_keys) {
+    std::vector<std::pair<std::string, uint64_t>> recorded;
+    {
+        std::lock_guard<std::mutex> lock(hot_key_mu_);
+        recorded = hot_keys_;
+    }
+    // the counts recorded may be stale after gc, so read the current ones
+    std::shared_lock<std::shared_mutex> lock(mu_);
+    for (const auto& kv : recorded) {
+        void* entry = nullptr;
+        if (entries_->Get(Slice(kv.first), entry) < 0 || entry == nullptr) {
+            continue;
+        }
+        uint64_t count = 0;
+        if (ts_cnt_ > 1) {
+            for (uint32_t i = 0; i < ts_cnt_; i++) {
+                count = std::max(count, ((KeyEntry**)entry)[i]->count_.load(std::memory_order_relaxed));  // NOLINT
+            }
+        } else {
+            count = ((KeyEntry*)entry)->count_.load(std::memory_order_relaxed);  // NOLINT
+        }
+        if (count > 0) {
+            hot_keys->emplace_back(kv.first, count);
+        }
+    }
+}
+
+void Segment::GcHotKeys(uint64_t max_cnt, uint64_t& gc_idx_cnt, uint64_t& gc_record_cnt,
+                        uint64_t& gc_record_byte_size) {
+    if (max_cnt == 0) {
+        return;
+    }
+    std::vector<std::pair<std::string, uint64_t>> hot_keys;
+    GetHotKeys(&hot_keys);
+    uint64_t old = gc_idx_cnt;
+    for (const auto& kv : hot_keys) {
+        if (kv.second <= max_cnt) {
+            continue;
+        }
+        for (uint32_t i = 0; i < ts_cnt_; i++) {
+            KeyEntry* entry = nullptr;
+            ::openmldb::base::Node<uint64_t, DataBlock*>* node = NULL;
+            {
+                std::lock_guard<std::shared_mutex> lock(mu_);
+                void* value = nullptr;
+                if (entries_->Get(Slice(kv.first), value) < 0 || value == nullptr) {
+                    break;
+                }
+                entry = ts_cnt_ > 1 ? ((KeyEntry**)value)[i] : (KeyEntry*)value;  // NOLINT
+                if (entry->refs_.load(std::memory_order_acquire) <= 0) {
+                    node = entry->entries.SplitByPos(max_cnt);
+                }
+            }
+            uint64_t entry_gc_idx_cnt = 0;
+            RetireList(node, entry_gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
+            entry->count_.fetch_sub(entry_gc_idx_cnt, std::memory_order_relaxed);
+            if (ts_cnt_ > 1) {
+                idx_cnt_vec_[i]->fetch_sub(entry_gc_idx_cnt, std::memory_order_relaxed);
+            }
+            gc_idx_cnt += entry_gc_idx_cnt;
+        }
+    }
+    if (ts_cnt_ <= 1) {
+        idx_cnt_.fetch_sub(gc_idx_cnt - old, std::memory_order_relaxed);
+    }
+    if (gc_idx_cnt > old) {
+        DEBUGLOG("[GcHotKeys] segment gc hot keys to %lu rows, count %lu", max_cnt, gc_idx_cnt - old);
+    }
+}
+
 // Iterator
 MemTableIterator* Segment::NewIterator(const Slice& key, Ticket& ticket) {
     if (entries_ == NULL || ts_cnt_ > 1) {
         return new MemTableIterator(NULL);
     }
-    void* entry = NULL;
-    if (entries_->Get(key, entry) < 0 || entry == NULL) {
+    void* entry = MayContainPk(key) ? FindEntry(key) : NULL;
+    if (entry == NULL) {
         return new MemTableIterator(NULL);
     }
     ticket.Push((KeyEntry*)entry);                                           // NOLINT
@@ -825,8 +2001,8 @@ MemTableIterator* Segment::NewIterator(const Slice& key, uint32_t idx, Ticket& t
     if (ts_cnt_ == 1) {
         return NewIterator(key, ticket);
     }
-    void* entry_arr = NULL;
-    if (entries_->Get(key, entry_arr) < 0 || entry_arr == NULL) {
+    void* entry_arr = MayContainPk(key) ? FindEntry(key) : NULL;
+    if (entry_arr == NULL) {
         return new MemTableIterator(NULL);
     }
     ticket.Push(((KeyEntry**)entry_arr)[pos->second]);                                         // NOLINT
@@ -860,10 +2036,11 @@ void MemTableIterator::Next() {
         return;
     }
     it_->Next();
+    PrefetchNextRow(it_);
 }
 
 ::openmldb::base::Slice MemTableIterator::GetValue() const {
-    return ::openmldb::base::Slice(it_->GetValue()->data, it_->GetValue()->size);
+    return cold_reader_.Read(it_->GetValue());
 }
 
 uint64_t MemTableIterator::GetKey() const { return it_->GetKey(); }
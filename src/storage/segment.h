@@ -18,15 +18,25 @@
 #define SRC_STORAGE_SEGMENT_H_
 
 #include <atomic>
+#include <functional>
 #include <map>
 #include <memory>
 #include <mutex>  // NOLINT
+#include <shared_mutex>  // NOLINT
+#include <string>
+#include <unordered_set>
+#include <utility>
 #include <vector>
 
+#include "base/bloom_filter.h"
+#include "base/epoch.h"
 #include "base/skiplist.h"
 #include "base/slice.h"
 #include "proto/tablet.pb.h"
+#include "storage/cold_block.h"
+#include "storage/data_block_pool.h"
 #include "storage/iterator.h"
+#include "storage/pk_hash_index.h"
 #include "storage/schema.h"
 #include "storage/ticket.h"
 
@@ -43,16 +53,27 @@ class Ticket;
 struct DataBlock {
     // dimension count down
     uint8_t dim_cnt_down;
+    // allocated by DataBlockPool, the data is in the same cell
+    bool pooled : 1;
+    // the data is a compact row referring to blobs, which are released with the block
+    bool has_blobs : 1;
+    // the position in the cold block which data points to, HOT_POS if the row is not packed
+    // and MAPPED_POS if data points to a mapped snapshot which is not owned by the block
+    uint16_t cold_pos;
     uint32_t size;
     char* data;
 
-    DataBlock(uint8_t dim_cnt, const char* input, uint32_t len) : dim_cnt_down(dim_cnt), size(len), data(NULL) {
+    static constexpr uint16_t HOT_POS = UINT16_MAX;
+    static constexpr uint16_t MAPPED_POS = UINT16_MAX - 1;
+
+    DataBlock(uint8_t dim_cnt, const char* input, uint32_t len)
+        : dim_cnt_down(dim_cnt), pooled(false), has_blobs(false), cold_pos(HOT_POS), size(len), data(NULL) {
         data = new char[len];
         memcpy(data, input, len);
     }
 
     DataBlock(uint8_t dim_cnt, char* input, uint32_t len, bool skip_copy)
-        : dim_cnt_down(dim_cnt), size(len), data(NULL) {
+        : dim_cnt_down(dim_cnt), pooled(false), has_blobs(false), cold_pos(HOT_POS), size(len), data(NULL) {
         if (skip_copy) {
             data = input;
         } else {
@@ -61,8 +82,28 @@ struct DataBlock {
         }
     }
 
+    // a packed row, the cold block is released by DeleteDataBlock
+    DataBlock(ColdBlock* cold_block, uint16_t pos, uint32_t len)
+        : dim_cnt_down(1),
+          pooled(false),
+          has_blobs(false),
+          cold_pos(pos),
+          size(len),
+          data(reinterpret_cast<char*>(cold_block)) {}
+
+    inline bool IsCold() const { return cold_pos < MAPPED_POS; }
+
+    inline bool IsMapped() const { return cold_pos == MAPPED_POS; }
+
+    // the row refers to the memory of a mapped snapshot which outlives the block
+    inline void SetMapped() { cold_pos = MAPPED_POS; }
+
+    inline ColdBlock* GetColdBlock() const { return reinterpret_cast<ColdBlock*>(data); }
+
     ~DataBlock() {
-        delete[] data;
+        if (!pooled && !IsCold() && !IsMapped()) {
+            delete[] data;
+        }
         data = NULL;
     }
 };
@@ -80,7 +121,25 @@ struct TimeComparator {
 };
 
 static const TimeComparator tcmp;
+// the hot keys of a segment are recorded every kHotKeyRecordStep rows of a key
+static constexpr uint64_t kHotKeyRecordStep = 1024;
+static constexpr uint32_t kMaxHotKeyCnt = 8;
 typedef ::openmldb::base::Skiplist<uint64_t, DataBlock*, TimeComparator> TimeEntries;
+// upgrade the row of the block of a ts to the latest schema version, see Segment::Upgrade. It returns the
+// block itself if the row is of the latest version already, and NULL if the row can not be upgraded
+typedef std::function<DataBlock*(uint64_t, DataBlock*)> RowUpgrader;
+
+// fetch the block of the row after the current one of it, so it is in the cache when the iteration steps
+// there after the current row is processed. The payload of a pooled block is right after its header
+inline void PrefetchNextRow(TimeEntries::Iterator* it) {
+    if (!it->Valid()) {
+        return;
+    }
+    DataBlock** next = it->PeekNextValue();
+    if (next != NULL) {
+        ::openmldb::base::Prefetch(*next);
+    }
+}
 
 class MemTableIterator : public TableIterator {
  public:
@@ -93,15 +152,23 @@ class MemTableIterator : public TableIterator {
     uint64_t GetKey() const override;
     void SeekToFirst() override;
     void SeekToLast() override;
+    bool IsValuePinned() const override { return cold_reader_.IsLastPinned(); }
+
+    void SetCompactCodec(const std::shared_ptr<::openmldb::codec::CompactRowCodec>& codec) {
+        cold_reader_.SetCompactCodec(codec);
+    }
 
  private:
     TimeEntries::Iterator* it_;
+    mutable ColdRowReader cold_reader_;
 };
 
 class KeyEntry {
  public:
     KeyEntry() : entries(12, 4, tcmp), refs_(0), count_(0) {}
     explicit KeyEntry(uint8_t height) : entries(height, 4, tcmp), refs_(0), count_(0) {}
+    // the time entries begin with a head of init_height levels, see Segment::GrowKeyEntry
+    KeyEntry(uint8_t height, uint8_t init_height) : entries(height, init_height, 4, tcmp), refs_(0), count_(0) {}
     ~KeyEntry() {}
 
     // just return the count of datablock
@@ -116,7 +183,7 @@ class KeyEntry {
             if (block->dim_cnt_down > 1) {
                 block->dim_cnt_down--;
             } else {
-                delete block;
+                DeleteDataBlock(block);
             }
             it->Next();
         }
@@ -145,6 +212,18 @@ struct SliceComparator {
 typedef ::openmldb::base::Skiplist<::openmldb::base::Slice, void*, SliceComparator> KeyEntries;
 typedef ::openmldb::base::Skiplist<uint64_t, ::openmldb::base::Node<Slice, void*>*, TimeComparator> KeyEntryNodeList;
 
+// the bytes of the index of a segment by its parts, the rows are counted by the table
+struct SegmentMemStat {
+    // the nodes of the pk skiplist with the keys
+    uint64_t pk_node_byte_size = 0;
+    // the key entries of the pks with their heads
+    uint64_t key_entry_byte_size = 0;
+    // the nodes of the time entries
+    uint64_t ts_node_byte_size = 0;
+    uint64_t pk_index_byte_size = 0;
+    uint64_t pk_filter_byte_size = 0;
+};
+
 class Segment {
  public:
     Segment();
@@ -161,6 +240,10 @@ class Segment {
 
     void BulkLoadPut(unsigned int key_entry_id, const Slice& key, uint64_t time, DataBlock* row);
 
+    // load all the rows of the key entry of a key at once. The time list of a new key is built from the sorted
+    // rows off-line and installed with one lock of the segment, the rows of an existing key are inserted into it
+    void BulkLoad(unsigned int key_entry_id, const Slice& key, std::vector<std::pair<uint64_t, DataBlock*>>* rows);
+
     void Put(const Slice& key, const TSDimensions& ts_dimension, DataBlock* row);
 
     // Get time data
@@ -169,6 +252,12 @@ class Segment {
     bool Get(const Slice& key, uint32_t idx, uint64_t time, DataBlock** block);
 
     bool Delete(const Slice& key);
+    // delete the rows of the key whose ts is from end_ts to start_ts, the rows of the ts are cut off the key entry
+    // at once and freed by GcFreeList. false if the key is not found
+    bool Delete(const Slice& key, uint32_t idx, uint64_t start_ts, uint64_t end_ts);
+    // delete the rows of every key whose ts is from end_ts to start_ts, return the count of the rows deleted.
+    // The puts of the segment wait for it
+    uint64_t Delete(uint32_t idx, uint64_t start_ts, uint64_t end_ts);
 
     uint64_t Release();
 
@@ -226,10 +315,15 @@ class Segment {
 
     const std::map<uint32_t, uint32_t>& GetTsIdxMap() const { return ts_idx_map_; }
 
-    inline uint64_t GetIdxByteSize() { return idx_byte_size_.load(std::memory_order_relaxed); }
+    inline uint64_t GetIdxByteSize() {
+        return idx_byte_size_.load(std::memory_order_relaxed) + (pk_index_ ? pk_index_->GetByteSize() : 0);
+    }
 
     inline uint64_t GetPkCnt() { return pk_cnt_.load(std::memory_order_relaxed); }
 
+    // add the bytes of the parts of the index to stat
+    void GetMemStat(SegmentMemStat* stat);
+
     void GcFreeList(uint64_t& entry_gc_idx_cnt,      // NOLINT
                     uint64_t& gc_record_cnt,         // NOLINT
                     uint64_t& gc_record_byte_size);  // NOLINT
@@ -238,19 +332,140 @@ class Segment {
 
     int GetCount(const Slice& key, uint64_t& count);                // NOLINT
     int GetCount(const Slice& key, uint32_t idx, uint64_t& count);  // NOLINT
+    // the count of the rows of the key not expired by the ttl, the rows of ts 0 are not counted if skip_zero_ts.
+    // The rows not expired are the count of the key less the expired ones at the end of the time entries, which
+    // are at most the rows put in a gc interval, so it takes O(1) for the latest ttl and no walk of the whole key
+    // for the others. -1 if the key is not found or the rows changed while counting, then iterate the key instead
+    int GetLiveCount(const Slice& key, uint32_t idx, uint64_t expire_time, uint64_t expire_cnt, TTLType ttl_type,
+                     bool skip_zero_ts, uint64_t* count);
 
     void IncrGcVersion() { gc_version_.fetch_add(1, std::memory_order_relaxed); }
 
+    // Keep the latest keep_cnt rows of every key by trimming the keys at put rather than by Gc4Head, which
+    // visits all of the keys in every round. A key is trimmed once it has latest_ttl_trim_slack rows more than
+    // keep_cnt, so the trimming takes O(1) per put amortized. 0 turns it off, and it is ignored if the trimming
+    // is disabled or the segment has multiple ts
+    void SetLatestKeepCnt(uint64_t keep_cnt) {
+        if (latest_trim_slack_ == 0 || ts_cnt_ > 1) {
+            keep_cnt = 0;
+        }
+        latest_keep_cnt_.store(keep_cnt, std::memory_order_relaxed);
+    }
+    uint64_t GetLatestKeepCnt() const { return latest_keep_cnt_.load(std::memory_order_relaxed); }
+
     void ReleaseAndCount(uint64_t& gc_idx_cnt,            // NOLINT
                          uint64_t& gc_record_cnt,         // NOLINT
                          uint64_t& gc_record_byte_size);  // NOLINT
 
+    // Execute one slice of the incremental gc which visits at most max_key_cnt keys from the
+    // key where the last slice stopped, max_key_cnt 0 means the whole segment.
+    // Return true if the sweep of the segment is finished
+    bool ExecuteGcSlice(const std::map<uint32_t, TTLSt>& ttl_st_map, uint32_t max_key_cnt,
+                        uint64_t& gc_idx_cnt,            // NOLINT
+                        uint64_t& gc_record_cnt,         // NOLINT
+                        uint64_t& gc_record_byte_size);  // NOLINT
+
+    // the keys with the most rows in the segment and their count of rows, in no particular order.
+    // A key is recorded when its count of rows reaches a multiple of kHotKeyRecordStep, so it
+    // costs nothing on most puts
+    void GetHotKeys(std::vector<std::pair<std::string, uint64_t>>* hot_keys);
+
+    // keep at most max_cnt rows of the hot keys, whatever the ttl is
+    void GcHotKeys(uint64_t max_cnt, uint64_t& gc_idx_cnt,  // NOLINT
+                   uint64_t& gc_record_cnt,                 // NOLINT
+                   uint64_t& gc_record_byte_size);          // NOLINT
+
+    // whether a sweep is started by ExecuteGcSlice and not finished yet
+    inline bool IsGcSweeping() const { return gc_sweep_start_time_.load(std::memory_order_relaxed) > 0; }
+
+    // the time in ms since the unfinished sweep started, 0 if there is no unfinished sweep
+    uint64_t GetGcLag() const;
+
+    // the count of the lookups of a key checked by the pk filter, and the count of them which are
+    // answered by the filter without searching the key entries as the key does not exist
+    inline uint64_t GetPkLookupCnt() const { return pk_lookup_cnt_.load(std::memory_order_relaxed); }
+    inline uint64_t GetPkFilteredCnt() const { return pk_filtered_cnt_.load(std::memory_order_relaxed); }
+
+    // build the pk filter again from the keys if it is too full or most of its keys are removed,
+    // it is called by the gc thread after a sweep
+    void RebuildPkFilter();
+
+    // Pack the rows whose ts is not greater than time into cold blocks with at most max_row_cnt
+    // rows each. The key entries occupied by readers are skipped, and the replaced rows are
+    // released by GcFreeList later. The blocks are stored in layout if it is not NULL. If
+    // dict_size is not 0, the blocks are deflated with a dictionary of at most dict_size bytes,
+    // which is sampled from the rows of the first demote
+    void Demote(uint64_t time, uint32_t max_row_cnt, const ColdBlockLayout* layout, uint32_t dict_size,
+                uint64_t& demote_cnt,        // NOLINT
+                uint64_t& saved_byte_size);  // NOLINT
+
+    // Replace the rows of the schema versions other than version by the rows of upgrade, from the key where
+    // the last call stopped until max_row_cnt rows are replaced. The key entries occupied by readers are
+    // skipped, and the replaced rows are released by GcFreeList later. Return true if a sweep of the segment
+    // is finished and all of its rows are of version, then the later calls of the version return at once
+    bool Upgrade(uint8_t version, uint64_t max_row_cnt, const RowUpgrader& upgrade,
+                 uint64_t& upgrade_cnt);  // NOLINT
+
  private:
     void FreeList(::openmldb::base::Node<uint64_t, DataBlock*>* node, uint64_t& gc_idx_cnt,  // NOLINT
                   uint64_t& gc_record_cnt,         // NOLINT
                   uint64_t& gc_record_byte_size);  // NOLINT
     void SplitList(KeyEntry* entry, uint64_t ts, ::openmldb::base::Node<uint64_t, DataBlock*>** node);
 
+    // Put without holding the unique lock, mu_ should be held in shared mode.
+    // Return true if the key entry should grow or be trimmed
+    bool PutConcurrently(const Slice& key, uint64_t time, DataBlock* row);
+    void PutConcurrently(const Slice& key, const TSDimensions& ts_dimension, DataBlock* row);
+    // Find the key entry of key or insert a new one, byte_size is increased if inserted
+    void* GetOrInsertEntryConcurrently(const Slice& key, uint32_t* byte_size);
+    void FreeUnusedEntry(const Slice& key, void* entry);
+    // count the bytes of a pk node of the height and its key entries to the index or take them off, which are
+    // returned
+    uint32_t AddPkByteSize(uint8_t height, uint32_t key_size);
+    uint32_t SubPkByteSize(uint8_t height, uint32_t key_size);
+
+    // A key entry begins with a head of key_entry_init_height_ levels. The time entries of one level are a
+    // sorted list, which is enough for the keys with a few rows and saves the tower of the head. Once a key
+    // entry has more than key_entry_grow_cnt_ rows its head grows to key_entry_max_height_ levels, and the
+    // rows after it are indexed as a skiplist
+    inline KeyEntry* NewKeyEntry() const { return new KeyEntry(key_entry_max_height_, key_entry_init_height_); }
+    inline bool NeedGrow(KeyEntry* entry, uint64_t cnt) const {
+        return cnt > key_entry_grow_cnt_ && entry->entries.GetHeadHeight() < key_entry_max_height_;
+    }
+    // the bytes of the head more than a new key entry
+    inline uint32_t GetGrownByteSize(KeyEntry* entry) const {
+        return (entry->entries.GetHeadHeight() - key_entry_init_height_) * 8;
+    }
+    // mu_ should be held in unique mode, the replaced head is released by GcFreeList later
+    void GrowKeyEntry(KeyEntry* entry);
+    // grow or trim the key entries of key if they need, it holds mu_ in unique mode
+    void UpdateKeyEntry(const Slice& key);
+    void FreeRetiredHeads(uint64_t version);
+
+    inline bool NeedTrim(uint64_t cnt) const {
+        uint64_t keep_cnt = latest_keep_cnt_.load(std::memory_order_relaxed);
+        return keep_cnt > 0 && cnt > keep_cnt + latest_trim_slack_;
+    }
+    // cut the rows after the latest keep count off the key entry, mu_ should be held in unique mode.
+    // The rows are released by GcFreeList later as the other segments of the same rows are gc by the gc thread
+    void TrimKeyEntry(KeyEntry* entry);
+    // cut the rows of the ts range off the key entry at pos and remove the key if it has no row left, mu_ should
+    // be held in unique mode. It returns the count of the rows cut
+    uint64_t DeleteRange(const Slice& key, void* entry_or_arr, uint32_t pos, uint64_t start_ts, uint64_t end_ts);
+    // free the list cut off by the gc, or retire it to be freed once no reader started before is in progress
+    // with the epoch reclamation. The indexes are counted to gc_idx_cnt either way
+    void RetireList(::openmldb::base::Node<uint64_t, DataBlock*>* node, uint64_t& gc_idx_cnt,  // NOLINT
+                    uint64_t& gc_record_cnt, uint64_t& gc_record_byte_size);                   // NOLINT
+    void FreeRetiredList(uint64_t version, uint64_t& gc_record_cnt,  // NOLINT
+                         uint64_t& gc_record_byte_size);             // NOLINT
+    // the version the retired memory is stamped with, see GcFreeList
+    inline uint64_t GetRetireVersion() const {
+        return epoch_ != NULL ? epoch_->GetEpoch() : gc_version_.load(std::memory_order_relaxed);
+    }
+    void FreeTrimmedList(uint64_t& gc_idx_cnt,            // NOLINT
+                         uint64_t& gc_record_cnt,         // NOLINT
+                         uint64_t& gc_record_byte_size);  // NOLINT
+
     void GcEntryFreeList(uint64_t version, uint64_t& gc_idx_cnt,  // NOLINT
                          uint64_t& gc_record_cnt,                 // NOLINT
                          uint64_t& gc_record_byte_size);          // NOLINT
@@ -258,21 +473,146 @@ class Segment {
                    uint64_t& gc_record_cnt,         // NOLINT
                    uint64_t& gc_record_byte_size);  // NOLINT
 
+    void DemoteEntry(KeyEntry* entry, uint64_t time, uint32_t max_row_cnt, const ColdBlockLayout* layout,
+                     ColdBlockDict* dict,
+                     uint64_t& demote_cnt,        // NOLINT
+                     uint64_t& saved_byte_size);  // NOLINT
+    void PackRows(const std::vector<DataBlock**>& slots, const std::vector<DataBlock*>& rows,
+                  const ColdBlockLayout* layout, ColdBlockDict* dict,
+                  uint64_t& demote_cnt,        // NOLINT
+                  uint64_t& saved_byte_size);  // NOLINT
+    // sample the latest row to be demoted of every key until max_size bytes
+    ColdBlockDict* NewColdBlockDict(uint64_t time, uint32_t max_size);
+    void FreeDemotedList(uint64_t version);
+    // return false if some rows of the key entry are not upgraded
+    bool UpgradeEntry(KeyEntry* entry, uint8_t version, const RowUpgrader& upgrade,
+                      uint64_t& upgrade_cnt);  // NOLINT
+    // the replaced rows are counted as they are added to the table again by the upgrade
+    void FreeUpgradedList(uint64_t version, uint64_t& gc_record_cnt,  // NOLINT
+                          uint64_t& gc_record_byte_size);             // NOLINT
+
+    // gc the keys whose rows may be expired according to the expire index
+    void Gc4TTLByIndex(const uint64_t time, uint64_t& gc_idx_cnt,  // NOLINT
+                       uint64_t& gc_record_cnt,                    // NOLINT
+                       uint64_t& gc_record_byte_size);             // NOLINT
+    void GcEntry4TTL(const Slice& key, KeyEntry* entry, const uint64_t time,
+                     uint64_t& gc_idx_cnt,            // NOLINT
+                     uint64_t& gc_record_cnt,         // NOLINT
+                     uint64_t& gc_record_byte_size);  // NOLINT
+    // add the key to the bucket of time in the expire index
+    void IndexExpire(const Slice& key, uint64_t time);
+    // drop the expire index if the rows are not expired by the absolute ttl, then the next
+    // Gc4TTL visits all of the keys and builds the index again
+    void ResetExpireIndex();
+
+    void RecordHotKey(const Slice& key, uint64_t count);
+
+    // the key should be added to the pk filter before it is inserted into the key entries
+    inline void AddToPkFilter(const Slice& key) {
+        ::openmldb::base::BlockedBloomFilter* filter = pk_filter_.load(std::memory_order_acquire);
+        if (filter != nullptr) {
+            filter->Add(key);
+        }
+    }
+    // return false if the key is not in the segment for sure
+    bool MayContainPk(const Slice& key);
+
+    // the key entry or the key entry array of key found by the hash index if it is enabled, NULL if not found
+    inline void* FindEntry(const Slice& key) {
+        if (pk_index_) {
+            KeyEntryNode* node = pk_index_->Find(key);
+            return node == nullptr ? nullptr : node->GetValue();
+        }
+        void* entry = nullptr;
+        if (entries_->Get(key, entry) < 0) {
+            return nullptr;
+        }
+        return entry;
+    }
+    // insert the key into the key entries, the pk filter and the hash index, mu_ should be held in unique mode.
+    // The memory of key is owned by the segment then. Return the height of the node
+    uint8_t InsertEntry(const Slice& key, void* entry);
+    // remove the key from the key entries and the hash index, mu_ should be held in unique mode
+    KeyEntryNode* RemoveEntry(const Slice& key);
+
+    // the iterator begins with the key where the last gc slice stopped
+    KeyEntries::Iterator* NewGcIterator();
+    // return true and record the current key if the key budget of the gc slice is used up
+    bool PauseGc(KeyEntries::Iterator* it);
+
  private:
     KeyEntries* entries_;
-    // only Put need mutex
-    std::mutex mu_;
+    // Put holds it in shared mode if concurrent_put_ is enabled, otherwise in unique mode.
+    // Gc and Delete always hold it in unique mode
+    std::shared_mutex mu_;
+    bool concurrent_put_;
     std::mutex gc_mu_;
     std::atomic<uint64_t> idx_cnt_;
     std::atomic<uint64_t> idx_byte_size_;
+    // the parts of idx_byte_size_ of the pk nodes and the key entries, see GetMemStat
+    std::atomic<uint64_t> pk_node_byte_size_;
+    std::atomic<uint64_t> key_entry_byte_size_;
     std::atomic<uint64_t> pk_cnt_;
     uint8_t key_entry_max_height_;
+    uint32_t key_entry_grow_cnt_;
+    uint8_t key_entry_init_height_;
     KeyEntryNodeList* entry_free_list_;
     uint32_t ts_cnt_;
     std::atomic<uint64_t> gc_version_;
     std::map<uint32_t, uint32_t> ts_idx_map_;
     std::vector<std::shared_ptr<std::atomic<uint64_t>>> idx_cnt_vec_;
     uint64_t ttl_offset_;
+    // the rows replaced by cold blocks and the gc version when they are replaced, guarded by gc_mu_
+    std::vector<std::pair<uint64_t, DataBlock*>> demoted_free_list_;
+    // the rows replaced by Upgrade and the gc version when they are replaced, guarded by gc_mu_
+    std::vector<std::pair<uint64_t, DataBlock*>> upgraded_free_list_;
+    // the heads replaced by GrowKeyEntry and the gc version when they are replaced, guarded by gc_mu_
+    std::vector<std::pair<uint64_t, ::openmldb::base::Node<uint64_t, DataBlock*>*>> retired_head_list_;
+    // the dictionary of the cold blocks, only touched by the gc thread
+    ColdBlockDict* cold_dict_;
+    // the state of the incremental gc, which is only touched by the gc thread
+    uint32_t gc_key_budget_;
+    uint32_t gc_key_visited_;
+    bool gc_paused_;
+    std::string gc_cursor_;
+    std::atomic<uint64_t> gc_sweep_start_time_;
+    // the state of the upgrade of the rows, which is only touched by the gc thread. upgrade_version_ is the
+    // version of the current sweep or the last one, and upgrade_dirty_ tells some rows are not of it
+    uint8_t upgrade_version_;
+    bool upgrade_sweeping_;
+    bool upgrade_dirty_;
+    std::string upgrade_cursor_;
+    // the expire index maps the bucket of time to the keys which may have rows in the bucket,
+    // so Gc4TTL only visits the keys with expired rows. The time span of a bucket is
+    // expire_bucket_size_ in ms, and 0 means the index is disabled
+    std::mutex expire_mu_;
+    uint64_t expire_bucket_size_;
+    // some keys are not in the index, only touched by the gc thread
+    bool expire_index_dirty_;
+    std::map<uint64_t, std::unordered_set<std::string>> expire_index_;
+    // at most kMaxHotKeyCnt keys with the count of rows when they are recorded
+    std::mutex hot_key_mu_;
+    std::vector<std::pair<std::string, uint64_t>> hot_keys_;
+    // the bloom filter of the keys checked before searching the key entries, NULL if it is disabled.
+    // It is only replaced by RebuildPkFilter with mu_ held in unique mode, and the replaced one is
+    // kept until the next rebuild as the readers may still use it
+    uint32_t pk_filter_bits_per_key_;
+    std::atomic<::openmldb::base::BlockedBloomFilter*> pk_filter_;
+    std::unique_ptr<::openmldb::base::BlockedBloomFilter> retired_pk_filter_;
+    std::atomic<uint64_t> pk_lookup_cnt_;
+    std::atomic<uint64_t> pk_filtered_cnt_;
+    // the hash index of the keys for the point lookups, NULL if it is disabled
+    std::unique_ptr<PkHashIndex> pk_index_;
+    // see SetLatestKeepCnt, the lists cut off by the trimming are guarded by gc_mu_
+    uint32_t latest_trim_slack_;
+    std::atomic<uint64_t> latest_keep_cnt_;
+    std::vector<::openmldb::base::Node<uint64_t, DataBlock*>*> trimmed_list_;
+    // the retired memory is stamped with the epoch of it rather than gc_version_ and freed once the readers
+    // started before are finished, NULL if it is disabled. The lists cut off by the gc, which are freed at
+    // once without it, and the rows of the range deletes, which are stamped with gc_version_ without it, wait
+    // in retired_list_ guarded by gc_mu_
+    ::openmldb::base::EpochManager* epoch_;
+    std::vector<std::pair<uint64_t, ::openmldb::base::Node<uint64_t, DataBlock*>*>> retired_list_;
 };
 
 }  // namespace storage
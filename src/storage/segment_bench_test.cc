@@ -0,0 +1,91 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <iostream>
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "base/glog_wapper.h"
+#include "base/slice.h"
+#include "common/timer.h"
+#include "gflags/gflags.h"
+#include "gtest/gtest.h"
+#include "storage/segment.h"
+
+DECLARE_bool(enable_concurrent_put);
+DECLARE_int32(put_concurrency_limit);
+
+using ::openmldb::base::Slice;
+
+namespace openmldb {
+namespace storage {
+
+class SegmentBenchmarkTest : public ::testing::Test {
+ public:
+    SegmentBenchmarkTest() {}
+    ~SegmentBenchmarkTest() {}
+};
+
+static const uint32_t PUT_CNT_PER_THREAD = 100000;
+
+// every thread puts into the same few keys to simulate a hot key partition
+uint64_t RunContention(bool concurrent_put, uint32_t thread_num, uint32_t key_num) {
+    FLAGS_enable_concurrent_put = concurrent_put;
+    Segment segment(8);
+    std::vector<std::thread> threads;
+    uint64_t consumed = ::baidu::common::timer::get_micros();
+    for (uint32_t i = 0; i < thread_num; i++) {
+        threads.emplace_back([&segment, i, key_num] {
+            std::string value(100, 'a');
+            for (uint32_t j = 0; j < PUT_CNT_PER_THREAD; j++) {
+                std::string pk = "pk" + std::to_string(j % key_num);
+                segment.Put(Slice(pk), (uint64_t)j * 64 + i, value.c_str(), value.size());
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    consumed = ::baidu::common::timer::get_micros() - consumed;
+    EXPECT_EQ((uint64_t)thread_num * PUT_CNT_PER_THREAD, segment.GetIdxCnt());
+    EXPECT_EQ(key_num, segment.GetPkCnt());
+    segment.Release();
+    FLAGS_enable_concurrent_put = false;
+    return consumed;
+}
+
+TEST_F(SegmentBenchmarkTest, PutContention) {
+    std::vector<uint32_t> key_nums = {1, 16, 1024};
+    for (uint32_t key_num : key_nums) {
+        for (uint32_t thread_num = 1; thread_num <= (uint32_t)FLAGS_put_concurrency_limit; thread_num *= 2) {
+            uint64_t locked = RunContention(false, thread_num, key_num);
+            uint64_t lock_free = RunContention(true, thread_num, key_num);
+            std::cout << "key num " << key_num << " thread num " << thread_num << " mutex put consumed "
+                      << locked / 1000 << "ms, concurrent put consumed " << lock_free / 1000 << "ms" << std::endl;
+        }
+    }
+}
+
+}  // namespace storage
+}  // namespace openmldb
+
+int main(int argc, char** argv) {
+    ::openmldb::base::SetLogLevel(INFO);
+    ::testing::InitGoogleTest(&argc, argv);
+    ::google::ParseCommandLineFlags(&argc, &argv, true);
+    return RUN_ALL_TESTS();
+}
@@ -16,16 +16,30 @@
 
 #include "storage/segment.h"
 
+#include <algorithm>
 #include <iostream>
+#include <memory>
 #include <string>
+#include <thread>  // NOLINT
+#include <vector>
 
 #include "base/glog_wapper.h"  // NOLINT
 #include "base/slice.h"
+#include "codec/codec.h"
+#include "gflags/gflags.h"
 #include "gtest/gtest.h"
 #include "storage/record.h"
 
 using ::openmldb::base::Slice;
 
+DECLARE_bool(enable_concurrent_put);
+DECLARE_uint32(gc_expire_bucket_span);
+DECLARE_uint32(pk_bloom_filter_bits_per_key);
+DECLARE_bool(enable_pk_hash_index);
+DECLARE_uint32(latest_ttl_trim_slack);
+DECLARE_bool(enable_epoch_reclaim);
+DECLARE_uint32(gc_deleted_pk_version_delta);
+
 namespace openmldb {
 namespace storage {
 
@@ -179,6 +193,48 @@ TEST_F(SegmentTest, GetCount) {
     ASSERT_EQ(1, (int64_t)count);
 }
 
+TEST_F(SegmentTest, GetLiveCount) {
+    Segment segment;
+    Slice pk("test1");
+    for (uint64_t ts = 0; ts < 10; ts++) {
+        segment.Put(pk, ts, "test1", 5);
+    }
+    uint64_t count = 0;
+    ASSERT_EQ(-1, segment.GetLiveCount("test2", 0, 0, 0, TTLType::kAbsoluteTime, false, &count));
+    ASSERT_EQ(0, segment.GetLiveCount(pk, 0, 0, 0, TTLType::kAbsoluteTime, false, &count));
+    ASSERT_EQ(10, (int64_t)count);
+    ASSERT_EQ(0, segment.GetLiveCount(pk, 0, 0, 0, TTLType::kAbsoluteTime, true, &count));
+    ASSERT_EQ(9, (int64_t)count);
+    // the rows of ts 0 to 3 are expired
+    ASSERT_EQ(0, segment.GetLiveCount(pk, 0, 3, 0, TTLType::kAbsoluteTime, false, &count));
+    ASSERT_EQ(6, (int64_t)count);
+    ASSERT_EQ(0, segment.GetLiveCount(pk, 0, 0, 4, TTLType::kLatestTime, false, &count));
+    ASSERT_EQ(4, (int64_t)count);
+    ASSERT_EQ(0, segment.GetLiveCount(pk, 0, 0, 20, TTLType::kLatestTime, true, &count));
+    ASSERT_EQ(9, (int64_t)count);
+    ASSERT_EQ(0, segment.GetLiveCount(pk, 0, 3, 8, TTLType::kAbsAndLat, false, &count));
+    ASSERT_EQ(8, (int64_t)count);
+    ASSERT_EQ(0, segment.GetLiveCount(pk, 0, 3, 2, TTLType::kAbsAndLat, false, &count));
+    ASSERT_EQ(6, (int64_t)count);
+    ASSERT_EQ(0, segment.GetLiveCount(pk, 0, 3, 0, TTLType::kAbsAndLat, false, &count));
+    ASSERT_EQ(10, (int64_t)count);
+    ASSERT_EQ(0, segment.GetLiveCount(pk, 0, 3, 8, TTLType::kAbsOrLat, false, &count));
+    ASSERT_EQ(6, (int64_t)count);
+    ASSERT_EQ(0, segment.GetLiveCount(pk, 0, 3, 2, TTLType::kAbsOrLat, false, &count));
+    ASSERT_EQ(2, (int64_t)count);
+
+    // the count is kept by gc, the rows left are not expired any more
+    uint64_t gc_idx_cnt = 0;
+    uint64_t gc_record_cnt = 0;
+    uint64_t gc_record_byte_size = 0;
+    segment.Gc4TTL(3, gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
+    ASSERT_EQ(4, (int64_t)gc_idx_cnt);
+    ASSERT_EQ(0, segment.GetLiveCount(pk, 0, 3, 0, TTLType::kAbsoluteTime, false, &count));
+    ASSERT_EQ(6, (int64_t)count);
+    ASSERT_EQ(0, segment.GetLiveCount(pk, 0, 0, 0, TTLType::kAbsoluteTime, true, &count));
+    ASSERT_EQ(6, (int64_t)count);
+}
+
 TEST_F(SegmentTest, Iterator) {
     Segment segment;
     Slice pk("test1");
@@ -254,6 +310,360 @@ TEST_F(SegmentTest, TestGc4TTL) {
     ASSERT_EQ(2 * GetRecordSize(5), (int64_t)gc_record_byte_size);
 }
 
+TEST_F(SegmentTest, TestGc4TTLByIndex) {
+    FLAGS_gc_expire_bucket_span = 1;
+    Segment segment;
+    FLAGS_gc_expire_bucket_span = 0;
+    uint64_t minute = 60 * 1000;
+    for (int i = 0; i < 10; i++) {
+        std::string pk = "PK" + std::to_string(i);
+        segment.Put(Slice(pk), 100 * minute + i, "test1", 5);
+        segment.Put(Slice(pk), 200 * minute + i, "test2", 5);
+    }
+    uint64_t gc_idx_cnt = 0;
+    uint64_t gc_record_cnt = 0;
+    uint64_t gc_record_byte_size = 0;
+    {
+        // the entry occupied by reader is skipped and indexed again
+        Ticket ticket;
+        MemTableIterator* it = segment.NewIterator("PK0", ticket);
+        segment.Gc4TTL(150 * minute, gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
+        ASSERT_EQ(9, (int64_t)gc_idx_cnt);
+        delete it;
+    }
+    segment.Gc4TTL(150 * minute, gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
+    ASSERT_EQ(10, (int64_t)gc_idx_cnt);
+    ASSERT_EQ(10, (int64_t)segment.GetIdxCnt());
+    // the rows in the bucket of time are checked too
+    segment.Gc4TTL(200 * minute + 4, gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
+    ASSERT_EQ(15, (int64_t)gc_idx_cnt);
+    // the index is rebuilt after the gc of latest ttl
+    TTLSt ttl_st(0, 10, ::openmldb::storage::kLatestTime);
+    segment.ExecuteGc(ttl_st, gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
+    segment.Put(Slice("PK9"), 100 * minute, "test1", 5);
+    segment.Gc4TTL(300 * minute, gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
+    ASSERT_EQ(21, (int64_t)gc_idx_cnt);
+    ASSERT_EQ(0, (int64_t)segment.GetIdxCnt());
+}
+
+TEST_F(SegmentTest, TestGcSlice) {
+    Segment segment;
+    for (int i = 0; i < 10; i++) {
+        std::string pk = "PK" + std::to_string(i);
+        segment.Put(Slice(pk), 9768, "test1", 5);
+        segment.Put(Slice(pk), 9769, "test2", 5);
+    }
+    std::map<uint32_t, TTLSt> ttl_st_map;
+    ttl_st_map.emplace(0, TTLSt(0, 1, ::openmldb::storage::kLatestTime));
+    uint64_t gc_idx_cnt = 0;
+    uint64_t gc_record_cnt = 0;
+    uint64_t gc_record_byte_size = 0;
+    ASSERT_FALSE(segment.IsGcSweeping());
+    for (int i = 0; i < 3; i++) {
+        ASSERT_FALSE(segment.ExecuteGcSlice(ttl_st_map, 3, gc_idx_cnt, gc_record_cnt, gc_record_byte_size));
+        ASSERT_TRUE(segment.IsGcSweeping());
+        ASSERT_EQ(3 * (i + 1), (int64_t)gc_idx_cnt);
+    }
+    ASSERT_TRUE(segment.ExecuteGcSlice(ttl_st_map, 3, gc_idx_cnt, gc_record_cnt, gc_record_byte_size));
+    ASSERT_FALSE(segment.IsGcSweeping());
+    ASSERT_EQ(0u, segment.GetGcLag());
+    ASSERT_EQ(10, (int64_t)gc_idx_cnt);
+    ASSERT_EQ(10, (int64_t)segment.GetIdxCnt());
+    // the whole segment is visited if the key count is not limited
+    ASSERT_TRUE(segment.ExecuteGcSlice(ttl_st_map, 0, gc_idx_cnt, gc_record_cnt, gc_record_byte_size));
+    ASSERT_EQ(10, (int64_t)gc_idx_cnt);
+}
+
+TEST_F(SegmentTest, PkBloomFilter) {
+    FLAGS_pk_bloom_filter_bits_per_key = 10;
+    Segment segment(8);
+    FLAGS_pk_bloom_filter_bits_per_key = 0;
+    const int key_num = 3000;
+    for (int i = 0; i < key_num; i++) {
+        segment.Put(Slice("pk" + std::to_string(i)), 9768, "test1", 5);
+    }
+    DataBlock* block = NULL;
+    // the filter of an empty segment is too full to filter anything
+    ASSERT_FALSE(segment.Get(Slice("missing0"), 9768, &block));
+    ASSERT_EQ(1, (int64_t)segment.GetPkLookupCnt());
+    ASSERT_EQ(0, (int64_t)segment.GetPkFilteredCnt());
+    // the filter is built again after a sweep of gc
+    std::map<uint32_t, TTLSt> ttl_st_map;
+    ttl_st_map.emplace(0, TTLSt(0, 0, ::openmldb::storage::kLatestTime));
+    uint64_t gc_idx_cnt = 0;
+    uint64_t gc_record_cnt = 0;
+    uint64_t gc_record_byte_size = 0;
+    ASSERT_TRUE(segment.ExecuteGcSlice(ttl_st_map, 0, gc_idx_cnt, gc_record_cnt, gc_record_byte_size));
+    for (int i = 0; i < key_num; i++) {
+        ASSERT_TRUE(segment.Get(Slice("pk" + std::to_string(i)), 9768, &block));
+        ASSERT_EQ("test1", std::string(block->data, block->size));
+    }
+    ASSERT_EQ(0, (int64_t)segment.GetPkFilteredCnt());
+    for (int i = 0; i < key_num; i++) {
+        ASSERT_FALSE(segment.Get(Slice("missing" + std::to_string(i)), 9768, &block));
+    }
+    ASSERT_GT(segment.GetPkFilteredCnt(), (uint64_t)key_num * 9 / 10);
+    uint64_t count = 0;
+    ASSERT_EQ(0, segment.GetCount(Slice("pk1"), count));
+    ASSERT_EQ(1, (int64_t)count);
+    // the keys put after the rebuild are added to the filter
+    segment.Put(Slice("new_pk"), 9769, "test2", 5);
+    ASSERT_TRUE(segment.Get(Slice("new_pk"), 9769, &block));
+    Ticket ticket;
+    std::unique_ptr<MemTableIterator> it(segment.NewIterator(Slice("new_pk"), ticket));
+    it->SeekToFirst();
+    ASSERT_TRUE(it->Valid());
+    ASSERT_EQ(9769, (int64_t)it->GetKey());
+    segment.Release();
+}
+
+TEST_F(SegmentTest, PkHashIndex) {
+    FLAGS_enable_pk_hash_index = true;
+    Segment segment(8);
+    std::vector<uint32_t> ts_idx_vec = {1, 3};
+    Segment multi_ts_segment(8, ts_idx_vec);
+    FLAGS_enable_pk_hash_index = false;
+    const int key_num = 1000;
+    for (int i = 0; i < key_num; i++) {
+        std::string pk = "pk" + std::to_string(i);
+        segment.Put(Slice(pk), 9768, "test1", 5);
+        segment.Put(Slice(pk), 9769, "test2", 5);
+        TSDimensions ts_dimension;
+        auto* ts = ts_dimension.Add();
+        ts->set_ts(9768);
+        ts->set_idx(1);
+        ts = ts_dimension.Add();
+        ts->set_ts(9769);
+        ts->set_idx(3);
+        multi_ts_segment.Put(Slice(pk), ts_dimension, new DataBlock(2, "test3", 5));
+    }
+    ASSERT_EQ(key_num, (int64_t)segment.GetPkCnt());
+    DataBlock* block = NULL;
+    for (int i = 0; i < key_num; i++) {
+        std::string pk = "pk" + std::to_string(i);
+        ASSERT_TRUE(segment.Get(Slice(pk), 9769, &block));
+        ASSERT_EQ("test2", std::string(block->data, block->size));
+        ASSERT_TRUE(multi_ts_segment.Get(Slice(pk), 3, 9769, &block));
+        ASSERT_EQ("test3", std::string(block->data, block->size));
+        uint64_t count = 0;
+        ASSERT_EQ(0, segment.GetCount(Slice(pk), count));
+        ASSERT_EQ(2, (int64_t)count);
+    }
+    ASSERT_FALSE(segment.Get(Slice("missing"), 9769, &block));
+    // the deleted and the expired keys are removed from the hash index
+    ASSERT_TRUE(segment.Delete(Slice("pk0")));
+    ASSERT_FALSE(segment.Get(Slice("pk0"), 9769, &block));
+    uint64_t gc_idx_cnt = 0;
+    uint64_t gc_record_cnt = 0;
+    uint64_t gc_record_byte_size = 0;
+    segment.Gc4TTL(9770, gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
+    ASSERT_FALSE(segment.Get(Slice("pk1"), 9769, &block));
+    Ticket ticket;
+    std::unique_ptr<MemTableIterator> it(segment.NewIterator(Slice("pk1"), ticket));
+    it->SeekToFirst();
+    ASSERT_FALSE(it->Valid());
+    // a key is inserted again after it is removed
+    segment.Put(Slice("pk1"), 9771, "test4", 5);
+    ASSERT_TRUE(segment.Get(Slice("pk1"), 9771, &block));
+    ASSERT_EQ("test4", std::string(block->data, block->size));
+    segment.IncrGcVersion();
+    segment.IncrGcVersion();
+    segment.IncrGcVersion();
+    segment.GcFreeList(gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
+    ASSERT_EQ(1, (int64_t)segment.GetPkCnt());
+    segment.Release();
+    multi_ts_segment.Release();
+}
+
+TEST_F(SegmentTest, TestDemote) {
+    Segment segment;
+    for (uint64_t ts = 100; ts < 200; ts++) {
+        std::string value = std::string(64, 'a') + std::to_string(ts);
+        segment.Put("PK", ts, value.data(), value.size());
+    }
+    uint64_t demote_cnt = 0;
+    uint64_t saved_byte_size = 0;
+    {
+        // the entry occupied by reader is skipped
+        Ticket ticket;
+        MemTableIterator* it = segment.NewIterator("PK", ticket);
+        segment.Demote(149, 32, NULL, 0, demote_cnt, saved_byte_size);
+        ASSERT_EQ(0, (int64_t)demote_cnt);
+        delete it;
+    }
+    segment.Demote(149, 32, NULL, 0, demote_cnt, saved_byte_size);
+    ASSERT_EQ(50, (int64_t)demote_cnt);
+    ASSERT_GT(saved_byte_size, 0u);
+    // the rows have been packed
+    segment.Demote(149, 32, NULL, 0, demote_cnt, saved_byte_size);
+    ASSERT_EQ(50, (int64_t)demote_cnt);
+    segment.IncrGcVersion();
+    segment.IncrGcVersion();
+    segment.IncrGcVersion();
+    uint64_t gc_idx_cnt = 0;
+    uint64_t gc_record_cnt = 0;
+    uint64_t gc_record_byte_size = 0;
+    segment.GcFreeList(gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
+    {
+        Ticket ticket;
+        MemTableIterator* it = segment.NewIterator("PK", ticket);
+        it->SeekToFirst();
+        uint64_t ts = 199;
+        while (it->Valid()) {
+            ASSERT_EQ(ts, it->GetKey());
+            ASSERT_EQ(std::string(64, 'a') + std::to_string(ts), it->GetValue().ToString());
+            it->Next();
+            ts--;
+        }
+        ASSERT_EQ(99, (int64_t)ts);
+        delete it;
+    }
+    segment.Gc4TTL(119, gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
+    ASSERT_EQ(20, (int64_t)gc_idx_cnt);
+    ASSERT_EQ(20, (int64_t)gc_record_cnt);
+    ASSERT_EQ(80, (int64_t)segment.GetIdxCnt());
+}
+
+static std::string EncodeRow(const ::openmldb::codec::Schema& schema, uint64_t ts, uint8_t version) {
+    ::openmldb::codec::RowBuilder builder(schema);
+    std::string card = "card" + std::to_string(ts % 7);
+    std::string row(builder.CalTotalLength(card.size()), '\0');
+    builder.SetSchemaVersion(version);
+    builder.SetBuffer(reinterpret_cast<int8_t*>(&row[0]), row.size());
+    builder.AppendString(card.data(), card.size());
+    builder.AppendInt64(ts);
+    builder.AppendDouble(ts * 1.5);
+    builder.AppendInt32(ts % 3);
+    return row;
+}
+
+TEST_F(SegmentTest, TestColdBlockLayout) {
+    ::openmldb::codec::Schema schema;
+    auto add_column = [&schema](const std::string& name, ::openmldb::type::DataType type) {
+        auto column = schema.Add();
+        column->set_name(name);
+        column->set_data_type(type);
+    };
+    add_column("card", ::openmldb::type::kString);
+    add_column("ts", ::openmldb::type::kBigInt);
+    add_column("amt", ::openmldb::type::kDouble);
+    add_column("cnt", ::openmldb::type::kInt);
+    ColdBlockLayout layout;
+    ASSERT_TRUE(layout.Init(schema, 1));
+    ASSERT_EQ(5u, layout.widths.size());
+    ASSERT_EQ(6u + 1 + 8 + 8 + 4, layout.GetFixedSize());
+
+    std::vector<std::string> values;
+    std::vector<DataBlock*> rows;
+    std::string expect;
+    for (uint64_t ts = 100; ts < 164; ts++) {
+        values.push_back(EncodeRow(schema, ts, 1));
+        expect += values.back();
+    }
+    for (const auto& value : values) {
+        rows.push_back(new DataBlock(1, value.data(), value.size()));
+    }
+    ColdBlock* block = ColdBlock::New(rows, &layout);
+    ASSERT_TRUE(block != NULL);
+    ASSERT_TRUE(block->IsColumnar());
+    block->Ref();
+    std::string buf;
+    ASSERT_TRUE(block->Unpack(&buf));
+    ASSERT_EQ(expect, buf);
+    ASSERT_EQ(values[10].size(), block->GetRowOffset(11) - block->GetRowOffset(10));
+    block->UnRef();
+
+    // the rows of another schema version are stored one after another
+    std::string other = EncodeRow(schema, 99, 2);
+    DataBlock* other_block = new DataBlock(1, other.data(), other.size());
+    rows.push_back(other_block);
+    block = ColdBlock::New(rows, &layout);
+    ASSERT_TRUE(block != NULL);
+    ASSERT_FALSE(block->IsColumnar());
+    block->Ref();
+    buf.clear();
+    ASSERT_TRUE(block->Unpack(&buf));
+    ASSERT_EQ(expect + other, buf);
+    block->UnRef();
+    for (auto row : rows) {
+        delete row;
+    }
+}
+
+TEST_F(SegmentTest, TestDemoteColumnar) {
+    ::openmldb::codec::Schema schema;
+    for (auto type : {::openmldb::type::kString, ::openmldb::type::kBigInt, ::openmldb::type::kDouble,
+                      ::openmldb::type::kInt}) {
+        auto column = schema.Add();
+        column->set_name("col" + std::to_string(schema.size()));
+        column->set_data_type(type);
+    }
+    ColdBlockLayout layout;
+    ASSERT_TRUE(layout.Init(schema, 1));
+    Segment segment;
+    for (uint64_t ts = 100; ts < 200; ts++) {
+        std::string value = EncodeRow(schema, ts, 1);
+        segment.Put("PK", ts, value.data(), value.size());
+    }
+    uint64_t demote_cnt = 0;
+    uint64_t saved_byte_size = 0;
+    segment.Demote(149, 32, &layout, 0, demote_cnt, saved_byte_size);
+    ASSERT_EQ(50, (int64_t)demote_cnt);
+    ASSERT_GT(saved_byte_size, 0u);
+    Ticket ticket;
+    MemTableIterator* it = segment.NewIterator("PK", ticket);
+    it->SeekToFirst();
+    uint64_t ts = 199;
+    while (it->Valid()) {
+        ASSERT_EQ(ts, it->GetKey());
+        ASSERT_EQ(EncodeRow(schema, ts, 1), it->GetValue().ToString());
+        it->Next();
+        ts--;
+    }
+    ASSERT_EQ(99, (int64_t)ts);
+    delete it;
+}
+
+TEST_F(SegmentTest, TestDemoteWithDict) {
+    // a few rows of every key, which share the most of their bytes with the other keys
+    auto get_value = [](uint32_t key, uint64_t ts) {
+        return "{\"channel\":\"mobile\",\"city\":\"beijing\",\"device\":\"android\",\"user\":" +
+               std::to_string(key) + ",\"ts\":" + std::to_string(ts) + "}";
+    };
+    Segment plain_segment;
+    Segment segment;
+    for (uint32_t key = 0; key < 100; key++) {
+        std::string pk = "PK" + std::to_string(key);
+        for (uint64_t ts = 100; ts < 104; ts++) {
+            std::string value = get_value(key, ts);
+            plain_segment.Put(Slice(pk), ts, value.data(), value.size());
+            segment.Put(Slice(pk), ts, value.data(), value.size());
+        }
+    }
+    uint64_t plain_demote_cnt = 0;
+    uint64_t plain_saved_byte_size = 0;
+    plain_segment.Demote(149, 32, NULL, 0, plain_demote_cnt, plain_saved_byte_size);
+    uint64_t demote_cnt = 0;
+    uint64_t saved_byte_size = 0;
+    segment.Demote(149, 32, NULL, 4096, demote_cnt, saved_byte_size);
+    ASSERT_EQ(400, (int64_t)demote_cnt);
+    ASSERT_GT(saved_byte_size, plain_saved_byte_size);
+    for (uint32_t key = 0; key < 100; key++) {
+        Ticket ticket;
+        MemTableIterator* it = segment.NewIterator("PK" + std::to_string(key), ticket);
+        it->SeekToFirst();
+        uint64_t ts = 103;
+        while (it->Valid()) {
+            ASSERT_EQ(ts, it->GetKey());
+            ASSERT_EQ(get_value(key, ts), it->GetValue().ToString());
+            it->Next();
+            ts--;
+        }
+        ASSERT_EQ(99, (int64_t)ts);
+        delete it;
+    }
+}
+
 TEST_F(SegmentTest, TestGc4TTLAndHead) {
     Segment segment;
     segment.Put("PK1", 9766, "test1", 5);
@@ -413,6 +823,417 @@ TEST_F(SegmentTest, PutAndGetTS) {
     ASSERT_EQ(e, t);
 }
 
+TEST_F(SegmentTest, BulkLoad) {
+    Segment segment(8);
+    std::vector<std::pair<uint64_t, DataBlock*>> rows;
+    for (uint64_t ts = 1; ts <= 10; ts++) {
+        rows.emplace_back(ts, new DataBlock(1, "test1", 5));
+    }
+    segment.BulkLoad(0, Slice("pk1"), &rows);
+    // the rows of an existing key are inserted into its time list
+    rows.clear();
+    rows.emplace_back(20, new DataBlock(1, "test2", 5));
+    rows.emplace_back(15, new DataBlock(1, "test2", 5));
+    segment.BulkLoad(0, Slice("pk1"), &rows);
+    ASSERT_EQ(1, (int64_t)segment.GetPkCnt());
+    ASSERT_EQ(12, (int64_t)segment.GetIdxCnt());
+    uint64_t count = 0;
+    ASSERT_EQ(0, segment.GetCount(Slice("pk1"), count));
+    ASSERT_EQ(12, (int64_t)count);
+    DataBlock* block = NULL;
+    ASSERT_TRUE(segment.Get(Slice("pk1"), 15, &block));
+    ASSERT_EQ("test2", std::string(block->data, block->size));
+    Ticket ticket;
+    std::unique_ptr<MemTableIterator> it(segment.NewIterator(Slice("pk1"), ticket));
+    it->SeekToFirst();
+    std::vector<uint64_t> ts_vec;
+    while (it->Valid()) {
+        ts_vec.push_back(it->GetKey());
+        it->Next();
+    }
+    ASSERT_EQ(12, (int64_t)ts_vec.size());
+    ASSERT_EQ(20, (int64_t)ts_vec.front());
+    ASSERT_EQ(1, (int64_t)ts_vec.back());
+    ASSERT_TRUE(std::is_sorted(ts_vec.rbegin(), ts_vec.rend()));
+    segment.Release();
+}
+
+TEST_F(SegmentTest, BulkLoadMultiTs) {
+    std::vector<uint32_t> ts_idx_vec = {1, 3};
+    Segment segment(8, ts_idx_vec);
+    std::vector<std::pair<uint64_t, DataBlock*>> rows;
+    std::vector<DataBlock*> blocks;
+    for (uint64_t ts = 1; ts <= 5; ts++) {
+        blocks.push_back(new DataBlock(2, "test1", 5));
+        rows.emplace_back(ts, blocks.back());
+    }
+    segment.BulkLoad(1, Slice("pk1"), &rows);
+    rows.clear();
+    for (uint64_t ts = 1; ts <= 5; ts++) {
+        rows.emplace_back(ts + 100, blocks[ts - 1]);
+    }
+    segment.BulkLoad(0, Slice("pk1"), &rows);
+    ASSERT_EQ(1, (int64_t)segment.GetPkCnt());
+    uint64_t count = 0;
+    ASSERT_EQ(0, segment.GetIdxCnt(1, count));
+    ASSERT_EQ(5, (int64_t)count);
+    ASSERT_EQ(0, segment.GetIdxCnt(3, count));
+    ASSERT_EQ(5, (int64_t)count);
+    DataBlock* block = NULL;
+    ASSERT_TRUE(segment.Get(Slice("pk1"), 3, 3, &block));
+    ASSERT_TRUE(segment.Get(Slice("pk1"), 1, 103, &block));
+    ASSERT_FALSE(segment.Get(Slice("pk1"), 1, 3, &block));
+    segment.Release();
+}
+
+TEST_F(SegmentTest, PutConcurrently) {
+    FLAGS_enable_concurrent_put = true;
+    Segment segment(8);
+    std::vector<std::thread> threads;
+    for (uint32_t i = 0; i < 4; i++) {
+        threads.emplace_back([&segment, i] {
+            for (uint32_t j = 0; j < 1000; j++) {
+                std::string pk = "pk" + std::to_string(j % 10);
+                segment.Put(Slice(pk), i * 1000 + j, "test1", 5);
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    ASSERT_EQ(10, (int64_t)segment.GetPkCnt());
+    ASSERT_EQ(4000, (int64_t)segment.GetIdxCnt());
+    uint64_t count = 0;
+    ASSERT_EQ(0, segment.GetCount("pk0", count));
+    ASSERT_EQ(400, (int64_t)count);
+    {
+        // release the ticket before gc, or the entry is skipped
+        Ticket ticket;
+        MemTableIterator* it = segment.NewIterator("pk0", ticket);
+        it->SeekToFirst();
+        uint64_t pre_ts = UINT64_MAX;
+        uint64_t cnt = 0;
+        while (it->Valid()) {
+            ASSERT_LT(it->GetKey(), pre_ts);
+            pre_ts = it->GetKey();
+            cnt++;
+            it->Next();
+        }
+        ASSERT_EQ(400, (int64_t)cnt);
+        delete it;
+    }
+    uint64_t gc_idx_cnt = 0;
+    uint64_t gc_record_cnt = 0;
+    uint64_t gc_record_byte_size = 0;
+    segment.Gc4Head(1, gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
+    ASSERT_EQ(3990, (int64_t)gc_idx_cnt);
+    FLAGS_enable_concurrent_put = false;
+}
+
+TEST_F(SegmentTest, PutConcurrentlyMultiTs) {
+    FLAGS_enable_concurrent_put = true;
+    std::vector<uint32_t> ts_idx_vec = {1, 3};
+    Segment segment(8, ts_idx_vec);
+    std::vector<std::thread> threads;
+    for (uint32_t i = 0; i < 4; i++) {
+        threads.emplace_back([&segment, i] {
+            for (uint32_t j = 0; j < 1000; j++) {
+                TSDimensions ts_dimension;
+                auto* ts = ts_dimension.Add();
+                ts->set_ts(i * 1000 + j);
+                ts->set_idx(1);
+                ts = ts_dimension.Add();
+                ts->set_ts(i * 1000 + j);
+                ts->set_idx(3);
+                std::string pk = "pk" + std::to_string(j % 10);
+                segment.Put(Slice(pk), ts_dimension, new DataBlock(2, "test1", 5));
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    ASSERT_EQ(10, (int64_t)segment.GetPkCnt());
+    uint64_t count = 0;
+    ASSERT_EQ(0, segment.GetIdxCnt(1, count));
+    ASSERT_EQ(4000, (int64_t)count);
+    ASSERT_EQ(0, segment.GetCount("pk5", 3, count));
+    ASSERT_EQ(400, (int64_t)count);
+    FLAGS_enable_concurrent_put = false;
+}
+
+TEST_F(SegmentTest, GrowKeyEntry) {
+    Segment segment(8);
+    for (uint64_t ts = 1; ts <= 3; ts++) {
+        segment.Put(Slice("small"), ts, "test1", 5);
+    }
+    uint64_t small_idx_byte_size = segment.GetIdxByteSize();
+    for (uint64_t ts = 1; ts <= 100; ts++) {
+        segment.Put(Slice("big"), ts, "test2", 5);
+    }
+    void* value = NULL;
+    ASSERT_EQ(0, segment.GetKeyEntries()->Get(Slice("small"), value));
+    // a few rows are kept in a list without the tower of the head
+    ASSERT_EQ(1, reinterpret_cast<KeyEntry*>(value)->entries.GetHeadHeight());
+    ASSERT_EQ(0, segment.GetKeyEntries()->Get(Slice("big"), value));
+    ASSERT_EQ(8, reinterpret_cast<KeyEntry*>(value)->entries.GetHeadHeight());
+    ASSERT_GT(segment.GetIdxByteSize() - small_idx_byte_size, 100 * GetRecordTsIdxSize(1) + 7 * 8);
+    {
+        Ticket ticket;
+        MemTableIterator* it = segment.NewIterator("big", ticket);
+        it->SeekToFirst();
+        for (uint64_t ts = 100; ts >= 1; ts--) {
+            ASSERT_TRUE(it->Valid());
+            ASSERT_EQ(ts, it->GetKey());
+            it->Next();
+        }
+        ASSERT_FALSE(it->Valid());
+        it->Seek(5);
+        ASSERT_TRUE(it->Valid());
+        ASSERT_EQ(5u, it->GetKey());
+        delete it;
+    }
+    DataBlock* block = NULL;
+    ASSERT_TRUE(segment.Get(Slice("big"), 2, &block));
+    ASSERT_EQ("test2", std::string(block->data, block->size));
+    uint64_t gc_idx_cnt = 0;
+    uint64_t gc_record_cnt = 0;
+    uint64_t gc_record_byte_size = 0;
+    segment.Gc4Head(2, gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
+    ASSERT_EQ(99, (int64_t)gc_idx_cnt);
+    for (int i = 0; i < 5; i++) {
+        segment.IncrGcVersion();
+        segment.GcFreeList(gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
+    }
+    uint64_t count = 0;
+    ASSERT_EQ(0, segment.GetCount("big", count));
+    ASSERT_EQ(2u, count);
+    ASSERT_EQ(0, segment.GetCount("small", count));
+    ASSERT_EQ(2u, count);
+}
+
+TEST_F(SegmentTest, DeleteRange) {
+    Segment segment(8);
+    for (uint64_t ts = 1; ts <= 10; ts++) {
+        segment.Put(Slice("pk1"), ts, "test1", 5);
+        segment.Put(Slice("pk2"), ts, "test1", 5);
+    }
+    ASSERT_FALSE(segment.Delete(Slice("pk3"), 0, 5, 3));
+    ASSERT_TRUE(segment.Delete(Slice("pk1"), 0, 5, 3));
+    uint64_t count = 0;
+    ASSERT_EQ(0, segment.GetCount("pk1", count));
+    ASSERT_EQ(7u, count);
+    ASSERT_EQ(17u, segment.GetIdxCnt());
+    std::vector<uint64_t> expect = {10, 9, 8, 7, 6, 2, 1};
+    std::vector<uint64_t> keys;
+    {
+        Ticket ticket;
+        std::unique_ptr<MemTableIterator> it(segment.NewIterator("pk1", ticket));
+        for (it->SeekToFirst(); it->Valid(); it->Next()) {
+            keys.push_back(it->GetKey());
+        }
+    }
+    ASSERT_EQ(expect, keys);
+    // the rows of all the keys, the keys with no row left are removed
+    ASSERT_EQ(10u, segment.Delete(0, 10, 6));
+    ASSERT_EQ(7u, segment.GetIdxCnt());
+    ASSERT_EQ(0, segment.GetCount("pk2", count));
+    ASSERT_EQ(5u, count);
+    ASSERT_TRUE(segment.Delete(Slice("pk1"), 0, 2, 1));
+    ASSERT_EQ(-1, segment.GetCount("pk1", count));
+    ASSERT_EQ(0, segment.GetCount("pk2", count));
+    ASSERT_EQ(5u, count);
+    // the rows are freed by the gc thread later
+    uint64_t gc_idx_cnt = 0;
+    uint64_t gc_record_cnt = 0;
+    uint64_t gc_record_byte_size = 0;
+    segment.GcFreeList(gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
+    ASSERT_EQ(0u, gc_record_cnt);
+    for (uint32_t i = 0; i < FLAGS_gc_deleted_pk_version_delta; i++) {
+        segment.IncrGcVersion();
+    }
+    segment.GcFreeList(gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
+    ASSERT_EQ(15u, gc_record_cnt);
+
+    std::vector<uint32_t> ts_idx_vec = {1, 3};
+    Segment segment1(8, ts_idx_vec);
+    for (uint64_t ts = 1; ts <= 10; ts++) {
+        ::openmldb::api::LogEntry entry;
+        for (uint32_t idx : ts_idx_vec) {
+            ::openmldb::api::TSDimension* ts_dimension = entry.add_ts_dimensions();
+            ts_dimension->set_ts(ts * idx);
+            ts_dimension->set_idx(idx);
+        }
+        segment1.Put(Slice("pk"), entry.ts_dimensions(), new DataBlock(2, "test1", 5));
+    }
+    ASSERT_FALSE(segment1.Delete(Slice("pk"), 2, 10, 1));
+    ASSERT_TRUE(segment1.Delete(Slice("pk"), 3, 30, 12));
+    ASSERT_EQ(0, segment1.GetCount("pk", 3, count));
+    ASSERT_EQ(3u, count);
+    ASSERT_EQ(0, segment1.GetCount("pk", 1, count));
+    ASSERT_EQ(10u, count);
+    ASSERT_EQ(10u, segment1.Delete(1, 10, 1));
+    // the key is kept as it still has the rows of the other ts
+    ASSERT_EQ(0, segment1.GetCount("pk", 3, count));
+    ASSERT_EQ(3u, count);
+    for (uint32_t i = 0; i < FLAGS_gc_deleted_pk_version_delta; i++) {
+        segment1.IncrGcVersion();
+    }
+    gc_record_cnt = 0;
+    segment1.GcFreeList(gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
+    // the rows of both ts deleted
+    ASSERT_EQ(7u, gc_record_cnt);
+}
+
+TEST_F(SegmentTest, TrimLatest) {
+    FLAGS_latest_ttl_trim_slack = 4;
+    Segment segment(8);
+    FLAGS_latest_ttl_trim_slack = 0;
+    segment.SetLatestKeepCnt(2);
+    ASSERT_EQ(2u, segment.GetLatestKeepCnt());
+    for (uint64_t ts = 1; ts <= 100; ts++) {
+        segment.Put(Slice("pk"), ts, "test1", 5);
+        uint64_t count = 0;
+        ASSERT_EQ(0, segment.GetCount("pk", count));
+        ASSERT_LE(count, 6u);
+    }
+    // the trimmed rows are released by the gc thread
+    uint64_t gc_idx_cnt = 0;
+    uint64_t gc_record_cnt = 0;
+    uint64_t gc_record_byte_size = 0;
+    segment.GcFreeList(gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
+    uint64_t count = 0;
+    ASSERT_EQ(0, segment.GetCount("pk", count));
+    ASSERT_EQ(100u, gc_record_cnt + count);
+    ASSERT_EQ(count, segment.GetIdxCnt());
+    // the key is not visited by the gc
+    uint64_t gc_cnt = gc_record_cnt;
+    segment.ExecuteGc(TTLSt(0, 2, ::openmldb::storage::TTLType::kLatestTime), gc_idx_cnt, gc_record_cnt,
+                      gc_record_byte_size);
+    ASSERT_EQ(gc_cnt, gc_record_cnt);
+    Ticket ticket;
+    MemTableIterator* it = segment.NewIterator("pk", ticket);
+    it->SeekToFirst();
+    ASSERT_TRUE(it->Valid());
+    ASSERT_EQ(100u, it->GetKey());
+    it->Next();
+    ASSERT_TRUE(it->Valid());
+    ASSERT_EQ(99u, it->GetKey());
+    delete it;
+    // it is left to the gc if the trimming is disabled
+    Segment segment2(8);
+    segment2.SetLatestKeepCnt(2);
+    ASSERT_EQ(0u, segment2.GetLatestKeepCnt());
+}
+
+TEST_F(SegmentTest, EpochReclaim) {
+    FLAGS_enable_epoch_reclaim = true;
+    Segment segment(8);
+    for (uint64_t ts = 1; ts <= 10; ts++) {
+        segment.Put(Slice("pk1"), ts, "test1", 5);
+        segment.Put(Slice("pk2"), ts, "test2", 5);
+    }
+    uint64_t gc_idx_cnt = 0;
+    uint64_t gc_record_cnt = 0;
+    uint64_t gc_record_byte_size = 0;
+    {
+        Ticket ticket;
+        MemTableIterator* it = segment.NewIterator("pk1", ticket);
+        it->Seek(3);
+        // the key of the reader is not skipped by the gc
+        segment.Gc4Head(2, gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
+        ASSERT_EQ(16u, gc_idx_cnt);
+        ASSERT_EQ(0u, gc_record_cnt);
+        ASSERT_TRUE(segment.Delete(Slice("pk2")));
+        for (int i = 0; i < 5; i++) {
+            segment.GcFreeList(gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
+        }
+        ASSERT_EQ(0u, gc_record_cnt);
+        // the rows cut off are still readable by the reader
+        for (uint64_t ts = 3; ts >= 1; ts--) {
+            ASSERT_TRUE(it->Valid());
+            ASSERT_EQ(ts, it->GetKey());
+            ASSERT_EQ("test1", it->GetValue().ToString());
+            it->Next();
+        }
+        ASSERT_FALSE(it->Valid());
+        delete it;
+    }
+    // freed at once after the reader finishes
+    segment.GcFreeList(gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
+    FLAGS_enable_epoch_reclaim = false;
+    ASSERT_EQ(18u, gc_record_cnt);
+    ASSERT_EQ(2u, segment.GetIdxCnt());
+    uint64_t count = 0;
+    ASSERT_EQ(0, segment.GetCount("pk1", count));
+    ASSERT_EQ(2u, count);
+    ASSERT_EQ(-1, segment.GetCount("pk2", count));
+}
+
+TEST_F(SegmentTest, MemStat) {
+    Segment segment(8);
+    for (uint64_t ts = 1; ts <= 3; ts++) {
+        segment.Put(Slice("small"), ts, "test1", 5);
+    }
+    for (uint64_t ts = 1; ts <= 100; ts++) {
+        segment.Put(Slice("big"), ts, "test2", 5);
+    }
+    SegmentMemStat stat;
+    segment.GetMemStat(&stat);
+    ASSERT_GE(stat.pk_node_byte_size, GetRecordPkNodeSize(1, 5) + GetRecordPkNodeSize(1, 3));
+    // the head of big grows to 8 levels
+    ASSERT_EQ(2 * GetRecordKeyEntrySize(1, 1) + 7 * 8, stat.key_entry_byte_size);
+    ASSERT_GE(stat.ts_node_byte_size, 103 * GetRecordTsIdxSize(1));
+    ASSERT_EQ(segment.GetIdxByteSize(), stat.pk_node_byte_size + stat.key_entry_byte_size + stat.ts_node_byte_size +
+                                            stat.pk_index_byte_size);
+    uint64_t gc_idx_cnt = 0;
+    uint64_t gc_record_cnt = 0;
+    uint64_t gc_record_byte_size = 0;
+    segment.Gc4TTL(1000, gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
+    for (int i = 0; i < 5; i++) {
+        segment.IncrGcVersion();
+        segment.GcFreeList(gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
+    }
+    ASSERT_EQ(0u, segment.GetPkCnt());
+    SegmentMemStat gc_stat;
+    segment.GetMemStat(&gc_stat);
+    ASSERT_EQ(0u, gc_stat.pk_node_byte_size);
+    ASSERT_EQ(0u, gc_stat.key_entry_byte_size);
+    ASSERT_EQ(0u, gc_stat.ts_node_byte_size);
+}
+
+TEST_F(SegmentTest, HotKeys) {
+    Segment segment(8);
+    for (uint64_t i = 0; i < 3000; i++) {
+        segment.Put("hot", 10000 + i, "test1", 5);
+    }
+    for (uint64_t i = 0; i < 100; i++) {
+        segment.Put("pk" + std::to_string(i), 10000, "test1", 5);
+    }
+    std::vector<std::pair<std::string, uint64_t>> hot_keys;
+    segment.GetHotKeys(&hot_keys);
+    ASSERT_EQ(1u, hot_keys.size());
+    ASSERT_EQ("hot", hot_keys[0].first);
+    ASSERT_EQ(3000, (int64_t)hot_keys[0].second);
+    uint64_t gc_idx_cnt = 0;
+    uint64_t gc_record_cnt = 0;
+    uint64_t gc_record_byte_size = 0;
+    segment.GcHotKeys(500, gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
+    ASSERT_EQ(2500, (int64_t)gc_idx_cnt);
+    ASSERT_EQ(2500, (int64_t)gc_record_cnt);
+    ASSERT_EQ(600, (int64_t)segment.GetIdxCnt());
+    uint64_t count = 0;
+    ASSERT_EQ(0, segment.GetCount("hot", count));
+    ASSERT_EQ(500, (int64_t)count);
+    DataBlock* block = NULL;
+    ASSERT_TRUE(segment.Get("hot", 12999, &block));
+    ASSERT_FALSE(segment.Get("hot", 10000, &block));
+    hot_keys.clear();
+    segment.GetHotKeys(&hot_keys);
+    ASSERT_EQ(1u, hot_keys.size());
+    ASSERT_EQ(500, (int64_t)hot_keys[0].second);
+}
+
 }  // namespace storage
 }  // namespace openmldb
 
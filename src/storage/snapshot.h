@@ -16,6 +16,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <memory>
 #include <string>
 
@@ -28,7 +29,8 @@ namespace storage {
 
 class Snapshot {
  public:
-    Snapshot(uint32_t tid, uint32_t pid) : tid_(tid), pid_(pid), offset_(0), making_snapshot_(false) {}
+    Snapshot(uint32_t tid, uint32_t pid)
+        : tid_(tid), pid_(pid), offset_(0), making_snapshot_(false), recovered_cnt_(0), recover_expect_cnt_(0) {}
     virtual ~Snapshot() = default;
     virtual bool Init() = 0;
     virtual int MakeSnapshot(std::shared_ptr<Table> table,
@@ -37,7 +39,11 @@ class Snapshot {
     virtual bool Recover(std::shared_ptr<Table> table,
                          uint64_t& latest_offset) = 0;  // NOLINT
     uint64_t GetOffset() { return offset_; }
+    // the progress of Recover, the count of records loaded and the count recorded in manifest
+    uint64_t GetRecoveredCnt() const { return recovered_cnt_.load(std::memory_order_relaxed); }
+    uint64_t GetRecoverExpectCnt() const { return recover_expect_cnt_.load(std::memory_order_relaxed); }
     int GenManifest(const std::string& snapshot_name, uint64_t key_count, uint64_t offset, uint64_t term);
+    int GenManifest(const ::openmldb::api::Manifest& manifest);
     static int GetLocalManifest(const std::string& full_path,
                                 ::openmldb::api::Manifest& manifest);  // NOLINT
 
@@ -47,6 +53,8 @@ class Snapshot {
     uint64_t offset_;
     std::atomic<bool> making_snapshot_;
     std::string snapshot_path_;
+    std::atomic<uint64_t> recovered_cnt_;
+    std::atomic<uint64_t> recover_expect_cnt_;
 };
 
 }  // namespace storage
@@ -23,11 +23,15 @@
 #include <time.h>
 #include <unistd.h>
 
+#include <fstream>
 #include <iostream>
+#include <memory>
+#include <set>
 
 #include "base/file_util.h"
 #include "base/glog_wapper.h"
 #include "base/strings.h"
+#include "codec/row_codec.h"
 #include "codec/schema_codec.h"
 #include "common/timer.h"
 #include "gtest/gtest.h"
@@ -40,6 +44,10 @@
 
 DECLARE_string(db_root_path);
 DECLARE_string(snapshot_compression);
+DECLARE_bool(snapshot_mmap);
+DECLARE_uint32(binlog_replay_thread_num);
+DECLARE_uint32(extract_index_thread_num);
+DECLARE_uint32(snapshot_delta_max_num);
 
 using ::openmldb::api::LogEntry;
 namespace openmldb {
@@ -351,6 +359,185 @@ TEST_F(SnapshotTest, Recover_only_binlog) {
     ASSERT_FALSE(it->Valid());
 }
 
+TEST_F(SnapshotTest, Recover_binlog_parallel) {
+    std::string binlog_dir = FLAGS_db_root_path + "/7_1/binlog/";
+    LogParts* log_part = new LogParts(12, 4, scmp);
+    uint64_t offset = 0;
+    uint32_t binlog_index = 0;
+    WriteHandle* wh = NULL;
+    RollWLogFile(&wh, log_part, binlog_dir, binlog_index, offset);
+    for (int count = 0; count < 1000; count++) {
+        offset++;
+        ::openmldb::api::LogEntry entry;
+        entry.set_log_index(offset);
+        entry.set_pk("key" + std::to_string(count % 50));
+        entry.set_ts(count);
+        entry.set_value("value" + std::to_string(count));
+        std::string buffer;
+        entry.SerializeToString(&buffer);
+        ASSERT_TRUE(wh->Write(::openmldb::base::Slice(buffer)).ok());
+        if (count == 500) {
+            // the rows of key7 put before are deleted
+            offset++;
+            ::openmldb::api::LogEntry delete_entry;
+            delete_entry.set_log_index(offset);
+            delete_entry.set_method_type(::openmldb::api::MethodType::kDelete);
+            ::openmldb::api::Dimension* dimension = delete_entry.add_dimensions();
+            dimension->set_key("key7");
+            dimension->set_idx(0);
+            delete_entry.SerializeToString(&buffer);
+            ASSERT_TRUE(wh->Write(::openmldb::base::Slice(buffer)).ok());
+        }
+    }
+    wh->Sync();
+    std::map<std::string, uint32_t> mapping;
+    mapping.insert(std::make_pair("idx0", 0));
+    std::shared_ptr<MemTable> table =
+        std::make_shared<MemTable>("test", 7, 1, 8, mapping, 0, ::openmldb::type::TTLType::kAbsoluteTime);
+    table->Init();
+    FLAGS_binlog_replay_thread_num = 4;
+    uint64_t latest_offset = 0;
+    Binlog binlog(log_part, binlog_dir);
+    ASSERT_TRUE(binlog.RecoverFromBinlog(table, 0, latest_offset));
+    FLAGS_binlog_replay_thread_num = 1;
+    ASSERT_EQ(1001u, latest_offset);
+    Ticket ticket;
+    TableIterator* it = table->NewIterator("key7", ticket);
+    it->SeekToFirst();
+    uint32_t cnt = 0;
+    while (it->Valid()) {
+        ASSERT_GT(it->GetKey(), 500u);
+        cnt++;
+        it->Next();
+    }
+    ASSERT_EQ(10u, cnt);
+    delete it;
+    it = table->NewIterator("key8", ticket);
+    it->SeekToFirst();
+    cnt = 0;
+    while (it->Valid()) {
+        cnt++;
+        it->Next();
+    }
+    ASSERT_EQ(20u, cnt);
+    delete it;
+}
+
+uint32_t CountRows(std::shared_ptr<Table> table, const std::string& key) {
+    Ticket ticket;
+    TableIterator* it = table->NewIterator(key, ticket);
+    it->SeekToFirst();
+    uint32_t cnt = 0;
+    while (it->Valid()) {
+        cnt++;
+        it->Next();
+    }
+    delete it;
+    return cnt;
+}
+
+TEST_F(SnapshotTest, MakeDeltaSnapshot) {
+    LogParts* log_part = new LogParts(12, 4, scmp);
+    MemTableSnapshot snapshot(8, 1, log_part, FLAGS_db_root_path);
+    snapshot.Init();
+    std::map<std::string, uint32_t> mapping;
+    mapping.insert(std::make_pair("idx0", 0));
+    std::shared_ptr<MemTable> table =
+        std::make_shared<MemTable>("test", 8, 1, 8, mapping, 0, ::openmldb::type::TTLType::kAbsoluteTime);
+    table->Init();
+    std::string log_path = FLAGS_db_root_path + "/8_1/binlog/";
+    std::string snapshot_path = FLAGS_db_root_path + "/8_1/snapshot/";
+    uint64_t offset = 0;
+    uint32_t binlog_index = 0;
+    WriteHandle* wh = NULL;
+    RollWLogFile(&wh, log_part, log_path, binlog_index, offset);
+    auto put = [&](const std::string& key, uint64_t ts) {
+        ::openmldb::api::LogEntry entry;
+        entry.set_log_index(++offset);
+        entry.set_pk(key);
+        entry.set_ts(ts);
+        entry.set_value("value");
+        entry.set_term(5);
+        std::string buffer;
+        entry.SerializeToString(&buffer);
+        ASSERT_TRUE(wh->Write(::openmldb::base::Slice(buffer)).ok());
+    };
+    auto del = [&](const std::string& key) {
+        ::openmldb::api::LogEntry entry;
+        entry.set_log_index(++offset);
+        entry.set_method_type(::openmldb::api::MethodType::kDelete);
+        ::openmldb::api::Dimension* dimension = entry.add_dimensions();
+        dimension->set_key(key);
+        dimension->set_idx(0);
+        entry.set_term(5);
+        std::string buffer;
+        entry.SerializeToString(&buffer);
+        ASSERT_TRUE(wh->Write(::openmldb::base::Slice(buffer)).ok());
+    };
+    auto recover = [&]() {
+        std::shared_ptr<MemTable> recovered =
+            std::make_shared<MemTable>("test", 8, 1, 8, mapping, 0, ::openmldb::type::TTLType::kAbsoluteTime);
+        recovered->Init();
+        MemTableSnapshot recover_snapshot(8, 1, log_part, FLAGS_db_root_path);
+        recover_snapshot.Init();
+        uint64_t latest_offset = 0;
+        EXPECT_TRUE(recover_snapshot.Recover(recovered, latest_offset));
+        EXPECT_EQ(offset, latest_offset);
+        return recovered;
+    };
+    FLAGS_snapshot_delta_max_num = 2;
+    for (int i = 0; i < 10; i++) {
+        put("key" + std::to_string(i), 1);
+        put("key" + std::to_string(i), 2);
+    }
+    uint64_t offset_value = 0;
+    // the first snapshot is a full one
+    ASSERT_EQ(0, snapshot.MakeSnapshot(table, offset_value, 0));
+    ::openmldb::api::Manifest manifest;
+    ASSERT_EQ(0, GetManifest(snapshot_path + "MANIFEST", &manifest));
+    ASSERT_EQ(20u, manifest.count());
+    ASSERT_EQ(0, manifest.deltas_size());
+
+    del("key0");
+    put("key0", 3);
+    put("key10", 1);
+    ASSERT_EQ(0, snapshot.MakeSnapshot(table, offset_value, 0));
+    del("key1");
+    ASSERT_EQ(0, snapshot.MakeSnapshot(table, offset_value, 0));
+    ASSERT_EQ(offset, offset_value);
+    manifest.Clear();
+    ASSERT_EQ(0, GetManifest(snapshot_path + "MANIFEST", &manifest));
+    ASSERT_EQ(20u, manifest.count());
+    ASSERT_EQ(offset, manifest.offset());
+    ASSERT_EQ(2, manifest.deltas_size());
+    ASSERT_EQ(3u, manifest.deltas(0).count());
+    ASSERT_EQ(1u, manifest.deltas(1).count());
+    ASSERT_EQ(offset, manifest.deltas(1).offset());
+    std::shared_ptr<MemTable> recovered = recover();
+    ASSERT_EQ(1u, CountRows(recovered, "key0"));
+    ASSERT_EQ(0u, CountRows(recovered, "key1"));
+    ASSERT_EQ(2u, CountRows(recovered, "key2"));
+    ASSERT_EQ(1u, CountRows(recovered, "key10"));
+
+    // the deltas reach snapshot_delta_max_num and are merged
+    put("key11", 1);
+    ASSERT_EQ(0, snapshot.MakeSnapshot(table, offset_value, 0));
+    FLAGS_snapshot_delta_max_num = 0;
+    manifest.Clear();
+    ASSERT_EQ(0, GetManifest(snapshot_path + "MANIFEST", &manifest));
+    ASSERT_EQ(0, manifest.deltas_size());
+    ASSERT_EQ(19u, manifest.count());
+    std::vector<std::string> vec;
+    ASSERT_EQ(0, ::openmldb::base::GetFileName(snapshot_path, vec));
+    ASSERT_EQ(2u, vec.size());
+    recovered = recover();
+    ASSERT_EQ(1u, CountRows(recovered, "key0"));
+    ASSERT_EQ(0u, CountRows(recovered, "key1"));
+    ASSERT_EQ(2u, CountRows(recovered, "key2"));
+    ASSERT_EQ(1u, CountRows(recovered, "key11"));
+    delete wh;
+}
+
 TEST_F(SnapshotTest, Recover_only_snapshot_multi) {
     std::string snapshot_dir = FLAGS_db_root_path + "/3_2/snapshot";
     std::string binlog_dir = FLAGS_db_root_path + "/3_2/binlog";
@@ -698,6 +885,8 @@ TEST_F(SnapshotTest, Recover_only_snapshot) {
     uint64_t offset = 0;
     ASSERT_TRUE(snapshot.Recover(table, offset));
     ASSERT_EQ(2u, offset);
+    ASSERT_EQ(2u, snapshot.GetRecoveredCnt());
+    ASSERT_EQ(2u, snapshot.GetRecoverExpectCnt());
     Ticket ticket;
     TableIterator* it = table->NewIterator("test0", ticket);
     it->Seek(9528);
@@ -860,6 +1049,91 @@ TEST_F(SnapshotTest, MakeSnapshot) {
     ASSERT_EQ(7, (int64_t)manifest.term());
 }
 
+TEST_F(SnapshotTest, MakeMappedSnapshot) {
+    FLAGS_snapshot_mmap = true;
+    LogParts* log_part = new LogParts(12, 4, scmp);
+    MemTableSnapshot snapshot(6, 1, log_part, FLAGS_db_root_path);
+    snapshot.Init();
+    std::map<std::string, uint32_t> mapping;
+    mapping.insert(std::make_pair("idx0", 0));
+    std::shared_ptr<MemTable> table =
+        std::make_shared<MemTable>("tx_log", 6, 1, 8, mapping, 0, ::openmldb::type::TTLType::kAbsoluteTime);
+    table->Init();
+    uint64_t offset = 0;
+    uint32_t binlog_index = 0;
+    std::string log_path = FLAGS_db_root_path + "/6_1/binlog/";
+    std::string snapshot_path = FLAGS_db_root_path + "/6_1/snapshot/";
+    WriteHandle* wh = NULL;
+    RollWLogFile(&wh, log_part, log_path, binlog_index, offset++);
+    for (int count = 0; count < 10; count++) {
+        ::openmldb::api::LogEntry entry;
+        entry.set_log_index(offset);
+        std::string key = "key" + std::to_string(count % 5);
+        if (count % 2 == 0) {
+            entry.set_pk(key);
+        } else {
+            ::openmldb::api::Dimension* dimension = entry.add_dimensions();
+            dimension->set_key(key);
+            dimension->set_idx(0);
+        }
+        entry.set_ts(1000 + count);
+        entry.set_value("value" + std::to_string(count));
+        entry.set_term(5);
+        std::string buffer;
+        entry.SerializeToString(&buffer);
+        ::openmldb::base::Slice slice(buffer);
+        ::openmldb::base::Status status = wh->Write(slice);
+        offset++;
+    }
+    wh->EndLog();
+    uint64_t offset_value = 0;
+    ASSERT_EQ(0, snapshot.MakeSnapshot(table, offset_value, 0));
+    ASSERT_EQ(10u, offset_value);
+    std::vector<std::string> vec;
+    ASSERT_EQ(0, ::openmldb::base::GetFileName(snapshot_path, vec));
+    // the snapshot, its mapped sidecar and the manifest
+    ASSERT_EQ(3u, vec.size());
+
+    std::shared_ptr<MemTable> new_table =
+        std::make_shared<MemTable>("tx_log", 6, 1, 8, mapping, 0, ::openmldb::type::TTLType::kAbsoluteTime);
+    new_table->Init();
+    MemTableSnapshot new_snapshot(6, 1, log_part, FLAGS_db_root_path);
+    ASSERT_TRUE(new_snapshot.Init());
+    uint64_t latest_offset = 0;
+    ASSERT_TRUE(new_snapshot.Recover(new_table, latest_offset));
+    ASSERT_EQ(10u, latest_offset);
+    ASSERT_EQ(10u, new_snapshot.GetRecoveredCnt());
+    ASSERT_EQ(10u, new_table->GetRecordCnt());
+    for (int i = 0; i < 5; i++) {
+        Ticket ticket;
+        TableIterator* it = new_table->NewIterator("key" + std::to_string(i), ticket);
+        it->SeekToFirst();
+        ASSERT_TRUE(it->Valid());
+        ASSERT_EQ(1005u + i, it->GetKey());
+        ASSERT_EQ("value" + std::to_string(i + 5), it->GetValue().ToString());
+        it->Next();
+        ASSERT_TRUE(it->Valid());
+        ASSERT_EQ(1000u + i, it->GetKey());
+        ASSERT_EQ("value" + std::to_string(i), it->GetValue().ToString());
+        it->Next();
+        ASSERT_FALSE(it->Valid());
+        delete it;
+    }
+    // the mapped rows are released with the table
+    new_table->Release();
+
+    // an incomplete sidecar is ignored
+    ::openmldb::api::Manifest manifest;
+    ASSERT_EQ(0, GetManifest(snapshot_path + "MANIFEST", &manifest));
+    ASSERT_EQ(0, truncate((snapshot_path + manifest.name() + ".mmap").c_str(), 8));
+    std::shared_ptr<MemTable> copy_table =
+        std::make_shared<MemTable>("tx_log", 6, 1, 8, mapping, 0, ::openmldb::type::TTLType::kAbsoluteTime);
+    copy_table->Init();
+    ASSERT_TRUE(new_snapshot.Recover(copy_table, latest_offset));
+    ASSERT_EQ(10u, copy_table->GetRecordCnt());
+    FLAGS_snapshot_mmap = false;
+}
+
 TEST_F(SnapshotTest, MakeSnapshot_with_delete_index) {
     LogParts* log_part = new LogParts(12, 4, scmp);
     MemTableSnapshot snapshot(1, 3, log_part, FLAGS_db_root_path);
@@ -1432,6 +1706,119 @@ TEST_F(SnapshotTest, Recover_snapshot_ts) {
     delete it;
 }
 
+TEST_F(SnapshotTest, ExportToCsv) {
+    ::openmldb::api::TableMeta table_meta;
+    table_meta.set_name("test");
+    table_meta.set_tid(3);
+    table_meta.set_pid(1);
+    table_meta.set_seg_cnt(8);
+    SchemaCodec::SetColumnDesc(table_meta.add_column_desc(), "card", ::openmldb::type::kString);
+    SchemaCodec::SetColumnDesc(table_meta.add_column_desc(), "amt", ::openmldb::type::kDouble);
+    SchemaCodec::SetColumnDesc(table_meta.add_column_desc(), "ts1", ::openmldb::type::kBigInt);
+    SchemaCodec::SetIndex(table_meta.add_column_key(), "card", "card", "ts1", ::openmldb::type::kAbsoluteTime, 0, 0);
+    table_meta.set_mode(::openmldb::api::TableMode::kTableLeader);
+    std::shared_ptr<MemTable> table = std::make_shared<MemTable>(table_meta);
+    table->Init();
+    std::vector<std::vector<std::string>> values = {
+        {"card0", "1.5", "1000"}, {"card,1", "0.1", "1001"}, {"card\"2", "null", "1002"}};
+    for (const auto& value : values) {
+        std::string row;
+        ASSERT_EQ(0, ::openmldb::codec::RowCodec::EncodeRow(value, table_meta.column_desc(), 1, row).code);
+        ::openmldb::api::Dimension dim;
+        dim.set_idx(0);
+        dim.set_key(value[0]);
+        Dimensions dimensions;
+        dimensions.Add()->CopyFrom(dim);
+        ASSERT_TRUE(table->Put(std::stoull(value[2]), row, dimensions));
+    }
+    LogParts* log_part = new LogParts(12, 4, scmp);
+    MemTableSnapshot snapshot(3, 1, log_part, FLAGS_db_root_path);
+    ASSERT_TRUE(snapshot.Init());
+    std::string file_path = FLAGS_db_root_path + "/3_1.csv";
+    uint64_t count = 0;
+    ASSERT_EQ(0, snapshot.ExportToCsv(table, file_path, &count));
+    ASSERT_EQ(3u, count);
+    std::ifstream in(file_path);
+    std::set<std::string> lines;
+    std::string line;
+    ASSERT_TRUE(std::getline(in, line));
+    ASSERT_EQ("card,amt,ts1", line);
+    while (std::getline(in, line)) {
+        lines.insert(line);
+    }
+    std::set<std::string> expect = {"card0,1.5,1000", "\"card,1\",0.10000000000000001,1001", "\"card\"\"2\",null,1002"};
+    ASSERT_EQ(expect, lines);
+}
+
+TEST_F(SnapshotTest, ExtractIndexDataParallel) {
+    ::openmldb::api::TableMeta table_meta;
+    table_meta.set_name("test");
+    table_meta.set_tid(4);
+    table_meta.set_pid(0);
+    table_meta.set_seg_cnt(8);
+    SchemaCodec::SetColumnDesc(table_meta.add_column_desc(), "card", ::openmldb::type::kString);
+    SchemaCodec::SetColumnDesc(table_meta.add_column_desc(), "mcc", ::openmldb::type::kString);
+    SchemaCodec::SetColumnDesc(table_meta.add_column_desc(), "ts1", ::openmldb::type::kBigInt);
+    // the entries are put by their ts, so the indexes have no ts column
+    SchemaCodec::SetIndex(table_meta.add_column_key(), "card", "card", "", ::openmldb::type::kAbsoluteTime, 0, 0);
+    table_meta.set_mode(::openmldb::api::TableMode::kTableLeader);
+    std::shared_ptr<MemTable> table = std::make_shared<MemTable>(table_meta);
+    table->Init();
+
+    std::string binlog_dir = FLAGS_db_root_path + "/4_0/binlog/";
+    LogParts* log_part = new LogParts(12, 4, scmp);
+    uint32_t binlog_index = 0;
+    WriteHandle* wh = NULL;
+    RollWLogFile(&wh, log_part, binlog_dir, binlog_index, 0);
+    uint64_t total_num = 1000;
+    for (uint64_t i = 0; i < total_num; i++) {
+        std::vector<std::string> value = {"card" + std::to_string(i % 100), "mcc" + std::to_string(i % 10),
+                                          std::to_string(1000 + i)};
+        std::string row;
+        ASSERT_EQ(0, ::openmldb::codec::RowCodec::EncodeRow(value, table_meta.column_desc(), 1, row).code);
+        ::openmldb::api::LogEntry entry;
+        entry.set_log_index(i + 1);
+        entry.set_ts(1000 + i);
+        entry.set_value(row);
+        auto dim = entry.add_dimensions();
+        dim->set_idx(0);
+        dim->set_key(value[0]);
+        std::string buffer;
+        entry.SerializeToString(&buffer);
+        ASSERT_TRUE(wh->Write(::openmldb::base::Slice(buffer)).ok());
+    }
+    wh->Sync();
+    MemTableSnapshot snapshot(4, 0, log_part, FLAGS_db_root_path);
+    ASSERT_TRUE(snapshot.Init());
+    uint64_t offset = 0;
+    ASSERT_EQ(0, snapshot.MakeSnapshot(table, offset, 0));
+    ASSERT_EQ(total_num, offset);
+
+    ::openmldb::common::ColumnKey column_key;
+    SchemaCodec::SetIndex(&column_key, "mcc", "mcc", "", ::openmldb::type::kAbsoluteTime, 0, 0);
+    ASSERT_TRUE(table->AddIndex(column_key));
+    FLAGS_extract_index_thread_num = 4;
+    ASSERT_EQ(0, snapshot.ExtractIndexData(table, column_key, 1, 1, offset));
+    FLAGS_extract_index_thread_num = 1;
+    ASSERT_EQ(total_num, offset);
+    for (uint32_t i = 0; i < 10; i++) {
+        Ticket ticket;
+        std::unique_ptr<TableIterator> it(table->NewIterator(1, "mcc" + std::to_string(i), ticket));
+        it->SeekToFirst();
+        uint64_t cnt = 0;
+        while (it->Valid()) {
+            ASSERT_EQ(i, (it->GetKey() - 1000) % 10);
+            cnt++;
+            it->Next();
+        }
+        ASSERT_EQ(total_num / 10, cnt);
+    }
+    ::openmldb::api::Manifest manifest;
+    GetManifest(FLAGS_db_root_path + "/4_0/snapshot/MANIFEST", &manifest);
+    ASSERT_EQ(total_num, manifest.count());
+    RemoveData(FLAGS_db_root_path);
+}
+
 TEST_F(SnapshotTest, MakeSnapshotWithEndOffset) {
     LogParts* log_part = new LogParts(12, 4, scmp);
     MemTableSnapshot snapshot(10, 2, log_part, FLAGS_db_root_path);
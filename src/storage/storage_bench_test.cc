@@ -0,0 +1,261 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/glog_wapper.h"
+#include "base/slice.h"
+#include "common/timer.h"
+#include "gflags/gflags.h"
+#include "gtest/gtest.h"
+#include "storage/mem_table.h"
+#include "storage/segment.h"
+
+using ::openmldb::base::Slice;
+
+namespace openmldb {
+namespace storage {
+
+class StorageBenchmarkTest : public ::testing::Test {
+ public:
+    StorageBenchmarkTest() {}
+    ~StorageBenchmarkTest() {}
+};
+
+static const uint32_t PUT_CNT = 200000;
+static const std::vector<uint8_t> HEIGHTS = {4, 8, 12};
+static const std::vector<uint32_t> KEY_NUMS = {100, 10000, 100000};
+
+// the keys are interleaved, so every key has PUT_CNT / key_num rows with the increasing ts
+static void PutRows(Segment* segment, uint32_t key_num, uint32_t put_cnt) {
+    std::string value(100, 'a');
+    for (uint32_t i = 0; i < put_cnt; i++) {
+        std::string pk = "pk" + std::to_string(i % key_num);
+        segment->Put(Slice(pk), (uint64_t)i + 1, value.c_str(), value.size());
+    }
+}
+
+static void PrintCost(const std::string& name, uint8_t height, uint32_t key_num, uint64_t op_cnt,
+                      uint64_t consumed) {
+    std::cout << name << " height " << static_cast<uint32_t>(height) << " key num " << key_num << " op cnt "
+              << op_cnt << " consumed " << consumed / 1000 << "ms, " << consumed * 1000 / std::max<uint64_t>(op_cnt, 1)
+              << "ns/op" << std::endl;
+}
+
+TEST_F(StorageBenchmarkTest, SegmentPut) {
+    for (uint8_t height : HEIGHTS) {
+        for (uint32_t key_num : KEY_NUMS) {
+            Segment segment(height);
+            uint64_t consumed = ::baidu::common::timer::get_micros();
+            PutRows(&segment, key_num, PUT_CNT);
+            consumed = ::baidu::common::timer::get_micros() - consumed;
+            ASSERT_EQ(PUT_CNT, segment.GetIdxCnt());
+            PrintCost("put", height, key_num, PUT_CNT, consumed);
+            segment.Release();
+        }
+    }
+}
+
+TEST_F(StorageBenchmarkTest, SegmentPutMultiTs) {
+    std::vector<uint32_t> ts_idx_vec = {0, 1, 2};
+    for (uint8_t height : HEIGHTS) {
+        for (uint32_t key_num : KEY_NUMS) {
+            Segment segment(height, ts_idx_vec);
+            uint64_t consumed = ::baidu::common::timer::get_micros();
+            for (uint32_t i = 0; i < PUT_CNT; i++) {
+                TSDimensions ts_dimension;
+                for (uint32_t idx : ts_idx_vec) {
+                    auto* ts = ts_dimension.Add();
+                    ts->set_ts((uint64_t)i + idx + 1);
+                    ts->set_idx(idx);
+                }
+                std::string pk = "pk" + std::to_string(i % key_num);
+                segment.Put(Slice(pk), ts_dimension, new DataBlock(ts_idx_vec.size(), "test1", 5));
+            }
+            consumed = ::baidu::common::timer::get_micros() - consumed;
+            uint64_t count = 0;
+            ASSERT_EQ(0, segment.GetIdxCnt(2, count));
+            ASSERT_EQ(PUT_CNT, count);
+            PrintCost("put with 3 ts", height, key_num, PUT_CNT, consumed);
+            segment.Release();
+        }
+    }
+}
+
+TEST_F(StorageBenchmarkTest, SegmentGet) {
+    for (uint8_t height : HEIGHTS) {
+        for (uint32_t key_num : KEY_NUMS) {
+            Segment segment(height);
+            PutRows(&segment, key_num, PUT_CNT);
+            uint64_t found = 0;
+            uint64_t consumed = ::baidu::common::timer::get_micros();
+            for (uint32_t i = 0; i < PUT_CNT; i++) {
+                // the ts of the rows are visited in a scattered order
+                uint32_t pos = (uint32_t)(((uint64_t)i * 7919) % PUT_CNT);
+                std::string pk = "pk" + std::to_string(pos % key_num);
+                DataBlock* block = NULL;
+                if (segment.Get(Slice(pk), (uint64_t)pos + 1, &block)) {
+                    found++;
+                }
+            }
+            consumed = ::baidu::common::timer::get_micros() - consumed;
+            ASSERT_EQ(PUT_CNT, found);
+            PrintCost("get", height, key_num, PUT_CNT, consumed);
+            segment.Release();
+        }
+    }
+}
+
+// seek every key to the middle of its rows and read the window of rows before it
+TEST_F(StorageBenchmarkTest, SegmentIteratorSeekAndNext) {
+    const uint32_t window_size = 100;
+    for (uint8_t height : HEIGHTS) {
+        for (uint32_t key_num : KEY_NUMS) {
+            Segment segment(height);
+            PutRows(&segment, key_num, PUT_CNT);
+            uint64_t seek_cnt = 0;
+            uint64_t row_cnt = 0;
+            uint64_t consumed = ::baidu::common::timer::get_micros();
+            for (uint32_t i = 0; i < key_num; i++) {
+                std::string pk = "pk" + std::to_string(i);
+                Ticket ticket;
+                std::unique_ptr<MemTableIterator> it(segment.NewIterator(Slice(pk), ticket));
+                it->Seek(PUT_CNT / 2);
+                seek_cnt++;
+                for (uint32_t j = 0; j < window_size && it->Valid(); j++) {
+                    row_cnt++;
+                    it->Next();
+                }
+            }
+            consumed = ::baidu::common::timer::get_micros() - consumed;
+            ASSERT_GT(row_cnt, 0u);
+            std::cout << "seek cnt " << seek_cnt << " next cnt " << row_cnt << ", ";
+            PrintCost("seek and next", height, key_num, seek_cnt + row_cnt, consumed);
+            segment.Release();
+        }
+    }
+}
+
+// read every row of every key, the rows are put interleaved so the next row of a key is rarely in the cache
+TEST_F(StorageBenchmarkTest, SegmentIteratorScanRows) {
+    for (uint8_t height : HEIGHTS) {
+        for (uint32_t key_num : KEY_NUMS) {
+            Segment segment(height);
+            PutRows(&segment, key_num, PUT_CNT);
+            uint64_t row_cnt = 0;
+            uint64_t sum = 0;
+            uint64_t consumed = ::baidu::common::timer::get_micros();
+            for (uint32_t i = 0; i < key_num; i++) {
+                std::string pk = "pk" + std::to_string(i);
+                Ticket ticket;
+                std::unique_ptr<MemTableIterator> it(segment.NewIterator(Slice(pk), ticket));
+                it->SeekToFirst();
+                while (it->Valid()) {
+                    sum += static_cast<uint8_t>(it->GetValue().data()[0]);
+                    row_cnt++;
+                    it->Next();
+                }
+            }
+            consumed = ::baidu::common::timer::get_micros() - consumed;
+            ASSERT_EQ(PUT_CNT, row_cnt);
+            ASSERT_EQ(row_cnt * 'a', sum);
+            PrintCost("scan rows", height, key_num, row_cnt, consumed);
+            segment.Release();
+        }
+    }
+}
+
+TEST_F(StorageBenchmarkTest, MemTableTraverse) {
+    std::map<std::string, uint32_t> mapping;
+    mapping.insert(std::make_pair("idx0", 0));
+    for (uint32_t key_num : KEY_NUMS) {
+        MemTable table("t1", 1, 1, 8, mapping, 0, ::openmldb::type::TTLType::kAbsoluteTime);
+        table.Init();
+        std::string value(100, 'a');
+        for (uint32_t i = 0; i < PUT_CNT; i++) {
+            table.Put("pk" + std::to_string(i % key_num), (uint64_t)i + 1, value.c_str(), value.size());
+        }
+        // the key iterator of the sql engine, which reads the rows of every key by its window iterator
+        uint64_t key_cnt = 0;
+        uint64_t row_cnt = 0;
+        uint64_t consumed = ::baidu::common::timer::get_micros();
+        std::unique_ptr<::hybridse::vm::WindowIterator> it(table.NewWindowIterator(0));
+        it->SeekToFirst();
+        while (it->Valid()) {
+            key_cnt++;
+            std::unique_ptr<::hybridse::vm::RowIterator> wit = it->GetValue();
+            wit->SeekToFirst();
+            while (wit->Valid()) {
+                row_cnt++;
+                wit->Next();
+            }
+            it->Next();
+        }
+        consumed = ::baidu::common::timer::get_micros() - consumed;
+        ASSERT_EQ(key_num, key_cnt);
+        ASSERT_EQ(PUT_CNT, row_cnt);
+        PrintCost("key iterator traverse", 8, key_num, row_cnt, consumed);
+
+        row_cnt = 0;
+        consumed = ::baidu::common::timer::get_micros();
+        std::unique_ptr<TableIterator> traverse_it(table.NewTraverseIterator(0));
+        traverse_it->SeekToFirst();
+        while (traverse_it->Valid()) {
+            row_cnt++;
+            traverse_it->Next();
+        }
+        consumed = ::baidu::common::timer::get_micros() - consumed;
+        ASSERT_EQ(PUT_CNT, row_cnt);
+        PrintCost("traverse iterator", 8, key_num, row_cnt, consumed);
+    }
+}
+
+// keep the latest 10 rows of every key
+TEST_F(StorageBenchmarkTest, SegmentGc) {
+    const uint64_t keep_cnt = 10;
+    for (uint8_t height : HEIGHTS) {
+        for (uint32_t key_num : KEY_NUMS) {
+            Segment segment(height);
+            PutRows(&segment, key_num, PUT_CNT);
+            uint64_t gc_idx_cnt = 0;
+            uint64_t gc_record_cnt = 0;
+            uint64_t gc_record_byte_size = 0;
+            TTLSt ttl_st(0, keep_cnt, ::openmldb::storage::kLatestTime);
+            uint64_t consumed = ::baidu::common::timer::get_micros();
+            segment.ExecuteGc(ttl_st, gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
+            consumed = ::baidu::common::timer::get_micros() - consumed;
+            uint64_t kept = std::min<uint64_t>(PUT_CNT, key_num * keep_cnt);
+            ASSERT_EQ(PUT_CNT - kept, gc_idx_cnt);
+            PrintCost("gc", height, key_num, gc_idx_cnt, consumed);
+            segment.Release();
+        }
+    }
+}
+
+}  // namespace storage
+}  // namespace openmldb
+
+int main(int argc, char** argv) {
+    ::openmldb::base::SetLogLevel(INFO);
+    ::testing::InitGoogleTest(&argc, argv);
+    ::google::ParseCommandLineFlags(&argc, &argv, true);
+    return RUN_ALL_TESTS();
+}
@@ -17,6 +17,7 @@
 #include "storage/table.h"
 
 #include <algorithm>
+#include <string>
 #include <utility>
 
 #include "base/glog_wapper.h"
@@ -25,7 +26,10 @@
 namespace openmldb {
 namespace storage {
 
-Table::Table() {}
+// the projection lists of a table are the few ones of its queries, the cache is bounded anyway
+static constexpr uint32_t MAX_PROJECT_PLAN_CNT = 64;
+
+Table::Table() : latest_version_(0), single_version_(0) {}
 
 Table::Table(const std::string& name, uint32_t id, uint32_t pid, uint64_t ttl, bool is_leader, uint64_t ttl_offset,
              const std::map<std::string, uint32_t>& mapping, ::openmldb::type::TTLType ttl_type,
@@ -37,6 +41,10 @@ Table::Table(const std::string& name, uint32_t id, uint32_t pid, uint64_t ttl, b
       is_leader_(is_leader),
       compress_type_(compress_type),
       version_schema_(),
+      latest_version_schema_(),
+      upgrade_plan_(),
+      latest_version_(0),
+      single_version_(0),
       update_ttl_(std::make_shared<std::vector<::openmldb::storage::UpdateTTLMeta>>()) {
     table_meta_ = std::make_shared<::openmldb::api::TableMeta>();
     ::openmldb::common::TTLSt ttl_st;
@@ -85,7 +93,59 @@ void Table::AddVersionSchema(const ::openmldb::api::TableMeta& table_meta) {
         }
         new_versions->insert(std::make_pair(ver.id(), new_schema));
     }
+    const auto& latest = *new_versions->rbegin();
+    std::shared_ptr<const ::openmldb::codec::RowProjectPlan> upgrade_plan;
+    if (new_versions->size() > 1) {
+        ::openmldb::codec::ProjectList plist;
+        for (int i = 0; i < latest.second->size(); i++) {
+            plist.Add(i);
+        }
+        upgrade_plan = ::openmldb::codec::RowProjectPlan::New(*new_versions, plist, true);
+    }
+    auto latest_versions = std::make_shared<std::map<int32_t, std::shared_ptr<Schema>>>();
+    latest_versions->insert(latest);
+    std::atomic_store_explicit(&upgrade_plan_, upgrade_plan, std::memory_order_relaxed);
+    std::atomic_store_explicit(&latest_version_schema_, latest_versions, std::memory_order_relaxed);
     std::atomic_store_explicit(&version_schema_, new_versions, std::memory_order_relaxed);
+    uint8_t latest_version = static_cast<uint8_t>(latest.first);
+    if (new_versions->size() == 1) {
+        // the rows of a table without added columns are all of the first version
+        single_version_.store(latest_version, std::memory_order_release);
+    }
+    // IsSingleVersion is false until the rows of the older versions are upgraded to the new latest version
+    latest_version_.store(latest_version, std::memory_order_release);
+}
+
+std::shared_ptr<const ::openmldb::codec::RowProjectPlan> Table::GetProjectPlan(
+    const ::openmldb::codec::ProjectList& plist) {
+    // the plan of a single version table has no dispatch of the versions
+    auto versions = IsSingleVersion() ? std::atomic_load_explicit(&latest_version_schema_, std::memory_order_relaxed)
+                                      : std::atomic_load_explicit(&version_schema_, std::memory_order_relaxed);
+    if (!versions) {
+        return std::shared_ptr<const ::openmldb::codec::RowProjectPlan>();
+    }
+    std::string key;
+    for (uint32_t idx : plist) {
+        key.append(std::to_string(idx)).push_back(',');
+    }
+    std::lock_guard<std::mutex> lock(project_mu_);
+    if (project_versions_ != versions) {
+        // the schema is altered, the plans of the old versions are dropped
+        project_plans_.clear();
+        project_versions_ = versions;
+    }
+    auto it = project_plans_.find(key);
+    if (it != project_plans_.end()) {
+        return it->second;
+    }
+    auto plan = ::openmldb::codec::RowProjectPlan::New(*versions, plist);
+    if (plan) {
+        if (project_plans_.size() >= MAX_PROJECT_PLAN_CNT) {
+            project_plans_.clear();
+        }
+        project_plans_.emplace(key, plan);
+    }
+    return plan;
 }
 
 void Table::SetTableMeta(::openmldb::api::TableMeta& table_meta) {  // NOLINT
@@ -19,9 +19,11 @@
 #include <atomic>
 #include <map>
 #include <memory>
+#include <mutex>  // NOLINT
 #include <string>
 #include <vector>
 
+#include "codec/codec.h"
 #include "proto/tablet.pb.h"
 #include "storage/iterator.h"
 #include "storage/schema.h"
@@ -65,6 +67,28 @@ class Table {
 
     virtual bool Delete(const std::string& pk, uint32_t idx) = 0;
 
+    // delete the rows of pk in the index idx whose ts is from end_ts to start_ts
+    virtual bool DeleteRange(const std::string& pk, uint32_t idx, uint64_t start_ts, uint64_t end_ts) {
+        return false;
+    }
+
+    // delete the rows of all the indexes whose ts in the index is from end_ts to start_ts
+    virtual bool DeleteRange(uint64_t start_ts, uint64_t end_ts) { return false; }
+
+    // apply a delete of the binlog, it deletes the rows of a ts range if it has the end_ts, and the ts range of
+    // all the keys if it has no dimension either
+    bool Delete(const ::openmldb::api::LogEntry& entry) {
+        if (entry.has_end_ts()) {
+            return entry.dimensions_size() > 0
+                       ? DeleteRange(entry.dimensions(0).key(), entry.dimensions(0).idx(), entry.ts(), entry.end_ts())
+                       : DeleteRange(entry.ts(), entry.end_ts());
+        }
+        if (entry.dimensions_size() == 0) {
+            return false;
+        }
+        return Delete(entry.dimensions(0).key(), entry.dimensions(0).idx());
+    }
+
     virtual TableIterator* NewIterator(const std::string& pk,
                                        Ticket& ticket) = 0;  // NOLINT
 
@@ -137,6 +161,29 @@ class Table {
         return *std::atomic_load_explicit(&version_schema_, std::memory_order_relaxed);
     }
 
+    inline uint8_t GetLatestVersion() const { return latest_version_.load(std::memory_order_relaxed); }
+
+    // whether all the rows are of the latest schema version, which is set once the rows of the older versions
+    // are upgraded by the gc. It is reset when a version is added
+    inline bool IsSingleVersion() const {
+        uint8_t version = single_version_.load(std::memory_order_acquire);
+        return version != 0 && version == GetLatestVersion();
+    }
+
+    void SetSingleVersion(uint8_t version) { single_version_.store(version, std::memory_order_release); }
+
+    // the plan projecting the rows of all the versions to the columns of the latest version, NULL if the table
+    // has only one version
+    std::shared_ptr<const ::openmldb::codec::RowProjectPlan> GetUpgradePlan() {
+        return std::atomic_load_explicit(&upgrade_plan_, std::memory_order_relaxed);
+    }
+
+    // the compiled plan of a projection list over the current schema versions, which is built at
+    // the first projected read and shared by the later ones. It is built of the latest version only
+    // if the table is single version. Return NULL if the list is invalid
+    std::shared_ptr<const ::openmldb::codec::RowProjectPlan> GetProjectPlan(
+        const ::openmldb::codec::ProjectList& plist);
+
     std::vector<std::shared_ptr<IndexDef>> GetAllIndex() { return table_index_.GetAllIndex(); }
 
     std::shared_ptr<IndexDef> GetIndex(const std::string& name) { return table_index_.GetIndex(name); }
@@ -179,7 +226,17 @@ class Table {
     std::shared_ptr<::openmldb::api::TableMeta> table_meta_;
     int64_t last_make_snapshot_time_;
     std::shared_ptr<std::map<int32_t, std::shared_ptr<Schema>>> version_schema_;
+    // the latest version alone of version_schema_ and the plan upgrading the rows to it
+    std::shared_ptr<std::map<int32_t, std::shared_ptr<Schema>>> latest_version_schema_;
+    std::shared_ptr<const ::openmldb::codec::RowProjectPlan> upgrade_plan_;
+    std::atomic<uint8_t> latest_version_;
+    // the version all the rows are of, 0 if it is unknown
+    std::atomic<uint8_t> single_version_;
     std::shared_ptr<std::vector<::openmldb::storage::UpdateTTLMeta>> update_ttl_;
+    std::mutex project_mu_;
+    // the schema versions the cached plans are built of
+    std::shared_ptr<std::map<int32_t, std::shared_ptr<Schema>>> project_versions_;
+    std::map<std::string, std::shared_ptr<const ::openmldb::codec::RowProjectPlan>> project_plans_;
 };
 
 }  // namespace storage
@@ -25,6 +25,8 @@
 
 DECLARE_uint32(max_traverse_cnt);
 DECLARE_int32(gc_safe_offset);
+DECLARE_uint32(gc_slice_key_cnt);
+DECLARE_uint32(schema_upgrade_row_cnt);
 
 namespace openmldb {
 namespace storage {
@@ -57,6 +59,28 @@ TEST_F(TableTest, Put) {
     delete table;
 }
 
+TEST_F(TableTest, WriteVersion) {
+    std::map<std::string, uint32_t> mapping;
+    mapping.insert(std::make_pair("idx0", 0));
+    MemTable table("tx_log", 1, 1, 8, mapping, 10, ::openmldb::type::kAbsoluteTime);
+    table.Init();
+    MemTable other("tx_log", 2, 1, 8, mapping, 10, ::openmldb::type::kAbsoluteTime);
+    other.Init();
+    // the versions of different tables never collide
+    ASSERT_NE(table.GetWriteVersion(), other.GetWriteVersion());
+    uint64_t version = table.GetWriteVersion();
+    table.Put("test", 9537, "test", 4);
+    ASSERT_NE(version, table.GetWriteVersion());
+    version = table.GetWriteVersion();
+    Ticket ticket;
+    std::unique_ptr<TableIterator> it(table.NewIterator("test", ticket));
+    it->SeekToFirst();
+    ASSERT_TRUE(it->Valid());
+    ASSERT_EQ(version, table.GetWriteVersion());
+    table.Delete("test", 0);
+    ASSERT_NE(version, table.GetWriteVersion());
+}
+
 TEST_F(TableTest, MultiDimissionDelete) {
     ::openmldb::api::TableMeta* table_meta = new ::openmldb::api::TableMeta();
     table_meta->set_name("t0");
@@ -349,6 +373,34 @@ TEST_F(TableTest, SchedGc) {
     delete table;
 }
 
+TEST_F(TableTest, SchedGcSlice) {
+    std::map<std::string, uint32_t> mapping;
+    mapping.insert(std::make_pair("idx0", 0));
+    MemTable* table = new MemTable("tx_log", 1, 1, 8, mapping, 1, ::openmldb::type::kLatestTime);
+    table->Init();
+    for (int i = 0; i < 40; i++) {
+        std::string pk = "test" + std::to_string(i);
+        table->Put(pk, 9527, "test", 4);
+        table->Put(pk, 9528, "test", 4);
+    }
+    ASSERT_EQ(80, (int64_t)table->GetRecordCnt());
+    FLAGS_gc_slice_key_cnt = 2;
+    table->SchedGc();
+    ASSERT_TRUE(table->IsGcSweeping());
+    ASSERT_GT(80, (int64_t)table->GetRecordCnt());
+    ASSERT_LT(40, (int64_t)table->GetRecordCnt());
+    uint32_t slice_cnt = 1;
+    while (table->IsGcSweeping()) {
+        table->SchedGc();
+        slice_cnt++;
+    }
+    FLAGS_gc_slice_key_cnt = 0;
+    ASSERT_LT(1u, slice_cnt);
+    ASSERT_EQ(40, (int64_t)table->GetRecordCnt());
+    ASSERT_EQ(0u, table->GetGcLag());
+    delete table;
+}
+
 TEST_F(TableTest, TableDataCnt) {
     std::map<std::string, uint32_t> mapping;
     mapping.insert(std::make_pair("idx0", 0));
@@ -1112,6 +1164,283 @@ TEST_F(TableTest, GcAbsAndLat) {
     FLAGS_gc_safe_offset = offset;
 }
 
+TEST_F(TableTest, CompactRowFormat) {
+    ::openmldb::api::TableMeta table_meta;
+    table_meta.set_name("table1");
+    table_meta.set_tid(1);
+    table_meta.set_pid(0);
+    table_meta.set_seg_cnt(8);
+    table_meta.set_format_version(1);
+    SchemaCodec::SetColumnDesc(table_meta.add_column_desc(), "card", ::openmldb::type::kString);
+    SchemaCodec::SetColumnDesc(table_meta.add_column_desc(), "ts", ::openmldb::type::kBigInt);
+    SchemaCodec::SetColumnDesc(table_meta.add_column_desc(), "memo", ::openmldb::type::kString);
+    SchemaCodec::SetColumnDesc(table_meta.add_column_desc(), "amt", ::openmldb::type::kDouble);
+    SchemaCodec::SetColumnDesc(table_meta.add_column_desc(), "cnt", ::openmldb::type::kBigInt);
+    SchemaCodec::SetIndex(table_meta.add_column_key(), "card", "card", "", ::openmldb::type::kAbsoluteTime, 0, 0);
+    MemTable table(table_meta);
+    ASSERT_TRUE(table.Init());
+    table_meta.set_compact_row_format(true);
+    MemTable compact_table(table_meta);
+    ASSERT_TRUE(compact_table.Init());
+
+    ::openmldb::codec::RowBuilder builder(table_meta.column_desc());
+    std::vector<std::string> rows;
+    for (int i = 0; i < 100; i++) {
+        std::string card = "card" + std::to_string(i % 10);
+        std::string row(builder.CalTotalLength(card.size()), '\0');
+        builder.SetBuffer(reinterpret_cast<int8_t*>(&row[0]), row.size());
+        builder.AppendString(card.c_str(), card.size());
+        builder.AppendInt64(1000 + i);
+        builder.AppendNULL();
+        builder.AppendNULL();
+        builder.AppendInt64(i);
+        rows.push_back(row);
+        ::openmldb::api::Dimension dim;
+        dim.set_idx(0);
+        dim.set_key(card);
+        Dimensions dimensions;
+        dimensions.Add()->CopyFrom(dim);
+        ASSERT_TRUE(table.Put(1000 + i, row, dimensions));
+        ASSERT_TRUE(compact_table.Put(1000 + i, row, dimensions));
+    }
+    ASSERT_LT(compact_table.GetRecordByteSize(), table.GetRecordByteSize());
+
+    // the rows are read back as they are put
+    Ticket ticket;
+    std::unique_ptr<TableIterator> it(compact_table.NewIterator(0, "card5", ticket));
+    it->SeekToFirst();
+    int count = 0;
+    for (; it->Valid(); it->Next()) {
+        ASSERT_EQ(rows[it->GetKey() - 1000], it->GetValue().ToString());
+        count++;
+    }
+    ASSERT_EQ(10, count);
+    it.reset(compact_table.NewTraverseIterator(0));
+    count = 0;
+    for (it->SeekToFirst(); it->Valid(); it->Next()) {
+        ASSERT_EQ(rows[it->GetKey() - 1000], it->GetValue().ToString());
+        count++;
+    }
+    ASSERT_EQ(100, count);
+    std::unique_ptr<::hybridse::vm::WindowIterator> window_it(compact_table.NewWindowIterator(0));
+    window_it->SeekToFirst();
+    count = 0;
+    for (; window_it->Valid(); window_it->Next()) {
+        auto row_it = window_it->GetValue();
+        for (row_it->SeekToFirst(); row_it->Valid(); row_it->Next()) {
+            ASSERT_EQ(rows[row_it->GetKey() - 1000], row_it->GetValue().ToString());
+            count++;
+        }
+    }
+    ASSERT_EQ(100, count);
+}
+
+TEST_F(TableTest, BlobMinSize) {
+    ::openmldb::api::TableMeta table_meta;
+    table_meta.set_name("table1");
+    table_meta.set_tid(1);
+    table_meta.set_pid(0);
+    table_meta.set_seg_cnt(8);
+    table_meta.set_format_version(1);
+    table_meta.set_blob_min_size(1024);
+    SchemaCodec::SetColumnDesc(table_meta.add_column_desc(), "card", ::openmldb::type::kString);
+    SchemaCodec::SetColumnDesc(table_meta.add_column_desc(), "ts", ::openmldb::type::kBigInt);
+    SchemaCodec::SetColumnDesc(table_meta.add_column_desc(), "doc", ::openmldb::type::kString);
+    SchemaCodec::SetIndex(table_meta.add_column_key(), "card", "card", "", ::openmldb::type::kAbsoluteTime, 0, 0);
+    MemTable table(table_meta);
+    ASSERT_TRUE(table.Init());
+
+    ::openmldb::codec::RowBuilder builder(table_meta.column_desc());
+    std::vector<std::string> rows;
+    for (int i = 0; i < 100; i++) {
+        // the small docs are kept in the rows of format version 1
+        std::string card = "card" + std::to_string(i % 10);
+        std::string doc(i % 2 == 0 ? 10000 : 100, 'a' + i % 26);
+        std::string row(builder.CalTotalLength(card.size() + doc.size()), '\0');
+        builder.SetBuffer(reinterpret_cast<int8_t*>(&row[0]), row.size());
+        builder.AppendString(card.c_str(), card.size());
+        builder.AppendInt64(1000 + i);
+        builder.AppendString(doc.c_str(), doc.size());
+        rows.push_back(row);
+        ::openmldb::api::Dimension dim;
+        dim.set_idx(0);
+        dim.set_key(card);
+        Dimensions dimensions;
+        dimensions.Add()->CopyFrom(dim);
+        ASSERT_TRUE(table.Put(1000 + i, row, dimensions));
+    }
+
+    Ticket ticket;
+    std::unique_ptr<TableIterator> it(table.NewIterator(0, "card4", ticket));
+    int count = 0;
+    for (it->SeekToFirst(); it->Valid(); it->Next()) {
+        ASSERT_EQ(rows[it->GetKey() - 1000], it->GetValue().ToString());
+        count++;
+    }
+    ASSERT_EQ(10, count);
+    // the docs in the blobs are not read without their column
+    std::unique_ptr<::hybridse::vm::WindowIterator> window_it(table.NewWindowIterator(0));
+    auto key_it = dynamic_cast<MemTableKeyIterator*>(window_it.get());
+    ASSERT_TRUE(key_it != nullptr);
+    ASSERT_TRUE(key_it->SetColumnMask(std::make_shared<const std::vector<bool>>(std::vector<bool>{true, true, false})));
+    count = 0;
+    for (window_it->SeekToFirst(); window_it->Valid(); window_it->Next()) {
+        auto row_it = window_it->GetValue();
+        for (row_it->SeekToFirst(); row_it->Valid(); row_it->Next()) {
+            uint64_t ts = row_it->GetKey();
+            auto row = row_it->GetValue();
+            ::openmldb::codec::RowView view(table_meta.column_desc(), row.buf(), row.size());
+            int64_t value = 0;
+            ASSERT_EQ(0, view.GetInt64(1, &value));
+            ASSERT_EQ(static_cast<int64_t>(ts), value);
+            ASSERT_EQ(ts % 2 == 0, view.IsNULL(2));
+            count++;
+        }
+    }
+    ASSERT_EQ(100, count);
+}
+
+TEST_F(TableTest, ProjectPlanCache) {
+    ::openmldb::api::TableMeta table_meta;
+    table_meta.set_name("table1");
+    table_meta.set_tid(1);
+    table_meta.set_pid(0);
+    table_meta.set_seg_cnt(8);
+    table_meta.set_format_version(1);
+    SchemaCodec::SetColumnDesc(table_meta.add_column_desc(), "card", ::openmldb::type::kString);
+    SchemaCodec::SetColumnDesc(table_meta.add_column_desc(), "ts", ::openmldb::type::kBigInt);
+    SchemaCodec::SetColumnDesc(table_meta.add_column_desc(), "amt", ::openmldb::type::kDouble);
+    SchemaCodec::SetIndex(table_meta.add_column_key(), "card", "card", "ts", ::openmldb::type::kAbsoluteTime, 0, 0);
+    MemTable table(table_meta);
+    ASSERT_TRUE(table.Init());
+
+    ::openmldb::codec::ProjectList plist;
+    plist.Add(2);
+    plist.Add(0);
+    auto plan = table.GetProjectPlan(plist);
+    ASSERT_TRUE(plan);
+    ASSERT_EQ(plan, table.GetProjectPlan(plist));
+    ::openmldb::codec::ProjectList invalid_plist;
+    invalid_plist.Add(3);
+    ASSERT_FALSE(table.GetProjectPlan(invalid_plist));
+
+    // the plan is built again for the new schema version
+    SchemaCodec::SetColumnDesc(table_meta.add_added_column_desc(), "memo", ::openmldb::type::kString);
+    auto pair = table_meta.add_schema_versions();
+    pair->set_id(2);
+    pair->set_field_count(4);
+    table.SetTableMeta(table_meta);
+    auto new_plan = table.GetProjectPlan(plist);
+    ASSERT_TRUE(new_plan);
+    ASSERT_NE(plan, new_plan);
+    invalid_plist.Set(0, 4);
+    ASSERT_FALSE(table.GetProjectPlan(invalid_plist));
+    invalid_plist.Set(0, 3);
+    ASSERT_TRUE(table.GetProjectPlan(invalid_plist));
+
+    ::openmldb::codec::RowBuilder builder(*table.GetVersionSchema(2));
+    builder.SetSchemaVersion(2);
+    std::string row(builder.CalTotalLength(9), '\0');
+    builder.SetBuffer(reinterpret_cast<int8_t*>(&row[0]), row.size());
+    builder.AppendString("card0", 5);
+    builder.AppendInt64(1000);
+    builder.AppendDouble(1.5);
+    builder.AppendString("memo", 4);
+    ::openmldb::codec::RowProject row_project(new_plan);
+    int8_t* out = nullptr;
+    uint32_t out_size = 0;
+    ASSERT_TRUE(row_project.Project(reinterpret_cast<const int8_t*>(row.data()), row.size(), &out, &out_size));
+    ::openmldb::codec::RowView view(new_plan->GetOutputSchema(), out, out_size);
+    double amt = 0;
+    ASSERT_EQ(0, view.GetDouble(0, &amt));
+    ASSERT_EQ(1.5, amt);
+    std::string card;
+    ASSERT_EQ(0, view.GetStrValue(1, &card));
+    ASSERT_EQ("card0", card);
+    delete[] out;
+}
+
+TEST_F(TableTest, UpgradeSchemaVersion) {
+    ::openmldb::api::TableMeta table_meta;
+    table_meta.set_name("table1");
+    table_meta.set_tid(1);
+    table_meta.set_pid(0);
+    table_meta.set_seg_cnt(8);
+    table_meta.set_format_version(1);
+    SchemaCodec::SetColumnDesc(table_meta.add_column_desc(), "card", ::openmldb::type::kString);
+    SchemaCodec::SetColumnDesc(table_meta.add_column_desc(), "mcc", ::openmldb::type::kString);
+    SchemaCodec::SetColumnDesc(table_meta.add_column_desc(), "amt", ::openmldb::type::kBigInt);
+    SchemaCodec::SetIndex(table_meta.add_column_key(), "card", "card", "", ::openmldb::type::kAbsoluteTime, 0, 0);
+    SchemaCodec::SetIndex(table_meta.add_column_key(), "mcc", "mcc", "", ::openmldb::type::kAbsoluteTime, 0, 0);
+    MemTable table(table_meta);
+    ASSERT_TRUE(table.Init());
+    ASSERT_TRUE(table.IsSingleVersion());
+
+    ::openmldb::codec::RowBuilder builder(table_meta.column_desc());
+    auto put_row = [&](int i) {
+        std::string card = "card" + std::to_string(i % 5);
+        std::string mcc = "mcc" + std::to_string(i % 3);
+        std::string row(builder.CalTotalLength(card.size() + mcc.size()), '\0');
+        builder.SetBuffer(reinterpret_cast<int8_t*>(&row[0]), row.size());
+        builder.AppendString(card.c_str(), card.size());
+        builder.AppendString(mcc.c_str(), mcc.size());
+        builder.AppendInt64(i);
+        Dimensions dimensions;
+        auto dim = dimensions.Add();
+        dim->set_idx(0);
+        dim->set_key(card);
+        dim = dimensions.Add();
+        dim->set_idx(1);
+        dim->set_key(mcc);
+        return table.Put(1000 + i, row, dimensions);
+    };
+    for (int i = 0; i < 20; i++) {
+        ASSERT_TRUE(put_row(i));
+    }
+    SchemaCodec::SetColumnDesc(table_meta.add_added_column_desc(), "memo", ::openmldb::type::kString);
+    auto pair = table_meta.add_schema_versions();
+    pair->set_id(2);
+    pair->set_field_count(4);
+    table.SetTableMeta(table_meta);
+    ASSERT_EQ(2, table.GetLatestVersion());
+    ASSERT_FALSE(table.IsSingleVersion());
+
+    // the rows are upgraded a few in every round of gc
+    FLAGS_schema_upgrade_row_cnt = 8;
+    table.SchedGc();
+    ASSERT_FALSE(table.IsSingleVersion());
+    for (int i = 0; i < 10 && !table.IsSingleVersion(); i++) {
+        table.SchedGc();
+    }
+    ASSERT_TRUE(table.IsSingleVersion());
+    // the rows put by the clients of the old version are upgraded at once
+    ASSERT_TRUE(put_row(20));
+    // the replaced rows are released after the gc versions of the readers
+    for (int i = 0; i < 4; i++) {
+        table.SchedGc();
+    }
+    ASSERT_EQ(21u, table.GetRecordCnt());
+
+    auto schema = table.GetVersionSchema(2);
+    for (uint32_t idx = 0; idx < 2; idx++) {
+        std::unique_ptr<TableIterator> it(table.NewTraverseIterator(idx));
+        int count = 0;
+        for (it->SeekToFirst(); it->Valid(); it->Next()) {
+            auto value = it->GetValue();
+            const int8_t* row = reinterpret_cast<const int8_t*>(value.data());
+            ASSERT_EQ(2, ::openmldb::codec::RowView::GetSchemaVersion(row));
+            ::openmldb::codec::RowView view(*schema, row, value.size());
+            int64_t amt = 0;
+            ASSERT_EQ(0, view.GetInt64(2, &amt));
+            ASSERT_EQ(static_cast<int64_t>(it->GetKey()) - 1000, amt);
+            ASSERT_TRUE(view.IsNULL(3));
+            count++;
+        }
+        ASSERT_EQ(21, count);
+    }
+    FLAGS_schema_upgrade_row_cnt = 0;
+}
+
 }  // namespace storage
 }  // namespace openmldb
 
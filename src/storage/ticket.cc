@@ -16,10 +16,18 @@
 
 #include "storage/ticket.h"
 
+#include "gflags/gflags.h"
+
+DECLARE_bool(enable_epoch_reclaim);
+
 namespace openmldb {
 namespace storage {
 
-Ticket::Ticket() {}
+Ticket::Ticket() {
+    if (FLAGS_enable_epoch_reclaim) {
+        guard_.Enter(::openmldb::base::EpochManager::Default());
+    }
+}
 
 Ticket::~Ticket() {
     std::vector<KeyEntry*>::iterator it = entries_.begin();
@@ -29,7 +37,8 @@ Ticket::~Ticket() {
 }
 
 void Ticket::Push(KeyEntry* entry) {
-    if (entry == NULL) {
+    // the entries are not referred as nothing is freed before the reader finishes
+    if (entry == NULL || guard_.IsEntered()) {
         return;
     }
     entry->Ref();
@@ -19,6 +19,7 @@
 
 #include <vector>
 
+#include "base/epoch.h"
 #include "storage/segment.h"
 
 namespace openmldb {
@@ -26,6 +27,8 @@ namespace storage {
 
 class KeyEntry;
 
+// Ticket keeps the memory read by the iterators created with it valid. It refers the key entries read, or
+// it announces a reader to the epoch manager for its lifetime with the epoch reclamation
 class Ticket {
  public:
     Ticket();
@@ -38,6 +41,7 @@ class Ticket {
 
  private:
     std::vector<KeyEntry*> entries_;
+    ::openmldb::base::EpochGuard guard_;
 };
 
 }  // namespace storage
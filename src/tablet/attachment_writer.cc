@@ -0,0 +1,95 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tablet/attachment_writer.h"
+
+#include <string.h>
+
+#include <algorithm>
+
+#include "gflags/gflags.h"
+
+DECLARE_uint32(scan_zero_copy_min_size);
+
+namespace openmldb {
+namespace tablet {
+
+static const size_t kTailSize = 16;
+
+AttachmentWriter::AttachmentWriter(butil::IOBuf* buf)
+    : buf_(buf), pins_(new Pins()), ref_cnt_(0), finished_(false) {}
+
+AttachmentWriter::~AttachmentWriter() { Finish(); }
+
+void AttachmentWriter::Append(const void* data, size_t size) { buf_->append(data, size); }
+
+void AttachmentWriter::AppendPinned(const ::openmldb::base::Slice& row) {
+    // a user data block costs an allocation and a block reference, the small rows are cheaper to copy
+    if (FLAGS_scan_zero_copy_min_size == 0 || row.size() < FLAGS_scan_zero_copy_min_size) {
+        buf_->append(row.data(), row.size());
+        return;
+    }
+    buf_->append_user_data(const_cast<char*>(row.data()), row.size(), ReleaseNothing);
+    ref_cnt_++;
+}
+
+void AttachmentWriter::AppendOwned(char* data, size_t size) {
+    if (size == 0) {
+        delete[] data;
+        return;
+    }
+    buf_->append_user_data(data, size, ReleaseOwned);
+}
+
+void AttachmentWriter::Pin(const std::shared_ptr<void>& obj) {
+    if (pins_ && obj) {
+        pins_->objs.push_back(obj);
+    }
+}
+
+void AttachmentWriter::Finish() {
+    if (finished_) {
+        return;
+    }
+    finished_ = true;
+    if (ref_cnt_ == 0) {
+        pins_.reset();
+        return;
+    }
+    // move the last bytes to a tail block which releases the pins with it
+    size_t size = std::min(buf_->size(), kTailSize);
+    char* tail = new char[sizeof(Pins*) + size];
+    Pins* pins = pins_.release();
+    memcpy(tail, &pins, sizeof(Pins*));
+    buf_->copy_to(tail + sizeof(Pins*), size, buf_->size() - size);
+    buf_->pop_back(size);
+    buf_->append_user_data(tail + sizeof(Pins*), size, ReleasePins);
+}
+
+void AttachmentWriter::ReleaseOwned(void* data) { delete[] reinterpret_cast<char*>(data); }
+
+void AttachmentWriter::ReleaseNothing(void* data) {}
+
+void AttachmentWriter::ReleasePins(void* data) {
+    char* tail = reinterpret_cast<char*>(data) - sizeof(Pins*);
+    Pins* pins = NULL;
+    memcpy(&pins, tail, sizeof(Pins*));
+    delete pins;
+    delete[] tail;
+}
+
+}  // namespace tablet
+}  // namespace openmldb
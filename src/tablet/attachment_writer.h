@@ -0,0 +1,79 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_TABLET_ATTACHMENT_WRITER_H_
+#define SRC_TABLET_ATTACHMENT_WRITER_H_
+
+#include <memory>
+#include <vector>
+
+#include "base/slice.h"
+#include "butil/iobuf.h"
+
+namespace openmldb {
+namespace tablet {
+
+// AttachmentWriter appends the rows of a response to its attachment. The rows in the memory of the table are appended
+// by reference rather than copied, and the objects pinning them, e.g. the iterators and tickets of a scan, are kept
+// until brpc releases the attachment after sending it.
+// The IOBuf calls the deleter of a user data block with the data only, so the pins are owned by a tail block holding
+// a copy of the last bytes. The blocks of an IOBuf are released from the front, so when the tail is released none of
+// the rows referenced before it is in use any more.
+class AttachmentWriter {
+ public:
+    explicit AttachmentWriter(butil::IOBuf* buf);
+    ~AttachmentWriter();
+    AttachmentWriter(const AttachmentWriter&) = delete;
+    AttachmentWriter& operator=(const AttachmentWriter&) = delete;
+
+    // append a copy of data
+    void Append(const void* data, size_t size);
+
+    // append the row by reference if it is large enough, the row must stay valid as long as the pinned objects
+    void AppendPinned(const ::openmldb::base::Slice& row);
+
+    // append a buffer allocated by new char[], the attachment takes the ownership of it
+    void AppendOwned(char* data, size_t size);
+
+    // keep obj until the rows appended by reference are released
+    void Pin(const std::shared_ptr<void>& obj);
+
+    // hand the pins over to the attachment if any row is appended by reference, or release them.
+    // Nothing should be appended after it
+    void Finish();
+
+    inline uint64_t GetRefCnt() const { return ref_cnt_; }
+
+ private:
+    struct Pins {
+        std::vector<std::shared_ptr<void>> objs;
+    };
+
+    static void ReleaseOwned(void* data);
+    static void ReleaseNothing(void* data);
+    static void ReleasePins(void* data);
+
+ private:
+    butil::IOBuf* buf_;
+    std::unique_ptr<Pins> pins_;
+    // the count of rows appended by reference
+    uint64_t ref_cnt_;
+    bool finished_;
+};
+
+}  // namespace tablet
+}  // namespace openmldb
+#endif  // SRC_TABLET_ATTACHMENT_WRITER_H_
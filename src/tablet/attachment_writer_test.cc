@@ -0,0 +1,100 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tablet/attachment_writer.h"
+
+#include <string.h>
+
+#include <memory>
+#include <string>
+
+#include "gflags/gflags.h"
+#include "gtest/gtest.h"
+
+DECLARE_uint32(scan_zero_copy_min_size);
+
+namespace openmldb {
+namespace tablet {
+
+class AttachmentWriterTest : public ::testing::Test {
+ public:
+    AttachmentWriterTest() {}
+    ~AttachmentWriterTest() {}
+};
+
+TEST_F(AttachmentWriterTest, PinnedRows) {
+    FLAGS_scan_zero_copy_min_size = 8;
+    std::string large(100, 'a');
+    std::string small = "bcd";
+    auto pin = std::make_shared<int>(1);
+    butil::IOBuf buf;
+    {
+        AttachmentWriter writer(&buf);
+        writer.Pin(pin);
+        writer.Append("hdr", 3);
+        writer.AppendPinned(::openmldb::base::Slice(large));
+        writer.AppendPinned(::openmldb::base::Slice(small));
+        char* owned = new char[4];
+        memcpy(owned, "efgh", 4);
+        writer.AppendOwned(owned, 4);
+        writer.AppendPinned(::openmldb::base::Slice(large));
+        writer.Finish();
+        // the small row is copied
+        ASSERT_EQ(2u, writer.GetRefCnt());
+    }
+    ASSERT_EQ("hdr" + large + small + "efgh" + large, buf.to_string());
+    // the large rows are referenced rather than copied
+    bool referenced = false;
+    for (size_t i = 0; i < buf.backing_block_num(); i++) {
+        if (buf.backing_block(i).data() == large.data()) {
+            referenced = true;
+        }
+    }
+    ASSERT_TRUE(referenced);
+    // the pins are released with the attachment
+    ASSERT_EQ(2, pin.use_count());
+    butil::IOBuf sent;
+    sent.append(buf);
+    buf.clear();
+    ASSERT_EQ(2, pin.use_count());
+    sent.clear();
+    ASSERT_EQ(1, pin.use_count());
+}
+
+TEST_F(AttachmentWriterTest, CopiedRows) {
+    FLAGS_scan_zero_copy_min_size = 0;
+    std::string row(100, 'a');
+    auto pin = std::make_shared<int>(1);
+    butil::IOBuf buf;
+    {
+        AttachmentWriter writer(&buf);
+        writer.Pin(pin);
+        writer.AppendPinned(::openmldb::base::Slice(row));
+        ASSERT_EQ(0u, writer.GetRefCnt());
+    }
+    // nothing is referenced, so the pins are released with the writer
+    ASSERT_EQ(1, pin.use_count());
+    ASSERT_EQ(row, buf.to_string());
+}
+
+}  // namespace tablet
+}  // namespace openmldb
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    ::google::ParseCommandLineFlags(&argc, &argv, true);
+    return RUN_ALL_TESTS();
+}
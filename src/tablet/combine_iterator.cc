@@ -32,6 +32,7 @@ CombineIterator::CombineIterator(std::vector<QueryIt> q_its, uint64_t start_time
       ttl_type_(expired_value.ttl_type),
       expire_time_(expired_value.abs_ttl),
       expire_cnt_(expired_value.lat_ttl),
+      merger_(),
       cur_qit_(nullptr) {}
 
 void CombineIterator::SeekToFirst() {
@@ -72,66 +73,64 @@ void CombineIterator::SeekToFirst() {
             q_it.it->SeekToFirst();
         }
     }
+    merger_.Reset(q_its_.size());
+    for (size_t i = 0; i < q_its_.size(); i++) {
+        AddIterator(i);
+    }
     SelectIterator();
 }
 
-void CombineIterator::SelectIterator() {
-    uint64_t max_ts = 0;
-    bool need_delete = false;
-    cur_qit_ = nullptr;
-    for (auto iter = q_its_.begin(); iter != q_its_.end(); iter++) {
-        uint64_t cur_ts = 0;
-        if (iter->it && iter->it->Valid()) {
-            cur_ts = iter->it->GetKey();
-            bool is_expire = false;
-            switch (ttl_type_) {
-                case ::openmldb::storage::TTLType::kAbsoluteTime:
-                    if (expire_time_ != 0 && cur_ts <= expire_time_) {
-                        is_expire = true;
-                    }
-                    break;
-                case ::openmldb::storage::TTLType::kLatestTime:
-                    if (expire_cnt_ != 0 && iter->iter_pos >= expire_cnt_) {
-                        is_expire = true;
-                    }
-                    break;
-                case ::openmldb::storage::TTLType::kAbsAndLat:
-                    if ((expire_cnt_ != 0 && iter->iter_pos >= expire_cnt_) &&
-                        (expire_time_ != 0 && cur_ts <= expire_time_)) {
-                        is_expire = true;
-                    }
-                    break;
-                case ::openmldb::storage::TTLType::kAbsOrLat:
-                    if ((expire_cnt_ != 0 && iter->iter_pos >= expire_cnt_) ||
-                        (expire_time_ != 0 && cur_ts <= expire_time_)) {
-                        is_expire = true;
-                    }
-                    break;
-                default:
-                    break;
-            }
-            if (is_expire) {
-                iter->it.reset();
-                need_delete = true;
-                continue;
-            }
-        }
-        if (cur_ts > max_ts) {
-            max_ts = cur_ts;
-            cur_qit_ = &(*iter);
-        }
+bool CombineIterator::IsExpired(const QueryIt& q_it, uint64_t ts) const {
+    switch (ttl_type_) {
+        case ::openmldb::storage::TTLType::kAbsoluteTime:
+            return expire_time_ != 0 && ts <= expire_time_;
+        case ::openmldb::storage::TTLType::kLatestTime:
+            return expire_cnt_ != 0 && q_it.iter_pos >= expire_cnt_;
+        case ::openmldb::storage::TTLType::kAbsAndLat:
+            return (expire_cnt_ != 0 && q_it.iter_pos >= expire_cnt_) && (expire_time_ != 0 && ts <= expire_time_);
+        case ::openmldb::storage::TTLType::kAbsOrLat:
+            return (expire_cnt_ != 0 && q_it.iter_pos >= expire_cnt_) || (expire_time_ != 0 && ts <= expire_time_);
+        default:
+            return false;
     }
-    if (need_delete) {
-        q_its_.erase(std::remove_if(q_its_.begin(), q_its_.end(), [](const QueryIt& q_it) { return !q_it.it; }),
-                     q_its_.end());
+}
+
+void CombineIterator::AddIterator(size_t idx) {
+    auto& q_it = q_its_[idx];
+    if (!q_it.it || !q_it.it->Valid()) {
+        return;
+    }
+    uint64_t ts = q_it.it->GetKey();
+    if (IsExpired(q_it, ts)) {
+        q_it.it.reset();
+        return;
+    }
+    // the row at ts 0 is never selected
+    if (ts > 0) {
+        merger_.Add(idx, ts);
     }
 }
 
+void CombineIterator::SelectIterator() { cur_qit_ = merger_.Empty() ? nullptr : &q_its_[merger_.Top()]; }
+
 void CombineIterator::Next() {
-    if (cur_qit_ != nullptr) {
-        cur_qit_->it->Next();
-        cur_qit_->iter_pos += 1;
-        cur_qit_ = nullptr;
+    if (cur_qit_ == nullptr) {
+        return;
+    }
+    cur_qit_->it->Next();
+    cur_qit_->iter_pos += 1;
+    uint64_t ts = 0;
+    if (cur_qit_->it->Valid()) {
+        ts = cur_qit_->it->GetKey();
+        if (IsExpired(*cur_qit_, ts)) {
+            cur_qit_->it.reset();
+            ts = 0;
+        }
+    }
+    if (ts > 0) {
+        merger_.Next(ts);
+    } else {
+        merger_.Pop();
     }
     SelectIterator();
 }
@@ -142,5 +141,7 @@ uint64_t CombineIterator::GetTs() { return cur_qit_->it->GetKey(); }
 
 openmldb::base::Slice CombineIterator::GetValue() { return cur_qit_->it->GetValue(); }
 
+bool CombineIterator::IsValuePinned() { return cur_qit_->it->IsValuePinned(); }
+
 }  // namespace tablet
 }  // namespace openmldb
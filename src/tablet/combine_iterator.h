@@ -17,8 +17,10 @@
 #pragma once
 #include <memory>
 #include <string>
+#include <functional>
 #include <vector>
 
+#include "base/kway_merger.h"
 #include "storage/table.h"
 
 namespace openmldb {
@@ -122,10 +124,15 @@ class CombineIterator {
     bool Valid();
     uint64_t GetTs();
     openmldb::base::Slice GetValue();
+    // the value is pinned by the iterators and tickets of the query iterators
+    bool IsValuePinned();
     inline uint64_t GetExpireTime() const { return expire_time_; }
     inline ::openmldb::storage::TTLType GetTTLType() const { return ttl_type_; }
 
  private:
+    // add the query iterator to the merger if it is at a row not expired
+    void AddIterator(size_t idx);
+    bool IsExpired(const QueryIt& q_it, uint64_t ts) const;
     void SelectIterator();
 
  private:
@@ -135,6 +142,8 @@ class CombineIterator {
     ::openmldb::storage::TTLType ttl_type_;
     uint64_t expire_time_;
     const uint32_t expire_cnt_;
+    // the query iterators by their ts, the ties go to the first one
+    ::hybridse::base::KWayMerger<uint64_t, std::greater<uint64_t>> merger_;
     QueryIt* cur_qit_;
 };
 
@@ -122,7 +122,7 @@ bool DataReceiver::WriteBinlogToReplicator(const std::shared_ptr<replica::LogRep
 DataReceiver::~DataReceiver() {
     for (auto block : data_blocks_) {
         if ((--block->dim_cnt_down) == 0) {
-            delete block;
+            ::openmldb::storage::DeleteDataBlock(block);
         }
     }
 }
@@ -0,0 +1,279 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tablet/deployment_materializer.h"
+
+#include <utility>
+
+#include "base/glog_wapper.h"
+#include "catalog/schema_adapter.h"
+#include "codec/schema_codec.h"
+
+namespace openmldb {
+namespace tablet {
+
+using ::openmldb::catalog::SchemaAdapter;
+using ::openmldb::codec::SchemaCodec;
+
+// the columns of the derived table before the outputs
+static const char DERIVED_KEY_COL[] = "__key";
+static const char DERIVED_TS_COL[] = "__ts";
+
+DeploymentMaterializer::DeploymentMaterializer(const ::openmldb::api::MaterializedDeployment& desc,
+                                               std::shared_ptr<Table> base_table, std::shared_ptr<Table> derived_table,
+                                               std::shared_ptr<LogReplicator> derived_replicator, Runner runner)
+    : desc_(desc),
+      base_table_(base_table),
+      derived_table_(derived_table),
+      derived_replicator_(derived_replicator),
+      runner_(std::move(runner)),
+      index_id_(0),
+      ts_idx_(-1),
+      output_schema_() {}
+
+bool DeploymentMaterializer::SetDerivedTableSchema(const ::hybridse::codec::Schema& output_schema,
+                                                   ::openmldb::api::TableMeta* table_meta) {
+    ::openmldb::codec::Schema outputs;
+    if (!SchemaAdapter::ConvertSchema(output_schema, &outputs)) {
+        return false;
+    }
+    table_meta->clear_column_desc();
+    table_meta->clear_column_key();
+    SchemaCodec::SetColumnDesc(table_meta->add_column_desc(), DERIVED_KEY_COL, ::openmldb::type::kString);
+    SchemaCodec::SetColumnDesc(table_meta->add_column_desc(), DERIVED_TS_COL, ::openmldb::type::kTimestamp);
+    for (const auto& col : outputs) {
+        SchemaCodec::SetColumnDesc(table_meta->add_column_desc(), col.name(), col.data_type());
+    }
+    SchemaCodec::SetIndex(table_meta->add_column_key(), DERIVED_KEY_COL, DERIVED_KEY_COL, DERIVED_TS_COL,
+                          ::openmldb::type::kLatestTime, 0, 1);
+    table_meta->set_format_version(1);
+    return true;
+}
+
+bool DeploymentMaterializer::Init(const ::hybridse::codec::Schema& request_schema,
+                                  const ::hybridse::codec::Schema& output_schema) {
+    auto base_meta = base_table_->GetTableMeta();
+    if (base_meta->format_version() != 1 || base_meta->compress_type() == ::openmldb::type::kSnappy) {
+        PDLOG(WARNING, "materialized deployment needs the uncompressed rows of format version 1. tid %u pid %u",
+              base_table_->GetId(), base_table_->GetPid());
+        return false;
+    }
+    auto index_def = base_table_->GetIndex(desc_.index_name());
+    if (!index_def) {
+        PDLOG(WARNING, "index %s of materialized deployment is not found. tid %u pid %u",
+              desc_.index_name().c_str(), base_table_->GetId(), base_table_->GetPid());
+        return false;
+    }
+    index_id_ = index_def->GetId();
+    auto ts_col = index_def->GetTsColumn();
+    ts_idx_ = ts_col ? ts_col->GetTsIdx() : -1;
+    // the put row is the request row of the deployment
+    bool request_matched = request_schema.size() == base_meta->column_desc_size();
+    for (int i = 0; request_matched && i < request_schema.size(); i++) {
+        ::hybridse::type::Type type;
+        request_matched = SchemaAdapter::ConvertType(base_meta->column_desc(i).data_type(), &type) &&
+                          type == request_schema.Get(i).type();
+    }
+    if (!request_matched) {
+        PDLOG(WARNING, "the request schema of deployment %s is mismatched with table tid %u",
+              desc_.sp_name().c_str(), base_table_->GetId());
+        return false;
+    }
+    ::openmldb::api::TableMeta expect_meta;
+    output_schema_.Clear();
+    if (!SetDerivedTableSchema(output_schema, &expect_meta) ||
+        !SchemaAdapter::ConvertSchema(output_schema, &output_schema_)) {
+        PDLOG(WARNING, "the outputs of deployment %s are not supported", desc_.sp_name().c_str());
+        return false;
+    }
+    auto derived_meta = derived_table_->GetTableMeta();
+    bool schema_matched = derived_meta->format_version() == 1 &&
+                          derived_meta->column_desc_size() == expect_meta.column_desc_size() &&
+                          derived_meta->column_key_size() > 0 &&
+                          derived_meta->column_key(0).ts_name() == expect_meta.column_key(0).ts_name();
+    for (int i = 0; schema_matched && i < expect_meta.column_desc_size(); i++) {
+        schema_matched = derived_meta->column_desc(i).data_type() == expect_meta.column_desc(i).data_type();
+    }
+    if (!schema_matched) {
+        PDLOG(WARNING, "the schema of derived table tid %u is mismatched with deployment %s", derived_table_->GetId(),
+              desc_.sp_name().c_str());
+        return false;
+    }
+    PDLOG(INFO, "init materialized deployment %s.%s on index %s with derived table tid %u. tid %u pid %u",
+          desc_.db().c_str(), desc_.sp_name().c_str(), desc_.index_name().c_str(), derived_table_->GetId(),
+          base_table_->GetId(), base_table_->GetPid());
+    return true;
+}
+
+bool DeploymentMaterializer::GetKey(const ::openmldb::api::PutRequest& request, std::string* key, uint64_t* ts) {
+    bool has_found_key = false;
+    if (request.dimensions_size() == 0) {
+        if (index_id_ == 0) {
+            key->assign(request.pk());
+            has_found_key = true;
+        }
+    } else {
+        for (const auto& dimension : request.dimensions()) {
+            if (dimension.idx() == index_id_) {
+                key->assign(dimension.key());
+                has_found_key = true;
+                break;
+            }
+        }
+    }
+    if (!has_found_key) {
+        return false;
+    }
+    *ts = request.time();
+    if (ts_idx_ >= 0) {
+        for (const auto& ts_dimension : request.ts_dimensions()) {
+            if (static_cast<int32_t>(ts_dimension.idx()) == ts_idx_) {
+                *ts = ts_dimension.ts();
+                break;
+            }
+        }
+    }
+    return true;
+}
+
+bool DeploymentMaterializer::Compute(const ::openmldb::api::PutRequest& request, DerivedRow* row) {
+    row->value.clear();
+    if (!GetKey(request, &row->key, &row->ts)) {
+        return false;
+    }
+    ::hybridse::codec::Row output;
+    auto status = runner_(::hybridse::codec::Row(request.value()), &output);
+    if (!status.isOK()) {
+        DEBUGLOG("fail to run deployment %s: %s. tid %u pid %u", desc_.sp_name().c_str(), status.msg.c_str(),
+                 base_table_->GetId(), base_table_->GetPid());
+        return false;
+    }
+    if (!EncodeRow(row->key, row->ts, output, &row->value)) {
+        row->value.clear();
+        return false;
+    }
+    return true;
+}
+
+bool DeploymentMaterializer::EncodeRow(const std::string& key, uint64_t ts, const ::hybridse::codec::Row& output,
+                                       std::string* row) {
+    if (output.GetRowPtrCnt() != 1 || output.size() <= 0) {
+        PDLOG(WARNING, "the outputs of deployment %s are not in one row", desc_.sp_name().c_str());
+        return false;
+    }
+    // the rows of the engine are encoded as the rows of the tables
+    ::openmldb::codec::RowView view(output_schema_, output.buf(), output.size());
+    uint32_t str_len = key.size();
+    for (int i = 0; i < output_schema_.size(); i++) {
+        auto type = output_schema_.Get(i).data_type();
+        if ((type == ::openmldb::type::kString || type == ::openmldb::type::kVarchar) && !view.IsNULL(i)) {
+            char* str = nullptr;
+            uint32_t length = 0;
+            view.GetString(i, &str, &length);
+            str_len += length;
+        }
+    }
+    ::openmldb::codec::RowBuilder builder(derived_table_->GetTableMeta()->column_desc());
+    uint32_t size = builder.CalTotalLength(str_len);
+    row->resize(size);
+    builder.SetBuffer(reinterpret_cast<int8_t*>(&(*row)[0]), size);
+    builder.AppendString(key.c_str(), key.size());
+    builder.AppendTimestamp(ts);
+    bool ok = true;
+    for (int i = 0; ok && i < output_schema_.size(); i++) {
+        if (view.IsNULL(i)) {
+            ok = builder.AppendNULL();
+            continue;
+        }
+        switch (output_schema_.Get(i).data_type()) {
+            case ::openmldb::type::kBool: {
+                bool val = false;
+                ok = view.GetBool(i, &val) == 0 && builder.AppendBool(val);
+                break;
+            }
+            case ::openmldb::type::kSmallInt: {
+                int16_t val = 0;
+                ok = view.GetInt16(i, &val) == 0 && builder.AppendInt16(val);
+                break;
+            }
+            case ::openmldb::type::kInt: {
+                int32_t val = 0;
+                ok = view.GetInt32(i, &val) == 0 && builder.AppendInt32(val);
+                break;
+            }
+            case ::openmldb::type::kBigInt: {
+                int64_t val = 0;
+                ok = view.GetInt64(i, &val) == 0 && builder.AppendInt64(val);
+                break;
+            }
+            case ::openmldb::type::kTimestamp: {
+                int64_t val = 0;
+                ok = view.GetTimestamp(i, &val) == 0 && builder.AppendTimestamp(val);
+                break;
+            }
+            case ::openmldb::type::kFloat: {
+                float val = 0;
+                ok = view.GetFloat(i, &val) == 0 && builder.AppendFloat(val);
+                break;
+            }
+            case ::openmldb::type::kDouble: {
+                double val = 0;
+                ok = view.GetDouble(i, &val) == 0 && builder.AppendDouble(val);
+                break;
+            }
+            case ::openmldb::type::kDate: {
+                int32_t val = 0;
+                ok = view.GetDate(i, &val) == 0 && builder.AppendDate(val);
+                break;
+            }
+            case ::openmldb::type::kString:
+            case ::openmldb::type::kVarchar: {
+                char* str = nullptr;
+                uint32_t length = 0;
+                ok = view.GetString(i, &str, &length) == 0 && builder.AppendString(str, length);
+                break;
+            }
+            default:
+                ok = false;
+        }
+    }
+    if (!ok) {
+        PDLOG(WARNING, "fail to encode the outputs of deployment %s. tid %u pid %u", desc_.sp_name().c_str(),
+              base_table_->GetId(), base_table_->GetPid());
+    }
+    return ok;
+}
+
+bool DeploymentMaterializer::Write(const DerivedRow& row) {
+    ::openmldb::api::LogEntry entry;
+    entry.set_term(derived_replicator_->GetLeaderTerm());
+    entry.set_value(row.value);
+    auto dimension = entry.add_dimensions();
+    dimension->set_key(row.key);
+    dimension->set_idx(0);
+    auto ts_dimension = entry.add_ts_dimensions();
+    ts_dimension->set_ts(row.ts);
+    ts_dimension->set_idx(0);
+    if (!derived_table_->Put(entry) || !derived_replicator_->AppendEntry(entry)) {
+        PDLOG(WARNING, "fail to write the outputs of deployment %s to derived table tid %u. tid %u pid %u",
+              desc_.sp_name().c_str(), derived_table_->GetId(), base_table_->GetId(), base_table_->GetPid());
+        return false;
+    }
+    return true;
+}
+
+}  // namespace tablet
+}  // namespace openmldb
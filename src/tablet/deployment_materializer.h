@@ -0,0 +1,97 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_TABLET_DEPLOYMENT_MATERIALIZER_H_
+#define SRC_TABLET_DEPLOYMENT_MATERIALIZER_H_
+
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "base/fe_status.h"
+#include "codec/codec.h"
+#include "codec/fe_row_codec.h"
+#include "proto/tablet.pb.h"
+#include "replica/log_replicator.h"
+#include "storage/table.h"
+
+namespace openmldb {
+namespace tablet {
+
+using ::openmldb::replica::LogReplicator;
+using ::openmldb::storage::Table;
+
+// the row of the derived table computed for a put, the value is empty if it is not computed
+struct DerivedRow {
+    std::string key;
+    uint64_t ts = 0;
+    std::string value;
+};
+
+// Runs a deployment on every row put to the table and keeps its outputs for the latest row of every key of an
+// index in a derived table, so the features of a key are read by a point lookup of the derived table instead of
+// the computation over the windows of the base table. The outputs are computed before the row is put, as the
+// request row of the deployment is not in the windows yet.
+class DeploymentMaterializer {
+ public:
+    // run the deployment on the request row
+    typedef std::function<::hybridse::base::Status(const ::hybridse::codec::Row&, ::hybridse::codec::Row*)> Runner;
+
+    DeploymentMaterializer(const ::openmldb::api::MaterializedDeployment& desc, std::shared_ptr<Table> base_table,
+                           std::shared_ptr<Table> derived_table, std::shared_ptr<LogReplicator> derived_replicator,
+                           Runner runner);
+    DeploymentMaterializer(const DeploymentMaterializer&) = delete;
+    DeploymentMaterializer& operator=(const DeploymentMaterializer&) = delete;
+
+    // the schema of the derived table, the key and the ts of the put row followed by the outputs. It is indexed by
+    // key and keeps the latest row only
+    static bool SetDerivedTableSchema(const ::hybridse::codec::Schema& output_schema,
+                                      ::openmldb::api::TableMeta* table_meta);
+
+    // check the schemas of the deployment against the base and the derived tables
+    bool Init(const ::hybridse::codec::Schema& request_schema, const ::hybridse::codec::Schema& output_schema);
+
+    // run the deployment on the row of the request and encode the row of the derived table. It is false if the
+    // row has no key of the index, or the deployment fails
+    bool Compute(const ::openmldb::api::PutRequest& request, DerivedRow* row);
+
+    // put the row computed to the derived table and its binlog
+    bool Write(const DerivedRow& row);
+
+    inline uint32_t GetDerivedTid() const { return derived_table_->GetId(); }
+    inline const ::openmldb::api::MaterializedDeployment& GetDesc() const { return desc_; }
+
+ private:
+    bool GetKey(const ::openmldb::api::PutRequest& request, std::string* key, uint64_t* ts);
+
+    bool EncodeRow(const std::string& key, uint64_t ts, const ::hybridse::codec::Row& output, std::string* row);
+
+ private:
+    ::openmldb::api::MaterializedDeployment desc_;
+    std::shared_ptr<Table> base_table_;
+    std::shared_ptr<Table> derived_table_;
+    std::shared_ptr<LogReplicator> derived_replicator_;
+    Runner runner_;
+    uint32_t index_id_;
+    int32_t ts_idx_;
+    // the outputs in the types of the derived table
+    ::openmldb::codec::Schema output_schema_;
+};
+
+}  // namespace tablet
+}  // namespace openmldb
+
+#endif  // SRC_TABLET_DEPLOYMENT_MATERIALIZER_H_
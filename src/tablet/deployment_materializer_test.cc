@@ -0,0 +1,214 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tablet/deployment_materializer.h"
+
+#include <gtest/gtest.h>
+
+#include <map>
+#include <string>
+
+#include "base/glog_wapper.h"
+#include "catalog/schema_adapter.h"
+#include "codec/schema_codec.h"
+#include "storage/mem_table.h"
+#include "storage/ticket.h"
+
+using ::openmldb::codec::SchemaCodec;
+using ::openmldb::replica::kLeaderNode;
+using ::openmldb::storage::MemTable;
+using ::openmldb::storage::TableIterator;
+using ::openmldb::storage::Ticket;
+
+namespace openmldb {
+namespace tablet {
+
+class DeploymentMaterializerTest : public ::testing::Test {
+ public:
+    DeploymentMaterializerTest() {}
+    ~DeploymentMaterializerTest() {}
+};
+
+inline std::string GenRand() { return std::to_string(rand() % 10000000 + 1); }  // NOLINT
+
+static std::shared_ptr<MemTable> CreateBaseTable() {
+    ::openmldb::api::TableMeta table_meta;
+    table_meta.set_name("t1");
+    table_meta.set_tid(1);
+    table_meta.set_pid(0);
+    table_meta.set_format_version(1);
+    SchemaCodec::SetColumnDesc(table_meta.add_column_desc(), "card", ::openmldb::type::kString);
+    SchemaCodec::SetColumnDesc(table_meta.add_column_desc(), "price", ::openmldb::type::kBigInt);
+    SchemaCodec::SetColumnDesc(table_meta.add_column_desc(), "ts1", ::openmldb::type::kTimestamp);
+    SchemaCodec::SetIndex(table_meta.add_column_key(), "card", "card", "ts1", ::openmldb::type::kAbsoluteTime, 0, 0);
+    auto table = std::make_shared<MemTable>(table_meta);
+    table->Init();
+    return table;
+}
+
+static void AddColumn(::hybridse::codec::Schema* schema, const std::string& name, ::hybridse::type::Type type) {
+    auto col = schema->Add();
+    col->set_name(name);
+    col->set_type(type);
+}
+
+static ::openmldb::api::PutRequest BuildPut(MemTable* table, const std::string& card, int64_t price, uint64_t ts) {
+    ::openmldb::codec::RowBuilder builder(table->GetTableMeta()->column_desc());
+    uint32_t size = builder.CalTotalLength(card.size());
+    std::string row;
+    row.resize(size);
+    builder.SetBuffer(reinterpret_cast<int8_t*>(&row[0]), size);
+    builder.AppendString(card.c_str(), card.size());
+    builder.AppendInt64(price);
+    builder.AppendTimestamp(ts);
+    ::openmldb::api::PutRequest request;
+    request.set_value(row);
+    auto dim = request.add_dimensions();
+    dim->set_idx(0);
+    dim->set_key(card);
+    auto ts_dim = request.add_ts_dimensions();
+    ts_dim->set_idx(0);
+    ts_dim->set_ts(ts);
+    return request;
+}
+
+TEST_F(DeploymentMaterializerTest, ComputeAndWrite) {
+    std::string folder = "/tmp/" + GenRand() + "/";
+    std::atomic<bool> follower(false);
+    auto base_table = CreateBaseTable();
+    ::hybridse::codec::Schema request_schema;
+    ASSERT_TRUE(::openmldb::catalog::SchemaAdapter::ConvertSchema(base_table->GetTableMeta()->column_desc(),
+                                                                &request_schema));
+    ::hybridse::codec::Schema output_schema;
+    AddColumn(&output_schema, "card", ::hybridse::type::kVarchar);
+    AddColumn(&output_schema, "price_sum", ::hybridse::type::kInt64);
+    ::openmldb::api::TableMeta derived_meta;
+    derived_meta.set_name("t1_sp");
+    derived_meta.set_tid(2);
+    derived_meta.set_pid(0);
+    ASSERT_TRUE(DeploymentMaterializer::SetDerivedTableSchema(output_schema, &derived_meta));
+    auto derived_table = std::make_shared<MemTable>(derived_meta);
+    derived_table->Init();
+    auto derived_replicator =
+        std::make_shared<LogReplicator>(folder + "2_0", std::map<std::string, std::string>(), kLeaderNode,
+                                        derived_table, &follower);
+    ASSERT_TRUE(derived_replicator->Init());
+
+    // sum the prices of the card in the base table and the request row, like a window to the current row
+    ::openmldb::codec::Schema outputs;
+    ASSERT_TRUE(::openmldb::catalog::SchemaAdapter::ConvertSchema(output_schema, &outputs));
+    auto runner = [&](const ::hybridse::codec::Row& row, ::hybridse::codec::Row* output) {
+        ::openmldb::codec::RowView view(base_table->GetTableMeta()->column_desc(), row.buf(), row.size());
+        char* card = nullptr;
+        uint32_t length = 0;
+        int64_t sum = 0;
+        view.GetString(0, &card, &length);
+        view.GetInt64(1, &sum);
+        std::string pk(card, length);
+        Ticket ticket;
+        std::unique_ptr<TableIterator> it(base_table->NewIterator(0, pk, ticket));
+        for (it->SeekToFirst(); it->Valid(); it->Next()) {
+            auto value = it->GetValue();
+            int64_t price = 0;
+            view.Reset(reinterpret_cast<const int8_t*>(value.data()), value.size());
+            view.GetInt64(1, &price);
+            sum += price;
+        }
+        ::openmldb::codec::RowBuilder builder(outputs);
+        uint32_t size = builder.CalTotalLength(pk.size());
+        std::string buf;
+        buf.resize(size);
+        builder.SetBuffer(reinterpret_cast<int8_t*>(&buf[0]), size);
+        builder.AppendString(pk.c_str(), pk.size());
+        builder.AppendInt64(sum);
+        *output = ::hybridse::codec::Row(buf);
+        return ::hybridse::base::Status::OK();
+    };
+    ::openmldb::api::MaterializedDeployment desc;
+    desc.set_db("db1");
+    desc.set_sp_name("sp1");
+    desc.set_index_name("card");
+    desc.set_derived_tid(2);
+    DeploymentMaterializer materializer(desc, base_table, derived_table, derived_replicator, runner);
+    ASSERT_TRUE(materializer.Init(request_schema, output_schema));
+    std::map<std::string, int64_t> expect;
+    for (int i = 0; i < 100; i++) {
+        std::string card = "card" + std::to_string(i % 3);
+        auto request = BuildPut(base_table.get(), card, i, 1000 + i);
+        DerivedRow row;
+        ASSERT_TRUE(materializer.Compute(request, &row));
+        ASSERT_EQ(card, row.key);
+        ASSERT_EQ(1000u + i, row.ts);
+        ASSERT_TRUE(base_table->Put(request.dimensions(), request.ts_dimensions(), request.value()));
+        ASSERT_TRUE(materializer.Write(row));
+        expect[card] += i;
+    }
+    ASSERT_EQ(100u, derived_replicator->GetOffset());
+    // the latest row of the key keeps the outputs on all the rows of the key
+    ::openmldb::codec::RowView view(derived_table->GetTableMeta()->column_desc());
+    for (const auto& kv : expect) {
+        Ticket ticket;
+        std::unique_ptr<TableIterator> it(derived_table->NewIterator(0, kv.first, ticket));
+        it->SeekToFirst();
+        ASSERT_TRUE(it->Valid());
+        auto value = it->GetValue();
+        ASSERT_TRUE(view.Reset(reinterpret_cast<const int8_t*>(value.data()), value.size()));
+        char* card = nullptr;
+        uint32_t length = 0;
+        ASSERT_EQ(0, view.GetString(2, &card, &length));
+        ASSERT_EQ(kv.first, std::string(card, length));
+        int64_t sum = 0;
+        ASSERT_EQ(0, view.GetInt64(3, &sum));
+        ASSERT_EQ(kv.second, sum);
+    }
+}
+
+TEST_F(DeploymentMaterializerTest, SchemaMismatched) {
+    std::string folder = "/tmp/" + GenRand() + "/";
+    std::atomic<bool> follower(false);
+    auto base_table = CreateBaseTable();
+    auto base_replicator =
+        std::make_shared<LogReplicator>(folder + "1_0", std::map<std::string, std::string>(), kLeaderNode,
+                                        base_table, &follower);
+    ASSERT_TRUE(base_replicator->Init());
+    ::hybridse::codec::Schema request_schema;
+    ASSERT_TRUE(::openmldb::catalog::SchemaAdapter::ConvertSchema(base_table->GetTableMeta()->column_desc(),
+                                                                &request_schema));
+    ::hybridse::codec::Schema output_schema;
+    AddColumn(&output_schema, "price_sum", ::hybridse::type::kInt64);
+    ::openmldb::api::MaterializedDeployment desc;
+    desc.set_sp_name("sp1");
+    desc.set_index_name("card");
+    auto runner = [](const ::hybridse::codec::Row&, ::hybridse::codec::Row*) {
+        return ::hybridse::base::Status::OK();
+    };
+    // the base table is not a derived table of the outputs
+    DeploymentMaterializer materializer(desc, base_table, base_table, base_replicator, runner);
+    ASSERT_FALSE(materializer.Init(request_schema, output_schema));
+    // the request schema is not the schema of the base table
+    DeploymentMaterializer other(desc, base_table, base_table, base_replicator, runner);
+    ASSERT_FALSE(other.Init(output_schema, output_schema));
+}
+
+}  // namespace tablet
+}  // namespace openmldb
+
+int main(int argc, char** argv) {
+    srand(time(NULL));
+    ::openmldb::base::SetLogLevel(INFO);
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
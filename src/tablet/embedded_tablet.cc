@@ -0,0 +1,94 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tablet/embedded_tablet.h"
+
+#include <gflags/gflags.h>
+
+#include "base/glog_wapper.h"
+#include "rpc/local_channel.h"
+
+DECLARE_string(endpoint);
+DECLARE_int32(thread_pool_size);
+
+namespace openmldb {
+namespace tablet {
+
+EmbeddedTablet::EmbeddedTablet() : tablet_(std::make_shared<TabletImpl>()), server_(), endpoint_(), started_(false) {}
+
+EmbeddedTablet::~EmbeddedTablet() { Stop(); }
+
+bool EmbeddedTablet::Start() {
+    if (started_) {
+        return true;
+    }
+    ::hybridse::vm::Engine::InitializeGlobalLLVM();
+    if (!tablet_->Init("")) {
+        PDLOG(WARNING, "fail to init the embedded tablet");
+        return false;
+    }
+    brpc::ServerOptions options;
+    options.num_threads = FLAGS_thread_pool_size;
+    if (server_.AddService(tablet_.get(), brpc::SERVER_DOESNT_OWN_SERVICE) != 0) {
+        PDLOG(WARNING, "fail to add the service of the embedded tablet");
+        return false;
+    }
+    tablet_->SetServer(&server_);
+    if (server_.Start(FLAGS_endpoint.c_str(), &options) != 0) {
+        PDLOG(WARNING, "fail to start the embedded tablet on %s", FLAGS_endpoint.c_str());
+        return false;
+    }
+    if (!tablet_->RegisterZK()) {
+        PDLOG(WARNING, "fail to register the embedded tablet %s to zk", FLAGS_endpoint.c_str());
+        server_.Stop(0);
+        server_.Join();
+        return false;
+    }
+    endpoint_ = FLAGS_endpoint;
+    LocalServiceRegistry::Register(endpoint_, tablet_);
+    started_ = true;
+    PDLOG(INFO, "start the embedded tablet on %s", endpoint_.c_str());
+    return true;
+}
+
+void EmbeddedTablet::Stop() {
+    if (!started_) {
+        return;
+    }
+    // the clients created before the stop hold and call the tablet still
+    LocalServiceRegistry::Unregister(endpoint_);
+    server_.Stop(0);
+    server_.Join();
+    started_ = false;
+}
+
+::hybridse::base::Status EmbeddedTablet::CallProcedure(const std::string& db, const std::string& sp_name,
+                                                      const ::hybridse::codec::Row& row,
+                                                      ::hybridse::codec::Row* output, uint64_t timeout_ms) {
+    if (output == nullptr) {
+        return ::hybridse::base::Status(::hybridse::common::kRunError, "output is null");
+    }
+    return tablet_->CallProcedureLocal(db, sp_name, row, timeout_ms, output);
+}
+
+::hybridse::base::Status EmbeddedTablet::GetProcedureSchema(const std::string& db, const std::string& sp_name,
+                                                           ::hybridse::codec::Schema* request_schema,
+                                                           ::hybridse::codec::Schema* output_schema) {
+    return tablet_->GetProcedureSchema(db, sp_name, request_schema, output_schema);
+}
+
+}  // namespace tablet
+}  // namespace openmldb
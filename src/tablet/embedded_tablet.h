@@ -0,0 +1,69 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_TABLET_EMBEDDED_TABLET_H_
+#define SRC_TABLET_EMBEDDED_TABLET_H_
+
+#include <brpc/server.h>
+
+#include <memory>
+#include <string>
+
+#include "tablet/tablet_impl.h"
+
+namespace openmldb {
+namespace tablet {
+
+// EmbeddedTablet runs a tablet in the process of the application. The tablet joins the cluster like the other
+// ones, so the nameserver can put the leaders or the followers of the tables read by the deployments on it,
+// and the deployments are called on the engine of the tablet in the process, without the sdk and the rpc. The
+// partitions not on the tablet are read from the other tablets as usual.
+//
+// The tablet is registered to the LocalServiceRegistry, so the sdk in the process calls it without the socket
+// if --enable_local_call is on.
+class EmbeddedTablet {
+ public:
+    EmbeddedTablet();
+    ~EmbeddedTablet();
+
+    EmbeddedTablet(const EmbeddedTablet&) = delete;
+    EmbeddedTablet& operator=(const EmbeddedTablet&) = delete;
+
+    // start the tablet with the flags of the tablet, eg, --endpoint, --zk_cluster and --db_root_path, the
+    // server of the tablet serves the nameserver and the other tablets
+    bool Start();
+    void Stop();
+
+    // run the deployment on the request row encoded in the request schema, see TabletImpl::CallProcedureLocal
+    ::hybridse::base::Status CallProcedure(const std::string& db, const std::string& sp_name,
+                                           const ::hybridse::codec::Row& row, ::hybridse::codec::Row* output,
+                                           uint64_t timeout_ms = 0);
+    ::hybridse::base::Status GetProcedureSchema(const std::string& db, const std::string& sp_name,
+                                                ::hybridse::codec::Schema* request_schema,
+                                                ::hybridse::codec::Schema* output_schema);
+
+    TabletImpl* GetTablet() { return tablet_.get(); }
+
+ private:
+    std::shared_ptr<TabletImpl> tablet_;
+    brpc::Server server_;
+    std::string endpoint_;
+    bool started_;
+};
+
+}  // namespace tablet
+}  // namespace openmldb
+#endif  // SRC_TABLET_EMBEDDED_TABLET_H_
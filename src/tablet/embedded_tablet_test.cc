@@ -0,0 +1,139 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tablet/embedded_tablet.h"
+
+#include <brpc/server.h>
+#include <gflags/gflags.h>
+#include <unistd.h>
+
+#include "base/glog_wapper.h"
+#include "codec/fe_row_codec.h"
+#include "gtest/gtest.h"
+#include "nameserver/name_server_impl.h"
+#include "rpc/local_channel.h"
+#include "sdk/sql_router.h"
+
+DECLARE_string(endpoint);
+DECLARE_string(db_root_path);
+DECLARE_string(zk_cluster);
+DECLARE_string(zk_root_path);
+DECLARE_int32(zk_session_timeout);
+
+using ::openmldb::nameserver::NameServerImpl;
+
+namespace openmldb {
+namespace tablet {
+
+inline std::string GenRand() {
+    return std::to_string(rand() % 10000000 + 1);  // NOLINT
+}
+
+class EmbeddedTabletTest : public ::testing::Test {
+ public:
+    EmbeddedTabletTest() {}
+    ~EmbeddedTabletTest() {}
+};
+
+TEST_F(EmbeddedTabletTest, CallProcedure) {
+    FLAGS_zk_cluster = "127.0.0.1:6181";
+    FLAGS_zk_root_path = "/rtidb4" + GenRand();
+
+    FLAGS_endpoint = "127.0.0.1:9632";
+    brpc::Server ns_server;
+    NameServerImpl* nameserver = new NameServerImpl();
+    ASSERT_TRUE(nameserver->Init(""));
+    brpc::ServerOptions options;
+    ASSERT_EQ(0, ns_server.AddService(nameserver, brpc::SERVER_OWNS_SERVICE));
+    ASSERT_EQ(0, ns_server.Start(FLAGS_endpoint.c_str(), &options));
+    sleep(2);
+
+    // the only tablet of the cluster is in the process, so all the partitions are local
+    FLAGS_endpoint = "127.0.0.1:9832";
+    FLAGS_db_root_path = "/tmp/" + GenRand();
+    EmbeddedTablet embedded;
+    ASSERT_TRUE(embedded.Start());
+    ASSERT_TRUE(LocalServiceRegistry::Find(FLAGS_endpoint));
+    sleep(2);
+
+    openmldb::sdk::SQLRouterOptions sql_opt;
+    sql_opt.zk_cluster = FLAGS_zk_cluster;
+    sql_opt.zk_path = FLAGS_zk_root_path;
+    auto router = openmldb::sdk::NewClusterSQLRouter(sql_opt);
+    ASSERT_TRUE(router);
+    std::string db = "test" + GenRand();
+    hybridse::sdk::Status status;
+    ASSERT_TRUE(router->CreateDB(db, &status));
+    std::string ddl = "create table trans(c1 string, c3 int, c4 bigint, c7 timestamp, index(key=c1, ts=c7));";
+    ASSERT_TRUE(router->ExecuteDDL(db, ddl, &status)) << status.msg;
+    ASSERT_TRUE(router->RefreshCatalog());
+    ASSERT_TRUE(router->ExecuteInsert(db, "insert into trans values(\"bb\",24,34,1590738994000);", &status));
+    std::string sql =
+        "SELECT c1, c3, sum(c4) OVER w1 as w1_c4_sum FROM trans WINDOW w1 AS"
+        " (PARTITION BY trans.c1 ORDER BY trans.c7 ROWS BETWEEN 2 PRECEDING AND CURRENT ROW);";
+    std::string sp_ddl = "create procedure sp (const c1 string, const c3 int, c4 bigint, c7 timestamp) begin " +
+                         sql + " end;";
+    ASSERT_TRUE(router->ExecuteDDL(db, sp_ddl, &status)) << status.msg;
+    ASSERT_TRUE(router->RefreshCatalog());
+
+    auto request_row = router->GetRequestRow(db, sql, &status);
+    ASSERT_TRUE(request_row);
+    request_row->Init(2);
+    ASSERT_TRUE(request_row->AppendString("bb"));
+    ASSERT_TRUE(request_row->AppendInt32(23));
+    ASSERT_TRUE(request_row->AppendInt64(33));
+    ASSERT_TRUE(request_row->AppendTimestamp(1590738995000));
+    ASSERT_TRUE(request_row->Build());
+
+    ::hybridse::codec::Schema request_schema;
+    ::hybridse::codec::Schema output_schema;
+    ASSERT_TRUE(embedded.GetProcedureSchema(db, "sp", &request_schema, &output_schema).isOK());
+    ASSERT_EQ(4, request_schema.size());
+    ASSERT_EQ(3, output_schema.size());
+
+    ::hybridse::codec::Row output;
+    auto ret = embedded.CallProcedure(db, "sp", ::hybridse::codec::Row(request_row->GetRow()), &output);
+    ASSERT_TRUE(ret.isOK()) << ret;
+    ::hybridse::codec::RowView row_view(output_schema, output.buf(), output.size());
+    ASSERT_EQ("bb", row_view.GetStringUnsafe(0));
+    ASSERT_EQ(23, row_view.GetInt32Unsafe(1));
+    ASSERT_EQ(67, row_view.GetInt64Unsafe(2));
+
+    // the same output as the call by the sdk, which calls the tablet in the process too
+    auto rs = router->CallProcedure(db, "sp", request_row, &status);
+    ASSERT_TRUE(rs);
+    ASSERT_TRUE(rs->Next());
+    ASSERT_EQ(rs->GetInt64Unsafe(2), row_view.GetInt64Unsafe(2));
+
+    ret = embedded.CallProcedure(db, "sp_not_exist", ::hybridse::codec::Row(request_row->GetRow()), &output);
+    ASSERT_EQ(::hybridse::common::kProcedureNotFound, ret.code);
+
+    embedded.Stop();
+    ASSERT_FALSE(LocalServiceRegistry::Find(FLAGS_endpoint));
+    ns_server.Stop(10);
+}
+
+}  // namespace tablet
+}  // namespace openmldb
+
+int main(int argc, char** argv) {
+    FLAGS_zk_session_timeout = 2000;
+    ::testing::InitGoogleTest(&argc, argv);
+    srand(time(NULL));
+    ::openmldb::base::SetLogLevel(INFO);
+    ::google::ParseCommandLineFlags(&argc, &argv, true);
+    return RUN_ALL_TESTS();
+}
@@ -16,6 +16,10 @@
 
 #include "tablet/file_receiver.h"
 
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
 #include "base/file_util.h"
 #include "base/glog_wapper.h"
 #include "base/strings.h"
@@ -24,16 +28,16 @@ namespace openmldb {
 namespace tablet {
 
 FileReceiver::FileReceiver(const std::string& file_name, const std::string& dir_name, const std::string& path)
-    : file_name_(file_name), dir_name_(dir_name), path_(path), size_(0), block_id_(0), file_(NULL) {}
+    : file_name_(file_name), dir_name_(dir_name), path_(path), size_(0), block_id_(0), fd_(-1) {}
 
 FileReceiver::~FileReceiver() {
-    if (file_) fclose(file_);
+    if (fd_ >= 0) close(fd_);
 }
 
 bool FileReceiver::Init() {
-    if (file_) {
-        fclose(file_);
-        file_ = NULL;
+    if (fd_ >= 0) {
+        close(fd_);
+        fd_ = -1;
     }
     if (path_.back() != '/') {
         path_.append("/");
@@ -43,20 +47,21 @@ bool FileReceiver::Init() {
         return false;
     }
     std::string full_path = path_ + file_name_ + ".tmp";
-    FILE* file = fopen(full_path.c_str(), "wb");
-    if (file == NULL) {
+    int fd = open(full_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
         PDLOG(WARNING, "fail to open file %s", full_path.c_str());
         return false;
     }
-    file_ = file;
+    fd_ = fd;
+    size_ = 0;
     block_id_ = 0;
     return true;
 }
 
 uint64_t FileReceiver::GetBlockId() { return block_id_; }
 
-int FileReceiver::WriteData(const std::string& data, uint64_t block_id) {
-    if (file_ == NULL) {
+int FileReceiver::WriteData(const butil::IOBuf& data, uint64_t block_id) {
+    if (fd_ < 0) {
         PDLOG(WARNING, "file is NULL");
         return -1;
     }
@@ -64,23 +69,26 @@ int FileReceiver::WriteData(const std::string& data, uint64_t block_id) {
         DEBUGLOG("block id %lu has been received", block_id);
         return 0;
     }
-
-#ifdef __APPLE__
-    size_t r = fwrite(data.c_str(), 1, data.size(), file_);
-#else
-    // linux
-    size_t r = fwrite_unlocked(data.c_str(), 1, data.size(), file_);
-#endif
-    if (r < data.size()) {
-        PDLOG(WARNING, "write error. name %s%s", path_.c_str(), file_name_.c_str());
-        return -1;
+    // the copy refers to the same blocks
+    butil::IOBuf left(data);
+    size_t size = left.size();
+    while (!left.empty()) {
+        ssize_t r = left.cut_into_file_descriptor(fd_);
+        if (r < 0 && errno != EINTR) {
+            PDLOG(WARNING, "write error. name %s%s", path_.c_str(), file_name_.c_str());
+            return -1;
+        }
     }
-    size_ += r;
+    size_ += size;
     block_id_ = block_id;
     return 0;
 }
 
 void FileReceiver::SaveFile() {
+    if (fd_ >= 0) {
+        close(fd_);
+        fd_ = -1;
+    }
     std::string full_path = path_ + file_name_;
     std::string tmp_file_path = full_path + ".tmp";
     if (::openmldb::base::IsExists(full_path)) {
@@ -16,6 +16,8 @@
 
 #pragma once
 
+#include <butil/iobuf.h>
+
 #include <string>
 
 namespace openmldb {
@@ -28,7 +30,8 @@ class FileReceiver {
     FileReceiver(const FileReceiver&) = delete;
     FileReceiver& operator=(const FileReceiver&) = delete;
     bool Init();
-    int WriteData(const std::string& data, uint64_t block_id);
+    // write the blocks of data to the file without copying them out
+    int WriteData(const butil::IOBuf& data, uint64_t block_id);
     void SaveFile();
     uint64_t GetBlockId();
 
@@ -38,7 +41,7 @@ class FileReceiver {
     std::string path_;
     uint64_t size_;
     uint64_t block_id_;
-    FILE* file_;
+    int fd_;
 };
 
 }  // namespace tablet
@@ -16,11 +16,18 @@
 
 #include "tablet/file_sender.h"
 
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <memory>
 #include <thread>  // NOLINT
 #include <vector>
 
 #include "base/file_util.h"
 #include "base/glog_wapper.h"
+#include "base/rate_limiter.h"
 #include "boost/algorithm/string/predicate.hpp"
 #include "common/timer.h"
 #include "gflags/gflags.h"
@@ -28,16 +35,25 @@
 DECLARE_int32(send_file_max_try);
 DECLARE_uint32(stream_block_size);
 DECLARE_int32(stream_bandwidth_limit);
-DECLARE_uint32(stream_block_size);
-DECLARE_int32(stream_bandwidth_limit);
+DECLARE_uint64(stream_node_bandwidth_limit);
+DECLARE_uint64(background_disk_io_limit);
 DECLARE_int32(stream_close_wait_time_ms);
 DECLARE_int32(retry_send_file_wait_time_ms);
 DECLARE_int32(request_max_retry);
 DECLARE_int32(request_timeout_ms);
+DECLARE_uint32(send_file_thread_num);
 
 namespace openmldb {
 namespace tablet {
 
+// all the files sent by the tablet share the bandwidth of the node, so the snapshots of many
+// partitions can be sent at the same time without hurting the requests
+static ::openmldb::base::RateLimiter* GetNodeRateLimiter() {
+    static ::openmldb::base::RateLimiter limiter(0);
+    limiter.SetLimit(FLAGS_stream_node_bandwidth_limit);
+    return &limiter;
+}
+
 FileSender::FileSender(uint32_t tid, uint32_t pid, const std::string& endpoint)
     : tid_(tid),
       pid_(pid),
@@ -45,6 +61,7 @@ FileSender::FileSender(uint32_t tid, uint32_t pid, const std::string& endpoint)
       cur_try_time_(0),
       max_try_time_(FLAGS_send_file_max_try),
       limit_time_(0),
+      sending_num_(0),
       channel_(NULL),
       stub_(NULL) {}
 
@@ -73,13 +90,21 @@ bool FileSender::Init() {
     return true;
 }
 
-int FileSender::WriteData(const std::string& file_name, const std::string& dir_name, const char* buffer, size_t len,
-                          uint64_t block_id) {
-    if (buffer == NULL) {
-        return -1;
-    }
-    uint64_t cur_time = ::baidu::common::timer::get_micros();
+struct FileSender::SendDataCall {
     ::openmldb::api::SendDataRequest request;
+    ::openmldb::api::GeneralResponse response;
+    brpc::Controller cntl;
+    uint64_t start_time = 0;
+};
+
+void FileSender::StartSendData(const std::string& file_name, const std::string& dir_name, butil::IOBuf* data,
+                               uint64_t block_id, bool eof, SendDataCall* call) {
+    uint64_t wait_time = GetNodeRateLimiter()->Acquire(data->size());
+    if (wait_time > 0) {
+        std::this_thread::sleep_for(std::chrono::microseconds(wait_time));
+    }
+    call->start_time = ::baidu::common::timer::get_micros();
+    ::openmldb::api::SendDataRequest& request = call->request;
     request.set_tid(tid_);
     request.set_pid(pid_);
     request.set_file_name(file_name);
@@ -87,34 +112,66 @@ int FileSender::WriteData(const std::string& file_name, const std::string& dir_n
         request.set_dir_name(dir_name);
     }
     request.set_block_id(block_id);
-    request.set_block_size(len);
-    brpc::Controller cntl;
-    if (block_id > 0) {
-        cntl.request_attachment().append(buffer, len);
-    }
-    if (len > 0 && len < FLAGS_stream_block_size) {
+    request.set_block_size(data->size());
+    if (eof) {
         request.set_eof(true);
     }
-    ::openmldb::api::GeneralResponse response;
-    stub_->SendData(&cntl, &request, &response, NULL);
-    if (cntl.Failed()) {
+    // the blocks are referred by the attachment instead of copied
+    call->cntl.request_attachment().swap(*data);
+    stub_->SendData(&call->cntl, &request, &call->response, brpc::DoNothing());
+}
+
+int FileSender::JoinSendData(const std::string& file_name, SendDataCall* call) {
+    brpc::Join(call->cntl.call_id());
+    if (call->cntl.Failed()) {
         PDLOG(WARNING, "send data failed. tid %u pid %u file %s error msg %s", tid_, pid_, file_name.c_str(),
-              cntl.ErrorText().c_str());
+              call->cntl.ErrorText().c_str());
         return -1;
-    } else if (response.code() != 0) {
+    } else if (call->response.code() != 0) {
         PDLOG(WARNING, "send data failed. tid %u pid %u file %s error msg %s", tid_, pid_, file_name.c_str(),
-              response.msg().c_str());
+              call->response.msg().c_str());
         return -1;
     }
-    uint64_t time_used = ::baidu::common::timer::get_micros() - cur_time;
-    if (limit_time_ > time_used && len > FLAGS_stream_block_size / 2) {
-        uint64_t sleep_time = limit_time_ - time_used;
-        DEBUGLOG("sleep %lu us, limit_time %lu time_used %lu", sleep_time, limit_time_, time_used);
+    uint64_t time_used = ::baidu::common::timer::get_micros() - call->start_time;
+    uint64_t limit_time = limit_time_ * std::max(sending_num_.load(std::memory_order_relaxed), 1u);
+    if (limit_time > time_used && call->request.block_size() > FLAGS_stream_block_size / 2) {
+        uint64_t sleep_time = limit_time - time_used;
+        DEBUGLOG("sleep %lu us, limit_time %lu time_used %lu", sleep_time, limit_time, time_used);
         std::this_thread::sleep_for(std::chrono::microseconds(sleep_time));
     }
     return 0;
 }
 
+int FileSender::WriteData(const std::string& file_name, const std::string& dir_name, butil::IOBuf* data,
+                          uint64_t block_id, bool eof) {
+    if (data == NULL) {
+        return -1;
+    }
+    SendDataCall call;
+    StartSendData(file_name, dir_name, data, block_id, eof, &call);
+    return JoinSendData(file_name, &call);
+}
+
+ssize_t FileSender::ReadBlock(int fd, uint64_t offset, ::openmldb::base::RateLimiter* disk_limiter,
+                              butil::IOPortal* data) {
+    data->clear();
+    while (data->size() < FLAGS_stream_block_size) {
+        ssize_t len = data->pappend_from_file_descriptor(fd, offset + data->size(),
+                                                         FLAGS_stream_block_size - data->size());
+        if (len < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        if (len == 0) {
+            break;
+        }
+    }
+    disk_limiter->Throttle(data->size());
+    return data->size();
+}
+
 int FileSender::SendFile(const std::string& file_name, const std::string& full_path) {
     return SendFile(file_name, "", full_path);
 }
@@ -152,54 +209,66 @@ int FileSender::SendFile(const std::string& file_name, const std::string& dir_na
 
 int FileSender::SendFileInternal(const std::string& file_name, const std::string& dir_name,
                                  const std::string& full_path, uint64_t file_size) {
-    FILE* file = fopen(full_path.c_str(), "rb");
-    if (file == NULL) {
+    int fd = open(full_path.c_str(), O_RDONLY);
+    if (fd < 0) {
         PDLOG(WARNING, "fail to open file %s", full_path.c_str());
         return -1;
     }
-    char buffer[FLAGS_stream_block_size];
-
+    sending_num_.fetch_add(1, std::memory_order_relaxed);
+    uint64_t start_time = ::baidu::common::timer::get_micros();
     uint64_t block_num = file_size / FLAGS_stream_block_size + 1;
     uint64_t report_block_num = block_num / 100;
     int ret = 0;
     uint64_t block_count = 0;
+    uint64_t offset = 0;
+    butil::IOPortal block;
+    std::unique_ptr<SendDataCall> call;
+    auto* disk_limiter = ::openmldb::base::GetDiskRateLimiter(full_path, FLAGS_background_disk_io_limit);
     do {
-        if (block_count == 0 && WriteData(file_name, dir_name, buffer, 0, block_count) < 0) {
+        if (WriteData(file_name, dir_name, &block, block_count, false) < 0) {
             PDLOG(WARNING, "Init file receiver failed. tid[%u] pid[%u] file %s", tid_, pid_, file_name.c_str());
             ret = -1;
             break;
         }
-        block_count++;
-
-#ifdef __APPLE__
-        size_t len = fread(buffer, 1, FLAGS_stream_block_size, file);
-#else
-        size_t len = fread_unlocked(buffer, 1, FLAGS_stream_block_size, file);
-#endif
-        if (len < FLAGS_stream_block_size) {
-            if (feof(file)) {
-                if (len > 0) {
-                    ret = WriteData(file_name, dir_name, buffer, len, block_count);
-                }
+        ssize_t len = ReadBlock(fd, offset, disk_limiter, &block);
+        while (len >= 0) {
+            block_count++;
+            offset += len;
+            bool eof = static_cast<uint64_t>(len) < FLAGS_stream_block_size || offset >= file_size;
+            call.reset(new SendDataCall());
+            StartSendData(file_name, dir_name, &block, block_count, eof, call.get());
+            // read the next block while the former one is being sent
+            if (!eof) {
+                len = ReadBlock(fd, offset, disk_limiter, &block);
+            }
+            if (JoinSendData(file_name, call.get()) < 0) {
+                PDLOG(WARNING, "data write failed. tid[%u] pid[%u] file %s", tid_, pid_, file_name.c_str());
+                ret = -1;
+                break;
+            }
+            if (report_block_num == 0 || block_count % report_block_num == 0) {
+                PDLOG(INFO,
+                      "send block num[%lu] total block num[%lu]. tid[%u] pid[%u] "
+                      "file[%s] endpoint[%s]",
+                      block_count, block_num, tid_, pid_, file_name.c_str(), endpoint_.c_str());
+            }
+            if (eof) {
                 break;
             }
-            PDLOG(WARNING, "read file %s error. error message: %s", file_name.c_str(), strerror(errno));
-            ret = -1;
-            break;
         }
-        if (WriteData(file_name, dir_name, buffer, len, block_count) < 0) {
-            PDLOG(WARNING, "data write failed. tid[%u] pid[%u] file %s", tid_, pid_, file_name.c_str());
+        if (len < 0) {
+            PDLOG(WARNING, "read file %s error. error message: %s", file_name.c_str(), strerror(errno));
             ret = -1;
-            break;
-        }
-        if (report_block_num == 0 || block_count % report_block_num == 0) {
-            PDLOG(INFO,
-                  "send block num[%lu] total block num[%lu]. tid[%u] pid[%u] "
-                  "file[%s] endpoint[%s]",
-                  block_count, block_num, tid_, pid_, file_name.c_str(), endpoint_.c_str());
         }
-    } while (true);
-    fclose(file);
+    } while (false);
+    close(fd);
+    sending_num_.fetch_sub(1, std::memory_order_relaxed);
+    if (ret == 0) {
+        uint64_t time_used = std::max(::baidu::common::timer::get_micros() - start_time, static_cast<uint64_t>(1));
+        PDLOG(INFO, "send file %s to %s. size[%lu] time used[%lu]us throughput[%lu]KB/s tid[%u] pid[%u]",
+              file_name.c_str(), endpoint_.c_str(), file_size, time_used, file_size * 1000000 / time_used / 1024,
+              tid_, pid_);
+    }
     std::this_thread::sleep_for(std::chrono::milliseconds(FLAGS_stream_close_wait_time_ms));
     return ret;
 }
@@ -229,15 +298,41 @@ int FileSender::CheckFile(const std::string& file_name, const std::string& dir_n
     return 0;
 }
 
+int FileSender::SendFiles(const std::vector<std::string>& file_names, const std::string& dir_name,
+                          const std::string& dir_path) {
+    std::atomic<uint32_t> next(0);
+    std::atomic<bool> has_error(false);
+    auto send = [&]() {
+        for (uint32_t i = next.fetch_add(1); i < file_names.size() && !has_error.load(); i = next.fetch_add(1)) {
+            if (SendFile(file_names[i], dir_name, dir_path + file_names[i]) < 0) {
+                has_error.store(true);
+            }
+        }
+    };
+    uint32_t thread_num = std::min(std::max(FLAGS_send_file_thread_num, 1u), static_cast<uint32_t>(file_names.size()));
+    std::vector<std::thread> threads;
+    for (uint32_t i = 1; i < thread_num; i++) {
+        threads.emplace_back(send);
+    }
+    send();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    return has_error.load() ? -1 : 0;
+}
+
 int FileSender::SendDir(const std::string& dir_name, const std::string& full_path) {
     std::vector<std::string> file_vec;
     ::openmldb::base::GetFileName(full_path, file_vec);
+    std::vector<std::string> file_names;
     for (const std::string& file : file_vec) {
-        if (SendFile(file.substr(file.find_last_of("/") + 1), dir_name, file) < 0) {
-            return -1;
-        }
+        file_names.push_back(file.substr(file.find_last_of("/") + 1));
     }
-    return 0;
+    std::string dir_path = full_path;
+    if (!dir_path.empty() && dir_path.back() != '/') {
+        dir_path.append("/");
+    }
+    return SendFiles(file_names, dir_name, dir_path);
 }
 
 }  // namespace tablet
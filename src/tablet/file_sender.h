@@ -18,9 +18,13 @@
 
 #include <brpc/channel.h>
 #include <brpc/controller.h>
+#include <butil/iobuf.h>
 
+#include <atomic>
 #include <string>
+#include <vector>
 
+#include "base/rate_limiter.h"
 #include "proto/tablet.pb.h"
 
 namespace openmldb {
@@ -33,20 +37,35 @@ class FileSender {
     bool Init();
     int SendFile(const std::string& file_name, const std::string& dir_name, const std::string& full_path);
     int SendFile(const std::string& file_name, const std::string& full_path);
+    // send the files under dir_path on send_file_thread_num threads
+    int SendFiles(const std::vector<std::string>& file_names, const std::string& dir_name,
+                  const std::string& dir_path);
     int SendFileInternal(const std::string& file_name, const std::string& dir_name, const std::string& full_path,
                          uint64_t file_size);
     int SendDir(const std::string& dir_name, const std::string& full_path);
-    int WriteData(const std::string& file_name, const std::string& dir_name, const char* buffer, size_t len,
-                  uint64_t block_id);
+    int WriteData(const std::string& file_name, const std::string& dir_name, butil::IOBuf* data, uint64_t block_id,
+                  bool eof);
     int CheckFile(const std::string& file_name, const std::string& dir_name, uint64_t file_size);
 
  private:
+    struct SendDataCall;
+
+    // the data is moved to the attachment of the request, JoinSendData waits for the response
+    void StartSendData(const std::string& file_name, const std::string& dir_name, butil::IOBuf* data,
+                       uint64_t block_id, bool eof, SendDataCall* call);
+    int JoinSendData(const std::string& file_name, SendDataCall* call);
+    // read a block at offset into the blocks of data, return the size read or -1 on error. The block waits for
+    // the disk limiter by its size after it is read
+    ssize_t ReadBlock(int fd, uint64_t offset, ::openmldb::base::RateLimiter* disk_limiter, butil::IOPortal* data);
+
     uint32_t tid_;
     uint32_t pid_;
     std::string endpoint_;
     uint32_t cur_try_time_;
     uint32_t max_try_time_;
     uint64_t limit_time_;
+    // the count of files being sent, they share the bandwidth limit
+    std::atomic<uint32_t> sending_num_;
     brpc::Channel* channel_;
     ::openmldb::api::TabletServer_Stub* stub_;
 };
@@ -0,0 +1,123 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tablet/query_admission.h"
+
+#include <algorithm>
+
+#include "common/timer.h"
+
+namespace openmldb {
+namespace tablet {
+
+QueryAdmission::QueryAdmission(uint32_t procedure_limit, uint32_t batch_limit, uint32_t batch_wait_ms)
+    : procedure_limit_(procedure_limit),
+      batch_limit_(batch_limit),
+      batch_wait_ms_(batch_wait_ms),
+      mu_(),
+      cv_(),
+      procedures_(),
+      procedure_cnt_(0),
+      batch_cnt_(0) {}
+
+bool QueryAdmission::AcquireProcedure(const std::string& key) {
+    std::lock_guard<bthread::Mutex> lock(mu_);
+    uint32_t& cnt = procedures_[key];
+    if (procedure_limit_ > 0 && cnt >= procedure_limit_) {
+        return false;
+    }
+    cnt++;
+    procedure_cnt_++;
+    return true;
+}
+
+void QueryAdmission::ReleaseProcedure(const std::string& key) {
+    {
+        std::lock_guard<bthread::Mutex> lock(mu_);
+        auto it = procedures_.find(key);
+        if (it == procedures_.end()) {
+            return;
+        }
+        if (--it->second == 0) {
+            procedures_.erase(it);
+        }
+        if (--procedure_cnt_ > 0) {
+            return;
+        }
+    }
+    // the batch slots are given back when the deployments are idle
+    cv_.notify_all();
+}
+
+uint32_t QueryAdmission::BatchLimitLocked() const {
+    if (procedure_cnt_ == 0) {
+        return batch_limit_;
+    }
+    return std::max(batch_limit_ / 2, 1u);
+}
+
+bool QueryAdmission::AcquireBatch() {
+    if (batch_limit_ == 0) {
+        return true;
+    }
+    uint64_t deadline = ::baidu::common::timer::get_micros() + static_cast<uint64_t>(batch_wait_ms_) * 1000;
+    std::unique_lock<bthread::Mutex> lock(mu_);
+    while (batch_cnt_ >= BatchLimitLocked()) {
+        uint64_t now = ::baidu::common::timer::get_micros();
+        if (now >= deadline) {
+            return false;
+        }
+        cv_.wait_for(lock, deadline - now);
+    }
+    batch_cnt_++;
+    return true;
+}
+
+void QueryAdmission::ReleaseBatch() {
+    if (batch_limit_ == 0) {
+        return;
+    }
+    {
+        std::lock_guard<bthread::Mutex> lock(mu_);
+        batch_cnt_--;
+    }
+    cv_.notify_one();
+}
+
+QueryAdmissionGuard::QueryAdmissionGuard(QueryAdmission* admission, bool is_procedure, const std::string& db,
+                                         const std::string& sp_name)
+    : admission_(admission), is_procedure_(is_procedure), key_(), admitted_(false) {
+    if (is_procedure_) {
+        key_ = db + "|" + sp_name;
+        admitted_ = admission_->AcquireProcedure(key_);
+    } else {
+        admitted_ = admission_->AcquireBatch();
+    }
+}
+
+QueryAdmissionGuard::~QueryAdmissionGuard() {
+    if (!admitted_) {
+        return;
+    }
+    if (is_procedure_) {
+        admission_->ReleaseProcedure(key_);
+    } else {
+        admission_->ReleaseBatch();
+    }
+}
+
+}  // namespace tablet
+}  // namespace openmldb
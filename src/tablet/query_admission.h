@@ -0,0 +1,84 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_TABLET_QUERY_ADMISSION_H_
+#define SRC_TABLET_QUERY_ADMISSION_H_
+
+#include <map>
+#include <mutex>  // NOLINT
+#include <string>
+
+#include "bthread/condition_variable.h"
+#include "bthread/mutex.h"
+
+namespace openmldb {
+namespace tablet {
+
+// QueryAdmission decides which queries run on an overloaded tablet. the requests of the deployments go
+// first, they are rejected only when their deployment reaches procedure_limit. the other queries wait up to
+// batch_wait_ms for one of the batch_limit slots, and half of the slots are taken away while deployment
+// requests are running. a limit of 0 is unlimited
+class QueryAdmission {
+ public:
+    QueryAdmission(uint32_t procedure_limit, uint32_t batch_limit, uint32_t batch_wait_ms);
+
+    QueryAdmission(const QueryAdmission&) = delete;
+    QueryAdmission& operator=(const QueryAdmission&) = delete;
+
+    bool AcquireProcedure(const std::string& key);
+    void ReleaseProcedure(const std::string& key);
+
+    bool AcquireBatch();
+    void ReleaseBatch();
+
+ private:
+    uint32_t BatchLimitLocked() const;
+
+ private:
+    uint32_t procedure_limit_;
+    uint32_t batch_limit_;
+    uint32_t batch_wait_ms_;
+    bthread::Mutex mu_;
+    bthread::ConditionVariable cv_;
+    // the running requests keyed by the db and the name of the deployment
+    std::map<std::string, uint32_t> procedures_;
+    uint32_t procedure_cnt_;
+    uint32_t batch_cnt_;
+};
+
+// take the slot of a query in the scope
+class QueryAdmissionGuard {
+ public:
+    QueryAdmissionGuard(QueryAdmission* admission, bool is_procedure, const std::string& db,
+                        const std::string& sp_name);
+    ~QueryAdmissionGuard();
+
+    QueryAdmissionGuard(const QueryAdmissionGuard&) = delete;
+    QueryAdmissionGuard& operator=(const QueryAdmissionGuard&) = delete;
+
+    bool IsAdmitted() const { return admitted_; }
+
+ private:
+    QueryAdmission* admission_;
+    bool is_procedure_;
+    std::string key_;
+    bool admitted_;
+};
+
+}  // namespace tablet
+}  // namespace openmldb
+
+#endif  // SRC_TABLET_QUERY_ADMISSION_H_
@@ -0,0 +1,81 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tablet/query_admission.h"
+
+#include "base/glog_wapper.h"
+#include "gtest/gtest.h"
+
+namespace openmldb {
+namespace tablet {
+
+class QueryAdmissionTest : public ::testing::Test {};
+
+TEST_F(QueryAdmissionTest, ProcedureLimit) {
+    QueryAdmission admission(2, 0, 0);
+    ASSERT_TRUE(admission.AcquireProcedure("db|sp1"));
+    ASSERT_TRUE(admission.AcquireProcedure("db|sp1"));
+    ASSERT_FALSE(admission.AcquireProcedure("db|sp1"));
+    // the limit is of every deployment
+    ASSERT_TRUE(admission.AcquireProcedure("db|sp2"));
+    admission.ReleaseProcedure("db|sp1");
+    ASSERT_TRUE(admission.AcquireProcedure("db|sp1"));
+}
+
+TEST_F(QueryAdmissionTest, BatchLimit) {
+    QueryAdmission admission(0, 4, 10);
+    for (int i = 0; i < 4; i++) {
+        ASSERT_TRUE(admission.AcquireBatch());
+    }
+    ASSERT_FALSE(admission.AcquireBatch());
+    admission.ReleaseBatch();
+    ASSERT_TRUE(admission.AcquireBatch());
+    for (int i = 0; i < 4; i++) {
+        admission.ReleaseBatch();
+    }
+    // half of the slots are left to the batch queries while a deployment is running
+    ASSERT_TRUE(admission.AcquireProcedure("db|sp"));
+    ASSERT_TRUE(admission.AcquireBatch());
+    ASSERT_TRUE(admission.AcquireBatch());
+    ASSERT_FALSE(admission.AcquireBatch());
+    admission.ReleaseProcedure("db|sp");
+    ASSERT_TRUE(admission.AcquireBatch());
+}
+
+TEST_F(QueryAdmissionTest, Guard) {
+    QueryAdmission admission(1, 1, 10);
+    {
+        QueryAdmissionGuard guard(&admission, true, "db", "sp");
+        ASSERT_TRUE(guard.IsAdmitted());
+        QueryAdmissionGuard rejected(&admission, true, "db", "sp");
+        ASSERT_FALSE(rejected.IsAdmitted());
+        QueryAdmissionGuard batch(&admission, false, "db", "");
+        ASSERT_TRUE(batch.IsAdmitted());
+    }
+    QueryAdmissionGuard guard(&admission, true, "db", "sp");
+    ASSERT_TRUE(guard.IsAdmitted());
+    QueryAdmissionGuard batch(&admission, false, "db", "");
+    ASSERT_TRUE(batch.IsAdmitted());
+}
+
+}  // namespace tablet
+}  // namespace openmldb
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    ::openmldb::base::SetLogLevel(INFO);
+    return RUN_ALL_TESTS();
+}
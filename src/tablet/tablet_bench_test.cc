@@ -0,0 +1,306 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "base/glog_wapper.h"
+#include "brpc/controller.h"
+#include "codec/codec.h"
+#include "codec/sql_rpc_row_codec.h"
+#include "common/timer.h"
+#include "gflags/gflags.h"
+#include "gtest/gtest.h"
+#include "proto/tablet.pb.h"
+#include "tablet/tablet_impl.h"
+#include "vm/engine.h"
+
+DECLARE_string(db_root_path);
+DECLARE_string(recycle_bin_root_path);
+
+// the workload of the benchmark, e.g. --bench_zipf_theta=0 for the uniform keys
+DEFINE_uint32(bench_key_num, 10000, "the number of the distinct keys");
+DEFINE_double(bench_zipf_theta, 0.99, "the skew of the zipfian keys in [0, 1), 0 is uniform");
+DEFINE_uint32(bench_column_num, 8, "the number of the double columns besides the key and ts");
+DEFINE_uint32(bench_window_size, 100, "the rows preceding the request row in the window");
+DEFINE_uint32(bench_preload_cnt, 100000, "the rows put before the mixed workload");
+DEFINE_uint32(bench_op_cnt, 20000, "the operations every thread runs");
+DEFINE_double(bench_put_ratio, 0.2, "the ratio of puts in the operations, the others are window queries");
+DEFINE_uint32(bench_max_thread_num, 8, "the thread number is doubled from 1 up to it");
+
+namespace openmldb {
+namespace tablet {
+
+class MockClosure : public ::google::protobuf::Closure {
+ public:
+    MockClosure() {}
+    ~MockClosure() {}
+    void Run() {}
+};
+
+inline std::string GenRand() {
+    return std::to_string(rand() % 10000000 + 1);  // NOLINT
+}
+
+// the zipfian generator of Gray et al., "Quickly Generating Billion-Record Synthetic Databases"
+class ZipfGenerator {
+ public:
+    ZipfGenerator(uint64_t n, double theta) : n_(n), theta_(theta) {
+        zetan_ = Zeta(n, theta);
+        double zeta2 = Zeta(2, theta);
+        alpha_ = 1.0 / (1.0 - theta);
+        eta_ = (1 - std::pow(2.0 / n, 1 - theta)) / (1 - zeta2 / zetan_);
+    }
+
+    uint64_t Next(std::mt19937_64* rng) const {
+        double u = std::uniform_real_distribution<double>(0, 1)(*rng);
+        double uz = u * zetan_;
+        if (uz < 1) {
+            return 0;
+        }
+        if (uz < 1 + std::pow(0.5, theta_)) {
+            return 1;
+        }
+        return std::min(n_ - 1, static_cast<uint64_t>(n_ * std::pow(eta_ * u - eta_ + 1, alpha_)));
+    }
+
+ private:
+    static double Zeta(uint64_t n, double theta) {
+        double sum = 0;
+        for (uint64_t i = 1; i <= n; i++) {
+            sum += 1.0 / std::pow(static_cast<double>(i), theta);
+        }
+        return sum;
+    }
+
+    uint64_t n_;
+    double theta_;
+    double zetan_;
+    double alpha_;
+    double eta_;
+};
+
+struct OpLatency {
+    std::vector<uint64_t> put_us;
+    std::vector<uint64_t> query_us;
+};
+
+class TabletBenchmarkTest : public ::testing::Test {
+ public:
+    TabletBenchmarkTest() {}
+    ~TabletBenchmarkTest() {}
+
+    void SetUp() {
+        tablet_.Init("");
+        for (uint32_t i = 0; i < FLAGS_bench_column_num; i++) {
+            column_names_.push_back("c" + std::to_string(i));
+        }
+        ::openmldb::common::ColumnDesc* col = schema_.Add();
+        col->set_name("k");
+        col->set_data_type(::openmldb::type::kString);
+        col = schema_.Add();
+        col->set_name("ts");
+        col->set_data_type(::openmldb::type::kTimestamp);
+        for (const auto& name : column_names_) {
+            col = schema_.Add();
+            col->set_name(name);
+            col->set_data_type(::openmldb::type::kDouble);
+        }
+    }
+
+    bool CreateTable() {
+        MockClosure closure;
+        ::openmldb::api::CreateTableRequest request;
+        ::openmldb::api::TableMeta* table_meta = request.mutable_table_meta();
+        table_meta->set_db(db_);
+        table_meta->set_name(name_);
+        table_meta->set_tid(tid_);
+        table_meta->set_pid(0);
+        table_meta->set_seg_cnt(8);
+        table_meta->set_mode(::openmldb::api::TableMode::kTableLeader);
+        table_meta->set_key_entry_max_height(8);
+        table_meta->set_format_version(1);
+        table_meta->mutable_column_desc()->CopyFrom(schema_);
+        ::openmldb::common::ColumnKey* ck = table_meta->add_column_key();
+        ck->set_index_name("k_idx");
+        ck->add_col_name("k");
+        ck->set_ts_name("ts");
+        ::openmldb::api::CreateTableResponse response;
+        tablet_.CreateTable(NULL, &request, &response, &closure);
+        return response.code() == 0;
+    }
+
+    std::string EncodeRow(const std::string& key, int64_t ts, std::mt19937_64* rng) {
+        codec::RowBuilder builder(schema_);
+        uint32_t size = builder.CalTotalLength(key.size());
+        std::string row(size, '\0');
+        builder.SetBuffer(reinterpret_cast<int8_t*>(&row[0]), size);
+        builder.AppendString(key.c_str(), key.size());
+        builder.AppendTimestamp(ts);
+        std::uniform_real_distribution<double> dist(0, 100);
+        for (uint32_t i = 0; i < FLAGS_bench_column_num; i++) {
+            builder.AppendDouble(dist(*rng));
+        }
+        return row;
+    }
+
+    bool Put(const std::string& key, int64_t ts, std::mt19937_64* rng) {
+        MockClosure closure;
+        ::openmldb::api::PutRequest request;
+        request.set_tid(tid_);
+        request.set_pid(0);
+        request.set_format_version(1);
+        ::openmldb::api::Dimension* dim = request.add_dimensions();
+        dim->set_idx(0);
+        dim->set_key(key);
+        ::openmldb::api::TSDimension* ts_dim = request.add_ts_dimensions();
+        ts_dim->set_idx(0);
+        ts_dim->set_ts(ts);
+        request.set_value(EncodeRow(key, ts, rng));
+        ::openmldb::api::PutResponse response;
+        tablet_.Put(NULL, &request, &response, &closure);
+        return response.code() == 0;
+    }
+
+    // run the window aggregations over the rows of the key preceding the request row
+    bool Query(const std::string& sql, const std::string& key, int64_t ts, std::mt19937_64* rng) {
+        MockClosure closure;
+        ::openmldb::api::QueryRequest request;
+        request.set_db(db_);
+        request.set_sql(sql);
+        request.set_is_batch(false);
+        std::string row = EncodeRow(key, ts, rng);
+        brpc::Controller cntl;
+        if (!codec::EncodeRpcRow(reinterpret_cast<const int8_t*>(row.data()), row.size(),
+                                 &cntl.request_attachment())) {
+            return false;
+        }
+        request.set_row_size(row.size());
+        request.set_row_slices(1);
+        ::openmldb::api::QueryResponse response;
+        tablet_.Query(&cntl, &request, &response, &closure);
+        return response.code() == 0 && response.count() == 1;
+    }
+
+    std::string WindowSql() const {
+        std::string sql = "SELECT k";
+        for (const auto& name : column_names_) {
+            sql += ", sum(" + name + ") OVER w AS sum_" + name;
+        }
+        sql += " FROM " + name_ + " WINDOW w AS (PARTITION BY k ORDER BY ts ROWS BETWEEN " +
+               std::to_string(FLAGS_bench_window_size) + " PRECEDING AND CURRENT ROW);";
+        return sql;
+    }
+
+ protected:
+    TabletImpl tablet_;
+    std::string name_ = "t" + GenRand();
+    std::string db_ = "db" + name_;
+    uint32_t tid_ = rand() % 10000000 + 1;  // NOLINT
+    Schema schema_;
+    std::vector<std::string> column_names_;
+};
+
+static uint64_t Percentile(const std::vector<uint64_t>& sorted, double p) {
+    if (sorted.empty()) {
+        return 0;
+    }
+    size_t idx = std::min(sorted.size() - 1, static_cast<size_t>(sorted.size() * p));
+    return sorted[idx];
+}
+
+static void PrintLatency(const std::string& op, std::vector<uint64_t>* latency) {
+    std::sort(latency->begin(), latency->end());
+    std::cout << "  " << op << " cnt " << latency->size() << " p50 " << Percentile(*latency, 0.5) << "us p99 "
+              << Percentile(*latency, 0.99) << "us p999 " << Percentile(*latency, 0.999) << "us" << std::endl;
+}
+
+TEST_F(TabletBenchmarkTest, FeatureWorkload) {
+    ASSERT_GT(FLAGS_bench_key_num, 1u);
+    ASSERT_TRUE(FLAGS_bench_zipf_theta >= 0 && FLAGS_bench_zipf_theta < 1);
+    ASSERT_TRUE(CreateTable());
+    ZipfGenerator zipf(FLAGS_bench_key_num, FLAGS_bench_zipf_theta);
+    std::atomic<int64_t> ts(::baidu::common::timer::get_micros() / 1000);
+    std::mt19937_64 rng(0);
+    for (uint32_t i = 0; i < FLAGS_bench_preload_cnt; i++) {
+        ASSERT_TRUE(Put("key" + std::to_string(zipf.Next(&rng)), ts++, &rng));
+    }
+    std::string sql = WindowSql();
+    // compile the sql before the timing
+    ASSERT_TRUE(Query(sql, "key0", ts++, &rng));
+    std::cout << "key num " << FLAGS_bench_key_num << " zipf theta " << FLAGS_bench_zipf_theta << " column num "
+              << FLAGS_bench_column_num << " window size " << FLAGS_bench_window_size << " put ratio "
+              << FLAGS_bench_put_ratio << std::endl;
+    for (uint32_t thread_num = 1; thread_num <= FLAGS_bench_max_thread_num; thread_num *= 2) {
+        std::vector<OpLatency> latency(thread_num);
+        std::atomic<uint64_t> failed(0);
+        std::vector<std::thread> threads;
+        uint64_t consumed = ::baidu::common::timer::get_micros();
+        for (uint32_t i = 0; i < thread_num; i++) {
+            threads.emplace_back([this, i, thread_num, &zipf, &ts, &sql, &latency, &failed] {
+                std::mt19937_64 rng(thread_num * 1000 + i + 1);
+                std::uniform_real_distribution<double> dist(0, 1);
+                OpLatency& op_latency = latency[i];
+                for (uint32_t j = 0; j < FLAGS_bench_op_cnt; j++) {
+                    std::string key = "key" + std::to_string(zipf.Next(&rng));
+                    bool is_put = dist(rng) < FLAGS_bench_put_ratio;
+                    uint64_t start = ::baidu::common::timer::get_micros();
+                    bool ok = is_put ? Put(key, ts++, &rng) : Query(sql, key, ts.load(), &rng);
+                    uint64_t cost = ::baidu::common::timer::get_micros() - start;
+                    if (!ok) {
+                        failed++;
+                    }
+                    (is_put ? op_latency.put_us : op_latency.query_us).push_back(cost);
+                }
+            });
+        }
+        for (auto& t : threads) {
+            t.join();
+        }
+        consumed = ::baidu::common::timer::get_micros() - consumed;
+        EXPECT_EQ(0u, failed.load());
+        OpLatency total;
+        for (const auto& op_latency : latency) {
+            total.put_us.insert(total.put_us.end(), op_latency.put_us.begin(), op_latency.put_us.end());
+            total.query_us.insert(total.query_us.end(), op_latency.query_us.begin(), op_latency.query_us.end());
+        }
+        uint64_t op_cnt = static_cast<uint64_t>(thread_num) * FLAGS_bench_op_cnt;
+        std::cout << "thread num " << thread_num << " consumed " << consumed / 1000 << "ms throughput "
+                  << op_cnt * 1000000 / std::max<uint64_t>(consumed, 1) << " ops/s" << std::endl;
+        PrintLatency("put", &total.put_us);
+        PrintLatency("query", &total.query_us);
+    }
+}
+
+}  // namespace tablet
+}  // namespace openmldb
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    srand(time(NULL));
+    ::google::ParseCommandLineFlags(&argc, &argv, true);
+    std::string k1 = ::openmldb::tablet::GenRand();
+    FLAGS_db_root_path = "/tmp/db" + k1;
+    FLAGS_recycle_bin_root_path = "/tmp/recycle" + k1;
+    ::hybridse::vm::Engine::InitializeGlobalLLVM();
+    return RUN_ALL_TESTS();
+}
@@ -27,6 +27,7 @@
 #include <snappy.h>
 
 #include <algorithm>
+#include <sstream>
 #include <thread>  // NOLINT
 #include <utility>
 #include <vector>
@@ -43,7 +44,10 @@
 #include "base/status.h"
 #include "base/strings.h"
 #include "brpc/controller.h"
+#include "brpc/stream.h"
 #include "butil/iobuf.h"
+#include "bvar/bvar.h"
+#include "catalog/client_manager.h"
 #include "catalog/schema_adapter.h"
 #include "codec/codec.h"
 #include "codec/row_codec.h"
@@ -51,6 +55,7 @@
 #include "common/timer.h"
 #include "glog/logging.h"
 #include "storage/binlog.h"
+#include "storage/disk_table.h"
 #include "storage/segment.h"
 #include "tablet/file_sender.h"
 
@@ -61,9 +66,15 @@ using ::openmldb::storage::DataBlock;
 using ::openmldb::storage::Table;
 
 DECLARE_int32(gc_interval);
+DECLARE_int32(gc_slice_interval);
 DECLARE_int32(gc_pool_size);
+DECLARE_uint32(background_thread_num);
+DECLARE_uint64(background_disk_io_limit);
 DECLARE_int32(statdb_ttl);
 DECLARE_uint32(scan_max_bytes_size);
+DECLARE_uint32(stream_max_bytes_size);
+DECLARE_uint32(stream_write_timeout_ms);
+DECLARE_uint32(attachment_compress_min_size);
 DECLARE_uint32(scan_reserve_size);
 DECLARE_double(mem_release_rate);
 DECLARE_string(db_root_path);
@@ -82,7 +93,21 @@ DECLARE_uint32(task_check_interval);
 DECLARE_uint32(load_index_max_wait_time);
 DECLARE_bool(use_name);
 DECLARE_bool(enable_distsql);
+DECLARE_bool(enable_sub_query_batch);
+DECLARE_uint32(request_result_cache_size);
+DECLARE_uint32(request_result_cache_ttl_ms);
+DECLARE_uint32(request_branch_thread_num);
+DECLARE_uint32(batch_query_thread_num);
+DECLARE_uint32(batch_query_memory_budget_mb);
+DECLARE_string(batch_query_spill_dir);
+DECLARE_bool(enable_literal_parameterize);
+DECLARE_string(jit_object_cache_dir);
+DECLARE_bool(enable_jit_tiered_compile);
+DECLARE_uint32(jit_compile_thread_num);
+DECLARE_uint32(jit_pgo_profile_runs);
+DECLARE_bool(enable_jit_inline_builtins);
 DECLARE_string(snapshot_compression);
+DECLARE_string(binlog_compression);
 DECLARE_string(file_compression);
 
 // cluster config
@@ -94,32 +119,72 @@ DECLARE_int32(zk_keep_alive_check_interval);
 
 DECLARE_int32(binlog_sync_to_disk_interval);
 DECLARE_int32(binlog_delete_interval);
+DECLARE_int32(binlog_aggregate_interval);
+DECLARE_uint32(binlog_aggregate_max_cnt);
 DECLARE_uint32(absolute_ttl_max);
 DECLARE_uint32(latest_ttl_max);
 DECLARE_uint32(max_traverse_cnt);
+DECLARE_uint32(traverse_cursor_ttl);
+DECLARE_uint32(traverse_cursor_max_cnt);
 DECLARE_uint32(snapshot_ttl_time);
 DECLARE_uint32(snapshot_ttl_check_interval);
 DECLARE_uint32(put_slow_log_threshold);
+DECLARE_uint32(put_worker_num);
 DECLARE_uint32(query_slow_log_threshold);
+DECLARE_uint32(query_trace_sample_interval);
+DECLARE_string(workload_capture_path);
+DECLARE_uint32(workload_capture_sample_interval);
+DECLARE_uint64(workload_capture_max_size);
+DECLARE_bool(enable_procedure_profile);
+DECLARE_uint32(query_procedure_concurrency_limit);
+DECLARE_uint32(query_batch_concurrency_limit);
+DECLARE_uint32(query_batch_wait_ms);
 DECLARE_int32(snapshot_pool_size);
+DECLARE_uint32(max_memory_mb);
+DECLARE_uint32(max_table_memory_mb);
+DECLARE_double(soft_memory_limit_ratio);
+DECLARE_int32(memory_check_interval);
+DECLARE_bool(enable_warm_up);
+DECLARE_uint32(procedure_compile_thread_num);
 
 namespace openmldb {
 namespace tablet {
 
 static const std::string SERVER_CONCURRENCY_KEY = "server";  // NOLINT
 static const uint32_t SEED = 0xe17a1465;
+// the request mode queries stopped by their deadlines
+static bvar::Adder<uint64_t> g_query_deadline_exceeded("query_deadline_exceeded");
+
+static bool HasBinlogAggregation(const ::openmldb::api::TableMeta& table_meta) {
+    for (const auto& desc : table_meta.pre_aggregations()) {
+        if (desc.has_aggr_tid()) {
+            return true;
+        }
+    }
+    return false;
+}
 
 TabletImpl::TabletImpl()
     : tables_(),
       mu_(),
-      gc_pool_(FLAGS_gc_pool_size),
+      // the limits are in the order of the classes
+      background_executor_(FLAGS_background_thread_num,
+                           {1, static_cast<uint32_t>(FLAGS_io_pool_size), static_cast<uint32_t>(FLAGS_task_pool_size),
+                            static_cast<uint32_t>(FLAGS_gc_pool_size),
+                            static_cast<uint32_t>(FLAGS_snapshot_pool_size)}),
+      background_metrics_(),
+      gc_pool_(&background_executor_, PriorityExecutor::kGc),
       replicators_(),
       snapshots_(),
+      table_handles_(std::make_shared<const TableHandles>()),
       zk_client_(NULL),
-      keep_alive_pool_(1),
-      task_pool_(FLAGS_task_pool_size),
-      io_pool_(FLAGS_io_pool_size),
-      snapshot_pool_(FLAGS_snapshot_pool_size),
+      keep_alive_pool_(&background_executor_, PriorityExecutor::kKeepAlive),
+      task_pool_(&background_executor_, PriorityExecutor::kTask),
+      io_pool_(&background_executor_, PriorityExecutor::kReplication),
+      snapshot_pool_(&background_executor_, PriorityExecutor::kSnapshot),
+      pending_loads_(),
+      pending_load_seq_(0),
+      load_mu_(),
       server_(NULL),
       mode_root_paths_(),
       mode_recycle_root_paths_(),
@@ -130,14 +195,32 @@ TabletImpl::TabletImpl()
       zk_path_(),
       endpoint_(),
       sp_cache_(std::shared_ptr<SpCache>(new SpCache())),
-      notify_path_() {}
+      notify_path_(),
+      table_status_cache_(),
+      table_status_version_(0),
+      table_status_epoch_(::baidu::common::timer::get_micros()),
+      query_admission_(FLAGS_query_procedure_concurrency_limit, FLAGS_query_batch_concurrency_limit,
+                       FLAGS_query_batch_wait_ms),
+      traverse_cursors_(FLAGS_traverse_cursor_ttl, FLAGS_traverse_cursor_max_cnt),
+      query_trace_cnt_(0),
+      query_trace_mu_(),
+      query_trace_recorders_(),
+      memory_used_(0),
+      memory_exceeded_(false),
+      memory_exceeded_tables_(std::make_shared<const std::set<uint64_t>>()),
+      memory_soft_exceeded_(false),
+      memory_soft_tables_() {
+    for (uint32_t i = 0; i < PriorityExecutor::kClassCnt; i++) {
+        background_metrics_.emplace_back(
+            new BackgroundMetrics(&background_executor_, static_cast<PriorityExecutor::Class>(i)));
+    }
+}
 
 TabletImpl::~TabletImpl() {
-    task_pool_.Stop(true);
-    keep_alive_pool_.Stop(true);
-    gc_pool_.Stop(true);
-    io_pool_.Stop(true);
-    snapshot_pool_.Stop(true);
+    for (auto& worker : put_workers_) {
+        worker->Stop(true);
+    }
+    background_executor_.Stop();
     delete zk_client_;
 }
 
@@ -149,6 +232,18 @@ bool TabletImpl::Init(const std::string& zk_cluster, const std::string& zk_path,
                       const std::string& real_endpoint) {
     ::hybridse::vm::EngineOptions options;
     options.set_cluster_optimized(FLAGS_enable_distsql);
+    options.set_max_request_result_cache_size(FLAGS_request_result_cache_size)
+        ->set_request_result_cache_ttl(FLAGS_request_result_cache_ttl_ms)
+        ->set_request_branch_thread_num(FLAGS_request_branch_thread_num)
+        ->set_batch_window_thread_num(FLAGS_batch_query_thread_num);
+    options.set_enable_literal_parameterize(FLAGS_enable_literal_parameterize);
+    options.jit_options().set_object_cache_dir(FLAGS_jit_object_cache_dir);
+    options.jit_options().set_enable_tiered_compile(FLAGS_enable_jit_tiered_compile);
+    options.jit_options().set_compile_thread_num(FLAGS_jit_compile_thread_num);
+    options.jit_options().set_pgo_profile_runs(FLAGS_jit_pgo_profile_runs);
+    options.jit_options().set_enable_inline_builtins(FLAGS_enable_jit_inline_builtins);
+    options.set_enable_runner_stats(FLAGS_enable_procedure_profile);
+    options.jit_options().set_enable_perf(FLAGS_enable_procedure_profile);
     engine_ = std::unique_ptr<::hybridse::vm::Engine>(new ::hybridse::vm::Engine(catalog_, options));
     catalog_->SetLocalTablet(
         std::shared_ptr<::hybridse::vm::Tablet>(new ::hybridse::vm::LocalTablet(engine_.get(), sp_cache_)));
@@ -157,14 +252,26 @@ bool TabletImpl::Init(const std::string& zk_cluster, const std::string& zk_path,
         LOG(WARNING) << "wrong snapshot_compression: " << FLAGS_snapshot_compression;
         return false;
     }
+    if (snapshot_compression_set.find(FLAGS_binlog_compression) == snapshot_compression_set.end()) {
+        LOG(WARNING) << "wrong binlog_compression: " << FLAGS_binlog_compression;
+        return false;
+    }
     std::set<std::string> file_compression_set{"off", "zlib", "lz4"};
     if (file_compression_set.find(FLAGS_file_compression) == file_compression_set.end()) {
         LOG(WARNING) << "wrong FLAGS_file_compression: " << FLAGS_file_compression;
         return false;
     }
+    if (!FLAGS_workload_capture_path.empty() &&
+        !workload_capture_.Open(FLAGS_workload_capture_path, FLAGS_workload_capture_sample_interval,
+                                FLAGS_workload_capture_max_size)) {
+        return false;
+    }
     zk_cluster_ = zk_cluster;
     zk_path_ = zk_path;
     endpoint_ = endpoint;
+    for (uint32_t i = put_workers_.size(); i < FLAGS_put_worker_num; i++) {
+        put_workers_.push_back(std::make_shared<ThreadPool>(1));
+    }
     notify_path_ = zk_path + "/table/notify";
     sp_root_path_ = zk_path + "/store_procedure/db_sp_data";
     std::lock_guard<std::mutex> lock(mu_);
@@ -205,9 +312,15 @@ bool TabletImpl::Init(const std::string& zk_cluster, const std::string& zk_path,
 
     snapshot_pool_.DelayTask(FLAGS_make_snapshot_check_interval, boost::bind(&TabletImpl::SchedMakeSnapshot, this));
     task_pool_.AddTask(boost::bind(&TabletImpl::GetDiskused, this));
+    if (FLAGS_max_memory_mb > 0 || FLAGS_max_table_memory_mb > 0) {
+        task_pool_.DelayTask(FLAGS_memory_check_interval, boost::bind(&TabletImpl::SchedCheckMemory, this));
+    }
     if (FLAGS_recycle_ttl != 0) {
         task_pool_.DelayTask(FLAGS_recycle_ttl * 60 * 1000, boost::bind(&TabletImpl::SchedDelRecycle, this));
     }
+    if (FLAGS_traverse_cursor_ttl > 0) {
+        task_pool_.DelayTask(FLAGS_traverse_cursor_ttl, boost::bind(&TabletImpl::SchedExpireTraverseCursor, this));
+    }
 #ifdef TCMALLOC_ENABLE
     MallocExtension* tcmalloc = MallocExtension::instance();
     tcmalloc->SetMemoryReleaseRate(FLAGS_mem_release_rate);
@@ -282,6 +395,14 @@ bool TabletImpl::RegisterZK() {
                 return false;
             }
         }
+        if (FLAGS_enable_warm_up) {
+            // compile the procedures before the tablet is visible to the clients, otherwise the
+            // first request of every procedure waits for the compilation
+            uint64_t start_time = ::baidu::common::timer::get_micros();
+            RefreshTableInfo();
+            PDLOG(INFO, "warm up the procedures of tablet %s in %lu ms", endpoint_.c_str(),
+                  (::baidu::common::timer::get_micros() - start_time) / 1000);
+        }
         if (!zk_client_->Register(true)) {
             PDLOG(WARNING, "fail to register tablet with endpoint %s", endpoint_.c_str());
             return false;
@@ -332,6 +453,16 @@ bool TabletImpl::CheckGetDone(::openmldb::api::GetType type, uint64_t ts, uint64
 int32_t TabletImpl::GetIndex(const ::openmldb::api::GetRequest* request, const ::openmldb::api::TableMeta& meta,
                              const std::map<int32_t, std::shared_ptr<Schema>>& vers_schema, CombineIterator* it,
                              std::string* value, uint64_t* ts) {
+    std::shared_ptr<const ::openmldb::codec::RowProjectPlan> project_plan;
+    if (request->projection().size() > 0 && meta.format_version() == 1) {
+        project_plan = ::openmldb::codec::RowProjectPlan::New(vers_schema, request->projection());
+    }
+    return GetIndex(request, meta, project_plan, it, value, ts);
+}
+
+int32_t TabletImpl::GetIndex(const ::openmldb::api::GetRequest* request, const ::openmldb::api::TableMeta& meta,
+                             const std::shared_ptr<const ::openmldb::codec::RowProjectPlan>& project_plan,
+                             CombineIterator* it, std::string* value, uint64_t* ts) {
     if (it == nullptr || value == nullptr || ts == nullptr) {
         PDLOG(WARNING, "invalid args");
         return -1;
@@ -354,13 +485,12 @@ int32_t TabletImpl::GetIndex(const ::openmldb::api::GetRequest* request, const :
         real_et_type = ::openmldb::api::GetType::kSubKeyGe;
     }
     bool enable_project = false;
-    openmldb::codec::RowProject row_project(vers_schema, request->projection());
+    openmldb::codec::RowProject row_project(project_plan);
     if (request->projection().size() > 0 && meta.format_version() == 1) {
         if (meta.compress_type() == ::openmldb::type::kSnappy) {
             return -1;
         }
-        bool ok = row_project.Init();
-        if (!ok) {
+        if (!project_plan) {
             PDLOG(WARNING, "invalid project list");
             return -1;
         }
@@ -508,15 +638,22 @@ void TabletImpl::Get(RpcController* controller, const ::openmldb::api::GetReques
         query_its[idx].table = table;
     }
     auto table_meta = query_its.begin()->table->GetTableMeta();
-    const std::map<int32_t, std::shared_ptr<Schema>> vers_schema = query_its.begin()->table->GetAllVersionSchema();
+    std::shared_ptr<const ::openmldb::codec::RowProjectPlan> project_plan;
+    if (request->projection().size() > 0 && table_meta->format_version() == 1) {
+        project_plan = query_its.begin()->table->GetProjectPlan(request->projection());
+    }
     CombineIterator combine_it(std::move(query_its), request->ts(), request->type(), expired_value);
     combine_it.SeekToFirst();
     std::string* value = response->mutable_value();
     uint64_t ts = 0;
-    int32_t code = GetIndex(request, *table_meta, vers_schema, &combine_it, value, &ts);
+    int32_t code = GetIndex(request, *table_meta, project_plan, &combine_it, value, &ts);
     response->set_ts(ts);
     response->set_code(code);
     uint64_t end_time = ::baidu::common::timer::get_micros();
+    auto metrics = GetTableMetrics(request->tid(), request->pid());
+    if (metrics) {
+        metrics->get << end_time - start_time;
+    }
     if (start_time + FLAGS_query_slow_log_threshold < end_time) {
         std::string index_name;
         if (request->has_idx_name() && request->idx_name().size() > 0) {
@@ -545,6 +682,104 @@ void TabletImpl::Get(RpcController* controller, const ::openmldb::api::GetReques
     }
 }
 
+void TabletImpl::BatchGet(RpcController* controller, const ::openmldb::api::BatchGetRequest* request,
+                          ::openmldb::api::BatchGetResponse* response, Closure* done) {
+    brpc::ClosureGuard done_guard(done);
+    uint64_t start_time = ::baidu::common::timer::get_micros();
+    uint32_t tid = request->tid();
+    uint32_t pid = request->pid();
+    std::shared_ptr<Table> table = GetTable(tid, pid);
+    if (!table) {
+        PDLOG(WARNING, "table is not exist. tid %u, pid %u", tid, pid);
+        response->set_code(::openmldb::base::ReturnCode::kTableIsNotExist);
+        response->set_msg("table is not exist");
+        return;
+    }
+    if (table->GetTableStat() == ::openmldb::storage::kLoading) {
+        PDLOG(WARNING, "table is loading. tid %u, pid %u", tid, pid);
+        response->set_code(::openmldb::base::ReturnCode::kTableIsLoading);
+        response->set_msg("table is loading");
+        return;
+    }
+    auto table_meta = table->GetTableMeta();
+    const std::string pk_index_name = table->GetPkIndex()->GetName();
+    // the index id and expired value are resolved once for all the keys of an index
+    std::map<std::string, std::pair<uint32_t, ::openmldb::storage::TTLSt>> index_map;
+    brpc::Controller* cntl = static_cast<brpc::Controller*>(controller);
+    butil::IOBuf& buf = cntl->response_attachment();
+    uint32_t count = 0;
+    std::string value;
+    for (const auto& key : request->keys()) {
+        const std::string& index_name = key.idx_name().empty() ? pk_index_name : key.idx_name();
+        auto iter = index_map.find(index_name);
+        if (iter == index_map.end()) {
+            auto index_def = table->GetIndex(index_name);
+            if (!index_def || !index_def->IsReady()) {
+                response->add_codes(::openmldb::base::ReturnCode::kIdxNameNotFound);
+                continue;
+            }
+            ::openmldb::storage::TTLSt expired_value = *index_def->GetTTL();
+            expired_value.abs_ttl = table->GetExpireTime(expired_value);
+            iter = index_map.emplace(index_name, std::make_pair(index_def->GetId(), expired_value)).first;
+        }
+        std::vector<QueryIt> query_its(1);
+        GetIterator(table, key.key(), iter->second.first, &query_its[0].it, &query_its[0].ticket);
+        if (!query_its[0].it) {
+            response->add_codes(::openmldb::base::ReturnCode::kTsNameNotFound);
+            continue;
+        }
+        query_its[0].table = table;
+        CombineIterator combine_it(std::move(query_its), key.ts(), key.type(), iter->second.second);
+        combine_it.SeekToFirst();
+        uint64_t ts = 0;
+        std::shared_ptr<const ::openmldb::codec::RowProjectPlan> project_plan;
+        if (key.projection().size() > 0 && table_meta->format_version() == 1) {
+            project_plan = table->GetProjectPlan(key.projection());
+        }
+        int32_t code = GetIndex(&key, *table_meta, project_plan, &combine_it, &value, &ts);
+        switch (code) {
+            case 0: {
+                char header[12];
+                uint32_t total_size = 8 + value.size();
+                memcpy(header, static_cast<const void*>(&total_size), 4);
+                memrev32ifbe(header);
+                memcpy(header + 4, static_cast<const void*>(&ts), 8);
+                memrev64ifbe(header + 4);
+                buf.append(header, sizeof(header));
+                buf.append(value);
+                count++;
+                response->add_codes(::openmldb::base::ReturnCode::kOk);
+                break;
+            }
+            case 1:
+                response->add_codes(::openmldb::base::ReturnCode::kKeyNotFound);
+                break;
+            case -4:
+                response->add_codes(::openmldb::base::ReturnCode::kEncodeError);
+                break;
+            default:
+                response->add_codes(::openmldb::base::ReturnCode::kInvalidParameter);
+                break;
+        }
+        if (buf.size() > FLAGS_scan_max_bytes_size) {
+            LOG(WARNING) << "reach the max byte size " << FLAGS_scan_max_bytes_size << " cur is " << buf.size();
+            buf.clear();
+            response->clear_codes();
+            response->set_code(::openmldb::base::ReturnCode::kReacheTheScanMaxBytesSize);
+            response->set_msg("reach the max scan byte size");
+            return;
+        }
+    }
+    response->set_code(::openmldb::base::ReturnCode::kOk);
+    response->set_count(count);
+    response->set_buf_size(buf.size());
+    uint64_t end_time = ::baidu::common::timer::get_micros();
+    if (start_time + FLAGS_query_slow_log_threshold < end_time) {
+        PDLOG(INFO, "slow log[batch get]. key num %d time %lu. tid %u, pid %u", request->keys_size(),
+              end_time - start_time, tid, pid);
+    }
+}
+
 void TabletImpl::Put(RpcController* controller, const ::openmldb::api::PutRequest* request,
                      ::openmldb::api::PutResponse* response, Closure* done) {
     if (follower_.load(std::memory_order_relaxed)) {
@@ -554,6 +789,9 @@ void TabletImpl::Put(RpcController* controller, const ::openmldb::api::PutReques
         return;
     }
     uint64_t start_time = ::baidu::common::timer::get_micros();
+    if (workload_capture_.IsEnabled()) {
+        workload_capture_.Capture(::openmldb::api::CaptureEntry::kPut, start_time, *request, butil::IOBuf());
+    }
     std::shared_ptr<Table> table = GetTable(request->tid(), request->pid());
     if (!table) {
         PDLOG(WARNING, "table is not exist. tid %u, pid %u", request->tid(), request->pid());
@@ -590,58 +828,115 @@ void TabletImpl::Put(RpcController* controller, const ::openmldb::api::PutReques
         done->Run();
         return;
     }
-    bool ok = false;
-    if (request->dimensions_size() > 0) {
-        int32_t ret_code = CheckDimessionPut(request, table->GetIdxCnt());
-        if (ret_code != 0) {
-            response->set_code(::openmldb::base::ReturnCode::kInvalidDimensionParameter);
-            response->set_msg("invalid dimension parameter");
-            done->Run();
-            return;
+    if (!put_workers_.empty()) {
+        uint64_t idx = (static_cast<uint64_t>(request->tid()) * 131 + request->pid()) % put_workers_.size();
+        auto& worker = put_workers_[idx];
+        worker->AddTask(boost::bind(&TabletImpl::PutInternal, this, table, request, response, done, start_time));
+        return;
+    }
+    PutInternal(table, request, response, done, start_time);
+}
+
+static void ComputeDerivedRows(const std::vector<std::shared_ptr<DeploymentMaterializer>>& materializers,
+                               const ::openmldb::api::PutRequest& request, std::vector<DerivedRow>* rows) {
+    rows->resize(materializers.size());
+    for (size_t i = 0; i < materializers.size(); i++) {
+        materializers[i]->Compute(request, &(*rows)[i]);
+    }
+}
+
+static void WriteDerivedRows(const std::vector<std::shared_ptr<DeploymentMaterializer>>& materializers,
+                             const std::vector<DerivedRow>& rows) {
+    for (size_t i = 0; i < materializers.size() && i < rows.size(); i++) {
+        if (!rows[i].value.empty()) {
+            materializers[i]->Write(rows[i]);
         }
-        if (request->ts_dimensions_size() > 0) {
-            DLOG(INFO) << "put data to tid " << request->tid() << " pid " << request->pid() << " with key "
-                       << request->dimensions(0).key() << " ts " << request->ts_dimensions(0).ts();
-            ok = table->Put(request->dimensions(), request->ts_dimensions(), request->value());
-        } else {
-            DLOG(INFO) << "put data to tid " << request->tid() << " pid " << request->pid() << " with key "
-                       << request->dimensions(0).key() << " ts " << request->time();
+    }
+}
 
-            ok = table->Put(request->time(), request->value(), request->dimensions());
+std::vector<std::shared_ptr<DeploymentMaterializer>> TabletImpl::GetMaterializers(
+    const std::shared_ptr<Table>& table) {
+    std::vector<std::shared_ptr<DeploymentMaterializer>> materializers;
+    auto table_meta = table->GetTableMeta();
+    if (table_meta->materialized_deployments_size() == 0) {
+        return materializers;
+    }
+    uint32_t tid = table->GetId();
+    uint32_t pid = table->GetPid();
+    {
+        std::lock_guard<SpinMutex> spin_lock(spin_mutex_);
+        auto it = materializers_.find(tid);
+        if (it != materializers_.end()) {
+            auto pit = it->second.find(pid);
+            if (pit != it->second.end()) {
+                return pit->second;
+            }
         }
-    } else {
-        ok = table->Put(request->pk(), request->time(), request->value().c_str(), request->value().size());
     }
-    if (!ok) {
-        response->set_code(::openmldb::base::ReturnCode::kPutFailed);
-        response->set_msg("put failed");
+    for (const auto& desc : table_meta->materialized_deployments()) {
+        std::shared_ptr<Table> derived_table = GetTable(desc.derived_tid(), pid);
+        std::shared_ptr<LogReplicator> derived_replicator = GetReplicator(desc.derived_tid(), pid);
+        if (!derived_table || !derived_replicator || derived_table->GetTableStat() != ::openmldb::storage::kNormal) {
+            DEBUGLOG("derived table tid %u pid %u is not loaded", desc.derived_tid(), pid);
+            return {};
+        }
+        ::hybridse::codec::Schema request_schema;
+        ::hybridse::codec::Schema output_schema;
+        auto status = GetProcedureSchema(desc.db(), desc.sp_name(), &request_schema, &output_schema);
+        if (!status.isOK()) {
+            DEBUGLOG("deployment %s.%s is not compiled: %s", desc.db().c_str(), desc.sp_name().c_str(),
+                     status.msg.c_str());
+            return {};
+        }
+        std::string db = desc.db();
+        std::string sp_name = desc.sp_name();
+        auto runner = [this, db, sp_name](const ::hybridse::codec::Row& row, ::hybridse::codec::Row* output) {
+            return CallProcedureLocal(db, sp_name, row, 0, output);
+        };
+        auto materializer =
+            std::make_shared<DeploymentMaterializer>(desc, table, derived_table, derived_replicator, runner);
+        // the mismatched one is skipped until the table is loaded again
+        if (!materializer->Init(request_schema, output_schema)) {
+            PDLOG(WARNING, "fail to init materialized deployment %s with derived table tid %u. tid %u pid %u",
+                  desc.sp_name().c_str(), desc.derived_tid(), tid, pid);
+            continue;
+        }
+        materializers.push_back(materializer);
+    }
+    std::lock_guard<SpinMutex> spin_lock(spin_mutex_);
+    materializers_[tid][pid] = materializers;
+    return materializers;
+}
+
+void TabletImpl::PutInternal(const std::shared_ptr<Table>& table, const ::openmldb::api::PutRequest* request,
+                             ::openmldb::api::PutResponse* response, Closure* done, uint64_t start_time) {
+    // the outputs are computed before the put, as the request row of a deployment is not in its windows
+    auto materializers = GetMaterializers(table);
+    std::vector<DerivedRow> derived_rows;
+    ComputeDerivedRows(materializers, *request, &derived_rows);
+    std::string msg;
+    auto code = PutRow(table, *request, &msg);
+    if (code != ::openmldb::base::ReturnCode::kOk) {
+        response->set_code(code);
+        response->set_msg(msg);
         done->Run();
         return;
     }
 
     response->set_code(::openmldb::base::ReturnCode::kOk);
-    std::shared_ptr<LogReplicator> replicator;
-    do {
-        replicator = GetReplicator(request->tid(), request->pid());
-        if (!replicator) {
-            PDLOG(WARNING, "fail to find table tid %u pid %u leader's log replicator", request->tid(), request->pid());
-            break;
-        }
-        ::openmldb::api::LogEntry entry;
-        entry.set_pk(request->pk());
-        entry.set_ts(request->time());
-        entry.set_value(request->value());
-        entry.set_term(replicator->GetLeaderTerm());
-        if (request->dimensions_size() > 0) {
-            entry.mutable_dimensions()->CopyFrom(request->dimensions());
-        }
-        if (request->ts_dimensions_size() > 0) {
-            entry.mutable_ts_dimensions()->CopyFrom(request->ts_dimensions());
-        }
-        replicator->AppendEntry(entry);
-    } while (false);
+    std::shared_ptr<LogReplicator> replicator = GetReplicator(request->tid(), request->pid());
+    if (replicator) {
+        AppendPutEntry(replicator, *request);
+    } else {
+        PDLOG(WARNING, "fail to find table tid %u pid %u leader's log replicator", request->tid(), request->pid());
+    }
+    WriteDerivedRows(materializers, derived_rows);
 
     uint64_t end_time = ::baidu::common::timer::get_micros();
+    auto metrics = GetTableMetrics(request->tid(), request->pid());
+    if (metrics) {
+        metrics->put << end_time - start_time;
+    }
     if (start_time + FLAGS_put_slow_log_threshold < end_time) {
         std::string key;
         if (request->dimensions_size() > 0) {
@@ -668,6 +963,129 @@ void TabletImpl::Put(RpcController* controller, const ::openmldb::api::PutReques
     }
 }
 
+::openmldb::base::ReturnCode TabletImpl::PutRow(const std::shared_ptr<Table>& table,
+                                                const ::openmldb::api::PutRequest& request, std::string* msg) {
+    auto limit_code = CheckMemoryLimit(table->GetId(), table->GetPid(), msg);
+    if (limit_code != ::openmldb::base::ReturnCode::kOk) {
+        return limit_code;
+    }
+    bool ok = false;
+    if (request.dimensions_size() > 0) {
+        int32_t ret_code = CheckDimessionPut(&request, table->GetIdxCnt());
+        if (ret_code != 0) {
+            msg->assign("invalid dimension parameter");
+            return ::openmldb::base::ReturnCode::kInvalidDimensionParameter;
+        }
+        if (request.ts_dimensions_size() > 0) {
+            DLOG(INFO) << "put data to tid " << table->GetId() << " pid " << table->GetPid() << " with key "
+                       << request.dimensions(0).key() << " ts " << request.ts_dimensions(0).ts();
+            ok = table->Put(request.dimensions(), request.ts_dimensions(), request.value());
+        } else {
+            DLOG(INFO) << "put data to tid " << table->GetId() << " pid " << table->GetPid() << " with key "
+                       << request.dimensions(0).key() << " ts " << request.time();
+
+            ok = table->Put(request.time(), request.value(), request.dimensions());
+        }
+    } else {
+        ok = table->Put(request.pk(), request.time(), request.value().c_str(), request.value().size());
+    }
+    if (!ok) {
+        msg->assign("put failed");
+        return ::openmldb::base::ReturnCode::kPutFailed;
+    }
+    return ::openmldb::base::ReturnCode::kOk;
+}
+
+void TabletImpl::AppendPutEntry(const std::shared_ptr<LogReplicator>& replicator,
+                                const ::openmldb::api::PutRequest& request) {
+    // the entry is built once and shared with the binlog cache
+    auto entry = std::make_shared<::openmldb::api::LogEntry>();
+    entry->set_pk(request.pk());
+    entry->set_ts(request.time());
+    entry->set_value(request.value());
+    entry->set_term(replicator->GetLeaderTerm());
+    if (request.dimensions_size() > 0) {
+        entry->mutable_dimensions()->CopyFrom(request.dimensions());
+    }
+    if (request.ts_dimensions_size() > 0) {
+        entry->mutable_ts_dimensions()->CopyFrom(request.ts_dimensions());
+    }
+    replicator->AppendEntry(entry);
+}
+
+void TabletImpl::PutBatch(RpcController* controller, const ::openmldb::api::PutBatchRequest* request,
+                          ::openmldb::api::PutBatchResponse* response, Closure* done) {
+    brpc::ClosureGuard done_guard(done);
+    response->set_count(0);
+    if (follower_.load(std::memory_order_relaxed)) {
+        response->set_code(::openmldb::base::ReturnCode::kIsFollowerCluster);
+        response->set_msg("is follower cluster");
+        return;
+    }
+    uint64_t start_time = ::baidu::common::timer::get_micros();
+    std::shared_ptr<Table> table = GetTable(request->tid(), request->pid());
+    if (!table) {
+        PDLOG(WARNING, "table is not exist. tid %u, pid %u", request->tid(), request->pid());
+        response->set_code(::openmldb::base::ReturnCode::kTableIsNotExist);
+        response->set_msg("table is not exist");
+        return;
+    }
+    if ((!request->has_format_version() && table->GetTableMeta()->format_version() == 1) ||
+        (request->has_format_version() && request->format_version() != table->GetTableMeta()->format_version())) {
+        response->set_code(::openmldb::base::ReturnCode::kPutBadFormat);
+        response->set_msg("put bad format");
+        return;
+    }
+    if (!table->IsLeader()) {
+        response->set_code(::openmldb::base::ReturnCode::kTableIsFollower);
+        response->set_msg("table is follower");
+        return;
+    }
+    if (table->GetTableStat() == ::openmldb::storage::kLoading) {
+        PDLOG(WARNING, "table is loading. tid %u, pid %u", request->tid(), request->pid());
+        response->set_code(::openmldb::base::ReturnCode::kTableIsLoading);
+        response->set_msg("table is loading");
+        return;
+    }
+    std::shared_ptr<LogReplicator> replicator = GetReplicator(request->tid(), request->pid());
+    if (!replicator) {
+        PDLOG(WARNING, "fail to find table tid %u pid %u leader's log replicator", request->tid(), request->pid());
+    }
+    response->set_code(::openmldb::base::ReturnCode::kOk);
+    auto materializers = GetMaterializers(table);
+    std::vector<DerivedRow> derived_rows;
+    uint32_t count = 0;
+    for (const auto& row : request->rows()) {
+        if (row.time() == 0 && row.ts_dimensions_size() == 0) {
+            response->set_code(::openmldb::base::ReturnCode::kTsMustBeGreaterThanZero);
+            response->set_msg("ts must be greater than zero");
+            break;
+        }
+        ComputeDerivedRows(materializers, row, &derived_rows);
+        std::string msg;
+        auto code = PutRow(table, row, &msg);
+        if (code != ::openmldb::base::ReturnCode::kOk) {
+            response->set_code(code);
+            response->set_msg(msg);
+            break;
+        }
+        if (replicator) {
+            AppendPutEntry(replicator, row);
+        }
+        WriteDerivedRows(materializers, derived_rows);
+        count++;
+    }
+    response->set_count(count);
+    uint64_t end_time = ::baidu::common::timer::get_micros();
+    if (start_time + FLAGS_put_slow_log_threshold < end_time) {
+        PDLOG(INFO, "slow log[put batch]. %u rows time %lu. tid %u, pid %u", count, end_time - start_time,
+              request->tid(), request->pid());
+    }
+    if (replicator && count > 0 && FLAGS_binlog_notify_on_put) {
+        replicator->Notify();
+    }
+}
+
 int TabletImpl::CheckTableMeta(const openmldb::api::TableMeta* table_meta, std::string& msg) {
     msg.clear();
     if (table_meta->name().size() <= 0) {
@@ -741,12 +1159,18 @@ int TabletImpl::CheckTableMeta(const openmldb::api::TableMeta* table_meta, std::
     return 0;
 }
 
+static inline void AppendAttachmentHeader(uint64_t ts, uint32_t size, AttachmentWriter* writer) {
+    char header[12];
+    ::openmldb::codec::EncodeHeader(ts, size, header);
+    writer->Append(header, sizeof(header));
+}
+
 int32_t TabletImpl::ScanIndex(const ::openmldb::api::ScanRequest* request, const ::openmldb::api::TableMeta& meta,
-                              const std::map<int32_t, std::shared_ptr<Schema>>& vers_schema,
-                              CombineIterator* combine_it, butil::IOBuf* io_buf, uint32_t* count) {
+                              const std::shared_ptr<const ::openmldb::codec::RowProjectPlan>& project_plan,
+                              CombineIterator* combine_it, AttachmentWriter* writer, uint32_t* count) {
     uint32_t limit = request->limit();
     uint32_t atleast = request->atleast();
-    if (combine_it == NULL || io_buf == NULL || count == NULL || (atleast > limit && limit != 0)) {
+    if (combine_it == NULL || writer == NULL || count == NULL || (atleast > limit && limit != 0)) {
         PDLOG(WARNING, "invalid args");
         return -1;
     }
@@ -770,14 +1194,13 @@ int32_t TabletImpl::ScanIndex(const ::openmldb::api::ScanRequest* request, const
     }
 
     bool enable_project = false;
-    ::openmldb::codec::RowProject row_project(vers_schema, request->projection());
+    ::openmldb::codec::RowProject row_project(project_plan);
     if (request->projection().size() > 0 && meta.format_version() == 1) {
         if (meta.compress_type() == ::openmldb::type::kSnappy) {
             LOG(WARNING) << "project on compress row data do not eing supported";
             return -1;
         }
-        bool ok = row_project.Init();
-        if (!ok) {
+        if (!project_plan) {
             PDLOG(WARNING, "invalid project list");
             return -1;
         }
@@ -785,6 +1208,7 @@ int32_t TabletImpl::ScanIndex(const ::openmldb::api::ScanRequest* request, const
     }
     bool remove_duplicated_record =
         request->has_enable_remove_duplicated_record() && request->enable_remove_duplicated_record();
+    bool with_ts = request->attachment_with_ts();
     uint64_t last_time = 0;
     uint32_t total_block_size = 0;
     uint32_t record_count = 0;
@@ -833,11 +1257,21 @@ int32_t TabletImpl::ScanIndex(const ::openmldb::api::ScanRequest* request, const
                 PDLOG(WARNING, "fail to make a projection");
                 return -4;
             }
-            io_buf->append(reinterpret_cast<void*>(ptr), size);
+            if (with_ts) {
+                AppendAttachmentHeader(ts, size, writer);
+            }
+            writer->AppendOwned(reinterpret_cast<char*>(ptr), size);
             total_block_size += size;
         } else {
             openmldb::base::Slice data = combine_it->GetValue();
-            io_buf->append(reinterpret_cast<const void*>(data.data()), data.size());
+            if (with_ts) {
+                AppendAttachmentHeader(ts, data.size(), writer);
+            }
+            if (combine_it->IsValuePinned()) {
+                writer->AppendPinned(data);
+            } else {
+                writer->Append(data.data(), data.size());
+            }
             total_block_size += data.size();
         }
         record_count++;
@@ -851,7 +1285,7 @@ int32_t TabletImpl::ScanIndex(const ::openmldb::api::ScanRequest* request, const
     return 0;
 }
 int32_t TabletImpl::ScanIndex(const ::openmldb::api::ScanRequest* request, const ::openmldb::api::TableMeta& meta,
-                              const std::map<int32_t, std::shared_ptr<Schema>>& vers_schema,
+                              const std::shared_ptr<const ::openmldb::codec::RowProjectPlan>& project_plan,
                               CombineIterator* combine_it, std::string* pairs, uint32_t* count) {
     uint32_t limit = request->limit();
     uint32_t atleast = request->atleast();
@@ -878,14 +1312,13 @@ int32_t TabletImpl::ScanIndex(const ::openmldb::api::ScanRequest* request, const
     }
 
     bool enable_project = false;
-    ::openmldb::codec::RowProject row_project(vers_schema, request->projection());
+    ::openmldb::codec::RowProject row_project(project_plan);
     if (request->projection().size() > 0 && meta.format_version() == 1) {
         if (meta.compress_type() == ::openmldb::type::kSnappy) {
             LOG(WARNING) << "project on compress row data do not eing supported";
             return -1;
         }
-        bool ok = row_project.Init();
-        if (!ok) {
+        if (!project_plan) {
             PDLOG(WARNING, "invalid project list");
             return -1;
         }
@@ -1144,25 +1577,47 @@ void TabletImpl::Scan(RpcController* controller, const ::openmldb::api::ScanRequ
         query_its[idx].table = table;
     }
     auto table_meta = query_its.begin()->table->GetTableMeta();
-    const std::map<int32_t, std::shared_ptr<Schema>> vers_schema = query_its.begin()->table->GetAllVersionSchema();
+    std::shared_ptr<const ::openmldb::codec::RowProjectPlan> project_plan;
+    if (request->projection().size() > 0 && table_meta->format_version() == 1) {
+        project_plan = query_its.begin()->table->GetProjectPlan(request->projection());
+    }
+    // the rows appended to the attachment by reference are valid as long as the iterators and tickets
+    bool use_attachment = request->use_attachment() || request->attachment_with_ts();
+    std::vector<QueryIt> pinned_its;
+    if (use_attachment) {
+        pinned_its = query_its;
+    }
     CombineIterator combine_it(std::move(query_its), request->st(), request->st_type(), expired_value);
     uint32_t count = 0;
     int32_t code = 0;
-    if (!request->has_use_attachment() || !request->use_attachment()) {
+    if (!use_attachment) {
         std::string* pairs = response->mutable_pairs();
-        code = ScanIndex(request, *table_meta, vers_schema, &combine_it, pairs, &count);
+        code = ScanIndex(request, *table_meta, project_plan, &combine_it, pairs, &count);
         response->set_code(code);
         response->set_count(count);
     } else {
         brpc::Controller* cntl = static_cast<brpc::Controller*>(controller);
         butil::IOBuf& buf = cntl->response_attachment();
-        code = ScanIndex(request, *table_meta, vers_schema, &combine_it, &buf, &count);
+        AttachmentWriter writer(&buf);
+        for (const auto& query_it : pinned_its) {
+            writer.Pin(query_it.table);
+            writer.Pin(query_it.it);
+            writer.Pin(query_it.ticket);
+        }
+        code = ScanIndex(request, *table_meta, project_plan, &combine_it, &writer, &count);
+        writer.Finish();
         response->set_code(code);
         response->set_count(count);
         response->set_buf_size(buf.size());
         DLOG(INFO) << " scan " << request->pk() << " with buf size " << buf.size();
+        response->set_attachment_compress_type(
+            codec::CompressAttachment(request->accept_compress_type(), FLAGS_attachment_compress_min_size, &buf));
     }
     uint64_t end_time = ::baidu::common::timer::get_micros();
+    auto metrics = GetTableMetrics(request->tid(), request->pid());
+    if (metrics) {
+        metrics->scan << end_time - start_time;
+    }
     if (start_time + FLAGS_query_slow_log_threshold < end_time) {
         std::string index_name;
         if (request->has_idx_name() && request->idx_name().size() > 0) {
@@ -1230,8 +1685,8 @@ void TabletImpl::Count(RpcController* controller, const ::openmldb::api::CountRe
     }
     index = index_def->GetId();
     ttl = *index_def->GetTTL();
+    MemTable* mem_table = dynamic_cast<MemTable*>(table.get());
     if (!request->filter_expired_data()) {
-        MemTable* mem_table = dynamic_cast<MemTable*>(table.get());
         if (mem_table != NULL) {
             uint64_t count = 0;
             if (mem_table->GetCount(index, request->key(), count) < 0) {
@@ -1243,6 +1698,24 @@ void TabletImpl::Count(RpcController* controller, const ::openmldb::api::CountRe
             return;
         }
     }
+    uint64_t expire_time = table->GetExpireTime(ttl);
+    // count the whole key by its row count rather than iterating, as CountIndex does with no st and et
+    if (mem_table != NULL && request->st() == 0 && request->et() == 0 && !request->enable_remove_duplicated_record() &&
+        (request->st_type() == ::openmldb::api::GetType::kSubKeyEq ||
+         request->st_type() == ::openmldb::api::GetType::kSubKeyLe ||
+         request->st_type() == ::openmldb::api::GetType::kSubKeyLt) &&
+        (request->et_type() == ::openmldb::api::GetType::kSubKeyGt ||
+         request->et_type() == ::openmldb::api::GetType::kSubKeyGe)) {
+        // the et of kSubKeyGt leaves out the rows of ts 0, unless it turns to kSubKeyGe by the expire time
+        bool skip_zero_ts = request->et_type() == ::openmldb::api::GetType::kSubKeyGt && expire_time == 0;
+        uint64_t count = 0;
+        if (mem_table->GetLiveCount(index, request->key(), expire_time, ttl.lat_ttl, skip_zero_ts, &count) == 0) {
+            response->set_code(::openmldb::base::ReturnCode::kOk);
+            response->set_msg("ok");
+            response->set_count(count);
+            return;
+        }
+    }
     ::openmldb::storage::Ticket ticket;
     ::openmldb::storage::TableIterator* it = table->NewIterator(index, request->key(), ticket);
     if (it == NULL) {
@@ -1252,7 +1725,7 @@ void TabletImpl::Count(RpcController* controller, const ::openmldb::api::CountRe
     }
     uint32_t count = 0;
     int32_t code = 0;
-    code = CountIndex(table->GetExpireTime(ttl), ttl.lat_ttl, index_def->GetTTLType(), it, request, &count);
+    code = CountIndex(expire_time, ttl.lat_ttl, index_def->GetTTLType(), it, request, &count);
     delete it;
     response->set_code(code);
     response->set_count(count);
@@ -1313,8 +1786,23 @@ void TabletImpl::Traverse(RpcController* controller, const ::openmldb::api::Trav
         return;
     }
     index = index_def->GetId();
+    bool use_cursor = request->use_cursor() && FLAGS_traverse_cursor_ttl > 0;
+    std::unique_ptr<TraverseCursor> cursor;
+    if (use_cursor && request->cursor_id() > 0) {
+        cursor = traverse_cursors_.Take(request->cursor_id());
+        // the cursor of a retried request stops at a later page
+        if (cursor && (cursor->tid != request->tid() || cursor->pid != request->pid() || cursor->index != index ||
+                       cursor->table != table || cursor->pk != request->pk() || cursor->ts != request->ts())) {
+            cursor.reset();
+        }
+    }
     ::openmldb::storage::TableIterator* it = NULL;
-    it = table->NewTraverseIterator(index);
+    if (cursor) {
+        it = cursor->it.release();
+        it->ResetCount();
+    } else {
+        it = table->NewTraverseIterator(index);
+    }
     if (it == NULL) {
         response->set_code(::openmldb::base::ReturnCode::kTsNameNotFound);
         response->set_msg("ts name not found, when create iterator");
@@ -1323,7 +1811,17 @@ void TabletImpl::Traverse(RpcController* controller, const ::openmldb::api::Trav
 
     uint64_t last_time = 0;
     std::string last_pk;
-    if (request->has_pk() && request->pk().size() > 0) {
+    if (cursor) {
+        // go on from the row the last page stops at without seeking the key again
+        DEBUGLOG("tid %u, pid %u go on with cursor %lu", request->tid(), request->pid(), request->cursor_id());
+        if (cursor->need_next) {
+            it->Next();
+        } else if (!it->Valid()) {
+            it->Seek(request->pk(), request->ts());
+        }
+        last_pk = request->pk();
+        last_time = request->ts();
+    } else if (request->has_pk() && request->pk().size() > 0) {
         DEBUGLOG("tid %u, pid %u seek pk %s ts %lu", request->tid(), request->pid(), request->pk().c_str(),
                  request->ts());
         it->Seek(request->pk(), request->ts());
@@ -1333,6 +1831,24 @@ void TabletImpl::Traverse(RpcController* controller, const ::openmldb::api::Trav
         DEBUGLOG("tid %u, pid %u seek to first", request->tid(), request->pid());
         it->SeekToFirst();
     }
+    bool enable_project = false;
+    auto table_meta = table->GetTableMeta();
+    std::shared_ptr<const ::openmldb::codec::RowProjectPlan> project_plan;
+    if (request->projection().size() > 0 && table_meta->format_version() == 1 &&
+        table_meta->compress_type() != ::openmldb::type::kSnappy) {
+        project_plan = table->GetProjectPlan(request->projection());
+    }
+    ::openmldb::codec::RowProject row_project(project_plan);
+    if (request->projection().size() > 0 && table_meta->format_version() == 1) {
+        if (!project_plan) {
+            PDLOG(WARNING, "invalid project list. tid %u, pid %u", request->tid(), request->pid());
+            response->set_code(::openmldb::base::ReturnCode::kInvalidParameter);
+            response->set_msg("invalid project list");
+            delete it;
+            return;
+        }
+        enable_project = true;
+    }
     std::map<std::string, std::vector<std::pair<uint64_t, openmldb::base::Slice>>> value_map;
     uint32_t total_block_size = 0;
     bool remove_duplicated_record = false;
@@ -1340,6 +1856,8 @@ void TabletImpl::Traverse(RpcController* controller, const ::openmldb::api::Trav
         remove_duplicated_record = request->enable_remove_duplicated_record();
     }
     uint32_t scount = 0;
+    // the row of the iterator is returned when the loop stops
+    bool need_next = false;
     for (; it->Valid(); it->Next()) {
         if (request->limit() > 0 && scount > request->limit() - 1) {
             DEBUGLOG("reache the limit %u ", request->limit());
@@ -1358,12 +1876,27 @@ void TabletImpl::Traverse(RpcController* controller, const ::openmldb::api::Trav
             value_map[last_pk].reserve(request->limit());
         }
         openmldb::base::Slice value = it->GetValue();
-        value_map[last_pk].push_back(std::make_pair(it->GetKey(), value));
-        total_block_size += last_pk.length() + value.size();
+        if (enable_project) {
+            int8_t* ptr = nullptr;
+            uint32_t size = 0;
+            if (!row_project.Project(reinterpret_cast<const int8_t*>(value.data()), value.size(), &ptr, &size)) {
+                PDLOG(WARNING, "fail to make a projection. tid %u, pid %u", request->tid(), request->pid());
+                response->set_code(::openmldb::base::ReturnCode::kEncodeError);
+                response->set_msg("fail to make a projection");
+                delete it;
+                return;
+            }
+            value_map[last_pk].emplace_back(it->GetKey(), Slice(reinterpret_cast<char*>(ptr), size, true));
+            total_block_size += last_pk.length() + size;
+        } else {
+            value_map[last_pk].push_back(std::make_pair(it->GetKey(), value));
+            total_block_size += last_pk.length() + value.size();
+        }
         scount++;
         if (it->GetCount() >= FLAGS_max_traverse_cnt) {
             DEBUGLOG("traverse cnt %lu max %lu, key %s ts %lu", it->GetCount(), FLAGS_max_traverse_cnt, last_pk.c_str(),
                      last_time);
+            need_next = true;
             break;
         }
     }
@@ -1379,24 +1912,56 @@ void TabletImpl::Traverse(RpcController* controller, const ::openmldb::api::Trav
     } else if (scount < request->limit()) {
         is_finish = true;
     }
-    uint32_t total_size = scount * (8 + 4 + 4) + total_block_size;
-    std::string* pairs = response->mutable_pairs();
-    if (scount <= 0) {
-        pairs->resize(0);
+    if (request->use_attachment()) {
+        // the values of the pks passed are not pinned by the iterator any more, so they are copied
+        butil::IOBuf& buf = static_cast<brpc::Controller*>(controller)->response_attachment();
+        std::string header;
+        for (const auto& kv : value_map) {
+            header.resize(4 + 4 + 8 + kv.first.length());
+            for (const auto& pair : kv.second) {
+                ::openmldb::codec::EncodeFullHeader(kv.first, pair.first, pair.second.size(), &header[0]);
+                buf.append(header);
+                buf.append(pair.second.data(), pair.second.size());
+            }
+        }
+        response->set_buf_size(buf.size());
     } else {
-        pairs->resize(total_size);
-    }
-    char* rbuffer = reinterpret_cast<char*>(&((*pairs)[0]));
-    uint32_t offset = 0;
-    for (const auto& kv : value_map) {
-        for (const auto& pair : kv.second) {
-            DEBUGLOG("encode pk %s ts %lu size %u", kv.first.c_str(), pair.first, pair.second.size());
-            ::openmldb::codec::EncodeFull(kv.first, pair.first, pair.second.data(), pair.second.size(), rbuffer,
-                                          offset);
-            offset += (4 + 4 + 8 + kv.first.length() + pair.second.size());
+        uint32_t total_size = scount * (8 + 4 + 4) + total_block_size;
+        std::string* pairs = response->mutable_pairs();
+        if (scount <= 0) {
+            pairs->resize(0);
+        } else {
+            pairs->resize(total_size);
+        }
+        char* rbuffer = reinterpret_cast<char*>(&((*pairs)[0]));
+        uint32_t offset = 0;
+        for (const auto& kv : value_map) {
+            for (const auto& pair : kv.second) {
+                DEBUGLOG("encode pk %s ts %lu size %u", kv.first.c_str(), pair.first, pair.second.size());
+                ::openmldb::codec::EncodeFull(kv.first, pair.first, pair.second.data(), pair.second.size(), rbuffer,
+                                              offset);
+                offset += (4 + 4 + 8 + kv.first.length() + pair.second.size());
+            }
         }
     }
-    delete it;
+    uint64_t cursor_id = 0;
+    if (use_cursor && !is_finish) {
+        if (!cursor) {
+            cursor.reset(new TraverseCursor());
+            cursor->tid = request->tid();
+            cursor->pid = request->pid();
+            cursor->index = index;
+            cursor->table = table;
+        }
+        cursor->it.reset(it);
+        cursor->pk = last_pk;
+        cursor->ts = last_time;
+        cursor->need_next = need_next;
+        cursor_id = traverse_cursors_.Put(std::move(cursor), request->cursor_id());
+    } else {
+        delete it;
+    }
+    response->set_cursor_id(cursor_id);
     DEBUGLOG("traverse count %d. last_pk %s last_time %lu", scount, last_pk.c_str(), last_time);
     response->set_code(::openmldb::base::ReturnCode::kOk);
     response->set_count(scount);
@@ -1444,7 +2009,24 @@ void TabletImpl::Delete(RpcController* controller, const ::openmldb::api::Delete
         }
         idx = index_def->GetId();
     }
-    if (table->Delete(request->key(), idx)) {
+    // the delete is applied by the same entry as it is replayed from the binlog
+    ::openmldb::api::LogEntry entry;
+    entry.set_method_type(::openmldb::api::MethodType::kDelete);
+    if (!request->key().empty() || !request->has_ts()) {
+        ::openmldb::api::Dimension* dimension = entry.add_dimensions();
+        dimension->set_key(request->key());
+        dimension->set_idx(idx);
+    }
+    if (request->has_ts()) {
+        if (request->ts() < request->end_ts()) {
+            response->set_code(::openmldb::base::ReturnCode::kInvalidParameter);
+            response->set_msg("ts is less than end_ts");
+            return;
+        }
+        entry.set_ts(request->ts());
+        entry.set_end_ts(request->end_ts());
+    }
+    if (table->Delete(entry)) {
         response->set_code(::openmldb::base::ReturnCode::kOk);
         response->set_msg("ok");
         DEBUGLOG("delete ok. tid %u, pid %u, key %s", request->tid(), request->pid(), request->key().c_str());
@@ -1460,12 +2042,7 @@ void TabletImpl::Delete(RpcController* controller, const ::openmldb::api::Delete
             PDLOG(WARNING, "fail to find table tid %u pid %u leader's log replicator", request->tid(), request->pid());
             break;
         }
-        ::openmldb::api::LogEntry entry;
         entry.set_term(replicator->GetLeaderTerm());
-        entry.set_method_type(::openmldb::api::MethodType::kDelete);
-        ::openmldb::api::Dimension* dimension = entry.add_dimensions();
-        dimension->set_key(request->key());
-        dimension->set_idx(idx);
         replicator->AppendEntry(entry);
     } while (false);
     if (replicator && FLAGS_binlog_notify_on_put) {
@@ -1474,17 +2051,107 @@ void TabletImpl::Delete(RpcController* controller, const ::openmldb::api::Delete
     return;
 }
 
+// write the rows to the stream in the chunks of whole rows, waiting for the client when the stream is full
+static bool WriteStreamRows(brpc::StreamId stream, uint32_t chunk_size, butil::IOBuf* rows) {
+    while (!rows->empty()) {
+        size_t chunk_bytes = 0;
+        while (chunk_bytes < rows->size()) {
+            uint32_t row_size = 0;
+            if (rows->copy_to(reinterpret_cast<void*>(&row_size), 4, chunk_bytes + 2) != 4 || row_size == 0) {
+                LOG(WARNING) << "invalid row in the stream rows at " << chunk_bytes;
+                return false;
+            }
+            if (chunk_bytes > 0 && chunk_bytes + row_size > chunk_size) {
+                break;
+            }
+            chunk_bytes += row_size;
+        }
+        butil::IOBuf chunk;
+        rows->cutn(&chunk, chunk_bytes);
+        int ret = brpc::StreamWrite(stream, chunk);
+        while (ret == EAGAIN) {
+            timespec due_time = butil::milliseconds_from_now(FLAGS_stream_write_timeout_ms);
+            ret = brpc::StreamWait(stream, &due_time);
+            if (ret != 0) {
+                break;
+            }
+            ret = brpc::StreamWrite(stream, chunk);
+        }
+        if (ret != 0) {
+            LOG(WARNING) << "fail to write the stream rows, ret " << ret;
+            return false;
+        }
+    }
+    return true;
+}
+
 void TabletImpl::Query(RpcController* ctrl, const openmldb::api::QueryRequest* request,
                        openmldb::api::QueryResponse* response, Closure* done) {
     DLOG(INFO) << "handle query request begin!";
     brpc::ClosureGuard done_guard(done);
+    uint64_t start_time = ::baidu::common::timer::get_micros();
+    if (workload_capture_.IsEnabled()) {
+        workload_capture_.Capture(::openmldb::api::CaptureEntry::kQuery, start_time, *request,
+                                  static_cast<brpc::Controller*>(ctrl)->request_attachment());
+    }
+    QueryAdmissionGuard admission(&query_admission_, request->is_procedure(), request->db(), request->sp_name());
+    if (!admission.IsAdmitted()) {
+        response->set_code(::openmldb::base::kQueryOverloaded);
+        response->set_msg("the tablet is overloaded, the query is rejected");
+        return;
+    }
     brpc::Controller* cntl = static_cast<brpc::Controller*>(ctrl);
     butil::IOBuf& buf = cntl->response_attachment();
-    ProcessQuery(ctrl, request, response, &buf);
+    brpc::StreamId stream = brpc::INVALID_STREAM_ID;
+    if (request->is_batch() && request->stream_chunk_size() > 0) {
+        brpc::StreamOptions stream_options;
+        if (brpc::StreamAccept(&stream, *cntl, &stream_options) != 0) {
+            LOG(WARNING) << "fail to accept the stream, the rows are put in the response";
+            stream = brpc::INVALID_STREAM_ID;
+        }
+    }
+    if (stream == brpc::INVALID_STREAM_ID) {
+        ProcessQuery(ctrl, request, response, &buf, FLAGS_scan_max_bytes_size, start_time);
+        if (response->code() == ::openmldb::base::kOk) {
+            response->set_attachment_compress_type(
+                codec::CompressAttachment(request->accept_compress_type(), FLAGS_attachment_compress_min_size, &buf));
+        }
+        return;
+    }
+    // the rows are written to the stream after the response is sent, so the result is not
+    // truncated by scan_max_bytes_size and the client reads it while it is transferred
+    butil::IOBuf rows;
+    ProcessQuery(ctrl, request, response, &rows, FLAGS_stream_max_bytes_size, start_time);
+    if (response->code() == ::openmldb::base::kOk) {
+        response->set_stream(true);
+    }
+    done_guard.reset(NULL);
+    if (response->stream()) {
+        WriteStreamRows(stream, request->stream_chunk_size(), &rows);
+    }
+    brpc::StreamClose(stream);
+}
+
+// add the time from start_us of a stage to the traces of the response when the session is traced, start_us is
+// set to the time now for the next stage
+static void AddStageTrace(const std::string& stage, int64_t id, uint64_t& start_us,  // NOLINT
+                          const ::hybridse::vm::RunSession& session, openmldb::api::QueryResponse* response) {
+    if (!session.IsTrace()) {
+        return;
+    }
+    uint64_t now = ::baidu::common::timer::get_micros();
+    auto trace = response->add_traces();
+    trace->set_stage(stage);
+    if (id >= 0) {
+        trace->set_id(id);
+    }
+    trace->set_time_us(now - start_us);
+    start_us = now;
 }
 
 void TabletImpl::ProcessQuery(RpcController* ctrl, const openmldb::api::QueryRequest* request,
-                              ::openmldb::api::QueryResponse* response, butil::IOBuf* buf) {
+                              ::openmldb::api::QueryResponse* response, butil::IOBuf* buf, uint64_t max_bytes_size,
+                              uint64_t start_time) {
     ::hybridse::base::Status status;
     if (request->is_batch()) {
         // convert repeated openmldb:type::DataType into hybridse::codec::Schema
@@ -1506,6 +2173,8 @@ void TabletImpl::ProcessQuery(RpcController* ctrl, const openmldb::api::QueryReq
             session.EnableDebug();
         }
         session.SetParameterSchema(parameter_schema);
+        session.SetMemoryBudget(static_cast<uint64_t>(FLAGS_batch_query_memory_budget_mb) << 20,
+                                FLAGS_batch_query_spill_dir);
         {
             bool ok = engine_->Get(request->sql(), request->db(), session, status);
             if (!ok) {
@@ -1527,6 +2196,13 @@ void TabletImpl::ProcessQuery(RpcController* ctrl, const openmldb::api::QueryReq
         }
         std::vector<::hybridse::codec::Row> output_rows;
         int32_t run_ret = session.Run(parameter_row, output_rows);
+        if (run_ret == ::hybridse::vm::RunSession::kRunMemoryExceeded) {
+            response->set_msg("the rows of the query are beyond the memory budget " +
+                              std::to_string(FLAGS_batch_query_memory_budget_mb) + "MB");
+            response->set_code(::openmldb::base::kSQLRunError);
+            PDLOG(WARNING, "sql %s is beyond the memory budget", request->sql().c_str());
+            return;
+        }
         if (run_ret != 0) {
             response->set_msg(status.msg);
             response->set_code(::openmldb::base::kSQLRunError);
@@ -1536,7 +2212,7 @@ void TabletImpl::ProcessQuery(RpcController* ctrl, const openmldb::api::QueryReq
         uint32_t byte_size = 0;
         uint32_t count = 0;
         for (auto& output_row : output_rows) {
-            if (byte_size > FLAGS_scan_max_bytes_size) {
+            if (byte_size > max_bytes_size) {
                 LOG(WARNING) << "reach the max byte size truncate result";
                 response->set_schema(session.GetEncodedSchema());
                 response->set_byte_size(byte_size);
@@ -1559,6 +2235,16 @@ void TabletImpl::ProcessQuery(RpcController* ctrl, const openmldb::api::QueryReq
         if (request->is_debug()) {
             session.EnableDebug();
         }
+        if (request->timeout_ms() > 0) {
+            uint64_t arrival = start_time > 0 ? start_time : ::baidu::common::timer::get_micros();
+            session.SetDeadline(arrival + request->timeout_ms() * 1000);
+        }
+        bool sampled = IsQueryTraceSampled(*request);
+        uint64_t start_us = 0;
+        if (request->is_trace() || sampled) {
+            session.EnableTrace();
+            start_us = ::baidu::common::timer::get_micros();
+        }
         if (request->is_procedure()) {
             const std::string& db_name = request->db();
             const std::string& sp_name = request->sp_name();
@@ -1575,7 +2261,11 @@ void TabletImpl::ProcessQuery(RpcController* ctrl, const openmldb::api::QueryReq
             }
             session.SetCompileInfo(request_compile_info);
             session.SetSpName(sp_name);
+            AddStageTrace("compile", -1, start_us, session, response);
             RunRequestQuery(ctrl, *request, session, *response, *buf);
+            if (sampled) {
+                RecordQueryTrace(*request, *response);
+            }
         } else {
             bool ok = engine_->Get(request->sql(), request->db(), session, status);
             if (!ok || session.GetCompileInfo() == nullptr) {
@@ -1584,8 +2274,12 @@ void TabletImpl::ProcessQuery(RpcController* ctrl, const openmldb::api::QueryReq
                 DLOG(WARNING) << "fail to compile sql in request mode:\n" << request->sql();
                 return;
             }
+            AddStageTrace("compile", -1, start_us, session, response);
             RunRequestQuery(ctrl, *request, session, *response, *buf);
         }
+        if (!request->is_trace()) {
+            response->clear_traces();
+        }
         const std::string& sql = session.GetCompileInfo()->GetSql();
         if (response->code() != ::openmldb::base::kOk) {
             DLOG(WARNING) << "fail to run sql " << sql << " error msg: " << response->msg();
@@ -1601,16 +2295,59 @@ void TabletImpl::SubQuery(RpcController* ctrl, const openmldb::api::QueryRequest
     brpc::ClosureGuard done_guard(done);
     brpc::Controller* cntl = static_cast<brpc::Controller*>(ctrl);
     butil::IOBuf& buf = cntl->response_attachment();
-    ProcessQuery(ctrl, request, response, &buf);
+    ProcessQuery(ctrl, request, response, &buf, FLAGS_scan_max_bytes_size);
+}
+
+void TabletImpl::SubQueryBatch(RpcController* ctrl, const openmldb::api::SubQueryBatchRequest* request,
+                               openmldb::api::SubQueryBatchResponse* response, Closure* done) {
+    DLOG(INFO) << "handle subquery batch request with " << request->requests_size() << " requests";
+    brpc::ClosureGuard done_guard(done);
+    brpc::Controller* cntl = static_cast<brpc::Controller*>(ctrl);
+    butil::IOBuf& request_buf = cntl->request_attachment();
+    butil::IOBuf& buf = cntl->response_attachment();
+    for (const auto& sub_request : request->requests()) {
+        // every request is processed with a controller holding its own row
+        brpc::Controller sub_cntl;
+        if (sub_request.row_size() > 0 &&
+            request_buf.cutn(&sub_cntl.request_attachment(), sub_request.row_size()) != sub_request.row_size()) {
+            response->set_code(::openmldb::base::kSQLRunError);
+            response->set_msg("fail to read the row of the sub query");
+            return;
+        }
+        butil::IOBuf sub_buf;
+        auto sub_response = response->add_responses();
+        ProcessQuery(&sub_cntl, &sub_request, sub_response, &sub_buf, FLAGS_scan_max_bytes_size);
+        if (sub_response->code() != ::openmldb::base::kOk) {
+            sub_response->set_byte_size(0);
+            continue;
+        }
+        buf.append(sub_buf);
+    }
+    response->set_code(::openmldb::base::kOk);
 }
 
 void TabletImpl::SQLBatchRequestQuery(RpcController* ctrl, const openmldb::api::SQLBatchRequestQueryRequest* request,
                                       openmldb::api::SQLBatchRequestQueryResponse* response, Closure* done) {
     DLOG(INFO) << "handle query batch request begin!";
     brpc::ClosureGuard done_guard(done);
+    if (workload_capture_.IsEnabled()) {
+        workload_capture_.Capture(::openmldb::api::CaptureEntry::kSQLBatchRequestQuery,
+                                  ::baidu::common::timer::get_micros(), *request,
+                                  static_cast<brpc::Controller*>(ctrl)->request_attachment());
+    }
+    QueryAdmissionGuard admission(&query_admission_, request->is_procedure(), request->db(), request->sp_name());
+    if (!admission.IsAdmitted()) {
+        response->set_code(::openmldb::base::kQueryOverloaded);
+        response->set_msg("the tablet is overloaded, the query is rejected");
+        return;
+    }
     brpc::Controller* cntl = static_cast<brpc::Controller*>(ctrl);
     butil::IOBuf& buf = cntl->response_attachment();
-    return ProcessBatchRequestQuery(ctrl, request, response, buf);
+    ProcessBatchRequestQuery(ctrl, request, response, buf);
+    if (response->code() == ::openmldb::base::kOk) {
+        response->set_attachment_compress_type(
+            codec::CompressAttachment(request->accept_compress_type(), FLAGS_attachment_compress_min_size, &buf));
+    }
 }
 void TabletImpl::ProcessBatchRequestQuery(RpcController* ctrl,
                                           const openmldb::api::SQLBatchRequestQueryRequest* request,
@@ -1671,13 +2408,14 @@ void TabletImpl::ProcessBatchRequestQuery(RpcController* ctrl,
         return;
     }
 
-    auto& io_buf = static_cast<brpc::Controller*>(ctrl)->request_attachment();
+    // the input rows reference the blocks of the attachment rather than copies
+    codec::RpcRowDecoder decoder(static_cast<brpc::Controller*>(ctrl)->request_attachment());
     size_t buf_offset = 0;
     std::vector<::hybridse::codec::Row> input_rows(input_row_num);
     if (has_common_and_uncommon_row) {
         size_t common_size = request->row_sizes().Get(0);
         ::hybridse::codec::Row common_row;
-        if (!codec::DecodeRpcRow(io_buf, buf_offset, common_size, request->common_slices(), &common_row)) {
+        if (!decoder.Decode(buf_offset, common_size, request->common_slices(), &common_row)) {
             response->set_msg("decode input common row failed");
             response->set_code(::openmldb::base::kSQLRunError);
             return;
@@ -1686,8 +2424,7 @@ void TabletImpl::ProcessBatchRequestQuery(RpcController* ctrl,
         for (size_t i = 0; i < input_row_num; ++i) {
             ::hybridse::codec::Row non_common_row;
             size_t non_common_size = request->row_sizes().Get(i + 1);
-            if (!codec::DecodeRpcRow(io_buf, buf_offset, non_common_size, request->non_common_slices(),
-                                     &non_common_row)) {
+            if (!decoder.Decode(buf_offset, non_common_size, request->non_common_slices(), &non_common_row)) {
                 response->set_msg("decode input non common row failed");
                 response->set_code(::openmldb::base::kSQLRunError);
                 return;
@@ -1698,8 +2435,7 @@ void TabletImpl::ProcessBatchRequestQuery(RpcController* ctrl,
     } else {
         for (size_t i = 0; i < input_row_num; ++i) {
             size_t non_common_size = request->row_sizes().Get(i);
-            if (!codec::DecodeRpcRow(io_buf, buf_offset, non_common_size, request->non_common_slices(),
-                                     &input_rows[i])) {
+            if (!decoder.Decode(buf_offset, non_common_size, request->non_common_slices(), &input_rows[i])) {
                 response->set_msg("decode input non common row failed");
                 response->set_code(::openmldb::base::kSQLRunError);
                 return;
@@ -2160,6 +2896,11 @@ void TabletImpl::GetTableStatus(RpcController* controller, const ::openmldb::api
             if (replicator) {
                 status->set_offset(replicator->GetOffset());
             }
+            std::shared_ptr<Snapshot> snapshot = GetSnapshotUnLock(table->GetId(), table->GetPid());
+            if (snapshot) {
+                status->set_recovered_record_cnt(snapshot->GetRecoveredCnt());
+                status->set_recover_expect_cnt(snapshot->GetRecoverExpectCnt());
+            }
             status->set_record_cnt(table->GetRecordCnt());
             if (MemTable* mem_table = dynamic_cast<MemTable*>(table.get())) {
                 status->set_is_expire(mem_table->GetExpireStatus());
@@ -2167,6 +2908,16 @@ void TabletImpl::GetTableStatus(RpcController* controller, const ::openmldb::api
                 status->set_record_idx_byte_size(mem_table->GetRecordIdxByteSize());
                 status->set_record_pk_cnt(mem_table->GetRecordPkCnt());
                 status->set_skiplist_height(mem_table->GetKeyEntryHeight());
+                status->set_gc_lag(mem_table->GetGcLag());
+                status->set_numa_node(mem_table->GetNumaNode());
+                if (request->need_mem_status()) {
+                    SetMemStatus(mem_table, status);
+                }
+                uint64_t pk_lookup_cnt = 0;
+                uint64_t pk_filtered_cnt = 0;
+                mem_table->GetPkFilterStat(&pk_lookup_cnt, &pk_filtered_cnt);
+                status->set_pk_lookup_cnt(pk_lookup_cnt);
+                status->set_pk_filtered_cnt(pk_filtered_cnt);
                 uint64_t record_idx_cnt = 0;
                 auto indexs = table->GetAllIndex();
                 for (const auto& index_def : indexs) {
@@ -2187,9 +2938,71 @@ void TabletImpl::GetTableStatus(RpcController* controller, const ::openmldb::api
             }
         }
     }
+    if (!request->has_tid() && !request->has_pid()) {
+        FilterChangedTableStatus(request, response);
+    }
+#ifdef TCMALLOC_ENABLE
+    if (request->need_mem_status()) {
+        MallocExtension* tcmalloc = MallocExtension::instance();
+        size_t allocated_byte_size = 0;
+        size_t heap_byte_size = 0;
+        tcmalloc->GetNumericProperty("generic.current_allocated_bytes", &allocated_byte_size);
+        tcmalloc->GetNumericProperty("generic.heap_size", &heap_byte_size);
+        response->set_allocated_byte_size(allocated_byte_size);
+        response->set_heap_byte_size(heap_byte_size);
+    }
+#endif
     response->set_code(::openmldb::base::ReturnCode::kOk);
 }
 
+void TabletImpl::SetMemStatus(MemTable* mem_table, ::openmldb::api::TableStatus* status) {
+    std::vector<std::pair<std::string, ::openmldb::storage::SegmentMemStat>> stats;
+    mem_table->GetIndexMemStat(&stats);
+    for (const auto& kv : stats) {
+        ::openmldb::api::IndexMemStatus* idx_mem_status = status->add_idx_mem_status();
+        idx_mem_status->set_idx_name(kv.first);
+        idx_mem_status->set_pk_node_byte_size(kv.second.pk_node_byte_size);
+        idx_mem_status->set_key_entry_byte_size(kv.second.key_entry_byte_size);
+        idx_mem_status->set_ts_node_byte_size(kv.second.ts_node_byte_size);
+        idx_mem_status->set_pk_index_byte_size(kv.second.pk_index_byte_size);
+        idx_mem_status->set_pk_filter_byte_size(kv.second.pk_filter_byte_size);
+    }
+    if (mem_table->GetDataBlockPool() != NULL) {
+        status->set_data_block_pool_byte_size(mem_table->GetDataBlockPool()->GetSlabByteSize());
+    }
+}
+
+void TabletImpl::FilterChangedTableStatus(const ::openmldb::api::GetTableStatusRequest* request,
+                                          ::openmldb::api::GetTableStatusResponse* response) {
+    bool is_incremental = request->has_status_version() && request->status_epoch() == table_status_epoch_;
+    std::map<uint64_t, std::pair<std::string, uint64_t>> status_cache;
+    ::google::protobuf::RepeatedPtrField<::openmldb::api::TableStatus> changed_status;
+    for (auto& status : *response->mutable_all_table_status()) {
+        uint64_t key = static_cast<uint64_t>(status.tid()) << 32 | status.pid();
+        std::string value;
+        status.SerializeToString(&value);
+        uint64_t version = 0;
+        auto it = table_status_cache_.find(key);
+        if (it != table_status_cache_.end() && it->second.first == value) {
+            version = it->second.second;
+        } else {
+            version = ++table_status_version_;
+        }
+        if (is_incremental && version <= request->status_version()) {
+            response->add_unchanged_partitions(key);
+        } else {
+            changed_status.Add()->Swap(&status);
+        }
+        status_cache.emplace(key, std::make_pair(std::move(value), version));
+    }
+    // the partitions dropped are not kept
+    table_status_cache_.swap(status_cache);
+    response->mutable_all_table_status()->Swap(&changed_status);
+    response->set_is_incremental(is_incremental);
+    response->set_status_version(table_status_version_);
+    response->set_status_epoch(table_status_epoch_);
+}
+
 void TabletImpl::SetExpire(RpcController* controller, const ::openmldb::api::SetExpireRequest* request,
                            ::openmldb::api::GeneralResponse* response, Closure* done) {
     brpc::ClosureGuard done_guard(done);
@@ -2337,6 +3150,73 @@ void TabletImpl::MakeSnapshot(RpcController* controller, const ::openmldb::api::
     SetTaskStatus(task_ptr, ::openmldb::api::TaskStatus::kFailed);
 }
 
+void TabletImpl::ExportTable(RpcController* controller, const ::openmldb::api::ExportTableRequest* request,
+                             ::openmldb::api::GeneralResponse* response, Closure* done) {
+    brpc::ClosureGuard done_guard(done);
+    std::shared_ptr<::openmldb::api::TaskInfo> task_ptr;
+    if (request->has_task_info() && request->task_info().IsInitialized()) {
+        if (AddOPTask(request->task_info(), ::openmldb::api::TaskType::kExportTable, task_ptr) < 0) {
+            response->set_code(-1);
+            response->set_msg("add task failed");
+            return;
+        }
+    }
+    uint32_t tid = request->tid();
+    uint32_t pid = request->pid();
+    do {
+        if (request->path().empty()) {
+            response->set_code(::openmldb::base::ReturnCode::kInvalidParameter);
+            response->set_msg("path is empty");
+            break;
+        }
+        std::shared_ptr<Table> table = GetTable(tid, pid);
+        if (!table) {
+            PDLOG(WARNING, "table is not exist. tid %u, pid %u", tid, pid);
+            response->set_code(::openmldb::base::ReturnCode::kTableIsNotExist);
+            response->set_msg("table is not exist");
+            break;
+        }
+        if (!std::dynamic_pointer_cast<MemTable>(table)) {
+            response->set_code(::openmldb::base::ReturnCode::kOperatorNotSupport);
+            response->set_msg("only memory table can be exported");
+            break;
+        }
+        if (table->GetTableStat() != ::openmldb::storage::kNormal) {
+            response->set_code(::openmldb::base::ReturnCode::kTableStatusIsNotKnormal);
+            response->set_msg("table status is not kNormal");
+            PDLOG(WARNING, "table state is %d, cannot export. tid %u, pid %u", table->GetTableStat(), tid, pid);
+            break;
+        }
+        if (!::openmldb::base::MkdirRecur(request->path())) {
+            response->set_code(::openmldb::base::ReturnCode::kWriteDataFailed);
+            response->set_msg("fail to create the export path");
+            break;
+        }
+        snapshot_pool_.AddTask(
+            boost::bind(&TabletImpl::ExportTableInternal, this, tid, pid, request->path(), task_ptr));
+        response->set_code(::openmldb::base::ReturnCode::kOk);
+        response->set_msg("ok");
+        return;
+    } while (0);
+    SetTaskStatus(task_ptr, ::openmldb::api::TaskStatus::kFailed);
+}
+
+void TabletImpl::ExportTableInternal(uint32_t tid, uint32_t pid, const std::string& path,
+                                     std::shared_ptr<::openmldb::api::TaskInfo> task) {
+    std::shared_ptr<Table> table = GetTable(tid, pid);
+    std::shared_ptr<Snapshot> snapshot = GetSnapshot(tid, pid);
+    auto memtable_snapshot = std::dynamic_pointer_cast<::openmldb::storage::MemTableSnapshot>(snapshot);
+    std::string file_path = path + "/" + std::to_string(tid) + "_" + std::to_string(pid) + ".csv";
+    uint64_t count = 0;
+    if (!table || !memtable_snapshot || memtable_snapshot->ExportToCsv(table, file_path, &count) < 0) {
+        PDLOG(WARNING, "fail to export table. tid %u, pid %u", tid, pid);
+        SetTaskStatus(task, ::openmldb::api::TaskStatus::kFailed);
+        return;
+    }
+    PDLOG(INFO, "export %lu rows to %s. tid %u, pid %u", count, file_path.c_str(), tid, pid);
+    SetTaskStatus(task, ::openmldb::api::TaskStatus::kDone);
+}
+
 void TabletImpl::SchedMakeSnapshot() {
     int now_hour = ::openmldb::base::GetNowHour();
     if (now_hour != FLAGS_make_snapshot_time) {
@@ -2456,12 +3336,12 @@ void TabletImpl::SendData(RpcController* controller, const ::openmldb::api::Send
         response->set_code(::openmldb::base::ReturnCode::kBlockIdMismatch);
         return;
     }
-    std::string data = cntl->request_attachment().to_string();
-    if (data.length() != request->block_size()) {
+    const butil::IOBuf& data = cntl->request_attachment();
+    if (data.size() != request->block_size()) {
         PDLOG(WARNING,
               "receive data error. tid %u, pid %u, file_name %s, expected "
               "length %u real length %u",
-              tid, pid, request->file_name().c_str(), request->block_size(), data.length());
+              tid, pid, request->file_name().c_str(), request->block_size(), data.size());
         response->set_code(::openmldb::base::ReturnCode::kReceiveDataError);
         response->set_msg("receive data error");
         return;
@@ -2578,7 +3458,8 @@ void TabletImpl::SendSnapshotInternal(const std::string& endpoint, uint32_t tid,
         }
         full_path.append("snapshot/");
         std::string manifest_file = full_path + "MANIFEST";
-        std::string snapshot_file;
+        // the snapshot and its deltas
+        std::vector<std::string> snapshot_files;
         {
             int fd = open(manifest_file.c_str(), O_RDONLY);
             if (fd < 0) {
@@ -2593,10 +3474,13 @@ void TabletImpl::SendSnapshotInternal(const std::string& endpoint, uint32_t tid,
                 PDLOG(WARNING, "parse manifest failed. tid[%u] pid[%u]", tid, pid);
                 break;
             }
-            snapshot_file = manifest.name();
+            snapshot_files.push_back(manifest.name());
+            for (const auto& delta : manifest.deltas()) {
+                snapshot_files.push_back(delta.name());
+            }
         }
-        // send snapshot file
-        if (sender.SendFile(snapshot_file, full_path + snapshot_file) < 0) {
+        // send snapshot files, the manifest is sent after them
+        if (sender.SendFiles(snapshot_files, "", full_path) < 0) {
             PDLOG(WARNING, "send snapshot failed. tid[%u] pid[%u]", tid, pid);
             break;
         }
@@ -2785,8 +3669,19 @@ void TabletImpl::LoadTable(RpcController* controller, const ::openmldb::api::Loa
         if (table_meta.seg_cnt() > 0) {
             seg_cnt = table_meta.seg_cnt();
         }
-        PDLOG(INFO, "start to recover table with id %u pid %u name %s seg_cnt %d ", tid, pid, name.c_str(), seg_cnt);
-        task_pool_.AddTask(boost::bind(&TabletImpl::LoadTableInternal, this, tid, pid, task_ptr));
+        uint64_t size = 0;
+        if (!::openmldb::base::GetDirSizeRecur(db_path, size)) {
+            PDLOG(WARNING, "get table size failed, load it at last. tid %u, pid %u", tid, pid);
+            size = UINT64_MAX;
+        }
+        bool follower = table_meta.mode() != ::openmldb::api::TableMode::kTableLeader;
+        PDLOG(INFO, "start to recover table with id %u pid %u name %s seg_cnt %d size %lu follower %d", tid, pid,
+              name.c_str(), seg_cnt, size, follower);
+        {
+            std::lock_guard<std::mutex> lock(load_mu_);
+            pending_loads_.push(PendingLoad{follower, size, pending_load_seq_++, tid, pid, task_ptr});
+        }
+        task_pool_.AddTask(boost::bind(&TabletImpl::LoadNextTable, this));
         response->set_code(::openmldb::base::ReturnCode::kOk);
         response->set_msg("ok");
         return;
@@ -2794,6 +3689,19 @@ void TabletImpl::LoadTable(RpcController* controller, const ::openmldb::api::Loa
     SetTaskStatus(task_ptr, ::openmldb::api::TaskStatus::kFailed);
 }
 
+void TabletImpl::LoadNextTable() {
+    PendingLoad load;
+    {
+        std::lock_guard<std::mutex> lock(load_mu_);
+        if (pending_loads_.empty()) {
+            return;
+        }
+        load = pending_loads_.top();
+        pending_loads_.pop();
+    }
+    LoadTableInternal(load.tid, load.pid, load.task_ptr);
+}
+
 int TabletImpl::LoadTableInternal(uint32_t tid, uint32_t pid, std::shared_ptr<::openmldb::api::TaskInfo> task_ptr) {
     do {
         // load snapshot data
@@ -2838,6 +3746,10 @@ int TabletImpl::LoadTableInternal(uint32_t tid, uint32_t pid, std::shared_ptr<::
                                boost::bind(&TabletImpl::SchedSyncDisk, this, tid, pid));
             task_pool_.DelayTask(FLAGS_binlog_delete_interval,
                                  boost::bind(&TabletImpl::SchedDelBinlog, this, tid, pid));
+            if (HasBinlogAggregation(*table->GetTableMeta())) {
+                task_pool_.DelayTask(FLAGS_binlog_aggregate_interval,
+                                     boost::bind(&TabletImpl::SchedAggregateBinlog, this, tid, pid));
+            }
             PDLOG(INFO, "load table success. tid %u pid %u", tid, pid);
             if (task_ptr) {
                 std::lock_guard<std::mutex> lock(mu_);
@@ -2881,6 +3793,14 @@ int32_t TabletImpl::DeleteTableInternal(uint32_t tid, uint32_t pid,
             tables_[tid].erase(pid);
             replicators_[tid].erase(pid);
             snapshots_[tid].erase(pid);
+            aggregators_[tid].erase(pid);
+            if (aggregators_[tid].empty()) {
+                aggregators_.erase(tid);
+            }
+            materializers_[tid].erase(pid);
+            if (materializers_[tid].empty()) {
+                materializers_.erase(tid);
+            }
             if (tables_[tid].empty()) {
                 tables_.erase(tid);
             }
@@ -2890,6 +3810,7 @@ int32_t TabletImpl::DeleteTableInternal(uint32_t tid, uint32_t pid,
             if (snapshots_[tid].empty()) {
                 snapshots_.erase(tid);
             }
+            PublishTableHandlesUnLock();
         }
         if (replicator) {
             replicator->DelAllReplicateNode();
@@ -3006,6 +3927,10 @@ void TabletImpl::CreateTable(RpcController* controller, const ::openmldb::api::C
     replicator->StartSyncing();
     io_pool_.DelayTask(FLAGS_binlog_sync_to_disk_interval, boost::bind(&TabletImpl::SchedSyncDisk, this, tid, pid));
     task_pool_.DelayTask(FLAGS_binlog_delete_interval, boost::bind(&TabletImpl::SchedDelBinlog, this, tid, pid));
+    if (HasBinlogAggregation(*table_meta)) {
+        task_pool_.DelayTask(FLAGS_binlog_aggregate_interval,
+                             boost::bind(&TabletImpl::SchedAggregateBinlog, this, tid, pid));
+    }
     PDLOG(INFO, "create table with id %u pid %u name %s", tid, pid, name.c_str());
     gc_pool_.DelayTask(FLAGS_gc_interval * 60 * 1000, boost::bind(&TabletImpl::GcTable, this, tid, pid, false));
     response->set_code(::openmldb::base::ReturnCode::kOk);
@@ -3030,6 +3955,30 @@ void TabletImpl::ExecuteGc(RpcController* controller, const ::openmldb::api::Exe
     PDLOG(INFO, "ExecuteGc. tid %u pid %u", tid, pid);
 }
 
+void TabletImpl::GetHotKeys(RpcController* controller, const ::openmldb::api::GetHotKeysRequest* request,
+                            ::openmldb::api::GetHotKeysResponse* response, Closure* done) {
+    brpc::ClosureGuard done_guard(done);
+    uint32_t tid = request->tid();
+    uint32_t pid = request->pid();
+    std::shared_ptr<Table> table = GetTable(tid, pid);
+    if (!table) {
+        DEBUGLOG("table is not exist. tid %u pid %u", tid, pid);
+        response->set_code(::openmldb::base::ReturnCode::kTableIsNotExist);
+        response->set_msg("table is not exist");
+        return;
+    }
+    MemTable* mem_table = dynamic_cast<MemTable*>(table.get());
+    if (mem_table == NULL) {
+        DEBUGLOG("table is not memtable. tid %u, pid %u", tid, pid);
+        response->set_code(::openmldb::base::ReturnCode::kTableTypeMismatch);
+        response->set_msg("table is not memtable");
+        return;
+    }
+    mem_table->GetHotKeys(request->limit(), response);
+    response->set_code(::openmldb::base::ReturnCode::kOk);
+    response->set_msg("ok");
+}
+
 void TabletImpl::GetTableFollower(RpcController* controller, const ::openmldb::api::GetTableFollowerRequest* request,
                                   ::openmldb::api::GetTableFollowerResponse* response, Closure* done) {
     brpc::ClosureGuard done_guard(done);
@@ -3058,6 +4007,8 @@ void TabletImpl::GetTableFollower(RpcController* controller, const ::openmldb::a
     response->set_offset(replicator->GetOffset());
     std::map<std::string, uint64_t> info_map;
     replicator->GetReplicateInfo(info_map);
+    std::map<std::string, uint64_t> lag_map;
+    replicator->GetReplicateLagBytes(lag_map);
     if (info_map.empty()) {
         response->set_msg("has no follower");
         response->set_code(::openmldb::base::ReturnCode::kNoFollower);
@@ -3066,6 +4017,10 @@ void TabletImpl::GetTableFollower(RpcController* controller, const ::openmldb::a
         ::openmldb::api::FollowerInfo* follower_info = response->add_follower_info();
         follower_info->set_endpoint(kv.first);
         follower_info->set_offset(kv.second);
+        auto iter = lag_map.find(kv.first);
+        if (iter != lag_map.end()) {
+            follower_info->set_lag_bytes(iter->second);
+        }
     }
     response->set_msg("ok");
     response->set_code(::openmldb::base::ReturnCode::kOk);
@@ -3389,13 +4344,6 @@ int TabletImpl::CreateTableInternal(const ::openmldb::api::TableMeta* table_meta
         msg.assign("table exists");
         return -1;
     }
-    Table* table_ptr = new MemTable(*table_meta);
-    table.reset(table_ptr);
-    if (!table->Init()) {
-        PDLOG(WARNING, "fail to init table. tid %u, pid %u", table_meta->tid(), table_meta->pid());
-        msg.assign("fail to init table");
-        return -1;
-    }
     std::string db_root_path;
     bool ok = ChooseDBRootPath(tid, pid, db_root_path);
     if (!ok) {
@@ -3405,6 +4353,18 @@ int TabletImpl::CreateTableInternal(const ::openmldb::api::TableMeta* table_meta
     }
     std::string table_db_path =
         db_root_path + "/" + std::to_string(table_meta->tid()) + "_" + std::to_string(table_meta->pid());
+    Table* table_ptr = NULL;
+    if (table_meta->storage_mode() == ::openmldb::type::StorageMode::kMemory) {
+        table_ptr = new MemTable(*table_meta);
+    } else {
+        table_ptr = new ::openmldb::storage::DiskTable(*table_meta, table_db_path + "/disk_data");
+    }
+    table.reset(table_ptr);
+    if (!table->Init()) {
+        PDLOG(WARNING, "fail to init table. tid %u, pid %u", table_meta->tid(), table_meta->pid());
+        msg.assign("fail to init table");
+        return -1;
+    }
     std::shared_ptr<LogReplicator> replicator;
     if (table->IsLeader()) {
         replicator =
@@ -3440,6 +4400,7 @@ int TabletImpl::CreateTableInternal(const ::openmldb::api::TableMeta* table_meta
     tables_[table_meta->tid()].insert(std::make_pair(table_meta->pid(), table));
     snapshots_[table_meta->tid()].insert(std::make_pair(table_meta->pid(), snapshot));
     replicators_[table_meta->tid()].insert(std::make_pair(table_meta->pid(), replicator));
+    PublishTableHandlesUnLock();
     if (!table_meta->db().empty()) {
         bool ok = catalog_->AddTable(*table_meta, table);
         engine_->ClearCacheLocked(table_meta->db());
@@ -3652,6 +4613,13 @@ void TabletImpl::GcTable(uint32_t tid, uint32_t pid, bool execute_once) {
     if (table) {
         int32_t gc_interval = FLAGS_gc_interval;
         table->SchedGc();
+        MemTable* mem_table = dynamic_cast<MemTable*>(table.get());
+        if (mem_table != NULL && mem_table->IsGcSweeping()) {
+            // continue the unfinished round of gc with the next slice, even if the gc is triggered once
+            gc_pool_.DelayTask(FLAGS_gc_slice_interval,
+                               boost::bind(&TabletImpl::GcTable, this, tid, pid, execute_once));
+            return;
+        }
         if (!execute_once) {
             gc_pool_.DelayTask(gc_interval * 60 * 1000, boost::bind(&TabletImpl::GcTable, this, tid, pid, false));
         }
@@ -3660,8 +4628,12 @@ void TabletImpl::GcTable(uint32_t tid, uint32_t pid, bool execute_once) {
 }
 
 std::shared_ptr<Snapshot> TabletImpl::GetSnapshot(uint32_t tid, uint32_t pid) {
-    std::lock_guard<SpinMutex> spin_lock(spin_mutex_);
-    return GetSnapshotUnLock(tid, pid);
+    auto handles = std::atomic_load_explicit(&table_handles_, std::memory_order_acquire);
+    auto it = handles->find(static_cast<uint64_t>(tid) << 32 | pid);
+    if (it == handles->end()) {
+        return std::shared_ptr<Snapshot>();
+    }
+    return it->second.snapshot;
 }
 
 std::shared_ptr<Snapshot> TabletImpl::GetSnapshotUnLock(uint32_t tid, uint32_t pid) {
@@ -3687,13 +4659,52 @@ std::shared_ptr<LogReplicator> TabletImpl::GetReplicatorUnLock(uint32_t tid, uin
 }
 
 std::shared_ptr<LogReplicator> TabletImpl::GetReplicator(uint32_t tid, uint32_t pid) {
-    std::lock_guard<SpinMutex> spin_lock(spin_mutex_);
-    return GetReplicatorUnLock(tid, pid);
+    auto handles = std::atomic_load_explicit(&table_handles_, std::memory_order_acquire);
+    auto it = handles->find(static_cast<uint64_t>(tid) << 32 | pid);
+    if (it == handles->end()) {
+        return std::shared_ptr<LogReplicator>();
+    }
+    return it->second.replicator;
 }
 
 std::shared_ptr<Table> TabletImpl::GetTable(uint32_t tid, uint32_t pid) {
-    std::lock_guard<SpinMutex> spin_lock(spin_mutex_);
-    return GetTableUnLock(tid, pid);
+    auto handles = std::atomic_load_explicit(&table_handles_, std::memory_order_acquire);
+    auto it = handles->find(static_cast<uint64_t>(tid) << 32 | pid);
+    if (it == handles->end()) {
+        return std::shared_ptr<Table>();
+    }
+    return it->second.table;
+}
+
+std::shared_ptr<TableMetrics> TabletImpl::GetTableMetrics(uint32_t tid, uint32_t pid) {
+    auto handles = std::atomic_load_explicit(&table_handles_, std::memory_order_acquire);
+    auto it = handles->find(static_cast<uint64_t>(tid) << 32 | pid);
+    if (it == handles->end()) {
+        return std::shared_ptr<TableMetrics>();
+    }
+    return it->second.metrics;
+}
+
+void TabletImpl::PublishTableHandlesUnLock() {
+    auto old_handles = std::atomic_load_explicit(&table_handles_, std::memory_order_acquire);
+    auto handles = std::make_shared<TableHandles>();
+    for (const auto& kv : tables_) {
+        for (const auto& pkv : kv.second) {
+            uint64_t key = static_cast<uint64_t>(kv.first) << 32 | pkv.first;
+            TableHandle& handle = (*handles)[key];
+            handle.table = pkv.second;
+            handle.replicator = GetReplicatorUnLock(kv.first, pkv.first);
+            handle.snapshot = GetSnapshotUnLock(kv.first, pkv.first);
+            auto it = old_handles->find(key);
+            if (it != old_handles->end()) {
+                handle.metrics = it->second.metrics;
+            } else {
+                handle.metrics = std::make_shared<TableMetrics>(kv.first, pkv.first);
+            }
+        }
+    }
+    std::atomic_store_explicit(&table_handles_, std::shared_ptr<const TableHandles>(handles),
+                               std::memory_order_release);
 }
 
 std::shared_ptr<Table> TabletImpl::GetTableUnLock(uint32_t tid, uint32_t pid) {
@@ -3710,17 +4721,48 @@ std::shared_ptr<Table> TabletImpl::GetTableUnLock(uint32_t tid, uint32_t pid) {
 void TabletImpl::ShowMemPool(RpcController* controller, const ::openmldb::api::HttpRequest* request,
                              ::openmldb::api::HttpResponse* response, Closure* done) {
     brpc::ClosureGuard done_guard(done);
-#ifdef TCMALLOC_ENABLE
     brpc::Controller* cntl = static_cast<brpc::Controller*>(controller);
+    cntl->response_attachment().append("<html><head><title>Mem Stat</title></head><body><pre>");
+#ifdef TCMALLOC_ENABLE
     MallocExtension* tcmalloc = MallocExtension::instance();
     std::string stat;
     stat.resize(1024);
     char* buffer = reinterpret_cast<char*>(&(stat[0]));
     tcmalloc->GetStats(buffer, 1024);
-    cntl->response_attachment().append("<html><head><title>Mem Stat</title></head><body><pre>");
     cntl->response_attachment().append(stat);
-    cntl->response_attachment().append("</pre></body></html>");
 #endif
+    std::vector<std::shared_ptr<Table>> tables;
+    {
+        std::lock_guard<SpinMutex> spin_lock(spin_mutex_);
+        for (auto it = tables_.begin(); it != tables_.end(); ++it) {
+            for (auto pit = it->second.begin(); pit != it->second.end(); ++pit) {
+                tables.push_back(pit->second);
+            }
+        }
+    }
+    for (const auto& table : tables) {
+        MemTable* mem_table = dynamic_cast<MemTable*>(table.get());
+        if (mem_table == NULL || mem_table->GetDataBlockPool() == NULL) {
+            continue;
+        }
+        std::vector<::openmldb::storage::DataBlockPoolStat> pool_stats;
+        mem_table->GetDataBlockPool()->GetStat(&pool_stats);
+        std::string table_stat = "\ndata block pool of table " + table->GetName() + " tid " +
+                                 std::to_string(table->GetId()) + " pid " + std::to_string(table->GetPid()) +
+                                 " slab bytes " +
+                                 std::to_string(mem_table->GetDataBlockPool()->GetSlabByteSize()) +
+                                 " huge page bytes " +
+                                 std::to_string(mem_table->GetDataBlockPool()->GetHugePageByteSize()) +
+                                 " hugetlb bytes " +
+                                 std::to_string(mem_table->GetDataBlockPool()->GetHugeTlbByteSize()) + "\n";
+        for (const auto& pool_stat : pool_stats) {
+            table_stat.append("cell size " + std::to_string(pool_stat.cell_size) + " slab cnt " +
+                              std::to_string(pool_stat.slab_cnt) + " used cell cnt " +
+                              std::to_string(pool_stat.used_cell_cnt) + "\n");
+        }
+        cntl->response_attachment().append(table_stat);
+    }
+    cntl->response_attachment().append("</pre></body></html>");
 }
 
 void TabletImpl::CheckZkClient() {
@@ -3838,6 +4880,7 @@ void TabletImpl::RefreshTableInfo() {
     auto old_db_sp_map = catalog_->GetProcedures();
     catalog_->Refresh(table_info_vec, version, db_sp_map);
     // skip exist procedure, don`t need recompile
+    std::vector<std::shared_ptr<hybridse::sdk::ProcedureInfo>> new_sp_infos;
     for (const auto& db_sp_map_kv : db_sp_map) {
         const auto& db = db_sp_map_kv.first;
         auto old_db_sp_map_it = old_db_sp_map.find(db);
@@ -3849,15 +4892,34 @@ void TabletImpl::RefreshTableInfo() {
                 if (old_sp_map_it != old_sp_map.end()) {
                     continue;
                 } else {
-                    CreateProcedure(sp_map_kv.second);
+                    new_sp_infos.push_back(sp_map_kv.second);
                 }
             }
         } else {
             for (const auto& sp_map_kv : db_sp_map_kv.second) {
-                CreateProcedure(sp_map_kv.second);
+                new_sp_infos.push_back(sp_map_kv.second);
             }
         }
     }
+    CreateProcedures(new_sp_infos);
+}
+
+void TabletImpl::CreateProcedures(const std::vector<std::shared_ptr<hybridse::sdk::ProcedureInfo>>& sp_infos) {
+    uint32_t thread_num = std::min(FLAGS_procedure_compile_thread_num, static_cast<uint32_t>(sp_infos.size()));
+    if (thread_num <= 1) {
+        for (const auto& sp_info : sp_infos) {
+            CreateProcedure(sp_info);
+        }
+        return;
+    }
+    void (TabletImpl::*create_procedure)(const std::shared_ptr<hybridse::sdk::ProcedureInfo>&) =
+        &TabletImpl::CreateProcedure;
+    ThreadPool pool(thread_num);
+    for (const auto& sp_info : sp_infos) {
+        pool.AddTask(boost::bind(create_procedure, this, sp_info));
+    }
+    // wait for all of the procedures compiled
+    pool.Stop(true);
 }
 
 int TabletImpl::CheckDimessionPut(const ::openmldb::api::PutRequest* request, uint32_t idx_cnt) {
@@ -3885,6 +4947,68 @@ void TabletImpl::SchedSyncDisk(uint32_t tid, uint32_t pid) {
     }
 }
 
+void TabletImpl::SchedAggregateBinlog(uint32_t tid, uint32_t pid) {
+    std::shared_ptr<Table> table = GetTable(tid, pid);
+    std::shared_ptr<LogReplicator> replicator = GetReplicator(tid, pid);
+    if (!table || !replicator) {
+        // the table is dropped
+        return;
+    }
+    std::vector<std::shared_ptr<BinlogAggregator>> aggregators;
+    {
+        std::lock_guard<SpinMutex> spin_lock(spin_mutex_);
+        auto it = aggregators_.find(tid);
+        if (it != aggregators_.end() && it->second.find(pid) != it->second.end()) {
+            aggregators = it->second[pid];
+        }
+    }
+    auto table_meta = table->GetTableMeta();
+    if (aggregators.empty() && table->IsLeader()) {
+        bool all_loaded = true;
+        for (const auto& desc : table_meta->pre_aggregations()) {
+            if (!desc.has_aggr_tid()) {
+                continue;
+            }
+            std::shared_ptr<Table> aggr_table = GetTable(desc.aggr_tid(), pid);
+            std::shared_ptr<LogReplicator> aggr_replicator = GetReplicator(desc.aggr_tid(), pid);
+            if (!aggr_table || !aggr_replicator || aggr_table->GetTableStat() != ::openmldb::storage::kNormal) {
+                DEBUGLOG("aggr table tid %u pid %u is not loaded", desc.aggr_tid(), pid);
+                all_loaded = false;
+                break;
+            }
+            auto aggregator = std::make_shared<BinlogAggregator>(desc, table, replicator, aggr_table, aggr_replicator);
+            if (!aggregator->Init()) {
+                PDLOG(WARNING, "fail to init aggregator with aggr table tid %u. tid %u pid %u", desc.aggr_tid(), tid,
+                      pid);
+                all_loaded = false;
+                break;
+            }
+            aggregators.push_back(aggregator);
+        }
+        if (all_loaded) {
+            std::lock_guard<SpinMutex> spin_lock(spin_mutex_);
+            aggregators_[tid][pid] = aggregators;
+        } else {
+            aggregators.clear();
+        }
+    }
+    int min_log_part_index = -1;
+    for (const auto& aggregator : aggregators) {
+        if (!aggregator->Sync(FLAGS_binlog_aggregate_max_cnt)) {
+            PDLOG(WARNING, "fail to aggregate binlog into aggr table tid %u. tid %u pid %u", aggregator->GetAggrTid(),
+                  tid, pid);
+        }
+        int log_part_index = aggregator->GetLogPartIndex();
+        if (log_part_index >= 0 && (min_log_part_index < 0 || log_part_index < min_log_part_index)) {
+            min_log_part_index = log_part_index;
+        }
+    }
+    // keep the binlog not aggregated yet
+    replicator->SetConsumerLogPartIndex(min_log_part_index);
+    task_pool_.DelayTask(FLAGS_binlog_aggregate_interval,
+                         boost::bind(&TabletImpl::SchedAggregateBinlog, this, tid, pid));
+}
+
 void TabletImpl::SchedDelBinlog(uint32_t tid, uint32_t pid) {
     std::shared_ptr<LogReplicator> replicator = GetReplicator(tid, pid);
     if (replicator) {
@@ -3940,9 +5064,72 @@ void TabletImpl::DelRecycle(const std::string& path) {
         }
         if (FLAGS_recycle_ttl != 0 && (now_time - recycle_time) > FLAGS_recycle_ttl * 60) {
             PDLOG(INFO, "delete recycle dir %s", file_path.c_str());
-            ::openmldb::base::RemoveDirRecursive(file_path);
+            ::openmldb::base::RemoveDirRecursive(
+                file_path, ::openmldb::base::GetDiskRateLimiter(file_path, FLAGS_background_disk_io_limit));
+        }
+    }
+}
+
+void TabletImpl::SchedCheckMemory() {
+    uint64_t max_memory = static_cast<uint64_t>(FLAGS_max_memory_mb) * 1024 * 1024;
+    uint64_t max_table_memory = static_cast<uint64_t>(FLAGS_max_table_memory_mb) * 1024 * 1024;
+    uint64_t total = 0;
+    auto exceeded_tables = std::make_shared<std::set<uint64_t>>();
+    std::set<uint64_t> soft_tables;
+    auto handles = std::atomic_load_explicit(&table_handles_, std::memory_order_acquire);
+    for (const auto& kv : *handles) {
+        MemTable* mem_table = dynamic_cast<MemTable*>(kv.second.table.get());
+        if (mem_table == NULL) {
+            continue;
         }
+        uint64_t used = mem_table->GetMemoryUsage();
+        total += used;
+        if (max_table_memory == 0) {
+            continue;
+        }
+        if (used >= max_table_memory) {
+            exceeded_tables->insert(kv.first);
+        }
+        if (used >= max_table_memory * FLAGS_soft_memory_limit_ratio) {
+            soft_tables.insert(kv.first);
+        }
+    }
+    memory_used_.store(total, std::memory_order_relaxed);
+    bool exceeded = max_memory > 0 && total >= max_memory;
+    if (exceeded != memory_exceeded_.load(std::memory_order_relaxed)) {
+        PDLOG(WARNING, "the memory used %lu bytes %s the limit %lu bytes", total, exceeded ? "reaches" : "is below",
+              max_memory);
+    }
+    memory_exceeded_.store(exceeded, std::memory_order_relaxed);
+    std::atomic_store_explicit(&memory_exceeded_tables_, std::shared_ptr<const std::set<uint64_t>>(exceeded_tables),
+                               std::memory_order_release);
+    // make a gc once the soft limit is reached, rather than waiting for the next gc interval
+    bool soft_exceeded = max_memory > 0 && total >= max_memory * FLAGS_soft_memory_limit_ratio;
+    for (const auto& kv : *handles) {
+        if ((soft_exceeded && !memory_soft_exceeded_) ||
+            (soft_tables.count(kv.first) > 0 && memory_soft_tables_.count(kv.first) == 0)) {
+            uint32_t tid = kv.first >> 32;
+            uint32_t pid = kv.first & UINT32_MAX;
+            PDLOG(INFO, "make a gc as the soft memory limit is reached. tid %u, pid %u", tid, pid);
+            gc_pool_.AddTask(boost::bind(&TabletImpl::GcTable, this, tid, pid, true));
+        }
+    }
+    memory_soft_exceeded_ = soft_exceeded;
+    memory_soft_tables_.swap(soft_tables);
+    task_pool_.DelayTask(FLAGS_memory_check_interval, boost::bind(&TabletImpl::SchedCheckMemory, this));
+}
+
+::openmldb::base::ReturnCode TabletImpl::CheckMemoryLimit(uint32_t tid, uint32_t pid, std::string* msg) {
+    if (memory_exceeded_.load(std::memory_order_relaxed)) {
+        msg->assign("the memory of the tablet reaches the limit");
+        return ::openmldb::base::ReturnCode::kExceedMemoryLimit;
     }
+    auto exceeded_tables = std::atomic_load_explicit(&memory_exceeded_tables_, std::memory_order_acquire);
+    if (!exceeded_tables->empty() && exceeded_tables->count(static_cast<uint64_t>(tid) << 32 | pid) > 0) {
+        msg->assign("the memory of the table reaches the limit");
+        return ::openmldb::base::ReturnCode::kExceedMemoryLimit;
+    }
+    return ::openmldb::base::ReturnCode::kOk;
 }
 
 void TabletImpl::SchedDelRecycle() {
@@ -3952,6 +5139,14 @@ void TabletImpl::SchedDelRecycle() {
     task_pool_.DelayTask(FLAGS_recycle_ttl * 60 * 1000, boost::bind(&TabletImpl::SchedDelRecycle, this));
 }
 
+void TabletImpl::SchedExpireTraverseCursor() {
+    uint32_t cnt = traverse_cursors_.Expire();
+    if (cnt > 0) {
+        PDLOG(INFO, "release %u expired traverse cursors", cnt);
+    }
+    task_pool_.DelayTask(FLAGS_traverse_cursor_ttl, boost::bind(&TabletImpl::SchedExpireTraverseCursor, this));
+}
+
 bool TabletImpl::CreateMultiDir(const std::vector<std::string>& dirs) {
     std::vector<std::string>::const_iterator it = dirs.begin();
     for (; it != dirs.end(); ++it) {
@@ -4279,6 +5474,7 @@ void TabletImpl::DumpIndexDataInternal(std::shared_ptr<::openmldb::storage::Tabl
             return;
         }
         ::openmldb::log::WriteHandle* wh = new ::openmldb::log::WriteHandle("off", index_file_name, fd);
+        wh->SetRateLimiter(::openmldb::base::GetDiskRateLimiter(index_path, FLAGS_background_disk_io_limit));
         whs.push_back(wh);
     }
     if (memtable_snapshot->DumpIndexData(table, column_key, idx, whs)) {
@@ -4412,7 +5608,7 @@ void TabletImpl::LoadIndexDataInternal(uint32_t tid, uint32_t pid, uint32_t cur_
         ::openmldb::api::LogEntry entry;
         entry.ParseFromString(std::string(record.data(), record.size()));
         if (entry.has_method_type() && entry.method_type() == ::openmldb::api::MethodType::kDelete) {
-            table->Delete(entry.dimensions(0).key(), entry.dimensions(0).idx());
+            table->Delete(entry);
         } else {
             table->Put(entry);
         }
@@ -4714,12 +5910,73 @@ void TabletImpl::DropProcedure(RpcController* controller, const ::openmldb::api:
     PDLOG(INFO, "drop procedure success. db_name[%s] sp_name[%s]", db_name.c_str(), sp_name.c_str());
 }
 
+void TabletImpl::ProfileProcedure(RpcController* controller, const ::openmldb::api::ProfileProcedureRequest* request,
+                                  ::openmldb::api::ProfileProcedureResponse* response, Closure* done) {
+    brpc::ClosureGuard done_guard(done);
+    const std::string& db_name = request->db_name();
+    const std::string& sp_name = request->sp_name();
+    hybridse::base::Status status;
+    auto request_info = sp_cache_->GetRequestInfo(db_name, sp_name, status);
+    if (!status.isOK() || !request_info) {
+        response->set_code(::openmldb::base::ReturnCode::kProcedureNotFound);
+        response->set_msg(status.msg);
+        return;
+    }
+    std::ostringstream request_stats;
+    std::ostringstream fn_symbols;
+    request_info->DumpRunnerStats(request_stats);
+    request_info->DumpFnSymbols(fn_symbols);
+    auto batch_request_info = sp_cache_->GetBatchRequestInfo(db_name, sp_name, status);
+    if (status.isOK() && batch_request_info) {
+        std::ostringstream batch_request_stats;
+        batch_request_info->DumpRunnerStats(batch_request_stats);
+        batch_request_info->DumpFnSymbols(fn_symbols);
+        response->set_batch_request_stats(batch_request_stats.str());
+    }
+    if (request->reset()) {
+        request_info->ResetRunnerStats();
+        if (batch_request_info) {
+            batch_request_info->ResetRunnerStats();
+        }
+    }
+    response->set_request_stats(request_stats.str());
+    response->set_fn_symbols(fn_symbols.str());
+    response->set_code(::openmldb::base::ReturnCode::kOk);
+    response->set_msg(FLAGS_enable_procedure_profile ? "ok"
+                                                     : "ok, the runs are not recorded as enable_procedure_profile is off");
+}
+
+bool TabletImpl::IsQueryTraceSampled(const openmldb::api::QueryRequest& request) {
+    if (!request.is_procedure() || FLAGS_query_trace_sample_interval == 0) {
+        return false;
+    }
+    return query_trace_cnt_.fetch_add(1, std::memory_order_relaxed) % FLAGS_query_trace_sample_interval == 0;
+}
+
+void TabletImpl::RecordQueryTrace(const openmldb::api::QueryRequest& request,
+                                  const openmldb::api::QueryResponse& response) {
+    if (response.code() != ::openmldb::base::kOk) {
+        return;
+    }
+    std::string prefix = "deployment_" + request.db() + "_" + request.sp_name();
+    std::lock_guard<std::mutex> lock(query_trace_mu_);
+    for (const auto& trace : response.traces()) {
+        std::string name = trace.has_id() ? trace.stage() + "_" + std::to_string(trace.id()) : trace.stage();
+        auto& recorder = query_trace_recorders_[prefix + "|" + name];
+        if (!recorder) {
+            recorder = std::make_shared<bvar::LatencyRecorder>(prefix, name);
+        }
+        *recorder << trace.time_us();
+    }
+}
+
 void TabletImpl::RunRequestQuery(RpcController* ctrl, const openmldb::api::QueryRequest& request,
                                  ::hybridse::vm::RequestRunSession& session, openmldb::api::QueryResponse& response,
                                  butil::IOBuf& buf) {
     if (request.is_debug()) {
         session.EnableDebug();
     }
+    uint64_t start_us = session.IsTrace() ? ::baidu::common::timer::get_micros() : 0;
     ::hybridse::codec::Row row;
     auto& request_buf = dynamic_cast<brpc::Controller*>(ctrl)->request_attachment();
     size_t input_slices = request.row_slices();
@@ -4728,14 +5985,36 @@ void TabletImpl::RunRequestQuery(RpcController* ctrl, const openmldb::api::Query
         response.set_msg("fail to decode input row");
         return;
     }
+    AddStageTrace("decode", -1, start_us, session, &response);
     ::hybridse::codec::Row output;
     int32_t ret = 0;
-    if (request.has_task_id()) {
-        ret = session.Run(request.task_id(), row, &output);
-    } else {
-        ret = session.Run(row, &output);
-    }
-    if (ret != 0) {
+    {
+        // the sub queries of the run are sent when the first of them is read
+        std::unique_ptr<::openmldb::catalog::SubQueryBatchScope> batch_scope;
+        if (FLAGS_enable_sub_query_batch) {
+            batch_scope.reset(new ::openmldb::catalog::SubQueryBatchScope());
+        }
+        if (request.has_task_id()) {
+            ret = session.Run(request.task_id(), row, &output);
+        } else {
+            ret = session.Run(row, &output);
+        }
+    }
+    // the runners read the rows of their producers lazily, so the time of a runner may include
+    // the seeks of the iterators of the ones below it
+    for (const auto& trace : session.GetTraces()) {
+        auto runner_trace = response.add_traces();
+        runner_trace->set_stage(trace.name);
+        runner_trace->set_id(trace.id);
+        runner_trace->set_time_us(trace.time_us);
+    }
+    AddStageTrace("run", -1, start_us, session, &response);
+    if (ret == ::hybridse::vm::RunSession::kRunDeadlineExceeded) {
+        g_query_deadline_exceeded << 1;
+        response.set_code(::openmldb::base::kQueryDeadlineExceeded);
+        response.set_msg("the query is stopped by its deadline");
+        return;
+    } else if (ret != 0) {
         response.set_code(::openmldb::base::kSQLRunError);
         response.set_msg("fail to run sql");
         return;
@@ -4750,6 +6029,7 @@ void TabletImpl::RunRequestQuery(RpcController* ctrl, const openmldb::api::Query
         response.set_msg("fail to encode sql output row");
         return;
     }
+    AddStageTrace("encode", -1, start_us, session, &response);
     if (!request.has_task_id()) {
         response.set_schema(session.GetEncodedSchema());
     }
@@ -4759,6 +6039,54 @@ void TabletImpl::RunRequestQuery(RpcController* ctrl, const openmldb::api::Query
     response.set_code(::openmldb::base::kOk);
 }
 
+::hybridse::base::Status TabletImpl::CallProcedureLocal(const std::string& db, const std::string& sp_name,
+                                                    const ::hybridse::codec::Row& row, uint64_t timeout_ms,
+                                                    ::hybridse::codec::Row* output) {
+    ::hybridse::base::Status status;
+    auto compile_info = sp_cache_->GetRequestInfo(db, sp_name, status);
+    if (!status.isOK()) {
+        return status;
+    }
+    ::hybridse::vm::RequestRunSession session;
+    session.SetCompileInfo(compile_info);
+    session.SetSpName(sp_name);
+    if (timeout_ms > 0) {
+        session.SetDeadline(::baidu::common::timer::get_micros() + timeout_ms * 1000);
+    }
+    int32_t ret = 0;
+    {
+        std::unique_ptr<::openmldb::catalog::SubQueryBatchScope> batch_scope;
+        if (FLAGS_enable_sub_query_batch) {
+            batch_scope.reset(new ::openmldb::catalog::SubQueryBatchScope());
+        }
+        ret = session.Run(row, output);
+    }
+    if (ret == ::hybridse::vm::RunSession::kRunDeadlineExceeded) {
+        g_query_deadline_exceeded << 1;
+        return ::hybridse::base::Status(::hybridse::common::kTimeoutError, "the query is stopped by its deadline");
+    } else if (ret != 0) {
+        return ::hybridse::base::Status(::hybridse::common::kRunError, "fail to run procedure " + sp_name);
+    }
+    return ::hybridse::base::Status::OK();
+}
+
+::hybridse::base::Status TabletImpl::GetProcedureSchema(const std::string& db, const std::string& sp_name,
+                                                    ::hybridse::codec::Schema* request_schema,
+                                                    ::hybridse::codec::Schema* output_schema) {
+    ::hybridse::base::Status status;
+    auto compile_info = sp_cache_->GetRequestInfo(db, sp_name, status);
+    if (!status.isOK()) {
+        return status;
+    }
+    if (request_schema != nullptr) {
+        request_schema->CopyFrom(compile_info->GetRequestSchema());
+    }
+    if (output_schema != nullptr) {
+        output_schema->CopyFrom(compile_info->GetSchema());
+    }
+    return ::hybridse::base::Status::OK();
+}
+
 void TabletImpl::CreateProcedure(const std::shared_ptr<hybridse::sdk::ProcedureInfo>& sp_info) {
     const std::string& db_name = sp_info->GetDbName();
     const std::string& sp_name = sp_info->GetSpName();
@@ -18,35 +18,51 @@
 #define SRC_TABLET_TABLET_IMPL_H_
 
 #include <brpc/server.h>
+#include <bvar/latency_recorder.h>
+#include <bvar/passive_status.h>
 
+#include <atomic>
 #include <list>
 #include <map>
 #include <memory>
 #include <mutex>  // NOLINT
+#include <queue>
 #include <set>
 #include <string>
+#include <tuple>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
+#include "base/priority_executor.h"
 #include "base/set.h"
 #include "base/spinlock.h"
+#include "base/status.h"
 #include "catalog/schema_adapter.h"
 #include "catalog/tablet_catalog.h"
 #include "common/thread_pool.h"
 #include "proto/tablet.pb.h"
+#include "replica/binlog_aggregator.h"
 #include "replica/log_replicator.h"
 #include "storage/mem_table.h"
 #include "storage/mem_table_snapshot.h"
+#include "tablet/attachment_writer.h"
 #include "tablet/bulk_load_mgr.h"
 #include "tablet/combine_iterator.h"
+#include "tablet/deployment_materializer.h"
 #include "tablet/file_receiver.h"
+#include "tablet/query_admission.h"
+#include "tablet/traverse_cursor.h"
+#include "tablet/workload_capture.h"
 #include "vm/engine.h"
 #include "zk/zk_client.h"
 
 using ::baidu::common::ThreadPool;
 using ::google::protobuf::Closure;
 using ::google::protobuf::RpcController;
+using ::openmldb::base::PriorityExecutor;
 using ::openmldb::base::SpinMutex;
+using ::openmldb::replica::BinlogAggregator;
 using ::openmldb::replica::LogReplicator;
 using ::openmldb::replica::ReplicatorRole;
 using ::openmldb::storage::IndexDef;
@@ -64,6 +80,52 @@ namespace tablet {
 typedef std::map<uint32_t, std::map<uint32_t, std::shared_ptr<Table>>> Tables;
 typedef std::map<uint32_t, std::map<uint32_t, std::shared_ptr<LogReplicator>>> Replicators;
 typedef std::map<uint32_t, std::map<uint32_t, std::shared_ptr<Snapshot>>> Snapshots;
+typedef std::map<uint32_t, std::map<uint32_t, std::vector<std::shared_ptr<BinlogAggregator>>>> Aggregators;
+typedef std::map<uint32_t, std::map<uint32_t, std::vector<std::shared_ptr<DeploymentMaterializer>>>> Materializers;
+
+// the latency of the requests to a partition, exported as the bvars table_<tid>_<pid>_<put|get|scan>
+struct TableMetrics {
+    TableMetrics(uint32_t tid, uint32_t pid)
+        : put("table_" + std::to_string(tid) + "_" + std::to_string(pid), "put"),
+          get("table_" + std::to_string(tid) + "_" + std::to_string(pid), "get"),
+          scan("table_" + std::to_string(tid) + "_" + std::to_string(pid), "scan") {}
+    bvar::LatencyRecorder put;
+    bvar::LatencyRecorder get;
+    bvar::LatencyRecorder scan;
+};
+
+// the tasks of a class of the background executor, exported as the bvars background_<class>_<pending|running>
+struct BackgroundMetrics {
+    BackgroundMetrics(PriorityExecutor* executor, PriorityExecutor::Class cls)
+        : executor(executor),
+          cls(cls),
+          pending(std::string("background_") + PriorityExecutor::GetClassName(cls) + "_pending", GetPending, this),
+          running(std::string("background_") + PriorityExecutor::GetClassName(cls) + "_running", GetRunning,
+                  this) {}
+    static uint64_t GetPending(void* arg) {
+        auto* metrics = reinterpret_cast<BackgroundMetrics*>(arg);
+        return metrics->executor->GetPendingCnt(metrics->cls);
+    }
+    static uint64_t GetRunning(void* arg) {
+        auto* metrics = reinterpret_cast<BackgroundMetrics*>(arg);
+        return metrics->executor->GetRunningCnt(metrics->cls);
+    }
+    PriorityExecutor* executor;
+    PriorityExecutor::Class cls;
+    bvar::PassiveStatus<uint64_t> pending;
+    bvar::PassiveStatus<uint64_t> running;
+};
+
+// the handles of a partition looked up by the requests
+struct TableHandle {
+    std::shared_ptr<Table> table;
+    std::shared_ptr<LogReplicator> replicator;
+    std::shared_ptr<Snapshot> snapshot;
+    // kept while the partition is on the tablet
+    std::shared_ptr<TableMetrics> metrics;
+};
+// keyed by tid << 32 | pid
+typedef std::unordered_map<uint64_t, TableHandle> TableHandles;
 
 // tablet cache entry for sql procedure
 struct SQLProcedureCacheEntry {
@@ -166,9 +228,15 @@ class TabletImpl : public ::openmldb::api::TabletServer {
     void Put(RpcController* controller, const ::openmldb::api::PutRequest* request,
              ::openmldb::api::PutResponse* response, Closure* done);
 
+    void PutBatch(RpcController* controller, const ::openmldb::api::PutBatchRequest* request,
+                  ::openmldb::api::PutBatchResponse* response, Closure* done);
+
     void Get(RpcController* controller, const ::openmldb::api::GetRequest* request,
              ::openmldb::api::GetResponse* response, Closure* done);
 
+    void BatchGet(RpcController* controller, const ::openmldb::api::BatchGetRequest* request,
+                  ::openmldb::api::BatchGetResponse* response, Closure* done);
+
     void Scan(RpcController* controller, const ::openmldb::api::ScanRequest* request,
               ::openmldb::api::ScanResponse* response, Closure* done);
 
@@ -245,6 +313,9 @@ class TabletImpl : public ::openmldb::api::TabletServer {
     void ExecuteGc(RpcController* controller, const ::openmldb::api::ExecuteGcRequest* request,
                    ::openmldb::api::GeneralResponse* response, Closure* done);
 
+    void GetHotKeys(RpcController* controller, const ::openmldb::api::GetHotKeysRequest* request,
+                    ::openmldb::api::GetHotKeysResponse* response, Closure* done);
+
     void ShowMemPool(RpcController* controller, const ::openmldb::api::HttpRequest* request,
                      ::openmldb::api::HttpResponse* response, Closure* done);
 
@@ -302,6 +373,9 @@ class TabletImpl : public ::openmldb::api::TabletServer {
     void SubQuery(RpcController* controller, const openmldb::api::QueryRequest* request,
                   openmldb::api::QueryResponse* response, Closure* done);
 
+    void SubQueryBatch(RpcController* controller, const openmldb::api::SubQueryBatchRequest* request,
+                       openmldb::api::SubQueryBatchResponse* response, Closure* done);
+
     void SQLBatchRequestQuery(RpcController* controller, const openmldb::api::SQLBatchRequestQueryRequest* request,
                               openmldb::api::SQLBatchRequestQueryResponse* response, Closure* done);
     void SubBatchRequestQuery(RpcController* controller, const openmldb::api::SQLBatchRequestQueryRequest* request,
@@ -314,19 +388,39 @@ class TabletImpl : public ::openmldb::api::TabletServer {
 
     inline void SetServer(brpc::Server* server) { server_ = server; }
 
-    // get on value from specified ttl type index
+    // put a row to the table, the msg is set if it fails
+    ::openmldb::base::ReturnCode PutRow(const std::shared_ptr<Table>& table, const ::openmldb::api::PutRequest& request,
+                                        std::string* msg);
+
+    void AppendPutEntry(const std::shared_ptr<LogReplicator>& replicator, const ::openmldb::api::PutRequest& request);
+
+    // the materialized deployments of the table, they are built on the first put after the derived tables are
+    // loaded and the deployments are compiled
+    std::vector<std::shared_ptr<DeploymentMaterializer>> GetMaterializers(const std::shared_ptr<Table>& table);
+
+    // put the row checked by Put, write the binlog and run the done
+    void PutInternal(const std::shared_ptr<Table>& table, const ::openmldb::api::PutRequest* request,
+                     ::openmldb::api::PutResponse* response, Closure* done, uint64_t start_time);
+
+    // get on value from specified ttl type index, the projection is compiled for this call
     int32_t GetIndex(const ::openmldb::api::GetRequest* request, const ::openmldb::api::TableMeta& meta,
                      const std::map<int32_t, std::shared_ptr<Schema>>& vers_schema, CombineIterator* combine_it,
                      std::string* value, uint64_t* ts);
 
+    // project_plan is the cached plan of the projection of the request, it is ignored without projection
+    int32_t GetIndex(const ::openmldb::api::GetRequest* request, const ::openmldb::api::TableMeta& meta,
+                     const std::shared_ptr<const ::openmldb::codec::RowProjectPlan>& project_plan,
+                     CombineIterator* combine_it, std::string* value, uint64_t* ts);
+
     // scan specified ttl type index
     int32_t ScanIndex(const ::openmldb::api::ScanRequest* request, const ::openmldb::api::TableMeta& meta,
-                      const std::map<int32_t, std::shared_ptr<Schema>>& vers_schema, CombineIterator* combine_it,
-                      std::string* pairs, uint32_t* count);
+                      const std::shared_ptr<const ::openmldb::codec::RowProjectPlan>& project_plan,
+                      CombineIterator* combine_it, std::string* pairs, uint32_t* count);
 
+    // the rows pinned by the iterators of combine_it are appended to the attachment by reference
     int32_t ScanIndex(const ::openmldb::api::ScanRequest* request, const ::openmldb::api::TableMeta& meta,
-                      const std::map<int32_t, std::shared_ptr<Schema>>& vers_schema, CombineIterator* combine_it,
-                      butil::IOBuf* buf, uint32_t* count);
+                      const std::shared_ptr<const ::openmldb::codec::RowProjectPlan>& project_plan,
+                      CombineIterator* combine_it, AttachmentWriter* writer, uint32_t* count);
 
     int32_t CountIndex(uint64_t expire_time, uint64_t expire_cnt, ::openmldb::storage::TTLType ttl_type,
                        ::openmldb::storage::TableIterator* it, const ::openmldb::api::CountRequest* request,
@@ -340,6 +434,14 @@ class TabletImpl : public ::openmldb::api::TabletServer {
     void DropProcedure(RpcController* controller, const ::openmldb::api::DropProcedureRequest* request,
                        ::openmldb::api::GeneralResponse* response, Closure* done);
 
+    // the plan node runs and jit functions of a procedure, the runs are recorded with enable_procedure_profile
+    void ProfileProcedure(RpcController* controller, const ::openmldb::api::ProfileProcedureRequest* request,
+                          ::openmldb::api::ProfileProcedureResponse* response, Closure* done);
+
+    // export the rows of a partition to a csv file in the snapshot pool, which can be loaded by the importer
+    void ExportTable(RpcController* controller, const ::openmldb::api::ExportTableRequest* request,
+                     ::openmldb::api::GeneralResponse* response, Closure* done);
+
     void GetBulkLoadInfo(RpcController* controller, const ::openmldb::api::BulkLoadInfoRequest* request,
                          ::openmldb::api::BulkLoadInfoResponse* response, Closure* done);
 
@@ -359,6 +461,19 @@ class TabletImpl : public ::openmldb::api::TabletServer {
 
     std::shared_ptr<Snapshot> GetSnapshotUnLock(uint32_t tid, uint32_t pid);
 
+    std::shared_ptr<TableMetrics> GetTableMetrics(uint32_t tid, uint32_t pid);
+
+    // the handles read by GetTable, GetReplicator and GetSnapshot without the lock, which are copied
+    // and published again when the partitions change. spin_mutex_ should be held
+    void PublishTableHandlesUnLock();
+
+    // keep the version of the status of every partition, and only leave the status changed after the version of
+    // the request in the response. spin_mutex_ should be held
+    void FilterChangedTableStatus(const ::openmldb::api::GetTableStatusRequest* request,
+                                  ::openmldb::api::GetTableStatusResponse* response);
+    // set the bytes of the parts of every index and the data block pool of the table
+    void SetMemStatus(MemTable* mem_table, ::openmldb::api::TableStatus* status);
+
     void GcTable(uint32_t tid, uint32_t pid, bool execute_once);
 
     void GcTableSnapshot(uint32_t tid, uint32_t pid);
@@ -372,6 +487,9 @@ class TabletImpl : public ::openmldb::api::TabletServer {
     void MakeSnapshotInternal(uint32_t tid, uint32_t pid, uint64_t end_offset,
                               std::shared_ptr<::openmldb::api::TaskInfo> task);
 
+    void ExportTableInternal(uint32_t tid, uint32_t pid, const std::string& path,
+                             std::shared_ptr<::openmldb::api::TaskInfo> task);
+
     void SendSnapshotInternal(const std::string& endpoint, uint32_t tid, uint32_t pid, uint32_t remote_tid,
                               std::shared_ptr<::openmldb::api::TaskInfo> task);
 
@@ -395,8 +513,19 @@ class TabletImpl : public ::openmldb::api::TabletServer {
 
     void SchedMakeSnapshot();
 
+    // aggregate the binlog of the table into its pre-aggregation tables, the aggregators
+    // are created once the pre-aggregation tables are loaded
+    void SchedAggregateBinlog(uint32_t tid, uint32_t pid);
+
     void GetDiskused();
 
+    // account the memory of the memory tables, then update the partitions over the hard limits
+    // and make a gc of the partitions which reach the soft limits
+    void SchedCheckMemory();
+
+    // kOk if neither the tablet nor the table reaches the hard memory limit
+    ::openmldb::base::ReturnCode CheckMemoryLimit(uint32_t tid, uint32_t pid, std::string* msg);
+
     void CheckZkClient();
 
     void RefreshTableInfo();
@@ -406,6 +535,9 @@ class TabletImpl : public ::openmldb::api::TabletServer {
     int32_t DeleteTableInternal(uint32_t tid, uint32_t pid, std::shared_ptr<::openmldb::api::TaskInfo> task_ptr);
 
     int LoadTableInternal(uint32_t tid, uint32_t pid, std::shared_ptr<::openmldb::api::TaskInfo> task_ptr);
+
+    // load the partition of the highest priority in pending_loads_, every LoadTable adds one task of it
+    void LoadNextTable();
     int WriteTableMeta(const std::string& path, const ::openmldb::api::TableMeta* table_meta);
 
     int UpdateTableMeta(const std::string& path, ::openmldb::api::TableMeta* table_meta, bool for_add_column);
@@ -458,34 +590,79 @@ class TabletImpl : public ::openmldb::api::TabletServer {
 
     void SchedDelRecycle();
 
+    void SchedExpireTraverseCursor();
+
     bool GetRealEp(uint64_t tid, uint64_t pid, std::map<std::string, std::string>* real_ep_map);
 
+    // the deadline of a request mode query with timeout_ms is from start_time, or the time now if it is 0
     void ProcessQuery(RpcController* controller, const openmldb::api::QueryRequest* request,
-                      ::openmldb::api::QueryResponse* response, butil::IOBuf* buf);
+                      ::openmldb::api::QueryResponse* response, butil::IOBuf* buf, uint64_t max_bytes_size,
+                      uint64_t start_time = 0);
+    // run the deployment on the request row in the process, for the application embedding the tablet. It skips
+    // the rpc and the encoding of the rows, the output holds its own buffer
+    ::hybridse::base::Status CallProcedureLocal(const std::string& db, const std::string& sp_name,
+                                                const ::hybridse::codec::Row& row, uint64_t timeout_ms,
+                                                ::hybridse::codec::Row* output);
+    // the request and the output schemas of the deployment
+    ::hybridse::base::Status GetProcedureSchema(const std::string& db, const std::string& sp_name,
+                                                ::hybridse::codec::Schema* request_schema,
+                                                ::hybridse::codec::Schema* output_schema);
     void ProcessBatchRequestQuery(RpcController* controller, const openmldb::api::SQLBatchRequestQueryRequest* request,
                                   openmldb::api::SQLBatchRequestQueryResponse* response,
                                   butil::IOBuf& buf);  // NOLINT
 
  private:
+    // the request of a deployment is sampled one in query_trace_sample_interval
+    bool IsQueryTraceSampled(const openmldb::api::QueryRequest& request);
+
+    void RecordQueryTrace(const openmldb::api::QueryRequest& request, const openmldb::api::QueryResponse& response);
+
     void RunRequestQuery(RpcController* controller, const openmldb::api::QueryRequest& request,
                          ::hybridse::vm::RequestRunSession& session,                  // NOLINT
                          openmldb::api::QueryResponse& response, butil::IOBuf& buf);  // NOLINT
 
     void CreateProcedure(const std::shared_ptr<hybridse::sdk::ProcedureInfo>& sp_info);
 
+    // compile the procedures with at most procedure_compile_thread_num threads
+    void CreateProcedures(const std::vector<std::shared_ptr<hybridse::sdk::ProcedureInfo>>& sp_infos);
+
     Tables tables_;
     std::mutex mu_;
     SpinMutex spin_mutex_;
-    ThreadPool gc_pool_;
+    // runs the background tasks of the pools below by their priority
+    PriorityExecutor background_executor_;
+    std::vector<std::unique_ptr<BackgroundMetrics>> background_metrics_;
+    PriorityExecutor::Queue gc_pool_;
     Replicators replicators_;
     Snapshots snapshots_;
+    std::shared_ptr<const TableHandles> table_handles_;
+    Aggregators aggregators_;
+    Materializers materializers_;
     ZkClient* zk_client_;
-    ThreadPool keep_alive_pool_;
-    ThreadPool task_pool_;
-    ThreadPool io_pool_;
-    ThreadPool snapshot_pool_;
+    PriorityExecutor::Queue keep_alive_pool_;
+    PriorityExecutor::Queue task_pool_;
+    PriorityExecutor::Queue io_pool_;
+    PriorityExecutor::Queue snapshot_pool_;
+    // every partition is put by one of the workers only, so its segments are written by one thread
+    std::vector<std::shared_ptr<ThreadPool>> put_workers_;
     std::map<uint64_t, std::list<std::shared_ptr<::openmldb::api::TaskInfo>>> task_map_;
     std::set<std::string> sync_snapshot_set_;
+    // the partitions waiting to be loaded. The leaders are loaded before the followers as they serve the queries,
+    // and the small partitions first, so most of the partitions are queryable soon after the tablet restarts
+    struct PendingLoad {
+        bool follower;
+        uint64_t size;
+        uint64_t seq;
+        uint32_t tid;
+        uint32_t pid;
+        std::shared_ptr<::openmldb::api::TaskInfo> task_ptr;
+        bool operator<(const PendingLoad& other) const {
+            return std::tie(follower, size, seq) > std::tie(other.follower, other.size, other.seq);
+        }
+    };
+    std::priority_queue<PendingLoad> pending_loads_;
+    uint64_t pending_load_seq_;
+    std::mutex load_mu_;
     std::map<std::string, std::shared_ptr<FileReceiver>> file_receiver_map_;
     BulkLoadMgr bulk_load_mgr_;
     brpc::Server* server_;  // TODO(hw): need?
@@ -504,6 +681,26 @@ class TabletImpl : public ::openmldb::api::TabletServer {
     std::shared_ptr<SpCache> sp_cache_;
     std::string notify_path_;
     std::string sp_root_path_;
+    // the serialized status and its version of the partitions keyed by tid << 32 | pid
+    std::map<uint64_t, std::pair<std::string, uint64_t>> table_status_cache_;
+    uint64_t table_status_version_;
+    // the versions of the tablet started again are not comparable to the ones before
+    uint64_t table_status_epoch_;
+    QueryAdmission query_admission_;
+    TraverseCursorMgr traverse_cursors_;
+    std::atomic<uint64_t> query_trace_cnt_;
+    std::mutex query_trace_mu_;
+    // the latency of the stages of the sampled requests keyed by the deployment and the stage
+    std::map<std::string, std::shared_ptr<bvar::LatencyRecorder>> query_trace_recorders_;
+    // the bytes of the memory tables accounted by SchedCheckMemory
+    std::atomic<uint64_t> memory_used_;
+    std::atomic<bool> memory_exceeded_;
+    // the partitions over max_table_memory_mb keyed by tid << 32 | pid
+    std::shared_ptr<const std::set<uint64_t>> memory_exceeded_tables_;
+    // the state of the soft limits, only touched by SchedCheckMemory
+    bool memory_soft_exceeded_;
+    std::set<uint64_t> memory_soft_tables_;
+    WorkloadCapture workload_capture_;
 };
 
 }  // namespace tablet
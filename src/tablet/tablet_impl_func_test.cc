@@ -354,6 +354,51 @@ TEST_F(TabletFuncTest, GetTimeIndex_ts1_iterator) {
     RunGetTimeIndexAssert(&query_its, base_ts, base_ts - 100);
 }
 
+TEST_F(TabletFuncTest, CombineIterator_merge) {
+    // the latest 3 rows of card0 in every table, the iterator of the greatest ts expires first
+    std::vector<uint64_t> start_ts = {1500, 1000, 500};
+    std::vector<QueryIt> query_its(start_ts.size());
+    for (size_t i = 0; i < start_ts.size(); i++) {
+        ::openmldb::storage::Table* table = NULL;
+        CreateBaseTable(table, ::openmldb::type::TTLType::kLatestTime, 3, start_ts[i]);
+        query_its[i].ticket = std::make_shared<::openmldb::storage::Ticket>();
+        query_its[i].it.reset(table->NewIterator(0, "card0", *query_its[i].ticket));
+        query_its[i].table.reset(table);
+    }
+    ::openmldb::storage::TTLSt ttl(0, 3, ::openmldb::storage::kLatestTime);
+    CombineIterator combine_it(query_its, 0, ::openmldb::api::GetType::kSubKeyLe, ttl);
+    combine_it.SeekToFirst();
+    std::vector<uint64_t> expect = {2400, 2300, 2200, 1900, 1800, 1700, 1400, 1300, 1200};
+    for (uint64_t ts : expect) {
+        ASSERT_TRUE(combine_it.Valid());
+        ASSERT_EQ(ts, combine_it.GetTs());
+        combine_it.Next();
+    }
+    ASSERT_FALSE(combine_it.Valid());
+
+    // the ties go to the first iterator
+    start_ts = {1000, 1500};
+    std::vector<QueryIt> tie_its(start_ts.size());
+    for (size_t i = 0; i < start_ts.size(); i++) {
+        ::openmldb::storage::Table* table = NULL;
+        CreateBaseTable(table, ::openmldb::type::TTLType::kLatestTime, 0, start_ts[i]);
+        tie_its[i].ticket = std::make_shared<::openmldb::storage::Ticket>();
+        tie_its[i].it.reset(table->NewIterator(0, "card0", *tie_its[i].ticket));
+        tie_its[i].table.reset(table);
+    }
+    CombineIterator tie_it(tie_its, 1500, ::openmldb::api::GetType::kSubKeyLe, ::openmldb::storage::TTLSt());
+    tie_it.SeekToFirst();
+    ASSERT_TRUE(tie_it.Valid());
+    ASSERT_EQ(1500u, tie_it.GetTs());
+    ASSERT_EQ("value500", tie_it.GetValue().ToString());
+    tie_it.Next();
+    ASSERT_TRUE(tie_it.Valid());
+    ASSERT_EQ(1500u, tie_it.GetTs());
+    ASSERT_EQ("value0", tie_it.GetValue().ToString());
+    tie_it.Next();
+    ASSERT_EQ(1400u, tie_it.GetTs());
+}
+
 }  // namespace tablet
 }  // namespace openmldb
 
@@ -669,6 +669,73 @@ TEST_P(TabletProjectTest, scan_case) {
     }
 }
 
+TEST_P(TabletProjectTest, traverse_case) {
+    auto args = GetParam();
+    // create table
+    std::string name = ::openmldb::tablet::GenRand();
+    int tid = rand() % 10000000;  // NOLINT
+    MockClosure closure;
+    // create a table
+    {
+        ::openmldb::api::CreateTableRequest crequest;
+        ::openmldb::api::TableMeta* table_meta = crequest.mutable_table_meta();
+        table_meta->set_name(name);
+        table_meta->set_tid(tid);
+        table_meta->set_pid(0);
+        table_meta->set_seg_cnt(8);
+        table_meta->set_mode(::openmldb::api::TableMode::kTableLeader);
+        table_meta->set_key_entry_max_height(8);
+        table_meta->set_format_version(1);
+        Schema* schema = table_meta->mutable_column_desc();
+        schema->CopyFrom(args->schema);
+        ::openmldb::common::ColumnKey* ck = table_meta->add_column_key();
+        ck->CopyFrom(args->ckey);
+        ::openmldb::api::CreateTableResponse cresponse;
+        tablet_.CreateTable(NULL, &crequest, &cresponse, &closure);
+        ASSERT_EQ(0, cresponse.code());
+    }
+    // put a record
+    {
+        ::openmldb::api::PutRequest request;
+        request.set_tid(tid);
+        request.set_pid(0);
+        request.set_format_version(1);
+        ::openmldb::api::Dimension* dim = request.add_dimensions();
+        dim->set_idx(0);
+        std::string key = args->pk;
+        dim->set_key(key);
+        ::openmldb::api::TSDimension* ts = request.add_ts_dimensions();
+        ts->set_idx(0);
+        ts->set_ts(args->ts);
+        request.set_value(reinterpret_cast<char*>(args->row_ptr), args->row_size);
+        ::openmldb::api::PutResponse response;
+        tablet_.Put(NULL, &request, &response, &closure);
+        ASSERT_EQ(0, response.code());
+    }
+
+    // traverse with projectlist
+    {
+        ::openmldb::api::TraverseRequest sr;
+        sr.set_tid(tid);
+        sr.set_pid(0);
+        sr.set_limit(100);
+        sr.mutable_projection()->CopyFrom(args->plist);
+        ::openmldb::api::TraverseResponse srp;
+        tablet_.Traverse(NULL, &sr, &srp, &closure);
+        ASSERT_EQ(0, srp.code());
+        ASSERT_EQ(1, (int64_t)srp.count());
+        ::openmldb::base::KvIterator kv_it(&srp, false);
+        ASSERT_TRUE(kv_it.Valid());
+        ASSERT_EQ(args->pk, kv_it.GetPK());
+        ASSERT_EQ(kv_it.GetValue().size(), args->out_size);
+        codec::RowView left(args->output_schema);
+        left.Reset(reinterpret_cast<const int8_t*>(kv_it.GetValue().data()), kv_it.GetValue().size());
+        codec::RowView right(args->output_schema);
+        right.Reset(reinterpret_cast<int8_t*>(args->out_ptr), args->out_size);
+        CompareRow(&left, &right, args->output_schema);
+    }
+}
+
 INSTANTIATE_TEST_SUITE_P(TabletProjectPrefix, TabletProjectTest, testing::ValuesIn(GenCommonCase()));
 
 }  // namespace tablet
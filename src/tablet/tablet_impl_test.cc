@@ -23,13 +23,18 @@
 #include <sys/stat.h>
 
 #include <algorithm>
+#include <memory>
+#include <string>
 #include <utility>
+#include <vector>
 
+#include "base/count_down_latch.h"
 #include "base/file_util.h"
 #include "base/glog_wapper.h"
 #include "base/kv_iterator.h"
 #include "base/strings.h"
 #include "boost/lexical_cast.hpp"
+#include "bvar/variable.h"
 #include "codec/codec.h"
 #include "codec/flat_array.h"
 #include "codec/row_codec.h"
@@ -53,6 +58,9 @@ DECLARE_string(db_root_path);
 DECLARE_string(recycle_bin_root_path);
 DECLARE_string(endpoint);
 DECLARE_uint32(recycle_ttl);
+DECLARE_uint32(put_worker_num);
+DECLARE_uint32(max_table_memory_mb);
+DECLARE_int32(memory_check_interval);
 
 namespace openmldb {
 namespace tablet {
@@ -75,6 +83,15 @@ class MockClosure : public ::google::protobuf::Closure {
     void Run() {}
 };
 
+class CountDownClosure : public ::google::protobuf::Closure {
+ public:
+    explicit CountDownClosure(::openmldb::base::CountDownLatch* latch) : latch_(latch) {}
+    void Run() { latch_->CountDown(); }
+
+ private:
+    ::openmldb::base::CountDownLatch* latch_;
+};
+
 class TabletImplTest : public ::testing::Test {
  public:
     TabletImplTest() {}
@@ -510,6 +527,33 @@ TEST_F(TabletImplTest, SCAN_latest_table) {
         kv_it->Next();
         ASSERT_TRUE(kv_it->Valid());
     }
+
+    // scan with the pairs in the attachment
+    {
+        ::openmldb::api::ScanRequest sr;
+        sr.set_tid(id);
+        sr.set_pid(0);
+        sr.set_pk("1");
+        sr.set_st(92);
+        sr.set_et(0);
+        sr.set_et_type(::openmldb::api::kSubKeyGe);
+        sr.set_attachment_with_ts(true);
+        auto* srp = new ::openmldb::api::ScanResponse();
+        brpc::Controller cntl;
+        tablet.Scan(&cntl, &sr, srp, &closure);
+        ASSERT_EQ(0, srp->code());
+        ASSERT_EQ(5, (signed)srp->count());
+        ASSERT_TRUE(srp->pairs().empty());
+        ASSERT_EQ(srp->buf_size(), cntl.response_attachment().size());
+        ::openmldb::base::KvIterator kv_it(srp, &cntl.response_attachment());
+        for (int i = 0; i < 5; i++) {
+            ASSERT_TRUE(kv_it.Valid());
+            ASSERT_EQ(92u - 10 * i, kv_it.GetKey());
+            ASSERT_EQ(std::to_string(91 - 10 * i), kv_it.GetValue().ToString());
+            kv_it.Next();
+        }
+        ASSERT_FALSE(kv_it.Valid());
+    }
 }
 
 TEST_F(TabletImplTest, Get) {
@@ -1128,6 +1172,314 @@ TEST_F(TabletImplTest, MultiGet) {
     ASSERT_EQ(108, scan_response.code());
 }
 
+TEST_F(TabletImplTest, BatchGet) {
+    TabletImpl tablet;
+    tablet.Init("");
+    uint32_t id = counter++;
+    ::openmldb::api::CreateTableRequest request;
+    ::openmldb::api::TableMeta* table_meta = request.mutable_table_meta();
+    table_meta->set_name("t0");
+    table_meta->set_tid(id);
+    table_meta->set_pid(1);
+    table_meta->set_mode(::openmldb::api::TableMode::kTableLeader);
+    auto column = table_meta->add_column_desc();
+    column->set_name("card");
+    column->set_data_type(::openmldb::type::kString);
+    column = table_meta->add_column_desc();
+    column->set_name("amt");
+    column->set_data_type(::openmldb::type::kString);
+    SchemaCodec::SetIndex(table_meta->add_column_key(), "card", "card", "", ::openmldb::type::kAbsoluteTime, 0, 0);
+    SchemaCodec::SetIndex(table_meta->add_column_key(), "amt", "amt", "", ::openmldb::type::kAbsoluteTime, 0, 0);
+    ::openmldb::api::CreateTableResponse response;
+    MockClosure closure;
+    tablet.CreateTable(NULL, &request, &response, &closure);
+    ASSERT_EQ(0, response.code());
+
+    std::vector<std::string> rows;
+    for (int i = 0; i < 5; i++) {
+        std::vector<std::string> input = {"card" + std::to_string(i), "amt" + std::to_string(i)};
+        std::string value;
+        ::openmldb::codec::RowCodec::EncodeRow(input, table_meta->column_desc(), 1, value);
+        rows.push_back(value);
+        ::openmldb::api::PutRequest request;
+        request.set_time(1100 + i);
+        request.set_value(value);
+        request.set_tid(id);
+        request.set_pid(1);
+        ::openmldb::api::Dimension* d = request.add_dimensions();
+        d->set_key(input[0]);
+        d->set_idx(0);
+        d = request.add_dimensions();
+        d->set_key(input[1]);
+        d->set_idx(1);
+        ::openmldb::api::PutResponse response;
+        tablet.Put(NULL, &request, &response, &closure);
+        ASSERT_EQ(0, response.code());
+    }
+    ::openmldb::api::BatchGetRequest get_request;
+    get_request.set_tid(id);
+    get_request.set_pid(1);
+    for (int i = 0; i < 5; i++) {
+        auto key = get_request.add_keys();
+        key->set_key("card" + std::to_string(i));
+    }
+    auto key = get_request.add_keys();
+    key->set_key("amt3");
+    key->set_idx_name("amt");
+    key = get_request.add_keys();
+    key->set_key("card9");
+    key = get_request.add_keys();
+    key->set_key("card1");
+    key->set_idx_name("ts");
+    key = get_request.add_keys();
+    key->set_key("card2");
+    key->set_ts(1000);
+    ::openmldb::api::BatchGetResponse get_response;
+    brpc::Controller cntl;
+    tablet.BatchGet(&cntl, &get_request, &get_response, &closure);
+    ASSERT_EQ(0, get_response.code());
+    ASSERT_EQ(9, get_response.codes_size());
+    ASSERT_EQ(6u, get_response.count());
+    ASSERT_EQ(109, get_response.codes(6));
+    ASSERT_EQ(108, get_response.codes(7));
+    ASSERT_EQ(109, get_response.codes(8));
+    butil::IOBuf& buf = cntl.response_attachment();
+    ASSERT_EQ(get_response.buf_size(), buf.size());
+    for (int i = 0; i < 6; i++) {
+        ASSERT_EQ(0, get_response.codes(i));
+        int row = i < 5 ? i : 3;
+        uint32_t total_size = 0;
+        uint64_t ts = 0;
+        std::string value;
+        ASSERT_EQ(4u, buf.cutn(&total_size, 4));
+        ASSERT_EQ(8u, buf.cutn(&ts, 8));
+        ASSERT_EQ(rows[row].size() + 8, total_size);
+        ASSERT_EQ(1100u + row, ts);
+        buf.cutn(&value, total_size - 8);
+        ASSERT_EQ(rows[row], value);
+    }
+    ASSERT_TRUE(buf.empty());
+
+    get_request.set_tid(id + 1000);
+    get_response.Clear();
+    tablet.BatchGet(&cntl, &get_request, &get_response, &closure);
+    ASSERT_EQ(100, get_response.code());
+}
+
+TEST_F(TabletImplTest, PutWorker) {
+    uint32_t old_worker_num = FLAGS_put_worker_num;
+    FLAGS_put_worker_num = 2;
+    TabletImpl tablet;
+    tablet.Init("");
+    FLAGS_put_worker_num = old_worker_num;
+    uint32_t id = counter++;
+    {
+        ::openmldb::api::CreateTableRequest request;
+        ::openmldb::api::TableMeta* table_meta = request.mutable_table_meta();
+        table_meta->set_name("t0");
+        table_meta->set_tid(id);
+        table_meta->set_pid(1);
+        table_meta->set_mode(::openmldb::api::TableMode::kTableLeader);
+        AddDefaultSchema(0, 0, ::openmldb::type::TTLType::kAbsoluteTime, table_meta);
+        ::openmldb::api::CreateTableResponse response;
+        MockClosure closure;
+        tablet.CreateTable(NULL, &request, &response, &closure);
+        ASSERT_EQ(0, response.code());
+    }
+    // the puts are run on the worker of the partition and done after the return
+    uint32_t cnt = 10;
+    uint64_t now = ::baidu::common::timer::get_micros() / 1000;
+    ::openmldb::base::CountDownLatch latch(cnt);
+    std::vector<::openmldb::api::PutRequest> requests(cnt);
+    std::vector<::openmldb::api::PutResponse> responses(cnt);
+    std::vector<std::unique_ptr<CountDownClosure>> closures;
+    for (uint32_t i = 0; i < cnt; i++) {
+        PackDefaultDimension("test0", &requests[i]);
+        requests[i].set_time(now - i);
+        requests[i].set_value("value" + std::to_string(i));
+        requests[i].set_tid(id);
+        requests[i].set_pid(1);
+        closures.emplace_back(new CountDownClosure(&latch));
+        tablet.Put(NULL, &requests[i], &responses[i], closures.back().get());
+    }
+    latch.Wait();
+    for (uint32_t i = 0; i < cnt; i++) {
+        ASSERT_EQ(0, responses[i].code());
+    }
+    ::openmldb::api::TraverseRequest request;
+    request.set_tid(id);
+    request.set_pid(1);
+    request.set_limit(100);
+    ::openmldb::api::TraverseResponse response;
+    MockClosure closure;
+    tablet.Traverse(NULL, &request, &response, &closure);
+    ASSERT_EQ(0, response.code());
+    ASSERT_EQ(cnt, response.count());
+}
+
+TEST_F(TabletImplTest, MemoryLimit) {
+    uint32_t old_max_table_memory = FLAGS_max_table_memory_mb;
+    int32_t old_check_interval = FLAGS_memory_check_interval;
+    FLAGS_max_table_memory_mb = 1;
+    FLAGS_memory_check_interval = 100;
+    TabletImpl tablet;
+    tablet.Init("");
+    uint32_t id = counter++;
+    {
+        ::openmldb::api::CreateTableRequest request;
+        ::openmldb::api::TableMeta* table_meta = request.mutable_table_meta();
+        table_meta->set_name("t0");
+        table_meta->set_tid(id);
+        table_meta->set_pid(1);
+        table_meta->set_mode(::openmldb::api::TableMode::kTableLeader);
+        AddDefaultSchema(0, 0, ::openmldb::type::TTLType::kAbsoluteTime, table_meta);
+        ::openmldb::api::CreateTableResponse response;
+        MockClosure closure;
+        tablet.CreateTable(NULL, &request, &response, &closure);
+        ASSERT_EQ(0, response.code());
+    }
+    uint64_t now = ::baidu::common::timer::get_micros() / 1000;
+    std::string value(1024, 'a');
+    for (uint32_t i = 0; i < 1100; i++) {
+        ::openmldb::api::PutRequest request;
+        PackDefaultDimension("test0", &request);
+        request.set_time(now - i);
+        request.set_value(value);
+        request.set_tid(id);
+        request.set_pid(1);
+        ::openmldb::api::PutResponse response;
+        MockClosure closure;
+        tablet.Put(NULL, &request, &response, &closure);
+        ASSERT_EQ(0, response.code());
+    }
+    sleep(1);
+    ::openmldb::api::PutRequest request;
+    PackDefaultDimension("test0", &request);
+    request.set_time(now);
+    request.set_value(value);
+    request.set_tid(id);
+    request.set_pid(1);
+    ::openmldb::api::PutResponse response;
+    MockClosure closure;
+    tablet.Put(NULL, &request, &response, &closure);
+    ASSERT_EQ(::openmldb::base::ReturnCode::kExceedMemoryLimit, response.code());
+    FLAGS_max_table_memory_mb = old_max_table_memory;
+    FLAGS_memory_check_interval = old_check_interval;
+}
+
+TEST_F(TabletImplTest, TableMetrics) {
+    TabletImpl tablet;
+    tablet.Init("");
+    uint32_t id = counter++;
+    {
+        ::openmldb::api::CreateTableRequest request;
+        ::openmldb::api::TableMeta* table_meta = request.mutable_table_meta();
+        table_meta->set_name("t0");
+        table_meta->set_tid(id);
+        table_meta->set_pid(1);
+        table_meta->set_mode(::openmldb::api::TableMode::kTableLeader);
+        AddDefaultSchema(0, 0, ::openmldb::type::TTLType::kAbsoluteTime, table_meta);
+        ::openmldb::api::CreateTableResponse response;
+        MockClosure closure;
+        tablet.CreateTable(NULL, &request, &response, &closure);
+        ASSERT_EQ(0, response.code());
+    }
+    std::string prefix = "table_" + std::to_string(id) + "_1_";
+    ASSERT_EQ("0", bvar::Variable::describe_exposed(prefix + "put_count"));
+    {
+        ::openmldb::api::PutRequest request;
+        PackDefaultDimension("test0", &request);
+        request.set_time(::baidu::common::timer::get_micros() / 1000);
+        request.set_value("value0");
+        request.set_tid(id);
+        request.set_pid(1);
+        ::openmldb::api::PutResponse response;
+        MockClosure closure;
+        tablet.Put(NULL, &request, &response, &closure);
+        ASSERT_EQ(0, response.code());
+    }
+    ASSERT_EQ("1", bvar::Variable::describe_exposed(prefix + "put_count"));
+    // the bvars are hidden with the table dropped
+    {
+        ::openmldb::api::DropTableRequest request;
+        request.set_tid(id);
+        request.set_pid(1);
+        ::openmldb::api::DropTableResponse response;
+        MockClosure closure;
+        tablet.DropTable(NULL, &request, &response, &closure);
+        ASSERT_EQ(0, response.code());
+    }
+    sleep(1);
+    ASSERT_EQ("", bvar::Variable::describe_exposed(prefix + "put_count"));
+}
+
+TEST_F(TabletImplTest, PutBatch) {
+    TabletImpl tablet;
+    tablet.Init("");
+    uint32_t id = counter++;
+    ::openmldb::api::CreateTableRequest request;
+    ::openmldb::api::TableMeta* table_meta = request.mutable_table_meta();
+    table_meta->set_name("t0");
+    table_meta->set_tid(id);
+    table_meta->set_pid(1);
+    table_meta->set_mode(::openmldb::api::TableMode::kTableLeader);
+    auto column = table_meta->add_column_desc();
+    column->set_name("card");
+    column->set_data_type(::openmldb::type::kString);
+    column = table_meta->add_column_desc();
+    column->set_name("amt");
+    column->set_data_type(::openmldb::type::kString);
+    SchemaCodec::SetIndex(table_meta->add_column_key(), "card", "card", "", ::openmldb::type::kAbsoluteTime, 0, 0);
+    ::openmldb::api::CreateTableResponse response;
+    MockClosure closure;
+    tablet.CreateTable(NULL, &request, &response, &closure);
+    ASSERT_EQ(0, response.code());
+
+    ::openmldb::api::PutBatchRequest put_request;
+    put_request.set_tid(id);
+    put_request.set_pid(1);
+    std::vector<std::string> rows;
+    for (int i = 0; i < 5; i++) {
+        std::vector<std::string> input = {"card" + std::to_string(i % 2), "amt" + std::to_string(i)};
+        std::string value;
+        ::openmldb::codec::RowCodec::EncodeRow(input, table_meta->column_desc(), 1, value);
+        rows.push_back(value);
+        auto row = put_request.add_rows();
+        row->set_time(1100 + i);
+        row->set_value(value);
+        ::openmldb::api::Dimension* d = row->add_dimensions();
+        d->set_key(input[0]);
+        d->set_idx(0);
+    }
+    // the row with zero ts fails the rows after it
+    put_request.mutable_rows(3)->set_time(0);
+    ::openmldb::api::PutBatchResponse put_response;
+    tablet.PutBatch(NULL, &put_request, &put_response, &closure);
+    ASSERT_EQ(::openmldb::base::ReturnCode::kTsMustBeGreaterThanZero, put_response.code());
+    ASSERT_EQ(3u, put_response.count());
+    put_request.mutable_rows()->DeleteSubrange(0, 3);
+    put_request.mutable_rows(0)->set_time(1103);
+    tablet.PutBatch(NULL, &put_request, &put_response, &closure);
+    ASSERT_EQ(0, put_response.code());
+    ASSERT_EQ(2u, put_response.count());
+
+    for (int i = 0; i < 5; i++) {
+        ::openmldb::api::GetRequest get_request;
+        get_request.set_tid(id);
+        get_request.set_pid(1);
+        get_request.set_key("card" + std::to_string(i % 2));
+        get_request.set_ts(1100 + i);
+        ::openmldb::api::GetResponse get_response;
+        tablet.Get(NULL, &get_request, &get_response, &closure);
+        ASSERT_EQ(0, get_response.code());
+        ASSERT_EQ(rows[i], get_response.value());
+    }
+
+    put_request.set_tid(id + 1000);
+    tablet.PutBatch(NULL, &put_request, &put_response, &closure);
+    ASSERT_EQ(100, put_response.code());
+}
+
 TEST_F(TabletImplTest, CreateTable) {
     uint32_t id = counter++;
     TabletImpl tablet;
@@ -2771,6 +3123,62 @@ TEST_F(TabletImplTest, CreateTableAbsoluteTest_Default) {
     }
 }
 
+TEST_F(TabletImplTest, GetTableStatusIncremental) {
+    uint32_t id = counter++;
+    MockClosure closure;
+    TabletImpl tablet;
+    tablet.Init("");
+    for (uint32_t pid = 0; pid < 2; pid++) {
+        ::openmldb::api::CreateTableRequest request;
+        ::openmldb::api::TableMeta* table_meta = request.mutable_table_meta();
+        table_meta->set_name("t0");
+        table_meta->set_tid(id);
+        table_meta->set_pid(pid);
+        table_meta->set_mode(::openmldb::api::kTableLeader);
+        AddDefaultSchema(0, 0, ::openmldb::type::TTLType::kLatestTime, table_meta);
+        ::openmldb::api::CreateTableResponse response;
+        tablet.CreateTable(NULL, &request, &response, &closure);
+        ASSERT_EQ(0, response.code());
+    }
+    ::openmldb::api::GetTableStatusRequest request;
+    ::openmldb::api::GetTableStatusResponse response;
+    tablet.GetTableStatus(NULL, &request, &response, &closure);
+    ASSERT_EQ(0, response.code());
+    ASSERT_FALSE(response.is_incremental());
+    ASSERT_EQ(2, response.all_table_status_size());
+    request.set_status_version(response.status_version());
+    request.set_status_epoch(response.status_epoch());
+    // nothing changed
+    {
+        ::openmldb::api::GetTableStatusResponse inc_response;
+        tablet.GetTableStatus(NULL, &request, &inc_response, &closure);
+        ASSERT_EQ(0, inc_response.code());
+        ASSERT_TRUE(inc_response.is_incremental());
+        ASSERT_EQ(0, inc_response.all_table_status_size());
+        ASSERT_EQ(2, inc_response.unchanged_partitions_size());
+    }
+    PrepareLatestTableData(tablet, id, 1);
+    {
+        ::openmldb::api::GetTableStatusResponse inc_response;
+        tablet.GetTableStatus(NULL, &request, &inc_response, &closure);
+        ASSERT_EQ(0, inc_response.code());
+        ASSERT_TRUE(inc_response.is_incremental());
+        ASSERT_EQ(1, inc_response.all_table_status_size());
+        ASSERT_EQ(1u, inc_response.all_table_status(0).pid());
+        ASSERT_EQ(100u, inc_response.all_table_status(0).record_cnt());
+        ASSERT_EQ(1, inc_response.unchanged_partitions_size());
+        ASSERT_EQ(static_cast<uint64_t>(id) << 32, inc_response.unchanged_partitions(0));
+    }
+    // the versions of another epoch are not comparable
+    {
+        request.set_status_epoch(response.status_epoch() + 1);
+        ::openmldb::api::GetTableStatusResponse full_response;
+        tablet.GetTableStatus(NULL, &request, &full_response, &closure);
+        ASSERT_FALSE(full_response.is_incremental());
+        ASSERT_EQ(2, full_response.all_table_status_size());
+    }
+}
+
 TEST_F(TabletImplTest, CreateTableAbsoluteTest_Specify) {
     uint32_t id = counter++;
     MockClosure closure;
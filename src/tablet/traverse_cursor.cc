@@ -0,0 +1,87 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tablet/traverse_cursor.h"
+
+#include <utility>
+#include <vector>
+
+#include "common/timer.h"
+
+namespace openmldb {
+namespace tablet {
+
+static inline uint64_t NowMs() { return static_cast<uint64_t>(::baidu::common::timer::get_micros() / 1000); }
+
+TraverseCursorMgr::TraverseCursorMgr(uint64_t ttl_ms, uint32_t max_cnt)
+    : ttl_ms_(ttl_ms), max_cnt_(max_cnt), mu_(), cursors_(), next_id_(1) {}
+
+std::unique_ptr<TraverseCursor> TraverseCursorMgr::Take(uint64_t id) {
+    std::unique_ptr<TraverseCursor> cursor;
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        auto iter = cursors_.find(id);
+        if (iter == cursors_.end()) {
+            return cursor;
+        }
+        cursor = std::move(iter->second);
+        cursors_.erase(iter);
+    }
+    if (cursor->expire_time < NowMs()) {
+        // the iterator is released out of the lock
+        cursor.reset();
+    }
+    return cursor;
+}
+
+uint64_t TraverseCursorMgr::Put(std::unique_ptr<TraverseCursor> cursor, uint64_t id) {
+    cursor->expire_time = NowMs() + ttl_ms_;
+    std::lock_guard<std::mutex> lock(mu_);
+    if (cursors_.size() >= max_cnt_) {
+        return 0;
+    }
+    if (id == 0 || cursors_.find(id) != cursors_.end()) {
+        id = next_id_++;
+    }
+    cursors_.emplace(id, std::move(cursor));
+    return id;
+}
+
+uint32_t TraverseCursorMgr::Expire() {
+    uint64_t now = NowMs();
+    std::vector<std::unique_ptr<TraverseCursor>> expired;
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        auto iter = cursors_.begin();
+        while (iter != cursors_.end()) {
+            if (iter->second->expire_time < now) {
+                expired.push_back(std::move(iter->second));
+                iter = cursors_.erase(iter);
+            } else {
+                iter++;
+            }
+        }
+    }
+    return expired.size();
+}
+
+uint32_t TraverseCursorMgr::GetCnt() {
+    std::lock_guard<std::mutex> lock(mu_);
+    return cursors_.size();
+}
+
+}  // namespace tablet
+}  // namespace openmldb
@@ -0,0 +1,77 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_TABLET_TRAVERSE_CURSOR_H_
+#define SRC_TABLET_TRAVERSE_CURSOR_H_
+
+#include <map>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <string>
+
+#include "storage/table.h"
+
+namespace openmldb {
+namespace tablet {
+
+// the iterator of a traverse kept between the pages, it pins the table and the key it stops at
+struct TraverseCursor {
+    uint32_t tid = 0;
+    uint32_t pid = 0;
+    uint32_t index = 0;
+    std::shared_ptr<::openmldb::storage::Table> table;
+    std::unique_ptr<::openmldb::storage::TableIterator> it;
+    // the pk and ts the last page ends with, the next page is requested from them
+    std::string pk;
+    uint64_t ts = 0;
+    // the row of the iterator is returned by the last page already
+    bool need_next = false;
+    uint64_t expire_time = 0;
+};
+
+// TraverseCursorMgr keeps the cursors of the traverses until they are taken by the next pages or expire. A cursor
+// is taken out for a page, so the retried or concurrent requests of the same cursor fall back to seeking the
+// iterator
+class TraverseCursorMgr {
+ public:
+    TraverseCursorMgr(uint64_t ttl_ms, uint32_t max_cnt);
+
+    TraverseCursorMgr(const TraverseCursorMgr&) = delete;
+    TraverseCursorMgr& operator=(const TraverseCursorMgr&) = delete;
+
+    // take the cursor of id out, NULL if it is not found or expired
+    std::unique_ptr<TraverseCursor> Take(uint64_t id);
+
+    // keep the cursor for the ttl and return its id, 0 if there are max_cnt cursors already.
+    // The id of a cursor taken can be given to it again
+    uint64_t Put(std::unique_ptr<TraverseCursor> cursor, uint64_t id);
+
+    // release the expired cursors and return the count of them
+    uint32_t Expire();
+
+    uint32_t GetCnt();
+
+ private:
+    uint64_t ttl_ms_;
+    uint32_t max_cnt_;
+    std::mutex mu_;
+    std::map<uint64_t, std::unique_ptr<TraverseCursor>> cursors_;
+    uint64_t next_id_;
+};
+
+}  // namespace tablet
+}  // namespace openmldb
+#endif  // SRC_TABLET_TRAVERSE_CURSOR_H_
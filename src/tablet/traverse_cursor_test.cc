@@ -0,0 +1,74 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tablet/traverse_cursor.h"
+
+#include <unistd.h>
+
+#include <memory>
+#include <utility>
+
+#include "gtest/gtest.h"
+
+namespace openmldb {
+namespace tablet {
+
+class TraverseCursorTest : public ::testing::Test {
+ public:
+    TraverseCursorTest() {}
+    ~TraverseCursorTest() {}
+};
+
+TEST_F(TraverseCursorTest, PutTake) {
+    TraverseCursorMgr mgr(60000, 2);
+    auto cursor = std::make_unique<TraverseCursor>();
+    cursor->pk = "pk1";
+    cursor->ts = 10;
+    uint64_t id = mgr.Put(std::move(cursor), 0);
+    ASSERT_NE(0u, id);
+    ASSERT_EQ(1u, mgr.GetCnt());
+    auto taken = mgr.Take(id);
+    ASSERT_TRUE(taken);
+    ASSERT_EQ("pk1", taken->pk);
+    ASSERT_EQ(10u, taken->ts);
+    // a cursor is taken only once
+    ASSERT_FALSE(mgr.Take(id));
+    // the id is given back to the next page
+    ASSERT_EQ(id, mgr.Put(std::move(taken), id));
+    ASSERT_NE(0u, mgr.Put(std::make_unique<TraverseCursor>(), 0));
+    // full
+    ASSERT_EQ(0u, mgr.Put(std::make_unique<TraverseCursor>(), 0));
+    ASSERT_EQ(2u, mgr.GetCnt());
+}
+
+TEST_F(TraverseCursorTest, Expire) {
+    TraverseCursorMgr mgr(1, 16);
+    uint64_t id1 = mgr.Put(std::make_unique<TraverseCursor>(), 0);
+    uint64_t id2 = mgr.Put(std::make_unique<TraverseCursor>(), 0);
+    ASSERT_NE(id1, id2);
+    usleep(5000);
+    ASSERT_FALSE(mgr.Take(id1));
+    ASSERT_EQ(1u, mgr.Expire());
+    ASSERT_EQ(0u, mgr.GetCnt());
+}
+
+}  // namespace tablet
+}  // namespace openmldb
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,128 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tablet/workload_capture.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "base/glog_wapper.h"
+#include "log/log_reader.h"
+#include "log/sequential_file.h"
+
+namespace openmldb {
+namespace tablet {
+
+WorkloadCapture::WorkloadCapture()
+    : enabled_(false), request_cnt_(0), captured_cnt_(0), sample_interval_(1), max_size_(0), mu_(), wh_() {}
+
+WorkloadCapture::~WorkloadCapture() { Close(); }
+
+bool WorkloadCapture::Open(const std::string& path, uint32_t sample_interval, uint64_t max_size) {
+    std::lock_guard<std::mutex> lock(mu_);
+    if (wh_) {
+        PDLOG(WARNING, "the workload capture is opened already");
+        return false;
+    }
+    // the file ends with the end of the log on the close, so a new capture overwrites it
+    FILE* fd = fopen(path.c_str(), "wb");
+    if (fd == NULL) {
+        PDLOG(WARNING, "fail to open the workload capture file %s", path.c_str());
+        return false;
+    }
+    wh_.reset(new ::openmldb::log::WriteHandle("off", path, fd));
+    sample_interval_ = std::max<uint32_t>(sample_interval, 1);
+    max_size_ = max_size;
+    enabled_.store(true, std::memory_order_relaxed);
+    PDLOG(INFO, "capture one in %u requests to %s", sample_interval_, path.c_str());
+    return true;
+}
+
+void WorkloadCapture::Close() {
+    std::lock_guard<std::mutex> lock(mu_);
+    enabled_.store(false, std::memory_order_relaxed);
+    if (wh_) {
+        wh_->EndLog();
+        wh_.reset();
+        PDLOG(INFO, "close the workload capture with %lu requests", captured_cnt_.load(std::memory_order_relaxed));
+    }
+}
+
+void WorkloadCapture::Capture(::openmldb::api::CaptureEntry::Method method, uint64_t time_us,
+                              const google::protobuf::Message& request, const butil::IOBuf& attachment) {
+    if (!IsEnabled() || request_cnt_.fetch_add(1, std::memory_order_relaxed) % sample_interval_ != 0) {
+        return;
+    }
+    ::openmldb::api::CaptureEntry entry;
+    entry.set_method(method);
+    entry.set_time_us(time_us);
+    if (!request.SerializeToString(entry.mutable_request())) {
+        return;
+    }
+    if (!attachment.empty()) {
+        attachment.copy_to(entry.mutable_attachment());
+    }
+    std::string value;
+    entry.SerializeToString(&value);
+    std::lock_guard<std::mutex> lock(mu_);
+    if (!wh_) {
+        return;
+    }
+    auto status = wh_->Write(::openmldb::base::Slice(value));
+    if (!status.ok()) {
+        PDLOG(WARNING, "fail to write the workload capture: %s, stop the capture", status.ToString().c_str());
+        enabled_.store(false, std::memory_order_relaxed);
+        return;
+    }
+    captured_cnt_.fetch_add(1, std::memory_order_relaxed);
+    if (max_size_ > 0 && wh_->GetSize() >= max_size_) {
+        PDLOG(INFO, "the workload capture reaches %lu bytes, stop the capture", max_size_);
+        enabled_.store(false, std::memory_order_relaxed);
+        wh_->Flush();
+    }
+}
+
+bool WorkloadCapture::Load(const std::string& path, std::vector<::openmldb::api::CaptureEntry>* entries) {
+    FILE* fd = fopen(path.c_str(), "rb");
+    if (fd == NULL) {
+        PDLOG(WARNING, "fail to open the workload capture file %s", path.c_str());
+        return false;
+    }
+    std::unique_ptr<::openmldb::log::SequentialFile> seq_file(::openmldb::log::NewSeqFile(path, fd));
+    ::openmldb::log::Reader reader(seq_file.get(), NULL, true, 0, false);
+    std::string buffer;
+    while (true) {
+        ::openmldb::base::Slice record;
+        ::openmldb::base::Status status = reader.ReadRecord(&record, &buffer);
+        if (status.IsWaitRecord() || status.IsEof()) {
+            break;
+        }
+        if (!status.ok()) {
+            PDLOG(WARNING, "fail to read the workload capture %s: %s", path.c_str(), status.ToString().c_str());
+            return false;
+        }
+        ::openmldb::api::CaptureEntry entry;
+        if (!entry.ParseFromArray(record.data(), record.size())) {
+            PDLOG(WARNING, "fail to parse the entry of the workload capture %s", path.c_str());
+            return false;
+        }
+        entries->push_back(std::move(entry));
+    }
+    return true;
+}
+
+}  // namespace tablet
+}  // namespace openmldb
@@ -0,0 +1,72 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_TABLET_WORKLOAD_CAPTURE_H_
+#define SRC_TABLET_WORKLOAD_CAPTURE_H_
+
+#include <butil/iobuf.h>
+#include <google/protobuf/message.h>
+
+#include <atomic>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <string>
+#include <vector>
+
+#include "log/log_writer.h"
+#include "proto/tablet.pb.h"
+
+namespace openmldb {
+namespace tablet {
+
+// WorkloadCapture samples the requests of the tablet with their arrival times into a file of CaptureEntry
+// records in the format of the binlog, which is replayed by the workload_replay tool.
+class WorkloadCapture {
+ public:
+    WorkloadCapture();
+    ~WorkloadCapture();
+
+    WorkloadCapture(const WorkloadCapture&) = delete;
+    WorkloadCapture& operator=(const WorkloadCapture&) = delete;
+
+    // the requests are sampled one in sample_interval, and the capture stops when the file reaches max_size
+    bool Open(const std::string& path, uint32_t sample_interval, uint64_t max_size);
+    void Close();
+
+    bool IsEnabled() const { return enabled_.load(std::memory_order_relaxed); }
+
+    // capture the request if it is sampled, time_us is its arrival time
+    void Capture(::openmldb::api::CaptureEntry::Method method, uint64_t time_us,
+                 const google::protobuf::Message& request, const butil::IOBuf& attachment);
+
+    uint64_t GetCapturedCnt() const { return captured_cnt_.load(std::memory_order_relaxed); }
+
+    // read all the entries of the capture file
+    static bool Load(const std::string& path, std::vector<::openmldb::api::CaptureEntry>* entries);
+
+ private:
+    std::atomic<bool> enabled_;
+    std::atomic<uint64_t> request_cnt_;
+    std::atomic<uint64_t> captured_cnt_;
+    uint32_t sample_interval_;
+    uint64_t max_size_;
+    std::mutex mu_;
+    std::unique_ptr<::openmldb::log::WriteHandle> wh_;
+};
+
+}  // namespace tablet
+}  // namespace openmldb
+#endif  // SRC_TABLET_WORKLOAD_CAPTURE_H_
@@ -0,0 +1,94 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tablet/workload_capture.h"
+
+#include <stdlib.h>
+
+#include "base/glog_wapper.h"
+#include "gtest/gtest.h"
+
+namespace openmldb {
+namespace tablet {
+
+class WorkloadCaptureTest : public ::testing::Test {};
+
+TEST_F(WorkloadCaptureTest, CaptureAndLoad) {
+    std::string path = "/tmp/workload_capture_" + std::to_string(rand() % 10000000);  // NOLINT
+    WorkloadCapture capture;
+    ASSERT_FALSE(capture.IsEnabled());
+    ASSERT_TRUE(capture.Open(path, 2, 0));
+    ASSERT_TRUE(capture.IsEnabled());
+    for (int i = 0; i < 10; i++) {
+        ::openmldb::api::QueryRequest request;
+        request.set_db("db");
+        request.set_sql("select " + std::to_string(i));
+        butil::IOBuf attachment;
+        attachment.append("row" + std::to_string(i));
+        capture.Capture(::openmldb::api::CaptureEntry::kQuery, 100 + i, request, attachment);
+    }
+    ::openmldb::api::PutRequest put;
+    put.set_tid(1);
+    capture.Capture(::openmldb::api::CaptureEntry::kPut, 200, put, butil::IOBuf());
+    // one in two requests is captured
+    ASSERT_EQ(6u, capture.GetCapturedCnt());
+    capture.Close();
+    ASSERT_FALSE(capture.IsEnabled());
+
+    std::vector<::openmldb::api::CaptureEntry> entries;
+    ASSERT_TRUE(WorkloadCapture::Load(path, &entries));
+    ASSERT_EQ(6u, entries.size());
+    for (int i = 0; i < 5; i++) {
+        ASSERT_EQ(::openmldb::api::CaptureEntry::kQuery, entries[i].method());
+        ASSERT_EQ(100u + i * 2, entries[i].time_us());
+        ::openmldb::api::QueryRequest request;
+        ASSERT_TRUE(request.ParseFromString(entries[i].request()));
+        ASSERT_EQ("select " + std::to_string(i * 2), request.sql());
+        ASSERT_EQ("row" + std::to_string(i * 2), entries[i].attachment());
+    }
+    ASSERT_EQ(::openmldb::api::CaptureEntry::kPut, entries[5].method());
+    ASSERT_FALSE(entries[5].has_attachment());
+    remove(path.c_str());
+}
+
+TEST_F(WorkloadCaptureTest, MaxSize) {
+    std::string path = "/tmp/workload_capture_" + std::to_string(rand() % 10000000);  // NOLINT
+    WorkloadCapture capture;
+    ASSERT_TRUE(capture.Open(path, 1, 1024));
+    ::openmldb::api::QueryRequest request;
+    request.set_sql(std::string(200, 'a'));
+    for (int i = 0; i < 100; i++) {
+        capture.Capture(::openmldb::api::CaptureEntry::kQuery, i, request, butil::IOBuf());
+    }
+    // the capture stops once the file reaches the max size
+    ASSERT_FALSE(capture.IsEnabled());
+    ASSERT_LT(capture.GetCapturedCnt(), 100u);
+    capture.Close();
+    std::vector<::openmldb::api::CaptureEntry> entries;
+    ASSERT_TRUE(WorkloadCapture::Load(path, &entries));
+    ASSERT_EQ(capture.GetCapturedCnt(), entries.size());
+    remove(path.c_str());
+}
+
+}  // namespace tablet
+}  // namespace openmldb
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    srand(time(NULL));
+    ::openmldb::base::SetLogLevel(INFO);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,189 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// replay the requests captured by the tablet with --workload_capture_path to a tablet, with the arrival
+// intervals of the capture scaled by --replay_speed, and report the qps and the latencies of each method
+
+#include <brpc/controller.h>
+#include <gflags/gflags.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "base/glog_wapper.h"
+#include "common/timer.h"
+#include "proto/tablet.pb.h"
+#include "rpc/rpc_client.h"
+#include "tablet/workload_capture.h"
+
+DEFINE_string(replay_file, "", "the workload capture file to replay");
+DEFINE_string(replay_endpoint, "", "the endpoint of the tablet to replay to");
+DEFINE_double(replay_speed, 1.0, "the speed of the replay, 1 keeps the intervals of the capture and 0 replays "
+              "as fast as possible");
+DEFINE_uint32(replay_thread_num, 8, "the number of the threads sending the requests");
+DEFINE_uint32(replay_timeout_ms, 10000, "the timeout of each request");
+
+using ::openmldb::api::CaptureEntry;
+
+namespace openmldb {
+namespace tools {
+
+struct ReplayStat {
+    uint64_t error_cnt = 0;
+    std::vector<uint64_t> latencies;
+};
+
+bool SendEntry(::openmldb::RpcClient<::openmldb::api::TabletServer_Stub>* client, const CaptureEntry& entry) {
+    brpc::Controller cntl;
+    cntl.set_timeout_ms(FLAGS_replay_timeout_ms);
+    if (!entry.attachment().empty()) {
+        cntl.request_attachment().append(entry.attachment());
+    }
+    switch (entry.method()) {
+        case CaptureEntry::kQuery: {
+            ::openmldb::api::QueryRequest request;
+            ::openmldb::api::QueryResponse response;
+            if (!request.ParseFromString(entry.request())) {
+                return false;
+            }
+            return client->SendRequest(&::openmldb::api::TabletServer_Stub::Query, &cntl, &request, &response) &&
+                   response.code() == 0;
+        }
+        case CaptureEntry::kSQLBatchRequestQuery: {
+            ::openmldb::api::SQLBatchRequestQueryRequest request;
+            ::openmldb::api::SQLBatchRequestQueryResponse response;
+            if (!request.ParseFromString(entry.request())) {
+                return false;
+            }
+            return client->SendRequest(&::openmldb::api::TabletServer_Stub::SQLBatchRequestQuery, &cntl, &request,
+                                       &response) &&
+                   response.code() == 0;
+        }
+        case CaptureEntry::kPut: {
+            ::openmldb::api::PutRequest request;
+            ::openmldb::api::PutResponse response;
+            if (!request.ParseFromString(entry.request())) {
+                return false;
+            }
+            return client->SendRequest(&::openmldb::api::TabletServer_Stub::Put, &cntl, &request, &response) &&
+                   response.code() == 0;
+        }
+        default:
+            return false;
+    }
+}
+
+void ReplayEntries(::openmldb::RpcClient<::openmldb::api::TabletServer_Stub>* client,
+                   const std::vector<CaptureEntry>& entries, uint32_t thread_idx, uint64_t start_us,
+                   std::map<int, ReplayStat>* stats) {
+    uint64_t first_us = entries.front().time_us();
+    for (size_t i = thread_idx; i < entries.size(); i += FLAGS_replay_thread_num) {
+        const auto& entry = entries[i];
+        if (FLAGS_replay_speed > 0) {
+            uint64_t offset_us = static_cast<uint64_t>((entry.time_us() - first_us) / FLAGS_replay_speed);
+            uint64_t now = ::baidu::common::timer::get_micros();
+            if (start_us + offset_us > now) {
+                usleep(start_us + offset_us - now);
+            }
+        }
+        uint64_t begin = ::baidu::common::timer::get_micros();
+        bool ok = SendEntry(client, entry);
+        auto& stat = (*stats)[entry.method()];
+        if (!ok) {
+            stat.error_cnt++;
+        }
+        stat.latencies.push_back(::baidu::common::timer::get_micros() - begin);
+    }
+}
+
+void PrintStat(const std::string& name, ReplayStat* stat, uint64_t duration_us) {
+    auto& latencies = stat->latencies;
+    if (latencies.empty()) {
+        return;
+    }
+    std::sort(latencies.begin(), latencies.end());
+    uint64_t sum = 0;
+    for (auto latency : latencies) {
+        sum += latency;
+    }
+    auto percentile = [&latencies](double p) {
+        return latencies[std::min(latencies.size() - 1, static_cast<size_t>(latencies.size() * p))];
+    };
+    printf("%-24s cnt %lu error %lu qps %.1f avg %luus p50 %luus p99 %luus p999 %luus\n", name.c_str(),
+           latencies.size(), stat->error_cnt, latencies.size() * 1000000.0 / std::max<uint64_t>(duration_us, 1),
+           sum / latencies.size(), percentile(0.5), percentile(0.99), percentile(0.999));
+}
+
+int Replay() {
+    std::vector<CaptureEntry> entries;
+    if (!::openmldb::tablet::WorkloadCapture::Load(FLAGS_replay_file, &entries)) {
+        return 1;
+    }
+    if (entries.empty()) {
+        printf("no request in %s\n", FLAGS_replay_file.c_str());
+        return 0;
+    }
+    std::stable_sort(entries.begin(), entries.end(), [](const CaptureEntry& l, const CaptureEntry& r) {
+        return l.time_us() < r.time_us();
+    });
+    ::openmldb::RpcClient<::openmldb::api::TabletServer_Stub> client(FLAGS_replay_endpoint);
+    if (client.Init() < 0) {
+        printf("fail to init the client of %s\n", FLAGS_replay_endpoint.c_str());
+        return 1;
+    }
+    FLAGS_replay_thread_num = std::max<uint32_t>(FLAGS_replay_thread_num, 1);
+    std::vector<std::map<int, ReplayStat>> thread_stats(FLAGS_replay_thread_num);
+    std::vector<std::thread> threads;
+    uint64_t start_us = ::baidu::common::timer::get_micros();
+    for (uint32_t i = 0; i < FLAGS_replay_thread_num; i++) {
+        threads.emplace_back(ReplayEntries, &client, std::cref(entries), i, start_us, &thread_stats[i]);
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    uint64_t duration_us = ::baidu::common::timer::get_micros() - start_us;
+    std::map<int, ReplayStat> stats;
+    for (auto& thread_stat : thread_stats) {
+        for (auto& kv : thread_stat) {
+            auto& stat = stats[kv.first];
+            stat.error_cnt += kv.second.error_cnt;
+            stat.latencies.insert(stat.latencies.end(), kv.second.latencies.begin(), kv.second.latencies.end());
+        }
+    }
+    printf("replay %lu requests in %.3fs\n", entries.size(), duration_us / 1000000.0);
+    for (auto& kv : stats) {
+        PrintStat(CaptureEntry::Method_Name(static_cast<CaptureEntry::Method>(kv.first)), &kv.second, duration_us);
+    }
+    return 0;
+}
+
+}  // namespace tools
+}  // namespace openmldb
+
+int main(int argc, char** argv) {
+    ::google::SetUsageMessage("workload_replay --replay_file=<capture file> --replay_endpoint=<tablet endpoint>");
+    ::google::ParseCommandLineFlags(&argc, &argv, true);
+    if (FLAGS_replay_file.empty() || FLAGS_replay_endpoint.empty()) {
+        std::cout << ::google::ProgramUsage() << std::endl;
+        return 1;
+    }
+    return ::openmldb::tools::Replay();
+}
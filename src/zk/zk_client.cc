@@ -18,6 +18,7 @@
 
 #include <algorithm>
 #include <utility>
+#include <vector>
 
 #include "base/glog_wapper.h"
 #include "base/strings.h"
@@ -46,9 +47,8 @@ void NodeWatcher(zhandle_t* zh, int type, int state, const char* path, void* wat
     PDLOG(INFO, "node watcher with event type %d, state %d", type, state);
     if (zoo_get_context(zh)) {
         ZkClient* client = const_cast<ZkClient*>(reinterpret_cast<const ZkClient*>(zoo_get_context(zh)));
+        // zookeeper is just one time watching, the nodes are watched again when they are got
         client->HandleNodesChanged(type, state);
-        // zookeeper is just one time watching, so need to watch nodes again
-        client->WatchNodes();
     }
 }
 
@@ -61,6 +61,35 @@ void ItemWatcher(zhandle_t* zh, int type, int state, const char* path, void* wat
     }
 }
 
+struct NodesVersionContext {
+    std::mutex mu;
+    std::condition_variable cv;
+    uint32_t pending = 0;
+    bool ok = true;
+    std::vector<int64_t>* versions = nullptr;
+};
+
+struct NodeVersionRequest {
+    NodesVersionContext* ctx;
+    uint32_t idx;
+};
+
+void NodeVersionCompletion(int rc, const struct Stat* stat, const void* data) {
+    const NodeVersionRequest* request = reinterpret_cast<const NodeVersionRequest*>(data);
+    NodesVersionContext* ctx = request->ctx;
+    std::lock_guard<std::mutex> lock(ctx->mu);
+    if (rc == ZOK && stat != NULL) {
+        (*ctx->versions)[request->idx] = stat->mzxid;
+    } else if (rc == ZNONODE) {
+        (*ctx->versions)[request->idx] = -1;
+    } else {
+        ctx->ok = false;
+    }
+    if (--ctx->pending == 0) {
+        ctx->cv.notify_all();
+    }
+}
+
 ZkClient::ZkClient(const std::string& hosts, const std::string& real_endpoint, int32_t session_timeout,
                    const std::string& endpoint, const std::string& zk_root_path)
     : hosts_(hosts),
@@ -80,6 +109,8 @@ ZkClient::ZkClient(const std::string& hosts, const std::string& real_endpoint, i
       registed_(false),
       children_callbacks_(),
       item_callbacks_(),
+      children_cache_(),
+      item_versions_(),
       session_term_(0) {
     data_.count = 0;
     data_.data = NULL;
@@ -102,6 +133,8 @@ ZkClient::ZkClient(const std::string& hosts, int32_t session_timeout, const std:
       registed_(false),
       children_callbacks_(),
       item_callbacks_(),
+      children_cache_(),
+      item_versions_(),
       session_term_(0) {
     data_.count = 0;
     data_.data = NULL;
@@ -126,25 +159,27 @@ bool ZkClient::Init() {
 }
 
 void ZkClient::HandleNodesChanged(int type, int state) {
-    if (type == ZOO_CHILD_EVENT) {
-        std::vector<std::string> endpoints;
-        bool ok = GetNodes(endpoints);
-        if (!ok) {
+    if (type != ZOO_CHILD_EVENT) {
+        WatchNodes();
+        return;
+    }
+    std::vector<std::string> endpoints;
+    std::vector<NodesChangedCallback> watch_callbacks_vec;
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        // the nodes are got and watched again in one request
+        if (!WatchNodesUnLocked(&endpoints)) {
             return;
         }
-        std::vector<NodesChangedCallback> watch_callbacks_vec;
-        {
-            std::lock_guard<std::mutex> lock(mu_);
-            watch_callbacks_vec = nodes_watch_callbacks_;
-        }
-        PDLOG(INFO,
-              "handle node changed event with type %d, and state %d, endpoints "
-              "size %d, callback size %d",
-              type, state, endpoints.size(), watch_callbacks_vec.size());
-        std::vector<NodesChangedCallback>::iterator it = watch_callbacks_vec.begin();
-        for (; it != watch_callbacks_vec.end(); ++it) {
-            (*it)(endpoints);
-        }
+        watch_callbacks_vec = nodes_watch_callbacks_;
+    }
+    PDLOG(INFO,
+          "handle node changed event with type %d, and state %d, endpoints "
+          "size %d, callback size %d",
+          type, state, endpoints.size(), watch_callbacks_vec.size());
+    std::vector<NodesChangedCallback>::iterator it = watch_callbacks_vec.begin();
+    for (; it != watch_callbacks_vec.end(); ++it) {
+        (*it)(endpoints);
     }
 }
 
@@ -282,32 +317,34 @@ bool ZkClient::CreateNode(const std::string& node, const std::string& value, int
 
 void ZkClient::HandleChildrenChanged(const std::string& path, int type, int state) {
     NodesChangedCallback callback;
+    std::vector<std::string> children;
     {
         std::lock_guard<std::mutex> lock(mu_);
-        std::map<std::string, NodesChangedCallback>::iterator it = children_callbacks_.find(path);
+        auto it = children_callbacks_.find(path);
         if (it == children_callbacks_.end()) {
             PDLOG(INFO, "watch for path %s not exist", path.c_str());
             return;
         }
         callback = it->second;
-    }
-    if (type == ZOO_CHILD_EVENT) {
-        std::vector<std::string> children;
-        bool ok = GetChildren(path, children);
-        if (!ok) {
+        // the children are got and watched again in one request
+        if (!WatchChildrenUnLocked(path, &children)) {
             PDLOG(WARNING, "fail to get nodes for path %s", path.c_str());
-            WatchChildren(path, callback);
             return;
         }
-        PDLOG(INFO, "handle node changed event with type %d, and state %d for path %s", type, state, path.c_str());
-        callback(children);
+        auto& cached_children = children_cache_[path];
+        if (type != ZOO_CHILD_EVENT || cached_children == children) {
+            return;
+        }
+        cached_children = children;
     }
-    WatchChildren(path, callback);
+    PDLOG(INFO, "handle node changed event with type %d, and state %d for path %s", type, state, path.c_str());
+    callback(children);
 }
 
 void ZkClient::CancelWatchChildren(const std::string& node) {
     std::lock_guard<std::mutex> lock(mu_);
     children_callbacks_.erase(node);
+    children_cache_.erase(node);
 }
 
 bool ZkClient::WatchChildren(const std::string& node, NodesChangedCallback callback) {
@@ -316,15 +353,31 @@ bool ZkClient::WatchChildren(const std::string& node, NodesChangedCallback callb
     if (it == children_callbacks_.end()) {
         children_callbacks_.insert(std::make_pair(node, callback));
     }
+    std::vector<std::string> children;
+    if (!WatchChildrenUnLocked(node, &children)) {
+        return false;
+    }
+    children_cache_[node].swap(children);
+    return true;
+}
+
+bool ZkClient::WatchChildrenUnLocked(const std::string& node, std::vector<std::string>* children) {
     if (zk_ == NULL || !connected_) {
         return false;
     }
-    deallocate_String_vector(&data_);
-    int ret = zoo_wget_children(zk_, node.c_str(), ChildrenWatcher, NULL, &data_);
+    struct String_vector data;
+    data.count = 0;
+    data.data = NULL;
+    int ret = zoo_wget_children(zk_, node.c_str(), ChildrenWatcher, NULL, &data);
     if (ret != ZOK) {
         PDLOG(WARNING, "fail to watch path %s errno %d", node.c_str(), ret);
         return false;
     }
+    for (int32_t i = 0; i < data.count; i++) {
+        children->push_back(std::string(data.data[i]));
+    }
+    deallocate_String_vector(&data);
+    std::sort(children->begin(), children->end());
     return true;
 }
 
@@ -371,6 +424,65 @@ bool ZkClient::SetNodeValue(const std::string& node, const std::string& value) {
     return false;
 }
 
+bool ZkClient::SetNodesValue(const std::vector<std::string>& nodes, const std::vector<std::string>& values) {
+    if (nodes.empty() || nodes.size() != values.size()) {
+        return false;
+    }
+    std::vector<zoo_op_t> ops(nodes.size());
+    std::vector<zoo_op_result_t> results(nodes.size());
+    std::vector<struct Stat> stats(nodes.size());
+    for (uint32_t i = 0; i < nodes.size(); i++) {
+        zoo_set_op_init(&ops[i], nodes[i].c_str(), values[i].c_str(), values[i].length(), -1, &stats[i]);
+    }
+    std::lock_guard<std::mutex> lock(mu_);
+    if (zk_ == NULL || !connected_) {
+        return false;
+    }
+    int ret = zoo_multi(zk_, ops.size(), ops.data(), results.data());
+    if (ret != ZOK) {
+        PDLOG(WARNING, "set the values of %u nodes failed, ret %d", static_cast<uint32_t>(nodes.size()), ret);
+        return false;
+    }
+    return true;
+}
+
+bool ZkClient::GetNodesVersion(const std::vector<std::string>& nodes, std::vector<int64_t>* versions) {
+    if (versions == NULL) {
+        return false;
+    }
+    versions->assign(nodes.size(), -1);
+    NodesVersionContext ctx;
+    ctx.versions = versions;
+    std::vector<NodeVersionRequest> requests(nodes.size());
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        if (zk_ == NULL || !connected_) {
+            return false;
+        }
+        for (uint32_t i = 0; i < nodes.size(); i++) {
+            requests[i].ctx = &ctx;
+            requests[i].idx = i;
+            {
+                std::lock_guard<std::mutex> ctx_lock(ctx.mu);
+                ctx.pending++;
+            }
+            if (zoo_aexists(zk_, nodes[i].c_str(), 0, NodeVersionCompletion, &requests[i]) != ZOK) {
+                std::lock_guard<std::mutex> ctx_lock(ctx.mu);
+                ctx.pending--;
+                ctx.ok = false;
+                break;
+            }
+        }
+    }
+    // every request sent is completed, even if the session is closed
+    std::unique_lock<std::mutex> ctx_lock(ctx.mu);
+    ctx.cv.wait(ctx_lock, [&ctx] { return ctx.pending == 0; });
+    if (!ctx.ok) {
+        PDLOG(WARNING, "fail to get the version of %lu nodes", nodes.size());
+    }
+    return ctx.ok;
+}
+
 bool ZkClient::Increment(const std::string& node) {
     int try_num = 3;
     while (try_num-- > 0) {
@@ -419,6 +531,10 @@ int ZkClient::IsExistNode(const std::string& node) {
 
 bool ZkClient::WatchNodes() {
     std::lock_guard<std::mutex> lock(mu_);
+    return WatchNodesUnLocked(NULL);
+}
+
+bool ZkClient::WatchNodesUnLocked(std::vector<std::string>* endpoints) {
     if (zk_ == NULL || !connected_) {
         return false;
     }
@@ -428,6 +544,11 @@ bool ZkClient::WatchNodes() {
         PDLOG(WARNING, "fail to watch path %s errno %d", nodes_root_path_.c_str(), ret);
         return false;
     }
+    if (endpoints != NULL) {
+        for (int32_t i = 0; i < data_.count; i++) {
+            endpoints->push_back(std::string(data_.data[i]));
+        }
+    }
     return true;
 }
 
@@ -441,16 +562,20 @@ void ZkClient::HandleItemChanged(const std::string& path, int type, int state) {
             return;
         }
         callback = it->second;
+        // watch again before the callback, so the changes made during the callback are not missed
+        int64_t version = -1;
+        WatchItemUnLocked(path, &version);
+        item_versions_[path] = version;
     }
     if (type == ZOO_CHANGED_EVENT) {
         callback();
     }
-    WatchItem(path, callback);
 }
 
 void ZkClient::CancelWatchItem(const std::string& path) {
     std::lock_guard<std::mutex> lock(mu_);
     item_callbacks_.erase(path);
+    item_versions_.erase(path);
 }
 
 bool ZkClient::WatchItem(const std::string& path, ItemChangedCallback callback) {
@@ -462,16 +587,70 @@ bool ZkClient::WatchItem(const std::string& path, ItemChangedCallback callback)
     if (it == item_callbacks_.end()) {
         item_callbacks_.insert(std::make_pair(path, callback));
     }
-    deallocate_String_vector(&data_);
-    int buffer_len = ZK_MAX_BUFFER_SIZE;
-    int ret = zoo_wget(zk_, path.data(), ItemWatcher, NULL, buffer_, &buffer_len, NULL);
+    int64_t version = -1;
+    if (!WatchItemUnLocked(path, &version)) {
+        return false;
+    }
+    item_versions_[path] = version;
+    return true;
+}
+
+bool ZkClient::WatchItemUnLocked(const std::string& path, int64_t* version) {
+    if (zk_ == NULL || !connected_) {
+        return false;
+    }
+    // the value is not needed to watch the changes of the item
+    Stat stat;
+    int ret = zoo_wexists(zk_, path.c_str(), ItemWatcher, NULL, &stat);
     if (ret != ZOK) {
-        PDLOG(WARNING, "fail to watch item %s errno %d", nodes_root_path_.c_str(), ret);
+        PDLOG(WARNING, "fail to watch item %s errno %d", path.c_str(), ret);
         return false;
     }
+    *version = stat.mzxid;
     return true;
 }
 
+void ZkClient::ResumeWatches() {
+    std::vector<ItemChangedCallback> item_callbacks;
+    std::vector<std::pair<NodesChangedCallback, std::vector<std::string>>> children_callbacks;
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        if (zk_ == NULL || !connected_) {
+            return;
+        }
+        for (const auto& kv : item_callbacks_) {
+            int64_t version = -1;
+            if (!WatchItemUnLocked(kv.first, &version)) {
+                continue;
+            }
+            auto version_it = item_versions_.find(kv.first);
+            if (version_it == item_versions_.end() || version_it->second != version) {
+                item_versions_[kv.first] = version;
+                item_callbacks.push_back(kv.second);
+            }
+        }
+        for (const auto& kv : children_callbacks_) {
+            std::vector<std::string> children;
+            if (!WatchChildrenUnLocked(kv.first, &children)) {
+                continue;
+            }
+            auto& cached_children = children_cache_[kv.first];
+            if (cached_children != children) {
+                cached_children = children;
+                children_callbacks.emplace_back(kv.second, std::move(children));
+            }
+        }
+    }
+    PDLOG(INFO, "resume watches, %u items and %u children changed while the session is lost",
+          static_cast<uint32_t>(item_callbacks.size()), static_cast<uint32_t>(children_callbacks.size()));
+    for (const auto& callback : item_callbacks) {
+        callback();
+    }
+    for (const auto& kv : children_callbacks) {
+        kv.first(kv.second);
+    }
+}
+
 void ZkClient::WatchNodes(NodesChangedCallback callback) {
     std::lock_guard<std::mutex> lock(mu_);
     nodes_watch_callbacks_.push_back(callback);
@@ -533,6 +712,9 @@ bool ZkClient::Reconnect() {
         PDLOG(WARNING, "fail to init zk handler with hosts %s, session_timeout %d", hosts_.c_str(), session_timeout_);
         return false;
     }
+    lock.unlock();
+    // the watches are lost with the session, only the ones changed in between are notified
+    ResumeWatches();
     return true;
 }
 
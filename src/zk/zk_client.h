@@ -89,6 +89,13 @@ class ZkClient {
 
     bool SetNodeValue(const std::string& node, const std::string& value);
 
+    // set the values of the nodes in one transaction, none of them is set if it fails
+    bool SetNodesValue(const std::vector<std::string>& nodes, const std::vector<std::string>& values);
+
+    // get the zxids where the nodes are last modified, which are requested in a pipeline.
+    // the version is -1 if the node does not exist
+    bool GetNodesVersion(const std::vector<std::string>& nodes, std::vector<int64_t>* versions);
+
     bool SetNodeWatcher(const std::string& node, watcher_fn watcher, void* watcherCtx);
 
     bool Increment(const std::string& node);
@@ -126,12 +133,22 @@ class ZkClient {
 
     inline uint64_t GetSessionTerm() { return session_term_.load(std::memory_order_relaxed); }
 
-    // when reconnect, need Register and Watchnodes again
+    // when reconnect, need Register and Watchnodes again. the items and the children watched are
+    // watched again by the client itself
     bool Reconnect();
 
+    // watch the items and the children with the current session again, and run the callbacks of the
+    // ones changed after they are last got
+    void ResumeWatches();
+
  private:
     void Connected();
 
+    // get the children sorted and watch the node in one request
+    bool WatchChildrenUnLocked(const std::string& node, std::vector<std::string>* children);
+    bool WatchItemUnLocked(const std::string& path, int64_t* version);
+    bool WatchNodesUnLocked(std::vector<std::string>* endpoints);
+
  private:
     // input args
     std::string hosts_;
@@ -156,6 +173,9 @@ class ZkClient {
     std::atomic<bool> registed_;
     std::map<std::string, NodesChangedCallback> children_callbacks_;
     std::map<std::string, ItemChangedCallback> item_callbacks_;
+    // the children and the zxids of the items last got, to tell the changes when the watches are resumed
+    std::map<std::string, std::vector<std::string>> children_cache_;
+    std::map<std::string, int64_t> item_versions_;
     char buffer_[ZK_MAX_BUFFER_SIZE];
     std::atomic<uint64_t> session_term_;
 };
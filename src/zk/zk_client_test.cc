@@ -108,6 +108,54 @@ TEST_F(ZkClientTest, CreateNode) {
     ASSERT_TRUE(ok);
 }
 
+TEST_F(ZkClientTest, GetNodesVersion) {
+    ZkClient client("127.0.0.1:6181", "", session_timeout, "127.0.0.1:9527", "/rtidb1");
+    bool ok = client.Init();
+    ASSERT_TRUE(ok);
+    std::string node1 = "/rtidb1/test/node" + GenRand();
+    std::string node2 = "/rtidb1/test/node" + GenRand();
+    ASSERT_TRUE(client.CreateNode(node1, "value1"));
+    ASSERT_TRUE(client.CreateNode(node2, "value2"));
+    std::vector<int64_t> versions;
+    ASSERT_TRUE(client.GetNodesVersion({node1, node2, node1 + "_not_exist"}, &versions));
+    ASSERT_EQ(3u, versions.size());
+    ASSERT_GT(versions[0], 0);
+    ASSERT_GT(versions[1], versions[0]);
+    ASSERT_EQ(-1, versions[2]);
+
+    // only the version of the node changed is updated
+    ASSERT_TRUE(client.SetNodeValue(node1, "value3"));
+    std::vector<int64_t> new_versions;
+    ASSERT_TRUE(client.GetNodesVersion({node1, node2}, &new_versions));
+    ASSERT_GT(new_versions[0], versions[1]);
+    ASSERT_EQ(versions[1], new_versions[1]);
+    ASSERT_TRUE(client.DeleteNode(node1));
+    ASSERT_TRUE(client.DeleteNode(node2));
+}
+
+TEST_F(ZkClientTest, SetNodesValue) {
+    ZkClient client("127.0.0.1:6181", "", session_timeout, "127.0.0.1:9527", "/rtidb1");
+    bool ok = client.Init();
+    ASSERT_TRUE(ok);
+    std::string node1 = "/rtidb1/test/node" + GenRand();
+    std::string node2 = "/rtidb1/test/node" + GenRand();
+    ASSERT_TRUE(client.CreateNode(node1, "value1"));
+    ASSERT_TRUE(client.CreateNode(node2, "value2"));
+    ASSERT_TRUE(client.SetNodesValue({node1, node2}, {"value3", "value4"}));
+    std::string value;
+    ASSERT_TRUE(client.GetNodeValue(node1, value));
+    ASSERT_EQ("value3", value);
+    ASSERT_TRUE(client.GetNodeValue(node2, value));
+    ASSERT_EQ("value4", value);
+
+    // nothing is set if one of the nodes does not exist
+    ASSERT_FALSE(client.SetNodesValue({node1, node2 + "_not_exist"}, {"value5", "value6"}));
+    ASSERT_TRUE(client.GetNodeValue(node1, value));
+    ASSERT_EQ("value3", value);
+    ASSERT_TRUE(client.DeleteNode(node1));
+    ASSERT_TRUE(client.DeleteNode(node2));
+}
+
 TEST_F(ZkClientTest, ZkNodeChange) {
     ZkClient client("127.0.0.1:6181", "", session_timeout, "127.0.0.1:9527", "/rtidb1");
     bool ok = client.Init();
@@ -148,6 +196,28 @@ TEST_F(ZkClientTest, ZkNodeChange) {
     ASSERT_TRUE(detect.load());
 }
 
+TEST_F(ZkClientTest, ResumeWatches) {
+    ZkClient client("127.0.0.1:6181", "", session_timeout, "127.0.0.1:9527", "/rtidb1");
+    ASSERT_TRUE(client.Init());
+    std::string node = "/rtidb1/test/node" + GenRand();
+    ASSERT_TRUE(client.CreateNode(node, "1"));
+
+    ZkClient client2("127.0.0.1:6181", "", session_timeout, "127.0.0.1:9527", "/rtidb1");
+    ASSERT_TRUE(client2.Init());
+    std::atomic<int> changed(0);
+    ASSERT_TRUE(client2.WatchItem(node, [&changed] { changed++; }));
+    // the item is not changed while the session is lost, so the callback is not run
+    ASSERT_TRUE(client2.Reconnect());
+    ASSERT_EQ(0, changed.load());
+    // the item is watched with the new session
+    ASSERT_TRUE(client.SetNodeValue(node, "2"));
+    for (int i = 0; i < 30 && changed.load() == 0; i++) {
+        sleep(1);
+    }
+    ASSERT_EQ(1, changed.load());
+    ASSERT_TRUE(client.DeleteNode(node));
+}
+
 }  // namespace zk
 }  // namespace openmldb
 